@@ -17,14 +17,26 @@
 #include <androidfw/BackupHelpers.h>
 #include <utils/String8.h>
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace android;
 
 #include <unistd.h>
 
+// Entity data that can't be moved by the kernel is copied in chunks this large.
+static const size_t COPY_BUFFER_SIZE = 256 * 1024;
+
 static int usage(int /* argc */, const char** argv)
 {
     const char* p = argv[0];
@@ -38,11 +50,155 @@ static int usage(int /* argc */, const char** argv)
                     "  Lists the backup entities in the file.\n"
                     "\n"
                     "usage: %s print NAME FILE\n"
-                    "  Prints the entity named NAME in FILE.\n",
+                    "  Writes the data of the entity named NAME in FILE to stdout.\n",
                     p, p, p, p);
     return 1;
 }
 
+static bool write_fully(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t amt = TEMP_FAILURE_RETRY(write(fd, data, size));
+        if (amt <= 0) {
+            return false;
+        }
+        data += amt;
+        size -= amt;
+    }
+    return true;
+}
+
+// Reads through the data of the current entity, for inputs that can't seek past it.
+static int skip_entity_data(BackupDataReader& reader)
+{
+    if (reader.SkipEntityData() == 0) {
+        return 0;
+    }
+    std::vector<char> buffer(COPY_BUFFER_SIZE);
+    ssize_t amt;
+    while ((amt = reader.ReadEntityData(buffer.data(), buffer.size())) > 0) {
+    }
+    return amt == 0 ? 0 : reader.Status();
+}
+
+// Moves |size| bytes at |offset| of |in| to |out| without them going through user space:
+// splice() when |out| is a pipe, sendfile() otherwise. Returns how many bytes were moved, which
+// is less than |size| when the kernel can't do it for these files.
+static size_t move_in_kernel(int in, off64_t offset, int out, size_t size)
+{
+    struct stat st;
+    const bool toPipe = fstat(out, &st) == 0 && S_ISFIFO(st.st_mode);
+    size_t moved = 0;
+    while (moved < size) {
+        const size_t chunk = size - moved;
+        ssize_t amt;
+        if (toPipe) {
+            loff_t inOffset = offset;
+            amt = TEMP_FAILURE_RETRY(splice(in, &inOffset, out, nullptr, chunk, SPLICE_F_MORE));
+        } else {
+            off64_t inOffset = offset;
+            amt = TEMP_FAILURE_RETRY(sendfile64(out, in, &inOffset, chunk));
+        }
+        if (amt <= 0) {
+            break;
+        }
+        offset += amt;
+        moved += amt;
+    }
+    return moved;
+}
+
+// Copies the rest of the current entity's data with the reads on another thread, so that reading
+// a chunk overlaps writing the previous one, e.g. when both ends are slow pipes.
+static bool copy_pipelined(BackupDataReader& reader, int out)
+{
+    struct Chunk {
+        std::vector<char> data = std::vector<char>(COPY_BUFFER_SIZE);
+        // Bytes in |data|, 0 at the end of the entity and -1 after a read error.
+        ssize_t size = 0;
+        bool full = false;
+    };
+    Chunk chunks[2];
+    std::mutex lock;
+    std::condition_variable changed;
+    bool writeFailed = false;
+
+    std::thread readerThread([&]() {
+        for (size_t i = 0;; i ^= 1) {
+            Chunk& chunk = chunks[i];
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [&]() { return !chunk.full || writeFailed; });
+                if (writeFailed) {
+                    return;
+                }
+            }
+            const ssize_t amt = reader.ReadEntityData(chunk.data.data(), chunk.data.size());
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                chunk.size = amt;
+                chunk.full = true;
+            }
+            changed.notify_all();
+            if (amt <= 0) {
+                return;
+            }
+        }
+    });
+
+    bool ok = true;
+    for (size_t i = 0;; i ^= 1) {
+        Chunk& chunk = chunks[i];
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&]() { return chunk.full; });
+        }
+        if (chunk.size <= 0) {
+            ok = chunk.size == 0;
+            break;
+        }
+        if (!write_fully(out, chunk.data.data(), chunk.size)) {
+            std::lock_guard<std::mutex> guard(lock);
+            writeFailed = true;
+            ok = false;
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            chunk.full = false;
+        }
+        changed.notify_all();
+    }
+    changed.notify_all();
+    readerThread.join();
+    return ok;
+}
+
+// Writes the |size| bytes of data of the current entity to |out|. When |in| is a file, the data
+// is moved by the kernel and then skipped in the reader; anything left is copied through buffers.
+static bool copy_entity_data(BackupDataReader& reader, int in, size_t size, int out)
+{
+    const off64_t offset = lseek64(in, 0, SEEK_CUR);
+    if (offset >= 0 && size > 0) {
+        const size_t moved = move_in_kernel(in, offset, out, size);
+        if (moved == size) {
+            return reader.SkipEntityData() == 0;
+        }
+        // The file offset didn't move, so read past what was already written out to keep the
+        // reader in step.
+        std::vector<char> buffer(COPY_BUFFER_SIZE);
+        for (size_t left = moved; left > 0;) {
+            const ssize_t amt = reader.ReadEntityData(buffer.data(),
+                                                      std::min(left, buffer.size()));
+            if (amt <= 0) {
+                return false;
+            }
+            left -= amt;
+        }
+    }
+    return copy_pipelined(reader, out);
+}
+
 static int perform_full_backup()
 {
     printf("this would have written all of your data to stdout\n");
@@ -60,7 +216,8 @@ static int perform_list(const char* filename)
         return 1;
     }
 
-    BackupDataReader reader(fd);
+    // Only headers are parsed, so read ahead of them.
+    BackupDataReader reader(fd, COPY_BUFFER_SIZE);
     bool done;
     int type;
 
@@ -76,6 +233,7 @@ static int perform_list(const char* filename)
                 err = reader.ReadEntityHeader(&key, &dataSize);
                 if (err == 0) {
                     printf("   entity: %s (%zu bytes)\n", key.string(), dataSize);
+                    err = skip_entity_data(reader);
                 } else {
                     printf("   Error reading entity header\n");
                 }
@@ -94,8 +252,45 @@ static int perform_list(const char* filename)
 
 static int perform_print(const char* entityname, const char* filename)
 {
-    printf("perform_print(%s, %s);", entityname, filename);
-    return 0;
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error opening: %s\n", filename);
+        return 1;
+    }
+
+    BackupDataReader reader(fd);
+    bool done;
+    int type;
+    int result = 1;
+
+    while (reader.ReadNextHeader(&done, &type) == 0 && !done) {
+        if (type != BACKUP_HEADER_ENTITY_V1) {
+            fprintf(stderr, "Unknown chunk type: 0x%08x\n", type);
+            break;
+        }
+        String8 key;
+        size_t dataSize;
+        if (reader.ReadEntityHeader(&key, &dataSize) != 0) {
+            fprintf(stderr, "Error reading entity header\n");
+            break;
+        }
+        if (key != entityname) {
+            if (skip_entity_data(reader) != 0) {
+                fprintf(stderr, "Error skipping entity: %s\n", key.string());
+                break;
+            }
+            continue;
+        }
+        if (copy_entity_data(reader, fd, dataSize, STDOUT_FILENO)) {
+            result = 0;
+        } else {
+            fprintf(stderr, "Error writing entity: %s (%s)\n", key.string(), strerror(errno));
+        }
+        break;
+    }
+
+    close(fd);
+    return result;
 }
 
 int main(int argc, const char** argv)
@@ -16,7 +16,13 @@
 
 #define LOG_NDEBUG 0
 #define LOG_TAG "BootAnimation"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <stdint.h>
@@ -40,8 +46,10 @@
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
+#include <utils/Trace.h>
 
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 
 #include <ui/DisplayMode.h>
 #include <ui/PixelFormat.h>
@@ -102,6 +110,7 @@ static const int TEXT_CENTER_VALUE = INT_MAX;
 static const int TEXT_MISSING_VALUE = INT_MIN;
 static const char EXIT_PROP_NAME[] = "service.bootanim.exit";
 static const char PROGRESS_PROP_NAME[] = "service.bootanim.progress";
+static const char FRAME_STATS_PROP_NAME[] = "service.bootanim.frame_stats";
 static const char DISPLAYS_PROP_NAME[] = "persist.service.bootanim.displays";
 static const char CLOCK_ENABLED_PROP_NAME[] = "persist.sys.bootanim.clock.enabled";
 static const int ANIM_ENTRY_NAME_MAX = ANIM_PATH_MAX + 1;
@@ -249,6 +258,34 @@ void BootAnimation::binderDied(const wp<IBinder>&) {
     requestExit();
 }
 
+// KTX 1.1 files, which a part may hold compressed frames in instead of PNG files, start with this
+// identifier and then a KtxHeader.
+static const uint8_t KTX_IDENTIFIER[] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+static constexpr uint32_t KTX_ENDIANNESS = 0x04030201;
+
+struct KtxHeader {
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+static bool isKtxTexture(const FileMap* map) {
+    return map->getDataLength() >= sizeof(KTX_IDENTIFIER) + sizeof(KtxHeader) &&
+            memcmp(map->getDataPtr(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0;
+}
+
 static void* decodeImage(const void* encodedData, size_t dataLength, AndroidBitmapInfo* outInfo,
     bool premultiplyAlpha) {
     AImageDecoder* decoder = nullptr;
@@ -352,15 +389,19 @@ status_t BootAnimation::initTexture(FileMap* map, int* width, int* height,
         return NO_INIT;
     }
 
-    const int w = bitmapInfo.width;
-    const int h = bitmapInfo.height;
+    *width = bitmapInfo.width;
+    *height = bitmapInfo.height;
 
+    return initTexture(pixels, bitmapInfo.format, bitmapInfo.width, bitmapInfo.height);
+}
+
+status_t BootAnimation::initTexture(const void* pixels, int32_t format, int w, int h) {
     int tw = 1 << (31 - __builtin_clz(w));
     int th = 1 << (31 - __builtin_clz(h));
     if (tw < w) tw <<= 1;
     if (th < h) th <<= 1;
 
-    switch (bitmapInfo.format) {
+    switch (format) {
         case ANDROID_BITMAP_FORMAT_RGBA_8888:
             if (!mUseNpotTextures && (tw != w || th != h)) {
                 glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tw, th, 0, GL_RGBA,
@@ -393,12 +434,166 @@ status_t BootAnimation::initTexture(FileMap* map, int* width, int* height,
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    *width = w;
-    *height = h;
+    return NO_ERROR;
+}
 
+status_t BootAnimation::initCompressedTexture(FileMap* map, int* width, int* height) {
+    // Stored zip entries aren't aligned, so the header is copied out.
+    const uint8_t* data = static_cast<const uint8_t*>(map->getDataPtr());
+    const size_t length = map->getDataLength();
+    KtxHeader header;
+    memcpy(&header, data + sizeof(KTX_IDENTIFIER), sizeof(header));
+
+    // Only the first mipmap level is uploaded: frames are drawn at their size.
+    size_t offset = sizeof(KTX_IDENTIFIER) + sizeof(header);
+    uint32_t imageSize = 0;
+    bool valid = header.endianness == KTX_ENDIANNESS && header.glType == 0 &&
+            header.pixelDepth == 0 && header.numberOfArrayElements == 0 &&
+            header.numberOfFaces == 1 && header.bytesOfKeyValueData <= length - offset;
+    if (valid) {
+        offset += header.bytesOfKeyValueData;
+        valid = sizeof(imageSize) <= length - offset;
+    }
+    if (valid) {
+        memcpy(&imageSize, data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+        valid = imageSize <= length - offset;
+    }
+    if (!valid) {
+        SLOGE("Frame is not a 2D compressed KTX texture");
+        delete map;
+        return NO_INIT;
+    }
+    if (std::find(mCompressedTextureFormats.begin(), mCompressedTextureFormats.end(),
+            static_cast<GLint>(header.glInternalFormat)) == mCompressedTextureFormats.end()) {
+        SLOGE("Compressed texture format 0x%x is not supported", header.glInternalFormat);
+        delete map;
+        return NO_INIT;
+    }
+
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, header.glInternalFormat, header.pixelWidth,
+            header.pixelHeight, 0, imageSize, data + offset);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    *width = header.pixelWidth;
+    *height = header.pixelHeight;
+
+    // As in initTexture(), the packed frame isn't needed past its upload.
+    delete map;
     return NO_ERROR;
 }
 
+// Decodes the frames of a part on worker threads ahead of playAnimation(), which only has their
+// upload left to do, so that big panels don't drop frames to PNG decoding. At most a ring of a
+// few frames is held decoded at a time, rather than the whole part.
+class BootAnimation::FrameDecoder {
+public:
+    struct DecodedFrame {
+        AndroidBitmapInfo info;
+        std::unique_ptr<void, decltype(free)*> pixels{nullptr, free};
+        // A KTX texture to upload as it is stored, instead of pixels.
+        FileMap* compressedTexture = nullptr;
+        nsecs_t decodeTime = 0;
+    };
+
+    explicit FrameDecoder(const Animation::Part& part) : mPart(part), mSlots(RING_SIZE) {
+        const size_t workerCount = std::min(WORKER_COUNT, part.frames.size());
+        for (size_t i = 0; i < workerCount; i++) {
+            mWorkers.emplace_back([this] { decodeFrames(); });
+        }
+    }
+
+    ~FrameDecoder() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_all();
+        for (std::thread& worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    // Waits for the frame at |index|, the one after the last taken, and returns it, without
+    // pixels if it couldn't be decoded.
+    DecodedFrame take(size_t index) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        Slot& slot = mSlots[index % RING_SIZE];
+        mCondition.wait(lock, [&] { return slot.index == index && slot.ready; });
+        DecodedFrame frame = std::move(slot.frame);
+        slot.index = NO_FRAME;
+        slot.ready = false;
+        mNextTake = index + 1;
+        lock.unlock();
+        mCondition.notify_all();
+        return frame;
+    }
+
+private:
+    // A 4K frame takes 32MB decoded: two being decoded while one is waiting for upload keep
+    // both workers busy.
+    static constexpr size_t RING_SIZE = 3;
+    static constexpr size_t WORKER_COUNT = 2;
+    static constexpr size_t NO_FRAME = SIZE_MAX;
+
+    struct Slot {
+        size_t index = NO_FRAME;
+        bool ready = false;
+        DecodedFrame frame;
+    };
+
+    void decodeFrames() {
+        const size_t fcount = mPart.frames.size();
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true) {
+            mCondition.wait(lock, [&] {
+                return mStopping || mNextDecode >= fcount || mNextDecode < mNextTake + RING_SIZE;
+            });
+            if (mStopping || mNextDecode >= fcount) {
+                return;
+            }
+            const size_t index = mNextDecode++;
+            Slot& slot = mSlots[index % RING_SIZE];
+            slot.index = index;
+            lock.unlock();
+
+            DecodedFrame frame;
+            const Animation::Frame& source(mPart.frames[index]);
+            const nsecs_t decodeStart = systemTime();
+            if (isKtxTexture(source.map)) {
+                frame.compressedTexture = source.map;
+            } else {
+                // Set decoding option to alpha unpremultiplied so that the R, G, B channels
+                // of transparent pixels are preserved.
+                frame.pixels.reset(decodeImage(source.map->getDataPtr(),
+                        source.map->getDataLength(), &frame.info,
+                        false /* don't premultiply alpha */));
+                // As in initTexture(), the packed frame isn't needed past its decoding.
+                delete source.map;
+            }
+            frame.decodeTime = systemTime() - decodeStart;
+
+            lock.lock();
+            slot.frame = std::move(frame);
+            slot.ready = true;
+            mCondition.notify_all();
+        }
+    }
+
+    const Animation::Part& mPart;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<Slot> mSlots;
+    size_t mNextDecode = 0;
+    size_t mNextTake = 0;
+    bool mStopping = false;
+    std::vector<std::thread> mWorkers;
+};
+
 class BootAnimation::DisplayEventCallback : public LooperCallback {
     BootAnimation* mBootAnimation;
 
@@ -1400,6 +1595,14 @@ bool BootAnimation::movie() {
         }
     }
 
+    // Frames may be textures compressed in any of the formats the GPU takes.
+    GLint compressedTextureFormatCount = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &compressedTextureFormatCount);
+    mCompressedTextureFormats.resize(compressedTextureFormatCount);
+    if (compressedTextureFormatCount > 0) {
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, mCompressedTextureFormats.data());
+    }
+
     // Blend required to draw time on top of animation frames.
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_DITHER);
@@ -1431,6 +1634,7 @@ bool BootAnimation::movie() {
     }
 
     playAnimation(*mAnimation);
+    reportFrameStats();
 
     if (mTimeCheckThread != nullptr) {
         mTimeCheckThread->requestExit();
@@ -1571,6 +1775,12 @@ bool BootAnimation::playAnimation(const Animation& animation) {
             bool displayProgress = animation.progressEnabled &&
                 (i == (pcount -1)) && currentProgress != 0;
 
+            // Only the first play of a part decodes its frames, later ones reuse their textures.
+            std::unique_ptr<FrameDecoder> decoder;
+            if (r == 0) {
+                decoder = std::make_unique<FrameDecoder>(part);
+            }
+
             for (size_t j=0 ; j<fcount ; j++) {
                 if (shouldStopPlayingPart(part, fadedFramesCount, lastDisplayedProgress)) break;
 
@@ -1601,10 +1811,24 @@ bool BootAnimation::playAnimation(const Animation& animation) {
                 } else {
                     glGenTextures(1, &frame.tid);
                     glBindTexture(GL_TEXTURE_2D, frame.tid);
-                    int w, h;
-                    // Set decoding option to alpha unpremultiplied so that the R, G, B channels
-                    // of transparent pixels are preserved.
-                    initTexture(frame.map, &w, &h, false /* don't premultiply alpha */);
+                    FrameDecoder::DecodedFrame decoded;
+                    {
+                        ATRACE_NAME("waitForFrame");
+                        const nsecs_t waitStart = systemTime();
+                        decoded = decoder->take(j);
+                        mFrameStats.decodeWaitTime += systemTime() - waitStart;
+                    }
+                    const nsecs_t uploadStart = systemTime();
+                    mFrameStats.decodeTime += decoded.decodeTime;
+                    ATRACE_NAME("uploadFrame");
+                    if (decoded.compressedTexture != nullptr) {
+                        int w, h;
+                        initCompressedTexture(decoded.compressedTexture, &w, &h);
+                    } else if (decoded.pixels) {
+                        initTexture(decoded.pixels.get(), decoded.info.format, decoded.info.width,
+                                decoded.info.height);
+                    }
+                    mFrameStats.uploadTime += systemTime() - uploadStart;
                 }
 
                 const int trimWidth = frame.trimWidth * ratio_w;
@@ -1659,11 +1883,26 @@ bool BootAnimation::playAnimation(const Animation& animation) {
 
                 handleViewport(frameDuration);
 
-                eglSwapBuffers(mDisplay, mSurface);
+                const nsecs_t swapStart = systemTime();
+                {
+                    ATRACE_NAME("swapBuffers");
+                    eglSwapBuffers(mDisplay, mSurface);
+                }
 
                 nsecs_t now = systemTime();
+                mFrameStats.swapTime += now - swapStart;
                 nsecs_t delay = frameDuration - (now - lastFrame);
                 //SLOGD("%lld, %lld", ns2ms(now - lastFrame), ns2ms(delay));
+                // The progress display sleeps on purpose, so its frames don't count as late.
+                mFrameStats.frames++;
+                if (delay < 0 && !displayProgress) {
+                    // The frames that should have been shown while this one was prepared.
+                    const nsecs_t frameTime = now - lastFrame;
+                    mFrameStats.lateFrames++;
+                    mFrameStats.droppedFrames += (frameTime - 1) / frameDuration;
+                    mFrameStats.maxFrameTime = std::max(mFrameStats.maxFrameTime, frameTime);
+                    ATRACE_INT("BootAnimationDroppedFrames", mFrameStats.droppedFrames);
+                }
                 lastFrame = now;
 
                 if (delay > 0) {
@@ -1778,6 +2017,22 @@ void BootAnimation::releaseAnimation(Animation* animation) const {
     delete animation;
 }
 
+void BootAnimation::reportFrameStats() {
+    const FrameStats& stats = mFrameStats;
+    if (stats.frames == 0) {
+        return;
+    }
+    // Decode time is spent on the decoder threads, the other times on the animation thread.
+    const std::string summary = android::base::StringPrintf(
+            "frames=%zu late=%zu dropped=%zu max_frame_ms=%" PRId64 " decode_ms=%" PRId64
+            " decode_wait_ms=%" PRId64 " upload_ms=%" PRId64 " swap_ms=%" PRId64,
+            stats.frames, stats.lateFrames, stats.droppedFrames, ns2ms(stats.maxFrameTime),
+            ns2ms(stats.decodeTime), ns2ms(stats.decodeWaitTime), ns2ms(stats.uploadTime),
+            ns2ms(stats.swapTime));
+    SLOGI("%sAnimation frame stats: %s", mShuttingDown ? "Shutdown" : "Boot", summary.c_str());
+    android::base::SetProperty(FRAME_STATS_PROP_NAME, summary);
+}
+
 BootAnimation::Animation* BootAnimation::loadAnimation(const String8& fn) {
     if (mLoadedFiles.indexOf(fn) >= 0) {
         SLOGE("File \"%s\" is already loaded. Cyclic ref is not allowed",
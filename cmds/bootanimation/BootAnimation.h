@@ -175,10 +175,14 @@ private:
     int displayEventCallback(int fd, int events, void* data);
     void processDisplayEvents();
 
+    class FrameDecoder;
+
     status_t initTexture(Texture* texture, AssetManager& asset, const char* name,
         bool premultiplyAlpha = true);
     status_t initTexture(FileMap* map, int* width, int* height,
         bool premultiplyAlpha = true);
+    status_t initTexture(const void* pixels, int32_t format, int width, int height);
+    status_t initCompressedTexture(FileMap* map, int* width, int* height);
     status_t initFont(Font* font, const char* fallback);
     void initShaders();
     bool android();
@@ -210,6 +214,7 @@ private:
     void checkExit();
 
     void handleViewport(nsecs_t timestep);
+    void reportFrameStats();
     void initDynamicColors();
 
     sp<SurfaceComposerClient>       mSession;
@@ -224,6 +229,7 @@ private:
     int         mCurrentInset;
     int         mTargetInset;
     bool        mUseNpotTextures = false;
+    std::vector<GLint> mCompressedTextureFormats;
     EGLDisplay  mDisplay;
     EGLDisplay  mContext;
     EGLDisplay  mSurface;
@@ -240,6 +246,19 @@ private:
     sp<TimeCheckThread> mTimeCheckThread = nullptr;
     sp<Callbacks> mCallbacks;
     Animation* mAnimation = nullptr;
+
+    // Where the time of the frames played went, reported when the animation ends.
+    struct FrameStats {
+        size_t frames = 0;
+        size_t lateFrames = 0;      // Frames that took longer than the frame duration,
+        size_t droppedFrames = 0;   // and by how many frame durations altogether.
+        nsecs_t maxFrameTime = 0;
+        nsecs_t decodeTime = 0;     // Decoding the frames, on the FrameDecoder threads.
+        nsecs_t decodeWaitTime = 0; // Waiting for frames to be decoded.
+        nsecs_t uploadTime = 0;
+        nsecs_t swapTime = 0;
+    };
+    FrameStats mFrameStats;
     GLuint mImageShader;
     GLuint mTextShader;
     GLuint mImageFadeLocation;
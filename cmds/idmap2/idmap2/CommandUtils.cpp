@@ -16,7 +16,6 @@
 
 #include "idmap2/CommandUtils.h"
 
-#include <fstream>
 #include <memory>
 #include <string>
 #include <vector>
@@ -27,6 +26,7 @@
 
 using android::idmap2::Error;
 using android::idmap2::IdmapHeader;
+using android::idmap2::MappedIdmap;
 using android::idmap2::OverlayResourceContainer;
 using android::idmap2::Result;
 using android::idmap2::TargetResourceContainer;
@@ -36,12 +36,11 @@ Result<Unit> Verify(const std::string& idmap_path, const std::string& target_pat
                     const std::string& overlay_path, const std::string& overlay_name,
                     PolicyBitmask fulfilled_policies, bool enforce_overlayable) {
   SYSTRACE << "Verify " << idmap_path;
-  std::ifstream fin(idmap_path);
-  const std::unique_ptr<const IdmapHeader> header = IdmapHeader::FromBinaryStream(fin);
-  fin.close();
-  if (!header) {
-    return Error("failed to parse idmap header");
+  const auto idmap = MappedIdmap::FromPath(idmap_path);
+  if (!idmap) {
+    return Error(idmap.GetError(), "failed to parse idmap");
   }
+  const IdmapHeader& header = (*idmap)->GetHeader();
 
   auto target = TargetResourceContainer::FromPath(target_path);
   if (!target) {
@@ -53,8 +52,8 @@ Result<Unit> Verify(const std::string& idmap_path, const std::string& target_pat
     return Error("failed to load overlay '%s'", overlay_path.c_str());
   }
 
-  const auto header_ok = header->IsUpToDate(**target, **overlay, overlay_name, fulfilled_policies,
-                                            enforce_overlayable);
+  const auto header_ok = header.IsUpToDate(**target, **overlay, overlay_name, fulfilled_policies,
+                                           enforce_overlayable);
   if (!header_ok) {
     return Error(header_ok.GetError(), "idmap not up to date");
   }
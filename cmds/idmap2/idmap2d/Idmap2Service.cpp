@@ -19,14 +19,19 @@
 #include <sys/stat.h>   // umask
 #include <sys/types.h>  // umask
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <limits>
+#include <map>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -44,12 +49,16 @@
 using android::base::StringPrintf;
 using android::binder::Status;
 using android::idmap2::BinaryStreamVisitor;
+using android::idmap2::Error;
 using android::idmap2::FabricatedOverlayContainer;
 using android::idmap2::Idmap;
 using android::idmap2::IdmapHeader;
+using android::idmap2::MappedIdmap;
 using android::idmap2::OverlayResourceContainer;
 using android::idmap2::PrettyPrintVisitor;
+using android::idmap2::Result;
 using android::idmap2::TargetResourceContainer;
+using android::idmap2::Unit;
 using android::idmap2::utils::kIdmapCacheDir;
 using android::idmap2::utils::kIdmapFilePermissionMask;
 using android::idmap2::utils::RandomStringForPath;
@@ -59,7 +68,11 @@ using PolicyBitmask = android::ResTable_overlayable_policy_header::PolicyBitmask
 
 namespace {
 
-constexpr const char* kFrameworkPath = "/system/framework/framework-res.apk";
+// The most targets kept loaded between requests.
+constexpr size_t kTargetCacheSize = 4;
+
+// The most threads a batch request runs on, the binder thread included.
+constexpr size_t kMaxBatchThreads = 4;
 
 Status ok() {
   return Status::ok();
@@ -74,6 +87,44 @@ PolicyBitmask ConvertAidlArgToPolicyBitmask(int32_t arg) {
   return static_cast<PolicyBitmask>(arg);
 }
 
+Result<Unit> WriteIdmap(const std::string& idmap_path, const Idmap& idmap) {
+  umask(kIdmapFilePermissionMask);
+  std::ofstream fout(idmap_path);
+  if (fout.fail()) {
+    return Error("failed to open idmap path %s", idmap_path.c_str());
+  }
+
+  BinaryStreamVisitor visitor(fout);
+  idmap.accept(&visitor);
+  fout.close();
+  if (fout.fail()) {
+    unlink(idmap_path.c_str());
+    return Error("failed to write to idmap path %s", idmap_path.c_str());
+  }
+  return Unit{};
+}
+
+// Calls process(i) for each i in [0, count) on a pool of threads, and returns once all the calls
+// are done. The calling thread is one of the pool.
+void RunOnThreadPool(size_t count, const std::function<void(size_t)>& process) {
+  const size_t thread_count = std::min<size_t>(
+      {count, kMaxBatchThreads, std::max(1U, std::thread::hardware_concurrency())});
+  std::atomic<size_t> next = 0;
+  const auto work = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      process(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 }  // namespace
 
 namespace android::os {
@@ -113,14 +164,13 @@ Status Idmap2Service::verifyIdmap(const std::string& target_path, const std::str
   assert(_aidl_return);
 
   const std::string idmap_path = Idmap::CanonicalIdmapPathFor(kIdmapCacheDir, overlay_path);
-  std::ifstream fin(idmap_path);
-  const std::unique_ptr<const IdmapHeader> header = IdmapHeader::FromBinaryStream(fin);
-  fin.close();
-  if (!header) {
+  const auto idmap = MappedIdmap::FromPath(idmap_path);
+  if (!idmap) {
     *_aidl_return = false;
-    LOG(WARNING) << "failed to parse idmap header of '" << idmap_path << "'";
+    LOG(WARNING) << "failed to parse idmap '" << idmap_path << "': " << idmap.GetErrorMessage();
     return ok();
   }
+  const IdmapHeader& header = (*idmap)->GetHeader();
 
   const auto target = GetTargetContainer(target_path);
   if (!target) {
@@ -136,9 +186,11 @@ Status Idmap2Service::verifyIdmap(const std::string& target_path, const std::str
     return ok();
   }
 
+  std::unique_lock target_lock((*target)->lock);
   auto up_to_date =
-      header->IsUpToDate(*GetPointer(*target), **overlay, overlay_name,
-                         ConvertAidlArgToPolicyBitmask(fulfilled_policies), enforce_overlayable);
+      header.IsUpToDate(*(*target)->container, **overlay, overlay_name,
+                        ConvertAidlArgToPolicyBitmask(fulfilled_policies), enforce_overlayable);
+  target_lock.unlock();
 
   *_aidl_return = static_cast<bool>(up_to_date);
   if (!up_to_date) {
@@ -181,49 +233,223 @@ Status Idmap2Service::createIdmap(const std::string& target_path, const std::str
     return error("failed to load apk overlay '%s'" + overlay_path);
   }
 
-  const auto idmap = Idmap::FromContainers(*GetPointer(*target), **overlay, overlay_name,
+  std::unique_lock target_lock((*target)->lock);
+  const auto idmap = Idmap::FromContainers(*(*target)->container, **overlay, overlay_name,
                                            policy_bitmask, enforce_overlayable);
+  target_lock.unlock();
   if (!idmap) {
     return error(idmap.GetErrorMessage());
   }
 
-  umask(kIdmapFilePermissionMask);
-  std::ofstream fout(idmap_path);
-  if (fout.fail()) {
-    return error("failed to open idmap path " + idmap_path);
+  if (auto result = WriteIdmap(idmap_path, **idmap); !result) {
+    return error(result.GetErrorMessage());
   }
 
-  BinaryStreamVisitor visitor(fout);
-  (*idmap)->accept(&visitor);
-  fout.close();
-  if (fout.fail()) {
-    unlink(idmap_path.c_str());
-    return error("failed to write to idmap path " + idmap_path);
+  *_aidl_return = idmap_path;
+  return ok();
+}
+
+// The targets of a batch request. Each is loaded by the first overlay that needs it and then kept
+// for the rest of the batch, even if it leaves target_cache_. The overlays of one target take turns
+// using it, while the overlays of different targets run in parallel.
+class Idmap2Service::BatchTargets {
+ public:
+  explicit BatchTargets(Idmap2Service* service) : service_(service) {
   }
 
-  *_aidl_return = idmap_path;
+  // Returns f(target) for the target at target_path, or an error if it fails to load.
+  template <typename F>
+  auto WithTarget(const std::string& target_path, F&& f)
+      -> decltype(f(std::declval<const TargetResourceContainer&>())) {
+    Entry* entry;
+    {
+      std::lock_guard lock(mutex_);
+      entry = &entries_[target_path];
+    }
+    TargetPtr target;
+    {
+      std::lock_guard lock(entry->mutex);
+      if (!entry->target) {
+        entry->target = service_->GetTargetContainer(target_path);
+      }
+      if (!*entry->target) {
+        return Error(entry->target->GetError(), "failed to load target '%s'", target_path.c_str());
+      }
+      target = **entry->target;
+    }
+    std::lock_guard lock(target->lock);
+    return f(*target->container);
+  }
+
+ private:
+  struct Entry {
+    std::mutex mutex;
+    std::optional<Result<TargetPtr>> target;
+  };
+
+  Idmap2Service* service_;
+  std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+};
+
+Status Idmap2Service::CheckBatchSizes(const std::vector<std::string>& target_paths,
+                                      const std::vector<std::string>& overlay_paths,
+                                      const std::vector<std::string>& overlay_names,
+                                      const std::vector<int32_t>& fulfilled_policies,
+                                      const std::vector<bool>& enforce_overlayable) {
+  const size_t count = target_paths.size();
+  if (overlay_paths.size() != count || overlay_names.size() != count ||
+      fulfilled_policies.size() != count || enforce_overlayable.size() != count) {
+    return error("batch arguments differ in size");
+  }
   return ok();
 }
 
-idmap2::Result<Idmap2Service::TargetResourceContainerPtr> Idmap2Service::GetTargetContainer(
+Status Idmap2Service::verifyIdmaps(const std::vector<std::string>& target_paths,
+                                   const std::vector<std::string>& overlay_paths,
+                                   const std::vector<std::string>& overlay_names,
+                                   const std::vector<int32_t>& fulfilled_policies,
+                                   const std::vector<bool>& enforce_overlayable,
+                                   int32_t user_id ATTRIBUTE_UNUSED,
+                                   std::vector<bool>* _aidl_return) {
+  assert(_aidl_return);
+  SYSTRACE << "Idmap2Service::verifyIdmaps " << overlay_paths.size();
+  _aidl_return->clear();
+  if (auto status = CheckBatchSizes(target_paths, overlay_paths, overlay_names,
+                                    fulfilled_policies, enforce_overlayable);
+      !status.isOk()) {
+    return status;
+  }
+
+  // Not a vector<bool>, whose elements can't be written from several threads.
+  std::vector<char> up_to_date(overlay_paths.size(), false);
+  BatchTargets targets(this);
+  RunOnThreadPool(overlay_paths.size(), [&](size_t i) {
+    const std::string idmap_path = Idmap::CanonicalIdmapPathFor(kIdmapCacheDir, overlay_paths[i]);
+    const auto idmap = MappedIdmap::FromPath(idmap_path);
+    if (!idmap) {
+      LOG(WARNING) << "failed to parse idmap '" << idmap_path << "': " << idmap.GetErrorMessage();
+      return;
+    }
+
+    const auto overlay = OverlayResourceContainer::FromPath(overlay_paths[i]);
+    if (!overlay) {
+      LOG(WARNING) << "failed to load overlay '" << overlay_paths[i] << "'";
+      return;
+    }
+
+    const auto result =
+        targets.WithTarget(target_paths[i], [&](const TargetResourceContainer& target) {
+          return (*idmap)->GetHeader().IsUpToDate(
+              target, **overlay, overlay_names[i],
+              ConvertAidlArgToPolicyBitmask(fulfilled_policies[i]), enforce_overlayable[i]);
+        });
+    if (!result) {
+      LOG(WARNING) << "idmap '" << idmap_path << "' not up to date : " << result.GetErrorMessage();
+      return;
+    }
+    up_to_date[i] = true;
+  });
+
+  _aidl_return->assign(up_to_date.begin(), up_to_date.end());
+  return ok();
+}
+
+Status Idmap2Service::createIdmaps(const std::vector<std::string>& target_paths,
+                                   const std::vector<std::string>& overlay_paths,
+                                   const std::vector<std::string>& overlay_names,
+                                   const std::vector<int32_t>& fulfilled_policies,
+                                   const std::vector<bool>& enforce_overlayable,
+                                   int32_t user_id ATTRIBUTE_UNUSED,
+                                   std::vector<std::optional<std::string>>* _aidl_return) {
+  assert(_aidl_return);
+  SYSTRACE << "Idmap2Service::createIdmaps " << overlay_paths.size();
+  _aidl_return->clear();
+  if (auto status = CheckBatchSizes(target_paths, overlay_paths, overlay_names,
+                                    fulfilled_policies, enforce_overlayable);
+      !status.isOk()) {
+    return status;
+  }
+
+  // The pool threads have no calling identity, read it on the binder thread.
+  const uid_t uid = IPCThreadState::self()->getCallingUid();
+  _aidl_return->resize(overlay_paths.size());
+  BatchTargets targets(this);
+  RunOnThreadPool(overlay_paths.size(), [&](size_t i) {
+    const std::string idmap_path = Idmap::CanonicalIdmapPathFor(kIdmapCacheDir, overlay_paths[i]);
+    if (!UidHasWriteAccessToPath(uid, idmap_path)) {
+      LOG(ERROR) << "will not write to " << idmap_path << ": calling uid " << uid
+                 << " lacks write access";
+      return;
+    }
+
+    // See createIdmap for why the old idmap is deleted first.
+    unlink(idmap_path.c_str());
+
+    const auto overlay = OverlayResourceContainer::FromPath(overlay_paths[i]);
+    if (!overlay) {
+      LOG(ERROR) << "failed to load apk overlay '" << overlay_paths[i] << "'";
+      return;
+    }
+
+    const auto idmap =
+        targets.WithTarget(target_paths[i], [&](const TargetResourceContainer& target) {
+          return Idmap::FromContainers(target, **overlay, overlay_names[i],
+                                       ConvertAidlArgToPolicyBitmask(fulfilled_policies[i]),
+                                       enforce_overlayable[i]);
+        });
+    if (!idmap) {
+      LOG(ERROR) << idmap.GetErrorMessage();
+      return;
+    }
+
+    if (auto result = WriteIdmap(idmap_path, **idmap); !result) {
+      LOG(ERROR) << result.GetErrorMessage();
+      return;
+    }
+    (*_aidl_return)[i] = idmap_path;
+  });
+  return ok();
+}
+
+Result<Idmap2Service::TargetPtr> Idmap2Service::GetTargetContainer(
     const std::string& target_path) {
-  if (target_path == kFrameworkPath) {
-    if (framework_apk_cache_ == nullptr) {
-      // Initialize the framework APK cache.
-      auto target = TargetResourceContainer::FromPath(target_path);
-      if (!target) {
-        return target.GetError();
+  struct stat st;
+  if (stat(target_path.c_str(), &st) != 0) {
+    return Error("failed to stat '%s': %s", target_path.c_str(), strerror(errno));
+  }
+  const auto is_same_file = [&st](const CachedTarget& cached) {
+    return cached.device == st.st_dev && cached.inode == st.st_ino &&
+           cached.mtime.tv_sec == st.st_mtim.tv_sec && cached.mtime.tv_nsec == st.st_mtim.tv_nsec;
+  };
+  {
+    std::lock_guard lock(target_cache_mutex_);
+    auto it = std::find_if(target_cache_.begin(), target_cache_.end(),
+                           [&](const CachedTarget& cached) { return cached.path == target_path; });
+    if (it != target_cache_.end()) {
+      if (is_same_file(*it)) {
+        target_cache_.splice(target_cache_.begin(), target_cache_, it);
+        return {it->target};
       }
-      framework_apk_cache_ = std::move(*target);
+      target_cache_.erase(it);
     }
-    return {framework_apk_cache_.get()};
   }
 
-  auto target = TargetResourceContainer::FromPath(target_path);
-  if (!target) {
-    return target.GetError();
+  // Load without holding the cache lock, so that requests on other targets are not held up.
+  auto container = TargetResourceContainer::FromPath(target_path);
+  if (!container) {
+    return container.GetError();
+  }
+  auto target = std::make_shared<Target>();
+  target->container = std::move(*container);
+
+  std::lock_guard lock(target_cache_mutex_);
+  target_cache_.remove_if([&](const CachedTarget& cached) { return cached.path == target_path; });
+  target_cache_.push_front({target_path, st.st_dev, st.st_ino, st.st_mtim, target});
+  if (target_cache_.size() > kTargetCacheSize) {
+    target_cache_.pop_back();
   }
-  return {std::move(*target)};
+  return {std::move(target)};
 }
 
 Status Idmap2Service::createFabricatedOverlay(
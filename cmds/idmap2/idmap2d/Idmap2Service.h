@@ -23,13 +23,15 @@
 #include <binder/BinderService.h>
 #include <idmap2/ResourceContainer.h>
 #include <idmap2/Result.h>
+#include <sys/types.h>
 
+#include <ctime>
 #include <filesystem>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
-#include <variant>
 #include <vector>
 
 namespace android::os {
@@ -56,6 +58,24 @@ class Idmap2Service : public BinderService<Idmap2Service>, public BnIdmap2 {
                              bool enforce_overlayable, int32_t user_id,
                              std::optional<std::string>* _aidl_return) override;
 
+  // The batch forms of verifyIdmap and createIdmap, for OverlayManagerService to update all the
+  // overlays in one transaction at boot and on user switches. The arguments of the i-th overlay
+  // are the i-th elements of the arrays. Each target is loaded once for the whole batch, and the
+  // overlays are processed on a pool of threads.
+  binder::Status verifyIdmaps(const std::vector<std::string>& target_paths,
+                              const std::vector<std::string>& overlay_paths,
+                              const std::vector<std::string>& overlay_names,
+                              const std::vector<int32_t>& fulfilled_policies,
+                              const std::vector<bool>& enforce_overlayable, int32_t user_id,
+                              std::vector<bool>* _aidl_return) override;
+
+  binder::Status createIdmaps(const std::vector<std::string>& target_paths,
+                              const std::vector<std::string>& overlay_paths,
+                              const std::vector<std::string>& overlay_names,
+                              const std::vector<int32_t>& fulfilled_policies,
+                              const std::vector<bool>& enforce_overlayable, int32_t user_id,
+                              std::vector<std::optional<std::string>>* _aidl_return) override;
+
   binder::Status createFabricatedOverlay(
       const os::FabricatedOverlayInternal& overlay,
       std::optional<os::FabricatedOverlayInfo>* _aidl_return) override;
@@ -73,33 +93,49 @@ class Idmap2Service : public BinderService<Idmap2Service>, public BnIdmap2 {
   binder::Status dumpIdmap(const std::string& overlay_path, std::string* _aidl_return) override;
 
  private:
+  // A loaded target. Containers are not thread-safe, so hold the lock while using the container.
+  struct Target {
+    std::mutex lock;
+    std::unique_ptr<idmap2::TargetResourceContainer> container;
+  };
+  using TargetPtr = std::shared_ptr<Target>;
+
+  // A target in target_cache_, with the identity of the file it was loaded from.
+  struct CachedTarget {
+    std::string path;
+    dev_t device;
+    ino_t inode;
+    timespec mtime;
+    TargetPtr target;
+  };
+
   // idmap2d is killed after a period of inactivity, so any information stored on this class should
   // be able to be recalculated if idmap2 dies and restarts.
-  std::unique_ptr<idmap2::TargetResourceContainer> framework_apk_cache_;
+  //
+  // The most recently used targets, most recent first. framework-res and SystemUI are the targets
+  // of most overlays, so this saves loading them again for each of their overlays. An entry is
+  // dropped once the file at its path has another inode or modification time, as after an update
+  // of the package.
+  std::list<CachedTarget> target_cache_;
+  std::mutex target_cache_mutex_;
 
   int32_t frro_iter_id_ = 0;
   std::optional<std::filesystem::directory_iterator> frro_iter_;
   std::mutex frro_iter_mutex_;
 
-  template <typename T>
-  using MaybeUniquePtr = std::variant<std::unique_ptr<T>, T*>;
+  idmap2::Result<TargetPtr> GetTargetContainer(const std::string& target_path);
 
-  using TargetResourceContainerPtr = MaybeUniquePtr<idmap2::TargetResourceContainer>;
-  idmap2::Result<TargetResourceContainerPtr> GetTargetContainer(const std::string& target_path);
+  // The targets of a batch request, see BatchTargets in Idmap2Service.cpp.
+  class BatchTargets;
 
-  template <typename T>
-  WARN_UNUSED static const T* GetPointer(const MaybeUniquePtr<T>& ptr);
+  // Checks that the arguments of a batch request have the same number of elements.
+  static binder::Status CheckBatchSizes(const std::vector<std::string>& target_paths,
+                                        const std::vector<std::string>& overlay_paths,
+                                        const std::vector<std::string>& overlay_names,
+                                        const std::vector<int32_t>& fulfilled_policies,
+                                        const std::vector<bool>& enforce_overlayable);
 };
 
-template <typename T>
-const T* Idmap2Service::GetPointer(const MaybeUniquePtr<T>& ptr) {
-  auto u = std::get_if<T*>(&ptr);
-  if (u != nullptr) {
-    return *u;
-  }
-  return std::get<std::unique_ptr<T>>(ptr).get();
-}
-
 }  // namespace android::os
 
 #endif  // IDMAP2_IDMAP2D_IDMAP2SERVICE_H_
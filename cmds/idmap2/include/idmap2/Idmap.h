@@ -73,10 +73,13 @@
 
 #include <iostream>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "android-base/macros.h"
+#include "android-base/mapped_file.h"
 #include "androidfw/ResourceTypes.h"
 #include "androidfw/StringPiece.h"
 #include "androidfw/ConfigDescription.h"
@@ -86,6 +89,7 @@
 namespace android::idmap2 {
 
 class Idmap;
+class MappedIdmap;
 class Visitor;
 
 // magic number: all idmap files start with this
@@ -167,6 +171,7 @@ class IdmapHeader {
   std::string debug_info_;
 
   friend Idmap;
+  friend MappedIdmap;
   DISALLOW_COPY_AND_ASSIGN(IdmapHeader);
 };
 class IdmapData {
@@ -212,6 +217,7 @@ class IdmapData {
 
     friend Idmap;
     friend IdmapData;
+    friend MappedIdmap;
     DISALLOW_COPY_AND_ASSIGN(Header);
   };
 
@@ -305,6 +311,59 @@ class Idmap {
   DISALLOW_COPY_AND_ASSIGN(Idmap);
 };
 
+// A read-only view of an idmap file mapped into memory, for the callers that only look at an idmap,
+// like idmap2d verifying the idmaps of every overlay at boot. The file is validated as a whole
+// once, when it is mapped. Afterwards the target and overlay entries are read straight from the
+// mapping: unlike Idmap::FromBinaryStream, only the header strings are copied.
+class MappedIdmap {
+ public:
+  static Result<std::unique_ptr<const MappedIdmap>> FromPath(const std::string& path);
+
+  // Views the idmap in data, which must be 4 byte aligned and outlive the MappedIdmap.
+  static Result<std::unique_ptr<const MappedIdmap>> FromData(const void* data, size_t size);
+
+  const IdmapHeader& GetHeader() const {
+    return *header_;
+  }
+
+  const IdmapData::Header& GetDataHeader() const {
+    return *data_header_;
+  }
+
+  std::span<const IdmapData::TargetEntry> GetTargetEntries() const {
+    return target_entries_;
+  }
+
+  std::span<const IdmapData::OverlayEntry> GetOverlayEntries() const {
+    return overlay_entries_;
+  }
+
+  std::string_view GetStringPoolData() const {
+    return string_pool_data_;
+  }
+
+  // The inline entries are not stored as an array of TargetInlineEntry, their values and
+  // configurations are decoded from the mapping on each call.
+  std::vector<IdmapData::TargetInlineEntry> GetTargetInlineEntries() const;
+
+ private:
+  MappedIdmap() = default;
+
+  static Result<std::unique_ptr<MappedIdmap>> Parse(const uint8_t* data, size_t size);
+
+  std::unique_ptr<android::base::MappedFile> file_;
+  std::unique_ptr<const IdmapHeader> header_;
+  std::unique_ptr<const IdmapData::Header> data_header_;
+  std::span<const IdmapData::TargetEntry> target_entries_;
+  const uint8_t* target_inline_entries_ = nullptr;
+  const uint8_t* target_inline_entry_values_ = nullptr;
+  const uint8_t* configs_ = nullptr;
+  std::span<const IdmapData::OverlayEntry> overlay_entries_;
+  std::string_view string_pool_data_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedIdmap);
+};
+
 class Visitor {
  public:
   virtual ~Visitor() = default;
@@ -16,8 +16,14 @@
 
 #include "idmap2/Idmap.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <limits>
@@ -26,6 +32,7 @@
 #include <utility>
 
 #include "android-base/macros.h"
+#include "android-base/unique_fd.h"
 #include "androidfw/AssetManager2.h"
 #include "idmap2/ResourceMapping.h"
 #include "idmap2/ResourceUtils.h"
@@ -84,6 +91,72 @@ bool WARN_UNUSED ReadString(std::istream& stream, std::string* out) {
   return true;
 }
 
+// The sizes of the records of the data block, see the format in Idmap.h.
+constexpr size_t kTargetEntrySize = 2 * sizeof(uint32_t);
+constexpr size_t kTargetInlineEntrySize = 3 * sizeof(uint32_t);
+constexpr size_t kTargetInlineEntryValueSize = 3 * sizeof(uint32_t);
+constexpr size_t kOverlayEntrySize = 2 * sizeof(uint32_t);
+
+// The target and overlay entries of a mapped idmap are used in place, so their structs must have
+// the layout of the file, which is little endian.
+static_assert(std::endian::native == std::endian::little);
+static_assert(sizeof(IdmapData::TargetEntry) == kTargetEntrySize);
+static_assert(sizeof(IdmapData::OverlayEntry) == kOverlayEntrySize);
+
+// Reads the idmap format from memory, checking each read against the end of the data.
+class BufferReader {
+ public:
+  BufferReader(const uint8_t* data, size_t size) : data_(data), size_(size) {
+  }
+
+  bool WARN_UNUSED Read32(uint32_t* out) {
+    const uint8_t* data = Skip(1, sizeof(uint32_t));
+    if (data == nullptr) {
+      return false;
+    }
+    uint32_t value;
+    memcpy(&value, data, sizeof(uint32_t));
+    *out = dtohl(value);
+    return true;
+  }
+
+  bool WARN_UNUSED ReadString(std::string_view* out) {
+    uint32_t size;
+    if (!Read32(&size)) {
+      return false;
+    }
+    const uint8_t* data = Skip(1, static_cast<uint64_t>(size) + CalculatePadding(size));
+    if (data == nullptr) {
+      return false;
+    }
+    *out = std::string_view(reinterpret_cast<const char*>(data), size);
+    return true;
+  }
+
+  // Returns the next count records of the given size and moves past them, or nullptr if the
+  // data is too short for them.
+  const uint8_t* Skip(uint64_t count, uint64_t size) {
+    const uint64_t length = count * size;  // counts are 32 bit, this doesn't overflow
+    if (length > size_ - offset_) {
+      return nullptr;
+    }
+    const uint8_t* data = data_ + offset_;
+    offset_ += length;
+    return data;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+uint32_t Get32(const uint8_t* data, size_t index) {
+  uint32_t value;
+  memcpy(&value, data + index * sizeof(uint32_t), sizeof(uint32_t));
+  return dtohl(value);
+}
+
 }  // namespace
 
 std::unique_ptr<const IdmapHeader> IdmapHeader::FromBinaryStream(std::istream& stream) {
@@ -310,6 +383,144 @@ Result<std::unique_ptr<const Idmap>> Idmap::FromBinaryStream(std::istream& strea
   return {std::move(idmap)};
 }
 
+Result<std::unique_ptr<const MappedIdmap>> MappedIdmap::FromPath(const std::string& path) {
+  SYSTRACE << "MappedIdmap::FromPath " << path;
+  android::base::unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
+    return Error("failed to open %s: %s", path.c_str(), strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd.get(), &st) != 0) {
+    return Error("failed to stat %s: %s", path.c_str(), strerror(errno));
+  }
+  if (st.st_size == 0) {
+    return Error("empty idmap %s", path.c_str());
+  }
+  auto file = android::base::MappedFile::FromFd(fd, 0, st.st_size, PROT_READ);
+  if (file == nullptr) {
+    return Error("failed to map %s: %s", path.c_str(), strerror(errno));
+  }
+
+  auto idmap = Parse(reinterpret_cast<const uint8_t*>(file->data()), file->size());
+  if (!idmap) {
+    return Error(idmap.GetError(), "failed to parse %s", path.c_str());
+  }
+  (*idmap)->file_ = std::move(file);
+  return {std::move(*idmap)};
+}
+
+Result<std::unique_ptr<const MappedIdmap>> MappedIdmap::FromData(const void* data, size_t size) {
+  auto idmap = Parse(static_cast<const uint8_t*>(data), size);
+  if (!idmap) {
+    return idmap.GetError();
+  }
+  return {std::move(*idmap)};
+}
+
+Result<std::unique_ptr<MappedIdmap>> MappedIdmap::Parse(const uint8_t* data, size_t size) {
+  if (reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) != 0) {
+    return Error("idmap data is not aligned");
+  }
+  BufferReader reader(data, size);
+  std::unique_ptr<MappedIdmap> idmap(new MappedIdmap());
+
+  std::unique_ptr<IdmapHeader> header(new IdmapHeader());
+  if (!reader.Read32(&header->magic_) || !reader.Read32(&header->version_)) {
+    return Error("failed to parse idmap header");
+  }
+  if (header->magic_ != kIdmapMagic || header->version_ != kIdmapCurrentVersion) {
+    return Error("not a current version idmap: magic 0x%08x, version 0x%08x", header->magic_,
+                 header->version_);
+  }
+  uint32_t enforce_overlayable;
+  std::string_view target_path;
+  std::string_view overlay_path;
+  std::string_view overlay_name;
+  std::string_view debug_info;
+  if (!reader.Read32(&header->target_crc_) || !reader.Read32(&header->overlay_crc_) ||
+      !reader.Read32(&header->fulfilled_policies_) || !reader.Read32(&enforce_overlayable) ||
+      !reader.ReadString(&target_path) || !reader.ReadString(&overlay_path) ||
+      !reader.ReadString(&overlay_name) || !reader.ReadString(&debug_info)) {
+    return Error("failed to parse idmap header");
+  }
+  header->enforce_overlayable_ = enforce_overlayable != 0U;
+  header->target_path_ = target_path;
+  header->overlay_path_ = overlay_path;
+  header->overlay_name_ = overlay_name;
+  header->debug_info_ = debug_info;
+  idmap->header_ = std::move(header);
+
+  // Like Idmap::FromBinaryStream, expect exactly one data block.
+  std::unique_ptr<IdmapData::Header> data_header(new IdmapData::Header());
+  if (!reader.Read32(&data_header->target_entry_count) ||
+      !reader.Read32(&data_header->target_entry_inline_count) ||
+      !reader.Read32(&data_header->target_entry_inline_value_count) ||
+      !reader.Read32(&data_header->config_count) ||
+      !reader.Read32(&data_header->overlay_entry_count) ||
+      !reader.Read32(&data_header->string_pool_index_offset)) {
+    return Error("failed to parse data block header");
+  }
+
+  const uint8_t* target_entries = reader.Skip(data_header->target_entry_count, kTargetEntrySize);
+  idmap->target_inline_entries_ =
+      reader.Skip(data_header->target_entry_inline_count, kTargetInlineEntrySize);
+  idmap->target_inline_entry_values_ =
+      reader.Skip(data_header->target_entry_inline_value_count, kTargetInlineEntryValueSize);
+  idmap->configs_ = reader.Skip(data_header->config_count, sizeof(ConfigDescription));
+  const uint8_t* overlay_entries =
+      reader.Skip(data_header->overlay_entry_count, kOverlayEntrySize);
+  if (target_entries == nullptr || idmap->target_inline_entries_ == nullptr ||
+      idmap->target_inline_entry_values_ == nullptr || idmap->configs_ == nullptr ||
+      overlay_entries == nullptr || !reader.ReadString(&idmap->string_pool_data_)) {
+    return Error("idmap data block is truncated");
+  }
+
+  // Check the indices of the inline entries once, so that decoding them needs no checks.
+  for (size_t i = 0; i < data_header->target_entry_inline_count; i++) {
+    const uint64_t start = Get32(idmap->target_inline_entries_, i * 3 + 1);
+    const uint64_t count = Get32(idmap->target_inline_entries_, i * 3 + 2);
+    if (start + count > data_header->target_entry_inline_value_count) {
+      return Error("inline entry %zu has values out of range", i);
+    }
+  }
+  for (size_t i = 0; i < data_header->target_entry_inline_value_count; i++) {
+    if (Get32(idmap->target_inline_entry_values_, i * 3) >= data_header->config_count) {
+      return Error("inline value %zu has a config out of range", i);
+    }
+  }
+
+  idmap->target_entries_ = {reinterpret_cast<const IdmapData::TargetEntry*>(target_entries),
+                            data_header->target_entry_count};
+  idmap->overlay_entries_ = {reinterpret_cast<const IdmapData::OverlayEntry*>(overlay_entries),
+                             data_header->overlay_entry_count};
+  idmap->data_header_ = std::move(data_header);
+  return {std::move(idmap)};
+}
+
+std::vector<IdmapData::TargetInlineEntry> MappedIdmap::GetTargetInlineEntries() const {
+  std::vector<IdmapData::TargetInlineEntry> entries;
+  entries.reserve(data_header_->GetTargetInlineEntryCount());
+  for (size_t i = 0; i < data_header_->GetTargetInlineEntryCount(); i++) {
+    IdmapData::TargetInlineEntry entry{};
+    entry.target_id = Get32(target_inline_entries_, i * 3);
+    const uint32_t start = Get32(target_inline_entries_, i * 3 + 1);
+    const uint32_t count = Get32(target_inline_entries_, i * 3 + 2);
+    for (uint32_t j = start; j < start + count; j++) {
+      const uint8_t* value = target_inline_entry_values_ + j * kTargetInlineEntryValueSize;
+      ConfigDescription config;
+      memcpy(&config, configs_ + Get32(value, 0) * sizeof(ConfigDescription),
+             sizeof(ConfigDescription));
+      // Skip Res_value::size and the padding, see Res_value in ResourceTypes.h.
+      TargetValue target_value;
+      target_value.data_type = value[sizeof(uint32_t) + 3];
+      target_value.data_value = Get32(value, 2);
+      entry.values[config] = target_value;
+    }
+    entries.emplace_back(std::move(entry));
+  }
+  return entries;
+}
+
 Result<std::unique_ptr<const IdmapData>> IdmapData::FromResourceMapping(
     const ResourceMapping& resource_mapping) {
   if (resource_mapping.GetTargetToOverlayMap().empty()) {
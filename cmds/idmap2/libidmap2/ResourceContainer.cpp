@@ -17,12 +17,15 @@
 #include "idmap2/ResourceContainer.h"
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "androidfw/ApkAssets.h"
 #include "androidfw/AssetManager.h"
+#include "androidfw/ResourceUtils.h"
 #include "androidfw/Util.h"
 #include "idmap2/FabricatedOverlay.h"
 #include "idmap2/XmlParser.h"
@@ -39,6 +42,10 @@ constexpr ResourceId kAttrResourcesMap = 0x01010609;
 constexpr ResourceId kAttrTargetName = 0x0101044d;
 constexpr ResourceId kAttrTargetPackage = 0x01010021;
 
+// The number of names looked up in a target after which its names are indexed, see
+// ApkResourceContainer::GetResourceId.
+constexpr size_t kResourceIdIndexThreshold = 128;
+
 // idmap version 0x01 naively assumes that the package to use is always the first ResTable_package
 // in the resources.arsc blob. In most cases, there is only a single ResTable_package anyway, so
 // this assumption tends to work out. That said, the correct thing to do is to scan
@@ -268,6 +275,10 @@ struct ResState {
   std::unique_ptr<AssetManager2> am;
   ZipAssetsProvider* zip_assets;
 
+  // The compile-time ids of the resources of the package by "type/entry" name, once built.
+  mutable std::optional<std::unordered_map<std::string, ResourceId>> resource_ids;
+  mutable size_t resource_id_lookups = 0;
+
   static Result<ResState> Initialize(std::unique_ptr<ZipAssetsProvider> zip) {
     ResState state;
     state.zip_assets = zip.get();
@@ -292,6 +303,21 @@ struct ResState {
   }
 };
 
+std::unordered_map<std::string, ResourceId> BuildResourceIdIndex(const AssetManager2& am,
+                                                                 const LoadedPackage& package) {
+  std::unordered_map<std::string, ResourceId> resource_ids;
+  package.ForEachTypeSpec([&](const TypeSpec& type_spec, uint8_t type_id) {
+    const uint32_t entry_count = dtohl(type_spec.type_spec->entryCount);
+    for (uint32_t entry = 0; entry < entry_count; entry++) {
+      const ResourceId id = make_resid(package.GetPackageId(), type_id, entry);
+      if (auto name = utils::ResToTypeEntryName(am, id)) {
+        resource_ids.emplace(std::move(*name), id);
+      }
+    }
+  });
+  return resource_ids;
+}
+
 }  // namespace
 
 struct ApkResourceContainer : public TargetResourceContainer, public OverlayResourceContainer {
@@ -407,6 +433,21 @@ Result<ResourceId> ApkResourceContainer::GetResourceId(const std::string& name)
   if (!state) {
     return state.GetError();
   }
+
+  // Overlays of thousands of resources, and the many overlays of a target that idmap2d keeps
+  // loaded, resolve names faster through an index of the whole package. It costs a name lookup
+  // per resource of the target, so it is only built once enough names were looked up.
+  if (!(*state)->resource_ids &&
+      ++(*state)->resource_id_lookups > kResourceIdIndexThreshold) {
+    (*state)->resource_ids = BuildResourceIdIndex(*(*state)->am, *(*state)->package);
+  }
+  if ((*state)->resource_ids) {
+    if (auto it = (*state)->resource_ids->find(name); it != (*state)->resource_ids->end()) {
+      return it->second;
+    }
+    // Names with a package or such as attr/ for ^attr-private/ are left to the AssetManager2.
+  }
+
   auto id = (*state)->am->GetResourceId(name, "", (*state)->package->GetPackageName());
   if (!id.has_value()) {
     return Error("failed to find resource '%s'", name.c_str());
@@ -17,6 +17,7 @@
 #include <android-base/file.h>
 
 #include <cstdio>  // fclose
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <sstream>
@@ -185,6 +186,66 @@ TEST(IdmapTests, GracefullyFailToCreateIdmapFromCorruptBinaryStream) {
   ASSERT_FALSE(result);
 }
 
+TEST(IdmapTests, CreateMappedIdmapFromData) {
+  // MappedIdmap reads the entries in place, so the data needs to be aligned like a mapped file.
+  std::vector<uint32_t> buffer((kIdmapRawDataLen + 3) / 4);
+  memcpy(buffer.data(), kIdmapRawData, kIdmapRawDataLen);
+
+  auto result = MappedIdmap::FromData(buffer.data(), kIdmapRawDataLen);
+  ASSERT_TRUE(result) << result.GetErrorMessage();
+  const auto idmap = std::move(*result);
+
+  ASSERT_EQ(idmap->GetHeader().GetMagic(), 0x504d4449U);
+  ASSERT_EQ(idmap->GetHeader().GetVersion(), 0x09U);
+  ASSERT_EQ(idmap->GetHeader().GetTargetCrc(), 0x1234U);
+  ASSERT_EQ(idmap->GetHeader().GetOverlayCrc(), 0x5678U);
+  ASSERT_EQ(idmap->GetHeader().GetFulfilledPolicies(), kIdmapRawDataPolicies);
+  ASSERT_EQ(idmap->GetHeader().GetEnforceOverlayable(), true);
+  ASSERT_EQ(idmap->GetHeader().GetTargetPath(), kIdmapRawTargetPath);
+  ASSERT_EQ(idmap->GetHeader().GetOverlayPath(), kIdmapRawOverlayPath);
+  ASSERT_EQ(idmap->GetHeader().GetOverlayName(), kIdmapRawOverlayName);
+
+  const auto target_entries = idmap->GetTargetEntries();
+  ASSERT_EQ(target_entries.size(), 3U);
+  ASSERT_TARGET_ENTRY(target_entries[0], 0x7f020000, 0x7f020000);
+  ASSERT_TARGET_ENTRY(target_entries[1], 0x7f030000, 0x7f030000);
+  ASSERT_TARGET_ENTRY(target_entries[2], 0x7f030002, 0x7f030001);
+
+  const auto target_inline_entries = idmap->GetTargetInlineEntries();
+  ASSERT_EQ(target_inline_entries.size(), 1U);
+  ASSERT_TARGET_INLINE_ENTRY(target_inline_entries[0], 0x7f040000, "land-xxhdpi-v7",
+                             Res_value::TYPE_INT_HEX, 0x12345678);
+
+  const auto overlay_entries = idmap->GetOverlayEntries();
+  ASSERT_EQ(overlay_entries.size(), 3U);
+  ASSERT_OVERLAY_ENTRY(overlay_entries[0], 0x7f020000, 0x7f020000);
+  ASSERT_OVERLAY_ENTRY(overlay_entries[1], 0x7f030000, 0x7f030000);
+  ASSERT_OVERLAY_ENTRY(overlay_entries[2], 0x7f030001, 0x7f030002);
+}
+
+TEST(IdmapTests, GracefullyFailToCreateMappedIdmapFromTruncatedData) {
+  std::vector<uint32_t> buffer((kIdmapRawDataLen + 3) / 4);
+  memcpy(buffer.data(), kIdmapRawData, kIdmapRawDataLen);
+
+  // Cut the file in the header, in the entries and in the string pool.
+  for (size_t size : {10U, kIdmapRawDataOffset + 30U, kIdmapRawDataLen - 1U}) {
+    ASSERT_FALSE(MappedIdmap::FromData(buffer.data(), size)) << size;
+  }
+}
+
+TEST(IdmapTests, CreateMappedIdmapFromPath) {
+  TemporaryFile tf;
+  ASSERT_TRUE(android::base::WriteFully(tf.fd, kIdmapRawData, kIdmapRawDataLen));
+
+  auto result = MappedIdmap::FromPath(tf.path);
+  ASSERT_TRUE(result) << result.GetErrorMessage();
+  ASSERT_EQ((*result)->GetHeader().GetTargetPath(), kIdmapRawTargetPath);
+  ASSERT_EQ((*result)->GetTargetEntries().size(), 3U);
+  ASSERT_EQ((*result)->GetOverlayEntries().size(), 3U);
+
+  ASSERT_FALSE(MappedIdmap::FromPath(std::string(tf.path) + ".missing"));
+}
+
 TEST(IdmapTests, CreateIdmapHeaderFromApkAssets) {
   std::string target_apk_path = GetTestDataPath() + "/target/target.apk";
   std::string overlay_apk_path = GetTestDataPath() + "/overlay/overlay.apk";
@@ -141,6 +141,22 @@ Result<Unit> MappingExists(const ResourceMapping& mapping, const ResourceId& tar
   return Result<Unit>({});
 }
 
+TEST(ResourceMappingTests, TargetResourceIdsFromIndex) {
+  auto target = TargetResourceContainer::FromPath(GetTestDataPath() + "/target/target.apk");
+  ASSERT_TRUE(target);
+
+  // Look up enough names for the target to index them, and check the ids before and after.
+  for (size_t i = 0; i < 200; i++) {
+    auto int1 = (*target)->GetResourceId("integer/int1");
+    ASSERT_TRUE(int1) << i;
+    ASSERT_EQ(*int1, R::target::integer::int1) << i;
+    auto str4 = (*target)->GetResourceId("string/str4");
+    ASSERT_TRUE(str4) << i;
+    ASSERT_EQ(*str4, R::target::string::str4) << i;
+    ASSERT_FALSE((*target)->GetResourceId("string/not_in_target")) << i;
+  }
+}
+
 TEST(ResourceMappingTests, ResourcesFromApkAssetsLegacy) {
   auto resources = TestGetResourceMapping("target/target.apk", "overlay/overlay-legacy.apk", "",
                                           PolicyFlags::PUBLIC, /* enforce_overlayable */ false);
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include "TestConstants.h"
+#include "TestHelpers.h"
+#include "android-base/file.h"
+#include "benchmark/benchmark.h"
+#include "idmap2/LogInfo.h"
+#include "idmap2/ResourceContainer.h"
+#include "idmap2/ResourceMapping.h"
+
+using PolicyFlags = android::ResTable_overlayable_policy_header::PolicyFlags;
+
+namespace android::idmap2 {
+
+// The benchmark runs without tests/Main.cpp, but next to the same test data.
+std::string GetTestDataPath() {
+  return base::GetExecutableDirectory() + "/tests/data";
+}
+
+// The names of the test target, see R.h.
+static std::vector<std::string> TargetNames() {
+  std::vector<std::string> names = {"integer/int1", "drawable/dr1"};
+  for (const char* name : {"not_overlayable", "other", "policy_actor", "policy_config_signature",
+                           "policy_odm", "policy_oem", "policy_product", "policy_public",
+                           "policy_signature", "policy_system", "policy_system_vendor", "str1",
+                           "str2", "str3", "str4"}) {
+    names.push_back(std::string("string/") + name);
+  }
+  return names;
+}
+
+// Name lookups in a newly loaded target, which does not index its names for so few of them.
+static void BM_GetResourceIdFirstLookups(benchmark::State& state) {
+  const std::vector<std::string> names = TargetNames();
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto target = TargetResourceContainer::FromPath(GetTestDataPath() + "/target/target.apk");
+    if (!target || !(*target)->GetResourceId(names[0])) {
+      state.SkipWithError("Failed to load the target");
+      return;
+    }
+    state.ResumeTiming();
+    for (const auto& name : names) {
+      benchmark::DoNotOptimize((*target)->GetResourceId(name));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_GetResourceIdFirstLookups);
+
+// Name lookups in a target that has been used for many lookups already, as by a large overlay or
+// by the overlays of a target that idmap2d keeps loaded.
+static void BM_GetResourceIdIndexed(benchmark::State& state) {
+  const std::vector<std::string> names = TargetNames();
+  auto target = TargetResourceContainer::FromPath(GetTestDataPath() + "/target/target.apk");
+  if (!target) {
+    state.SkipWithError("Failed to load the target");
+    return;
+  }
+  for (size_t i = 0; i < 1000; i++) {
+    benchmark::DoNotOptimize((*target)->GetResourceId(names[i % names.size()]));
+  }
+  for (auto _ : state) {
+    for (const auto& name : names) {
+      benchmark::DoNotOptimize((*target)->GetResourceId(name));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_GetResourceIdIndexed);
+
+// The whole mapping of the test overlay on a target that stays loaded.
+static void BM_FromContainers(benchmark::State& state) {
+  auto target = TargetResourceContainer::FromPath(GetTestDataPath() + "/target/target.apk");
+  auto overlay = OverlayResourceContainer::FromPath(GetTestDataPath() + "/overlay/overlay.apk");
+  if (!target || !overlay) {
+    state.SkipWithError("Failed to load the containers");
+    return;
+  }
+  auto overlay_info = (*overlay)->FindOverlayInfo(TestConstants::OVERLAY_NAME_DEFAULT);
+  if (!overlay_info) {
+    state.SkipWithError("Failed to find the overlay info");
+    return;
+  }
+  for (auto _ : state) {
+    LogInfo log_info;
+    auto mapping = ResourceMapping::FromContainers(**target, **overlay, *overlay_info,
+                                                   PolicyFlags::PUBLIC, false, log_info);
+    if (!mapping) {
+      state.SkipWithError("Failed to map the overlay");
+      return;
+    }
+    benchmark::DoNotOptimize(mapping->GetTargetToOverlayMap().size());
+  }
+}
+BENCHMARK(BM_FromContainers);
+
+}  // namespace android::idmap2
+
+BENCHMARK_MAIN();
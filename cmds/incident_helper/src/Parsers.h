@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PARSERS_H
+#define PARSERS_H
+
+#include "TextParserBase.h"
+
+/**
+ * Returns a new parser for the text of the given section, which the caller deletes. Sections
+ * without a parser of their own get a NoopParser, and ids up to 1 are parsers for testing.
+ *
+ * This is the entry point of the parsers for both the incident_helper binary and incidentd,
+ * which links them in to parse sections in process.
+ */
+TextParserBase* selectParser(int section);
+
+#endif  // PARSERS_H
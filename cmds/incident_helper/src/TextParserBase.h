@@ -33,6 +33,8 @@ public:
     explicit TextParserBase(String8 name) : name(name) {};
     virtual ~TextParserBase() {};
 
+    // Parses the text read from in until eof into the proto written to out. Neither fd is
+    // closed, and parsers keep no state across calls, so incidentd runs them on its threads.
     virtual status_t Parse(const int in, const int out) const = 0;
 };
 
@@ -19,7 +19,10 @@
 #include "ih_util.h"
 
 #include <algorithm>
+#include <charconv>
+#include <fcntl.h>
 #include <sstream>
+#include <strings.h>
 #include <unistd.h>
 
 bool isValidChar(char c) {
@@ -52,8 +55,20 @@ static inline std::string trimHeader(const std::string& s) {
     return toLowerStr(trimDefault(s));
 }
 
-static inline bool isNumber(const std::string& s) {
-    std::string::const_iterator it = s.begin();
+static inline std::string_view trimView(std::string_view s) {
+    const auto head = s.find_first_not_of(DEFAULT_WHITESPACE);
+    if (head == std::string_view::npos) return std::string_view();
+
+    const auto tail = s.find_last_not_of(DEFAULT_WHITESPACE);
+    return s.substr(head, tail - head + 1);
+}
+
+static inline bool equalsIgnoreCase(std::string_view s, const char* word) {
+    return s.size() == strlen(word) && strncasecmp(s.data(), word, s.size()) == 0;
+}
+
+static inline bool isNumber(std::string_view s) {
+    std::string_view::const_iterator it = s.begin();
     while (it != s.end() && std::isdigit(*it)) ++it;
     return !s.empty() && it == s.end();
 }
@@ -153,6 +168,58 @@ record_t parseRecordByColumns(const std::string& line, const std::vector<int>& i
     return record;
 }
 
+size_t parseFields(std::string_view line, fields_t* fields, std::string_view delimiters) {
+    fields->clear();
+
+    size_t base = 0;
+    while (base <= line.size()) {
+        size_t found = line.find_first_of(delimiters, base);
+        if (found == std::string_view::npos) found = line.size();
+        std::string_view word = trimView(line.substr(base, found - base));
+        if (!word.empty()) {
+            fields->push_back(word);
+        }
+        base = found + 1;
+    }
+    return fields->size();
+}
+
+size_t parseFieldsByColumns(std::string_view line, const std::vector<int>& indices,
+        fields_t* fields, std::string_view delimiters) {
+    // The same walk as parseRecordByColumns, see the comments there.
+    fields->clear();
+    int lastIndex = 0;
+    int lastBeginning = 0;
+    int lineSize = (int)line.size();
+    for (int idx : indices) {
+        if (idx <= lastIndex) {
+            idx = lastIndex + 1;
+        }
+        if (idx > lineSize) {
+            if (lastIndex < idx && lastIndex < lineSize) {
+                break;
+            }
+            fprintf(stderr, "index wrong: lastIndex: %d, idx: %d, lineSize: %d\n",
+                    lastIndex, idx, lineSize);
+            fields->clear();
+            return 0;
+        }
+        while (idx < lineSize && delimiters.find(line[idx++]) == std::string_view::npos);
+        fields->push_back(trimView(line.substr(lastIndex, idx - lastIndex)));
+        lastBeginning = lastIndex;
+        lastIndex = idx;
+    }
+    if (lineSize - lastIndex > 0) {
+        int beginning = lastIndex;
+        if (fields->size() == indices.size() && !fields->empty()) {
+            fields->pop_back();
+            beginning = lastBeginning;
+        }
+        fields->push_back(trimView(line.substr(beginning, lineSize - beginning)));
+    }
+    return fields->size();
+}
+
 void printRecord(const record_t& record) {
     fprintf(stderr, "Record: { ");
     if (record.size() == 0) {
@@ -208,6 +275,22 @@ bool stripSuffix(std::string* line, const char* key, bool endAtDelimiter) {
     return true;
 }
 
+bool stripPrefix(std::string_view* line, const char* key, bool endAtDelimiter) {
+    const auto head = line->find_first_not_of(DEFAULT_WHITESPACE);
+    if (head == std::string_view::npos) return false;
+    const size_t len = strlen(key);
+    if (line->compare(head, len, key) != 0) return false;
+
+    const size_t j = head + len;
+    if (endAtDelimiter) {
+        // this means if the line only have prefix or no delimiter, we still return false.
+        if (j == line->size() || isValidChar((*line)[j])) return false;
+    }
+
+    *line = trimView(line->substr(j));
+    return true;
+}
+
 std::string behead(std::string* line, const char cut) {
     auto found = line->find_first_of(cut);
     if (found == std::string::npos) {
@@ -221,40 +304,73 @@ std::string behead(std::string* line, const char cut) {
     return head;
 }
 
-int toInt(const std::string& s) {
-    return atoi(s.c_str());
+// Parses like atoi and atoll, without needing a null terminated copy of the view: leading
+// whitespace and a plus sign are skipped, parsing stops at the first non digit and 0 is returned
+// when there is no number or it is out of range.
+template <typename T>
+static T toIntegral(std::string_view s) {
+    s = s.substr(std::min(s.find_first_not_of(" \t\n\v\f\r"), s.size()));
+    if (!s.empty() && s[0] == '+') s.remove_prefix(1);
+    T value = 0;
+    if (std::from_chars(s.data(), s.data() + s.size(), value).ec != std::errc()) return 0;
+    return value;
 }
 
-long long toLongLong(const std::string& s) {
-    return atoll(s.c_str());
+int toInt(std::string_view s) {
+    return toIntegral<int>(s);
 }
 
-double toDouble(const std::string& s) {
-    return atof(s.c_str());
+long long toLongLong(std::string_view s) {
+    return toIntegral<long long>(s);
+}
+
+double toDouble(std::string_view s) {
+    // Values are short, copy them to the stack to null terminate them for atof.
+    char buf[64];
+    if (s.size() >= sizeof(buf)) {
+        return atof(std::string(s).c_str());
+    }
+    memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    return atof(buf);
 }
 
 // ==============================================================================
 Reader::Reader(const int fd)
 {
-    mFile = fdopen(fd, "r");
-    mBuffer = new char[1024];
+    // Read from a dup so that fd stays open, the caller owns it.
+    const int dupFd = fd < 0 ? -1 : fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    mFile = dupFd < 0 ? nullptr : fdopen(dupFd, "r");
+    if (mFile == nullptr && dupFd >= 0) close(dupFd);
+    mBuffer = nullptr;
+    mCapacity = 0;
     mStatus = mFile == nullptr ? "Invalid fd " + std::to_string(fd) : "";
 }
 
 Reader::~Reader()
 {
     if (mFile != nullptr) fclose(mFile);
-    delete[] mBuffer;
+    free(mBuffer);  // allocated by getline
 }
 
 bool Reader::readLine(std::string* line) {
+    std::string_view view;
+    if (!readLine(&view)) return false;
+    line->assign(view);
+    return true;
+}
+
+bool Reader::readLine(std::string_view* line) {
     if (mFile == nullptr) return false;
 
-    size_t len = 0;
-    ssize_t read = getline(&mBuffer, &len, mFile);
+    ssize_t read = getline(&mBuffer, &mCapacity, mFile);
     if (read != -1) {
-        std::string s(mBuffer);
-        line->assign(trim(s, DEFAULT_NEWLINE));
+        // Like trim with DEFAULT_NEWLINE; the line ends at the first null as it used to.
+        std::string_view s(mBuffer, strnlen(mBuffer, read));
+        const auto head = s.find_first_not_of(DEFAULT_NEWLINE);
+        const auto tail = s.find_last_not_of(DEFAULT_NEWLINE);
+        *line = head == std::string_view::npos ? std::string_view()
+                                                : s.substr(head, tail - head + 1);
         return true;
     }
     if (!feof(mFile)) {
@@ -276,11 +392,9 @@ Table::Table(const char* names[], const uint64_t ids[], const int count)
         :mEnums(),
          mEnumValuesByName()
 {
-    std::map<std::string, uint64_t> fields;
     for (int i = 0; i < count; i++) {
-        fields[names[i]] = ids[i];
+        mFields[names[i]] = ids[i];
     }
-    mFields = fields;
 }
 
 Table::~Table()
@@ -295,7 +409,7 @@ Table::addEnumTypeMap(const char* field, const char* enumNames[], const int enum
         return;
     }
 
-    std::map<std::string, int> enu;
+    std::map<std::string, int, std::less<>> enu;
     for (int i = 0; i < enumSize; i++) {
         enu[enumNames[i]] = enumValues[i];
     }
@@ -309,12 +423,13 @@ Table::addEnumNameToValue(const char* enumName, const int enumValue)
 }
 
 bool
-Table::insertField(ProtoOutputStream* proto, const std::string& name, const std::string& value)
+Table::insertField(ProtoOutputStream* proto, std::string_view name, std::string_view value)
 {
-    if (mFields.find(name) == mFields.end()) return false;
+    auto field = mFields.find(name);
+    if (field == mFields.end()) return false;
 
-    uint64_t found = mFields[name];
-    record_t repeats; // used for repeated fields
+    uint64_t found = field->second;
+    fields_t repeats; // used for repeated fields
     switch ((found & FIELD_COUNT_MASK) | (found & FIELD_TYPE_MASK)) {
         case FIELD_COUNT_SINGLE | FIELD_TYPE_DOUBLE:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_FLOAT:
@@ -322,7 +437,7 @@ Table::insertField(ProtoOutputStream* proto, const std::string& name, const std:
             break;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_STRING:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_BYTES:
-            proto->write(found, value);
+            proto->write(found, value.data(), value.size());
             break;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_INT64:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_SINT64:
@@ -332,31 +447,37 @@ Table::insertField(ProtoOutputStream* proto, const std::string& name, const std:
             proto->write(found, toLongLong(value));
             break;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_BOOL:
-            if (strcmp(toLowerStr(value).c_str(), "true") == 0 || strcmp(value.c_str(), "1") == 0) {
+            if (equalsIgnoreCase(value, "true") || value == "1") {
                 proto->write(found, true);
                 break;
             }
-            if (strcmp(toLowerStr(value).c_str(), "false") == 0 || strcmp(value.c_str(), "0") == 0) {
+            if (equalsIgnoreCase(value, "false") || value == "0") {
                 proto->write(found, false);
                 break;
             }
             return false;
-        case FIELD_COUNT_SINGLE | FIELD_TYPE_ENUM:
+        case FIELD_COUNT_SINGLE | FIELD_TYPE_ENUM: {
             // if the field has its own enum mapping, use this, otherwise use general name to value mapping.
-            if (mEnums.find(name) != mEnums.end()) {
-                if (mEnums[name].find(value) != mEnums[name].end()) {
-                    proto->write(found, mEnums[name][value]);
+            auto enums = mEnums.find(name);
+            if (enums != mEnums.end()) {
+                auto enumValue = enums->second.find(value);
+                if (enumValue != enums->second.end()) {
+                    proto->write(found, enumValue->second);
                 } else {
                     proto->write(found, 0); // TODO: should get the default enum value (Unknown)
                 }
-            } else if (mEnumValuesByName.find(value) != mEnumValuesByName.end()) {
-                proto->write(found, mEnumValuesByName[value]);
+                break;
+            }
+            auto enumValue = mEnumValuesByName.find(value);
+            if (enumValue != mEnumValuesByName.end()) {
+                proto->write(found, enumValue->second);
             } else if (isNumber(value)) {
                 proto->write(found, toInt(value));
             } else {
                 return false;
             }
             break;
+        }
         case FIELD_COUNT_SINGLE | FIELD_TYPE_INT32:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_SINT32:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_UINT32:
@@ -366,15 +487,15 @@ Table::insertField(ProtoOutputStream* proto, const std::string& name, const std:
             break;
         // REPEATED TYPE below:
         case FIELD_COUNT_REPEATED | FIELD_TYPE_INT32:
-            repeats = parseRecord(value, COMMA_DELIMITER);
+            parseFields(value, &repeats, COMMA_DELIMITER);
             for (size_t i=0; i<repeats.size(); i++) {
                 proto->write(found, toInt(repeats[i]));
             }
             break;
         case FIELD_COUNT_REPEATED | FIELD_TYPE_STRING:
-            repeats = parseRecord(value, COMMA_DELIMITER);
+            parseFields(value, &repeats, COMMA_DELIMITER);
             for (size_t i=0; i<repeats.size(); i++) {
-                proto->write(found, repeats[i]);
+                proto->write(found, repeats[i].data(), repeats[i].size());
             }
             break;
         default:
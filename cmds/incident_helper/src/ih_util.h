@@ -20,6 +20,7 @@
 #include <map>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <android/util/ProtoOutputStream.h>
@@ -28,6 +29,7 @@ using namespace android::util;
 
 typedef std::vector<std::string> header_t;
 typedef std::vector<std::string> record_t;
+typedef std::vector<std::string_view> fields_t;
 typedef std::string (*trans_func) (const std::string&);
 
 const std::string DEFAULT_WHITESPACE = " \t";
@@ -72,6 +74,17 @@ bool getColumnIndices(std::vector<int>& indices, const char* headerNames[], cons
  */
 record_t parseRecordByColumns(const std::string& line, const std::vector<int>& indices, const std::string& delimiters = DEFAULT_WHITESPACE);
 
+/**
+ * Allocation free versions of parseRecord and parseRecordByColumns for the per line work of the
+ * parsers. The fields are views into the line, which must outlive them, and the vector is cleared
+ * and refilled, so reusing it across lines keeps its capacity. Returns the number of fields, which
+ * is 0 for parseRecordByColumns when the indices are wrong.
+ */
+size_t parseFields(std::string_view line, fields_t* fields,
+        std::string_view delimiters = DEFAULT_WHITESPACE);
+size_t parseFieldsByColumns(std::string_view line, const std::vector<int>& indices,
+        fields_t* fields, std::string_view delimiters = DEFAULT_WHITESPACE);
+
 /** Prints record_t to stderr */
 void printRecord(const record_t& record);
 
@@ -89,6 +102,7 @@ void printRecord(const record_t& record);
  */
 bool stripPrefix(std::string* line, const char* key, bool endAtDelimiter = false);
 bool stripSuffix(std::string* line, const char* key, bool endAtDelimiter = false);
+bool stripPrefix(std::string_view* line, const char* key, bool endAtDelimiter = false);
 
 /**
  * behead the given line by the cut, return the head and reassign the line to be the rest.
@@ -98,13 +112,14 @@ std::string behead(std::string* line, const char cut);
 /**
  * Converts string to the desired type
  */
-int toInt(const std::string& s);
-long long toLongLong(const std::string& s);
-double toDouble(const std::string& s);
+int toInt(std::string_view s);
+long long toLongLong(std::string_view s);
+double toDouble(std::string_view s);
 
 /**
- * Reader class reads data from given fd in streaming fashion.
- * The buffer size is controlled by capacity parameter.
+ * Reader class reads data from given fd in streaming fashion, the fd is not closed.
+ * The line buffer grows to the longest line and is reused for the following ones. The
+ * string_view version of readLine doesn't copy the line, the view is valid until the next read.
  */
 class Reader
 {
@@ -113,11 +128,13 @@ public:
     ~Reader();
 
     bool readLine(std::string* line);
+    bool readLine(std::string_view* line);
     bool ok(std::string* error);
 
 private:
     FILE* mFile;
     char* mBuffer;
+    size_t mCapacity;
     std::string mStatus;
 };
 
@@ -149,11 +166,12 @@ public:
 
     // Based on given name, find the right field id, parse the text value and insert to proto.
     // Return false if the given name can't be found.
-    bool insertField(ProtoOutputStream* proto, const std::string& name, const std::string& value);
+    bool insertField(ProtoOutputStream* proto, std::string_view name, std::string_view value);
 private:
-    std::map<std::string, uint64_t> mFields;
-    std::map<std::string, std::map<std::string, int>> mEnums;
-    std::map<std::string, int> mEnumValuesByName;
+    // Transparent comparators, so that fields are looked up by views without copying them.
+    std::map<std::string, uint64_t, std::less<>> mFields;
+    std::map<std::string, std::map<std::string, int, std::less<>>, std::less<>> mEnums;
+    std::map<std::string, int, std::less<>> mEnumValuesByName;
 };
 
 /**
@@ -16,15 +16,7 @@
 
 #define LOG_TAG "incident_helper"
 
-#include "parsers/BatteryTypeParser.h"
-#include "parsers/CpuFreqParser.h"
-#include "parsers/CpuInfoParser.h"
-#include "parsers/EventLogTagsParser.h"
-#include "parsers/KernelWakesParser.h"
-#include "parsers/PageTypeInfoParser.h"
-#include "parsers/ProcrankParser.h"
-#include "parsers/PsParser.h"
-#include "parsers/SystemPropertiesParser.h"
+#include "Parsers.h"
 
 #include <android-base/file.h>
 #include <getopt.h>
@@ -42,44 +34,6 @@ static void usage(FILE* out) {
     fprintf(out, "  -s           section id, must be positive\n");
 }
 
-//=============================================================================
-static TextParserBase* selectParser(int section) {
-    switch (section) {
-        // IDs smaller than or equal to 0 are reserved for testing
-        case -1:
-            return new TimeoutParser();
-        case 0:
-            return new NoopParser();
-        case 1: // 1 is reserved for incident header so it won't be section id
-            return new ReverseParser();
-/* ========================================================================= */
-        // IDs larger than 1 are section ids reserved in incident.proto
-        case 1000:
-            return new SystemPropertiesParser();
-        case 1100:
-            return new EventLogTagsParser();
-        case 2000:
-            return new ProcrankParser();
-        case 2001:
-            return new PageTypeInfoParser();
-        case 2002:
-            return new KernelWakesParser();
-        case 2003:
-            return new CpuInfoParser();
-        case 2004:
-            return new CpuFreqParser();
-        case 2005:
-            return new PsParser();
-        case 2006:
-            return new BatteryTypeParser();
-        case 3026: // system_trace is already a serialized protobuf
-            return new NoopParser();
-        default:
-            // Return no op parser when no specific ones are implemented.
-            return new NoopParser();
-    }
-}
-
 //=============================================================================
 int main(int argc, char** argv) {
     fprintf(stderr, "Start incident_helper...\n");
@@ -27,9 +27,9 @@ status_t
 KernelWakesParser::Parse(const int in, const int out) const
 {
     Reader reader(in);
-    string line;
+    string_view line;
     header_t header;  // the header of /d/wakeup_sources
-    record_t record;  // retain each record
+    fields_t record;  // retain each record, views into line
     int nline = 0;
 
     ProtoOutputStream proto;
@@ -42,35 +42,39 @@ KernelWakesParser::Parse(const int in, const int out) const
         if (line.empty()) continue;
         // parse head line
         if (nline++ == 0) {
-            header = parseHeader(line, TAB_DELIMITER);
+            header = parseHeader(string(line), TAB_DELIMITER);
             continue;
         }
 
         // parse for each record, the line delimiter is \t only!
-        record = parseRecord(line, TAB_DELIMITER);
+        parseFields(line, &record, TAB_DELIMITER);
 
         if (record.size() < header.size()) {
             // TODO: log this to incident report!
-            fprintf(stderr, "[%s]Line %d has missing fields\n%s\n", this->name.string(), nline, line.c_str());
+            fprintf(stderr, "[%s]Line %d has missing fields\n%.*s\n", this->name.string(), nline, 
+                    (int)line.size(), line.data());
             continue;
         } else if (record.size() > header.size()) {
             // TODO: log this to incident report!
-            fprintf(stderr, "[%s]Line %d has extra fields\n%s\n", this->name.string(), nline, line.c_str());
+            fprintf(stderr, "[%s]Line %d has extra fields\n%.*s\n", this->name.string(), nline, 
+                    (int)line.size(), line.data());
             continue;
         }
 
         uint64_t token = proto.start(KernelWakeSourcesProto::WAKEUP_SOURCES);
         for (int i=0; i<(int)record.size(); i++) {
             if (!table.insertField(&proto, header[i], record[i])) {
-                fprintf(stderr, "[%s]Line %d has bad value %s of %s\n",
-                        this->name.string(), nline, header[i].c_str(), record[i].c_str());
+                fprintf(stderr, "[%s]Line %d has bad value %s of %.*s\n",
+                        this->name.string(), nline, header[i].c_str(), (int)record[i].size(),
+                        record[i].data());
             }
         }
         proto.end(token);
     }
 
-    if (!reader.ok(&line)) {
-        fprintf(stderr, "Bad read from fd %d: %s\n", in, line.c_str());
+    string error;
+    if (!reader.ok(&error)) {
+        fprintf(stderr, "Bad read from fd %d: %s\n", in, error.c_str());
         return -1;
     }
 
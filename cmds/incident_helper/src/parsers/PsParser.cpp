@@ -25,10 +25,10 @@ using namespace android::os;
 
 status_t PsParser::Parse(const int in, const int out) const {
     Reader reader(in);
-    string line;
+    string_view line;
     header_t header;  // the header of /d/wakeup_sources
     vector<int> columnIndices; // task table can't be split by purely delimiter, needs column positions.
-    record_t record;  // retain each record
+    fields_t record;  // retain each record, views into line
     int nline = 0;
     int diff = 0;
 
@@ -46,43 +46,47 @@ status_t PsParser::Parse(const int in, const int out) const {
         if (line.empty()) continue;
 
         if (nline++ == 0) {
-            header = parseHeader(line, DEFAULT_WHITESPACE);
+            header = parseHeader(string(line), DEFAULT_WHITESPACE);
 
             const char* headerNames[] = { "LABEL", "USER", "PID", "TID", "PPID", "VSZ", "RSS", "WCHAN", "ADDR", "S", "PRI", "NI", "RTPRIO", "SCH", "PCY", "TIME", "CMD", nullptr };
-            if (!getColumnIndices(columnIndices, headerNames, line)) {
+            if (!getColumnIndices(columnIndices, headerNames, string(line))) {
                 return -1;
             }
 
             continue;
         }
 
-        record = parseRecordByColumns(line, columnIndices);
+        parseFieldsByColumns(line, columnIndices, &record);
 
         diff = record.size() - header.size();
         if (diff < 0) {
             // TODO: log this to incident report!
-            fprintf(stderr, "[%s]Line %d has %d missing fields\n%s\n", this->name.string(), nline, -diff, line.c_str());
-            printRecord(record);
+            fprintf(stderr, "[%s]Line %d has %d missing fields\n%.*s\n", this->name.string(), nline, -diff,
+                    (int)line.size(), line.data());
+            printRecord(record_t(record.begin(), record.end()));
             continue;
         } else if (diff > 0) {
             // TODO: log this to incident report!
-            fprintf(stderr, "[%s]Line %d has %d extra fields\n%s\n", this->name.string(), nline, diff, line.c_str());
-            printRecord(record);
+            fprintf(stderr, "[%s]Line %d has %d extra fields\n%.*s\n", this->name.string(), nline, diff,
+                    (int)line.size(), line.data());
+            printRecord(record_t(record.begin(), record.end()));
             continue;
         }
 
         uint64_t token = proto.start(PsProto::PROCESSES);
         for (int i=0; i<(int)record.size(); i++) {
             if (!table.insertField(&proto, header[i], record[i])) {
-                fprintf(stderr, "[%s]Line %d has bad value %s of %s\n",
-                        this->name.string(), nline, header[i].c_str(), record[i].c_str());
+                fprintf(stderr, "[%s]Line %d has bad value %s of %.*s\n",
+                        this->name.string(), nline, header[i].c_str(), (int)record[i].size(),
+                        record[i].data());
             }
         }
         proto.end(token);
     }
 
-    if (!reader.ok(&line)) {
-        fprintf(stderr, "Bad read from fd %d: %s\n", in, line.c_str());
+    string error;
+    if (!reader.ok(&error)) {
+        fprintf(stderr, "Bad read from fd %d: %s\n", in, error.c_str());
         return -1;
     }
 
@@ -0,0 +1,137 @@
+// Copyright (C) 2023 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ih_util.h"
+#include "KernelWakesParser.h"
+#include "ProcrankParser.h"
+#include "PsParser.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/test_utils.h>
+#include <android-base/unique_fd.h>
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+using android::base::StringAppendF;
+using android::base::unique_fd;
+
+constexpr int64_t LINE_COUNT = 2000;
+
+static std::string psText(int64_t lines) {
+    std::string text = "LABEL                          USER           PID   TID  PPID     VSZ    RSS "
+                       "WCHAN            ADDR S PRI  NI RTPRIO SCH PCY     TIME CMD\n";
+    for (int64_t i = 0; i < lines; i++) {
+        StringAppendF(&text,
+                      "u:r:system_server:s0           system        %5lld %5lld   %3lld 2529980 "
+                      "183416 SyS_epoll_wait      0 S  19   0      -   0  fg 00:00:%02lld "
+                      "system_server\n",
+                      (long long)(1000 + i), (long long)(1000 + i), (long long)(i % 500),
+                      (long long)(i % 60));
+    }
+    return text;
+}
+
+static std::string procrankText(int64_t lines) {
+    std::string text = "  PID       Vss      Rss      Pss      Uss     Swap    PSwap    USwap    ZSwap "
+                       " cmdline\n";
+    for (int64_t i = 0; i < lines; i++) {
+        StringAppendF(&text,
+                      "%5lld  2148000K  209056K  %6lldK   89108K   23768K    9882K    6212K     "
+                      "3568K  com.example.app%lld\n",
+                      (long long)(1000 + i), (long long)(100000 - i), (long long)i);
+    }
+    text += "                           ------   ------   ------   ------   ------   ------  "
+            "------\n"
+            "                          1201993K  935300K  8863326K  2287619K  1220422K  "
+            "198641K  TOTAL\n"
+            "\n"
+            "ZRAM: 6828K physical used for 31076K in swap (524284K total swap)\n"
+            " RAM: 3843972K total, 281424K free, 116764K buffers, 1777452K cached, 1136K shmem, "
+            "217916K slab\n";
+    return text;
+}
+
+static std::string kernelWakesText(int64_t lines) {
+    std::string text = "name\t\tactive_count\tevent_count\twakeup_count\texpire_count\t"
+                       "active_since\ttotal_time\tmax_time\tlast_change\tprevent_suspend_time\n";
+    for (int64_t i = 0; i < lines; i++) {
+        StringAppendF(&text, "wakeup_source_%lld\t\t%lld\t\t%lld\t\t0\t\t0\t\t0\t\t%lld\t\t12\t\t"
+                             "2446364\t\t0\n",
+                      (long long)i, (long long)i * 3, (long long)i * 3, (long long)i * 7);
+    }
+    return text;
+}
+
+// Runs the parser over the text from a file into /dev/null, and reports the input bytes per
+// second.
+static void runParser(benchmark::State& state, const TextParserBase& parser,
+                      const std::string& text) {
+    TemporaryFile input;
+    unique_fd out(open("/dev/null", O_WRONLY | O_CLOEXEC));
+    if (!android::base::WriteStringToFile(text, input.path) || out.get() < 0) {
+        state.SkipWithError("Failed to set up the files");
+        return;
+    }
+    for (auto _ : state) {
+        unique_fd in(open(input.path, O_RDONLY | O_CLOEXEC));
+        if (in.get() < 0 || parser.Parse(in.get(), out.get()) != NO_ERROR) {
+            state.SkipWithError("Failed to parse");
+            return;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+static void BM_PsParser(benchmark::State& state) {
+    runParser(state, PsParser(), psText(state.range(0)));
+}
+BENCHMARK(BM_PsParser)->Arg(LINE_COUNT);
+
+static void BM_ProcrankParser(benchmark::State& state) {
+    runParser(state, ProcrankParser(), procrankText(state.range(0)));
+}
+BENCHMARK(BM_ProcrankParser)->Arg(LINE_COUNT);
+
+static void BM_KernelWakesParser(benchmark::State& state) {
+    runParser(state, KernelWakesParser(), kernelWakesText(state.range(0)));
+}
+BENCHMARK(BM_KernelWakesParser)->Arg(LINE_COUNT);
+
+// The tokenizers alone, copying each word against viewing it.
+static void BM_ParseRecord(benchmark::State& state) {
+    const std::string line = psText(1).substr(psText(0).size());
+    for (auto _ : state) {
+        record_t record = parseRecord(line);
+        benchmark::DoNotOptimize(record.data());
+    }
+    state.SetBytesProcessed(state.iterations() * line.size());
+}
+BENCHMARK(BM_ParseRecord);
+
+static void BM_ParseFields(benchmark::State& state) {
+    const std::string line = psText(1).substr(psText(0).size());
+    fields_t fields;
+    for (auto _ : state) {
+        parseFields(line, &fields);
+        benchmark::DoNotOptimize(fields.data());
+    }
+    state.SetBytesProcessed(state.iterations() * line.size());
+}
+BENCHMARK(BM_ParseFields);
+
+BENCHMARK_MAIN();
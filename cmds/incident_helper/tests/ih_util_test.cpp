@@ -19,6 +19,7 @@
 #include <android-base/file.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <fcntl.h>
 #include <string>
 
 using namespace android::base;
@@ -99,6 +100,44 @@ TEST(IhUtilTest, ParseRecordByColumns) {
     EXPECT_EQ(expected, result);
 }
 
+// The views must split like parseRecord and parseRecordByColumns.
+static record_t toRecord(const fields_t& fields) {
+    return record_t(fields.begin(), fields.end());
+}
+
+TEST(IhUtilTest, ParseFields) {
+    fields_t fields;
+    const char* lines[] = { " \t \t\t ", " \t 100 00\toooh \t wqrw", "123,456,78_9", "", "a,,b ," };
+    for (const char* delimiters : { " \t", "\t", "," }) {
+        for (const char* line : lines) {
+            size_t count = parseFields(line, &fields, delimiters);
+            EXPECT_EQ(count, fields.size());
+            EXPECT_EQ(parseRecord(line, delimiters), toRecord(fields)) << line;
+        }
+    }
+}
+
+TEST(IhUtilTest, ParseFieldsReusesVector) {
+    fields_t fields;
+    EXPECT_EQ(4u, parseFields("a b c d", &fields));
+    const auto* data = fields.data();
+    EXPECT_EQ(2u, parseFields("e f", &fields));
+    EXPECT_EQ(data, fields.data());
+    EXPECT_EQ(toRecord(fields), record_t({ "e", "f" }));
+}
+
+TEST(IhUtilTest, ParseFieldsByColumns) {
+    fields_t fields;
+    std::vector<int> indices = { 3, 10 };
+    const char* lines[] = { "12345", "abc \t2345  6789 ", "abc \t23456789 bob",
+                            "abc \t         bob", "abcdefgt\t6789 bob", "abcdefgt\t     bob" };
+    for (const char* line : lines) {
+        size_t count = parseFieldsByColumns(line, indices, &fields);
+        EXPECT_EQ(count, fields.size());
+        EXPECT_EQ(parseRecordByColumns(line, indices), toRecord(fields)) << line;
+    }
+}
+
 TEST(IhUtilTest, stripPrefix) {
     string data1 = "Swap: abc ";
     EXPECT_TRUE(stripPrefix(&data1, "Swap:"));
@@ -117,6 +156,24 @@ TEST(IhUtilTest, stripPrefix) {
     EXPECT_THAT(data4, StrEq("Swap: abc "));
 }
 
+TEST(IhUtilTest, stripPrefixView) {
+    string_view data1 = "Swap: abc ";
+    EXPECT_TRUE(stripPrefix(&data1, "Swap:"));
+    EXPECT_EQ(data1, "abc");
+
+    string_view data2 = "Swap: abc ";
+    EXPECT_FALSE(stripPrefix(&data2, "Total:"));
+    EXPECT_EQ(data2, "Swap: abc ");
+
+    string_view data3 = "Swap: abc ";
+    EXPECT_TRUE(stripPrefix(&data3, "Swa"));
+    EXPECT_EQ(data3, "p: abc");
+
+    string_view data4 = "Swap: abc ";
+    EXPECT_FALSE(stripPrefix(&data4, "Swa", true));
+    EXPECT_EQ(data4, "Swap: abc ");
+}
+
 TEST(IhUtilTest, stripSuffix) {
     string data1 = " 243%abc";
     EXPECT_TRUE(stripSuffix(&data1, "abc"));
@@ -151,6 +208,19 @@ TEST(IhUtilTest, behead) {
     EXPECT_THAT(testcase3, "");
 }
 
+TEST(IhUtilTest, toNumbers) {
+    string_view number = "1234 5678";
+    EXPECT_EQ(1234, toInt(number.substr(0, 4)));
+    EXPECT_EQ(1234, toInt(number));
+    EXPECT_EQ(42, toInt(" +42K"));
+    EXPECT_EQ(-7, toInt("-7"));
+    EXPECT_EQ(0, toInt("abc"));
+    EXPECT_EQ(0, toInt(""));
+    EXPECT_EQ(12345678901LL, toLongLong("12345678901"));
+    EXPECT_DOUBLE_EQ(3.5, toDouble(string_view("3.5%").substr(0, 3)));
+    EXPECT_DOUBLE_EQ(-0.25, toDouble("-0.25"));
+}
+
 TEST(IhUtilTest, Reader) {
     TemporaryFile tf;
     ASSERT_NE(tf.fd, -1);
@@ -180,6 +250,42 @@ TEST(IhUtilTest, ReaderEmpty) {
     ASSERT_TRUE(r.ok(&line));
 }
 
+TEST(IhUtilTest, ReaderViews) {
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    const string longLine(3000, 'x');
+    ASSERT_TRUE(WriteStringToFile("first\r\n" + longLine + "\n\nlast", tf.path));
+
+    Reader r(tf.fd);
+    string_view line;
+    ASSERT_TRUE(r.readLine(&line));
+    EXPECT_EQ(line, "first");
+    ASSERT_TRUE(r.readLine(&line));
+    EXPECT_EQ(line, longLine);
+    ASSERT_TRUE(r.readLine(&line));
+    EXPECT_TRUE(line.empty());
+    ASSERT_TRUE(r.readLine(&line));
+    EXPECT_EQ(line, "last");
+    ASSERT_FALSE(r.readLine(&line));
+    string error;
+    ASSERT_TRUE(r.ok(&error));
+}
+
+TEST(IhUtilTest, ReaderLeavesFdOpen) {
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile("line\n", tf.path));
+
+    {
+        Reader r(tf.fd);
+        string line;
+        ASSERT_TRUE(r.readLine(&line));
+        EXPECT_THAT(line, StrEq("line"));
+    }
+    // The parsers run in incidentd, which owns the fd and closes it itself.
+    EXPECT_NE(-1, fcntl(tf.fd, F_GETFD));
+}
+
 TEST(IhUtilTest, ReaderMultipleEmptyLines) {
     TemporaryFile tf;
     ASSERT_NE(tf.fd, -1);
@@ -17,6 +17,7 @@
 #include "Log.h"
 
 #include "FdBuffer.h"
+#include "Gzip.h"
 #include "incidentd_util.h"
 
 #include <log/log.h>
@@ -43,7 +44,8 @@ FdBuffer::FdBuffer(sp<EncodedBuffer> buffer, bool isBufferPooled)
          mFinishTime(-1),
          mTimedOut(false),
          mTruncated(false),
-         mIsBufferPooled(isBufferPooled) {
+         mIsBufferPooled(isBufferPooled),
+         mSplicedBytes(0) {
 }
 
 FdBuffer::~FdBuffer() {
@@ -110,6 +112,43 @@ status_t FdBuffer::read(int fd, int64_t timeout) {
     return NO_ERROR;
 }
 
+status_t FdBuffer::readGzipped(int fd, int64_t timeout) {
+    mStartTime = uptimeMillis();
+    GzipCompressor compressor;
+    GzipCompressor::Sink sink = [this](uint8_t const* buf, size_t size) {
+        return mBuffer->writeRaw(buf, size);
+    };
+    uint8_t buf[BUFFER_SIZE];
+
+    while (true) {
+        if (mBuffer->size() >= MAX_BUFFER_SIZE) {
+            mTruncated = true;
+            VLOG("Truncating data");
+            break;
+        }
+        if (uptimeMillis() >= mStartTime + timeout) {
+            VLOG("timed out due to long read");
+            mTimedOut = true;
+            break;
+        }
+        ssize_t amt = TEMP_FAILURE_RETRY(::read(fd, buf, sizeof(buf)));
+        if (amt < 0) {
+            VLOG("Fail to read %d: %s", fd, strerror(errno));
+            return -errno;
+        } else if (amt == 0) {
+            VLOG("Reached EOF of fd=%d", fd);
+            break;
+        }
+        status_t err = compressor.write(buf, amt, sink);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    status_t err = compressor.finish(sink);
+    mFinishTime = uptimeMillis();
+    return err;
+}
+
 status_t FdBuffer::readFully(int fd) {
     mStartTime = uptimeMillis();
 
@@ -162,6 +201,10 @@ status_t FdBuffer::readProcessedDataInStream(int fd, unique_fd toFd, unique_fd f
     size_t cirSize = 0;
     int rpos = 0, wpos = 0;
 
+    // Whether to try splicing fd into toFd. Not every file supports it, e.g. some proc and
+    // sysfs files, in which case we go back to copying through cirBuf.
+    bool canSplice = true;
+
     // This is the buffer used to store processed data
     while (true) {
         if (mBuffer->size() >= MAX_BUFFER_SIZE) {
@@ -204,8 +247,28 @@ status_t FdBuffer::readProcessedDataInStream(int fd, unique_fd toFd, unique_fd f
             }
         }
 
+        // splice from fd to the parsing process, once everything copied before is written
+        if (canSplice && cirSize == 0 && pfds[0].fd != -1 && pfds[1].fd != -1) {
+            ssize_t amt = TEMP_FAILURE_RETRY(splice(fd, NULL, toFd.get(), NULL, BUFFER_SIZE,
+                                                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+            if (amt < 0) {
+                if (errno == EINVAL || errno == ENOSYS) {
+                    VLOG("fd %d can't be spliced, copying it instead", fd);
+                    canSplice = false;
+                } else if (!(errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    VLOG("Fail to splice fd %d: %s", fd, strerror(errno));
+                    return -errno;
+                }  // otherwise just continue
+            } else if (amt == 0) {
+                VLOG("Reached EOF of input file %d", fd);
+                pfds[0].fd = -1;  // reach EOF so don't have to poll pfds[0].
+            } else {
+                mSplicedBytes += amt;
+            }
+        }
+
         // read from fd
-        if (cirSize != BUFFER_SIZE && pfds[0].fd != -1) {
+        if (!canSplice && cirSize != BUFFER_SIZE && pfds[0].fd != -1) {
             ssize_t amt;
             if (rpos >= wpos) {
                 amt = TEMP_FAILURE_RETRY(::read(fd, cirBuf + rpos, BUFFER_SIZE - rpos));
@@ -57,6 +57,8 @@ public:
      * reads original data in 'fd' and writes to parsing process through 'toFd', then it reads
      * and stores the processed data from 'fromFd' in memory for later usage.
      * This function behaves in a streaming fashion in order to save memory usage.
+     * Where the kernel supports it, the original data is spliced from 'fd' into 'toFd'
+     * instead of being copied through a buffer in memory.
      * Returns NO_ERROR if there were no errors or if we timed out.
      *
      * Poll will return POLLERR if fd is from sysfs, handle this edge case.
@@ -64,6 +66,13 @@ public:
     status_t readProcessedDataInStream(int fd, unique_fd toFd, unique_fd fromFd, int64_t timeoutMs,
                                        const bool isSysfs = false);
 
+    /**
+     * Read the data until the timeout is hit or we hit eof, and store it gzipped. The data is
+     * compressed as it is read, so only the compressed data is held in memory.
+     * Returns NO_ERROR if there were no errors or if we timed out.
+     */
+    status_t readGzipped(int fd, int64_t timeoutMs);
+
     /**
      * Write by hand into the buffer.
      */
@@ -104,6 +113,11 @@ public:
      */
     int64_t durationMs() const { return mFinishTime - mStartTime; }
 
+    /**
+     * How much of the input of readProcessedDataInStream was spliced to the parsing process.
+     */
+    size_t splicedBytes() const { return mSplicedBytes; }
+
     /**
      * Get the EncodedBuffer inside.
      */
@@ -116,6 +130,7 @@ private:
     bool mTimedOut;
     bool mTruncated;
     bool mIsBufferPooled;
+    size_t mSplicedBytes;
 };
 
 }  // namespace incidentd
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false
+#include "Log.h"
+
+#include "Gzip.h"
+
+#include <android-base/file.h>
+#include <log/log.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace android {
+namespace os {
+namespace incidentd {
+
+const size_t GZIP_BUFFER_SIZE = 16 * 1024;  // 16 KB
+// Adding 16 to the window bits makes zlib write a gzip header and trailer instead of zlib ones.
+const int GZIP_WINDOW_BITS = MAX_WBITS + 16;
+// One below zlib's default memory level, which saves 64 KB of deflate state for slightly worse
+// compression.
+const int GZIP_MEM_LEVEL = 7;
+
+// ================================================================================
+GzipCompressor::GzipCompressor() : mStream(), mInitError(NO_ERROR) {
+    if (deflateInit2(&mStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS,
+                     GZIP_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        ALOGW("GzipCompressor failed to init: %s", mStream.msg ? mStream.msg : "no memory");
+        mInitError = NO_MEMORY;
+    }
+}
+
+GzipCompressor::~GzipCompressor() {
+    if (mInitError == NO_ERROR) {
+        deflateEnd(&mStream);
+    }
+}
+
+status_t GzipCompressor::write(uint8_t const* buf, size_t size, const Sink& sink) {
+    if (mInitError != NO_ERROR) {
+        return mInitError;
+    }
+    mStream.next_in = const_cast<Bytef*>(buf);
+    mStream.avail_in = size;
+    return deflate(Z_NO_FLUSH, sink);
+}
+
+status_t GzipCompressor::finish(const Sink& sink) {
+    if (mInitError != NO_ERROR) {
+        return mInitError;
+    }
+    mStream.next_in = nullptr;
+    mStream.avail_in = 0;
+    return deflate(Z_FINISH, sink);
+}
+
+status_t GzipCompressor::deflate(int flush, const Sink& sink) {
+    uint8_t out[GZIP_BUFFER_SIZE];
+    while (true) {
+        mStream.next_out = out;
+        mStream.avail_out = sizeof(out);
+        int ret = ::deflate(&mStream, flush);
+        if (ret == Z_STREAM_ERROR) {
+            ALOGW("GzipCompressor failed to deflate");
+            return BAD_VALUE;
+        }
+        size_t produced = sizeof(out) - mStream.avail_out;
+        if (produced > 0) {
+            status_t err = sink(out, produced);
+            if (err != NO_ERROR) {
+                return err;
+            }
+        }
+        // deflate only leaves output space unused once it has taken all of the input, or has
+        // written the trailer when finishing.
+        if (flush == Z_FINISH ? ret == Z_STREAM_END : mStream.avail_out != 0) {
+            return NO_ERROR;
+        }
+    }
+}
+
+// ================================================================================
+status_t gzip_fd(int in, int out) {
+    GzipCompressor compressor;
+    GzipCompressor::Sink sink = [out](uint8_t const* buf, size_t size) -> status_t {
+        return android::base::WriteFully(out, buf, size) ? NO_ERROR : -errno;
+    };
+    uint8_t buf[GZIP_BUFFER_SIZE];
+    while (true) {
+        ssize_t amt = TEMP_FAILURE_RETRY(::read(in, buf, sizeof(buf)));
+        if (amt < 0) {
+            return -errno;
+        } else if (amt == 0) {
+            return compressor.finish(sink);
+        }
+        status_t err = compressor.write(buf, amt, sink);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+}
+
+// ================================================================================
+struct GzipPipe::State {
+    std::mutex lock;
+    std::condition_variable done;
+    bool finished = false;
+    status_t err = NO_ERROR;
+};
+
+GzipPipe::GzipPipe() : mState(), mWrite() {}
+
+GzipPipe::~GzipPipe() {
+    if (mState != nullptr && mWrite.ok()) {
+        finish(0);
+    }
+}
+
+status_t GzipPipe::start(unique_fd out) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return -errno;
+    }
+    unique_fd in(fds[0]);
+    mWrite.reset(fds[1]);
+    mState = std::make_shared<State>();
+
+    // The thread owns the fds and shares the state, so that it can outlive a finish() that
+    // timed out.
+    std::shared_ptr<State> state = mState;
+    std::thread([state, in = std::move(in), out = std::move(out)]() {
+        status_t err = gzip_fd(in.get(), out.get());
+        if (err != NO_ERROR) {
+            ALOGW("[GzipPipe] failed to compress: %s", strerror(-err));
+        }
+        std::unique_lock<std::mutex> lock(state->lock);
+        state->finished = true;
+        state->err = err;
+        state->done.notify_all();
+    }).detach();
+    return NO_ERROR;
+}
+
+bool GzipPipe::ok() const {
+    if (mState == nullptr) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mState->lock);
+    return !mState->finished || mState->err == NO_ERROR;
+}
+
+status_t GzipPipe::finish(int64_t timeoutMs) {
+    if (mState == nullptr) {
+        return NO_INIT;
+    }
+    // Closing the write end is the eof the worker waits for.
+    mWrite.reset();
+    std::unique_lock<std::mutex> lock(mState->lock);
+    if (!mState->done.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                               [this] { return mState->finished; })) {
+        return TIMED_OUT;
+    }
+    return mState->err;
+}
+
+}  // namespace incidentd
+}  // namespace os
+}  // namespace android
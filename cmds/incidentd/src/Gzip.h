@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <android-base/unique_fd.h>
+#include <utils/Errors.h>
+#include <zlib.h>
+
+#include <functional>
+#include <memory>
+
+namespace android {
+namespace os {
+namespace incidentd {
+
+using android::base::unique_fd;
+
+/**
+ * Compresses data into the gzip format in process, in place of running /system/bin/gzip.
+ * The compressed output is handed to a sink as it is produced, so neither the input nor the
+ * output is ever held as a whole.
+ */
+class GzipCompressor {
+public:
+    // Takes size bytes of compressed output. Returns NO_ERROR, or an error that stops compressing.
+    using Sink = std::function<status_t(uint8_t const* buf, size_t size)>;
+
+    GzipCompressor();
+    ~GzipCompressor();
+
+    /**
+     * Compresses size bytes of buf.
+     */
+    status_t write(uint8_t const* buf, size_t size, const Sink& sink);
+
+    /**
+     * Flushes the rest of the output and the gzip trailer. Nothing can be written afterwards.
+     */
+    status_t finish(const Sink& sink);
+
+private:
+    status_t deflate(int flush, const Sink& sink);
+
+    z_stream mStream;
+    status_t mInitError;
+};
+
+/**
+ * Compresses everything read from in until eof and writes it to out.
+ */
+status_t gzip_fd(int in, int out);
+
+/**
+ * A pipe whose data is compressed into another fd on a worker thread. This stands in for a gzip
+ * child process fed through a pipe, without the cost of forking one.
+ */
+class GzipPipe {
+public:
+    GzipPipe();
+    ~GzipPipe();
+
+    /**
+     * Starts compressing the data written to writeFd() into out.
+     */
+    status_t start(unique_fd out);
+
+    /**
+     * The fd to write the uncompressed data to, -1 before start().
+     */
+    int writeFd() const { return mWrite.get(); }
+
+    /**
+     * Whether the worker is still compressing, i.e. it has not failed.
+     */
+    bool ok() const;
+
+    /**
+     * Closes writeFd() and waits up to timeoutMs for the worker to compress the rest.
+     * Returns the error of the worker, or TIMED_OUT if it didn't finish in time. The worker
+     * closes out when it is done, even after a time out.
+     */
+    status_t finish(int64_t timeoutMs);
+
+private:
+    struct State;
+    std::shared_ptr<State> mState;
+    unique_fd mWrite;
+};
+
+}  // namespace incidentd
+}  // namespace os
+}  // namespace android
+
+#endif  // GZIP_H
@@ -26,11 +26,42 @@
 #include <android/util/ProtoFileReader.h>
 #include <log/log.h>
 
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace android {
 namespace os {
 namespace incidentd {
 
 // ================================================================================
+/**
+ * Copies the next size bytes of in to out[i] for every i where keep[i] is set, straight from the
+ * buffer of the reader when it can view them. spans is scratch space for the views.
+ */
+static void copy_bytes_to_each(const vector<ProtoOutputStream*>& outs, const vector<bool>& keep,
+        const sp<ProtoReader>& in, size_t size, vector<ProtoSpan>* spans) {
+    spans->clear();
+    if (in->readSpans(size, spans)) {
+        for (const ProtoSpan& span : *spans) {
+            for (size_t i = 0; i < outs.size(); i++) {
+                if (keep[i]) {
+                    outs[i]->writeRaw(span.data, span.size);
+                }
+            }
+        }
+        return;
+    }
+    for (size_t j = 0; j < size; j++) {
+        uint8_t byte = in->next();
+        for (size_t i = 0; i < outs.size(); i++) {
+            if (keep[i]) {
+                outs[i]->writeRawByte(byte);
+            }
+        }
+    }
+}
+
 /**
  * Write the field to buf based on the wire type, iterator will point to next field.
  * If skip is set to true, no data will be written to buf. Return number of bytes written.
@@ -71,24 +102,82 @@ void write_field_or_skip(ProtoOutputStream* out, const sp<ProtoReader>& in,
     if (skip) {
         in->move(bytesToWrite);
     } else {
-        for (size_t i = 0; i < bytesToWrite; i++) {
-            out->writeRawByte(in->next());
+        vector<ProtoSpan> spans;
+        copy_bytes_to_each({out}, {true}, in, bytesToWrite, &spans);
+    }
+}
+
+/**
+ * Like write_field_or_skip, for several output streams at once: the field is read once and
+ * written to out[i] for every i where keep[i] is set.
+ */
+static void write_field_to_each(const vector<ProtoOutputStream*>& outs, const vector<bool>& keep,
+        const sp<ProtoReader>& in, uint32_t fieldTag, vector<ProtoSpan>* spans) {
+    uint8_t wireType = read_wire_type(fieldTag);
+    size_t bytesToWrite = 0;
+
+    switch (wireType) {
+        case WIRE_TYPE_VARINT: {
+            uint64_t varint = in->readRawVarint();
+            for (size_t i = 0; i < outs.size(); i++) {
+                if (keep[i]) {
+                    outs[i]->writeRawVarint(fieldTag);
+                    outs[i]->writeRawVarint(varint);
+                }
+            }
+            return;
+        }
+        case WIRE_TYPE_FIXED64:
+            bytesToWrite = 8;
+            break;
+        case WIRE_TYPE_LENGTH_DELIMITED:
+            bytesToWrite = in->readRawVarint();
+            break;
+        case WIRE_TYPE_FIXED32:
+            bytesToWrite = 4;
+            break;
+    }
+
+    bool anyKept = false;
+    for (size_t i = 0; i < outs.size(); i++) {
+        if (!keep[i]) {
+            continue;
+        }
+        anyKept = true;
+        if (wireType == WIRE_TYPE_LENGTH_DELIMITED) {
+            outs[i]->writeLengthDelimitedHeader(read_field_id(fieldTag), bytesToWrite);
+        } else {
+            outs[i]->writeRawVarint(fieldTag);
         }
     }
+    if (!anyKept) {
+        in->move(bytesToWrite);
+        return;
+    }
+    copy_bytes_to_each(outs, keep, in, bytesToWrite, spans);
 }
 
 /**
- * Strip next field based on its private policy and request spec, then stores data in buf.
- * Return NO_ERROR if succeeds, otherwise BAD_VALUE is returned to indicate bad data in
- * FdBuffer.
+ * Scratch space reused for every field of a strip pass, so that fields don't allocate.
+ */
+struct StripScratch {
+    vector<bool> keep;
+    vector<ProtoSpan> spans;
+};
+
+/**
+ * Strip next field based on its private policy and several request specs at once: the field
+ * is parsed once, and written to outs[i] if specs[i] allows it. Return NO_ERROR if succeeds,
+ * otherwise BAD_VALUE is returned to indicate bad data in FdBuffer.
  *
  * The iterator must point to the head of a protobuf formatted field for successful operation.
  * After exit with NO_ERROR, iterator points to the next protobuf field's head.
  *
  * depth is the depth of recursion, for debugging.
  */
-status_t strip_field(ProtoOutputStream* out, const sp<ProtoReader>& in,
-        const Privacy* parentPolicy, const PrivacySpec& spec, int depth) {
+static status_t strip_field_for_each(const vector<ProtoOutputStream*>& outs,
+        const vector<PrivacySpec>& specs, const sp<ProtoReader>& in,
+        const Privacy* parentPolicy, int depth, StripScratch* scratch) {
     if (!in->hasNext() || parentPolicy == NULL) {
         return BAD_VALUE;
     }
@@ -97,18 +186,24 @@ status_t strip_field(ProtoOutputStream* out, const sp<ProtoReader>& in,
     const Privacy* policy = lookup(parentPolicy, fieldId);
 
     if (policy == NULL || policy->children == NULL) {
-        bool skip = !spec.CheckPremission(policy, parentPolicy->policy);
+        vector<bool>& keep = scratch->keep;
+        keep.resize(outs.size());
+        for (size_t i = 0; i < outs.size(); i++) {
+            keep[i] = specs[i].CheckPremission(policy, parentPolicy->policy);
+        }
         // iterator will point to head of next field
-        size_t currentAt = in->bytesRead();
-        write_field_or_skip(out, in, fieldTag, skip);
+        write_field_to_each(outs, keep, in, fieldTag, &scratch->spans);
         return NO_ERROR;
     }
     // current field is message type and its sub-fields have extra privacy policies
     uint32_t msgSize = in->readRawVarint();
     size_t start = in->bytesRead();
-    uint64_t token = out->start(encode_field_id(policy));
+    vector<uint64_t> tokens(outs.size());
+    for (size_t i = 0; i < outs.size(); i++) {
+        tokens[i] = outs[i]->start(encode_field_id(policy));
+    }
     while (in->bytesRead() - start != msgSize) {
-        status_t err = strip_field(out, in, policy, spec, depth + 1);
+        status_t err = strip_field_for_each(outs, specs, in, policy, depth + 1, scratch);
         if (err != NO_ERROR) {
             ALOGW("Bad value when stripping id %d, wiretype %d, tag %#x, depth %d, size %d, "
                     "relative pos %zu, ", fieldId, read_wire_type(fieldTag), fieldTag, depth,
@@ -116,33 +211,42 @@ status_t strip_field(ProtoOutputStream* out, const sp<ProtoReader>& in,
             return err;
         }
     }
-    out->end(token);
+    for (size_t i = 0; i < outs.size(); i++) {
+        outs[i]->end(tokens[i]);
+    }
     return NO_ERROR;
 }
 
 // ================================================================================
 class FieldStripper {
 public:
-    FieldStripper(const Privacy* restrictions, const sp<ProtoReader>& data,
+    FieldStripper(const Privacy* restrictions, const sp<EncodedBuffer>& data,
             uint8_t bufferLevel);
 
     ~FieldStripper();
 
     /**
-     * Take the data that we have, and filter it down so that no fields
-     * are more sensitive than the given privacy policy.
+     * Take the data that we have, and filter it down so that no fields are more
+     * sensitive than each of the given privacy policies. The data is only parsed
+     * once, however many policies there are.
      */
-    status_t strip(uint8_t privacyPolicy);
+    status_t strip(const vector<uint8_t>& privacyPolicies);
 
     /**
-     * At the current filter level, how many bytes of data there is.
+     * At the given filter level, which must have been passed to strip, how many
+     * bytes of data there is.
      */
-    ssize_t dataSize() const { return mSize; }
+    ssize_t dataSize(uint8_t privacyPolicy);
 
     /**
-     * Write the data from the current filter level to the file descriptor.
+     * Whether the data at the given filter level is different from the unfiltered data.
      */
-    status_t writeData(int fd);
+    bool isStripped(uint8_t privacyPolicy) const { return mStripped.count(privacyPolicy) != 0; }
+
+    /**
+     * Write the data from the given filter level to the file descriptor.
+     */
+    status_t writeData(uint8_t privacyPolicy, int fd);
 
 private:
     /**
@@ -151,85 +255,93 @@ private:
     const Privacy* mRestrictions;
 
     /**
-     * The current buffer.
+     * The unfiltered data.
      */
-    sp<ProtoReader> mData;
+    sp<EncodedBuffer> mData;
 
     /**
-     * The current size of the buffer inside mData.
+     * The privacy policy that the data is already filtered to, as an optimization
+     * so we don't re-filter data that has already been filtered.
      */
-    ssize_t mSize;
+    uint8_t mBufferLevel;
 
     /**
-     * The current privacy policy that the data is filtered to, as an optimization
-     * so we don't always re-filter data that has already been filtered.
+     * The data filtered to each of the policies that needed stripping, and the
+     * pooled buffers that hold it.
      */
-    uint8_t mCurrentLevel;
-
-    sp<EncodedBuffer> mEncodedBuffer;
+    map<uint8_t, unique_ptr<ProtoOutputStream>> mStripped;
+    vector<sp<EncodedBuffer>> mBuffers;
 };
 
-FieldStripper::FieldStripper(const Privacy* restrictions, const sp<ProtoReader>& data,
+FieldStripper::FieldStripper(const Privacy* restrictions, const sp<EncodedBuffer>& data,
             uint8_t bufferLevel)
         :mRestrictions(restrictions),
          mData(data),
-         mSize(data->size()),
-         mCurrentLevel(bufferLevel),
-         mEncodedBuffer(get_buffer_from_pool()) {
-    if (mSize < 0) {
-        ALOGW("FieldStripper constructed with a ProtoReader that doesn't support size."
-                " Data will be missing.");
-    }
+         mBufferLevel(bufferLevel) {
 }
 
 FieldStripper::~FieldStripper() {
-    return_buffer_to_pool(mEncodedBuffer);
+    mStripped.clear();
+    for (const sp<EncodedBuffer>& buffer : mBuffers) {
+        return_buffer_to_pool(buffer);
+    }
 }
 
-status_t FieldStripper::strip(const uint8_t privacyPolicy) {
-    // If the current strip level is less (fewer fields retained) than what's already in the
-    // buffer, then we can skip it.
-    if (mCurrentLevel < privacyPolicy) {
-        PrivacySpec spec(privacyPolicy);
-        mEncodedBuffer->clear();
-        ProtoOutputStream proto(mEncodedBuffer);
-
+status_t FieldStripper::strip(const vector<uint8_t>& privacyPolicies) {
+    vector<ProtoOutputStream*> outs;
+    vector<PrivacySpec> specs;
+    for (uint8_t privacyPolicy : privacyPolicies) {
+        // If the strip level is less (fewer fields retained) than what's already in the
+        // buffer, then we can skip it.
+        if (mBufferLevel >= privacyPolicy || mStripped.count(privacyPolicy) != 0) {
+            continue;
+        }
         // Optimization when no strip happens.
+        PrivacySpec spec(privacyPolicy);
         if (mRestrictions == NULL || spec.RequireAll()) {
-            if (spec.CheckPremission(mRestrictions)) {
-                mSize = mData->size();
-            }
-            return NO_ERROR;
-        }
-
-        while (mData->hasNext()) {
-            status_t err = strip_field(&proto, mData, mRestrictions, spec, 0);
-            if (err != NO_ERROR) {
-                return err; // Error logged in strip_field.
-            }
+            continue;
         }
+        sp<EncodedBuffer> buffer = get_buffer_from_pool();
+        mBuffers.push_back(buffer);
+        unique_ptr<ProtoOutputStream> proto = make_unique<ProtoOutputStream>(buffer);
+        outs.push_back(proto.get());
+        specs.push_back(spec);
+        mStripped[privacyPolicy] = std::move(proto);
+    }
+    if (outs.empty()) {
+        return NO_ERROR;
+    }
 
-        if (mData->bytesRead() != mData->size()) {
-            ALOGW("Buffer corrupted: expect %zu bytes, read %zu bytes", mData->size(),
-                    mData->bytesRead());
-            return BAD_VALUE;
+    sp<ProtoReader> reader = mData->read();
+    StripScratch scratch;
+    while (reader->hasNext()) {
+        status_t err = strip_field_for_each(outs, specs, reader, mRestrictions, 0, &scratch);
+        if (err != NO_ERROR) {
+            return err; // Error logged in strip_field_for_each.
         }
+    }
 
-        mData = proto.data();
-        mSize = proto.size();
-        mCurrentLevel = privacyPolicy;
+    if (reader->bytesRead() != reader->size()) {
+        ALOGW("Buffer corrupted: expect %zu bytes, read %zu bytes", reader->size(),
+                reader->bytesRead());
+        return BAD_VALUE;
     }
     return NO_ERROR;
 }
 
-status_t FieldStripper::writeData(int fd) {
-    status_t err = NO_ERROR;
-    sp<ProtoReader> reader = mData;
-    if (mData == nullptr) {
-        // There had been an error processing the data. We won't write anything,
-        // but we also won't return an error, because errors are fatal.
-        return NO_ERROR;
+ssize_t FieldStripper::dataSize(uint8_t privacyPolicy) {
+    auto stripped = mStripped.find(privacyPolicy);
+    if (stripped == mStripped.end()) {
+        return mData->size();
     }
+    return stripped->second->size();
+}
+
+status_t FieldStripper::writeData(uint8_t privacyPolicy, int fd) {
+    status_t err = NO_ERROR;
+    auto stripped = mStripped.find(privacyPolicy);
+    sp<ProtoReader> reader = stripped == mStripped.end() ? mData->read()
+                                                          : stripped->second->data();
     while (reader->readBuffer() != NULL) {
         err = WriteFully(fd, reader->readBuffer(), reader->currentToRead()) ? NO_ERROR : -errno;
         reader->move(reader->currentToRead());
@@ -277,22 +389,26 @@ status_t PrivacyFilter::writeData(const FdBuffer& buffer, uint8_t bufferLevel,
             return a->getPrivacyPolicy() < b->getPrivacyPolicy();
         });
 
-    uint8_t privacyPolicy = PRIVACY_POLICY_LOCAL; // a.k.a. no filtering
-    FieldStripper fieldStripper(mRestrictions, buffer.data()->read(), bufferLevel);
+    // Filter the data to every policy that is asked for in a single pass.
+    vector<uint8_t> privacyPolicies;
     for (const sp<FilterFd>& output: mOutputs) {
-        // Do another level of filtering if necessary
-        if (privacyPolicy != output->getPrivacyPolicy()) {
-            privacyPolicy = output->getPrivacyPolicy();
-            err = fieldStripper.strip(privacyPolicy);
-            if (err != NO_ERROR) {
-                // We can't successfully strip this data.  We will skip
-                // the rest of this section.
-                return NO_ERROR;
-            }
+        if (privacyPolicies.empty() || privacyPolicies.back() != output->getPrivacyPolicy()) {
+            privacyPolicies.push_back(output->getPrivacyPolicy());
+        }
+    }
+    FieldStripper fieldStripper(mRestrictions, buffer.data(), bufferLevel);
+    status_t stripErr = fieldStripper.strip(privacyPolicies);
+
+    for (const sp<FilterFd>& output: mOutputs) {
+        const uint8_t privacyPolicy = output->getPrivacyPolicy();
+        if (stripErr != NO_ERROR && fieldStripper.isStripped(privacyPolicy)) {
+            // We can't successfully strip this data.  We will skip
+            // the rest of this section.
+            return NO_ERROR;
         }
 
         // Write the resultant buffer to the fd, along with the header.
-        ssize_t dataSize = fieldStripper.dataSize();
+        ssize_t dataSize = fieldStripper.dataSize(privacyPolicy);
         if (dataSize > 0) {
             err = write_section_header(output->getFd(), mSectionId, dataSize);
             if (err != NO_ERROR) {
@@ -300,7 +416,7 @@ status_t PrivacyFilter::writeData(const FdBuffer& buffer, uint8_t bufferLevel,
                 continue;
             }
 
-            err = fieldStripper.writeData(output->getFd());
+            err = fieldStripper.writeData(privacyPolicy, output->getFd());
             if (err != NO_ERROR) {
                 output->onWriteError(err);
                 continue;
@@ -38,7 +38,10 @@
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <time.h>
 #include <wait.h>
 
@@ -53,8 +56,14 @@ using namespace android::util;
  *      frameworks/base/core/proto/android/os/incident.proto
  */
 const int FIELD_ID_METADATA = 2;
-// Args for exec gzip
-static const char* GZIP[] = {"/system/bin/gzip", NULL};
+
+/**
+ * How many sections run at the same time, and how many may have finished and wait in memory
+ * for the sections before them to be written out.
+ */
+const size_t MAX_PARALLEL_SECTIONS = 4;
+const size_t MAX_BUFFERED_SECTIONS = 8;
+
 
 IncidentMetadata_Destination privacy_policy_to_dest(uint8_t privacyPolicy) {
     switch (privacyPolicy) {
@@ -147,7 +156,7 @@ ReportRequest::ReportRequest(const IncidentReportArgs& a,
          mFd(fd),
          mIsStreaming(fd >= 0),
          mStatus(OK),
-         mZipPid(-1) {
+         mZip() {
 }
 
 ReportRequest::~ReportRequest() {
@@ -164,8 +173,7 @@ bool ReportRequest::ok() {
     if (!args.gzip()) {
         return mFd >= 0;
     }
-    // Send a blank signal to check if mZipPid is alive
-    return mZipPid > 0 && kill(mZipPid, 0) == 0;
+    return mZip != nullptr && mZip->ok();
 }
 
 bool ReportRequest::containsSection(int sectionId) const {
@@ -180,37 +188,33 @@ void ReportRequest::closeFd() {
         close(mFd);
         mFd = -1;
     }
-    if (mZipPid > 0) {
-        mZipPipe.close();
+    if (mZip != nullptr) {
         // Gzip may take some time.
-        status_t err = wait_child(mZipPid, /* timeout_ms= */ 10 * 1000);
+        status_t err = mZip->finish(/* timeoutMs= */ 10 * 1000);
         if (err != 0) {
-            ALOGW("[ReportRequest] abnormal child process: %s", strerror(-err));
+            ALOGW("[ReportRequest] gzip failed: %s", strerror(-err));
         }
+        mZip.reset();
     }
 }
 
 int ReportRequest::getFd() {
-    return mZipPid > 0 ? mZipPipe.writeFd().get() : mFd;
+    return mZip != nullptr ? mZip->writeFd() : mFd;
 }
 
 status_t ReportRequest::initGzipIfNecessary() {
     if (!mIsStreaming || !args.gzip()) {
         return OK;
     }
-    if (!mZipPipe.init()) {
+    unique_ptr<GzipPipe> zip = std::make_unique<GzipPipe>();
+    status_t err = zip->start(unique_fd(mFd));
+    mFd = -1;
+    if (err != OK) {
         ALOGE("[ReportRequest] Failed to setup pipe for gzip");
-        mStatus = -errno;
-        return mStatus;
-    }
-    int status = 0;
-    pid_t pid = fork_execute_cmd((char* const*)GZIP, mZipPipe.readFd().release(), mFd, &status);
-    if (pid < 0 || status != 0) {
-        mStatus = status;
+        mStatus = err;
         return mStatus;
     }
-    mZipPid = pid;
-    mFd = -1;
+    mZip = std::move(zip);
     return OK;
 }
 
@@ -385,7 +389,17 @@ void ReportBatch::removeRequest(const sp<ReportRequest>& request) {
 ReportWriter::ReportWriter(const sp<ReportBatch>& batch)
         :mBatch(batch),
          mPersistedFile(),
-         mMaxPersistedPrivacyPolicy(PRIVACY_POLICY_UNSET) {
+         mMaxPersistedPrivacyPolicy(PRIVACY_POLICY_UNSET),
+         mSectionEndTimeMs(-1),
+         mBuffering(false) {
+}
+
+ReportWriter::ReportWriter()
+        :mBatch(),
+         mPersistedFile(),
+         mMaxPersistedPrivacyPolicy(PRIVACY_POLICY_UNSET),
+         mSectionEndTimeMs(-1),
+         mBuffering(true) {
 }
 
 ReportWriter::~ReportWriter() {
@@ -402,10 +416,12 @@ void ReportWriter::setMaxPersistedPrivacyPolicy(uint8_t privacyPolicy) {
 void ReportWriter::startSection(int sectionId) {
     mCurrentSectionId = sectionId;
     mSectionStartTimeMs = uptimeMillis();
+    mSectionEndTimeMs = -1;
 
     mSectionStatsCalledForSectionId = -1;
     mDumpSizeBytes = 0;
     mDumpDurationMs = 0;
+    mDumpSplicedBytes = 0;
     mSectionTimedOut = false;
     mSectionTruncated = false;
     mSectionBufferSuccess = false;
@@ -417,13 +433,14 @@ void ReportWriter::setSectionStats(const FdBuffer& buffer) {
     mSectionStatsCalledForSectionId = mCurrentSectionId;
     mDumpSizeBytes = buffer.size();
     mDumpDurationMs = buffer.durationMs();
+    mDumpSplicedBytes = buffer.splicedBytes();
     mSectionTimedOut = buffer.timedOut();
     mSectionTruncated = buffer.truncated();
     mSectionBufferSuccess = !buffer.timedOut() && !buffer.truncated();
 }
 
 void ReportWriter::endSection(IncidentMetadata::SectionStats* sectionMetadata) {
-    long endTime = uptimeMillis();
+    long endTime = mSectionEndTimeMs >= 0 ? mSectionEndTimeMs : uptimeMillis();
 
     if (mSectionStatsCalledForSectionId != mCurrentSectionId) {
         ALOGW("setSectionStats not called for section %d", mCurrentSectionId);
@@ -438,6 +455,11 @@ void ReportWriter::endSection(IncidentMetadata::SectionStats* sectionMetadata) {
     sectionMetadata->set_timed_out(mSectionTimedOut);
     sectionMetadata->set_is_truncated(mSectionTruncated);
     sectionMetadata->set_error_msg(mSectionErrors);
+
+    if (mDumpSplicedBytes > 0) {
+        ALOGD("Section %d: spliced %zu bytes of input to its parser", mCurrentSectionId,
+                mDumpSplicedBytes);
+    }
 }
 
 void ReportWriter::warning(const Section* section, status_t err, const char* format, ...) {
@@ -493,6 +515,14 @@ void ReportWriter::vflog(const Section* section, status_t err, int level, const
 
 // Reads data from FdBuffer and writes it to the requests file descriptor.
 status_t ReportWriter::writeSection(const FdBuffer& buffer) {
+    if (mBuffering) {
+        // The buffer belongs to the section and is gone once it returns, so keep a copy.
+        if (mBufferedData == nullptr) {
+            mBufferedData = make_unique<FdBuffer>();
+        }
+        return mBufferedData->write(buffer.data()->read());
+    }
+
     PrivacyFilter filter(mCurrentSectionId, get_privacy_of_section(mCurrentSectionId));
 
     // Add the fd for the persisted requests
@@ -514,6 +544,31 @@ status_t ReportWriter::writeSection(const FdBuffer& buffer) {
     return filter.writeData(buffer, PRIVACY_POLICY_LOCAL, &mMaxSectionDataFilteredSize);
 }
 
+void ReportWriter::finishBufferedSection() {
+    mSectionEndTimeMs = uptimeMillis();
+}
+
+status_t ReportWriter::writeBufferedSection(const ReportWriter& buffered) {
+    mSectionStartTimeMs = buffered.mSectionStartTimeMs;
+    mSectionEndTimeMs = buffered.mSectionEndTimeMs;
+    if (buffered.mSectionStatsCalledForSectionId == buffered.mCurrentSectionId) {
+        mSectionStatsCalledForSectionId = mCurrentSectionId;
+    }
+    mDumpSizeBytes = buffered.mDumpSizeBytes;
+    mDumpDurationMs = buffered.mDumpDurationMs;
+    mDumpSplicedBytes = buffered.mDumpSplicedBytes;
+    mSectionTimedOut = buffered.mSectionTimedOut;
+    mSectionTruncated = buffered.mSectionTruncated;
+    mSectionBufferSuccess = buffered.mSectionBufferSuccess;
+    mHadError = buffered.mHadError;
+    mSectionErrors = buffered.mSectionErrors;
+
+    if (buffered.mBufferedData == nullptr) {
+        return NO_ERROR;
+    }
+    return writeSection(*buffered.mBufferedData);
+}
+
 
 // ================================================================================
 Reporter::Reporter(const sp<WorkDirectory>& workDirectory,
@@ -532,6 +587,7 @@ void Reporter::runReport(size_t* reportByteSize) {
     status_t err = NO_ERROR;
 
     IncidentMetadata metadata;
+    vector<const Section*> sections;
     int persistedPrivacyPolicy = PRIVACY_POLICY_UNSET;
 
     (*reportByteSize) = 0;
@@ -612,7 +668,7 @@ void Reporter::runReport(size_t* reportByteSize) {
     mBatch->forEachStreamingRequest([](const sp<ReportRequest>& request) {
         status_t err = request->initGzipIfNecessary();
         if (err != 0) {
-            ALOGW("Error forking gzip: %s", strerror(err));
+            ALOGW("Error starting gzip: %s", strerror(-err));
         }
     });
 
@@ -636,10 +692,13 @@ void Reporter::runReport(size_t* reportByteSize) {
     // For each of the report fields, see if we need it, and if so, execute the command
     // and report to those that care that we're doing it.
     for (const Section** section = SECTION_LIST; *section; section++) {
-        if (execute_section(*section, &metadata, reportByteSize) != NO_ERROR) {
-            goto DONE;
+        if (mBatch->containsSection((*section)->id)) {
+            sections.push_back(*section);
         }
     }
+    if (execute_sections(sections, &metadata, reportByteSize) != NO_ERROR) {
+        goto DONE;
+    }
 
     for (const Section* section : mRegisteredSections) {
         if (execute_section(section, &metadata, reportByteSize) != NO_ERROR) {
@@ -702,8 +761,89 @@ DONE:
     ALOGI("Done taking incident report err=%s", strerror(-err));
 }
 
+status_t Reporter::execute_sections(const vector<const Section*>& sections,
+        IncidentMetadata* metadata, size_t* reportByteSize) {
+    const size_t threadCount = min(MAX_PARALLEL_SECTIONS, sections.size());
+    if (threadCount <= 1) {
+        for (const Section* section : sections) {
+            status_t err = execute_section(section, metadata, reportByteSize);
+            if (err != NO_ERROR) {
+                return err;
+            }
+        }
+        return NO_ERROR;
+    }
+
+    // Sections run on worker threads into memory, and are written out here in the order of
+    // SECTION_LIST, so the report looks the same as when they run one after another. Only the
+    // section data goes through the workers; the requests, listeners and privacy filtering are
+    // only touched on this thread.
+    vector<unique_ptr<BufferedSection>> buffered;
+    buffered.reserve(sections.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+        buffered.push_back(make_unique<BufferedSection>());
+    }
+
+    mutex lock;
+    condition_variable changed;
+    size_t next = 0;
+    size_t written = 0;
+    bool stopped = false;
+
+    auto worker = [&]() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            // Bound how far the workers get ahead of the section being written, since every
+            // finished section holds its data in memory until then.
+            changed.wait(guard, [&]() {
+                return stopped || next >= sections.size()
+                        || next < written + MAX_BUFFERED_SECTIONS;
+            });
+            if (stopped || next >= sections.size()) {
+                return;
+            }
+            const size_t i = next++;
+            guard.unlock();
+
+            BufferedSection* section = buffered[i].get();
+            section->writer.startSection(sections[i]->id);
+            section->err = sections[i]->Execute(&section->writer);
+            section->writer.finishBufferedSection();
+
+            guard.lock();
+            section->done = true;
+            changed.notify_all();
+        }
+    };
+    vector<thread> threads;
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+
+    status_t err = NO_ERROR;
+    for (size_t i = 0; i < sections.size() && err == NO_ERROR; i++) {
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&]() { return buffered[i]->done; });
+        }
+        err = execute_section(sections[i], metadata, reportByteSize, buffered[i].get());
+        buffered[i].reset();
+
+        scoped_lock<mutex> guard(lock);
+        written = i + 1;
+        stopped = err != NO_ERROR;
+        changed.notify_all();
+    }
+
+    // After a fatal error, the sections that already started are left to finish, and dropped.
+    for (thread& t : threads) {
+        t.join();
+    }
+    return err;
+}
+
 status_t Reporter::execute_section(const Section* section, IncidentMetadata* metadata,
-        size_t* reportByteSize) {
+        size_t* reportByteSize, const BufferedSection* buffered) {
     const int sectionId = section->id;
 
     // If nobody wants this section, skip it.
@@ -722,7 +862,15 @@ status_t Reporter::execute_section(const Section* section, IncidentMetadata* met
 
     // Go get the data and write it into the file descriptors.
     mWriter.startSection(sectionId);
-    status_t err = section->Execute(&mWriter);
+    status_t err;
+    if (buffered == nullptr) {
+        err = section->Execute(&mWriter);
+    } else {
+        err = mWriter.writeBufferedSection(buffered->writer);
+        if (buffered->err != NO_ERROR) {
+            err = buffered->err;
+        }
+    }
     mWriter.endSection(sectionMetadata);
 
     // Sections returning errors are fatal. Most errors should not be fatal.
@@ -17,6 +17,7 @@
 
 #include "incidentd_util.h"
 #include "FdBuffer.h"
+#include "Gzip.h"
 #include "WorkDirectory.h"
 
 #include "frameworks/base/core/proto/android/os/metadata.pb.h"
@@ -27,6 +28,7 @@
 #include <android/util/protobuf.h>
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -77,8 +79,7 @@ private:
     int mFd;
     bool mIsStreaming;
     status_t mStatus;
-    pid_t mZipPid;
-    Fpipe mZipPipe;
+    unique_ptr<GzipPipe> mZip;
 };
 
 // ================================================================================
@@ -192,6 +193,13 @@ private:
 class ReportWriter {
 public:
     ReportWriter(const sp<ReportBatch>& batch);
+
+    /**
+     * Creates a writer that keeps the section in memory instead of writing it to the
+     * requests, so that the section can be run on a worker thread and written out later
+     * with writeBufferedSection.
+     */
+    ReportWriter();
     ~ReportWriter();
 
     void setPersistedFile(sp<ReportFile> file);
@@ -207,6 +215,17 @@ public:
 
     status_t writeSection(const FdBuffer& buffer);
 
+    /**
+     * Marks the end of the execution of a section that was kept in memory.
+     */
+    void finishBufferedSection();
+
+    /**
+     * Takes the stats and errors of a section that the given writer kept in memory, and
+     * writes its data to the requests.
+     */
+    status_t writeBufferedSection(const ReportWriter& buffered);
+
 private:
     // Data about all requests
     sp<ReportBatch> mBatch;
@@ -232,6 +251,18 @@ private:
      */
     int64_t mSectionStartTimeMs;
 
+    /**
+     * The time that the current section finished executing, if it was kept in memory and
+     * written later, or -1.
+     */
+    int64_t mSectionEndTimeMs;
+
+    /**
+     * The data of the current section, when this writer keeps it in memory.
+     */
+    bool mBuffering;
+    unique_ptr<FdBuffer> mBufferedData;
+
     /**
      * The last section that setSectionStats was called for, so if someone misses
      * it we can log that.
@@ -244,6 +275,7 @@ private:
      */
     int32_t mDumpSizeBytes;
     int64_t mDumpDurationMs;
+    size_t mDumpSplicedBytes;
     bool mSectionTimedOut;
     bool mSectionTruncated;
     bool mSectionBufferSuccess;
@@ -274,9 +306,19 @@ private:
     sp<ReportFile> mPersistedFile;
     const vector<BringYourOwnSection*>& mRegisteredSections;
 
-    status_t execute_section(const Section* section, IncidentMetadata* metadata,
+    // A section that was run on a worker thread and waits to be written out in order.
+    struct BufferedSection {
+        ReportWriter writer;
+        status_t err = NO_ERROR;
+        bool done = false;
+    };
+
+    status_t execute_sections(const vector<const Section*>& sections, IncidentMetadata* metadata,
         size_t* reportByteSize);
 
+    status_t execute_section(const Section* section, IncidentMetadata* metadata,
+        size_t* reportByteSize, const BufferedSection* buffered = nullptr);
+
     void cancel_and_remove_failed_requests();
 };
 
@@ -20,6 +20,8 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <thread>
@@ -38,6 +40,7 @@
 #include <sys/mman.h>
 
 #include "FdBuffer.h"
+#include "Parsers.h"
 #include "Privacy.h"
 #include "frameworks/base/core/proto/android/os/backtrace.proto.h"
 #include "frameworks/base/core/proto/android/os/data.proto.h"
@@ -57,13 +60,103 @@ const int FIELD_ID_INCIDENT_METADATA = 2;
 
 // incident section parameters
 const char INCIDENT_HELPER[] = "/system/bin/incident_helper";
-const char* GZIP[] = {"/system/bin/gzip", NULL};
-
 static pid_t fork_execute_incident_helper(const int id, Fpipe* p2cPipe, Fpipe* c2pPipe) {
     const char* ihArgs[]{INCIDENT_HELPER, "-s", String8::format("%d", id).string(), NULL};
     return fork_execute_cmd(const_cast<char**>(ihArgs), p2cPipe, c2pPipe);
 }
 
+void sigpipe_handler(int signum);
+
+/**
+ * Parses the text of a section into its proto with the incident_helper parsers. They are linked
+ * into incidentd and run on a worker thread, which saves forking a process and copying the data
+ * through it for every section. The forked /system/bin/incident_helper is kept as a fallback:
+ * it runs in its own, more restricted, domain, and it can be killed. It is used for the test
+ * parsers, whose ids are up to 1, and for every section when
+ * persist.incidentd.parse_in_process is false.
+ */
+class IncidentHelper {
+public:
+    explicit IncidentHelper(int id);
+
+    /**
+     * Starts parsing what is written to input into output. The helper takes the read end of
+     * input and the write end of output.
+     */
+    bool start(Fpipe* input, Fpipe* output);
+
+    /**
+     * Stops the helper after the section failed. A worker thread can't be killed, it stops on
+     * its own once the section closed its ends of the pipes.
+     */
+    void kill();
+
+    /**
+     * Waits for the helper and returns whether it parsed successfully.
+     */
+    status_t wait();
+
+private:
+    // Shared with the worker thread, which outlives the section when it times out.
+    struct State {
+        std::mutex lock;
+        std::condition_variable done;
+        bool finished = false;
+        status_t err = NO_ERROR;
+    };
+
+    const int mId;
+    pid_t mPid;
+    std::shared_ptr<State> mState;
+};
+
+IncidentHelper::IncidentHelper(int id) : mId(id), mPid(-1), mState() {}
+
+bool IncidentHelper::start(Fpipe* input, Fpipe* output) {
+    if (mId <= 1 || !GetBoolProperty("persist.incidentd.parse_in_process", true)) {
+        mPid = fork_execute_incident_helper(mId, input, output);
+        return mPid != -1;
+    }
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    mState = state;
+    std::thread([id = mId, state, in = std::move(input->readFd()),
+                 out = std::move(output->writeFd())]() mutable {
+        // Don't crash the service if writing to a closed pipe (may happen if reading times out)
+        signal(SIGPIPE, sigpipe_handler);
+        std::unique_ptr<TextParserBase> parser(selectParser(id));
+        status_t err = parser->Parse(in.get(), out.get());
+        // Closing out is the eof that the section reads up to, as from the child process.
+        in.reset();
+        out.reset();
+        std::unique_lock<std::mutex> lock(state->lock);
+        state->finished = true;
+        state->err = err;
+        state->done.notify_all();
+    }).detach();
+    return true;
+}
+
+void IncidentHelper::kill() {
+    if (mPid != -1) {
+        kill_child(mPid);
+    }
+}
+
+status_t IncidentHelper::wait() {
+    if (mState == nullptr) {
+        return wait_child(mPid);
+    }
+    // The output is read up to eof, so the parser is done or about to be. Give it as long as
+    // wait_child gives the child process.
+    std::unique_lock<std::mutex> lock(mState->lock);
+    if (!mState->done.wait_for(lock, std::chrono::seconds(1),
+                               [this] { return mState->finished; })) {
+        return TIMED_OUT;
+    }
+    return mState->err;
+}
+
 bool section_requires_specific_mention(int sectionId) {
     switch (sectionId) {
         case 3025: // restricted_images
@@ -114,8 +207,8 @@ status_t FileSection::Execute(ReportWriter* writer) const {
         return -errno;
     }
 
-    pid_t pid = fork_execute_incident_helper(this->id, &p2cPipe, &c2pPipe);
-    if (pid == -1) {
+    IncidentHelper helper(this->id);
+    if (!helper.start(&p2cPipe, &c2pPipe)) {
         ALOGW("[%s] failed to fork", this->name.string());
         return -errno;
     }
@@ -129,13 +222,13 @@ status_t FileSection::Execute(ReportWriter* writer) const {
     if (readStatus != NO_ERROR || buffer.timedOut()) {
         ALOGW("[%s] failed to read data from incident helper: %s, timedout: %s",
               this->name.string(), strerror(-readStatus), buffer.timedOut() ? "true" : "false");
-        kill_child(pid);
+        helper.kill();
         return readStatus;
     }
 
-    status_t ihStatus = wait_child(pid);
+    status_t ihStatus = helper.wait();
     if (ihStatus != NO_ERROR) {
-        ALOGW("[%s] abnormal child process: %s", this->name.string(), strerror(-ihStatus));
+        ALOGW("[%s] abnormal incident helper: %s", this->name.string(), strerror(-ihStatus));
         return OK; // Not a fatal error.
     }
 
@@ -173,20 +266,6 @@ status_t GZipSection::Execute(ReportWriter* writer) const {
         return NO_ERROR;  // e.g. LAST_KMSG will reach here in user build.
     }
     FdBuffer buffer;
-    Fpipe p2cPipe;
-    Fpipe c2pPipe;
-    // initiate pipes to pass data to/from gzip
-    if (!p2cPipe.init() || !c2pPipe.init()) {
-        ALOGW("[%s] failed to setup pipes", this->name.string());
-        return -errno;
-    }
-
-    pid_t pid = fork_execute_cmd((char* const*)GZIP, &p2cPipe, &c2pPipe);
-    if (pid == -1) {
-        ALOGW("[%s] failed to fork", this->name.string());
-        return -errno;
-    }
-    // parent process
 
     // construct Fdbuffer to output GZippedfileProto, the reason to do this instead of using
     // ProtoOutputStream is to avoid allocation of another buffer inside ProtoOutputStream.
@@ -204,22 +283,14 @@ status_t GZipSection::Execute(ReportWriter* writer) const {
     size_t dataBeginAt = internalBuffer->wp()->pos();
     VLOG("[%s] editPos=%zu, dataBeginAt=%zu", this->name.string(), editPos, dataBeginAt);
 
-    status_t readStatus = buffer.readProcessedDataInStream(
-            fd.get(), std::move(p2cPipe.writeFd()), std::move(c2pPipe.readFd()), this->timeoutMs,
-            isSysfs(mFilenames[index]));
+    // The file is compressed in process as it is read, instead of through a gzip child.
+    status_t readStatus = buffer.readGzipped(fd.get(), this->timeoutMs);
     writer->setSectionStats(buffer);
     if (readStatus != NO_ERROR || buffer.timedOut()) {
-        ALOGW("[%s] failed to read data from gzip: %s, timedout: %s", this->name.string(),
+        ALOGW("[%s] failed to gzip data: %s, timedout: %s", this->name.string(),
               strerror(-readStatus), buffer.timedOut() ? "true" : "false");
-        kill_child(pid);
         return readStatus;
     }
-
-    status_t gzipStatus = wait_child(pid);
-    if (gzipStatus != NO_ERROR) {
-        ALOGW("[%s] abnormal child process: %s", this->name.string(), strerror(-gzipStatus));
-        return gzipStatus;
-    }
     // Revisit the actual size from gzip result and edit the internal buffer accordingly.
     size_t dataSize = buffer.size() - dataBeginAt;
     internalBuffer->wp()->rewind()->move(editPos);
@@ -369,9 +440,10 @@ status_t CommandSection::Execute(ReportWriter* writer) const {
         ALOGW("[%s] failed to fork", this->name.string());
         return -errno;
     }
-    pid_t ihPid = fork_execute_incident_helper(this->id, &cmdPipe, &ihPipe);
-    if (ihPid == -1) {
+    IncidentHelper helper(this->id);
+    if (!helper.start(&cmdPipe, &ihPipe)) {
         ALOGW("[%s] failed to fork", this->name.string());
+        kill_child(cmdPid);
         return -errno;
     }
 
@@ -383,14 +455,14 @@ status_t CommandSection::Execute(ReportWriter* writer) const {
         ALOGW("[%s] failed to read data from incident helper: %s, timedout: %s",
               this->name.string(), strerror(-readStatus), buffer.timedOut() ? "true" : "false");
         kill_child(cmdPid);
-        kill_child(ihPid);
+        helper.kill();
         return readStatus;
     }
 
     // Waiting for command here has one trade-off: the failed status of command won't be detected
     // until buffer timeout, but it has advatage on starting the data stream earlier.
     status_t cmdStatus = wait_child(cmdPid);
-    status_t ihStatus = wait_child(ihPid);
+    status_t ihStatus = helper.wait();
     if (cmdStatus != NO_ERROR || ihStatus != NO_ERROR) {
         ALOGW("[%s] abnormal child processes, return status: command: %s, incident helper: %s",
               this->name.string(), strerror(-cmdStatus), strerror(-ihStatus));
@@ -523,6 +595,7 @@ status_t TextDumpsysSection::Execute(ReportWriter* writer) const {
 // ================================================================================
 // initialization only once in Section.cpp.
 map<log_id_t, log_time> LogSection::gLastLogsRetrieved;
+std::mutex LogSection::gLogSectionLock;
 
 LogSection::LogSection(int id, const char* logID, ...) : WorkerThreadSection(id), mLogMode(logModeBase) {
     name = "logcat -b ";
@@ -577,6 +650,8 @@ static inline int32_t get4LE(uint8_t const* src) {
 status_t LogSection::BlockingCall(unique_fd& pipeWriteFd) const {
     // heap profile shows that liblog malloc & free significant amount of memory in this process.
     // Hence forking a new process to prevent memory fragmentation.
+    // Log sections run one at a time, so each child forks from a settled gLastLogsRetrieved.
+    std::lock_guard<std::mutex> lock(gLogSectionLock);
     pid_t pid = fork();
     if (pid < 0) {
         ALOGW("[%s] failed to fork", this->name.string());
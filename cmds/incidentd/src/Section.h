@@ -22,6 +22,7 @@
 
 #include <stdarg.h>
 #include <map>
+#include <mutex>
 
 #include <android/os/IIncidentDumpCallback.h>
 #include <log/log_read.h>
@@ -163,6 +164,9 @@ private:
 class LogSection : public WorkerThreadSection {
     // global last log retrieved timestamp for each log_id_t.
     static map<log_id_t, log_time> gLastLogsRetrieved;
+    // Held while a log section runs, so that sections running on parallel report workers
+    // read and update gLastLogsRetrieved one at a time.
+    static std::mutex gLogSectionLock;
 
     // log mode: non blocking.
     const static int logModeBase = ANDROID_LOG_NONBLOCK;
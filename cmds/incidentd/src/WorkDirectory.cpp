@@ -16,6 +16,7 @@
 
 #include "Log.h"
 
+#include "Gzip.h"
 #include "incidentd_util.h"
 #include "proto_util.h"
 #include "PrivacyFilter.h"
@@ -68,8 +69,6 @@ const ComponentName DROPBOX_SENTINEL("android", "DROPBOX");
 /** metadata field id in IncidentProto */
 const int FIELD_ID_INCIDENT_METADATA = 2;
 
-// Args for exec gzip
-static const char* GZIP[] = {"/system/bin/gzip", NULL};
 
 /**
  * Read a protobuf from disk into the message.
@@ -218,26 +217,17 @@ void log_envelope(const ReportFileProto& envelope) {
 }
 
 // ================================================================================
-struct WorkDirectoryEntry {
-    WorkDirectoryEntry();
-    explicit WorkDirectoryEntry(const WorkDirectoryEntry& that);
-    ~WorkDirectoryEntry();
-
-    string envelope;
-    string data;
-    int64_t timestampNs;
-    off_t size;
-};
-
 WorkDirectoryEntry::WorkDirectoryEntry()
         :envelope(),
          data(),
+         timestampNs(0),
          size(0) {
 }
 
 WorkDirectoryEntry::WorkDirectoryEntry(const WorkDirectoryEntry& that)
         :envelope(that.envelope),
          data(that.data),
+         timestampNs(that.timestampNs),
          size(that.size) {
 }
 
@@ -424,24 +414,15 @@ status_t ReportFile::startFilteringData(int writeFd, const IncidentReportArgs& a
         return BAD_VALUE;
     }
 
-    pid_t zipPid = 0;
+    GzipPipe zip;
     if (args.gzip()) {
-        Fpipe zipPipe;
-        if (!zipPipe.init()) {
+        status_t err = zip.start(unique_fd(writeFd));
+        if (err != NO_ERROR) {
             ALOGE("[ReportFile] Failed to setup pipe for gzip");
-            close(writeFd);
             close(dataFd);
-            return -errno;
-        }
-        int status = 0;
-        zipPid = fork_execute_cmd((char* const*)GZIP, zipPipe.readFd().release(), writeFd, &status);
-        close(writeFd);
-        close(dataFd);
-        if (zipPid < 0 || status != 0) {
-            ALOGE("[ReportFile] Failed to fork and exec gzip");
-            return status;
+            return err;
         }
-        writeFd = zipPipe.writeFd().release();
+        writeFd = zip.writeFd();
     }
 
     status_t err;
@@ -463,15 +444,16 @@ status_t ReportFile::startFilteringData(int writeFd, const IncidentReportArgs& a
                 strerror(-err));
     }
 
-    close(writeFd);
     close(dataFd);
-    if (zipPid > 0) {
-        status_t err = wait_child(zipPid, /* timeout_ms= */ 10 * 1000);
+    if (args.gzip()) {
+        // Closes writeFd, which the worker compressing into the original one reads from.
+        status_t err = zip.finish(/* timeoutMs= */ 10 * 1000);
         if (err != 0) {
-            ALOGE("[ReportFile] abnormal child process: %s", strerror(-err));
+            ALOGE("[ReportFile] gzip failed: %s", strerror(-err));
         }
         return err;
     }
+    close(writeFd);
     return NO_ERROR;
 }
 
@@ -509,6 +491,9 @@ status_t ReportFile::save_envelope_impl(bool cleanup) {
         }
         return err;
     }
+    // The data file is closed, and its size recorded, before the envelope is saved.
+    mWorkDirectory->index_report(mTimestampNs, mEnvelopeFileName, mDataFileName,
+            mEnvelope.ByteSizeLong() + mEnvelope.data_file_size());
     return NO_ERROR;
 }
 
@@ -533,16 +518,20 @@ status_t ReportFile::load_envelope_impl(bool cleanup) {
 WorkDirectory::WorkDirectory()
         :mDirectory("/data/misc/incidents"),
          mMaxFileCount(100),
-         mMaxDiskUsageBytes(400 * 1024 * 1024) {  // Incident reports can take up to 400MB on disk.
+         mMaxDiskUsageBytes(400 * 1024 * 1024),  // Incident reports can take up to 400MB on disk.
                                                  // TODO: Should be a flag.
+         mIndexSize(0) {
     create_directory(mDirectory.c_str());
+    load_index();
 }
 
 WorkDirectory::WorkDirectory(const string& dir, int maxFileCount, long maxDiskUsageBytes)
         :mDirectory(dir),
          mMaxFileCount(maxFileCount),
-         mMaxDiskUsageBytes(maxDiskUsageBytes) {
+         mMaxDiskUsageBytes(maxDiskUsageBytes),
+         mIndexSize(0) {
     create_directory(mDirectory.c_str());
+    load_index();
 }
 
 sp<ReportFile> WorkDirectory::createReportFile() {
@@ -575,16 +564,12 @@ status_t WorkDirectory::getReports(vector<sp<ReportFile>>* result, int64_t after
         ALOGD("WorkDirectory::getReports");
     }
 
-    map<string,WorkDirectoryEntry> files;
-    get_directory_contents_locked(&files, after);
-    for (map<string,WorkDirectoryEntry>::iterator it = files.begin();
-            it != files.end(); it++) {
-        sp<ReportFile> reportFile = new ReportFile(this, it->second.timestampNs,
-                it->second.envelope, it->second.data);
-        if (DBG) {
-            ALOGD("  %s", reportFile->getId().c_str());
+    const size_t first = result->size();
+    get_reports_locked(result, after);
+    if (DBG) {
+        for (size_t i = first; i < result->size(); i++) {
+            ALOGD("  %s", (*result)[i]->getId().c_str());
         }
-        result->push_back(reportFile);
     }
     return NO_ERROR;
 }
@@ -628,10 +613,8 @@ sp<ReportFile> WorkDirectory::getReport(const string& pkg, const string& cls, co
 
 bool WorkDirectory::hasMore(int64_t after) {
     unique_lock<mutex> lock(mLock);
-
-    map<string,WorkDirectoryEntry> files;
-    get_directory_contents_locked(&files, after);
-    return files.size() > 0;
+    unique_lock<mutex> indexLock(mIndexLock);
+    return mIndex.upper_bound(after) != mIndex.end();
 }
 
 void WorkDirectory::commit(const sp<ReportFile>& report, const string& pkg, const string& cls) {
@@ -654,14 +637,10 @@ void WorkDirectory::commitAll(const string& pkg) {
 
     unique_lock<mutex> lock(mLock);
 
-    map<string,WorkDirectoryEntry> files;
-    get_directory_contents_locked(&files, 0);
-
-    for (map<string,WorkDirectoryEntry>::iterator it = files.begin();
-            it != files.end(); it++) {
-        sp<ReportFile> reportFile = new ReportFile(this, it->second.timestampNs,
-                it->second.envelope, it->second.data);
+    vector<sp<ReportFile>> files;
+    get_reports_locked(&files, 0);
 
+    for (const sp<ReportFile>& reportFile : files) {
         err = reportFile->loadEnvelope();
         if (err != NO_ERROR) {
             continue;
@@ -679,6 +658,7 @@ void WorkDirectory::remove(const sp<ReportFile>& report) {
     if (DO_UNLINK) {
         unlink(report->getDataFileName().c_str());
         unlink(report->getEnvelopeFileName().c_str());
+        unindex_report(report->getTimestampNs());
     }
 }
 
@@ -801,36 +781,67 @@ off_t WorkDirectory::get_directory_contents_locked(map<string,WorkDirectoryEntry
     return totalSize;
 }
 
-void WorkDirectory::clean_directory_locked() {
-    DIR* dir;
-    struct dirent* entry;
-    struct stat st;
-
-    // Map of filename without extension to the entries about it.  Conveniently,
-    // this also keeps the list sorted by filename, which is a timestamp.
+void WorkDirectory::load_index() {
     map<string,WorkDirectoryEntry> files;
     off_t totalSize = get_directory_contents_locked(&files, 0);
     if (totalSize < 0) {
         return;
     }
-    int totalCount = files.size();
 
-    // Count or size is less than max, then we're done.
-    if (totalSize < mMaxDiskUsageBytes && totalCount < mMaxFileCount) {
+    unique_lock<mutex> indexLock(mIndexLock);
+    mIndex.clear();
+    mIndexSize = 0;
+    for (map<string,WorkDirectoryEntry>::const_iterator it = files.begin();
+            it != files.end(); it++) {
+        mIndex.emplace(it->second.timestampNs, it->second);
+        mIndexSize += it->second.size;
+    }
+}
+
+void WorkDirectory::index_report(int64_t timestampNs, const string& envelope,
+        const string& data, off_t size) {
+    unique_lock<mutex> indexLock(mIndexLock);
+    WorkDirectoryEntry& entry = mIndex[timestampNs];
+    mIndexSize += size - entry.size;
+    entry.envelope = envelope;
+    entry.data = data;
+    entry.timestampNs = timestampNs;
+    entry.size = size;
+}
+
+void WorkDirectory::unindex_report(int64_t timestampNs) {
+    unique_lock<mutex> indexLock(mIndexLock);
+    map<int64_t,WorkDirectoryEntry>::iterator it = mIndex.find(timestampNs);
+    if (it != mIndex.end()) {
+        mIndexSize -= it->second.size;
+        mIndex.erase(it);
+    }
+}
+
+void WorkDirectory::get_reports_locked(vector<sp<ReportFile>>* result, int64_t after) {
+    unique_lock<mutex> indexLock(mIndexLock);
+    for (map<int64_t,WorkDirectoryEntry>::const_iterator it = mIndex.upper_bound(after);
+            it != mIndex.end(); it++) {
+        result->push_back(new ReportFile(this, it->second.timestampNs,
+                it->second.envelope, it->second.data));
+    }
+}
+
+void WorkDirectory::clean_directory_locked() {
+    if (!DO_UNLINK) {
         return;
     }
 
-    // Remove files until we're under our limits.
-    if (DO_UNLINK) {
-        for (map<string, WorkDirectoryEntry>::const_iterator it = files.begin();
-                it != files.end() && (totalSize >= mMaxDiskUsageBytes
-                    || totalCount >= mMaxFileCount);
-                it++) {
-            unlink(it->second.envelope.c_str());
-            unlink(it->second.data.c_str());
-            totalSize -= it->second.size;
-            totalCount--;
-        }
+    // Remove the oldest reports until we're under our limits.  The index is
+    // sorted by timestamp, so they are at the front.
+    unique_lock<mutex> indexLock(mIndexLock);
+    while (!mIndex.empty() && (mIndexSize >= mMaxDiskUsageBytes
+                || (int)mIndex.size() >= mMaxFileCount)) {
+        map<int64_t,WorkDirectoryEntry>::iterator it = mIndex.begin();
+        unlink(it->second.envelope.c_str());
+        unlink(it->second.data.c_str());
+        mIndexSize -= it->second.size;
+        mIndex.erase(it);
     }
 }
 
@@ -840,6 +851,7 @@ void WorkDirectory::delete_files_for_report_if_necessary(const sp<ReportFile>& r
         if (DO_UNLINK) {
             unlink(report->getDataFileName().c_str());
             unlink(report->getEnvelopeFileName().c_str());
+            unindex_report(report->getTimestampNs());
         }
     }
 }
@@ -23,6 +23,7 @@
 
 #include <utils/RefBase.h>
 
+#include <map>
 #include <mutex>
 #include <string>
 
@@ -37,7 +38,20 @@ using namespace std;
 extern const ComponentName DROPBOX_SENTINEL;
 
 class WorkDirectory;
-struct WorkDirectoryEntry;
+
+/**
+ * The files of one report on disk, and their size.
+ */
+struct WorkDirectoryEntry {
+    WorkDirectoryEntry();
+    explicit WorkDirectoryEntry(const WorkDirectoryEntry& that);
+    ~WorkDirectoryEntry();
+
+    string envelope;
+    string data;
+    int64_t timestampNs;
+    off_t size;
+};
 
 void get_args_from_report(IncidentReportArgs* out, const ReportFileProto_Report& report);
 
@@ -193,6 +207,11 @@ private:
  * alive for the duration of all of the ReportFiles.  In the real
  * incidentd, WorkDirectory is a singleton.  In tests, it may
  * have a shorter duration.
+ *
+ * The directory is scanned once, when the WorkDirectory is made, into an index of the
+ * reports and their sizes.  After that the index is kept up to date as reports are saved
+ * and removed, so listing and cleaning don't go back to the disk.  Files changed behind
+ * incidentd's back are only picked up by the next scan, at the next start.
  */
 class WorkDirectory : public virtual RefBase {
 public:
@@ -252,6 +271,8 @@ public:
     void remove(const sp<ReportFile>& report);
     
 private:
+    friend class ReportFile;
+
     string mDirectory;
     int mMaxFileCount;
     long mMaxDiskUsageBytes;
@@ -260,9 +281,22 @@ private:
     // the directory consistent.
     mutex mLock;
 
+    // Held while using the index.  ReportFiles update it while saving their envelope,
+    // which may happen with mLock held, so this is always taken after mLock.
+    mutex mIndexLock;
+
+    // The reports in the directory by timestamp, and the sum of their sizes.
+    map<int64_t,WorkDirectoryEntry> mIndex;
+    off_t mIndexSize;
+
     int64_t make_timestamp_ns_locked();
     bool file_exists_locked(int64_t timestampNs);    
     off_t get_directory_contents_locked(map<string,WorkDirectoryEntry>* files, int64_t after);
+    void load_index();
+    void index_report(int64_t timestampNs, const string& envelope, const string& data,
+            off_t size);
+    void unindex_report(int64_t timestampNs);
+    void get_reports_locked(vector<sp<ReportFile>>* result, int64_t after);
     void clean_directory_locked();
     void delete_files_for_report_if_necessary(const sp<ReportFile>& report);
 
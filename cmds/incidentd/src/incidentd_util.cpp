@@ -67,8 +67,12 @@ void return_buffer_to_pool(sp<EncodedBuffer> buffer) {
 }
 
 void clear_buffer_pool() {
-    std::scoped_lock<std::mutex> lock(gBufferPoolLock);
-    gBufferPool.clear();
+    {
+        std::scoped_lock<std::mutex> lock(gBufferPoolLock);
+        gBufferPool.clear();
+    }
+    // The released buffers leave their chunks in the protoutil pool, which is unmapped too.
+    EncodedBuffer::clearChunkPool();
 }
 
 // ================================================================================
@@ -173,6 +173,39 @@ TEST_F(FdBufferTest, ReadInStreamAndWrite) {
     }
 }
 
+TEST_F(FdBufferTest, ReadInStreamSplicesFile) {
+    // Larger than the pipe, so the input is spliced in several parts.
+    std::string testdata(256 * 1024, 'x');
+    for (size_t i = 0; i < testdata.size(); i += 97) {
+        testdata[i] = 'a' + (i % 26);
+    }
+    ASSERT_TRUE(WriteStringToFile(testdata, tf.path));
+
+    int pid = fork();
+    ASSERT_TRUE(pid != -1);
+
+    if (pid == 0) {
+        p2cPipe.writeFd().reset();
+        c2pPipe.readFd().reset();
+        ASSERT_TRUE(DoDataStream(p2cPipe.readFd(), c2pPipe.writeFd()));
+        p2cPipe.readFd().reset();
+        c2pPipe.writeFd().reset();
+        // Must exit here otherwise the child process will continue executing the test binary.
+        _exit(EXIT_SUCCESS);
+    } else {
+        p2cPipe.readFd().reset();
+        c2pPipe.writeFd().reset();
+
+        ASSERT_EQ(NO_ERROR,
+                  buffer.readProcessedDataInStream(tf.fd, std::move(p2cPipe.writeFd()),
+                                                   std::move(c2pPipe.readFd()), READ_TIMEOUT));
+        AssertBufferReadSuccessful(testdata.size());
+        AssertBufferContent(testdata.c_str());
+        EXPECT_EQ(testdata.size(), buffer.splicedBytes());
+        wait(&pid);
+    }
+}
+
 TEST_F(FdBufferTest, ReadInStreamAndWriteAllAtOnce) {
     std::string testdata = "child process flushes only after all data are read.";
     std::string expected = HEAD + testdata;
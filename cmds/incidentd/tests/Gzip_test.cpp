@@ -0,0 +1,112 @@
+// Copyright (C) 2023 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#define DEBUG false
+#include "Log.h"
+
+#include "FdBuffer.h"
+#include "Gzip.h"
+
+#include <fcntl.h>
+#include <zlib.h>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+using namespace android;
+using namespace android::base;
+using namespace android::os::incidentd;
+
+// Some text that compresses, long enough to take several buffers of output.
+static std::string MakeData() {
+    std::string data;
+    for (int i = 0; i < 20000; i++) {
+        data += "line " + std::to_string(i * 7919 % 1000) + "\n";
+    }
+    return data;
+}
+
+static std::string Gunzip(const std::string& gzipped) {
+    z_stream stream = {};
+    EXPECT_EQ(inflateInit2(&stream, MAX_WBITS + 16), Z_OK);
+    stream.next_in = (Bytef*)gzipped.data();
+    stream.avail_in = gzipped.size();
+    std::string out;
+    char buf[4096];
+    int ret;
+    do {
+        stream.next_out = (Bytef*)buf;
+        stream.avail_out = sizeof(buf);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - stream.avail_out);
+    } while (ret == Z_OK);
+    EXPECT_EQ(ret, Z_STREAM_END);
+    inflateEnd(&stream);
+    return out;
+}
+
+TEST(GzipTest, CompressorWritesGzip) {
+    const std::string data = MakeData();
+    std::string gzipped;
+    GzipCompressor::Sink sink = [&](uint8_t const* buf, size_t size) {
+        gzipped.append((const char*)buf, size);
+        return NO_ERROR;
+    };
+
+    GzipCompressor compressor;
+    // Feed it in uneven pieces.
+    for (size_t pos = 0; pos < data.size(); pos += 1000) {
+        ASSERT_EQ(NO_ERROR, compressor.write((uint8_t const*)data.data() + pos,
+                                             std::min<size_t>(1000, data.size() - pos), sink));
+    }
+    ASSERT_EQ(NO_ERROR, compressor.finish(sink));
+
+    EXPECT_LT(gzipped.size(), data.size());
+    EXPECT_EQ(Gunzip(gzipped), data);
+}
+
+TEST(GzipTest, PipeCompressesIntoFd) {
+    const std::string data = MakeData();
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+
+    GzipPipe zip;
+    ASSERT_EQ(NO_ERROR, zip.start(unique_fd(dup(tf.fd))));
+    EXPECT_TRUE(zip.ok());
+    ASSERT_TRUE(WriteFully(zip.writeFd(), data.data(), data.size()));
+    ASSERT_EQ(NO_ERROR, zip.finish(/* timeoutMs= */ 5 * 1000));
+
+    std::string gzipped;
+    ASSERT_TRUE(ReadFileToString(tf.path, &gzipped));
+    EXPECT_EQ(Gunzip(gzipped), data);
+}
+
+TEST(GzipTest, FdBufferReadGzipped) {
+    const std::string data = MakeData();
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(data, tf.path));
+
+    unique_fd fd(open(tf.path, O_RDONLY | O_CLOEXEC));
+    FdBuffer buffer;
+    ASSERT_EQ(NO_ERROR, buffer.readGzipped(fd.get(), /* timeoutMs= */ 5 * 1000));
+    EXPECT_FALSE(buffer.timedOut());
+    EXPECT_FALSE(buffer.truncated());
+
+    std::string gzipped;
+    sp<ProtoReader> reader = buffer.data()->read();
+    while (reader->hasNext()) {
+        gzipped.push_back(reader->next());
+    }
+    EXPECT_EQ(Gunzip(gzipped), data);
+}
@@ -300,3 +300,54 @@ TEST_F(PrivacyFilterTest, AutoMessage) {
 }
 
 #endif
+
+class TestFilterFd : public FilterFd {
+public:
+    TestFilterFd(uint8_t privacyPolicy, int fd) : FilterFd(privacyPolicy, fd), error(NO_ERROR) {}
+
+    virtual void onWriteError(status_t err) { error = err; }
+
+    status_t error;
+};
+
+TEST(PrivacyFilterWriteDataTest, WritesEachPolicy) {
+    Privacy field1{1, OTHER_TYPE, NULL, PRIVACY_POLICY_LOCAL, NULL};
+    Privacy field2{2, STRING_TYPE, NULL, PRIVACY_POLICY_EXPLICIT, NULL};
+    Privacy field4{4, OTHER_TYPE, NULL, PRIVACY_POLICY_AUTOMATIC, NULL};
+    Privacy* children[] = {&field1, &field2, &field4, NULL};
+    Privacy section{1, MESSAGE_TYPE, children, PRIVACY_POLICY_UNSET, NULL};
+
+    const std::string data = VARINT_FIELD_1 + STRING_FIELD_2 + FIX32_FIELD_4;
+    FdBuffer buffer;
+    ASSERT_EQ(NO_ERROR, buffer.write(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+
+    // Two outputs share the explicit policy, to check that both get the stripped data.
+    TemporaryFile local, explicit1, explicit2, automatic;
+    std::vector<sp<TestFilterFd>> outputs = {
+            new TestFilterFd(PRIVACY_POLICY_AUTOMATIC, automatic.fd),
+            new TestFilterFd(PRIVACY_POLICY_EXPLICIT, explicit1.fd),
+            new TestFilterFd(PRIVACY_POLICY_LOCAL, local.fd),
+            new TestFilterFd(PRIVACY_POLICY_EXPLICIT, explicit2.fd),
+    };
+    PrivacyFilter filter(1, &section);
+    for (const sp<TestFilterFd>& output : outputs) {
+        filter.addFd(output);
+    }
+    size_t maxSize = 0;
+    ASSERT_EQ(NO_ERROR, filter.writeData(buffer, PRIVACY_POLICY_LOCAL, &maxSize));
+    EXPECT_EQ(data.size(), maxSize);
+    for (const sp<TestFilterFd>& output : outputs) {
+        EXPECT_EQ(NO_ERROR, output->error);
+    }
+
+    const std::string explicitData = STRING_FIELD_2 + FIX32_FIELD_4;
+    std::string content;
+    ASSERT_TRUE(ReadFileToString(local.path, &content));
+    EXPECT_THAT(content, StrEq("\x0a" + std::string(1, data.size()) + data));
+    ASSERT_TRUE(ReadFileToString(explicit1.path, &content));
+    EXPECT_THAT(content, StrEq("\x0a" + std::string(1, explicitData.size()) + explicitData));
+    ASSERT_TRUE(ReadFileToString(explicit2.path, &content));
+    EXPECT_THAT(content, StrEq("\x0a" + std::string(1, explicitData.size()) + explicitData));
+    ASSERT_TRUE(ReadFileToString(automatic.path, &content));
+    EXPECT_THAT(content, StrEq("\x0a" + std::string(1, FIX32_FIELD_4.size()) + FIX32_FIELD_4));
+}
@@ -21,6 +21,7 @@
 
 #include <dirent.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <android-base/file.h>
 #include <gmock/gmock.h>
@@ -149,6 +150,38 @@ TEST_F(ReporterTest, IncidentReportArgs) {
     ASSERT_TRUE(args1.containsSection(3, false));
 }
 
+TEST_F(ReporterTest, RunReportWritesSectionsInOrder) {
+    TemporaryFile tf;
+    IncidentReportArgs args;
+    args.addSection(1);
+    args.addSection(2);
+    args.setPrivacyPolicy(android::os::PRIVACY_POLICY_LOCAL);
+
+    sp<WorkDirectory> workDirectory = new WorkDirectory(td.path, 10, 1024 * 1024);
+    sp<ReportBatch> batch = new ReportBatch();
+    // The request closes its fd when the report is done.
+    batch->addStreamingReport(args, listener, dup(tf.fd));
+    vector<BringYourOwnSection*> registeredSections;
+    sp<Reporter> reporter = new Reporter(workDirectory, batch, registeredSections);
+    reporter->runReport(&size);
+
+    // The sections run on several threads, but are written in the order of SECTION_LIST,
+    // each as a message field numbered with the section id.
+    string result;
+    ASSERT_TRUE(ReadFileToString(tf.path, &result));
+    ASSERT_GT(result.size(), 2UL);
+    EXPECT_EQ('\x0a', result[0]);
+    size_t second = 2 + static_cast<uint8_t>(result[1]);
+    ASSERT_LT(second, result.size());
+    EXPECT_EQ('\x12', result[second]);
+
+    EXPECT_EQ(1, listener->sectionStarted(1));
+    EXPECT_EQ(1, listener->sectionFinished(1));
+    EXPECT_EQ(1, listener->sectionStarted(2));
+    EXPECT_EQ(1, listener->sectionFinished(2));
+    EXPECT_EQ(1, listener->finishInvoked);
+}
+
 /*
 TEST_F(ReporterTest, RunReportEmpty) {
     vector<sp<ReportRequest>> requests;
@@ -0,0 +1,142 @@
+// Copyright (C) 2023 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#define DEBUG false
+#include "Log.h"
+
+#include "WorkDirectory.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+using namespace android;
+using namespace android::base;
+using namespace android::os;
+using namespace android::os::incidentd;
+using namespace std;
+
+namespace {
+
+// Counts the files in the directory, to check what is on disk besides the index.
+int count_files(const char* directory) {
+    DIR* dir = opendir(directory);
+    if (dir == nullptr) {
+        return -1;
+    }
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+sp<ReportFile> create_report(const sp<WorkDirectory>& workDirectory, const string& pkg) {
+    sp<ReportFile> file = workDirectory->createReportFile();
+    EXPECT_NE(nullptr, file);
+    if (file == nullptr) {
+        return nullptr;
+    }
+    IncidentReportArgs args;
+    args.setReceiverPkg(pkg);
+    args.setReceiverCls("Receiver");
+    file->addReport(args);
+    EXPECT_EQ(NO_ERROR, file->startWritingDataFile());
+    EXPECT_TRUE(WriteStringToFd("data", file->getDataFileFd()));
+    file->closeDataFile();
+    file->markCompleted();
+    EXPECT_EQ(NO_ERROR, file->saveEnvelope());
+    return file;
+}
+
+}  // namespace
+
+TEST(WorkDirectoryTest, GetReportsAfter) {
+    TemporaryDir td;
+    sp<WorkDirectory> workDirectory = new WorkDirectory(td.path, 10, 1024 * 1024);
+
+    sp<ReportFile> first = create_report(workDirectory, "pkg1");
+    sp<ReportFile> second = create_report(workDirectory, "pkg2");
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+
+    vector<sp<ReportFile>> files;
+    ASSERT_EQ(NO_ERROR, workDirectory->getReports(&files, 0));
+    ASSERT_EQ(2UL, files.size());
+    EXPECT_EQ(first->getTimestampNs(), files[0]->getTimestampNs());
+    EXPECT_EQ(second->getTimestampNs(), files[1]->getTimestampNs());
+
+    files.clear();
+    ASSERT_EQ(NO_ERROR, workDirectory->getReports(&files, first->getTimestampNs()));
+    ASSERT_EQ(1UL, files.size());
+    EXPECT_EQ(second->getTimestampNs(), files[0]->getTimestampNs());
+
+    EXPECT_TRUE(workDirectory->hasMore(first->getTimestampNs()));
+    EXPECT_FALSE(workDirectory->hasMore(second->getTimestampNs()));
+}
+
+TEST(WorkDirectoryTest, CommitRemovesFromIndex) {
+    TemporaryDir td;
+    sp<WorkDirectory> workDirectory = new WorkDirectory(td.path, 10, 1024 * 1024);
+
+    sp<ReportFile> file = create_report(workDirectory, "pkg1");
+    ASSERT_NE(nullptr, file);
+    workDirectory->commit(file, "pkg1", "Receiver");
+
+    EXPECT_FALSE(workDirectory->hasMore(0));
+    EXPECT_EQ(0, count_files(td.path));
+}
+
+TEST(WorkDirectoryTest, CleanRemovesOldestReports) {
+    TemporaryDir td;
+    sp<WorkDirectory> workDirectory = new WorkDirectory(td.path, 2, 1024 * 1024);
+
+    sp<ReportFile> first = create_report(workDirectory, "pkg1");
+    sp<ReportFile> second = create_report(workDirectory, "pkg2");
+    // Making the third removes the first, so that there are fewer than 2 before it.
+    sp<ReportFile> third = create_report(workDirectory, "pkg3");
+    ASSERT_NE(nullptr, third);
+
+    vector<sp<ReportFile>> files;
+    ASSERT_EQ(NO_ERROR, workDirectory->getReports(&files, 0));
+    ASSERT_EQ(2UL, files.size());
+    EXPECT_EQ(second->getTimestampNs(), files[0]->getTimestampNs());
+    EXPECT_EQ(third->getTimestampNs(), files[1]->getTimestampNs());
+    EXPECT_EQ(4, count_files(td.path));
+}
+
+TEST(WorkDirectoryTest, IndexIsRebuiltFromDisk) {
+    TemporaryDir td;
+    int64_t timestampNs;
+    {
+        sp<WorkDirectory> workDirectory = new WorkDirectory(td.path, 10, 1024 * 1024);
+        sp<ReportFile> file = create_report(workDirectory, "pkg1");
+        ASSERT_NE(nullptr, file);
+        timestampNs = file->getTimestampNs();
+    }
+    // A data file without an envelope is deleted by the scan.
+    ASSERT_TRUE(WriteStringToFile("orphan", string(td.path) + "/00000000000000000001.data"));
+
+    sp<WorkDirectory> workDirectory = new WorkDirectory(td.path, 10, 1024 * 1024);
+    vector<sp<ReportFile>> files;
+    ASSERT_EQ(NO_ERROR, workDirectory->getReports(&files, 0));
+    ASSERT_EQ(1UL, files.size());
+    EXPECT_EQ(timestampNs, files[0]->getTimestampNs());
+    EXPECT_EQ(2, count_files(td.path));
+}
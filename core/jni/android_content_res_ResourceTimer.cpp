@@ -17,8 +17,11 @@
 #include <jni.h>
 #include <core_jni_helpers.h>
 #include <utils/misc.h>
+#include <android-base/properties.h>
 #include <androidfw/ResourceTimer.h>
 
+#include <climits>
+
 namespace android {
 
 // ----------------------------------------------------------------------------
@@ -80,8 +83,12 @@ static jstring counterName(JNIEnv *env, int counter) {
   return env->NewStringUTF(s);
 }
 
+// One in this many resource calls of each thread is timed.  The counts pulled by the java layer
+// are of the timed calls only.
+static const char* const kSampleIntervalProperty = "persist.sys.resource_timer.sample_interval";
+
 static int NativeEnableTimers(JNIEnv* env, jobject /*clazz*/, jobject config) {
-  ResourceTimer::enable();
+  ResourceTimer::enable(base::GetIntProperty(kSampleIntervalProperty, 1, 1, INT_MAX));
 
   env->SetIntField(config, gConfigOffsets.maxTimer, ResourceTimer::counterSize);
   env->SetIntField(config, gConfigOffsets.maxBuckets, 4);       // Number of ints in PValues
@@ -438,6 +438,123 @@ static jdouble nativeGetDouble(JNIEnv* env, jclass clazz, jlong windowPtr,
     }
 }
 
+template <typename T, typename ArrayT>
+static void copyNumericColumn(JNIEnv* env, CursorWindow* window, jint column, jint startRow,
+        jint numRows, ArrayT valuesObj, const char* typeName,
+        status_t (CursorWindow::*getColumn)(uint32_t, uint32_t, uint32_t, T*)) {
+    if (startRow < 0 || numRows < 0 || column < 0) {
+        throwExceptionWithRowCol(env, startRow, column);
+        return;
+    }
+    if (env->GetArrayLength(valuesObj) < numRows) {
+        jniThrowException(env, "java/lang/ArrayIndexOutOfBoundsException",
+                "Array too small for the requested rows");
+        return;
+    }
+
+    T* values = static_cast<T*>(env->GetPrimitiveArrayCritical(valuesObj, NULL));
+    if (!values) {
+        return; // OOM exception already thrown
+    }
+    status_t status = (window->*getColumn)(column, startRow, numRows, values);
+    env->ReleasePrimitiveArrayCritical(valuesObj, values, 0);
+
+    if (status == BAD_VALUE) {
+        throwExceptionWithRowCol(env, startRow, column);
+    } else if (status != OK) {
+        String8 msg;
+        msg.appendFormat("Unable to convert BLOB to %s", typeName);
+        throw_sqlite3_exception(env, msg.string());
+    }
+}
+
+static void nativeGetLongColumn(JNIEnv* env, jclass clazz, jlong windowPtr,
+        jint column, jint startRow, jint numRows, jlongArray valuesObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting %d longs for column %d from row %d of %p", numRows, column, startRow,
+            window);
+
+    copyNumericColumn<int64_t>(env, window, column, startRow, numRows, valuesObj, "long",
+            &CursorWindow::getLongColumn);
+}
+
+static void nativeGetDoubleColumn(JNIEnv* env, jclass clazz, jlong windowPtr,
+        jint column, jint startRow, jint numRows, jdoubleArray valuesObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Getting %d doubles for column %d from row %d of %p", numRows, column, startRow,
+            window);
+
+    copyNumericColumn<double>(env, window, column, startRow, numRows, valuesObj, "double",
+            &CursorWindow::getDoubleColumn);
+}
+
+static bool checkRowsInWindow(JNIEnv* env, CursorWindow* window, jint startRow, jint numRows,
+        jint startColumn, jint numColumns) {
+    if (startRow < 0 || numRows < 0 || startColumn < 0 || numColumns < 0
+            || uint32_t(startRow) + uint32_t(numRows) > window->getNumRows()
+            || uint32_t(startColumn) + uint32_t(numColumns) > window->getNumColumns()) {
+        throwExceptionWithRowCol(env, startRow, startColumn);
+        return false;
+    }
+    return true;
+}
+
+static void nativeCopyRows(JNIEnv* env, jclass clazz, jlong windowPtr,
+        jint startRow, jint numRows, jint startColumn, jint numColumns,
+        jintArray typesObj, jlongArray longsObj, jdoubleArray doublesObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Copying %dx%d fields at %d,%d from %p", numRows, numColumns, startRow,
+            startColumn, window);
+
+    if (!checkRowsInWindow(env, window, startRow, numRows, startColumn, numColumns)) {
+        return;
+    }
+    const jsize count = numRows * numColumns;
+    if (env->GetArrayLength(typesObj) < count
+            || (longsObj && env->GetArrayLength(longsObj) < count)
+            || (doublesObj && env->GetArrayLength(doublesObj) < count)) {
+        jniThrowException(env, "java/lang/ArrayIndexOutOfBoundsException",
+                "Array too small for the requested fields");
+        return;
+    }
+
+    jint* types = static_cast<jint*>(env->GetPrimitiveArrayCritical(typesObj, NULL));
+    jlong* longs = longsObj && types
+            ? static_cast<jlong*>(env->GetPrimitiveArrayCritical(longsObj, NULL)) : NULL;
+    jdouble* doubles = doublesObj && types && (longs || !longsObj)
+            ? static_cast<jdouble*>(env->GetPrimitiveArrayCritical(doublesObj, NULL)) : NULL;
+    const bool ok = types && (longs || !longsObj) && (doubles || !doublesObj);
+    if (ok) {
+        window->copyRows(startRow, numRows, startColumn, numColumns, types, longs, doubles);
+    }
+    if (doubles) env->ReleasePrimitiveArrayCritical(doublesObj, doubles, 0);
+    if (longs) env->ReleasePrimitiveArrayCritical(longsObj, longs, 0);
+    if (types) env->ReleasePrimitiveArrayCritical(typesObj, types, 0);
+    // If !ok, an OOM exception has already been thrown.
+}
+
+static void nativeCopyRowsToBuffer(JNIEnv* env, jclass clazz, jlong windowPtr,
+        jint startRow, jint numRows, jint startColumn, jint numColumns, jobject bufferObj) {
+    CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
+    LOG_WINDOW("Copying %dx%d fields at %d,%d from %p to a buffer", numRows, numColumns,
+            startRow, startColumn, window);
+
+    if (!checkRowsInWindow(env, window, startRow, numRows, startColumn, numColumns)) {
+        return;
+    }
+    void* buffer = env->GetDirectBufferAddress(bufferObj);
+    jlong capacity = env->GetDirectBufferCapacity(bufferObj);
+    if (!buffer || capacity < 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "The buffer must be a direct ByteBuffer");
+        return;
+    }
+    if (window->copyRowsToBuffer(startRow, numRows, startColumn, numColumns, buffer,
+            size_t(capacity)) != OK) {
+        jniThrowException(env, "java/nio/BufferOverflowException", NULL);
+    }
+}
+
 static jboolean nativePutBlob(JNIEnv* env, jclass clazz, jlong windowPtr,
         jbyteArray valueObj, jint row, jint column) {
     CursorWindow* window = reinterpret_cast<CursorWindow*>(windowPtr);
@@ -540,6 +657,14 @@ static const JNINativeMethod sMethods[] =
             (void*)nativeGetString },
     { "nativeCopyStringToBuffer", "(JIILandroid/database/CharArrayBuffer;)V",
             (void*)nativeCopyStringToBuffer },
+    { "nativeGetLongColumn", "(JIII[J)V",
+            (void*)nativeGetLongColumn },
+    { "nativeGetDoubleColumn", "(JIII[D)V",
+            (void*)nativeGetDoubleColumn },
+    { "nativeCopyRows", "(JIIII[I[J[D)V",
+            (void*)nativeCopyRows },
+    { "nativeCopyRowsToBuffer", "(JIIIILjava/nio/ByteBuffer;)V",
+            (void*)nativeCopyRowsToBuffer },
     { "nativePutBlob", "(J[BII)Z",
             (void*)nativePutBlob },
     { "nativePutString", "(JLjava/lang/String;II)Z",
@@ -29,8 +29,11 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <android-base/logging.h>
@@ -51,7 +54,9 @@
 #include <memtrack/memtrack.h>
 #include <memunreachable/memunreachable.h>
 #include <android-base/strings.h>
+#include <android-base/unique_fd.h>
 #include "android_os_Debug.h"
+#include "core_jni_helpers.h"
 #include <vintf/VintfObject.h>
 
 namespace android
@@ -240,22 +245,189 @@ static int read_memtrack_memory(int pid, struct graphics_memory_pss* graphics_me
     return err;
 }
 
+// A VMA of /proc/pid/smaps. Its name is only valid until the callback returns.
+struct smaps_vma {
+    uint64_t start;
+    uint64_t end;
+    std::string_view name;
+    meminfo::MemUsage usage;
+};
+
+// Large enough for the lines of the biggest VMAs, and to read smaps in a few calls.
+static constexpr size_t kSmapsBufferSize = 64 * 1024;
+
+static bool parse_hex(std::string_view* s, uint64_t* out)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+    for (; i < s->size(); i++) {
+        const char c = (*s)[i];
+        if (c >= '0' && c <= '9') {
+            value = (value << 4) | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value = (value << 4) | (c - 'a' + 10);
+        } else {
+            break;
+        }
+    }
+    s->remove_prefix(i);
+    *out = value;
+    return i > 0;
+}
+
+static void skip_field(std::string_view* s)
+{
+    size_t end = s->find_first_of(" \t");
+    s->remove_prefix(end == std::string_view::npos ? s->size() : end);
+    end = s->find_first_not_of(" \t");
+    s->remove_prefix(end == std::string_view::npos ? s->size() : end);
+}
+
+// Parses "   1234 kB".
+static uint64_t parse_kb(std::string_view s)
+{
+    uint64_t value = 0;
+    size_t i = s.find_first_not_of(' ');
+    for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++) {
+        value = value * 10 + (s[i] - '0');
+    }
+    return value;
+}
+
+// Parses a "start-end perms offset dev inode name" line of smaps.
+static bool parse_smaps_header(std::string_view line, smaps_vma* vma, std::string* name)
+{
+    if (!parse_hex(&line, &vma->start) || line.empty() || line[0] != '-') {
+        return false;
+    }
+    line.remove_prefix(1);
+    if (!parse_hex(&line, &vma->end)) {
+        return false;
+    }
+    skip_field(&line);  // the separator after the end
+    for (int i = 0; i < 4; i++) {
+        skip_field(&line);  // perms, offset, dev and inode
+    }
+    // The line is overwritten by the next read(), so the name is kept aside. Its capacity is
+    // reused, which leaves a copy but no allocation per VMA.
+    name->assign(line);
+    vma->name = *name;
+    vma->usage = {};
+    return true;
+}
+
+static void parse_smaps_field(std::string_view line, meminfo::MemUsage* usage)
+{
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+        return;
+    }
+    const std::string_view key = line.substr(0, colon);
+    uint64_t* field = nullptr;
+    if (key == "Rss") {
+        field = &usage->rss;
+    } else if (key == "Pss") {
+        field = &usage->pss;
+    } else if (key == "Shared_Clean") {
+        field = &usage->shared_clean;
+    } else if (key == "Shared_Dirty") {
+        field = &usage->shared_dirty;
+    } else if (key == "Private_Clean") {
+        field = &usage->private_clean;
+    } else if (key == "Private_Dirty") {
+        field = &usage->private_dirty;
+    } else if (key == "Swap") {
+        field = &usage->swap;
+    } else if (key == "SwapPss") {
+        field = &usage->swap_pss;
+    } else {
+        return;
+    }
+    *field = parse_kb(line.substr(colon + 1));
+    usage->uss = usage->private_clean + usage->private_dirty;
+}
+
+/*
+ * Calls callback for each VMA of /proc/pid/smaps. The file is read in large chunks into one
+ * buffer and its lines are parsed in place, instead of a getline() and a std::string per line
+ * as with meminfo::ForEachVmaFromFile(), which takes hundreds of ms for large processes.
+ */
+template <typename Callback>
+static bool for_each_smaps_vma(int pid, Callback&& callback)
+{
+    std::string smaps_path = base::StringPrintf("/proc/%d/smaps", pid);
+    base::unique_fd fd(TEMP_FAILURE_RETRY(open(smaps_path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd == -1) {
+        return false;
+    }
+
+    std::unique_ptr<char[]> buffer(new char[kSmapsBufferSize]);
+    size_t size = 0;
+    smaps_vma vma = {};
+    std::string name;
+    bool has_vma = false;
+    bool eof = false;
+    while (!eof) {
+        ssize_t n = TEMP_FAILURE_RETRY(read(fd, buffer.get() + size, kSmapsBufferSize - size));
+        if (n == -1) {
+            return false;
+        }
+        eof = n == 0;
+        size += n;
+
+        const std::string_view data(buffer.get(), size);
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t end = data.find('\n', pos);
+            if (end == std::string_view::npos) {
+                if (!eof) {
+                    break;
+                }
+                end = data.size();
+            }
+            const std::string_view line = data.substr(pos, end - pos);
+            pos = std::min(end + 1, data.size());
+
+            // The header of a VMA starts with its hexadecimal start address, and its fields
+            // with a capitalized name.
+            const char c = line.empty() ? '\0' : line[0];
+            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')) {
+                if (has_vma) {
+                    callback(vma);
+                }
+                has_vma = parse_smaps_header(line, &vma, &name);
+            } else if (has_vma) {
+                parse_smaps_field(line, &vma.usage);
+            }
+        }
+
+        // Keep the partial last line for the next read().
+        size -= pos;
+        memmove(buffer.get(), buffer.get() + pos, size);
+        if (size == kSmapsBufferSize) {
+            ALOGE("Line too long in %s", smaps_path.c_str());
+            return false;
+        }
+    }
+    if (has_vma) {
+        callback(vma);
+    }
+    return true;
+}
+
 static bool load_maps(int pid, stats_t* stats, bool* foundSwapPss)
 {
     *foundSwapPss = false;
     uint64_t prev_end = 0;
     int prev_heap = HEAP_UNKNOWN;
 
-    std::string smaps_path = base::StringPrintf("/proc/%d/smaps", pid);
-    auto vma_scan = [&](const meminfo::Vma& vma) {
+    auto vma_scan = [&](const smaps_vma& vma) {
         int which_heap = HEAP_UNKNOWN;
         int sub_heap = HEAP_UNKNOWN;
         bool is_swappable = false;
-        std::string name;
-        if (base::EndsWith(vma.name, " (deleted)")) {
-            name = vma.name.substr(0, vma.name.size() - strlen(" (deleted)"));
-        } else {
-            name = vma.name;
+        std::string_view name = vma.name;
+        if (base::EndsWith(name, " (deleted)")) {
+            name.remove_suffix(strlen(" (deleted)"));
         }
 
         uint32_t namesz = name.size();
@@ -284,16 +456,16 @@ static bool load_maps(int pid, stats_t* stats, bool* foundSwapPss)
             which_heap = HEAP_TTF;
             is_swappable = true;
         } else if ((base::EndsWith(name, ".odex")) ||
-                (namesz > 4 && strstr(name.c_str(), ".dex") != nullptr)) {
+                (namesz > 4 && name.find(".dex") != std::string_view::npos)) {
             which_heap = HEAP_DEX;
             sub_heap = HEAP_DEX_APP_DEX;
             is_swappable = true;
         } else if (base::EndsWith(name, ".vdex")) {
             which_heap = HEAP_DEX;
             // Handle system@framework@boot and system/framework/boot|apex
-            if ((strstr(name.c_str(), "@boot") != nullptr) ||
-                    (strstr(name.c_str(), "/boot") != nullptr) ||
-                    (strstr(name.c_str(), "/apex") != nullptr)) {
+            if ((name.find("@boot") != std::string_view::npos) ||
+                    (name.find("/boot") != std::string_view::npos) ||
+                    (name.find("/apex") != std::string_view::npos)) {
                 sub_heap = HEAP_DEX_BOOT_VDEX;
             } else {
                 sub_heap = HEAP_DEX_APP_VDEX;
@@ -305,9 +477,9 @@ static bool load_maps(int pid, stats_t* stats, bool* foundSwapPss)
         } else if (base::EndsWith(name, ".art") || base::EndsWith(name, ".art]")) {
             which_heap = HEAP_ART;
             // Handle system@framework@boot* and system/framework/boot|apex*
-            if ((strstr(name.c_str(), "@boot") != nullptr) ||
-                    (strstr(name.c_str(), "/boot") != nullptr) ||
-                    (strstr(name.c_str(), "/apex") != nullptr)) {
+            if ((name.find("@boot") != std::string_view::npos) ||
+                    (name.find("/boot") != std::string_view::npos) ||
+                    (name.find("/apex") != std::string_view::npos)) {
                 sub_heap = HEAP_ART_BOOT;
             } else {
                 sub_heap = HEAP_ART_APP;
@@ -412,7 +584,7 @@ static bool load_maps(int pid, stats_t* stats, bool* foundSwapPss)
         }
     };
 
-    return meminfo::ForEachVmaFromFile(smaps_path, vma_scan);
+    return for_each_smaps_vma(pid, vma_scan);
 }
 
 static jboolean android_os_Debug_getDirtyPagesPid(JNIEnv *env, jobject clazz,
@@ -494,32 +666,62 @@ static void android_os_Debug_getDirtyPages(JNIEnv *env, jobject clazz, jobject o
     android_os_Debug_getDirtyPagesPid(env, clazz, getpid(), object);
 }
 
-static jlong android_os_Debug_getPssPid(JNIEnv *env, jobject clazz, jint pid,
-        jlongArray outUssSwapPssRss, jlongArray outMemtrack)
-{
-    jlong pss = 0;
-    jlong rss = 0;
-    jlong swapPss = 0;
-    jlong uss = 0;
-    jlong memtrack = 0;
-
+// The totals of a process, from /proc/pid/smaps_rollup, or from smaps on older kernels.
+struct pss_totals {
+    jlong pss;
+    jlong uss;
+    jlong swapPss;
+    jlong rss;
+    jlong memtrack;
     struct graphics_memory_pss graphics_mem;
-    if (read_memtrack_memory(pid, &graphics_mem) == 0) {
-        pss = uss = rss = memtrack = graphics_mem.graphics + graphics_mem.gl + graphics_mem.other;
+};
+
+static bool read_pss_totals(struct memtrack_proc* p, int pid, pss_totals* totals)
+{
+    memset(totals, 0, sizeof(*totals));
+    if (p != NULL && read_memtrack_memory(p, pid, &totals->graphics_mem) == 0) {
+        const struct graphics_memory_pss& graphics_mem = totals->graphics_mem;
+        totals->memtrack = graphics_mem.graphics + graphics_mem.gl + graphics_mem.other;
+        totals->pss = totals->uss = totals->rss = totals->memtrack;
     }
 
     ::android::meminfo::ProcMemInfo proc_mem(pid);
     ::android::meminfo::MemUsage stats;
-    if (proc_mem.SmapsOrRollup(&stats)) {
-        pss += stats.pss;
-        uss += stats.uss;
-        rss += stats.rss;
-        swapPss = stats.swap_pss;
-        pss += swapPss; // Also in swap, those pages would be accounted as Pss without SWAP
-    } else {
+    if (!proc_mem.SmapsOrRollup(&stats)) {
+        return false;
+    }
+    totals->pss += stats.pss;
+    totals->uss += stats.uss;
+    totals->rss += stats.rss;
+    totals->swapPss = stats.swap_pss;
+    // Also in swap, those pages would be accounted as Pss without SWAP
+    totals->pss += stats.swap_pss;
+    return true;
+}
+
+static jlong android_os_Debug_getPssPid(JNIEnv *env, jobject clazz, jint pid,
+        jlongArray outUssSwapPssRss, jlongArray outMemtrack)
+{
+    struct memtrack_proc* p = memtrack_proc_new();
+    if (p == NULL) {
+        ALOGW("failed to create memtrack_proc");
+    }
+    pss_totals totals;
+    bool found = read_pss_totals(p, pid, &totals);
+    if (p != NULL) {
+        memtrack_proc_destroy(p);
+    }
+    if (!found) {
         return 0;
     }
 
+    const jlong pss = totals.pss;
+    const jlong uss = totals.uss;
+    const jlong swapPss = totals.swapPss;
+    const jlong rss = totals.rss;
+    const jlong memtrack = totals.memtrack;
+    const struct graphics_memory_pss& graphics_mem = totals.graphics_mem;
+
     if (outUssSwapPssRss != NULL) {
         int outLen = env->GetArrayLength(outUssSwapPssRss);
         if (outLen >= 1) {
@@ -565,6 +767,55 @@ static jlong android_os_Debug_getPss(JNIEnv *env, jobject clazz)
     return android_os_Debug_getPssPid(env, clazz, getpid(), NULL, NULL);
 }
 
+// The values getPssPids() returns for each pid, in order.
+enum {
+    PSS_PIDS_PSS,
+    PSS_PIDS_USS,
+    PSS_PIDS_SWAP_PSS,
+    PSS_PIDS_RSS,
+    PSS_PIDS_MEMTRACK,
+    PSS_PIDS_COUNT
+};
+
+/*
+ * The totals of getPss(int, long[], long[]) for each of pids, in one call and with one memtrack
+ * client. out holds PSS_PIDS_COUNT values per pid; those of the pids that are gone are 0.
+ */
+static void android_os_Debug_getPssPids(JNIEnv *env, jobject clazz, jintArray pids,
+        jlongArray out)
+{
+    if (pids == NULL || out == NULL) {
+        jniThrowNullPointerException(env, "pids == null || out == null");
+        return;
+    }
+    const jsize count = env->GetArrayLength(pids);
+    if (env->GetArrayLength(out) < count * PSS_PIDS_COUNT) {
+        jniThrowRuntimeException(env, "outLen < pids.length * PSS_PIDS_COUNT");
+        return;
+    }
+
+    std::vector<jint> pidValues(count);
+    env->GetIntArrayRegion(pids, 0, count, pidValues.data());
+    std::vector<jlong> values(count * PSS_PIDS_COUNT);
+    struct memtrack_proc* p = memtrack_proc_new();
+    for (jsize i = 0; i < count; i++) {
+        pss_totals totals;
+        if (!read_pss_totals(p, pidValues[i], &totals)) {
+            continue;
+        }
+        jlong* pidOut = &values[i * PSS_PIDS_COUNT];
+        pidOut[PSS_PIDS_PSS] = totals.pss;
+        pidOut[PSS_PIDS_USS] = totals.uss;
+        pidOut[PSS_PIDS_SWAP_PSS] = totals.swapPss;
+        pidOut[PSS_PIDS_RSS] = totals.rss;
+        pidOut[PSS_PIDS_MEMTRACK] = totals.memtrack;
+    }
+    if (p != NULL) {
+        memtrack_proc_destroy(p);
+    }
+    env->SetLongArrayRegion(out, 0, values.size(), values.data());
+}
+
 // The 1:1 mapping of MEMINFO_* enums here must match with the constants from
 // Debug.java.
 enum {
@@ -686,6 +937,9 @@ static jint android_os_getBinderReceivedTransactions(JNIEnv *env, jobject clazz)
 jint android_os_Debug_getLocalObjectCount(JNIEnv* env, jobject clazz);
 jint android_os_Debug_getProxyObjectCount(JNIEnv* env, jobject clazz);
 jint android_os_Debug_getDeathObjectCount(JNIEnv* env, jobject clazz);
+jlong android_os_Debug_getProxyCacheHitCount(JNIEnv* env, jobject clazz);
+jlong android_os_Debug_getProxyCacheMissCount(JNIEnv* env, jobject clazz);
+jlong android_os_Debug_getProxyCacheLockWaitNanos(JNIEnv* env, jobject clazz);
 
 static bool openFile(JNIEnv* env, jobject fileDescriptor, UniqueFile& fp)
 {
@@ -1032,6 +1286,18 @@ static const JNINativeMethod gMethods[] = {
             (void*)android_os_Debug_isVmapStack },
 };
 
+// Registered only if Debug declares them.
+static const JNINativeMethod gOptionalMethods[] = {
+    { "getBinderProxyCacheHitCount", "()J",
+            (void*)android_os_Debug_getProxyCacheHitCount },
+    { "getBinderProxyCacheMissCount", "()J",
+            (void*)android_os_Debug_getProxyCacheMissCount },
+    { "getBinderProxyCacheLockWaitNanos", "()J",
+            (void*)android_os_Debug_getProxyCacheLockWaitNanos },
+    { "getPssPids",             "([I[J)V",
+            (void*) android_os_Debug_getPssPids },
+};
+
 int register_android_os_Debug(JNIEnv *env)
 {
     jclass clazz = env->FindClass("android/os/Debug$MemoryInfo");
@@ -1073,7 +1339,9 @@ int register_android_os_Debug(JNIEnv *env)
                 env->GetFieldID(clazz, stat_field_names[i].swappedOutPss_name, "I");
     }
 
-    return jniRegisterNativeMethods(env, "android/os/Debug", gMethods, NELEM(gMethods));
+    int res = jniRegisterNativeMethods(env, "android/os/Debug", gMethods, NELEM(gMethods));
+    RegisterOptionalMethods(env, "android/os/Debug", gOptionalMethods, NELEM(gOptionalMethods));
+    return res;
 }
 
 }; // namespace android
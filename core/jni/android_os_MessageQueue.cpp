@@ -23,6 +23,8 @@
 #include <utils/Log.h>
 #include "android_os_MessageQueue.h"
 
+#include <vector>
+
 #include "core_jni_helpers.h"
 
 namespace android {
@@ -30,6 +32,8 @@ namespace android {
 static struct {
     jfieldID mPtr;   // native object attached to the DVM MessageQueue
     jmethodID dispatchEvents;
+    // Null unless MessageQueue implements dispatchEventsBatch().
+    jmethodID dispatchEventsBatch;
 } gMessageQueueClassInfo;
 
 // Must be kept in sync with the constants in Looper.FileDescriptorCallback
@@ -51,6 +55,8 @@ public:
 
     virtual int handleEvent(int fd, int events, void* data);
 
+    void dispatchPendingFdEvents();
+
     /**
      * A simple proxy that holds a weak reference to a looper callback.
      */
@@ -67,9 +73,17 @@ public:
     };
 
 private:
+    // A file descriptor event of the current poll, not yet delivered to Java.
+    struct PendingFdEvent {
+        int fd;
+        int events;
+        int oldWatchedEvents;
+    };
+
     JNIEnv* mPollEnv;
     jobject mPollObj;
     jthrowable mExceptionObj;
+    std::vector<PendingFdEvent> mPendingFdEvents;
 };
 
 
@@ -123,6 +137,9 @@ void NativeMessageQueue::pollOnce(JNIEnv* env, jobject pollObj, int timeoutMilli
     mPollEnv = env;
     mPollObj = pollObj;
     mLooper->pollOnce(timeoutMillis);
+    if (!mPendingFdEvents.empty()) {
+        dispatchPendingFdEvents();
+    }
     mPollObj = NULL;
     mPollEnv = NULL;
 
@@ -166,17 +183,69 @@ int NativeMessageQueue::handleEvent(int fd, int looperEvents, void* data) {
         events |= CALLBACK_EVENT_ERROR;
     }
     int oldWatchedEvents = reinterpret_cast<intptr_t>(data);
-    int newWatchedEvents = mPollEnv->CallIntMethod(mPollObj,
-            gMessageQueueClassInfo.dispatchEvents, fd, events);
-    if (!newWatchedEvents) {
-        return 0; // unregister the fd
-    }
-    if (newWatchedEvents != oldWatchedEvents) {
-        setFileDescriptorEvents(fd, newWatchedEvents);
+    if (gMessageQueueClassInfo.dispatchEventsBatch == NULL) {
+        int newWatchedEvents = mPollEnv->CallIntMethod(mPollObj,
+                gMessageQueueClassInfo.dispatchEvents, fd, events);
+        if (!newWatchedEvents) {
+            return 0; // unregister the fd
+        }
+        if (newWatchedEvents != oldWatchedEvents) {
+            setFileDescriptorEvents(fd, newWatchedEvents);
+        }
+        return 1;
     }
+
+    // Delivered with the other events of this poll once the looper returns, so that Java is
+    // called once per poll rather than once per ready file descriptor. The fd stays registered
+    // until then.
+    mPendingFdEvents.push_back({fd, events, oldWatchedEvents});
     return 1;
 }
 
+void NativeMessageQueue::dispatchPendingFdEvents() {
+    JNIEnv* env = mPollEnv;
+    const size_t count = mPendingFdEvents.size();
+
+    // {fd, events} pairs, whose events MessageQueue.dispatchEventsBatch() replaces with the
+    // events to watch from now on, or 0 to unregister the fd.
+    std::vector<jint> fdEvents(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        fdEvents[i * 2] = mPendingFdEvents[i].fd;
+        fdEvents[i * 2 + 1] = mPendingFdEvents[i].events;
+    }
+    jintArray fdEventsArray = env->NewIntArray(fdEvents.size());
+    if (fdEventsArray != NULL) {
+        env->SetIntArrayRegion(fdEventsArray, 0, fdEvents.size(), fdEvents.data());
+        env->CallVoidMethod(mPollObj, gMessageQueueClassInfo.dispatchEventsBatch, fdEventsArray);
+    }
+    if (env->ExceptionCheck()) {
+        // Like a callback that throws from dispatchEvents(), unregisters the fds, since which
+        // of them threw is unknown, so that a level-triggered fd doesn't wake the looper again
+        // and again. The exception surfaces when nativePollOnce() returns.
+        if (fdEventsArray != NULL) {
+            env->DeleteLocalRef(fdEventsArray);
+        }
+        for (const PendingFdEvent& event : mPendingFdEvents) {
+            mLooper->removeFd(event.fd);
+        }
+        mPendingFdEvents.clear();
+        return;
+    }
+    env->GetIntArrayRegion(fdEventsArray, 0, fdEvents.size(), fdEvents.data());
+    env->DeleteLocalRef(fdEventsArray);
+
+    for (size_t i = 0; i < count; i++) {
+        const int fd = mPendingFdEvents[i].fd;
+        const int newWatchedEvents = fdEvents[i * 2 + 1];
+        if (!newWatchedEvents) {
+            mLooper->removeFd(fd);
+        } else if (newWatchedEvents != mPendingFdEvents[i].oldWatchedEvents) {
+            setFileDescriptorEvents(fd, newWatchedEvents);
+        }
+    }
+    mPendingFdEvents.clear();
+}
+
 
 // --- NativeMessageQueue::WeakLooperCallback ---
 
@@ -262,6 +331,12 @@ int register_android_os_MessageQueue(JNIEnv* env) {
     gMessageQueueClassInfo.mPtr = GetFieldIDOrDie(env, clazz, "mPtr", "J");
     gMessageQueueClassInfo.dispatchEvents = GetMethodIDOrDie(env, clazz,
             "dispatchEvents", "(II)I");
+    gMessageQueueClassInfo.dispatchEventsBatch = env->GetMethodID(clazz,
+            "dispatchEventsBatch", "([I)V");
+    if (gMessageQueueClassInfo.dispatchEventsBatch == NULL) {
+        // Events are delivered one fd at a time through dispatchEvents().
+        env->ExceptionClear();
+    }
 
     return res;
 }
@@ -259,6 +259,130 @@ static void android_os_Parcel_writeBlob(JNIEnv* env, jclass clazz, jlong nativeP
     blob.release();
 }
 
+// The JNI functions that copy a primitive array of type T from and to native memory.
+template <typename T>
+struct PrimitiveArrayTraits;
+
+template <>
+struct PrimitiveArrayTraits<jint> {
+    using ArrayType = jintArray;
+    static constexpr auto New = &JNIEnv::NewIntArray;
+    static constexpr auto GetRegion = &JNIEnv::GetIntArrayRegion;
+    static constexpr auto SetRegion = &JNIEnv::SetIntArrayRegion;
+};
+
+template <>
+struct PrimitiveArrayTraits<jlong> {
+    using ArrayType = jlongArray;
+    static constexpr auto New = &JNIEnv::NewLongArray;
+    static constexpr auto GetRegion = &JNIEnv::GetLongArrayRegion;
+    static constexpr auto SetRegion = &JNIEnv::SetLongArrayRegion;
+};
+
+template <>
+struct PrimitiveArrayTraits<jfloat> {
+    using ArrayType = jfloatArray;
+    static constexpr auto New = &JNIEnv::NewFloatArray;
+    static constexpr auto GetRegion = &JNIEnv::GetFloatArrayRegion;
+    static constexpr auto SetRegion = &JNIEnv::SetFloatArrayRegion;
+};
+
+template <>
+struct PrimitiveArrayTraits<jdouble> {
+    using ArrayType = jdoubleArray;
+    static constexpr auto New = &JNIEnv::NewDoubleArray;
+    static constexpr auto GetRegion = &JNIEnv::GetDoubleArrayRegion;
+    static constexpr auto SetRegion = &JNIEnv::SetDoubleArrayRegion;
+};
+
+// Writes the length of the array, followed by its elements in their natural size. This is what
+// Parcel.java writes one element at a time, so both can read what the other wrote; but the
+// elements are copied into the parcel data at once.
+template <typename T>
+static void writePrimitiveArray(JNIEnv* env, jclass clazz, jlong nativePtr, jobject data,
+                                jint offset, jint length)
+{
+    using Traits = PrimitiveArrayTraits<T>;
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return;
+    }
+
+    if (length < 0 || static_cast<size_t>(length) > INT32_MAX / sizeof(T)) {
+        signalExceptionForError(env, clazz, BAD_VALUE);
+        return;
+    }
+
+    const status_t err = parcel->writeInt32(length);
+    if (err != NO_ERROR) {
+        signalExceptionForError(env, clazz, err);
+        return;
+    }
+
+    void* dest = parcel->writeInplace(length * sizeof(T));
+    if (dest == NULL) {
+        signalExceptionForError(env, clazz, NO_MEMORY);
+        return;
+    }
+
+    (env->*Traits::GetRegion)(static_cast<typename Traits::ArrayType>(data), offset, length,
+                              static_cast<T*>(dest));
+}
+
+static void android_os_Parcel_writeIntArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                            jobject data, jint offset, jint length)
+{
+    writePrimitiveArray<jint>(env, clazz, nativePtr, data, offset, length);
+}
+
+static void android_os_Parcel_writeLongArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                             jobject data, jint offset, jint length)
+{
+    writePrimitiveArray<jlong>(env, clazz, nativePtr, data, offset, length);
+}
+
+static void android_os_Parcel_writeFloatArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                              jobject data, jint offset, jint length)
+{
+    writePrimitiveArray<jfloat>(env, clazz, nativePtr, data, offset, length);
+}
+
+static void android_os_Parcel_writeDoubleArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                               jobject data, jint offset, jint length)
+{
+    writePrimitiveArray<jdouble>(env, clazz, nativePtr, data, offset, length);
+}
+
+// Writes the bytes of a direct ByteBuffer like writeByteArray() does those of a byte[].
+static void android_os_Parcel_writeByteBuffer(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                              jobject buffer, jint offset, jint length)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return;
+    }
+
+    const jbyte* src = static_cast<const jbyte*>(env->GetDirectBufferAddress(buffer));
+    const jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (src == NULL || offset < 0 || length < 0 || offset > capacity - length) {
+        signalExceptionForError(env, clazz, BAD_VALUE);
+        return;
+    }
+
+    const status_t err = parcel->writeInt32(length);
+    if (err != NO_ERROR) {
+        signalExceptionForError(env, clazz, err);
+        return;
+    }
+
+    void* dest = parcel->writeInplace(length);
+    if (dest == NULL) {
+        signalExceptionForError(env, clazz, NO_MEMORY);
+        return;
+    }
+    memcpy(dest, src + offset, length);
+}
+
 static int android_os_Parcel_writeInt(jlong nativePtr, jint val) {
     Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
     return (parcel != NULL) ? parcel->writeInt32(val) : OK;
@@ -446,6 +570,125 @@ static jbyteArray android_os_Parcel_readBlob(JNIEnv* env, jclass clazz, jlong na
     return ret;
 }
 
+// Returns the elements of an array written by writePrimitiveArray(), or by Parcel.java,
+// in place in the parcel data. Returns NULL if there isn't such an array at the current
+// position, and sets |len| to its length, or -1 for a null array.
+template <typename T>
+static const T* readPrimitiveArrayInplace(Parcel* parcel, int32_t* len)
+{
+    *len = parcel->readInt32();
+    if (*len < 0 || static_cast<size_t>(*len) > parcel->dataAvail() / sizeof(T)) {
+        return NULL;
+    }
+    return static_cast<const T*>(parcel->readInplace(*len * sizeof(T)));
+}
+
+template <typename T>
+static jobject createPrimitiveArray(JNIEnv* env, jlong nativePtr)
+{
+    using Traits = PrimitiveArrayTraits<T>;
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return NULL;
+    }
+
+    int32_t len;
+    const T* data = readPrimitiveArrayInplace<T>(parcel, &len);
+    if (data == NULL) {
+        return NULL;
+    }
+    typename Traits::ArrayType ret = (env->*Traits::New)(len);
+    if (ret != NULL) {
+        (env->*Traits::SetRegion)(ret, 0, len, data);
+    }
+    return ret;
+}
+
+template <typename T>
+static jboolean readPrimitiveArray(JNIEnv* env, jlong nativePtr, jobject dest)
+{
+    using Traits = PrimitiveArrayTraits<T>;
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return JNI_FALSE;
+    }
+
+    int32_t len;
+    const T* data = readPrimitiveArrayInplace<T>(parcel, &len);
+    auto array = static_cast<typename Traits::ArrayType>(dest);
+    if (data == NULL || len != env->GetArrayLength(array)) {
+        return JNI_FALSE;
+    }
+    (env->*Traits::SetRegion)(array, 0, len, data);
+    return JNI_TRUE;
+}
+
+static jobject android_os_Parcel_createIntArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    return createPrimitiveArray<jint>(env, nativePtr);
+}
+
+static jobject android_os_Parcel_createLongArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    return createPrimitiveArray<jlong>(env, nativePtr);
+}
+
+static jobject android_os_Parcel_createFloatArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    return createPrimitiveArray<jfloat>(env, nativePtr);
+}
+
+static jobject android_os_Parcel_createDoubleArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    return createPrimitiveArray<jdouble>(env, nativePtr);
+}
+
+static jboolean android_os_Parcel_readIntArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                               jobject dest)
+{
+    return readPrimitiveArray<jint>(env, nativePtr, dest);
+}
+
+static jboolean android_os_Parcel_readLongArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                                jobject dest)
+{
+    return readPrimitiveArray<jlong>(env, nativePtr, dest);
+}
+
+static jboolean android_os_Parcel_readFloatArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                                 jobject dest)
+{
+    return readPrimitiveArray<jfloat>(env, nativePtr, dest);
+}
+
+static jboolean android_os_Parcel_readDoubleArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                                  jobject dest)
+{
+    return readPrimitiveArray<jdouble>(env, nativePtr, dest);
+}
+
+// Reads the bytes written by writeByteArray() into a direct ByteBuffer, which must have exactly
+// as many bytes after |offset| as were written.
+static jboolean android_os_Parcel_readByteBuffer(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                                 jobject buffer, jint offset)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return JNI_FALSE;
+    }
+
+    jbyte* dest = static_cast<jbyte*>(env->GetDirectBufferAddress(buffer));
+    const jlong capacity = env->GetDirectBufferCapacity(buffer);
+    int32_t len;
+    const jbyte* data = readPrimitiveArrayInplace<jbyte>(parcel, &len);
+    if (dest == NULL || data == NULL || offset < 0 || offset > capacity ||
+        len != capacity - offset) {
+        return JNI_FALSE;
+    }
+    memcpy(dest + offset, data, len);
+    return JNI_TRUE;
+}
+
 static jint android_os_Parcel_readInt(jlong nativePtr)
 {
     Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
@@ -901,6 +1144,24 @@ static const JNINativeMethod gParcelMethods[] = {
     {"nativeReplaceCallingWorkSourceUid", "(JI)Z", (void*)android_os_Parcel_replaceCallingWorkSourceUid},
 };
 
+// The bulk array transfers, registered only if Parcel declares them.
+static const JNINativeMethod gParcelArrayMethods[] = {
+    {"nativeWriteIntArray",       "(J[III)V", (void*)android_os_Parcel_writeIntArray},
+    {"nativeWriteLongArray",      "(J[JII)V", (void*)android_os_Parcel_writeLongArray},
+    {"nativeWriteFloatArray",     "(J[FII)V", (void*)android_os_Parcel_writeFloatArray},
+    {"nativeWriteDoubleArray",    "(J[DII)V", (void*)android_os_Parcel_writeDoubleArray},
+    {"nativeWriteByteBuffer",     "(JLjava/nio/ByteBuffer;II)V", (void*)android_os_Parcel_writeByteBuffer},
+    {"nativeCreateIntArray",      "(J)[I", (void*)android_os_Parcel_createIntArray},
+    {"nativeCreateLongArray",     "(J)[J", (void*)android_os_Parcel_createLongArray},
+    {"nativeCreateFloatArray",    "(J)[F", (void*)android_os_Parcel_createFloatArray},
+    {"nativeCreateDoubleArray",   "(J)[D", (void*)android_os_Parcel_createDoubleArray},
+    {"nativeReadIntArray",        "(J[I)Z", (void*)android_os_Parcel_readIntArray},
+    {"nativeReadLongArray",       "(J[J)Z", (void*)android_os_Parcel_readLongArray},
+    {"nativeReadFloatArray",      "(J[F)Z", (void*)android_os_Parcel_readFloatArray},
+    {"nativeReadDoubleArray",     "(J[D)Z", (void*)android_os_Parcel_readDoubleArray},
+    {"nativeReadByteBuffer",      "(JLjava/nio/ByteBuffer;I)Z", (void*)android_os_Parcel_readByteBuffer},
+};
+
 const char* const kParcelPathName = "android/os/Parcel";
 
 int register_android_os_Parcel(JNIEnv* env)
@@ -912,7 +1173,9 @@ int register_android_os_Parcel(JNIEnv* env)
     gParcelOffsets.obtain = GetStaticMethodIDOrDie(env, clazz, "obtain", "()Landroid/os/Parcel;");
     gParcelOffsets.recycle = GetMethodIDOrDie(env, clazz, "recycle", "()V");
 
-    return RegisterMethodsOrDie(env, kParcelPathName, gParcelMethods, NELEM(gParcelMethods));
+    int res = RegisterMethodsOrDie(env, kParcelPathName, gParcelMethods, NELEM(gParcelMethods));
+    RegisterOptionalMethods(env, kParcelPathName, gParcelArrayMethods, NELEM(gParcelArrayMethods));
+    return res;
 }
 
 };
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the ways android_os_Parcel.cpp can move primitive arrays: one element per call, as
+// Parcel.java does through nativeWriteInt() and nativeReadInt(), against one copy of all the
+// elements in place, as nativeWriteIntArray() and nativeCreateIntArray() do.
+
+#include <benchmark/benchmark.h>
+#include <binder/Parcel.h>
+
+#include <string.h>
+
+#include <vector>
+
+using android::Parcel;
+using android::status_t;
+
+template <typename T>
+static status_t writeElement(Parcel* parcel, T value);
+
+template <>
+status_t writeElement(Parcel* parcel, int32_t value) {
+    return parcel->writeInt32(value);
+}
+
+template <>
+status_t writeElement(Parcel* parcel, int64_t value) {
+    return parcel->writeInt64(value);
+}
+
+template <typename T>
+static T readElement(const Parcel& parcel);
+
+template <>
+int32_t readElement(const Parcel& parcel) {
+    return parcel.readInt32();
+}
+
+template <>
+int64_t readElement(const Parcel& parcel) {
+    return parcel.readInt64();
+}
+
+// Bulk copies all the elements at once, instead of one per call.
+constexpr bool kPerElement = false;
+constexpr bool kBulk = true;
+
+template <typename T>
+static void writeArray(Parcel* parcel, const std::vector<T>& values, bool bulk) {
+    parcel->writeInt32(values.size());
+    if (bulk) {
+        memcpy(parcel->writeInplace(values.size() * sizeof(T)), values.data(),
+               values.size() * sizeof(T));
+    } else {
+        for (T value : values) {
+            writeElement(parcel, value);
+        }
+    }
+}
+
+template <typename T, bool bulk>
+static void BM_WriteArray(benchmark::State& state) {
+    const std::vector<T> values(state.range(0), 42);
+    Parcel parcel;
+    for (auto _ : state) {
+        parcel.setDataSize(0);
+        writeArray(&parcel, values, bulk);
+        benchmark::DoNotOptimize(parcel.data());
+    }
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(T));
+}
+
+template <typename T, bool bulk>
+static void BM_ReadArray(benchmark::State& state) {
+    Parcel parcel;
+    writeArray(&parcel, std::vector<T>(state.range(0), 42), true);
+    std::vector<T> values(state.range(0));
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        const int32_t len = parcel.readInt32();
+        if (bulk) {
+            memcpy(values.data(), parcel.readInplace(len * sizeof(T)), len * sizeof(T));
+        } else {
+            for (int32_t i = 0; i < len; ++i) {
+                values[i] = readElement<T>(parcel);
+            }
+        }
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(T));
+}
+
+// From the small arrays of most AIDL calls to large ones such as lists of ids or timestamps.
+BENCHMARK_TEMPLATE(BM_WriteArray, int32_t, kPerElement)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_WriteArray, int32_t, kBulk)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_WriteArray, int64_t, kPerElement)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_WriteArray, int64_t, kBulk)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadArray, int32_t, kPerElement)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadArray, int32_t, kBulk)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadArray, int64_t, kPerElement)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_ReadArray, int64_t, kBulk)->Arg(16)->Arg(256)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -21,6 +21,12 @@
 #include <nativehelper/JNIHelp.h>
 
 #include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "core_jni_helpers.h"
 
 static constexpr const char* kNullReplacement = "(null)";
 
@@ -57,6 +63,55 @@ inline static void withString(JNIEnv* env, jstring jstr, F callback) {
     callback(buffer.data());
 }
 
+// Names that Trace.java interns once to trace them without converting a jstring on every call.
+// The table only grows, so that the id-based natives read it without locking.
+class InternedNames {
+public:
+    static constexpr jint kMaxNames = 4096;
+
+    // Returns the id of the sanitized |name|, or -1 once the table is full.
+    jint intern(const char* name) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mIds.find(name);
+        if (it != mIds.end()) {
+            return it->second;
+        }
+        const jint id = mCount.load(std::memory_order_relaxed);
+        if (id == kMaxNames) {
+            return -1;
+        }
+        auto inserted = mIds.emplace(name, id).first;
+        mNames[id] = inserted->first.c_str();
+        mCount.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    // Returns the name of |id|, or kNullReplacement if it isn't one.
+    const char* get(jint id) const {
+        if (CC_UNLIKELY(id < 0 || id >= mCount.load(std::memory_order_acquire))) {
+            return kNullReplacement;
+        }
+        return mNames[id];
+    }
+
+private:
+    std::mutex mLock;
+    // Node-based, so that the strings the table points into never move.
+    std::unordered_map<std::string, jint> mIds;
+    std::array<const char*, kMaxNames> mNames;
+    std::atomic<jint> mCount = 0;
+};
+
+static InternedNames gInternedNames;
+
+static jint android_os_Trace_nativeInternName(JNIEnv* env, jclass, jstring nameStr) {
+    jint id;
+    withString(env, nameStr, [&id](const char* str) {
+        id = gInternedNames.intern(str);
+    });
+    return id;
+}
+
 static void android_os_Trace_nativeTraceCounter(JNIEnv* env, jclass,
         jlong tag, jstring nameStr, jlong value) {
     withString(env, nameStr, [tag, value](const char* str) {
@@ -75,6 +130,18 @@ static void android_os_Trace_nativeTraceEnd(JNIEnv*, jclass, jlong tag) {
     atrace_end(tag);
 }
 
+static void android_os_Trace_nativeTraceCounterInterned(jlong tag, jint nameId, jlong value) {
+    atrace_int64(tag, gInternedNames.get(nameId), value);
+}
+
+static void android_os_Trace_nativeTraceBeginInterned(jlong tag, jint nameId) {
+    atrace_begin(tag, gInternedNames.get(nameId));
+}
+
+static void android_os_Trace_nativeInstantInterned(jlong tag, jint nameId) {
+    atrace_instant(tag, gInternedNames.get(nameId));
+}
+
 static void android_os_Trace_nativeAsyncTraceBegin(JNIEnv* env, jclass,
         jlong tag, jstring nameStr, jint cookie) {
     withString(env, nameStr, [tag, cookie](const char* str) {
@@ -174,10 +241,31 @@ static const JNINativeMethod gTraceMethods[] = {
             (void*)atrace_get_enabled_tags },
 };
 
+// Registered only if Trace declares them.
+static const JNINativeMethod gTraceInternedMethods[] = {
+    /* name, signature, funcPtr */
+    { "nativeInternName",
+            "(Ljava/lang/String;)I",
+            (void*)android_os_Trace_nativeInternName },
+
+    // ----------- @CriticalNative  ----------------
+    { "nativeTraceCounterInterned",
+            "(JIJ)V",
+            (void*)android_os_Trace_nativeTraceCounterInterned },
+    { "nativeTraceBeginInterned",
+            "(JI)V",
+            (void*)android_os_Trace_nativeTraceBeginInterned },
+    { "nativeInstantInterned",
+            "(JI)V",
+            (void*)android_os_Trace_nativeInstantInterned },
+};
+
 int register_android_os_Trace(JNIEnv* env) {
     int res = jniRegisterNativeMethods(env, "android/os/Trace",
             gTraceMethods, NELEM(gTraceMethods));
     LOG_ALWAYS_FATAL_IF(res < 0, "Unable to register native methods.");
+    RegisterOptionalMethods(env, "android/os/Trace", gTraceInternedMethods,
+                            NELEM(gTraceInternedMethods));
 
     return 0;
 }
@@ -30,6 +30,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "android-base/logging.h"
 #include "android-base/properties.h"
@@ -678,6 +679,72 @@ static jint NativeGetResourceValue(JNIEnv* env, jclass /*clazz*/, jlong ptr, jin
   return CopyValue(env, *value, typed_value);
 }
 
+// Looks up the values of all resources in `java_resids` at once, writing STYLE_NUM_ENTRIES ints
+// per resource into `out_java_values`. Resources that can't be found get a cookie of -1. Returns
+// the number of resources found, or -1 on error.
+static jint NativeGetResourceValues(JNIEnv* env, jclass /*clazz*/, jlong ptr,
+                                    jintArray java_resids, jshort density,
+                                    jintArray out_java_values, jboolean resolve_references) {
+  const jsize resids_len = env->GetArrayLength(java_resids);
+  const jsize out_values_len = env->GetArrayLength(out_java_values);
+  if (out_values_len < (resids_len * STYLE_NUM_ENTRIES)) {
+    jniThrowException(env, "java/lang/IndexOutOfBoundsException", "outValues too small");
+    return -1;
+  }
+
+  std::vector<uint32_t> resids(resids_len);
+  env->GetIntArrayRegion(java_resids, 0, resids_len, reinterpret_cast<jint*>(resids.data()));
+  if (env->ExceptionCheck()) {
+    return -1;
+  }
+
+  auto assetmanager = LockAndStartAssetManager(ptr);
+  ResourceTimer _timer(ResourceTimer::Counter::GetResourceValue);
+
+  std::vector<AssetManager2::SelectedValue> values(resids_len);
+  auto result = assetmanager->GetResources(resids, values, static_cast<uint16_t>(density));
+  if (!result.has_value()) {
+    return -1;
+  }
+
+  jint* out_values =
+      reinterpret_cast<jint*>(env->GetPrimitiveArrayCritical(out_java_values, nullptr));
+  if (out_values == nullptr) {
+    return -1;
+  }
+
+  jint found = 0;
+  jint* cursor = out_values;
+  for (AssetManager2::SelectedValue& value : values) {
+    if (value.cookie != kInvalidCookie && resolve_references &&
+        !assetmanager->ResolveReference(value).has_value()) {
+      value.cookie = kInvalidCookie;
+    }
+
+    if (value.cookie == kInvalidCookie) {
+      cursor[STYLE_TYPE] = static_cast<jint>(Res_value::TYPE_NULL);
+      cursor[STYLE_DATA] = static_cast<jint>(Res_value::DATA_NULL_UNDEFINED);
+      cursor[STYLE_ASSET_COOKIE] = ApkAssetsCookieToJavaCookie(kInvalidCookie);
+      cursor[STYLE_RESOURCE_ID] = 0;
+      cursor[STYLE_CHANGING_CONFIGURATIONS] = 0;
+      cursor[STYLE_DENSITY] = 0;
+      cursor[STYLE_SOURCE_RESOURCE_ID] = 0;
+    } else {
+      cursor[STYLE_TYPE] = static_cast<jint>(value.type);
+      cursor[STYLE_DATA] = static_cast<jint>(value.data);
+      cursor[STYLE_ASSET_COOKIE] = ApkAssetsCookieToJavaCookie(value.cookie);
+      cursor[STYLE_RESOURCE_ID] = static_cast<jint>(value.resid);
+      cursor[STYLE_CHANGING_CONFIGURATIONS] = static_cast<jint>(value.flags);
+      cursor[STYLE_DENSITY] = static_cast<jint>(value.config.density);
+      cursor[STYLE_SOURCE_RESOURCE_ID] = 0;
+      found++;
+    }
+    cursor += STYLE_NUM_ENTRIES;
+  }
+  env->ReleasePrimitiveArrayCritical(out_java_values, out_values, 0);
+  return found;
+}
+
 static jint NativeGetResourceBagValue(JNIEnv* env, jclass /*clazz*/, jlong ptr, jint resid,
                                       jint bag_entry_id, jobject typed_value) {
   auto assetmanager = LockAndStartAssetManager(ptr);
@@ -1514,6 +1581,7 @@ static const JNINativeMethod gAssetManagerMethods[] = {
 
     // AssetManager resource methods.
     {"nativeGetResourceValue", "(JISLandroid/util/TypedValue;Z)I", (void*)NativeGetResourceValue},
+    {"nativeGetResourceValues", "(J[IS[IZ)I", (void*)NativeGetResourceValues},
     {"nativeGetResourceBagValue", "(JIILandroid/util/TypedValue;)I",
      (void*)NativeGetResourceBagValue},
     {"nativeGetStyleAttributes", "(JI)[I", (void*)NativeGetStyleAttributes},
@@ -20,6 +20,7 @@
 #include "android_os_Parcel.h"
 #include "android_util_Binder.h"
 
+#include <array>
 #include <atomic>
 #include <fcntl.h>
 #include <inttypes.h>
@@ -29,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <unordered_map>
 
 #include <android-base/stringprintf.h>
 #include <binder/BpBinder.h>
@@ -47,6 +49,7 @@
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/SystemClock.h>
+#include <utils/Timers.h>
 #include <utils/threads.h>
 
 #include <nativehelper/JNIHelp.h>
@@ -750,6 +753,109 @@ BinderProxyNativeData* getBPNativeData(JNIEnv* env, jobject obj) {
     return (BinderProxyNativeData *) env->GetLongField(obj, gBinderProxyOffsets.mNativeData);
 }
 
+// The live BinderProxy of each IBinder that javaObjectForIBinder returned, so that it can
+// return it again without calling BinderProxy.getInstance, which serializes all the binder
+// threads on the global proxy map, and without allocating a BinderProxyNativeData that
+// would be deleted right away. The entries are sharded by IBinder so that binder threads
+// looking up different binders rarely wait for each other.
+//
+// An entry holds a weak reference, so the cache doesn't keep proxies alive; it agrees with
+// the Java map since either holds the proxy until it's collected.
+class BinderProxyCache {
+public:
+    // Returns a local reference to the live proxy of |binder|, or NULL if there is none.
+    jobject get(JNIEnv* env, IBinder* binder) {
+        Shard& shard = shardFor(binder);
+        std::unique_lock<std::mutex> lock = lockShard(shard);
+        auto it = shard.entries.find(binder);
+        // The reference is only valid with the lock held, since remove() deletes it.
+        jobject proxy = it != shard.entries.end() ? env->NewLocalRef(it->second.proxy) : NULL;
+        lock.unlock();
+        (proxy != NULL ? mHits : mMisses).fetch_add(1, std::memory_order_relaxed);
+        return proxy;
+    }
+
+    // Caches |proxy|, whose native data is |nativeData|, as the proxy of |binder|.
+    void put(JNIEnv* env, IBinder* binder, jobject proxy, BinderProxyNativeData* nativeData) {
+        if (mVM.load(std::memory_order_relaxed) == NULL) {
+            mVM.store(jnienv_to_javavm(env), std::memory_order_relaxed);
+        }
+        Shard& shard = shardFor(binder);
+        std::unique_lock<std::mutex> lock = lockShard(shard);
+        Entry& entry = shard.entries[binder];
+        if (entry.nativeData == nativeData) {
+            return;
+        }
+        // The previous proxy of |binder| was collected, but not destroyed yet.
+        if (entry.proxy != NULL) {
+            env->DeleteWeakGlobalRef(entry.proxy);
+        }
+        entry.proxy = env->NewWeakGlobalRef(proxy);
+        entry.nativeData = nativeData;
+    }
+
+    // Forgets the proxy of |nativeData|, when it's destroyed, unless another proxy replaced
+    // it already.
+    void remove(IBinder* binder, BinderProxyNativeData* nativeData) {
+        Shard& shard = shardFor(binder);
+        std::unique_lock<std::mutex> lock = lockShard(shard);
+        auto it = shard.entries.find(binder);
+        if (it == shard.entries.end() || it->second.nativeData != nativeData) {
+            return;
+        }
+        JNIEnv* env = javavm_to_jnienv(mVM.load(std::memory_order_relaxed));
+        LOG_ALWAYS_FATAL_IF(env == NULL, "BinderProxy destroyed on an unattached thread");
+        env->DeleteWeakGlobalRef(it->second.proxy);
+        shard.entries.erase(it);
+    }
+
+    uint64_t hits() const { return mHits.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return mMisses.load(std::memory_order_relaxed); }
+    uint64_t lockWaitNs() const { return mLockWaitNs.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kShardCount = 16;
+
+    struct Entry {
+        jweak proxy = NULL;
+        BinderProxyNativeData* nativeData = NULL;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<IBinder*, Entry> entries;
+    };
+
+    Shard& shardFor(IBinder* binder) {
+        // Binders are allocated at least 16 bytes apart, so the low bits are always the same.
+        return mShards[(reinterpret_cast<uintptr_t>(binder) >> 4) % kShardCount];
+    }
+
+    // Locks |shard|, measuring the time spent waiting for it only when it's contended.
+    std::unique_lock<std::mutex> lockShard(Shard& shard) {
+        std::unique_lock<std::mutex> lock(shard.lock, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            lock.lock();
+            mLockWaitNs.fetch_add(systemTime(SYSTEM_TIME_MONOTONIC) - start,
+                                  std::memory_order_relaxed);
+        }
+        return lock;
+    }
+
+    std::array<Shard, kShardCount> mShards;
+    std::atomic<JavaVM*> mVM{NULL};
+    std::atomic<uint64_t> mHits{0};
+    std::atomic<uint64_t> mMisses{0};
+    std::atomic<uint64_t> mLockWaitNs{0};
+};
+
+// Never destroyed, since binder threads may still use it while the process exits.
+static BinderProxyCache& getBinderProxyCache() {
+    static BinderProxyCache* cache = new BinderProxyCache();
+    return *cache;
+}
+
 // If the argument is a JavaBBinder, return the Java object that was used to create it.
 // Otherwise return a BinderProxy for the IBinder. If a previous call was passed the
 // same IBinder, and the original BinderProxy is still alive, return the same BinderProxy.
@@ -767,6 +873,11 @@ jobject javaObjectForIBinder(JNIEnv* env, const sp<IBinder>& val)
         return object;
     }
 
+    jobject cached = getBinderProxyCache().get(env, val.get());
+    if (cached != NULL) {
+        return cached;
+    }
+
     BinderProxyNativeData* nativeData = new BinderProxyNativeData();
     nativeData->mOrgue = new DeathRecipientList;
     nativeData->mObject = val;
@@ -793,6 +904,7 @@ jobject javaObjectForIBinder(JNIEnv* env, const sp<IBinder>& val)
     } else {
         delete nativeData;
     }
+    getBinderProxyCache().put(env, val.get(), object, actualNativeData);
 
     return object;
 }
@@ -1152,6 +1264,21 @@ jint android_os_Debug_getDeathObjectCount(JNIEnv* env, jobject clazz)
     return gNumDeathRefsCreated - gNumDeathRefsDeleted;
 }
 
+jlong android_os_Debug_getProxyCacheHitCount(JNIEnv* env, jobject clazz)
+{
+    return getBinderProxyCache().hits();
+}
+
+jlong android_os_Debug_getProxyCacheMissCount(JNIEnv* env, jobject clazz)
+{
+    return getBinderProxyCache().misses();
+}
+
+jlong android_os_Debug_getProxyCacheLockWaitNanos(JNIEnv* env, jobject clazz)
+{
+    return getBinderProxyCache().lockWaitNs();
+}
+
 }
 
 // ****************************************************************************
@@ -1549,6 +1676,7 @@ static void BinderProxy_destroy(void* rawNativeData)
     BinderProxyNativeData * nativeData = (BinderProxyNativeData *) rawNativeData;
     LOGDEATH("Destroying BinderProxy: binder=%p drl=%p\n",
             nativeData->mObject.get(), nativeData->mOrgue.get());
+    getBinderProxyCache().remove(nativeData->mObject.get(), nativeData);
     delete nativeData;
     IPCThreadState::self()->flushCommands();
     --gNumProxies;
@@ -17,42 +17,51 @@
 #include "core_jni_helpers.h"
 #include "nativehelper/scoped_primitive_array.h"
 
+#include <iterator>
+#include <memory>
+
 namespace android {
 
 static jint android_util_CharsetUtils_toModifiedUtf8Bytes(JNIEnv *env, jobject clazz,
         jstring src, jint srcLen, jlong dest, jint destOff, jint destLen) {
     char *destPtr = reinterpret_cast<char*>(dest);
 
-    // Quickly check if destination has plenty of room for worst-case
-    // 4-bytes-per-char encoded size
-    const size_t worstLen = (srcLen * 4);
-    if (destOff >= 0 && destOff + worstLen < destLen) {
-        env->GetStringUTFRegion(src, 0, srcLen, destPtr + destOff);
-        return strlen(destPtr + destOff + srcLen) + srcLen;
+    const jchar *chars = env->GetStringCritical(src, nullptr);
+    if (chars == nullptr) {
+        return 0;
     }
 
-    // String still might fit in destination, but we need to measure
-    // its actual encoded size to be sure
-    const size_t encodedLen = env->GetStringUTFLength(src);
+    // Quickly check if destination has plenty of room for worst-case
+    // 3-bytes-per-char encoded size; otherwise the string still might fit in
+    // destination, but we need to measure its actual encoded size to be sure
+    const size_t worstLen = (srcLen * 3);
+    const size_t encodedLen = (destOff >= 0 && destOff + worstLen < destLen)
+            ? worstLen : modifiedUtf8Length(chars, srcLen);
+    jint result = -encodedLen;
     if (destOff >= 0 && destOff + encodedLen < destLen) {
-        env->GetStringUTFRegion(src, 0, srcLen, destPtr + destOff);
-        return encodedLen;
+        result = encodeModifiedUtf8(chars, srcLen, destPtr + destOff);
+        destPtr[destOff + result] = '\0';
     }
 
-    return -encodedLen;
+    env->ReleaseStringCritical(src, chars);
+    return result;
 }
 
 static jstring android_util_CharsetUtils_fromModifiedUtf8Bytes(JNIEnv *env, jobject clazz,
         jlong src, jint srcOff, jint srcLen) {
-    char *srcPtr = reinterpret_cast<char*>(src);
+    const char *srcPtr = reinterpret_cast<const char*>(src);
+
+    // Decodes at most one char per byte; most strings fit on the stack.
+    jchar stackChars[256];
+    std::unique_ptr<jchar[]> heapChars;
+    jchar *chars = stackChars;
+    if (static_cast<size_t>(srcLen) > std::size(stackChars)) {
+        heapChars.reset(new jchar[srcLen]);
+        chars = heapChars.get();
+    }
 
-    // This is funky, but we need to temporarily swap a null byte so that
-    // JNI knows where the string ends; we'll put it back, we promise
-    char tmp = srcPtr[srcOff + srcLen];
-    srcPtr[srcOff + srcLen] = '\0';
-    jstring res = env->NewStringUTF(srcPtr + srcOff);
-    srcPtr[srcOff + srcLen] = tmp;
-    return res;
+    const size_t length = decodeModifiedUtf8(srcPtr + srcOff, srcLen, chars);
+    return env->NewString(chars, length);
 }
 
 static const JNINativeMethod methods[] = {
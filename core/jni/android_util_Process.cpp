@@ -32,9 +32,11 @@
 
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <limits>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "core_jni_helpers.h"
@@ -924,6 +926,195 @@ jintArray android_os_Process_getPids(JNIEnv* env, jobject clazz,
     return lastArray;
 }
 
+// The fields of each process in the array that getProcessSnapshot() returns. Times are in clock
+// ticks, as in /proc/pid/stat, and sizes in kB.
+enum {
+    PROCESS_SNAPSHOT_PID = 0,
+    PROCESS_SNAPSHOT_PPID,
+    PROCESS_SNAPSHOT_UID,
+    PROCESS_SNAPSHOT_STATE,
+    PROCESS_SNAPSHOT_MINOR_FAULTS,
+    PROCESS_SNAPSHOT_MAJOR_FAULTS,
+    PROCESS_SNAPSHOT_UTIME,
+    PROCESS_SNAPSHOT_STIME,
+    PROCESS_SNAPSHOT_NUM_THREADS,
+    PROCESS_SNAPSHOT_START_TIME,
+    PROCESS_SNAPSHOT_VSIZE_KB,
+    PROCESS_SNAPSHOT_RSS_KB,
+    PROCESS_SNAPSHOT_SHARED_KB,
+    PROCESS_SNAPSHOT_RSS_ANON_KB,
+    PROCESS_SNAPSHOT_RSS_FILE_KB,
+    PROCESS_SNAPSHOT_SWAP_KB,
+    PROCESS_SNAPSHOT_FIELD_COUNT,
+};
+
+// Reads the whole of |name| under |dirFd| into |buffer|, which only grows so that all the files
+// of a snapshot share it.
+static bool readProcFileAt(int dirFd, const char* name, std::vector<char>* buffer,
+                           std::string_view* contents) {
+    ::android::base::unique_fd fd(openat(dirFd, name, O_RDONLY | O_CLOEXEC));
+    if (!fd.ok()) {
+        return false;
+    }
+    for (;;) {
+        const ssize_t numberBytesRead =
+                TEMP_FAILURE_RETRY(pread(fd, buffer->data(), buffer->size(), 0));
+        if (numberBytesRead < 0) {
+            return false;
+        }
+        if (static_cast<size_t>(numberBytesRead) < buffer->size()) {
+            *contents = std::string_view(buffer->data(), numberBytesRead);
+            return true;
+        }
+        buffer->resize(buffer->size() * 2);
+    }
+}
+
+// Parses the next space-separated number of |s| into |out|.
+static bool parseNextLong(std::string_view* s, jlong* out) {
+    while (!s->empty() && s->front() == ' ') {
+        s->remove_prefix(1);
+    }
+    auto [end, error] = std::from_chars(s->data(), s->data() + s->size(), *out);
+    if (error != std::errc()) {
+        return false;
+    }
+    s->remove_prefix(end - s->data());
+    return true;
+}
+
+static bool parseProcStat(std::string_view stat, jlong* fields) {
+    // The command name is in parentheses and may contain anything, including ") ".
+    const size_t commEnd = stat.rfind(')');
+    if (commEnd == std::string_view::npos || commEnd + 2 >= stat.size()) {
+        return false;
+    }
+    stat.remove_prefix(commEnd + 2);
+    fields[PROCESS_SNAPSHOT_STATE] = stat.front();
+    stat.remove_prefix(1);
+
+    // The fields of proc(5) from ppid, the fourth, to starttime, the twenty-second.
+    static constexpr int kFirstField = 4;
+    static constexpr std::pair<int, int> kStatFields[] = {
+        {4, PROCESS_SNAPSHOT_PPID},
+        {10, PROCESS_SNAPSHOT_MINOR_FAULTS},
+        {12, PROCESS_SNAPSHOT_MAJOR_FAULTS},
+        {14, PROCESS_SNAPSHOT_UTIME},
+        {15, PROCESS_SNAPSHOT_STIME},
+        {20, PROCESS_SNAPSHOT_NUM_THREADS},
+        {22, PROCESS_SNAPSHOT_START_TIME},
+    };
+    int field = kFirstField;
+    for (const auto& [statField, snapshotField] : kStatFields) {
+        jlong value;
+        do {
+            if (!parseNextLong(&stat, &value)) {
+                return false;
+            }
+        } while (field++ < statField);
+        fields[snapshotField] = value;
+    }
+    return true;
+}
+
+static void parseProcStatm(std::string_view statm, jlong* fields) {
+    static const jlong kPageSizeKb = sysconf(_SC_PAGESIZE) / 1024;
+    for (int snapshotField : {PROCESS_SNAPSHOT_VSIZE_KB, PROCESS_SNAPSHOT_RSS_KB,
+                              PROCESS_SNAPSHOT_SHARED_KB}) {
+        jlong pages;
+        if (!parseNextLong(&statm, &pages)) {
+            return;
+        }
+        fields[snapshotField] = pages * kPageSizeKb;
+    }
+}
+
+static void parseProcStatus(std::string_view status, jlong* fields) {
+    static constexpr std::pair<std::string_view, int> kStatusFields[] = {
+        {"Uid:", PROCESS_SNAPSHOT_UID},
+        {"RssAnon:", PROCESS_SNAPSHOT_RSS_ANON_KB},
+        {"RssFile:", PROCESS_SNAPSHOT_RSS_FILE_KB},
+        {"VmSwap:", PROCESS_SNAPSHOT_SWAP_KB},
+    };
+    while (!status.empty()) {
+        const size_t lineEnd = status.find('\n');
+        std::string_view line = status.substr(0, lineEnd);
+        status.remove_prefix(lineEnd == std::string_view::npos ? status.size() : lineEnd + 1);
+        for (const auto& [tag, snapshotField] : kStatusFields) {
+            if (line.substr(0, tag.size()) == tag) {
+                line.remove_prefix(tag.size());
+                while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+                    line.remove_prefix(1);
+                }
+                parseNextLong(&line, &fields[snapshotField]);
+                break;
+            }
+        }
+    }
+}
+
+// Walks /proc once and reads the stat, statm and status of every process, for callers that
+// would otherwise list the pids with getPids() and read each file with readProcFile(). Returns
+// {processCount, PROCESS_SNAPSHOT_FIELD_COUNT, then the fields of each process}, sorted by pid;
+// processes that exit during the walk are left out.
+static jlongArray android_os_Process_getProcessSnapshot(JNIEnv* env, jobject clazz)
+{
+    std::unique_ptr<DIR, decltype(&closedir)> proc(opendir("/proc"), closedir);
+    if (proc == nullptr) {
+        return nullptr;
+    }
+
+    std::vector<jlong> snapshot(2);
+    std::vector<char> buffer(kProcReadMinHeapBufferSize);
+    jlong fields[PROCESS_SNAPSHOT_FIELD_COUNT];
+    struct dirent* entry;
+    while ((entry = readdir(proc.get())) != nullptr) {
+        jlong pid;
+        const char* nameEnd = entry->d_name + strlen(entry->d_name);
+        auto [end, error] = std::from_chars(entry->d_name, nameEnd, pid);
+        if (error != std::errc() || end != nameEnd) {
+            continue;
+        }
+
+        ::android::base::unique_fd pidFd(openat(dirfd(proc.get()), entry->d_name,
+                                                O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        std::string_view contents;
+        if (!pidFd.ok() || !readProcFileAt(pidFd, "stat", &buffer, &contents)) {
+            continue;
+        }
+
+        std::fill(std::begin(fields), std::end(fields), 0);
+        fields[PROCESS_SNAPSHOT_PID] = pid;
+        if (!parseProcStat(contents, fields)) {
+            continue;
+        }
+        if (readProcFileAt(pidFd, "statm", &buffer, &contents)) {
+            parseProcStatm(contents, fields);
+        }
+        if (readProcFileAt(pidFd, "status", &buffer, &contents)) {
+            parseProcStatus(contents, fields);
+        }
+        snapshot.insert(snapshot.end(), std::begin(fields), std::end(fields));
+    }
+
+    const size_t count = (snapshot.size() - 2) / PROCESS_SNAPSHOT_FIELD_COUNT;
+    snapshot[0] = count;
+    snapshot[1] = PROCESS_SNAPSHOT_FIELD_COUNT;
+    using Process = std::array<jlong, PROCESS_SNAPSHOT_FIELD_COUNT>;
+    Process* processes = reinterpret_cast<Process*>(snapshot.data() + 2);
+    std::sort(processes, processes + count, [](const Process& a, const Process& b) {
+        return a[PROCESS_SNAPSHOT_PID] < b[PROCESS_SNAPSHOT_PID];
+    });
+
+    jlongArray result = env->NewLongArray(snapshot.size());
+    if (result == NULL) {
+        jniThrowException(env, "java/lang/OutOfMemoryError", NULL);
+        return NULL;
+    }
+    env->SetLongArrayRegion(result, 0, snapshot.size(), snapshot.data());
+    return result;
+}
+
 enum {
     PROC_TERM_MASK = 0xff,
     PROC_ZERO_TERM = 0,
@@ -1405,7 +1596,14 @@ static const JNINativeMethod methods[] = {
         {"freezeCgroupUid", "(IZ)V", (void*)android_os_Process_freezeCgroupUID},
 };
 
+// Registered only if Process declares them.
+static const JNINativeMethod optionalMethods[] = {
+        {"getProcessSnapshot", "()[J", (void*)android_os_Process_getProcessSnapshot},
+};
+
 int register_android_os_Process(JNIEnv* env)
 {
-    return RegisterMethodsOrDie(env, "android/os/Process", methods, NELEM(methods));
+    int res = RegisterMethodsOrDie(env, "android/os/Process", methods, NELEM(methods));
+    RegisterOptionalMethods(env, "android/os/Process", optionalMethods, NELEM(optionalMethods));
+    return res;
 }
@@ -262,14 +262,39 @@ static jint android_content_XmlBlock_nativeGetAttributeIndex(JNIEnv* env, jobjec
     return idx;
 }
 
+static jint getIdAttribute(const ResXMLParser* st) {
+    ssize_t idx = st->indexOfID();
+    return idx >= 0 ? static_cast<jint>(st->getAttributeValueStringID(idx)) : -1;
+}
+
+static jint getClassAttribute(const ResXMLParser* st) {
+    ssize_t idx = st->indexOfClass();
+    return idx >= 0 ? static_cast<jint>(st->getAttributeValueStringID(idx)) : -1;
+}
+
+static jint getStyleAttribute(const ResXMLParser* st) {
+    ssize_t idx = st->indexOfStyle();
+    if (idx < 0) {
+        return 0;
+    }
+
+    Res_value value;
+    if (st->getAttributeValue(idx, &value) < 0) {
+        return 0;
+    }
+
+    return value.dataType == value.TYPE_REFERENCE
+        || value.dataType == value.TYPE_ATTRIBUTE
+        ? value.data : 0;
+}
+
 static jint android_content_XmlBlock_nativeGetIdAttribute(CRITICAL_JNI_PARAMS_COMMA jlong token) {
     ResXMLParser* st = reinterpret_cast<ResXMLParser*>(token);
     if (st == NULL) {
         return kNullDocument;
     }
 
-    ssize_t idx = st->indexOfID();
-    return idx >= 0 ? static_cast<jint>(st->getAttributeValueStringID(idx)) : -1;
+    return getIdAttribute(st);
 }
 
 static jint android_content_XmlBlock_nativeGetClassAttribute(
@@ -279,8 +304,7 @@ static jint android_content_XmlBlock_nativeGetClassAttribute(
         return kNullDocument;
     }
 
-    ssize_t idx = st->indexOfClass();
-    return idx >= 0 ? static_cast<jint>(st->getAttributeValueStringID(idx)) : -1;
+    return getClassAttribute(st);
 }
 
 static jint android_content_XmlBlock_nativeGetStyleAttribute(
@@ -290,19 +314,7 @@ static jint android_content_XmlBlock_nativeGetStyleAttribute(
         return kNullDocument;
     }
 
-    ssize_t idx = st->indexOfStyle();
-    if (idx < 0) {
-        return 0;
-    }
-
-    Res_value value;
-    if (st->getAttributeValue(idx, &value) < 0) {
-        return 0;
-    }
-
-    return value.dataType == value.TYPE_REFERENCE
-        || value.dataType == value.TYPE_ATTRIBUTE
-        ? value.data : 0;
+    return getStyleAttribute(st);
 }
 
 static jint android_content_XmlBlock_nativeGetSourceResId(CRITICAL_JNI_PARAMS_COMMA jlong token) {
@@ -314,6 +326,80 @@ static jint android_content_XmlBlock_nativeGetSourceResId(CRITICAL_JNI_PARAMS_CO
     }
 }
 
+// The layout of the element state of nativeGetElementState(): a header, followed by
+// ELEMENT_STATE_ATTRIBUTE_SIZE values for each attribute.
+enum {
+    ELEMENT_STATE_NAMESPACE,
+    ELEMENT_STATE_NAME,
+    ELEMENT_STATE_LINE_NUMBER,
+    ELEMENT_STATE_ATTRIBUTE_COUNT,
+    ELEMENT_STATE_ID_ATTRIBUTE,
+    ELEMENT_STATE_CLASS_ATTRIBUTE,
+    ELEMENT_STATE_STYLE_ATTRIBUTE,
+    ELEMENT_STATE_HEADER_SIZE
+};
+
+enum {
+    ATTRIBUTE_STATE_NAMESPACE,
+    ATTRIBUTE_STATE_NAME,
+    ATTRIBUTE_STATE_RESOURCE,
+    ATTRIBUTE_STATE_STRING_VALUE,
+    ATTRIBUTE_STATE_DATA_TYPE,
+    ATTRIBUTE_STATE_DATA,
+    ELEMENT_STATE_ATTRIBUTE_SIZE
+};
+
+/*
+ * Fills outState with what the nativeGet*() calls return for the current START_TAG and all
+ * its attributes, so that inflating a view takes one JNI call instead of a few per attribute.
+ * Returns the length of the state, which is only written if outState is large enough for it.
+ */
+static jint android_content_XmlBlock_nativeGetElementState(JNIEnv* env, jobject clazz,
+                                                           jlong token, jintArray outState)
+{
+    ResXMLParser* st = reinterpret_cast<ResXMLParser*>(token);
+    if (st == NULL) {
+        return kNullDocument;
+    }
+    if (outState == NULL) {
+        jniThrowNullPointerException(env, "outState");
+        return 0;
+    }
+
+    const ssize_t attributeCount = static_cast<ssize_t>(st->getAttributeCount());
+    const size_t count = attributeCount > 0 ? attributeCount : 0;
+    const jint length = ELEMENT_STATE_HEADER_SIZE + count * ELEMENT_STATE_ATTRIBUTE_SIZE;
+    if (env->GetArrayLength(outState) < length) {
+        return length;
+    }
+
+    jint* state = reinterpret_cast<jint*>(env->GetPrimitiveArrayCritical(outState, NULL));
+    if (state == NULL) {
+        return 0;
+    }
+    state[ELEMENT_STATE_NAMESPACE] = static_cast<jint>(st->getElementNamespaceID());
+    state[ELEMENT_STATE_NAME] = static_cast<jint>(st->getElementNameID());
+    state[ELEMENT_STATE_LINE_NUMBER] = static_cast<jint>(st->getLineNumber());
+    state[ELEMENT_STATE_ATTRIBUTE_COUNT] = static_cast<jint>(count);
+    state[ELEMENT_STATE_ID_ATTRIBUTE] = getIdAttribute(st);
+    state[ELEMENT_STATE_CLASS_ATTRIBUTE] = getClassAttribute(st);
+    state[ELEMENT_STATE_STYLE_ATTRIBUTE] = getStyleAttribute(st);
+
+    jint* attribute = state + ELEMENT_STATE_HEADER_SIZE;
+    for (size_t idx = 0; idx < count; idx++) {
+        attribute[ATTRIBUTE_STATE_NAMESPACE] = static_cast<jint>(st->getAttributeNamespaceID(idx));
+        attribute[ATTRIBUTE_STATE_NAME] = static_cast<jint>(st->getAttributeNameID(idx));
+        attribute[ATTRIBUTE_STATE_RESOURCE] = static_cast<jint>(st->getAttributeNameResID(idx));
+        attribute[ATTRIBUTE_STATE_STRING_VALUE] =
+                static_cast<jint>(st->getAttributeValueStringID(idx));
+        attribute[ATTRIBUTE_STATE_DATA_TYPE] = static_cast<jint>(st->getAttributeDataType(idx));
+        attribute[ATTRIBUTE_STATE_DATA] = static_cast<jint>(st->getAttributeData(idx));
+        attribute += ELEMENT_STATE_ATTRIBUTE_SIZE;
+    }
+    env->ReleasePrimitiveArrayCritical(outState, state, 0);
+    return length;
+}
+
 static void android_content_XmlBlock_nativeDestroyParseState(JNIEnv* env, jobject clazz,
                                                           jlong token)
 {
@@ -394,10 +480,19 @@ static const JNINativeMethod gXmlBlockMethods[] = {
             (void*) android_content_XmlBlock_nativeGetSourceResId},
 };
 
+// Registered only if XmlBlock declares them.
+static const JNINativeMethod gXmlBlockOptionalMethods[] = {
+    { "nativeGetElementState",     "(J[I)I",
+            (void*) android_content_XmlBlock_nativeGetElementState },
+};
+
 int register_android_content_XmlBlock(JNIEnv* env)
 {
-    return RegisterMethodsOrDie(env,
+    int res = RegisterMethodsOrDie(env,
             "android/content/res/XmlBlock", gXmlBlockMethods, NELEM(gXmlBlockMethods));
+    RegisterOptionalMethods(env, "android/content/res/XmlBlock", gXmlBlockOptionalMethods,
+                            NELEM(gXmlBlockOptionalMethods));
+    return res;
 }
 
 }; // namespace android
@@ -42,6 +42,9 @@ namespace android {
 
 static const bool kDebugDispatchCycle = false;
 
+// The most key and motion events handed to Java by one dispatchInputEvents() call.
+static const size_t kMaxDeliveryBatchSize = 64;
+
 static const char* toString(bool value) {
     return value ? "true" : "false";
 }
@@ -50,6 +53,7 @@ static struct {
     jclass clazz;
 
     jmethodID dispatchInputEvent;
+    jmethodID dispatchInputEvents;
     jmethodID onFocusEvent;
     jmethodID onPointerCaptureEvent;
     jmethodID onDragEvent;
@@ -57,6 +61,10 @@ static struct {
     jmethodID onTouchModeChanged;
 } gInputEventReceiverClassInfo;
 
+static struct {
+    jclass clazz;
+} gInputEventClassInfo;
+
 // Add prefix to the beginning of each line in 'str'
 static std::string addPrefix(std::string str, std::string_view prefix) {
     str.insert(0, prefix); // insert at the beginning of the first line
@@ -85,6 +93,7 @@ public:
     status_t reportTimeline(int32_t inputEventId, nsecs_t gpuCompletedTime, nsecs_t presentTime);
     status_t consumeEvents(JNIEnv* env, bool consumeBatches, nsecs_t frameTime,
             bool* outConsumedBatch);
+    void setBatchedDelivery(JNIEnv* env, bool enabled);
     std::string dump(const char* prefix);
 
 protected:
@@ -110,8 +119,20 @@ private:
     int mFdEvents;
     std::vector<OutboundEvent> mOutboundQueue;
 
+    // With batched delivery, the key and motion events consumed by a call to consumeEvents()
+    // are collected in these global refs, and handed to Java by a single dispatchInputEvents()
+    // upcall instead of one dispatchInputEvent() per event. Java clears the elements of
+    // mDeliveryEvents it was handed.
+    jintArray mDeliverySeqs;
+    jobjectArray mDeliveryEvents;
+    std::array<jint, kMaxDeliveryBatchSize> mPendingDeliverySeqs;
+    size_t mPendingDeliveryCount;
+
     void setFdEvents(int events);
 
+    // Dispatches the collected events, if any. Returns false if Java threw.
+    bool flushDeliveryBatch(JNIEnv* env, jobject receiverObj);
+
     const std::string getInputChannelName() {
         return mInputConsumer.getChannel()->getName();
     }
@@ -128,7 +149,10 @@ NativeInputEventReceiver::NativeInputEventReceiver(
         mInputConsumer(inputChannel),
         mMessageQueue(messageQueue),
         mBatchedInputEventPending(false),
-        mFdEvents(0) {
+        mFdEvents(0),
+        mDeliverySeqs(nullptr),
+        mDeliveryEvents(nullptr),
+        mPendingDeliveryCount(0) {
     if (kDebugDispatchCycle) {
         ALOGD("channel '%s' ~ Initializing input event receiver.", getInputChannelName().c_str());
     }
@@ -137,6 +161,50 @@ NativeInputEventReceiver::NativeInputEventReceiver(
 NativeInputEventReceiver::~NativeInputEventReceiver() {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->DeleteGlobalRef(mReceiverWeakGlobal);
+    setBatchedDelivery(env, false);
+}
+
+void NativeInputEventReceiver::setBatchedDelivery(JNIEnv* env, bool enabled) {
+    enabled = enabled && gInputEventReceiverClassInfo.dispatchInputEvents != nullptr;
+    if (enabled == (mDeliveryEvents != nullptr)) {
+        return;
+    }
+    if (!enabled) {
+        env->DeleteGlobalRef(mDeliverySeqs);
+        env->DeleteGlobalRef(mDeliveryEvents);
+        mDeliverySeqs = nullptr;
+        mDeliveryEvents = nullptr;
+        return;
+    }
+
+    ScopedLocalRef<jintArray> seqs(env, env->NewIntArray(kMaxDeliveryBatchSize));
+    ScopedLocalRef<jobjectArray> events(env,
+                                        env->NewObjectArray(kMaxDeliveryBatchSize,
+                                                            gInputEventClassInfo.clazz, nullptr));
+    if (seqs.get() == nullptr || events.get() == nullptr) {
+        return; // OutOfMemoryError is pending
+    }
+    mDeliverySeqs = static_cast<jintArray>(env->NewGlobalRef(seqs.get()));
+    mDeliveryEvents = static_cast<jobjectArray>(env->NewGlobalRef(events.get()));
+}
+
+bool NativeInputEventReceiver::flushDeliveryBatch(JNIEnv* env, jobject receiverObj) {
+    if (mPendingDeliveryCount == 0) {
+        return true;
+    }
+    const jint count = static_cast<jint>(mPendingDeliveryCount);
+    mPendingDeliveryCount = 0;
+    if (kDebugDispatchCycle) {
+        ALOGD("channel '%s' ~ Dispatching %d input events.", getInputChannelName().c_str(), count);
+    }
+    env->SetIntArrayRegion(mDeliverySeqs, 0, count, mPendingDeliverySeqs.data());
+    env->CallVoidMethod(receiverObj, gInputEventReceiverClassInfo.dispatchInputEvents, count,
+                        mDeliverySeqs, mDeliveryEvents);
+    if (env->ExceptionCheck()) {
+        ALOGE("Exception dispatching input events.");
+        return false;
+    }
+    return true;
 }
 
 status_t NativeInputEventReceiver::initialize() {
@@ -322,10 +390,17 @@ status_t NativeInputEventReceiver::consumeEvents(JNIEnv* env,
         if (status != OK && status != WOULD_BLOCK) {
             ALOGE("channel '%s' ~ Failed to consume input event.  status=%s(%d)",
                   getInputChannelName().c_str(), statusToString(status).c_str(), status);
+            // The events consumed so far still need to be handled, and finished.
+            if (!skipCallbacks) {
+                flushDeliveryBatch(env, receiverObj.get());
+            }
             return status;
         }
 
         if (status == WOULD_BLOCK) {
+            if (!skipCallbacks && !flushDeliveryBatch(env, receiverObj.get())) {
+                skipCallbacks = true;
+            }
             if (!skipCallbacks && !mBatchedInputEventPending && mInputConsumer.hasPendingBatch()) {
                 // There is a pending batch.  Come back later.
                 if (!receiverObj.get()) {
@@ -366,8 +441,16 @@ status_t NativeInputEventReceiver::consumeEvents(JNIEnv* env,
                 }
             }
 
+            // The other events are handled right away, after the ones collected before them.
+            const InputEventType type = inputEvent->getType();
+            if (type != InputEventType::KEY && type != InputEventType::MOTION &&
+                !flushDeliveryBatch(env, receiverObj.get())) {
+                skipCallbacks = true;
+                continue;
+            }
+
             jobject inputEventObj;
-            switch (inputEvent->getType()) {
+            switch (type) {
                 case InputEventType::KEY:
                     if (kDebugDispatchCycle) {
                         ALOGD("channel '%s' ~ Received key event.", getInputChannelName().c_str());
@@ -445,7 +528,15 @@ status_t NativeInputEventReceiver::consumeEvents(JNIEnv* env,
                 inputEventObj = nullptr;
             }
 
-            if (inputEventObj) {
+            if (inputEventObj && mDeliveryEvents != nullptr) {
+                env->SetObjectArrayElement(mDeliveryEvents, mPendingDeliveryCount, inputEventObj);
+                env->DeleteLocalRef(inputEventObj);
+                mPendingDeliverySeqs[mPendingDeliveryCount++] = seq;
+                if (mPendingDeliveryCount == kMaxDeliveryBatchSize &&
+                    !flushDeliveryBatch(env, receiverObj.get())) {
+                    skipCallbacks = true;
+                }
+            } else if (inputEventObj) {
                 if (kDebugDispatchCycle) {
                     ALOGD("channel '%s' ~ Dispatching input event.", getInputChannelName().c_str());
                 }
@@ -583,6 +674,13 @@ static jboolean nativeConsumeBatchedInputEvents(JNIEnv* env, jclass clazz, jlong
     return consumedBatch ? JNI_TRUE : JNI_FALSE;
 }
 
+static void nativeSetBatchedDelivery(JNIEnv* env, jclass clazz, jlong receiverPtr,
+                                     jboolean enabled) {
+    sp<NativeInputEventReceiver> receiver =
+            reinterpret_cast<NativeInputEventReceiver*>(receiverPtr);
+    receiver->setBatchedDelivery(env, enabled);
+}
+
 static jstring nativeDump(JNIEnv* env, jclass clazz, jlong receiverPtr, jstring prefix) {
     sp<NativeInputEventReceiver> receiver =
             reinterpret_cast<NativeInputEventReceiver*>(receiverPtr);
@@ -602,16 +700,33 @@ static const JNINativeMethod gMethods[] = {
         {"nativeDump", "(JLjava/lang/String;)Ljava/lang/String;", (void*)nativeDump},
 };
 
+// Registered only if InputEventReceiver declares batched delivery.
+static const JNINativeMethod gBatchedDeliveryMethods[] = {
+        {"nativeSetBatchedDelivery", "(JZ)V", (void*)nativeSetBatchedDelivery},
+};
+
 int register_android_view_InputEventReceiver(JNIEnv* env) {
     int res = RegisterMethodsOrDie(env, "android/view/InputEventReceiver",
             gMethods, NELEM(gMethods));
+    RegisterOptionalMethods(env, "android/view/InputEventReceiver", gBatchedDeliveryMethods,
+                            NELEM(gBatchedDeliveryMethods));
 
     jclass clazz = FindClassOrDie(env, "android/view/InputEventReceiver");
     gInputEventReceiverClassInfo.clazz = MakeGlobalRefOrDie(env, clazz);
 
+    gInputEventClassInfo.clazz =
+            MakeGlobalRefOrDie(env, FindClassOrDie(env, "android/view/InputEvent"));
+
     gInputEventReceiverClassInfo.dispatchInputEvent = GetMethodIDOrDie(env,
             gInputEventReceiverClassInfo.clazz,
             "dispatchInputEvent", "(ILandroid/view/InputEvent;)V");
+    // Batched delivery stays off if the receiver has no dispatchInputEvents().
+    gInputEventReceiverClassInfo.dispatchInputEvents =
+            env->GetMethodID(gInputEventReceiverClassInfo.clazz, "dispatchInputEvents",
+                             "(I[I[Landroid/view/InputEvent;)V");
+    if (gInputEventReceiverClassInfo.dispatchInputEvents == nullptr) {
+        env->ExceptionClear();
+    }
     gInputEventReceiverClassInfo.onFocusEvent =
             GetMethodIDOrDie(env, gInputEventReceiverClassInfo.clazz, "onFocusEvent", "(Z)V");
     gInputEventReceiverClassInfo.onPointerCaptureEvent =
@@ -587,6 +587,102 @@ static jfloat android_view_MotionEvent_nativeGetAxisValue(JNIEnv* env, jclass cl
     }
 }
 
+// The most axes that a single nativeGetAxisValues() call exports, one per PointerCoords bit.
+static const jsize MAX_EXPORTED_AXES = 64;
+
+static jsize getExportedAxes(JNIEnv* env, jintArray axesArray, jint* outAxes) {
+    if (!axesArray) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "axes must not be null");
+        return -1;
+    }
+    jsize axisCount = env->GetArrayLength(axesArray);
+    if (axisCount > MAX_EXPORTED_AXES) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "axes must not hold more than 64 axes");
+        return -1;
+    }
+    env->GetIntArrayRegion(axesArray, 0, axisCount, outAxes);
+    return axisCount;
+}
+
+static bool validateExportedValues(JNIEnv* env, size_t valueCount, jlong offset,
+        jlong capacity) {
+    if (offset < 0 || offset > capacity || valueCount > size_t(capacity - offset)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "outValues must be large enough to hold all samples");
+        return false;
+    }
+    return true;
+}
+
+// Writes the values of the axes of every pointer of every sample, oldest sample first and
+// ending with the current one: outValues[(sample * pointerCount + pointer) * axisCount + axis].
+static void exportAxisValues(const MotionEvent& event, const jint* axes, size_t axisCount,
+        jfloat* outValues) {
+    const size_t historySize = event.getHistorySize();
+    const size_t pointerCount = event.getPointerCount();
+    for (size_t historyPos = 0; historyPos <= historySize; historyPos++) {
+        for (size_t pointerIndex = 0; pointerIndex < pointerCount; pointerIndex++) {
+            for (size_t i = 0; i < axisCount; i++) {
+                *outValues++ = historyPos == historySize
+                        ? event.getAxisValue(axes[i], pointerIndex)
+                        : event.getHistoricalAxisValue(axes[i], pointerIndex, historyPos);
+            }
+        }
+    }
+}
+
+static jint android_view_MotionEvent_nativeGetAxisValues(JNIEnv* env, jclass clazz,
+        jlong nativePtr, jintArray axesArray, jfloatArray outValuesArray, jint offset) {
+    MotionEvent* event = reinterpret_cast<MotionEvent*>(nativePtr);
+    jint axes[MAX_EXPORTED_AXES];
+    jsize axisCount = getExportedAxes(env, axesArray, axes);
+    if (axisCount < 0) {
+        return 0;
+    }
+    if (!outValuesArray) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "outValues must not be null");
+        return 0;
+    }
+    const size_t valueCount = (event->getHistorySize() + 1) * event->getPointerCount() * axisCount;
+    if (!validateExportedValues(env, valueCount, offset, env->GetArrayLength(outValuesArray))) {
+        return 0;
+    }
+
+    jfloat* outValues = static_cast<jfloat*>(env->GetPrimitiveArrayCritical(
+            outValuesArray, NULL));
+    exportAxisValues(*event, axes, axisCount, outValues + offset);
+    env->ReleasePrimitiveArrayCritical(outValuesArray, outValues, 0);
+    return jint(valueCount);
+}
+
+// Same as nativeGetAxisValues(), into a direct ByteBuffer in the native byte order. The
+// offset is in floats, from the start of the buffer.
+static jint android_view_MotionEvent_nativeGetAxisValuesToBuffer(JNIEnv* env, jclass clazz,
+        jlong nativePtr, jintArray axesArray, jobject outBufferObj, jint offset) {
+    MotionEvent* event = reinterpret_cast<MotionEvent*>(nativePtr);
+    jint axes[MAX_EXPORTED_AXES];
+    jsize axisCount = getExportedAxes(env, axesArray, axes);
+    if (axisCount < 0) {
+        return 0;
+    }
+    void* outBuffer = outBufferObj ? env->GetDirectBufferAddress(outBufferObj) : NULL;
+    if (!outBuffer || reinterpret_cast<uintptr_t>(outBuffer) % alignof(jfloat) != 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "outBuffer must be an aligned direct buffer");
+        return 0;
+    }
+    const size_t valueCount = (event->getHistorySize() + 1) * event->getPointerCount() * axisCount;
+    const jlong capacity = env->GetDirectBufferCapacity(outBufferObj) / jlong(sizeof(jfloat));
+    if (!validateExportedValues(env, valueCount, offset, capacity)) {
+        return 0;
+    }
+
+    exportAxisValues(*event, axes, axisCount, static_cast<jfloat*>(outBuffer) + offset);
+    return jint(valueCount);
+}
+
 static void android_view_MotionEvent_nativeTransform(JNIEnv* env, jclass clazz,
         jlong nativePtr, jobject matrixObj) {
     MotionEvent* event = reinterpret_cast<MotionEvent*>(nativePtr);
@@ -874,9 +970,18 @@ static const JNINativeMethod gMotionEventMethods[] = {
          (void*)android_view_MotionEvent_nativeGetSurfaceRotation},
 };
 
+// Registered only if MotionEvent declares them.
+static const JNINativeMethod gMotionEventAxisValuesMethods[] = {
+        {"nativeGetAxisValues", "(J[I[FI)I", (void*)android_view_MotionEvent_nativeGetAxisValues},
+        {"nativeGetAxisValuesToBuffer", "(J[ILjava/nio/ByteBuffer;I)I",
+         (void*)android_view_MotionEvent_nativeGetAxisValuesToBuffer},
+};
+
 int register_android_view_MotionEvent(JNIEnv* env) {
     int res = RegisterMethodsOrDie(env, "android/view/MotionEvent", gMotionEventMethods,
                                    NELEM(gMotionEventMethods));
+    RegisterOptionalMethods(env, "android/view/MotionEvent", gMotionEventAxisValuesMethods,
+                            NELEM(gMotionEventAxisValuesMethods));
 
     gMotionEventClassInfo.clazz = FindClassOrDie(env, "android/view/MotionEvent");
     gMotionEventClassInfo.clazz = MakeGlobalRefOrDie(env, gMotionEventClassInfo.clazz);
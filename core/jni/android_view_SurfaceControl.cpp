@@ -931,6 +931,90 @@ static void nativeSetShadowRadius(JNIEnv* env, jclass clazz, jlong transactionOb
     transaction->setShadowRadius(ctrl, shadowRadius);
 }
 
+// The layer operations of nativeApplyLayerCommands(). These match the COMMAND_* constants of
+// SurfaceControl.Transaction's command buffer.
+enum LayerCommandOp : int32_t {
+    LAYER_COMMAND_SET_LAYER = 0,            // i[0]: z-order
+    LAYER_COMMAND_SET_POSITION = 1,         // f[0], f[1]: x, y
+    LAYER_COMMAND_SET_SCALE = 2,            // f[0], f[1]: x scale, y scale
+    LAYER_COMMAND_SET_MATRIX = 3,           // f[0..3]: dsdx, dtdx, dtdy, dsdy
+    LAYER_COMMAND_SET_ALPHA = 4,            // f[0]: alpha
+    LAYER_COMMAND_SET_WINDOW_CROP = 5,      // i[0..3]: left, top, right, bottom
+    LAYER_COMMAND_SET_CORNER_RADIUS = 6,    // f[0]: radius
+    LAYER_COMMAND_SET_FLAGS = 7,            // i[0], i[1]: flags, mask
+    LAYER_COMMAND_SET_SHADOW_RADIUS = 8,    // f[0]: radius
+};
+
+// One command as Java writes it into the buffer, in native byte order.
+struct LayerCommand {
+    int32_t op;
+    int32_t reserved;
+    int64_t surfaceControl;
+    union {
+        float f[4];
+        int32_t i[4];
+    };
+};
+static_assert(sizeof(LayerCommand) == 32, "LayerCommand must match the Java command size");
+
+// Applies |count| commands of |commandBuffer|, a direct ByteBuffer, to the transaction at once, so
+// that animating many layers per frame costs one JNI call instead of one per setter.
+static void nativeApplyLayerCommands(JNIEnv* env, jclass clazz, jlong transactionObj,
+        jobject commandBuffer, jint count) {
+    auto transaction = reinterpret_cast<SurfaceComposerClient::Transaction*>(transactionObj);
+
+    const uint8_t* commands = static_cast<const uint8_t*>(env->GetDirectBufferAddress(
+            commandBuffer));
+    const jlong capacity = env->GetDirectBufferCapacity(commandBuffer);
+    if (commands == nullptr || count < 0 ||
+            static_cast<uint64_t>(count) * sizeof(LayerCommand) > static_cast<uint64_t>(capacity)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "Command buffer is not direct or too small");
+        return;
+    }
+
+    for (jint c = 0; c < count; c++) {
+        LayerCommand command;
+        memcpy(&command, commands + c * sizeof(LayerCommand), sizeof(LayerCommand));
+        SurfaceControl* const ctrl = reinterpret_cast<SurfaceControl*>(command.surfaceControl);
+        switch (command.op) {
+            case LAYER_COMMAND_SET_LAYER:
+                transaction->setLayer(ctrl, command.i[0]);
+                break;
+            case LAYER_COMMAND_SET_POSITION:
+                transaction->setPosition(ctrl, command.f[0], command.f[1]);
+                break;
+            case LAYER_COMMAND_SET_SCALE:
+                transaction->setMatrix(ctrl, command.f[0], 0, 0, command.f[1]);
+                break;
+            case LAYER_COMMAND_SET_MATRIX:
+                transaction->setMatrix(ctrl, command.f[0], command.f[1], command.f[2],
+                                       command.f[3]);
+                break;
+            case LAYER_COMMAND_SET_ALPHA:
+                transaction->setAlpha(ctrl, command.f[0]);
+                break;
+            case LAYER_COMMAND_SET_WINDOW_CROP:
+                transaction->setCrop(ctrl, Rect(command.i[0], command.i[1], command.i[2],
+                                                command.i[3]));
+                break;
+            case LAYER_COMMAND_SET_CORNER_RADIUS:
+                transaction->setCornerRadius(ctrl, command.f[0]);
+                break;
+            case LAYER_COMMAND_SET_FLAGS:
+                transaction->setFlags(ctrl, command.i[0], command.i[1]);
+                break;
+            case LAYER_COMMAND_SET_SHADOW_RADIUS:
+                transaction->setShadowRadius(ctrl, command.f[0]);
+                break;
+            default:
+                jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                        "Unknown layer command %d at %d", command.op, c);
+                return;
+        }
+    }
+}
+
 static void nativeSetTrustedOverlay(JNIEnv* env, jclass clazz, jlong transactionObj,
                                     jlong nativeObject, jboolean isTrustedOverlay) {
     auto transaction = reinterpret_cast<SurfaceComposerClient::Transaction*>(transactionObj);
@@ -2317,10 +2401,20 @@ static const JNINativeMethod sSurfaceControlMethods[] = {
         // clang-format on
 };
 
+// Registered only if SurfaceControl declares them.
+static const JNINativeMethod sSurfaceControlOptionalMethods[] = {
+        // clang-format off
+    {"nativeApplyLayerCommands", "(JLjava/nio/ByteBuffer;I)V",
+            (void*)nativeApplyLayerCommands },
+        // clang-format on
+};
+
 int register_android_view_SurfaceControl(JNIEnv* env)
 {
     int err = RegisterMethodsOrDie(env, "android/view/SurfaceControl",
             sSurfaceControlMethods, NELEM(sSurfaceControlMethods));
+    RegisterOptionalMethods(env, "android/view/SurfaceControl", sSurfaceControlOptionalMethods,
+                            NELEM(sSurfaceControlOptionalMethods));
 
     jclass integerClass = FindClassOrDie(env, "java/lang/Integer");
     gIntegerClassInfo.clazz = MakeGlobalRefOrDie(env, integerClass);
@@ -22,6 +22,8 @@
 #include <nativehelper/jni_macros.h>
 
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
 #include <sys/types.h>
 
 #include <linux/f2fs.h>
@@ -31,32 +33,41 @@
 
 #include <utils/Log.h>
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace std::literals;
 
 namespace android {
 
-static jlong com_android_internal_content_F2fsUtils_nativeReleaseCompressedBlocks(JNIEnv *env,
-                                                                                  jclass clazz,
-                                                                                  jstring path) {
+// An app's code directory holds few files; more threads than this add little.
+static constexpr size_t kMaxReleaseThreads = 4;
+
+// Returns the number of blocks released from the file at |filePath|, 0 if it isn't compressed,
+// or -errno if releasing them failed.
+static jlong releaseCompressedBlocks(const char* filePath) {
     unsigned long long blkcnt;
     int ret;
-    ScopedUtfChars filePath(env, path);
 
-    android::base::unique_fd fd(open(filePath.c_str(), O_RDONLY | O_CLOEXEC, 0));
+    android::base::unique_fd fd(open(filePath, O_RDONLY | O_CLOEXEC, 0));
     if (fd < 0) {
-        ALOGW("Failed to open file: %s (%d)\n", filePath.c_str(), errno);
+        ALOGW("Failed to open file: %s (%d)\n", filePath, errno);
         return 0;
     }
 
     long flags = 0;
     ret = ioctl(fd, FS_IOC_GETFLAGS, &flags);
     if (ret < 0) {
-        ALOGW("Failed to get flags for file: %s (%d)\n", filePath.c_str(), errno);
+        ALOGW("Failed to get flags for file: %s (%d)\n", filePath, errno);
         return 0;
     }
     if ((flags & FS_COMPR_FL) == 0) {
@@ -70,15 +81,105 @@ static jlong com_android_internal_content_F2fsUtils_nativeReleaseCompressedBlock
     return blkcnt;
 }
 
+// Appends the regular files under |dirPath| to |files|, without following symlinks.
+static void listFilesRecursively(const std::string& dirPath, std::vector<std::string>* files) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(dirPath.c_str()), closedir);
+    if (dir == nullptr) {
+        ALOGW("Failed to open directory: %s (%d)\n", dirPath.c_str(), errno);
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir.get())) != nullptr) {
+        if (entry->d_name == "."sv || entry->d_name == ".."sv) {
+            continue;
+        }
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(dirfd(dir.get()), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                continue;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+        if (type == DT_DIR) {
+            listFilesRecursively(dirPath + '/' + entry->d_name, files);
+        } else if (type == DT_REG) {
+            files->push_back(dirPath + '/' + entry->d_name);
+        }
+    }
+}
+
+static jlong com_android_internal_content_F2fsUtils_nativeReleaseCompressedBlocks(JNIEnv *env,
+                                                                                  jclass clazz,
+                                                                                  jstring path) {
+    ScopedUtfChars filePath(env, path);
+    return releaseCompressedBlocks(filePath.c_str());
+}
+
+// Releases the compressed blocks of all the files under |path| on up to kMaxReleaseThreads
+// threads, instead of the caller walking the directory and releasing one file per call. Returns
+// how many bytes were released; files that fail are logged and skipped.
+static jlong com_android_internal_content_F2fsUtils_nativeReleaseCompressedBlocksRecursively(
+        JNIEnv *env, jclass clazz, jstring path) {
+    ScopedUtfChars dirPath(env, path);
+
+    struct statfs fs;
+    if (statfs(dirPath.c_str(), &fs) < 0) {
+        ALOGW("Failed to statfs: %s (%d)\n", dirPath.c_str(), errno);
+        return 0;
+    }
+
+    std::vector<std::string> files;
+    listFilesRecursively(dirPath.c_str(), &files);
+
+    std::atomic<size_t> nextFile = 0;
+    std::atomic<uint64_t> releasedBlocks = 0;
+    auto release = [&]() {
+        size_t i;
+        while ((i = nextFile++) < files.size()) {
+            const jlong blocks = releaseCompressedBlocks(files[i].c_str());
+            if (blocks < 0) {
+                ALOGW("Failed to release compressed blocks of: %s (%d)\n", files[i].c_str(),
+                      static_cast<int>(-blocks));
+            } else {
+                releasedBlocks += blocks;
+            }
+        }
+    };
+
+    const size_t threadCount = std::min({files.size(), kMaxReleaseThreads,
+                                         std::max<size_t>(std::thread::hardware_concurrency(), 1)});
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(release);
+    }
+    release();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    return releasedBlocks * fs.f_bsize;
+}
+
 static const std::array gMethods = {
         MAKE_JNI_NATIVE_METHOD(
                 "nativeReleaseCompressedBlocks", "(Ljava/lang/String;)J",
                 com_android_internal_content_F2fsUtils_nativeReleaseCompressedBlocks),
 };
 
+// Registered only if F2fsUtils declares them.
+static const std::array gOptionalMethods = {
+        MAKE_JNI_NATIVE_METHOD(
+                "nativeReleaseCompressedBlocksRecursively", "(Ljava/lang/String;)J",
+                com_android_internal_content_F2fsUtils_nativeReleaseCompressedBlocksRecursively),
+};
+
 int register_com_android_internal_content_F2fsUtils(JNIEnv *env) {
-    return RegisterMethodsOrDie(env, "com/android/internal/content/F2fsUtils", gMethods.data(),
-                                gMethods.size());
+    int res = RegisterMethodsOrDie(env, "com/android/internal/content/F2fsUtils", gMethods.data(),
+                                   gMethods.size());
+    RegisterOptionalMethods(env, "com/android/internal/content/F2fsUtils",
+                            gOptionalMethods.data(), gOptionalMethods.size());
+    return res;
 }
 
 }; // namespace android
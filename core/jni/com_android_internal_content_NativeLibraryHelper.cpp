@@ -17,6 +17,7 @@
 #define LOG_TAG "NativeLibraryHelper"
 //#define LOG_NDEBUG 0
 
+#include <android-base/unique_fd.h>
 #include <androidfw/ApkParsing.h>
 #include <androidfw/ZipFileRO.h>
 #include <androidfw/ZipUtils.h>
@@ -29,22 +30,42 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/xattr.h>
 #include <time.h>
 #include <unistd.h>
 #include <utils/Log.h>
 #include <zlib.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "core_jni_helpers.h"
 
 #define RS_BITCODE_SUFFIX ".bc"
 
 #define TMP_FILE_PATTERN "/tmp.XXXXXX"
-#define TMP_FILE_PATTERN_LEN (sizeof(TMP_FILE_PATTERN) - 1)
+
+// The CRC32 of the zip entry a library was extracted from, as an ExtractedLibraryStamp.
+#define EXTRACTED_CRC_XATTR "user.nativelib.crc32"
 
 namespace android {
 
+// Extracting more libraries at once barely helps once the storage is busy.
+static constexpr size_t kMaxExtractionThreads = 4;
+
+// Only vouches for the CRC of the file it was written to: a file whose size, modification time
+// or inode differs from the recorded ones is read back.
+struct ExtractedLibraryStamp {
+    uint32_t crc;
+    uint32_t size;
+    int64_t modifiedTime;
+    uint64_t inode;
+};
+
 // These match PackageManager.java install codes
 enum install_status_t {
     INSTALL_SUCCEEDED = 1,
@@ -82,6 +103,17 @@ isFileDifferent(const char* filePath, uint32_t fileSize, time_t modifiedTime,
         return true;
     }
 
+    // Libraries extracted by copyNativeBinaries() carry the CRC they were extracted with, which
+    // spares reading them back as long as the file is still the one it was recorded for.
+    ExtractedLibraryStamp stamp;
+    if (lgetxattr(filePath, EXTRACTED_CRC_XATTR, &stamp, sizeof(stamp)) == sizeof(stamp) &&
+            stamp.size == fileSize && stamp.modifiedTime == modifiedTime &&
+            stamp.inode == static_cast<uint64_t>(st->st_ino)) {
+        ALOGV("%s: extracted crc = %" PRIu32 ", zipCrc = %" PRIu32 "\n", filePath, stamp.crc,
+                zipCrc);
+        return stamp.crc != zipCrc;
+    }
+
     int fd = TEMP_FAILURE_RETRY(open(filePath, O_RDONLY | O_CLOEXEC));
     if (fd < 0) {
         ALOGV("Couldn't open file %s: %s", filePath, strerror(errno));
@@ -123,18 +155,41 @@ sumFiles(JNIEnv*, void* arg, ZipFileRO* zipFile, ZipEntryRO zipEntry, const char
 }
 
 /*
- * Copy the native library if needed.
+ * A native library that copyNativeBinaries() extracts, from the time it is found in the APK until
+ * it is renamed to its final name.
+ */
+struct NativeLibrary {
+    // The ZipEntryRO of the iteration doesn't outlive it, so the entry is looked up again by name.
+    std::string entryName;
+    std::string fileName;
+    std::string localFileName;
+    uint32_t uncompLen;
+    uint32_t crc;
+    time_t modTime;
+
+    // Set by extractNativeLibrary() when the library has to be replaced.
+    install_status_t status = INSTALL_SUCCEEDED;
+    std::string localTmpFileName;
+    base::unique_fd tmpFd;
+    time_t accessTime = 0;
+};
+
+struct NativeLibraryCopy {
+    std::string nativeLibPath;
+    bool extractNativeLibs;
+    std::vector<NativeLibrary> libraries;
+};
+
+/*
+ * Check a native library of the APK and, if it is to be extracted, add it to the libraries to
+ * copy.
  *
  * This function assumes the library and path names passed in are considered safe.
  */
 static install_status_t
-copyFileIfChanged(JNIEnv *env, void* arg, ZipFileRO* zipFile, ZipEntryRO zipEntry, const char* fileName)
+listFileToCopy(JNIEnv*, void* arg, ZipFileRO* zipFile, ZipEntryRO zipEntry, const char* fileName)
 {
-    void** args = reinterpret_cast<void**>(arg);
-    jstring* javaNativeLibPath = (jstring*) args[0];
-    jboolean extractNativeLibs = *(jboolean*) args[1];
-
-    ScopedUtfChars nativeLibPath(env, *javaNativeLibPath);
+    NativeLibraryCopy* copy = reinterpret_cast<NativeLibraryCopy*>(arg);
 
     uint32_t uncompLen;
     uint32_t when;
@@ -148,7 +203,7 @@ copyFileIfChanged(JNIEnv *env, void* arg, ZipFileRO* zipFile, ZipEntryRO zipEntr
         return INSTALL_FAILED_INVALID_APK;
     }
 
-    if (!extractNativeLibs) {
+    if (!copy->extractNativeLibs) {
         // check if library is uncompressed and page-aligned
         if (method != ZipFileRO::kCompressStored) {
             ALOGE("Library '%s' is compressed - will not be able to open it directly from apk.\n",
@@ -165,48 +220,48 @@ copyFileIfChanged(JNIEnv *env, void* arg, ZipFileRO* zipFile, ZipEntryRO zipEntr
         return INSTALL_SUCCEEDED;
     }
 
-    // Build local file path
-    const size_t fileNameLen = strlen(fileName);
-    char localFileName[nativeLibPath.size() + fileNameLen + 2];
+    struct tm t;
+    ZipUtils::zipTimeToTimespec(when, &t);
 
-    if (strlcpy(localFileName, nativeLibPath.c_str(), sizeof(localFileName)) != nativeLibPath.size()) {
-        ALOGE("Couldn't allocate local file name for library");
-        return INSTALL_FAILED_INTERNAL_ERROR;
+    char entryName[PATH_MAX];
+    if (zipFile->getEntryFileName(zipEntry, entryName, sizeof(entryName))) {
+        ALOGE("Couldn't read zip entry name\n");
+        return INSTALL_FAILED_INVALID_APK;
     }
 
-    *(localFileName + nativeLibPath.size()) = '/';
-
-    if (strlcpy(localFileName + nativeLibPath.size() + 1, fileName, sizeof(localFileName)
-                    - nativeLibPath.size() - 1) != fileNameLen) {
-        ALOGE("Couldn't allocate local file name for library");
-        return INSTALL_FAILED_INTERNAL_ERROR;
-    }
+    NativeLibrary& library = copy->libraries.emplace_back();
+    library.entryName = entryName;
+    library.fileName = fileName;
+    library.localFileName = copy->nativeLibPath + '/' + fileName;
+    library.uncompLen = uncompLen;
+    library.crc = crc;
+    library.modTime = mktime(&t);
+    return INSTALL_SUCCEEDED;
+}
 
+/*
+ * Extract the native library to a temporary file if it differs from the one already in place.
+ * The temporary file is left open for commitNativeLibrary().
+ *
+ * This runs on the extraction threads, concurrently with other libraries of the same APK:
+ * ZipFileRO reads the entries with pread(), and nothing else here is shared.
+ */
+static install_status_t
+extractNativeLibrary(ZipFileRO* zipFile, const std::string& nativeLibPath, NativeLibrary* library)
+{
     // Only copy out the native file if it's different.
-    struct tm t;
-    ZipUtils::zipTimeToTimespec(when, &t);
-    const time_t modTime = mktime(&t);
     struct stat64 st;
-    if (!isFileDifferent(localFileName, uncompLen, modTime, crc, &st)) {
+    if (!isFileDifferent(library->localFileName.c_str(), library->uncompLen, library->modTime,
+                library->crc, &st)) {
         return INSTALL_SUCCEEDED;
     }
+    library->accessTime = st.st_atime;
 
-    char localTmpFileName[nativeLibPath.size() + TMP_FILE_PATTERN_LEN + 1];
-    if (strlcpy(localTmpFileName, nativeLibPath.c_str(), sizeof(localTmpFileName))
-            != nativeLibPath.size()) {
-        ALOGE("Couldn't allocate local file name for library");
-        return INSTALL_FAILED_INTERNAL_ERROR;
-    }
-
-    if (strlcpy(localTmpFileName + nativeLibPath.size(), TMP_FILE_PATTERN,
-                    TMP_FILE_PATTERN_LEN + 1) != TMP_FILE_PATTERN_LEN) {
-        ALOGE("Couldn't allocate temporary file name for library");
-        return INSTALL_FAILED_INTERNAL_ERROR;
-    }
-
-    int fd = mkstemp(localTmpFileName);
+    std::string localTmpFileName = nativeLibPath + TMP_FILE_PATTERN;
+    base::unique_fd fd(mkstemp(localTmpFileName.data()));
     if (fd < 0) {
-        ALOGE("Couldn't open temporary file name: %s: %s\n", localTmpFileName, strerror(errno));
+        ALOGE("Couldn't open temporary file name: %s: %s\n", localTmpFileName.c_str(),
+                strerror(errno));
         return INSTALL_FAILED_CONTAINER_ERROR;
     }
 
@@ -214,59 +269,173 @@ copyFileIfChanged(JNIEnv *env, void* arg, ZipFileRO* zipFile, ZipEntryRO zipEntr
     // writes
     unsigned int flags;
     if (ioctl(fd, FS_IOC_GETFLAGS, &flags) == -1) {
-        ALOGE("Failed to call FS_IOC_GETFLAGS on %s: %s\n", localTmpFileName, strerror(errno));
+        ALOGE("Failed to call FS_IOC_GETFLAGS on %s: %s\n", localTmpFileName.c_str(),
+                strerror(errno));
     } else if ((flags & FS_COMPR_FL) == 0) {
         flags |= FS_COMPR_FL;
         ioctl(fd, FS_IOC_SETFLAGS, &flags);
     }
 
-    if (!zipFile->uncompressEntry(zipEntry, fd)) {
-        ALOGE("Failed uncompressing %s to %s\n", fileName, localTmpFileName);
-        close(fd);
-        unlink(localTmpFileName);
+    ZipEntryRO zipEntry = zipFile->findEntryByName(library->entryName.c_str());
+    const bool uncompressed = zipEntry != nullptr && zipFile->uncompressEntry(zipEntry, fd);
+    zipFile->releaseEntry(zipEntry);
+    if (!uncompressed) {
+        ALOGE("Failed uncompressing %s to %s\n", library->fileName.c_str(),
+                localTmpFileName.c_str());
+        fd.reset();
+        unlink(localTmpFileName.c_str());
         return INSTALL_FAILED_CONTAINER_ERROR;
     }
 
-    if (fsync(fd) < 0) {
-        ALOGE("Coulnd't fsync temporary file name: %s: %s\n", localTmpFileName, strerror(errno));
-        close(fd);
-        unlink(localTmpFileName);
-        return INSTALL_FAILED_INTERNAL_ERROR;
+    // Start the writeback now, so that it overlaps with the extraction of the other libraries
+    // and the fsync() of commitNativeLibrary() has little left to wait for.
+    sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+
+    library->localTmpFileName = std::move(localTmpFileName);
+    library->tmpFd = std::move(fd);
+    return INSTALL_SUCCEEDED;
+}
+
+/*
+ * Extract all the libraries that changed, on up to kMaxExtractionThreads threads including the
+ * calling one. Stops at the first failure, which is left in the status of its library.
+ */
+static void
+extractNativeLibraries(ZipFileRO* zipFile, NativeLibraryCopy* copy)
+{
+    std::vector<NativeLibrary>& libraries = copy->libraries;
+    std::atomic<size_t> nextLibrary = 0;
+    std::atomic<bool> failed = false;
+    auto extract = [&]() {
+        size_t i;
+        while (!failed && (i = nextLibrary++) < libraries.size()) {
+            libraries[i].status = extractNativeLibrary(zipFile, copy->nativeLibPath,
+                    &libraries[i]);
+            if (libraries[i].status != INSTALL_SUCCEEDED) {
+                failed = true;
+            }
+        }
+    };
+
+    const size_t threadCount = std::min({libraries.size(), kMaxExtractionThreads,
+            std::max<size_t>(std::thread::hardware_concurrency(), 1)});
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(extract);
+    }
+    extract();
+    for (std::thread& thread : threads) {
+        thread.join();
     }
+}
 
-    close(fd);
+/*
+ * Make the extracted library durable and move it to its final name.
+ */
+static install_status_t
+commitNativeLibrary(NativeLibrary* library)
+{
+    const char* localTmpFileName = library->localTmpFileName.c_str();
+    const char* localFileName = library->localFileName.c_str();
 
     // Set the modification time for this file to the ZIP's mod time.
-    struct timeval times[2];
-    times[0].tv_sec = st.st_atime;
-    times[1].tv_sec = modTime;
-    times[0].tv_usec = times[1].tv_usec = 0;
-    if (utimes(localTmpFileName, times) < 0) {
+    struct timespec times[2];
+    times[0].tv_sec = library->accessTime;
+    times[1].tv_sec = library->modTime;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    if (futimens(library->tmpFd, times) < 0) {
         ALOGE("Couldn't change modification time on %s: %s\n", localTmpFileName, strerror(errno));
-        unlink(localTmpFileName);
         return INSTALL_FAILED_CONTAINER_ERROR;
     }
 
     // Set the mode to 755
     static const mode_t mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP |  S_IXGRP | S_IROTH | S_IXOTH;
-    if (chmod(localTmpFileName, mode) < 0) {
+    if (fchmod(library->tmpFd, mode) < 0) {
         ALOGE("Couldn't change permissions on %s: %s\n", localTmpFileName, strerror(errno));
-        unlink(localTmpFileName);
         return INSTALL_FAILED_CONTAINER_ERROR;
     }
 
+    // Lets the next install skip this library without reading it back. isFileDifferent() falls
+    // back to computing the CRC when this fails.
+    struct stat64 st;
+    if (fstat64(library->tmpFd, &st) < 0) {
+        ALOGV("Couldn't stat %s: %s\n", localTmpFileName, strerror(errno));
+    } else {
+        const ExtractedLibraryStamp stamp{library->crc, library->uncompLen, library->modTime,
+                static_cast<uint64_t>(st.st_ino)};
+        if (fsetxattr(library->tmpFd, EXTRACTED_CRC_XATTR, &stamp, sizeof(stamp), 0) < 0) {
+            ALOGV("Couldn't set the CRC on %s: %s\n", localTmpFileName, strerror(errno));
+        }
+    }
+
+    if (fsync(library->tmpFd) < 0) {
+        ALOGE("Coulnd't fsync temporary file name: %s: %s\n", localTmpFileName, strerror(errno));
+        return INSTALL_FAILED_INTERNAL_ERROR;
+    }
+
+    library->tmpFd.reset();
+
     // Finally, rename it to the final name.
     if (rename(localTmpFileName, localFileName) < 0) {
         ALOGE("Couldn't rename %s to %s: %s\n", localTmpFileName, localFileName, strerror(errno));
-        unlink(localTmpFileName);
         return INSTALL_FAILED_CONTAINER_ERROR;
     }
 
     ALOGV("Successfully moved %s to %s\n", localTmpFileName, localFileName);
 
+    library->localTmpFileName.clear();
     return INSTALL_SUCCEEDED;
 }
 
+/*
+ * Copy the native libraries that changed: extract them all concurrently, then fsync and rename
+ * them, and fsync their directory once for all the renames.
+ */
+static install_status_t
+copyChangedFiles(ZipFileRO* zipFile, NativeLibraryCopy* copy)
+{
+    extractNativeLibraries(zipFile, copy);
+
+    install_status_t ret = INSTALL_SUCCEEDED;
+    for (const NativeLibrary& library : copy->libraries) {
+        if (library.status != INSTALL_SUCCEEDED) {
+            ALOGV("Failure for entry %s", library.fileName.c_str());
+            ret = library.status;
+            break;
+        }
+    }
+
+    bool renamed = false;
+    for (NativeLibrary& library : copy->libraries) {
+        if (ret != INSTALL_SUCCEEDED) {
+            break;
+        }
+        if (library.tmpFd >= 0) {
+            ret = commitNativeLibrary(&library);
+            renamed = true;
+        }
+    }
+
+    for (NativeLibrary& library : copy->libraries) {
+        if (!library.localTmpFileName.empty()) {
+            library.tmpFd.reset();
+            unlink(library.localTmpFileName.c_str());
+        }
+    }
+
+    if (ret == INSTALL_SUCCEEDED && renamed) {
+        base::unique_fd dirFd(TEMP_FAILURE_RETRY(open(copy->nativeLibPath.c_str(),
+                O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+        if (dirFd < 0 || fsync(dirFd) < 0) {
+            ALOGE("Couldn't fsync %s: %s\n", copy->nativeLibPath.c_str(), strerror(errno));
+            return INSTALL_FAILED_INTERNAL_ERROR;
+        }
+    }
+
+    return ret;
+}
+
 /*
  * An iterator over all shared libraries in a zip file. An entry is
  * considered to be a shared library if all of the conditions below are
@@ -431,9 +600,20 @@ com_android_internal_content_NativeLibraryHelper_copyNativeBinaries(JNIEnv *env,
         jlong apkHandle, jstring javaNativeLibPath, jstring javaCpuAbi,
         jboolean extractNativeLibs, jboolean debuggable)
 {
-    void* args[] = { &javaNativeLibPath, &extractNativeLibs };
-    return (jint) iterateOverNativeFiles(env, apkHandle, javaCpuAbi, debuggable,
-            copyFileIfChanged, reinterpret_cast<void*>(args));
+    const ScopedUtfChars nativeLibPath(env, javaNativeLibPath);
+    if (nativeLibPath.c_str() == nullptr) {
+        // This would've thrown, so this return code isn't observable by Java.
+        return INSTALL_FAILED_INVALID_APK;
+    }
+
+    NativeLibraryCopy copy{nativeLibPath.c_str(), extractNativeLibs == JNI_TRUE, {}};
+    install_status_t ret = iterateOverNativeFiles(env, apkHandle, javaCpuAbi, debuggable,
+            listFileToCopy, &copy);
+    if (ret != INSTALL_SUCCEEDED || copy.libraries.empty()) {
+        return (jint) ret;
+    }
+
+    return (jint) copyChangedFiles(reinterpret_cast<ZipFileRO*>(apkHandle), &copy);
 }
 
 static jlong
@@ -18,6 +18,11 @@
 
 #include <sys/sysinfo.h>
 
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <android-base/stringprintf.h>
 #include <cputimeinstate.h>
 
@@ -53,11 +58,117 @@ static void copy2DVecToArray(JNIEnv *env, jlongArray ar, std::vector<std::vector
     }
 }
 
+// Reads the times of all the updated UIDs into one flat array, instead of one SparseArray
+// entry per UID:
+//
+//   [uidCount, width, uid0, times0[0 .. width), uid1, times1[0 .. width), ...]
+//
+// The buffer the array is built from is reused across reads. In delta mode, the times are
+// those since the previous bulk read, and the UIDs whose times didn't change are left out.
+class BulkReader {
+public:
+    static constexpr size_t kHeaderSize = 2;
+
+    // The update time of the UIDs of the previous read.
+    uint64_t lastUpdate() const { return mLastUpdate; }
+
+    // Starts a read of the UIDs updated up to |newLastUpdate|. The totals are updated as the
+    // UIDs are added, so the next read starts from |newLastUpdate| even if this one fails.
+    void start(uint64_t newLastUpdate) {
+        mLastUpdate = newLastUpdate;
+        mOut.assign(kHeaderSize, 0);
+        mOut[1] = mWidth;
+        mHasRecords = false;
+    }
+
+    // Appends the times of |uid|, in ms. Returns false if they don't have the width of the
+    // other UIDs.
+    template <typename Times>
+    bool add(uint32_t uid, const Times &times, bool delta) {
+        const size_t start = mOut.size();
+        mOut.push_back(uid);
+        appendTimes(times);
+        const size_t width = mOut.size() - start - 1;
+        if (!mHasRecords && width != mWidth) {
+            // The times of another set of CPUs, or of another kernel: start over.
+            mWidth = width;
+            mOut[1] = width;
+            mTotals.clear();
+            mTotalsIndex.clear();
+        }
+        mHasRecords = true;
+        if (width != mWidth) return false;
+
+        auto [it, inserted] = mTotalsIndex.try_emplace(uid, mTotals.size());
+        if (inserted) mTotals.resize(mTotals.size() + mWidth, 0);
+        jlong *out = &mOut[start + 1];
+        jlong *totals = &mTotals[it->second];
+        bool changed = false;
+        for (size_t i = 0; i < mWidth; ++i) {
+            const jlong total = out[i];
+            if (delta) {
+                // The times of a removed and reused UID start again from zero.
+                out[i] = total >= totals[i] ? total - totals[i] : total;
+                changed |= out[i] != 0;
+            }
+            totals[i] = total;
+        }
+        if (delta && !changed) mOut.resize(start);
+        return true;
+    }
+
+    jlongArray finish(JNIEnv *env) {
+        mOut[0] = (mOut.size() - kHeaderSize) / (mWidth + 1);
+        jlongArray ar = env->NewLongArray(mOut.size());
+        if (ar != nullptr) env->SetLongArrayRegion(ar, 0, mOut.size(), mOut.data());
+        return ar;
+    }
+
+    // Forgets the totals of the UIDs in [startUid, endUid], once their times are cleared.
+    void removeUidRange(uint32_t startUid, uint32_t endUid) {
+        for (uint32_t uid = startUid; uid <= endUid; ++uid) {
+            auto it = mTotalsIndex.find(uid);
+            if (it != mTotalsIndex.end()) {
+                std::fill_n(mTotals.begin() + it->second, mWidth, 0);
+            }
+        }
+    }
+
+    std::mutex &lock() { return mLock; }
+
+private:
+    void appendTimes(const std::vector<uint64_t> &times) {
+        for (uint64_t time : times) mOut.push_back(time / NSEC_PER_MSEC);
+    }
+
+    void appendTimes(const std::vector<std::vector<uint64_t>> &times) {
+        for (const auto &subVec : times) appendTimes(subVec);
+    }
+
+    std::mutex mLock;
+    uint64_t mLastUpdate = 0;
+    size_t mWidth = 0;
+    bool mHasRecords = false;
+    // The totals of each UID at the previous read, at mTotals[mTotalsIndex[uid]], in ms.
+    std::unordered_map<uint32_t, size_t> mTotalsIndex;
+    std::vector<jlong> mTotals;
+    std::vector<jlong> mOut;
+};
+
+static BulkReader gFreqTimeBulkReader;
+static BulkReader gActiveTimeBulkReader;
+static BulkReader gClusterTimeBulkReader;
+
 static jboolean KernelCpuUidFreqTimeBpfMapReader_removeUidRange(JNIEnv *env, jclass, jint startUid,
                                                                 jint endUid) {
     for (uint32_t uid = startUid; uid <= endUid; ++uid) {
         if (!android::bpf::clearUidTimes(uid)) return false;
     }
+    for (BulkReader *reader :
+         {&gFreqTimeBulkReader, &gActiveTimeBulkReader, &gClusterTimeBulkReader}) {
+        std::lock_guard guard(reader->lock());
+        reader->removeUidRange(startUid, endUid);
+    }
     return true;
 }
 
@@ -82,11 +193,29 @@ static jboolean KernelCpuUidFreqTimeBpfMapReader_readBpfData(JNIEnv *env, jobjec
     return true;
 }
 
+static jlongArray KernelCpuUidFreqTimeBpfMapReader_readBpfDataBulk(JNIEnv *env, jobject,
+                                                                   jboolean delta) {
+    std::lock_guard guard(gFreqTimeBulkReader.lock());
+    uint64_t newLastUpdate = gFreqTimeBulkReader.lastUpdate();
+    auto data = android::bpf::getUidsUpdatedCpuFreqTimes(&newLastUpdate);
+    if (!data.has_value()) return nullptr;
+
+    gFreqTimeBulkReader.start(newLastUpdate);
+    for (const auto &[uid, times] : *data) {
+        if (!gFreqTimeBulkReader.add(uid, times, delta)) return nullptr;
+    }
+    return gFreqTimeBulkReader.finish(env);
+}
+
 static const JNINativeMethod gFreqTimeMethods[] = {
         {"removeUidRange", "(II)Z", (void *)KernelCpuUidFreqTimeBpfMapReader_removeUidRange},
         {"readBpfData", "()Z", (void *)KernelCpuUidFreqTimeBpfMapReader_readBpfData},
 };
 
+static const JNINativeMethod gFreqTimeBulkMethods[] = {
+        {"readBpfDataBulk", "(Z)[J", (void *)KernelCpuUidFreqTimeBpfMapReader_readBpfDataBulk},
+};
+
 static jboolean KernelCpuUidActiveTimeBpfMapReader_readBpfData(JNIEnv *env, jobject thiz) {
     static uint64_t lastUpdate = 0;
     uint64_t newLastUpdate = lastUpdate;
@@ -107,6 +236,20 @@ static jboolean KernelCpuUidActiveTimeBpfMapReader_readBpfData(JNIEnv *env, jobj
     return true;
 }
 
+static jlongArray KernelCpuUidActiveTimeBpfMapReader_readBpfDataBulk(JNIEnv *env, jobject,
+                                                                     jboolean delta) {
+    std::lock_guard guard(gActiveTimeBulkReader.lock());
+    uint64_t newLastUpdate = gActiveTimeBulkReader.lastUpdate();
+    auto data = android::bpf::getUidsUpdatedConcurrentTimes(&newLastUpdate);
+    if (!data.has_value()) return nullptr;
+
+    gActiveTimeBulkReader.start(newLastUpdate);
+    for (const auto &[uid, times] : *data) {
+        if (!gActiveTimeBulkReader.add(uid, times.active, delta)) return nullptr;
+    }
+    return gActiveTimeBulkReader.finish(env);
+}
+
 static jlongArray KernelCpuUidActiveTimeBpfMapReader_getDataDimensions(JNIEnv *env, jobject) {
     jlong nCpus = get_nprocs_conf();
 
@@ -120,6 +263,10 @@ static const JNINativeMethod gActiveTimeMethods[] = {
         {"getDataDimensions", "()[J", (void *)KernelCpuUidActiveTimeBpfMapReader_getDataDimensions},
 };
 
+static const JNINativeMethod gActiveTimeBulkMethods[] = {
+        {"readBpfDataBulk", "(Z)[J", (void *)KernelCpuUidActiveTimeBpfMapReader_readBpfDataBulk},
+};
+
 static jboolean KernelCpuUidClusterTimeBpfMapReader_readBpfData(JNIEnv *env, jobject thiz) {
     static uint64_t lastUpdate = 0;
     uint64_t newLastUpdate = lastUpdate;
@@ -141,6 +288,20 @@ static jboolean KernelCpuUidClusterTimeBpfMapReader_readBpfData(JNIEnv *env, job
     return true;
 }
 
+static jlongArray KernelCpuUidClusterTimeBpfMapReader_readBpfDataBulk(JNIEnv *env, jobject,
+                                                                      jboolean delta) {
+    std::lock_guard guard(gClusterTimeBulkReader.lock());
+    uint64_t newLastUpdate = gClusterTimeBulkReader.lastUpdate();
+    auto data = android::bpf::getUidsUpdatedConcurrentTimes(&newLastUpdate);
+    if (!data.has_value()) return nullptr;
+
+    gClusterTimeBulkReader.start(newLastUpdate);
+    for (const auto &[uid, times] : *data) {
+        if (!gClusterTimeBulkReader.add(uid, times.policy, delta)) return nullptr;
+    }
+    return gClusterTimeBulkReader.finish(env);
+}
+
 static jlongArray KernelCpuUidClusterTimeBpfMapReader_getDataDimensions(JNIEnv *env, jobject) {
     auto times = android::bpf::getUidConcurrentTimes(0);
     if (!times.has_value()) return nullptr;
@@ -158,16 +319,26 @@ static const JNINativeMethod gClusterTimeMethods[] = {
          (void *)KernelCpuUidClusterTimeBpfMapReader_getDataDimensions},
 };
 
+static const JNINativeMethod gClusterTimeBulkMethods[] = {
+        {"readBpfDataBulk", "(Z)[J", (void *)KernelCpuUidClusterTimeBpfMapReader_readBpfDataBulk},
+};
+
+// The bulk reads are only registered if the reader declares them.
 struct readerMethods {
     const char *name;
     const JNINativeMethod *methods;
     int numMethods;
+    const JNINativeMethod *bulkMethods;
+    int numBulkMethods;
 };
 
 static const readerMethods gAllMethods[] = {
-        {"KernelCpuUidFreqTimeBpfMapReader", gFreqTimeMethods, NELEM(gFreqTimeMethods)},
-        {"KernelCpuUidActiveTimeBpfMapReader", gActiveTimeMethods, NELEM(gActiveTimeMethods)},
-        {"KernelCpuUidClusterTimeBpfMapReader", gClusterTimeMethods, NELEM(gClusterTimeMethods)},
+        {"KernelCpuUidFreqTimeBpfMapReader", gFreqTimeMethods, NELEM(gFreqTimeMethods),
+         gFreqTimeBulkMethods, NELEM(gFreqTimeBulkMethods)},
+        {"KernelCpuUidActiveTimeBpfMapReader", gActiveTimeMethods, NELEM(gActiveTimeMethods),
+         gActiveTimeBulkMethods, NELEM(gActiveTimeBulkMethods)},
+        {"KernelCpuUidClusterTimeBpfMapReader", gClusterTimeMethods, NELEM(gClusterTimeMethods),
+         gClusterTimeBulkMethods, NELEM(gClusterTimeBulkMethods)},
 };
 
 int register_com_android_internal_os_KernelCpuUidBpfMapReader(JNIEnv *env) {
@@ -186,6 +357,7 @@ int register_com_android_internal_os_KernelCpuUidBpfMapReader(JNIEnv *env) {
         auto fullName = android::base::StringPrintf("%s$%s", readerName, m.name);
         ret = RegisterMethodsOrDie(env, fullName.c_str(), m.methods, m.numMethods);
         if (ret < 0) break;
+        RegisterOptionalMethods(env, fullName.c_str(), m.bulkMethods, m.numBulkMethods);
     }
     return ret;
 }
@@ -24,6 +24,7 @@
 
 #include "LongArrayMultiStateCounter.h"
 #include "core_jni_helpers.h"
+#include "long_array_utils.h"
 
 namespace android {
 
@@ -73,6 +74,33 @@ static void native_addCounts(jlong nativePtr, jlong longArrayContainerNativePtr)
     counter->addValue(*vector);
 }
 
+// Copies jarray into a vector that the calling thread reuses, so that updating a counter from a
+// long[] needs neither a LongArrayContainer nor an allocation.
+static const std::vector<uint64_t> *copyToScratchVector(JNIEnv *env, jlongArray jarray) {
+    thread_local std::vector<uint64_t> scratch;
+    scratch.resize(env->GetArrayLength(jarray));
+    env->GetLongArrayRegion(jarray, 0, scratch.size(), reinterpret_cast<jlong *>(scratch.data()));
+    return &scratch;
+}
+
+static void native_updateValuesFromArray(JNIEnv *env, jobject self, jlong nativePtr,
+                                         jlongArray jarray, jlong timestamp) {
+    battery::LongArrayMultiStateCounter *counter =
+            reinterpret_cast<battery::LongArrayMultiStateCounter *>(nativePtr);
+
+    // Boundary checks are performed in the Java layer
+    counter->updateValue(*copyToScratchVector(env, jarray), timestamp);
+}
+
+static void native_addCountsFromArray(JNIEnv *env, jobject self, jlong nativePtr,
+                                      jlongArray jarray) {
+    battery::LongArrayMultiStateCounter *counter =
+            reinterpret_cast<battery::LongArrayMultiStateCounter *>(nativePtr);
+
+    // Boundary checks are performed in the Java layer
+    counter->addValue(*copyToScratchVector(env, jarray));
+}
+
 static void native_reset(jlong nativePtr) {
     battery::LongArrayMultiStateCounter *counter =
             reinterpret_cast<battery::LongArrayMultiStateCounter *>(nativePtr);
@@ -219,6 +247,14 @@ static const JNINativeMethod g_LongArrayMultiStateCounter_methods[] = {
         {"native_getArrayLength", "(J)I", (void *)native_getArrayLength},
 };
 
+// Registered only if LongArrayMultiStateCounter declares them.
+static const JNINativeMethod g_LongArrayMultiStateCounter_array_methods[] = {
+        // @FastNative
+        {"native_updateValuesFromArray", "(J[JJ)V", (void *)native_updateValuesFromArray},
+        // @FastNative
+        {"native_addCountsFromArray", "(J[J)V", (void *)native_addCountsFromArray},
+};
+
 /////////////////////// LongArrayMultiStateCounter.LongArrayContainer ////////////////////////
 
 static void native_dispose_LongArrayContainer(jlong nativePtr) {
@@ -250,6 +286,21 @@ static void native_getValues_LongArrayContainer(JNIEnv *env, jobject self, jlong
     std::copy(vector->data(), vector->data() + vector->size(), scopedArray.get());
 }
 
+static void native_addValues_LongArrayContainer(JNIEnv *env, jobject self, jlong nativePtr,
+                                                jlongArray jarray) {
+    std::vector<uint64_t> *vector = reinterpret_cast<std::vector<uint64_t> *>(nativePtr);
+    void *array = env->GetPrimitiveArrayCritical(jarray, nullptr);
+
+    // Boundary checks are performed in the Java layer
+    addLongArrays(vector->data(), static_cast<const uint64_t *>(array), vector->size());
+    env->ReleasePrimitiveArrayCritical(jarray, array, JNI_ABORT);
+}
+
+static void native_scaleValues_LongArrayContainer(jlong nativePtr, jdouble scale) {
+    std::vector<uint64_t> *vector = reinterpret_cast<std::vector<uint64_t> *>(nativePtr);
+    scaleLongArray(vector->data(), vector->data(), vector->size(), scale);
+}
+
 static jboolean native_combineValues_LongArrayContainer(JNIEnv *env, jobject self, jlong nativePtr,
                                                         jlongArray jarray, jintArray jindexMap) {
     std::vector<uint64_t> *vector = reinterpret_cast<std::vector<uint64_t> *>(nativePtr);
@@ -295,15 +346,32 @@ static const JNINativeMethod g_LongArrayContainer_methods[] = {
         {"native_combineValues", "(J[J[I)Z", (void *)native_combineValues_LongArrayContainer},
 };
 
+// Registered only if LongArrayContainer declares them.
+static const JNINativeMethod g_LongArrayContainer_inplace_methods[] = {
+        // @FastNative
+        {"native_addValues", "(J[J)V", (void *)native_addValues_LongArrayContainer},
+        // @CriticalNative
+        {"native_scaleValues", "(JD)V", (void *)native_scaleValues_LongArrayContainer},
+};
+
 int register_com_android_internal_os_LongArrayMultiStateCounter(JNIEnv *env) {
     // 0 represents success, thus "|" and not "&"
-    return RegisterMethodsOrDie(env, "com/android/internal/os/LongArrayMultiStateCounter",
-                                g_LongArrayMultiStateCounter_methods,
-                                NELEM(g_LongArrayMultiStateCounter_methods)) |
+    int res = RegisterMethodsOrDie(env, "com/android/internal/os/LongArrayMultiStateCounter",
+                                   g_LongArrayMultiStateCounter_methods,
+                                   NELEM(g_LongArrayMultiStateCounter_methods)) |
             RegisterMethodsOrDie(env,
                                  "com/android/internal/os/LongArrayMultiStateCounter"
                                  "$LongArrayContainer",
                                  g_LongArrayContainer_methods, NELEM(g_LongArrayContainer_methods));
+    RegisterOptionalMethods(env, "com/android/internal/os/LongArrayMultiStateCounter",
+                            g_LongArrayMultiStateCounter_array_methods,
+                            NELEM(g_LongArrayMultiStateCounter_array_methods));
+    RegisterOptionalMethods(env,
+                            "com/android/internal/os/LongArrayMultiStateCounter"
+                            "$LongArrayContainer",
+                            g_LongArrayContainer_inplace_methods,
+                            NELEM(g_LongArrayContainer_inplace_methods));
+    return res;
 }
 
 } // namespace android
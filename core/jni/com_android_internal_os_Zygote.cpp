@@ -30,6 +30,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <iterator>
 #include <list>
@@ -91,6 +92,7 @@
 #include "core_jni_helpers.h"
 #include "fd_utils.h"
 #include "filesystem_utils.h"
+#include "prefault_utils.h"
 
 #include "nativebridge/native_bridge.h"
 
@@ -111,6 +113,7 @@ using android::base::StringAppendF;
 using android::base::StringPrintf;
 using android::base::WriteStringToFile;
 using android::base::GetBoolProperty;
+using android::base::GetProperty;
 
 using android::zygote::ZygoteFailure;
 
@@ -329,6 +332,20 @@ static std::array<UsapTableEntry, USAP_POOL_SIZE_MAX_LIMIT> gUsapTable;
  */
 static FileDescriptorTable* gOpenFdTable = nullptr;
 
+/**
+ * The steady clock time at which the fork of this child started, in nanoseconds, or 0 when it
+ * wasn't recorded. See zygote::SetForkStartTime.
+ */
+static int64_t gForkStartTimeNs = 0;
+
+/**
+ * The pages that apps prefault once they're specialized, loaded from the file named by
+ * kPrefaultProfileProperty before the first fork. See PrefaultProfile.
+ */
+static const char kPrefaultProfileProperty[] = "persist.zygote.prefault_profile";
+static PrefaultProfile* gPrefaultProfile = nullptr;
+static bool gPrefaultProfileLoaded = false;
+
 // Must match values in com.android.internal.os.Zygote.
 // The values should be consistent with IVold.aidl
 enum MountExternalKind {
@@ -2011,6 +2028,20 @@ static void SpecializeCommon(JNIEnv* env, uid_t uid, gid_t gid, jintArray gids,
     if (env->ExceptionCheck()) {
         fail_fn("Error calling post fork hooks.");
     }
+
+    if (!is_system_server && gPrefaultProfile != nullptr) {
+        gPrefaultProfile->ApplyAsync();
+    }
+
+    if (gForkStartTimeNs != 0) {
+        const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count();
+        ALOGD("Specialized %s %" PRId64 " us after the fork started",
+              nice_name_ptr != nullptr ? nice_name_ptr : process_name,
+              (now_ns - gForkStartTimeNs) / 1000);
+        gForkStartTimeNs = 0;
+    }
 }
 
 static uint64_t GetEffectiveCapabilityMask(JNIEnv* env) {
@@ -2246,6 +2277,10 @@ void zygote::ZygoteFailure(JNIEnv* env,
   __builtin_unreachable();
 }
 
+void zygote::SetForkStartTime(int64_t fork_start_ns) {
+  gForkStartTimeNs = fork_start_ns;
+}
+
 static std::set<int>* gPreloadFds = nullptr;
 static bool gPreloadFdsExtracted = false;
 
@@ -2275,6 +2310,16 @@ pid_t zygote::ForkCommon(JNIEnv* env, bool is_system_server,
   // Note that the zygote process is single threaded at this point.
   BlockSignal(SIGCHLD, fail_fn);
 
+  // Load the prefault profile while logging is still allowed. Its file is
+  // closed before the open FD table is checked below.
+  if (!gPrefaultProfileLoaded) {
+    gPrefaultProfileLoaded = true;
+    const std::string profile_path = GetProperty(kPrefaultProfileProperty, "");
+    if (!profile_path.empty()) {
+      gPrefaultProfile = PrefaultProfile::Load(profile_path).release();
+    }
+  }
+
   // Close any logging related FDs before we start evaluating the list of
   // file descriptors.
   __android_log_close();
@@ -60,6 +60,12 @@ int forkApp(JNIEnv* env,
             bool is_priority_fork,
             bool purge);
 
+/**
+ * Records, in a child forked by the command buffer fast path, the steady clock time at which
+ * its fork started, so that specializing it logs how long the child took to become the app.
+ */
+void SetForkStartTime(int64_t fork_start_ns);
+
 [[noreturn]]
 void ZygoteFailure(JNIEnv* env,
                    const char* process_name,
@@ -289,6 +289,47 @@ class NativeCommandBuffer {
 
 static int buffersAllocd(0);
 
+// Time spent in each phase of the forks handled by nativeForkRepeatedly, so that slow app starts
+// can be attributed to reading the command count, parsing the arguments as they are read, or
+// forking. Specialization happens in the child, which reports it from SpecializeCommon.
+class ForkPhaseStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Number of forks over which the averages are logged.
+  static constexpr int LOG_INTERVAL = 32;
+
+  void addRead(Clock::time_point start, Clock::time_point end) { mRead += end - start; }
+  void addParse(Clock::time_point start, Clock::time_point end) { mParse += end - start; }
+
+  void addFork(Clock::time_point start, Clock::time_point end) {
+    mFork += end - start;
+    if (++mForks == LOG_INTERVAL) {
+      log();
+    }
+  }
+
+  void log() {
+    if (mForks == 0) {
+      return;
+    }
+    ALOGI("forkRepeatedly: %d forks, average read %lld us, parse %lld us, fork %lld us",
+          mForks, averageUs(mRead), averageUs(mParse), averageUs(mFork));
+    *this = ForkPhaseStats();
+  }
+
+ private:
+  long long averageUs(Clock::duration total) const {
+    return static_cast<long long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(total).count() / mForks);
+  }
+
+  Clock::duration mRead{};
+  Clock::duration mParse{};
+  Clock::duration mFork{};
+  int mForks = 0;
+};
+
 // Get a new NativeCommandBuffer. Can only be called once between freeNativeBuffer calls,
 // so that only one buffer exists at a time.
 jlong com_android_internal_os_ZygoteCommandBuffer_getNativeBuffer(JNIEnv* env, jclass, jint fd) {
@@ -420,17 +461,23 @@ jboolean com_android_internal_os_ZygoteCommandBuffer_nativeForkRepeatedly(
                            strerror(errno)));
   }
 
+  ForkPhaseStats stats;
   bool first_time = true;
+  bool is_simple;
   do {
     if (credentials.uid != expected_uid) {
+      stats.log();
       return JNI_FALSE;
     }
     n_buffer->readAllLines(first_time ? fail_fn_1 : fail_fn_n);
     n_buffer->reset();
+    auto fork_start = ForkPhaseStats::Clock::now();
     int pid = zygote::forkApp(env, /* no pipe FDs */ -1, -1, session_socket_fds,
                               /*args_known=*/ true, /*is_priority_fork=*/ true,
                               /*purge=*/ first_time);
     if (pid == 0) {
+      zygote::SetForkStartTime(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          fork_start.time_since_epoch()).count());
       return JNI_TRUE;
     }
     // We're in the parent. Write big-endian pid, followed by a boolean.
@@ -451,13 +498,19 @@ jboolean com_android_internal_os_ZygoteCommandBuffer_nativeForkRepeatedly(
             (CREATE_ERROR("Write unexpectedly returned short: %d < 5", res));
       }
     }
+    stats.addFork(fork_start, ForkPhaseStats::Clock::now());
     // Clear buffer and get count from next command.
     n_buffer->clear();
+    ForkPhaseStats::Clock::time_point read_end;
     for (;;) {
       // Poll isn't strictly necessary for now. But without it, disconnect is hard to detect.
       int poll_res = TEMP_FAILURE_RETRY(poll(fd_structs, 2, -1 /* infinite timeout */));
       if ((fd_structs[SESSION_IDX].revents & POLLIN) != 0) {
+        // Only the time after the command arrives counts; waiting for it is idle time.
+        auto read_start = ForkPhaseStats::Clock::now();
         if (n_buffer->getCount(fail_fn_z) != 0) {
+          read_end = ForkPhaseStats::Clock::now();
+          stats.addRead(read_start, read_end);
           break;
         }  // else disconnected;
       } else if (poll_res == 0 || (fd_structs[ZYGOTE_IDX].revents & POLLIN) == 0) {
@@ -498,7 +551,10 @@ jboolean com_android_internal_os_ZygoteCommandBuffer_nativeForkRepeatedly(
       }
     }
     first_time = false;
-  } while (n_buffer->isSimpleForkCommand(minUid, fail_fn_n));
+    is_simple = n_buffer->isSimpleForkCommand(minUid, fail_fn_n);
+    stats.addParse(read_end, ForkPhaseStats::Clock::now());
+  } while (is_simple);
+  stats.log();
   ALOGW("forkRepeatedly terminated due to non-simple command");
   n_buffer->logState();
   n_buffer->reset();
@@ -23,6 +23,7 @@
 #include <linux/fsverity.h>
 #include <linux/stat.h>
 #include <nativehelper/JNIHelp.h>
+#include <nativehelper/ScopedLocalRef.h>
 #include <nativehelper/ScopedUtfChars.h>
 #include <string.h>
 #include <sys/ioctl.h>
@@ -30,19 +31,27 @@
 #include <sys/types.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
+#include "core_jni_helpers.h"
 #include "jni.h"
 
 namespace android {
 
 namespace {
 
-int enableFsverityForFd(JNIEnv *env, jobject clazz, jint fd) {
-    if (fd < 0) {
-        return errno;
-    }
+// Threads of enableAndMeasureFsverity(), including the calling one. The kernel builds each Merkle
+// tree on the thread that enables fs-verity, and more threads mostly compete for the storage.
+constexpr size_t kMaxVerityThreads = 4;
+
+constexpr auto kDigestSha256 = 32;
 
+int enableFsverityOnFd(int fd) {
     fsverity_enable_arg arg = {};
     arg.version = 1;
     arg.hash_algorithm = FS_VERITY_HASH_ALG_SHA256; // hardcoded in measureFsverity below
@@ -56,13 +65,23 @@ int enableFsverityForFd(JNIEnv *env, jobject clazz, jint fd) {
     return 0;
 }
 
+int enableFsverityForFd(JNIEnv *env, jobject clazz, jint fd) {
+    if (fd < 0) {
+        return errno;
+    }
+    return enableFsverityOnFd(fd);
+}
+
 int enableFsverity(JNIEnv *env, jobject clazz, jstring filePath) {
     ScopedUtfChars path(env, filePath);
     if (path.c_str() == nullptr) {
         return EINVAL;
     }
     ::android::base::unique_fd rfd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
-    return enableFsverityForFd(env, clazz, rfd.get());
+    if (rfd.get() < 0) {
+        return errno;
+    }
+    return enableFsverityOnFd(rfd.get());
 }
 
 // Returns whether the file has fs-verity enabled.
@@ -97,37 +116,114 @@ int statxForFsverity(JNIEnv *env, jobject /* clazz */, jstring filePath) {
     return (flags & FS_VERITY_FL) != 0;
 }
 
-int measureFsverity(JNIEnv *env, jobject /* clazz */, jstring filePath, jbyteArray digest) {
-    static constexpr auto kDigestSha256 = 32;
+// Reads the SHA-256 fs-verity digest of the file into |digest|, which holds kDigestSha256 bytes.
+// Returns 0 or -errno.
+int measureFsverityForFd(int fd, uint8_t *digest) {
     using Storage = std::aligned_storage_t<sizeof(fsverity_digest) + kDigestSha256>;
 
     Storage bytes;
     fsverity_digest *data = reinterpret_cast<fsverity_digest *>(&bytes);
     data->digest_size = kDigestSha256; // the only input/output parameter
 
+    if (::ioctl(fd, FS_IOC_MEASURE_VERITY, data) < 0) {
+        return -errno;
+    }
+
+    if (data->digest_algorithm != FS_VERITY_HASH_ALG_SHA256 ||
+        data->digest_size != kDigestSha256) {
+        return -EINVAL;
+    }
+
+    memcpy(digest, data->digest, kDigestSha256);
+    return 0;
+}
+
+int measureFsverity(JNIEnv *env, jobject /* clazz */, jstring filePath, jbyteArray digest) {
     ScopedUtfChars path(env, filePath);
     ::android::base::unique_fd rfd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
     if (rfd.get() < 0) {
         return -errno;
     }
-    if (::ioctl(rfd.get(), FS_IOC_MEASURE_VERITY, data) < 0) {
-        return -errno;
-    }
 
-    if (data->digest_algorithm != FS_VERITY_HASH_ALG_SHA256) {
-        return -EINVAL;
+    uint8_t bytes[kDigestSha256];
+    if (int error = measureFsverityForFd(rfd.get(), bytes); error != 0) {
+        return error;
     }
 
-    if (digest != nullptr && data->digest_size > 0) {
+    if (digest != nullptr) {
         auto digestSize = env->GetArrayLength(digest);
-        if (data->digest_size > digestSize) {
+        if (kDigestSha256 > digestSize) {
             return -E2BIG;
         }
-        env->SetByteArrayRegion(digest, 0, data->digest_size, (const jbyte *)data->digest);
+        env->SetByteArrayRegion(digest, 0, kDigestSha256, (const jbyte *)bytes);
     }
 
     return 0;
 }
+
+// Enables fs-verity on each of |filePaths|, unless it already is, and measures it, on up to
+// kMaxVerityThreads threads so that the Merkle trees of the splits of an APK are built at once.
+// Fills |errors| with 0 or the errno that failed each file, and |digests| with the SHA-256
+// digests of those that succeeded, kDigestSha256 bytes each in the order of |filePaths|.
+// Returns 0, or -EINVAL or -E2BIG when the arrays don't fit the paths.
+int enableAndMeasureFsverity(JNIEnv *env, jobject /* clazz */, jobjectArray filePaths,
+                             jbyteArray digests, jintArray errors) {
+    if (filePaths == nullptr || digests == nullptr || errors == nullptr) {
+        return -EINVAL;
+    }
+    const size_t count = env->GetArrayLength(filePaths);
+    if (static_cast<size_t>(env->GetArrayLength(digests)) < count * kDigestSha256 ||
+        static_cast<size_t>(env->GetArrayLength(errors)) < count) {
+        return -E2BIG;
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        ScopedLocalRef<jstring> filePath(env,
+                static_cast<jstring>(env->GetObjectArrayElement(filePaths, i)));
+        ScopedUtfChars path(env, filePath.get());
+        if (path.c_str() == nullptr) {
+            return -EINVAL;
+        }
+        paths.emplace_back(path.c_str());
+    }
+
+    std::vector<uint8_t> results(count * kDigestSha256);
+    std::vector<jint> resultErrors(count);
+    std::atomic<size_t> next = 0;
+    auto enableAndMeasure = [&]() {
+        size_t i;
+        while ((i = next++) < count) {
+            ::android::base::unique_fd rfd(open(paths[i].c_str(), O_RDONLY | O_CLOEXEC));
+            if (rfd.get() < 0) {
+                resultErrors[i] = errno;
+                continue;
+            }
+            int error = enableFsverityOnFd(rfd.get());
+            if (error == 0 || error == EEXIST) {
+                error = -measureFsverityForFd(rfd.get(), &results[i * kDigestSha256]);
+            }
+            resultErrors[i] = error;
+        }
+    };
+
+    const size_t threadCount = std::min({count, kMaxVerityThreads,
+                                         std::max<size_t>(std::thread::hardware_concurrency(), 1)});
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(enableAndMeasure);
+    }
+    enableAndMeasure();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    env->SetByteArrayRegion(digests, 0, results.size(), (const jbyte *)results.data());
+    env->SetIntArrayRegion(errors, 0, count, resultErrors.data());
+    return 0;
+}
+
 const JNINativeMethod sMethods[] = {
         {"enableFsverityNative", "(Ljava/lang/String;)I", (void *)enableFsverity},
         {"enableFsverityForFdNative", "(I)I", (void *)enableFsverityForFd},
@@ -135,11 +231,20 @@ const JNINativeMethod sMethods[] = {
         {"measureFsverityNative", "(Ljava/lang/String;[B)I", (void *)measureFsverity},
 };
 
+// Registered only if VerityUtils declares them.
+const JNINativeMethod sOptionalMethods[] = {
+        {"enableAndMeasureFsverityNative", "([Ljava/lang/String;[B[I)I",
+         (void *)enableAndMeasureFsverity},
+};
+
 } // namespace
 
 int register_com_android_internal_security_VerityUtils(JNIEnv *env) {
-    return jniRegisterNativeMethods(env, "com/android/internal/security/VerityUtils", sMethods,
-                                    NELEM(sMethods));
+    int res = jniRegisterNativeMethods(env, "com/android/internal/security/VerityUtils", sMethods,
+                                       NELEM(sMethods));
+    RegisterOptionalMethods(env, "com/android/internal/security/VerityUtils", sOptionalMethods,
+                            NELEM(sOptionalMethods));
+    return res;
 }
 
 } // namespace android
@@ -22,6 +22,8 @@
 #include <nativehelper/scoped_utf_chars.h>
 #include <android_runtime/AndroidRuntime.h>
 
+#include "modified_utf8.h"
+
 // Host targets (layoutlib) do not differentiate between regular and critical native methods,
 // and they need all the JNI methods to have JNIEnv* and jclass/jobject as their first two arguments.
 // The following macro allows to have those arguments when compiling for host while omitting them when
@@ -90,6 +92,25 @@ static inline int RegisterMethodsOrDie(JNIEnv* env, const char* className,
     return res;
 }
 
+/**
+ * Registers native methods that the Java class may not declare, one at a time, so that a missing
+ * one is skipped instead of failing the whole registration. Returns how many were registered.
+ */
+static inline int RegisterOptionalMethods(JNIEnv* env, const char* className,
+                                          const JNINativeMethod* gMethods, int numMethods) {
+    ScopedLocalRef<jclass> clazz(env, env->FindClass(className));
+    LOG_ALWAYS_FATAL_IF(clazz == NULL, "Unable to find class %s", className);
+    int registered = 0;
+    for (int i = 0; i < numMethods; i++) {
+        if (env->RegisterNatives(clazz.get(), &gMethods[i], 1) == JNI_OK) {
+            registered++;
+        } else {
+            env->ExceptionClear();
+        }
+    }
+    return registered;
+}
+
 /**
  * Returns the result of invoking java.lang.ref.Reference.get() on a Reference object.
  */
@@ -30,6 +30,7 @@
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <android-base/unique_fd.h>
 
 // Static allowlist of open paths that the zygote is allowed to keep open.
 static const char* kPathAllowlist[] = {
@@ -182,7 +183,9 @@ class FileDescriptorInfo {
   // the same description.
   bool RefersToSameFile() const;
 
-  void ReopenOrDetach(fail_fn_t fail_fn) const;
+  // Reopens the file, or points the socket at |dev_null_fd|, which is opened
+  // lazily so that it's shared by all the sockets of a table.
+  void ReopenOrDetach(android::base::unique_fd* dev_null_fd, fail_fn_t fail_fn) const;
 
   const int fd;
   const struct stat stat;
@@ -210,7 +213,7 @@ class FileDescriptorInfo {
   //   address).
   static bool GetSocketName(const int fd, std::string* result);
 
-  void DetachSocket(fail_fn_t fail_fn) const;
+  void DetachSocket(android::base::unique_fd* dev_null_fd, fail_fn_t fail_fn) const;
 
   DISALLOW_COPY_AND_ASSIGN(FileDescriptorInfo);
 };
@@ -330,9 +333,10 @@ bool FileDescriptorInfo::RefersToSameFile() const {
   return f_stat.st_ino == stat.st_ino && f_stat.st_dev == stat.st_dev;
 }
 
-void FileDescriptorInfo::ReopenOrDetach(fail_fn_t fail_fn) const {
+void FileDescriptorInfo::ReopenOrDetach(android::base::unique_fd* dev_null_fd,
+                                        fail_fn_t fail_fn) const {
   if (is_sock) {
-    return DetachSocket(fail_fn);
+    return DetachSocket(dev_null_fd, fail_fn);
   }
 
   // Children can directly use the in-memory file created by ART through memfd_create.
@@ -343,7 +347,10 @@ void FileDescriptorInfo::ReopenOrDetach(fail_fn_t fail_fn) const {
   // NOTE: This might happen if the file was unlinked after being opened.
   // It's a common pattern in the case of temporary files and the like but
   // we should not allow such usage from the zygote.
-  const int new_fd = TEMP_FAILURE_RETRY(open(file_path.c_str(), open_flags));
+  //
+  // The descriptor flags are only FD_CLOEXEC, which dup3() below sets on |fd|,
+  // so |new_fd| itself is always opened close-on-exec.
+  const int new_fd = TEMP_FAILURE_RETRY(open(file_path.c_str(), open_flags | O_CLOEXEC));
 
   if (new_fd == -1) {
     fail_fn(android::base::StringPrintf("Failed open(%s, %i): %s",
@@ -352,16 +359,11 @@ void FileDescriptorInfo::ReopenOrDetach(fail_fn_t fail_fn) const {
                                         strerror(errno)));
   }
 
-  if (TEMP_FAILURE_RETRY(fcntl(new_fd, F_SETFD, fd_flags)) == -1) {
-    close(new_fd);
-    fail_fn(android::base::StringPrintf("Failed fcntl(%d, F_SETFD, %d) (%s): %s",
-                                        new_fd,
-                                        fd_flags,
-                                        file_path.c_str(),
-                                        strerror(errno)));
-  }
-
-  if (TEMP_FAILURE_RETRY(fcntl(new_fd, F_SETFL, fs_flags)) == -1) {
+  // open() sets none of the flags F_SETFL can change, so there's only something
+  // to do if the original description had any of them.
+  static const int kSettableFlags = (O_APPEND | O_ASYNC | O_DIRECT | O_NOATIME | O_NONBLOCK);
+  if ((fs_flags & kSettableFlags) != 0 &&
+      TEMP_FAILURE_RETRY(fcntl(new_fd, F_SETFL, fs_flags)) == -1) {
     close(new_fd);
     fail_fn(android::base::StringPrintf("Failed fcntl(%d, F_SETFL, %d) (%s): %s",
                                         new_fd,
@@ -458,41 +460,44 @@ bool FileDescriptorInfo::GetSocketName(const int fd, std::string* result) {
   return true;
 }
 
-void FileDescriptorInfo::DetachSocket(fail_fn_t fail_fn) const {
-  const int dev_null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
-  if (dev_null_fd < 0) {
-    fail_fn(std::string("Failed to open /dev/null: ").append(strerror(errno)));
+void FileDescriptorInfo::DetachSocket(android::base::unique_fd* dev_null_fd,
+                                      fail_fn_t fail_fn) const {
+  if (*dev_null_fd == -1) {
+    dev_null_fd->reset(open("/dev/null", O_RDWR | O_CLOEXEC));
+    if (*dev_null_fd == -1) {
+      fail_fn(std::string("Failed to open /dev/null: ").append(strerror(errno)));
+    }
   }
 
-  if (dup3(dev_null_fd, fd, O_CLOEXEC) == -1) {
+  if (dup3(dev_null_fd->get(), fd, O_CLOEXEC) == -1) {
     fail_fn(android::base::StringPrintf("Failed dup3 on socket descriptor %d: %s",
                                         fd,
                                         strerror(errno)));
   }
-
-  if (close(dev_null_fd) == -1) {
-    fail_fn(android::base::StringPrintf("Failed close(%d): %s", dev_null_fd, strerror(errno)));
-  }
 }
 
 // TODO: Move the definitions here and eliminate the forward declarations. They
 // temporarily help making code reviews easier.
 static int ParseFd(dirent* dir_entry, int dir_fd);
-static std::unique_ptr<std::set<int>> GetOpenFdsIgnoring(const std::vector<int>& fds_to_ignore,
-                                                         fail_fn_t fail_fn);
+static void GetOpenFdsIgnoring(const std::vector<int>& fds_to_ignore, std::vector<int>* result,
+                               fail_fn_t fail_fn);
 
 FileDescriptorTable* FileDescriptorTable::Create(const std::vector<int>& fds_to_ignore,
                                                  fail_fn_t fail_fn) {
-  std::unique_ptr<std::set<int>> open_fds = GetOpenFdsIgnoring(fds_to_ignore, fail_fn);
+  std::vector<int> open_fds;
+  GetOpenFdsIgnoring(fds_to_ignore, &open_fds, fail_fn);
   std::unordered_map<int, FileDescriptorInfo*> open_fd_map;
-  for (auto fd : *open_fds) {
+  open_fd_map.reserve(open_fds.size());
+  for (auto fd : open_fds) {
     open_fd_map[fd] = FileDescriptorInfo::CreateFromFd(fd, fail_fn);
   }
   return new FileDescriptorTable(open_fd_map);
 }
 
-static std::unique_ptr<std::set<int>> GetOpenFdsIgnoring(const std::vector<int>& fds_to_ignore,
-                                                         fail_fn_t fail_fn) {
+// Fills |result| with the sorted open FDs. |result| is reused across forks so
+// that listing the FDs doesn't allocate once it's grown to the table size.
+static void GetOpenFdsIgnoring(const std::vector<int>& fds_to_ignore, std::vector<int>* result,
+                               fail_fn_t fail_fn) {
   DIR* proc_fd_dir = opendir(kFdPath);
   if (proc_fd_dir == nullptr) {
     fail_fn(android::base::StringPrintf("Unable to open directory %s: %s",
@@ -500,7 +505,7 @@ static std::unique_ptr<std::set<int>> GetOpenFdsIgnoring(const std::vector<int>&
                                         strerror(errno)));
   }
 
-  auto result = std::make_unique<std::set<int>>();
+  result->clear();
   int dir_fd = dirfd(proc_fd_dir);
   dirent* dir_entry;
   while ((dir_entry = readdir(proc_fd_dir)) != nullptr) {
@@ -513,37 +518,39 @@ static std::unique_ptr<std::set<int>> GetOpenFdsIgnoring(const std::vector<int>&
       continue;
     }
 
-    result->insert(fd);
+    result->push_back(fd);
   }
 
   if (closedir(proc_fd_dir) == -1) {
     fail_fn(android::base::StringPrintf("Unable to close directory: %s", strerror(errno)));
   }
-  return result;
+  std::sort(result->begin(), result->end());
 }
 
 std::unique_ptr<std::set<int>> GetOpenFds(fail_fn_t fail_fn) {
   const std::vector<int> nothing_to_ignore;
-  return GetOpenFdsIgnoring(nothing_to_ignore, fail_fn);
+  std::vector<int> open_fds;
+  GetOpenFdsIgnoring(nothing_to_ignore, &open_fds, fail_fn);
+  return std::make_unique<std::set<int>>(open_fds.begin(), open_fds.end());
 }
 
 void FileDescriptorTable::Restat(const std::vector<int>& fds_to_ignore, fail_fn_t fail_fn) {
-  std::unique_ptr<std::set<int>> open_fds = GetOpenFdsIgnoring(fds_to_ignore, fail_fn);
+  GetOpenFdsIgnoring(fds_to_ignore, &open_fds_, fail_fn);
 
-  // Check that the files did not change, and leave only newly opened FDs in
-  // |open_fds|.
-  RestatInternal(*open_fds, fail_fn);
+  // Check that the files did not change, and add the newly opened FDs.
+  RestatInternal(open_fds_, fail_fn);
 }
 
 // Reopens all file descriptors that are contained in the table.
 void FileDescriptorTable::ReopenOrDetach(fail_fn_t fail_fn) {
+  android::base::unique_fd dev_null_fd;
   std::unordered_map<int, FileDescriptorInfo*>::const_iterator it;
   for (it = open_fd_map_.begin(); it != open_fd_map_.end(); ++it) {
     const FileDescriptorInfo* info = it->second;
     if (info == nullptr) {
       return;
     } else {
-      info->ReopenOrDetach(fail_fn);
+      info->ReopenOrDetach(&dev_null_fd, fail_fn);
     }
   }
 }
@@ -559,7 +566,7 @@ FileDescriptorTable::~FileDescriptorTable() {
     }
 }
 
-void FileDescriptorTable::RestatInternal(std::set<int>& open_fds, fail_fn_t fail_fn) {
+void FileDescriptorTable::RestatInternal(const std::vector<int>& open_fds, fail_fn_t fail_fn) {
   // ART creates a file through memfd for optimization purposes. We make sure
   // there is at most one being created.
   bool art_memfd_seen = false;
@@ -570,11 +577,13 @@ void FileDescriptorTable::RestatInternal(std::set<int>& open_fds, fail_fn_t fail
   // (a) they continue to be open.
   // (b) they refer to the same file.
   //
+  // (b) is checked against the st_dev and st_ino recorded when the entry was
+  // created, so an entry is only collected again when its FD was reused.
+  //
   // We'll only store the last error message.
   std::unordered_map<int, FileDescriptorInfo*>::iterator it = open_fd_map_.begin();
   while (it != open_fd_map_.end()) {
-    std::set<int>::const_iterator element = open_fds.find(it->first);
-    if (element == open_fds.end()) {
+    if (!std::binary_search(open_fds.begin(), open_fds.end(), it->first)) {
       // The entry from the file descriptor table is no longer in the list
       // of open files. We warn about this condition and remove it from
       // the list of FDs under consideration.
@@ -591,7 +600,7 @@ void FileDescriptorTable::RestatInternal(std::set<int>& open_fds, fail_fn_t fail
         // The file descriptor refers to a different description. We must
         // update our entry in the table.
         delete it->second;
-        it->second = FileDescriptorInfo::CreateFromFd(*element, fail_fn);
+        it->second = FileDescriptorInfo::CreateFromFd(it->first, fail_fn);
       } else {
         // It's the same file. Nothing to do here. Move on to the next open
         // FD.
@@ -606,14 +615,10 @@ void FileDescriptorTable::RestatInternal(std::set<int>& open_fds, fail_fn_t fail
       }
 
       ++it;
-
-      // Finally, remove the FD from the set of open_fds. We do this last because
-      // |element| will not remain valid after a call to erase.
-      open_fds.erase(element);
     }
   }
 
-  if (open_fds.size() > 0) {
+  if (open_fds.size() > open_fd_map_.size()) {
     // The zygote has opened new file descriptors since our last inspection.
     // We warn about this condition and add them to our table.
     //
@@ -622,10 +627,10 @@ void FileDescriptorTable::RestatInternal(std::set<int>& open_fds, fail_fn_t fail
     // ALOGW("Zygote opened %zd new file descriptor(s).", open_fds.size());
 
     // TODO(narayan): This code will be removed in a future android release.
-    std::set<int>::const_iterator it;
-    for (it = open_fds.begin(); it != open_fds.end(); ++it) {
-      const int fd = (*it);
-      open_fd_map_[fd] = FileDescriptorInfo::CreateFromFd(fd, fail_fn);
+    for (const int fd : open_fds) {
+      if (open_fd_map_.find(fd) == open_fd_map_.end()) {
+        open_fd_map_[fd] = FileDescriptorInfo::CreateFromFd(fd, fail_fn);
+      }
     }
   }
 }
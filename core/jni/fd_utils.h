@@ -100,11 +100,15 @@ class FileDescriptorTable {
  private:
   explicit FileDescriptorTable(const std::unordered_map<int, FileDescriptorInfo*>& map);
 
-  void RestatInternal(std::set<int>& open_fds, fail_fn_t fail_fn);
+  // Checks the entries of the table against |open_fds|, which must be sorted.
+  void RestatInternal(const std::vector<int>& open_fds, fail_fn_t fail_fn);
 
   // Invariant: All values in this unordered_map are non-NULL.
   std::unordered_map<int, FileDescriptorInfo*> open_fd_map_;
 
+  // The FDs listed by the last Restat(), kept to reuse their storage.
+  std::vector<int> open_fds_;
+
   DISALLOW_COPY_AND_ASSIGN(FileDescriptorTable);
 };
 
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORKS_BASE_CORE_JNI_LONG_ARRAY_UTILS_H_
+#define FRAMEWORKS_BASE_CORE_JNI_LONG_ARRAY_UTILS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace android {
+
+// Element-wise kernels over the uint64_t arrays of LongArrayMultiStateCounter, which battery
+// stats runs for every UID on every update. They process two elements per instruction where
+// the CPU allows it; |dst| and |src| either don't overlap or are the same array.
+
+// dst[i] += src[i]
+inline void addLongArrays(uint64_t* dst, const uint64_t* src, size_t count) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 2 <= count; i += 2) {
+        vst1q_u64(dst + i, vaddq_u64(vld1q_u64(dst + i), vld1q_u64(src + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= count; i += 2) {
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i);
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + i);
+        _mm_storeu_si128(out, _mm_add_epi64(_mm_loadu_si128(out), _mm_loadu_si128(in)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] += src[i];
+    }
+}
+
+// dst[i] = src[i] * scale, rounded toward zero. |scale| must not be negative.
+inline void scaleLongArray(uint64_t* dst, const uint64_t* src, size_t count, double scale) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    // 32-bit NEON has no 64-bit float lanes.
+    for (; i + 2 <= count; i += 2) {
+        float64x2_t values = vcvtq_f64_u64(vld1q_u64(src + i));
+        vst1q_u64(dst + i, vcvtq_u64_f64(vmulq_n_f64(values, scale)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = static_cast<uint64_t>(static_cast<double>(src[i]) * scale);
+    }
+}
+
+} // namespace android
+
+#endif  // FRAMEWORKS_BASE_CORE_JNI_LONG_ARRAY_UTILS_H_
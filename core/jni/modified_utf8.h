@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORKS_BASE_CORE_JNI_MODIFIED_UTF8_H_
+#define FRAMEWORKS_BASE_CORE_JNI_MODIFIED_UTF8_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace android {
+
+// Conversions between UTF-16 and modified UTF-8, the encoding of JNI and DataOutput: U+0000 takes
+// two bytes and each unit of a surrogate pair is encoded on its own, so every UTF-16 unit maps to
+// one, two or three bytes. Runs of U+0001..U+007F, which most strings are made of, are converted
+// eight or sixteen at a time where the CPU allows it.
+
+namespace modified_utf8 {
+
+// Converts the leading run of single-byte units of |src|, a whole number of vectors of them,
+// and returns its length.
+inline size_t narrowAscii(const uint16_t* src, size_t length, char* dst) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    const uint16x8_t one = vdupq_n_u16(1);
+    const uint16x8_t limit = vdupq_n_u16(0x7f);
+    for (; i + 8 <= length; i += 8) {
+        const uint16x8_t units = vld1q_u16(src + i);
+        const uint8x8_t ascii = vmovn_u16(vcltq_u16(vsubq_u16(units, one), limit));
+        if (vget_lane_u64(vreinterpret_u64_u8(ascii), 0) != UINT64_MAX) {
+            break;
+        }
+        vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vmovn_u16(units));
+    }
+#elif defined(__SSE2__)
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i limit = _mm_set1_epi16(0x7e);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= length; i += 8) {
+        const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // unit - 1 <= 0x7e, unsigned, without SSE4's unsigned min.
+        const __m128i over = _mm_subs_epu16(_mm_sub_epi16(units, one), limit);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(over, zero)) != 0xffff) {
+            break;
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(units, units));
+    }
+#endif
+    return i;
+}
+
+// Converts the leading run of single-byte characters of |src|, a whole number of vectors of
+// them, and returns its length.
+inline size_t widenAscii(const char* src, size_t length, uint16_t* dst) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    const uint8x16_t one = vdupq_n_u8(1);
+    const uint8x16_t limit = vdupq_n_u8(0x7f);
+    for (; i + 16 <= length; i += 16) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        const uint8x16_t ascii = vcltq_u8(vsubq_u8(bytes, one), limit);
+        const uint64x2_t lanes = vreinterpretq_u64_u8(ascii);
+        if ((vgetq_lane_u64(lanes, 0) & vgetq_lane_u64(lanes, 1)) != UINT64_MAX) {
+            break;
+        }
+        vst1q_u16(dst + i, vmovl_u8(vget_low_u8(bytes)));
+        vst1q_u16(dst + i + 8, vmovl_u8(vget_high_u8(bytes)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // No byte with its top bit set, and no NUL.
+        if (_mm_movemask_epi8(_mm_or_si128(bytes, _mm_cmpeq_epi8(bytes, zero))) != 0) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(bytes, zero));
+    }
+#endif
+    return i;
+}
+
+// How many units or bytes the scalar loops convert, past a vector that had a multi-byte
+// character, before trying the vectors again: about one vector's worth.
+constexpr size_t kEncodeScalarRun = 8;
+constexpr size_t kDecodeScalarRun = 16;
+
+} // namespace modified_utf8
+
+// Returns how many bytes encodeModifiedUtf8() writes for |src|.
+inline size_t modifiedUtf8Length(const uint16_t* src, size_t length) {
+    size_t bytes = length;
+    for (size_t i = 0; i < length; i++) {
+        const uint16_t unit = src[i];
+        bytes += (unit == 0 || unit > 0x7f) + (unit > 0x7ff);
+    }
+    return bytes;
+}
+
+// Encodes the |length| UTF-16 units of |src| into |dst|, which holds modifiedUtf8Length() bytes,
+// and returns how many it wrote. Doesn't write a terminating NUL.
+inline size_t encodeModifiedUtf8(const uint16_t* src, size_t length, char* dst) {
+    char* out = dst;
+    size_t i = 0;
+    while (i < length) {
+        const size_t ascii = modified_utf8::narrowAscii(src + i, length - i, out);
+        i += ascii;
+        out += ascii;
+        for (size_t end = i + modified_utf8::kEncodeScalarRun; i < length && i < end; i++) {
+            const uint16_t unit = src[i];
+            if (unit != 0 && unit <= 0x7f) {
+                *out++ = static_cast<char>(unit);
+            } else if (unit <= 0x7ff) {
+                *out++ = static_cast<char>(0xc0 | (unit >> 6));
+                *out++ = static_cast<char>(0x80 | (unit & 0x3f));
+            } else {
+                *out++ = static_cast<char>(0xe0 | (unit >> 12));
+                *out++ = static_cast<char>(0x80 | ((unit >> 6) & 0x3f));
+                *out++ = static_cast<char>(0x80 | (unit & 0x3f));
+            }
+        }
+    }
+    return out - dst;
+}
+
+// Decodes the |length| bytes of |src| into |dst|, which holds |length| units, and returns how many
+// it wrote. Like ART, also accepts the four-byte sequences of standard UTF-8, as surrogate pairs;
+// NULs are kept and malformed sequences become U+FFFD.
+inline size_t decodeModifiedUtf8(const char* src, size_t length, uint16_t* dst) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+    uint16_t* out = dst;
+    auto continuation = [&](size_t i) { return i < length && (in[i] & 0xc0) == 0x80; };
+    size_t i = 0;
+    while (i < length) {
+        const size_t ascii = modified_utf8::widenAscii(src + i, length - i, out);
+        i += ascii;
+        out += ascii;
+        for (size_t end = i + modified_utf8::kDecodeScalarRun; i < length && i < end;) {
+            const uint8_t c = in[i];
+            if (c < 0x80) {
+                *out++ = c;
+                i += 1;
+            } else if ((c & 0xe0) == 0xc0 && continuation(i + 1)) {
+                *out++ = ((c & 0x1f) << 6) | (in[i + 1] & 0x3f);
+                i += 2;
+            } else if ((c & 0xf0) == 0xe0 && continuation(i + 1) && continuation(i + 2)) {
+                *out++ = ((c & 0x0f) << 12) | ((in[i + 1] & 0x3f) << 6) | (in[i + 2] & 0x3f);
+                i += 3;
+            } else if ((c & 0xf8) == 0xf0 && continuation(i + 1) && continuation(i + 2) &&
+                       continuation(i + 3)) {
+                const uint32_t codePoint = ((c & 0x07) << 18) | ((in[i + 1] & 0x3f) << 12) |
+                        ((in[i + 2] & 0x3f) << 6) | (in[i + 3] & 0x3f);
+                if (codePoint >= 0x10000 && codePoint <= 0x10ffff) {
+                    *out++ = 0xd800 + ((codePoint - 0x10000) >> 10);
+                    *out++ = 0xdc00 + ((codePoint - 0x10000) & 0x3ff);
+                } else {
+                    *out++ = 0xfffd;
+                }
+                i += 4;
+            } else {
+                *out++ = 0xfffd;
+                i += 1;
+            }
+        }
+    }
+    return out - dst;
+}
+
+} // namespace android
+
+#endif  // FRAMEWORKS_BASE_CORE_JNI_MODIFIED_UTF8_H_
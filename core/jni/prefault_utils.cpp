@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "prefault_utils.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+// Faults the pages in, rather than only reading them ahead, since Linux 5.14.
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#endif
+
+static const char kMapsPath[] = "/proc/self/maps";
+
+// Keeps the byte offsets of the pages from overflowing.
+static const uint64_t kMaxPage = UINT32_MAX;
+
+std::unique_ptr<PrefaultProfile> PrefaultProfile::Load(const std::string& path) {
+    std::string text;
+    if (!android::base::ReadFileToString(path, &text)) {
+        PLOG(ERROR) << "Unable to read prefault profile " << path;
+        return nullptr;
+    }
+    auto profile = Parse(text);
+    if (profile == nullptr) {
+        LOG(ERROR) << "Invalid prefault profile " << path;
+    }
+    return profile;
+}
+
+std::unique_ptr<PrefaultProfile> PrefaultProfile::Parse(const std::string& text) {
+    std::unique_ptr<PrefaultProfile> profile(new PrefaultProfile());
+    for (const auto& line : android::base::Split(text, "\n")) {
+        std::vector<std::string> tokens = android::base::Split(line, " \t");
+        tokens.erase(std::remove(tokens.begin(), tokens.end(), ""), tokens.end());
+        if (tokens.empty() || tokens[0][0] == '#') {
+            continue;
+        }
+        if (tokens[0][0] != '/' || tokens.size() < 2) {
+            return nullptr;
+        }
+
+        std::vector<PageRange>& ranges = profile->files_[tokens[0]];
+        for (size_t i = 1; i < tokens.size(); ++i) {
+            const std::string& token = tokens[i];
+            const size_t dash = token.find('-');
+            uint64_t first;
+            uint64_t last;
+            if (dash == std::string::npos) {
+                if (!android::base::ParseUint(token, &first, kMaxPage)) {
+                    return nullptr;
+                }
+                last = first;
+            } else if (!android::base::ParseUint(token.substr(0, dash), &first, kMaxPage) ||
+                       !android::base::ParseUint(token.substr(dash + 1), &last, kMaxPage) ||
+                       last < first) {
+                return nullptr;
+            }
+            ranges.push_back({first, last - first + 1});
+        }
+    }
+    return profile;
+}
+
+void PrefaultProfile::ApplyAsync() const {
+    std::thread([this] {
+        // Page faults of the app's own threads come first.
+        setpriority(PRIO_PROCESS, 0, 19);
+        Apply();
+    }).detach();
+}
+
+void PrefaultProfile::Apply() const {
+    std::string maps;
+    if (!android::base::ReadFileToString(kMapsPath, &maps)) {
+        PLOG(ERROR) << "Unable to read " << kMapsPath;
+        return;
+    }
+
+    const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    int advice = MADV_POPULATE_READ;
+    for (const auto& line : android::base::Split(maps, "\n")) {
+        unsigned long start;
+        unsigned long end;
+        char perms[5];
+        uint64_t offset;
+        int path_start = 0;
+        if (sscanf(line.c_str(), "%lx-%lx %4s %" SCNx64 " %*x:%*x %*u %n", &start, &end, perms,
+                   &offset, &path_start) != 4 ||
+            path_start == 0 || perms[0] != 'r') {
+            continue;
+        }
+        auto file = files_.find(line.substr(path_start));
+        if (file == files_.end()) {
+            continue;
+        }
+
+        const uint64_t map_end = offset + (end - start);
+        for (const PageRange& range : file->second) {
+            const uint64_t first = std::max(range.first * page_size, offset);
+            const uint64_t last = std::min((range.first + range.count) * page_size, map_end);
+            if (first >= last) {
+                continue;
+            }
+            void* addr = reinterpret_cast<void*>(start + (first - offset));
+            if (madvise(addr, last - first, advice) == -1 && errno == EINVAL &&
+                advice == MADV_POPULATE_READ) {
+                // Older kernels only read the pages ahead, leaving the faults to the app.
+                advice = MADV_WILLNEED;
+                madvise(addr, last - first, advice);
+            }
+        }
+    }
+}
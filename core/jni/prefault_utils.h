@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORKS_BASE_CORE_JNI_PREFAULT_UTILS_H_
+#define FRAMEWORKS_BASE_CORE_JNI_PREFAULT_UTILS_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/macros.h>
+
+// The pages of the files mapped by the zygote that apps fault in early, such as the
+// boot image, framework-res.apk and libhwui.so. Every forked app faults in the same pages
+// again, so an app prefaults those of the profile in the background once it's specialized.
+//
+// A profile is a text file with one line per file: its path followed by the page ranges
+// to prefault, as page indices from the start of the file. Lines starting with '#' are
+// comments.
+//
+//   /system/framework/framework-res.apk 0-15 32 40-47
+//
+// Profiles are recorded on the device they're used on, e.g. from the mincore(2) of the
+// mappings of a started app, so that the page size is the one of the running kernel.
+class PrefaultProfile {
+public:
+    // Reads and parses the profile at |path|. Returns nullptr if it can't be read, or
+    // isn't a valid profile.
+    static std::unique_ptr<PrefaultProfile> Load(const std::string& path);
+
+    // Parses the |text| of a profile. Returns nullptr if it isn't a valid profile.
+    static std::unique_ptr<PrefaultProfile> Parse(const std::string& text);
+
+    // Prefaults the pages of the profile that are mapped by the calling process, from a
+    // detached thread at the lowest priority. The profile must outlive the thread.
+    void ApplyAsync() const;
+
+    // Prefaults the pages of the profile that are mapped by the calling process.
+    void Apply() const;
+
+private:
+    struct PageRange {
+        uint64_t first;
+        uint64_t count;
+    };
+
+    PrefaultProfile() = default;
+
+    // Invariant: no vector is empty.
+    std::unordered_map<std::string, std::vector<PageRange>> files_;
+
+    DISALLOW_COPY_AND_ASSIGN(PrefaultProfile);
+};
+
+#endif  // FRAMEWORKS_BASE_CORE_JNI_PREFAULT_UTILS_H_
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the per-UID work of a battery stats update over thousands of
+// LongArrayMultiStateCounters: the element-wise kernels of long_array_utils.h against plain
+// loops, and the updates of the counters themselves.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "LongArrayMultiStateCounter.h"
+#include "long_array_utils.h"
+
+using android::battery::LongArrayMultiStateCounter;
+
+// About the number of UIDs of a device with many apps installed.
+static constexpr size_t kCounterCount = 4096;
+static constexpr uint16_t kStateCount = 2;
+
+// A counter per UID, each array as long as the benchmark argument, e.g. the CPU frequencies.
+static std::vector<std::vector<uint64_t>> makeArrays(size_t length) {
+    return std::vector<std::vector<uint64_t>>(kCounterCount, std::vector<uint64_t>(length, 1));
+}
+
+static void BM_AddLoop(benchmark::State& state) {
+    auto totals = makeArrays(state.range(0));
+    const std::vector<uint64_t> delta(state.range(0), 3);
+    for (auto _ : state) {
+        for (auto& total : totals) {
+            for (size_t i = 0; i < total.size(); i++) {
+                total[i] += delta[i];
+            }
+            benchmark::DoNotOptimize(total.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCounterCount);
+}
+
+static void BM_AddLongArrays(benchmark::State& state) {
+    auto totals = makeArrays(state.range(0));
+    const std::vector<uint64_t> delta(state.range(0), 3);
+    for (auto _ : state) {
+        for (auto& total : totals) {
+            android::addLongArrays(total.data(), delta.data(), total.size());
+            benchmark::DoNotOptimize(total.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCounterCount);
+}
+
+static void BM_ScaleLoop(benchmark::State& state) {
+    auto totals = makeArrays(state.range(0));
+    for (auto _ : state) {
+        for (auto& total : totals) {
+            for (size_t i = 0; i < total.size(); i++) {
+                total[i] = static_cast<uint64_t>(static_cast<double>(total[i]) * 1.0);
+            }
+            benchmark::DoNotOptimize(total.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCounterCount);
+}
+
+static void BM_ScaleLongArray(benchmark::State& state) {
+    auto totals = makeArrays(state.range(0));
+    for (auto _ : state) {
+        for (auto& total : totals) {
+            android::scaleLongArray(total.data(), total.data(), total.size(), 1.0);
+            benchmark::DoNotOptimize(total.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCounterCount);
+}
+
+// What native_updateValues() does for every UID, once its new values are in native memory.
+static void BM_UpdateValue(benchmark::State& state) {
+    const size_t length = state.range(0);
+    std::vector<std::unique_ptr<LongArrayMultiStateCounter>> counters;
+    for (size_t i = 0; i < kCounterCount; i++) {
+        counters.push_back(std::make_unique<LongArrayMultiStateCounter>(
+                kStateCount, std::vector<uint64_t>(length)));
+    }
+    std::vector<uint64_t> value(length);
+    const std::vector<uint64_t> delta(length, 3);
+    int64_t timestamp = 0;
+    for (auto _ : state) {
+        timestamp += 1000;
+        android::addLongArrays(value.data(), delta.data(), length);
+        for (auto& counter : counters) {
+            counter->updateValue(value, timestamp);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCounterCount);
+}
+
+// From the active time of a few CPUs to the time in each frequency of all the CPUs.
+BENCHMARK(BM_AddLoop)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_AddLongArrays)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_ScaleLoop)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_ScaleLongArray)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_UpdateValue)->Arg(8)->Arg(32)->Arg(128);
+
+BENCHMARK_MAIN();
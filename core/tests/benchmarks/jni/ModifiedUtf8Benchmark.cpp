@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the modified UTF-8 kernels of modified_utf8.h against the one-unit-at-a-time loops
+// they replace, on short strings such as property names and log tags and on long ones such as
+// log messages, all ASCII or with a few non-ASCII characters.
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "modified_utf8.h"
+
+// Every how many units a string has a character outside of ASCII, or 0 for none.
+static constexpr size_t kAscii = 0;
+static constexpr size_t kMixed = 16;
+
+static std::vector<uint16_t> makeString(size_t length, size_t nonAsciiEvery) {
+    std::vector<uint16_t> units(length);
+    for (size_t i = 0; i < length; i++) {
+        units[i] = (nonAsciiEvery != kAscii && i % nonAsciiEvery == nonAsciiEvery - 1)
+                ? 0x00e9 : 'a' + i % 26;
+    }
+    return units;
+}
+
+static size_t encodeLoop(const uint16_t* src, size_t length, char* dst) {
+    char* out = dst;
+    for (size_t i = 0; i < length; i++) {
+        const uint16_t unit = src[i];
+        if (unit != 0 && unit <= 0x7f) {
+            *out++ = static_cast<char>(unit);
+        } else if (unit <= 0x7ff) {
+            *out++ = static_cast<char>(0xc0 | (unit >> 6));
+            *out++ = static_cast<char>(0x80 | (unit & 0x3f));
+        } else {
+            *out++ = static_cast<char>(0xe0 | (unit >> 12));
+            *out++ = static_cast<char>(0x80 | ((unit >> 6) & 0x3f));
+            *out++ = static_cast<char>(0x80 | (unit & 0x3f));
+        }
+    }
+    return out - dst;
+}
+
+static size_t decodeLoop(const char* src, size_t length, uint16_t* dst) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+    uint16_t* out = dst;
+    for (size_t i = 0; i < length;) {
+        const uint8_t c = in[i];
+        if (c < 0x80) {
+            *out++ = c;
+            i += 1;
+        } else if ((c & 0xe0) == 0xc0) {
+            *out++ = ((c & 0x1f) << 6) | (in[i + 1] & 0x3f);
+            i += 2;
+        } else {
+            *out++ = ((c & 0x0f) << 12) | ((in[i + 1] & 0x3f) << 6) | (in[i + 2] & 0x3f);
+            i += 3;
+        }
+    }
+    return out - dst;
+}
+
+constexpr bool kLoop = false;
+constexpr bool kKernel = true;
+
+template <size_t nonAsciiEvery, bool kernel>
+static void BM_Encode(benchmark::State& state) {
+    const std::vector<uint16_t> units = makeString(state.range(0), nonAsciiEvery);
+    std::vector<char> bytes(units.size() * 3);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernel
+                ? android::encodeModifiedUtf8(units.data(), units.size(), bytes.data())
+                : encodeLoop(units.data(), units.size(), bytes.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * units.size());
+}
+
+template <size_t nonAsciiEvery, bool kernel>
+static void BM_Decode(benchmark::State& state) {
+    const std::vector<uint16_t> units = makeString(state.range(0), nonAsciiEvery);
+    std::vector<char> bytes(units.size() * 3);
+    bytes.resize(android::encodeModifiedUtf8(units.data(), units.size(), bytes.data()));
+    std::vector<uint16_t> decoded(bytes.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernel
+                ? android::decodeModifiedUtf8(bytes.data(), bytes.size(), decoded.data())
+                : decodeLoop(bytes.data(), bytes.size(), decoded.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * units.size());
+}
+
+// From property names and log tags to log messages and serialized text.
+BENCHMARK_TEMPLATE(BM_Encode, kAscii, kLoop)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Encode, kAscii, kKernel)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Encode, kMixed, kLoop)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Encode, kMixed, kKernel)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Decode, kAscii, kLoop)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Decode, kAscii, kKernel)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Decode, kMixed, kLoop)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Decode, kMixed, kKernel)->Arg(16)->Arg(64)->Arg(1024);
+
+BENCHMARK_MAIN();
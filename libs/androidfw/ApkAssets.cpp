@@ -19,6 +19,7 @@
 #include "android-base/errors.h"
 #include "android-base/logging.h"
 #include "android-base/utf8.h"
+#include "androidfw/ResourceTimer.h"
 
 namespace android {
 
@@ -127,6 +128,7 @@ ApkAssetsPtr ApkAssets::LoadImpl(std::unique_ptr<Asset> resources_asset,
   if (assets == nullptr ) {
     return {};
   }
+  ResourceTimer _timer(ResourceTimer::Counter::LoadApkAssets);
 
   std::unique_ptr<LoadedArsc> loaded_arsc;
   if (resources_asset != nullptr) {
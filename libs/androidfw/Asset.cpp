@@ -31,6 +31,8 @@
 #include <utils/Log.h>
 #include <utils/threads.h>
 
+#include <algorithm>
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -39,6 +41,9 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 using namespace android;
 
@@ -298,6 +303,21 @@ Asset::Asset(void)
 /*
  * Create a new Asset from a memory mapping.
  */
+/*static*/ std::unique_ptr<Asset> Asset::createFromSharedMap(
+        std::shared_ptr<const incfs::IncFsFileMap> sharedMap, off64_t offset, size_t length,
+        AccessMode mode, base::unique_fd fd)
+{
+    auto pAsset = util::make_unique<_FileAsset>();
+
+    status_t result = pAsset->openChunk(std::move(sharedMap), offset, length, std::move(fd));
+    if (result != NO_ERROR) {
+        return NULL;
+    }
+
+    pAsset->mAccessMode = mode;
+    return std::move(pAsset);
+}
+
 /*static*/ std::unique_ptr<Asset> Asset::createFromUncompressedMap(incfs::IncFsFileMap&& dataMap,
                                                                    AccessMode mode,
                                                                    base::unique_fd fd)
@@ -381,7 +401,8 @@ off64_t Asset::handleSeek(off64_t offset, int whence, off64_t curPosn, off64_t m
  * Constructor.
  */
 _FileAsset::_FileAsset(void)
-    : mStart(0), mLength(0), mOffset(0), mFp(NULL), mFileName(NULL), mFd(-1), mBuf(NULL)
+    : mStart(0), mLength(0), mOffset(0), mFp(NULL), mFileName(NULL), mFd(-1), mBuf(NULL),
+      mSharedOffset(0)
 {
     // Register the Asset with the global list here after it is fully constructed and its
     // vtable pointer points to this concrete type. b/31113965
@@ -466,6 +487,49 @@ status_t _FileAsset::openChunk(incfs::IncFsFileMap&& dataMap, base::unique_fd fd
     return NO_ERROR;
 }
 
+/*
+ * Use a region of a mapping shared with other assets.
+ */
+status_t _FileAsset::openChunk(std::shared_ptr<const incfs::IncFsFileMap> sharedMap,
+        off64_t offset, size_t length, base::unique_fd fd)
+{
+    assert(mFp == NULL);    // no reopen
+    assert(getMap() == NULL);
+    assert(sharedMap != NULL);
+
+    if (offset < 0 || (size_t) offset > sharedMap->length()
+            || length > sharedMap->length() - (size_t) offset) {
+        ALOGE("Asset of %zu bytes at %lld is outside of a %zu byte mapping", length,
+                (long long) offset, sharedMap->length());
+        return BAD_VALUE;
+    }
+
+    mSharedMap = std::move(sharedMap);
+    mSharedOffset = offset;
+    mStart = -1;            // not used
+    mLength = length;
+    mFd = std::move(fd);
+    assert(mOffset == 0);
+
+    return NO_ERROR;
+}
+
+const incfs::IncFsFileMap* _FileAsset::getMap() const
+{
+    if (mSharedMap != NULL) {
+        return mSharedMap.get();
+    }
+    return mMap.has_value() ? &(*mMap) : NULL;
+}
+
+incfs::map_ptr<void> _FileAsset::getMappedData() const
+{
+    if (mSharedMap != NULL) {
+        return mSharedMap->data().offset(mSharedOffset);
+    }
+    return mMap->data();
+}
+
 /*
  * Read a chunk of data.
  */
@@ -495,10 +559,10 @@ ssize_t _FileAsset::read(void* buf, size_t count)
     if (!count)
         return 0;
 
-    if (mMap.has_value()) {
+    if (getMap() != NULL) {
         /* copy from mapped area */
         //printf("map read\n");
-        const auto readPos = mMap->data().offset(mOffset).convert<char>();
+        const auto readPos = getMappedData().offset(mOffset).convert<char>();
         if (!readPos.verify(count)) {
             return -1;
         }
@@ -607,11 +671,11 @@ incfs::map_ptr<void> _FileAsset::getIncFsBuffer(bool aligned)
     /* subsequent requests just use what we did previously */
     if (mBuf != NULL)
         return mBuf;
-    if (mMap.has_value()) {
+    if (getMap() != NULL) {
         if (!aligned) {
-            return mMap->data();
+            return getMappedData();
         }
-        return ensureAlignment(*mMap);
+        return ensureAlignment(getMappedData());
     }
 
     assert(mFp != NULL);
@@ -660,16 +724,67 @@ incfs::map_ptr<void> _FileAsset::getIncFsBuffer(bool aligned)
         if (!aligned) {
             return mMap->data();
         }
-        return ensureAlignment(*mMap);
+        return ensureAlignment(mMap->data());
+    }
+}
+
+/*
+ * Ask the kernel to read "length" bytes of a mapping, or of a file, ahead.
+ */
+static void readAheadMapped(const void* data, off64_t length)
+{
+#if defined(__linux__)
+    const uintptr_t pageSize = getpagesize();
+    const uintptr_t start = reinterpret_cast<uintptr_t>(data) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(data) + length;
+    if (madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED) != 0) {
+        ALOGW("Unable to read ahead %lld mapped asset bytes (%s)", (long long) length,
+                strerror(errno));
+    }
+#else
+    (void) data;
+    (void) length;
+#endif
+}
+
+static void readAheadFile(int fd, off64_t offset, off64_t length)
+{
+#if defined(__linux__)
+    if (int result = posix_fadvise64(fd, offset, length, POSIX_FADV_WILLNEED); result != 0) {
+        ALOGW("Unable to read ahead %lld asset bytes (%s)", (long long) length,
+                strerror(result));
+    }
+#else
+    (void) fd;
+    (void) offset;
+    (void) length;
+#endif
+}
+
+/*
+ * Read the next "length" bytes of the chunk ahead.
+ */
+void _FileAsset::readAhead(off64_t length)
+{
+    length = std::min(length, mLength - mOffset);
+    if (length <= 0 || mBuf != NULL)
+        return;
+
+    if (const incfs::IncFsFileMap* map = getMap(); map != NULL) {
+        const uint8_t* data = static_cast<const uint8_t*>(map->unsafe_data());
+        readAheadMapped(data + mSharedOffset + mOffset, length);
+    } else if (mFp != NULL) {
+        readAheadFile(fileno(mFp), mStart + mOffset, length);
     }
 }
 
 int _FileAsset::openFileDescriptor(off64_t* outStart, off64_t* outLength) const
 {
-    if (mMap.has_value()) {
+    if (const incfs::IncFsFileMap* map = getMap(); map != NULL) {
+        const off64_t start = map->offset() + mSharedOffset;
         if (mFd.ok()) {
-            *outStart = mMap->offset();
-            *outLength = mMap->length();
+            *outStart = start;
+            *outLength = mLength;
             const int fd = dup(mFd);
             if (fd < 0) {
                 ALOGE("Unable to dup fd (%d).", mFd.get());
@@ -678,15 +793,15 @@ int _FileAsset::openFileDescriptor(off64_t* outStart, off64_t* outLength) const
             lseek64(fd, 0, SEEK_SET);
             return fd;
         }
-        const char* fname = mMap->file_name();
+        const char* fname = map->file_name();
         if (fname == NULL) {
             fname = mFileName;
         }
         if (fname == NULL) {
             return -1;
         }
-        *outStart = mMap->offset();
-        *outLength = mMap->length();
+        *outStart = start;
+        *outLength = mLength;
         return open(fname, O_RDONLY | O_BINARY);
     }
     if (mFileName == NULL) {
@@ -697,9 +812,8 @@ int _FileAsset::openFileDescriptor(off64_t* outStart, off64_t* outLength) const
     return open(mFileName, O_RDONLY | O_BINARY);
 }
 
-incfs::map_ptr<void> _FileAsset::ensureAlignment(const incfs::IncFsFileMap& map)
+incfs::map_ptr<void> _FileAsset::ensureAlignment(incfs::map_ptr<void> data)
 {
-    const auto data = map.data();
     if (util::IsFourByteAligned(data)) {
         // We can return this directly if it is aligned on a word
         // boundary.
@@ -894,6 +1008,33 @@ void _CompressedAsset::close(void)
     }
 }
 
+/*
+ * Read the compressed data of the next "length" bytes ahead.  Where that
+ * data is has to be estimated, assuming the data is evenly compressed, so
+ * an input chunk more is read ahead on each side.
+ */
+void _CompressedAsset::readAhead(off64_t length)
+{
+    length = std::min(length, mUncompressedLen - mOffset);
+    if (length <= 0 || mBuf != NULL || mUncompressedLen == 0)
+        return;
+
+    const double ratio = (double) mCompressedLen / mUncompressedLen;
+    const off64_t margin = StreamingZipInflater::INPUT_CHUNK_SIZE;
+    const off64_t start = std::max<off64_t>((off64_t) (mOffset * ratio) - margin, 0);
+    const off64_t end = std::min<off64_t>((off64_t) ((mOffset + length) * ratio) + margin,
+            mCompressedLen);
+    if (end <= start)
+        return;
+
+    if (mMap.has_value()) {
+        const uint8_t* data = static_cast<const uint8_t*>(mMap->unsafe_data());
+        readAheadMapped(data + start, end - start);
+    } else if (mFd >= 0) {
+        readAheadFile(mFd, mStart + start, end - start);
+    }
+}
+
 /*
  * Get a pointer to a read-only buffer of data.
  *
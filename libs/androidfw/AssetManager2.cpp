@@ -26,8 +26,10 @@
 
 #include "android-base/logging.h"
 #include "android-base/stringprintf.h"
+#include "androidfw/ResourceTimer.h"
 #include "androidfw/ResourceTypes.h"
 #include "androidfw/ResourceUtils.h"
+#include "androidfw/SharedResolvedCache.h"
 #include "androidfw/Util.h"
 #include "utils/ByteOrder.h"
 #include "utils/Trace.h"
@@ -93,13 +95,16 @@ struct FindEntryResult {
 
 AssetManager2::AssetManager2(ApkAssetsList apk_assets, const ResTable_config& configuration)
     : configuration_(configuration) {
+  UpdateLocaleDataCache();
   // Don't invalidate caches here as there's nothing cached yet.
   SetApkAssets(apk_assets, false);
 }
 
 bool AssetManager2::SetApkAssets(ApkAssetsList apk_assets, bool invalidate_caches) {
   BuildDynamicRefTable(apk_assets);
+  filter_snapshots_.clear();
   RebuildFilterList();
+  UpdateSharedResolvedCache();
   if (invalidate_caches) {
     InvalidateCaches(static_cast<uint32_t>(-1));
   }
@@ -423,14 +428,60 @@ bool AssetManager2::ContainsAllocatedTable() const {
 
 void AssetManager2::SetConfiguration(const ResTable_config& configuration) {
   const int diff = configuration_.diff(configuration);
+  const ResTable_config previous_configuration = configuration_;
   configuration_ = configuration;
 
   if (diff) {
-    RebuildFilterList();
+    if (diff & ResTable_config::CONFIG_LOCALE) {
+      UpdateLocaleDataCache();
+    }
+    RebuildFilterList(static_cast<uint32_t>(diff), &previous_configuration);
+    UpdateSharedResolvedCache();
     InvalidateCaches(static_cast<uint32_t>(diff));
   }
 }
 
+void AssetManager2::SetSharedResolvedCache(std::shared_ptr<const SharedResolvedCache> cache) {
+  shared_cache_ = std::move(cache);
+  UpdateSharedResolvedCache();
+}
+
+void AssetManager2::UpdateLocaleDataCache() {
+  if (configuration_.locale == 0) {
+    // Locale comparisons stop before the locale data when nothing is requested.
+    return;
+  }
+  if (locale_data_cache_ == nullptr) {
+    locale_data_cache_ = std::make_unique<LocaleDataCache>();
+  } else if (locale_data_cache_->servesLocale(configuration_.language,
+                                              configuration_.localeScript,
+                                              configuration_.country)) {
+    return;
+  }
+  locale_data_cache_->reset(configuration_.language, configuration_.localeScript,
+                            configuration_.country);
+}
+
+void AssetManager2::UpdateSharedResolvedCache() {
+  active_shared_cache_ = nullptr;
+  if (shared_cache_ == nullptr) {
+    return;
+  }
+
+  if (shared_cache_->GetConfiguration().compare(configuration_) != 0) {
+    return;
+  }
+
+  // The values in the table embed cookies and runtime package IDs, so the package group must be
+  // made up of exactly the same ApkAssets at the same positions.
+  const std::string fingerprint =
+      SharedResolvedCache::ComputeFingerprint(*this, shared_cache_->GetPackageId());
+  if (fingerprint.empty() || fingerprint != shared_cache_->GetFingerprint()) {
+    return;
+  }
+  active_shared_cache_ = shared_cache_.get();
+}
+
 std::set<AssetManager2::ApkAssetsPtr> AssetManager2::GetNonSystemOverlays() const {
   std::set<ApkAssetsPtr> non_system_overlays;
   for (const PackageGroup& package_group : package_groups_) {
@@ -566,6 +617,35 @@ std::unique_ptr<AssetDir> AssetManager2::OpenDir(const std::string& dirname) con
   return asset_dir;
 }
 
+bool AssetManager2::ForEachAssetEntry(
+    const std::string& dirname,
+    base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const {
+  ATRACE_NAME("AssetManager::ForEachAssetEntry");
+  auto op = StartOperation();
+
+  std::string full_path = "assets/" + dirname;
+  std::set<std::string, std::less<>> reported;
+
+  // Start from the back, like Open().
+  for (size_t i = apk_assets_.size(); i > 0; --i) {
+    const auto& apk_assets = GetApkAssets(i - 1);
+    if (!apk_assets || apk_assets->IsOverlay()) {
+      continue;
+    }
+
+    auto func = [&](StringPiece name, const AssetEntryInfo& info) {
+      if (reported.emplace(name).second) {
+        f(name, info);
+      }
+    };
+
+    if (!apk_assets->GetAssetsProvider()->ForEachEntry(full_path, func)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Search in reverse because that's how we used to do it and we need to preserve behaviour.
 // This is unfortunate, because ClassLoaders delegate to the parent first, so the order
 // is inconsistent for split APKs.
@@ -766,7 +846,7 @@ base::expected<FindEntryResult, NullOrIOError> AssetManager2::FindEntry(
 base::expected<FindEntryResult, NullOrIOError> AssetManager2::FindEntryInternal(
     const PackageGroup& package_group, uint8_t type_idx, uint16_t entry_idx,
     const ResTable_config& desired_config, bool stop_at_first_match,
-    bool ignore_configuration) const {
+    bool ignore_configuration, const TypeSpec* const* type_specs) const {
   const bool logging_enabled = resource_resolution_logging_enabled_;
   ApkAssetsCookie best_cookie = kInvalidCookie;
   const LoadedPackage* best_package = nullptr;
@@ -778,7 +858,12 @@ base::expected<FindEntryResult, NullOrIOError> AssetManager2::FindEntryInternal(
   // If `desired_config` is not the same as the set configuration or the caller will accept a value
   // from any configuration, then we cannot use our filtered list of types since it only it contains
   // types matched to the set configuration.
-  const bool use_filtered = !ignore_configuration && &desired_config == &configuration_;
+  const bool use_filtered_configs = !ignore_configuration && &desired_config == &configuration_;
+
+  // Types without a filtered list have every candidate configuration matched against
+  // `desired_config`.
+  const ResTable_config::MatchKey desired_key = ignore_configuration
+      ? ResTable_config::MatchKey{0U, 0U} : desired_config.matchKey();
 
   const size_t package_count = package_group.packages_.size();
   for (size_t pi = 0; pi < package_count; pi++) {
@@ -787,8 +872,9 @@ base::expected<FindEntryResult, NullOrIOError> AssetManager2::FindEntryInternal(
     const ApkAssetsCookie cookie = package_group.cookies_[pi];
 
     // If the type IDs are offset in this package, we need to take that into account when searching
-    // for a type.
-    const TypeSpec* type_spec = loaded_package->GetTypeSpecByTypeIndex(type_idx);
+    // for a type. Batched lookups pass in the type specs they already looked up for this type.
+    const TypeSpec* type_spec = (type_specs != nullptr)
+        ? type_specs[pi] : loaded_package->GetTypeSpecByTypeIndex(type_idx);
     if (UNLIKELY(type_spec == nullptr)) {
       continue;
     }
@@ -803,6 +889,8 @@ base::expected<FindEntryResult, NullOrIOError> AssetManager2::FindEntryInternal(
     }
     type_flags |= entry_flags.value();
 
+    const bool use_filtered =
+        use_filtered_configs && loaded_package_impl.filtered_types_.test(type_idx);
     const FilteredConfigGroup& filtered_group = loaded_package_impl.filtered_configs_[type_idx];
     const size_t type_entry_count = (use_filtered) ? filtered_group.type_entries.size()
                                                    : type_spec->type_entries.size();
@@ -814,14 +902,16 @@ base::expected<FindEntryResult, NullOrIOError> AssetManager2::FindEntryInternal(
       // configuration to match or if we're using the list of types that have already had their
       // configuration matched.
       const ResTable_config& this_config = type_entry->config;
-      if (!(use_filtered || ignore_configuration || this_config.match(desired_config))) {
+      if (!(use_filtered || ignore_configuration ||
+            this_config.match(desired_config, type_entry->match_key, desired_key))) {
         continue;
       }
 
       Resolution::Step::Type resolution_type;
       if (best_config == nullptr) {
         resolution_type = Resolution::Step::Type::INITIAL;
-      } else if (this_config.isBetterThan(*best_config, &desired_config)) {
+      } else if (this_config.isBetterThan(*best_config, &desired_config,
+                                          locale_data_cache_.get())) {
         resolution_type = Resolution::Step::Type::BETTER_MATCH;
       } else if (package_is_loader && this_config.compare(*best_config) == 0) {
         resolution_type = Resolution::Step::Type::OVERLAID;
@@ -902,12 +992,42 @@ void AssetManager2::ResetResourceResolution() const {
 }
 
 void AssetManager2::SetResourceResolutionLoggingEnabled(bool enabled) {
+  if (enabled && IsConcurrentReadsEnabled()) {
+    LOG(ERROR) << "Can't enable resource resolution logging while concurrent reads are enabled.";
+    return;
+  }
   resource_resolution_logging_enabled_ = enabled;
   if (!enabled) {
     ResetResourceResolution();
   }
 }
 
+void AssetManager2::SetConcurrentReadsEnabled(bool enabled) {
+  if (!enabled) {
+    concurrent_locks_.reset();
+    return;
+  }
+  if (concurrent_locks_ == nullptr) {
+    // The steps of the last resolution are shared state that can't be recorded concurrently.
+    SetResourceResolutionLoggingEnabled(false);
+    concurrent_locks_ = std::make_unique<ConcurrentReadLocks>();
+  }
+}
+
+std::shared_lock<std::shared_mutex> AssetManager2::ReadLockCaches() const {
+  if (concurrent_locks_ == nullptr) {
+    return {};
+  }
+  return std::shared_lock(concurrent_locks_->cache_lock);
+}
+
+std::unique_lock<std::shared_mutex> AssetManager2::WriteLockCaches() const {
+  if (concurrent_locks_ == nullptr) {
+    return {};
+  }
+  return std::unique_lock(concurrent_locks_->cache_lock);
+}
+
 std::string AssetManager2::GetLastResourceResolution() const {
   if (!resource_resolution_logging_enabled_) {
     LOG(ERROR) << "Must enable resource resolution logging before getting path.";
@@ -1016,6 +1136,14 @@ base::expected<uint32_t, NullOrIOError> AssetManager2::GetResourceTypeSpecFlags(
 
 base::expected<AssetManager2::SelectedValue, NullOrIOError> AssetManager2::GetResource(
     uint32_t resid, bool may_be_bag, uint16_t density_override) const {
+  ResourceTimer _timer(ResourceTimer::Counter::GetResource);
+  if (active_shared_cache_ != nullptr && density_override == 0U &&
+      !resource_resolution_logging_enabled_) {
+    if (const SelectedValue* shared_value = active_shared_cache_->FindValue(resid)) {
+      return *shared_value;
+    }
+  }
+
   auto result = FindEntry(resid, density_override, false /* stop_at_first_match */,
                           false /* ignore_configuration */);
   if (!result.has_value()) {
@@ -1042,16 +1170,117 @@ base::expected<AssetManager2::SelectedValue, NullOrIOError> AssetManager2::GetRe
                        resid, result->config);
 }
 
+base::expected<size_t, IOError> AssetManager2::GetResources(
+    std::span<const uint32_t> resids, std::span<SelectedValue> out_values,
+    uint16_t density_override) const {
+  CHECK(out_values.size() >= resids.size()) << "out_values is too small";
+  auto op = StartOperation();
+
+  // Overlays, the shared cache, and resolution logging all need per-resource handling, so those
+  // lookups go through GetResource(). Everything else only needs FindEntryInternal().
+  const bool use_slow_path = resource_resolution_logging_enabled_ || active_shared_cache_ != nullptr;
+
+  ResTable_config density_override_config;
+  const ResTable_config* desired_config = &configuration_;
+  if (density_override != 0 && density_override != configuration_.density) {
+    density_override_config = configuration_;
+    density_override_config.density = density_override;
+    desired_config = &density_override_config;
+  }
+
+  // Visit the IDs grouped by package and type so that lookups of the same type run back to back.
+  std::vector<uint32_t> order(resids.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return (resids[a] & 0xffff0000U) < (resids[b] & 0xffff0000U);
+  });
+
+  size_t found = 0U;
+  uint32_t current_type = 0U;
+  const PackageGroup* package_group = nullptr;
+  std::vector<const TypeSpec*> type_specs;
+  for (const uint32_t index : order) {
+    const uint32_t resid = resids[index];
+    SelectedValue& out_value = out_values[index];
+    out_value = SelectedValue();
+    if (UNLIKELY(!is_valid_resid(resid))) {
+      LOG(ERROR) << base::StringPrintf("Invalid resource ID 0x%08x.", resid);
+      continue;
+    }
+
+    if (package_group == nullptr || (resid & 0xffff0000U) != current_type) {
+      current_type = resid & 0xffff0000U;
+      const uint8_t package_idx = package_ids_[get_package_id(resid)];
+      package_group = (package_idx != 0xff) ? &package_groups_[package_idx] : nullptr;
+      type_specs.clear();
+      if (package_group != nullptr) {
+        const uint8_t type_idx = get_type_id(resid) - 1;
+        for (const ConfiguredPackage& package : package_group->packages_) {
+          type_specs.push_back(package.loaded_package_->GetTypeSpecByTypeIndex(type_idx));
+        }
+      }
+    }
+
+    if (package_group == nullptr || use_slow_path || !package_group->overlays_.empty()) {
+      auto result = GetResource(resid, true /* may_be_bag */, density_override);
+      if (UNLIKELY(IsIOError(result))) {
+        return base::unexpected(GetIOError(result.error()));
+      }
+      if (result.has_value()) {
+        out_value = *result;
+        found++;
+      }
+      continue;
+    }
+
+    auto result = FindEntryInternal(*package_group, get_type_id(resid) - 1, get_entry_id(resid),
+                                    *desired_config, false /* stop_at_first_match */,
+                                    false /* ignore_configuration */, type_specs.data());
+    if (UNLIKELY(IsIOError(result))) {
+      return base::unexpected(GetIOError(result.error()));
+    }
+    if (!result.has_value()) {
+      continue;
+    }
+
+    if (std::holds_alternative<incfs::verified_map_ptr<ResTable_map_entry>>(result->entry)) {
+      // Create a reference since we can't represent this complex type as a Res_value.
+      out_value = SelectedValue(Res_value::TYPE_REFERENCE, resid, result->cookie,
+                                result->type_flags, resid, result->config);
+    } else {
+      // Convert the package ID to the runtime assigned package ID.
+      Res_value value = std::get<Res_value>(result->entry);
+      result->dynamic_ref_table->lookupResourceValue(&value);
+      out_value = SelectedValue(value.dataType, value.data, result->cookie, result->type_flags,
+                                resid, result->config);
+    }
+    found++;
+  }
+  return found;
+}
+
 base::expected<std::monostate, NullOrIOError> AssetManager2::ResolveReference(
     AssetManager2::SelectedValue& value, bool cache_value) const {
   if (value.type != Res_value::TYPE_REFERENCE || value.data == 0U) {
     // Not a reference. Nothing to do.
     return {};
   }
+  ResourceTimer _timer(ResourceTimer::Counter::ResolveReference);
 
   const uint32_t original_flags = value.flags;
   const uint32_t original_resid = value.data;
+  if (active_shared_cache_ != nullptr && !resource_resolution_logging_enabled_) {
+    if (const auto shared_value = active_shared_cache_->FindResolvedValue(original_resid)) {
+      value = *shared_value;
+      value.flags |= original_flags;
+      return {};
+    }
+  }
+
   if (cache_value) {
+    auto lock = ReadLockCaches();
     auto cached_value = cached_resolved_values_.find(value.data);
     if (cached_value != cached_resolved_values_.end()) {
       value = cached_value->second;
@@ -1080,6 +1309,7 @@ base::expected<std::monostate, NullOrIOError> AssetManager2::ResolveReference(
         result->data == resolve_resid || i == kMaxIterations) {
       // This reference can't be resolved, so exit now and let the caller deal with it.
       if (cache_value) {
+        auto lock = WriteLockCaches();
         cached_resolved_values_[original_resid] = value;
       }
 
@@ -1095,11 +1325,15 @@ base::expected<std::monostate, NullOrIOError> AssetManager2::ResolveReference(
 }
 
 const std::vector<uint32_t> AssetManager2::GetBagResIdStack(uint32_t resid) const {
-  auto cached_iter = cached_bag_resid_stacks_.find(resid);
-  if (cached_iter != cached_bag_resid_stacks_.end()) {
-    return cached_iter->second;
+  {
+    auto lock = ReadLockCaches();
+    auto cached_iter = cached_bag_resid_stacks_.find(resid);
+    if (cached_iter != cached_bag_resid_stacks_.end()) {
+      return cached_iter->second;
+    }
   }
 
+  auto lock = WriteLockCaches();
   std::vector<uint32_t> found_resids;
   GetBag(resid, found_resids);
   cached_bag_resid_stacks_.emplace(resid, found_resids);
@@ -1120,6 +1354,24 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::ResolveBag(
 }
 
 base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(uint32_t resid) const {
+  ResourceTimer _timer(ResourceTimer::Counter::GetBag);
+  if (active_shared_cache_ != nullptr) {
+    if (const ResolvedBag* shared_bag = active_shared_cache_->FindBag(resid)) {
+      return shared_bag;
+    }
+  }
+
+  if (concurrent_locks_ != nullptr) {
+    // Most lookups hit the cache, so only take the write lock when the bag has to be built.
+    auto lock = ReadLockCaches();
+    if (ResolvedBag* cached_bag = cached_bags_.Find(resid)) {
+      return cached_bag;
+    }
+  }
+
+  // Building a bag fills the cache with the bag and all its parents, so the write lock is held
+  // for the whole operation.
+  auto lock = WriteLockCaches();
   std::vector<uint32_t> found_resids;
   const auto bag = GetBag(resid, found_resids);
   cached_bag_resid_stacks_.emplace(resid, std::move(found_resids));
@@ -1128,8 +1380,8 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(uint32_t
 
 base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(
     uint32_t resid, std::vector<uint32_t>& child_resids) const {
-  if (auto cached_iter = cached_bags_.find(resid); cached_iter != cached_bags_.end()) {
-    return cached_iter->second.get();
+  if (ResolvedBag* cached_bag = cached_bags_.Find(resid)) {
+    return cached_bag;
   }
 
   auto entry = FindEntry(resid, 0u /* density_override */, false /* stop_at_first_match */,
@@ -1158,8 +1410,7 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(
     // There is no parent or a circular parental dependency exist, meaning there is nothing to
     // inherit and we can do a simple copy of the entries in the map.
     const size_t entry_count = map_entry_end - map_entry;
-    util::unique_cptr<ResolvedBag> new_bag{reinterpret_cast<ResolvedBag*>(
-        malloc(sizeof(ResolvedBag) + (entry_count * sizeof(ResolvedBag::Entry))))};
+    ResolvedBag* new_bag = cached_bags_.Allocate(entry_count);
 
     bool sort_entries = false;
     for (auto new_entry = new_bag->entries; map_entry != map_entry_end; ++map_entry) {
@@ -1204,9 +1455,8 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(
 
     new_bag->type_spec_flags = entry->type_flags;
     new_bag->entry_count = static_cast<uint32_t>(entry_count);
-    ResolvedBag* result = new_bag.get();
-    cached_bags_[resid] = std::move(new_bag);
-    return result;
+    cached_bags_.Insert(resid, new_bag);
+    return new_bag;
   }
 
   // In case the parent is a dynamic reference, resolve it.
@@ -1222,10 +1472,9 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(
   }
 
   // Create the max possible entries we can make. Once we construct the bag,
-  // we will realloc to fit to size.
+  // we will shrink it to fit to size.
   const size_t max_count = (*parent_bag)->entry_count + dtohl(map->count);
-  util::unique_cptr<ResolvedBag> new_bag{reinterpret_cast<ResolvedBag*>(
-      malloc(sizeof(ResolvedBag) + (max_count * sizeof(ResolvedBag::Entry))))};
+  ResolvedBag* new_bag = cached_bags_.Allocate(max_count);
   ResolvedBag::Entry* new_entry = new_bag->entries;
 
   const ResolvedBag::Entry* parent_entry = (*parent_bag)->entries;
@@ -1322,8 +1571,7 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(
   // Resize the resulting array to fit.
   const size_t actual_count = new_entry - new_bag->entries;
   if (actual_count != max_count) {
-    new_bag.reset(reinterpret_cast<ResolvedBag*>(realloc(
-        new_bag.release(), sizeof(ResolvedBag) + (actual_count * sizeof(ResolvedBag::Entry)))));
+    cached_bags_.Shrink(new_bag, actual_count);
   }
 
   if (sort_entries) {
@@ -1334,9 +1582,8 @@ base::expected<const ResolvedBag*, NullOrIOError> AssetManager2::GetBag(
   // Combine flags from the parent and our own bag.
   new_bag->type_spec_flags = entry->type_flags | (*parent_bag)->type_spec_flags;
   new_bag->entry_count = static_cast<uint32_t>(actual_count);
-  ResolvedBag* result = new_bag.get();
-  cached_bags_[resid] = std::move(new_bag);
-  return result;
+  cached_bags_.Insert(resid, new_bag);
+  return new_bag;
 }
 
 static bool Utf8ToUtf16(StringPiece str, std::u16string* out) {
@@ -1412,19 +1659,56 @@ base::expected<uint32_t, NullOrIOError> AssetManager2::GetResourceId(
   return base::unexpected(std::nullopt);
 }
 
-void AssetManager2::RebuildFilterList() {
-  for (PackageGroup& group : package_groups_) {
-    for (ConfiguredPackage& package : group.packages_) {
-      package.filtered_configs_.forEachItem([](auto, auto& fcg) { fcg.type_entries.clear(); });
-      // Create the filters here.
-      package.loaded_package_->ForEachTypeSpec([&](const TypeSpec& type_spec, uint8_t type_id) {
-        FilteredConfigGroup* group = nullptr;
+void AssetManager2::RebuildFilterList(uint32_t diff,
+                                      const ResTable_config* previous_configuration) {
+  // The number of replaced filter lists to remember.
+  constexpr size_t kMaxFilterSnapshots = 2U;
+
+  auto restored = std::find_if(filter_snapshots_.begin(), filter_snapshots_.end(),
+                               [&](const FilterSnapshot& snapshot) {
+    return snapshot.configuration.compare(configuration_) == 0;
+  });
+  FilterSnapshot replaced;
+  if (previous_configuration != nullptr) {
+    replaced.configuration = *previous_configuration;
+  }
+  const ResTable_config::MatchKey configuration_key = configuration_.matchKey();
+
+  for (size_t gi = 0; gi < package_groups_.size(); gi++) {
+    PackageGroup& group = package_groups_[gi];
+    for (size_t pi = 0; pi < group.packages_.size(); pi++) {
+      ConfiguredPackage& package = group.packages_[pi];
+      // Create the filters here. Lazy types that have not been used yet are left unparsed.
+      package.loaded_package_->ForEachParsedTypeSpec([&](const TypeSpec& type_spec,
+                                                         uint8_t type_id) {
+        const uint8_t type_idx = type_id - 1;
+        const bool was_filtered = package.filtered_types_.test(type_idx);
+        if (was_filtered && (type_spec.config_axes & diff) == 0U) {
+          // None of the configurations of this type can start or stop matching.
+          return;
+        }
+
+        const uint64_t key = (static_cast<uint64_t>(gi) << 40U) |
+                             (static_cast<uint64_t>(pi) << 8U) | type_idx;
+        FilteredConfigGroup& filtered_group = package.filtered_configs_.editItemAt(type_idx);
+        if (was_filtered && previous_configuration != nullptr) {
+          replaced.type_entries[key] = std::move(filtered_group.type_entries);
+        }
+        filtered_group.type_entries.clear();
+        package.filtered_types_.set(type_idx);
+
+        if (restored != filter_snapshots_.end()) {
+          auto entries = restored->type_entries.find(key);
+          if (entries != restored->type_entries.end()) {
+            filtered_group.type_entries = std::move(entries->second);
+            return;
+          }
+        }
+
         for (const auto& type_entry : type_spec.type_entries) {
-          if (type_entry.config.match(configuration_)) {
-            if (!group) {
-              group = &package.filtered_configs_.editItemAt(type_id - 1);
-            }
-            group->type_entries.push_back(&type_entry);
+          if (type_entry.config.match(configuration_, type_entry.match_key,
+                                      configuration_key)) {
+            filtered_group.type_entries.push_back(&type_entry);
           }
         }
       });
@@ -1432,6 +1716,16 @@ void AssetManager2::RebuildFilterList() {
           [](const auto& fcg) { return fcg.type_entries.empty(); });
     }
   }
+
+  if (restored != filter_snapshots_.end()) {
+    filter_snapshots_.erase(restored);
+  }
+  if (previous_configuration != nullptr) {
+    filter_snapshots_.insert(filter_snapshots_.begin(), std::move(replaced));
+    if (filter_snapshots_.size() > kMaxFilterSnapshots) {
+      filter_snapshots_.pop_back();
+    }
+  }
 }
 
 void AssetManager2::InvalidateCaches(uint32_t diff) {
@@ -1439,19 +1733,17 @@ void AssetManager2::InvalidateCaches(uint32_t diff) {
 
   if (diff == 0xffffffffu) {
     // Everything must go.
-    cached_bags_.clear();
+    cached_bags_.Clear();
+    cached_themes_.clear();
     return;
   }
 
   // Be more conservative with what gets purged. Only if the bag has other possible
   // variations with respect to what changed (diff) should we remove it.
-  for (auto iter = cached_bags_.cbegin(); iter != cached_bags_.cend();) {
-    if (diff & iter->second->type_spec_flags) {
-      iter = cached_bags_.erase(iter);
-    } else {
-      ++iter;
-    }
-  }
+  cached_bags_.EraseVaryingWith(diff);
+  std::erase_if(cached_themes_, [diff](const auto& cached_theme) {
+    return (cached_theme.second.type_spec_flags & diff) != 0U;
+  });
 
   cached_resolved_values_.clear();
 }
@@ -1470,8 +1762,9 @@ uint8_t AssetManager2::GetAssignedPackageId(const LoadedPackage* package) const
 std::unique_ptr<Theme> AssetManager2::NewTheme() {
   constexpr size_t kInitialReserveSize = 32;
   auto theme = std::unique_ptr<Theme>(new Theme(this));
-  theme->keys_.reserve(kInitialReserveSize);
-  theme->entries_.reserve(kInitialReserveSize);
+  ThemeData& data = theme->MutableData();
+  data.keys.reserve(kInitialReserveSize);
+  data.entries.reserve(kInitialReserveSize);
   return theme;
 }
 
@@ -1488,11 +1781,26 @@ void AssetManager2::ForEachPackage(base::function_ref<bool(const std::string&, u
 }
 
 AssetManager2::ScopedOperation AssetManager2::StartOperation() const {
+  if (concurrent_locks_ != nullptr) {
+    std::lock_guard<std::mutex> lock(concurrent_locks_->operation_lock);
+    if (number_of_running_scoped_operations_++ == 0) {
+      // Promote all assets up front so that GetApkAssets() doesn't modify `apk_assets_` while
+      // other threads read it.
+      for (auto&& [wptr, assets] : apk_assets_) {
+        assets = wptr.promote();
+      }
+    }
+    return ScopedOperation(*this);
+  }
   ++number_of_running_scoped_operations_;
   return ScopedOperation(*this);
 }
 
 void AssetManager2::FinishOperation() const {
+  std::unique_lock<std::mutex> lock;
+  if (concurrent_locks_ != nullptr) {
+    lock = std::unique_lock(concurrent_locks_->operation_lock);
+  }
   if (number_of_running_scoped_operations_ < 1) {
     ALOGW("Invalid FinishOperation() call when there's none happening");
     return;
@@ -1512,7 +1820,7 @@ const AssetManager2::ApkAssetsPtr& AssetManager2::GetApkAssets(ApkAssetsCookie c
     return empty;
   }
   auto& [wptr, res] = apk_assets_[cookie];
-  if (!res) {
+  if (!res && concurrent_locks_ == nullptr) {
     res = wptr.promote();
   }
   return res;
@@ -1529,17 +1837,67 @@ struct Theme::Entry {
   Res_value value;
 };
 
+struct ThemeData {
+  std::vector<uint32_t> keys;
+  std::vector<Theme::Entry> entries;
+};
+
+size_t AssetManager2::StyleStackHash::operator()(const std::vector<uint32_t>& style_stack) const {
+  size_t hash = style_stack.size();
+  for (uint32_t value : style_stack) {
+    hash = hash * 31U + value;
+  }
+  return hash;
+}
+
+ThemeData& Theme::MutableData() {
+  // The entries can only be modified in place if nothing else shares them.
+  if (data_ == nullptr) {
+    data_ = std::make_shared<ThemeData>();
+  } else if (data_.use_count() > 1) {
+    data_ = std::make_shared<ThemeData>(*data_);
+  }
+  return const_cast<ThemeData&>(*data_);
+}
+
 base::expected<std::monostate, NullOrIOError> Theme::ApplyStyle(uint32_t resid, bool force) {
   ATRACE_NAME("Theme::ApplyStyle");
+  ResourceTimer _timer(ResourceTimer::Counter::ThemeApplyStyle);
+
+  // The maximum number of themes kept in AssetManager2::cached_themes_.
+  constexpr size_t kMaxCachedThemes = 64U;
+
+  std::vector<uint32_t> style_stack;
+  if (style_stack_valid_) {
+    style_stack = style_stack_;
+    style_stack.push_back(resid);
+    style_stack.push_back(force ? 1U : 0U);
+
+    auto lock = asset_manager_->ReadLockCaches();
+    auto cached_theme = asset_manager_->cached_themes_.find(style_stack);
+    if (cached_theme != asset_manager_->cached_themes_.end()) {
+      data_ = cached_theme->second.data;
+      type_spec_flags_ |= cached_theme->second.type_spec_flags;
+      style_stack_ = std::move(style_stack);
+      style_stack_flags_ = cached_theme->second.type_spec_flags;
+      return {};
+    }
+  }
 
   auto bag = asset_manager_->GetBag(resid);
   if (!bag.has_value()) {
     return base::unexpected(bag.error());
   }
 
+  // The style stack stays valid only if the style is fully applied.
+  style_stack_valid_ = false;
+
   // Merge the flags from this style.
   type_spec_flags_ |= (*bag)->type_spec_flags;
 
+  ThemeData& data = MutableData();
+  auto& keys = data.keys;
+  auto& entries = data.entries;
   for (auto it = begin(*bag); it != end(*bag); ++it) {
     const uint32_t attr_res_id = it->key;
 
@@ -1557,21 +1915,35 @@ base::expected<std::monostate, NullOrIOError> Theme::ApplyStyle(uint32_t resid,
       continue;
     }
 
-    const auto key_it = std::lower_bound(keys_.begin(), keys_.end(), attr_res_id);
-    const auto entry_it = entries_.begin() + (key_it - keys_.begin());
-    if (key_it != keys_.end() && *key_it == attr_res_id) {
+    const auto key_it = std::lower_bound(keys.begin(), keys.end(), attr_res_id);
+    const auto entry_it = entries.begin() + (key_it - keys.begin());
+    if (key_it != keys.end() && *key_it == attr_res_id) {
       if (is_undefined) {
         // DATA_NULL_UNDEFINED clears the value of the attribute in the theme only when `force` is
         // true.
-        keys_.erase(key_it);
-        entries_.erase(entry_it);
+        keys.erase(key_it);
+        entries.erase(entry_it);
       } else if (force) {
         *entry_it = Entry{it->cookie, (*bag)->type_spec_flags, it->value};
       }
     } else {
-      keys_.insert(key_it, attr_res_id);
-      entries_.insert(entry_it, Entry{it->cookie, (*bag)->type_spec_flags, it->value});
+      keys.insert(key_it, attr_res_id);
+      entries.insert(entry_it, Entry{it->cookie, (*bag)->type_spec_flags, it->value});
+    }
+  }
+
+  if (!style_stack.empty()) {
+    // Share the result with themes that apply the same styles later on.
+    style_stack_ = std::move(style_stack);
+    style_stack_valid_ = true;
+    style_stack_flags_ |= (*bag)->type_spec_flags;
+
+    auto lock = asset_manager_->WriteLockCaches();
+    if (asset_manager_->cached_themes_.size() >= kMaxCachedThemes) {
+      asset_manager_->cached_themes_.clear();
     }
+    asset_manager_->cached_themes_.emplace(style_stack_, AssetManager2::CachedTheme{
+        .data = data_, .type_spec_flags = style_stack_flags_});
   }
   return {};
 }
@@ -1579,10 +1951,7 @@ base::expected<std::monostate, NullOrIOError> Theme::ApplyStyle(uint32_t resid,
 void Theme::Rebase(AssetManager2* am, const uint32_t* style_ids, const uint8_t* force,
                    size_t style_count) {
   ATRACE_NAME("Theme::Rebase");
-  // Reset the entries without changing the vector capacity to prevent reallocations during
-  // ApplyStyle.
-  keys_.clear();
-  entries_.clear();
+  Clear();
   asset_manager_ = am;
   for (size_t i = 0; i < style_count; i++) {
     ApplyStyle(style_ids[i], force[i]);
@@ -1592,12 +1961,16 @@ void Theme::Rebase(AssetManager2* am, const uint32_t* style_ids, const uint8_t*
 std::optional<AssetManager2::SelectedValue> Theme::GetAttribute(uint32_t resid) const {
   constexpr const uint32_t kMaxIterations = 20;
   uint32_t type_spec_flags = 0u;
+  if (data_ == nullptr) {
+    return std::nullopt;
+  }
+  const auto& keys = data_->keys;
   for (uint32_t i = 0; i <= kMaxIterations; i++) {
-    const auto key_it = std::lower_bound(keys_.begin(), keys_.end(), resid);
-    if (key_it == keys_.end() || *key_it != resid) {
+    const auto key_it = std::lower_bound(keys.begin(), keys.end(), resid);
+    if (key_it == keys.end() || *key_it != resid) {
       return std::nullopt;
     }
-    const auto entry_it = entries_.begin() + (key_it - keys_.begin());
+    const auto entry_it = data_->entries.begin() + (key_it - keys.begin());
     type_spec_flags |= entry_it->type_spec_flags;
     if (entry_it->value.dataType == Res_value::TYPE_ATTRIBUTE) {
       resid = entry_it->value.data;
@@ -1631,8 +2004,18 @@ base::expected<std::monostate, NullOrIOError> Theme::ResolveAttributeReference(
 }
 
 void Theme::Clear() {
-  keys_.clear();
-  entries_.clear();
+  if (data_ != nullptr && data_.use_count() == 1) {
+    // Reset the entries without changing the vector capacity to prevent reallocations during
+    // ApplyStyle.
+    ThemeData& data = MutableData();
+    data.keys.clear();
+    data.entries.clear();
+  } else {
+    data_.reset();
+  }
+  style_stack_.clear();
+  style_stack_valid_ = true;
+  style_stack_flags_ = 0u;
 }
 
 base::expected<std::monostate, IOError> Theme::SetTo(const Theme& source) {
@@ -1643,8 +2026,11 @@ base::expected<std::monostate, IOError> Theme::SetTo(const Theme& source) {
   type_spec_flags_ = source.type_spec_flags_;
 
   if (asset_manager_ == source.asset_manager_) {
-    keys_ = source.keys_;
-    entries_ = source.entries_;
+    // Share the entries until one of the themes is modified.
+    data_ = source.data_;
+    style_stack_ = source.style_stack_;
+    style_stack_valid_ = source.style_stack_valid_;
+    style_stack_flags_ = source.style_stack_flags_;
   } else {
     std::unordered_map<ApkAssetsCookie, ApkAssetsCookie> src_to_dest_asset_cookies;
     using SourceToDestinationRuntimePackageMap = std::unordered_map<int, int>;
@@ -1683,12 +2069,19 @@ base::expected<std::monostate, IOError> Theme::SetTo(const Theme& source) {
       }
     }
 
-    // Reset the data in the destination theme.
-    keys_.clear();
-    entries_.clear();
+    // Reset the data in the destination theme. The copied entries don't correspond to styles
+    // applied through this theme's AssetManager, so they can't be shared.
+    Clear();
+    style_stack_valid_ = false;
+    if (source.data_ == nullptr) {
+      return {};
+    }
+    ThemeData& data = MutableData();
+    auto& keys = data.keys;
+    auto& entries = data.entries;
 
-    for (size_t i = 0, size = source.entries_.size(); i != size; ++i) {
-      const auto& entry = source.entries_[i];
+    for (size_t i = 0, size = source.data_->entries.size(); i != size; ++i) {
+      const auto& entry = source.data_->entries[i];
       bool is_reference = (entry.value.dataType == Res_value::TYPE_ATTRIBUTE
                            || entry.value.dataType == Res_value::TYPE_REFERENCE
                            || entry.value.dataType == Res_value::TYPE_DYNAMIC_ATTRIBUTE
@@ -1728,7 +2121,7 @@ base::expected<std::monostate, IOError> Theme::SetTo(const Theme& source) {
         }
       }
 
-      const auto source_res_id = source.keys_[i];
+      const auto source_res_id = source.data_->keys[i];
 
       // The package id of the attribute needs to be rewritten to the package id of the
       // attribute in the destination.
@@ -1762,11 +2155,11 @@ base::expected<std::monostate, IOError> Theme::SetTo(const Theme& source) {
 
       auto dest_attr_id = make_resid(attribute_dest_package_id, get_type_id(source_res_id),
                                      get_entry_id(source_res_id));
-      const auto key_it = std::lower_bound(keys_.begin(), keys_.end(), dest_attr_id);
-      const auto entry_it = entries_.begin() + (key_it - keys_.begin());
+      const auto key_it = std::lower_bound(keys.begin(), keys.end(), dest_attr_id);
+      const auto entry_it = entries.begin() + (key_it - keys.begin());
       // Since the entries were cleared, the attribute resource id has yet been mapped to any value.
-      keys_.insert(key_it, dest_attr_id);
-      entries_.insert(entry_it, Entry{data_dest_cookie, entry.type_spec_flags,
+      keys.insert(key_it, dest_attr_id);
+      entries.insert(entry_it, Entry{data_dest_cookie, entry.type_spec_flags,
                                       Res_value{.dataType = entry.value.dataType,
                                                 .data = attribute_data}});
     }
@@ -1776,9 +2169,12 @@ base::expected<std::monostate, IOError> Theme::SetTo(const Theme& source) {
 
 void Theme::Dump() const {
   LOG(INFO) << base::StringPrintf("Theme(this=%p, AssetManager2=%p)", this, asset_manager_);
-  for (size_t i = 0, size = keys_.size(); i != size; ++i) {
-    auto res_id = keys_[i];
-    const auto& entry = entries_[i];
+  if (data_ == nullptr) {
+    return;
+  }
+  for (size_t i = 0, size = data_->keys.size(); i != size; ++i) {
+    auto res_id = data_->keys[i];
+    const auto& entry = data_->entries[i];
     LOG(INFO) << base::StringPrintf("  entry(0x%08x)=(0x%08x) type=(0x%02x), cookie(%d)",
                                     res_id, entry.value.data, entry.value.dataType,
                                     entry.cookie);
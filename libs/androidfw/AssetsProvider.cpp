@@ -16,9 +16,14 @@
 
 #include "androidfw/AssetsProvider.h"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+
 #include <android-base/errors.h>
+#include <android-base/file.h>
+#include <android-base/strings.h>
 #include <android-base/stringprintf.h>
 #include <android-base/utf8.h>
 #include <ziparchive/zip_archive.h>
@@ -26,13 +31,43 @@
 namespace android {
 namespace {
 constexpr const char* kEmptyDebugString = "<empty>";
+constexpr const char* kResourcesArsc = "resources.arsc";
+
+// Entries separated by less than this many bytes are prefetched with a single read; reading the
+// gap costs less than an additional seek on slow storage.
+constexpr off64_t kPrefetchMergeGap = 128 * 1024;
+
+void Readahead(int fd, off64_t offset, off64_t length) {
+#if defined(__linux__)
+  if (int result = posix_fadvise64(fd, offset, length, POSIX_FADV_WILLNEED); result != 0) {
+    LOG(WARNING) << "Failed to prefetch " << length << " bytes at offset " << offset << ": "
+                 << base::SystemErrorCodeToString(result);
+  }
+#else
+  (void)fd;
+  (void)offset;
+  (void)length;
+#endif
+}
 } // namespace
 
+std::atomic<prefetch_policy_t> ZipAssetsProvider::prefetch_policy_{0U};
+
 std::unique_ptr<Asset> AssetsProvider::Open(const std::string& path, Asset::AccessMode mode,
                                             bool* file_exists) const {
   return OpenInternal(path, mode, file_exists);
 }
 
+bool AssetsProvider::ForEachEntry(
+    const std::string& path,
+    base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const {
+  return ForEachFile(path, [&](StringPiece name, FileType type) {
+    if (type == kFileTypeRegular) {
+      f(name, AssetEntryInfo{});
+    }
+  });
+}
+
 std::unique_ptr<Asset> AssetsProvider::CreateAssetFromFile(const std::string& path) {
   base::unique_fd fd(base::utf8::open(path.c_str(), O_RDONLY | O_CLOEXEC));
   if (!fd.ok()) {
@@ -171,6 +206,18 @@ std::unique_ptr<Asset> ZipAssetsProvider::OpenInternal(const std::string& path,
 
     const int fd = GetFileDescriptor(zip_handle_.get());
     const off64_t fd_offset = GetFileDescriptorOffset(zip_handle_.get());
+
+    const prefetch_policy_t prefetch_policy = prefetch_policy_.load(std::memory_order_relaxed);
+    if ((prefetch_policy & PREFETCH_RECORD_OPENED_ENTRIES) != 0U) {
+      std::lock_guard<std::mutex> lock(opened_entries_lock_);
+      opened_entries_.insert(path);
+    }
+    if ((prefetch_policy & PREFETCH_RESOURCES_ARSC) != 0U && path == kResourcesArsc) {
+      Readahead(fd, entry.offset + fd_offset, entry.method == kCompressDeflated
+                                                  ? entry.compressed_length
+                                                  : entry.uncompressed_length);
+    }
+
     const bool incremental_hardening = (flags_ & PROPERTY_DISABLE_INCREMENTAL_HARDENING) == 0U;
     incfs::IncFsFileMap asset_map;
     if (entry.method == kCompressDeflated) {
@@ -191,7 +238,9 @@ std::unique_ptr<Asset> ZipAssetsProvider::OpenInternal(const std::string& path,
       return asset;
     }
 
-    if (!asset_map.Create(fd, entry.offset + fd_offset, entry.uncompressed_length,
+    auto apk_map = GetApkMap();
+    if (apk_map == nullptr &&
+        !asset_map.Create(fd, entry.offset + fd_offset, entry.uncompressed_length,
                           name_.GetDebugName().c_str(), incremental_hardening)) {
       LOG(ERROR) << "Failed to mmap file '" << path << "' in APK '" << name_.GetDebugName() << "'";
       return {};
@@ -209,7 +258,10 @@ std::unique_ptr<Asset> ZipAssetsProvider::OpenInternal(const std::string& path,
       }
     }
 
-    auto asset = Asset::createFromUncompressedMap(std::move(asset_map), mode, std::move(ufd));
+    auto asset = (apk_map != nullptr)
+        ? Asset::createFromSharedMap(std::move(apk_map), entry.offset, entry.uncompressed_length,
+                                     mode, std::move(ufd))
+        : Asset::createFromUncompressedMap(std::move(asset_map), mode, std::move(ufd));
     if (asset == nullptr) {
       LOG(ERROR) << "Failed to mmap file '" << path << "' in APK '" << name_.GetDebugName() << "'";
       return {};
@@ -217,6 +269,40 @@ std::unique_ptr<Asset> ZipAssetsProvider::OpenInternal(const std::string& path,
     return asset;
 }
 
+std::shared_ptr<const incfs::IncFsFileMap> ZipAssetsProvider::GetApkMap() const {
+  // Mapping whole APKs can exhaust the address space of 32-bit processes, so they keep mapping
+  // each entry on its own.
+  if constexpr (sizeof(void*) < 8) {
+    return {};
+  }
+
+  std::lock_guard<std::mutex> lock(apk_map_lock_);
+  if (apk_map_ != nullptr || apk_map_failed_) {
+    return apk_map_;
+  }
+
+  // APKs embedded at an offset of a larger file are not mapped as a whole, since the end of the
+  // embedded region is not known here.
+  const int fd = GetFileDescriptor(zip_handle_.get());
+  struct stat sb;
+  if (GetFileDescriptorOffset(zip_handle_.get()) != 0 || fstat(fd, &sb) != 0 || sb.st_size <= 0) {
+    apk_map_failed_ = true;
+    return {};
+  }
+
+  const bool incremental_hardening = (flags_ & PROPERTY_DISABLE_INCREMENTAL_HARDENING) == 0U;
+  auto apk_map = std::make_shared<incfs::IncFsFileMap>();
+  if (!apk_map->Create(fd, 0, static_cast<size_t>(sb.st_size), name_.GetDebugName().c_str(),
+                       incremental_hardening)) {
+    LOG(WARNING) << "Failed to mmap APK '" << name_.GetDebugName()
+                 << "', mapping entries individually";
+    apk_map_failed_ = true;
+    return {};
+  }
+  apk_map_ = std::move(apk_map);
+  return apk_map_;
+}
+
 bool ZipAssetsProvider::ForEachFile(
     const std::string& root_path,
     base::function_ref<void(StringPiece, FileType)> f) const {
@@ -263,6 +349,43 @@ bool ZipAssetsProvider::ForEachFile(
     return result == -1;
 }
 
+bool ZipAssetsProvider::ForEachEntry(
+    const std::string& root_path,
+    base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const {
+  std::string root_path_full = root_path;
+  if (root_path_full.back() != '/') {
+    root_path_full += '/';
+  }
+
+  void* cookie;
+  if (StartIteration(zip_handle_.get(), &cookie, root_path_full, "") != 0) {
+    return false;
+  }
+
+  // Entry offsets are relative to the start of the archive, which may be embedded in a larger file.
+  const off64_t fd_offset = GetFileDescriptorOffset(zip_handle_.get());
+  std::string name;
+  ::ZipEntry entry{};
+
+  int32_t result;
+  while ((result = Next(cookie, &entry, &name)) == 0) {
+    StringPiece leaf_file_path = StringPiece(name).substr(root_path_full.size());
+    if (leaf_file_path.empty() || leaf_file_path.find('/') != StringPiece::npos) {
+      continue;
+    }
+    f(leaf_file_path, AssetEntryInfo{
+        .offset = entry.offset + fd_offset,
+        .compressed_length = static_cast<off64_t>(entry.compressed_length),
+        .uncompressed_length = static_cast<off64_t>(entry.uncompressed_length),
+        .method = entry.method,
+    });
+  }
+  EndIteration(cookie);
+
+  // -1 is end of iteration, anything else is an error.
+  return result == -1;
+}
+
 std::optional<uint32_t> ZipAssetsProvider::GetCrc(std::string_view path) const {
   ::ZipEntry entry;
   if (FindEntry(zip_handle_.get(), path, &entry) != 0) {
@@ -271,6 +394,93 @@ std::optional<uint32_t> ZipAssetsProvider::GetCrc(std::string_view path) const {
   return entry.crc32;
 }
 
+void ZipAssetsProvider::SetPrefetchPolicy(prefetch_policy_t policy) {
+  prefetch_policy_.store(policy, std::memory_order_relaxed);
+}
+
+prefetch_policy_t ZipAssetsProvider::GetPrefetchPolicy() {
+  return prefetch_policy_.load(std::memory_order_relaxed);
+}
+
+size_t ZipAssetsProvider::Prefetch(const std::vector<std::string>& entry_names) const {
+  struct Range {
+    off64_t offset;
+    off64_t length;
+  };
+
+  std::vector<Range> ranges;
+  ranges.reserve(entry_names.size());
+  for (const std::string& name : entry_names) {
+    ::ZipEntry entry;
+    if (FindEntry(zip_handle_.get(), name, &entry) != 0) {
+      continue;
+    }
+    ranges.push_back(Range{entry.offset, entry.method == kCompressDeflated
+                                             ? static_cast<off64_t>(entry.compressed_length)
+                                             : static_cast<off64_t>(entry.uncompressed_length)});
+  }
+
+  if (ranges.empty()) {
+    return 0U;
+  }
+
+  std::sort(ranges.begin(), ranges.end(),
+            [](const Range& a, const Range& b) { return a.offset < b.offset; });
+
+  const int fd = GetFileDescriptor(zip_handle_.get());
+  const off64_t fd_offset = GetFileDescriptorOffset(zip_handle_.get());
+  Range current = ranges.front();
+  for (auto iter = ranges.begin() + 1; iter != ranges.end(); ++iter) {
+    const off64_t current_end = current.offset + current.length;
+    if (iter->offset <= current_end + kPrefetchMergeGap) {
+      current.length = std::max(current_end, iter->offset + iter->length) - current.offset;
+      continue;
+    }
+    Readahead(fd, current.offset + fd_offset, current.length);
+    current = *iter;
+  }
+  Readahead(fd, current.offset + fd_offset, current.length);
+  return ranges.size();
+}
+
+std::vector<std::string> ZipAssetsProvider::GetOpenedEntries() const {
+  std::lock_guard<std::mutex> lock(opened_entries_lock_);
+  return {opened_entries_.begin(), opened_entries_.end()};
+}
+
+std::optional<std::vector<std::string>> ZipAssetsProvider::ReadPrefetchList(
+    const std::string& path) {
+  std::string contents;
+  if (!base::ReadFileToString(path, &contents)) {
+    return {};
+  }
+
+  std::vector<std::string> entry_names;
+  for (std::string& name : base::Split(contents, "\n")) {
+    if (!name.empty()) {
+      entry_names.push_back(std::move(name));
+    }
+  }
+  return entry_names;
+}
+
+bool ZipAssetsProvider::WritePrefetchList(const std::string& path,
+                                          const std::vector<std::string>& entry_names) {
+  std::string contents;
+  for (const std::string& name : entry_names) {
+    if (name.find('\n') != std::string::npos) {
+      // Zip entry names may contain any character, but such entries are not worth prefetching.
+      continue;
+    }
+    contents.append(name).append(1, '\n');
+  }
+  if (!base::WriteStringToFile(contents, path)) {
+    PLOG(ERROR) << "Failed to write prefetch list '" << path << "'";
+    return false;
+  }
+  return true;
+}
+
 std::optional<std::string_view> ZipAssetsProvider::GetPath() const {
   if (name_.GetPath() != nullptr) {
     return *name_.GetPath();
@@ -389,6 +599,12 @@ bool MultiAssetsProvider::ForEachFile(
   return primary_->ForEachFile(root_path, f) && secondary_->ForEachFile(root_path, f);
 }
 
+bool MultiAssetsProvider::ForEachEntry(
+    const std::string& root_path,
+    base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const {
+  return primary_->ForEachEntry(root_path, f) && secondary_->ForEachEntry(root_path, f);
+}
+
 std::optional<std::string_view> MultiAssetsProvider::GetPath() const {
   return path_;
 }
@@ -16,12 +16,14 @@
 
 #include "androidfw/AttributeResolution.h"
 
+#include <algorithm>
 #include <cstdint>
 
 #include <log/log.h>
 
 #include "androidfw/AssetManager2.h"
 #include "androidfw/AttributeFinder.h"
+#include "androidfw/ResourceTimer.h"
 
 constexpr bool kDebugStyles = false;
 #define DEBUG_LOG(...) do { if (kDebugStyles) { ALOGI(__VA_ARGS__); } } while(0)
@@ -63,6 +65,34 @@ class BagAttributeFinder
   }
 };
 
+// Finds attributes in a bag by merging it with a sorted list of requested attributes.
+//
+// ResolvedBag entries are always sorted by key, so when the requested attributes are sorted as
+// well the cursor only ever moves forward and each bag entry is compared at most once. Attributes
+// must be requested in increasing order.
+class SortedBagAttributeFinder {
+ public:
+  explicit SortedBagAttributeFinder(const ResolvedBag* bag)
+      : current_(bag != nullptr ? bag->entries : nullptr),
+        end_(bag != nullptr ? bag->entries + bag->entry_count : nullptr) {
+  }
+
+  inline const ResolvedBag::Entry* Find(uint32_t attr) {
+    while (current_ != end_ && current_->key < attr) {
+      ++current_;
+    }
+    return (current_ != end_ && current_->key == attr) ? current_ : end_;
+  }
+
+  inline const ResolvedBag::Entry* end() const {
+    return end_;
+  }
+
+ private:
+  const ResolvedBag::Entry* current_;
+  const ResolvedBag::Entry* end_;
+};
+
 base::expected<const ResolvedBag*, NullOrIOError> GetStyleBag(Theme* theme,
                                                               uint32_t theme_attribute_resid,
                                                               uint32_t fallback_resid,
@@ -217,34 +247,20 @@ base::expected<std::monostate, IOError> ResolveAttrs(Theme* theme, uint32_t def_
   return {};
 }
 
-base::expected<std::monostate, IOError> ApplyStyle(Theme* theme, ResXMLParser* xml_parser,
-                                                   uint32_t def_style_attr,
-                                                   uint32_t def_style_resid,
-                                                   const uint32_t* attrs, size_t attrs_length,
-                                                   uint32_t* out_values, uint32_t* out_indices) {
-  DEBUG_LOG("APPLY STYLE: theme=0x%p defStyleAttr=0x%x defStyleRes=0x%x xml=0x%p", theme,
-            def_style_attr, def_style_resid, xml_parser);
+namespace {
 
+// Fills in the requested attributes of ApplyStyle(), using StyleFinder to look the attributes up
+// in the XML and default style bags.
+template <typename StyleFinder>
+base::expected<std::monostate, IOError> ApplyStyleAttributes(
+    Theme* theme, ResXMLParser* xml_parser, const ResolvedBag* default_style_bag,
+    uint32_t def_style_theme_flags, const ResolvedBag* xml_style_bag,
+    uint32_t xml_style_theme_flags, const uint32_t* attrs, size_t attrs_length,
+    uint32_t* out_values, uint32_t* out_indices) {
   int indices_idx = 0;
   const AssetManager2* assetmanager = theme->GetAssetManager();
-
-  // Load default style from attribute, if specified...
-  uint32_t def_style_theme_flags = 0U;
-  const auto default_style_bag = GetStyleBag(theme, def_style_attr, def_style_resid,
-                                             &def_style_theme_flags);
-  if (IsIOError(default_style_bag)) {
-    return base::unexpected(GetIOError(default_style_bag.error()));
-  }
-
-  // Retrieve the style resource ID associated with the current XML tag's style attribute.
-  uint32_t xml_style_theme_flags = 0U;
-  const auto xml_style_bag = GetXmlStyleBag(theme, xml_parser, &def_style_theme_flags);
-  if (IsIOError(xml_style_bag)) {
-    return base::unexpected(GetIOError(xml_style_bag.error()));
-  }
-
-  BagAttributeFinder def_style_attr_finder(default_style_bag.value_or(nullptr));
-  BagAttributeFinder xml_style_attr_finder(xml_style_bag.value_or(nullptr));
+  StyleFinder def_style_attr_finder(default_style_bag);
+  StyleFinder xml_style_attr_finder(xml_style_bag);
   XmlAttributeFinder xml_attr_finder(xml_parser);
 
   // Now iterate through all of the attributes that the client has requested,
@@ -276,7 +292,7 @@ base::expected<std::monostate, IOError> ApplyStyle(Theme* theme, ResXMLParser* x
       // Walk through the style class values looking for the requested attribute.
       const ResolvedBag::Entry* entry = xml_style_attr_finder.Find(cur_ident);
       if (entry != xml_style_attr_finder.end()) {
-        value = AssetManager2::SelectedValue(*xml_style_bag, *entry);
+        value = AssetManager2::SelectedValue(xml_style_bag, *entry);
         value.flags |= xml_style_theme_flags;
         value_source_resid = entry->style;
         DEBUG_LOG("-> From style: type=0x%x, data=0x%08x, style=0x%08x", value.type, value.data,
@@ -288,7 +304,7 @@ base::expected<std::monostate, IOError> ApplyStyle(Theme* theme, ResXMLParser* x
       // Walk through the default style values looking for the requested attribute.
       const ResolvedBag::Entry* entry = def_style_attr_finder.Find(cur_ident);
       if (entry != def_style_attr_finder.end()) {
-        value = AssetManager2::SelectedValue(*default_style_bag, *entry);
+        value = AssetManager2::SelectedValue(default_style_bag, *entry);
         value.flags |= def_style_theme_flags;
         value_source_resid = entry->style;
         DEBUG_LOG("-> From def style: type=0x%x, data=0x%08x, style=0x%08x", value.type, value.data,
@@ -349,6 +365,48 @@ base::expected<std::monostate, IOError> ApplyStyle(Theme* theme, ResXMLParser* x
   return {};
 }
 
+} // namespace
+
+base::expected<std::monostate, IOError> ApplyStyle(Theme* theme, ResXMLParser* xml_parser,
+                                                   uint32_t def_style_attr,
+                                                   uint32_t def_style_resid,
+                                                   const uint32_t* attrs, size_t attrs_length,
+                                                   uint32_t* out_values, uint32_t* out_indices) {
+  ResourceTimer _timer(ResourceTimer::Counter::ApplyStyle);
+  DEBUG_LOG("APPLY STYLE: theme=0x%p defStyleAttr=0x%x defStyleRes=0x%x xml=0x%p", theme,
+            def_style_attr, def_style_resid, xml_parser);
+
+  // Load default style from attribute, if specified...
+  uint32_t def_style_theme_flags = 0U;
+  const auto default_style_bag = GetStyleBag(theme, def_style_attr, def_style_resid,
+                                             &def_style_theme_flags);
+  if (IsIOError(default_style_bag)) {
+    return base::unexpected(GetIOError(default_style_bag.error()));
+  }
+
+  // Retrieve the style resource ID associated with the current XML tag's style attribute.
+  uint32_t xml_style_theme_flags = 0U;
+  const auto xml_style_bag = GetXmlStyleBag(theme, xml_parser, &def_style_theme_flags);
+  if (IsIOError(xml_style_bag)) {
+    return base::unexpected(GetIOError(xml_style_bag.error()));
+  }
+
+  const ResolvedBag* default_bag = default_style_bag.value_or(nullptr);
+  const ResolvedBag* xml_bag = xml_style_bag.value_or(nullptr);
+
+  // Bags are sorted by key, so when the requested attributes are sorted too (the common case for
+  // generated styleable arrays) a single forward merge over each bag finds every attribute.
+  // Otherwise, fall back to the finder that can back track across package IDs.
+  if (std::is_sorted(attrs, attrs + attrs_length)) {
+    return ApplyStyleAttributes<SortedBagAttributeFinder>(
+        theme, xml_parser, default_bag, def_style_theme_flags, xml_bag, xml_style_theme_flags,
+        attrs, attrs_length, out_values, out_indices);
+  }
+  return ApplyStyleAttributes<BagAttributeFinder>(
+      theme, xml_parser, default_bag, def_style_theme_flags, xml_bag, xml_style_theme_flags, attrs,
+      attrs_length, out_values, out_indices);
+}
+
 base::expected<std::monostate, IOError> RetrieveAttributes(AssetManager2* assetmanager,
                                                            ResXMLParser* xml_parser,
                                                            uint32_t* attrs,
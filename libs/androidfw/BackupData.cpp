@@ -18,8 +18,11 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <androidfw/BackupHelpers.h>
 #include <log/log.h>
 #include <utils/ByteOrder.h>
@@ -62,23 +65,26 @@ BackupDataWriter::~BackupDataWriter()
 {
 }
 
-// Pad out anything they've previously written to the next 4 byte boundary.
+// Writes all the buffers, resuming after short writes.
 status_t
-BackupDataWriter::write_padding_for(int n)
+BackupDataWriter::write_all(struct iovec* iov, int count)
 {
-    ssize_t amt;
-    ssize_t paddingSize;
-
-    paddingSize = padding_extra(n);
-    if (paddingSize > 0) {
-        uint32_t padding = 0xbcbcbcbc;
-        if (kIsDebug) ALOGI("writing %zd padding bytes for %d", paddingSize, n);
-        amt = write(m_fd, &padding, paddingSize);
-        if (amt != paddingSize) {
-            m_status = errno;
+    while (count > 0) {
+        ssize_t amt = TEMP_FAILURE_RETRY(writev(m_fd, iov, count));
+        if (amt <= 0) {
+            m_status = amt < 0 ? errno : EIO;
             return m_status;
         }
         m_pos += amt;
+        while (count > 0 && (size_t) amt >= iov->iov_len) {
+            amt -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*) iov->iov_base + amt;
+            iov->iov_len -= amt;
+        }
     }
     return NO_ERROR;
 }
@@ -90,13 +96,6 @@ BackupDataWriter::WriteEntityHeader(const String8& key, size_t dataSize)
         return m_status;
     }
 
-    ssize_t amt;
-
-    amt = write_padding_for(m_pos);
-    if (amt != 0) {
-        return amt;
-    }
-
     String8 k;
     if (m_keyPrefix.length() > 0) {
         k = m_keyPrefix;
@@ -119,27 +118,27 @@ BackupDataWriter::WriteEntityHeader(const String8& key, size_t dataSize)
     header.keyLen = tolel(keyLen);
     header.dataSize = tolel(dataSize);
 
-    if (kIsDebug) ALOGI("writing entity header, %zu bytes", sizeof(entity_header_v1));
-    amt = write(m_fd, &header, sizeof(entity_header_v1));
-    if (amt != sizeof(entity_header_v1)) {
-        m_status = errno;
-        return m_status;
+    // The padding of the previous entity's data, the header, the key and the key's padding go
+    // out in a single write.
+    uint32_t padding = 0xbcbcbcbc;
+    struct iovec iov[4] = {
+        { &padding, padding_extra(m_pos) },
+        { &header, sizeof(entity_header_v1) },
+        { const_cast<char*>(k.string()), (size_t) keyLen + 1 },
+        { &padding, padding_extra(keyLen + 1) },
+    };
+    if (kIsDebug) {
+        ALOGI("writing entity header, %zu bytes, key %zd bytes, padding %zu+%zu bytes",
+                sizeof(entity_header_v1), keyLen + 1, iov[0].iov_len, iov[3].iov_len);
     }
-    m_pos += amt;
-
-    if (kIsDebug) ALOGI("writing entity header key, %zd bytes", keyLen+1);
-    amt = write(m_fd, k.string(), keyLen+1);
-    if (amt != keyLen+1) {
-        m_status = errno;
-        return m_status;
+    status_t err = write_all(iov, 4);
+    if (err != NO_ERROR) {
+        return err;
     }
-    m_pos += amt;
-
-    amt = write_padding_for(keyLen+1);
 
     m_entityCount++;
 
-    return amt;
+    return NO_ERROR;
 }
 
 status_t
@@ -175,10 +174,18 @@ BackupDataWriter::SetKeyPrefix(const String8& keyPrefix)
 
 
 BackupDataReader::BackupDataReader(int fd)
+    :BackupDataReader(fd, 0)
+{
+}
+
+BackupDataReader::BackupDataReader(int fd, size_t bufferSize)
     :m_fd(fd),
      m_done(false),
      m_status(NO_ERROR),
-     m_entityCount(0)
+     m_entityCount(0),
+     m_buffer(bufferSize),
+     m_bufferStart(0),
+     m_bufferEnd(0)
 {
     memset(&m_header, 0, sizeof(m_header));
     m_pos = (ssize_t) lseek(fd, 0, SEEK_CUR);
@@ -237,7 +244,7 @@ BackupDataReader::ReadNextHeader(bool* done, int* type)
     else if (amt != NO_ERROR) {
         return amt;
     }
-    amt = read(m_fd, &m_header, sizeof(m_header));
+    amt = read_bytes(&m_header, sizeof(m_header));
     *done = m_done = (amt == 0);
     if (*done) {
         return NO_ERROR;
@@ -270,7 +277,7 @@ BackupDataReader::ReadNextHeader(bool* done, int* type)
                 m_status = ENOMEM;
                 return m_status;
             }
-            int amt = read(m_fd, buf, size+1);
+            int amt = read_bytes(buf, size+1);
             CHECK_SIZE(amt, (int)size+1);
             m_key.unlockBuffer(size);
             m_pos += size+1;
@@ -318,11 +325,18 @@ BackupDataReader::SkipEntityData()
         return EINVAL;
     }
     if (m_header.entity.dataSize > 0) {
-        int pos = lseek(m_fd, m_dataEndPos, SEEK_SET);
-        if (pos == -1) {
-            return errno;
+        const size_t remaining = m_dataEndPos - m_pos;
+        if (remaining <= m_bufferEnd - m_bufferStart) {
+            m_bufferStart += remaining;
+            m_pos = m_dataEndPos;
+        } else {
+            int pos = lseek(m_fd, m_dataEndPos, SEEK_SET);
+            if (pos == -1) {
+                return errno;
+            }
+            m_pos = pos;
+            m_bufferStart = m_bufferEnd = 0;
         }
-        m_pos = pos;
     }
     SKIP_PADDING();
     return NO_ERROR;
@@ -348,7 +362,7 @@ BackupDataReader::ReadEntityData(void* data, size_t size)
     if (kIsDebug) {
         ALOGD("   reading %zu bytes", size);
     }
-    int amt = read(m_fd, data, size);
+    int amt = read_bytes(data, size);
     if (amt < 0) {
         m_status = errno;
         return -1;
@@ -361,6 +375,42 @@ BackupDataReader::ReadEntityData(void* data, size_t size)
     return amt;
 }
 
+// Reads like read(), from the read-ahead buffer when there is one. Reads as much as was asked for
+// unless the file ends or fails first.
+ssize_t
+BackupDataReader::read_bytes(void* data, size_t size)
+{
+    if (m_buffer.empty()) {
+        return read(m_fd, data, size);
+    }
+    uint8_t* out = static_cast<uint8_t*>(data);
+    size_t copied = 0;
+    while (copied < size) {
+        if (m_bufferStart == m_bufferEnd) {
+            if (size - copied >= m_buffer.size()) {
+                // Large enough not to be worth copying through the buffer.
+                ssize_t amt = read(m_fd, out + copied, size - copied);
+                if (amt <= 0) {
+                    return copied > 0 ? (ssize_t) copied : amt;
+                }
+                copied += amt;
+                continue;
+            }
+            ssize_t amt = read(m_fd, m_buffer.data(), m_buffer.size());
+            if (amt <= 0) {
+                return copied > 0 ? (ssize_t) copied : amt;
+            }
+            m_bufferStart = 0;
+            m_bufferEnd = amt;
+        }
+        const size_t chunk = std::min(size - copied, m_bufferEnd - m_bufferStart);
+        memcpy(out + copied, m_buffer.data() + m_bufferStart, chunk);
+        m_bufferStart += chunk;
+        copied += chunk;
+    }
+    return copied;
+}
+
 status_t
 BackupDataReader::skip_padding()
 {
@@ -370,7 +420,7 @@ BackupDataReader::skip_padding()
     paddingSize = padding_extra(m_pos);
     if (paddingSize > 0) {
         uint32_t padding;
-        amt = read(m_fd, &padding, paddingSize);
+        amt = read_bytes(&padding, paddingSize);
         CHECK_SIZE(amt, paddingSize);
         m_pos += amt;
     }
@@ -30,6 +30,14 @@
 #include <utime.h>
 #include <zlib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <log/log.h>
 #include <utils/ByteOrder.h>
 #include <utils/KeyedVector.h>
@@ -310,15 +318,18 @@ compute_crc32(const char* file, FileRec* out) {
         return -1;
     }
 
-    const int bufsize = 4*1024;
+    const int bufsize = 64*1024;
     int amt;
 
     char* buf = (char*)malloc(bufsize);
     int crc = crc32(0L, Z_NULL, 0);
 
+#ifdef __linux__
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
     lseek(fd, 0, SEEK_SET);
 
-    while ((amt = read(fd, buf, bufsize)) != 0) {
+    while ((amt = read(fd, buf, bufsize)) > 0) {
         crc = crc32(crc, (Bytef*)buf, amt);
     }
 
@@ -329,9 +340,65 @@ compute_crc32(const char* file, FileRec* out) {
     return NO_ERROR;
 }
 
+// The files are only read here, so more threads than this mostly contend for the same disk.
+static const int kMaxBackupWorkers = 4;
+
+// What back_up_files learns about one file before it compares snapshots.
+struct FileScan {
+    bool found = false;
+    bool readable = false;
+    FileRec rec;
+};
+
+static void
+scan_file(char const* file, FileScan* out)
+{
+    struct stat st;
+    if (stat(file, &st) != 0) {
+        // not found => treat as deleted
+        return;
+    }
+    out->found = true;
+    out->rec.file = file;
+    out->rec.deleted = false;
+    out->rec.s.modTime_sec = st.st_mtime;
+    out->rec.s.modTime_nsec = 0; // workaround sim breakage
+    //out->rec.s.modTime_nsec = st.st_mtime_nsec;
+    out->rec.s.mode = st.st_mode;
+    out->rec.s.size = st.st_size;
+    out->readable = compute_crc32(file, &out->rec) == NO_ERROR;
+}
+
+static void
+scan_files(char const* const* files, int fileCount, int workerCount,
+        std::vector<FileScan>* out)
+{
+    out->resize(fileCount);
+    if (workerCount <= 0) {
+        workerCount = std::min<int>(std::thread::hardware_concurrency(), kMaxBackupWorkers);
+    }
+    workerCount = std::max(1, std::min(workerCount, fileCount));
+
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < fileCount; ) {
+            scan_file(files[i], &(*out)[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < workerCount; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
 int
 back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD,
-        char const* const* files, char const* const* keys, int fileCount)
+        char const* const* files, char const* const* keys, int fileCount, int workerCount)
 {
     int err;
     KeyedVector<String8,FileState> oldSnapshot;
@@ -345,37 +412,29 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
         }
     }
 
+    // Stat and checksum the files up front, in parallel; everything from here on
+    // runs in key order on this thread.
+    std::vector<FileScan> scans;
+    scan_files(files, fileCount, workerCount, &scans);
+
     for (int i=0; i<fileCount; i++) {
         String8 key(keys[i]);
-        FileRec r;
-        char const* file = files[i];
-        r.file = file;
-        struct stat st;
-
-        err = stat(file, &st);
-        if (err != 0) {
+        const FileScan& scan = scans[i];
+        if (!scan.found) {
             // not found => treat as deleted
             continue;
-        } else {
-            r.deleted = false;
-            r.s.modTime_sec = st.st_mtime;
-            r.s.modTime_nsec = 0; // workaround sim breakage
-            //r.s.modTime_nsec = st.st_mtime_nsec;
-            r.s.mode = st.st_mode;
-            r.s.size = st.st_size;
-
-            if (newSnapshot.indexOfKey(key) >= 0) {
-                LOGP("back_up_files key already in use '%s'", key.string());
-                return -1;
-            }
+        }
 
-            // compute the CRC
-            if (compute_crc32(file, &r) != NO_ERROR) {
-                ALOGW("Unable to open file %s", file);
-                continue;
-            }
+        if (newSnapshot.indexOfKey(key) >= 0) {
+            LOGP("back_up_files key already in use '%s'", key.string());
+            return -1;
+        }
+
+        if (!scan.readable) {
+            ALOGW("Unable to open file %s", files[i]);
+            continue;
         }
-        newSnapshot.add(key, r);
+        newSnapshot.add(key, scan.rec);
     }
 
     int n = 0;
@@ -478,6 +537,102 @@ void send_tarfile_chunk(BackupDataWriter* writer, const char* buffer, size_t siz
     if (size != 0) writer->WriteEntityData(buffer, size);
 }
 
+// Files at least this large are read on a separate thread while write_tarfile
+// sends the previous chunk, so reading the file and writing the stream overlap.
+static const off64_t kTarfileReadAheadThreshold = 1024 * 1024;
+
+/*
+ * Reads a file ahead of write_tarfile on a worker thread, one chunk at a time
+ * through a pair of buffers. The reads are the same read() calls the
+ * sequential loop makes, so the tar stream is the same either way.
+ */
+class TarfileReadAhead {
+public:
+    TarfileReadAhead(int fd, off64_t size, size_t chunkSize)
+            : mFd(fd), mChunkSize(chunkSize), mRemaining(size) {
+        for (Chunk& chunk : mChunks) {
+            chunk.data.reset(new char[chunkSize]);
+        }
+        mThread = std::thread([this]() { run(); });
+    }
+
+    ~TarfileReadAhead() {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mCancelled = true;
+        }
+        mCondition.notify_all();
+        mThread.join();
+    }
+
+    /*
+     * Waits for the next chunk and returns the result of its read(); no more
+     * chunks follow one whose result is <= 0. The data stays valid until the
+     * next call, and has room for chunkSize bytes.
+     */
+    ssize_t next(char** outData) {
+        std::unique_lock<std::mutex> lock(mLock);
+        if (mConsumed > 0) {
+            // Hand the previous chunk back to the reader.
+            mChunks[(mConsumed - 1) % 2].ready = false;
+            mCondition.notify_all();
+        }
+        Chunk& chunk = mChunks[mConsumed % 2];
+        mCondition.wait(lock, [&chunk]() { return chunk.ready; });
+        mConsumed++;
+        *outData = chunk.data.get();
+        return chunk.result;
+    }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        ssize_t result = 0;
+        bool ready = false;
+    };
+
+    void run() {
+        for (size_t i = 0;; i++) {
+            Chunk& chunk = mChunks[i % 2];
+            {
+                std::unique_lock<std::mutex> lock(mLock);
+                mCondition.wait(lock, [this, &chunk]() { return mCancelled || !chunk.ready; });
+                if (mCancelled) {
+                    return;
+                }
+            }
+
+            size_t toRead = mRemaining > (off64_t) mChunkSize ? mChunkSize : mRemaining;
+            ssize_t nRead = read(mFd, chunk.data.get(), toRead);
+            if (nRead < 0) {
+                nRead = -errno;
+            } else {
+                mRemaining -= nRead;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                chunk.result = nRead;
+                chunk.ready = true;
+            }
+            mCondition.notify_all();
+            if (nRead <= 0 || mRemaining <= 0) {
+                return;
+            }
+        }
+    }
+
+    const int mFd;
+    const size_t mChunkSize;
+    off64_t mRemaining;
+    Chunk mChunks[2];
+    size_t mConsumed = 0;
+    bool mCancelled = false;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::thread mThread;
+};
+
 int write_tarfile(const String8& packageName, const String8& domain,
         const String8& rootpath, const String8& filepath, off64_t* outSize,
         BackupDataWriter* writer)
@@ -681,7 +836,35 @@ int write_tarfile(const String8& packageName, const String8& domain,
 
     // Now write the file data itself, for real files.  We honor tar's convention that
     // only full 512-byte blocks are sent to write().
-    if (!isdir) {
+    if (!isdir && s.st_size >= kTarfileReadAheadThreshold) {
+        TarfileReadAhead readAhead(fd, s.st_size, BUFSIZE);
+        off64_t toWrite = s.st_size;
+        while (toWrite > 0) {
+            char* data;
+            ssize_t nRead = readAhead.next(&data);
+            if (nRead < 0) {
+                err = -nRead;
+                ALOGE("Unable to read file [%s], err=%d (%s)", filepath.string(),
+                        err, strerror(err));
+                break;
+            } else if (nRead == 0) {
+                ALOGE("EOF but expect %lld more bytes in [%s]", (long long) toWrite,
+                        filepath.string());
+                err = EIO;
+                break;
+            }
+
+            // NUL-pad a short block at EOF to a 512-byte multiple, as below.
+            ssize_t partial = (nRead+512) % 512;
+            if (partial > 0) {
+                ssize_t remainder = 512 - partial;
+                memset(data + nRead, 0, remainder);
+                nRead += remainder;
+            }
+            send_tarfile_chunk(writer, data, nRead);
+            toWrite -= nRead;
+        }
+    } else if (!isdir) {
         off64_t toWrite = s.st_size;
         while (toWrite > 0) {
             size_t toRead = toWrite;
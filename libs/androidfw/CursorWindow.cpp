@@ -20,6 +20,8 @@
 
 #include <sys/mman.h>
 
+#include <type_traits>
+
 #include "android-base/logging.h"
 #include "cutils/ashmem.h"
 
@@ -130,8 +132,15 @@ status_t CursorWindow::maybeInflate() {
 fail:
     LOG(ERROR) << "Failed maybeInflate";
 fail_silent:
-    ::munmap(newData, mInflatedSize);
-    ::close(ashmemFd);
+    if (newData != nullptr && newData != MAP_FAILED) {
+        ::munmap(newData, mInflatedSize);
+    }
+    if (ashmemFd >= 0) {
+        ::close(ashmemFd);
+    }
+    // Every allocation that does not fit retries inflation, and filling a
+    // window keeps allocating until one fails; stop the retries here.
+    mInflatedSize = mSize;
     return UNKNOWN_ERROR;
 }
 
@@ -318,6 +327,67 @@ status_t CursorWindow::freeLastRow() {
     return OK;
 }
 
+status_t CursorWindow::appendRow(const RowField* fields, uint32_t numFields) {
+    if (mReadOnly) {
+        return INVALID_OPERATION;
+    }
+    if (numFields != mNumColumns) {
+        LOG(ERROR) << "Trying to append a row of " << numFields << " fields to a window with "
+                << mNumColumns << " columns";
+        return BAD_VALUE;
+    }
+
+    // Lay the data out exactly as consecutive putString()/putBlob() calls would.
+    size_t dataSize = 0;
+    for (uint32_t i = 0; i < numFields; i++) {
+        if (fields[i].type == FIELD_TYPE_STRING || fields[i].type == FIELD_TYPE_BLOB) {
+            dataSize += (fields[i].value.buffer.size + 3) & ~3;
+            if (dataSize > mInflatedSize) {
+                return NO_MEMORY;
+            }
+        }
+    }
+
+    status_t status = allocRow();
+    if (status) {
+        return status;
+    }
+    uint32_t offset = mAllocOffset;
+    if (dataSize > 0 && alloc(dataSize, &offset)) {
+        freeLastRow();
+        return NO_MEMORY;
+    }
+
+    // Look the slots up after alloc(), which may have moved them by inflating.
+    uint8_t* slot = reinterpret_cast<uint8_t*>(getFieldSlot(mNumRows - 1, 0));
+    uint8_t* data = static_cast<uint8_t*>(mData);
+    for (uint32_t i = 0; i < numFields; i++, slot -= kSlotSizeBytes) {
+        FieldSlot* fieldSlot = reinterpret_cast<FieldSlot*>(slot);
+        const RowField& field = fields[i];
+        fieldSlot->type = field.type;
+        switch (field.type) {
+            case FIELD_TYPE_INTEGER:
+                fieldSlot->data.l = field.value.l;
+                break;
+            case FIELD_TYPE_FLOAT:
+                fieldSlot->data.d = field.value.d;
+                break;
+            case FIELD_TYPE_STRING:
+            case FIELD_TYPE_BLOB:
+                memcpy(data + offset, field.value.buffer.data, field.value.buffer.size);
+                fieldSlot->data.buffer.offset = offset;
+                fieldSlot->data.buffer.size = field.value.buffer.size;
+                offset += (field.value.buffer.size + 3) & ~3;
+                break;
+            default:
+                // allocRow() already initialized the slot to null.
+                fieldSlot->type = FIELD_TYPE_NULL;
+                break;
+        }
+    }
+    return OK;
+}
+
 status_t CursorWindow::alloc(size_t size, uint32_t* outOffset) {
     if (mReadOnly) {
         return INVALID_OPERATION;
@@ -351,6 +421,149 @@ CursorWindow::FieldSlot* CursorWindow::getFieldSlot(uint32_t row, uint32_t colum
     }
 }
 
+CursorWindow::FieldSlot* CursorWindow::getColumnSlots(uint32_t column, uint32_t startRow,
+        uint32_t numRows) {
+    if (column >= mNumColumns || startRow > mNumRows || numRows > mNumRows - startRow) {
+        LOG(ERROR) << "Failed to read rows " << startRow << "+" << numRows << ", column " << column
+                << " from a window with " << mNumRows << " rows, " << mNumColumns << " columns";
+        return nullptr;
+    }
+    return static_cast<FieldSlot*>(static_cast<void*>(static_cast<uint8_t*>(mSlotsStart)
+            - ((((size_t) startRow * mNumColumns) + column) << kSlotShift)));
+}
+
+template <typename T>
+status_t CursorWindow::getNumericColumn(uint32_t column, uint32_t startRow, uint32_t numRows,
+        T* outValues) {
+    if (numRows == 0) {
+        return OK;
+    }
+    uint8_t* slot = reinterpret_cast<uint8_t*>(getColumnSlots(column, startRow, numRows));
+    if (!slot) {
+        return BAD_VALUE;
+    }
+
+    const size_t stride = (size_t) mNumColumns << kSlotShift;
+    for (uint32_t i = 0; i < numRows; i++, slot -= stride) {
+        FieldSlot* fieldSlot = reinterpret_cast<FieldSlot*>(slot);
+        switch (fieldSlot->type) {
+            case FIELD_TYPE_INTEGER:
+                outValues[i] = T(fieldSlot->data.l);
+                break;
+            case FIELD_TYPE_FLOAT:
+                outValues[i] = T(fieldSlot->data.d);
+                break;
+            case FIELD_TYPE_NULL:
+                outValues[i] = T(0);
+                break;
+            case FIELD_TYPE_STRING: {
+                size_t sizeIncludingNull;
+                const char* value = getFieldSlotValueString(fieldSlot, &sizeIncludingNull);
+                if (!value || sizeIncludingNull <= 1) {
+                    outValues[i] = T(0);
+                } else if constexpr (std::is_floating_point_v<T>) {
+                    outValues[i] = strtod(value, nullptr);
+                } else {
+                    outValues[i] = strtoll(value, nullptr, 0);
+                }
+                break;
+            }
+            default:
+                return BAD_TYPE;
+        }
+    }
+    return OK;
+}
+
+status_t CursorWindow::getLongColumn(uint32_t column, uint32_t startRow, uint32_t numRows,
+        int64_t* outValues) {
+    return getNumericColumn(column, startRow, numRows, outValues);
+}
+
+status_t CursorWindow::getDoubleColumn(uint32_t column, uint32_t startRow, uint32_t numRows,
+        double* outValues) {
+    return getNumericColumn(column, startRow, numRows, outValues);
+}
+
+status_t CursorWindow::copyRows(uint32_t startRow, uint32_t numRows, uint32_t startColumn,
+        uint32_t numColumns, int32_t* outTypes, int64_t* outLongs, double* outDoubles) {
+    if (numRows == 0 || numColumns == 0) {
+        return OK;
+    }
+    if (startColumn >= mNumColumns || numColumns > mNumColumns - startColumn) {
+        LOG(ERROR) << "Failed to read columns " << startColumn << "+" << numColumns
+                << " from a window with " << mNumColumns << " columns";
+        return BAD_VALUE;
+    }
+    uint8_t* rowSlot = reinterpret_cast<uint8_t*>(getColumnSlots(startColumn, startRow, numRows));
+    if (!rowSlot) {
+        return BAD_VALUE;
+    }
+
+    const size_t stride = (size_t) mNumColumns << kSlotShift;
+    size_t index = 0;
+    for (uint32_t r = 0; r < numRows; r++, rowSlot -= stride) {
+        uint8_t* slot = rowSlot;
+        for (uint32_t c = 0; c < numColumns; c++, index++, slot -= kSlotSizeBytes) {
+            FieldSlot* fieldSlot = reinterpret_cast<FieldSlot*>(slot);
+            int64_t l = 0;
+            double d = 0.0;
+            if (fieldSlot->type == FIELD_TYPE_INTEGER) {
+                l = fieldSlot->data.l;
+                d = double(l);
+            } else if (fieldSlot->type == FIELD_TYPE_FLOAT) {
+                d = fieldSlot->data.d;
+                l = int64_t(d);
+            }
+            outTypes[index] = fieldSlot->type;
+            if (outLongs) outLongs[index] = l;
+            if (outDoubles) outDoubles[index] = d;
+        }
+    }
+    return OK;
+}
+
+status_t CursorWindow::copyRowsToBuffer(uint32_t startRow, uint32_t numRows, uint32_t startColumn,
+        uint32_t numColumns, void* outBuffer, size_t outCapacity) {
+    if (numRows == 0 || numColumns == 0) {
+        return OK;
+    }
+    if (startColumn >= mNumColumns || numColumns > mNumColumns - startColumn) {
+        LOG(ERROR) << "Failed to read columns " << startColumn << "+" << numColumns
+                << " from a window with " << mNumColumns << " columns";
+        return BAD_VALUE;
+    }
+    uint8_t* rowSlot = reinterpret_cast<uint8_t*>(getColumnSlots(startColumn, startRow, numRows));
+    if (!rowSlot) {
+        return BAD_VALUE;
+    }
+    if (outCapacity / sizeof(BulkField) < (size_t) numRows * numColumns) {
+        return NO_MEMORY;
+    }
+
+    const size_t stride = (size_t) mNumColumns << kSlotShift;
+    uint8_t* out = static_cast<uint8_t*>(outBuffer);
+    for (uint32_t r = 0; r < numRows; r++, rowSlot -= stride) {
+        uint8_t* slot = rowSlot;
+        for (uint32_t c = 0; c < numColumns; c++, slot -= kSlotSizeBytes) {
+            FieldSlot* fieldSlot = reinterpret_cast<FieldSlot*>(slot);
+            BulkField field = {};
+            field.type = fieldSlot->type;
+            if (field.type == FIELD_TYPE_INTEGER) {
+                field.value.l = fieldSlot->data.l;
+            } else if (field.type == FIELD_TYPE_FLOAT) {
+                field.value.d = fieldSlot->data.d;
+            } else if (field.type == FIELD_TYPE_STRING || field.type == FIELD_TYPE_BLOB) {
+                field.size = fieldSlot->data.buffer.size;
+            }
+            // The buffer comes from Java and need not be aligned.
+            memcpy(out, &field, sizeof(field));
+            out += sizeof(field);
+        }
+    }
+    return OK;
+}
+
 status_t CursorWindow::putBlob(uint32_t row, uint32_t column, const void* value, size_t size) {
     return putBlobOrString(row, column, value, size, FIELD_TYPE_BLOB);
 }
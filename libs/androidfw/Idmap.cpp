@@ -18,6 +18,9 @@
 
 #include "androidfw/Idmap.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "android-base/logging.h"
 #include "android-base/stringprintf.h"
 #include "androidfw/misc.h"
@@ -143,11 +146,83 @@ status_t OverlayDynamicRefTable::lookupResourceIdNoRewrite(uint32_t* resId) cons
   return DynamicRefTable::lookupResourceId(resId);
 }
 
+namespace {
+
+// A type's overlaid entries are indexed if their range takes at most this many slots per entry,
+// plus kMinIndexedSlots.
+constexpr uint32_t kMaxSlotsPerEntry = 4U;
+constexpr uint32_t kMinIndexedSlots = 32U;
+
+}  // namespace
+
+IdmapTargetIndex::IdmapTargetIndex(const Idmap_target_entry* entries, uint32_t entry_count,
+                                   const Idmap_target_entry_inline* inline_entries,
+                                   uint32_t inline_entry_count) {
+  // The entries of each type that are overlaid: the first, the last and how many.
+  struct Range {
+    uint32_t first = 0xFFFFU;
+    uint32_t last = 0U;
+    uint32_t count = 0U;
+  };
+  std::vector<Range> ranges;
+  const auto add_range = [&ranges](uint32_t target_id) {
+    const uint32_t type_id = (target_id >> 16U) & 0xFFU;
+    const uint32_t entry = target_id & 0xFFFFU;
+    if (type_id >= ranges.size()) {
+      ranges.resize(type_id + 1);
+    }
+    Range& range = ranges[type_id];
+    range.first = std::min(range.first, entry);
+    range.last = std::max(range.last, entry);
+    range.count++;
+  };
+  for (uint32_t i = 0; i < entry_count; i++) {
+    add_range(dtohl(entries[i].target_id));
+  }
+  for (uint32_t i = 0; i < inline_entry_count; i++) {
+    add_range(dtohl(inline_entries[i].target_id));
+  }
+
+  types_.resize(ranges.size());
+  for (size_t type_id = 0; type_id < ranges.size(); type_id++) {
+    const Range& range = ranges[type_id];
+    if (range.count == 0) {
+      continue;
+    }
+    const uint32_t slot_count = range.last - range.first + 1;
+    if (slot_count > kMaxSlotsPerEntry * range.count + kMinIndexedSlots) {
+      types_[type_id].searched = true;
+      continue;
+    }
+    types_[type_id].first_entry = range.first;
+    types_[type_id].slots.resize(slot_count, 0U);
+  }
+
+  // Like the binary searches, prefer a target entry over an inline entry, and the first entry of
+  // an id over the others.
+  const auto set_slot = [this](uint32_t target_id, uint32_t slot) {
+    Type& type = types_[(target_id >> 16U) & 0xFFU];
+    if (!type.searched) {
+      uint32_t& type_slot = type.slots[(target_id & 0xFFFFU) - type.first_entry];
+      if (type_slot == 0U) {
+        type_slot = slot;
+      }
+    }
+  };
+  for (uint32_t i = 0; i < entry_count; i++) {
+    set_slot(dtohl(entries[i].target_id), i + 1);
+  }
+  for (uint32_t i = 0; i < inline_entry_count; i++) {
+    set_slot(dtohl(inline_entries[i].target_id), kInlineSlot | (i + 1));
+  }
+}
+
 IdmapResMap::IdmapResMap(const Idmap_data_header* data_header,
                          const Idmap_target_entry* entries,
                          const Idmap_target_entry_inline* inline_entries,
                          const Idmap_target_entry_inline_value* inline_entry_values,
                          const ConfigDescription* configs,
+                         const IdmapTargetIndex* target_index,
                          uint8_t target_assigned_package_id,
                          const OverlayDynamicRefTable* overlay_ref_table)
     : data_header_(data_header),
@@ -155,6 +230,7 @@ IdmapResMap::IdmapResMap(const Idmap_data_header* data_header,
       inline_entries_(inline_entries),
       inline_entry_values_(inline_entry_values),
       configurations_(configs),
+      target_index_(target_index),
       target_assigned_package_id_(target_assigned_package_id),
       overlay_ref_table_(overlay_ref_table) { }
 
@@ -168,15 +244,47 @@ IdmapResMap::Result IdmapResMap::Lookup(uint32_t target_res_id) const {
   // package id when determining if the resource in the target package is overlaid.
   target_res_id &= 0x00FFFFFFU;
 
-  // Check if the target resource is mapped to an overlay resource.
-  auto first_entry = entries_;
-  auto end_entry = entries_ + dtohl(data_header_->target_entry_count);
-  auto entry = std::lower_bound(first_entry, end_entry, target_res_id,
-                                [](const Idmap_target_entry& e, const uint32_t target_id) {
-    return (0x00FFFFFFU & dtohl(e.target_id)) < target_id;
-  });
+  const Idmap_target_entry* entry = nullptr;
+  const Idmap_target_entry_inline* inline_entry = nullptr;
+  if (const auto slot = target_index_ != nullptr ? target_index_->Find(target_res_id)
+                                                 : std::nullopt) {
+    if (*slot == 0U) {
+      return {};
+    }
+    if ((*slot & IdmapTargetIndex::kInlineSlot) != 0U) {
+      inline_entry = inline_entries_ + (*slot & ~IdmapTargetIndex::kInlineSlot) - 1;
+    } else {
+      entry = entries_ + *slot - 1;
+    }
+  } else {
+    // Check if the target resource is mapped to an overlay resource.
+    auto first_entry = entries_;
+    auto end_entry = entries_ + dtohl(data_header_->target_entry_count);
+    auto found_entry = std::lower_bound(first_entry, end_entry, target_res_id,
+                                        [](const Idmap_target_entry& e, const uint32_t target_id) {
+      return (0x00FFFFFFU & dtohl(e.target_id)) < target_id;
+    });
+    if (found_entry != end_entry &&
+        (0x00FFFFFFU & dtohl(found_entry->target_id)) == target_res_id) {
+      entry = found_entry;
+    } else {
+      // Check if the target resources is mapped to an inline table entry.
+      auto first_inline_entry = inline_entries_;
+      auto end_inline_entry = inline_entries_ + dtohl(data_header_->target_inline_entry_count);
+      auto found_inline_entry = std::lower_bound(first_inline_entry, end_inline_entry,
+                                                 target_res_id,
+                                                 [](const Idmap_target_entry_inline& e,
+                                                    const uint32_t target_id) {
+        return (0x00FFFFFFU & dtohl(e.target_id)) < target_id;
+      });
+      if (found_inline_entry != end_inline_entry &&
+          (0x00FFFFFFU & dtohl(found_inline_entry->target_id)) == target_res_id) {
+        inline_entry = found_inline_entry;
+      }
+    }
+  }
 
-  if (entry != end_entry && (0x00FFFFFFU & dtohl(entry->target_id)) == target_res_id) {
+  if (entry != nullptr) {
     uint32_t overlay_resource_id = dtohl(entry->overlay_id);
     // Lookup the resource without rewriting the overlay resource id back to the target resource id
     // being looked up.
@@ -184,17 +292,7 @@ IdmapResMap::Result IdmapResMap::Lookup(uint32_t target_res_id) const {
     return Result(overlay_resource_id);
   }
 
-  // Check if the target resources is mapped to an inline table entry.
-  auto first_inline_entry = inline_entries_;
-  auto end_inline_entry = inline_entries_ + dtohl(data_header_->target_inline_entry_count);
-  auto inline_entry = std::lower_bound(first_inline_entry, end_inline_entry, target_res_id,
-                                       [](const Idmap_target_entry_inline& e,
-                                          const uint32_t target_id) {
-    return (0x00FFFFFFU & dtohl(e.target_id)) < target_id;
-  });
-
-  if (inline_entry != end_inline_entry &&
-      (0x00FFFFFFU & dtohl(inline_entry->target_id)) == target_res_id) {
+  if (inline_entry != nullptr) {
     std::map<ConfigDescription, Res_value> values_map;
     for (int i = 0; i < inline_entry->value_count; i++) {
       const auto& value = inline_entry_values_[inline_entry->start_value_index + i];
@@ -267,6 +365,8 @@ LoadedIdmap::LoadedIdmap(std::string&& idmap_path, const Idmap_header* header,
       configurations_(configs),
       overlay_entries_(overlay_entries),
       string_pool_(std::move(string_pool)),
+      target_index_(target_entries, dtohl(data_header->target_entry_count), target_inline_entries,
+                    dtohl(data_header->target_inline_entry_count)),
       idmap_path_(std::move(idmap_path)),
       overlay_apk_path_(overlay_apk_path),
       target_apk_path_(target_apk_path),
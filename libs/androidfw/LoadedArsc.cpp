@@ -56,10 +56,21 @@ struct TypeSpecBuilder {
     TypeSpec::TypeEntry& entry = type_entries.emplace_back();
     entry.config.copyFromDtoH(type->config);
     entry.type = type;
+    entry.match_key = entry.config.matchKey();
+    config_axes |= static_cast<uint32_t>(entry.config.diff(ResTable_config{}));
+  }
+
+  // Records a type chunk that is verified and added by LoadedPackage::ParseTypeSpec().
+  void AddLazyType(incfs::map_ptr<ResTable_type> type) {
+    lazy_types.push_back(type);
   }
 
   TypeSpec Build() {
-    return {header_, std::move(type_entries)};
+    return {header_, std::move(type_entries), config_axes};
+  }
+
+  std::vector<incfs::map_ptr<ResTable_type>> TakeLazyTypes() {
+    return std::move(lazy_types);
   }
 
  private:
@@ -67,6 +78,8 @@ struct TypeSpecBuilder {
 
   incfs::verified_map_ptr<ResTable_typeSpec> header_;
   std::vector<TypeSpec::TypeEntry> type_entries;
+  uint32_t config_axes = 0U;
+  std::vector<incfs::map_ptr<ResTable_type>> lazy_types;
 };
 
 }  // namespace
@@ -322,6 +335,39 @@ LoadedPackage::GetEntryFromOffset(incfs::verified_map_ptr<ResTable_type> type_ch
   return valid;
 }
 
+const TypeSpec* LoadedPackage::ParseTypeSpec(uint8_t type_id) const {
+  std::lock_guard<std::mutex> lock(lazy_types_lock_);
+  std::atomic<uint8_t>& state = type_states_[type_id];
+  if (state.load(std::memory_order_relaxed) == kTypePending) {
+    std::vector<TypeSpec::TypeEntry> type_entries;
+    uint32_t config_axes = 0U;
+    uint8_t new_state = kTypeParsed;
+    auto lazy_type = lazy_types_.find(type_id);
+    for (const incfs::map_ptr<ResTable_type>& type : lazy_type->second) {
+      if (!VerifyResTableType(type)) {
+        LOG(ERROR) << StringPrintf("Ignoring type %02x of package '%s'.", type_id,
+                                   package_name_.c_str());
+        new_state = kTypeInvalid;
+        break;
+      }
+      TypeSpec::TypeEntry& entry = type_entries.emplace_back();
+      entry.config.copyFromDtoH(type->config);
+      entry.type = type.verified();
+      entry.match_key = entry.config.matchKey();
+      config_axes |= static_cast<uint32_t>(entry.config.diff(ResTable_config{}));
+    }
+
+    if (new_state == kTypeParsed) {
+      TypeSpec& type_spec = type_specs_[type_id];
+      type_spec.type_entries = std::move(type_entries);
+      type_spec.config_axes = config_axes;
+    }
+    lazy_types_.erase(lazy_type);
+    state.store(new_state, std::memory_order_release);
+  }
+  return (state.load(std::memory_order_relaxed) == kTypeParsed) ? &type_specs_[type_id] : nullptr;
+}
+
 base::expected<std::monostate, IOError> LoadedPackage::CollectConfigurations(
     bool exclude_mipmap, std::set<ResTable_config>* out_configs) const {
   for (const auto& type_spec : type_specs_) {
@@ -350,7 +396,11 @@ base::expected<std::monostate, IOError> LoadedPackage::CollectConfigurations(
       }
     }
 
-    for (const auto& type_entry : type_spec.second.type_entries) {
+    const TypeSpec* parsed_type_spec = GetParsedTypeSpec(type_spec.first, type_spec.second);
+    if (parsed_type_spec == nullptr) {
+      continue;
+    }
+    for (const auto& type_entry : parsed_type_spec->type_entries) {
       out_configs->insert(type_entry.config);
     }
   }
@@ -359,15 +409,15 @@ base::expected<std::monostate, IOError> LoadedPackage::CollectConfigurations(
 
 void LoadedPackage::CollectLocales(bool canonicalize, std::set<std::string>* out_locales) const {
   char temp_locale[RESTABLE_MAX_LOCALE_LEN];
-  for (const auto& type_spec : type_specs_) {
-    for (const auto& type_entry : type_spec.second.type_entries) {
+  ForEachTypeSpec([&](const TypeSpec& type_spec, uint8_t) {
+    for (const auto& type_entry : type_spec.type_entries) {
       if (type_entry.config.locale != 0) {
         type_entry.config.getBcp47Locale(temp_locale, canonicalize);
         std::string locale(temp_locale);
         out_locales->insert(std::move(locale));
       }
     }
-  }
+  });
 }
 
 base::expected<uint32_t, NullOrIOError> LoadedPackage::FindEntryByName(
@@ -378,17 +428,59 @@ base::expected<uint32_t, NullOrIOError> LoadedPackage::FindEntryByName(
     return base::unexpected(type_idx.error());
   }
 
-  const base::expected<size_t, NullOrIOError> key_idx = key_string_pool_.indexOfString(
-      entry_name.data(), entry_name.size());
+  std::lock_guard<std::mutex> lock(name_index_lock_);
+  const std::optional<uint32_t> key_idx = FindKeyIndexLocked(entry_name);
   if (!key_idx.has_value()) {
-    return base::unexpected(key_idx.error());
+    return base::unexpected(std::nullopt);
+  }
+
+  const auto entry_indices = GetEntryIndicesLocked(*type_idx);
+  if (!entry_indices.has_value()) {
+    return base::unexpected(entry_indices.error());
   }
 
-  const TypeSpec* type_spec = GetTypeSpecByTypeIndex(*type_idx);
+  const auto entry_idx = (*entry_indices)->find(*key_idx);
+  if (entry_idx == (*entry_indices)->end()) {
+    return base::unexpected(std::nullopt);
+  }
+
+  // The package ID will be overridden by the caller (due to runtime assignment of package IDs for
+  // shared libraries).
+  return make_resid(0x00, *type_idx + type_id_offset_ + 1, entry_idx->second);
+}
+
+std::optional<uint32_t> LoadedPackage::FindKeyIndexLocked(const std::u16string& entry_name) const {
+  if (!key_indices_.has_value()) {
+    auto& key_indices = key_indices_.emplace();
+    const size_t key_count = key_string_pool_.size();
+    key_indices.reserve(key_count);
+    for (size_t i = 0; i < key_count; i++) {
+      // Keep the first occurrence of duplicated names, like ResStringPool::indexOfString().
+      key_indices.emplace(util::GetString(key_string_pool_, i), i);
+    }
+  }
+
+  const auto key_idx = key_indices_->find(util::Utf16ToUtf8(entry_name));
+  if (key_idx == key_indices_->end()) {
+    return {};
+  }
+  return key_idx->second;
+}
+
+base::expected<const std::unordered_map<uint32_t, uint16_t>*, NullOrIOError>
+LoadedPackage::GetEntryIndicesLocked(uint8_t type_idx) const {
+  if (auto iter = entry_indices_.find(type_idx); iter != entry_indices_.end()) {
+    return &iter->second;
+  }
+
+  const TypeSpec* type_spec = GetTypeSpecByTypeIndex(type_idx);
   if (type_spec == nullptr) {
     return base::unexpected(std::nullopt);
   }
 
+  // Build the index in a local map so that a failure to read the entries does not leave behind a
+  // partial index.
+  std::unordered_map<uint32_t, uint16_t> entry_indices;
   for (const auto& type_entry : type_spec->type_entries) {
     const incfs::verified_map_ptr<ResTable_type>& type = type_entry.type;
 
@@ -427,15 +519,12 @@ base::expected<uint32_t, NullOrIOError> LoadedPackage::FindEntryByName(
           return base::unexpected(IOError::PAGES_MISSING);
         }
 
-        if (entry->key() == static_cast<uint32_t>(*key_idx)) {
-          // The package ID will be overridden by the caller (due to runtime assignment of package
-          // IDs for shared libraries).
-          return make_resid(0x00, *type_idx + type_id_offset_ + 1, res_idx);
-        }
+        // Types are searched in order, so keep the first entry found for each key.
+        entry_indices.emplace(entry->key(), res_idx);
       }
     }
   }
-  return base::unexpected(std::nullopt);
+  return &entry_indices_.emplace(type_idx, std::move(entry_indices)).first->second;
 }
 
 const LoadedPackage* LoadedArsc::GetPackageById(uint8_t package_id) const {
@@ -470,6 +559,11 @@ std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
     loaded_package->property_flags_ |= PROPERTY_LOADER;
   }
 
+  if ((property_flags & PROPERTY_LAZY_TYPES) != 0) {
+    loaded_package->property_flags_ |= PROPERTY_LAZY_TYPES;
+  }
+  const bool lazy_types = loaded_package->HasLazyTypes();
+
   if ((property_flags & PROPERTY_OVERLAY) != 0) {
     // Overlay resources must have an exclusive resource id space for referencing internal
     // resources.
@@ -584,14 +678,18 @@ std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
           return {};
         }
 
-        if (!VerifyResTableType(type)) {
+        if (!lazy_types && !VerifyResTableType(type)) {
           return {};
         }
 
         // Type chunks must be preceded by their TypeSpec chunks.
         std::unique_ptr<TypeSpecBuilder>& builder_ptr = type_builder_map[type->id];
         if (builder_ptr != nullptr) {
-          builder_ptr->AddType(type.verified());
+          if (lazy_types) {
+            builder_ptr->AddLazyType(type);
+          } else {
+            builder_ptr->AddType(type.verified());
+          }
         } else {
           LOG(ERROR) << StringPrintf(
               "RES_TABLE_TYPE_TYPE with ID %02x found without preceding RES_TABLE_TYPE_SPEC_TYPE.",
@@ -783,6 +881,10 @@ std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
     TypeSpec type_spec = entry.second->Build();
     uint8_t type_id = static_cast<uint8_t>(entry.first);
     loaded_package->type_specs_[type_id] = std::move(type_spec);
+    if (lazy_types) {
+      loaded_package->type_states_[type_id].store(kTypePending, std::memory_order_relaxed);
+      loaded_package->lazy_types_[type_id] = entry.second->TakeLazyTypes();
+    }
   }
 
   return std::move(loaded_package);
@@ -239,4 +239,69 @@ bool localeDataIsCloseToUsEnglish(const char* region) {
     return stop_list_index == 0; // 'en' is first in ENGLISH_STOP_LIST
 }
 
+// An entry holds the 32-bit key in its low half, then the result, biased to be non-negative, and
+// bits telling it apart from an empty slot and from a result of the other function.
+static constexpr uint64_t CACHE_RESULT_MASK = 0xFFULL << 32;
+static constexpr uint64_t CACHE_ENTRY_COMPARE_REGIONS = 1ULL << 40;
+static constexpr uint64_t CACHE_ENTRY_CLOSE_TO_US_ENGLISH = 1ULL << 41;
+
+inline uint32_t packRegion(const char* region) {
+    return (((uint8_t) region[0]) << 8u) | ((uint8_t) region[1]);
+}
+
+inline size_t cacheSlot(uint64_t tag, size_t count) {
+    const uint64_t hash = tag * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(hash >> 56) % count;
+}
+
+LocaleDataCache::LocaleDataCache() {
+    for (auto& entry : entries_) {
+        entry.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LocaleDataCache::reset(const char* language, const char* script, const char* region) {
+    memcpy(language_, language, sizeof(language_));
+    memcpy(script_, script, sizeof(script_));
+    memcpy(region_, region, sizeof(region_));
+    for (auto& entry : entries_) {
+        entry.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool LocaleDataCache::servesLocale(const char* language, const char* script,
+                                   const char* region) const {
+    return memcmp(language_, language, sizeof(language_)) == 0 &&
+            memcmp(script_, script, sizeof(script_)) == 0 &&
+            memcmp(region_, region, sizeof(region_)) == 0;
+}
+
+int LocaleDataCache::compareRegions(const char* left_region, const char* right_region) {
+    const uint64_t tag = CACHE_ENTRY_COMPARE_REGIONS |
+            (packRegion(left_region) << 16u) | packRegion(right_region);
+    auto& entry = entries_[cacheSlot(tag, kEntryCount)];
+    const uint64_t cached = entry.load(std::memory_order_relaxed);
+    if ((cached & ~CACHE_RESULT_MASK) == tag) {
+        return static_cast<int>((cached & CACHE_RESULT_MASK) >> 32) - 1;
+    }
+    // Callers only look at the sign of the comparison, so that is all that is kept.
+    const int result = localeDataCompareRegions(left_region, right_region, language_, script_,
+                                                region_);
+    const int sign = (result > 0) - (result < 0);
+    entry.store(tag | (static_cast<uint64_t>(sign + 1) << 32), std::memory_order_relaxed);
+    return sign;
+}
+
+bool LocaleDataCache::isCloseToUsEnglish(const char* region) {
+    const uint64_t tag = CACHE_ENTRY_CLOSE_TO_US_ENGLISH | packRegion(region);
+    auto& entry = entries_[cacheSlot(tag, kEntryCount)];
+    const uint64_t cached = entry.load(std::memory_order_relaxed);
+    if ((cached & ~CACHE_RESULT_MASK) == tag) {
+        return (cached & CACHE_RESULT_MASK) != 0;
+    }
+    const bool result = localeDataIsCloseToUsEnglish(region);
+    entry.store(tag | (static_cast<uint64_t>(result) << 32), std::memory_order_relaxed);
+    return result;
+}
+
 } // namespace android
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "androidfw/ResolvedBagCache.h"
+
+#include <algorithm>
+
+#include "android-base/logging.h"
+#include "androidfw/AssetManager2.h"
+
+namespace android {
+
+namespace {
+
+// Most framework and application styles fit many times into a single block, so a theme rarely
+// needs more than a handful of blocks.
+constexpr size_t kBlockSize = 16U * 1024U;
+
+constexpr size_t kBagAlignment = alignof(ResolvedBag);
+
+// The index is grown once it is half full to keep probe sequences short.
+constexpr size_t kInitialSlotCount = 64U;
+
+inline size_t Align(size_t size) {
+  return (size + kBagAlignment - 1U) & ~(kBagAlignment - 1U);
+}
+
+inline size_t Hash(uint32_t resid, size_t mask) {
+  // Resource IDs of the same type are sequential, so scramble the bits with a Fibonacci hash.
+  return (static_cast<size_t>(resid) * 0x9E3779B1U) & mask;
+}
+
+}  // namespace
+
+size_t ResolvedBagCache::SizeOf(size_t entry_count) {
+  return Align(sizeof(ResolvedBag) + entry_count * sizeof(ResolvedBag::Entry));
+}
+
+ResolvedBag* ResolvedBagCache::Find(uint32_t resid) const {
+  if (slots_.empty()) {
+    return nullptr;
+  }
+  const size_t mask = slots_.size() - 1U;
+  for (size_t i = Hash(resid, mask);; i = (i + 1U) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.resid == resid) {
+      return slot.bag;
+    }
+    if (slot.resid == 0U) {
+      return nullptr;
+    }
+  }
+}
+
+ResolvedBag* ResolvedBagCache::Allocate(size_t entry_count) {
+  const size_t size = SizeOf(entry_count);
+  if (blocks_.empty() || blocks_.back().capacity - blocks_.back().used < size) {
+    const size_t capacity = std::max(kBlockSize, size);
+    blocks_.push_back(Block{.data = std::unique_ptr<uint8_t[]>(new uint8_t[capacity]),
+                            .capacity = capacity});
+  }
+
+  Block& block = blocks_.back();
+  auto bag = reinterpret_cast<ResolvedBag*>(block.data.get() + block.used);
+  block.used += size;
+  last_allocation_ = bag;
+  last_allocation_size_ = size;
+  return bag;
+}
+
+void ResolvedBagCache::Shrink(ResolvedBag* bag, size_t entry_count) {
+  if (bag != last_allocation_ || blocks_.empty()) {
+    return;
+  }
+  const size_t size = SizeOf(entry_count);
+  if (size < last_allocation_size_) {
+    blocks_.back().used -= last_allocation_size_ - size;
+    last_allocation_size_ = size;
+  }
+}
+
+void ResolvedBagCache::Insert(uint32_t resid, ResolvedBag* bag) {
+  if ((count_ + 1U) * 2U > slots_.size()) {
+    Grow();
+  }
+  ResolvedBag* replaced = InsertSlot(resid, bag);
+  if (replaced == bag) {
+    return;
+  }
+  BlockOf(bag)->live += SizeOf(bag->entry_count);
+  if (replaced != nullptr) {
+    BlockOf(replaced)->live -= SizeOf(replaced->entry_count);
+    ReleaseUnusedBlocks();
+  }
+}
+
+ResolvedBag* ResolvedBagCache::InsertSlot(uint32_t resid, ResolvedBag* bag) {
+  const size_t mask = slots_.size() - 1U;
+  for (size_t i = Hash(resid, mask);; i = (i + 1U) & mask) {
+    Slot& slot = slots_[i];
+    if (slot.resid == 0U) {
+      slot = Slot{resid, bag};
+      ++count_;
+      return nullptr;
+    }
+    if (slot.resid == resid) {
+      ResolvedBag* replaced = slot.bag;
+      slot.bag = bag;
+      return replaced;
+    }
+  }
+}
+
+ResolvedBagCache::Block* ResolvedBagCache::BlockOf(const ResolvedBag* bag) {
+  auto address = reinterpret_cast<const uint8_t*>(bag);
+  for (Block& block : blocks_) {
+    if (address >= block.data.get() && address < block.data.get() + block.capacity) {
+      return &block;
+    }
+  }
+  LOG(FATAL) << "Bag not allocated by this cache";
+  return nullptr;
+}
+
+void ResolvedBagCache::ReleaseUnusedBlocks() {
+  if (blocks_.size() < 2U) {
+    return;
+  }
+  // The last block is kept since new bags are carved out of it. Moving a Block does not move
+  // the storage it owns, so the remaining bags stay where they are.
+  blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end() - 1,
+                               [](const Block& block) { return block.live == 0U; }),
+                blocks_.end() - 1);
+}
+
+void ResolvedBagCache::Grow() {
+  std::vector<Slot> old_slots(std::max(kInitialSlotCount, slots_.size() * 2U));
+  old_slots.swap(slots_);
+  count_ = 0U;
+  for (const Slot& slot : old_slots) {
+    if (slot.resid != 0U) {
+      InsertSlot(slot.resid, slot.bag);
+    }
+  }
+}
+
+void ResolvedBagCache::EraseVaryingWith(uint32_t diff) {
+  if (count_ == 0U) {
+    return;
+  }
+
+  // Collect the bags that survive, then rebuild the index from scratch. Open addressing without
+  // tombstones cannot erase slots in place.
+  std::vector<Slot> survivors;
+  survivors.reserve(count_);
+  for (const Slot& slot : slots_) {
+    if (slot.resid != 0U && (slot.bag->type_spec_flags & diff) == 0U) {
+      survivors.push_back(slot);
+    }
+  }
+
+  if (survivors.size() == count_) {
+    return;
+  }
+
+  for (const Slot& slot : slots_) {
+    if (slot.resid != 0U && (slot.bag->type_spec_flags & diff) != 0U) {
+      BlockOf(slot.bag)->live -= SizeOf(slot.bag->entry_count);
+    }
+  }
+
+  std::fill(slots_.begin(), slots_.end(), Slot{});
+  count_ = 0U;
+  for (const Slot& slot : survivors) {
+    InsertSlot(slot.resid, slot.bag);
+  }
+
+  ReleaseUnusedBlocks();
+}
+
+void ResolvedBagCache::Clear() {
+  std::fill(slots_.begin(), slots_.end(), Slot{});
+  count_ = 0U;
+  last_allocation_ = nullptr;
+  last_allocation_size_ = 0U;
+
+  // Keep the first block around since the cache will most likely be repopulated right away.
+  if (!blocks_.empty()) {
+    blocks_.resize(1U);
+    blocks_.front().used = 0U;
+    blocks_.front().live = 0U;
+  }
+}
+
+}  // namespace android
@@ -17,8 +17,10 @@
 #include <unistd.h>
 #include <string.h>
 
+#include <algorithm>
 #include <map>
 #include <atomic>
+#include <mutex>
 
 #include <utils/Log.h>
 #include <androidfw/ResourceTimer.h>
@@ -64,10 +66,59 @@ unsigned int diffInNs(timespec const &a, timespec const &b) {
 
 }
 
+struct ResourceTimer::Registry {
+  std::mutex lock;
+  std::vector<ThreadTimers*> threads;
+  // The events recorded by threads that have exited.
+  Timer retired[ResourceTimer::counterSize];
+};
+
+struct ResourceTimer::ThreadTimers {
+  std::mutex lock;
+  Timer timers[ResourceTimer::counterSize];
+  // The number of calls of each counter left until its next timed one.  Only used by the owning
+  // thread.
+  int countdown[ResourceTimer::counterSize] = {};
+
+  ThreadTimers() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> registry_lock(r.lock);
+    r.threads.push_back(this);
+  }
+
+  ~ThreadTimers() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> registry_lock(r.lock);
+    std::lock_guard<std::mutex> thread_lock(lock);
+    for (int i = 0; i < counterSize; i++) {
+      r.retired[i].merge(timers[i]);
+    }
+    r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+  }
+};
+
+ResourceTimer::Registry& ResourceTimer::registry() {
+  // Never destroyed, as threads may still exit after static destructors have run.
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+ResourceTimer::ThreadTimers& ResourceTimer::threadTimers() {
+  static thread_local ThreadTimers timers;
+  return timers;
+}
+
 ResourceTimer::ResourceTimer(Counter api)
-    : active_(enabled_.load()),
+    : active_(enabled_.load(std::memory_order_relaxed)),
       api_(api) {
   if (active_) {
+    ThreadTimers& t = threadTimers();
+    int& countdown = t.countdown[toIndex(api_)];
+    if (--countdown > 0) {
+      active_ = false;
+      return;
+    }
+    countdown = sample_interval_.load(std::memory_order_relaxed);
     clock_gettime(CLOCK_MONOTONIC, &start_);
   }
 }
@@ -76,11 +127,15 @@ ResourceTimer::~ResourceTimer() {
   record();
 }
 
-void ResourceTimer::enable() {
-  if (!enabled_.load()) counter_ = new GuardedTimer[ResourceTimer::counterSize];
+void ResourceTimer::enable(int sample_interval) {
+  sample_interval_.store(std::max(sample_interval, 1));
   enabled_.store(true);
 }
 
+int ResourceTimer::sampleInterval() {
+  return sample_interval_.load();
+}
+
 void ResourceTimer::cancel() {
   active_ = false;
 }
@@ -92,26 +147,37 @@ void ResourceTimer::record() {
   clock_gettime(CLOCK_MONOTONIC, &end);
   // Get the difference in microseconds.
   const unsigned int ticks = diffInNs(end, start_);
-  ScopedTimer t(counter_[toIndex(api_)]);
-  t->record(ticks);
+  ThreadTimers& t = threadTimers();
+  std::lock_guard<std::mutex> lock(t.lock);
+  t.timers[toIndex(api_)].record(ticks);
   active_ = false;
 }
 
 bool ResourceTimer::copy(int counter, Timer &dst, bool reset) {
-  ScopedTimer t(counter_[counter]);
-  if (t->count == 0) {
-    dst.reset();
-    if (reset) t->reset();
-    return false;
+  Registry& r = registry();
+  std::lock_guard<std::mutex> registry_lock(r.lock);
+  dst.reset();
+  dst.merge(r.retired[counter]);
+  if (reset) r.retired[counter].reset();
+  for (ThreadTimers* t : r.threads) {
+    std::lock_guard<std::mutex> thread_lock(t->lock);
+    dst.merge(t->timers[counter]);
+    if (reset) t->timers[counter].reset();
   }
-  Timer::copy(dst, *t, reset);
-  return true;
+  return dst.count != 0;
 }
 
 void ResourceTimer::reset() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> registry_lock(r.lock);
   for (int i = 0; i < counterSize; i++) {
-    ScopedTimer t(counter_[i]);
-    t->reset();
+    r.retired[i].reset();
+  }
+  for (ThreadTimers* t : r.threads) {
+    std::lock_guard<std::mutex> thread_lock(t->lock);
+    for (int i = 0; i < counterSize; i++) {
+      t->timers[i].reset();
+    }
   }
 }
 
@@ -162,6 +228,33 @@ void ResourceTimer::Timer::copy(Timer &dst, Timer &src, bool reset) {
   }
 }
 
+void ResourceTimer::Timer::merge(const Timer &other) {
+  if (other.count == 0) return;
+
+  count += other.count;
+  total += other.total;
+  if (mintime == 0 || (other.mintime != 0 && other.mintime < mintime)) mintime = other.mintime;
+  if (other.maxtime > maxtime) maxtime = other.maxtime;
+
+  // Both lists are sorted with the biggest value first.
+  int merged[MaxLargest];
+  for (size_t i = 0, a = 0, b = 0; i < MaxLargest; i++) {
+    merged[i] = largest[a] >= other.largest[b] ? largest[a++] : other.largest[b++];
+  }
+  memcpy(largest, merged, sizeof(largest));
+
+  for (int d = 0; d < MaxDimension; d++) {
+    if (other.buckets[d] == nullptr) continue;
+    if (buckets[d] == nullptr) {
+      buckets[d] = new int[MaxBuckets];
+      memset(buckets[d], 0, sizeof(int) * MaxBuckets);
+    }
+    for (int j = 0; j < MaxBuckets; j++) {
+      buckets[d][j] += other.buckets[d][j];
+    }
+  }
+}
+
 void ResourceTimer::Timer::record(int ticks) {
   // Record that the event happened.
   count++;
@@ -257,12 +350,24 @@ char const *ResourceTimer::toString(ResourceTimer::Counter counter) {
       return "GetResourceValue";
     case Counter::RetrieveAttributes:
       return "RetrieveAttributes";
+    case Counter::GetResource:
+      return "GetResource";
+    case Counter::GetBag:
+      return "GetBag";
+    case Counter::ResolveReference:
+      return "ResolveReference";
+    case Counter::ApplyStyle:
+      return "ApplyStyle";
+    case Counter::ThemeApplyStyle:
+      return "ThemeApplyStyle";
+    case Counter::LoadApkAssets:
+      return "LoadApkAssets";
   };
   return "Unknown";
 }
 
 std::atomic<bool> ResourceTimer::enabled_(false);
-std::atomic<ResourceTimer::GuardedTimer *> ResourceTimer::counter_(nullptr);
+std::atomic<int> ResourceTimer::sample_interval_(1);
 
 const int ResourceTimer::Timer::range[] = { 100 * US, 1000 * US, 10*1000 * US, 100*1000 * US };
 const int ResourceTimer::Timer::width[] = {   1 * US,   10 * US,     100 * US,     1000 * US };
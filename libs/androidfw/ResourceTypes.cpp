@@ -29,6 +29,7 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <new>
 #include <set>
 #include <type_traits>
 #include <vector>
@@ -50,6 +51,12 @@
 
 #endif
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifndef INT32_MAX
 #define INT32_MAX ((int32_t)(2147483647))
 #endif
@@ -694,15 +701,13 @@ status_t ResStringPool::getError() const
 void ResStringPool::uninit()
 {
     mError = NO_INIT;
-    if (mHeader && mCache != NULL) {
+    std::atomic<char16_t*>* cache = mCache.load(std::memory_order_relaxed);
+    if (mHeader && cache != NULL) {
         for (size_t x = 0; x < mHeader->stringCount; x++) {
-            if (mCache[x] != NULL) {
-                free(mCache[x]);
-                mCache[x] = NULL;
-            }
+            free(cache[x].load(std::memory_order_relaxed));
         }
-        free(mCache);
-        mCache = NULL;
+        delete[] cache;
+        mCache.store(NULL, std::memory_order_relaxed);
     }
     if (mOwnedData) {
         free(mOwnedData);
@@ -710,6 +715,93 @@ void ResStringPool::uninit()
     }
 }
 
+/**
+ * Returns the number of leading ASCII characters of the UTF-8 string |src|.
+ * Most resource strings are plain ASCII, so this is checked 16 bytes at a time
+ * where the CPU allows it before falling back to the full UTF-8 decoder.
+ */
+static size_t asciiPrefixLength(const uint8_t* src, size_t len)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    for (; i + 16U <= len; i += 16U) {
+        if (vmaxvq_u8(vld1q_u8(src + i)) >= 0x80U) {
+            break;
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 16U <= len; i += 16U) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(v) != 0) {
+            break;
+        }
+    }
+#endif
+    while (i < len && src[i] < 0x80U) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Widens the ASCII string |src| of |len| characters to UTF-16.
+ */
+static void widenAscii(const uint8_t* src, size_t len, char16_t* dst)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    for (; i + 16U <= len; i += 16U) {
+        const uint8x16_t v = vld1q_u8(src + i);
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + i), vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + i + 8U), vmovl_high_u8(v));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16U <= len; i += 16U) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8U), _mm_unpackhi_epi8(v, zero));
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] = src[i];
+    }
+}
+
+/**
+ * Narrows the leading ASCII characters of the UTF-16 string |src| into |dst|
+ * and returns how many were narrowed. The string is entirely ASCII if this
+ * returns |len|; otherwise the contents of |dst| past the result are undefined.
+ */
+static size_t narrowAsciiPrefix(const char16_t* src, size_t len, char* dst)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    for (; i + 8U <= len; i += 8U) {
+        // Saturating narrowing maps every non-ASCII character to a byte >= 0x80.
+        const uint8x8_t v = vqmovn_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(src + i)));
+        if (vmaxv_u8(v) >= 0x80U) {
+            break;
+        }
+        vst1_u8(reinterpret_cast<uint8_t*>(dst + i), v);
+    }
+#elif defined(__SSE2__)
+    for (; i + 8U <= len; i += 8U) {
+        // Saturating packing maps every non-ASCII character to a byte >= 0x80.
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i packed = _mm_packus_epi16(v, v);
+        if ((_mm_movemask_epi8(packed) & 0xff) != 0) {
+            break;
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#endif
+    for (; i < len && src[i] < 0x80U; i++) {
+        dst[i] = static_cast<char>(src[i]);
+    }
+    return i;
+}
+
 /**
  * Strings in UTF-16 format have length indicated by a length encoded in the
  * stored data. It is either 1 or 2 characters of length data. This allows a
@@ -824,10 +916,21 @@ base::expected<StringPiece16, NullOrIOError> ResStringPool::stringAt(size_t idx)
 
                 // encLen must be less than 0x7FFF due to encoding.
                 if ((uint32_t)(u8str+*u8len-strings) < mStringPoolSize) {
-                    AutoMutex lock(mDecodeLock);
+                    std::atomic<char16_t*>* cache = mCache.load(std::memory_order_acquire);
+                    if (cache != NULL) {
+                        if (char16_t* cached = cache[idx].load(std::memory_order_acquire)) {
+                            return StringPiece16(cached, *u16len);
+                        }
+                    }
 
-                    if (mCache != NULL && mCache[idx] != NULL) {
-                        return StringPiece16(mCache[idx], *u16len);
+                    AutoMutex lock(mDecodeLocks[idx % kDecodeLockStripes]);
+
+                    // Another thread may have decoded the string while we waited for the lock.
+                    cache = mCache.load(std::memory_order_acquire);
+                    if (cache != NULL) {
+                        if (char16_t* cached = cache[idx].load(std::memory_order_relaxed)) {
+                            return StringPiece16(cached, *u16len);
+                        }
                     }
 
                     // Retrieve the actual length of the utf8 string if the
@@ -837,12 +940,17 @@ base::expected<StringPiece16, NullOrIOError> ResStringPool::stringAt(size_t idx)
                         return base::unexpected(decodedString.error());
                     }
 
+                    const auto u8data = reinterpret_cast<const uint8_t*>(decodedString->data());
+                    const bool isAscii =
+                            asciiPrefixLength(u8data, decodedString->size()) ==
+                            decodedString->size();
+
                     // Since AAPT truncated lengths longer than 0x7FFF, check
                     // that the bits that remain after truncation at least match
                     // the bits of the actual length
-                    ssize_t actualLen = utf8_to_utf16_length(
-                        reinterpret_cast<const uint8_t*>(decodedString->data()),
-                        decodedString->size());
+                    ssize_t actualLen = isAscii
+                            ? static_cast<ssize_t>(decodedString->size())
+                            : utf8_to_utf16_length(u8data, decodedString->size());
 
                     if (actualLen < 0 || ((size_t)actualLen & 0x7FFFU) != *u16len) {
                         ALOGW("Bad string block: string #%lld decoded length is not correct "
@@ -859,24 +967,16 @@ base::expected<StringPiece16, NullOrIOError> ResStringPool::stringAt(size_t idx)
                         return base::unexpected(std::nullopt);
                     }
 
-                    utf8_to_utf16(reinterpret_cast<const uint8_t*>(decodedString->data()),
-                                  decodedString->size(), u16str, *u16len + 1);
+                    if (isAscii) {
+                        widenAscii(u8data, decodedString->size(), u16str);
+                    } else {
+                        utf8_to_utf16(u8data, decodedString->size(), u16str, *u16len + 1);
+                    }
 
-                    if (mCache == NULL) {
-#ifndef __ANDROID__
-                        if (kDebugStringPoolNoisy) {
-                            ALOGI("CREATING STRING CACHE OF %zu bytes",
-                                  mHeader->stringCount*sizeof(char16_t**));
-                        }
-#else
-                        // We do not want to be in this case when actually running Android.
-                        ALOGW("CREATING STRING CACHE OF %zu bytes",
-                                static_cast<size_t>(mHeader->stringCount*sizeof(char16_t**)));
-#endif
-                        mCache = (char16_t**)calloc(mHeader->stringCount, sizeof(char16_t*));
-                        if (mCache == NULL) {
-                            ALOGW("No memory trying to allocate decode cache table of %d bytes\n",
-                                  (int)(mHeader->stringCount*sizeof(char16_t**)));
+                    if (cache == NULL) {
+                        cache = getOrCreateDecodeCache();
+                        if (cache == NULL) {
+                            free(u16str);
                             return base::unexpected(std::nullopt);
                         }
                     }
@@ -885,7 +985,7 @@ base::expected<StringPiece16, NullOrIOError> ResStringPool::stringAt(size_t idx)
                       ALOGI("Caching UTF8 string: %s", u8str.unsafe_ptr());
                     }
 
-                    mCache[idx] = u16str;
+                    cache[idx].store(u16str, std::memory_order_release);
                     return StringPiece16(u16str, *u16len);
                 } else {
                     ALOGW("Bad string block: string #%lld extends to %lld, past end at %lld\n",
@@ -902,6 +1002,34 @@ base::expected<StringPiece16, NullOrIOError> ResStringPool::stringAt(size_t idx)
     return base::unexpected(std::nullopt);
 }
 
+std::atomic<char16_t*>* ResStringPool::getOrCreateDecodeCache() const
+{
+    AutoMutex lock(mCacheLock);
+    std::atomic<char16_t*>* cache = mCache.load(std::memory_order_relaxed);
+    if (cache != NULL) {
+        return cache;
+    }
+
+#ifndef __ANDROID__
+    if (kDebugStringPoolNoisy) {
+        ALOGI("CREATING STRING CACHE OF %zu bytes",
+              mHeader->stringCount*sizeof(char16_t**));
+    }
+#else
+    // We do not want to be in this case when actually running Android.
+    ALOGW("CREATING STRING CACHE OF %zu bytes",
+            static_cast<size_t>(mHeader->stringCount*sizeof(char16_t**)));
+#endif
+    cache = new (std::nothrow) std::atomic<char16_t*>[mHeader->stringCount]();
+    if (cache == NULL) {
+        ALOGW("No memory trying to allocate decode cache table of %d bytes\n",
+              (int)(mHeader->stringCount*sizeof(char16_t**)));
+        return NULL;
+    }
+    mCache.store(cache, std::memory_order_release);
+    return cache;
+}
+
 base::expected<StringPiece, NullOrIOError> ResStringPool::string8At(size_t idx) const
 {
     if (mError == NO_ERROR && idx < mHeader->stringCount) {
@@ -1000,6 +1128,13 @@ base::expected<String8, IOError> ResStringPool::string8ObjectAt(size_t idx) cons
         return base::unexpected(GetIOError(str16.error()));
     }
     if (str16.has_value()) {
+        String8 result;
+        char* buffer = result.lockBuffer(str16->size());
+        if (buffer != NULL &&
+                narrowAsciiPrefix(str16->data(), str16->size(), buffer) == str16->size()) {
+            result.unlockBuffer(str16->size());
+            return result;
+        }
         return String8(str16->data(), str16->size());
     }
 
@@ -2448,6 +2583,11 @@ inline bool langsAreEquivalent(const char lang1[2], const char lang2[2]) {
 
 bool ResTable_config::isLocaleBetterThan(const ResTable_config& o,
         const ResTable_config* requested) const {
+    return isLocaleBetterThan(o, requested, nullptr);
+}
+
+bool ResTable_config::isLocaleBetterThan(const ResTable_config& o,
+        const ResTable_config* requested, LocaleDataCache* locale_cache) const {
     if (requested->locale == 0) {
         // The request doesn't have a locale, so no resource is better
         // than the other.
@@ -2470,6 +2610,15 @@ bool ResTable_config::isLocaleBetterThan(const ResTable_config& o,
     // 2) If the request's script is known, the resource scripts are either
     //    unknown or match the request.
 
+    if (locale_cache != nullptr && !locale_cache->servesLocale(
+            requested->language, requested->localeScript, requested->country)) {
+        locale_cache = nullptr;
+    }
+    auto isCloseToUsEnglish = [locale_cache](const char* region) {
+        return locale_cache != nullptr ? locale_cache->isCloseToUsEnglish(region)
+                                       : localeDataIsCloseToUsEnglish(region);
+    };
+
     if (!langsAreEquivalent(language, o.language)) {
         // The languages of the two resources are not equivalent. If we are
         // here, we can only assume that the two resources matched the request
@@ -2492,11 +2641,11 @@ bool ResTable_config::isLocaleBetterThan(const ResTable_config& o,
                 } else {
                     return !(o.country[0] == '\0' || areIdentical(o.country, kUnitedStates));
                 }
-            } else if (localeDataIsCloseToUsEnglish(requested->country)) {
+            } else if (isCloseToUsEnglish(requested->country)) {
                 if (language[0] != '\0') {
-                    return localeDataIsCloseToUsEnglish(country);
+                    return isCloseToUsEnglish(country);
                 } else {
-                    return !localeDataIsCloseToUsEnglish(o.country);
+                    return !isCloseToUsEnglish(o.country);
                 }
             }
         }
@@ -2513,9 +2662,10 @@ bool ResTable_config::isLocaleBetterThan(const ResTable_config& o,
     // check the region and variant.
 
     // See if any of the regions is better than the other.
-    const int region_comparison = localeDataCompareRegions(
-            country, o.country,
-            requested->language, requested->localeScript, requested->country);
+    const int region_comparison = locale_cache != nullptr
+            ? locale_cache->compareRegions(country, o.country)
+            : localeDataCompareRegions(country, o.country,
+                    requested->language, requested->localeScript, requested->country);
     if (region_comparison != 0) {
         return (region_comparison > 0);
     }
@@ -2553,6 +2703,11 @@ bool ResTable_config::isLocaleBetterThan(const ResTable_config& o,
 
 bool ResTable_config::isBetterThan(const ResTable_config& o,
         const ResTable_config* requested) const {
+    return isBetterThan(o, requested, nullptr);
+}
+
+bool ResTable_config::isBetterThan(const ResTable_config& o,
+        const ResTable_config* requested, LocaleDataCache* locale_cache) const {
     if (requested) {
         if (imsi || o.imsi) {
             if ((mcc != o.mcc) && requested->mcc) {
@@ -2564,7 +2719,7 @@ bool ResTable_config::isBetterThan(const ResTable_config& o,
             }
         }
 
-        if (isLocaleBetterThan(o, requested)) {
+        if (isLocaleBetterThan(o, requested, locale_cache)) {
             return true;
         }
 
@@ -3010,6 +3165,41 @@ bool ResTable_config::match(const ResTable_config& settings) const {
     return true;
 }
 
+ResTable_config::MatchKey ResTable_config::matchKey() const {
+    MatchKey key{0, 0};
+    unsigned shift = 0;
+    auto put = [&key, &shift](uint32_t value, unsigned bits) {
+        const uint64_t fieldMask = (uint64_t(1) << bits) - 1;
+        key.values |= (value & fieldMask) << shift;
+        if (value != 0) {
+            key.mask |= fieldMask << shift;
+        }
+        shift += bits;
+    };
+
+    // Every dimension here is one that match() rejects when it is set and
+    // differs from the requested one. The keysHidden rule has an exception
+    // and the locale, size and version rules are not equality tests, so they
+    // are left to match(). 57 of the 64 bits are used.
+    put(mcc, 10);
+    put(mnc, 10);
+    put((screenLayout & MASK_LAYOUTDIR) >> 6, 2);
+    put((screenLayout & MASK_SCREENLONG) >> 4, 2);
+    put(uiMode & MASK_UI_MODE_TYPE, 4);
+    put((uiMode & MASK_UI_MODE_NIGHT) >> 4, 2);
+    put(screenLayout2 & MASK_SCREENROUND, 2);
+    put((colorMode & MASK_HDR) >> 2, 2);
+    put(colorMode & MASK_WIDE_COLOR_GAMUT, 2);
+    put(orientation, 2);
+    put(touchscreen, 2);
+    put(keyboard, 2);
+    put(navigation, 3);
+    put((inputFlags & MASK_NAVHIDDEN) >> 2, 2);
+    put(grammaticalInflection, 2);
+    put(minorVersion, 8);
+    return key;
+}
+
 void ResTable_config::appendDirLocale(String8& out) const {
     if (!language[0]) {
         return;
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_RESOURCES
+
+#include "androidfw/SharedResolvedCache.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
+#include <type_traits>
+
+#include "android-base/file.h"
+#include "android-base/logging.h"
+#include "android-base/stringprintf.h"
+#include "androidfw/AssetsProvider.h"
+#include "androidfw/ResourceUtils.h"
+#include "utils/Trace.h"
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t kSharedResolvedCacheMagic = 0x43525241u;  // 'ARRC'
+constexpr uint32_t kSharedResolvedCacheVersion = 1u;
+
+// Every section of the table starts at an offset aligned to this value so that the arrays can be
+// used in place once the file is mapped.
+constexpr size_t kSectionAlignment = 8u;
+
+static_assert(std::is_trivially_copyable_v<AssetManager2::SelectedValue>,
+              "SelectedValue must be trivially copyable to be stored in a shared table");
+static_assert(std::is_trivially_copyable_v<ResolvedBag::Entry>,
+              "ResolvedBag::Entry must be trivially copyable to be stored in a shared table");
+static_assert(alignof(ResolvedBag) <= kSectionAlignment);
+
+// The on-disk header of the table. The table is written and read on the same device by processes
+// of the same bitness, so all fields are in host byte order.
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t pointer_size;
+  uint32_t package_id;
+  uint32_t fingerprint_size;
+  uint32_t value_count;
+  uint32_t bag_count;
+  uint32_t bag_data_size;
+  ResTable_config config;
+};
+
+constexpr size_t Align(size_t size) {
+  return (size + kSectionAlignment - 1u) & ~(kSectionAlignment - 1u);
+}
+
+template <typename T>
+void Append(std::string* out, const T* data, size_t count) {
+  out->append(reinterpret_cast<const char*>(data), count * sizeof(T));
+  out->resize(Align(out->size()), '\0');
+}
+
+}  // namespace
+
+std::string SharedResolvedCache::ComputeFingerprint(const AssetManager2& assetmanager,
+                                                    uint8_t package_id) {
+  const uint8_t idx = assetmanager.package_ids_[package_id];
+  if (idx == 0xff) {
+    return {};
+  }
+
+  auto op = assetmanager.StartOperation();
+  const AssetManager2::PackageGroup& package_group = assetmanager.package_groups_[idx];
+  std::string fingerprint;
+  bool valid = true;
+  auto append_assets = [&](char kind, ApkAssetsCookie cookie) {
+    const auto& assets = assetmanager.GetApkAssets(cookie);
+    if (assets == nullptr) {
+      base::StringAppendF(&fingerprint, "%c%d:<null>;", kind, cookie);
+      return;
+    }
+    // A path can be updated in place, so the file it names is part of the fingerprint. Assets
+    // that are not backed by a file, or that changed since they were loaded, can't be told apart
+    // from their next version.
+    const auto path = assets->GetPath();
+    struct stat st;
+    if (!path || !assets->IsUpToDate() || stat(std::string(*path).c_str(), &st) != 0) {
+      valid = false;
+      return;
+    }
+    base::StringAppendF(&fingerprint, "%c%d:%s@%lld.%09ld/%lld;", kind, cookie,
+                        assets->GetDebugName().c_str(), static_cast<long long>(st.st_mtim.tv_sec),
+                        static_cast<long>(st.st_mtim.tv_nsec), static_cast<long long>(st.st_size));
+  };
+  for (ApkAssetsCookie cookie : package_group.cookies_) {
+    append_assets('p', cookie);
+  }
+  for (const AssetManager2::ConfiguredOverlay& overlay : package_group.overlays_) {
+    append_assets('o', overlay.cookie);
+  }
+  return valid ? fingerprint : std::string();
+}
+
+bool SharedResolvedCache::Write(const AssetManager2& assetmanager, uint8_t package_id, int fd) {
+  ATRACE_NAME("SharedResolvedCache::Write");
+  const uint8_t idx = assetmanager.package_ids_[package_id];
+  if (idx == 0xff) {
+    LOG(ERROR) << base::StringPrintf("No package with ID %02x to build a shared cache for.",
+                                     package_id);
+    return false;
+  }
+
+  auto op = assetmanager.StartOperation();
+  const std::string fingerprint = ComputeFingerprint(assetmanager, package_id);
+  if (fingerprint.empty()) {
+    LOG(WARNING) << base::StringPrintf("Package %02x can't be told apart from its next version.",
+                                       package_id);
+    return false;
+  }
+
+  std::map<uint32_t, std::pair<AssetManager2::SelectedValue, AssetManager2::SelectedValue>> values;
+  std::map<uint32_t, const ResolvedBag*> bags;
+  for (const auto& package : assetmanager.package_groups_[idx].packages_) {
+    for (uint32_t resid : *package.loaded_package_) {
+      resid = fix_package_id(resid, package_id);
+      if (values.count(resid) != 0 || bags.count(resid) != 0) {
+        continue;
+      }
+
+      auto value = assetmanager.GetResource(resid, true /* may_be_bag */);
+      if (UNLIKELY(IsIOError(value))) {
+        return false;
+      }
+      if (!value.has_value()) {
+        // The resource has no value for the configuration.
+        continue;
+      }
+
+      if (value->type == Res_value::TYPE_REFERENCE && value->data == resid) {
+        // GetResource() represents complex values as a reference to themselves.
+        auto bag = assetmanager.GetBag(resid);
+        if (UNLIKELY(IsIOError(bag))) {
+          return false;
+        }
+        if (bag.has_value()) {
+          bags.emplace(resid, *bag);
+        }
+        continue;
+      }
+
+      // Resolve the value the same way ResolveReference() resolves a reference to `resid`.
+      AssetManager2::SelectedValue resolved;
+      resolved.type = Res_value::TYPE_REFERENCE;
+      resolved.data = resid;
+      resolved.flags = 0U;
+      resolved.resid = 0U;
+      if (!assetmanager.ResolveReference(resolved).has_value()) {
+        continue;
+      }
+      values.emplace(resid, std::make_pair(*value, resolved));
+    }
+  }
+
+  std::vector<uint32_t> value_keys;
+  std::vector<AssetManager2::SelectedValue> direct_values;
+  std::vector<AssetManager2::SelectedValue> resolved_values;
+  value_keys.reserve(values.size());
+  direct_values.reserve(values.size());
+  resolved_values.reserve(values.size());
+  for (const auto& [resid, value] : values) {
+    value_keys.push_back(resid);
+    direct_values.push_back(value.first);
+    resolved_values.push_back(value.second);
+  }
+
+  std::vector<uint32_t> bag_keys;
+  std::vector<uint32_t> bag_offsets;
+  std::string bag_data;
+  for (const auto& [resid, bag] : bags) {
+    bag_keys.push_back(resid);
+    bag_offsets.push_back(static_cast<uint32_t>(bag_data.size()));
+    bag_data.append(reinterpret_cast<const char*>(bag),
+                    sizeof(ResolvedBag) + bag->entry_count * sizeof(ResolvedBag::Entry));
+    bag_data.resize(Align(bag_data.size()), '\0');
+  }
+
+  Header header = {
+      .magic = kSharedResolvedCacheMagic,
+      .version = kSharedResolvedCacheVersion,
+      .pointer_size = static_cast<uint32_t>(sizeof(void*)),
+      .package_id = package_id,
+      .fingerprint_size = static_cast<uint32_t>(fingerprint.size()),
+      .value_count = static_cast<uint32_t>(value_keys.size()),
+      .bag_count = static_cast<uint32_t>(bag_keys.size()),
+      .bag_data_size = static_cast<uint32_t>(bag_data.size()),
+      .config = assetmanager.GetConfiguration(),
+  };
+
+  std::string out;
+  Append(&out, &header, 1u);
+  Append(&out, fingerprint.data(), fingerprint.size());
+  Append(&out, value_keys.data(), value_keys.size());
+  Append(&out, direct_values.data(), direct_values.size());
+  Append(&out, resolved_values.data(), resolved_values.size());
+  Append(&out, bag_keys.data(), bag_keys.size());
+  Append(&out, bag_offsets.data(), bag_offsets.size());
+  out.append(bag_data);
+
+  if (!base::WriteFully(fd, out.data(), out.size())) {
+    PLOG(ERROR) << "Failed to write shared resolved cache";
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<const SharedResolvedCache> SharedResolvedCache::Load(const std::string& path) {
+  return Load(AssetsProvider::CreateAssetFromFile(path));
+}
+
+std::unique_ptr<const SharedResolvedCache> SharedResolvedCache::Load(
+    std::unique_ptr<Asset> asset) {
+  ATRACE_NAME("SharedResolvedCache::Load");
+  if (asset == nullptr) {
+    return {};
+  }
+
+  const auto data = reinterpret_cast<const uint8_t*>(asset->getBuffer(true /* aligned */));
+  const size_t size = static_cast<size_t>(asset->getLength());
+  if (data == nullptr || size < sizeof(Header)) {
+    LOG(ERROR) << "Shared resolved cache is too small.";
+    return {};
+  }
+
+  const Header* header = reinterpret_cast<const Header*>(data);
+  if (header->magic != kSharedResolvedCacheMagic ||
+      header->version != kSharedResolvedCacheVersion ||
+      header->pointer_size != sizeof(void*) || header->package_id > 0xffu) {
+    LOG(ERROR) << "Shared resolved cache has an incompatible header.";
+    return {};
+  }
+
+  // Validate that every section fits within the mapping before exposing it.
+  size_t offset = Align(sizeof(Header));
+  auto take = [&](size_t section_size) -> const uint8_t* {
+    if (offset > size || section_size > size - offset) {
+      return nullptr;
+    }
+    const uint8_t* section = data + offset;
+    offset = std::min(size, offset + Align(section_size));
+    return section;
+  };
+
+  const size_t value_count = header->value_count;
+  const size_t bag_count = header->bag_count;
+  const auto fingerprint = take(header->fingerprint_size);
+  const auto value_keys = take(value_count * sizeof(uint32_t));
+  const auto values = take(value_count * sizeof(AssetManager2::SelectedValue));
+  const auto resolved_values = take(value_count * sizeof(AssetManager2::SelectedValue));
+  const auto bag_keys = take(bag_count * sizeof(uint32_t));
+  const auto bag_offsets = take(bag_count * sizeof(uint32_t));
+  const auto bag_data = take(header->bag_data_size);
+  if (!fingerprint || !value_keys || !values || !resolved_values || !bag_keys || !bag_offsets ||
+      !bag_data) {
+    LOG(ERROR) << "Shared resolved cache is truncated.";
+    return {};
+  }
+
+  auto cache = std::unique_ptr<SharedResolvedCache>(new SharedResolvedCache());
+  cache->package_id_ = static_cast<uint8_t>(header->package_id);
+  cache->configuration_ = header->config;
+  cache->fingerprint_ = std::string_view(reinterpret_cast<const char*>(fingerprint),
+                                         header->fingerprint_size);
+  cache->value_keys_ = {reinterpret_cast<const uint32_t*>(value_keys), value_count};
+  cache->values_ = {reinterpret_cast<const AssetManager2::SelectedValue*>(values), value_count};
+  cache->resolved_values_ = {
+      reinterpret_cast<const AssetManager2::SelectedValue*>(resolved_values), value_count};
+  cache->bag_keys_ = {reinterpret_cast<const uint32_t*>(bag_keys), bag_count};
+  cache->bag_offsets_ = {reinterpret_cast<const uint32_t*>(bag_offsets), bag_count};
+  cache->bag_data_ = bag_data;
+
+  for (uint32_t bag_offset : cache->bag_offsets_) {
+    const size_t bag_data_size = header->bag_data_size;
+    if (bag_offset % kSectionAlignment != 0 || bag_offset > bag_data_size ||
+        bag_data_size - bag_offset < sizeof(ResolvedBag)) {
+      LOG(ERROR) << "Shared resolved cache has an invalid bag offset.";
+      return {};
+    }
+    const auto bag = reinterpret_cast<const ResolvedBag*>(bag_data + bag_offset);
+    if ((bag_data_size - bag_offset - sizeof(ResolvedBag)) / sizeof(ResolvedBag::Entry) <
+        bag->entry_count) {
+      LOG(ERROR) << "Shared resolved cache has a truncated bag.";
+      return {};
+    }
+  }
+
+  if (!std::is_sorted(cache->value_keys_.begin(), cache->value_keys_.end()) ||
+      !std::is_sorted(cache->bag_keys_.begin(), cache->bag_keys_.end())) {
+    LOG(ERROR) << "Shared resolved cache keys are not sorted.";
+    return {};
+  }
+
+  cache->asset_ = std::move(asset);
+  return cache;
+}
+
+const AssetManager2::SelectedValue* SharedResolvedCache::FindValue(uint32_t resid) const {
+  const auto iter = std::lower_bound(value_keys_.begin(), value_keys_.end(), resid);
+  if (iter == value_keys_.end() || *iter != resid) {
+    return nullptr;
+  }
+  return &values_[iter - value_keys_.begin()];
+}
+
+const AssetManager2::SelectedValue* SharedResolvedCache::FindResolvedValue(uint32_t resid) const {
+  const auto iter = std::lower_bound(value_keys_.begin(), value_keys_.end(), resid);
+  if (iter == value_keys_.end() || *iter != resid) {
+    return nullptr;
+  }
+  return &resolved_values_[iter - value_keys_.begin()];
+}
+
+const ResolvedBag* SharedResolvedCache::FindBag(uint32_t resid) const {
+  const auto iter = std::lower_bound(bag_keys_.begin(), bag_keys_.end(), resid);
+  if (iter == bag_keys_.end() || *iter != resid) {
+    return nullptr;
+  }
+  return reinterpret_cast<const ResolvedBag*>(bag_data_ + bag_offsets_[iter - bag_keys_.begin()]);
+}
+
+}  // namespace android
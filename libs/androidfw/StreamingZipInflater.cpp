@@ -58,10 +58,11 @@ StreamingZipInflater::StreamingZipInflater(int fd, off64_t compDataStart,
     mOutTotalSize = uncompSize;
     mInTotalSize = compSize;
 
-    mInBufSize = StreamingZipInflater::INPUT_CHUNK_SIZE;
+    // Small blobs do not need full sized chunks.
+    mInBufSize = min_of(compSize, StreamingZipInflater::INPUT_CHUNK_SIZE);
     mInBuf = new uint8_t[mInBufSize];
 
-    mOutBufSize = StreamingZipInflater::OUTPUT_CHUNK_SIZE;
+    mOutBufSize = min_of(uncompSize, StreamingZipInflater::OUTPUT_CHUNK_SIZE);
     mOutBuf = new uint8_t[mOutBufSize];
 
     initInflateState();
@@ -79,7 +80,7 @@ StreamingZipInflater::StreamingZipInflater(const incfs::IncFsFileMap* dataMap, s
     mInBuf = (uint8_t*) dataMap->unsafe_data(); // IncFs safety handled in zlib.
     mInBufSize = mInTotalSize;
 
-    mOutBufSize = StreamingZipInflater::OUTPUT_CHUNK_SIZE;
+    mOutBufSize = min_of(uncompSize, StreamingZipInflater::OUTPUT_CHUNK_SIZE);
     mOutBuf = new uint8_t[mOutBufSize];
 
     initInflateState();
@@ -131,6 +132,8 @@ void StreamingZipInflater::initInflateState() {
  *    a. if there is no input data to decode, read some into the input buffer
  *       and readjust the z_stream input pointers
  *    b. point the output to the start of the output buffer and decode what we can
+ *       (or, if at least a whole output buffer's worth of data is still wanted,
+ *       decode straight into the caller's buffer to save a copy)
  *    c. deliver whatever output data we can
  */
 ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
@@ -167,8 +170,15 @@ ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
             }
             // we know we've drained whatever is in the out buffer now, so just
             // start from scratch there, reading all the input we have at present.
-            mInflateState.next_out = (Bytef*) mOutBuf;
-            mInflateState.avail_out = mOutBufSize;
+            // Large reads bypass the out buffer entirely.
+            const bool direct = (outBuf != NULL) && (toRead >= mOutBufSize);
+            if (direct) {
+                mInflateState.next_out = (Bytef*) dest;
+                mInflateState.avail_out = toRead;
+            } else {
+                mInflateState.next_out = (Bytef*) mOutBuf;
+                mInflateState.avail_out = mOutBufSize;
+            }
 
             /*
             ALOGV("Inflating to outbuf: avail_in=%u avail_out=%u next_in=%p next_out=%p",
@@ -197,7 +207,16 @@ ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
 
                 // Note how much data we got, and off we go
                 mOutDeliverable = 0;
-                mOutLastDecoded = mOutBufSize - mInflateState.avail_out;
+                if (direct) {
+                    const size_t decoded = toRead - mInflateState.avail_out;
+                    mOutLastDecoded = 0;
+                    mOutCurPosition += decoded;
+                    dest += decoded;
+                    bytesRead += decoded;
+                    toRead -= decoded;
+                } else {
+                    mOutLastDecoded = mOutBufSize - mInflateState.avail_out;
+                }
             }
         }
     }
@@ -18,8 +18,11 @@
 #include <androidfw/StringPool.h>
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "android-base/logging.h"
 #include "androidfw/ResourceTypes.h"
@@ -171,11 +174,9 @@ StringPool::Ref StringPool::MakeRef(StringPiece str, const Context& context) {
 
 StringPool::Ref StringPool::MakeRefImpl(StringPiece str, const Context& context, bool unique) {
   if (unique) {
-    auto range = indexed_strings_.equal_range(str);
-    for (auto iter = range.first; iter != range.second; ++iter) {
-      if (context.priority == iter->second->context.priority) {
-        return Ref(iter->second);
-      }
+    auto iter = indexed_strings_.find(IndexKey{str, context.priority});
+    if (iter != indexed_strings_.end()) {
+      return Ref(iter->second);
     }
   }
 
@@ -188,7 +189,7 @@ StringPool::Ref StringPool::MakeRefImpl(StringPiece str, const Context& context,
 
   Entry* borrow = entry.get();
   strings_.emplace_back(std::move(entry));
-  indexed_strings_.insert(std::make_pair(StringPiece(borrow->value), borrow));
+  indexed_strings_.emplace(IndexKey{borrow->value, context.priority}, borrow);
   return Ref(borrow);
 }
 
@@ -267,19 +268,10 @@ void StringPool::Merge(StringPool&& pool) {
 void StringPool::HintWillAdd(size_t string_count, size_t style_count) {
   strings_.reserve(strings_.size() + string_count);
   styles_.reserve(styles_.size() + style_count);
+  indexed_strings_.reserve(indexed_strings_.size() + string_count);
 }
 
 void StringPool::Prune() {
-  const auto iter_end = indexed_strings_.end();
-  auto index_iter = indexed_strings_.begin();
-  while (index_iter != iter_end) {
-    if (index_iter->second->ref_ <= 0) {
-      index_iter = indexed_strings_.erase(index_iter);
-    } else {
-      ++index_iter;
-    }
-  }
-
   auto end_iter2 =
       std::remove_if(strings_.begin(), strings_.end(),
                      [](const std::unique_ptr<Entry>& entry) -> bool { return entry->ref_ <= 0; });
@@ -291,6 +283,13 @@ void StringPool::Prune() {
   strings_.erase(end_iter2, strings_.end());
   styles_.erase(end_iter3, styles_.end());
 
+  // Index the remaining strings again, so that a pruned string doesn't hide a duplicate of it that
+  // is still referenced.
+  indexed_strings_.clear();
+  for (const std::unique_ptr<Entry>& entry : strings_) {
+    indexed_strings_.emplace(IndexKey{entry->value, entry->context.priority}, entry.get());
+  }
+
   ReAssignIndices();
 }
 
@@ -300,17 +299,20 @@ static void SortEntries(
     const std::function<int(const StringPool::Context&, const StringPool::Context&)>& cmp) {
   using UEntry = std::unique_ptr<E>;
 
+  // Stable, so that duplicates keep their relative order and the output doesn't depend on the
+  // sort implementation.
   if (cmp != nullptr) {
-    std::sort(entries.begin(), entries.end(), [&cmp](const UEntry& a, const UEntry& b) -> bool {
-      int r = cmp(a->context, b->context);
-      if (r == 0) {
-        r = a->value.compare(b->value);
-      }
-      return r < 0;
-    });
+    std::stable_sort(entries.begin(), entries.end(),
+                     [&cmp](const UEntry& a, const UEntry& b) -> bool {
+                       int r = cmp(a->context, b->context);
+                       if (r == 0) {
+                         r = a->value.compare(b->value);
+                       }
+                       return r < 0;
+                     });
   } else {
-    std::sort(entries.begin(), entries.end(),
-              [](const UEntry& a, const UEntry& b) -> bool { return a->value < b->value; });
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const UEntry& a, const UEntry& b) -> bool { return a->value < b->value; });
   }
 }
 
@@ -363,8 +365,10 @@ static size_t EncodedLengthUnits(size_t length) {
 
 const std::string kStringTooLarge = "STRING_TOO_LARGE";
 
-static bool EncodeString(const std::string& str, const bool utf8, BigBuffer* out,
-                         IDiagnostics* diag) {
+// Appends the string as it is stored in a ResStringPool: its length(s), followed by the
+// null-terminated string. A string too large to encode is written as kStringTooLarge instead, and
+// false is returned.
+static bool EncodeString(const std::string& str, const bool utf8, std::string* out) {
   if (utf8) {
     const std::string& encoded = util::Utf8ToModifiedUtf8(str);
     const ssize_t utf16_length =
@@ -375,17 +379,16 @@ static bool EncodeString(const std::string& str, const bool utf8, BigBuffer* out
     // can be encoded using chars
     if ((((size_t)encoded.size()) > EncodeLengthMax<char>()) ||
         (((size_t)utf16_length) > EncodeLengthMax<char>())) {
-      diag->Error(DiagMessage() << "string too large to encode using UTF-8 "
-                                << "written instead as '" << kStringTooLarge << "'");
-
-      EncodeString(kStringTooLarge, utf8, out, diag);
+      EncodeString(kStringTooLarge, utf8, out);
       return false;
     }
 
     const size_t total_size = EncodedLengthUnits<char>(utf16_length) +
                               EncodedLengthUnits<char>(encoded.size()) + encoded.size() + 1;
 
-    char* data = out->NextBlock<char>(total_size);
+    const size_t start = out->size();
+    out->resize(start + total_size);
+    char* data = out->data() + start;
 
     // First encode the UTF16 string length.
     data = EncodeLength(data, utf16_length);
@@ -394,6 +397,7 @@ static bool EncodeString(const std::string& str, const bool utf8, BigBuffer* out
     data = EncodeLength(data, encoded.size());
     strncpy(data, encoded.data(), encoded.size());
 
+    // The null-terminating character is already here, resize() fills with 0s.
   } else {
     const std::u16string encoded = util::Utf8ToUtf16(str);
     const ssize_t utf16_length = encoded.size();
@@ -401,33 +405,73 @@ static bool EncodeString(const std::string& str, const bool utf8, BigBuffer* out
     // Make sure the length to be encoded does not exceed the maximum possible
     // length that can be encoded
     if (((size_t)utf16_length) > EncodeLengthMax<char16_t>()) {
-      diag->Error(DiagMessage() << "string too large to encode using UTF-16 "
-                                << "written instead as '" << kStringTooLarge << "'");
-
-      EncodeString(kStringTooLarge, utf8, out, diag);
+      EncodeString(kStringTooLarge, utf8, out);
       return false;
     }
 
     // Total number of 16-bit words to write.
     const size_t total_size = EncodedLengthUnits<char16_t>(utf16_length) + encoded.size() + 1;
 
-    char16_t* data = out->NextBlock<char16_t>(total_size);
-
-    // Encode the actual UTF16 string length.
-    data = EncodeLength(data, utf16_length);
-    const size_t byte_length = encoded.size() * sizeof(char16_t);
-
-    // NOTE: For some reason, strncpy16(data, entry->value.data(),
-    // entry->value.size()) truncates the string.
-    memcpy(data, encoded.data(), byte_length);
+    char16_t length_units[2];
+    const size_t length_size = EncodeLength(length_units, utf16_length) - length_units;
+    const size_t start = out->size();
+    out->resize(start + total_size * sizeof(char16_t));
+    char* data = out->data() + start;
+    memcpy(data, length_units, length_size * sizeof(char16_t));
+    memcpy(data + length_size * sizeof(char16_t), encoded.data(),
+           encoded.size() * sizeof(char16_t));
 
-    // The null-terminating character is already here due to the block of data
-    // being set to 0s on allocation.
+    // The null-terminating character is already here, resize() fills with 0s.
   }
 
   return true;
 }
 
+// The strings of a pool encoded by one thread.
+struct EncodedStrings {
+  // The encoded strings, back to back.
+  std::string data;
+  // Where each string starts in data.
+  std::vector<uint32_t> offsets;
+  // How many strings were too large to encode.
+  size_t too_large_count = 0;
+};
+
+// Below this many strings per thread, starting a thread costs more than it saves.
+constexpr size_t kMinStringsPerEncodingThread = 4096;
+
+// Encodes the strings on as many threads as are worth it. Each thread encodes a contiguous range
+// of the strings, so that the ranges only need to be copied out in order.
+static std::vector<EncodedStrings> EncodeStrings(const std::vector<const std::string*>& strings,
+                                                 bool utf8) {
+  const size_t thread_count =
+      std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+                                           strings.size() / kMinStringsPerEncodingThread));
+  std::vector<EncodedStrings> ranges(thread_count);
+  auto encode_range = [&](size_t range) {
+    EncodedStrings& encoded = ranges[range];
+    const size_t begin = strings.size() * range / thread_count;
+    const size_t end = strings.size() * (range + 1) / thread_count;
+    encoded.offsets.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+      encoded.offsets.push_back(encoded.data.size());
+      if (!EncodeString(*strings[i], utf8, &encoded.data)) {
+        encoded.too_large_count++;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t range = 1; range < thread_count; range++) {
+    threads.emplace_back(encode_range, range);
+  }
+  encode_range(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return ranges;
+}
+
 bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8, IDiagnostics* diag) {
   bool no_error = true;
   const size_t start_index = out->size();
@@ -448,14 +492,29 @@ bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8, IDia
   header->stringsStart = before_strings_index - start_index;
 
   // Styles always come first.
+  std::vector<const std::string*> strings;
+  strings.reserve(pool.size());
   for (const std::unique_ptr<StyleEntry>& entry : pool.styles_) {
-    *indices++ = out->size() - before_strings_index;
-    no_error = EncodeString(entry->value, utf8, out, diag) && no_error;
+    strings.push_back(&entry->value);
   }
-
   for (const std::unique_ptr<Entry>& entry : pool.strings_) {
-    *indices++ = out->size() - before_strings_index;
-    no_error = EncodeString(entry->value, utf8, out, diag) && no_error;
+    strings.push_back(&entry->value);
+  }
+
+  for (const EncodedStrings& encoded : EncodeStrings(strings, utf8)) {
+    const uint32_t range_start = out->size() - before_strings_index;
+    for (uint32_t offset : encoded.offsets) {
+      *indices++ = range_start + offset;
+    }
+    if (!encoded.data.empty()) {
+      memcpy(out->NextBlock<char>(encoded.data.size()), encoded.data.data(), encoded.data.size());
+    }
+    for (size_t i = 0; i < encoded.too_large_count; i++) {
+      diag->Error(DiagMessage() << "string too large to encode using "
+                                << (utf8 ? "UTF-8" : "UTF-16") << " written instead as '"
+                                << kStringTooLarge << "'");
+      no_error = false;
+    }
   }
 
   out->Align4();
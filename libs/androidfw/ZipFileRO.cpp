@@ -32,10 +32,114 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+
 using namespace android;
 
+namespace {
+
+/*
+ * Layout of the name index written by ZipFileRO::writeIndex(): an
+ * IndexHeader, followed by the IndexEntries sorted by name, followed by the
+ * names. Fields are stored in host byte order since the index never leaves
+ * the device that wrote it.
+ */
+constexpr uint32_t kIndexMagic = 0x5844495a;  // "ZIDX"
+constexpr uint32_t kIndexVersion = 1;
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    // The size and modification time of the archive the index was written for.
+    uint64_t zipSize;
+    int64_t zipModTime;
+    uint32_t entryCount;
+    uint32_t namesSize;
+};
+
+struct IndexEntry {
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint16_t method;
+    uint32_t modTime;
+    uint32_t crc32;
+    uint32_t compressedLength;
+    uint32_t uncompressedLength;
+    uint32_t hasDataDescriptor;
+    uint32_t reserved;
+    uint64_t dataOffset;
+};
+
+static_assert(sizeof(IndexHeader) == 32, "IndexHeader must not have padding");
+static_assert(sizeof(IndexEntry) == 40, "IndexEntry must not have padding");
+
+inline const IndexHeader* indexHeader(const FileMap* index) {
+    return reinterpret_cast<const IndexHeader*>(index->getDataPtr());
+}
+
+inline const IndexEntry* indexEntries(const FileMap* index) {
+    return reinterpret_cast<const IndexEntry*>(
+            reinterpret_cast<const uint8_t*>(index->getDataPtr()) + sizeof(IndexHeader));
+}
+
+inline bool indexEntryNameInBounds(const FileMap* index, const IndexEntry& entry) {
+    return entry.nameOffset + static_cast<uint64_t>(entry.nameLength)
+            <= indexHeader(index)->namesSize;
+}
+
+inline std::string_view indexEntryName(const FileMap* index, const IndexEntry& entry) {
+    const char* names = reinterpret_cast<const char*>(
+            indexEntries(index) + indexHeader(index)->entryCount);
+    return std::string_view(names + entry.nameOffset, entry.nameLength);
+}
+
+/*
+ * Maps the index at "indexFileName" and checks that it was written for the
+ * archive described by "zipStat". Returns NULL if the index cannot be used.
+ */
+FileMap* mapIndex(const char* indexFileName, const struct stat& zipStat) {
+    android::base::unique_fd fd(::open(indexFileName, O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        return NULL;
+    }
+
+    struct stat indexStat;
+    if (fstat(fd.get(), &indexStat) != 0 ||
+            static_cast<size_t>(indexStat.st_size) < sizeof(IndexHeader)) {
+        return NULL;
+    }
+
+    FileMap* index = new FileMap();
+    if (!index->create(indexFileName, fd.get(), 0, indexStat.st_size, true)) {
+        delete index;
+        return NULL;
+    }
+
+    const IndexHeader* header = indexHeader(index);
+    const uint64_t expectedSize = sizeof(IndexHeader) +
+            static_cast<uint64_t>(header->entryCount) * sizeof(IndexEntry) + header->namesSize;
+    if (header->magic != kIndexMagic || header->version != kIndexVersion ||
+            header->zipSize != static_cast<uint64_t>(zipStat.st_size) ||
+            header->zipModTime != static_cast<int64_t>(zipStat.st_mtime) ||
+            expectedSize != static_cast<uint64_t>(indexStat.st_size)) {
+        ALOGV("Ignoring stale or corrupt zip index %s", indexFileName);
+        delete index;
+        return NULL;
+    }
+    return index;
+}
+
+} // namespace
+
 class _ZipEntryRO {
 public:
     ZipEntry entry;
@@ -54,10 +158,16 @@ private:
 };
 
 ZipFileRO::~ZipFileRO() {
-    CloseArchive(mHandle);
+    if (mHandle != NULL) {
+        CloseArchive(mHandle);
+    }
     if (mFileName != NULL) {
         free(mFileName);
     }
+    delete mIndex;
+    if (mFd >= 0) {
+        close(mFd);
+    }
 }
 
 /*
@@ -92,8 +202,178 @@ ZipFileRO::~ZipFileRO() {
     return new ZipFileRO(handle, strdup(debugFileName));
 }
 
+/* static */ ZipFileRO* ZipFileRO::openWithIndex(const char* zipFileName,
+        const char* indexFileName)
+{
+    android::base::unique_fd fd(::open(zipFileName, O_RDONLY | O_CLOEXEC));
+    struct stat zipStat;
+    if (fd.get() < 0 || fstat(fd.get(), &zipStat) != 0) {
+        return open(zipFileName);
+    }
+
+    FileMap* index = mapIndex(indexFileName, zipStat);
+    if (index == NULL) {
+        return open(zipFileName);
+    }
+
+    return new ZipFileRO(fd.release(), strdup(zipFileName), index);
+}
+
+/* static */ bool ZipFileRO::writeIndex(const char* zipFileName, const char* indexFileName)
+{
+    ZipArchiveHandle handle;
+    const int32_t error = OpenArchive(zipFileName, &handle);
+    if (error) {
+        ALOGW("Error opening archive %s: %s", zipFileName, ErrorCodeString(error));
+        CloseArchive(handle);
+        return false;
+    }
+
+    struct stat zipStat;
+    if (fstat(GetFileDescriptor(handle), &zipStat) != 0) {
+        ALOGW("Error reading the size of archive %s: %s", zipFileName, strerror(errno));
+        CloseArchive(handle);
+        return false;
+    }
+
+    void* cookie;
+    if (StartIteration(handle, &cookie) != 0) {
+        CloseArchive(handle);
+        return false;
+    }
+
+    std::vector<std::pair<std::string, ZipEntry>> entries;
+    ZipEntry entry;
+    std::string_view name;
+    int32_t result;
+    while ((result = Next(cookie, &entry, &name)) == 0) {
+        entries.emplace_back(std::string(name), entry);
+    }
+    EndIteration(cookie);
+    CloseArchive(handle);
+    if (result != -1) {
+        ALOGW("Error iterating over %s: %s", zipFileName, ErrorCodeString(result));
+        return false;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::string names;
+    std::vector<IndexEntry> indexEntries;
+    indexEntries.reserve(entries.size());
+    for (const auto& [entryName, zipEntry] : entries) {
+        indexEntries.push_back(IndexEntry{
+                .nameOffset = static_cast<uint32_t>(names.size()),
+                .nameLength = static_cast<uint16_t>(entryName.size()),
+                .method = static_cast<uint16_t>(zipEntry.method),
+                .modTime = zipEntry.mod_time,
+                .crc32 = zipEntry.crc32,
+                .compressedLength = static_cast<uint32_t>(zipEntry.compressed_length),
+                .uncompressedLength = static_cast<uint32_t>(zipEntry.uncompressed_length),
+                .hasDataDescriptor = zipEntry.has_data_descriptor ? 1U : 0U,
+                .reserved = 0U,
+                .dataOffset = static_cast<uint64_t>(zipEntry.offset),
+        });
+        names.append(entryName);
+    }
+
+    const IndexHeader header{
+            .magic = kIndexMagic,
+            .version = kIndexVersion,
+            .zipSize = static_cast<uint64_t>(zipStat.st_size),
+            .zipModTime = static_cast<int64_t>(zipStat.st_mtime),
+            .entryCount = static_cast<uint32_t>(indexEntries.size()),
+            .namesSize = static_cast<uint32_t>(names.size()),
+    };
+
+    std::string contents;
+    contents.reserve(sizeof(header) + indexEntries.size() * sizeof(IndexEntry) + names.size());
+    contents.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(indexEntries.data()),
+                    indexEntries.size() * sizeof(IndexEntry));
+    contents.append(names);
+
+    // Write to a temporary file first so that readers never see a partial index.
+    const std::string tmpFileName = std::string(indexFileName) + ".tmp";
+    if (!android::base::WriteStringToFile(contents, tmpFileName)
+            || rename(tmpFileName.c_str(), indexFileName) != 0) {
+        ALOGW("Error writing zip index %s: %s", indexFileName, strerror(errno));
+        unlink(tmpFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+ZipArchiveHandle ZipFileRO::getHandle() const
+{
+    if (mIndex == NULL) {
+        return mHandle;
+    }
+
+    AutoMutex _l(mHandleLock);
+    if (mHandle == NULL) {
+        ZipArchiveHandle handle;
+        // The handle does not own mFd, which stays open as long as this object.
+        const int32_t error = OpenArchiveFd(mFd, mFileName, &handle, false);
+        if (error) {
+            ALOGW("Error opening archive %s: %s", mFileName, ErrorCodeString(error));
+            CloseArchive(handle);
+            return NULL;
+        }
+        mHandle = handle;
+    }
+    return mHandle;
+}
+
+int ZipFileRO::getFileDescriptor() const
+{
+    return mIndex != NULL ? mFd : GetFileDescriptor(mHandle);
+}
+
+ZipEntryRO ZipFileRO::findIndexedEntry(const char* entryName) const
+{
+    const IndexHeader* header = indexHeader(mIndex);
+    const IndexEntry* begin = indexEntries(mIndex);
+    const IndexEntry* end = begin + header->entryCount;
+    const std::string_view name(entryName);
+
+    // Entries whose name is out of bounds compare as larger than any name, so
+    // they are never read.
+    const IndexEntry* iter = std::lower_bound(begin, end, name,
+            [this](const IndexEntry& entry, std::string_view n) {
+                return indexEntryNameInBounds(mIndex, entry) && indexEntryName(mIndex, entry) < n;
+            });
+    if (iter == end || !indexEntryNameInBounds(mIndex, *iter)
+            || indexEntryName(mIndex, *iter) != name) {
+        return NULL;
+    }
+
+    const uint64_t dataLength = iter->method == kCompressStored ? iter->uncompressedLength
+                                                                : iter->compressedLength;
+    if (iter->dataOffset + dataLength > header->zipSize) {
+        ALOGW("Zip index entry %s points past the end of %s", entryName, mFileName);
+        return NULL;
+    }
+
+    _ZipEntryRO* data = new _ZipEntryRO;
+    data->name = indexEntryName(mIndex, *iter);
+    data->entry.method = iter->method;
+    data->entry.mod_time = iter->modTime;
+    data->entry.crc32 = iter->crc32;
+    data->entry.compressed_length = iter->compressedLength;
+    data->entry.uncompressed_length = iter->uncompressedLength;
+    data->entry.has_data_descriptor = iter->hasDataDescriptor != 0U;
+    data->entry.offset = static_cast<off64_t>(iter->dataOffset);
+    return (ZipEntryRO) data;
+}
+
 ZipEntryRO ZipFileRO::findEntryByName(const char* entryName) const
 {
+    if (mIndex != NULL) {
+        return findIndexedEntry(entryName);
+    }
+
     _ZipEntryRO* data = new _ZipEntryRO;
 
     data->name = entryName;
@@ -148,8 +428,13 @@ bool ZipFileRO::startIteration(void** cookie) {
 
 bool ZipFileRO::startIteration(void** cookie, const char* prefix, const char* suffix)
 {
+    ZipArchiveHandle handle = getHandle();
+    if (handle == NULL) {
+        return false;
+    }
+
     _ZipEntryRO* ze = new _ZipEntryRO;
-    int32_t error = StartIteration(mHandle, &(ze->cookie),
+    int32_t error = StartIteration(handle, &(ze->cookie),
                                    prefix ? prefix : "", suffix ? suffix : "");
     if (error) {
         ALOGW("Could not start iteration over %s: %s", mFileName != NULL ? mFileName : "<null>",
@@ -214,7 +499,7 @@ FileMap* ZipFileRO::createEntryFileMap(ZipEntryRO entry) const
 {
     const _ZipEntryRO *zipEntry = reinterpret_cast<_ZipEntryRO*>(entry);
     const ZipEntry& ze = zipEntry->entry;
-    int fd = GetFileDescriptor(mHandle);
+    int fd = getFileDescriptor();
     size_t actualLen = 0;
 
     if (ze.method == kCompressStored) {
@@ -239,7 +524,7 @@ std::optional<incfs::IncFsFileMap> ZipFileRO::createEntryIncFsFileMap(ZipEntryRO
 {
     const _ZipEntryRO *zipEntry = reinterpret_cast<_ZipEntryRO*>(entry);
     const ZipEntry& ze = zipEntry->entry;
-    int fd = GetFileDescriptor(mHandle);
+    int fd = getFileDescriptor();
     size_t actualLen = 0;
 
     if (ze.method == kCompressStored) {
@@ -263,8 +548,13 @@ std::optional<incfs::IncFsFileMap> ZipFileRO::createEntryIncFsFileMap(ZipEntryRO
  */
 bool ZipFileRO::uncompressEntry(ZipEntryRO entry, void* buffer, size_t size) const
 {
+    ZipArchiveHandle handle = getHandle();
+    if (handle == NULL) {
+        return false;
+    }
+
     _ZipEntryRO *zipEntry = reinterpret_cast<_ZipEntryRO*>(entry);
-    const int32_t error = ExtractToMemory(mHandle, &(zipEntry->entry),
+    const int32_t error = ExtractToMemory(handle, &(zipEntry->entry),
         (uint8_t*) buffer, size);
     if (error) {
         ALOGW("ExtractToMemory failed with %s", ErrorCodeString(error));
@@ -281,8 +571,13 @@ bool ZipFileRO::uncompressEntry(ZipEntryRO entry, void* buffer, size_t size) con
  */
 bool ZipFileRO::uncompressEntry(ZipEntryRO entry, int fd) const
 {
+    ZipArchiveHandle handle = getHandle();
+    if (handle == NULL) {
+        return false;
+    }
+
     _ZipEntryRO *zipEntry = reinterpret_cast<_ZipEntryRO*>(entry);
-    const int32_t error = ExtractEntryToFile(mHandle, &(zipEntry->entry), fd);
+    const int32_t error = ExtractEntryToFile(handle, &(zipEntry->entry), fd);
     if (error) {
         ALOGW("ExtractToMemory failed with %s", ErrorCodeString(error));
         return false;
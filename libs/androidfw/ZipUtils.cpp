@@ -143,9 +143,50 @@ class BufferWriter final : public zip_archive::Writer {
     return (zip_archive::Inflate(reader, compressedLen, uncompressedLen, &writer, nullptr) == 0);
 }
 
+/*
+ * Inflates raw deflate data held entirely in memory with a single call into
+ * zlib, writing straight into the output buffer.
+ */
+static bool inflateInMemory(const void* in, size_t inLen, void* out, size_t outLen)
+{
+    z_stream zstream;
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.next_in = (Bytef*) in;
+    zstream.avail_in = inLen;
+    zstream.next_out = (Bytef*) out;
+    zstream.avail_out = outLen;
+
+    int zerr = inflateInit2(&zstream, -MAX_WBITS);
+    if (zerr != Z_OK) {
+        ALOGW("Installed zlib is not compatible with linked version (%s)", ZLIB_VERSION);
+        return false;
+    }
+
+    zerr = inflate(&zstream, Z_FINISH);
+    inflateEnd(&zstream);
+    if (zerr != Z_STREAM_END || zstream.total_out != outLen) {
+        ALOGW("Error inflating buffer: zerr=%d, %lu of %zu bytes\n", zerr,
+                (unsigned long) zstream.total_out, outLen);
+        return false;
+    }
+    return true;
+}
+
 /*static*/ bool ZipUtils::inflateToBuffer(incfs::map_ptr<void> in, void* buf,
     long uncompressedLen, long compressedLen)
 {
+    // The whole input is mapped and the size of the output is known, so there is no need to
+    // stream the data through intermediate buffers: verify that all of the input is present and
+    // inflate it in one go.
+    if (compressedLen >= 0 && uncompressedLen >= 0 && compressedLen <= UINT32_MAX
+            && uncompressedLen <= UINT32_MAX) {
+        const incfs::map_ptr<uint8_t> input = in.convert<uint8_t>();
+        if (!input.verify(compressedLen)) {
+            return false;
+        }
+        return inflateInMemory(input.unsafe_ptr(), compressedLen, buf, uncompressedLen);
+    }
+
     BufferReader reader(in, compressedLen);
     BufferWriter writer(buf, uncompressedLen);
     return (zip_archive::Inflate(reader, compressedLen, uncompressedLen, &writer, nullptr) == 0);
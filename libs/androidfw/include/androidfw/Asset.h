@@ -122,6 +122,13 @@ public:
      */
     virtual int openFileDescriptor(off64_t* outStart, off64_t* outLength) const = 0;
 
+    /*
+     * Hint that the next "length" bytes of the asset, from the current
+     * offset, are about to be read, so that their storage can be read ahead.
+     * Assets already held in RAM ignore it.
+     */
+    virtual void readAhead(off64_t /* length */) {}
+
     /*
      * Return whether this asset's buffer is allocated in RAM (not mmapped).
      * Note: not virtual so it is safe to call even when being destroyed.
@@ -217,6 +224,18 @@ private:
                                                             AccessMode mode,
                                                             base::unique_fd fd = {});
 
+    /*
+     * Create the asset from the "length" bytes at "offset" of a memory-mapped
+     * file segment shared with other assets. No mapping is created for the
+     * asset; it keeps a reference to "sharedMap" until it is closed.
+     *
+     * The asset takes ownership of the file descriptor "fd", which is used to
+     * request new file descriptors using "openFileDescriptor".
+     */
+    static std::unique_ptr<Asset> createFromSharedMap(
+            std::shared_ptr<const incfs::IncFsFileMap> sharedMap, off64_t offset, size_t length,
+            AccessMode mode, base::unique_fd fd = {});
+
     /*
      * Create the asset from a memory-mapped file segment with compressed
      * data.
@@ -268,6 +287,14 @@ public:
      */
     status_t openChunk(incfs::IncFsFileMap&& dataMap, base::unique_fd fd);
 
+    /*
+     * Use a region of a memory-mapped segment shared with other assets.
+     *
+     * On success, the object takes ownership of "fd".
+     */
+    status_t openChunk(std::shared_ptr<const incfs::IncFsFileMap> sharedMap, off64_t offset,
+                       size_t length, base::unique_fd fd);
+
     /*
      * Standard Asset interfaces.
      */
@@ -279,10 +306,17 @@ public:
     off64_t getLength(void) const override { return mLength; }
     off64_t getRemainingLength(void) const override { return mLength-mOffset; }
     int openFileDescriptor(off64_t* outStart, off64_t* outLength) const override;
+    void readAhead(off64_t length) override;
     bool isAllocated(void) const override { return mBuf != NULL; }
 
 private:
-    incfs::map_ptr<void> ensureAlignment(const incfs::IncFsFileMap& map);
+    incfs::map_ptr<void> ensureAlignment(incfs::map_ptr<void> data);
+
+    /* Returns the mapping that holds the data of this asset, if there is one. */
+    const incfs::IncFsFileMap* getMap() const;
+
+    /* Returns the data of this asset within getMap(). */
+    incfs::map_ptr<void> getMappedData() const;
 
     off64_t         mStart;         // absolute file offset of start of chunk
     off64_t         mLength;        // length of the chunk
@@ -300,6 +334,13 @@ private:
 
     unsigned char*                      mBuf;     // for read
     std::optional<incfs::IncFsFileMap>  mMap;     // for memory map
+
+    /*
+     * For assets carved out of a mapping shared with other assets, the
+     * mapping and the offset of this asset's data within it.
+     */
+    std::shared_ptr<const incfs::IncFsFileMap> mSharedMap;
+    off64_t                                    mSharedOffset;
 };
 
 
@@ -337,6 +378,7 @@ public:
     virtual off64_t getLength(void) const { return mUncompressedLen; }
     virtual off64_t getRemainingLength(void) const { return mUncompressedLen-mOffset; }
     virtual int openFileDescriptor(off64_t* /* outStart */, off64_t* /* outLength */) const { return -1; }
+    virtual void readAhead(off64_t length);
     virtual bool isAllocated(void) const { return mBuf != NULL; }
 
 private:
@@ -20,8 +20,12 @@
 #include <utils/RefBase.h>
 
 #include <array>
+#include <bitset>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <span>
 #include <unordered_map>
 
@@ -30,12 +34,15 @@
 #include "androidfw/ApkAssets.h"
 #include "androidfw/Asset.h"
 #include "androidfw/AssetManager.h"
+#include "androidfw/ResolvedBagCache.h"
 #include "androidfw/ResourceTypes.h"
 #include "androidfw/Util.h"
 
 namespace android {
 
+class SharedResolvedCache;
 class Theme;
+struct ThemeData;
 
 using ApkAssetsCookie = int32_t;
 
@@ -80,6 +87,7 @@ struct FindEntryResult;
 // AssetManager2 is the main entry point for accessing assets and resources.
 // AssetManager2 provides caching of resources retrieved via the underlying ApkAssets.
 class AssetManager2 {
+  friend SharedResolvedCache;
   friend Theme;
 
  public:
@@ -199,6 +207,13 @@ class AssetManager2 {
   // The entries are sorted by their ASCII name.
   std::unique_ptr<AssetDir> OpenDir(const std::string& dirname) const;
 
+  // Iterates over the regular files of the directory `dirname` under the assets/ directory, along
+  // with how they are stored, without opening them. A file provided by several ApkAssets is only
+  // reported for the one that Open() would read it from. Returns false if an ApkAssets could not
+  // be iterated.
+  bool ForEachAssetEntry(const std::string& dirname,
+                         base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const;
+
   // Searches the set of APKs loaded by this AssetManager and opens the first one found.
   // `mode` controls how the file is opened.
   // `out_cookie` is populated with the cookie of the APK this file was found in.
@@ -284,6 +299,18 @@ class AssetManager2 {
   base::expected<SelectedValue, NullOrIOError> GetResource(uint32_t resid, bool may_be_bag = false,
                                                            uint16_t density_override = 0U) const;
 
+  // Retrieves the best matching values of every resource in `resids`, storing the value of
+  // `resids[i]` in `out_values[i]`. `out_values` must be at least as large as `resids`.
+  //
+  // This behaves like calling GetResource() with `may_be_bag` set to true for each ID, but the
+  // package and type lookups are only done once for IDs that share the same type. Values that
+  // could not be found have a cookie of kInvalidCookie.
+  //
+  // Returns the number of values found, or an I/O error if reading resource data failed.
+  base::expected<size_t, IOError> GetResources(std::span<const uint32_t> resids,
+                                               std::span<SelectedValue> out_values,
+                                               uint16_t density_override = 0U) const;
+
   // Resolves the resource referenced in `value` if the type is Res_value::TYPE_REFERENCE.
   //
   // If the data type is not Res_value::TYPE_REFERENCE, no work is done. Configuration flags of the
@@ -333,8 +360,21 @@ class AssetManager2 {
   void ResetResourceResolution() const;
 
   // Enables or disables resource resolution logging. Clears stored steps when disabled.
+  // Logging can't be enabled while concurrent reads are enabled.
   void SetResourceResolutionLoggingEnabled(bool enabled);
 
+  // Enables or disables concurrent reads. While enabled, methods that don't modify the
+  // AssetManager, like GetResource(), GetBag() and ResolveReference(), may be called from several
+  // threads at once. The caches they fill are then protected by a reader/writer lock. Methods that
+  // modify the AssetManager, including this one, still require exclusive access.
+  //
+  // Enabling concurrent reads disables resource resolution logging.
+  void SetConcurrentReadsEnabled(bool enabled);
+
+  bool IsConcurrentReadsEnabled() const {
+    return concurrent_locks_ != nullptr;
+  }
+
   // Returns formatted log of last resource resolution path, or empty if no resource has been
   // resolved yet.
   std::string GetLastResourceResolution() const;
@@ -345,6 +385,17 @@ class AssetManager2 {
   void ForEachPackage(base::function_ref<bool(const std::string&, uint8_t)> func,
                       package_property_t excluded_property_flags = 0U) const;
 
+  // Sets an immutable table of precomputed values and bags that GetResource(), ResolveReference()
+  // and GetBag() consult before the per-process caches. The table is only used while the
+  // configuration and ApkAssets of this AssetManager match the ones it was generated for; it is
+  // ignored otherwise. Pass nullptr to stop using a table.
+  void SetSharedResolvedCache(std::shared_ptr<const SharedResolvedCache> cache);
+
+  // Returns whether a table set by SetSharedResolvedCache() is currently being consulted.
+  bool IsSharedResolvedCacheActive() const {
+    return active_shared_cache_ != nullptr;
+  }
+
   void DumpToLog() const;
 
  private:
@@ -365,6 +416,10 @@ class AssetManager2 {
       // current configuration. This is used as an optimization to avoid checking every single
       // candidate configuration when looking up resources.
       ByteBucketArray<FilteredConfigGroup> filtered_configs_;
+
+      // The types for which `filtered_configs_` was built. Lazy types that were first parsed after
+      // the last RebuildFilterList() have no filtered list yet and match every candidate instead.
+      std::bitset<std::numeric_limits<uint8_t>::max() + 1> filtered_types_;
   };
 
   // Represents a Runtime Resource Overlay that overlays resources in the logical package.
@@ -416,7 +471,7 @@ class AssetManager2 {
   base::expected<FindEntryResult, NullOrIOError> FindEntryInternal(
       const PackageGroup& package_group, uint8_t type_idx, uint16_t entry_idx,
       const ResTable_config& desired_config, bool stop_at_first_match,
-      bool ignore_configuration) const;
+      bool ignore_configuration, const TypeSpec* const* type_specs = nullptr) const;
 
   // Assigns package IDs to all shared library ApkAssets.
   // Should be called whenever the ApkAssets are changed.
@@ -428,11 +483,29 @@ class AssetManager2 {
 
   // Triggers the re-construction of lists of types that match the set configuration.
   // This should always be called when mutating the AssetManager's configuration or ApkAssets set.
-  void RebuildFilterList();
+  //
+  // Only the lists of types with configurations along the axes in `diff` are rebuilt. When
+  // `previous_configuration` is set, the replaced lists are remembered so that switching back to
+  // that configuration can reuse them.
+  void RebuildFilterList(uint32_t diff = static_cast<uint32_t>(-1),
+                         const ResTable_config* previous_configuration = nullptr);
 
   // Retrieves the APK paths of overlays that overlay non-system packages.
   std::set<ApkAssetsPtr> GetNonSystemOverlays() const;
 
+  // Re-evaluates whether the shared resolved cache matches the current configuration and
+  // ApkAssets. This should always be called when mutating either of them.
+  void UpdateSharedResolvedCache();
+
+  // Points the locale data cache at the locale of the current configuration, forgetting what it
+  // remembered for the previous one.
+  void UpdateLocaleDataCache();
+
+  // Lock the caches for reading or for writing when concurrent reads are enabled, and do nothing
+  // otherwise.
+  std::shared_lock<std::shared_mutex> ReadLockCaches() const;
+  std::unique_lock<std::shared_mutex> WriteLockCaches() const;
+
   // AssetManager2::GetBag(resid) wraps this function to track which resource ids have already
   // been seen while traversing bag parents.
   base::expected<const ResolvedBag*, NullOrIOError> GetBag(
@@ -463,9 +536,24 @@ class AssetManager2 {
   // may need to be purged.
   ResTable_config configuration_ = {};
 
+  // Region comparisons for the locale of `configuration_`, which FindEntryInternal() repeats for
+  // every resource with several localized values. Null until a locale is set.
+  std::unique_ptr<LocaleDataCache> locale_data_cache_;
+
+  // Filtered config lists replaced by the most recent configuration changes, most recent first.
+  // Switching back and forth between configurations (e.g. toggling night mode) reuses these
+  // instead of matching every configuration of the affected types again.
+  struct FilterSnapshot {
+    ResTable_config configuration;
+
+    // Keyed by package group index, package index and type index.
+    std::unordered_map<uint64_t, std::vector<const TypeSpec::TypeEntry*>> type_entries;
+  };
+  std::vector<FilterSnapshot> filter_snapshots_;
+
   // Cached set of bags. These are cached because they can inherit keys from parent bags,
   // which involves some calculation.
-  mutable std::unordered_map<uint32_t, util::unique_cptr<ResolvedBag>> cached_bags_;
+  mutable ResolvedBagCache cached_bags_;
 
   // Cached set of bag resid stacks for each bag. These are cached because they might be requested
   // a number of times for each view during View inspection.
@@ -474,10 +562,38 @@ class AssetManager2 {
   // Cached set of resolved resource values.
   mutable std::unordered_map<uint32_t, SelectedValue> cached_resolved_values_;
 
+  // Themes that were built by applying the same sequence of styles share their entries. The cache
+  // is keyed by the sequence of styles, see Theme::style_stack_.
+  struct StyleStackHash {
+    size_t operator()(const std::vector<uint32_t>& style_stack) const;
+  };
+  struct CachedTheme {
+    std::shared_ptr<const ThemeData> data;
+
+    // The type spec flags of all the styles in the sequence.
+    uint32_t type_spec_flags;
+  };
+  mutable std::unordered_map<std::vector<uint32_t>, CachedTheme, StyleStackHash> cached_themes_;
+
+  // Immutable table of precomputed values and bags shared with other processes.
+  std::shared_ptr<const SharedResolvedCache> shared_cache_;
+
+  // Points to `shared_cache_` when it matches the current configuration and ApkAssets, and is null
+  // otherwise.
+  const SharedResolvedCache* active_shared_cache_ = nullptr;
+
   // Tracking the number of the started operations running with the current AssetManager.
   // Finishing the last one clears all promoted apk assets.
   mutable int number_of_running_scoped_operations_ = 0;
 
+  // The locks used while concurrent reads are enabled. `cache_lock` guards the mutable caches and
+  // `operation_lock` guards the operation count and the promoted apk assets.
+  struct ConcurrentReadLocks {
+    std::shared_mutex cache_lock;
+    std::mutex operation_lock;
+  };
+  std::unique_ptr<ConcurrentReadLocks> concurrent_locks_;
+
   // Whether or not to save resource resolution steps
   bool resource_resolution_logging_enabled_ = false;
 
@@ -592,11 +708,25 @@ class Theme {
 
   explicit Theme(AssetManager2* asset_manager);
 
+  // Returns the entries of this theme for modification, copying them first if they are shared with
+  // other themes.
+  ThemeData& MutableData();
+
   AssetManager2* asset_manager_ = nullptr;
   uint32_t type_spec_flags_ = 0u;
 
-  std::vector<uint32_t> keys_;
-  std::vector<Entry> entries_;
+  // The sorted attribute keys and their values. Themes with the same contents share these, and
+  // copy them before modifying them. May be null if the theme is empty.
+  std::shared_ptr<const ThemeData> data_;
+
+  // The styles applied since the theme was last cleared, as pairs of style resid and force flag.
+  // Empty and invalid if the entries were modified by anything but ApplyStyle(), in which case the
+  // entries can't be shared through AssetManager2::cached_themes_.
+  std::vector<uint32_t> style_stack_;
+  bool style_stack_valid_ = true;
+
+  // The type spec flags of the styles in `style_stack_`.
+  uint32_t style_stack_flags_ = 0u;
 };
 
 inline const ResolvedBag::Entry* begin(const ResolvedBag* bag) {
@@ -17,8 +17,12 @@
 #ifndef ANDROIDFW_ASSETSPROVIDER_H
 #define ANDROIDFW_ASSETSPROVIDER_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "android-base/function_ref.h"
 #include "android-base/macros.h"
@@ -33,6 +37,18 @@ struct ZipArchive;
 
 namespace android {
 
+// How a file of an AssetsProvider is stored, as recorded in the index of its container. Values that
+// the provider does not know are -1.
+struct AssetEntryInfo {
+  // Offset of the data of the file in the file at GetPath().
+  off64_t offset = -1;
+  off64_t compressed_length = -1;
+  off64_t uncompressed_length = -1;
+
+  // Zip compression method of the file: kCompressStored or kCompressDeflated.
+  int32_t method = -1;
+};
+
 // Interface responsible for opening and iterating through asset files.
 struct AssetsProvider {
   static constexpr off64_t kUnknownLength = -1;
@@ -49,6 +65,11 @@ struct AssetsProvider {
   virtual bool ForEachFile(const std::string& path,
                            base::function_ref<void(StringPiece, FileType)> f) const = 0;
 
+  // Iterate over the regular files directly under `path` along with how they are stored, without
+  // opening them. Providers that do not know how their files are stored report unknown values.
+  virtual bool ForEachEntry(const std::string& path,
+                            base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const;
+
   // Retrieves the path to the contents of the AssetsProvider on disk. The path could represent an
   // APk, a directory, or some other file type.
   WARN_UNUSED virtual std::optional<std::string_view> GetPath() const = 0;
@@ -79,6 +100,19 @@ struct AssetsProvider {
                                               bool* file_exists) const = 0;
 };
 
+// Flags controlling how ZipAssetsProvider pages in the contents of its APK.
+using prefetch_policy_t = uint32_t;
+enum : prefetch_policy_t {
+  // Asks the kernel to read resources.arsc ahead in full when it is opened, so that parsing the
+  // table does not fault it in page by page.
+  PREFETCH_RESOURCES_ARSC = 1U << 0U,
+
+  // Records the name of every entry opened from an APK. The recorded names can be saved with
+  // ZipAssetsProvider::WritePrefetchList() and replayed through ZipAssetsProvider::Prefetch() when
+  // the APK is opened in a later run.
+  PREFETCH_RECORD_OPENED_ENTRIES = 1U << 1U,
+};
+
 // Supplies assets from a zip archive.
 struct ZipAssetsProvider : public AssetsProvider {
   static std::unique_ptr<ZipAssetsProvider> Create(std::string path, package_property_t flags,
@@ -93,11 +127,36 @@ struct ZipAssetsProvider : public AssetsProvider {
   bool ForEachFile(const std::string& root_path,
                    base::function_ref<void(StringPiece, FileType)> f) const override;
 
+  // Reports the entries as stored in the central directory of the APK. Offsets are relative to the
+  // start of the file the APK was opened from.
+  bool ForEachEntry(const std::string& root_path,
+                    base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const override;
+
   WARN_UNUSED std::optional<std::string_view> GetPath() const override;
   WARN_UNUSED const std::string& GetDebugName() const override;
   WARN_UNUSED bool IsUpToDate() const override;
   WARN_UNUSED std::optional<uint32_t> GetCrc(std::string_view path) const;
 
+  // Sets the prefetch policy of every ZipAssetsProvider in the process. The policy is applied to
+  // entries opened after it is set.
+  static void SetPrefetchPolicy(prefetch_policy_t policy);
+  static prefetch_policy_t GetPrefetchPolicy();
+
+  // Asks the kernel to read the named entries ahead. Entries are read in the order they are stored
+  // in the APK, and entries close to each other are merged into a single read so that the I/O is
+  // mostly sequential. Names of entries that do not exist are ignored.
+  //
+  // Returns the number of entries that were found.
+  size_t Prefetch(const std::vector<std::string>& entry_names) const;
+
+  // Returns the names of the entries opened since PREFETCH_RECORD_OPENED_ENTRIES was set.
+  std::vector<std::string> GetOpenedEntries() const;
+
+  // Reads and writes prefetch lists, which store one entry name per line.
+  static std::optional<std::vector<std::string>> ReadPrefetchList(const std::string& path);
+  static bool WritePrefetchList(const std::string& path,
+                                const std::vector<std::string>& entry_names);
+
   ~ZipAssetsProvider() override = default;
  protected:
   std::unique_ptr<Asset> OpenInternal(const std::string& path, Asset::AccessMode mode,
@@ -129,6 +188,10 @@ struct ZipAssetsProvider : public AssetsProvider {
     bool is_path_;
   };
 
+  // Returns a mapping of the whole APK that uncompressed entries can be served from, or null if
+  // entries have to be mapped individually.
+  std::shared_ptr<const incfs::IncFsFileMap> GetApkMap() const;
+
   struct ZipCloser {
     void operator()(ZipArchive* a) const;
   };
@@ -136,6 +199,17 @@ struct ZipAssetsProvider : public AssetsProvider {
   PathOrDebugName name_;
   package_property_t flags_;
   time_t last_mod_time_;
+
+  // A mapping of the whole APK shared by the uncompressed assets opened from it. Each asset holds
+  // a reference, so the mapping outlives the provider if assets are still open.
+  mutable std::mutex apk_map_lock_;
+  mutable std::shared_ptr<const incfs::IncFsFileMap> apk_map_;
+  mutable bool apk_map_failed_ = false;
+
+  mutable std::mutex opened_entries_lock_;
+  mutable std::set<std::string> opened_entries_;
+
+  static std::atomic<prefetch_policy_t> prefetch_policy_;
 };
 
 // Supplies assets from a root directory.
@@ -169,6 +243,8 @@ struct MultiAssetsProvider : public AssetsProvider {
 
   bool ForEachFile(const std::string& root_path,
                    base::function_ref<void(StringPiece, FileType)> f) const override;
+  bool ForEachEntry(const std::string& root_path,
+                    base::function_ref<void(StringPiece, const AssetEntryInfo&)> f) const override;
 
   WARN_UNUSED std::optional<std::string_view> GetPath() const override;
   WARN_UNUSED const std::string& GetDebugName() const override;
@@ -18,11 +18,14 @@
 #define _UTILS_BACKUP_HELPERS_H
 
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #include <utils/Errors.h>
 #include <utils/String8.h>
 #include <utils/KeyedVector.h>
 
+#include <vector>
+
 namespace android {
 
 enum {
@@ -86,7 +89,7 @@ public:
 
 private:
     explicit BackupDataWriter();
-    status_t write_padding_for(int n);
+    status_t write_all(struct iovec* iov, int count);
     
     int m_fd;
     status_t m_status;
@@ -105,6 +108,10 @@ class BackupDataReader
 {
 public:
     explicit BackupDataReader(int fd);
+    // Reads ahead in chunks of bufferSize bytes instead of reading each header, key and padding
+    // on its own, which saves most reads for backups of many small entities. The fd is then read
+    // past the parsed data, so it must only be read through this reader.
+    BackupDataReader(int fd, size_t bufferSize);
     // does not close fd
     ~BackupDataReader();
 
@@ -119,6 +126,7 @@ public:
 private:
     explicit BackupDataReader();
     status_t skip_padding();
+    ssize_t read_bytes(void* data, size_t size);
     
     int m_fd;
     bool m_done;
@@ -131,10 +139,24 @@ private:
         entity_header_v1 entity;
     } m_header;
     String8 m_key;
+    // The read-ahead buffer, empty if there is none. Bytes [m_bufferStart, m_bufferEnd) are the
+    // ones of the file from m_pos on.
+    std::vector<uint8_t> m_buffer;
+    size_t m_bufferStart;
+    size_t m_bufferEnd;
 };
 
+/**
+ * Backs up the files that changed since the old snapshot and writes a new one.
+ *
+ * Files are stat'ed and checksummed on up to workerCount threads, while the
+ * entities are still written to dataStream in key order on the calling
+ * thread, so the output does not depend on workerCount. A workerCount of 0
+ * picks one thread per CPU, up to 4.
+ */
 int back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD,
-        char const* const* files, char const* const *keys, int fileCount);
+        char const* const* files, char const* const *keys, int fileCount,
+        int workerCount = 0);
 
 int write_tarfile(const String8& packageName, const String8& domain,
         const String8& rootPath, const String8& filePath, off64_t* outSize,
@@ -103,6 +103,28 @@ public:
     status_t allocRow();
     status_t freeLastRow();
 
+    /* Describes one field of a row passed to appendRow(). */
+    struct RowField {
+        int32_t type;
+        union {
+            int64_t l;
+            double d;
+            struct {
+                const void* data;
+                size_t size;
+            } buffer;
+        } value;
+    };
+
+    /**
+     * Appends a row made of "numFields" fields, which must be the number of
+     * columns. The slots of the row and the space for all of its strings and
+     * blobs are each allocated in one go, so filling a window row by row
+     * costs two allocations per row instead of one per field.
+     * Returns NO_MEMORY, leaving the window unchanged, if the row does not fit.
+     */
+    status_t appendRow(const RowField* fields, uint32_t numFields);
+
     status_t putBlob(uint32_t row, uint32_t column, const void* value, size_t size);
     status_t putString(uint32_t row, uint32_t column, const char* value, size_t sizeIncludingNull);
     status_t putLong(uint32_t row, uint32_t column, int64_t value);
@@ -139,6 +161,62 @@ public:
         return offsetToPtr(fieldSlot->data.buffer.offset, fieldSlot->data.buffer.size);
     }
 
+    /**
+     * Copies the values of a column for "numRows" rows starting at "startRow"
+     * into "outValues", converting them the same way the single-field getters
+     * of android.database.CursorWindow do: strings are parsed, floats and
+     * integers are converted and nulls read as zero.
+     *
+     * Row slots are laid out at a fixed stride, so the column is read in one
+     * strided pass with a single bounds check instead of one per field.
+     *
+     * Returns BAD_VALUE if the range is not in the window and BAD_TYPE if a
+     * field holds a blob. "outValues" is partially written in the latter case.
+     */
+    status_t getLongColumn(uint32_t column, uint32_t startRow, uint32_t numRows,
+            int64_t* outValues);
+    status_t getDoubleColumn(uint32_t column, uint32_t startRow, uint32_t numRows,
+            double* outValues);
+
+    /**
+     * Copies the fields of "numColumns" columns starting at "startColumn" for
+     * "numRows" rows starting at "startRow" in a single pass. Fields are
+     * written in row-major order: the field at (startRow + r, startColumn + c)
+     * goes to index r * numColumns + c of each output array.
+     *
+     * "outTypes" receives the type of every field. Integer and float fields
+     * are also written to "outLongs" and "outDoubles", converted as needed;
+     * null, string and blob fields read as zero there, and callers fetch
+     * strings and blobs individually. "outLongs" and "outDoubles" may be null.
+     *
+     * Returns BAD_VALUE if the rectangle is not in the window.
+     */
+    status_t copyRows(uint32_t startRow, uint32_t numRows, uint32_t startColumn,
+            uint32_t numColumns, int32_t* outTypes, int64_t* outLongs, double* outDoubles);
+
+    /**
+     * Record written by copyRowsToBuffer() for each field, in host byte order.
+     * "size" holds the size in bytes of string (including the terminating
+     * null) and blob fields. "value" holds the bits of integer and float
+     * fields and is zero otherwise.
+     */
+    struct BulkField {
+        int32_t type;
+        uint32_t size;
+        union {
+            int64_t l;
+            double d;
+        } value;
+    };
+
+    /**
+     * Like copyRows(), but writes one BulkField per field to "outBuffer".
+     * Returns BAD_VALUE if the rectangle is not in the window and NO_MEMORY
+     * if "outCapacity" bytes are not enough to hold all the records.
+     */
+    status_t copyRowsToBuffer(uint32_t startRow, uint32_t numRows, uint32_t startColumn,
+            uint32_t numColumns, void* outBuffer, size_t outCapacity);
+
     inline std::string toString() const {
         return android::base::StringPrintf("CursorWindow{name=%s, fd=%d, size=%d, inflatedSize=%d, "
                 "allocOffset=%d, slotsOffset=%d, numRows=%d, numColumns=%d}", mName.c_str(),
@@ -183,6 +261,11 @@ private:
     /**
      * By default windows are lightweight inline allocations; this method
      * inflates the window into a larger ashmem region.
+     *
+     * A window is inflated at most once, straight to mInflatedSize, so
+     * growth never copies more than the inline allocation. If inflation
+     * fails, the window keeps its inline size for good instead of retrying
+     * the ashmem setup on every following allocation.
      */
     status_t maybeInflate();
 
@@ -193,6 +276,18 @@ private:
 
     status_t putBlobOrString(uint32_t row, uint32_t column,
             const void* value, size_t size, int32_t type);
+
+    /**
+     * Returns the slot of "column" in "startRow" if "numRows" rows starting at
+     * "startRow" are in the window, or null if they are not. The slot of the
+     * same column in each following row is kSlotSizeBytes * mNumColumns bytes
+     * lower in memory.
+     */
+    FieldSlot* getColumnSlots(uint32_t column, uint32_t startRow, uint32_t numRows);
+
+    template <typename T>
+    status_t getNumericColumn(uint32_t column, uint32_t startRow, uint32_t numRows,
+            T* outValues);
 };
 
 }; // namespace android
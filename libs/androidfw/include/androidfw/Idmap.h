@@ -18,9 +18,11 @@
 #define IDMAP_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include "android-base/macros.h"
 #include "androidfw/ConfigDescription.h"
@@ -81,6 +83,46 @@ class OverlayDynamicRefTable : public DynamicRefTable {
   friend IdmapResMap;
 };
 
+// The target entries and inline target entries of an idmap, indexed directly by the type and entry
+// of their target resource ids. Both kinds of entries are sorted by target resource id, so without
+// the index every lookup of a resource in an overlaid package is a binary search. Types whose
+// overlaid entries are too sparse for a dense table are not indexed, and are still searched.
+class IdmapTargetIndex {
+ public:
+  // The slot of a resource is 0 if it is not overlaid, 1 + the index of its target entry, or
+  // kInlineSlot | 1 + the index of its inline target entry.
+  static constexpr uint32_t kInlineSlot = 0x80000000U;
+
+  IdmapTargetIndex() = default;
+  IdmapTargetIndex(const Idmap_target_entry* entries, uint32_t entry_count,
+                   const Idmap_target_entry_inline* inline_entries, uint32_t inline_entry_count);
+
+  // Returns the slot of the target resource id, which is without its package id, or std::nullopt
+  // if its type is not indexed.
+  std::optional<uint32_t> Find(uint32_t target_res_id) const {
+    const uint32_t type_id = target_res_id >> 16U;
+    if (type_id >= types_.size()) {
+      return 0U;
+    }
+    const Type& type = types_[type_id];
+    if (type.searched) {
+      return {};
+    }
+    const uint32_t slot = (target_res_id & 0xFFFFU) - type.first_entry;
+    return slot < type.slots.size() ? type.slots[slot] : 0U;
+  }
+
+ private:
+  struct Type {
+    bool searched = false;
+    uint16_t first_entry = 0U;
+    std::vector<uint32_t> slots;
+  };
+
+  // Indexed by type id.
+  std::vector<Type> types_;
+};
+
 // A mapping of target resource ids to a values or resource ids that should overlay the target.
 class IdmapResMap {
  public:
@@ -135,6 +177,7 @@ class IdmapResMap {
                        const Idmap_target_entry_inline* inline_entries,
                        const Idmap_target_entry_inline_value* inline_entry_values,
                        const ConfigDescription* configs,
+                       const IdmapTargetIndex* target_index,
                        uint8_t target_assigned_package_id,
                        const OverlayDynamicRefTable* overlay_ref_table);
 
@@ -143,6 +186,7 @@ class IdmapResMap {
   const Idmap_target_entry_inline* inline_entries_;
   const Idmap_target_entry_inline_value* inline_entry_values_;
   const ConfigDescription* configurations_;
+  const IdmapTargetIndex* target_index_;
   const uint8_t target_assigned_package_id_;
   const OverlayDynamicRefTable* overlay_ref_table_;
 
@@ -178,7 +222,8 @@ class LoadedIdmap {
   const IdmapResMap GetTargetResourcesMap(uint8_t target_assigned_package_id,
                                           const OverlayDynamicRefTable* overlay_ref_table) const {
     return IdmapResMap(data_header_, target_entries_, target_inline_entries_, inline_entry_values_,
-                       configurations_, target_assigned_package_id, overlay_ref_table);
+                       configurations_, &target_index_, target_assigned_package_id,
+                       overlay_ref_table);
   }
 
   // Returns a dynamic reference table for a loaded overlay package.
@@ -202,6 +247,7 @@ class LoadedIdmap {
   const ConfigDescription* configurations_;
   const Idmap_overlay_entry* overlay_entries_;
   const std::unique_ptr<ResStringPool> string_pool_;
+  IdmapTargetIndex target_index_;
 
   std::string idmap_path_;
   std::string_view overlay_apk_path_;
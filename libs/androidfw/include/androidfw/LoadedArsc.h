@@ -17,8 +17,13 @@
 #ifndef LOADEDARSC_H_
 #define LOADEDARSC_H_
 
+#include <array>
+#include <atomic>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <vector>
 #include <unordered_map>
@@ -54,6 +59,9 @@ struct TypeSpec {
     // Type configurations are accessed frequently when setting up an AssetManager and querying
     // resources. Access this cached configuration to minimize page faults.
     ResTable_config config;
+
+    // The MatchKey of `config`, used to reject non-matching configurations cheaply.
+    ResTable_config::MatchKey match_key;
   };
 
   // Pointer to the mmapped data where flags are kept. Flags denote whether the resource entry is
@@ -62,6 +70,11 @@ struct TypeSpec {
 
   std::vector<TypeEntry> type_entries;
 
+  // The configuration axes (ResTable_config::CONFIG_*) specified by at least one configuration in
+  // `type_entries`. Whether a configuration matches one of this type's configurations can only
+  // change when the configuration changes along one of these axes.
+  uint32_t config_axes = 0U;
+
   base::expected<uint32_t, NullOrIOError> GetFlagsForEntryIndex(uint16_t entry_index) const {
     if (entry_index >= dtohl(type_spec->entryCount)) {
       return 0U;
@@ -96,6 +109,10 @@ enum : package_property_t {
   // The apk assets is owned by the application running in this process and incremental crash
   // protections for this APK must be disabled.
   PROPERTY_DISABLE_INCREMENTAL_HARDENING = 1U << 4U,
+
+  // The types of the package are parsed the first time they are accessed instead of when the
+  // package is loaded. Useful for large resource tables of which only a few types are used.
+  PROPERTY_LAZY_TYPES = 1U << 5U,
 };
 
 struct OverlayableInfo {
@@ -163,6 +180,9 @@ class LoadedPackage {
   // the default policy in AAPT2 is to build UTF-8 string pools, this needs to change.
   // Returns a partial resource ID, with the package ID left as 0x00. The caller is responsible
   // for patching the correct package ID to the resource ID.
+  //
+  // The first lookup builds a hash index of the entry names, and the first lookup in each type
+  // builds an index of the entries of that type, so repeated lookups don't search the string pools.
   base::expected<uint32_t, NullOrIOError> FindEntryByName(const std::u16string& type_name,
                                                           const std::u16string& entry_name) const;
 
@@ -213,6 +233,11 @@ class LoadedPackage {
     return (property_flags_ & PROPERTY_LOADER) != 0;
   }
 
+  // Returns true if the types of this package are only parsed once they are accessed.
+  bool HasLazyTypes() const {
+    return (property_flags_ & PROPERTY_LAZY_TYPES) != 0;
+  }
+
   package_property_t GetPropertyFlags() const {
     return property_flags_;
   }
@@ -242,13 +267,27 @@ class LoadedPackage {
     if (type_spec == type_specs_.end()) {
       return nullptr;
     }
-    return &type_spec->second;
+    return GetParsedTypeSpec(type_spec->first, type_spec->second);
   }
 
+  // Invokes `f` for every type of the package, parsing the types that have not been accessed yet.
   template <typename Func>
   void ForEachTypeSpec(Func f) const {
     for (const auto& type_spec : type_specs_) {
-      f(type_spec.second, type_spec.first);
+      if (const TypeSpec* parsed = GetParsedTypeSpec(type_spec.first, type_spec.second)) {
+        f(*parsed, type_spec.first);
+      }
+    }
+  }
+
+  // Invokes `f` for every type of the package that has already been parsed. This is the same as
+  // ForEachTypeSpec() unless the package has lazy types.
+  template <typename Func>
+  void ForEachParsedTypeSpec(Func f) const {
+    for (const auto& type_spec : type_specs_) {
+      if (type_states_[type_spec.first].load(std::memory_order_acquire) == kTypeParsed) {
+        f(type_spec.second, type_spec.first);
+      }
     }
   }
 
@@ -284,6 +323,31 @@ class LoadedPackage {
 
   LoadedPackage() = default;
 
+  enum : uint8_t {
+    kTypeParsed = 0U,
+    kTypePending,
+    kTypeInvalid,
+  };
+
+  inline const TypeSpec* GetParsedTypeSpec(uint8_t type_id, const TypeSpec& type_spec) const {
+    if (UNLIKELY(type_states_[type_id].load(std::memory_order_acquire) != kTypeParsed)) {
+      return ParseTypeSpec(type_id);
+    }
+    return &type_spec;
+  }
+
+  // Parses the type chunks of a lazy type. Returns nullptr if the type chunks are corrupt.
+  const TypeSpec* ParseTypeSpec(uint8_t type_id) const;
+
+  // Returns the index in `key_string_pool_` of `entry_name`, building the name index if needed.
+  // `name_index_lock_` must be held.
+  std::optional<uint32_t> FindKeyIndexLocked(const std::u16string& entry_name) const;
+
+  // Returns the map of key string index to entry index of the type at `type_idx` in
+  // `type_string_pool_`, building it if needed. `name_index_lock_` must be held.
+  base::expected<const std::unordered_map<uint32_t, uint16_t>*, NullOrIOError>
+      GetEntryIndicesLocked(uint8_t type_idx) const;
+
   ResStringPool type_string_pool_;
   ResStringPool key_string_pool_;
   std::string package_name_;
@@ -292,7 +356,9 @@ class LoadedPackage {
   int type_id_offset_ = 0;
   package_property_t property_flags_ = 0U;
 
-  std::unordered_map<uint8_t, TypeSpec> type_specs_;
+  // The type entries of lazy types are filled in by ParseTypeSpec() once `type_states_` says the
+  // type is pending. The map itself is never modified after loading.
+  mutable std::unordered_map<uint8_t, TypeSpec> type_specs_;
   ByteBucketArray<uint32_t> resource_ids_;
   std::vector<DynamicPackageEntry> dynamic_package_map_;
   std::vector<std::pair<OverlayableInfo, std::unordered_set<uint32_t>>> overlayable_infos_;
@@ -300,6 +366,18 @@ class LoadedPackage {
 
   // A map of overlayable name to actor
   std::unordered_map<std::string, std::string> overlayable_map_;
+
+  // Lazily built indices used by FindEntryByName(). LoadedPackages are shared between threads, so
+  // the indices are guarded by `name_index_lock_`.
+  mutable std::mutex name_index_lock_;
+  mutable std::optional<std::unordered_map<std::string, uint32_t>> key_indices_;
+  mutable std::unordered_map<uint8_t, std::unordered_map<uint32_t, uint16_t>> entry_indices_;
+
+  // The parse state of each type, indexed by type ID. Types are always parsed unless the package
+  // has lazy types, in which case the type chunks of pending types are kept in `lazy_types_`.
+  mutable std::array<std::atomic<uint8_t>, std::numeric_limits<uint8_t>::max() + 1> type_states_{};
+  mutable std::mutex lazy_types_lock_;
+  mutable std::unordered_map<uint8_t, std::vector<incfs::map_ptr<ResTable_type>>> lazy_types_;
 };
 
 // Read-only view into a resource table. This class validates all data
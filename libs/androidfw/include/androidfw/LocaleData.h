@@ -20,6 +20,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
+
 namespace android {
 
 int localeDataCompareRegions(
@@ -31,6 +33,42 @@ void localeDataComputeScript(char out[4], const char* language, const char* regi
 
 bool localeDataIsCloseToUsEnglish(const char* region);
 
+// Remembers the results of localeDataCompareRegions() and localeDataIsCloseToUsEnglish() for one
+// requested locale. Resource lookups compare the same few regions of the candidate configurations
+// over and over, and the requested locale only changes with the configuration, so most lookups
+// are served without walking the locale parent tables.
+//
+// Lookups may run concurrently with each other, but not with reset().
+class LocaleDataCache {
+ public:
+  LocaleDataCache();
+
+  // Forgets all the results and makes the cache serve the given requested locale.
+  void reset(const char* language, const char* script, const char* region);
+
+  // Whether the cache was set up for the given requested locale.
+  bool servesLocale(const char* language, const char* script, const char* region) const;
+
+  // Returns the sign of localeDataCompareRegions() for the requested locale of the cache.
+  int compareRegions(const char* left_region, const char* right_region);
+
+  // Same as localeDataIsCloseToUsEnglish().
+  bool isCloseToUsEnglish(const char* region);
+
+ private:
+  LocaleDataCache(const LocaleDataCache&) = delete;
+  LocaleDataCache& operator=(const LocaleDataCache&) = delete;
+
+  // Direct-mapped: a result replaces whatever was in its slot. Each entry packs its key and the
+  // result so that readers never see one without the other.
+  static constexpr size_t kEntryCount = 256;
+
+  char language_[2] = {};
+  char script_[4] = {};
+  char region_[2] = {};
+  std::atomic<uint64_t> entries_[kEntryCount];
+};
+
 } // namespace android
 
 #endif // _LIBS_UTILS_LOCALE_DATA_H
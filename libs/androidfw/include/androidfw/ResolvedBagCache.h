@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDFW_RESOLVEDBAGCACHE_H_
+#define ANDROIDFW_RESOLVEDBAGCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace android {
+
+struct ResolvedBag;
+
+// Stores the ResolvedBags built by an AssetManager2.
+//
+// Bags are carved out of large, contiguous blocks instead of being allocated individually, and are
+// indexed by resource ID in an open-addressing hash table. Bags never move, so pointers to a bag
+// stay valid until the bag is erased or replaced, or the cache is cleared. A block is released once
+// none of its bags is cached anymore; clearing releases every bag at once.
+class ResolvedBagCache {
+ public:
+  ResolvedBagCache() = default;
+  ResolvedBagCache(ResolvedBagCache&&) = default;
+  ResolvedBagCache& operator=(ResolvedBagCache&&) = default;
+
+  // Returns the bag cached for `resid`, or nullptr if there is none.
+  ResolvedBag* Find(uint32_t resid) const;
+
+  // Reserves uninitialized storage for a bag of at most `entry_count` entries. The bag is not
+  // visible through Find() until it is passed to Insert().
+  ResolvedBag* Allocate(size_t entry_count);
+
+  // Returns unused storage at the end of `bag` to the cache. Only the most recently allocated bag
+  // can be shrunk; calls for other bags are ignored.
+  void Shrink(ResolvedBag* bag, size_t entry_count);
+
+  // Indexes `bag`, which must have been returned by Allocate(), under `resid`. A bag already
+  // cached under `resid` is replaced.
+  void Insert(uint32_t resid, ResolvedBag* bag);
+
+  // Removes every bag whose type_spec_flags intersect `diff`. Pointers to the remaining bags stay
+  // valid.
+  void EraseVaryingWith(uint32_t diff);
+
+  // Removes all bags and releases their storage.
+  void Clear();
+
+  size_t size() const {
+    return count_;
+  }
+
+  bool empty() const {
+    return count_ == 0U;
+  }
+
+ private:
+  struct Slot {
+    uint32_t resid = 0U;
+    ResolvedBag* bag = nullptr;
+  };
+
+  struct Block {
+    std::unique_ptr<uint8_t[]> data;
+    size_t capacity = 0U;
+    size_t used = 0U;
+
+    // The number of bytes in `data` used by bags that are still indexed.
+    size_t live = 0U;
+  };
+
+  static size_t SizeOf(size_t entry_count);
+
+  void Grow();
+
+  // Indexes `bag` under `resid` and returns the bag it replaced, if any.
+  ResolvedBag* InsertSlot(uint32_t resid, ResolvedBag* bag);
+
+  // Returns the block that holds `bag`.
+  Block* BlockOf(const ResolvedBag* bag);
+
+  // Releases every block, except the last one, that no longer holds an indexed bag.
+  void ReleaseUnusedBlocks();
+
+  // The storage backing the bags. New bags are always carved out of the last block.
+  std::vector<Block> blocks_;
+
+  // The open-addressing index. Its size is always zero or a power of two, and a resid of 0 marks
+  // an empty slot since 0 is never a valid resource ID.
+  std::vector<Slot> slots_;
+
+  // The number of bags indexed in `slots_`.
+  size_t count_ = 0U;
+
+  // The bag most recently returned by Allocate() and its size in bytes.
+  ResolvedBag* last_allocation_ = nullptr;
+  size_t last_allocation_size_ = 0U;
+};
+
+}  // namespace android
+
+#endif  // ANDROIDFW_RESOLVEDBAGCACHE_H_
@@ -21,7 +21,6 @@
 #include <atomic>
 #include <vector>
 
-#include <utils/Mutex.h>
 #include <android-base/macros.h>
 #include <androidfw/Util.h>
 
@@ -32,13 +31,23 @@ namespace android {
 // To monitor an API, first add it to the Counter enumeration.  Then, inside the API, create an
 // instance of ResourceTimer with the appropriate enumeral.  The corresponding counter will be
 // updated when the ResourceTimer destructor is called, normally at the end of the enclosing block.
+//
+// Every thread records into timers of its own, which are merged when the timers are fetched, and
+// only one in every sampleInterval() calls of a counter on a thread is timed, so that the timers
+// are cheap enough to stay enabled in production.
 class ResourceTimer {
  public:
   enum class Counter {
     GetResourceValue,
     RetrieveAttributes,
-
-    LastCounter = RetrieveAttributes,
+    GetResource,
+    GetBag,
+    ResolveReference,
+    ApplyStyle,
+    ThemeApplyStyle,
+    LoadApkAssets,
+
+    LastCounter = LoadApkAssets,
   };
   static const int counterSize = static_cast<int>(Counter::LastCounter) + 1;
   static char const *toString(Counter);
@@ -133,6 +142,9 @@ class ResourceTimer {
     // copy.  The reset flag is exploited to make the copy faster.  Any data in dst is lost.
     static void copy(Timer &dst, Timer &src, bool reset);
 
+    // Add the events of another timer to this one.
+    void merge(const Timer &other);
+
    private:
     // Free any buckets.
     void freeBuckets();
@@ -161,18 +173,22 @@ class ResourceTimer {
     int *buckets[MaxDimension];
   };
 
-  // Fetch one Timer.  The function has a short-circuit behavior: if the count is zero then
-  // destination count is set to zero and the function returns false.  Otherwise, the destination
-  // is a copy of the source and the function returns true.  This behavior lowers the cost of
-  // handling unused timers.
+  // Fetch one Timer, merged across all threads.  The function has a short-circuit behavior: if
+  // the count is zero then destination count is set to zero and the function returns false.
+  // Otherwise, the destination holds the events of the counter and the function returns true.
+  // This behavior lowers the cost of handling unused timers.
   static bool copy(int src, Timer &dst, bool reset);
 
-  // Enable the timers.  Timers are initially disabled.  Enabling timers allocates memory for the
-  // counters.  Timers cannot be disabled.
-  static void enable();
+  // Enable the timers.  Timers are initially disabled.  Timers cannot be disabled, but enabling
+  // them again changes the sample interval: only one in every sample_interval calls of a counter
+  // on a thread is timed, starting with its first call.
+  static void enable(int sample_interval = 1);
+
+  // The number of calls that each recorded event stands for.
+  static int sampleInterval();
 
  private:
-  // An internal reset method.  This does not take a lock.
+  // Reset every counter of every thread.
   static void reset();
 
   // Helper method to convert a counter into an enum.  Presumably, this will be inlined into zero
@@ -181,27 +197,12 @@ class ResourceTimer {
     return static_cast<std::vector<unsigned int>::size_type>(c);
   }
 
-  // Every counter has an associated lock.  The lock has been factored into a separate class to
-  // keep the Timer class a POD.
-  struct GuardedTimer {
-    Mutex lock_;
-    Timer timer_;
-  };
-
-  // Scoped timer
-  struct ScopedTimer {
-    AutoMutex _l;
-    Timer &t;
-    ScopedTimer(GuardedTimer &g) :
-        _l(g.lock_), t(g.timer_) {
-    }
-    Timer *operator->() {
-      return &t;
-    }
-    Timer& operator*() {
-      return t;
-    }
-  };
+  // The timers of one thread.  Their lock is only contended while the timers are fetched.
+  struct ThreadTimers;
+  // All the ThreadTimers, and the events of the threads that have exited.
+  struct Registry;
+  static ThreadTimers& threadTimers();
+  static Registry& registry();
 
   // An individual timer is active (or not), is tracking a specific API, and has a start time.
   // The api and the start time are undefined if the timer is not active.
@@ -212,8 +213,8 @@ class ResourceTimer {
   // The global enable flag.  This is initially false and may be set true by the java runtime.
   static std::atomic<bool> enabled_;
 
-  // The global timers.  The memory for the timers is not allocated until the timers are enabled.
-  static std::atomic<GuardedTimer *> counter_;
+  // One in this many calls of each thread is timed.
+  static std::atomic<int> sample_interval_;
 };
 
 }  // namespace android
@@ -41,6 +41,7 @@
 #include <android/configuration.h>
 
 #include <array>
+#include <atomic>
 #include <map>
 #include <memory>
 
@@ -557,17 +558,23 @@ private:
     void*                                         mOwnedData;
     incfs::verified_map_ptr<ResStringPool_header> mHeader;
     size_t                                        mSize;
-    mutable Mutex                                 mDecodeLock;
     incfs::map_ptr<uint32_t>                      mEntries;
     incfs::map_ptr<uint32_t>                      mEntryStyles;
     incfs::map_ptr<void>                          mStrings;
-    char16_t mutable**                            mCache;
+    // UTF-16 copies of the strings of a UTF-8 pool, created on first use. A string can be read
+    // from the cache without locking once it was published; decoding a string requires holding
+    // the lock of its stripe so that it is only decoded once.
+    static constexpr size_t kDecodeLockStripes = 16U;
+    mutable std::array<Mutex, kDecodeLockStripes> mDecodeLocks;
+    mutable Mutex                                 mCacheLock;
+    mutable std::atomic<std::atomic<char16_t*>*>  mCache;
     uint32_t                                      mStringPoolSize;    // number of uint16_t
     incfs::map_ptr<uint32_t>                      mStyles;
     uint32_t                                      mStylePoolSize;    // number of uint32_t
 
     base::expected<StringPiece, NullOrIOError> stringDecodeAt(
         size_t idx, incfs::map_ptr<uint8_t> str, size_t encLen) const;
+    std::atomic<char16_t*>* getOrCreateDecodeCache() const;
 };
 
 /**
@@ -1302,6 +1309,11 @@ struct ResTable_config
     // it wins.  If this IS generic, o wins (return false).
     bool isBetterThan(const ResTable_config& o, const ResTable_config* requested) const;
 
+    // Same as above, with the locale data lookups served by |locale_cache| when it was set up
+    // for the locale of |requested|. |locale_cache| may be null.
+    bool isBetterThan(const ResTable_config& o, const ResTable_config* requested,
+                      LocaleDataCache* locale_cache) const;
+
     // Return true if 'this' can be considered a match for the parameters in 
     // 'settings'.
     // Note this is asymetric.  A default piece of data will match every request
@@ -1310,6 +1322,35 @@ struct ResTable_config
     // settings is the requested settings
     bool match(const ResTable_config& settings) const;
 
+    // A packed form of the dimensions that match() compares for equality.
+    // Each dimension gets a few bits of "values"; "mask" covers the bits of
+    // the dimensions this configuration specifies. Dimensions are truncated
+    // to fit, so two keys can agree on configurations that differ, but never
+    // disagree on ones that are the same.
+    struct MatchKey {
+        uint64_t values;
+        uint64_t mask;
+
+        // Returns false if the configuration of this key cannot match the
+        // configuration of "settings". A true result still has to be
+        // confirmed with match().
+        inline bool mayMatch(const MatchKey& settings) const {
+            return ((values ^ settings.values) & mask) == 0;
+        }
+    };
+
+    // Computes the MatchKey of this configuration. Keys are meant to be
+    // computed once per configuration, when it is loaded or set, so that
+    // most non-matching candidates are rejected with a single compare.
+    MatchKey matchKey() const;
+
+    // Same as match(), but rejects "settings" early using the precomputed
+    // keys of both configurations.
+    inline bool match(const ResTable_config& settings, const MatchKey& key,
+                      const MatchKey& settingsKey) const {
+        return key.mayMatch(settingsKey) && match(settings);
+    }
+
     // Get the string representation of the locale component of this
     // Config. The maximum size of this representation will be
     // |RESTABLE_MAX_LOCALE_LEN| (including a terminating '\0').
@@ -1374,6 +1415,8 @@ struct ResTable_config
     // match() has already been used to remove any configurations that don't
     // match the requested configuration at all.
     bool isLocaleBetterThan(const ResTable_config& o, const ResTable_config* requested) const;
+    bool isLocaleBetterThan(const ResTable_config& o, const ResTable_config* requested,
+                            LocaleDataCache* locale_cache) const;
 
     String8 toString() const;
 };
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDFW_SHAREDRESOLVEDCACHE_H_
+#define ANDROIDFW_SHAREDRESOLVEDCACHE_H_
+
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "android-base/macros.h"
+#include "androidfw/Asset.h"
+#include "androidfw/AssetManager2.h"
+#include "androidfw/ResourceTypes.h"
+
+namespace android {
+
+// An immutable table of the resolved values and bags of a single package, computed for one
+// configuration. The table is meant to be generated once (e.g. by zygote for the framework
+// package) and then memory-mapped read-only by every process that uses the same set of ApkAssets,
+// so that AssetManager2 does not need to rebuild its per-process caches for that package.
+//
+// The table is only consulted by an AssetManager2 whose configuration and package group layout
+// (ApkAssets paths, cookies and overlays) are identical to the ones used to generate it.
+class SharedResolvedCache {
+ public:
+  // Resolves every resource of the package assigned `package_id` in `assetmanager` using its
+  // current configuration and writes the resulting table to `fd`.
+  // Returns false if the package does not exist, reading resource data failed, or writing failed.
+  static bool Write(const AssetManager2& assetmanager, uint8_t package_id, int fd);
+
+  // Memory-maps a table previously written with Write().
+  // Returns nullptr if the file could not be mapped or is not a valid table for this process.
+  static std::unique_ptr<const SharedResolvedCache> Load(const std::string& path);
+
+  // Creates a table backed by `asset`, which must remain valid and unmodified while the table is
+  // in use.
+  static std::unique_ptr<const SharedResolvedCache> Load(std::unique_ptr<Asset> asset);
+
+  // Returns the value that AssetManager2::GetResource() would return for `resid`, or nullptr if
+  // the resource is not in the table. Bags are not represented as values.
+  const AssetManager2::SelectedValue* FindValue(uint32_t resid) const;
+
+  // Returns the value that AssetManager2::ResolveReference() would produce for a reference to
+  // `resid`, or nullptr if the resource is not in the table.
+  const AssetManager2::SelectedValue* FindResolvedValue(uint32_t resid) const;
+
+  // Returns the fully merged bag with ID `resid`, or nullptr if the bag is not in the table.
+  const ResolvedBag* FindBag(uint32_t resid) const;
+
+  // The runtime package ID of the package whose resources are in this table.
+  uint8_t GetPackageId() const {
+    return package_id_;
+  }
+
+  // The configuration for which the values in this table were resolved.
+  const ResTable_config& GetConfiguration() const {
+    return configuration_;
+  }
+
+  // A description of the ApkAssets that made up the package group when the table was generated.
+  std::string_view GetFingerprint() const {
+    return fingerprint_;
+  }
+
+  size_t GetValueCount() const {
+    return value_keys_.size();
+  }
+
+  size_t GetBagCount() const {
+    return bag_keys_.size();
+  }
+
+  // Computes the fingerprint of the package group identified by `package_id` in `assetmanager`,
+  // from the ApkAssets of the group and the modification time and size of their files. Returns an
+  // empty string if `assetmanager` has no such package, or if one of the ApkAssets has no file or
+  // changed since it was loaded.
+  static std::string ComputeFingerprint(const AssetManager2& assetmanager, uint8_t package_id);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SharedResolvedCache);
+
+  SharedResolvedCache() = default;
+
+  std::unique_ptr<Asset> asset_;
+  uint8_t package_id_ = 0U;
+  ResTable_config configuration_ = {};
+  std::string_view fingerprint_;
+
+  std::span<const uint32_t> value_keys_;
+  std::span<const AssetManager2::SelectedValue> values_;
+  std::span<const AssetManager2::SelectedValue> resolved_values_;
+
+  std::span<const uint32_t> bag_keys_;
+  std::span<const uint32_t> bag_offsets_;
+  const uint8_t* bag_data_ = nullptr;
+};
+
+}  // namespace android
+
+#endif  // ANDROIDFW_SHAREDRESOLVEDCACHE_H_
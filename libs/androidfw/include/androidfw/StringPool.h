@@ -215,12 +215,31 @@ class StringPool {
 
   static bool Flatten(BigBuffer* out, const StringPool& pool, bool utf8, IDiagnostics* diag);
 
+  // Strings are only deduplicated with strings of the same priority, so that is part of the key.
+  struct IndexKey {
+    android::StringPiece value;
+    uint32_t priority;
+
+    bool operator==(const IndexKey& rhs) const {
+      return priority == rhs.priority && value == rhs.value;
+    }
+  };
+
+  struct IndexKeyHash {
+    size_t operator()(const IndexKey& key) const {
+      return std::hash<android::StringPiece>()(key.value) * 31 + key.priority;
+    }
+  };
+
   Ref MakeRefImpl(android::StringPiece str, const Context& context, bool unique);
   void ReAssignIndices();
 
   std::vector<std::unique_ptr<Entry>> strings_;
   std::vector<std::unique_ptr<StyleEntry>> styles_;
-  std::unordered_multimap<android::StringPiece, Entry*> indexed_strings_;
+
+  // One of the strings with each value and priority. Strings merged from another pool can be
+  // duplicates, those are not indexed.
+  std::unordered_map<IndexKey, Entry*, IndexKeyHash> indexed_strings_;
 };
 
 }  // namespace android
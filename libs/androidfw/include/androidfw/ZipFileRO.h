@@ -89,6 +89,26 @@ public:
     static ZipFileRO* openFd(int fd, const char* debugFileName,
         bool assume_ownership = true);
 
+    /*
+     * Open an archive, looking entries up by name in the index written by
+     * writeIndex() instead of parsing the central directory. The central
+     * directory is only parsed once an operation needs more than the index,
+     * like iterating or uncompressing an entry.
+     *
+     * Falls back to open() if the index is missing, corrupt or was written
+     * for a different version of the archive.
+     */
+    static ZipFileRO* openWithIndex(const char* zipFileName, const char* indexFileName);
+
+    /*
+     * Write a sorted index of the entry names of the archive "zipFileName"
+     * to "indexFileName", for use with openWithIndex(). The index is only
+     * meant to be read on the device that wrote it.
+     *
+     * Returns "true" on success.
+     */
+    static bool writeIndex(const char* zipFileName, const char* indexFileName);
+
     /*
      * Find an entry, by name.  Returns the entry identifier, or NULL if
      * not found.
@@ -182,12 +202,30 @@ private:
     ZipFileRO& operator=(const ZipFileRO& src);
 
     ZipFileRO(ZipArchiveHandle handle, char* fileName) : mHandle(handle),
-        mFileName(fileName)
+        mFileName(fileName), mFd(-1), mIndex(NULL)
+    {
+    }
+
+    ZipFileRO(int fd, char* fileName, FileMap* index) : mHandle(NULL),
+        mFileName(fileName), mFd(fd), mIndex(index)
     {
     }
 
-    const ZipArchiveHandle mHandle;
+    /* Returns the archive handle, opening the archive if needed. */
+    ZipArchiveHandle getHandle() const;
+    int getFileDescriptor() const;
+    ZipEntryRO findIndexedEntry(const char* entryName) const;
+
+    mutable ZipArchiveHandle mHandle;
     char* mFileName;
+
+    /*
+     * Set when the archive was opened with a name index, in which case
+     * mHandle is created on first use.
+     */
+    int mFd;
+    FileMap* mIndex;
+    mutable Mutex mHandleLock;
 };
 
 }; // namespace android
@@ -19,6 +19,7 @@
 #include "android-base/file.h"
 #include "android-base/test_utils.h"
 #include "android-base/unique_fd.h"
+#include "androidfw/AssetsProvider.h"
 #include "androidfw/Util.h"
 
 #include "TestHelpers.h"
@@ -26,6 +27,7 @@
 
 using ::android::base::unique_fd;
 using ::com::android::basic::R;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::Ge;
 using ::testing::NotNull;
@@ -108,4 +110,59 @@ TEST(ApkAssetsTest, OpenUncompressedAssetFd) {
   EXPECT_THAT(buffer, StrEq("This should be uncompressed.\n\n"));
 }
 
+TEST(ApkAssetsTest, UncompressedAssetsOutliveProvider) {
+  auto provider = ZipAssetsProvider::Create(GetTestDataPath() + "/basic/basic.apk", 0U);
+  ASSERT_THAT(provider, NotNull());
+
+  auto first = provider->Open("assets/uncompressed.txt", Asset::ACCESS_BUFFER);
+  auto second = provider->Open("assets/uncompressed.txt", Asset::ACCESS_RANDOM);
+  ASSERT_THAT(first, NotNull());
+  ASSERT_THAT(second, NotNull());
+  provider.reset();
+
+  const std::string expected = "This should be uncompressed.\n\n";
+  ASSERT_THAT(first->getLength(), Eq(static_cast<off64_t>(expected.size())));
+  auto buffer = reinterpret_cast<const char*>(first->getBuffer(false /* aligned */));
+  ASSERT_THAT(buffer, NotNull());
+  EXPECT_THAT(std::string(buffer, expected.size()), StrEq(expected));
+
+  ASSERT_THAT(second->seek(13, SEEK_SET), Eq(13));
+  std::string tail(expected.size() - 13, '\0');
+  ASSERT_THAT(second->read(&tail[0], tail.size()), Eq(static_cast<ssize_t>(tail.size())));
+  EXPECT_THAT(tail, StrEq(expected.substr(13)));
+
+  off64_t start, length;
+  unique_fd fd(second->openFileDescriptor(&start, &length));
+  ASSERT_THAT(fd.get(), Ge(0));
+  EXPECT_THAT(length, Eq(static_cast<off64_t>(expected.size())));
+  lseek64(fd.get(), start, SEEK_SET);
+  std::string from_fd(length, '\0');
+  ASSERT_TRUE(base::ReadFully(fd.get(), &from_fd[0], length));
+  EXPECT_THAT(from_fd, StrEq(expected));
+}
+
+TEST(ApkAssetsTest, RecordAndPrefetchOpenedEntries) {
+  ZipAssetsProvider::SetPrefetchPolicy(PREFETCH_RESOURCES_ARSC | PREFETCH_RECORD_OPENED_ENTRIES);
+  auto provider = ZipAssetsProvider::Create(GetTestDataPath() + "/basic/basic.apk", 0U);
+  ASSERT_THAT(provider, NotNull());
+
+  ASSERT_THAT(provider->Open("resources.arsc", Asset::ACCESS_BUFFER), NotNull());
+  ASSERT_THAT(provider->Open("res/layout/main.xml", Asset::ACCESS_BUFFER), NotNull());
+  ASSERT_THAT(provider->Open("res/layout/main.xml", Asset::ACCESS_BUFFER), NotNull());
+  EXPECT_THAT(provider->Open("does/not/exist.txt", Asset::ACCESS_BUFFER), Eq(nullptr));
+  ZipAssetsProvider::SetPrefetchPolicy(0U);
+
+  std::vector<std::string> opened = provider->GetOpenedEntries();
+  EXPECT_THAT(opened, ElementsAre("res/layout/main.xml", "resources.arsc"));
+
+  TemporaryFile tf;
+  ASSERT_TRUE(ZipAssetsProvider::WritePrefetchList(tf.path, opened));
+  auto prefetch_list = ZipAssetsProvider::ReadPrefetchList(tf.path);
+  ASSERT_TRUE(prefetch_list.has_value());
+  EXPECT_THAT(*prefetch_list, Eq(opened));
+
+  prefetch_list->push_back("does/not/exist.txt");
+  EXPECT_THAT(provider->Prefetch(*prefetch_list), Eq(2U));
+}
+
 }  // namespace android
@@ -17,6 +17,9 @@
 #include "androidfw/AssetManager2.h"
 #include "androidfw/AssetManager.h"
 
+#include <map>
+#include <thread>
+
 #include "TestHelpers.h"
 #include "android-base/file.h"
 #include "android-base/logging.h"
@@ -37,6 +40,7 @@ namespace lib_two = com::android::lib_two;
 namespace libclient = com::android::libclient;
 
 using ::testing::Eq;
+using ::testing::Gt;
 using ::testing::NotNull;
 using ::testing::StrEq;
 
@@ -154,6 +158,34 @@ TEST_F(AssetManager2Test, FindsResourceFromMultipleApkAssets) {
   EXPECT_EQ(Res_value::TYPE_STRING, value->type);
 }
 
+TEST_F(AssetManager2Test, FiltersConfigurationsAcrossConfigurationChanges) {
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({basic_assets_, basic_de_fr_assets_});
+
+  ResTable_config de_config{};
+  de_config.language[0] = 'd';
+  de_config.language[1] = 'e';
+  ResTable_config fr_config{};
+  fr_config.language[0] = 'f';
+  fr_config.language[1] = 'r';
+  ResTable_config de_land_config = de_config;
+  de_land_config.orientation = ResTable_config::ORIENTATION_LAND;
+
+  // Switch back and forth so that previously filtered lists get reused, and change an axis that
+  // no configuration of the type uses.
+  const std::vector<std::pair<ResTable_config, char>> steps = {
+      {de_config, 'd'}, {fr_config, 'f'}, {de_config, 'd'}, {{}, 0},
+      {de_config, 'd'}, {de_land_config, 'd'}, {fr_config, 'f'}, {de_land_config, 'd'},
+  };
+  for (const auto& [config, language] : steps) {
+    assetmanager.SetConfiguration(config);
+    auto value = assetmanager.GetResource(basic::R::string::test1);
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(language, value->config.language[0]);
+    EXPECT_EQ(language == 0 ? 0 : 1, value->cookie);
+  }
+}
+
 TEST_F(AssetManager2Test, FindsResourceFromSharedLibrary) {
   AssetManager2 assetmanager;
 
@@ -405,6 +437,66 @@ TEST_F(AssetManager2Test, MergeStylesCircularDependency) {
   ASSERT_EQ(3u, (*bag)->entry_count);
 }
 
+TEST_F(AssetManager2Test, GetResourcesMatchesGetResource) {
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({basic_assets_});
+
+  const std::vector<uint32_t> resids = {
+      basic::R::integer::ref1, basic::R::string::test1, 0x7f7f0000u, basic::R::integer::ref2,
+      basic::R::array::integerArray1, 0x00000000u, basic::R::integer::number2,
+  };
+  std::vector<AssetManager2::SelectedValue> values(resids.size());
+  auto result = assetmanager.GetResources(resids, values);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(5u, *result);
+
+  for (size_t i = 0; i < resids.size(); i++) {
+    auto expected = assetmanager.GetResource(resids[i], true /*may_be_bag*/);
+    if (!expected.has_value()) {
+      EXPECT_EQ(kInvalidCookie, values[i].cookie);
+      continue;
+    }
+    EXPECT_EQ(expected->cookie, values[i].cookie);
+    EXPECT_EQ(expected->type, values[i].type);
+    EXPECT_EQ(expected->data, values[i].data);
+    EXPECT_EQ(expected->flags, values[i].flags);
+    EXPECT_EQ(expected->resid, values[i].resid);
+    EXPECT_EQ(0, expected->config.compare(values[i].config));
+  }
+}
+
+TEST_F(AssetManager2Test, ConcurrentReads) {
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({basic_assets_, style_assets_});
+  assetmanager.SetConcurrentReadsEnabled(true);
+  ASSERT_TRUE(assetmanager.IsConcurrentReadsEnabled());
+
+  assetmanager.SetResourceResolutionLoggingEnabled(true);
+  EXPECT_EQ("", assetmanager.GetLastResourceResolution());
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 100; j++) {
+        auto bag = assetmanager.GetBag(app::R::style::StyleTwo);
+        ASSERT_TRUE(bag.has_value());
+        EXPECT_EQ(6u, (*bag)->entry_count);
+
+        auto value = assetmanager.GetResource(basic::R::integer::ref1);
+        ASSERT_TRUE(value.has_value());
+        ASSERT_TRUE(assetmanager.ResolveReference(*value, true /* cache_value */).has_value());
+        EXPECT_EQ(12000u, value->data);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  assetmanager.SetConcurrentReadsEnabled(false);
+  EXPECT_FALSE(assetmanager.IsConcurrentReadsEnabled());
+}
+
 TEST_F(AssetManager2Test, ResolveReferenceToResource) {
   AssetManager2 assetmanager;
   assetmanager.SetApkAssets({basic_assets_});
@@ -717,6 +809,27 @@ TEST_F(AssetManager2Test, OpenDirFromManyApks) {
   EXPECT_THAT(asset_dir->getFileType(2), Eq(FileType::kFileTypeDirectory));
 }
 
+TEST_F(AssetManager2Test, ForEachAssetEntryFromManyApks) {
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({system_assets_, app_assets_});
+
+  std::map<std::string, AssetEntryInfo> entries;
+  ASSERT_TRUE(assetmanager.ForEachAssetEntry("", [&](StringPiece name, const AssetEntryInfo& info) {
+    EXPECT_TRUE(entries.emplace(std::string(name), info).second);
+  }));
+  ASSERT_THAT(entries.size(), Eq(2u));
+
+  // file.txt is reported once, for the APK it is opened from.
+  for (const char* name : {"app_file.txt", "file.txt"}) {
+    auto iter = entries.find(name);
+    ASSERT_NE(iter, entries.end()) << name;
+    std::unique_ptr<Asset> asset = assetmanager.Open(name, Asset::ACCESS_BUFFER);
+    ASSERT_THAT(asset, NotNull());
+    EXPECT_THAT(iter->second.uncompressed_length, Eq(asset->getLength()));
+    EXPECT_THAT(iter->second.offset, Gt(0));
+  }
+}
+
 TEST_F(AssetManager2Test, GetLastPathWithoutEnablingReturnsEmpty) {
   ResTable_config desired_config;
 
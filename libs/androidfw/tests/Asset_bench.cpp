@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "androidfw/Asset.h"
+#include "androidfw/AssetsProvider.h"
+#include "androidfw/ZipFileRO.h"
+#include "benchmark/benchmark.h"
+
+#include "BenchmarkHelpers.h"
+
+namespace android {
+
+constexpr const static char* kFrameworkPath = "/system/framework/framework-res.apk";
+
+// Returns the name of the largest deflated entry of the APK at `path`.
+static std::string FindLargestCompressedEntry(const std::string& path) {
+  std::unique_ptr<ZipFileRO> zip(ZipFileRO::open(path.c_str()));
+  if (zip == nullptr) {
+    return {};
+  }
+
+  void* cookie;
+  if (!zip->startIteration(&cookie)) {
+    return {};
+  }
+
+  std::string largest_name;
+  uint32_t largest_length = 0U;
+  while (ZipEntryRO entry = zip->nextEntry(cookie)) {
+    uint16_t method;
+    uint32_t uncompressed_length;
+    if (!zip->getEntryInfo(entry, &method, &uncompressed_length, nullptr, nullptr, nullptr,
+                           nullptr) ||
+        method != ZipFileRO::kCompressDeflated || uncompressed_length <= largest_length) {
+      continue;
+    }
+
+    char name[PATH_MAX];
+    if (zip->getEntryFileName(entry, name, sizeof(name)) == 0) {
+      largest_name = name;
+      largest_length = uncompressed_length;
+    }
+  }
+  zip->endIteration(cookie);
+  return largest_name;
+}
+
+// Inflates the largest compressed entry of the APK at `path`, either all at once through
+// Asset::getBuffer() when `read_size` is 0, or by streaming it in reads of `read_size` bytes.
+static void BM_InflateAsset(benchmark::State& state, const std::string& path, size_t read_size) {
+  auto provider = ZipAssetsProvider::Create(path, 0U /* flags */);
+  const std::string entry_name = FindLargestCompressedEntry(path);
+  if (provider == nullptr || entry_name.empty()) {
+    state.SkipWithError("failed to find a compressed asset");
+    return;
+  }
+
+  std::vector<uint8_t> buffer(read_size);
+  size_t bytes_processed = 0U;
+  while (state.KeepRunning()) {
+    std::unique_ptr<Asset> asset = provider->Open(
+        entry_name, read_size == 0U ? Asset::ACCESS_BUFFER : Asset::ACCESS_STREAMING);
+    if (asset == nullptr) {
+      state.SkipWithError("failed to open asset");
+      return;
+    }
+
+    if (read_size == 0U) {
+      if (asset->getBuffer(false /* aligned */) == nullptr) {
+        state.SkipWithError("failed to inflate asset");
+        return;
+      }
+    } else {
+      while (asset->read(buffer.data(), buffer.size()) > 0) {
+      }
+    }
+    bytes_processed += asset->getLength();
+  }
+  state.SetBytesProcessed(bytes_processed);
+}
+
+static void BM_InflateAssetBuffer(benchmark::State& state) {
+  BM_InflateAsset(state, kFrameworkPath, 0U);
+}
+BENCHMARK(BM_InflateAssetBuffer);
+
+static void BM_InflateAssetStreaming(benchmark::State& state) {
+  BM_InflateAsset(state, kFrameworkPath, static_cast<size_t>(state.range(0)));
+}
+BENCHMARK(BM_InflateAssetStreaming)->Arg(4 * 1024)->Arg(64 * 1024)->Arg(256 * 1024);
+
+static void BM_InflateAssetBufferBasic(benchmark::State& state) {
+  BM_InflateAsset(state, GetTestDataPath() + "/basic/basic.apk", 0U);
+}
+BENCHMARK(BM_InflateAssetBufferBasic);
+
+}  // namespace android
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "benchmark/benchmark.h"
 
 //#include "android-base/stringprintf.h"
@@ -78,6 +80,38 @@ static void BM_ApplyStyle(benchmark::State& state) {
 }
 BENCHMARK(BM_ApplyStyle);
 
+static void BM_ApplyStyleDefaultStyle(benchmark::State& state, bool sorted) {
+  auto styles_apk = ApkAssets::Load(GetTestDataPath() + "/styles/styles.apk");
+  if (styles_apk == nullptr) {
+    state.SkipWithError("failed to load assets");
+    return;
+  }
+
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({styles_apk});
+
+  std::unique_ptr<Theme> theme = assetmanager.NewTheme();
+  theme->ApplyStyle(app::R::style::StyleOne);
+
+  std::array<uint32_t, 7> attrs{{app::R::attr::attr_one, app::R::attr::attr_two,
+                                 app::R::attr::attr_three, app::R::attr::attr_four,
+                                 app::R::attr::attr_five, app::R::attr::attr_six,
+                                 app::R::attr::attr_empty}};
+  if (!sorted) {
+    std::reverse(attrs.begin(), attrs.end());
+  }
+  std::array<uint32_t, attrs.size() * STYLE_NUM_ENTRIES> values;
+  std::array<uint32_t, attrs.size() + 1> indices;
+
+  while (state.KeepRunning()) {
+    ApplyStyle(theme.get(), nullptr /*xml_parser*/, 0u /*def_style_attr*/,
+               app::R::style::StyleTwo, attrs.data(), attrs.size(), values.data(),
+               indices.data());
+  }
+}
+BENCHMARK_CAPTURE(BM_ApplyStyleDefaultStyle, sorted, true);
+BENCHMARK_CAPTURE(BM_ApplyStyleDefaultStyle, unsorted, false);
+
 static void BM_ApplyStyleFramework(benchmark::State& state) {
   auto framework_apk = ApkAssets::Load(kFrameworkPath);
   if (framework_apk == nullptr) {
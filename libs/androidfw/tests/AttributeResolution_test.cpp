@@ -16,6 +16,7 @@
 
 #include "androidfw/AttributeResolution.h"
 
+#include <algorithm>
 #include <array>
 
 #include "android-base/file.h"
@@ -272,5 +273,40 @@ TEST_F(AttributeResolutionXmlTest, ThemeAndXmlParser) {
   EXPECT_EQ(expected_indices, indices);
 }
 
+TEST_F(AttributeResolutionTest, ApplyStyleIsIndependentOfAttributeOrder) {
+  std::unique_ptr<Theme> theme = assetmanager_.NewTheme();
+  ASSERT_TRUE(theme->ApplyStyle(R::style::StyleOne).has_value());
+
+  // The sorted attributes are merged with the bags, the unsorted ones are looked up one by one.
+  std::array<uint32_t, 5> sorted_attrs{{R::attr::attr_one, R::attr::attr_two,
+                                        R::attr::attr_three, R::attr::attr_four,
+                                        R::attr::attr_five}};
+  std::array<uint32_t, 5> unsorted_attrs{{R::attr::attr_five, R::attr::attr_two,
+                                          R::attr::attr_four, R::attr::attr_one,
+                                          R::attr::attr_three}};
+  std::array<uint32_t, sorted_attrs.size() * STYLE_NUM_ENTRIES> sorted_values;
+  std::array<uint32_t, sorted_attrs.size() * STYLE_NUM_ENTRIES> unsorted_values;
+  std::array<uint32_t, sorted_attrs.size() + 1> sorted_indices;
+  std::array<uint32_t, sorted_attrs.size() + 1> unsorted_indices;
+
+  ASSERT_TRUE(ApplyStyle(theme.get(), nullptr /*xml_parser*/, 0u /*def_style_attr*/,
+                         R::style::StyleTwo, sorted_attrs.data(), sorted_attrs.size(),
+                         sorted_values.data(), sorted_indices.data()).has_value());
+  ASSERT_TRUE(ApplyStyle(theme.get(), nullptr /*xml_parser*/, 0u /*def_style_attr*/,
+                         R::style::StyleTwo, unsorted_attrs.data(), unsorted_attrs.size(),
+                         unsorted_values.data(), unsorted_indices.data()).has_value());
+  EXPECT_EQ(sorted_indices[0], unsorted_indices[0]);
+
+  for (size_t i = 0; i < unsorted_attrs.size(); i++) {
+    const size_t sorted_index = std::find(sorted_attrs.begin(), sorted_attrs.end(),
+                                          unsorted_attrs[i]) - sorted_attrs.begin();
+    for (size_t j = 0; j < STYLE_NUM_ENTRIES; j++) {
+      EXPECT_EQ(sorted_values[sorted_index * STYLE_NUM_ENTRIES + j],
+                unsorted_values[i * STYLE_NUM_ENTRIES + j])
+          << "attr 0x" << std::hex << unsorted_attrs[i] << " entry " << j;
+    }
+  }
+}
+
 } // namespace android
 
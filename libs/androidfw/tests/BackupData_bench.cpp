@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "android-base/file.h"
+#include "benchmark/benchmark.h"
+
+#include "androidfw/BackupHelpers.h"
+
+namespace android {
+
+// About what a SharedPreferences backup holds: many short keys with values of a few bytes.
+static constexpr size_t kEntityCount = 1000;
+
+static void WriteEntities(int fd) {
+    BackupDataWriter writer(fd);
+    for (size_t i = 0; i < kEntityCount; i++) {
+        const std::string key = "pref_key_" + std::to_string(i);
+        const std::string value = std::to_string(i * 7919);
+        writer.WriteEntityHeader(String8(key.c_str()), value.size());
+        writer.WriteEntityData(value.data(), value.size());
+    }
+}
+
+static void BM_BackupDataWrite(benchmark::State& state) {
+    TemporaryFile file;
+    for (auto _ : state) {
+        ftruncate(file.fd, 0);
+        lseek(file.fd, 0, SEEK_SET);
+        WriteEntities(file.fd);
+    }
+    state.SetItemsProcessed(state.iterations() * kEntityCount);
+}
+BENCHMARK(BM_BackupDataWrite);
+
+// Reads all entities with a read-ahead buffer of the given size, 0 for none.
+static void BM_BackupDataRead(benchmark::State& state) {
+    TemporaryFile file;
+    WriteEntities(file.fd);
+    for (auto _ : state) {
+        lseek(file.fd, 0, SEEK_SET);
+        BackupDataReader reader(file.fd, state.range(0));
+        bool done;
+        int type;
+        String8 key;
+        size_t dataSize;
+        char data[32];
+        while (reader.ReadNextHeader(&done, &type) == NO_ERROR && !done) {
+            reader.ReadEntityHeader(&key, &dataSize);
+            benchmark::DoNotOptimize(reader.ReadEntityData(data, sizeof(data)));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kEntityCount);
+}
+BENCHMARK(BM_BackupDataRead)->Arg(0)->Arg(4096)->Arg(64 * 1024);
+
+}  // namespace android
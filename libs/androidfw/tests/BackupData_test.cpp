@@ -434,4 +434,53 @@ TEST_F(BackupDataTest, ReadDeletedEntityData) {
   delete reader;
 }
 
+TEST_F(BackupDataTest, ReadBufferedAndSkip) {
+  int fd = ::open(mFilename.string(), O_WRONLY);
+  BackupDataWriter writer(fd);
+  const char* keys[] = {KEY1, KEY2, KEY3, KEY4};
+  const char* values[] = {DATA1, DATA2, DATA3, nullptr};
+  for (int round = 0; round < 100; round++) {
+    for (int i = 0; i < 4; i++) {
+      if (values[i] == nullptr) {
+        ASSERT_EQ(NO_ERROR, writer.WriteEntityHeader(String8(keys[i]), -1));
+      } else {
+        ASSERT_EQ(NO_ERROR, writer.WriteEntityHeader(String8(keys[i]), strlen(values[i])));
+        ASSERT_EQ(NO_ERROR, writer.WriteEntityData(values[i], strlen(values[i])));
+      }
+    }
+  }
+  ::close(fd);
+
+  // Buffers smaller than, about as large as and larger than an entity, or the whole file.
+  for (size_t bufferSize : {4, 24, 700, 64 * 1024}) {
+    fd = ::open(mFilename.string(), O_RDONLY);
+    BackupDataReader reader(fd, bufferSize);
+    bool done;
+    int type;
+    String8 key;
+    size_t dataSize;
+    for (int round = 0; round < 100; round++) {
+      for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(NO_ERROR, reader.ReadNextHeader(&done, &type)) << bufferSize;
+        ASSERT_FALSE(done);
+        ASSERT_EQ(BACKUP_HEADER_ENTITY_V1, type);
+        ASSERT_EQ(NO_ERROR, reader.ReadEntityHeader(&key, &dataSize));
+        EXPECT_EQ(String8(keys[i]), key);
+        if (values[i] == nullptr) {
+          EXPECT_EQ(-1, (int) dataSize);
+        } else if ((round + i) % 2 == 0) {
+          EXPECT_EQ(NO_ERROR, reader.SkipEntityData());
+        } else {
+          char dataBytes[16] = {};
+          ASSERT_EQ((int) strlen(values[i]), reader.ReadEntityData(dataBytes, sizeof(dataBytes)));
+          EXPECT_STREQ(values[i], dataBytes);
+        }
+      }
+    }
+    reader.ReadNextHeader(&done, &type);
+    EXPECT_TRUE(done);
+    ::close(fd);
+  }
+}
+
 }
@@ -19,6 +19,7 @@
 
 #include <gtest/gtest.h>
 
+#include <arpa/inet.h>
 #include <fcntl.h>
 #include <utils/String8.h>
 #include <android-base/file.h>
@@ -59,5 +60,43 @@ TEST_F(BackupHelpersTest, WriteTarFileWithSizeGreaterThan2GB) {
   off64_t expectedTarSize = fileSize + 512;
   ASSERT_EQ(tarSize, expectedTarSize);
 }
+
+TEST_F(BackupHelpersTest, WriteTarFileStreamsLargeFileContents) {
+  TemporaryFile tf;
+  // Large enough to be read ahead on a separate thread, and not a multiple of 512.
+  std::string contents(1024 * 1024 + 300, '\0');
+  for (size_t i = 0; i < contents.size(); i++) {
+    contents[i] = static_cast<char>(i * 7 + i / 4096);
+  }
+  ASSERT_TRUE(android::base::WriteStringToFd(contents, tf.fd));
+
+  TemporaryFile out;
+  off64_t tarSize = 0;
+  {
+    BackupDataWriter writer(out.fd);
+    ASSERT_EQ(0, write_tarfile(String8("test-pkg"), String8(""), String8(""), String8(tf.path),
+                               &tarSize, &writer));
+  }
+
+  // The stream is a sequence of chunks, each preceded by its size in network byte order.
+  std::string stream;
+  ASSERT_TRUE(android::base::ReadFileToString(out.path, &stream));
+  std::string tar;
+  for (size_t pos = 0; pos < stream.size();) {
+    ASSERT_LE(pos + 4, stream.size());
+    uint32_t chunkSize;
+    memcpy(&chunkSize, stream.data() + pos, 4);
+    chunkSize = ntohl(chunkSize);
+    pos += 4;
+    ASSERT_LE(pos + chunkSize, stream.size());
+    tar.append(stream, pos, chunkSize);
+    pos += chunkSize;
+  }
+
+  ASSERT_EQ(static_cast<off64_t>(tar.size()), tarSize);
+  EXPECT_EQ(contents, tar.substr(512, contents.size()));
+  EXPECT_EQ(std::string(tar.size() - 512 - contents.size(), '\0'),
+            tar.substr(512 + contents.size()));
+}
 }
 
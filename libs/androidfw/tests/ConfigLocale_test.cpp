@@ -859,4 +859,48 @@ TEST(ConfigLocaleTest, isLocaleBetterThan_UsEnglishIsSpecial) {
     EXPECT_FALSE(config2.isLocaleBetterThan(config1, &request));
 }
 
+TEST(ConfigLocaleTest, isLocaleBetterThan_localeDataCache) {
+    const char* const languages[] = {NULL, "en", "es", "pt", "zh"};
+    const char* const regions[] = {NULL, "US", "GB", "001", "PR", "AR", "419", "MX", "ES",
+                                   "BR", "PT", "TW", "HK", "CN"};
+    const char* const requests[][2] = {{"en", "US"}, {"en", "PR"}, {"en", "AU"}, {"es", "AR"},
+                                       {"pt", "AO"}, {"zh", "HK"}};
+
+    LocaleDataCache cache;
+    for (const auto& requested : requests) {
+        ResTable_config request;
+        fillIn(requested[0], requested[1], NULL, NULL, &request);
+        cache.reset(request.language, request.localeScript, request.country);
+        // Twice, so that the second round is served from the cache.
+        for (int round = 0; round < 2; round++) {
+            for (const char* language : languages) {
+                for (const char* region1 : regions) {
+                    for (const char* region2 : regions) {
+                        ResTable_config config1, config2;
+                        fillIn(language, region1, NULL, NULL, &config1);
+                        fillIn(language, region2, NULL, NULL, &config2);
+                        EXPECT_EQ(config1.isLocaleBetterThan(config2, &request),
+                                  config1.isLocaleBetterThan(config2, &request, &cache));
+                        fillIn(NULL, NULL, NULL, NULL, &config2);
+                        EXPECT_EQ(config1.isLocaleBetterThan(config2, &request),
+                                  config1.isLocaleBetterThan(config2, &request, &cache));
+                        EXPECT_EQ(config2.isLocaleBetterThan(config1, &request),
+                                  config2.isLocaleBetterThan(config1, &request, &cache));
+                    }
+                }
+            }
+        }
+    }
+
+    // A cache set up for another locale isn't used.
+    ResTable_config request, config1, config2;
+    fillIn("es", "AR", NULL, NULL, &request);
+    fillIn("es", "419", NULL, NULL, &config1);
+    fillIn("es", "ES", NULL, NULL, &config2);
+    cache.reset("en", "Latn", "US");
+    EXPECT_FALSE(cache.servesLocale(request.language, request.localeScript, request.country));
+    EXPECT_TRUE(config1.isLocaleBetterThan(config2, &request, &cache));
+    EXPECT_FALSE(config2.isLocaleBetterThan(config1, &request, &cache));
+}
+
 }  // namespace android
@@ -16,6 +16,9 @@
 
 #include "androidfw/ResourceTypes.h"
 
+#include <vector>
+
+#include "androidfw/ConfigDescription.h"
 #include "utils/Log.h"
 #include "utils/String8.h"
 #include "utils/Vector.h"
@@ -219,4 +222,34 @@ TEST(ConfigTest, GrammaticalGender) {
   EXPECT_EQ(masculine.diff(feminine), ResTable_config::CONFIG_GRAMMATICAL_GENDER);
 }
 
+TEST(ConfigTest, MatchKeyAgreesWithMatch) {
+  const char* qualifiers[] = {
+      "",          "mcc310",       "mcc310-mnc004", "mcc310-mnc00", "ldrtl",    "ldltr",
+      "long",      "notlong",      "car",           "night",        "notnight", "round",
+      "highdr",    "widecg",       "port",          "land",         "finger",   "qwerty",
+      "nokeys",    "navhidden",    "trackball",     "masculine",    "feminine", "keyshidden",
+      "keyssoft",  "en",           "sw600dp",       "w720dp",       "v21",      "land-night",
+      "mcc310-car-port-qwerty-v23",
+  };
+  std::vector<ResTable_config> configs;
+  for (const char* str : qualifiers) {
+    ConfigDescription config;
+    ASSERT_TRUE(ConfigDescription::Parse(str, &config)) << str;
+    configs.push_back(config);
+  }
+
+  for (const ResTable_config& config : configs) {
+    const ResTable_config::MatchKey key = config.matchKey();
+    for (const ResTable_config& settings : configs) {
+      const ResTable_config::MatchKey settings_key = settings.matchKey();
+      EXPECT_EQ(config.match(settings), config.match(settings, key, settings_key))
+          << config.toString() << " vs " << settings.toString();
+    }
+  }
+
+  // The key alone rejects configurations that differ in an equality dimension.
+  EXPECT_FALSE(configs[14].matchKey().mayMatch(configs[15].matchKey()));
+  EXPECT_TRUE(configs[0].matchKey().mayMatch(configs[15].matchKey()));
+}
+
 }  // namespace android.
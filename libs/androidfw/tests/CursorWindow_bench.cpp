@@ -83,4 +83,64 @@ static void BM_CursorWindowRead16Kx4(benchmark::State& state) {
 }
 BENCHMARK(BM_CursorWindowRead16Kx4);
 
+// Fills windows with 100k rows of an (INTEGER, TEXT, REAL, TEXT) result set, the way
+// SQLiteConnection copies a query, starting over with a cleared window whenever one is full.
+static constexpr size_t kQueryRows = 100000;
+static constexpr size_t kQueryCols = 4;
+static const char kShortText[] = "short";
+static const char kLongText[] = "a somewhat longer piece of text for the row";
+
+static void BM_CursorWindowFillPerField(benchmark::State& state) {
+    CursorWindow* w;
+    CursorWindow::create(String8("test"), 1 << 21, &w);
+
+    while (state.KeepRunning()) {
+        w->clear();
+        w->setNumColumns(kQueryCols);
+        uint32_t row = 0;
+        for (size_t i = 0; i < kQueryRows; i++) {
+            if (w->allocRow() != OK || w->putLong(row, 0, i) != OK
+                    || w->putString(row, 1, kShortText, sizeof(kShortText)) != OK
+                    || w->putDouble(row, 2, i * 0.5) != OK
+                    || w->putString(row, 3, kLongText, sizeof(kLongText)) != OK) {
+                w->clear();
+                w->setNumColumns(kQueryCols);
+                row = 0;
+                continue;
+            }
+            row++;
+        }
+    }
+}
+BENCHMARK(BM_CursorWindowFillPerField);
+
+static void BM_CursorWindowFillAppendRow(benchmark::State& state) {
+    CursorWindow* w;
+    CursorWindow::create(String8("test"), 1 << 21, &w);
+
+    CursorWindow::RowField fields[kQueryCols];
+    fields[0].type = CursorWindow::FIELD_TYPE_INTEGER;
+    fields[1].type = CursorWindow::FIELD_TYPE_STRING;
+    fields[1].value.buffer.data = kShortText;
+    fields[1].value.buffer.size = sizeof(kShortText);
+    fields[2].type = CursorWindow::FIELD_TYPE_FLOAT;
+    fields[3].type = CursorWindow::FIELD_TYPE_STRING;
+    fields[3].value.buffer.data = kLongText;
+    fields[3].value.buffer.size = sizeof(kLongText);
+
+    while (state.KeepRunning()) {
+        w->clear();
+        w->setNumColumns(kQueryCols);
+        for (size_t i = 0; i < kQueryRows; i++) {
+            fields[0].value.l = i;
+            fields[2].value.d = i * 0.5;
+            if (w->appendRow(fields, kQueryCols) != OK) {
+                w->clear();
+                w->setNumColumns(kQueryCols);
+            }
+        }
+    }
+}
+BENCHMARK(BM_CursorWindowFillAppendRow);
+
 }  // namespace android
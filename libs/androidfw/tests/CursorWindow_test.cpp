@@ -391,4 +391,134 @@ TEST(CursorWindowTest, ParcelLarge) {
     ASSERT_ALIGNED(w);
 }
 
+TEST(CursorWindowTest, GetNumericColumn) {
+    CREATE_WINDOW_1K;
+    ASSERT_EQ(w->setNumColumns(3), OK);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(w->allocRow(), OK);
+    }
+
+    ASSERT_EQ(w->putLong(0, 1, 42), OK);
+    ASSERT_EQ(w->putDouble(1, 1, 2.5), OK);
+    ASSERT_EQ(w->putString(2, 1, "17", 3), OK);
+    ASSERT_EQ(w->putNull(3, 1), OK);
+    ASSERT_EQ(w->putLong(4, 1, -7), OK);
+    ASSERT_EQ(w->putBlob(4, 2, "x", 1), OK);
+
+    int64_t longs[5];
+    ASSERT_EQ(w->getLongColumn(1, 0, 5, longs), OK);
+    ASSERT_EQ(longs[0], 42);
+    ASSERT_EQ(longs[1], 2);
+    ASSERT_EQ(longs[2], 17);
+    ASSERT_EQ(longs[3], 0);
+    ASSERT_EQ(longs[4], -7);
+
+    double doubles[2];
+    ASSERT_EQ(w->getDoubleColumn(1, 1, 2, doubles), OK);
+    ASSERT_EQ(doubles[0], 2.5);
+    ASSERT_EQ(doubles[1], 17.0);
+
+    ASSERT_EQ(w->getLongColumn(1, 5, 0, longs), OK);
+    ASSERT_EQ(w->getLongColumn(1, 3, 3, longs), BAD_VALUE);
+    ASSERT_EQ(w->getLongColumn(3, 0, 1, longs), BAD_VALUE);
+    ASSERT_EQ(w->getLongColumn(2, 0, 5, longs), BAD_TYPE);
+}
+
+TEST(CursorWindowTest, CopyRows) {
+    CREATE_WINDOW_1K_3X3;
+
+    ASSERT_EQ(w->putLong(0, 1, 42), OK);
+    ASSERT_EQ(w->putDouble(0, 2, 2.5), OK);
+    ASSERT_EQ(w->putString(1, 1, "text", 5), OK);
+    ASSERT_EQ(w->putBlob(1, 2, "\x01\x02", 2), OK);
+    ASSERT_EQ(w->putLong(2, 2, -7), OK);
+
+    int32_t types[4];
+    int64_t longs[4];
+    double doubles[4];
+    ASSERT_EQ(w->copyRows(0, 2, 1, 2, types, longs, doubles), OK);
+    ASSERT_EQ(types[0], CursorWindow::FIELD_TYPE_INTEGER);
+    ASSERT_EQ(longs[0], 42);
+    ASSERT_EQ(doubles[0], 42.0);
+    ASSERT_EQ(types[1], CursorWindow::FIELD_TYPE_FLOAT);
+    ASSERT_EQ(longs[1], 2);
+    ASSERT_EQ(doubles[1], 2.5);
+    ASSERT_EQ(types[2], CursorWindow::FIELD_TYPE_STRING);
+    ASSERT_EQ(longs[2], 0);
+    ASSERT_EQ(types[3], CursorWindow::FIELD_TYPE_BLOB);
+
+    ASSERT_EQ(w->copyRows(2, 1, 0, 3, types, nullptr, nullptr), OK);
+    ASSERT_EQ(types[0], CursorWindow::FIELD_TYPE_NULL);
+    ASSERT_EQ(types[2], CursorWindow::FIELD_TYPE_INTEGER);
+
+    ASSERT_EQ(w->copyRows(2, 2, 0, 1, types, longs, doubles), BAD_VALUE);
+    ASSERT_EQ(w->copyRows(0, 1, 2, 2, types, longs, doubles), BAD_VALUE);
+
+    CursorWindow::BulkField fields[3];
+    ASSERT_EQ(w->copyRowsToBuffer(1, 1, 0, 3, fields, sizeof(fields) - 1), NO_MEMORY);
+    ASSERT_EQ(w->copyRowsToBuffer(1, 1, 0, 3, fields, sizeof(fields)), OK);
+    ASSERT_EQ(fields[0].type, CursorWindow::FIELD_TYPE_NULL);
+    ASSERT_EQ(fields[1].type, CursorWindow::FIELD_TYPE_STRING);
+    ASSERT_EQ(fields[1].size, 5);
+    ASSERT_EQ(fields[2].type, CursorWindow::FIELD_TYPE_BLOB);
+    ASSERT_EQ(fields[2].size, 2);
+}
+
+TEST(CursorWindowTest, AppendRow) {
+    CREATE_WINDOW_2M;
+    ASSERT_EQ(w->setNumColumns(4), OK);
+
+    char buf[kHalfInlineSize];
+    memset(buf, 42, kHalfInlineSize);
+
+    CursorWindow::RowField fields[4];
+    fields[0].type = CursorWindow::FIELD_TYPE_INTEGER;
+    fields[0].value.l = 0xcafe;
+    fields[1].type = CursorWindow::FIELD_TYPE_STRING;
+    fields[1].value.buffer.data = "abc";
+    fields[1].value.buffer.size = 4;
+    fields[2].type = CursorWindow::FIELD_TYPE_NULL;
+    fields[3].type = CursorWindow::FIELD_TYPE_BLOB;
+    fields[3].value.buffer.data = buf;
+    fields[3].value.buffer.size = kHalfInlineSize;
+    ASSERT_EQ(w->appendRow(fields, 3), BAD_VALUE);
+    ASSERT_EQ(w->getNumRows(), 0);
+
+    // The second row needs the window to inflate.
+    auto before = w->size();
+    ASSERT_EQ(w->appendRow(fields, 4), OK);
+    ASSERT_EQ(w->appendRow(fields, 4), OK);
+    ASSERT_GT(w->size(), before);
+    ASSERT_EQ(w->getNumRows(), 2);
+    ASSERT_ALIGNED(w);
+
+    for (uint32_t row = 0; row < 2; row++) {
+        auto field = w->getFieldSlot(row, 0);
+        ASSERT_EQ(w->getFieldSlotType(field), CursorWindow::FIELD_TYPE_INTEGER);
+        ASSERT_EQ(w->getFieldSlotValueLong(field), 0xcafe);
+
+        field = w->getFieldSlot(row, 1);
+        ASSERT_EQ(w->getFieldSlotType(field), CursorWindow::FIELD_TYPE_STRING);
+        size_t actualSize;
+        ASSERT_STREQ(w->getFieldSlotValueString(field, &actualSize), "abc");
+        ASSERT_EQ(actualSize, 4);
+
+        field = w->getFieldSlot(row, 2);
+        ASSERT_EQ(w->getFieldSlotType(field), CursorWindow::FIELD_TYPE_NULL);
+
+        field = w->getFieldSlot(row, 3);
+        ASSERT_EQ(w->getFieldSlotType(field), CursorWindow::FIELD_TYPE_BLOB);
+        auto actual = w->getFieldSlotValueBlob(field, &actualSize);
+        ASSERT_EQ(actualSize, kHalfInlineSize);
+        ASSERT_EQ(memcmp(buf, actual, kHalfInlineSize), 0);
+    }
+
+    // A row that does not fit leaves the window untouched.
+    auto freeSpace = w->freeSpace();
+    fields[3].value.buffer.size = w->size();
+    ASSERT_EQ(w->appendRow(fields, 4), NO_MEMORY);
+    ASSERT_EQ(w->getNumRows(), 2);
+    ASSERT_EQ(w->freeSpace(), freeSpace);
+}
+
 } // android
@@ -71,6 +71,74 @@ TEST(LoadedArscTest, LoadSinglePackageArsc) {
   ASSERT_TRUE(LoadedPackage::GetEntry(type.type, entry_index).has_value());
 }
 
+TEST(LoadedArscTest, FindEntryByName) {
+  std::string contents;
+  ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/basic/basic.apk", "resources.arsc",
+                                      &contents));
+
+  auto loaded_arsc = LoadedArsc::Load(reinterpret_cast<const void*>(contents.data()),
+                                                                    contents.length());
+  ASSERT_THAT(loaded_arsc, NotNull());
+
+  const LoadedPackage* package =
+      loaded_arsc->GetPackageById(get_package_id(basic::R::string::test1));
+  ASSERT_THAT(package, NotNull());
+
+  // Look up names more than once so that both the cold and the indexed paths are exercised.
+  for (int i = 0; i < 2; i++) {
+    auto id = package->FindEntryByName(u"string", u"test1");
+    ASSERT_TRUE(id.has_value());
+    EXPECT_EQ(fix_package_id(basic::R::string::test1, 0), *id);
+
+    id = package->FindEntryByName(u"integer", u"ref1");
+    ASSERT_TRUE(id.has_value());
+    EXPECT_EQ(fix_package_id(basic::R::integer::ref1, 0), *id);
+
+    EXPECT_FALSE(package->FindEntryByName(u"string", u"ref1").has_value());
+    EXPECT_FALSE(package->FindEntryByName(u"string", u"does_not_exist").has_value());
+    EXPECT_FALSE(package->FindEntryByName(u"no_such_type", u"test1").has_value());
+  }
+}
+
+TEST(LoadedArscTest, LoadLazyTypes) {
+  std::string contents;
+  ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/basic/basic.apk", "resources.arsc",
+                                      &contents));
+
+  auto loaded_arsc = LoadedArsc::Load(reinterpret_cast<const void*>(contents.data()),
+                                      contents.length(), nullptr /* loaded_idmap */,
+                                      PROPERTY_LAZY_TYPES);
+  ASSERT_THAT(loaded_arsc, NotNull());
+
+  const LoadedPackage* package =
+      loaded_arsc->GetPackageById(get_package_id(basic::R::string::test1));
+  ASSERT_THAT(package, NotNull());
+  EXPECT_TRUE(package->HasLazyTypes());
+
+  size_t parsed_count = 0U;
+  package->ForEachParsedTypeSpec([&](const TypeSpec&, uint8_t) { parsed_count++; });
+  EXPECT_EQ(0U, parsed_count);
+
+  const uint8_t type_index = get_type_id(basic::R::string::test1) - 1;
+  const TypeSpec* type_spec = package->GetTypeSpecByTypeIndex(type_index);
+  ASSERT_THAT(type_spec, NotNull());
+  ASSERT_THAT(type_spec->type_entries.size(), Ge(1u));
+  EXPECT_TRUE(LoadedPackage::GetEntry(type_spec->type_entries[0].type,
+                                      get_entry_id(basic::R::string::test1)).has_value());
+  EXPECT_EQ(type_spec, package->GetTypeSpecByTypeIndex(type_index));
+
+  package->ForEachParsedTypeSpec([&](const TypeSpec& parsed, uint8_t type_id) {
+    EXPECT_EQ(type_index + 1, type_id);
+    EXPECT_EQ(type_spec, &parsed);
+    parsed_count++;
+  });
+  EXPECT_EQ(1U, parsed_count);
+
+  std::set<ResTable_config> configs;
+  ASSERT_TRUE(package->CollectConfigurations(false /* exclude_mipmap */, &configs).has_value());
+  EXPECT_THAT(configs.size(), Ge(1u));
+}
+
 TEST(LoadedArscTest, LoadSharedLibrary) {
   std::string contents;
   ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/lib_one/lib_one.apk", "resources.arsc",
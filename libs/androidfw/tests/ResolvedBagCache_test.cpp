@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "androidfw/ResolvedBagCache.h"
+
+#include <vector>
+
+#include "androidfw/AssetManager2.h"
+#include "gtest/gtest.h"
+
+namespace android {
+
+static ResolvedBag* AddBag(ResolvedBagCache& cache, uint32_t resid, uint32_t entry_count,
+                           uint32_t type_spec_flags) {
+  ResolvedBag* bag = cache.Allocate(entry_count);
+  bag->type_spec_flags = type_spec_flags;
+  bag->entry_count = entry_count;
+  for (uint32_t i = 0; i < entry_count; i++) {
+    bag->entries[i].key = resid + i;
+  }
+  cache.Insert(resid, bag);
+  return bag;
+}
+
+TEST(ResolvedBagCacheTest, FindsInsertedBags) {
+  ResolvedBagCache cache;
+  EXPECT_EQ(nullptr, cache.Find(0x7f010000u));
+
+  for (uint32_t i = 0; i < 1000; i++) {
+    AddBag(cache, 0x7f010000u + i, i % 7, 0U);
+  }
+  ASSERT_EQ(1000u, cache.size());
+
+  for (uint32_t i = 0; i < 1000; i++) {
+    ResolvedBag* bag = cache.Find(0x7f010000u + i);
+    ASSERT_NE(nullptr, bag);
+    ASSERT_EQ(i % 7, bag->entry_count);
+    for (uint32_t j = 0; j < bag->entry_count; j++) {
+      EXPECT_EQ(0x7f010000u + i + j, bag->entries[j].key);
+    }
+  }
+  EXPECT_EQ(nullptr, cache.Find(0x7f020000u));
+}
+
+TEST(ResolvedBagCacheTest, ShrinkReusesStorage) {
+  ResolvedBagCache cache;
+  ResolvedBag* first = cache.Allocate(10);
+  cache.Shrink(first, 1);
+  first->entry_count = 1;
+  cache.Insert(0x7f010000u, first);
+
+  ResolvedBag* second = AddBag(cache, 0x7f010001u, 1, 0U);
+  EXPECT_EQ(reinterpret_cast<uint8_t*>(first->entries + 1), reinterpret_cast<uint8_t*>(second));
+}
+
+TEST(ResolvedBagCacheTest, EraseVaryingWithKeepsUnaffectedBags) {
+  ResolvedBagCache cache;
+  for (uint32_t i = 0; i < 2000; i++) {
+    AddBag(cache, 0x7f010000u + i, 4,
+           (i % 4 == 0) ? ResTable_config::CONFIG_DENSITY : ResTable_config::CONFIG_UI_MODE);
+  }
+
+  cache.EraseVaryingWith(ResTable_config::CONFIG_UI_MODE);
+  ASSERT_EQ(500u, cache.size());
+  for (uint32_t i = 0; i < 2000; i++) {
+    ResolvedBag* bag = cache.Find(0x7f010000u + i);
+    if (i % 4 == 0) {
+      ASSERT_NE(nullptr, bag);
+      ASSERT_EQ(4u, bag->entry_count);
+      EXPECT_EQ(0x7f010000u + i + 3, bag->entries[3].key);
+    } else {
+      EXPECT_EQ(nullptr, bag);
+    }
+  }
+}
+
+TEST(ResolvedBagCacheTest, EraseVaryingWithKeepsBagsInPlace) {
+  ResolvedBagCache cache;
+  std::vector<ResolvedBag*> kept;
+  for (uint32_t i = 0; i < 4000; i++) {
+    ResolvedBag* bag = AddBag(cache, 0x7f010000u + i, 4,
+                              (i % 100 == 0) ? ResTable_config::CONFIG_DENSITY
+                                             : ResTable_config::CONFIG_UI_MODE);
+    if (i % 100 == 0) {
+      kept.push_back(bag);
+    }
+  }
+
+  cache.EraseVaryingWith(ResTable_config::CONFIG_UI_MODE);
+  ASSERT_EQ(kept.size(), cache.size());
+  for (uint32_t i = 0; i < kept.size(); i++) {
+    EXPECT_EQ(kept[i], cache.Find(0x7f010000u + i * 100));
+    EXPECT_EQ(0x7f010000u + i * 100 + 3, kept[i]->entries[3].key);
+  }
+}
+
+TEST(ResolvedBagCacheTest, InsertReplacesExistingBag) {
+  ResolvedBagCache cache;
+  AddBag(cache, 0x7f010000u, 2, 0U);
+  ResolvedBag* replacement = AddBag(cache, 0x7f010000u, 5, 0U);
+  ASSERT_EQ(1u, cache.size());
+  EXPECT_EQ(replacement, cache.Find(0x7f010000u));
+  EXPECT_EQ(5u, cache.Find(0x7f010000u)->entry_count);
+}
+
+TEST(ResolvedBagCacheTest, ClearRemovesEverything) {
+  ResolvedBagCache cache;
+  AddBag(cache, 0x7f010000u, 2, 0U);
+  AddBag(cache, 0x7f010001u, 2, 0U);
+  cache.Clear();
+  EXPECT_TRUE(cache.empty());
+  EXPECT_EQ(nullptr, cache.Find(0x7f010000u));
+
+  AddBag(cache, 0x7f010001u, 3, 0U);
+  ASSERT_NE(nullptr, cache.Find(0x7f010001u));
+  EXPECT_EQ(3u, cache.Find(0x7f010001u)->entry_count);
+}
+
+}  // namespace android
@@ -23,6 +23,8 @@
 
 #include <androidfw/ResourceTimer.h>
 
+#include <thread>
+
 namespace android {
 
 namespace {
@@ -241,5 +243,79 @@ TEST(ResourceTimerTest, TimerOversize) {
   ASSERT_THAT(timer.pvalues.p99.nominal, 0);
 }
 
+TEST(ResourceTimerTest, TimerMerge) {
+  ResourceTimer::Timer timer;
+  ResourceTimer::Timer other;
+  for (int i = 1; i <= 100; i++) {
+    (i % 2 == 0 ? timer : other).record(US(i));
+  }
+  timer.merge(other);
+  ASSERT_THAT(timer.count, 100);
+  ASSERT_THAT(timer.total, US((101 * 100)/2));
+  ASSERT_THAT(timer.mintime, US(1));
+  ASSERT_THAT(timer.maxtime, US(100));
+  ASSERT_THAT(timer.largest[0], US(100));
+  ASSERT_THAT(timer.largest[1], US(99));
+  ASSERT_THAT(timer.largest[2], US(98));
+  ASSERT_THAT(timer.largest[3], US(97));
+  ASSERT_THAT(timer.largest[4], US(96));
+  timer.compute();
+  ASSERT_THAT(timer.pvalues.p50.floor, US(49));
+  ASSERT_THAT(timer.pvalues.p50.nominal, US(50));
+  ASSERT_THAT(timer.pvalues.p99.floor, US(98));
+  ASSERT_THAT(timer.pvalues.p99.nominal, US(99));
+}
+
+// Verify that the events of every thread, including the ones that have exited, are fetched, and
+// that only the sampled calls are timed.
+TEST(ResourceTimerTest, ThreadsAndSampling) {
+  // RetrieveAttributes is only timed by the java bindings, so nothing else records it here.
+  const int counter = static_cast<int>(ResourceTimer::Counter::RetrieveAttributes);
+  ResourceTimer::Timer timer;
+  ResourceTimer::enable(4);
+  ResourceTimer::copy(counter, timer, true);
+
+  auto worker = [] {
+    for (int i = 0; i < 100; i++) {
+      ResourceTimer _timer(ResourceTimer::Counter::RetrieveAttributes);
+    }
+  };
+  std::thread first(worker);
+  std::thread second(worker);
+  first.join();
+  second.join();
+  ResourceTimer::enable(1);
+
+  ASSERT_TRUE(ResourceTimer::copy(counter, timer, true));
+  ASSERT_THAT(timer.count, 2 * 25);
+  ASSERT_FALSE(ResourceTimer::copy(counter, timer, true));
+  ASSERT_THAT(timer.count, 0);
+}
+
+// Verify that every counter is sampled on its own, so that interleaved calls of two counters on
+// one thread are both timed.
+TEST(ResourceTimerTest, SamplingPerCounter) {
+  // Neither counter is recorded by anything else here.
+  const int first = static_cast<int>(ResourceTimer::Counter::RetrieveAttributes);
+  const int second = static_cast<int>(ResourceTimer::Counter::ThemeApplyStyle);
+  ResourceTimer::Timer timer;
+  ResourceTimer::enable(2);
+  ResourceTimer::copy(first, timer, true);
+  ResourceTimer::copy(second, timer, true);
+
+  std::thread worker([] {
+    for (int i = 0; i < 100; i++) {
+      { ResourceTimer _timer(ResourceTimer::Counter::RetrieveAttributes); }
+      { ResourceTimer _timer(ResourceTimer::Counter::ThemeApplyStyle); }
+    }
+  });
+  worker.join();
+  ResourceTimer::enable(1);
+
+  ASSERT_TRUE(ResourceTimer::copy(first, timer, true));
+  ASSERT_THAT(timer.count, 50);
+  ASSERT_TRUE(ResourceTimer::copy(second, timer, true));
+  ASSERT_THAT(timer.count, 50);
+}
 
 }  // namespace android
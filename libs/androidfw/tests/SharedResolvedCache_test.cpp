@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "androidfw/SharedResolvedCache.h"
+
+#include "android-base/file.h"
+#include "TestHelpers.h"
+#include "data/basic/R.h"
+#include "data/styles/R.h"
+
+namespace app = com::android::app;
+namespace basic = com::android::basic;
+
+namespace android {
+
+class SharedResolvedCacheTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    basic_assets_ = ApkAssets::Load(GetTestDataPath() + "/basic/basic.apk");
+    ASSERT_NE(nullptr, basic_assets_);
+
+    style_assets_ = ApkAssets::Load(GetTestDataPath() + "/styles/styles.apk");
+    ASSERT_NE(nullptr, style_assets_);
+  }
+
+ protected:
+  std::shared_ptr<const SharedResolvedCache> BuildCache(const AssetManager2& assetmanager) {
+    TemporaryFile tf;
+    if (!SharedResolvedCache::Write(assetmanager, 0x7f, tf.fd)) {
+      return {};
+    }
+    return SharedResolvedCache::Load(tf.path);
+  }
+
+  AssetManager2::ApkAssetsPtr basic_assets_;
+  AssetManager2::ApkAssetsPtr style_assets_;
+};
+
+TEST_F(SharedResolvedCacheTest, RoundTripsValuesAndBags) {
+  AssetManager2 source;
+  source.SetApkAssets({style_assets_});
+
+  auto cache = BuildCache(source);
+  ASSERT_NE(nullptr, cache);
+  EXPECT_EQ(0x7f, cache->GetPackageId());
+  EXPECT_LT(0u, cache->GetBagCount());
+
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({style_assets_});
+  assetmanager.SetSharedResolvedCache(cache);
+  ASSERT_TRUE(assetmanager.IsSharedResolvedCacheActive());
+
+  auto bag = assetmanager.GetBag(app::R::style::StyleTwo);
+  ASSERT_TRUE(bag.has_value());
+  EXPECT_EQ(cache->FindBag(app::R::style::StyleTwo), *bag);
+  ASSERT_EQ(6u, (*bag)->entry_count);
+  EXPECT_EQ(app::R::attr::attr_one, (*bag)->entries[0].key);
+  EXPECT_EQ(Res_value::TYPE_INT_DEC, (*bag)->entries[0].value.dataType);
+  EXPECT_EQ(1u, (*bag)->entries[0].value.data);
+  EXPECT_EQ(app::R::style::StyleOne, (*bag)->entries[0].style);
+}
+
+TEST_F(SharedResolvedCacheTest, ResolvesReferencesFromTable) {
+  AssetManager2 source;
+  source.SetApkAssets({basic_assets_});
+
+  auto cache = BuildCache(source);
+  ASSERT_NE(nullptr, cache);
+  ASSERT_NE(nullptr, cache->FindResolvedValue(basic::R::integer::ref1));
+
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({basic_assets_});
+  assetmanager.SetSharedResolvedCache(cache);
+  ASSERT_TRUE(assetmanager.IsSharedResolvedCacheActive());
+
+  auto value = assetmanager.GetResource(basic::R::integer::ref1);
+  ASSERT_TRUE(value.has_value());
+  EXPECT_EQ(Res_value::TYPE_REFERENCE, value->type);
+  EXPECT_EQ(basic::R::integer::ref2, value->data);
+
+  ASSERT_TRUE(assetmanager.ResolveReference(*value).has_value());
+  EXPECT_EQ(Res_value::TYPE_INT_DEC, value->type);
+  EXPECT_EQ(12000u, value->data);
+  EXPECT_EQ(basic::R::integer::ref2, value->resid);
+}
+
+TEST_F(SharedResolvedCacheTest, IgnoredWhenConfigurationDiffers) {
+  AssetManager2 source;
+  source.SetApkAssets({basic_assets_});
+
+  auto cache = BuildCache(source);
+  ASSERT_NE(nullptr, cache);
+
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({basic_assets_});
+  assetmanager.SetSharedResolvedCache(cache);
+  ASSERT_TRUE(assetmanager.IsSharedResolvedCacheActive());
+
+  ResTable_config config{};
+  config.density = ResTable_config::DENSITY_XHIGH;
+  assetmanager.SetConfiguration(config);
+  EXPECT_FALSE(assetmanager.IsSharedResolvedCacheActive());
+
+  assetmanager.SetConfiguration({});
+  EXPECT_TRUE(assetmanager.IsSharedResolvedCacheActive());
+}
+
+TEST_F(SharedResolvedCacheTest, IgnoredWhenApkAssetsDiffer) {
+  AssetManager2 source;
+  source.SetApkAssets({basic_assets_});
+
+  auto cache = BuildCache(source);
+  ASSERT_NE(nullptr, cache);
+
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({style_assets_});
+  assetmanager.SetSharedResolvedCache(cache);
+  EXPECT_FALSE(assetmanager.IsSharedResolvedCacheActive());
+}
+
+TEST_F(SharedResolvedCacheTest, RejectsTruncatedTable) {
+  AssetManager2 source;
+  source.SetApkAssets({style_assets_});
+
+  TemporaryFile tf;
+  ASSERT_TRUE(SharedResolvedCache::Write(source, 0x7f, tf.fd));
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(tf.path, &contents));
+  ASSERT_TRUE(base::WriteStringToFile(contents.substr(0, contents.size() / 2), tf.path));
+  EXPECT_EQ(nullptr, SharedResolvedCache::Load(tf.path));
+}
+
+}  // namespace android
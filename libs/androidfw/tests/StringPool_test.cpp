@@ -17,6 +17,7 @@
 #include "androidfw/StringPool.h"
 
 #include <string>
+#include <vector>
 
 #include "androidfw/IDiagnostics.h"
 #include "androidfw/StringPiece.h"
@@ -385,4 +386,83 @@ TEST(StringPoolTest, MaxEncodingLength) {
   EXPECT_THAT(android::util::GetString16(test, 0), Eq(longStr16));
 }
 
+TEST(StringPoolTest, ConvertAsciiAndNonAsciiStrings) {
+  using namespace android;  // For NO_ERROR on Windows.
+  NoOpDiagnostics diag;
+
+  // Cover strings shorter than, equal to and longer than the vectorized blocks, with non-ASCII
+  // characters at the start, in the middle of a block and at the end.
+  const std::vector<std::string> strings = {
+      "",
+      "short",
+      "exactly 16 chars",
+      "a string that is long enough to span several vector blocks",
+      "\u00e9cole",
+      "a string with an accent \u00e9 in the middle of it",
+      "a string that ends with a non-ASCII character \u093f",
+  };
+
+  StringPool pool;
+  for (const std::string& str : strings) {
+    pool.MakeRef(str);
+  }
+
+  BigBuffer buffers[2] = {BigBuffer(1024), BigBuffer(1024)};
+  ASSERT_TRUE(StringPool::FlattenUtf8(&buffers[0], pool, &diag));
+  ASSERT_TRUE(StringPool::FlattenUtf16(&buffers[1], pool, &diag));
+
+  for (const BigBuffer& buffer : buffers) {
+    std::unique_ptr<uint8_t[]> data = util::Copy(buffer);
+    ResStringPool test;
+    ASSERT_THAT(test.setTo(data.get(), buffer.size()), Eq(NO_ERROR));
+
+    for (size_t i = 0; i < strings.size(); i++) {
+      auto str16 = test.stringAt(i);
+      ASSERT_TRUE(str16.has_value());
+      EXPECT_THAT(std::u16string(str16->data(), str16->size()),
+                  Eq(util::Utf8ToUtf16(strings[i])));
+
+      // A second lookup of a UTF-8 string is served from the decode cache.
+      auto cached16 = test.stringAt(i);
+      ASSERT_TRUE(cached16.has_value());
+      EXPECT_THAT(cached16->data(), Eq(str16->data()));
+
+      auto str8 = test.string8ObjectAt(i);
+      ASSERT_TRUE(str8.has_value());
+      EXPECT_THAT(std::string(str8->c_str(), str8->size()), Eq(strings[i]));
+    }
+  }
+}
+
+TEST(StringPoolTest, FlattenLargePool) {
+  using namespace android;  // For NO_ERROR on Windows.
+  NoOpDiagnostics diag;
+
+  // Enough strings to be encoded on several threads, with one too large for UTF-8 in the middle.
+  StringPool pool;
+  std::vector<std::string> strings;
+  for (size_t i = 0; i < 20000; i++) {
+    strings.push_back(i == 12345 ? std::string(50000, 'a')
+                                 : "string " + std::to_string(i) + " \xF0\x90\x90\x80");
+    pool.MakeRef(strings.back());
+  }
+
+  BigBuffer buffers[2] = {BigBuffer(1024), BigBuffer(1024)};
+  EXPECT_FALSE(StringPool::FlattenUtf8(&buffers[0], pool, &diag));
+  EXPECT_TRUE(StringPool::FlattenUtf16(&buffers[1], pool, &diag));
+
+  for (const BigBuffer& buffer : buffers) {
+    std::unique_ptr<uint8_t[]> data = util::Copy(buffer);
+    ResStringPool test;
+    ASSERT_THAT(test.setTo(data.get(), buffer.size()), Eq(NO_ERROR));
+    ASSERT_THAT(test.size(), Eq(strings.size()));
+
+    const bool utf8 = &buffer == &buffers[0];
+    for (size_t i = 0; i < strings.size(); i++) {
+      EXPECT_THAT(util::GetString(test, i),
+                  Eq(utf8 && i == 12345 ? std::string("STRING_TOO_LARGE") : strings[i]));
+    }
+  }
+}
+
 }  // namespace android
@@ -188,6 +188,49 @@ TEST_F(ThemeTest, MultipleThemesOverlaidForced) {
   EXPECT_EQ(static_cast<uint32_t>(ResTable_typeSpec::SPEC_PUBLIC), value->flags);
 }
 
+TEST_F(ThemeTest, ThemesWithSameStylesStayIndependent) {
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({style_assets_});
+
+  std::unique_ptr<Theme> theme_one = assetmanager.NewTheme();
+  ASSERT_TRUE(theme_one->ApplyStyle(app::R::style::StyleTwo).has_value());
+  ASSERT_TRUE(theme_one->ApplyStyle(app::R::style::StyleThree).has_value());
+
+  // Shares the entries of StyleTwo with theme_one before diverging.
+  std::unique_ptr<Theme> theme_two = assetmanager.NewTheme();
+  ASSERT_TRUE(theme_two->ApplyStyle(app::R::style::StyleTwo).has_value());
+  ASSERT_TRUE(theme_two->ApplyStyle(app::R::style::StyleThree, true /* force */).has_value());
+
+  // Applies the exact same styles as theme_one.
+  std::unique_ptr<Theme> theme_three = assetmanager.NewTheme();
+  ASSERT_TRUE(theme_three->ApplyStyle(app::R::style::StyleTwo).has_value());
+  ASSERT_TRUE(theme_three->ApplyStyle(app::R::style::StyleThree).has_value());
+  EXPECT_EQ(theme_one->GetChangingConfigurations(), theme_three->GetChangingConfigurations());
+
+  auto value = theme_one->GetAttribute(app::R::attr::attr_five);
+  ASSERT_TRUE(value);
+  EXPECT_EQ(Res_value::TYPE_REFERENCE, value->type);
+  EXPECT_EQ(app::R::string::string_one, value->data);
+
+  value = theme_two->GetAttribute(app::R::attr::attr_five);
+  ASSERT_TRUE(value);
+  EXPECT_EQ(Res_value::TYPE_INT_DEC, value->type);
+  EXPECT_EQ(5u, value->data);
+
+  // Modifying one of the themes must not affect the others.
+  theme_one->Clear();
+  ASSERT_FALSE(theme_one->GetAttribute(app::R::attr::attr_five).has_value());
+  ASSERT_TRUE(theme_one->ApplyStyle(app::R::style::StyleThree, true /* force */).has_value());
+
+  value = theme_three->GetAttribute(app::R::attr::attr_five);
+  ASSERT_TRUE(value);
+  EXPECT_EQ(Res_value::TYPE_REFERENCE, value->type);
+  EXPECT_EQ(app::R::string::string_one, value->data);
+  value = theme_three->GetAttribute(app::R::attr::attr_one);
+  ASSERT_TRUE(value);
+  EXPECT_EQ(1u, value->data);
+}
+
 TEST_F(ThemeTest, ResolveDynamicAttributesAndReferencesToSharedLibrary) {
   AssetManager2 assetmanager;
   assetmanager.SetApkAssets({lib_two_assets_, lib_one_assets_, libclient_assets_});
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "androidfw/ZipFileRO.h"
+
+#include <memory>
+#include <string>
+
+#include "android-base/file.h"
+#include "TestHelpers.h"
+
+namespace android {
+
+class ZipFileROTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    apk_path_ = GetTestDataPath() + "/basic/basic.apk";
+  }
+
+ protected:
+  std::string apk_path_;
+};
+
+static std::string ReadEntry(ZipFileRO* zip, const char* name) {
+  ZipEntryRO entry = zip->findEntryByName(name);
+  if (entry == nullptr) {
+    return {};
+  }
+
+  uint32_t uncompressed_length = 0;
+  zip->getEntryInfo(entry, nullptr, &uncompressed_length, nullptr, nullptr, nullptr, nullptr);
+  std::string contents(uncompressed_length, '\0');
+  const bool success = zip->uncompressEntry(entry, contents.data(), contents.size());
+  zip->releaseEntry(entry);
+  return success ? contents : std::string();
+}
+
+TEST_F(ZipFileROTest, OpenWithIndexFindsSameEntries) {
+  TemporaryFile index;
+  ASSERT_TRUE(ZipFileRO::writeIndex(apk_path_.c_str(), index.path));
+
+  std::unique_ptr<ZipFileRO> zip(ZipFileRO::open(apk_path_.c_str()));
+  ASSERT_NE(nullptr, zip);
+  std::unique_ptr<ZipFileRO> indexed_zip(ZipFileRO::openWithIndex(apk_path_.c_str(), index.path));
+  ASSERT_NE(nullptr, indexed_zip);
+
+  void* cookie;
+  ASSERT_TRUE(zip->startIteration(&cookie));
+  size_t entry_count = 0;
+  while (ZipEntryRO entry = zip->nextEntry(cookie)) {
+    char name[256];
+    ASSERT_EQ(0, zip->getEntryFileName(entry, name, sizeof(name)));
+
+    uint16_t method, indexed_method;
+    uint32_t uncompressed, indexed_uncompressed, compressed, indexed_compressed, crc, indexed_crc;
+    off64_t offset, indexed_offset;
+    ASSERT_TRUE(zip->getEntryInfo(entry, &method, &uncompressed, &compressed, &offset, nullptr,
+                                  &crc));
+
+    ZipEntryRO indexed_entry = indexed_zip->findEntryByName(name);
+    ASSERT_NE(nullptr, indexed_entry) << name;
+    ASSERT_TRUE(indexed_zip->getEntryInfo(indexed_entry, &indexed_method, &indexed_uncompressed,
+                                          &indexed_compressed, &indexed_offset, nullptr,
+                                          &indexed_crc));
+    EXPECT_EQ(method, indexed_method) << name;
+    EXPECT_EQ(uncompressed, indexed_uncompressed) << name;
+    EXPECT_EQ(compressed, indexed_compressed) << name;
+    EXPECT_EQ(offset, indexed_offset) << name;
+    EXPECT_EQ(crc, indexed_crc) << name;
+
+    char indexed_name[256];
+    ASSERT_EQ(0, indexed_zip->getEntryFileName(indexed_entry, indexed_name,
+                                               sizeof(indexed_name)));
+    EXPECT_STREQ(name, indexed_name);
+    indexed_zip->releaseEntry(indexed_entry);
+    entry_count++;
+  }
+  zip->endIteration(cookie);
+  EXPECT_LT(0u, entry_count);
+
+  EXPECT_EQ(nullptr, indexed_zip->findEntryByName("does/not/exist"));
+  EXPECT_EQ(nullptr, indexed_zip->findEntryByName(""));
+
+  // Uncompressing an entry opens the archive behind the index.
+  const std::string contents = ReadEntry(indexed_zip.get(), "resources.arsc");
+  EXPECT_FALSE(contents.empty());
+  EXPECT_EQ(ReadEntry(zip.get(), "resources.arsc"), contents);
+}
+
+TEST_F(ZipFileROTest, OpenWithInvalidIndexFallsBack) {
+  TemporaryFile index;
+  ASSERT_TRUE(base::WriteStringToFile("not an index", index.path));
+
+  std::unique_ptr<ZipFileRO> zip(ZipFileRO::openWithIndex(apk_path_.c_str(), index.path));
+  ASSERT_NE(nullptr, zip);
+  EXPECT_FALSE(ReadEntry(zip.get(), "resources.arsc").empty());
+
+  std::unique_ptr<ZipFileRO> missing_index_zip(
+      ZipFileRO::openWithIndex(apk_path_.c_str(), "/does/not/exist.idx"));
+  ASSERT_NE(nullptr, missing_index_zip);
+  EXPECT_FALSE(ReadEntry(missing_index_zip.get(), "resources.arsc").empty());
+}
+
+}  // namespace android
@@ -16,13 +16,19 @@
 
 #define LOG_TAG "ZipUtils_test"
 #include <utils/Log.h>
+#include <androidfw/StreamingZipInflater.h>
 #include <androidfw/ZipUtils.h>
+#include <android-base/file.h>
 
 #include <gtest/gtest.h>
+#include <zlib.h>
 
 #include <fcntl.h>
 #include <string.h>
 
+#include <string>
+#include <vector>
+
 namespace android {
 
 class ZipUtilsTest : public testing::Test {
@@ -66,4 +72,74 @@ TEST_F(ZipUtilsTest, ZipTimeConvertSuccess) {
     EXPECT_EQ(nullptr, t.tm_zone);
 }
 
+
+// Returns |data| compressed as a raw deflate stream, as stored in zip entries.
+static std::vector<uint8_t> deflateRaw(const std::string& data) {
+    z_stream zstream;
+    memset(&zstream, 0, sizeof(zstream));
+    EXPECT_EQ(Z_OK, deflateInit2(&zstream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                                 Z_DEFAULT_STRATEGY));
+
+    std::vector<uint8_t> compressed(deflateBound(&zstream, data.size()));
+    zstream.next_in = (Bytef*) data.data();
+    zstream.avail_in = data.size();
+    zstream.next_out = compressed.data();
+    zstream.avail_out = compressed.size();
+    EXPECT_EQ(Z_STREAM_END, deflate(&zstream, Z_FINISH));
+    compressed.resize(zstream.total_out);
+    deflateEnd(&zstream);
+    return compressed;
+}
+
+static std::string makeTestData() {
+    std::string data;
+    for (int i = 0; data.size() < 300 * 1024; i++) {
+        data += "line " + std::to_string(i * 7919 % 10007) + " of the uncompressed data\n";
+    }
+    return data;
+}
+
+TEST_F(ZipUtilsTest, InflateToBufferFromMemory) {
+    const std::string data = makeTestData();
+    const std::vector<uint8_t> compressed = deflateRaw(data);
+
+    std::string inflated(data.size(), '\0');
+    ASSERT_TRUE(ZipUtils::inflateToBuffer(incfs::map_ptr<void>(compressed.data()),
+                                          inflated.data(), inflated.size(), compressed.size()));
+    EXPECT_EQ(data, inflated);
+
+    // The uncompressed length must match the data.
+    std::string too_long(data.size() + 1, '\0');
+    EXPECT_FALSE(ZipUtils::inflateToBuffer(incfs::map_ptr<void>(compressed.data()),
+                                           too_long.data(), too_long.size(), compressed.size()));
+}
+
+TEST_F(ZipUtilsTest, StreamingInflaterHandlesAnyReadSize) {
+    const std::string data = makeTestData();
+    const std::vector<uint8_t> compressed = deflateRaw(data);
+
+    TemporaryFile tf;
+    ASSERT_TRUE(android::base::WriteFully(tf.fd, compressed.data(), compressed.size()));
+
+    // Reads smaller than the output chunk go through the inflater's buffer, larger reads are
+    // inflated directly into the destination.
+    for (size_t read_size : {size_t(1000), StreamingZipInflater::OUTPUT_CHUNK_SIZE,
+                             size_t(200 * 1024)}) {
+        StreamingZipInflater inflater(tf.fd, 0, data.size(), compressed.size());
+        std::string inflated;
+        std::vector<char> buffer(read_size);
+        ssize_t result;
+        while ((result = inflater.read(buffer.data(), buffer.size())) > 0) {
+            inflated.append(buffer.data(), result);
+        }
+        ASSERT_EQ(0, result) << "read size " << read_size;
+        EXPECT_EQ(data, inflated) << "read size " << read_size;
+
+        // Seeking backwards rewinds the stream.
+        ASSERT_EQ(100, inflater.seekAbsolute(100));
+        ASSERT_EQ(10, inflater.read(buffer.data(), 10));
+        EXPECT_EQ(data.substr(100, 10), std::string(buffer.data(), 10));
+    }
+}
+
 }
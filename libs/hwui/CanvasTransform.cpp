@@ -26,6 +26,7 @@
 #include <log/log.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 
 #include "Properties.h"
@@ -55,12 +56,39 @@ SkColor makeDark(SkColor color) {
     }
 }
 
+// Recording a display list with force dark transforms the same few colors over and over, and each
+// transform goes through Lab and back, so every recording thread keeps the latest results.
+class ColorTransformCache {
+public:
+    SkColor transform(ColorTransform transform, SkColor color) {
+        const uint32_t hash = (color ^ static_cast<uint32_t>(transform)) * 2654435761u;
+        Entry& entry = mEntries[hash >> (32 - kSizeBits)];
+        if (entry.transform != transform || entry.color != color) {
+            entry.transform = transform;
+            entry.color = color;
+            entry.result = transform == ColorTransform::Light ? makeLight(color) : makeDark(color);
+        }
+        return entry.result;
+    }
+
+private:
+    static constexpr int kSizeBits = 8;
+
+    struct Entry {
+        ColorTransform transform = ColorTransform::None;
+        SkColor color = 0;
+        SkColor result = 0;
+    };
+    std::array<Entry, 1 << kSizeBits> mEntries;
+};
+
+static thread_local ColorTransformCache sColorTransformCache;
+
 SkColor transformColor(ColorTransform transform, SkColor color) {
     switch (transform) {
         case ColorTransform::Light:
-            return makeLight(color);
         case ColorTransform::Dark:
-            return makeDark(color);
+            return sColorTransformCache.transform(transform, color);
         default:
             return color;
     }
@@ -69,14 +97,41 @@ SkColor transformColor(ColorTransform transform, SkColor color) {
 SkColor transformColorInverse(ColorTransform transform, SkColor color) {
     switch (transform) {
         case ColorTransform::Dark:
-            return makeLight(color);
+            return transformColor(ColorTransform::Light, color);
         case ColorTransform::Light:
-            return makeDark(color);
+            return transformColor(ColorTransform::Dark, color);
         default:
             return color;
     }
 }
 
+// Paints that share a color filter get the same transformed filter rather than a new one each.
+static sk_sp<SkColorFilter> blendColorFilter(SkColor color, SkBlendMode mode) {
+    struct Entry {
+        SkColor color = 0;
+        SkBlendMode mode = SkBlendMode::kClear;
+        sk_sp<SkColorFilter> filter;
+    };
+    static thread_local std::array<Entry, 16> sFilters;
+
+    Entry& entry = sFilters[((color * 2654435761u) >> 28) ^ (static_cast<uint32_t>(mode) & 15)];
+    if (!entry.filter || entry.color != color || entry.mode != mode) {
+        entry.color = color;
+        entry.mode = mode;
+        entry.filter = SkColorFilters::Blend(color, mode);
+    }
+    return entry.filter;
+}
+
+static sk_sp<SkColorFilter> invertLightnessColorFilter() {
+    static const sk_sp<SkColorFilter> sFilter = [] {
+        SkHighContrastConfig config;
+        config.fInvertStyle = SkHighContrastConfig::InvertStyle::kInvertLightness;
+        return SkHighContrastFilter::Make(config);
+    }();
+    return sFilter;
+}
+
 static void applyColorTransform(ColorTransform transform, SkPaint& paint) {
     if (transform == ColorTransform::None) return;
 
@@ -105,10 +160,9 @@ static void applyColorTransform(ColorTransform transform, SkPaint& paint) {
     if (paint.getColorFilter()) {
         SkBlendMode mode;
         SkColor color;
-        // TODO: LRU this or something to avoid spamming new color mode filters
         if (paint.getColorFilter()->asAColorMode(&color, &mode)) {
             color = transformColor(transform, color);
-            paint.setColorFilter(SkColorFilters::Blend(color, mode));
+            paint.setColorFilter(blendColorFilter(color, mode));
         }
     }
 }
@@ -145,9 +199,8 @@ bool transformPaint(ColorTransform transform, SkPaint* paint, BitmapPalette pale
         shouldInvert = true;
     }
     if (shouldInvert) {
-        SkHighContrastConfig config;
-        config.fInvertStyle = SkHighContrastConfig::InvertStyle::kInvertLightness;
-        paint->setColorFilter(SkHighContrastFilter::Make(config)->makeComposed(paint->refColorFilter()));
+        paint->setColorFilter(
+                invertLightnessColorFilter()->makeComposed(paint->refColorFilter()));
     }
     return shouldInvert;
 }
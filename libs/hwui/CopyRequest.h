@@ -19,6 +19,8 @@
 #include "Rect.h"
 #include "hwui/Bitmap.h"
 
+#include <vector>
+
 namespace android::uirenderer {
 
 // Keep in sync with PixelCopy.java codes
@@ -39,4 +41,22 @@ struct CopyRequest {
     virtual void onCopyFinished(CopyResult result) = 0;
 };
 
+/**
+ * A copy of several regions of the same source that does not block the RenderThread. Each region
+ * is scaled to the size of its destination bitmap, and converted to its color type and color
+ * space, on the GPU. The RenderThread only issues the work and later copies the finished pixels
+ * out, so it never stalls waiting on the GPU or the source's fence.
+ */
+struct MultiRegionCopyRequest {
+    // The regions of the source to copy. An empty Rect copies the whole source.
+    std::vector<Rect> srcRects;
+    explicit MultiRegionCopyRequest(std::vector<Rect> srcRects) : srcRects(std::move(srcRects)) {}
+    virtual ~MultiRegionCopyRequest() {}
+    // Called on the RenderThread for each region, with that region's size in the source.
+    virtual SkBitmap getDestinationBitmap(size_t region, int srcWidth, int srcHeight) = 0;
+    // Called on the RenderThread once every region is copied or has failed. The result is
+    // Success only if all regions were copied, and otherwise the first failure.
+    virtual void onCopyFinished(CopyResult result) = 0;
+};
+
 }  // namespace android::uirenderer
@@ -51,6 +51,7 @@ static_assert(static_cast<int>(FrameInfoIndex::NumIndexes) == 23,
 
 void FrameInfo::importUiThreadInfo(int64_t* info) {
     memcpy(mFrameInfo, info, UI_THREAD_FRAME_INFO_SIZE * sizeof(int64_t));
+    setFunctorSync(0, 0);
 }
 
 } /* namespace uirenderer */
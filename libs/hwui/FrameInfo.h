@@ -143,6 +143,15 @@ public:
         set(FrameInfoIndex::Flags) |= static_cast<uint64_t>(frameInfoFlag);
     }
 
+    // The part of the Sync stage spent in WebView functors' onSync, over |count| render nodes.
+    // Kept out of FrameInfoIndex, whose layout FrameMetrics mirrors.
+    void setFunctorSync(nsecs_t duration, uint32_t count) {
+        mFunctorSyncDuration = duration;
+        mFunctorSyncCount = count;
+    }
+    nsecs_t functorSyncDuration() const { return mFunctorSyncDuration; }
+    uint32_t functorSyncCount() const { return mFunctorSyncCount; }
+
     const int64_t* data() const { return mFrameInfo; }
 
     inline int64_t operator[](FrameInfoIndex index) const { return get(index); }
@@ -188,6 +197,8 @@ public:
 
 private:
     int64_t mFrameInfo[static_cast<int>(FrameInfoIndex::NumIndexes)];
+    nsecs_t mFunctorSyncDuration = 0;
+    uint32_t mFunctorSyncCount = 0;
 };
 
 } /* namespace uirenderer */
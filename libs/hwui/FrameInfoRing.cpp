@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameInfoRing.h"
+
+#include <cutils/ashmem.h>
+#include <errno.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <new>
+
+namespace android {
+namespace uirenderer {
+
+std::unique_ptr<FrameInfoRing> FrameInfoRing::create(uint32_t capacity) {
+    LOG_ALWAYS_FATAL_IF(capacity == 0, "FrameInfoRing needs at least one slot");
+    size_t size = regionSize(capacity);
+    base::unique_fd fd(ashmem_create_region("hwui-frameinfo", size));
+    if (fd < 0) {
+        ALOGW("Failed to create frame info ring, error = %s", strerror(errno));
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        ALOGW("Failed to map frame info ring, error = %s", strerror(errno));
+        return nullptr;
+    }
+    // Our own mapping stays writable, anyone mapping the fd after this can only read.
+    if (ashmem_set_prot_region(fd, PROT_READ) < 0) {
+        ALOGW("Failed to make frame info ring read-only, error = %s", strerror(errno));
+        munmap(mapping, size);
+        return nullptr;
+    }
+
+    // ashmem regions start out zeroed, so every slot is already at sequence 0.
+    Header* header = new (mapping) Header;
+    header->magic = kMagic;
+    header->version = kVersion;
+    header->capacity = capacity;
+    header->fieldCount = kFieldCount;
+    header->writeCount.store(0, std::memory_order_release);
+    return std::unique_ptr<FrameInfoRing>(new FrameInfoRing(std::move(fd), mapping, size));
+}
+
+FrameInfoRing::FrameInfoRing(base::unique_fd fd, void* mapping, size_t size)
+        : mFd(std::move(fd)), mMapping(mapping), mSize(size) {}
+
+FrameInfoRing::~FrameInfoRing() {
+    munmap(mMapping, mSize);
+}
+
+void FrameInfoRing::write(const FrameInfo& frame) {
+    Header* head = header();
+    uint64_t index = head->writeCount.load(std::memory_order_relaxed);
+    Slot& slot = slots()[index % head->capacity];
+
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    // Keeps the stores below from becoming visible before the slot is marked as being written.
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint32_t i = 0; i < kFieldCount; i++) {
+        slot.data[i].store(frame[static_cast<int>(i)], std::memory_order_relaxed);
+    }
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    head->writeCount.store(index + 1, std::memory_order_release);
+}
+
+const FrameInfoRing::Header* FrameInfoRing::validate(const void* region, size_t regionSize) {
+    if (region == nullptr || regionSize < slotOffset()) {
+        return nullptr;
+    }
+    auto header = reinterpret_cast<const Header*>(region);
+    if (header->magic != kMagic || header->version != kVersion ||
+        header->fieldCount != kFieldCount || header->capacity == 0 ||
+        regionSize < FrameInfoRing::regionSize(header->capacity)) {
+        return nullptr;
+    }
+    return header;
+}
+
+uint64_t FrameInfoRing::writeCount(const void* region, size_t regionSize) {
+    const Header* header = validate(region, regionSize);
+    return header ? header->writeCount.load(std::memory_order_acquire) : 0;
+}
+
+bool FrameInfoRing::read(const void* region, size_t regionSize, uint64_t frameIndex,
+                         int64_t* outData) {
+    const Header* header = validate(region, regionSize);
+    if (!header || frameIndex >= header->writeCount.load(std::memory_order_acquire)) {
+        return false;
+    }
+    auto slots = reinterpret_cast<const Slot*>(reinterpret_cast<const uint8_t*>(region) +
+                                               slotOffset());
+    const Slot& slot = slots[frameIndex % header->capacity];
+    // The slot holds frameIndex only if it was written exactly this many times.
+    const uint64_t expected = 2 * (frameIndex / header->capacity + 1);
+
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+    for (uint32_t i = 0; i < kFieldCount; i++) {
+        outData[i] = slot.data[i].load(std::memory_order_relaxed);
+    }
+    // Keeps the loads above from being reordered after the sequence re-check.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+}
+
+} /* namespace uirenderer */
+} /* namespace android */
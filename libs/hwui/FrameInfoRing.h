@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameInfo.h"
+#include "utils/Macros.h"
+
+#include <android-base/unique_fd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * A ring of the most recent FrameInfo records kept in a shared memory region, so that a profiler
+ * holding the region's fd can follow frames without any binder calls into the app.
+ *
+ * There is exactly one writer, the JankTracker, and any number of readers that only map the
+ * region read-only. Each slot is guarded by a sequence count (a seqlock): the writer makes it odd
+ * while the slot is being rewritten and even once it is stable, so a reader that sees the same
+ * even count before and after copying a slot knows the copy is consistent. Nothing ever blocks.
+ *
+ * The layout is part of the contract with out-of-process readers; bump kVersion when changing it.
+ */
+class FrameInfoRing {
+    PREVENT_COPY_AND_ASSIGN(FrameInfoRing);
+
+public:
+    static constexpr uint32_t kMagic = 0x52494648;  // "HFIR"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kFieldCount = static_cast<uint32_t>(FrameInfoIndex::NumIndexes);
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t fieldCount;
+        // Total number of frames ever written. Frame n lives in slot n % capacity.
+        std::atomic<uint64_t> writeCount;
+    };
+
+    struct Slot {
+        // 2 * (number of times the slot was written), plus one while a write is in progress.
+        std::atomic<uint64_t> sequence;
+        std::atomic<int64_t> data[kFieldCount];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                          std::atomic<int64_t>::is_always_lock_free,
+                  "The ring is shared across processes and must not rely on hidden locks");
+
+    // Creates a ring backed by a new ashmem region, or returns nullptr on failure.
+    static std::unique_ptr<FrameInfoRing> create(uint32_t capacity);
+    ~FrameInfoRing();
+
+    // The fd of the backing region. Only read-only mappings of it are allowed.
+    int fd() const { return mFd.get(); }
+    size_t size() const { return mSize; }
+
+    void write(const FrameInfo& frame);
+
+    // Copies frame number `frameIndex` out of the mapped region at `region`. Returns false if
+    // the region is malformed, the frame hasn't been written yet, was already overwritten, or is
+    // being rewritten at this moment.
+    static bool read(const void* region, size_t regionSize, uint64_t frameIndex,
+                     int64_t* outData);
+    // Returns how many frames have been written to the ring at `region`, or 0 if it is malformed.
+    static uint64_t writeCount(const void* region, size_t regionSize);
+
+    static size_t regionSize(uint32_t capacity) {
+        return slotOffset() + static_cast<size_t>(capacity) * sizeof(Slot);
+    }
+
+private:
+    FrameInfoRing(base::unique_fd fd, void* mapping, size_t size);
+
+    static constexpr size_t slotOffset() { return (sizeof(Header) + 63) & ~size_t(63); }
+    static const Header* validate(const void* region, size_t regionSize);
+
+    Header* header() const { return reinterpret_cast<Header*>(mMapping); }
+    Slot* slots() const {
+        return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(mMapping) + slotOffset());
+    }
+
+    base::unique_fd mFd;
+    void* mMapping;
+    size_t mSize;
+};
+
+} /* namespace uirenderer */
+} /* namespace android */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameStageStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+namespace android {
+namespace uirenderer {
+
+static constexpr std::array<const char*, static_cast<size_t>(FrameStage::COUNT)> STAGE_NAMES{
+        "Vsync delay", "UI thread", "Sync queue wait", "Sync", "Functor sync",
+        "Issue draw commands", "Dequeue buffer", "Queue buffer", "Swap buffers", "GPU",
+};
+
+static double toMs(nsecs_t duration) {
+    return duration / 1000000.0;
+}
+
+uint32_t StageHistogram::bucketFor(uint64_t micros) {
+    if (micros < kSubBucketCount) {
+        return static_cast<uint32_t>(micros);
+    }
+    uint32_t msb = 63 - __builtin_clzll(micros);
+    if (msb >= kMaxValueBits) {
+        return kBucketCount - 1;
+    }
+    uint32_t shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBucketCount +
+           static_cast<uint32_t>((micros >> shift) - kSubBucketCount);
+}
+
+uint64_t StageHistogram::bucketStart(uint32_t bucket) {
+    if (bucket < kSubBucketCount) {
+        return bucket;
+    }
+    uint32_t shift = bucket / kSubBucketCount - 1;
+    return static_cast<uint64_t>(kSubBucketCount + bucket % kSubBucketCount) << shift;
+}
+
+void StageHistogram::record(nsecs_t duration) {
+    if (duration < 0) {
+        return;
+    }
+    mCounts[bucketFor(static_cast<uint64_t>(duration) / 1000)]++;
+    mCount++;
+}
+
+void StageHistogram::reset() {
+    mCounts.fill(0);
+    mCount = 0;
+}
+
+nsecs_t StageHistogram::findPercentile(int percentile) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    uint64_t target = (static_cast<uint64_t>(mCount) * percentile + 99) / 100;
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kBucketCount; i++) {
+        seen += mCounts[i];
+        if (seen >= target) {
+            return static_cast<nsecs_t>(bucketStart(i)) * 1000;
+        }
+    }
+    return maxValue();
+}
+
+nsecs_t StageHistogram::maxValue() const {
+    for (uint32_t i = kBucketCount; i > 0; i--) {
+        if (mCounts[i - 1]) {
+            return static_cast<nsecs_t>(bucketStart(i - 1)) * 1000;
+        }
+    }
+    return 0;
+}
+
+const char* FrameStageStats::stageName(FrameStage stage) {
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+void FrameStageStats::reportFrame(const FrameInfo& frame) {
+    record(FrameStage::VsyncDelay,
+           frame.duration(FrameInfoIndex::IntendedVsync, FrameInfoIndex::Vsync));
+    record(FrameStage::UiThread, frame.duration(FrameInfoIndex::Vsync, FrameInfoIndex::SyncQueued));
+    record(FrameStage::SyncQueueWait,
+           frame.duration(FrameInfoIndex::SyncQueued, FrameInfoIndex::SyncStart));
+    record(FrameStage::Sync,
+           frame.duration(FrameInfoIndex::SyncStart, FrameInfoIndex::IssueDrawCommandsStart));
+    if (frame.functorSyncCount() > 0) {
+        record(FrameStage::FunctorSync, frame.functorSyncDuration());
+    }
+    record(FrameStage::IssueDraw,
+           frame.duration(FrameInfoIndex::IssueDrawCommandsStart, FrameInfoIndex::SwapBuffers));
+    record(FrameStage::DequeueBuffer, frame[FrameInfoIndex::DequeueBufferDuration]);
+    record(FrameStage::QueueBuffer, frame[FrameInfoIndex::QueueBufferDuration]);
+    // Stages that never completed come out negative and are dropped by the histogram.
+    record(FrameStage::Swap,
+           frame.duration(FrameInfoIndex::SwapBuffers, FrameInfoIndex::SwapBuffersCompleted));
+    record(FrameStage::Gpu, frame.gpuDrawTime());
+}
+
+void FrameStageStats::reset() {
+    for (auto& histogram : mHistograms) {
+        histogram.reset();
+    }
+}
+
+void FrameStageStats::dump(int fd) const {
+    dprintf(fd, "\nStage latencies (50th/90th/99th percentile, max):");
+    for (size_t i = 0; i < mHistograms.size(); i++) {
+        const StageHistogram& histogram = mHistograms[i];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        dprintf(fd, "\n  %s: %.2fms/%.2fms/%.2fms, %.2fms (%u frames)", STAGE_NAMES[i],
+                toMs(histogram.findPercentile(50)), toMs(histogram.findPercentile(90)),
+                toMs(histogram.findPercentile(99)), toMs(histogram.maxValue()), histogram.count());
+    }
+    dprintf(fd, "\n");
+}
+
+} /* namespace uirenderer */
+} /* namespace android */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameInfo.h"
+
+#include <array>
+#include <cstdint>
+
+namespace android {
+namespace uirenderer {
+
+// Log-linear latency histogram in the style of HdrHistogram. Values are recorded in microseconds,
+// every power of two is split into kSubBucketCount linear buckets, so the reported value of any
+// bucket is within ~6% of the recorded ones across the whole range.
+class StageHistogram {
+public:
+    static constexpr uint32_t kSubBucketBits = 4;
+    static constexpr uint32_t kSubBucketCount = 1 << kSubBucketBits;
+    // 2^24us is about 16.7s, anything slower is an ANR rather than a slow stage.
+    static constexpr uint32_t kMaxValueBits = 24;
+    static constexpr uint32_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+    void record(nsecs_t duration);
+    void reset();
+
+    // Returns the duration in nanoseconds below which `percentile` percent of the recorded
+    // values fall, or 0 if nothing was recorded.
+    nsecs_t findPercentile(int percentile) const;
+    nsecs_t maxValue() const;
+    uint32_t count() const { return mCount; }
+
+    static uint32_t bucketFor(uint64_t micros);
+    // The smallest value, in microseconds, recorded into `bucket`.
+    static uint64_t bucketStart(uint32_t bucket);
+
+private:
+    std::array<uint32_t, kBucketCount> mCounts{};
+    uint32_t mCount = 0;
+};
+
+// The stages of a frame that are tracked individually. Boundaries are FrameInfo timestamps, so
+// they line up with what FrameMetrics and the systrace slices report.
+enum class FrameStage {
+    // IntendedVsync -> Vsync: how late the UI thread started the frame.
+    VsyncDelay = 0,
+    // Vsync -> SyncQueued: input, animation, traversal and recording on the UI thread.
+    UiThread,
+    // SyncQueued -> SyncStart: waiting for the RenderThread to pick the frame up.
+    SyncQueueWait,
+    // SyncStart -> IssueDrawCommandsStart: syncing the tree and uploading textures.
+    Sync,
+    // The WebView functor syncs within Sync, only for the frames that had any.
+    FunctorSync,
+    // IssueDrawCommandsStart -> SwapBuffers: issuing draw commands to the GPU.
+    IssueDraw,
+    // Time spent blocked in dequeueBuffer and queueBuffer.
+    DequeueBuffer,
+    QueueBuffer,
+    // SwapBuffers -> SwapBuffersCompleted.
+    Swap,
+    // SwapBuffers -> GpuCompleted.
+    Gpu,
+
+    COUNT,
+};
+
+// Per-stage latency histograms for the frames seen by a JankTracker. Unlike ProfileData this is
+// not shared with GraphicsStatsService, so it is free to be more precise than ashmem allows.
+class FrameStageStats {
+public:
+    void reportFrame(const FrameInfo& frame);
+    void reset();
+    void dump(int fd) const;
+
+    const StageHistogram& histogram(FrameStage stage) const {
+        return mHistograms[static_cast<size_t>(stage)];
+    }
+
+    static const char* stageName(FrameStage stage);
+
+private:
+    void record(FrameStage stage, nsecs_t duration) {
+        mHistograms[static_cast<size_t>(stage)].record(duration);
+    }
+
+    std::array<StageHistogram, static_cast<size_t>(FrameStage::COUNT)> mHistograms;
+};
+
+} /* namespace uirenderer */
+} /* namespace android */
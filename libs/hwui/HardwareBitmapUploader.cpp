@@ -32,7 +32,11 @@
 #include <utils/NdkUtils.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <future>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "hwui/Bitmap.h"
 #include "renderthread/EglManager.h"
@@ -57,6 +61,15 @@ struct FormatInfo {
     bool valid = true;
 };
 
+// An upload waiting for the upload thread. The buffer is owned by the upload until the bitmap
+// wrapping it is created.
+struct PendingUpload {
+    SkBitmap bitmap;
+    FormatInfo format;
+    UniqueAHardwareBuffer ahb;
+    std::promise<sk_sp<Bitmap>> result;
+};
+
 class AHBUploader : public RefBase {
 public:
     virtual ~AHBUploader() {}
@@ -72,12 +85,21 @@ public:
         onDestroy();
     }
 
-    bool uploadHardwareBitmap(const SkBitmap& bitmap, const FormatInfo& format,
-                              AHardwareBuffer* ahb) {
+    // Queues the upload and returns right away. Uploads queued while the upload thread is busy
+    // are coalesced into a single submission that is waited on once for the whole batch.
+    std::future<sk_sp<Bitmap>> uploadHardwareBitmap(PendingUpload&& upload) {
         ATRACE_CALL();
+        std::future<sk_sp<Bitmap>> result = upload.result.get_future();
         beginUpload();
-        bool result = onUploadHardwareBitmap(bitmap, format, ahb);
-        endUpload();
+        {
+            std::lock_guard _lock{mQueueLock};
+            mQueue.push_back(std::move(upload));
+            if (mIsDrainScheduled) {
+                return result;
+            }
+            mIsDrainScheduled = true;
+        }
+        mUploadThread->queue().post([this]() { this->drainQueue(); });
         return result;
     }
 
@@ -93,10 +115,37 @@ private:
     virtual void onIdle() = 0;
     virtual void onDestroy() = 0;
 
-    virtual bool onUploadHardwareBitmap(const SkBitmap& bitmap, const FormatInfo& format,
-                                        AHardwareBuffer* ahb) = 0;
+    // Called on the upload thread. Fills in whether each upload of the batch succeeded and only
+    // returns once the GPU has finished copying all of them.
+    virtual void onUploadHardwareBitmaps(const std::vector<PendingUpload>& batch,
+                                         std::vector<bool>& succeeded) = 0;
     virtual void onBeginUpload() = 0;
 
+    void drainQueue() {
+        std::vector<PendingUpload> batch;
+        {
+            std::lock_guard _lock{mQueueLock};
+            batch.swap(mQueue);
+            mIsDrainScheduled = false;
+        }
+        ATRACE_FORMAT("Upload %zu hardware bitmaps", batch.size());
+        std::vector<bool> succeeded(batch.size(), false);
+        onUploadHardwareBitmaps(batch, succeeded);
+        for (size_t i = 0; i < batch.size(); i++) {
+            PendingUpload& upload = batch[i];
+            // Finish the upload before the caller can observe the result, as it may terminate()
+            endUpload();
+            if (succeeded[i]) {
+                const SkBitmap& bitmap = upload.bitmap;
+                upload.result.set_value(Bitmap::createFrom(
+                        upload.ahb.get(), bitmap.colorType(), bitmap.refColorSpace(),
+                        bitmap.alphaType(), Bitmap::computePalette(bitmap)));
+            } else {
+                upload.result.set_value(nullptr);
+            }
+        }
+    }
+
     bool shouldTimeOutLocked() {
         nsecs_t durationSince = systemTime() - mLastUpload;
         return durationSince > kThreadTimeout;
@@ -133,6 +182,10 @@ private:
 
     int mPendingUploads = 0;
     nsecs_t mLastUpload = 0;
+
+    std::mutex mQueueLock;
+    std::vector<PendingUpload> mQueue;
+    bool mIsDrainScheduled = false;
 };
 
 #define FENCE_TIMEOUT 2000000000
@@ -164,63 +217,68 @@ private:
         return mEglManager.eglDisplay();
     }
 
-    bool onUploadHardwareBitmap(const SkBitmap& bitmap, const FormatInfo& format,
-                                AHardwareBuffer* ahb) override {
+    bool uploadToImage(EGLImageKHR image, const SkBitmap& bitmap, const FormatInfo& format) {
+        ATRACE_FORMAT("CPU -> gralloc transfer (%dx%d)", bitmap.width(), bitmap.height());
+        AutoSkiaGlTexture glTexture;
+        glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, image);
+        if (GLUtils::dumpGLErrors()) {
+            return false;
+        }
+
+        // glTexSubImage2D is synchronous in sense that it memcpy() from pointer that we
+        // provide.
+        // But asynchronous in sense that driver may upload texture onto hardware buffer
+        // when we first use it in drawing
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, bitmap.width(), bitmap.height(), format.format,
+                        format.type, bitmap.getPixels());
+        return !GLUtils::dumpGLErrors();
+    }
+
+    void onUploadHardwareBitmaps(const std::vector<PendingUpload>& batch,
+                                 std::vector<bool>& succeeded) override {
         ATRACE_CALL();
 
         EGLDisplay display = getUploadEglDisplay();
 
         LOG_ALWAYS_FATAL_IF(display == EGL_NO_DISPLAY, "Failed to get EGL_DEFAULT_DISPLAY! err=%s",
                             uirenderer::renderthread::EglManager::eglErrorString());
-        // We use an EGLImage to access the content of the buffer
-        // The EGL image is later bound to a 2D texture
-        const EGLClientBuffer clientBuffer = eglGetNativeClientBufferANDROID(ahb);
-        AutoEglImage autoImage(display, clientBuffer);
-        if (autoImage.image == EGL_NO_IMAGE_KHR) {
-            ALOGW("Could not create EGL image, err =%s",
-                  uirenderer::renderthread::EglManager::eglErrorString());
-            return false;
-        }
-
-        {
-            ATRACE_FORMAT("CPU -> gralloc transfer (%dx%d)", bitmap.width(), bitmap.height());
-            EGLSyncKHR fence = mUploadThread->queue().runSync([&]() -> EGLSyncKHR {
-                AutoSkiaGlTexture glTexture;
-                glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, autoImage.image);
-                if (GLUtils::dumpGLErrors()) {
-                    return EGL_NO_SYNC_KHR;
-                }
-
-                // glTexSubImage2D is synchronous in sense that it memcpy() from pointer that we
-                // provide.
-                // But asynchronous in sense that driver may upload texture onto hardware buffer
-                // when we first use it in drawing
-                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, bitmap.width(), bitmap.height(),
-                                format.format, format.type, bitmap.getPixels());
-                if (GLUtils::dumpGLErrors()) {
-                    return EGL_NO_SYNC_KHR;
-                }
-
-                EGLSyncKHR uploadFence =
-                        eglCreateSyncKHR(eglGetCurrentDisplay(), EGL_SYNC_FENCE_KHR, NULL);
-                if (uploadFence == EGL_NO_SYNC_KHR) {
-                    ALOGW("Could not create sync fence %#x", eglGetError());
-                };
-                glFlush();
-                GLUtils::dumpGLErrors();
-                return uploadFence;
-            });
-
-            if (fence == EGL_NO_SYNC_KHR) {
-                return false;
+        // We use an EGLImage to access the content of each buffer
+        // The EGL image is later bound to a 2D texture. The images have to outlive the fence.
+        std::vector<std::unique_ptr<AutoEglImage>> images;
+        images.reserve(batch.size());
+        bool anyUploaded = false;
+        for (size_t i = 0; i < batch.size(); i++) {
+            const EGLClientBuffer clientBuffer =
+                    eglGetNativeClientBufferANDROID(batch[i].ahb.get());
+            auto& autoImage = images.emplace_back(new AutoEglImage(display, clientBuffer));
+            if (autoImage->image == EGL_NO_IMAGE_KHR) {
+                ALOGW("Could not create EGL image, err =%s",
+                      uirenderer::renderthread::EglManager::eglErrorString());
+                continue;
             }
-            EGLint waitStatus = eglClientWaitSyncKHR(display, fence, 0, FENCE_TIMEOUT);
-            ALOGE_IF(waitStatus != EGL_CONDITION_SATISFIED_KHR,
-                    "Failed to wait for the fence %#x", eglGetError());
+            succeeded[i] = uploadToImage(autoImage->image, batch[i].bitmap, batch[i].format);
+            anyUploaded |= succeeded[i];
+        }
+        if (!anyUploaded) {
+            return;
+        }
 
-            eglDestroySyncKHR(display, fence);
+        // A single fence covers every transfer of the batch
+        EGLSyncKHR fence = eglCreateSyncKHR(eglGetCurrentDisplay(), EGL_SYNC_FENCE_KHR, NULL);
+        if (fence == EGL_NO_SYNC_KHR) {
+            ALOGW("Could not create sync fence %#x", eglGetError());
+        }
+        glFlush();
+        GLUtils::dumpGLErrors();
+        if (fence == EGL_NO_SYNC_KHR) {
+            std::fill(succeeded.begin(), succeeded.end(), false);
+            return;
         }
-        return true;
+        EGLint waitStatus = eglClientWaitSyncKHR(display, fence, 0, FENCE_TIMEOUT);
+        ALOGE_IF(waitStatus != EGL_CONDITION_SATISFIED_KHR,
+                "Failed to wait for the fence %#x", eglGetError());
+
+        eglDestroySyncKHR(display, fence);
     }
 
     renderthread::EglManager mEglManager;
@@ -239,35 +297,33 @@ private:
 
     void onBeginUpload() override {}
 
-    bool onUploadHardwareBitmap(const SkBitmap& bitmap, const FormatInfo& format,
-                                AHardwareBuffer* ahb) override {
-        bool uploadSucceeded = false;
-        mUploadThread->queue().runSync([this, &uploadSucceeded, bitmap, ahb]() {
-          ATRACE_CALL();
-          std::lock_guard _lock{mVkLock};
-
-          renderthread::VulkanManager* vkManager = getVulkanManager();
-          if (!vkManager->hasVkContext()) {
-              LOG_ALWAYS_FATAL_IF(mGrContext,
-                                  "GrContext exists with no VulkanManager for vulkan uploads");
-              vkManager->initialize();
-          }
-
-          if (!mGrContext) {
-              GrContextOptions options;
-              mGrContext = vkManager->createContext(options,
-                      renderthread::VulkanManager::ContextType::kUploadThread);
-              LOG_ALWAYS_FATAL_IF(!mGrContext, "failed to create GrContext for vulkan uploads");
-              this->postIdleTimeoutCheck();
-          }
-
-          sk_sp<SkImage> image =
-              SkImage::MakeFromAHardwareBufferWithData(mGrContext.get(), bitmap.pixmap(), ahb);
-          mGrContext->submit(true);
-
-          uploadSucceeded = (image.get() != nullptr);
-        });
-        return uploadSucceeded;
+    void onUploadHardwareBitmaps(const std::vector<PendingUpload>& batch,
+                                 std::vector<bool>& succeeded) override {
+        ATRACE_CALL();
+        std::lock_guard _lock{mVkLock};
+
+        renderthread::VulkanManager* vkManager = getVulkanManager();
+        if (!vkManager->hasVkContext()) {
+            LOG_ALWAYS_FATAL_IF(mGrContext,
+                                "GrContext exists with no VulkanManager for vulkan uploads");
+            vkManager->initialize();
+        }
+
+        if (!mGrContext) {
+            GrContextOptions options;
+            mGrContext = vkManager->createContext(options,
+                    renderthread::VulkanManager::ContextType::kUploadThread);
+            LOG_ALWAYS_FATAL_IF(!mGrContext, "failed to create GrContext for vulkan uploads");
+            this->postIdleTimeoutCheck();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            sk_sp<SkImage> image = SkImage::MakeFromAHardwareBufferWithData(
+                    mGrContext.get(), batch[i].bitmap.pixmap(), batch[i].ahb.get());
+            succeeded[i] = (image.get() != nullptr);
+        }
+        // A single submission, waited on once, for the whole batch
+        mGrContext->submit(true);
     }
 
     /* must be called on the upload thread after the vkLock has been acquired  */
@@ -411,7 +467,18 @@ static void createUploader(bool usingGL) {
     }
 }
 
+static std::future<sk_sp<Bitmap>> makeReadyFuture(sk_sp<Bitmap> bitmap) {
+    std::promise<sk_sp<Bitmap>> promise;
+    promise.set_value(std::move(bitmap));
+    return promise.get_future();
+}
+
 sk_sp<Bitmap> HardwareBitmapUploader::allocateHardwareBitmap(const SkBitmap& sourceBitmap) {
+    return allocateHardwareBitmapAsync(sourceBitmap).get();
+}
+
+std::future<sk_sp<Bitmap>> HardwareBitmapUploader::allocateHardwareBitmapAsync(
+        const SkBitmap& sourceBitmap) {
     ATRACE_CALL();
 
     bool usingGL = uirenderer::Properties::getRenderPipelineType() ==
@@ -419,9 +486,10 @@ sk_sp<Bitmap> HardwareBitmapUploader::allocateHardwareBitmap(const SkBitmap& sou
 
     FormatInfo format = determineFormat(sourceBitmap, usingGL);
     if (!format.valid) {
-        return nullptr;
+        return makeReadyFuture(nullptr);
     }
 
+    // Converting on the calling thread overlaps with the upload thread copying the previous batch
     SkBitmap bitmap = makeHwCompatible(format, sourceBitmap);
     AHardwareBuffer_Desc desc = {
             .width = static_cast<uint32_t>(bitmap.width()),
@@ -434,16 +502,13 @@ sk_sp<Bitmap> HardwareBitmapUploader::allocateHardwareBitmap(const SkBitmap& sou
     UniqueAHardwareBuffer ahb = allocateAHardwareBuffer(desc);
     if (!ahb) {
         ALOGW("allocateHardwareBitmap() failed in AHardwareBuffer_allocate()");
-        return nullptr;
+        return makeReadyFuture(nullptr);
     };
 
     createUploader(usingGL);
 
-    if (!sUploader->uploadHardwareBitmap(bitmap, format, ahb.get())) {
-        return nullptr;
-    }
-    return Bitmap::createFrom(ahb.get(), bitmap.colorType(), bitmap.refColorSpace(),
-                              bitmap.alphaType(), Bitmap::computePalette(bitmap));
+    return sUploader->uploadHardwareBitmap(PendingUpload{
+            .bitmap = std::move(bitmap), .format = format, .ahb = std::move(ahb)});
 }
 
 void HardwareBitmapUploader::initialize() {
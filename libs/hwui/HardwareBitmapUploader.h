@@ -19,6 +19,8 @@
 #include <hwui/Bitmap.h>
 #include <SkRefCnt.h>
 
+#include <future>
+
 class SkBitmap;
 
 namespace android::uirenderer {
@@ -30,6 +32,11 @@ public:
 
     static sk_sp<Bitmap> allocateHardwareBitmap(const SkBitmap& sourceBitmap);
 
+    // Same as allocateHardwareBitmap, but returns as soon as the upload is queued. Uploads queued
+    // while a previous one is in flight are submitted to the GPU together. The pixels of
+    // sourceBitmap must not change until the returned future is ready.
+    static std::future<sk_sp<Bitmap>> allocateHardwareBitmapAsync(const SkBitmap& sourceBitmap);
+
 #ifdef __ANDROID__
     static bool hasFP16Support();
     static bool has1010102Support();
@@ -183,11 +183,15 @@ void JankTracker::finishFrame(FrameInfo& frame, std::unique_ptr<FrameMetricsRepo
     }
     mData->reportFrame(totalDuration);
     (*mGlobalData)->reportFrame(totalDuration);
+    if (mFrameInfoRing) {
+        mFrameInfoRing->write(frame);
+    }
 
     // Only things like Surface.lockHardwareCanvas() are exempt from tracking
     if (CC_UNLIKELY(frame[FrameInfoIndex::Flags] & EXEMPT_FRAMES_FLAGS)) {
         return;
     }
+    mStageStats.reportFrame(frame);
 
     int64_t frameInterval = frame[FrameInfoIndex::FrameInterval];
 
@@ -248,6 +252,10 @@ void JankTracker::finishFrame(FrameInfo& frame, std::unique_ptr<FrameMetricsRepo
             for (size_t i = 0; i < static_cast<size_t>(FrameInfoIndex::NumIndexes); i++) {
                 ss << FrameInfoNames[i] << "=" << frame[i] << ", ";
             }
+            if (frame.functorSyncCount() > 0) {
+                ss << "FunctorSyncDuration=" << frame.functorSyncDuration()
+                   << " (" << frame.functorSyncCount() << " nodes), ";
+            }
             ALOGI("%s", ss.str().c_str());
             // Just so we have something that counts up, the value is largely irrelevant
             ATRACE_INT(ss.str().c_str(), ++sDaveyCount);
@@ -317,8 +325,17 @@ void JankTracker::dumpFrames(int fd) {
     dprintf(fd, "\n---PROFILEDATA---\n\n");
 }
 
+int JankTracker::getFrameInfoRingFd() {
+    std::lock_guard lock(mDataMutex);
+    if (!mFrameInfoRing) {
+        mFrameInfoRing = FrameInfoRing::create(mFrames.capacity());
+    }
+    return mFrameInfoRing ? mFrameInfoRing->fd() : -1;
+}
+
 void JankTracker::reset() REQUIRES(mDataMutex) {
     mFrames.clear();
+    mStageStats.reset();
     mData->reset();
     (*mGlobalData)->reset();
     sFrameStart = Properties::filterOutTestOverhead ? FrameInfoIndex::HandleInputStart
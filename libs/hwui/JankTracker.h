@@ -17,7 +17,9 @@
 #define JANKTRACKER_H_
 
 #include "FrameInfo.h"
+#include "FrameInfoRing.h"
 #include "FrameMetricsReporter.h"
+#include "FrameStageStats.h"
 #include "ProfileData.h"
 #include "ProfileDataContainer.h"
 #include "renderthread/TimeLord.h"
@@ -63,10 +65,20 @@ public:
     // Calculates the 'legacy' jank information, i.e. with outdated refresh rate information and
     // without GPU completion or deadlined information.
     void calculateLegacyJank(FrameInfo& frame);
-    void dumpStats(int fd) NO_THREAD_SAFETY_ANALYSIS { dumpData(fd, &mDescription, mData.get()); }
+    void dumpStats(int fd) NO_THREAD_SAFETY_ANALYSIS {
+        dumpData(fd, &mDescription, mData.get());
+        mStageStats.dump(fd);
+    }
     void dumpFrames(int fd);
     void reset();
 
+    // Returns the fd of the shared memory ring that finished frames are exported to, creating
+    // the ring on first use. The fd stays owned by the JankTracker, callers must dup() it to
+    // hand it out. Returns -1 if the ring could not be created.
+    int getFrameInfoRingFd();
+
+    const FrameStageStats& stageStats() NO_THREAD_SAFETY_ANALYSIS { return mStageStats; }
+
     // Exposed for FrameInfoVisualizer
     // TODO: Figure out a better way to handle this
     RingBuffer<FrameInfo, 120>& frames() { return mFrames; }
@@ -99,6 +111,10 @@ private:
     // Ring buffer large enough for 2 seconds worth of frames
     RingBuffer<FrameInfo, 120> mFrames;
 
+    FrameStageStats mStageStats GUARDED_BY(mDataMutex);
+    // Only created once a profiler asks for it, most windows are never observed.
+    std::unique_ptr<FrameInfoRing> mFrameInfoRing GUARDED_BY(mDataMutex);
+
     // Mutex to protect acccess to mData and mGlobalData obtained from mGlobalData->getDataMutex
     std::mutex& mDataMutex;
 };
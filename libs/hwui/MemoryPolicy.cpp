@@ -33,16 +33,24 @@ constexpr static MemoryPolicy sPersistentOrSystemPolicy{
 constexpr static MemoryPolicy sLowRamPolicy{
         .useAlternativeUiHidden = true,
         .purgeScratchOnly = false,
+        .animatedImageDecodeAheadFrames = 1,
+        .retainedLayerFrameThreshold = 0,
+        .bitmapPoolBytes = 2 * 1024 * 1024,
 };
 constexpr static MemoryPolicy sExtremeLowRam{
         .initialMaxSurfaceAreaScale = 0.2f,
         .surfaceSizeMultiplier = 5 * 4.0f,
         .backgroundRetentionPercent = 0.2f,
+        .warmRetentionPercent = 0.5f,
+        .hotTrimTimeout = 2_s,
         .contextTimeout = 5_s,
         .minimumResourceRetention = 1_s,
         .useAlternativeUiHidden = true,
         .purgeScratchOnly = false,
         .releaseContextOnStoppedOnly = true,
+        .animatedImageDecodeAheadFrames = 1,
+        .retainedLayerFrameThreshold = 0,
+        .bitmapPoolBytes = 0,
 };
 
 const MemoryPolicy& loadMemoryPolicy() {
@@ -18,6 +18,8 @@
 
 #include "utils/TimeUtils.h"
 
+#include <cstddef>
+
 namespace android::uirenderer {
 
 // Values mirror those from ComponentCallbacks2.java
@@ -47,6 +49,15 @@ struct MemoryPolicy {
     float surfaceSizeMultiplier = 12.0f * 4.0f;
     // How much of the foreground cache size should be preserved when going into the background
     float backgroundRetentionPercent = 0.5f;
+    // While frames are being drawn, the cache is continuously trimmed back to this fraction of
+    // the foreground cache size by purging the least recently used scratch resources. This keeps
+    // the cache from reaching its limit and then purging a large amount at once
+    float warmRetentionPercent = 0.75f;
+    // The size of the next frame is multiplied by this to estimate how many bytes of resources
+    // the frames being drawn right now need
+    float hotFrameSizeMultiplier = 4.0f * 4.0f;
+    // How long after the last frame the cache is trimmed down to what those frames need
+    nsecs_t hotTrimTimeout = 5_s;
     // How long after the last renderer goes away before the GPU context is released. A value
     // of 0 means only drop the context on background TRIM signals
     nsecs_t contextTimeout = 10_s;
@@ -62,6 +73,20 @@ struct MemoryPolicy {
     // EXPERIMENTAL: Whether or not to trigger releasing GPU context when all contexts are stopped
     // WARNING: Enabling this option can lead to instability, see b/266626090
     bool releaseContextOnStoppedOnly = false;
+    // How many frames an AnimatedImageDrawable decodes ahead of the one on screen. With more than
+    // one, a single frame that takes longer than a vsync to decode doesn't stall the animation
+    int animatedImageDecodeAheadFrames = 3;
+    // The most memory an AnimatedImageDrawable spends on frames decoded ahead. Large images
+    // decode fewer frames ahead, but always at least one
+    size_t animatedImageDecodeAheadBytes = 16 * 1024 * 1024;
+    // How many consecutive frames a RenderNode subtree has to be drawn without changing before
+    // it is automatically rendered into a layer that later frames reuse. 0 disables this
+    int retainedLayerFrameThreshold = 30;
+    // The most memory the layers of automatically retained subtrees may use
+    size_t retainedLayerBudgetBytes = 16 * 1024 * 1024;
+    // How much freed heap Bitmap memory is kept around for the next bitmaps to reuse. 0 disables
+    // the pool
+    size_t bitmapPoolBytes = 8 * 1024 * 1024;
 };
 
 const MemoryPolicy& loadMemoryPolicy();
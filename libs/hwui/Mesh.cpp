@@ -19,6 +19,8 @@
 #include <GLES/gl.h>
 #include <SkMesh.h>
 
+#include <algorithm>
+
 #include "SafeMath.h"
 
 static size_t min_vcount_for_mode(SkMesh::Mode mode) {
@@ -100,3 +102,72 @@ std::tuple<bool, SkString> Mesh::validate() {
 #undef FAIL_MESH_VALIDATE
     return {true, {}};
 }
+
+bool Mesh::updateVertexData(size_t offset, const void* data, size_t size) {
+    if (offset > mVertexBufferData.size() || size > mVertexBufferData.size() - offset) {
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+    memcpy(mVertexBufferData.data() + offset, data, size);
+    if (mVertexDirtyStart >= mVertexDirtyEnd) {
+        mVertexDirtyStart = offset;
+        mVertexDirtyEnd = offset + size;
+    } else {
+        mVertexDirtyStart = std::min(mVertexDirtyStart, offset);
+        mVertexDirtyEnd = std::max(mVertexDirtyEnd, offset + size);
+    }
+    mIsDirty = true;
+    return true;
+}
+
+void Mesh::updateSkMesh(GrDirectContext* context) const {
+    GrDirectContext::DirectContextID genId = GrDirectContext::DirectContextID();
+    if (context) {
+        genId = context->directContextID();
+    }
+    if (!mIsDirty && genId == mGenerationId) {
+        return;
+    }
+
+    const bool hasIndices = !mIndexBufferData.empty();
+    if (genId != mGenerationId || !mVertexBuffer || (hasIndices && !mIndexBuffer)) {
+        mVertexBuffer = nullptr;
+        mIndexBuffer = nullptr;
+    } else if (mVertexDirtyStart < mVertexDirtyEnd) {
+        // Buffer updates must be 4-byte aligned, which the vertex stride is.
+        const size_t start = mVertexDirtyStart & ~size_t(3);
+        const size_t end = std::min((mVertexDirtyEnd + 3) & ~size_t(3), mVertexBufferData.size());
+        if (!mVertexBuffer->update(context, mVertexBufferData.data() + start, start,
+                                   end - start)) {
+            mVertexBuffer = nullptr;
+        }
+    }
+    mVertexDirtyStart = mVertexDirtyEnd = 0;
+
+    if (!mVertexBuffer) {
+        mVertexBuffer = SkMesh::MakeVertexBuffer(
+                context, reinterpret_cast<const void*>(mVertexBufferData.data()),
+                mVertexBufferData.size());
+    }
+    if (hasIndices && !mIndexBuffer) {
+        mIndexBuffer = SkMesh::MakeIndexBuffer(
+                context, reinterpret_cast<const void*>(mIndexBufferData.data()),
+                mIndexBufferData.size());
+    }
+
+    auto meshMode = SkMesh::Mode(mMode);
+    if (hasIndices) {
+        mMesh = SkMesh::MakeIndexed(mMeshSpec, meshMode, mVertexBuffer, mVertexCount,
+                                    mVertexOffset, mIndexBuffer, mIndexCount, mIndexOffset,
+                                    mBuilder->fUniforms, mBounds)
+                        .mesh;
+    } else {
+        mMesh = SkMesh::Make(mMeshSpec, meshMode, mVertexBuffer, mVertexCount, mVertexOffset,
+                             mBuilder->fUniforms, mBounds)
+                        .mesh;
+    }
+    mIsDirty = false;
+    mGenerationId = genId;
+}
@@ -136,34 +136,10 @@ public:
 
     [[nodiscard]] std::tuple<bool, SkString> validate();
 
-    void updateSkMesh(GrDirectContext* context) const {
-        GrDirectContext::DirectContextID genId = GrDirectContext::DirectContextID();
-        if (context) {
-            genId = context->directContextID();
-        }
-
-        if (mIsDirty || genId != mGenerationId) {
-            auto vb = SkMesh::MakeVertexBuffer(
-                    context, reinterpret_cast<const void*>(mVertexBufferData.data()),
-                    mVertexBufferData.size());
-            auto meshMode = SkMesh::Mode(mMode);
-            if (!mIndexBufferData.empty()) {
-                auto ib = SkMesh::MakeIndexBuffer(
-                        context, reinterpret_cast<const void*>(mIndexBufferData.data()),
-                        mIndexBufferData.size());
-                mMesh = SkMesh::MakeIndexed(mMeshSpec, meshMode, vb, mVertexCount, mVertexOffset,
-                                            ib, mIndexCount, mIndexOffset, mBuilder->fUniforms,
-                                            mBounds)
-                                .mesh;
-            } else {
-                mMesh = SkMesh::Make(mMeshSpec, meshMode, vb, mVertexCount, mVertexOffset,
-                                     mBuilder->fUniforms, mBounds)
-                                .mesh;
-            }
-            mIsDirty = false;
-            mGenerationId = genId;
-        }
-    }
+    // Uploads what changed since the last call and rebuilds the SkMesh if needed. Buffers are
+    // only created again for a new context; vertex data changes are uploaded as a range, and
+    // uniform changes reuse the buffers as they are.
+    void updateSkMesh(GrDirectContext* context) const;
 
     SkMesh& getSkMesh() const {
         LOG_FATAL_IF(mIsDirty,
@@ -175,6 +151,11 @@ public:
 
     void markDirty() { mIsDirty = true; }
 
+    // Replaces |size| bytes of the vertex data at |offset|. Returns false, changing nothing, if
+    // the range is outside of the vertex buffer. The GPU copy is updated by the next
+    // updateSkMesh(), with only the bytes changed since the previous one.
+    bool updateVertexData(size_t offset, const void* data, size_t size);
+
     MeshUniformBuilder* uniformBuilder() { return mBuilder.get(); }
 
 private:
@@ -194,6 +175,11 @@ private:
 
     mutable SkMesh mMesh{};
     mutable bool mIsDirty = true;
+    mutable sk_sp<SkMesh::VertexBuffer> mVertexBuffer;
+    mutable sk_sp<SkMesh::IndexBuffer> mIndexBuffer;
+    // The range of mVertexBufferData changed since it was last uploaded, empty if start >= end.
+    mutable size_t mVertexDirtyStart = 0;
+    mutable size_t mVertexDirtyEnd = 0;
     mutable GrDirectContext::DirectContextID mGenerationId = GrDirectContext::DirectContextID();
 };
 #endif  // MESH_H_
@@ -19,25 +19,35 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <utils/Log.h>
+
+#include <array>
+#include <list>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
 namespace uirenderer {
 
+// Whether a character starts a new command. Note that 'e' or 'E' are not valid path commands,
+// but could be used for floating point numbers' scientific notation. Therefore, when searching
+// for next command, we should ignore 'e' and 'E'.
+static constexpr std::array<bool, 256> sIsCommandStart = [] {
+    std::array<bool, 256> table{};
+    for (int c = 'A'; c <= 'Z'; c++) {
+        table[c] = true;
+        table[c - 'A' + 'a'] = true;
+    }
+    table['e'] = table['E'] = false;
+    return table;
+}();
+
 static size_t nextStart(const char* s, size_t length, size_t startIndex) {
     size_t index = startIndex;
-    while (index < length) {
-        char c = s[index];
-        // Note that 'e' or 'E' are not valid path commands, but could be
-        // used for floating point numbers' scientific notation.
-        // Therefore, when searching for next command, we should ignore 'e'
-        // and 'E'.
-        if ((((c - 'A') * (c - 'Z') <= 0) || ((c - 'a') * (c - 'z') <= 0)) && c != 'e' &&
-            c != 'E') {
-            return index;
-        }
+    while (index < length && !sIsCommandStart[static_cast<uint8_t>(s[index])]) {
         index++;
     }
     return index;
@@ -97,6 +107,65 @@ static void extract(int* outEndPosition, bool* outEndWithNegOrDot, const char* s
     *outEndPosition = currentIndex;
 }
 
+// Powers of ten that are exactly representable as floats.
+static constexpr float kExactPowersOfTen[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                              1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+/**
+ * Parses the number in [s, end) without going through strtof, if it is a plain decimal
+ * number whose value can be computed with a single correctly rounded float operation: a
+ * mantissa below 2^24 and a power of ten of at most 10^10 are both exact, so the quotient or
+ * product is the same float strtof would return. This covers nearly every number in path data.
+ * Returns false if the number needs strtof.
+ */
+static bool parseFloatFast(const char* s, const char* end, float* outValue) {
+    const char* p = s;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    uint32_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa >= (1 << 24)) return false;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa >= (1 << 24)) return false;
+            exponent--;
+        }
+    }
+    if (digits == 0) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        if (p == end) return false;
+        int explicitExponent = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            explicitExponent = explicitExponent * 10 + (*p - '0');
+            if (explicitExponent > 100) return false;
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    // Anything left over, such as a hex prefix, is for strtof to interpret.
+    if (p != end || (end[0] | 0x20) == 'x') return false;
+    if (exponent < -10 || exponent > 10) return false;
+
+    float value = static_cast<float>(mantissa);
+    value = exponent < 0 ? value / kExactPowersOfTen[-exponent]
+                         : value * kExactPowersOfTen[exponent];
+    *outValue = negative ? -value : value;
+    return true;
+}
+
 static float parseFloat(PathParser::ParseResult* result, const char* startPtr,
                         size_t expectedLength) {
     char* endPtr = NULL;
@@ -115,6 +184,17 @@ static float parseFloat(PathParser::ParseResult* result, const char* startPtr,
     return currentValue;
 }
 
+// Parses the number token in [startPtr, endPtr), falling back to strtof for anything that isn't
+// a plain decimal number.
+static float parseNumber(PathParser::ParseResult* result, const char* startPtr,
+                         const char* endPtr, size_t expectedLength) {
+    float value;
+    if (parseFloatFast(startPtr, endPtr, &value)) {
+        return value;
+    }
+    return parseFloat(result, startPtr, expectedLength);
+}
+
 /**
  * Parse the floats in the string.
  *
@@ -137,7 +217,8 @@ static void getFloats(std::vector<float>* outPoints, PathParser::ParseResult* re
         extract(&endPosition, &endWithNegOrDot, pathStr, startPosition, end);
 
         if (startPosition < endPosition) {
-            float currentValue = parseFloat(result, &pathStr[startPosition], end - startPosition);
+            float currentValue = parseNumber(result, &pathStr[startPosition],
+                                             &pathStr[endPosition], end - startPosition);
             if (result->failureOccurred) {
                 return;
             }
@@ -212,8 +293,114 @@ void PathParser::validateVerbAndPoints(char verb, size_t points, PathParser::Par
                               std::to_string(points) + " float(s) are found. ";
 }
 
+namespace {
+
+void appendPathData(PathData* outData, const PathData& data) {
+    outData->verbs.insert(outData->verbs.end(), data.verbs.begin(), data.verbs.end());
+    outData->verbSizes.insert(outData->verbSizes.end(), data.verbSizes.begin(),
+                              data.verbSizes.end());
+    outData->points.insert(outData->points.end(), data.points.begin(), data.points.end());
+}
+
+// Bounded cache of successfully parsed path strings. VectorDrawables inflated from the same
+// resource, e.g. an icon in every row of a list, hand the same pathData strings to the parser
+// over and over again.
+class PathDataCache {
+public:
+    static PathDataCache& get() {
+        static PathDataCache* sCache = new PathDataCache();
+        return *sCache;
+    }
+
+    bool find(std::string_view path, PathData* outData) {
+        std::lock_guard lock(mLock);
+        auto it = mIndex.find(path);
+        if (it == mIndex.end()) {
+            return false;
+        }
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        appendPathData(outData, it->second->data);
+        return true;
+    }
+
+    void insert(std::string_view path, const PathData& data) {
+        size_t bytes = path.size() + data.verbs.size() + data.verbSizes.size() * sizeof(size_t) +
+                       data.points.size() * sizeof(float);
+        if (bytes > kMaxBytes / 8) {
+            return;
+        }
+        std::lock_guard lock(mLock);
+        if (mIndex.count(path)) {
+            return;
+        }
+        while (!mEntries.empty() && mBytes + bytes > kMaxBytes) {
+            mBytes -= mEntries.back().bytes;
+            mIndex.erase(mEntries.back().path);
+            mEntries.pop_back();
+        }
+        mEntries.push_front(Entry{std::string(path), data, bytes});
+        // The key views the string owned by the entry, which doesn't move within the list.
+        mIndex.emplace(mEntries.front().path, mEntries.begin());
+        mBytes += bytes;
+    }
+
+    void clear() {
+        std::lock_guard lock(mLock);
+        mIndex.clear();
+        mEntries.clear();
+        mBytes = 0;
+    }
+
+private:
+    static constexpr size_t kMaxBytes = 256 * 1024;
+
+    struct Entry {
+        std::string path;
+        PathData data;
+        size_t bytes;
+    };
+
+    std::mutex mLock;
+    // Most recently used first.
+    std::list<Entry> mEntries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> mIndex;
+    size_t mBytes = 0;
+};
+
+// Parsing short strings is cheaper than hashing them and taking the lock.
+constexpr size_t kMinCachedPathLength = 32;
+
+}  // namespace
+
 void PathParser::getPathDataFromAsciiString(PathData* data, ParseResult* result,
                                             const char* pathStr, size_t strLen) {
+    if (pathStr == NULL || strLen < kMinCachedPathLength) {
+        parsePathData(data, result, pathStr, strLen);
+        return;
+    }
+    std::string_view path(pathStr, strLen);
+    if (PathDataCache::get().find(path, data)) {
+        return;
+    }
+    PathData parsed;
+    parsePathData(&parsed, result, pathStr, strLen);
+    if (!result->failureOccurred) {
+        PathDataCache::get().insert(path, parsed);
+    }
+    // Like parsePathData, append to what the caller already has, even if parsing failed.
+    if (data->verbs.empty() && data->points.empty()) {
+        *data = std::move(parsed);
+    } else {
+        appendPathData(data, parsed);
+    }
+}
+
+void PathParser::clearPathDataCache() {
+    PathDataCache::get().clear();
+}
+
+void PathParser::parsePathData(PathData* data, ParseResult* result, const char* pathStr,
+                               size_t strLen) {
     if (pathStr == NULL) {
         result->failureOccurred = true;
         result->failureMessage = "Path string cannot be NULL.";
@@ -232,9 +419,11 @@ void PathParser::getPathDataFromAsciiString(PathData* data, ParseResult* result,
     }
     size_t end = start + 1;
 
+    // Reused for every command to avoid an allocation per verb.
+    std::vector<float> points;
     while (end < strLen) {
         end = nextStart(pathStr, strLen, end);
-        std::vector<float> points;
+        points.clear();
         getFloats(&points, result, pathStr, start, end);
         validateVerbAndPoints(pathStr[start], points.size(), result);
         if (result->failureOccurred) {
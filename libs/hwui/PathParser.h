@@ -39,8 +39,19 @@ public:
      */
     static void parseAsciiStringForSkPath(SkPath* outPath, ParseResult* result,
                                           const char* pathStr, size_t strLength);
+    /**
+     * Parse the string literal into path data, appending to outData. Results for long strings
+     * are kept in a bounded process-wide cache, since the same pathData is typically parsed for
+     * every inflation of a VectorDrawable.
+     */
     static void getPathDataFromAsciiString(PathData* outData, ParseResult* result,
                                            const char* pathStr, size_t strLength);
+    /**
+     * Same as getPathDataFromAsciiString, but always parses the string.
+     */
+    static void parsePathData(PathData* outData, ParseResult* result, const char* pathStr,
+                              size_t strLength);
+    static void clearPathDataCache();
     static void dump(const PathData& data);
     static void validateVerbAndPoints(char verb, size_t points, ParseResult* result);
 };
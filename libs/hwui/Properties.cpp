@@ -83,6 +83,11 @@ float Properties::defaultSdrWhitePoint = 200.f;
 
 bool Properties::useHintManager = false;
 int Properties::targetCpuTimePercentage = 70;
+bool Properties::usePredictiveHints = false;
+
+bool Properties::batchShadows = true;
+bool Properties::tiledRegionDecode = true;
+bool Properties::compactDisplayLists = true;
 
 bool Properties::enableWebViewOverlays = true;
 
@@ -148,6 +153,11 @@ bool Properties::load() {
     useHintManager = base::GetBoolProperty(PROPERTY_USE_HINT_MANAGER, false);
     targetCpuTimePercentage = base::GetIntProperty(PROPERTY_TARGET_CPU_TIME_PERCENTAGE, 70);
     if (targetCpuTimePercentage <= 0 || targetCpuTimePercentage > 100) targetCpuTimePercentage = 70;
+    usePredictiveHints = base::GetBoolProperty(PROPERTY_PREDICTIVE_HINTS, false);
+
+    batchShadows = base::GetBoolProperty(PROPERTY_BATCH_SHADOWS, true);
+    tiledRegionDecode = base::GetBoolProperty(PROPERTY_TILED_REGION_DECODE, true);
+    compactDisplayLists = base::GetBoolProperty(PROPERTY_COMPACT_DISPLAY_LISTS, true);
 
     enableWebViewOverlays = base::GetBoolProperty(PROPERTY_WEBVIEW_OVERLAYS_ENABLED, true);
 
@@ -194,6 +194,14 @@ enum DebugLevel {
  */
 #define PROPERTY_TARGET_CPU_TIME_PERCENTAGE "debug.hwui.target_cpu_time_percent"
 
+/**
+ * Controls whether HWUI predicts expensive frames from the recent frame history and
+ * animation state, and sends a load-up hint to HintManager before drawing them instead of
+ * only reporting them once they are done. Requires use_hint_manager. Accepted values are
+ * "true" and "false".
+ */
+#define PROPERTY_PREDICTIVE_HINTS "debug.hwui.predictive_hints"
+
 /**
  * Property for whether this is running in the emulator.
  */
@@ -218,6 +226,24 @@ enum DebugLevel {
 
 #define PROPERTY_MEMORY_POLICY "debug.hwui.app_memory_policy"
 
+/**
+ * Controls whether the shadows of casters at similar Z are drawn grouped by outline and
+ * elevation rather than in child order. Accepted values are "true" and "false", default "true".
+ */
+#define PROPERTY_BATCH_SHADOWS "debug.hwui.batch_shadows"
+
+/**
+ * Controls whether BitmapRegionDecoder splits large regions into bands that are decoded in
+ * parallel. Accepted values are "true" and "false", default "true".
+ */
+#define PROPERTY_TILED_REGION_DECODE "debug.hwui.tiled_region_decode"
+
+/**
+ * Controls whether finished display lists are compacted, dropping the ops that can't change what
+ * is drawn. Accepted values are "true" and "false", default "true".
+ */
+#define PROPERTY_COMPACT_DISPLAY_LISTS "debug.hwui.compact_display_lists"
+
 #define PROPERTY_8BIT_HDR_HEADROOM "debug.hwui.8bit_hdr_headroom"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -316,6 +342,11 @@ public:
 
     static bool useHintManager;
     static int targetCpuTimePercentage;
+    static bool usePredictiveHints;
+
+    static bool batchShadows;
+    static bool tiledRegionDecode;
+    static bool compactDisplayLists;
 
     static bool enableWebViewOverlays;
 
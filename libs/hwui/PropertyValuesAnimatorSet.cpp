@@ -29,6 +29,8 @@ void PropertyValuesAnimatorSet::addPropertyAnimator(PropertyValuesHolder* proper
     PropertyAnimator* animator = new PropertyAnimator(
             propertyValuesHolder, interpolator, startDelay, duration, repeatCount, repeatMode);
     mAnimators.emplace_back(animator);
+    mEndedAnimatorCount = 0;
+    mEndedAnimatorsEnd = 0;
 
     // Check whether any child animator is infinite after adding it them to the set.
     if (repeatCount == -1) {
@@ -76,9 +78,25 @@ void PropertyValuesAnimatorSet::onPlayTimeChanged(nsecs_t playTime) {
             // have the final say on what the property value should be.
             (*it)->setFraction(0, 0);
         }
+        mEndedAnimatorCount = 0;
+        mEndedAnimatorsEnd = 0;
     } else {
-        for (auto& anim : mAnimators) {
-            anim->setCurrentPlayTime(playTime);
+        // Animators that ended before the play time would only return early, which adds up for
+        // sets of many short animators. Seeking back before any of their ends re-evaluates them.
+        if (playTime < mEndedAnimatorsEnd) {
+            mEndedAnimatorCount = 0;
+            mEndedAnimatorsEnd = 0;
+        }
+        for (size_t i = mEndedAnimatorCount; i < mAnimators.size(); i++) {
+            mAnimators[i]->setCurrentPlayTime(playTime);
+        }
+        while (mEndedAnimatorCount < mAnimators.size()) {
+            PropertyAnimator& animator = *mAnimators[mEndedAnimatorCount];
+            if (playTime < animator.getTotalDuration() || !animator.hasSetEndValue()) {
+                break;
+            }
+            mEndedAnimatorsEnd = std::max(mEndedAnimatorsEnd, animator.getTotalDuration());
+            mEndedAnimatorCount++;
         }
     }
 }
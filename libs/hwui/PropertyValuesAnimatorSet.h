@@ -29,6 +29,8 @@ public:
                      nsecs_t duration, int repeatCount, RepeatMode repeatMode);
     void setCurrentPlayTime(nsecs_t playTime);
     nsecs_t getTotalDuration() { return mTotalDuration; }
+    // Whether the end value was set, after which play times past the end change nothing.
+    bool hasSetEndValue() const { return mLatestFraction == mRepeatCount + 1.0; }
     // fraction range: [0, 1], iteration range [0, repeatCount]
     void setFraction(float fraction, long iteration);
 
@@ -76,6 +78,11 @@ private:
     // Listener set from outside
     sp<AnimationListener> mOneShotListener;
     std::vector<std::unique_ptr<PropertyAnimator> > mAnimators;
+    // The leading animators of mAnimators, which init() sorts by total duration, that have set
+    // their end values and are skipped until the play time goes back before the latest of their
+    // ends.
+    size_t mEndedAnimatorCount = 0;
+    nsecs_t mEndedAnimatorsEnd = 0;
     float mLastFraction = 0.0f;
     bool mInitialized = false;
     sp<VectorDrawableRoot> mVectorDrawable;
@@ -24,6 +24,7 @@
 #include <SkImageInfo.h>
 #include <SkMatrix.h>
 #include <SkPaint.h>
+#include <SkPixmap.h>
 #include <SkRect.h>
 #include <SkRefCnt.h>
 #include <SkSamplingOptions.h>
@@ -53,8 +54,41 @@ namespace uirenderer {
 
 #define ARECT_ARGS(r) float((r).left), float((r).top), float((r).right), float((r).bottom)
 
-void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<CopyRequest>& request) {
-    ATRACE_CALL();
+// The most recently queued buffer of a window, and how to map it to what the window shows.
+struct Readback::SurfaceSource {
+    sk_sp<SkImage> image;
+    // The part of the buffer to sample, after applying the buffer's crop.
+    SkRect imageSrcRect;
+    // Where imageSrcRect lands before the window transform is applied.
+    SkRect imageDstRect;
+    // The "logical" size of the buffer, after the crop and window transform.
+    SkRect textureRect;
+    // Applies the window transform to imageDstRect.
+    SkMatrix transform;
+    bool hasBufferCrop = false;
+};
+
+// Returns a GPU surface to render a copy into before reading it back into a bitmap of the given
+// info, or nullptr if there is no way to render in a format compatible with it.
+static sk_sp<SkSurface> makeReadbackSurface(GrDirectContext* grContext, const SkImageInfo& info) {
+    sk_sp<SkSurface> tmpSurface = SkSurface::MakeRenderTarget(
+            grContext, skgpu::Budgeted::kYes, info, 0, kTopLeft_GrSurfaceOrigin, nullptr);
+
+    // if we can't generate a GPU surface that matches the destination bitmap (e.g. 565) then we
+    // attempt to do the intermediate rendering step in 8888
+    if (!tmpSurface.get()) {
+        SkImageInfo tmpInfo = info.makeColorType(SkColorType::kN32_SkColorType);
+        tmpSurface = SkSurface::MakeRenderTarget(grContext, skgpu::Budgeted::kYes, tmpInfo, 0,
+                                                 kTopLeft_GrSurfaceOrigin, nullptr);
+        if (!tmpSurface.get()) {
+            ALOGW("Unable to generate GPU buffer in a format compatible with the provided bitmap");
+        }
+    }
+    return tmpSurface;
+}
+
+CopyResult Readback::acquireSurfaceSource(ANativeWindow* window, bool waitOnGpu,
+                                          SurfaceSource* outSource) {
     // Setup the source
     AHardwareBuffer* rawSourceBuffer;
     int rawSourceFence;
@@ -66,32 +100,32 @@ void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<Copy
     // Really this shouldn't ever happen, but better safe than sorry.
     if (err == UNKNOWN_TRANSACTION) {
         ALOGW("Readback failed to ANativeWindow_getLastQueuedBuffer2 - who are we talking to?");
-        return request->onCopyFinished(CopyResult::SourceInvalid);
+        return CopyResult::SourceInvalid;
     }
     ALOGV("Using new path, cropRect=" RECT_STRING ", transform=%x", ARECT_ARGS(cropRect),
           windowTransform);
 
     if (err != NO_ERROR) {
         ALOGW("Failed to get last queued buffer, error = %d", err);
-        return request->onCopyFinished(CopyResult::SourceInvalid);
+        return CopyResult::SourceInvalid;
     }
     if (rawSourceBuffer == nullptr) {
         ALOGW("Surface doesn't have any previously queued frames, nothing to readback from");
-        return request->onCopyFinished(CopyResult::SourceEmpty);
+        return CopyResult::SourceEmpty;
     }
     UniqueAHardwareBuffer sourceBuffer{rawSourceBuffer};
     AHardwareBuffer_Desc description;
     AHardwareBuffer_describe(sourceBuffer.get(), &description);
     if (description.usage & AHARDWAREBUFFER_USAGE_PROTECTED_CONTENT) {
         ALOGW("Surface is protected, unable to copy from it");
-        return request->onCopyFinished(CopyResult::SourceInvalid);
+        return CopyResult::SourceInvalid;
     }
 
-    {
+    if (!waitOnGpu) {
         ATRACE_NAME("sync_wait");
         if (sourceFence != -1 && sync_wait(sourceFence.get(), 500 /* ms */) != NO_ERROR) {
             ALOGE("Timeout (500ms) exceeded waiting for buffer fence, abandoning readback attempt");
-            return request->onCopyFinished(CopyResult::Timeout);
+            return CopyResult::Timeout;
         }
     }
 
@@ -111,12 +145,23 @@ void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<Copy
             SkImage::MakeFromAHardwareBuffer(sourceBuffer.get(), kPremul_SkAlphaType, colorSpace);
 
     if (!image.get()) {
-        return request->onCopyFinished(CopyResult::UnknownError);
+        return CopyResult::UnknownError;
     }
 
     sk_sp<GrDirectContext> grContext = mRenderThread.requireGrContext();
 
-    SkRect srcRect = request->srcRect.toSkRect();
+    if (waitOnGpu && sourceFence != -1) {
+        // Make the GPU work that samples from the buffer wait for the producer instead of
+        // blocking the RenderThread on the fence.
+        if (Properties::getRenderPipelineType() == RenderPipelineType::SkiaGL) {
+            err = mRenderThread.eglManager().fenceWait(sourceFence.get());
+        } else {
+            err = mRenderThread.vulkanManager().fenceWait(sourceFence.get(), grContext.get());
+        }
+        if (err != NO_ERROR) {
+            return CopyResult::UnknownError;
+        }
+    }
 
     SkRect imageSrcRect = SkRect::MakeIWH(description.width, description.height);
     SkISize imageWH = SkISize::Make(description.width, description.height);
@@ -158,35 +203,6 @@ void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<Copy
                     ? SkRect::MakeIWH(imageSrcRect.height(), imageSrcRect.width())
                     : SkRect::MakeIWH(imageSrcRect.width(), imageSrcRect.height());
 
-    if (srcRect.isEmpty()) {
-        srcRect = textureRect;
-    } else {
-        ALOGV("intersecting " RECT_STRING " with " RECT_STRING, SK_RECT_ARGS(srcRect),
-              SK_RECT_ARGS(textureRect));
-        if (!srcRect.intersect(textureRect)) {
-            return request->onCopyFinished(CopyResult::UnknownError);
-        }
-    }
-
-    SkBitmap skBitmap = request->getDestinationBitmap(srcRect.width(), srcRect.height());
-    SkBitmap* bitmap = &skBitmap;
-    sk_sp<SkSurface> tmpSurface =
-            SkSurface::MakeRenderTarget(mRenderThread.getGrContext(), skgpu::Budgeted::kYes,
-                                        bitmap->info(), 0, kTopLeft_GrSurfaceOrigin, nullptr);
-
-    // if we can't generate a GPU surface that matches the destination bitmap (e.g. 565) then we
-    // attempt to do the intermediate rendering step in 8888
-    if (!tmpSurface.get()) {
-        SkImageInfo tmpInfo = bitmap->info().makeColorType(SkColorType::kN32_SkColorType);
-        tmpSurface = SkSurface::MakeRenderTarget(mRenderThread.getGrContext(),
-                                                 skgpu::Budgeted::kYes,
-                                                 tmpInfo, 0, kTopLeft_GrSurfaceOrigin, nullptr);
-        if (!tmpSurface.get()) {
-            ALOGW("Unable to generate GPU buffer in a format compatible with the provided bitmap");
-            return request->onCopyFinished(CopyResult::UnknownError);
-        }
-    }
-
     /*
      * The grand ordering of events.
      * First we apply the buffer's crop, done by using a srcRect of the crop with a dstRect of the
@@ -199,7 +215,7 @@ void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<Copy
      * as per GLConsumer::computeTransformMatrix
      *
      * Third we apply the user's supplied cropping & scale to the output by doing a RectToRect
-     * matrix transform from srcRect to {0,0, bitmapWidth, bitmapHeight}
+     * matrix transform from srcRect to {0,0, bitmapWidth, bitmapHeight}, see drawSurfaceSource.
      *
      * Finally we're done messing with this bloody thing for hopefully the last time.
      *
@@ -223,31 +239,73 @@ void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<Copy
         m.postTranslate(imageDstRect.height(), 0);
     }
 
+    outSource->image = std::move(image);
+    outSource->imageSrcRect = imageSrcRect;
+    outSource->imageDstRect = imageDstRect;
+    outSource->textureRect = textureRect;
+    outSource->transform = m;
+    outSource->hasBufferCrop = cropRect.left < cropRect.right && cropRect.top < cropRect.bottom;
+    return CopyResult::Success;
+}
+
+void Readback::drawSurfaceSource(const SurfaceSource& source, const SkRect& srcRect,
+                                 SkCanvas* canvas) {
+    const int width = canvas->imageInfo().width();
+    const int height = canvas->imageInfo().height();
+    SkMatrix m = source.transform;
     SkSamplingOptions sampling(SkFilterMode::kNearest);
     ALOGV("Mapping from " RECT_STRING " to " RECT_STRING, SK_RECT_ARGS(srcRect),
-          SK_RECT_ARGS(SkRect::MakeWH(bitmap->width(), bitmap->height())));
-    m.postConcat(SkMatrix::MakeRectToRect(srcRect,
-                                          SkRect::MakeWH(bitmap->width(), bitmap->height()),
+          SK_RECT_ARGS(SkRect::MakeWH(width, height)));
+    m.postConcat(SkMatrix::MakeRectToRect(srcRect, SkRect::MakeWH(width, height),
                                           SkMatrix::kFill_ScaleToFit));
-    if (srcRect.width() != bitmap->width() || srcRect.height() != bitmap->height()) {
+    if (srcRect.width() != width || srcRect.height() != height) {
         sampling = SkSamplingOptions(SkFilterMode::kLinear);
     }
 
-    SkCanvas* canvas = tmpSurface->getCanvas();
     canvas->save();
     canvas->concat(m);
     SkPaint paint;
     paint.setAlpha(255);
     paint.setBlendMode(SkBlendMode::kSrc);
-    const bool hasBufferCrop = cropRect.left < cropRect.right && cropRect.top < cropRect.bottom;
-    auto constraint =
-            hasBufferCrop ? SkCanvas::kStrict_SrcRectConstraint : SkCanvas::kFast_SrcRectConstraint;
+    auto constraint = source.hasBufferCrop ? SkCanvas::kStrict_SrcRectConstraint
+                                           : SkCanvas::kFast_SrcRectConstraint;
 
     static constexpr float kMaxLuminanceNits = 4000.f;
-    tonemapPaint(image->imageInfo(), canvas->imageInfo(), kMaxLuminanceNits, paint);
+    tonemapPaint(source.image->imageInfo(), canvas->imageInfo(), kMaxLuminanceNits, paint);
 
-    canvas->drawImageRect(image, imageSrcRect, imageDstRect, sampling, &paint, constraint);
+    canvas->drawImageRect(source.image, source.imageSrcRect, source.imageDstRect, sampling, &paint,
+                          constraint);
     canvas->restore();
+}
+
+void Readback::copySurfaceInto(ANativeWindow* window, const std::shared_ptr<CopyRequest>& request) {
+    ATRACE_CALL();
+    SurfaceSource source;
+    CopyResult result = acquireSurfaceSource(window, false /* waitOnGpu */, &source);
+    if (result != CopyResult::Success) {
+        return request->onCopyFinished(result);
+    }
+
+    SkRect srcRect = request->srcRect.toSkRect();
+    if (srcRect.isEmpty()) {
+        srcRect = source.textureRect;
+    } else {
+        ALOGV("intersecting " RECT_STRING " with " RECT_STRING, SK_RECT_ARGS(srcRect),
+              SK_RECT_ARGS(source.textureRect));
+        if (!srcRect.intersect(source.textureRect)) {
+            return request->onCopyFinished(CopyResult::UnknownError);
+        }
+    }
+
+    SkBitmap skBitmap = request->getDestinationBitmap(srcRect.width(), srcRect.height());
+    SkBitmap* bitmap = &skBitmap;
+    sk_sp<SkSurface> tmpSurface =
+            makeReadbackSurface(mRenderThread.getGrContext(), bitmap->info());
+    if (!tmpSurface.get()) {
+        return request->onCopyFinished(CopyResult::UnknownError);
+    }
+
+    drawSurfaceSource(source, srcRect, tmpSurface->getCanvas());
 
     if (!tmpSurface->readPixels(*bitmap, 0, 0)) {
         // if we fail to readback from the GPU directly (e.g. 565) then we attempt to read into
@@ -346,23 +404,10 @@ bool Readback::copyLayerInto(Layer* layer, const SkRect* srcRect, const SkRect*
      * a scaling issue (b/62262733) that was encountered when sampling from an EGLImage into a
      * software buffer.
      */
-    sk_sp<SkSurface> tmpSurface = SkSurface::MakeRenderTarget(mRenderThread.getGrContext(),
-                                                              skgpu::Budgeted::kYes,
-                                                              bitmap->info(),
-                                                              0,
-                                                              kTopLeft_GrSurfaceOrigin, nullptr);
-
-    // if we can't generate a GPU surface that matches the destination bitmap (e.g. 565) then we
-    // attempt to do the intermediate rendering step in 8888
+    sk_sp<SkSurface> tmpSurface =
+            makeReadbackSurface(mRenderThread.getGrContext(), bitmap->info());
     if (!tmpSurface.get()) {
-        SkImageInfo tmpInfo = bitmap->info().makeColorType(SkColorType::kN32_SkColorType);
-        tmpSurface = SkSurface::MakeRenderTarget(mRenderThread.getGrContext(),
-                                                 skgpu::Budgeted::kYes,
-                                                 tmpInfo, 0, kTopLeft_GrSurfaceOrigin, nullptr);
-        if (!tmpSurface.get()) {
-            ALOGW("Unable to generate GPU buffer in a format compatible with the provided bitmap");
-            return false;
-        }
+        return false;
     }
 
     if (!skiapipeline::LayerDrawable::DrawLayer(mRenderThread.getGrContext(),
@@ -391,5 +436,153 @@ bool Readback::copyLayerInto(Layer* layer, const SkRect* srcRect, const SkRect*
     return true;
 }
 
+// The regions of one MultiRegionCopyRequest that are still being read back. Only used on the
+// RenderThread.
+struct Readback::AsyncCopy {
+    explicit AsyncCopy(const std::shared_ptr<MultiRegionCopyRequest>& request)
+            : request(request), pendingRegions(request->srcRects.size()) {}
+
+    void finishRegion(CopyResult regionResult) {
+        if (result == CopyResult::Success) {
+            result = regionResult;
+        }
+        if (--pendingRegions == 0) {
+            request->onCopyFinished(result);
+        }
+    }
+
+    std::shared_ptr<MultiRegionCopyRequest> request;
+    size_t pendingRegions;
+    CopyResult result = CopyResult::Success;
+};
+
+struct Readback::AsyncRegion {
+    Readback* readback;
+    std::shared_ptr<AsyncCopy> copy;
+    SkBitmap bitmap;
+};
+
+void Readback::copySurfaceIntoAsync(ANativeWindow* window,
+                                    const std::shared_ptr<MultiRegionCopyRequest>& request) {
+    ATRACE_CALL();
+    SurfaceSource source;
+    CopyResult result = acquireSurfaceSource(window, true /* waitOnGpu */, &source);
+    if (result != CopyResult::Success) {
+        return request->onCopyFinished(result);
+    }
+    issueAsyncCopies(request, source.textureRect,
+                     [this, &source](const SkRect& srcRect, SkCanvas* canvas) {
+                         drawSurfaceSource(source, srcRect, canvas);
+                         return true;
+                     });
+}
+
+void Readback::copyLayerIntoAsync(DeferredLayerUpdater* deferredLayer,
+                                  const std::shared_ptr<MultiRegionCopyRequest>& request) {
+    ATRACE_CALL();
+    if (!mRenderThread.getGrContext()) {
+        return request->onCopyFinished(CopyResult::UnknownError);
+    }
+
+    // acquire most recent buffer for drawing
+    deferredLayer->updateTexImage();
+    deferredLayer->apply();
+    Layer* layer = deferredLayer->backingLayer();
+    if (!layer) {
+        return request->onCopyFinished(CopyResult::SourceEmpty);
+    }
+    issueAsyncCopies(request, SkRect::MakeIWH(layer->getWidth(), layer->getHeight()),
+                     [this, layer](const SkRect& srcRect, SkCanvas* canvas) {
+                         const SkRect dstRect = SkRect::Make(canvas->imageInfo().bounds());
+                         return skiapipeline::LayerDrawable::DrawLayer(
+                                 mRenderThread.getGrContext(), canvas, layer, &srcRect, &dstRect,
+                                 false);
+                     });
+}
+
+void Readback::issueAsyncCopies(const std::shared_ptr<MultiRegionCopyRequest>& request,
+                                const SkRect& sourceBounds, const DrawRegionFunction& drawRegion) {
+    if (request->srcRects.empty()) {
+        return request->onCopyFinished(CopyResult::Success);
+    }
+    GrDirectContext* grContext = mRenderThread.getGrContext();
+    auto copy = std::make_shared<AsyncCopy>(request);
+    bool issuedReadback = false;
+    for (size_t i = 0; i < request->srcRects.size(); i++) {
+        SkRect srcRect = request->srcRects[i].toSkRect();
+        if (srcRect.isEmpty()) {
+            srcRect = sourceBounds;
+        } else if (!srcRect.intersect(sourceBounds)) {
+            copy->finishRegion(CopyResult::UnknownError);
+            continue;
+        }
+        SkBitmap bitmap = request->getDestinationBitmap(i, srcRect.width(), srcRect.height());
+        if (bitmap.drawsNothing()) {
+            copy->finishRegion(CopyResult::DestinationInvalid);
+            continue;
+        }
+
+        // Render the region at the source's resolution, and leave the scaling to the destination
+        // size to asyncRescaleAndReadPixels. Unlike a single bilinear draw, it filters large
+        // downscales (e.g. thumbnails) in multiple passes, all of them on the GPU.
+        const SkImageInfo regionInfo = bitmap.info().makeWH(srcRect.width(), srcRect.height());
+        sk_sp<SkSurface> tmpSurface = makeReadbackSurface(grContext, regionInfo);
+        if (!tmpSurface.get() || !drawRegion(srcRect, tmpSurface->getCanvas())) {
+            copy->finishRegion(CopyResult::UnknownError);
+            continue;
+        }
+
+        mPendingAsyncRegions++;
+        issuedReadback = true;
+        tmpSurface->asyncRescaleAndReadPixels(
+                bitmap.info(), SkIRect::MakeSize(regionInfo.dimensions()),
+                SkImage::RescaleGamma::kSrc, SkImage::RescaleMode::kRepeatedLinear,
+                &Readback::onAsyncRegionRead, new AsyncRegion{this, copy, bitmap});
+    }
+
+    if (issuedReadback) {
+        grContext->flushAndSubmit();
+        scheduleAsyncPoll();
+    }
+}
+
+void Readback::onAsyncRegionRead(SkSurface::ReadPixelsContext context,
+                                 std::unique_ptr<const SkSurface::AsyncReadResult> result) {
+    std::unique_ptr<AsyncRegion> region(static_cast<AsyncRegion*>(context));
+    region->readback->mPendingAsyncRegions--;
+
+    CopyResult copyResult = CopyResult::UnknownError;
+    if (result && result->count() == 1) {
+        SkPixmap pixels(region->bitmap.info(), result->data(0), result->rowBytes(0));
+        if (region->bitmap.writePixels(pixels)) {
+            region->bitmap.notifyPixelsChanged();
+            copyResult = CopyResult::Success;
+        }
+    } else {
+        ALOGW("Unable to read back a region into the provided bitmap");
+    }
+    region->copy->finishRegion(copyResult);
+}
+
+void Readback::scheduleAsyncPoll() {
+    if (mAsyncPollScheduled) {
+        return;
+    }
+    mAsyncPollScheduled = true;
+    // Skia only delivers finished readbacks when asked to, so poll until every region arrived.
+    mRenderThread.queue().postDelayed(kAsyncPollInterval, [this]() {
+        mAsyncPollScheduled = false;
+        GrDirectContext* grContext = mRenderThread.getGrContext();
+        if (mPendingAsyncRegions == 0 || !grContext) {
+            // Destroying the context completes any readbacks that were still pending.
+            return;
+        }
+        grContext->checkAsyncWorkCompletion();
+        if (mPendingAsyncRegions > 0) {
+            scheduleAsyncPoll();
+        }
+    });
+}
+
 } /* namespace uirenderer */
 } /* namespace android */
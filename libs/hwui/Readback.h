@@ -17,13 +17,19 @@
 #pragma once
 
 #include <SkRefCnt.h>
+#include <SkSurface.h>
+
+#include <functional>
+#include <memory>
 
 #include "CopyRequest.h"
 #include "Matrix.h"
 #include "Rect.h"
 #include "renderthread/RenderThread.h"
+#include "utils/TimeUtils.h"
 
 class SkBitmap;
+class SkCanvas;
 class SkImage;
 struct SkRect;
 
@@ -49,13 +55,44 @@ public:
 
     CopyResult copyLayerInto(DeferredLayerUpdater* layer, SkBitmap* bitmap);
 
+    /**
+     * Like copySurfaceInto and copyLayerInto, but copies several regions of the source and
+     * returns as soon as the GPU work is issued. The request is finished from a later
+     * RenderThread task, once the GPU is done.
+     */
+    void copySurfaceIntoAsync(ANativeWindow* window,
+                              const std::shared_ptr<MultiRegionCopyRequest>& request);
+    void copyLayerIntoAsync(DeferredLayerUpdater* layer,
+                            const std::shared_ptr<MultiRegionCopyRequest>& request);
+
 private:
+    struct SurfaceSource;
+    struct AsyncCopy;
+    struct AsyncRegion;
+    // Draws the region srcRect of the source so that it fills the canvas.
+    using DrawRegionFunction = std::function<bool(const SkRect& srcRect, SkCanvas* canvas)>;
+
+    static constexpr nsecs_t kAsyncPollInterval = 2_ms;
+
+    CopyResult acquireSurfaceSource(ANativeWindow* window, bool waitOnGpu,
+                                    SurfaceSource* outSource);
+    void drawSurfaceSource(const SurfaceSource& source, const SkRect& srcRect, SkCanvas* canvas);
+
+    void issueAsyncCopies(const std::shared_ptr<MultiRegionCopyRequest>& request,
+                          const SkRect& sourceBounds, const DrawRegionFunction& drawRegion);
+    static void onAsyncRegionRead(SkSurface::ReadPixelsContext context,
+                                  std::unique_ptr<const SkSurface::AsyncReadResult> result);
+    void scheduleAsyncPoll();
+
     CopyResult copyImageInto(const sk_sp<SkImage>& image, const Rect& srcRect, SkBitmap* bitmap);
 
     bool copyLayerInto(Layer* layer, const SkRect* srcRect, const SkRect* dstRect,
                        SkBitmap* bitmap);
 
     renderthread::RenderThread& mRenderThread;
+    // Regions handed to asyncRescaleAndReadPixels whose results haven't arrived yet.
+    size_t mPendingAsyncRegions = 0;
+    bool mAsyncPollScheduled = false;
 };
 
 }  // namespace uirenderer
@@ -21,8 +21,12 @@
 #include <hwui/Paint.h>
 #include <log/log.h>
 
+#include <utils/String8.h>
+
+#include <atomic>
 #include <experimental/type_traits>
 #include <utility>
+#include <vector>
 
 #include "Mesh.h"
 #include "SkAndroidFrameworkUtils.h"
@@ -1034,6 +1038,242 @@ void DisplayListData::applyColorTransform(ColorTransform transform) {
     this->map(color_transform_fns, transform);
 }
 
+typedef void (*relocate_fn)(void*, void*, size_t);
+
+// Moves an op and the pod data that follows it to new storage. The op left behind still has to
+// be destroyed.
+#define X(T)                                                         \
+    [](void* src, void* dst, size_t skip) {                          \
+        new (dst) T(std::move(*static_cast<T*>(src)));               \
+        memcpy(static_cast<T*>(dst) + 1, static_cast<T*>(src) + 1,   \
+               skip - sizeof(T));                                    \
+    },
+static const relocate_fn relocate_fns[] = {
+#include "DisplayListOps.in"
+};
+#undef X
+
+static std::atomic<uint32_t> sCompactedLists = 0;
+static std::atomic<uint32_t> sElidedOps = 0;
+static std::atomic<size_t> sCompactionBytesSaved = 0;
+
+static bool isIdentityMatrixOp(const Op* op) {
+    switch ((Type)op->type) {
+        case Type::Translate: {
+            auto translate = static_cast<const Translate*>(op);
+            return translate->dx == 0 && translate->dy == 0;
+        }
+        case Type::Scale: {
+            auto scale = static_cast<const Scale*>(op);
+            return scale->sx == 1 && scale->sy == 1;
+        }
+        case Type::Concat:
+            return static_cast<const Concat*>(op)->matrix == SkM44();
+        default:
+            return false;
+    }
+}
+
+static bool canMergePoints(const DrawPoints* first, const DrawPoints* second) {
+    if (first->mode != second->mode || first->mode == SkCanvas::kPolygon_PointMode) {
+        return false;
+    }
+    // Every pair of points is a separate line, so an odd count would pair up the wrong points.
+    if (first->mode == SkCanvas::kLines_PointMode && (first->count & 1)) {
+        return false;
+    }
+    return first->paint == second->paint;
+}
+
+size_t DisplayListData::compact() {
+    // A run of ops that is written as one op: either a single op, or consecutive ops of the same
+    // type that are merged.
+    struct Run {
+        uint32_t offset;
+        uint32_t count;
+        uint32_t end;
+    };
+    struct OpenSave {
+        size_t runIndex;
+        // Only a plain save with nothing drawn before its restore can be dropped. A saveLayer
+        // draws its layer even if nothing was drawn into it.
+        bool elidable;
+        bool drew;
+    };
+    static constexpr size_t kNoMatrixRun = SIZE_MAX;
+
+    std::vector<Run> runs;
+    std::vector<OpenSave> saves;
+    // The first of the runs of matrix ops since the last op of another kind. A setMatrix replaces
+    // their effect, so they can be dropped.
+    size_t matrixRunStart = kNoMatrixRun;
+    uint32_t opCount = 0;
+    uint8_t* bytes = fBytes.get();
+    for (uint32_t offset = 0; offset < fUsed;) {
+        auto op = (const Op*)(bytes + offset);
+        const uint32_t end = offset + op->skip;
+        const Op* previous = runs.empty() || runs.back().end != offset
+                                     ? nullptr
+                                     : (const Op*)(bytes + runs.back().offset);
+        opCount++;
+        switch ((Type)op->type) {
+            case Type::Save:
+                saves.push_back({runs.size(), true, false});
+                runs.push_back({offset, 1, end});
+                matrixRunStart = kNoMatrixRun;
+                break;
+            case Type::SaveLayer:
+            case Type::SaveBehind:
+                saves.push_back({runs.size(), false, true});
+                runs.push_back({offset, 1, end});
+                matrixRunStart = kNoMatrixRun;
+                break;
+            case Type::Restore:
+                matrixRunStart = kNoMatrixRun;
+                if (!saves.empty()) {
+                    OpenSave save = saves.back();
+                    saves.pop_back();
+                    if (save.elidable && !save.drew) {
+                        // Everything since the save only changed state that is now restored.
+                        runs.resize(save.runIndex);
+                        break;
+                    }
+                    if (save.drew && !saves.empty()) {
+                        saves.back().drew = true;
+                    }
+                }
+                runs.push_back({offset, 1, end});
+                break;
+            case Type::Concat:
+            case Type::Scale:
+            case Type::Translate:
+            case Type::SetMatrix:
+                if (isIdentityMatrixOp(op)) {
+                    break;
+                }
+                if ((Type)op->type == Type::SetMatrix && matrixRunStart != kNoMatrixRun) {
+                    runs.resize(matrixRunStart);
+                    matrixRunStart = kNoMatrixRun;
+                }
+                if ((Type)op->type == Type::Translate && previous &&
+                    (Type)previous->type == Type::Translate) {
+                    runs.back().count++;
+                    runs.back().end = end;
+                    break;
+                }
+                if (matrixRunStart == kNoMatrixRun) {
+                    matrixRunStart = runs.size();
+                }
+                runs.push_back({offset, 1, end});
+                break;
+            case Type::ClipPath:
+            case Type::ClipRect:
+            case Type::ClipRRect:
+            case Type::ClipRegion:
+            case Type::ResetClip:
+                matrixRunStart = kNoMatrixRun;
+                runs.push_back({offset, 1, end});
+                break;
+            default:
+                matrixRunStart = kNoMatrixRun;
+                if (!saves.empty()) {
+                    saves.back().drew = true;
+                }
+                if ((Type)op->type == Type::DrawPoints && previous &&
+                    (Type)previous->type == Type::DrawPoints &&
+                    canMergePoints(static_cast<const DrawPoints*>(previous),
+                                   static_cast<const DrawPoints*>(op))) {
+                    runs.back().count++;
+                    runs.back().end = end;
+                    break;
+                }
+                runs.push_back({offset, 1, end});
+                break;
+        }
+        offset = end;
+    }
+    if (runs.size() == opCount) {
+        return 0;
+    }
+
+    // Merged ops are written as a single op, which is never larger than the ops it replaces.
+    size_t compactedSize = 0;
+    for (const Run& run : runs) {
+        if (run.count == 1) {
+            compactedSize += ((const Op*)(bytes + run.offset))->skip;
+        } else if ((Type)((const Op*)(bytes + run.offset))->type == Type::Translate) {
+            compactedSize += SkAlignPtr(sizeof(Translate));
+        } else {
+            size_t points = 0;
+            for (uint32_t offset = run.offset; offset < run.end;) {
+                auto op = (const DrawPoints*)(bytes + offset);
+                points += op->count;
+                offset += op->skip;
+            }
+            compactedSize += SkAlignPtr(sizeof(DrawPoints) + points * sizeof(SkPoint));
+        }
+    }
+
+    const size_t reserved = (compactedSize + SKLITEDL_PAGE) & ~(SKLITEDL_PAGE - 1);
+    AutoTMalloc<uint8_t> compacted(reserved);
+    size_t used = 0;
+    for (const Run& run : runs) {
+        auto op = (Op*)(bytes + run.offset);
+        uint8_t* dst = compacted.get() + used;
+        if (run.count == 1) {
+            relocate_fns[op->type](op, dst, op->skip);
+            used += op->skip;
+            continue;
+        }
+        Op* merged;
+        if ((Type)op->type == Type::Translate) {
+            SkScalar dx = 0, dy = 0;
+            for (uint32_t offset = run.offset; offset < run.end;) {
+                auto translate = (const Translate*)(bytes + offset);
+                dx += translate->dx;
+                dy += translate->dy;
+                offset += translate->skip;
+            }
+            merged = new (dst) Translate{dx, dy};
+            merged->type = (uint32_t)Type::Translate;
+            merged->skip = SkAlignPtr(sizeof(Translate));
+        } else {
+            auto first = (const DrawPoints*)op;
+            auto points = (SkPoint*)((DrawPoints*)dst + 1);
+            size_t count = 0;
+            for (uint32_t offset = run.offset; offset < run.end;) {
+                auto drawPoints = (const DrawPoints*)(bytes + offset);
+                memcpy(points + count, pod<SkPoint>(drawPoints),
+                       drawPoints->count * sizeof(SkPoint));
+                count += drawPoints->count;
+                offset += drawPoints->skip;
+            }
+            merged = new (dst) DrawPoints{first->mode, count, first->paint};
+            merged->type = (uint32_t)Type::DrawPoints;
+            merged->skip = SkAlignPtr(sizeof(DrawPoints) + count * sizeof(SkPoint));
+        }
+        used += merged->skip;
+    }
+    LOG_FATAL_IF(used != compactedSize);
+
+    const size_t saved = fUsed - used;
+    this->map(dtor_fns);
+    fBytes = std::move(compacted);
+    fUsed = used;
+    fReserved = reserved;
+
+    sCompactedLists++;
+    sElidedOps += opCount - runs.size();
+    sCompactionBytesSaved += saved;
+    return saved;
+}
+
+void DisplayListData::dumpCompactionStats(String8& log) {
+    log.appendFormat("Display list compaction: %u lists, %u ops elided, %.2fKB saved\n",
+                     sCompactedLists.load(), sElidedOps.load(),
+                     sCompactionBytesSaved.load() / 1000.f);
+}
+
 RecordingCanvas::RecordingCanvas() : INHERITED(1, 1), fDL(nullptr) {}
 
 void RecordingCanvas::reset(DisplayListData* dl, const SkIRect& bounds) {
@@ -44,6 +44,9 @@ class SkRRect;
 class Mesh;
 
 namespace android {
+
+class String8;
+
 namespace uirenderer {
 
 namespace skiapipeline {
@@ -120,6 +123,13 @@ public:
 
     void applyColorTransform(ColorTransform transform);
 
+    // Drops the ops that can't affect what is drawn, like a save and restore with only state
+    // changes between them or matrix changes that a setMatrix replaces, merges consecutive
+    // translates and drawPoints, and moves the ops that remain into a buffer that fits them.
+    // Returns the number of bytes saved.
+    size_t compact();
+    static void dumpCompactionStats(String8& log);
+
     bool hasText() const { return mHasText; }
     size_t usedSize() const { return fUsed; }
     size_t allocatedSize() const { return fReserved; }
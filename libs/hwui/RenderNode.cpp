@@ -19,6 +19,7 @@
 #include "DamageAccumulator.h"
 #include "Debug.h"
 #include "Properties.h"
+#include "RetainedLayerCache.h"
 #include "TreeInfo.h"
 #include "VectorDrawable.h"
 #include "private/hwui/WebViewFunctor.h"
@@ -173,8 +174,78 @@ void RenderNode::prepareLayer(TreeInfo& info, uint32_t dirtyMask) {
     }
 }
 
+// Subtrees that record less than this are about as cheap to draw again as a layer is to draw, and
+// would only take up layer memory.
+static constexpr size_t kMinRetainedLayerDisplayListBytes = 2 * 1024;
+
+bool RenderNode::canRetainLayer(const TreeInfo& info) const {
+    const RenderProperties& props = properties();
+    // Nodes that need their layer for other reasons already have one. Stretch, hole punches,
+    // backdrop filters and projection all draw differently from a layer, and a layer would clip
+    // whatever a node that doesn't clip to its bounds draws outside of them.
+    return !info.insideRetainedLayer && info.stretchEffectCount == 0 && isRenderable() &&
+           props.getClipToBounds() && props.effectiveLayerType() == LayerType::None &&
+           props.getWidth() > 0 && props.getHeight() > 0 && props.fitsOnLayer() &&
+           !mHasHolePunches &&
+           !mDisplayList.hasFunctor() && !props.getProjectBackwards() &&
+           !mDisplayList.containsProjectionReceiver() &&
+           props.layerProperties().getBackdropImageFilter() == nullptr &&
+           mSubtreeDisplayListBytes >= kMinRetainedLayerDisplayListBytes;
+}
+
+void RenderNode::updateRetainedLayer(TreeInfo& info) {
+    RetainedLayerCache& cache = RetainedLayerCache::get();
+    if (mRetainedLayerGeneration && cache.isEvicted(mRetainedLayerGeneration)) {
+        // The eviction already returned the reservation.
+        mRetainedLayerGeneration = 0;
+        mFramesUnchanged = 0;
+    }
+    const bool wasRetained = mRetainedLayerGeneration != 0;
+    mProperties.setRetainedAsLayer(false);
+
+    // While retained, prepareLayer() leaves only the damage that needs the layer redrawn.
+    SkRect dirty;
+    info.damageAccumulator->peekAtDirty(&dirty);
+    if (!dirty.isEmpty() || !canRetainLayer(info)) {
+        if (wasRetained && !dirty.isEmpty()) {
+            cache.onInvalidated();
+        }
+        releaseRetainedLayer();
+        return;
+    }
+
+    if (wasRetained) {
+        cache.onHit();
+    } else {
+        const int threshold = cache.frameThreshold();
+        if (threshold <= 0 || ++mFramesUnchanged < threshold) {
+            return;
+        }
+        // Matches the size SkiaPipeline::createOrUpdateLayer allocates.
+        const size_t width = ceilf(getWidth() / float(LAYER_SIZE)) * LAYER_SIZE;
+        const size_t height = ceilf(getHeight() / float(LAYER_SIZE)) * LAYER_SIZE;
+        mRetainedLayerBytes = width * height * 4;
+        mRetainedLayerGeneration = cache.reserve(mRetainedLayerBytes);
+        if (!mRetainedLayerGeneration) {
+            // Try again once another retained layer is dropped or evicted.
+            mFramesUnchanged = 0;
+            return;
+        }
+    }
+    mProperties.setRetainedAsLayer(true);
+}
+
+void RenderNode::releaseRetainedLayer() {
+    mFramesUnchanged = 0;
+    if (mRetainedLayerGeneration) {
+        RetainedLayerCache::get().release(mRetainedLayerGeneration, mRetainedLayerBytes);
+        mRetainedLayerGeneration = 0;
+    }
+}
+
 void RenderNode::pushLayerUpdate(TreeInfo& info) {
 #ifdef __ANDROID__ // Layoutlib does not support CanvasContext and Layers
+    updateRetainedLayer(info);
     LayerType layerType = properties().effectiveLayerType();
     // If we are not a layer OR we cannot be rendered (eg, view was detached)
     // we need to destroy any Layers we may have had previously
@@ -266,22 +337,30 @@ void RenderNode::prepareTreeImpl(TreeObserver& observer, TreeInfo& info, bool fu
         damageSelf(info);
     }
 
+    const bool insideRetainedLayer = info.insideRetainedLayer;
+    if (mRetainedLayerGeneration) {
+        info.insideRetainedLayer = true;
+    }
     if (mDisplayList) {
         info.out.hasFunctors |= mDisplayList.hasFunctor();
         mHasHolePunches = mDisplayList.hasHolePunches();
+        mSubtreeDisplayListBytes = mDisplayList.getUsedSize();
         bool isDirty = mDisplayList.prepareListAndChildren(
                 observer, info, childFunctorsNeedLayer,
                 [this](RenderNode* child, TreeObserver& observer, TreeInfo& info,
                        bool functorsNeedLayer) {
                     child->prepareTreeImpl(observer, info, functorsNeedLayer);
                     mHasHolePunches |= child->hasHolePunches();
+                    mSubtreeDisplayListBytes += child->mSubtreeDisplayListBytes;
                 });
         if (isDirty) {
             damageSelf(info);
         }
     } else {
         mHasHolePunches = false;
+        mSubtreeDisplayListBytes = 0;
     }
+    info.insideRetainedLayer = insideRetainedLayer;
     pushLayerUpdate(info);
 
     if (!mProperties.getAllowForceDark()) {
@@ -390,7 +469,14 @@ void RenderNode::syncDisplayList(TreeObserver& observer, TreeInfo* info) {
         WebViewSyncData syncData {
             .applyForceDark = info && !info->disableForceDark
         };
-        mDisplayList.syncContents(syncData);
+        if (info && mDisplayList.hasFunctor()) {
+            const nsecs_t syncStart = systemTime(SYSTEM_TIME_MONOTONIC);
+            mDisplayList.syncContents(syncData);
+            info->out.functorSyncDuration += systemTime(SYSTEM_TIME_MONOTONIC) - syncStart;
+            info->out.functorSyncCount++;
+        } else {
+            mDisplayList.syncContents(syncData);
+        }
         handleForceDark(info);
     }
 }
@@ -565,6 +651,20 @@ const SkPath* RenderNode::getClippedOutline(const SkRect& clipRect) const {
     return &mClippedOutlineCache.clippedOutline;
 }
 
+const SkPath* RenderNode::getRevealClippedOutline(const SkPath& outline,
+                                                  const SkPath& revealClip) const {
+    const uint32_t outlineID = outline.getGenerationID();
+    const uint32_t revealClipID = revealClip.getGenerationID();
+
+    if (outlineID != mRevealClippedOutlineCache.outlineID ||
+        revealClipID != mRevealClippedOutlineCache.revealClipID) {
+        mRevealClippedOutlineCache.outlineID = outlineID;
+        mRevealClippedOutlineCache.revealClipID = revealClipID;
+        Op(outline, revealClip, kIntersect_SkPathOp, &mRevealClippedOutlineCache.clippedOutline);
+    }
+    return &mRevealClippedOutlineCache.clippedOutline;
+}
+
 using StringBuffer = FatVector<char, 128>;
 
 template <typename... T>
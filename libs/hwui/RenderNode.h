@@ -235,11 +235,18 @@ private:
     void syncDisplayList(TreeObserver& observer, TreeInfo* info);
     void handleForceDark(TreeInfo* info);
 
+    // Walks the subtree on the RenderThread. Sibling subtrees cannot be prepared concurrently:
+    // position listeners and WebView functor syncs must run on the RenderThread, animators push
+    // to the shared AnimationContext, layer updates go to the single LayerUpdateQueue in `info`,
+    // and the TreeObserver may delete nodes reachable from other subtrees.
     void prepareTreeImpl(TreeObserver& observer, TreeInfo& info, bool functorsNeedLayer);
     void pushStagingPropertiesChanges(TreeInfo& info);
     void pushStagingDisplayListChanges(TreeObserver& observer, TreeInfo& info);
     void prepareLayer(TreeInfo& info, uint32_t dirtyMask);
     void pushLayerUpdate(TreeInfo& info);
+    void updateRetainedLayer(TreeInfo& info);
+    bool canRetainLayer(const TreeInfo& info) const;
+    void releaseRetainedLayer();
     void deleteDisplayList(TreeObserver& observer, TreeInfo* info = nullptr);
     void damageSelf(TreeInfo& info);
 
@@ -292,6 +299,15 @@ private:
     bool mHasHolePunches;
     StretchMask mStretchMask;
 
+    // Display list bytes of this node and all of its descendants, as of the last prepareTree.
+    size_t mSubtreeDisplayListBytes = 0;
+    // How many frames in a row the subtree was prepared without being damaged.
+    int mFramesUnchanged = 0;
+    // The RetainedLayerCache reservation for the layer this node was automatically promoted
+    // to, or 0 if it wasn't.
+    uint32_t mRetainedLayerGeneration = 0;
+    size_t mRetainedLayerBytes = 0;
+
     bool mIsTextureView = false;
 
     // METHODS & FIELDS ONLY USED BY THE SKIA RENDERER
@@ -332,6 +348,7 @@ public:
             mSkiaLayer->inverseTransformInWindow.loadIdentity();
         } else {
             mSkiaLayer.reset();
+            releaseRetainedLayer();
         }
 
         mProperties.mutateLayerProperties().mutableStretchEffect().clear();
@@ -379,6 +396,15 @@ public:
      */
     const SkPath* getClippedOutline(const SkRect& clipRect) const;
 
+    /**
+     * Like getClippedOutline, but intersects the given outline with the reveal clip. The outline
+     * is either the RenderNode's outline or the result of getClippedOutline.
+     *
+     * The returned path is only guaranteed to be valid until this function is called again or
+     * either path is mutated.
+     */
+    const SkPath* getRevealClippedOutline(const SkPath& outline, const SkPath& revealClip) const;
+
 private:
     /**
      * If this RenderNode has been used in a previous frame then the SkiaDisplayList
@@ -421,6 +447,16 @@ private:
         SkPath clippedOutline;
     };
     mutable ClippedOutlineCache mClippedOutlineCache;
+
+    struct RevealClippedOutlineCache {
+        // keys
+        uint32_t outlineID = 0;
+        uint32_t revealClipID = 0;
+
+        // value
+        SkPath clippedOutline;
+    };
+    mutable RevealClippedOutlineCache mRevealClippedOutlineCache;
 };  // class RenderNode
 
 class MarkAndSweepRemoved : public TreeObserver {
@@ -189,6 +189,9 @@ public:
         return CC_LIKELY(effectiveLayerType() == LayerType::None) && functorsNeedLayer;
     }
 
+    void setRetainedAsLayer(bool retained) { mComputedFields.mRetainedAsLayer = retained; }
+    bool isRetainedAsLayer() const { return mComputedFields.mRetainedAsLayer; }
+
     RenderProperties& operator=(const RenderProperties& other);
 
     bool setClipToBounds(bool clipToBounds) {
@@ -557,7 +560,8 @@ public:
 
     bool promotedToLayer() const {
         return mLayerProperties.mType == LayerType::None && fitsOnLayer() &&
-               (mComputedFields.mNeedLayerForFunctors || mLayerProperties.mImageFilter != nullptr ||
+               (mComputedFields.mNeedLayerForFunctors || mComputedFields.mRetainedAsLayer ||
+                mLayerProperties.mImageFilter != nullptr ||
                 mLayerProperties.getStretchEffect().requiresLayer() ||
                 (!MathUtils::isZero(mPrimitiveFields.mAlpha) && mPrimitiveFields.mAlpha < 1 &&
                  mPrimitiveFields.mHasOverlappingRendering));
@@ -625,6 +629,10 @@ private:
 
         // Force layer on for functors to enable render features they don't yet support (clipping)
         bool mNeedLayerForFunctors = false;
+
+        // Set by RenderNode when the subtree hasn't changed for long enough to keep drawing it
+        // from a layer, see RetainedLayerCache
+        bool mRetainedAsLayer = false;
     } mComputedFields;
 };
 
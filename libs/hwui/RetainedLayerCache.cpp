@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RetainedLayerCache.h"
+
+namespace android {
+namespace uirenderer {
+
+RetainedLayerCache& RetainedLayerCache::get() {
+    static RetainedLayerCache* sCache = new RetainedLayerCache();
+    return *sCache;
+}
+
+void RetainedLayerCache::setLimits(int frameThreshold, size_t budgetBytes) {
+    std::lock_guard lock(mLock);
+    mFrameThreshold = frameThreshold;
+    mBudgetBytes = budgetBytes;
+}
+
+int RetainedLayerCache::frameThreshold() {
+    std::lock_guard lock(mLock);
+    return mFrameThreshold;
+}
+
+uint32_t RetainedLayerCache::reserve(size_t bytes) {
+    std::lock_guard lock(mLock);
+    if (mFrameThreshold <= 0 || mBytes + bytes > mBudgetBytes) {
+        return 0;
+    }
+    mBytes += bytes;
+    mLayerCount++;
+    mPromotions++;
+    return mGeneration;
+}
+
+void RetainedLayerCache::release(uint32_t generation, size_t bytes) {
+    std::lock_guard lock(mLock);
+    if (generation != mGeneration) {
+        return;
+    }
+    mBytes -= bytes;
+    mLayerCount--;
+}
+
+bool RetainedLayerCache::isEvicted(uint32_t generation) {
+    std::lock_guard lock(mLock);
+    return generation != mGeneration;
+}
+
+void RetainedLayerCache::evictAll() {
+    std::lock_guard lock(mLock);
+    if (mLayerCount == 0) {
+        return;
+    }
+    mEvictions += mLayerCount;
+    mLayerCount = 0;
+    mBytes = 0;
+    // Skip 0, which stands for no reservation.
+    if (++mGeneration == 0) {
+        mGeneration = 1;
+    }
+}
+
+void RetainedLayerCache::onHit() {
+    std::lock_guard lock(mLock);
+    mHits++;
+}
+
+void RetainedLayerCache::onInvalidated() {
+    std::lock_guard lock(mLock);
+    mInvalidations++;
+}
+
+size_t RetainedLayerCache::sizeInBytes() {
+    std::lock_guard lock(mLock);
+    return mBytes;
+}
+
+void RetainedLayerCache::dumpMemoryUsage(String8& log) {
+    std::lock_guard lock(mLock);
+    uint32_t lookups = mHits + mInvalidations;
+    log.appendFormat("Retained layers: %u layers, %.2fMB of %.2fMB (promoted = %u, hits = %u, "
+                     "invalidated = %u, evicted = %u, hit rate = %.1f%%)\n",
+                     mLayerCount, mBytes / 1000000.f, mBudgetBytes / 1000000.f, mPromotions,
+                     mHits, mInvalidations, mEvictions,
+                     lookups ? mHits * 100.f / lookups : 0.f);
+}
+
+}  // namespace uirenderer
+}  // namespace android
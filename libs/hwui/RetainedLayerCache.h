@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Macros.h"
+
+#include <utils/String8.h>
+
+#include <cstdint>
+#include <mutex>
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * Budget for the layers of RenderNodes that were promoted to a layer automatically, because their
+ * subtree was drawn unchanged for a number of frames. Such a node keeps drawing the layer, which
+ * costs a single image draw, until its content changes again.
+ *
+ * The layers themselves are owned by their RenderNode. The cache only hands out reservations
+ * against the budget, and evicts all of them at once by advancing its generation: a node whose
+ * reservation is from an older generation drops its layer the next time it is prepared.
+ */
+class RetainedLayerCache {
+    PREVENT_COPY_AND_ASSIGN(RetainedLayerCache);
+
+public:
+    static RetainedLayerCache& get();
+
+    // Set by CacheManager from the MemoryPolicy. A threshold of 0 disables retaining layers.
+    void setLimits(int frameThreshold, size_t budgetBytes);
+    int frameThreshold();
+
+    // Reserves `bytes` of the budget. Returns the generation of the reservation, or 0 if the
+    // budget doesn't have room.
+    uint32_t reserve(size_t bytes);
+    // Returns a reservation. Reservations of an evicted generation were already returned.
+    void release(uint32_t generation, size_t bytes);
+    bool isEvicted(uint32_t generation);
+    // Drops every reservation, the nodes release their layers on their next frame.
+    void evictAll();
+
+    // A frame drew a retained layer instead of its subtree.
+    void onHit();
+    // A retained layer was dropped because its subtree changed.
+    void onInvalidated();
+
+    size_t sizeInBytes();
+    void dumpMemoryUsage(String8& log);
+
+private:
+    RetainedLayerCache() {}
+
+    std::mutex mLock;
+    int mFrameThreshold = 0;
+    size_t mBudgetBytes = 0;
+    uint32_t mGeneration = 1;
+    size_t mBytes = 0;
+    uint32_t mLayerCount = 0;
+    uint32_t mPromotions = 0;
+    uint32_t mHits = 0;
+    uint32_t mInvalidations = 0;
+    uint32_t mEvictions = 0;
+};
+
+}  // namespace uirenderer
+}  // namespace android
@@ -18,6 +18,10 @@
 
 #include <SkRuntimeEffect.h>
 #include <log/log.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 // libshaders only exists on Android devices
 #ifdef __ANDROID__
 #include <shaders/shaders.h>
@@ -42,15 +46,10 @@ public:
 };
 
 static sk_sp<SkColorFilter> createLinearEffectColorFilter(const shaders::LinearEffect& linearEffect,
+                                                          sk_sp<SkRuntimeEffect> runtimeEffect,
                                                           float maxDisplayLuminance,
                                                           float currentDisplayLuminanceNits,
                                                           float maxLuminance) {
-    auto shaderString = SkString(shaders::buildLinearEffectSkSL(linearEffect));
-    auto [runtimeEffect, error] = SkRuntimeEffect::MakeForColorFilter(std::move(shaderString));
-    if (!runtimeEffect) {
-        LOG_ALWAYS_FATAL("LinearColorFilter construction error: %s", error.c_str());
-    }
-
     ColorFilterRuntimeEffectBuilder effectBuilder(std::move(runtimeEffect));
 
     const auto uniforms =
@@ -64,6 +63,66 @@ static sk_sp<SkColorFilter> createLinearEffectColorFilter(const shaders::LinearE
     return effectBuilder.makeColorFilter();
 }
 
+/**
+ * Tonemapping color filters are requested for every draw of HDR content, and each one used to
+ * generate and compile its SkSL from scratch. The runtime effects only depend on the source and
+ * destination dataspaces, and the filters additionally only on the content's max luminance, so
+ * both are built once and shared. SkRuntimeEffects and SkColorFilters are immutable, which
+ * makes them safe to hand out to any thread.
+ */
+class TonemapFilterCache {
+public:
+    static TonemapFilterCache& get() {
+        static TonemapFilterCache* sCache = new TonemapFilterCache();
+        return *sCache;
+    }
+
+    sk_sp<SkColorFilter> getColorFilter(const shaders::LinearEffect& linearEffect,
+                                        float maxDisplayLuminance,
+                                        float currentDisplayLuminanceNits, float maxLuminance) {
+        std::lock_guard lock(mLock);
+        for (const auto& entry : mFilters) {
+            if (entry.effect == linearEffect && entry.maxLuminance == maxLuminance) {
+                return entry.filter;
+            }
+        }
+
+        sk_sp<SkRuntimeEffect>& runtimeEffect = mEffects[linearEffect];
+        if (!runtimeEffect) {
+            auto shaderString = SkString(shaders::buildLinearEffectSkSL(linearEffect));
+            auto [effect, error] = SkRuntimeEffect::MakeForColorFilter(std::move(shaderString));
+            if (!effect) {
+                LOG_ALWAYS_FATAL("LinearColorFilter construction error: %s", error.c_str());
+            }
+            runtimeEffect = std::move(effect);
+        }
+
+        sk_sp<SkColorFilter> filter =
+                createLinearEffectColorFilter(linearEffect, runtimeEffect, maxDisplayLuminance,
+                                              currentDisplayLuminanceNits, maxLuminance);
+        // Layers report their own max luminance, so keep only the most recent filters around.
+        if (mFilters.size() >= kMaxFilters) {
+            mFilters.erase(mFilters.begin());
+        }
+        mFilters.push_back({linearEffect, maxLuminance, filter});
+        return filter;
+    }
+
+private:
+    static constexpr size_t kMaxFilters = 16;
+
+    struct FilterEntry {
+        shaders::LinearEffect effect;
+        float maxLuminance;
+        sk_sp<SkColorFilter> filter;
+    };
+
+    std::mutex mLock;
+    std::unordered_map<shaders::LinearEffect, sk_sp<SkRuntimeEffect>, shaders::LinearEffectHasher>
+            mEffects;
+    std::vector<FilterEntry> mFilters;
+};
+
 static ui::Dataspace extractTransfer(ui::Dataspace dataspace) {
     return static_cast<ui::Dataspace>(dataspace & HAL_DATASPACE_TRANSFER_MASK);
 }
@@ -100,7 +159,7 @@ void tonemapPaint(const SkImageInfo& source, const SkImageInfo& destination, flo
                 .type = shaders::LinearEffect::SkSLType::ColorFilter};
         constexpr float kMaxDisplayBrightnessNits = 1000.f;
         constexpr float kCurrentDisplayBrightnessNits = 500.f;
-        sk_sp<SkColorFilter> colorFilter = createLinearEffectColorFilter(
+        sk_sp<SkColorFilter> colorFilter = TonemapFilterCache::get().getColorFilter(
                 effect, kMaxDisplayBrightnessNits, kCurrentDisplayBrightnessNits, maxLuminanceNits);
 
         if (paint.getColorFilter()) {
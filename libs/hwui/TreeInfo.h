@@ -100,10 +100,18 @@ public:
 
     int stretchEffectCount = 0;
 
+    // Whether an ancestor is drawn from a RetainedLayerCache layer, in which case the nodes below
+    // it don't need a layer of their own.
+    bool insideRetainedLayer = false;
+
     bool forceDrawFrame = false;
 
     struct Out {
         bool hasFunctors = false;
+        // Time spent syncing the functors of the render nodes whose display lists were synced,
+        // and how many such nodes there were
+        nsecs_t functorSyncDuration = 0;
+        uint32_t functorSyncCount = 0;
         // This is only updated if evaluateAnimations is true
         bool hasAnimations = false;
         // This is set to true if there is an animation that RenderThread cannot
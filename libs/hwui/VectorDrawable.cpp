@@ -32,6 +32,7 @@
 #endif
 
 #include <gui/TraceUtils.h>
+#include "VectorDrawableCache.h"
 #include "utils/Macros.h"
 #include "utils/VectorDrawableUtils.h"
 
@@ -41,6 +42,29 @@ namespace VectorDrawable {
 
 const int Tree::MAX_CACHED_BITMAP_SIZE = 2048;
 
+// A tree that had to be repainted this many times is animating or being mutated, so sharing its
+// bitmap would only churn the shared cache.
+static constexpr int MAX_SHARED_CACHE_REPAINTS = 3;
+
+// FNV-1a, the content hash only needs to be cheap and well distributed.
+static void hashBytes(uint64_t* hash, const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        *hash = (*hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+template <typename T>
+static void hashValue(uint64_t* hash, const T& value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+template <typename T>
+static void hashVector(uint64_t* hash, const std::vector<T>& values) {
+    hashValue(hash, values.size());
+    hashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
 void Path::dump() {
     ALOGD("Path: %s has %zu points", mName.c_str(), mProperties.getData().points.size());
 }
@@ -72,6 +96,13 @@ const SkPath& Path::getUpdatedPath(bool useStagingData, SkPath* tempStagingPath)
     }
 }
 
+void Path::hashContent(uint64_t* hash) const {
+    const Data& data = mProperties.getData();
+    hashVector(hash, data.verbs);
+    hashVector(hash, data.verbSizes);
+    hashVector(hash, data.points);
+}
+
 void Path::syncProperties() {
     if (mStagingPropertiesDirty) {
         mProperties.syncProperties(mStagingProperties);
@@ -268,6 +299,26 @@ void FullPath::FullPathProperties::setPropertyValue(int propertyId, float value)
     }
 }
 
+void FullPath::FullPathProperties::hashContent(uint64_t* hash) const {
+    // PrimitiveFields only holds 4 byte fields, so it has no padding to hash.
+    hashValue(hash, mPrimitiveFields);
+    // Shaders are immutable and shared by copies of a tree, their identity is enough.
+    hashValue(hash, fillGradient.get());
+    hashValue(hash, strokeGradient.get());
+}
+
+void FullPath::hashContent(uint64_t* hash) const {
+    hashValue(hash, 'F');
+    Path::hashContent(hash);
+    mProperties.hashContent(hash);
+    hashValue(hash, mAntiAlias);
+}
+
+void ClipPath::hashContent(uint64_t* hash) const {
+    hashValue(hash, 'C');
+    Path::hashContent(hash);
+}
+
 void ClipPath::draw(SkCanvas* outCanvas, bool useStagingData) {
     SkPath tempStagingPath;
     outCanvas->clipPath(getUpdatedPath(useStagingData, &tempStagingPath), true);
@@ -292,6 +343,15 @@ void Group::draw(SkCanvas* outCanvas, bool useStagingData) {
     // Restore the previous clip and matrix information.
 }
 
+void Group::hashContent(uint64_t* hash) const {
+    hashValue(hash, 'G');
+    hashValue(hash, mProperties.mPrimitiveFields);
+    hashValue(hash, mChildren.size());
+    for (auto& child : mChildren) {
+        child->hashContent(hash);
+    }
+}
+
 void Group::dump() {
     ALOGD("Group %s has %zu children: ", mName.c_str(), mChildren.size());
     ALOGD("Group translateX, Y : %f, %f, scaleX, Y: %f, %f", mProperties.getTranslateX(),
@@ -487,8 +547,23 @@ void Tree::getPaintFor(Paint* outPaint, const TreeProperties& prop) const {
 }
 
 Bitmap& Tree::getBitmapUpdateIfDirty() {
-    bool redrawNeeded = allocateBitmapIfNeeded(mCache, mProperties.getScaledWidth(),
-                                               mProperties.getScaledHeight());
+    int width = mProperties.getScaledWidth();
+    int height = mProperties.getScaledHeight();
+    // The shared bitmap is kept for as long as its key, the tree's content and size, holds.
+    if (mCache.shared && !mCache.dirty && mCache.bitmap->width() == width &&
+        mCache.bitmap->height() == height) {
+        return *mCache.bitmap;
+    }
+    if ((mCache.dirty || !canReuseBitmap(mCache.bitmap.get(), width, height)) &&
+        useSharedBitmapCache(width, height)) {
+        return *mCache.bitmap;
+    }
+    if (mCache.shared) {
+        // The shared bitmap must never be repainted in place.
+        mCache.bitmap.reset();
+        mCache.shared = false;
+    }
+    bool redrawNeeded = allocateBitmapIfNeeded(mCache, width, height);
     if (redrawNeeded || mCache.dirty) {
         updateBitmapCache(*mCache.bitmap, false);
         mCache.dirty = false;
@@ -534,6 +609,38 @@ void Tree::updateBitmapCache(Bitmap& bitmap, bool useStagingData) {
     mRootNode->draw(&outCanvas, useStagingData);
 }
 
+uint64_t Tree::computeContentHash() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashValue(&hash, mProperties.getViewportWidth());
+    hashValue(&hash, mProperties.getViewportHeight());
+    mRootNode->hashContent(&hash);
+    return hash;
+}
+
+bool Tree::useSharedBitmapCache(int width, int height) {
+    if (!mAllowCaching || mSharedCacheRepaints >= MAX_SHARED_CACHE_REPAINTS ||
+        !VectorDrawableCache::canCache(width, height)) {
+        return false;
+    }
+    VectorDrawableCache& cache = VectorDrawableCache::get();
+    VectorDrawableCache::Key key{computeContentHash(), width, height};
+    sk_sp<Bitmap> bitmap = cache.find(key);
+    if (!bitmap) {
+        SkImageInfo info = SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType);
+        bitmap = Bitmap::allocateHeapBitmap(info);
+        if (!bitmap) {
+            return false;
+        }
+        updateBitmapCache(*bitmap, false);
+        mSharedCacheRepaints++;
+        cache.insert(key, bitmap);
+    }
+    mCache.bitmap = std::move(bitmap);
+    mCache.shared = true;
+    mCache.dirty = false;
+    return true;
+}
+
 bool Tree::allocateBitmapIfNeeded(Cache& cache, int width, int height) {
     if (!canReuseBitmap(cache.bitmap.get(), width, height)) {
         SkImageInfo info = SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType);
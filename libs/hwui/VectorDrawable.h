@@ -120,6 +120,8 @@ public:
     virtual ~Node() {}
     virtual void syncProperties() = 0;
     virtual void setAntiAlias(bool aa) = 0;
+    // Mixes everything that affects how the render thread properties rasterize into `hash`.
+    virtual void hashContent(uint64_t* hash) const = 0;
 
     virtual void forEachFillColor(const std::function<void(SkColor)>& func) const { }
 
@@ -169,6 +171,7 @@ public:
 
     void dump() override;
     virtual void syncProperties() override;
+    void hashContent(uint64_t* hash) const override;
     virtual void onPropertyChanged(Properties* prop) override {
         if (prop == &mStagingProperties) {
             mStagingPropertiesDirty = true;
@@ -302,6 +305,7 @@ public:
         // Set property values during animation
         void setColorPropertyValue(int propertyId, int32_t value);
         void setPropertyValue(int propertyId, float value);
+        void hashContent(uint64_t* hash) const;
         bool mTrimDirty;
 
     private:
@@ -352,6 +356,7 @@ public:
         }
     }
     virtual void setAntiAlias(bool aa) { mAntiAlias = aa; }
+    void hashContent(uint64_t* hash) const override;
     void forEachFillColor(const std::function<void(SkColor)>& func) const override {
         func(mStagingProperties.getFillColor());
     }
@@ -377,6 +382,7 @@ public:
     ClipPath() : Path() {}
     void draw(SkCanvas* outCanvas, bool useStagingData) override;
     virtual void setAntiAlias(bool aa) {}
+    void hashContent(uint64_t* hash) const override;
 };
 
 class Group : public Node {
@@ -486,6 +492,8 @@ public:
         }
     }
 
+    void hashContent(uint64_t* hash) const override;
+
     void forEachFillColor(const std::function<void(SkColor)>& func) const override {
         for (auto& child : mChildren) {
             child->forEachFillColor(func);
@@ -659,8 +667,14 @@ private:
     public:
         sk_sp<Bitmap> bitmap;  // used by HWUI pipeline and software
         bool dirty = true;
+        // Whether bitmap is owned by the VectorDrawableCache and shared with other trees.
+        bool shared = false;
     };
 
+    uint64_t computeContentHash() const;
+    // Points mCache at a bitmap from the process-wide cache, rasterizing and inserting it if
+    // needed. Returns false if the tree shouldn't share its bitmap.
+    bool useSharedBitmapCache(int width, int height);
     bool allocateBitmapIfNeeded(Cache& cache, int width, int height);
     bool canReuseBitmap(Bitmap*, int width, int height);
     void updateBitmapCache(Bitmap& outCache, bool useStagingData);
@@ -678,6 +692,7 @@ private:
 
     Cache mStagingCache;
     Cache mCache;
+    int mSharedCacheRepaints = 0;
 
     PropertyChangedListener mPropertyChangedListener =
             PropertyChangedListener(&mCache.dirty, &mStagingCache.dirty);
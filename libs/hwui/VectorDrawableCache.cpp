@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VectorDrawableCache.h"
+
+namespace android {
+namespace uirenderer {
+namespace VectorDrawable {
+
+VectorDrawableCache& VectorDrawableCache::get() {
+    static VectorDrawableCache* sCache = new VectorDrawableCache();
+    return *sCache;
+}
+
+sk_sp<Bitmap> VectorDrawableCache::find(const Key& key) {
+    std::lock_guard lock(mLock);
+    auto it = mEntries.find(key);
+    if (it == mEntries.end()) {
+        mMisses++;
+        return nullptr;
+    }
+    mHits++;
+    it->second.lastUsed = systemTime(SYSTEM_TIME_MONOTONIC);
+    return it->second.bitmap;
+}
+
+void VectorDrawableCache::insert(const Key& key, sk_sp<Bitmap> bitmap) {
+    size_t bytes = bitmap->getAllocationByteCount();
+    if (bytes > kMaxEntryBytes) {
+        return;
+    }
+    std::lock_guard lock(mLock);
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        mBytes -= it->second.bitmap->getAllocationByteCount();
+        mEntries.erase(it);
+    }
+    evictLocked(bytes);
+    mEntries.emplace(key, Entry{std::move(bitmap), systemTime(SYSTEM_TIME_MONOTONIC)});
+    mBytes += bytes;
+}
+
+void VectorDrawableCache::evictLocked(size_t neededBytes) {
+    while (!mEntries.empty() && mBytes + neededBytes > kMaxBytes) {
+        // The cache holds at most a few dozen entries, a linear scan for the least recently
+        // used one is cheaper than keeping an LRU list up to date on every hit.
+        auto oldest = mEntries.begin();
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+            if (it->second.lastUsed < oldest->second.lastUsed) {
+                oldest = it;
+            }
+        }
+        mBytes -= oldest->second.bitmap->getAllocationByteCount();
+        mEntries.erase(oldest);
+    }
+}
+
+void VectorDrawableCache::trimStale(nsecs_t now) {
+    std::lock_guard lock(mLock);
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        if (now - it->second.lastUsed > kStaleTimeout) {
+            mBytes -= it->second.bitmap->getAllocationByteCount();
+            it = mEntries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void VectorDrawableCache::clear() {
+    std::lock_guard lock(mLock);
+    mEntries.clear();
+    mBytes = 0;
+}
+
+size_t VectorDrawableCache::sizeInBytes() {
+    std::lock_guard lock(mLock);
+    return mBytes;
+}
+
+void VectorDrawableCache::dumpMemoryUsage(String8& log) {
+    std::lock_guard lock(mLock);
+    log.appendFormat("VectorDrawable cache: %zu entries, %.2fMB (hits = %u, misses = %u)\n",
+                     mEntries.size(), mBytes / 1000000.f, mHits, mMisses);
+}
+
+}  // namespace VectorDrawable
+}  // namespace uirenderer
+}  // namespace android
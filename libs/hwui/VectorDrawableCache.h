@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "hwui/Bitmap.h"
+#include "utils/Macros.h"
+#include "utils/TimeUtils.h"
+
+#include <utils/String8.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace android {
+namespace uirenderer {
+namespace VectorDrawable {
+
+/**
+ * Process-wide cache of rasterized VectorDrawable trees, shared by every Tree whose content
+ * renders to identical pixels. The same icon drawn by many list rows is rasterized, and uploaded
+ * by Skia, only once instead of once per drawable instance.
+ *
+ * Tint and alpha are applied by the paint when the cached bitmap is drawn, so they are not part
+ * of the key and trees that only differ in tint share an entry.
+ *
+ * Cached bitmaps are never modified once inserted; a tree whose content changes looks up or
+ * inserts a new entry. Evicting an entry only drops the cache's reference, trees that still use
+ * the bitmap keep it alive.
+ */
+class VectorDrawableCache {
+    PREVENT_COPY_AND_ASSIGN(VectorDrawableCache);
+
+public:
+    struct Key {
+        uint64_t contentHash;
+        int width;
+        int height;
+
+        bool operator==(const Key& other) const {
+            return contentHash == other.contentHash && width == other.width &&
+                   height == other.height;
+        }
+    };
+
+    static VectorDrawableCache& get();
+
+    // Whether a bitmap of the given size is small enough to be shared.
+    static bool canCache(int width, int height) {
+        return width > 0 && height > 0 &&
+               static_cast<size_t>(width) * height * 4 <= kMaxEntryBytes;
+    }
+
+    sk_sp<Bitmap> find(const Key& key);
+    void insert(const Key& key, sk_sp<Bitmap> bitmap);
+
+    // Drops the entries that were not looked up within kStaleTimeout of `now`.
+    void trimStale(nsecs_t now);
+    void clear();
+
+    size_t sizeInBytes();
+    void dumpMemoryUsage(String8& log);
+
+    static constexpr size_t kMaxBytes = 4 * 1024 * 1024;
+    static constexpr size_t kMaxEntryBytes = 256 * 1024;
+    // Matches the age at which CacheManager purges unused GPU resources.
+    static constexpr nsecs_t kStaleTimeout = 30_s;
+
+private:
+    VectorDrawableCache() {}
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.contentHash ^ (static_cast<uint64_t>(key.width) << 32) ^
+                                       static_cast<uint64_t>(key.height));
+        }
+    };
+
+    struct Entry {
+        sk_sp<Bitmap> bitmap;
+        nsecs_t lastUsed;
+    };
+
+    void evictLocked(size_t neededBytes);
+
+    std::mutex mLock;
+    std::unordered_map<Key, Entry, KeyHash> mEntries;
+    size_t mBytes = 0;
+    uint32_t mHits = 0;
+    uint32_t mMisses = 0;
+};
+
+}  // namespace VectorDrawable
+}  // namespace uirenderer
+}  // namespace android
@@ -77,13 +77,13 @@ protected:
 
     bool internalSave(SaveEntry saveEntry);
 
-    void internalSaveLayer(const SkCanvas::SaveLayerRec& layerRec) {
+    void internalSaveLayer(const SkRect& bounds) {
         internalSave({
             .clip = true,
             .matrix = true,
             .layer = true
         });
-        internalClipRect(*layerRec.fBounds, SkClipOp::kIntersect);
+        internalClipRect(bounds, SkClipOp::kIntersect);
     }
 
     bool internalRestore();
@@ -212,7 +212,7 @@ public:
         static_assert(T != CanvasOpType::Restore, "Must use CanvasFrontend::restore() call instead");
 
         if constexpr (T == CanvasOpType::SaveLayer) {
-            internalSaveLayer(op.saveLayerRec);
+            internalSaveLayer(op.bounds);
         }
         if constexpr (T == CanvasOpType::SaveBehind) {
             // Don't use internalSaveLayer as this doesn't apply clipping, it's a "regular" save
@@ -17,6 +17,12 @@
 #include "CanvasOpBuffer.h"
 
 #include "CanvasOps.h"
+#include "DamageAccumulator.h"
+#include "Matrix.h"
+
+#include <experimental/type_traits>
+#include <iterator>
+#include <string>
 
 namespace android::uirenderer {
 
@@ -31,27 +37,98 @@ void CanvasOpBuffer::updateChildren(std::function<void(RenderNode*)> updateFn) {
     }
 }
 
+static const char* opName(CanvasOpType type) {
+    // In CanvasOpType order
+    static constexpr const char* kNames[] = {
+            "save", "saveLayer", "saveBehind", "restore", "beginZ", "endZ",
+            "clipRect", "clipPath",
+            "drawColor", "drawRect", "drawRegion", "drawRoundRect", "drawRoundRectProperty",
+            "drawDoubleRoundRect", "drawCircleProperty", "drawRippleDrawable", "drawCircle",
+            "drawOval", "drawArc", "drawPaint", "drawPoint", "drawPoints", "drawPath", "drawLine",
+            "drawLines", "drawVertices", "drawImage", "drawImageRect", "drawImageLattice",
+            "drawPicture", "drawLayer", "drawRenderNode",
+    };
+    static_assert(std::size(kNames) == static_cast<size_t>(CanvasOpType::COUNT));
+    return kNames[static_cast<int>(type)];
+}
+
 void CanvasOpBuffer::output(std::ostream& output, uint32_t level) const {
-    LOG_ALWAYS_FATAL("TODO");
+    const std::string indent((level + 1) * 2, ' ');
+    for_each([&]<CanvasOpType T>(const CanvasOpContainer<T>* op) {
+        output << indent << opName(T);
+        if constexpr (T == CanvasOpType::DrawRenderNode) {
+            (*op)->renderNode->output(output, level + 1);
+        } else {
+            output << std::endl;
+        }
+    });
 }
 
 bool CanvasOpBuffer::prepareListAndChildren(
             TreeObserver& observer, TreeInfo& info, bool functorsNeedLayer,
             std::function<void(RenderNode*, TreeObserver&, TreeInfo&, bool)> childFn) {
-    LOG_ALWAYS_FATAL("TODO");
+    bool hasBackwardProjectedNodesHere = false;
+    bool hasBackwardProjectedNodesSubtree = false;
+
+    if (mHas.children) {
+        for (auto& iter : filter<CanvasOpType::DrawRenderNode>()) {
+            RenderNode* childNode = iter->renderNode.get();
+            Matrix4 mat4(iter.transform());
+            info.damageAccumulator->pushTransform(&mat4);
+            info.hasBackwardProjectedNodes = false;
+            childFn(childNode, observer, info, functorsNeedLayer);
+            hasBackwardProjectedNodesHere |= childNode->properties().getProjectBackwards();
+            hasBackwardProjectedNodesSubtree |= info.hasBackwardProjectedNodes;
+            info.damageAccumulator->popTransform();
+        }
+    }
+
+    // Projected display lists are only drawn by SkiaDisplayList receivers, so there is nothing to
+    // reset here and the projected nodes are left for an ancestor to find.
+    info.hasBackwardProjectedNodes =
+            hasBackwardProjectedNodesSubtree || hasBackwardProjectedNodesHere;
+
+    // There are no animated image ops, so nothing to damage the node outside of its children.
     return false;
 }
 
 void CanvasOpBuffer::syncContents(const WebViewSyncData& data) {
-    LOG_ALWAYS_FATAL("TODO");
+    // Functors have no op yet, there is nothing to sync
+    LOG_ALWAYS_FATAL_IF(mHas.functor, "Functors aren't supported by CanvasOpBuffer");
 }
 
 void CanvasOpBuffer::onRemovedFromTree() {
-    LOG_ALWAYS_FATAL("TODO");
+    // Only functors need to know, and they have no op yet
+    LOG_ALWAYS_FATAL_IF(mHas.functor, "Functors aren't supported by CanvasOpBuffer");
 }
 
+template <class T>
+using has_paint_helper = decltype(std::declval<T>().paint);
+
+template <class T>
+constexpr bool has_paint =
+        std::is_same_v<std::experimental::detected_t<has_paint_helper, T>, SkPaint>;
+
+template <class T>
+using has_bitmap_helper = decltype(std::declval<T>().bitmap);
+
+template <class T>
+constexpr bool has_bitmap = std::experimental::is_detected_v<has_bitmap_helper, T>;
+
 void CanvasOpBuffer::applyColorTransform(ColorTransform transform) {
-    LOG_ALWAYS_FATAL("TODO");
+    // Same as DisplayListData, the ops are only const to keep for_each simple
+    for_each([transform]<CanvasOpType T>(const CanvasOpContainer<T>* container) {
+        auto& op = const_cast<CanvasOp<T>&>(container->op());
+        if constexpr (T == CanvasOpType::DrawRippleDrawable) {
+            // Ripple drawable needs to contrast against the background, so we need the inverse
+            // color.
+            op.params.color = transformColorInverse(transform, op.params.color);
+        } else if constexpr (has_paint<CanvasOp<T>> && has_bitmap<CanvasOp<T>>) {
+            transformPaint(transform, &op.paint, op.bitmap->palette());
+        } else if constexpr (has_paint<CanvasOp<T>>) {
+            transformPaint(transform, &op.paint);
+        }
+    });
 }
 
 }  // namespace android::uirenderer
@@ -19,4 +19,218 @@
 #include "CanvasOpBuffer.h"
 #include "CanvasOps.h"
 
-namespace android::uirenderer {}  // namespace android::uirenderer
+#include <algorithm>
+
+namespace android::uirenderer {
+
+int CanvasOpRecorder::save(SaveFlags::Flags flags) {
+    const int count = mFrontend.saveCount();
+    mFrontend.save(flags);
+    return count;
+}
+
+void CanvasOpRecorder::restore() {
+    mFrontend.restore();
+}
+
+void CanvasOpRecorder::restoreToCount(int saveCount) {
+    // The initial save can't be restored, same as SkCanvas
+    while (mFrontend.saveCount() > std::max(saveCount, 1)) {
+        mFrontend.restore();
+    }
+}
+
+int CanvasOpRecorder::saveLayer(float left, float top, float right, float bottom,
+                                const SkPaint* paint) {
+    const int count = mFrontend.saveCount();
+    mFrontend.draw(CanvasOp<CanvasOpType::SaveLayer>{
+            .bounds = SkRect::MakeLTRB(left, top, right, bottom),
+            .paint = paint ? std::optional<SkPaint>(*paint) : std::nullopt,
+    });
+    return count;
+}
+
+int CanvasOpRecorder::saveLayerAlpha(float left, float top, float right, float bottom,
+                                     int alpha) {
+    if (static_cast<unsigned>(alpha) < 0xFF) {
+        SkPaint alphaPaint;
+        alphaPaint.setAlpha(alpha);
+        return saveLayer(left, top, right, bottom, &alphaPaint);
+    }
+    return saveLayer(left, top, right, bottom, nullptr);
+}
+
+bool CanvasOpRecorder::clipRect(float left, float top, float right, float bottom, SkClipOp op) {
+    mFrontend.draw(CanvasOp<CanvasOpType::ClipRect>{
+            .rect = SkRect::MakeLTRB(left, top, right, bottom),
+            .clipOp = op,
+    });
+    return !mFrontend.isClipEmpty();
+}
+
+bool CanvasOpRecorder::clipPath(const SkPath* path, SkClipOp op) {
+    mFrontend.draw(CanvasOp<CanvasOpType::ClipPath>{
+            .path = *path,
+            .op = op,
+    });
+    return !mFrontend.isClipEmpty();
+}
+
+void CanvasOpRecorder::drawColor(int color, SkBlendMode mode) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawColor>{
+            .color = SkColor4f::FromColor(color),
+            .mode = mode,
+    });
+}
+
+void CanvasOpRecorder::drawPaint(const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawPaint>{.paint = paint});
+}
+
+void CanvasOpRecorder::drawPoint(float x, float y, const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawPoint>{.x = x, .y = y, .paint = paint});
+}
+
+sk_sp<Points> CanvasOpRecorder::makePoints(const float* points, int floatCount,
+                                           int pointsPerItem) {
+    // Drop the trailing coordinates that don't make a whole item, like SkiaCanvas does
+    const int count = (floatCount / 2) / pointsPerItem * pointsPerItem;
+    if (count <= 0) {
+        return nullptr;
+    }
+    auto result = sk_sp<Points>(new Points(count));
+    for (int i = 0; i < count; i++) {
+        (*result)[i] = SkPoint::Make(points[2 * i], points[2 * i + 1]);
+    }
+    return result;
+}
+
+void CanvasOpRecorder::drawPoints(const float* points, int floatCount, const Paint& paint) {
+    if (auto pts = makePoints(points, floatCount, 1)) {
+        mFrontend.draw(CanvasOp<CanvasOpType::DrawPoints>{
+                .count = pts->size(),
+                .paint = paint,
+                .points = std::move(pts),
+        });
+    }
+}
+
+void CanvasOpRecorder::drawLine(float startX, float startY, float stopX, float stopY,
+                                const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawLine>{
+            .startX = startX,
+            .startY = startY,
+            .endX = stopX,
+            .endY = stopY,
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawLines(const float* points, int floatCount, const Paint& paint) {
+    if (auto pts = makePoints(points, floatCount, 2)) {
+        mFrontend.draw(CanvasOp<CanvasOpType::DrawLines>{
+                .count = pts->size(),
+                .paint = paint,
+                .points = std::move(pts),
+        });
+    }
+}
+
+void CanvasOpRecorder::drawRect(float left, float top, float right, float bottom,
+                                const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawRect>{
+            .rect = SkRect::MakeLTRB(left, top, right, bottom),
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawRegion(const SkRegion& region, const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawRegion>{.region = region, .paint = paint});
+}
+
+void CanvasOpRecorder::drawRoundRect(float left, float top, float right, float bottom, float rx,
+                                     float ry, const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawRoundRect>{
+            .rect = SkRect::MakeLTRB(left, top, right, bottom),
+            .rx = rx,
+            .ry = ry,
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawDoubleRoundRect(const SkRRect& outer, const SkRRect& inner,
+                                           const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawDoubleRoundRect>{
+            .outer = outer,
+            .inner = inner,
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawCircle(float x, float y, float radius, const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawCircle>{
+            .cx = x,
+            .cy = y,
+            .radius = radius,
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawOval(float left, float top, float right, float bottom,
+                                const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawOval>{
+            .oval = SkRect::MakeLTRB(left, top, right, bottom),
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawArc(float left, float top, float right, float bottom, float startAngle,
+                               float sweepAngle, bool useCenter, const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawArc>{
+            .oval = SkRect::MakeLTRB(left, top, right, bottom),
+            .startAngle = startAngle,
+            .sweepAngle = sweepAngle,
+            .useCenter = useCenter,
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawPath(const SkPath& path, const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawPath>{.path = path, .paint = paint});
+}
+
+void CanvasOpRecorder::drawVertices(const SkVertices* vertices, SkBlendMode mode,
+                                    const Paint& paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawVertices>{
+            .vertices = sk_ref_sp(vertices),
+            .mode = mode,
+            .paint = paint,
+    });
+}
+
+void CanvasOpRecorder::drawBitmap(Bitmap& bitmap, float left, float top, const Paint* paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawImage>{
+            sk_ref_sp(&bitmap), left, top,
+            paint ? paint->filterMode() : SkFilterMode::kNearest,
+            paint ? SkPaint(*paint) : SkPaint()});
+}
+
+void CanvasOpRecorder::drawBitmap(Bitmap& bitmap, float srcLeft, float srcTop, float srcRight,
+                                  float srcBottom, float dstLeft, float dstTop, float dstRight,
+                                  float dstBottom, const Paint* paint) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawImageRect>{
+            sk_ref_sp(&bitmap), SkRect::MakeLTRB(srcLeft, srcTop, srcRight, srcBottom),
+            SkRect::MakeLTRB(dstLeft, dstTop, dstRight, dstBottom),
+            paint ? paint->filterMode() : SkFilterMode::kNearest,
+            paint ? SkPaint(*paint) : SkPaint()});
+}
+
+void CanvasOpRecorder::drawPicture(const SkPicture& picture) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawPicture>{.picture = sk_ref_sp(&picture)});
+}
+
+void CanvasOpRecorder::drawRenderNode(RenderNode* renderNode) {
+    mFrontend.draw(CanvasOp<CanvasOpType::DrawRenderNode>{.renderNode = renderNode});
+}
+
+}  // namespace android::uirenderer
@@ -17,22 +17,80 @@
 #pragma once
 
 #include "hwui/Canvas.h"
+#include "CanvasFrontend.h"
 #include "CanvasOpBuffer.h"
 
-#include <vector>
-
 namespace android::uirenderer {
 
 // Interop with existing HWUI Canvas
-class CanvasOpRecorder final : /* todo: public Canvas */ {
+//
+// Records the calls of the hwui Canvas that CanvasOps.h has ops for into a CanvasOpBuffer, with
+// the same signatures as the Canvas methods so the two can be swapped by the callers that stick to
+// them. Text, functors, vector drawables, layers and animated images have no ops yet, so they are
+// not offered here and a view that draws them still has to go through SkiaRecordingCanvas.
+class CanvasOpRecorder final {
 public:
+    CanvasOpRecorder(int width, int height) : mFrontend(width, height) {}
+
+    void resetRecording(int width, int height) { mFrontend.reset(width, height); }
+    [[nodiscard]] CanvasOpBuffer finishRecording() { return mFrontend.finish(); }
+
+    // State ops
+    int getSaveCount() const { return mFrontend.saveCount(); }
+    int save(SaveFlags::Flags flags);
+    void restore();
+    void restoreToCount(int saveCount);
+    int saveLayer(float left, float top, float right, float bottom, const SkPaint* paint);
+    int saveLayerAlpha(float left, float top, float right, float bottom, int alpha);
+
     // Transform ops
-private:
-    struct SaveEntry {
+    void getMatrix(SkMatrix* outMatrix) const { mFrontend.getMatrix(outMatrix); }
+    void setMatrix(const SkMatrix& matrix) { mFrontend.setMatrix(matrix); }
+    void concat(const SkMatrix& matrix) { mFrontend.concat(matrix); }
+    void rotate(float degrees) { mFrontend.rotate(degrees); }
+    void scale(float sx, float sy) { mFrontend.scale(sx, sy); }
+    void skew(float sx, float sy) { mFrontend.skew(sx, sy); }
+    void translate(float dx, float dy) { mFrontend.translate(dx, dy); }
 
-    };
+    // Clip ops
+    bool quickRejectRect(float left, float top, float right, float bottom) const {
+        return mFrontend.quickRejectRect(left, top, right, bottom);
+    }
+    bool quickRejectPath(const SkPath& path) const { return mFrontend.quickRejectPath(path); }
+    bool clipRect(float left, float top, float right, float bottom, SkClipOp op);
+    bool clipPath(const SkPath* path, SkClipOp op);
+
+    // Drawing ops
+    void drawColor(int color, SkBlendMode mode);
+    void drawPaint(const Paint& paint);
+    void drawPoint(float x, float y, const Paint& paint);
+    void drawPoints(const float* points, int floatCount, const Paint& paint);
+    void drawLine(float startX, float startY, float stopX, float stopY, const Paint& paint);
+    void drawLines(const float* points, int floatCount, const Paint& paint);
+    void drawRect(float left, float top, float right, float bottom, const Paint& paint);
+    void drawRegion(const SkRegion& region, const Paint& paint);
+    void drawRoundRect(float left, float top, float right, float bottom, float rx, float ry,
+                       const Paint& paint);
+    void drawDoubleRoundRect(const SkRRect& outer, const SkRRect& inner, const Paint& paint);
+    void drawCircle(float x, float y, float radius, const Paint& paint);
+    void drawOval(float left, float top, float right, float bottom, const Paint& paint);
+    void drawArc(float left, float top, float right, float bottom, float startAngle,
+                 float sweepAngle, bool useCenter, const Paint& paint);
+    void drawPath(const SkPath& path, const Paint& paint);
+    void drawVertices(const SkVertices* vertices, SkBlendMode mode, const Paint& paint);
+
+    // Bitmap-based
+    void drawBitmap(Bitmap& bitmap, float left, float top, const Paint* paint);
+    void drawBitmap(Bitmap& bitmap, float srcLeft, float srcTop, float srcRight, float srcBottom,
+                    float dstLeft, float dstTop, float dstRight, float dstBottom,
+                    const Paint* paint);
+    void drawPicture(const SkPicture& picture);
+    void drawRenderNode(RenderNode* renderNode);
+
+private:
+    sk_sp<Points> makePoints(const float* points, int floatCount, int pointsPerItem);
 
-    std::vector<SaveEntry> mSaveStack;
+    CanvasFrontend<CanvasOpBuffer> mFrontend;
 };
 
 }  // namespace android::uirenderer
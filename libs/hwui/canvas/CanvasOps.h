@@ -41,6 +41,7 @@
 #include "RenderNode.h"
 
 #include <experimental/type_traits>
+#include <optional>
 #include <utility>
 
 namespace android::uirenderer {
@@ -73,8 +74,12 @@ struct CanvasOp<CanvasOpType::Save> {
 
 template <>
 struct CanvasOp<CanvasOpType::SaveLayer> {
-    SkCanvas::SaveLayerRec saveLayerRec;
-    void draw(SkCanvas* canvas) const { canvas->saveLayer(saveLayerRec); }
+    // Owned by the op, a SaveLayerRec only points at them and would outlive the caller's copies
+    SkRect bounds;
+    std::optional<SkPaint> paint;
+    void draw(SkCanvas* canvas) const {
+        canvas->saveLayer(SkCanvas::SaveLayerRec(&bounds, paint ? &*paint : nullptr, 0));
+    }
     ASSERT_DRAWABLE()
 };
 
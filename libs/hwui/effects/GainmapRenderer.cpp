@@ -168,6 +168,10 @@ private:
     SkRuntimeShaderBuilder mBuilder{mShader};
     SkGainmapInfo mGainmapInfo;
     std::mutex mUniformGuard;
+    // The uniforms from the last build(). The ratio only changes when the display's HDR headroom
+    // does, so most frames can reuse them instead of copying the uniforms again.
+    float mLastTargetHdrSdrRatio = -1.f;
+    sk_sp<const SkData> mLastUniforms;
 
     void setupChildren(const sk_sp<const SkImage>& baseImage,
                        const sk_sp<const SkImage>& gainmapImage, SkTileMode tileModeX,
@@ -244,6 +248,9 @@ private:
             // This can happen if a BitmapShader is used on multiple canvas', such as a
             // software + hardware canvas, which is otherwise valid as SkShader is "immutable"
             std::lock_guard _lock(mUniformGuard);
+            if (mLastUniforms && targetHdrSdrRatio == mLastTargetHdrSdrRatio) {
+                return mLastUniforms;
+            }
             const float Wunclamped = (sk_float_log(targetHdrSdrRatio) -
                                       sk_float_log(mGainmapInfo.fDisplayRatioSdr)) /
                                      (sk_float_log(mGainmapInfo.fDisplayRatioHdr) -
@@ -251,6 +258,8 @@ private:
             const float W = std::max(std::min(Wunclamped, 1.f), 0.f);
             mBuilder.uniform("W") = W;
             uniforms = mBuilder.uniforms();
+            mLastTargetHdrSdrRatio = targetHdrSdrRatio;
+            mLastUniforms = uniforms;
         }
         return uniforms;
     }
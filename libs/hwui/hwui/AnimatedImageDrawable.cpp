@@ -20,20 +20,73 @@
 #endif
 
 #include <gui/TraceUtils.h>
+#include "MemoryPolicy.h"
 #include "pipeline/skia/SkiaUtils.h"
 
-#include <SkPicture.h>
+#include <SkBitmap.h>
 #include <SkRefCnt.h>
 
+#include <algorithm>
 #include <optional>
 
 namespace android {
 
+// Snapshots cover the bounds of the SkAnimatedImage, in the format it decodes to.
+static SkImageInfo snapshotInfo(SkAnimatedImage* image, const SkImageInfo& decodeInfo) {
+    const SkIRect bounds = image->getBounds().roundOut();
+    return decodeInfo.makeWH(bounds.width(), bounds.height());
+}
+
+static size_t decodeAheadFrames(size_t frameBytes) {
+    const uirenderer::MemoryPolicy& policy = uirenderer::loadMemoryPolicy();
+    size_t frames = std::max(policy.animatedImageDecodeAheadFrames, 1);
+    if (frameBytes > 0) {
+        frames = std::min(frames,
+                          std::max<size_t>(policy.animatedImageDecodeAheadBytes / frameBytes, 1));
+    }
+    return frames;
+}
+
+sk_sp<Bitmap> AnimatedImageDrawable::FramePool::acquire() {
+    std::lock_guard lock(mLock);
+    for (const sk_sp<Bitmap>& bitmap : mBitmaps) {
+        // Once the pool holds the only reference, no SkImage draws from this bitmap anymore.
+        if (bitmap->unique()) {
+            return bitmap;
+        }
+    }
+    if (mInfo.isEmpty()) {
+        return nullptr;
+    }
+    sk_sp<Bitmap> bitmap = Bitmap::allocateHeapBitmap(mInfo);
+    if (bitmap && mBitmaps.size() < mMaxBitmaps) {
+        mBitmaps.push_back(bitmap);
+    }
+    return bitmap;
+}
+
+void AnimatedImageDrawable::FramePool::trim() {
+    std::lock_guard lock(mLock);
+    mBitmaps.erase(std::remove_if(mBitmaps.begin(), mBitmaps.end(),
+                                  [](const sk_sp<Bitmap>& bitmap) { return bitmap->unique(); }),
+                   mBitmaps.end());
+}
+
 AnimatedImageDrawable::AnimatedImageDrawable(sk_sp<SkAnimatedImage> animatedImage, size_t bytesUsed,
-                                             SkEncodedImageFormat format)
-        : mSkAnimatedImage(std::move(animatedImage)), mBytesUsed(bytesUsed), mFormat(format) {
+                                             SkEncodedImageFormat format,
+                                             const SkImageInfo& decodeInfo)
+        : mSkAnimatedImage(std::move(animatedImage))
+        , mBytesUsed(bytesUsed)
+        , mFormat(format)
+        , mFramePool(snapshotInfo(mSkAnimatedImage.get(), decodeInfo)) {
     mTimeToShowNextSnapshot = ms2ns(currentFrameDuration());
     setStagingBounds(mSkAnimatedImage->getBounds());
+
+    const size_t frameBytes = mFramePool.info().computeMinByteSize();
+    mDecodeAheadFrames = decodeAheadFrames(frameBytes);
+    mExtraDecodeAheadBytes = (mDecodeAheadFrames - 1) * frameBytes;
+    // One bitmap for mSnapshot, plus one for each frame decoded ahead of it.
+    mFramePool.setMaxBitmaps(mDecodeAheadFrames + 1);
 }
 
 void AnimatedImageDrawable::syncProperties() {
@@ -54,6 +107,8 @@ bool AnimatedImageDrawable::start() {
 bool AnimatedImageDrawable::stop() {
     bool wasRunning = mRunning;
     mRunning = false;
+    // Frames which are still queued or on screen keep their bitmaps until they are dropped.
+    mFramePool.trim();
     return wasRunning;
 }
 
@@ -62,8 +117,8 @@ bool AnimatedImageDrawable::isRunning() {
 }
 
 bool AnimatedImageDrawable::nextSnapshotReady() const {
-    return mNextSnapshot.valid() &&
-           mNextSnapshot.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    return !mNextSnapshots.empty() &&
+           mNextSnapshots.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready;
 }
 
 // Only called on the RenderThread while UI thread is locked.
@@ -80,7 +135,7 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
     std::unique_lock lock{mSwapLock};
     mCurrentTime += currentTime - lastWallTime;
 
-    if (!mNextSnapshot.valid()) {
+    if (mNextSnapshots.empty()) {
         // Need to trigger onDraw in order to start decoding the next frame.
         *outDelay = mTimeToShowNextSnapshot - mCurrentTime;
         return true;
@@ -105,29 +160,42 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
     return false;
 }
 
-// Only called on the AnimatedImageThread.
-AnimatedImageDrawable::Snapshot AnimatedImageDrawable::decodeNextFrame() {
+// Only called on the AnimatedImageThread while mImageLock is held.
+AnimatedImageDrawable::Snapshot AnimatedImageDrawable::makeSnapshot(int durationMS) {
     Snapshot snap;
+    snap.mDurationMS = durationMS;
+
+    sk_sp<Bitmap> bitmap = mFramePool.acquire();
+    if (!bitmap) {
+        return snap;
+    }
+    SkBitmap skBitmap;
+    bitmap->getSkBitmap(&skBitmap);
     {
-        std::unique_lock lock{mImageLock};
-        snap.mDurationMS = adjustFrameDuration(mSkAnimatedImage->decodeNextFrame());
-        snap.mPic.reset(mSkAnimatedImage->newPictureSnapshot());
+        SkCanvas canvas(skBitmap);
+        canvas.clear(SK_ColorTRANSPARENT);
+        const SkRect bounds = mSkAnimatedImage->getBounds();
+        canvas.translate(-bounds.left(), -bounds.top());
+        mSkAnimatedImage->draw(&canvas);
     }
-
+    // The bitmap may have held an earlier frame. A new generation ID keeps GPU caches from
+    // treating the new image as the old one.
+    bitmap->notifyPixelsChanged();
+    snap.mImage = bitmap->makeImage();
     return snap;
 }
 
 // Only called on the AnimatedImageThread.
-AnimatedImageDrawable::Snapshot AnimatedImageDrawable::reset() {
-    Snapshot snap;
-    {
-        std::unique_lock lock{mImageLock};
-        mSkAnimatedImage->reset();
-        snap.mPic.reset(mSkAnimatedImage->newPictureSnapshot());
-        snap.mDurationMS = currentFrameDuration();
-    }
+AnimatedImageDrawable::Snapshot AnimatedImageDrawable::decodeNextFrame() {
+    std::unique_lock lock{mImageLock};
+    return makeSnapshot(adjustFrameDuration(mSkAnimatedImage->decodeNextFrame()));
+}
 
-    return snap;
+// Only called on the AnimatedImageThread.
+AnimatedImageDrawable::Snapshot AnimatedImageDrawable::reset() {
+    std::unique_lock lock{mImageLock};
+    mSkAnimatedImage->reset();
+    return makeSnapshot(currentFrameDuration());
 }
 
 // Update the matrix to map from the intrinsic bounds of the SkAnimatedImage to
@@ -165,7 +233,7 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     const bool starting = mStarting;
     mStarting = false;
 
-    const bool drawDirectly = !mSnapshot.mPic;
+    const bool drawDirectly = !mSnapshot.mImage;
     if (drawDirectly) {
         // The image is not animating, and never was. Draw directly from
         // mSkAnimatedImage.
@@ -184,10 +252,12 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
         }
     } else if (starting) {
         // The image has animated, and now is being reset. Queue up the first
-        // frame, but keep showing the current frame until the first is ready.
+        // frame, but keep showing the current frame until the first is ready. Frames decoded
+        // ahead are dropped; AnimatedImageThread runs the reset after any still being decoded.
 #ifdef __ANDROID__ // Layoutlib does not support AnimatedImageThread
         auto& thread = uirenderer::AnimatedImageThread::getInstance();
-        mNextSnapshot = thread.reset(sk_ref_sp(this));
+        mNextSnapshots.clear();
+        mNextSnapshots.push_back(thread.reset(sk_ref_sp(this)));
 #endif
     }
 
@@ -195,11 +265,14 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     if (mRunning && nextSnapshotReady()) {
         std::unique_lock lock{mSwapLock};
         if (mCurrentTime >= mTimeToShowNextSnapshot) {
-            mSnapshot = mNextSnapshot.get();
+            mSnapshot = mNextSnapshots.front().get();
+            mNextSnapshots.pop_front();
             const nsecs_t timeToShowCurrentSnap = mTimeToShowNextSnapshot;
             if (mSnapshot.mDurationMS == SkAnimatedImage::kFinished) {
                 finalFrame = true;
                 mRunning = false;
+                // Anything decoded past the final frame is a repeat of it.
+                mNextSnapshots.clear();
             } else {
                 mTimeToShowNextSnapshot += ms2ns(mSnapshot.mDurationMS);
                 if (mCurrentTime >= mTimeToShowNextSnapshot) {
@@ -213,17 +286,26 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
         }
     }
 
-    if (mRunning && !mNextSnapshot.valid()) {
 #ifdef __ANDROID__ // Layoutlib does not support AnimatedImageThread
+    // Until the first snapshot is shown, frames are drawn from mSkAnimatedImage itself, which
+    // must not run ahead of the frame on screen.
+    const size_t decodeAhead = drawDirectly ? 1 : mDecodeAheadFrames;
+    if (mRunning && mNextSnapshots.size() < decodeAhead) {
+        // AnimatedImageThread decodes in order, so the queue stays in display order.
         auto& thread = uirenderer::AnimatedImageThread::getInstance();
-        mNextSnapshot = thread.decodeNextFrame(sk_ref_sp(this));
-#endif
+        while (mNextSnapshots.size() < decodeAhead) {
+            mNextSnapshots.push_back(thread.decodeNextFrame(sk_ref_sp(this)));
+        }
     }
+#endif
 
     if (!drawDirectly) {
         // No other thread will modify mCurrentSnap so this should be safe to
         // use without locking.
-        canvas->drawPicture(mSnapshot.mPic, nullptr, lazyPaint ? &*lazyPaint : nullptr);
+        const SkRect bounds = mSkAnimatedImage->getBounds();
+        canvas->drawImage(mSnapshot.mImage, bounds.left(), bounds.top(),
+                          SkSamplingOptions(SkFilterMode::kLinear),
+                          lazyPaint ? &*lazyPaint : nullptr);
     }
 
     if (finalFrame) {
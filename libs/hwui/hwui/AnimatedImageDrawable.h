@@ -21,14 +21,19 @@
 #include <SkColorFilter.h>
 #include <SkDrawable.h>
 #include <SkEncodedImageFormat.h>
-#include <SkPicture.h>
+#include <SkImage.h>
+#include <SkImageInfo.h>
 #include <cutils/compiler.h>
 #include <utils/Macros.h>
 #include <utils/RefBase.h>
 #include <utils/Timers.h>
 
+#include <deque>
 #include <future>
 #include <mutex>
+#include <vector>
+
+#include "hwui/Bitmap.h"
 
 namespace android {
 
@@ -46,10 +51,11 @@ public:
  */
 class AnimatedImageDrawable : public SkDrawable {
 public:
-    // bytesUsed includes the approximate sizes of the SkAnimatedImage and the SkPictures in the
-    // Snapshots.
+    // bytesUsed includes the approximate sizes of the SkAnimatedImage and the current and next
+    // Snapshots. Frames decoded further ahead are accounted for by byteSize(). decodeInfo is the
+    // info the SkAnimatedImage decodes into; Snapshots use its color type and color space.
     AnimatedImageDrawable(sk_sp<SkAnimatedImage> animatedImage, size_t bytesUsed,
-                          SkEncodedImageFormat format);
+                          SkEncodedImageFormat format, const SkImageInfo& decodeInfo);
 
     /**
      * This updates the internal time and returns true if the image needs
@@ -93,7 +99,8 @@ public:
     }
 
     struct Snapshot {
-        sk_sp<SkPicture> mPic;
+        // Backed by a Bitmap from mFramePool, which reuses it once the image is released.
+        sk_sp<SkImage> mImage;
         int mDurationMS;
 
         Snapshot() = default;
@@ -108,12 +115,34 @@ public:
     Snapshot decodeNextFrame();
     Snapshot reset();
 
-    size_t byteSize() const { return sizeof(*this) + mBytesUsed; }
+    size_t byteSize() const { return sizeof(*this) + mBytesUsed + mExtraDecodeAheadBytes; }
 
 protected:
     void onDraw(SkCanvas* canvas) override;
 
 private:
+    // The bitmaps Snapshots are rendered into. A bitmap is handed out again once the pool holds
+    // the only reference to it, so a running animation stops allocating after its first frames.
+    class FramePool {
+    public:
+        explicit FramePool(const SkImageInfo& info) : mInfo(info) {}
+
+        const SkImageInfo& info() const { return mInfo; }
+        // Bitmaps acquired beyond this many are not kept for reuse.
+        void setMaxBitmaps(size_t maxBitmaps) { mMaxBitmaps = maxBitmaps; }
+
+        // Returns nullptr if the frames are empty or the allocation failed.
+        sk_sp<Bitmap> acquire();
+        // Releases the bitmaps that no Snapshot uses.
+        void trim();
+
+    private:
+        const SkImageInfo mInfo;
+        size_t mMaxBitmaps = 0;
+        std::mutex mLock;
+        std::vector<sk_sp<Bitmap>> mBitmaps;
+    };
+
     sk_sp<SkAnimatedImage> mSkAnimatedImage;
     const size_t mBytesUsed;
     const SkEncodedImageFormat mFormat;
@@ -124,11 +153,19 @@ private:
     // A snapshot of the current frame to draw.
     Snapshot mSnapshot;
 
-    std::future<Snapshot> mNextSnapshot;
+    // The frames following mSnapshot, in display order. AnimatedImageThread decodes them one at
+    // a time, up to mDecodeAheadFrames ahead of the frame being shown.
+    std::deque<std::future<Snapshot>> mNextSnapshots;
+
+    FramePool mFramePool;
+    size_t mDecodeAheadFrames = 1;
+    size_t mExtraDecodeAheadBytes = 0;
 
     bool nextSnapshotReady() const;
+    // Only called on the AnimatedImageThread while mImageLock is held.
+    Snapshot makeSnapshot(int durationMS);
 
-    // When to switch from mSnapshot to mNextSnapshot.
+    // When to switch from mSnapshot to the front of mNextSnapshots.
     nsecs_t mTimeToShowNextSnapshot = 0;
 
     // The current time for the drawable itself.
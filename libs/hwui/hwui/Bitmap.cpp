@@ -16,6 +16,7 @@
 #include "Bitmap.h"
 
 #include "HardwareBitmapUploader.h"
+#include "MemoryPolicy.h"
 #include "Properties.h"
 #ifdef __ANDROID__  // Layoutlib does not support render thread
 #include <private/android/AHardwareBufferHelpers.h>
@@ -33,6 +34,7 @@
 
 #include <cutils/ashmem.h>
 #include <log/log.h>
+#include <utils/String8.h>
 
 #ifndef _WIN32
 #include <binder/IServiceManager.h>
@@ -52,6 +54,8 @@
 #include <SkWebpEncoder.h>
 
 #include <limits>
+#include <mutex>
+#include <vector>
 
 namespace android {
 
@@ -83,6 +87,152 @@ static uint64_t AHardwareBuffer_getAllocationSize(AHardwareBuffer* aHardwareBuff
 }
 #endif
 
+static void purgeFreedHeap() {
+#ifdef __ANDROID__
+    mallopt(M_PURGE, 0);
+#endif
+}
+
+/**
+ * Pixel memory of destroyed heap bitmaps, kept for the next allocateHeapBitmap of the same size
+ * class. Size classes are an eighth of a power of two apart, so a pooled buffer is at most 12.5%
+ * larger than the bitmap that reuses it.
+ */
+class PixelPool {
+public:
+    static PixelPool& get() {
+        static PixelPool* sPool = new PixelPool(uirenderer::loadMemoryPolicy().bitmapPoolBytes);
+        return *sPool;
+    }
+
+    // Returns zeroed memory for a bitmap of `*size` bytes, or nullptr if the pool doesn't have
+    // any. Either way `*size` is rounded up to its size class, so that the memory can be pooled
+    // once the bitmap is destroyed.
+    void* acquire(size_t* size) {
+        if (!isPooledSize(*size)) {
+            return nullptr;
+        }
+        *size = roundUp(*size);
+        void* address = nullptr;
+        {
+            std::lock_guard lock(mLock);
+            // The most recently released buffer is the most likely to still be resident
+            for (auto it = mEntries.rbegin(); it != mEntries.rend(); ++it) {
+                if (it->size == *size) {
+                    address = it->address;
+                    mEntries.erase(std::next(it).base());
+                    mBytes -= *size;
+                    break;
+                }
+            }
+            if (address) {
+                mHits++;
+            } else {
+                mMisses++;
+            }
+        }
+        if (address) {
+            memset(address, 0, *size);
+        }
+        return address;
+    }
+
+    // Takes ownership of the memory of a destroyed bitmap. Returns false if it isn't pooled and
+    // the caller has to free it.
+    bool release(void* address, size_t size) {
+        if (!isPooledSize(size) || roundUp(size) != size) {
+            return false;
+        }
+        std::vector<void*> evicted;
+        {
+            std::lock_guard lock(mLock);
+            mEntries.push_back({address, size, systemTime(SYSTEM_TIME_MONOTONIC)});
+            mBytes += size;
+            while (mBytes > mBudgetBytes) {
+                evicted.push_back(mEntries.front().address);
+                mBytes -= mEntries.front().size;
+                mEntries.erase(mEntries.begin());
+            }
+        }
+        freeAll(evicted);
+        return true;
+    }
+
+    void trim(nsecs_t now, nsecs_t timeout) {
+        std::vector<void*> evicted;
+        {
+            std::lock_guard lock(mLock);
+            // Entries are in release order, so the stale ones are at the front
+            auto it = mEntries.begin();
+            for (; it != mEntries.end() && now - it->released > timeout; ++it) {
+                evicted.push_back(it->address);
+                mBytes -= it->size;
+            }
+            mEntries.erase(mEntries.begin(), it);
+        }
+        freeAll(evicted);
+    }
+
+    void dump(String8& log) {
+        std::lock_guard lock(mLock);
+        log.appendFormat("Bitmap pool: %zu buffers, %.2fMB of %.2fMB (hits = %u, misses = %u)\n",
+                         mEntries.size(), mBytes / 1000000.f, mBudgetBytes / 1000000.f, mHits,
+                         mMisses);
+    }
+
+private:
+    explicit PixelPool(size_t budgetBytes) : mBudgetBytes(budgetBytes) {}
+
+    // Small allocations are cheap for malloc to serve from its own free lists, and a buffer
+    // larger than a quarter of the pool would push out everything else.
+    static constexpr size_t kMinPooledBytes = 64 * 1024;
+    bool isPooledSize(size_t size) const {
+        return size >= kMinPooledBytes && size <= mBudgetBytes / 4;
+    }
+
+    static size_t roundUp(size_t size) {
+        const int highestBit = 63 - __builtin_clzll(static_cast<unsigned long long>(size));
+        const size_t step = (static_cast<size_t>(1) << highestBit) / 8;
+        return (size + step - 1) / step * step;
+    }
+
+    static void freeAll(const std::vector<void*>& addresses) {
+        if (addresses.empty()) {
+            return;
+        }
+        for (void* address : addresses) {
+            free(address);
+        }
+        purgeFreedHeap();
+    }
+
+    struct Entry {
+        void* address;
+        size_t size;
+        nsecs_t released;
+    };
+
+    const size_t mBudgetBytes;
+    std::mutex mLock;
+    // In the order they were released.
+    std::vector<Entry> mEntries;
+    size_t mBytes = 0;
+    uint32_t mHits = 0;
+    uint32_t mMisses = 0;
+};
+
+void Bitmap::trimPixelPool(nsecs_t now, nsecs_t timeout) {
+    PixelPool::get().trim(now, timeout);
+}
+
+void Bitmap::purgePixelPool() {
+    PixelPool::get().trim(std::numeric_limits<nsecs_t>::max(), -1);
+}
+
+void Bitmap::dumpPixelPool(String8& log) {
+    PixelPool::get().dump(log);
+}
+
 bool Bitmap::computeAllocationSize(size_t rowBytes, int height, size_t* size) {
     return 0 <= height && height <= std::numeric_limits<size_t>::max() &&
            !__builtin_mul_overflow(rowBytes, (size_t)height, size) &&
@@ -169,7 +319,10 @@ sk_sp<Bitmap> Bitmap::allocateHeapBitmap(const SkImageInfo& info) {
 }
 
 sk_sp<Bitmap> Bitmap::allocateHeapBitmap(size_t size, const SkImageInfo& info, size_t rowBytes) {
-    void* addr = calloc(size, 1);
+    void* addr = PixelPool::get().acquire(&size);
+    if (!addr) {
+        addr = calloc(size, 1);
+    }
     if (!addr) {
         return nullptr;
     }
@@ -312,10 +465,10 @@ Bitmap::~Bitmap() {
             close(mPixelStorage.ashmem.fd);
             break;
         case PixelStorageType::Heap:
-            free(mPixelStorage.heap.address);
-#ifdef __ANDROID__
-            mallopt(M_PURGE, 0);
-#endif
+            if (!PixelPool::get().release(mPixelStorage.heap.address, mPixelStorage.heap.size)) {
+                free(mPixelStorage.heap.address);
+                purgeFreedHeap();
+            }
             break;
         case PixelStorageType::Hardware:
 #ifdef __ANDROID__ // Layoutlib does not support hardware acceleration
@@ -24,6 +24,7 @@
 #include <SkRefCnt.h>
 #include <cutils/compiler.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 #include <optional>
 
@@ -58,6 +59,7 @@ class RenderThread;
 }
 
 class PixelStorage;
+class String8;
 
 typedef void (*FreeFunc)(void* addr, void* context);
 
@@ -78,6 +80,16 @@ public:
     static sk_sp<Bitmap> allocateHeapBitmap(const SkImageInfo& info);
     static sk_sp<Bitmap> allocateHeapBitmap(size_t size, const SkImageInfo& i, size_t rowBytes);
 
+    /* Large heap bitmaps return their pixel memory to a process-wide pool when destroyed, and
+     * allocateHeapBitmap takes it from there when a bitmap of about the same size is decoded or
+     * created next. This saves faulting in fresh pages for every image of a scrolling feed. The
+     * pool is bounded by MemoryPolicy::bitmapPoolBytes.
+     */
+    // Drops the pooled memory that wasn't reused since `now - timeout`.
+    static void trimPixelPool(nsecs_t now, nsecs_t timeout);
+    static void purgePixelPool();
+    static void dumpPixelPool(String8& log);
+
     /* The createFrom factories construct a new Bitmap object by wrapping the already allocated
      * memory that is provided as an input param.
      */
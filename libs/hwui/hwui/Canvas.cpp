@@ -16,6 +16,7 @@
 
 #include "Canvas.h"
 
+#include "GlyphRunCache.h"
 #include "MinikinUtils.h"
 #include "Paint.h"
 #include "Properties.h"
@@ -84,9 +85,9 @@ static void simplifyPaint(int color, Paint* paint) {
 
 class DrawTextFunctor {
 public:
-    DrawTextFunctor(const minikin::Layout& layout, Canvas* canvas, const Paint& paint, float x,
+    DrawTextFunctor(const TextGlyphs& glyphs, Canvas* canvas, const Paint& paint, float x,
                     float y, float totalAdvance)
-            : layout(layout)
+            : glyphs(glyphs)
             , canvas(canvas)
             , paint(paint)
             , x(x)
@@ -96,9 +97,9 @@ public:
     void operator()(size_t start, size_t end) {
         auto glyphFunc = [&](uint16_t* text, float* positions) {
             for (size_t i = start, textIndex = 0, posIndex = 0; i < end; i++) {
-                text[textIndex++] = layout.getGlyphId(i);
-                positions[posIndex++] = x + layout.getX(i);
-                positions[posIndex++] = y + layout.getY(i);
+                text[textIndex++] = glyphs.getGlyphId(i);
+                positions[posIndex++] = x + glyphs.getX(i);
+                positions[posIndex++] = y + glyphs.getY(i);
             }
         };
 
@@ -131,7 +132,7 @@ public:
     }
 
 private:
-    const minikin::Layout& layout;
+    const TextGlyphs& glyphs;
     Canvas* canvas;
     const Paint& paint;
     float x;
@@ -170,18 +171,26 @@ void Canvas::drawText(const uint16_t* text, int textSize, int start, int count,
         paint.getSkFont().setHinting(SkFontHinting::kNone);
     }
 
-    minikin::Layout layout = MinikinUtils::doLayout(&paint, bidiFlags, typeface, text, textSize,
-                                                    start, count, contextStart, contextCount, mt);
+    std::shared_ptr<const TextGlyphs> glyphs;
+    if (mt == nullptr && GlyphRunCache::canCache(contextCount)) {
+        glyphs = GlyphRunCache::get().getGlyphs(paint, typeface, bidiFlags, text, start, count,
+                                                contextStart, contextCount);
+    } else {
+        minikin::Layout layout = MinikinUtils::doLayout(&paint, bidiFlags, typeface, text,
+                                                        textSize, start, count, contextStart,
+                                                        contextCount, mt);
+        glyphs = std::make_shared<const TextGlyphs>(TextGlyphs::fromLayout(layout));
+    }
 
-    x += MinikinUtils::xOffsetForTextAlign(&paint, layout);
+    x += MinikinUtils::xOffsetForTextAlign(&paint, glyphs->getAdvance());
 
     // Set align to left for drawing, as we don't want individual
     // glyphs centered or right-aligned; the offset above takes
     // care of all alignment.
     paint.setTextAlign(Paint::kLeft_Align);
 
-    DrawTextFunctor f(layout, this, paint, x, y, layout.getAdvance());
-    MinikinUtils::forFontRun(layout, &paint, f);
+    DrawTextFunctor f(*glyphs, this, paint, x, y, glyphs->getAdvance());
+    MinikinUtils::forFontRun(*glyphs, &paint, f);
 }
 
 void Canvas::drawDoubleRoundRectXY(float outerLeft, float outerTop, float outerRight,
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FontLoadStats.h"
+
+#include <minikin/FontCollection.h>
+#include <minikin/FontFamily.h>
+#include <minikin/LocaleList.h>
+
+#include "MinikinSkia.h"
+#include "Typeface.h"
+
+namespace android {
+
+FontLoadStats& FontLoadStats::get() {
+    static FontLoadStats* sStats = new FontLoadStats();
+    return *sStats;
+}
+
+void FontLoadStats::onFontDeferred() {
+    std::lock_guard lock(mLock);
+    mDeferredCount++;
+}
+
+void FontLoadStats::onFontLoaded(std::string_view path, int ttcIndex, nsecs_t duration) {
+    std::lock_guard lock(mLock);
+    mLoadedCount++;
+    mLoadTime += duration;
+    if (!path.empty()) {
+        mLoadedFonts.emplace(std::string(path), ttcIndex);
+    }
+}
+
+bool FontLoadStats::isLoaded(const minikin::Font& font) {
+    minikin::BufferReader reader = font.typefaceMetadataReader();
+    if (reader.current() != nullptr) {
+        // A system font read from the shared buffer. Its MinikinFont is only made on first use,
+        // and asking for it here would make it, so look the file up instead.
+        std::string_view path = reader.readString();
+        int ttcIndex = reader.read<int>();
+        std::lock_guard lock(mLock);
+        return mLoadedFonts.count(std::make_pair(std::string(path), ttcIndex)) != 0;
+    }
+    return static_cast<const MinikinFontSkia*>(font.typeface().get())->isTypefaceLoaded();
+}
+
+void FontLoadStats::dump(String8& log) {
+    {
+        std::lock_guard lock(mLock);
+        log.appendFormat("Fonts: %u deferred, %u loaded in %.2fms\n", mDeferredCount,
+                         mLoadedCount, mLoadTime / 1000000.f);
+    }
+
+    const Typeface* typeface = Typeface::resolveDefault(nullptr);
+    if (typeface == nullptr || typeface->fFontCollection == nullptr) {
+        return;
+    }
+    const minikin::FontCollection& collection = *typeface->fFontCollection;
+    size_t untouchedFamilies = 0;
+    for (size_t i = 0; i < collection.getFamilyCount(); i++) {
+        const std::shared_ptr<minikin::FontFamily>& family = collection.getFamilyAt(i);
+        size_t loaded = 0;
+        for (size_t j = 0; j < family->getNumFonts(); j++) {
+            if (isLoaded(*family->getFont(j))) {
+                loaded++;
+            }
+        }
+        if (loaded == 0) {
+            untouchedFamilies++;
+            continue;
+        }
+        std::string locales = minikin::getLocaleString(family->localeListId());
+        log.appendFormat("  Family %zu [%s]: %zu of %zu fonts loaded\n", i, locales.c_str(),
+                         loaded, family->getNumFonts());
+    }
+    log.appendFormat("  %zu of %zu fallback families never loaded a font\n", untouchedFamilies,
+                     collection.getFamilyCount());
+}
+
+}  // namespace android
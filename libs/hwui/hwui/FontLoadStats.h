@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <minikin/Font.h>
+#include <utils/Macros.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace android {
+
+/**
+ * Process-wide record of which fonts had their SkTypeface created. Most system fonts are only
+ * there to cover scripts that an app never renders, so MinikinFontSkia defers parsing a font until
+ * it is first used to measure or draw a glyph, and this is how dumpsys gfxinfo shows which ones
+ * actually were.
+ */
+class FontLoadStats {
+    PREVENT_COPY_AND_ASSIGN(FontLoadStats);
+
+public:
+    static FontLoadStats& get();
+
+    // Called when a font is created without parsing it.
+    void onFontDeferred();
+    // Called when a deferred font creates its SkTypeface, which took `duration`.
+    void onFontLoaded(std::string_view path, int ttcIndex, nsecs_t duration);
+
+    // Whether the given font is one of the system fonts whose typeface was created, or is not a
+    // deferred font at all. Never forces the typeface to be created.
+    bool isLoaded(const minikin::Font& font);
+
+    // Prints the totals, and for every family of the default font collection that had a font
+    // loaded how many of its fonts were.
+    void dump(String8& log);
+
+private:
+    FontLoadStats() {}
+
+    std::mutex mLock;
+    // Path and collection index of every font file that was parsed.
+    std::set<std::pair<std::string, int>> mLoadedFonts;
+    uint32_t mDeferredCount = 0;
+    uint32_t mLoadedCount = 0;
+    nsecs_t mLoadTime = 0;
+};
+
+}  // namespace android
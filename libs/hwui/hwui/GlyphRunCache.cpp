@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GlyphRunCache.h"
+
+#include <functional>
+#include <string_view>
+
+#include "MinikinSkia.h"
+#include "MinikinUtils.h"
+
+namespace android {
+
+TextGlyphs TextGlyphs::fromLayout(const minikin::Layout& layout) {
+    TextGlyphs glyphs;
+    const size_t nGlyphs = layout.nGlyphs();
+    glyphs.glyphIds.reserve(nGlyphs);
+    glyphs.positions.reserve(2 * nGlyphs);
+    glyphs.advance = layout.getAdvance();
+
+    const minikin::MinikinFont* curFont = nullptr;
+    for (size_t i = 0; i < nGlyphs; i++) {
+        glyphs.glyphIds.push_back(layout.getGlyphId(i));
+        glyphs.positions.push_back(layout.getX(i));
+        glyphs.positions.push_back(layout.getY(i));
+
+        // Split runs exactly like MinikinUtils::forFontRun does.
+        const auto& font = layout.getFont(i)->typeface();
+        if (i == 0 || font.get() != curFont) {
+            if (!glyphs.runs.empty()) {
+                glyphs.runs.back().end = i;
+            }
+            glyphs.runs.push_back({i, nGlyphs, font, layout.getFakery(i)});
+            curFont = font.get();
+        }
+    }
+    return glyphs;
+}
+
+GlyphRunCache& GlyphRunCache::get() {
+    static GlyphRunCache* sCache = new GlyphRunCache();
+    return *sCache;
+}
+
+bool GlyphRunCache::Key::operator==(const Key& other) const {
+    return start == other.start && count == other.count && bidiFlags == other.bidiFlags &&
+           fontCollection == other.fontCollection && fontStyle == other.fontStyle &&
+           size == other.size && scaleX == other.scaleX && skewX == other.skewX &&
+           letterSpacing == other.letterSpacing && wordSpacing == other.wordSpacing &&
+           fontFlags == other.fontFlags && localeListId == other.localeListId &&
+           familyVariant == other.familyVariant && startHyphen == other.startHyphen &&
+           endHyphen == other.endHyphen && text == other.text &&
+           fontFeatureSettings == other.fontFeatureSettings;
+}
+
+size_t GlyphRunCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<std::u16string_view>()(key.text);
+    auto combine = [&hash](size_t value) { hash = hash * 31 + value; };
+    combine(key.start);
+    combine(key.count);
+    combine(static_cast<size_t>(key.bidiFlags));
+    combine(std::hash<const void*>()(key.fontCollection.get()));
+    combine(std::hash<float>()(key.size));
+    combine(std::hash<float>()(key.letterSpacing));
+    combine(key.fontFlags);
+    combine(key.localeListId);
+    return hash;
+}
+
+std::shared_ptr<const TextGlyphs> GlyphRunCache::getGlyphs(const Paint& paint,
+                                                           const Typeface* typeface,
+                                                           minikin::Bidi bidiFlags,
+                                                           const uint16_t* text, size_t start,
+                                                           size_t count, size_t contextStart,
+                                                           size_t contextCount) {
+    const Typeface* resolvedFace = Typeface::resolveDefault(typeface);
+    const SkFont& font = paint.getSkFont();
+    // Mirrors MinikinUtils::prepareMinikinPaint, minus creating the MinikinPaint itself.
+    Key key{
+            .text = std::u16string(reinterpret_cast<const char16_t*>(text + contextStart),
+                                   contextCount),
+            .start = static_cast<uint32_t>(start - contextStart),
+            .count = static_cast<uint32_t>(count),
+            .bidiFlags = bidiFlags,
+            .fontCollection = resolvedFace->fFontCollection,
+            .fontStyle = resolvedFace->fStyle,
+            .size = font.isLinearMetrics() ? font.getSize()
+                                           : static_cast<int>(font.getSize()),
+            .scaleX = font.getScaleX(),
+            .skewX = font.getSkewX(),
+            .letterSpacing = paint.getLetterSpacing(),
+            .wordSpacing = paint.getWordSpacing(),
+            .fontFlags = MinikinFontSkia::packFontFlags(font),
+            .localeListId = paint.getMinikinLocaleListId(),
+            .familyVariant = paint.getFamilyVariant(),
+            .startHyphen = paint.getStartHyphenEdit(),
+            .endHyphen = paint.getEndHyphenEdit(),
+            .fontFeatureSettings = paint.getFontFeatureSettings(),
+    };
+
+    {
+        std::lock_guard lock(mLock);
+        auto it = mIndex.find(key);
+        if (it != mIndex.end()) {
+            mEntries.splice(mEntries.begin(), mEntries, it->second);
+            return it->second->glyphs;
+        }
+    }
+
+    // Lay out without holding the lock, other threads may be drawing text at the same time.
+    minikin::Layout layout =
+            MinikinUtils::doLayout(&paint, bidiFlags, typeface, text, contextStart + contextCount,
+                                   start, count, contextStart, contextCount, nullptr);
+    auto glyphs = std::make_shared<const TextGlyphs>(TextGlyphs::fromLayout(layout));
+
+    std::lock_guard lock(mLock);
+    if (mIndex.count(key)) {
+        return glyphs;
+    }
+    if (mEntries.size() >= kMaxEntries) {
+        mIndex.erase(mEntries.back().key);
+        mEntries.pop_back();
+    }
+    mEntries.push_front(Entry{key, glyphs});
+    mIndex.emplace(std::move(key), mEntries.begin());
+    return glyphs;
+}
+
+void GlyphRunCache::clear() {
+    std::lock_guard lock(mLock);
+    mIndex.clear();
+    mEntries.clear();
+}
+
+size_t GlyphRunCache::size() {
+    std::lock_guard lock(mLock);
+    return mEntries.size();
+}
+
+}  // namespace android
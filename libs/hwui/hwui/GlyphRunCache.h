@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <minikin/FontCollection.h>
+#include <minikin/Layout.h>
+#include <utils/Macros.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Paint.h"
+#include "Typeface.h"
+
+namespace android {
+
+/**
+ * The glyphs of a laid out piece of text, positioned relative to the text's origin and split into
+ * runs that share a font. It mirrors the parts of minikin::Layout that drawing needs, so it can
+ * be kept around and drawn again without redoing the layout.
+ */
+struct TextGlyphs {
+    struct Run {
+        size_t start;
+        size_t end;
+        std::shared_ptr<minikin::MinikinFont> font;
+        minikin::FontFakery fakery;
+    };
+
+    std::vector<uint16_t> glyphIds;
+    // x and y of each glyph.
+    std::vector<float> positions;
+    std::vector<Run> runs;
+    float advance = 0;
+
+    static TextGlyphs fromLayout(const minikin::Layout& layout);
+
+    size_t nGlyphs() const { return glyphIds.size(); }
+    float getAdvance() const { return advance; }
+    uint16_t getGlyphId(size_t i) const { return glyphIds[i]; }
+    float getX(size_t i) const { return positions[2 * i]; }
+    float getY(size_t i) const { return positions[2 * i + 1]; }
+};
+
+/**
+ * Process-wide cache of TextGlyphs for short, plain text runs, used by Canvas::drawText. Minikin
+ * caches the shaping itself, but reaching that cache costs a MinikinPaint conversion and bidi
+ * analysis on every draw. Labels in list items draw the same few strings over and over, and with
+ * this cache skip layout entirely.
+ *
+ * Entries are keyed by the text, the bidi flags, the resolved typeface and every Paint parameter
+ * that feeds into the layout. Font parameters that only affect rasterization, like hinting, come
+ * from the Paint at draw time instead and are not part of the key.
+ */
+class GlyphRunCache {
+    PREVENT_COPY_AND_ASSIGN(GlyphRunCache);
+
+public:
+    static GlyphRunCache& get();
+
+    // Whether doLayout of this much context is worth caching. Long text is rarely repeated
+    // verbatim and would only push out the labels the cache is for.
+    static bool canCache(size_t contextCount) { return contextCount <= kMaxTextLength; }
+
+    // Returns the glyphs for the given text and paint, laying the text out only on a miss.
+    std::shared_ptr<const TextGlyphs> getGlyphs(const Paint& paint, const Typeface* typeface,
+                                                minikin::Bidi bidiFlags, const uint16_t* text,
+                                                size_t start, size_t count, size_t contextStart,
+                                                size_t contextCount);
+
+    void clear();
+    size_t size();
+
+    static constexpr size_t kMaxTextLength = 128;
+    static constexpr size_t kMaxEntries = 512;
+
+private:
+    GlyphRunCache() {}
+
+    struct Key {
+        // The context of the text, and which part of it is drawn.
+        std::u16string text;
+        uint32_t start;
+        uint32_t count;
+        minikin::Bidi bidiFlags;
+        // Kept alive by the entry, so the pointer can't be reused by another collection.
+        std::shared_ptr<minikin::FontCollection> fontCollection;
+        minikin::FontStyle fontStyle;
+        float size;
+        float scaleX;
+        float skewX;
+        float letterSpacing;
+        float wordSpacing;
+        uint32_t fontFlags;
+        uint32_t localeListId;
+        minikin::FamilyVariant familyVariant;
+        minikin::StartHyphenEdit startHyphen;
+        minikin::EndHyphenEdit endHyphen;
+        std::string fontFeatureSettings;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<const TextGlyphs> glyphs;
+    };
+
+    std::mutex mLock;
+    // Most recently used first.
+    std::list<Entry> mEntries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> mIndex;
+};
+
+}  // namespace android
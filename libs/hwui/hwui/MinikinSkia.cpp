@@ -16,6 +16,7 @@
 
 #include "MinikinSkia.h"
 
+#include <SkData.h>
 #include <SkFont.h>
 #include <SkFontDescriptor.h>
 #include <SkFontMetrics.h>
@@ -24,12 +25,17 @@
 #include <SkScalar.h>
 #include <SkStream.h>
 #include <SkTypeface.h>
+#include <gui/TraceUtils.h>
 #include <log/log.h>
+#include <utils/Timers.h>
 
 #include <minikin/Font.h>
 #include <minikin/MinikinExtent.h>
 #include <minikin/MinikinPaint.h>
 #include <minikin/MinikinRect.h>
+#include <ui/FatVector.h>
+
+#include "FontLoadStats.h"
 
 namespace android {
 
@@ -37,6 +43,7 @@ MinikinFontSkia::MinikinFontSkia(sk_sp<SkTypeface> typeface, int sourceId, const
                                  size_t fontSize, std::string_view filePath, int ttcIndex,
                                  const std::vector<minikin::FontVariation>& axes)
         : mTypeface(std::move(typeface))
+        , mTypefaceLoaded(true)
         , mSourceId(sourceId)
         , mFontData(fontData)
         , mFontSize(fontSize)
@@ -44,6 +51,49 @@ MinikinFontSkia::MinikinFontSkia(sk_sp<SkTypeface> typeface, int sourceId, const
         , mAxes(axes)
         , mFilePath(filePath) {}
 
+MinikinFontSkia::MinikinFontSkia(sk_sp<SkData> data, int sourceId, const void* fontData,
+                                 size_t fontSize, std::string_view filePath, int ttcIndex,
+                                 const std::vector<minikin::FontVariation>& axes)
+        : mTypefaceLoaded(false)
+        , mDeferredData(std::move(data))
+        , mSourceId(sourceId)
+        , mFontData(fontData)
+        , mFontSize(fontSize)
+        , mTtcIndex(ttcIndex)
+        , mAxes(axes)
+        , mFilePath(filePath) {
+    FontLoadStats::get().onFontDeferred();
+}
+
+MinikinFontSkia::~MinikinFontSkia() {}
+
+void MinikinFontSkia::loadTypeface() const {
+    std::call_once(mLoadTypefaceOnce, [this]() {
+        ATRACE_FORMAT("Parsing font %s", mFilePath.c_str());
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        FatVector<SkFontArguments::VariationPosition::Coordinate, 2> skVariation;
+        for (const auto& axis : mAxes) {
+            skVariation.push_back({axis.axisTag, axis.value});
+        }
+        SkFontArguments args;
+        args.setCollectionIndex(mTtcIndex);
+        args.setVariationDesignPosition(
+                {skVariation.data(), static_cast<int>(skVariation.size())});
+
+        // The stream shares mDeferredData, which keeps mFontData valid whether or not this works.
+        std::unique_ptr<SkStreamAsset> stream(new SkMemoryStream(mDeferredData));
+        sk_sp<SkFontMgr> fm(SkFontMgr::RefDefault());
+        mTypeface = fm->makeFromStream(std::move(stream), args);
+        if (mTypeface == nullptr) {
+            // Measuring and drawing fall back to the default typeface.
+            ALOGE("Failed to create SkTypeface for font %s", mFilePath.c_str());
+        }
+        FontLoadStats::get().onFontLoaded(mFilePath, mTtcIndex,
+                                          systemTime(SYSTEM_TIME_MONOTONIC) - start);
+        mTypefaceLoaded.store(true, std::memory_order_release);
+    });
+}
+
 static void MinikinFontSkia_SetSkiaFont(const minikin::MinikinFont* font, SkFont* skFont,
                                         const minikin::MinikinPaint& paint,
                                         const minikin::FontFakery& fakery) {
@@ -103,11 +153,14 @@ void MinikinFontSkia::GetFontExtent(minikin::MinikinExtent* extent,
 }
 
 SkTypeface* MinikinFontSkia::GetSkTypeface() const {
+    if (!isTypefaceLoaded()) {
+        loadTypeface();
+    }
     return mTypeface.get();
 }
 
 sk_sp<SkTypeface> MinikinFontSkia::RefSkTypeface() const {
-    return mTypeface;
+    return sk_ref_sp(GetSkTypeface());
 }
 
 const void* MinikinFontSkia::GetFontData() const {
@@ -128,6 +181,11 @@ const std::vector<minikin::FontVariation>& MinikinFontSkia::GetAxes() const {
 
 std::shared_ptr<minikin::MinikinFont> MinikinFontSkia::createFontWithVariation(
         const std::vector<minikin::FontVariation>& variations) const {
+    if (mDeferredData != nullptr) {
+        // The variation can wait for its first glyph just like this font did.
+        return std::make_shared<MinikinFontSkia>(mDeferredData, mSourceId, mFontData, mFontSize,
+                                                 mFilePath, mTtcIndex, variations);
+    }
     SkFontArguments args;
 
     int ttcIndex;
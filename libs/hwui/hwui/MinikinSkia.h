@@ -20,9 +20,13 @@
 #include <SkRefCnt.h>
 #include <cutils/compiler.h>
 #include <minikin/MinikinFont.h>
+
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <string_view>
 
+class SkData;
 class SkFont;
 class SkTypeface;
 
@@ -34,6 +38,13 @@ public:
                     std::string_view filePath, int ttcIndex,
                     const std::vector<minikin::FontVariation>& axes);
 
+    // Creates a font that only parses `data` into an SkTypeface the first time it is needed to
+    // measure or draw a glyph. `fontData` and `fontSize` must describe the contents of `data`.
+    MinikinFontSkia(sk_sp<SkData> data, int sourceId, const void* fontData, size_t fontSize,
+                    std::string_view filePath, int ttcIndex,
+                    const std::vector<minikin::FontVariation>& axes);
+    ~MinikinFontSkia() override;
+
     float GetHorizontalAdvance(uint32_t glyph_id, const minikin::MinikinPaint& paint,
                                const minikin::FontFakery& fakery) const override;
 
@@ -53,6 +64,8 @@ public:
 
     SkTypeface* GetSkTypeface() const;
     sk_sp<SkTypeface> RefSkTypeface() const;
+    // Whether the SkTypeface exists yet. Unlike the accessors above, never creates it.
+    bool isTypefaceLoaded() const { return mTypefaceLoaded.load(std::memory_order_acquire); }
 
     // Access to underlying raw font bytes
     const void* GetFontData() const;
@@ -72,7 +85,14 @@ public:
                                minikin::FontFakery fakery);
 
 private:
-    sk_sp<SkTypeface> mTypeface;
+    void loadTypeface() const;
+
+    // Set once, by loadTypeface() for deferred fonts, and never changed after mTypefaceLoaded.
+    mutable sk_sp<SkTypeface> mTypeface;
+    mutable std::atomic<bool> mTypefaceLoaded;
+    mutable std::once_flag mLoadTypefaceOnce;
+    // The font file a deferred font creates its typeface from, null otherwise.
+    sk_sp<SkData> mDeferredData;
 
     int mSourceId;
     // A raw pointer to the font data - it should be owned by some other object with
@@ -110,13 +110,13 @@ bool MinikinUtils::hasVariationSelector(const Typeface* typeface, uint32_t codep
     return resolvedFace->fFontCollection->hasVariationSelector(codepoint, vs);
 }
 
-float MinikinUtils::xOffsetForTextAlign(Paint* paint, const minikin::Layout& layout) {
+float MinikinUtils::xOffsetForTextAlign(Paint* paint, float advance) {
     switch (paint->getTextAlign()) {
         case Paint::kCenter_Align:
-            return layout.getAdvance() * -0.5f;
+            return advance * -0.5f;
             break;
         case Paint::kRight_Align:
-            return -layout.getAdvance();
+            return -advance;
             break;
         default:
             break;
@@ -27,6 +27,7 @@
 #include <cutils/compiler.h>
 #include <log/log.h>
 #include <minikin/Layout.h>
+#include "GlyphRunCache.h"
 #include "MinikinSkia.h"
 #include "Paint.h"
 #include "Typeface.h"
@@ -63,7 +64,10 @@ public:
     static bool hasVariationSelector(const Typeface* typeface, uint32_t codepoint,
                                                  uint32_t vs);
 
-    static float xOffsetForTextAlign(Paint* paint, const minikin::Layout& layout);
+    static float xOffsetForTextAlign(Paint* paint, const minikin::Layout& layout) {
+        return xOffsetForTextAlign(paint, layout.getAdvance());
+    }
+    static float xOffsetForTextAlign(Paint* paint, float advance);
 
     static float hOffsetForTextAlign(Paint* paint, const minikin::Layout& layout,
                                                  const SkPath& path);
@@ -95,6 +99,20 @@ public:
             skfont->setEmbolden(savefakeBold);
         }
     }
+
+    // Same as above, for glyphs that were already split into runs.
+    template <typename F>
+    static void forFontRun(const TextGlyphs& glyphs, Paint* paint, F& f) {
+        float saveSkewX = paint->getSkFont().getSkewX();
+        bool savefakeBold = paint->getSkFont().isEmbolden();
+        for (const TextGlyphs::Run& run : glyphs.runs) {
+            SkFont* skfont = &paint->getSkFont();
+            MinikinFontSkia::populateSkFont(skfont, run.font.get(), run.fakery);
+            f(run.start, run.end);
+            skfont->setSkewX(saveSkewX);
+            skfont->setEmbolden(savefakeBold);
+        }
+    }
 };
 
 }  // namespace android
@@ -143,8 +143,11 @@ Typeface* Typeface::createFromFamilies(std::vector<std::shared_ptr<minikin::Font
                 families.empty()
                         ? nullptr
                         : families[0]->getClosestMatch(defaultStyle).font->typeface().get();
-        if (mf != nullptr) {
-            SkTypeface* skTypeface = reinterpret_cast<const MinikinFontSkia*>(mf)->GetSkTypeface();
+        // A deferred font that fails to load has no SkTypeface.
+        SkTypeface* skTypeface =
+                mf != nullptr ? reinterpret_cast<const MinikinFontSkia*>(mf)->GetSkTypeface()
+                              : nullptr;
+        if (skTypeface != nullptr) {
             const SkFontStyle& style = skTypeface->fontStyle();
             weightFromFont = style.weight();
             italicFromFont = style.slant() != SkFontStyle::kUpright_Slant;
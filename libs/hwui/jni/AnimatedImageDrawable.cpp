@@ -78,9 +78,10 @@ static jlong AnimatedImageDrawable_nCreate(JNIEnv* env, jobject /*clazz*/,
 
     size_t bytesUsed = info.computeMinByteSize();
     // SkAnimatedImage has one SkBitmap for decoding, plus an extra one if there is a
-    // kRestorePrevious frame. AnimatedImageDrawable has two SkPictures storing the current
+    // kRestorePrevious frame. AnimatedImageDrawable has two bitmaps storing the current
     // frame and the next frame. (The former assumes that the image is animated, and the
-    // latter assumes that it is drawn to a hardware canvas.)
+    // latter assumes that it is drawn to a hardware canvas.) Frames it decodes further ahead
+    // are added by AnimatedImageDrawable::byteSize().
     bytesUsed *= hasRestoreFrame ? 4 : 3;
     sk_sp<SkPicture> picture;
     if (jpostProcess) {
@@ -109,7 +110,7 @@ static jlong AnimatedImageDrawable_nCreate(JNIEnv* env, jobject /*clazz*/,
     bytesUsed += sizeof(animatedImg.get());
 
     sk_sp<AnimatedImageDrawable> drawable(
-            new AnimatedImageDrawable(std::move(animatedImg), bytesUsed, format));
+            new AnimatedImageDrawable(std::move(animatedImg), bytesUsed, format, info));
     return reinterpret_cast<jlong>(drawable.release());
 }
 
@@ -20,10 +20,15 @@
 #include "BitmapRegionDecoder.h"
 
 #include <HardwareBitmapUploader.h>
+#include <Properties.h>
 #include <androidfw/Asset.h>
 #include <sys/stat.h>
+#include <thread/CommonPool.h>
 
+#include <algorithm>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include "BitmapFactory.h"
 #include "CreateJavaOutputStreamAdaptor.h"
@@ -41,11 +46,42 @@
 using namespace android;
 
 namespace android {
+
+/**
+ *  Allocator for one band of a tiled decode. The band's pixels alias its rows of the output
+ *  bitmap, so the bands are decoded in place and never copied.
+ */
+class BandPixelAllocator : public skia::BRDAllocator {
+public:
+    BandPixelAllocator(const SkBitmap& output, int top, int height)
+            : mOutput(output), mTop(top), mHeight(height) {}
+
+    bool allocPixelRef(SkBitmap* bitmap) override {
+        const SkImageInfo& info = bitmap->info();
+        if (info.width() != mOutput.width() || info.height() != mHeight ||
+            info.colorType() != mOutput.colorType()) {
+            return false;
+        }
+        mAlphaType = info.alphaType();
+        return bitmap->installPixels(info, mOutput.getAddr(0, mTop), mOutput.rowBytes());
+    }
+
+    SkCodec::ZeroInitialized zeroInit() const override { return SkCodec::kYes_ZeroInitialized; }
+
+    SkAlphaType alphaType() const { return mAlphaType; }
+
+private:
+    const SkBitmap& mOutput;
+    const int mTop;
+    const int mHeight;
+    SkAlphaType mAlphaType = kUnknown_SkAlphaType;
+};
+
 class BitmapRegionDecoderWrapper {
 public:
     static std::unique_ptr<BitmapRegionDecoderWrapper> Make(sk_sp<SkData> data) {
         std::unique_ptr<skia::BitmapRegionDecoder> mainImageBRD =
-                skia::BitmapRegionDecoder::Make(std::move(data));
+                skia::BitmapRegionDecoder::Make(data);
         if (!mainImageBRD) {
             return nullptr;
         }
@@ -68,8 +104,9 @@ public:
         }
 
         return std::unique_ptr<BitmapRegionDecoderWrapper>(
-                new BitmapRegionDecoderWrapper(std::move(mainImageBRD), std::move(gainmapBRD),
-                                               gainmapInfo, std::move(gainmapStream)));
+                new BitmapRegionDecoderWrapper(std::move(data), std::move(mainImageBRD),
+                                               std::move(gainmapBRD), gainmapInfo,
+                                               std::move(gainmapStream)));
     }
 
     SkEncodedImageFormat getEncodedFormat() { return mMainImageBRD->getEncodedFormat(); }
@@ -90,6 +127,108 @@ public:
                                            requireUnpremul, prefColorSpace);
     }
 
+    /**
+     *  Decodes a large region as horizontal bands in parallel, one band on the calling thread
+     *  and the others on the CommonPool. Every band has its own decoder, so no codec state is
+     *  shared between threads. The bands are decoded straight into a new heap bitmap.
+     *
+     *  Returns nullptr if the region is too small to be worth splitting, if the format can't be
+     *  decoded in bands, or if any band fails; the caller then decodes the region serially.
+     */
+    sk_sp<Bitmap> decodeRegionTiled(const SkIRect& subset, int sampleSize, SkColorType colorType,
+                                    bool requireUnpremul, sk_sp<SkColorSpace> colorSpace) {
+        if (!Properties::tiledRegionDecode || !canDecodeInBands(getEncodedFormat())) {
+            return nullptr;
+        }
+        sampleSize = std::max(sampleSize, 1);
+        // Regions that are not fully inside the image are placed at an offset in the output,
+        // and for the whole image some codecs round the sampled size differently. Both are
+        // left to the serial decode.
+        const SkIRect bounds = SkIRect::MakeWH(width(), height());
+        if (subset.isEmpty() || !bounds.contains(subset) ||
+            (sampleSize > 1 && subset == bounds)) {
+            return nullptr;
+        }
+        if (subset.width() < sampleSize || subset.height() < sampleSize) {
+            return nullptr;
+        }
+        const int outWidth = subset.width() / sampleSize;
+        const int outHeight = subset.height() / sampleSize;
+        if (static_cast<int64_t>(outWidth) * outHeight < kMinTiledDecodePixels) {
+            return nullptr;
+        }
+
+        // Every band but the last covers a multiple of the tallest JPEG MCU, so the band
+        // boundaries fall on MCU rows.
+        int bandCount = std::min(kMaxBands, outHeight / kMinBandHeight);
+        if (bandCount < 2) {
+            return nullptr;
+        }
+        int bandHeight = (outHeight + bandCount - 1) / bandCount;
+        bandHeight = (bandHeight + kBandAlignment - 1) / kBandAlignment * kBandAlignment;
+        bandCount = (outHeight + bandHeight - 1) / bandHeight;
+        if (bandCount < 2) {
+            return nullptr;
+        }
+        for (int i = static_cast<int>(mWorkerBRDs.size()); i < bandCount - 1; i++) {
+            std::unique_ptr<skia::BitmapRegionDecoder> brd = skia::BitmapRegionDecoder::Make(mData);
+            if (!brd) {
+                return nullptr;
+            }
+            mWorkerBRDs.push_back(std::move(brd));
+        }
+
+        // kPremul_SkAlphaType is a placeholder, the bands report the actual alpha type.
+        sk_sp<Bitmap> output = Bitmap::allocateHeapBitmap(
+                SkImageInfo::Make(outWidth, outHeight, colorType, kPremul_SkAlphaType, colorSpace));
+        if (!output) {
+            return nullptr;
+        }
+        SkBitmap outputBitmap;
+        output->getSkBitmap(&outputBitmap);
+
+        std::vector<std::unique_ptr<BandPixelAllocator>> allocators;
+        for (int band = 0; band < bandCount; band++) {
+            const int top = band * bandHeight;
+            allocators.push_back(std::make_unique<BandPixelAllocator>(
+                    outputBitmap, top, std::min(bandHeight, outHeight - top)));
+        }
+        auto decodeBand = [&](skia::BitmapRegionDecoder* brd, int band) {
+            const int top = band * bandHeight;
+            const int bottom = std::min(top + bandHeight, outHeight);
+            // The last band ends where the region does, which the sampled height already
+            // rounds down to the last whole sample.
+            const SkIRect bandSubset = SkIRect::MakeLTRB(
+                    subset.left(), subset.top() + top * sampleSize, subset.right(),
+                    band == bandCount - 1 ? subset.bottom() : subset.top() + bottom * sampleSize);
+            SkBitmap bandBitmap;
+            return brd->decodeRegion(&bandBitmap, allocators[band].get(), bandSubset, sampleSize,
+                                     colorType, requireUnpremul, colorSpace);
+        };
+        std::vector<std::future<bool>> workerResults;
+        for (int band = 1; band < bandCount; band++) {
+            skia::BitmapRegionDecoder* brd = mWorkerBRDs[band - 1].get();
+            workerResults.push_back(uirenderer::CommonPool::async(
+                    [&decodeBand, brd, band] { return decodeBand(brd, band); }));
+        }
+        bool success = decodeBand(mMainImageBRD.get(), 0);
+        // The workers write into the output, so wait for all of them even if a band failed.
+        for (auto& result : workerResults) {
+            success &= result.get();
+        }
+        if (!success) {
+            ALOGW("Tiled decode of region failed, decoding it serially");
+            return nullptr;
+        }
+        for (const auto& allocator : allocators) {
+            if (allocator->alphaType() != allocators[0]->alphaType()) {
+                return nullptr;
+            }
+        }
+        output->setAlphaType(allocators[0]->alphaType());
+        return output;
+    }
+
     bool decodeGainmapRegion(sp<uirenderer::Gainmap>* outGainmap, int outWidth, int outHeight,
                              const SkIRect& desiredSubset, int sampleSize, bool requireUnpremul) {
         SkColorType decodeColorType = mGainmapBRD->computeOutputColorType(kN32_SkColorType);
@@ -151,15 +290,43 @@ public:
     int height() const { return mMainImageBRD->height(); }
 
 private:
-    BitmapRegionDecoderWrapper(std::unique_ptr<skia::BitmapRegionDecoder> mainImageBRD,
+    // Regions whose output has fewer pixels than this are decoded on the calling thread.
+    static constexpr int64_t kMinTiledDecodePixels = 1024 * 1024;
+    static constexpr int kMinBandHeight = 256;
+    static constexpr int kBandAlignment = 16;
+    static constexpr int kMaxBands = uirenderer::CommonPool::THREAD_COUNT + 1;
+
+    // Formats whose codecs take a subset and only output its rows, so that the bands can be
+    // decoded separately. The rows above a band are still read to reach it (JPEG skips their
+    // IDCT, PNG and WebP decode them), so lower bands cost more than their share; the output and
+    // color conversion of the region are what gets split across threads.
+    static bool canDecodeInBands(SkEncodedImageFormat format) {
+        switch (format) {
+            case SkEncodedImageFormat::kJPEG:
+            case SkEncodedImageFormat::kPNG:
+            case SkEncodedImageFormat::kWEBP:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    BitmapRegionDecoderWrapper(sk_sp<SkData> data,
+                               std::unique_ptr<skia::BitmapRegionDecoder> mainImageBRD,
                                std::unique_ptr<skia::BitmapRegionDecoder> gainmapBRD,
                                SkGainmapInfo info, std::unique_ptr<SkStream> stream)
-            : mMainImageBRD(std::move(mainImageBRD))
+            : mData(std::move(data))
+            , mMainImageBRD(std::move(mainImageBRD))
             , mGainmapBRD(std::move(gainmapBRD))
             , mGainmapInfo(info)
             , mGainmapStream(std::move(stream)) {}
 
+    // Kept to create the decoders of tiled decodes.
+    sk_sp<SkData> mData;
     std::unique_ptr<skia::BitmapRegionDecoder> mMainImageBRD;
+    // Decoders for the bands of a tiled decode that don't run on the calling thread, created by
+    // the first region large enough to need them.
+    std::vector<std::unique_ptr<skia::BitmapRegionDecoder>> mWorkerBRDs;
     std::unique_ptr<skia::BitmapRegionDecoder> mGainmapBRD;
     SkGainmapInfo mGainmapInfo;
     std::unique_ptr<SkStream> mGainmapStream;
@@ -292,10 +459,17 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
     sk_sp<SkColorSpace> decodeColorSpace = brd->computeOutputColorSpace(
             decodeColorType, colorSpace);
 
-    // Decode the region.
+    // Decode the region. Large regions that don't reuse a bitmap are decoded in parallel.
     const SkIRect subset = SkIRect::MakeXYWH(inputX, inputY, inputWidth, inputHeight);
     SkBitmap bitmap;
-    if (!brd->decodeRegion(&bitmap, allocator, subset, sampleSize,
+    sk_sp<Bitmap> tiledBitmap;
+    if (!javaBitmap) {
+        tiledBitmap = brd->decodeRegionTiled(subset, sampleSize, decodeColorType, requireUnpremul,
+                                             decodeColorSpace);
+    }
+    if (tiledBitmap) {
+        tiledBitmap->getSkBitmap(&bitmap);
+    } else if (!brd->decodeRegion(&bitmap, allocator, subset, sampleSize,
             decodeColorType, requireUnpremul, decodeColorSpace)) {
         return nullObjectReturn("Failed to decode region.");
     }
@@ -369,7 +543,8 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
         }
         return bitmap::createBitmap(env, hardwareBitmap.release(), bitmapCreateFlags);
     }
-    Bitmap* heapBitmap = heapAlloc.getStorageObjAndReset();
+    Bitmap* heapBitmap =
+            tiledBitmap ? tiledBitmap.release() : heapAlloc.getStorageObjAndReset();
     if (hasGainmap && heapBitmap != nullptr) {
         heapBitmap->setGainmap(std::move(gainmap));
     }
@@ -2,6 +2,7 @@
 #define LOG_TAG "YuvToJpegEncoder"
 
 #include "CreateJavaOutputStreamAdaptor.h"
+#include "SkData.h"
 #include "SkStream.h"
 #include "YuvToJpegEncoder.h"
 #include <ui/PixelFormat.h>
@@ -9,7 +10,16 @@
 
 #include "graphics_jni_helpers.h"
 
+#include <thread/CommonPool.h>
+
+#include <algorithm>
 #include <csetjmp>
+#include <future>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 extern "C" {
     // We need to include stdio.h before jpeg because jpeg does not include it, but uses FILE
@@ -101,6 +111,162 @@ skstream_destination_mgr::skstream_destination_mgr(SkWStream* stream)
 
 bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
         int height, int* offsets, int jpegQuality) {
+    if (encodeStripes(stream, (uint8_t*) inYuv, width, height, offsets, jpegQuality)) {
+        return true;
+    }
+    return encodeImage(stream, (uint8_t*) inYuv, width, height, offsets, jpegQuality);
+}
+
+/*
+ * Both encoders use 2x2 luma sampling, so an MCU is 16x16 pixels.
+ */
+static constexpr int kMcuSize = 16;
+// Images smaller than this are encoded on the calling thread.
+static constexpr int64_t kMinStripedPixels = 1024 * 1024;
+static constexpr int kMinStripeHeight = 256;
+static constexpr int kMaxStripes = android::uirenderer::CommonPool::THREAD_COUNT + 1;
+
+static constexpr uint8_t kMarkerSOF0 = 0xC0;
+static constexpr uint8_t kMarkerSOF1 = 0xC1;
+static constexpr uint8_t kMarkerRST0 = 0xD0;
+static constexpr uint8_t kMarkerEOI = 0xD9;
+static constexpr uint8_t kMarkerSOS = 0xDA;
+static constexpr uint8_t kMarkerDRI = 0xDD;
+
+/*
+ * Where the parts of a baseline JPEG written by libjpeg are: the headers before the scan
+ * header, the scan header, and the entropy coded data that runs up to the final EOI.
+ */
+struct JpegLayout {
+    size_t sofOffset = 0;
+    size_t sosOffset = 0;
+    size_t dataOffset = 0;
+    size_t dataEnd = 0;
+};
+
+static bool parseJpegLayout(const uint8_t* jpeg, size_t size, JpegLayout* layout) {
+    if (size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8 || jpeg[size - 2] != 0xFF ||
+        jpeg[size - 1] != kMarkerEOI) {
+        return false;
+    }
+    bool foundSof = false;
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (jpeg[pos] != 0xFF) {
+            return false;
+        }
+        const uint8_t marker = jpeg[pos + 1];
+        const size_t length = (jpeg[pos + 2] << 8) | jpeg[pos + 3];
+        if (marker == kMarkerSOF0 || marker == kMarkerSOF1) {
+            layout->sofOffset = pos;
+            foundSof = true;
+        } else if (marker == kMarkerSOS) {
+            layout->sosOffset = pos;
+            layout->dataOffset = pos + 2 + length;
+            layout->dataEnd = size - 2;
+            return foundSof && layout->dataOffset <= layout->dataEnd;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+/*
+ * Large images are split into stripes of whole MCU rows that are encoded in parallel, one on
+ * the calling thread and the rest on the CommonPool. Every stripe is a complete JPEG encoded
+ * with the same tables, so the image is put back together from the headers of the first one
+ * followed by the entropy coded data of each stripe. A restart interval of one stripe makes
+ * that a valid JPEG: decoders reset the DC predictions at the RST marker between two stripes,
+ * just like each stripe's encoder started from zero.
+ *
+ * Returns false without writing anything if the image is too small or a stripe failed.
+ */
+bool YuvToJpegEncoder::encodeStripes(SkWStream* stream, uint8_t* yuv, int width, int height,
+                                     int* offsets, int jpegQuality) {
+    if (static_cast<int64_t>(width) * height < kMinStripedPixels) {
+        return false;
+    }
+    int stripeCount = std::min(kMaxStripes, height / kMinStripeHeight);
+    if (stripeCount < 2) {
+        return false;
+    }
+    int stripeHeight = (height + stripeCount - 1) / stripeCount;
+    stripeHeight = (stripeHeight + kMcuSize - 1) / kMcuSize * kMcuSize;
+    stripeCount = (height + stripeHeight - 1) / stripeHeight;
+    const int restartInterval = (width + kMcuSize - 1) / kMcuSize * (stripeHeight / kMcuSize);
+    if (stripeCount < 2 || restartInterval > 0xFFFF) {
+        return false;
+    }
+
+    std::vector<sk_sp<SkData>> stripes(stripeCount);
+    auto encodeStripe = [&](int stripe) {
+        const int top = stripe * stripeHeight;
+        int stripeOffsets[2];
+        offsetStripe(top, offsets, stripeOffsets);
+        SkDynamicMemoryWStream stripeStream;
+        if (!encodeImage(&stripeStream, yuv, width, std::min(stripeHeight, height - top),
+                         stripeOffsets, jpegQuality)) {
+            return false;
+        }
+        stripes[stripe] = stripeStream.detachAsData();
+        return true;
+    };
+    std::vector<std::future<bool>> results;
+    for (int stripe = 1; stripe < stripeCount; stripe++) {
+        results.push_back(android::uirenderer::CommonPool::async(
+                [&encodeStripe, stripe] { return encodeStripe(stripe); }));
+    }
+    bool success = encodeStripe(0);
+    for (auto& result : results) {
+        success &= result.get();
+    }
+    if (!success) {
+        ALOGW("Encoding stripes failed, encoding the image on one thread");
+        return false;
+    }
+
+    std::vector<JpegLayout> layouts(stripeCount);
+    for (int stripe = 0; stripe < stripeCount; stripe++) {
+        if (!parseJpegLayout(stripes[stripe]->bytes(), stripes[stripe]->size(),
+                             &layouts[stripe])) {
+            ALOGW("Unexpected layout of stripe %d, encoding the image on one thread", stripe);
+            return false;
+        }
+    }
+
+    // The headers of the first stripe, with the height of the whole image and the restart
+    // interval added in front of the scan header.
+    const uint8_t* first = stripes[0]->bytes();
+    const JpegLayout& firstLayout = layouts[0];
+    std::vector<uint8_t> header(first, first + firstLayout.sosOffset);
+    header[firstLayout.sofOffset + 5] = (height >> 8) & 0xFF;
+    header[firstLayout.sofOffset + 6] = height & 0xFF;
+    const uint8_t dri[] = {0xFF, kMarkerDRI, 0x00, 0x04,
+                           static_cast<uint8_t>(restartInterval >> 8),
+                           static_cast<uint8_t>(restartInterval & 0xFF)};
+    header.insert(header.end(), dri, dri + sizeof(dri));
+    header.insert(header.end(), first + firstLayout.sosOffset, first + firstLayout.dataOffset);
+    if (!stream->write(header.data(), header.size())) {
+        return false;
+    }
+    for (int stripe = 0; stripe < stripeCount; stripe++) {
+        const JpegLayout& layout = layouts[stripe];
+        if (!stream->write(stripes[stripe]->bytes() + layout.dataOffset,
+                           layout.dataEnd - layout.dataOffset)) {
+            return false;
+        }
+        const uint8_t marker[] = {0xFF, static_cast<uint8_t>(
+                stripe < stripeCount - 1 ? kMarkerRST0 + stripe % 8 : kMarkerEOI)};
+        if (!stream->write(marker, sizeof(marker))) {
+            return false;
+        }
+    }
+    stream->flush();
+    return true;
+}
+
+bool YuvToJpegEncoder::encodeImage(SkWStream* stream, uint8_t* yuv, int width, int height,
+                                   int* offsets, int jpegQuality) {
     jpeg_compress_struct      cinfo;
     ErrorMgr                  err;
     skstream_destination_mgr  sk_wstream(stream);
@@ -120,7 +286,7 @@ bool YuvToJpegEncoder::encode(SkWStream* stream, void* inYuv, int width,
 
     jpeg_start_compress(&cinfo, TRUE);
 
-    compress(&cinfo, (uint8_t*) inYuv, offsets);
+    compress(&cinfo, yuv, offsets);
 
     jpeg_finish_compress(&cinfo);
 
@@ -198,18 +364,32 @@ void Yuv420SpToJpegEncoder::deinterleave(uint8_t* vuPlanar, uint8_t* uRows,
         uint8_t* vRows, int rowIndex, int width, int height) {
     int numRows = (height - rowIndex) / 2;
     if (numRows > 8) numRows = 8;
+    const int halfWidth = width >> 1;
     for (int row = 0; row < numRows; ++row) {
         int offset = ((rowIndex >> 1) + row) * fStrides[1];
-        uint8_t* vu = vuPlanar + offset;
-        for (int i = 0; i < (width >> 1); ++i) {
-            int index = row * (width >> 1) + i;
-            uRows[index] = vu[1];
-            vRows[index] = vu[0];
-            vu += 2;
+        const uint8_t* vu = vuPlanar + offset;
+        uint8_t* u = uRows + row * halfWidth;
+        uint8_t* v = vRows + row * halfWidth;
+        int i = 0;
+#if defined(__ARM_NEON)
+        for (; i + 16 <= halfWidth; i += 16) {
+            uint8x16x2_t pixels = vld2q_u8(vu + 2 * i);
+            vst1q_u8(v + i, pixels.val[0]);
+            vst1q_u8(u + i, pixels.val[1]);
+        }
+#endif
+        for (; i < halfWidth; ++i) {
+            u[i] = vu[2 * i + 1];
+            v[i] = vu[2 * i];
         }
     }
 }
 
+void Yuv420SpToJpegEncoder::offsetStripe(int top, const int* offsets, int* stripeOffsets) {
+    stripeOffsets[0] = offsets[0] + top * fStrides[0];
+    stripeOffsets[1] = offsets[1] + (top >> 1) * fStrides[1];
+}
+
 void Yuv420SpToJpegEncoder::configSamplingFactors(jpeg_compress_struct* cinfo) {
     // cb and cr are horizontally downsampled and vertically downsampled as well.
     cinfo->comp_info[0].h_samp_factor = 2;
@@ -273,20 +453,35 @@ void Yuv422IToJpegEncoder::deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* u
         uint8_t* vRows, int rowIndex, int width, int height) {
     int numRows = height - rowIndex;
     if (numRows > 16) numRows = 16;
+    const int halfWidth = width >> 1;
     for (int row = 0; row < numRows; ++row) {
-        uint8_t* yuvSeg = yuv + (rowIndex + row) * fStrides[0];
-        for (int i = 0; i < (width >> 1); ++i) {
-            int indexY = row * width + (i << 1);
-            int indexU = row * (width >> 1) + i;
-            yRows[indexY] = yuvSeg[0];
-            yRows[indexY + 1] = yuvSeg[2];
-            uRows[indexU] = yuvSeg[1];
-            vRows[indexU] = yuvSeg[3];
-            yuvSeg += 4;
+        const uint8_t* yuvSeg = yuv + (rowIndex + row) * fStrides[0];
+        uint8_t* yRow = yRows + row * width;
+        uint8_t* u = uRows + row * halfWidth;
+        uint8_t* v = vRows + row * halfWidth;
+        int i = 0;
+#if defined(__ARM_NEON)
+        for (; i + 16 <= halfWidth; i += 16) {
+            uint8x16x4_t pixels = vld4q_u8(yuvSeg + 4 * i);
+            uint8x16x2_t luma = {{pixels.val[0], pixels.val[2]}};
+            vst2q_u8(yRow + 2 * i, luma);
+            vst1q_u8(u + i, pixels.val[1]);
+            vst1q_u8(v + i, pixels.val[3]);
+        }
+#endif
+        for (; i < halfWidth; ++i) {
+            yRow[2 * i] = yuvSeg[4 * i];
+            yRow[2 * i + 1] = yuvSeg[4 * i + 2];
+            u[i] = yuvSeg[4 * i + 1];
+            v[i] = yuvSeg[4 * i + 3];
         }
     }
 }
 
+void Yuv422IToJpegEncoder::offsetStripe(int top, const int* offsets, int* stripeOffsets) {
+    stripeOffsets[0] = offsets[0] + top * fStrides[0];
+}
+
 void Yuv422IToJpegEncoder::configSamplingFactors(jpeg_compress_struct* cinfo) {
     // cb and cr are horizontally downsampled and vertically downsampled as well.
     cinfo->comp_info[0].h_samp_factor = 2;
@@ -46,6 +46,16 @@ protected:
     virtual void configSamplingFactors(jpeg_compress_struct* cinfo) = 0;
     virtual void compress(jpeg_compress_struct* cinfo,
             uint8_t* yuv, int* offsets) = 0;
+    /** Computes the plane offsets of the image that starts at row top of the
+     *  image described by offsets.
+     */
+    virtual void offsetStripe(int top, const int* offsets, int* stripeOffsets) = 0;
+
+private:
+    bool encodeImage(SkWStream* stream, uint8_t* yuv, int width, int height,
+            int* offsets, int jpegQuality);
+    bool encodeStripes(SkWStream* stream, uint8_t* yuv, int width, int height,
+            int* offsets, int jpegQuality);
 };
 
 class Yuv420SpToJpegEncoder : public YuvToJpegEncoder {
@@ -60,6 +70,7 @@ private:
     void deinterleave(uint8_t* vuPlanar, uint8_t* uRows, uint8_t* vRows,
             int rowIndex, int width, int height);
     void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets);
+    void offsetStripe(int top, const int* offsets, int* stripeOffsets);
 };
 
 class Yuv422IToJpegEncoder : public YuvToJpegEncoder {
@@ -70,6 +81,7 @@ public:
 private:
     void configSamplingFactors(jpeg_compress_struct* cinfo);
     void compress(jpeg_compress_struct* cinfo, uint8_t* yuv, int* offsets);
+    void offsetStripe(int top, const int* offsets, int* stripeOffsets);
     void deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* uRows,
             uint8_t* vRows, int rowIndex, int width, int height);
 };
@@ -400,6 +400,12 @@ static void android_view_ThreadedRenderer_dumpProfileInfo(JNIEnv* env, jobject c
     proxy->dumpProfileInfo(fd, dumpFlags);
 }
 
+static jint android_view_ThreadedRenderer_getFrameInfoRingFd(JNIEnv* env, jobject clazz,
+        jlong proxyPtr) {
+    RenderProxy* proxy = reinterpret_cast<RenderProxy*>(proxyPtr);
+    return proxy->getFrameInfoRingFd();
+}
+
 static void android_view_ThreadedRenderer_dumpGlobalProfileInfo(JNIEnv* env, jobject clazz,
                                                                 jobject javaFileDescriptor,
                                                                 jint dumpFlags) {
@@ -1025,6 +1031,11 @@ static const JNINativeMethod gMethods[] = {
         {"nTrimCaches", "(I)V", (void*)android_view_ThreadedRenderer_trimCaches},
 };
 
+// Registered only if HardwareRenderer declares them.
+static const JNINativeMethod gOptionalMethods[] = {
+        {"nGetFrameInfoRingFd", "(J)I", (void*)android_view_ThreadedRenderer_getFrameInfoRingFd},
+};
+
 static JavaVM* mJvm = nullptr;
 
 static void attachRenderThreadToJvm(const char* name) {
@@ -1085,7 +1096,9 @@ int register_android_view_ThreadedRenderer(JNIEnv* env) {
     LOG_ALWAYS_FATAL_IF(fromSurface == nullptr,
                         "Failed to find required symbol ANativeWindow_fromSurface!");
 
-    return RegisterMethodsOrDie(env, kClassPathName, gMethods, NELEM(gMethods));
+    int res = RegisterMethodsOrDie(env, kClassPathName, gMethods, NELEM(gMethods));
+    RegisterOptionalMethods(env, kClassPathName, gOptionalMethods, NELEM(gOptionalMethods));
+    return res;
 }
 
 }; // namespace android
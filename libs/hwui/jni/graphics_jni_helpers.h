@@ -87,6 +87,25 @@ static inline int RegisterMethodsOrDie(JNIEnv* env, const char* className,
     return res;
 }
 
+/**
+ * Registers native methods that the Java class may not declare, one at a time, so that a missing
+ * one is skipped instead of failing the whole registration. Returns how many were registered.
+ */
+static inline int RegisterOptionalMethods(JNIEnv* env, const char* className,
+                                          const JNINativeMethod* gMethods, int numMethods) {
+    ScopedLocalRef<jclass> clazz(env, env->FindClass(className));
+    LOG_ALWAYS_FATAL_IF(clazz == NULL, "Unable to find class %s", className);
+    int registered = 0;
+    for (int i = 0; i < numMethods; i++) {
+        if (env->RegisterNatives(clazz.get(), &gMethods[i], 1) == JNI_OK) {
+            registered++;
+        } else {
+            env->ExceptionClear();
+        }
+    }
+    return registered;
+}
+
 /**
  * Read the specified field from jobject, and convert to std::string.
  * If the field cannot be obtained, return defaultValue.
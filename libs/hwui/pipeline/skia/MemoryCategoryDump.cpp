@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryCategoryDump.h"
+
+#include <GrDirectContext.h>
+#include <SkGraphics.h>
+#include <SkString.h>
+
+#include <cstring>
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+static const char* sCategoryNames[kMemoryCategoryCount] = {
+        "Texture", "RenderTarget", "Path", "Buffer", "GpuOther", "Bitmap", "GlyphCache", "CpuOther",
+};
+
+// Skia reports the "type" of a GPU resource with dumpStringValue and, for GL, its backing with
+// setMemoryBacking. The type wins when both are known.
+static bool categoryForType(const char* type, MemoryCategory* category) {
+    if (!strcmp(type, "Texture")) {
+        *category = MemoryCategory::Texture;
+    } else if (!strcmp(type, "RenderTarget") || SkStrStartsWith(type, "Stencil") ||
+               SkStrStartsWith(type, "Attachment")) {
+        *category = MemoryCategory::RenderTarget;
+    } else if (!strcmp(type, "Path Data")) {
+        *category = MemoryCategory::Path;
+    } else if (!strcmp(type, "Buffer Object")) {
+        *category = MemoryCategory::Buffer;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool categoryForBacking(const char* backingType, MemoryCategory* category) {
+    if (!strcmp(backingType, "gl_texture")) {
+        *category = MemoryCategory::Texture;
+    } else if (!strcmp(backingType, "gl_renderbuffer")) {
+        *category = MemoryCategory::RenderTarget;
+    } else if (!strcmp(backingType, "gl_buffer") || !strcmp(backingType, "vk_buffer")) {
+        *category = MemoryCategory::Buffer;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+MemoryCategoryDump::MemoryCategoryDump() {
+    mLastDumpName.reserve(100);
+}
+
+void MemoryCategoryDump::sample(GrDirectContext* context, MemorySample* sample) {
+    *sample = MemorySample();
+    mSample = sample;
+    mDumpingGpu = false;
+    SkGraphics::DumpMemoryStatistics(this);
+    recordIfNeeded("");
+    if (context) {
+        mDumpingGpu = true;
+        context->dumpMemoryStatistics(this);
+        recordIfNeeded("");
+    }
+    mSample = nullptr;
+}
+
+void MemoryCategoryDump::logSample(const MemorySample& sample, nsecs_t now, String8& log) {
+    log.appendFormat("  %7.1fs%s:", (now - sample.time) / -1000000000.0,
+                     sample.afterTrim ? " (trim)" : "");
+    for (size_t i = 0; i < kMemoryCategoryCount; i++) {
+        if (sample.bytes[i] > 0) {
+            log.appendFormat(" %s %.2fMB", sCategoryNames[i], sample.bytes[i] / 1000000.f);
+        }
+    }
+    log.appendFormat(" (%.2fMB GPU purgeable)\n", sample.purgeableGpuBytes / 1000000.f);
+}
+
+void MemoryCategoryDump::dumpNumericValue(const char* dumpName, const char* valueName,
+                                          const char* units, uint64_t value) {
+    if (!strcmp(units, "bytes")) {
+        recordIfNeeded(dumpName);
+        if (!strcmp(valueName, "size")) {
+            mLastSize = value;
+        } else if (!strcmp(valueName, "purgeable_size")) {
+            mLastPurgeableSize = value;
+        }
+    }
+}
+
+void MemoryCategoryDump::dumpStringValue(const char* dumpName, const char* valueName,
+                                         const char* value) {
+    recordIfNeeded(dumpName);
+    if (!strcmp(valueName, "type")) {
+        mHasCategory = categoryForType(value, &mCategory) || mHasCategory;
+    } else if (!strcmp(valueName, "category") && mCategory == MemoryCategory::Texture &&
+               SkStrContains(value, "Path")) {
+        // Software and tessellated path masks are cached as keyed textures
+        mCategory = MemoryCategory::Path;
+    }
+}
+
+void MemoryCategoryDump::setMemoryBacking(const char* dumpName, const char* backingType,
+                                          const char*) {
+    recordIfNeeded(dumpName);
+    if (!mHasCategory) {
+        mHasCategory = categoryForBacking(backingType, &mCategory);
+    }
+}
+
+void MemoryCategoryDump::recordIfNeeded(const char* dumpName) {
+    if (!mLastDumpName.compare(dumpName)) {
+        return;
+    }
+    if (!mLastDumpName.empty()) {
+        MemoryCategory category = mCategory;
+        if (mDumpingGpu) {
+            mSample->purgeableGpuBytes += mLastPurgeableSize;
+        } else if (SkStrContains(mLastDumpName.c_str(), "sk_glyph_cache")) {
+            category = MemoryCategory::GlyphCache;
+        } else if (SkStrContains(mLastDumpName.c_str(), "/bitmap_")) {
+            category = MemoryCategory::Bitmap;
+        } else {
+            category = MemoryCategory::CpuOther;
+        }
+        mSample->bytes[static_cast<size_t>(category)] += mLastSize;
+    }
+    mLastDumpName = dumpName;
+    mLastSize = 0;
+    mLastPurgeableSize = 0;
+    mHasCategory = false;
+    mCategory = MemoryCategory::GpuOther;
+}
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
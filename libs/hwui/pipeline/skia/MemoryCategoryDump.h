@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <SkTraceMemoryDump.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <string>
+
+class GrDirectContext;
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+enum class MemoryCategory {
+    Texture,
+    RenderTarget,
+    Path,
+    Buffer,
+    GpuOther,
+    Bitmap,
+    GlyphCache,
+    CpuOther,
+};
+
+constexpr size_t kMemoryCategoryCount = static_cast<size_t>(MemoryCategory::CpuOther) + 1;
+
+struct MemorySample {
+    nsecs_t time = 0;
+    // Whether the sample was taken right after the caches were trimmed instead of after a frame
+    bool afterTrim = false;
+    uint64_t bytes[kMemoryCategoryCount] = {};
+    uint64_t purgeableGpuBytes = 0;
+};
+
+/**
+ * Sums the memory of Skia's CPU caches and of a GrDirectContext per MemoryCategory. Unlike
+ * SkiaMemoryTracer it keeps no per-resource state, so it's cheap enough to sample with while
+ * frames are being drawn.
+ */
+class MemoryCategoryDump : public SkTraceMemoryDump {
+public:
+    MemoryCategoryDump();
+    ~MemoryCategoryDump() override {}
+
+    // Fills the sizes of |sample| with the current usage; |context| may be null.
+    void sample(GrDirectContext* context, MemorySample* sample);
+
+    static void logSample(const MemorySample& sample, nsecs_t now, String8& log);
+
+    void dumpNumericValue(const char* dumpName, const char* valueName, const char* units,
+                          uint64_t value) override;
+
+    void dumpStringValue(const char* dumpName, const char* valueName, const char* value) override;
+
+    LevelOfDetail getRequestedDetails() const override {
+        return SkTraceMemoryDump::kLight_LevelOfDetail;
+    }
+
+    bool shouldDumpWrappedObjects() const override { return false; }
+
+    void setMemoryBacking(const char* dumpName, const char* backingType,
+                          const char* backingObjectId) override;
+
+    void setDiscardableMemoryBacking(const char*, const SkDiscardableMemory&) override {}
+
+private:
+    void recordIfNeeded(const char* dumpName);
+
+    MemorySample* mSample = nullptr;
+    bool mDumpingGpu = false;
+
+    // The element being dumped, which is recorded once the next one starts
+    std::string mLastDumpName;
+    uint64_t mLastSize = 0;
+    uint64_t mLastPurgeableSize = 0;
+    bool mHasCategory = false;
+    MemoryCategory mCategory = MemoryCategory::GpuOther;
+};
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
@@ -15,6 +15,7 @@
  */
 
 #include "ReorderBarrierDrawables.h"
+#include "Properties.h"
 #include "RenderNode.h"
 #include "SkiaDisplayList.h"
 #include "LightingInfo.h"
@@ -105,12 +106,16 @@ void EndReorderBarrierDrawable::onDraw(SkCanvas* canvas) {
             // attempt to render the shadow if the caster about to be drawn is its caster,
             // OR if its caster's Z value is similar to the previous potential caster
             if (shadowIndex == drawIndex || casterZ - lastCasterZ < SHADOW_DELTA) {
-                this->drawShadow(canvas, zChildren[shadowIndex]);
+                Shadow shadow;
+                if (this->prepareShadow(zChildren[shadowIndex], &shadow)) {
+                    mPendingShadows.push_back(shadow);
+                }
                 lastCasterZ = casterZ;  // must do this even if current caster not casting a shadow
                 shadowIndex++;
                 continue;
             }
         }
+        this->flushShadows(canvas);
 
         RenderNodeDrawable* childNode = zChildren[drawIndex];
         SkASSERT(childNode);
@@ -130,20 +135,20 @@ static SkColor multiplyAlpha(SkColor color, float alpha) {
 }
 
 // copied from FrameBuilder::deferShadow
-void EndReorderBarrierDrawable::drawShadow(SkCanvas* canvas, RenderNodeDrawable* caster) {
+bool EndReorderBarrierDrawable::prepareShadow(RenderNodeDrawable* caster, Shadow* outShadow) {
     const RenderProperties& casterProperties = caster->getNodeProperties();
 
     if (casterProperties.getAlpha() <= 0.0f || casterProperties.getOutline().getAlpha() <= 0.0f ||
         !casterProperties.getOutline().getPath() || casterProperties.getScaleX() == 0 ||
         casterProperties.getScaleY() == 0) {
         // no shadow to draw
-        return;
+        return false;
     }
 
     const SkScalar casterAlpha =
             casterProperties.getAlpha() * casterProperties.getOutline().getAlpha();
     if (casterAlpha <= 0.0f) {
-        return;
+        return false;
     }
 
     float ambientAlpha = (LightingInfo::getAmbientShadowAlpha() / 255.f) * casterAlpha;
@@ -153,7 +158,7 @@ void EndReorderBarrierDrawable::drawShadow(SkCanvas* canvas, RenderNodeDrawable*
     const SkPath* revealClipPath = revealClip.getPath();
     if (revealClipPath && revealClipPath->isEmpty()) {
         // An empty reveal clip means nothing is drawn
-        return;
+        return false;
     }
 
     bool clippedToBounds = casterProperties.getClippingFlags() & CLIP_TO_CLIP_BOUNDS;
@@ -165,15 +170,10 @@ void EndReorderBarrierDrawable::drawShadow(SkCanvas* canvas, RenderNodeDrawable*
         casterClipRect = clipBounds.toSkRect();
         if (casterClipRect.isEmpty()) {
             // An empty clip rect means nothing is drawn
-            return;
+            return false;
         }
     }
 
-    SkAutoCanvasRestore acr(canvas, true);
-    // Since we're drawing out of recording order, the child's matrix needs to be applied to the
-    // canvas. In in-order drawing, the canvas already has the child's matrix applied.
-    canvas->setMatrix(mStartBarrier->mDisplayList->mParentMatrix);
-
     SkMatrix shadowMatrix;
     mat4 hwuiMatrix(caster->getRecordedMatrix());
     // TODO we don't pass the optional boolean to treat it as a 4x4 matrix
@@ -181,7 +181,9 @@ void EndReorderBarrierDrawable::drawShadow(SkCanvas* canvas, RenderNodeDrawable*
     // RenderNodeDrawable::setViewProperties as a part if their draw.
     caster->getRenderNode()->applyViewPropertyTransforms(hwuiMatrix);
     hwuiMatrix.copyTo(shadowMatrix);
-    canvas->concat(shadowMatrix);
+    // Since we're drawing out of recording order, the child's matrix needs to be applied to the
+    // canvas. In in-order drawing, the canvas already has the child's matrix applied.
+    outShadow->matrix = SkMatrix::Concat(mStartBarrier->mDisplayList->mParentMatrix, shadowMatrix);
 
     // default the shadow-casting path to the outline of the caster
     const SkPath* casterPath = casterProperties.getOutline().getPath();
@@ -192,30 +194,65 @@ void EndReorderBarrierDrawable::drawShadow(SkCanvas* canvas, RenderNodeDrawable*
     }
 
     // intersect the shadow-casting path with the reveal, if present
-    SkPath tmpPath;  // holds temporary SkPath to store the result of intersections
     if (revealClipPath) {
-        Op(*casterPath, *revealClipPath, kIntersect_SkPathOp, &tmpPath);
-        tmpPath.setIsVolatile(true);
-        casterPath = &tmpPath;
+        casterPath = caster->getRenderNode()->getRevealClippedOutline(*casterPath,
+                                                                     *revealClipPath);
     }
+    outShadow->casterPath = casterPath;
 
-    const Vector3 lightPos = LightingInfo::getLightCenter();
-    SkPoint3 skiaLightPos = SkPoint3::Make(lightPos.x, lightPos.y, lightPos.z);
-    SkPoint3 zParams;
     if (shadowMatrix.hasPerspective()) {
         // get the matrix with the full 3D transform
         mat4 zMatrix;
         caster->getRenderNode()->applyViewPropertyTransforms(zMatrix, true);
-        zParams = SkPoint3::Make(zMatrix[2], zMatrix[6], zMatrix[mat4::kTranslateZ]);
+        outShadow->zParams = SkPoint3::Make(zMatrix[2], zMatrix[6], zMatrix[mat4::kTranslateZ]);
     } else {
-        zParams = SkPoint3::Make(0, 0, casterProperties.getZ());
+        outShadow->zParams = SkPoint3::Make(0, 0, casterProperties.getZ());
+    }
+    outShadow->ambientColor =
+            multiplyAlpha(casterProperties.getAmbientShadowColor(), ambientAlpha);
+    outShadow->spotColor = multiplyAlpha(casterProperties.getSpotShadowColor(), spotAlpha);
+    outShadow->flags = casterAlpha < 1.0f ? SkShadowFlags::kTransparentOccluder_ShadowFlag : 0;
+    return true;
+}
+
+void EndReorderBarrierDrawable::drawShadow(SkCanvas* canvas, const Shadow& shadow) {
+    const Vector3 lightPos = LightingInfo::getLightCenter();
+    SkPoint3 skiaLightPos = SkPoint3::Make(lightPos.x, lightPos.y, lightPos.z);
+    canvas->setMatrix(shadow.matrix);
+    SkShadowUtils::DrawShadow(canvas, *shadow.casterPath, shadow.zParams, skiaLightPos,
+                              LightingInfo::getLightRadius(), shadow.ambientColor,
+                              shadow.spotColor, shadow.flags);
+}
+
+/**
+ * Draws the shadows gathered since the last caster was drawn. They all lie underneath the casters
+ * drawn next, so the order among them doesn't matter much. When batching, shadows that share an
+ * outline and elevation are drawn back to back, which lets Skia reuse the tessellation cached for
+ * that outline and combine the draws into fewer GPU ops. Grids of identical cards have all of
+ * their shadows drawn this way.
+ */
+void EndReorderBarrierDrawable::flushShadows(SkCanvas* canvas) {
+    if (mPendingShadows.empty()) {
+        return;
+    }
+    if (Properties::batchShadows && mPendingShadows.size() > 1) {
+        std::stable_sort(mPendingShadows.begin(), mPendingShadows.end(),
+                         [](const Shadow& a, const Shadow& b) {
+                             const uint32_t aID = a.casterPath->getGenerationID();
+                             const uint32_t bID = b.casterPath->getGenerationID();
+                             if (aID != bID) return aID < bID;
+                             if (a.zParams.fZ != b.zParams.fZ) return a.zParams.fZ < b.zParams.fZ;
+                             if (a.ambientColor != b.ambientColor) {
+                                 return a.ambientColor < b.ambientColor;
+                             }
+                             return a.spotColor < b.spotColor;
+                         });
+    }
+    SkAutoCanvasRestore acr(canvas, true);
+    for (const Shadow& shadow : mPendingShadows) {
+        drawShadow(canvas, shadow);
     }
-    SkColor ambientColor = multiplyAlpha(casterProperties.getAmbientShadowColor(), ambientAlpha);
-    SkColor spotColor = multiplyAlpha(casterProperties.getSpotShadowColor(), spotAlpha);
-    SkShadowUtils::DrawShadow(
-            canvas, *casterPath, zParams, skiaLightPos, LightingInfo::getLightRadius(),
-            ambientColor, spotColor,
-            casterAlpha < 1.0f ? SkShadowFlags::kTransparentOccluder_ShadowFlag : 0);
+    mPendingShadows.clear();
 }
 
 }  // namespace skiapipeline
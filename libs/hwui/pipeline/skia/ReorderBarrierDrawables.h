@@ -20,7 +20,11 @@
 #include "SkiaUtils.h"
 
 #include <SkCanvas.h>
+#include <SkColor.h>
 #include <SkDrawable.h>
+#include <SkMatrix.h>
+#include <SkPath.h>
+#include <SkPoint3.h>
 #include <ui/FatVector.h>
 
 namespace android {
@@ -70,8 +74,23 @@ protected:
     virtual void onDraw(SkCanvas* canvas) override;
 
 private:
-    void drawShadow(SkCanvas* canvas, RenderNodeDrawable* caster);
+    // Everything SkShadowUtils needs to draw the shadow of one caster.
+    struct Shadow {
+        SkMatrix matrix;
+        const SkPath* casterPath;
+        SkPoint3 zParams;
+        SkColor ambientColor;
+        SkColor spotColor;
+        uint32_t flags;
+    };
+
+    bool prepareShadow(RenderNodeDrawable* caster, Shadow* outShadow);
+    void drawShadow(SkCanvas* canvas, const Shadow& shadow);
+    void flushShadows(SkCanvas* canvas);
+
     StartReorderBarrierDrawable* mStartBarrier;
+    // Shadows of casters with similar Z that are drawn together, see flushShadows.
+    FatVector<Shadow, 16> mPendingShadows;
 };
 
 }  // namespace skiapipeline
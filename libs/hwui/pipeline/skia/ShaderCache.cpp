@@ -17,14 +17,20 @@
 #include "ShaderCache.h"
 #include <GrDirectContext.h>
 #include <SkData.h>
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
 #include <gui/TraceUtils.h>
 #include <log/log.h>
 #include <openssl/sha.h>
+#include <unistd.h>
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <thread>
 #include "FileBlobCache.h"
 #include "Properties.h"
+#include "thread/CommonPool.h"
 
 namespace android {
 namespace uirenderer {
@@ -36,6 +42,106 @@ static const size_t maxValueSize = 2 * 1024 * 1024;
 static const size_t maxTotalSize = 4 * 1024 * 1024;
 static_assert(maxKeySize + maxValueSize < maxTotalSize);
 
+// Once the journal grows past this size the whole cache is written out again instead.
+static const size_t maxJournalSize = maxTotalSize / 2;
+
+// Journal layout: a header of {magic, version, identity hash size} followed by the identity hash,
+// then records of {key size, value size, checksum} each followed by the key and value bytes.
+static const uint32_t journalMagic = 0x4a525348;  // "HSRJ"
+static const uint32_t journalVersion = 1;
+static const size_t journalHeaderSize = 3 * sizeof(uint32_t);
+static const size_t journalRecordHeaderSize = 3 * sizeof(uint32_t);
+
+// How many frames after initShaderDiskCache the shaders in use are recorded for, and how many of
+// them are compiled ahead of time on the next launch.
+static const int warmUpFrameCount = 60;
+static const size_t maxWarmUpShaders = 128;
+
+// Warm-up file layout: {magic, version, key count} followed by each key as {size, bytes}.
+static const uint32_t warmUpMagic = 0x55575348;  // "HSWU"
+static const uint32_t warmUpVersion = 1;
+
+static uint32_t journalChecksum(const uint8_t* data, size_t size, uint32_t hash = 2166136261u) {
+    // FNV-1a: only meant to catch entries that were not completely written.
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void appendUint32(std::vector<uint8_t>& buffer, uint32_t value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+static uint32_t readUint32(const uint8_t* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static bool writeJournal(const std::string& filename, size_t offset,
+                         const std::vector<uint8_t>& data) {
+    ATRACE_NAME("ShaderCache::writeJournal");
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (offset == 0 ? O_TRUNC : 0);
+    base::unique_fd fd(TEMP_FAILURE_RETRY(open(filename.c_str(), flags, 0600)));
+    if (fd == -1) {
+        ALOGE("ShaderCache: could not open journal %s: %s", filename.c_str(), strerror(errno));
+        return false;
+    }
+    if (lseek(fd, offset, SEEK_SET) != (off_t)offset ||
+        !base::WriteFully(fd, data.data(), data.size())) {
+        ALOGE("ShaderCache: could not write journal %s: %s", filename.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static void writeWarmUpFile(const std::string& filename,
+                            const std::vector<std::vector<uint8_t>>& keys) {
+    ATRACE_NAME("ShaderCache::writeWarmUpFile");
+    std::vector<uint8_t> data;
+    appendUint32(data, warmUpMagic);
+    appendUint32(data, warmUpVersion);
+    appendUint32(data, keys.size());
+    for (const auto& key : keys) {
+        appendUint32(data, key.size());
+        data.insert(data.end(), key.begin(), key.end());
+    }
+    std::string tmpFilename = filename + ".tmp";
+    if (!base::WriteStringToFile(std::string(data.begin(), data.end()), tmpFilename) ||
+        rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        ALOGE("ShaderCache: could not write %s: %s", filename.c_str(), strerror(errno));
+        unlink(tmpFilename.c_str());
+    }
+}
+
+static std::vector<std::vector<uint8_t>> readWarmUpFile(const std::string& filename) {
+    std::vector<std::vector<uint8_t>> keys;
+    std::string contents;
+    if (!base::ReadFileToString(filename, &contents)) {
+        return keys;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(contents.data());
+    const size_t size = contents.size();
+    if (size < 3 * sizeof(uint32_t) || readUint32(data) != warmUpMagic ||
+        readUint32(data + sizeof(uint32_t)) != warmUpVersion) {
+        return keys;
+    }
+    size_t count = std::min<size_t>(readUint32(data + 2 * sizeof(uint32_t)), maxWarmUpShaders);
+    size_t offset = 3 * sizeof(uint32_t);
+    for (size_t i = 0; i < count && size - offset >= sizeof(uint32_t); i++) {
+        size_t keySize = readUint32(data + offset);
+        offset += sizeof(uint32_t);
+        if (keySize == 0 || keySize > maxKeySize || size - offset < keySize) {
+            break;
+        }
+        keys.emplace_back(data + offset, data + offset + keySize);
+        offset += keySize;
+    }
+    return keys;
+}
+
 ShaderCache::ShaderCache() {
     // There is an "incomplete FileBlobCache type" compilation error, if ctor is moved to header.
 }
@@ -86,12 +192,103 @@ void ShaderCache::initShaderDiskCache(const void* identity, ssize_t size) {
     // desktop / laptop GPUs. Thus, disable the shader disk cache for emulator builds.
     if (!Properties::runningInEmulator && mFilename.length() > 0) {
         mBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize, maxTotalSize, mFilename));
-        validateCache(identity, size);
+        bool valid = validateCache(identity, size);
         mInitialized = true;
-        if (identity != nullptr && size > 0 && mIDHash.size()) {
+        bool hasIdentity = identity != nullptr && size > 0 && mIDHash.size();
+        if (hasIdentity) {
             set(&sIDKey, sizeof(sIDKey), mIDHash.data(), mIDHash.size());
         }
+        mJournalPending.clear();
+        mJournalSize = 0;
+        mJournalId = hasIdentity ? mIDHash : std::vector<uint8_t>();
+        if (valid) {
+            replayJournalLocked(mJournalId);
+        }
+        mUsedKeys.clear();
+        mWarmUpFramesLeft = warmUpFrameCount;
+        mRecordingWarmUp = mWarmUpFramesLeft > 0;
+        mWarmUpKeys.clear();
+        mWarmUpLoaded = false;
+        mWarmUpStats = {};
+    }
+}
+
+void ShaderCache::replayJournalLocked(const std::vector<uint8_t>& journalId) {
+    ATRACE_NAME("ShaderCache::replayJournal");
+    // Wait for an append that may still be in progress
+    std::lock_guard journalLock(mJournalLock);
+    std::string journal;
+    if (!base::ReadFileToString(journalFilename(), &journal)) {
+        return;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(journal.data());
+    const size_t size = journal.size();
+    if (size < journalHeaderSize || readUint32(data) != journalMagic ||
+        readUint32(data + sizeof(uint32_t)) != journalVersion) {
+        return;
+    }
+    size_t idSize = readUint32(data + 2 * sizeof(uint32_t));
+    size_t offset = journalHeaderSize + idSize;
+    if (idSize != journalId.size() || offset > size ||
+        !std::equal(journalId.begin(), journalId.end(), data + journalHeaderSize)) {
+        if (CC_UNLIKELY(Properties::debugLevel & kDebugCaches)) {
+            ALOGW("ShaderCache: ignoring journal written for another identity");
+        }
+        return;
+    }
+
+    int replayed = 0;
+    while (size - offset >= journalRecordHeaderSize) {
+        size_t keySize = readUint32(data + offset);
+        size_t valueSize = readUint32(data + offset + sizeof(uint32_t));
+        uint32_t checksum = readUint32(data + offset + 2 * sizeof(uint32_t));
+        const uint8_t* key = data + offset + journalRecordHeaderSize;
+        if (keySize > maxKeySize || valueSize > maxValueSize ||
+            size - offset - journalRecordHeaderSize < keySize + valueSize) {
+            break;
+        }
+        const uint8_t* value = key + keySize;
+        if (journalChecksum(value, valueSize, journalChecksum(key, keySize)) != checksum) {
+            break;
+        }
+        set(key, keySize, value, valueSize);
+        offset += journalRecordHeaderSize + keySize + valueSize;
+        replayed++;
+    }
+    // Anything past the last complete entry is overwritten by the next append.
+    mJournalSize = offset;
+    ATRACE_FORMAT("ShaderCache: replayed %d journal entries", replayed);
+}
+
+void ShaderCache::appendJournalLocked(const void* key, size_t keySize, const void* value,
+                                      size_t valueSize) {
+    const uint8_t* keyBytes = reinterpret_cast<const uint8_t*>(key);
+    const uint8_t* valueBytes = reinterpret_cast<const uint8_t*>(value);
+    appendUint32(mJournalPending, keySize);
+    appendUint32(mJournalPending, valueSize);
+    appendUint32(mJournalPending,
+                 journalChecksum(valueBytes, valueSize, journalChecksum(keyBytes, keySize)));
+    mJournalPending.insert(mJournalPending.end(), keyBytes, keyBytes + keySize);
+    mJournalPending.insert(mJournalPending.end(), valueBytes, valueBytes + valueSize);
+}
+
+std::vector<uint8_t> ShaderCache::takeJournalLocked(size_t* offset) {
+    std::vector<uint8_t> data;
+    *offset = mJournalSize;
+    if (mJournalSize == 0) {
+        appendUint32(data, journalMagic);
+        appendUint32(data, journalVersion);
+        appendUint32(data, mJournalId.size());
+        data.insert(data.end(), mJournalId.begin(), mJournalId.end());
+    }
+    if (data.empty()) {
+        data.swap(mJournalPending);
+    } else {
+        data.insert(data.end(), mJournalPending.begin(), mJournalPending.end());
+        mJournalPending.clear();
     }
+    mJournalSize += data.size();
+    return data;
 }
 
 void ShaderCache::setFilename(const char* filename) {
@@ -137,9 +334,106 @@ sk_sp<SkData> ShaderCache::load(const SkData& key) {
     }
     mNumShadersCachedInRam++;
     ATRACE_FORMAT("HWUI RAM cache: %d shaders", mNumShadersCachedInRam);
+    recordUsageLocked(key.data(), keySize);
     return SkData::MakeFromMalloc(valueBuffer, valueSize);
 }
 
+void ShaderCache::recordUsageLocked(const void* key, size_t keySize) {
+    if (mWarmUpFramesLeft <= 0 || mUsedKeys.size() >= maxWarmUpShaders) {
+        return;
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(key);
+    auto [it, inserted] = mUsedKeys.emplace(bytes, bytes + keySize);
+    if (inserted && mWarmUpKeys.count(*it) == 0) {
+        mWarmUpStats.missed++;
+    }
+}
+
+void ShaderCache::onFrameCompleted() {
+    if (!mRecordingWarmUp.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::lock_guard lock(mMutex);
+    if (mWarmUpFramesLeft <= 0 || --mWarmUpFramesLeft > 0) {
+        return;
+    }
+    mRecordingWarmUp = false;
+    if (!mInitialized || mDeferredSaveDelayMs == 0) {
+        mUsedKeys.clear();
+        return;
+    }
+
+    // Shaders that were compiled ahead of time are usually not loaded again, keep them in the
+    // list so they are not dropped on the following launch.
+    std::vector<std::vector<uint8_t>> keys(mUsedKeys.begin(), mUsedKeys.end());
+    for (const auto& key : mWarmUpKeys) {
+        if (keys.size() >= maxWarmUpShaders) break;
+        if (mUsedKeys.count(key) == 0) keys.push_back(key);
+    }
+    mUsedKeys.clear();
+    CommonPool::post([filename = warmUpFilename(), keys = std::move(keys)] {
+        writeWarmUpFile(filename, keys);
+    });
+}
+
+ShaderCache::ShaderList ShaderCache::loadWarmUpShaders() {
+    ATRACE_NAME("ShaderCache::loadWarmUpShaders");
+    std::string filename;
+    {
+        std::lock_guard lock(mMutex);
+        if (!mInitialized || mWarmUpLoaded) {
+            return {};
+        }
+        mWarmUpLoaded = true;
+        filename = warmUpFilename();
+    }
+
+    std::vector<std::vector<uint8_t>> keys = readWarmUpFile(filename);
+    ShaderList shaders;
+    std::lock_guard lock(mMutex);
+    if (!mBlobCache) {
+        return shaders;
+    }
+    for (auto& key : keys) {
+        size_t valueSize = mBlobCache->get(key.data(), key.size(), nullptr, 0);
+        if (valueSize == 0 || valueSize > maxValueSize) {
+            continue;
+        }
+        void* valueBuffer = malloc(valueSize);
+        if (!valueBuffer) {
+            break;
+        }
+        if (mBlobCache->get(key.data(), key.size(), valueBuffer, valueSize) != valueSize) {
+            free(valueBuffer);
+            continue;
+        }
+        shaders.emplace_back(SkData::MakeWithCopy(key.data(), key.size()),
+                             SkData::MakeFromMalloc(valueBuffer, valueSize));
+        mWarmUpKeys.insert(std::move(key));
+    }
+    mWarmUpStats.candidates = shaders.size();
+    return shaders;
+}
+
+void ShaderCache::onWarmUpShaderCompiled(const SkData& key, bool compiled) {
+    std::lock_guard lock(mMutex);
+    if (compiled) {
+        mWarmUpStats.compiled++;
+    } else {
+        mWarmUpStats.failed++;
+        // It will be compiled on first use, count that as a miss
+        const uint8_t* bytes = key.bytes();
+        mWarmUpKeys.erase(std::vector<uint8_t>(bytes, bytes + key.size()));
+    }
+}
+
+void ShaderCache::dumpWarmUpStats(String8& log) {
+    std::lock_guard lock(mMutex);
+    log.appendFormat("Shader warm-up: %zu recorded, %d precompiled, %d failed, %d loaded on use\n",
+                     mWarmUpStats.candidates, mWarmUpStats.compiled, mWarmUpStats.failed,
+                     mWarmUpStats.missed);
+}
+
 void ShaderCache::set(const void* key, size_t keySize, const void* value, size_t valueSize) {
     switch (mBlobCache->set(key, keySize, value, valueSize)) {
         case BlobCache::InsertResult::kInserted:
@@ -174,12 +468,21 @@ void ShaderCache::set(const void* key, size_t keySize, const void* value, size_t
 void ShaderCache::saveToDiskLocked() {
     ATRACE_NAME("ShaderCache::saveToDiskLocked");
     if (mInitialized && mBlobCache) {
+        // Everything queued for the journal is part of the cache file written below
+        mJournalPending.clear();
+        mJournalSize = 0;
         // The most straightforward way to make ownership shared
         mMutex.unlock();
         mMutex.lock_shared();
         mBlobCache->writeToFile();
         mMutex.unlock_shared();
         mMutex.lock();
+        // The journal must never hold entries older than the cache file, drop it.
+        std::lock_guard journalLock(mJournalLock);
+        if (unlink(journalFilename().c_str()) != 0 && errno != ENOENT) {
+            ALOGE("ShaderCache: could not remove journal: %s", strerror(errno));
+        }
+        mJournalFailed = false;
     }
 }
 
@@ -219,22 +522,43 @@ void ShaderCache::store(const SkData& key, const SkData& data, const SkString& /
         // Store pipeline cache on the next flush.
         mNewPipelineCacheSize = -1;
         mTryToStorePipelineCache = true;
+        recordUsageLocked(key.data(), keySize);
     }
     set(key.data(), keySize, value, valueSize);
+    if (mDeferredSaveDelayMs > 0) {
+        appendJournalLocked(key.data(), keySize, value, valueSize);
+    }
 
     if (!mSavePending && mDeferredSaveDelayMs > 0) {
         mSavePending = true;
         std::thread deferredSaveThread([this]() {
             usleep(mDeferredSaveDelayMs * 1000);  // milliseconds to microseconds
-            std::lock_guard lock(mMutex);
+            std::unique_lock lock(mMutex);
             // Store file on disk if there a new shader or Vulkan pipeline cache size changed.
-            if (mCacheDirty || mNewPipelineCacheSize != mOldPipelineCacheSize) {
+            if (!mCacheDirty && mNewPipelineCacheSize == mOldPipelineCacheSize) {
+                mSavePending = false;
+                return;
+            }
+            mOldPipelineCacheSize = mNewPipelineCacheSize;
+            mTryToStorePipelineCache = false;
+            mCacheDirty = false;
+            if (mJournalFailed || mJournalSize + mJournalPending.size() > maxJournalSize) {
                 saveToDiskLocked();
-                mOldPipelineCacheSize = mNewPipelineCacheSize;
-                mTryToStorePipelineCache = false;
-                mCacheDirty = false;
+                mSavePending = false;
+                return;
             }
+
+            // Append the new entries without holding mMutex, so that the RenderThread can keep
+            // loading and storing shaders while the journal is written.
+            size_t offset;
+            std::vector<uint8_t> data = takeJournalLocked(&offset);
+            std::string filename = journalFilename();
+            std::lock_guard journalLock(mJournalLock);
             mSavePending = false;
+            lock.unlock();
+            if (!writeJournal(filename, offset, data)) {
+                mJournalFailed = true;
+            }
         });
         deferredSaveThread.detach();
     }
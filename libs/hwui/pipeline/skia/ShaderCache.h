@@ -21,9 +21,14 @@
 #include <cutils/compiler.h>
 #include <ftl/shared_mutex.h>
 #include <utils/Mutex.h>
+#include <utils/String8.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 class SkData;
@@ -87,6 +92,32 @@ public:
      */
     void onVkFrameFlushed(GrDirectContext* context);
 
+    /**
+     * "onFrameCompleted" is called on the RenderThread after every frame. The keys of the shaders
+     * loaded or stored during the first frames after initShaderDiskCache are recorded, and saved
+     * next to the cache file once that window ends so the next launch can compile them early.
+     */
+    void onFrameCompleted();
+
+    /**
+     * "loadWarmUpShaders" returns the key/value pairs of the shaders recorded by the previous
+     * launch that are still in the cache. It reads a file and may be called from any thread, but
+     * only returns shaders the first time it is called after initShaderDiskCache.
+     */
+    using ShaderList = std::vector<std::pair<sk_sp<SkData>, sk_sp<SkData>>>;
+    ShaderList loadWarmUpShaders();
+
+    /**
+     * "onWarmUpShaderCompiled" records the result of precompiling one of the shaders returned by
+     * loadWarmUpShaders.
+     */
+    void onWarmUpShaderCompiled(const SkData& key, bool compiled);
+
+    /**
+     * "dumpWarmUpStats" appends the shader warm-up counters to the given log.
+     */
+    void dumpWarmUpStats(String8& log);
+
 private:
     // Creation and (the lack of) destruction is handled internally.
     ShaderCache();
@@ -114,6 +145,35 @@ private:
      */
     void saveToDiskLocked() REQUIRES(mMutex);
 
+    /**
+     * "replayJournalLocked" applies the entries stored in the journal since the cache file was
+     * last written to the in-memory cache. Entries are only applied if the journal was written
+     * for the current identity hash.
+     */
+    void replayJournalLocked(const std::vector<uint8_t>& journalId) REQUIRES(mMutex);
+
+    /**
+     * "appendJournalLocked" queues a new key/value pair to be appended to the journal by the
+     * next deferred save.
+     */
+    void appendJournalLocked(const void* key, size_t keySize, const void* value, size_t valueSize)
+            REQUIRES(mMutex);
+
+    /**
+     * "takeJournalLocked" hands the queued journal entries over to the caller, which writes them
+     * with writeJournal once mMutex has been released.
+     */
+    std::vector<uint8_t> takeJournalLocked(size_t* offset) REQUIRES(mMutex);
+
+    std::string journalFilename() const REQUIRES(mMutex) { return mFilename + ".journal"; }
+
+    std::string warmUpFilename() const REQUIRES(mMutex) { return mFilename + ".warmup"; }
+
+    /**
+     * "recordUsageLocked" adds a key to the set of shaders used during the warm-up window.
+     */
+    void recordUsageLocked(const void* key, size_t keySize) REQUIRES(mMutex);
+
     /**
      * "mInitialized" indicates whether the ShaderCache is in the initialized
      * state.  It is initialized to false at construction time, and gets set to
@@ -204,6 +264,73 @@ private:
      */
     bool mCacheDirty GUARDED_BY(mMutex) = false;
 
+    /**
+     * New entries are not persisted by rewriting the whole cache file, which would mean writing
+     * megabytes for every new shader. They are instead appended to a journal file next to it,
+     * which is replayed on top of the cache file by initShaderDiskCache. The cache file is only
+     * rewritten, and the journal discarded, once the journal grows too large.
+     *
+     * "mJournalPending" holds the serialized entries stored since the last deferred save.
+     */
+    std::vector<uint8_t> mJournalPending GUARDED_BY(mMutex);
+
+    /**
+     * "mJournalId" is the identity hash the journal on disk was written for.
+     */
+    std::vector<uint8_t> mJournalId GUARDED_BY(mMutex);
+
+    /**
+     * "mJournalSize" is the number of bytes in the journal file, including the entries that are
+     * currently being written. Zero means the journal has to be recreated by the next write.
+     */
+    size_t mJournalSize GUARDED_BY(mMutex) = 0;
+
+    /**
+     * "mJournalFailed" is set when appending to the journal fails, in which case the next deferred
+     * save rewrites the whole cache file instead.
+     */
+    std::atomic<bool> mJournalFailed = false;
+
+    /**
+     * "mJournalLock" serializes writes to the journal file, which happen without holding mMutex.
+     * It is always acquired after mMutex.
+     */
+    std::mutex mJournalLock;
+
+    /**
+     * "mUsedKeys" holds the keys of the shaders used since initShaderDiskCache, for as long as
+     * "mWarmUpFramesLeft" is non-zero.
+     */
+    std::set<std::vector<uint8_t>> mUsedKeys GUARDED_BY(mMutex);
+    int mWarmUpFramesLeft GUARDED_BY(mMutex) = 0;
+
+    /**
+     * "mRecordingWarmUp" is set while "mWarmUpFramesLeft" is non-zero, so that onFrameCompleted
+     * only takes mMutex during the first frames.
+     */
+    std::atomic_bool mRecordingWarmUp = false;
+
+    /**
+     * "mWarmUpKeys" holds the keys recorded by the previous launch, which are loaded once by
+     * loadWarmUpShaders. "mWarmUpLoaded" is set once that happened, until the next
+     * initShaderDiskCache.
+     */
+    std::set<std::vector<uint8_t>> mWarmUpKeys GUARDED_BY(mMutex);
+    bool mWarmUpLoaded GUARDED_BY(mMutex) = false;
+
+    /**
+     * Shader warm-up counters reported by dumpWarmUpStats.
+     */
+    struct WarmUpStats {
+        // Shaders recorded by the previous launch that were found in the cache
+        size_t candidates = 0;
+        int compiled = 0;
+        int failed = 0;
+        // Shaders loaded during the warm-up window that were not compiled ahead of time
+        int missed = 0;
+    };
+    WarmUpStats mWarmUpStats GUARDED_BY(mMutex);
+
     /**
      * "sCache" is the singleton ShaderCache object.
      */
@@ -182,8 +182,7 @@ void SkiaDisplayList::reset() {
     mChildFunctors.clear();
     mChildNodes.clear();
 
-    allocator.~LinearAllocator();
-    new (&allocator) LinearAllocator();
+    allocator.reset();
 }
 
 void SkiaDisplayList::output(std::ostream& output, uint32_t level) const {
@@ -96,6 +96,9 @@ std::unique_ptr<SkiaDisplayList> SkiaRecordingCanvas::finishRecording() {
     // close any existing chunks if necessary
     enableZ(false);
     mRecorder.restoreToCount(1);
+    if (Properties::compactDisplayLists) {
+        mDisplayList->mDisplayList.compact();
+    }
     return std::move(mDisplayList);
 }
 
@@ -28,13 +28,20 @@
 #include "DeviceInfo.h"
 #include "Layer.h"
 #include "Properties.h"
+#include "RecordingCanvas.h"
 #include "RenderThread.h"
+#include "RetainedLayerCache.h"
+#include "VectorDrawableCache.h"
 #include "VulkanManager.h"
+#include "hwui/Bitmap.h"
+#include "hwui/FontLoadStats.h"
 #include "pipeline/skia/ATraceMemoryDump.h"
+#include "pipeline/skia/MemoryCategoryDump.h"
 #include "pipeline/skia/ShaderCache.h"
 #include "pipeline/skia/SkiaMemoryTracer.h"
 #include "renderstate/RenderState.h"
 #include "thread/CommonPool.h"
+#include "utils/LinearAllocator.h"
 
 namespace android {
 namespace uirenderer {
@@ -45,6 +52,8 @@ CacheManager::CacheManager(RenderThread& thread)
     mMaxSurfaceArea = static_cast<size_t>((DeviceInfo::getWidth() * DeviceInfo::getHeight()) *
                                           mMemoryPolicy.initialMaxSurfaceAreaScale);
     setupCacheLimits();
+    RetainedLayerCache::get().setLimits(mMemoryPolicy.retainedLayerFrameThreshold,
+                                        mMemoryPolicy.retainedLayerBudgetBytes);
 }
 
 static inline int countLeadingZeros(uint32_t mask) {
@@ -60,6 +69,9 @@ static inline uint32_t nextPowerOfTwo(uint32_t n) {
 void CacheManager::setupCacheLimits() {
     mMaxResourceBytes = mMaxSurfaceArea * mMemoryPolicy.surfaceSizeMultiplier;
     mBackgroundResourceBytes = mMaxResourceBytes * mMemoryPolicy.backgroundRetentionPercent;
+    mTierUsage.warm.budgetBytes = mMaxResourceBytes * mMemoryPolicy.warmRetentionPercent;
+    mTierUsage.background.budgetBytes = mBackgroundResourceBytes;
+    updateHotBudget();
     // This sets the maximum size for a single texture atlas in the GPU font cache. If
     // necessary, the cache can allocate additional textures that are counted against the
     // total cache limits provided to Skia.
@@ -75,6 +87,12 @@ void CacheManager::setupCacheLimits() {
     }
 }
 
+void CacheManager::updateHotBudget() {
+    mTierUsage.hot.budgetBytes =
+            std::min(mTierUsage.warm.budgetBytes,
+                     static_cast<size_t>(mNextFrameArea * mMemoryPolicy.hotFrameSizeMultiplier));
+}
+
 void CacheManager::reset(sk_sp<GrDirectContext> context) {
     if (context != mGrContext) {
         destroy();
@@ -89,6 +107,7 @@ void CacheManager::reset(sk_sp<GrDirectContext> context) {
 
 void CacheManager::destroy() {
     // cleanup any caches here as the GrContext is about to go away...
+    RetainedLayerCache::get().evictAll();
     mGrContext.reset(nullptr);
 }
 
@@ -108,9 +127,45 @@ void CacheManager::configureContext(GrContextOptions* contextOptions, const void
     auto& cache = skiapipeline::ShaderCache::get();
     cache.initShaderDiskCache(identity, size);
     contextOptions->fPersistentCache = &cache;
+    scheduleShaderWarmUp();
+}
+
+// Keeps each warm-up task short so that frames queued on the RenderThread are not held back
+static constexpr size_t kShadersPerWarmUpTask = 4;
+
+void CacheManager::scheduleShaderWarmUp() {
+    // Reading the list of shaders used by the previous launch happens in the background, the
+    // compilation itself needs the GrContext and is done on the RenderThread between frames.
+    CommonPool::post([this] {
+        auto shaders = std::make_shared<const ShaderList>(
+                skiapipeline::ShaderCache::get().loadWarmUpShaders());
+        if (shaders->empty()) return;
+        mRenderThread.queue().post([this, shaders] { precompileShaders(shaders, 0); });
+    });
+}
+
+void CacheManager::precompileShaders(std::shared_ptr<const ShaderList> shaders, size_t start) {
+    if (!mGrContext) return;
+    ATRACE_NAME("CacheManager::precompileShaders");
+    auto& cache = skiapipeline::ShaderCache::get();
+    size_t end = std::min(shaders->size(), start + kShadersPerWarmUpTask);
+    for (size_t i = start; i < end; i++) {
+        const auto& [key, data] = (*shaders)[i];
+        cache.onWarmUpShaderCompiled(*key, mGrContext->precompileShader(*key, *data));
+    }
+    if (end < shaders->size()) {
+        mRenderThread.queue().post([this, shaders, end] { precompileShaders(shaders, end); });
+    }
 }
 
 void CacheManager::trimMemory(TrimLevel mode) {
+    LinearAllocator::trimPageCache();
+    if (mode >= TrimLevel::UI_HIDDEN) {
+        VectorDrawable::VectorDrawableCache::get().clear();
+        RetainedLayerCache::get().evictAll();
+        Bitmap::purgePixelPool();
+    }
+
     if (!mGrContext) {
         return;
     }
@@ -124,7 +179,9 @@ void CacheManager::trimMemory(TrimLevel mode) {
             SkGraphics::PurgeAllCaches();
             mRenderThread.destroyRenderingContext();
             break;
-        case TrimLevel::UI_HIDDEN:
+        case TrimLevel::UI_HIDDEN: {
+            size_t bytesBefore;
+            mGrContext->getResourceCacheUsage(nullptr, &bytesBefore);
             // Here we purge all the unlocked scratch resources and then toggle the resources cache
             // limits between the background and max amounts. This causes the unlocked resources
             // that have persistent data to be purged in LRU order.
@@ -133,10 +190,16 @@ void CacheManager::trimMemory(TrimLevel mode) {
             mGrContext->purgeUnlockedResources(mMemoryPolicy.purgeScratchOnly);
             mGrContext->setResourceCacheLimit(mMaxResourceBytes);
             SkGraphics::SetFontCacheLimit(mMaxCpuFontCacheBytes);
+            size_t bytesAfter;
+            mGrContext->getResourceCacheUsage(nullptr, &bytesAfter);
+            mTierUsage.background.trimCount++;
+            mTierUsage.background.trimmedBytes += bytesBefore - std::min(bytesBefore, bytesAfter);
             break;
+        }
         default:
             break;
     }
+    sampleMemory(/*afterTrim=*/true);
 }
 
 void CacheManager::trimCaches(CacheTrimLevel mode) {
@@ -156,9 +219,13 @@ void CacheManager::trimCaches(CacheTrimLevel mode) {
         default:
             break;
     }
+    sampleMemory(/*afterTrim=*/true);
 }
 
 void CacheManager::trimStaleResources() {
+    const nsecs_t now = systemTime(CLOCK_MONOTONIC);
+    VectorDrawable::VectorDrawableCache::get().trimStale(now);
+    Bitmap::trimPixelPool(now, mMemoryPolicy.minimumResourceRetention);
     if (!mGrContext) {
         return;
     }
@@ -166,9 +233,13 @@ void CacheManager::trimStaleResources() {
     mGrContext->purgeResourcesNotUsedInMs(std::chrono::seconds(30));
 }
 
-void CacheManager::getMemoryUsage(size_t* cpuUsage, size_t* gpuUsage) {
+void CacheManager::getMemoryUsage(size_t* cpuUsage, size_t* gpuUsage,
+                                  CacheTierUsage* tierUsage) {
     *cpuUsage = 0;
     *gpuUsage = 0;
+    if (tierUsage) {
+        *tierUsage = mTierUsage;
+    }
     if (!mGrContext) {
         return;
     }
@@ -196,11 +267,34 @@ void CacheManager::dumpMemoryUsage(String8& log, const RenderState* renderState)
         log.appendFormat("  IsSystemOrPersistent\n");
     }
     log.appendFormat("  GPU Context timeout: %" PRIu64 "\n", ns2s(mMemoryPolicy.contextTimeout));
+    log.appendFormat("  AnimatedImage decode ahead: %d frames, %.2fMB\n",
+                     mMemoryPolicy.animatedImageDecodeAheadFrames,
+                     mMemoryPolicy.animatedImageDecodeAheadBytes / 1000000.f);
+    log.appendFormat("  Retained layers: after %d frames, %.2fMB\n",
+                     mMemoryPolicy.retainedLayerFrameThreshold,
+                     mMemoryPolicy.retainedLayerBudgetBytes / 1000000.f);
+    log.appendFormat("  Bitmap pool: %.2fMB\n", mMemoryPolicy.bitmapPoolBytes / 1000000.f);
+    const std::pair<const char*, const CacheTierUsage::Tier&> tiers[] = {
+            {"Hot", mTierUsage.hot},
+            {"Warm", mTierUsage.warm},
+            {"Background", mTierUsage.background},
+    };
+    for (const auto& [name, tier] : tiers) {
+        log.appendFormat("  %s budget: %.2fMB (trimmed %u times, %.2fMB)\n", name,
+                         tier.budgetBytes / 1000000.f, tier.trimCount,
+                         tier.trimmedBytes / 1000000.f);
+    }
     size_t stoppedContexts = 0;
     for (auto context : mCanvasContexts) {
         if (context->isStopped()) stoppedContexts++;
     }
     log.appendFormat("Contexts: %zu (stopped = %zu)\n", mCanvasContexts.size(), stoppedContexts);
+    skiapipeline::ShaderCache::get().dumpWarmUpStats(log);
+    VectorDrawable::VectorDrawableCache::get().dumpMemoryUsage(log);
+    RetainedLayerCache::get().dumpMemoryUsage(log);
+    Bitmap::dumpPixelPool(log);
+    DisplayListData::dumpCompactionStats(log);
+    FontLoadStats::get().dump(log);
 
     auto vkInstance = VulkanManager::peekInstance();
     if (!mGrContext) {
@@ -256,11 +350,25 @@ void CacheManager::dumpMemoryUsage(String8& log, const RenderState* renderState)
 
     log.appendFormat("Total GPU memory usage:\n");
     gpuTracer.logTotals(log);
+
+    if (mMemorySamples.size() > 0) {
+        log.appendFormat("Memory samples by category:\n");
+        const nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        for (size_t i = 0; i < mMemorySamples.size(); i++) {
+            skiapipeline::MemoryCategoryDump::logSample(mMemorySamples[i], now, log);
+        }
+    }
 }
 
 void CacheManager::onFrameCompleted() {
     cancelDestroyContext();
+    skiapipeline::ShaderCache::get().onFrameCompleted();
+    scheduleHotTrim();
     mFrameCompletions.next() = systemTime(CLOCK_MONOTONIC);
+    if (mMemorySamples.size() == 0 ||
+        mFrameCompletions.back() - mMemorySamples.back().time >= 1_s) {
+        sampleMemory(/*afterTrim=*/false);
+    }
     if (ATRACE_ENABLED()) {
         static skiapipeline::ATraceMemoryDump tracer;
         tracer.startFrame();
@@ -272,6 +380,13 @@ void CacheManager::onFrameCompleted() {
     }
 }
 
+void CacheManager::sampleMemory(bool afterTrim) {
+    skiapipeline::MemorySample& sample = mMemorySamples.next();
+    mMemoryCategoryDump.sample(mGrContext.get(), &sample);
+    sample.time = systemTime(CLOCK_MONOTONIC);
+    sample.afterTrim = afterTrim;
+}
+
 void CacheManager::onThreadIdle() {
     if (!mGrContext || mFrameCompletions.size() == 0) return;
 
@@ -285,9 +400,45 @@ void CacheManager::onThreadIdle() {
                 ns2ms(std::max(frameDiffNanos, mMemoryPolicy.minimumResourceRetention));
         mGrContext->performDeferredCleanup(std::chrono::milliseconds(cleanupMillis),
                                            mMemoryPolicy.purgeScratchOnly);
+        trimToBudget(mTierUsage.warm.budgetBytes, mTierUsage.warm);
+        VectorDrawable::VectorDrawableCache::get().trimStale(now);
+        Bitmap::trimPixelPool(now, mMemoryPolicy.minimumResourceRetention);
     }
 }
 
+void CacheManager::trimToBudget(size_t budgetBytes, CacheTierUsage::Tier& tier) {
+    size_t bytes;
+    mGrContext->getResourceCacheUsage(nullptr, &bytes);
+    if (bytes <= budgetBytes || mGrContext->getResourceCachePurgeableBytes() == 0) {
+        return;
+    }
+    ATRACE_NAME("CacheManager::trimToBudget");
+    // Purges in LRU order, starting with scratch resources which are the cheapest to recreate
+    mGrContext->purgeUnlockedResources(bytes - budgetBytes, /*preferScratchResources=*/true);
+    size_t bytesAfter;
+    mGrContext->getResourceCacheUsage(nullptr, &bytesAfter);
+    if (bytesAfter < bytes) {
+        tier.trimCount++;
+        tier.trimmedBytes += bytes - bytesAfter;
+    }
+}
+
+void CacheManager::scheduleHotTrim() {
+    if (mIsHotTrimPending || mMemoryPolicy.hotTrimTimeout <= 0) return;
+    mIsHotTrimPending = true;
+    mRenderThread.queue().postDelayed(mMemoryPolicy.hotTrimTimeout, [this] {
+        mIsHotTrimPending = false;
+        if (!mGrContext || mFrameCompletions.size() == 0) return;
+        const nsecs_t idleNanos = systemTime(CLOCK_MONOTONIC) - mFrameCompletions.back();
+        if (idleNanos < mMemoryPolicy.hotTrimTimeout) {
+            // Frames were drawn in the meantime, check again once they have stopped
+            scheduleHotTrim();
+            return;
+        }
+        trimToBudget(mTierUsage.hot.budgetBytes, mTierUsage.hot);
+    });
+}
+
 void CacheManager::scheduleDestroyContext() {
     if (mMemoryPolicy.contextTimeout > 0) {
         mRenderThread.queue().postDelayed(mMemoryPolicy.contextTimeout,
@@ -345,9 +496,12 @@ void CacheManager::onContextStopped(CanvasContext* context) {
 
 void CacheManager::notifyNextFrameSize(int width, int height) {
     int frameArea = width * height;
+    mNextFrameArea = frameArea;
     if (frameArea > mMaxSurfaceArea) {
         mMaxSurfaceArea = frameArea;
         setupCacheLimits();
+    } else {
+        updateHotBudget();
     }
 }
 
@@ -23,12 +23,17 @@
 #include <SkSurface.h>
 #include <utils/String8.h>
 
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "MemoryPolicy.h"
+#include "pipeline/skia/MemoryCategoryDump.h"
 #include "utils/RingBuffer.h"
 #include "utils/TimeUtils.h"
 
+class SkData;
+
 namespace android {
 
 class Surface;
@@ -42,6 +47,21 @@ namespace renderthread {
 class RenderThread;
 class CanvasContext;
 
+// The resource cache is kept within one of three budgets. The hot budget covers the resources
+// needed by the frames currently being drawn, the warm budget is what the cache is trimmed to
+// while the UI is active, and the background budget applies once the UI is hidden.
+struct CacheTierUsage {
+    struct Tier {
+        size_t budgetBytes = 0;
+        // How often the cache was trimmed to this tier, and how many bytes that released
+        uint32_t trimCount = 0;
+        size_t trimmedBytes = 0;
+    };
+    Tier hot;
+    Tier warm;
+    Tier background;
+};
+
 class CacheManager {
 public:
 #ifdef __ANDROID__ // Layoutlib does not support hardware acceleration
@@ -51,7 +71,7 @@ public:
     void trimCaches(CacheTrimLevel mode);
     void trimStaleResources();
     void dumpMemoryUsage(String8& log, const RenderState* renderState = nullptr);
-    void getMemoryUsage(size_t* cpuUsage, size_t* gpuUsage);
+    void getMemoryUsage(size_t* cpuUsage, size_t* gpuUsage, CacheTierUsage* tierUsage = nullptr);
 
     size_t getCacheSize() const { return mMaxResourceBytes; }
     size_t getBackgroundCacheSize() const { return mBackgroundResourceBytes; }
@@ -69,6 +89,7 @@ private:
 
     explicit CacheManager(RenderThread& thread);
     void setupCacheLimits();
+    void updateHotBudget();
     bool areAllContextsStopped();
     void checkUiHidden();
     void scheduleDestroyContext();
@@ -76,6 +97,12 @@ private:
 
 #ifdef __ANDROID__ // Layoutlib does not support hardware acceleration
     void reset(sk_sp<GrDirectContext> grContext);
+    using ShaderList = std::vector<std::pair<sk_sp<SkData>, sk_sp<SkData>>>;
+    void scheduleShaderWarmUp();
+    void precompileShaders(std::shared_ptr<const ShaderList> shaders, size_t start);
+    void trimToBudget(size_t budgetBytes, CacheTierUsage::Tier& tier);
+    void scheduleHotTrim();
+    void sampleMemory(bool afterTrim);
 #endif
     void destroy();
 
@@ -89,6 +116,9 @@ private:
 
     size_t mMaxResourceBytes = 0;
     size_t mBackgroundResourceBytes = 0;
+    size_t mNextFrameArea = 0;
+    CacheTierUsage mTierUsage;
+    bool mIsHotTrimPending = false;
 
     size_t mMaxGpuFontAtlasBytes = 0;
     size_t mMaxCpuFontCacheBytes = 0;
@@ -96,6 +126,12 @@ private:
 
     std::vector<CanvasContext*> mCanvasContexts;
     RingBuffer<uint64_t, 100> mFrameCompletions;
+#ifdef __ANDROID__ // Layoutlib does not support hardware acceleration
+    // About the last minute of activity, sampled at most once per second while frames are drawn
+    // and after every trim
+    skiapipeline::MemoryCategoryDump mMemoryCategoryDump;
+    RingBuffer<skiapipeline::MemorySample, 64> mMemorySamples;
+#endif
 
     nsecs_t mLastDeferredCleanup = 0;
     bool mIsDestructionPending = false;
@@ -244,6 +244,7 @@ void CanvasContext::setupPipelineSurface() {
     if (mNativeSurface != nullptr && hasSurface) {
         mHaveNewSurface = true;
         mSwapHistory.clear();
+        mDamageHistory.clear();
         // Enable frame stats after the surface has been bound to the appropriate graphics API.
         // Order is important when new and old surfaces are the same, because old surface has
         // its frame stats disabled automatically.
@@ -429,6 +430,7 @@ void CanvasContext::prepareTree(TreeInfo& info, int64_t* uiFrameInfo, int64_t sy
     info.out.canDrawThisFrame = true;
 
     mAnimationContext->startFrame(info.mode);
+    mHintSessionWrapper.onFrameStart(mAnimationContext->hasAnimations());
     for (const sp<RenderNode>& node : mRenderNodes) {
         // Only the primary target node will be drawn full - all other nodes would get drawn in
         // real time mode. In case of a window, the primary node is the window content and the other
@@ -439,6 +441,7 @@ void CanvasContext::prepareTree(TreeInfo& info, int64_t* uiFrameInfo, int64_t sy
     }
     mAnimationContext->runRemainingAnimations(info);
     GL_CHECKPOINT(MODERATE);
+    mCurrentFrameInfo->setFunctorSync(info.out.functorSyncDuration, info.out.functorSyncCount);
 
     freePrefetchedLayers();
     GL_CHECKPOINT(MODERATE);
@@ -656,13 +659,13 @@ void CanvasContext::draw(bool solelyTextureViewUpdates) {
             didDraw = false;
         }
 
-        SwapHistory& swap = mSwapHistory.next();
         if (didDraw) {
-            swap.damage = windowDirty;
+            mDamageHistory.onBufferPresented(frame, windowDirty);
         } else {
-            float max = static_cast<float>(INT_MAX);
-            swap.damage = SkRect::MakeWH(max, max);
+            // The contents of every buffer are now unknown
+            mDamageHistory.clear();
         }
+        SwapHistory& swap = mSwapHistory.next();
         swap.swapCompletedTime = systemTime(SYSTEM_TIME_MONOTONIC);
         swap.vsyncTime = mRenderThread.timeLord().latestVsync();
         if (didDraw) {
@@ -973,6 +976,7 @@ DeferredLayerUpdater* CanvasContext::createTextureLayer() {
 
 void CanvasContext::dumpFrames(int fd) {
     mJankTracker.dumpStats(fd);
+    mHintSessionWrapper.dumpPredictionStats(fd);
     mJankTracker.dumpFrames(fd);
 }
 
@@ -995,7 +999,8 @@ void CanvasContext::waitOnFences() {
 }
 
 void CanvasContext::enqueueFrameWork(std::function<void()>&& func) {
-    mFrameFences.push_back(CommonPool::async(std::move(func)));
+    mFrameFences.push_back(
+            CommonPool::async(std::move(func), CommonPool::Priority::FrameCritical));
 }
 
 uint64_t CanvasContext::getFrameNumber() {
@@ -1050,18 +1055,12 @@ SkRect CanvasContext::computeDirtyRect(const Frame& frame, SkRect* dirty) {
     // last frame so there's nothing to union() against
     // Therefore we only care about the > 1 case.
     if (frame.bufferAge() > 1) {
-        if (frame.bufferAge() > (int)mSwapHistory.size()) {
+        // At this point we haven't yet added the latest frame to the damage history (happens
+        // after the swap), so this only adds what the buffer missed before it
+        if (!mDamageHistory.addBufferDamage(frame, dirty)) {
             // We don't have enough history to handle this old of a buffer
             // Just do a full-draw
             dirty->setIWH(frame.width(), frame.height());
-        } else {
-            // At this point we haven't yet added the latest frame
-            // to the damage history (happens below)
-            // So we need to damage
-            for (int i = mSwapHistory.size() - 1;
-                 i > ((int)mSwapHistory.size()) - frame.bufferAge(); i--) {
-                dirty->join(mSwapHistory[i].damage);
-            }
         }
     }
 
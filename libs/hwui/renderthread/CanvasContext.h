@@ -32,6 +32,7 @@
 
 #include "ColorMode.h"
 #include "DamageAccumulator.h"
+#include "DamageHistory.h"
 #include "FrameInfo.h"
 #include "FrameInfoVisualizer.h"
 #include "FrameMetricsReporter.h"
@@ -164,6 +165,7 @@ public:
 
     void dumpFrames(int fd);
     void resetFrameStats();
+    int getFrameInfoRingFd() { return mJankTracker.getFrameInfoRingFd(); }
 
     void setName(const std::string&& name);
 
@@ -300,7 +302,6 @@ private:
     bool mIsDirty = false;
     SwapBehavior mSwapBehavior = SwapBehavior::kSwap_default;
     struct SwapHistory {
-        SkRect damage;
         nsecs_t vsyncTime;
         nsecs_t swapCompletedTime;
         nsecs_t dequeueDuration;
@@ -309,6 +310,7 @@ private:
 
     // Need at least 4 because we do quad buffer. Add a few more for good measure.
     RingBuffer<SwapHistory, 7> mSwapHistory;
+    DamageHistory mDamageHistory;
     // Frame numbers start at 1, 0 means uninitialized
     uint64_t mFrameNumber = 0;
     int64_t mDamageId = 0;
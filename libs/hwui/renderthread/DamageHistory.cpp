@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DamageHistory.h"
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+static bool isTrackedSlot(int32_t slot) {
+    return slot >= 0 && slot < DamageHistory::kMaxBufferSlots;
+}
+
+void DamageHistory::clear() {
+    mSlots.fill(BufferSlot{});
+    mRecentDamage.clear();
+}
+
+bool DamageHistory::addBufferDamage(const Frame& frame, SkRect* dirty) const {
+    const int32_t slot = frame.bufferSlot();
+    if (isTrackedSlot(slot)) {
+        if (!mSlots[slot].hasValidContents) {
+            return false;
+        }
+        dirty->join(mSlots[slot].pendingDamage);
+        return true;
+    }
+
+    // A buffer of age 1 holds the previous frame, every older one misses the damage of the
+    // frames presented after it
+    const int age = frame.bufferAge();
+    if (age <= 0 || age > static_cast<int>(mRecentDamage.size())) {
+        return false;
+    }
+    for (int i = mRecentDamage.size() - 1; i > static_cast<int>(mRecentDamage.size()) - age;
+         i--) {
+        dirty->join(mRecentDamage[i]);
+    }
+    return true;
+}
+
+void DamageHistory::onBufferPresented(const Frame& frame, const SkRect& damage) {
+    const int32_t slot = frame.bufferSlot();
+    for (int32_t i = 0; i < kMaxBufferSlots; i++) {
+        if (i == slot) {
+            mSlots[i].hasValidContents = true;
+            mSlots[i].pendingDamage.setEmpty();
+        } else {
+            mSlots[i].pendingDamage.join(damage);
+        }
+    }
+    mRecentDamage.next() = damage;
+}
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
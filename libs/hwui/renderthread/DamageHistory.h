@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <SkRect.h>
+
+#include <array>
+
+#include "Frame.h"
+#include "utils/Macros.h"
+#include "utils/RingBuffer.h"
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+/**
+ * Remembers the damage of the frames presented to a surface, so that a frame drawn into a buffer
+ * with older contents only has to repaint what changed since that buffer was last presented.
+ *
+ * When the pipeline knows which swapchain image a frame is drawn into, the damage is accumulated
+ * per image, which works for buffers of any age. Otherwise it falls back to joining the damage of
+ * the last bufferAge - 1 frames.
+ */
+class DamageHistory {
+    PREVENT_COPY_AND_ASSIGN(DamageHistory);
+
+public:
+    DamageHistory() {}
+
+    // Forgets all damage, for example because the surface changed. Until a buffer is presented
+    // again its contents can't be reused.
+    void clear();
+
+    // Joins into `dirty` the area of the frame's buffer that is out of date. Returns false if the
+    // buffer's contents are unknown and the whole frame has to be repainted.
+    bool addBufferDamage(const Frame& frame, SkRect* dirty) const;
+
+    // Records that `frame` was presented after repainting `damage`.
+    void onBufferPresented(const Frame& frame, const SkRect& damage);
+
+    static constexpr int kMaxBufferSlots = 8;
+    static constexpr int kMaxBufferAge = 8;
+
+private:
+    struct BufferSlot {
+        bool hasValidContents = false;
+        // Damage of the frames presented since this buffer was.
+        SkRect pendingDamage = SkRect::MakeEmpty();
+    };
+
+    std::array<BufferSlot, kMaxBufferSlots> mSlots;
+    RingBuffer<SkRect, kMaxBufferAge> mRecentDamage;
+};
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
@@ -27,8 +27,8 @@ namespace renderthread {
 
 class Frame {
 public:
-    Frame(int32_t width, int32_t height, int32_t bufferAge)
-            : mWidth(width), mHeight(height), mBufferAge(bufferAge) {}
+    Frame(int32_t width, int32_t height, int32_t bufferAge, int32_t bufferSlot = -1)
+            : mWidth(width), mHeight(height), mBufferAge(bufferAge), mBufferSlot(bufferSlot) {}
 
     int32_t width() const { return mWidth; }
     int32_t height() const { return mHeight; }
@@ -37,6 +37,9 @@ public:
     // for what this means
     int32_t bufferAge() const { return mBufferAge; }
 
+    // Which of the surface's buffers the frame is drawn into, or -1 if the pipeline can't tell.
+    int32_t bufferSlot() const { return mBufferSlot; }
+
 private:
     Frame() {}
     friend class EglManager;
@@ -44,6 +47,7 @@ private:
     int32_t mWidth;
     int32_t mHeight;
     int32_t mBufferAge;
+    int32_t mBufferSlot = -1;
 
     EGLSurface mSurface;
 
@@ -18,8 +18,10 @@
 
 #include <dlfcn.h>
 #include <private/performance_hint_private.h>
+#include <stdio.h>
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <chrono>
 #include <vector>
 
@@ -135,9 +137,71 @@ void HintSessionWrapper::reportActualWorkDuration(long actualDurationNanos) {
     if (actualDurationNanos > kSanityCheckLowerBound &&
         actualDurationNanos < kSanityCheckUpperBound) {
         mBinding->reportActualWorkDuration(mHintSession, actualDurationNanos);
+
+        mPredictionStats.framesReported++;
+        if (mLastTargetWorkDuration > 0 && actualDurationNanos > mLastTargetWorkDuration) {
+            mPredictionStats.framesOverTarget++;
+            if (mPredictedExpensive) {
+                mPredictionStats.correctPredictions++;
+            } else {
+                mPredictionStats.missedPredictions++;
+            }
+        }
+        mRecentWorkDurations.next() = actualDurationNanos;
+        // Exponential moving average with a weight of 1/4 for the newest frame.
+        mAverageWorkDuration = mAverageWorkDuration == 0
+                                       ? actualDurationNanos
+                                       : (mAverageWorkDuration * 3 + actualDurationNanos) / 4;
+    }
+    mPredictedExpensive = false;
+}
+
+nsecs_t HintSessionWrapper::predictWorkDuration() const {
+    size_t count = mRecentWorkDurations.size();
+    if (count == 0) return 0;
+    // Frame costs are bursty, so follow the latest frame up quickly but only come back down
+    // at the pace of the average.
+    nsecs_t last = mRecentWorkDurations[count - 1];
+    nsecs_t prediction = std::max(mAverageWorkDuration, last);
+    if (count >= 2 && last > mRecentWorkDurations[count - 2]) {
+        // Frames keep getting slower, assume the next one continues the trend.
+        prediction += last - mRecentWorkDurations[count - 2];
+    }
+    return prediction;
+}
+
+void HintSessionWrapper::onFrameStart(bool isAnimating) {
+    bool animationStarted = isAnimating && !mWasAnimating;
+    mWasAnimating = isAnimating;
+    if (!Properties::usePredictiveHints || !init() || mLastTargetWorkDuration <= 0) return;
+
+    // The first frames of an animation or a scroll usually pay for inflation, layout and
+    // texture uploads that the history knows nothing about.
+    nsecs_t expensiveThreshold = mLastTargetWorkDuration * kExpensiveFramePercentage / 100;
+    mPredictedExpensive = animationStarted || predictWorkDuration() > expensiveThreshold;
+    if (!mPredictedExpensive) return;
+
+    mPredictionStats.predictedExpensive++;
+    nsecs_t now = systemTime();
+    if (now - mLastLoadUpHint > kLoadUpHintInterval) {
+        mLastLoadUpHint = now;
+        mPredictionStats.loadUpHints++;
+        mBinding->sendHint(mHintSession, static_cast<int32_t>(SessionHint::CPU_LOAD_UP));
     }
 }
 
+void HintSessionWrapper::dumpPredictionStats(int fd) const {
+    const PredictionStats& stats = mPredictionStats;
+    dprintf(fd, "\nHint session: %s mode",
+            Properties::usePredictiveHints ? "predictive" : "reactive");
+    dprintf(fd, "\n  Frames reported: %u, over target: %u", stats.framesReported,
+            stats.framesOverTarget);
+    dprintf(fd, "\n  Load-up hints: %u, predicted expensive: %u, correct: %u, missed: %u",
+            stats.loadUpHints, stats.predictedExpensive, stats.correctPredictions,
+            stats.missedPredictions);
+    dprintf(fd, "\n");
+}
+
 void HintSessionWrapper::sendLoadResetHint() {
     static constexpr int kMaxResetsSinceLastReport = 2;
     if (!init()) return;
@@ -152,6 +216,8 @@ void HintSessionWrapper::sendLoadResetHint() {
 
 void HintSessionWrapper::sendLoadIncreaseHint() {
     if (!init()) return;
+    mPredictionStats.loadUpHints++;
+    mLastLoadUpHint = systemTime();
     mBinding->sendHint(mHintSession, static_cast<int32_t>(SessionHint::CPU_LOAD_UP));
 }
 
@@ -20,6 +20,7 @@
 
 #include <future>
 
+#include "utils/RingBuffer.h"
 #include "utils/TimeUtils.h"
 
 namespace android {
@@ -41,7 +42,29 @@ public:
     bool init();
     void destroy();
 
+    // Called when the RenderThread starts working on a frame. In predictive mode this sends a
+    // load-up hint ahead of frames that are expected to miss their target, based on the recent
+    // work durations and on whether an animation is starting.
+    void onFrameStart(bool isAnimating);
+
+    // Counters used to compare the predictive and reactive modes. Frames over target are the
+    // jank cost and load-up hints are the power cost.
+    struct PredictionStats {
+        uint32_t framesReported = 0;
+        uint32_t framesOverTarget = 0;
+        uint32_t loadUpHints = 0;
+        uint32_t predictedExpensive = 0;
+        // Frames predicted to be expensive that did go over target.
+        uint32_t correctPredictions = 0;
+        // Frames that went over target without a load-up hint ahead of them.
+        uint32_t missedPredictions = 0;
+    };
+    const PredictionStats& predictionStats() const { return mPredictionStats; }
+    void dumpPredictionStats(int fd) const;
+
 private:
+    nsecs_t predictWorkDuration() const;
+
     APerformanceHintSession* mHintSession = nullptr;
     std::future<APerformanceHintSession*> mHintSessionFuture;
 
@@ -54,7 +77,18 @@ private:
 
     bool mSessionValid = true;
 
+    RingBuffer<nsecs_t, 4> mRecentWorkDurations;
+    nsecs_t mAverageWorkDuration = 0;
+    nsecs_t mLastLoadUpHint = 0;
+    bool mWasAnimating = false;
+    bool mPredictedExpensive = false;
+    PredictionStats mPredictionStats;
+
     static constexpr nsecs_t kResetHintTimeout = 100_ms;
+    // A load-up hint boosts the session for a while, don't send them back to back.
+    static constexpr nsecs_t kLoadUpHintInterval = 100_ms;
+    // Frames predicted to use more than this percentage of the target are treated as expensive.
+    static constexpr int kExpensiveFramePercentage = 90;
     static constexpr int64_t kSanityCheckLowerBound = 100_us;
     static constexpr int64_t kSanityCheckUpperBound = 10_s;
 
@@ -34,6 +34,7 @@
 #include <SkPicture.h>
 
 #include <pthread.h>
+#include <unistd.h>
 
 namespace android {
 namespace uirenderer {
@@ -206,6 +207,15 @@ bool RenderProxy::copyLayerInto(DeferredLayerUpdater* layer, SkBitmap& bitmap) {
     });
 }
 
+void RenderProxy::copyLayerIntoAsync(DeferredLayerUpdater* layer,
+                                     std::shared_ptr<MultiRegionCopyRequest>&& request) {
+    auto& thread = RenderThread::getInstance();
+    thread.queue().post([&thread, layer = sp<DeferredLayerUpdater>(layer),
+                         request = std::move(request)] {
+        thread.readback().copyLayerIntoAsync(layer.get(), request);
+    });
+}
+
 void RenderProxy::pushLayerUpdate(DeferredLayerUpdater* layer) {
     mDrawFrameTask.pushLayerUpdate(layer);
 }
@@ -306,6 +316,13 @@ void RenderProxy::resetProfileInfo() {
     });
 }
 
+int RenderProxy::getFrameInfoRingFd() {
+    return mRenderThread.queue().runSync([this]() -> int {
+        int fd = mContext->getFrameInfoRingFd();
+        return fd >= 0 ? dup(fd) : -1;
+    });
+}
+
 uint32_t RenderProxy::frameTimePercentile(int percentile) {
     return mRenderThread.queue().runSync([&]() -> auto {
         std::lock_guard lock(mRenderThread.globalProfileData().getDataMutex());
@@ -425,6 +442,16 @@ void RenderProxy::copySurfaceInto(ANativeWindow* window, std::shared_ptr<CopyReq
     });
 }
 
+void RenderProxy::copySurfaceIntoAsync(ANativeWindow* window,
+                                       std::shared_ptr<MultiRegionCopyRequest>&& request) {
+    auto& thread = RenderThread::getInstance();
+    ANativeWindow_acquire(window);
+    thread.queue().post([&thread, window, request = std::move(request)] {
+        thread.readback().copySurfaceIntoAsync(window, request);
+        ANativeWindow_release(window);
+    });
+}
+
 void RenderProxy::prepareToDraw(Bitmap& bitmap) {
     // If we haven't spun up a hardware accelerated window yet, there's no
     // point in precaching these bitmaps as it can't impact jank.
@@ -99,6 +99,8 @@ public:
     DeferredLayerUpdater* createTextureLayer();
     void buildLayer(RenderNode* node);
     bool copyLayerInto(DeferredLayerUpdater* layer, SkBitmap& bitmap);
+    void copyLayerIntoAsync(DeferredLayerUpdater* layer,
+                            std::shared_ptr<MultiRegionCopyRequest>&& request);
     void pushLayerUpdate(DeferredLayerUpdater* layer);
     void cancelLayerUpdate(DeferredLayerUpdater* layer);
     void detachSurfaceTexture(DeferredLayerUpdater* layer);
@@ -119,6 +121,9 @@ public:
     void dumpProfileInfo(int fd, int dumpFlags);
     // Not exported, only used for testing
     void resetProfileInfo();
+    // Returns a dup of the fd of the shared memory ring that finished frames are exported to, or
+    // -1 if it could not be created. The caller owns the returned fd.
+    int getFrameInfoRingFd();
     uint32_t frameTimePercentile(int p);
     static void dumpGraphicsMemory(int fd, bool includeProfileData = true,
                                    bool resetProfile = false);
@@ -145,6 +150,8 @@ public:
     void setForceDark(bool enable);
 
     static void copySurfaceInto(ANativeWindow* window, std::shared_ptr<CopyRequest>&& request);
+    static void copySurfaceIntoAsync(ANativeWindow* window,
+                                     std::shared_ptr<MultiRegionCopyRequest>&& request);
     static void prepareToDraw(Bitmap& bitmap);
 
     static int copyHWBitmapInto(Bitmap* hwBitmap, SkBitmap* bitmap);
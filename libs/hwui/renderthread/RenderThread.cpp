@@ -302,8 +302,10 @@ void RenderThread::requireVkContext() {
     mVkManager->initialize();
     GrContextOptions options;
     initGrContextOptions(options);
-    auto vkDriverVersion = mVkManager->getDriverVersion();
-    cacheManager().configureContext(&options, &vkDriverVersion, sizeof(vkDriverVersion));
+    // Skia keeps the VkPipelineCache data in the persistent cache, make sure it is discarded when
+    // the GPU or the driver build changes.
+    const auto& vkIdentity = mVkManager->getPipelineCacheIdentity();
+    cacheManager().configureContext(&options, &vkIdentity, sizeof(vkIdentity));
     sk_sp<GrDirectContext> grContext = mVkManager->createContext(options);
     LOG_ALWAYS_FATAL_IF(!grContext.get());
     setGrContext(grContext);
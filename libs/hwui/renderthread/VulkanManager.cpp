@@ -28,6 +28,8 @@
 #include <vk/GrVkExtensions.h>
 #include <vk/GrVkTypes.h>
 
+#include <cstring>
+
 #include "Properties.h"
 #include "RenderThread.h"
 #include "pipeline/skia/ShaderCache.h"
@@ -216,6 +218,11 @@ void VulkanManager::setupDevice(GrVkExtensions& grExtensions, VkPhysicalDeviceFe
     mGetPhysicalDeviceProperties(mPhysicalDevice, &physDeviceProperties);
     LOG_ALWAYS_FATAL_IF(physDeviceProperties.apiVersion < VK_MAKE_VERSION(1, 1, 0));
     mDriverVersion = physDeviceProperties.driverVersion;
+    mPipelineCacheIdentity.vendorID = physDeviceProperties.vendorID;
+    mPipelineCacheIdentity.deviceID = physDeviceProperties.deviceID;
+    mPipelineCacheIdentity.driverVersion = physDeviceProperties.driverVersion;
+    memcpy(mPipelineCacheIdentity.pipelineCacheUUID, physDeviceProperties.pipelineCacheUUID,
+           VK_UUID_SIZE);
 
     // query to get the initial queue props size
     uint32_t queueCount = 0;
@@ -526,7 +533,8 @@ Frame VulkanManager::dequeueNextBuffer(VulkanSurface* surface) {
     }
 
     int bufferAge = (mSwapBehavior == SwapBehavior::Discard) ? 0 : surface->getCurrentBuffersAge();
-    return Frame(surface->logicalWidth(), surface->logicalHeight(), bufferAge);
+    return Frame(surface->logicalWidth(), surface->logicalHeight(), bufferAge,
+                 surface->getCurrentBufferSlot());
 }
 
 struct DestroySemaphoreInfo {
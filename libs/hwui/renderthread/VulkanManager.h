@@ -111,6 +111,19 @@ public:
 
     uint32_t getDriverVersion() const { return mDriverVersion; }
 
+    // Identifies the VkPipelineCache data produced by this device and driver. Pipeline caches are
+    // only valid for the exact physical device and driver build that created them, which the
+    // driver version alone does not capture, so this is what the persistent cache is keyed on.
+    struct PipelineCacheIdentity {
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    };
+    const PipelineCacheIdentity& getPipelineCacheIdentity() const {
+        return mPipelineCacheIdentity;
+    }
+
 private:
     friend class VulkanSurface;
 
@@ -200,6 +213,7 @@ private:
     SwapBehavior mSwapBehavior = SwapBehavior::Discard;
     GrVkExtensions mExtensions;
     uint32_t mDriverVersion = 0;
+    PipelineCacheIdentity mPipelineCacheIdentity = {};
 
     VkSemaphore mSwapSemaphore = VK_NULL_HANDLE;
     void* mDestroySemaphoreContext = nullptr;
@@ -78,6 +78,9 @@ private:
     int logicalWidth() const { return mWindowInfo.size.width(); }
     int logicalHeight() const { return mWindowInfo.size.height(); }
     int getCurrentBuffersAge();
+    int getCurrentBufferSlot() const {
+        return mCurrentBufferInfo ? static_cast<int>(mCurrentBufferInfo - mNativeBuffers) : -1;
+    }
 
 private:
     /*
@@ -19,11 +19,13 @@
 #include <android/util/ProtoOutputStream.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <functional>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <inttypes.h>
 #include <log/log.h>
 #include <stats_event.h>
 #include <statslog_hwui.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -38,9 +40,19 @@ namespace uirenderer {
 using namespace google::protobuf;
 using namespace uirenderer::protos;
 
-constexpr int32_t sCurrentFileVersion = 1;
+// Version 1 files hold a single GraphicsStatsProto. Version 2 files are append-only: every
+// saveBuffer() adds a record, holding only the frames of that save and leaving out empty histogram
+// buckets, and the records are merged when the file is read. A record is its size as a uint32_t
+// followed by the GraphicsStatsProto.
+constexpr int32_t sSingleProtoFileVersion = 1;
+constexpr int32_t sCurrentFileVersion = 2;
 constexpr int32_t sHeaderSize = 4;
+constexpr int32_t sRecordHeaderSize = 4;
 static_assert(sizeof(sCurrentFileVersion) == sHeaderSize, "Header size is wrong");
+static_assert(sizeof(uint32_t) == sRecordHeaderSize, "Record header size is wrong");
+
+// Files that have grown past this are merged into a single record on the next save.
+constexpr off_t sCompactThreshold = 64 * 1024;
 
 constexpr int sHistogramSize = ProfileData::HistogramSize();
 constexpr int sGPUHistogramSize = ProfileData::GPUHistogramSize();
@@ -48,6 +60,8 @@ constexpr int sGPUHistogramSize = ProfileData::GPUHistogramSize();
 static bool mergeProfileDataIntoProto(protos::GraphicsStatsProto* proto, const std::string& package,
                                       int64_t versionCode, int64_t startTime, int64_t endTime,
                                       const ProfileData* data);
+static bool mergeStatsIntoProto(protos::GraphicsStatsProto* proto,
+                                const protos::GraphicsStatsProto& stats);
 static void dumpAsTextToFd(protos::GraphicsStatsProto* proto, int outFd);
 
 class FileDescriptor {
@@ -141,22 +155,177 @@ bool GraphicsStatsService::parseFromFile(const std::string& path,
         return false;
     }
     uint32_t file_version = *reinterpret_cast<uint32_t*>(addr);
-    if (file_version != sCurrentFileVersion) {
+    if (file_version != sCurrentFileVersion && file_version != sSingleProtoFileVersion) {
         ALOGW("file_version mismatch! expected %d got %d", sCurrentFileVersion, file_version);
         munmap(addr, sb.st_size);
         return false;
     }
 
-    void* data = reinterpret_cast<uint8_t*>(addr) + sHeaderSize;
-    int dataSize = sb.st_size - sHeaderSize;
-    io::ArrayInputStream input{data, dataSize};
-    bool success = output->ParseFromZeroCopyStream(&input);
-    if (!success) {
-        ALOGW("Parse failed on '%s' error='%s'", path.c_str(),
-              output->InitializationErrorString().c_str());
+    // The records are parsed straight out of the mapping and merged one after the other.
+    const uint8_t* cursor = reinterpret_cast<uint8_t*>(addr) + sHeaderSize;
+    const uint8_t* end = reinterpret_cast<uint8_t*>(addr) + sb.st_size;
+    output->Clear();
+    int records = 0;
+    while (cursor < end) {
+        uint32_t recordSize = static_cast<uint32_t>(end - cursor);
+        if (file_version == sCurrentFileVersion) {
+            if (end - cursor < sRecordHeaderSize) {
+                ALOGW("Truncated record header in '%s'", path.c_str());
+                break;
+            }
+            memcpy(&recordSize, cursor, sRecordHeaderSize);
+            cursor += sRecordHeaderSize;
+            if (recordSize > static_cast<uint32_t>(end - cursor)) {
+                // A save that was interrupted; keep the records before it.
+                ALOGW("Truncated record in '%s'", path.c_str());
+                break;
+            }
+        }
+        protos::GraphicsStatsProto record;
+        io::ArrayInputStream input{cursor, static_cast<int>(recordSize)};
+        if (!record.ParseFromZeroCopyStream(&input)) {
+            ALOGW("Parse failed on '%s' error='%s'", path.c_str(),
+                  record.InitializationErrorString().c_str());
+            break;
+        }
+        if (!mergeStatsIntoProto(output, record)) {
+            break;
+        }
+        cursor += recordSize;
+        records++;
     }
     munmap(addr, sb.st_size);
-    return success;
+    return records > 0;
+}
+
+// Fills in every bucket of both histograms of |proto|, with no frames.
+static void initHistograms(protos::GraphicsStatsProto* proto) {
+    const ProfileData empty;
+    proto->mutable_histogram()->Reserve(sHistogramSize);
+    empty.histogramForEach([&](ProfileData::HistogramEntry entry) {
+        auto bucket = proto->add_histogram();
+        bucket->set_render_millis(entry.renderTimeMs);
+        bucket->set_frame_count(0);
+    });
+    proto->mutable_gpu_histogram()->Reserve(sGPUHistogramSize);
+    empty.histogramGPUForEach([&](ProfileData::HistogramEntry entry) {
+        auto bucket = proto->add_gpu_histogram();
+        bucket->set_render_millis(entry.renderTimeMs);
+        bucket->set_frame_count(0);
+    });
+}
+
+// Adds the frames of |from| to the buckets of |into|. The buckets of |from| must be some of those
+// of |into|, in the same order.
+static bool mergeHistogram(
+        RepeatedPtrField<protos::GraphicsStatsHistogramBucketProto>* into,
+        const RepeatedPtrField<protos::GraphicsStatsHistogramBucketProto>& from) {
+    int index = 0;
+    for (const auto& bucket : from) {
+        while (index < into->size() && into->Get(index).render_millis() != bucket.render_millis()) {
+            index++;
+        }
+        if (index == into->size()) {
+            ALOGW("Frame time mismatch, no bucket for %dms", bucket.render_millis());
+            return false;
+        }
+        auto intoBucket = into->Mutable(index);
+        intoBucket->set_frame_count(intoBucket->frame_count() + bucket.frame_count());
+    }
+    return true;
+}
+
+// Merges |stats| into |proto|, whose histograms are filled in first if it has none. The package,
+// version and pipeline of |stats| replace those of |proto|.
+bool mergeStatsIntoProto(protos::GraphicsStatsProto* proto,
+                         const protos::GraphicsStatsProto& stats) {
+    if (proto->histogram_size() == 0 && proto->gpu_histogram_size() == 0) {
+        initHistograms(proto);
+    }
+    if (!mergeHistogram(proto->mutable_histogram(), stats.histogram()) ||
+        !mergeHistogram(proto->mutable_gpu_histogram(), stats.gpu_histogram())) {
+        return false;
+    }
+    if (proto->stats_start() == 0 || proto->stats_start() > stats.stats_start()) {
+        proto->set_stats_start(stats.stats_start());
+    }
+    if (proto->stats_end() == 0 || proto->stats_end() < stats.stats_end()) {
+        proto->set_stats_end(stats.stats_end());
+    }
+    proto->set_package_name(stats.package_name());
+    proto->set_version_code(stats.version_code());
+    proto->set_pipeline(stats.pipeline());
+    auto summary = proto->mutable_summary();
+    summary->set_total_frames(summary->total_frames() + stats.summary().total_frames());
+    summary->set_janky_frames(summary->janky_frames() + stats.summary().janky_frames());
+    summary->set_missed_vsync_count(summary->missed_vsync_count() +
+                                    stats.summary().missed_vsync_count());
+    summary->set_high_input_latency_count(summary->high_input_latency_count() +
+                                          stats.summary().high_input_latency_count());
+    summary->set_slow_ui_thread_count(summary->slow_ui_thread_count() +
+                                      stats.summary().slow_ui_thread_count());
+    summary->set_slow_bitmap_upload_count(summary->slow_bitmap_upload_count() +
+                                          stats.summary().slow_bitmap_upload_count());
+    summary->set_slow_draw_count(summary->slow_draw_count() + stats.summary().slow_draw_count());
+    summary->set_missed_deadline_count(summary->missed_deadline_count() +
+                                       stats.summary().missed_deadline_count());
+    return true;
+}
+
+// Removes the buckets without frames, which a saved record doesn't need.
+static void removeEmptyBuckets(
+        RepeatedPtrField<protos::GraphicsStatsHistogramBucketProto>* histogram) {
+    int kept = 0;
+    for (int i = 0; i < histogram->size(); i++) {
+        if (histogram->Get(i).frame_count() != 0) {
+            histogram->SwapElements(kept++, i);
+        }
+    }
+    histogram->DeleteSubrange(kept, histogram->size() - kept);
+}
+
+// Writes |record| to |fd| as a record of a version 2 file.
+static bool writeRecord(int fd, const std::string& path, const protos::GraphicsStatsProto& record) {
+    std::string buffer(sRecordHeaderSize, '\0');
+    if (!record.AppendToString(&buffer)) {
+        ALOGW("Serialize failed on '%s' unknown error", path.c_str());
+        return false;
+    }
+    const uint32_t recordSize = buffer.size() - sRecordHeaderSize;
+    memcpy(buffer.data(), &recordSize, sRecordHeaderSize);
+    const char* data = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining > 0) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, data, remaining));
+        if (ret <= 0) {
+            int err = errno;
+            ALOGW("Error writing to fd=%d, path='%s' err=%d (%s)", fd, path.c_str(), err,
+                  strerror(err));
+            return false;
+        }
+        data += ret;
+        remaining -= ret;
+    }
+    return true;
+}
+
+// Appends |record| to the version 2 file at |path| unless it is due to be compacted, and returns
+// whether it did.
+static bool appendRecord(const std::string& path, const protos::GraphicsStatsProto& record) {
+    FileDescriptor fd{open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC)};
+    if (!fd.valid()) {
+        return false;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) || sb.st_size < sHeaderSize || sb.st_size >= sCompactThreshold) {
+        return false;
+    }
+    int32_t fileVersion = 0;
+    if (TEMP_FAILURE_RETRY(pread(fd, &fileVersion, sHeaderSize, 0)) != sHeaderSize ||
+        fileVersion != sCurrentFileVersion) {
+        return false;
+    }
+    return writeRecord(fd, path, record);
 }
 
 bool mergeProfileDataIntoProto(protos::GraphicsStatsProto* proto, const std::string& package,
@@ -322,24 +491,37 @@ void dumpAsTextToFd(protos::GraphicsStatsProto* proto, int fd) {
 void GraphicsStatsService::saveBuffer(const std::string& path, const std::string& package,
                                       int64_t versionCode, int64_t startTime, int64_t endTime,
                                       const ProfileData* data) {
-    protos::GraphicsStatsProto statsProto;
-    if (!parseFromFile(path, &statsProto)) {
-        statsProto.Clear();
+    protos::GraphicsStatsProto record;
+    if (!mergeProfileDataIntoProto(&record, package, versionCode, startTime, endTime, data)) {
+        return;
     }
-    if (!mergeProfileDataIntoProto(&statsProto, package, versionCode, startTime, endTime, data)) {
+    // Merging the data should always fully-initialize the proto
+    if (!record.IsInitialized()) {
+        ALOGE("proto initialization error %s", record.InitializationErrorString().c_str());
         return;
     }
-    // Although we might not have read any data from the file, merging the existing data
-    // should always fully-initialize the proto
-    if (!statsProto.IsInitialized()) {
-        ALOGE("proto initialization error %s", statsProto.InitializationErrorString().c_str());
+    if (record.package_name().empty() || !record.has_summary()) {
+        ALOGE("missing package_name() '%s' summary %d", record.package_name().c_str(),
+              record.has_summary());
         return;
     }
-    if (statsProto.package_name().empty() || !statsProto.has_summary()) {
-        ALOGE("missing package_name() '%s' summary %d", statsProto.package_name().c_str(),
-              statsProto.has_summary());
+    removeEmptyBuckets(record.mutable_histogram());
+    removeEmptyBuckets(record.mutable_gpu_histogram());
+    if (appendRecord(path, record)) {
         return;
     }
+
+    // The file is new, too large or in the old format: rewrite it as a single record holding the
+    // stats it had and the new ones.
+    protos::GraphicsStatsProto statsProto;
+    if (!parseFromFile(path, &statsProto)) {
+        statsProto.Clear();
+    }
+    if (!mergeStatsIntoProto(&statsProto, record)) {
+        return;
+    }
+    removeEmptyBuckets(statsProto.mutable_histogram());
+    removeEmptyBuckets(statsProto.mutable_gpu_histogram());
     int outFd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0660);
     if (outFd <= 0) {
         int err = errno;
@@ -354,17 +536,7 @@ void GraphicsStatsService::saveBuffer(const std::string& path, const std::string
         close(outFd);
         return;
     }
-    {
-        FileOutputStreamLite output(outFd);
-        bool success = statsProto.SerializeToZeroCopyStream(&output) && output.Flush();
-        if (output.GetErrno() != 0) {
-            ALOGW("Error writing to fd=%d, path='%s' err=%d (%s)", outFd, path.c_str(),
-                  output.GetErrno(), strerror(output.GetErrno()));
-            success = false;
-        } else if (!success) {
-            ALOGW("Serialize failed on '%s' unknown error", path.c_str());
-        }
-    }
+    writeRecord(outFd, path, statsProto);
     close(outFd);
 }
 
@@ -379,7 +551,9 @@ public:
     DumpType type() { return mType; }
     protos::GraphicsStatsServiceDumpProto& proto() { return mProto; }
     void mergeStat(const protos::GraphicsStatsProto& stat);
-    void updateProto();
+    // Visits the merged stats of a statsd dump, or the stats added to the others, without copying
+    // them.
+    void forEachStat(const std::function<void(const protos::GraphicsStatsProto&)>& callback);
 
 private:
     // use package name and app version for a key
@@ -397,39 +571,20 @@ void GraphicsStatsService::Dump::mergeStat(const protos::GraphicsStatsProto& sta
     if (findIt == mStats.end()) {
         mStats[dumpKey] = stat;
     } else {
-        auto summary = findIt->second.mutable_summary();
-        summary->set_total_frames(summary->total_frames() + stat.summary().total_frames());
-        summary->set_janky_frames(summary->janky_frames() + stat.summary().janky_frames());
-        summary->set_missed_vsync_count(summary->missed_vsync_count() +
-                                        stat.summary().missed_vsync_count());
-        summary->set_high_input_latency_count(summary->high_input_latency_count() +
-                                              stat.summary().high_input_latency_count());
-        summary->set_slow_ui_thread_count(summary->slow_ui_thread_count() +
-                                          stat.summary().slow_ui_thread_count());
-        summary->set_slow_bitmap_upload_count(summary->slow_bitmap_upload_count() +
-                                              stat.summary().slow_bitmap_upload_count());
-        summary->set_slow_draw_count(summary->slow_draw_count() + stat.summary().slow_draw_count());
-        summary->set_missed_deadline_count(summary->missed_deadline_count() +
-                                           stat.summary().missed_deadline_count());
-        for (int bucketIndex = 0; bucketIndex < findIt->second.histogram_size(); bucketIndex++) {
-            auto bucket = findIt->second.mutable_histogram(bucketIndex);
-            bucket->set_frame_count(bucket->frame_count() +
-                                    stat.histogram(bucketIndex).frame_count());
-        }
-        for (int bucketIndex = 0; bucketIndex < findIt->second.gpu_histogram_size();
-             bucketIndex++) {
-            auto bucket = findIt->second.mutable_gpu_histogram(bucketIndex);
-            bucket->set_frame_count(bucket->frame_count() +
-                                    stat.gpu_histogram(bucketIndex).frame_count());
-        }
-        findIt->second.set_stats_start(std::min(findIt->second.stats_start(), stat.stats_start()));
-        findIt->second.set_stats_end(std::max(findIt->second.stats_end(), stat.stats_end()));
+        mergeStatsIntoProto(&findIt->second, stat);
     }
 }
 
-void GraphicsStatsService::Dump::updateProto() {
-    for (auto& stat : mStats) {
-        mProto.add_stats()->CopyFrom(stat.second);
+void GraphicsStatsService::Dump::forEachStat(
+        const std::function<void(const protos::GraphicsStatsProto&)>& callback) {
+    if (mType == DumpType::ProtobufStatsd) {
+        for (const auto& stat : mStats) {
+            callback(stat.second);
+        }
+    } else {
+        for (const auto& stat : mProto.stats()) {
+            callback(stat);
+        }
     }
 }
 
@@ -533,10 +688,7 @@ static void writeGpuHistogram(AStatsEvent* event,
 
 void GraphicsStatsService::finishDumpInMemory(Dump* dump, AStatsEventList* data,
                                               bool lastFullDay) {
-    dump->updateProto();
-    auto& serviceDump = dump->proto();
-    for (int stat_index = 0; stat_index < serviceDump.stats_size(); stat_index++) {
-        auto& stat = serviceDump.stats(stat_index);
+    dump->forEachStat([&](const protos::GraphicsStatsProto& stat) {
         AStatsEvent* event = AStatsEventList_addStatsEvent(data);
         AStatsEvent_setAtomId(event, stats::GRAPHICS_STATS);
         AStatsEvent_writeString(event, stat.package_name().c_str());
@@ -557,7 +709,7 @@ void GraphicsStatsService::finishDumpInMemory(Dump* dump, AStatsEventList* data,
         AStatsEvent_writeInt64(event, (int64_t)0);
         AStatsEvent_writeBool(event, !lastFullDay);
         AStatsEvent_build(event);
-    }
+    });
     delete dump;
 }
 
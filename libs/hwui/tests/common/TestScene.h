@@ -41,6 +41,17 @@ public:
         bool renderOffscreen = true;
         bool reportGpuMemoryUsage = false;
         bool reportGpuMemoryUsageVerbose = false;
+        // Frames drawn before measuring starts, or -1 for a default that suits renderOffscreen.
+        int warmupFrameCount = -1;
+        // Adds p50/p90/p99/max of every frame stage to the benchmark report.
+        bool reportFramePercentiles = false;
+        // If set, the FrameInfo of every measured frame is appended to this CSV file.
+        std::string frameCsvPath;
+        // Shell commands run before and after each test, e.g. to pin and unpin CPU/GPU clocks.
+        std::string preRunHook;
+        std::string postRunHook;
+        // Tells runs of the same scene with different options apart in the report.
+        std::string label;
     };
 
     template <class T>
@@ -29,6 +29,7 @@
 #include <renderthread/RenderThread.h>
 
 #include <SkBitmap.h>
+#include <SkBlendMode.h>
 #include <SkColor.h>
 #include <SkImageInfo.h>
 #include <SkRefCnt.h>
@@ -36,6 +37,7 @@
 #include <gtest/gtest.h>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 class SkCanvas;
 class SkMatrix;
@@ -204,6 +206,31 @@ public:
         return node;
     }
 
+    /**
+     * Creates a synthetic tree `depth` levels deep, in which every node but the leaves draws
+     * `width` children and every leaf draws a rect. Every node of the tree, parents before their
+     * children, is appended to outNodes if it isn't null. Nothing is synced yet.
+     */
+    static sp<RenderNode> createTree(int depth, int width,
+                                     std::vector<sp<RenderNode>>* outNodes = nullptr) {
+        sp<RenderNode> node = createNode(0, 0, 100, 100, nullptr);
+        if (outNodes) {
+            outNodes->push_back(node);
+        }
+        recordNode(*node, [depth, width, outNodes](Canvas& canvas) {
+            if (depth <= 1) {
+                canvas.drawColor(SK_ColorBLUE, SkBlendMode::kSrcOver);
+                return;
+            }
+            for (int i = 0; i < width; i++) {
+                sp<RenderNode> child = createTree(depth - 1, width, outNodes);
+                child->mutateStagingProperties().setTranslationX(i);
+                canvas.drawRenderNode(child.get());
+            }
+        });
+        return node;
+    }
+
     static void recordNode(RenderNode& node, std::function<void(Canvas&)> contentCallback) {
         std::unique_ptr<Canvas> canvas(Canvas::create_recording_canvas(
                 node.stagingProperties().getWidth(), node.stagingProperties().getHeight(), &node));
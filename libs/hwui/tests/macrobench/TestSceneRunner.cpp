@@ -16,6 +16,8 @@
 
 #include <gui/TraceUtils.h>
 #include "AnimationContext.h"
+#include "FrameInfo.h"
+#include "FrameMetricsObserver.h"
 #include "RenderNode.h"
 #include "renderthread/RenderProxy.h"
 #include "renderthread/RenderTask.h"
@@ -28,6 +30,16 @@
 #include <log/log.h>
 #include <ui/PixelFormat.h>
 
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <vector>
+
 // These are unstable internal APIs in google-benchmark. We should just implement our own variant
 // of these instead, but this was quicker. Disabled-by-default to avoid any breakages when
 // google-benchmark updates if they change anything
@@ -76,15 +88,138 @@ private:
     T mAverage;
 };
 
+static constexpr size_t kFrameInfoSize = static_cast<size_t>(FrameInfoIndex::NumIndexes);
+using FrameRecord = std::array<int64_t, kFrameInfoSize>;
+
+// Keeps the FrameInfo of every frame the RenderThread reports, so the run can be summarized per
+// stage instead of only by its average frame rate.
+class FrameRecorder : public FrameMetricsObserver {
+public:
+    FrameRecorder() : FrameMetricsObserver(false /*waitForPresentTime*/) {}
+
+    void notify(const int64_t* buffer) override {
+        FrameRecord record;
+        std::copy(buffer, buffer + kFrameInfoSize, record.begin());
+        std::lock_guard lock(mLock);
+        mFrames.push_back(record);
+    }
+
+    std::vector<FrameRecord> frames() {
+        std::lock_guard lock(mLock);
+        return mFrames;
+    }
+
+private:
+    std::mutex mLock;
+    std::vector<FrameRecord> mFrames;
+};
+
+struct FrameStage {
+    const char* name;
+    FrameInfoIndex start;
+    // The stage lasts from start to end, or, if both are the same, that field is a duration.
+    FrameInfoIndex end;
+};
+
+static const FrameStage kFrameStages[] = {
+        {"Total", FrameInfoIndex::IntendedVsync, FrameInfoIndex::FrameCompleted},
+        {"Sync", FrameInfoIndex::SyncStart, FrameInfoIndex::IssueDrawCommandsStart},
+        {"Draw", FrameInfoIndex::IssueDrawCommandsStart, FrameInfoIndex::SwapBuffers},
+        {"Swap", FrameInfoIndex::SwapBuffers, FrameInfoIndex::SwapBuffersCompleted},
+        {"Gpu", FrameInfoIndex::IssueDrawCommandsStart, FrameInfoIndex::GpuCompleted},
+        {"Dequeue", FrameInfoIndex::DequeueBufferDuration, FrameInfoIndex::DequeueBufferDuration},
+        {"Queue", FrameInfoIndex::QueueBufferDuration, FrameInfoIndex::QueueBufferDuration},
+};
+
+// Returns the duration of the stage in ms, or a negative value if the frame didn't record it.
+// Offscreen runs for instance have no GPU completion times.
+static double stageDurationMs(const FrameStage& stage, const FrameRecord& frame) {
+    int64_t start = frame[static_cast<size_t>(stage.start)];
+    int64_t end = frame[static_cast<size_t>(stage.end)];
+    if (stage.start == stage.end) {
+        return start / 1000000.0;
+    }
+    if (start <= 0 || end <= 0 || end < start) {
+        return -1;
+    }
+    return (end - start) / 1000000.0;
+}
+
+// Nearest-rank percentile of sorted, non-empty values.
+static double percentile(const std::vector<double>& sorted, int pct) {
+    size_t rank = (sorted.size() * pct + 99) / 100;
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static void addFramePercentiles(const std::vector<FrameRecord>& frames,
+                                benchmark::BenchmarkReporter::Run* report) {
+    for (const FrameStage& stage : kFrameStages) {
+        std::vector<double> durations;
+        durations.reserve(frames.size());
+        for (const FrameRecord& frame : frames) {
+            double duration = stageDurationMs(stage, frame);
+            if (duration >= 0) {
+                durations.push_back(duration);
+            }
+        }
+        if (durations.empty()) {
+            continue;
+        }
+        std::sort(durations.begin(), durations.end());
+        std::string name = stage.name;
+        report->counters[name + "_p50"] = percentile(durations, 50);
+        report->counters[name + "_p90"] = percentile(durations, 90);
+        report->counters[name + "_p99"] = percentile(durations, 99);
+        report->counters[name + "_max"] = durations.back();
+    }
+}
+
+static void writeFrameCsv(const TestScene::Info& info, const TestScene::Options& opts,
+                          int repetitionIndex, const std::vector<FrameRecord>& frames) {
+    FILE* file = fopen(opts.frameCsvPath.c_str(), "a");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s' for writing, errno=%d\n", opts.frameCsvPath.c_str(),
+                errno);
+        return;
+    }
+    if (ftell(file) == 0) {
+        fprintf(file, "scene,label,repetition,frame");
+        for (const char* name : FrameInfoNames) {
+            fprintf(file, ",%s", name);
+        }
+        fprintf(file, "\n");
+    }
+    for (size_t i = 0; i < frames.size(); i++) {
+        fprintf(file, "%s,%s,%d,%zu", info.name.c_str(), opts.label.c_str(), repetitionIndex, i);
+        for (int64_t value : frames[i]) {
+            fprintf(file, ",%" PRId64, value);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+static void runHook(const std::string& command) {
+    if (command.empty()) {
+        return;
+    }
+    int status = system(command.c_str());
+    if (status != 0) {
+        fprintf(stderr, "Hook '%s' failed with status %d\n", command.c_str(), status);
+    }
+}
+
 using BenchmarkResults = std::vector<benchmark::BenchmarkReporter::Run>;
 
 void outputBenchmarkReport(const TestScene::Info& info, const TestScene::Options& opts,
-                           double durationInS, int repetationIndex, BenchmarkResults* reports) {
+                           double durationInS, int repetationIndex,
+                           const std::vector<FrameRecord>& frames, BenchmarkResults* reports) {
     using namespace benchmark;
     benchmark::BenchmarkReporter::Run report;
     report.repetitions = opts.repeatCount;
     report.repetition_index = repetationIndex;
     report.run_name.function_name = info.name;
+    report.run_name.args = opts.label;
     report.iterations = static_cast<int64_t>(opts.frameCount);
     report.real_accumulated_time = durationInS;
     report.cpu_accumulated_time = durationInS;
@@ -95,6 +230,9 @@ void outputBenchmarkReport(const TestScene::Info& info, const TestScene::Options
         report.counters["Rendering RAM"] = Counter{static_cast<double>(cpuUsage + gpuUsage),
                                                    Counter::kDefaults, Counter::kIs1024};
     }
+    if (opts.reportFramePercentiles) {
+        addFramePercentiles(frames, &report);
+    }
     reports->push_back(report);
 }
 
@@ -132,7 +270,9 @@ static void doRun(const TestScene::Info& info, const TestScene::Options& opts, i
 
     // Do a few cold runs then reset the stats so that the caches are all hot
     int warmupFrameCount = 5;
-    if (opts.renderOffscreen) {
+    if (opts.warmupFrameCount >= 0) {
+        warmupFrameCount = opts.warmupFrameCount;
+    } else if (opts.renderOffscreen) {
         // Do a few more warmups to try and boost the clocks up
         warmupFrameCount = 10;
     }
@@ -150,6 +290,12 @@ static void doRun(const TestScene::Info& info, const TestScene::Options& opts, i
     proxy->resetProfileInfo();
     proxy->fence();
 
+    sp<FrameRecorder> frameRecorder;
+    if (opts.reportFramePercentiles || !opts.frameCsvPath.empty()) {
+        frameRecorder = new FrameRecorder();
+        proxy->addFrameMetricsObserver(frameRecorder.get());
+    }
+
     ModifiedMovingAverage<double> avgMs(opts.reportFrametimeWeight);
 
     nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -178,9 +324,19 @@ static void doRun(const TestScene::Info& info, const TestScene::Options& opts, i
     proxy->fence();
     nsecs_t end = systemTime(SYSTEM_TIME_MONOTONIC);
 
+    std::vector<FrameRecord> frames;
+    if (frameRecorder) {
+        proxy->removeFrameMetricsObserver(frameRecorder.get());
+        proxy->fence();
+        frames = frameRecorder->frames();
+        if (!opts.frameCsvPath.empty()) {
+            writeFrameCsv(info, opts, repetitionIndex, frames);
+        }
+    }
+
     if (reports) {
         outputBenchmarkReport(info, opts, (end - start) / (double)s2ns(1), repetitionIndex,
-                              reports);
+                              frames, reports);
     } else {
         proxy->dumpProfileInfo(STDOUT_FILENO, DumpFlags::JankStats);
     }
@@ -189,9 +345,11 @@ static void doRun(const TestScene::Info& info, const TestScene::Options& opts, i
 void run(const TestScene::Info& info, const TestScene::Options& opts,
          benchmark::BenchmarkReporter* reporter) {
     BenchmarkResults results;
+    runHook(opts.preRunHook);
     for (int i = 0; i < opts.repeatCount; i++) {
         doRun(info, opts, i, reporter ? &results : nullptr);
     }
+    runHook(opts.postRunHook);
     if (reporter) {
         reporter->ReportRuns(results);
         if (results.size() > 1) {
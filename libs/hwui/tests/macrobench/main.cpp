@@ -25,9 +25,11 @@
 #include <benchmark/benchmark.h>
 #include <fnmatch.h>
 #include <getopt.h>
+#include <json/json.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -41,8 +43,14 @@ using namespace android;
 using namespace android::uirenderer;
 using namespace android::uirenderer::test;
 
-static std::vector<TestScene::Info> gRunTests;
+struct TestRun {
+    TestScene::Info info;
+    TestScene::Options opts;
+};
+
+static std::vector<TestRun> gRunTests;
 static TestScene::Options gOpts;
+static const char* gConfigPath = nullptr;
 static bool gRunLeakCheck = true;
 std::unique_ptr<benchmark::BenchmarkReporter> gBenchmarkReporter;
 
@@ -72,6 +80,15 @@ OPTIONS:
   --renderer=TYPE      Sets the render pipeline to use. May be skiagl or skiavk
   --skip-leak-check    Skips the memory leak check
   --report-gpu-memory[=verbose]  Dumps the GPU memory usage after each test run
+  --warmup=NUM         Draw NUM frames before measuring. Default is 10 offscreen
+                       and 5 onscreen
+  --frame-percentiles  Report p50/p90/p99/max of every frame stage
+  --frame-csv=FILE     Append the FrameInfo of every measured frame to FILE
+  --pre-run-hook=CMD   Run the shell command CMD before each test, for example
+                       to pin CPU and GPU clocks
+  --post-run-hook=CMD  Run the shell command CMD after each test
+  --config=FILE        Run the tests described by the JSON file FILE, see
+                       how_to_run.txt
 )");
 }
 
@@ -175,6 +192,12 @@ enum {
     Renderer,
     SkipLeakCheck,
     ReportGpuMemory,
+    Warmup,
+    FramePercentiles,
+    FrameCsv,
+    PreRunHook,
+    PostRunHook,
+    Config,
 };
 }
 
@@ -192,10 +215,102 @@ static const struct option LONG_OPTIONS[] = {
         {"renderer", required_argument, nullptr, LongOpts::Renderer},
         {"skip-leak-check", no_argument, nullptr, LongOpts::SkipLeakCheck},
         {"report-gpu-memory", optional_argument, nullptr, LongOpts::ReportGpuMemory},
+        {"warmup", required_argument, nullptr, LongOpts::Warmup},
+        {"frame-percentiles", no_argument, nullptr, LongOpts::FramePercentiles},
+        {"frame-csv", required_argument, nullptr, LongOpts::FrameCsv},
+        {"pre-run-hook", required_argument, nullptr, LongOpts::PreRunHook},
+        {"post-run-hook", required_argument, nullptr, LongOpts::PostRunHook},
+        {"config", required_argument, nullptr, LongOpts::Config},
         {0, 0, 0, 0}};
 
 static const char* SHORT_OPTIONS = "c:r:h";
 
+// Adds the tests whose name matches `test`, which may be a glob, to gRunTests.
+static bool addTests(const char* test, const TestScene::Options& opts) {
+    if (strchr(test, '*')) {
+        // Glob match
+        for (auto& iter : TestScene::testMap()) {
+            if (!fnmatch(test, iter.first.c_str(), 0)) {
+                gRunTests.push_back({iter.second, opts});
+            }
+        }
+        return true;
+    }
+    auto pos = TestScene::testMap().find(test);
+    if (pos == TestScene::testMap().end()) {
+        fprintf(stderr, "Unknown test '%s'\n", test);
+        return false;
+    }
+    gRunTests.push_back({pos->second, opts});
+    return true;
+}
+
+// Overrides the options that are set in `value`, a JSON object.
+static bool readConfigOptions(const Json::Value& value, TestScene::Options* opts) {
+    if (value.isMember("frames")) opts->frameCount = value["frames"].asInt();
+    if (value.isMember("repeat")) opts->repeatCount = value["repeat"].asInt();
+    if (value.isMember("warmup")) opts->warmupFrameCount = value["warmup"].asInt();
+    if (value.isMember("offscreen")) opts->renderOffscreen = value["offscreen"].asBool();
+    if (value.isMember("framePercentiles")) {
+        opts->reportFramePercentiles = value["framePercentiles"].asBool();
+    }
+    if (value.isMember("frameCsv")) opts->frameCsvPath = value["frameCsv"].asString();
+    if (value.isMember("preRunHook")) opts->preRunHook = value["preRunHook"].asString();
+    if (value.isMember("postRunHook")) opts->postRunHook = value["postRunHook"].asString();
+    if (value.isMember("label")) opts->label = value["label"].asString();
+    if (opts->frameCount <= 0 || opts->repeatCount <= 0) {
+        fprintf(stderr, "frames and repeat must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+static bool loadConfig(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Failed to open config '%s'\n", path);
+        return false;
+    }
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    if (!Json::parseFromStream(builder, file, &root, &errors) || !root.isObject()) {
+        fprintf(stderr, "Failed to parse config '%s': %s\n", path, errors.c_str());
+        return false;
+    }
+    // The pipeline can't change within a process, so a config only picks one.
+    if (root.isMember("renderer") && !setRenderer(root["renderer"].asCString())) {
+        return false;
+    }
+    // Top level options apply to every run, on top of those from the command line.
+    TestScene::Options defaults = gOpts;
+    if (!readConfigOptions(root, &defaults)) {
+        return false;
+    }
+    const Json::Value& runs = root["runs"];
+    if (!runs.isArray() || runs.empty()) {
+        fprintf(stderr, "Config '%s' has no runs\n", path);
+        return false;
+    }
+    for (const Json::Value& run : runs) {
+        TestScene::Options opts = defaults;
+        if (!readConfigOptions(run, &opts)) {
+            return false;
+        }
+        const Json::Value& scenes = run["scenes"];
+        if (!scenes.isArray() || scenes.empty()) {
+            fprintf(stderr, "Every run in '%s' needs a list of scenes\n", path);
+            return false;
+        }
+        for (const Json::Value& scene : scenes) {
+            if (!addTests(scene.asCString(), opts)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void parseOptions(int argc, char* argv[]) {
     int c;
     bool error = false;
@@ -306,6 +421,34 @@ void parseOptions(int argc, char* argv[]) {
                 }
                 break;
 
+            case LongOpts::Warmup:
+                gOpts.warmupFrameCount = atoi(optarg);
+                if (gOpts.warmupFrameCount < 0) {
+                    fprintf(stderr, "Invalid warmup argument '%s'\n", optarg);
+                    error = true;
+                }
+                break;
+
+            case LongOpts::FramePercentiles:
+                gOpts.reportFramePercentiles = true;
+                break;
+
+            case LongOpts::FrameCsv:
+                gOpts.frameCsvPath = optarg;
+                break;
+
+            case LongOpts::PreRunHook:
+                gOpts.preRunHook = optarg;
+                break;
+
+            case LongOpts::PostRunHook:
+                gOpts.postRunHook = optarg;
+                break;
+
+            case LongOpts::Config:
+                gConfigPath = optarg;
+                break;
+
             case 'h':
                 printHelp();
                 exit(EXIT_SUCCESS);
@@ -328,43 +471,38 @@ void parseOptions(int argc, char* argv[]) {
     /* Print any remaining command line arguments (not options). */
     if (optind < argc) {
         do {
-            const char* test = argv[optind++];
-            if (strchr(test, '*')) {
-                // Glob match
-                for (auto& iter : TestScene::testMap()) {
-                    if (!fnmatch(test, iter.first.c_str(), 0)) {
-                        gRunTests.push_back(iter.second);
-                    }
-                }
-            } else {
-                auto pos = TestScene::testMap().find(test);
-                if (pos == TestScene::testMap().end()) {
-                    fprintf(stderr, "Unknown test '%s'\n", test);
-                    exit(EXIT_FAILURE);
-                } else {
-                    gRunTests.push_back(pos->second);
-                }
+            if (!addTests(argv[optind++], gOpts)) {
+                exit(EXIT_FAILURE);
             }
         } while (optind < argc);
-    } else {
+    } else if (!gConfigPath) {
         for (auto& iter : TestScene::testMap()) {
-            gRunTests.push_back(iter.second);
+            gRunTests.push_back({iter.second, gOpts});
         }
     }
+
+    if (gConfigPath && !loadConfig(gConfigPath)) {
+        exit(EXIT_FAILURE);
+    }
 }
 
 int main(int argc, char* argv[]) {
     Typeface::setRobotoTypefaceForTest();
 
     parseOptions(argc, argv);
-    if (!gBenchmarkReporter && gOpts.renderOffscreen) {
+    bool anyOffscreen = false;
+    for (auto&& test : gRunTests) {
+        anyOffscreen |= test.opts.renderOffscreen;
+    }
+    if (!gBenchmarkReporter && anyOffscreen) {
         gBenchmarkReporter.reset(new benchmark::ConsoleReporter());
     }
 
     if (gBenchmarkReporter) {
         size_t name_field_width = 10;
         for (auto&& test : gRunTests) {
-            name_field_width = std::max<size_t>(name_field_width, test.name.size());
+            name_field_width = std::max<size_t>(
+                    name_field_width, test.info.name.size() + test.opts.label.size() + 1);
         }
         // _50th, _90th, etc...
         name_field_width += 5;
@@ -375,7 +513,7 @@ int main(int argc, char* argv[]) {
     }
 
     for (auto&& test : gRunTests) {
-        run(test, gOpts, gBenchmarkReporter.get());
+        run(test.info, test.opts, gBenchmarkReporter.get());
     }
 
     if (gBenchmarkReporter) {
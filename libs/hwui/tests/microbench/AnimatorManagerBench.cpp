@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include "AnimationContext.h"
+#include "Animator.h"
+#include "AnimatorManager.h"
+#include "RenderNode.h"
+#include "renderthread/RenderThread.h"
+#include "tests/common/TestUtils.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// The per-frame cost of AnimatorManager::pushStaging once the animators are running, which
+// CanvasContext::prepareTree pays for every animating node. Args are the number of animating
+// nodes and the number of animators on each.
+void BM_AnimatorManager_pushStaging(benchmark::State& state) {
+    const int nodeCount = state.range(0);
+    const int animatorCount = state.range(1);
+    AnimationContext context(renderthread::RenderThread::getInstance().timeLord());
+
+    std::vector<sp<RenderNode>> nodes;
+    for (int i = 0; i < nodeCount; i++) {
+        sp<RenderNode> node = TestUtils::createNode(0, 0, 100, 100, nullptr);
+        for (int j = 0; j < animatorCount; j++) {
+            sp<BaseRenderNodeAnimator> animator = new RenderPropertyAnimator(
+                    static_cast<RenderPropertyAnimator::RenderProperty>(
+                            j % (RenderPropertyAnimator::ALPHA + 1)),
+                    100);
+            animator->setDuration(1000);
+            animator->start();
+            node->addAnimator(animator);
+        }
+        context.addAnimatingRenderNode(*node);
+        nodes.push_back(node);
+    }
+
+    while (state.KeepRunning()) {
+        for (const sp<RenderNode>& node : nodes) {
+            node->animators().pushStaging();
+        }
+    }
+    context.destroy();
+}
+BENCHMARK(BM_AnimatorManager_pushStaging)
+        ->Args({1, 1})
+        ->Args({1, 8})
+        ->Args({32, 2})
+        ->Args({128, 1});
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include "utils/Blur.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// Blurs a square A8 image whose size is the first arg with the radius of the second arg, in
+// both directions. If the third arg is set the passes run on the CommonPool too.
+void BM_Blur_separable(benchmark::State& state) {
+    const int32_t size = state.range(0);
+    const int32_t radius = state.range(1);
+    const bool parallel = state.range(2);
+    std::vector<float> weights(2 * radius + 1);
+    Blur::generateGaussianWeights(weights.data(), radius);
+    std::vector<uint8_t> image(size * size);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = i * 7;
+    }
+    std::vector<uint8_t> scratch(size * size);
+
+    for (auto _ : state) {
+        Blur::horizontal(weights.data(), radius, image.data(), scratch.data(), size, size,
+                         parallel);
+        Blur::vertical(weights.data(), radius, scratch.data(), image.data(), size, size,
+                       parallel);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_Blur_separable)
+        ->Args({64, 4, 0})
+        ->Args({512, 4, 0})
+        ->Args({512, 25, 0})
+        ->Args({512, 25, 1})
+        ->Args({1024, 10, 0})
+        ->Args({1024, 10, 1})
+        ->UseRealTime();
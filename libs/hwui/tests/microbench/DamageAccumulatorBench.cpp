@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include "DamageAccumulator.h"
+#include "RenderNode.h"
+#include "tests/common/TestUtils.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// Mirrors what RenderNode::prepareTree does with the accumulator: a transform for every node, and
+// damage from every leaf, for a tree of the given depth where every parent has `width` children.
+static void damageSubtree(DamageAccumulator& accumulator, const std::vector<sp<RenderNode>>& nodes,
+                          int depth) {
+    for (const sp<RenderNode>& node : nodes) {
+        accumulator.pushTransform(node.get());
+        if (depth <= 1) {
+            accumulator.dirty(0, 0, 10, 10);
+        } else {
+            damageSubtree(accumulator, nodes, depth - 1);
+        }
+        accumulator.popTransform();
+    }
+}
+
+// Args are the depth and width of the tree.
+void BM_DamageAccumulator_tree(benchmark::State& state) {
+    const int depth = state.range(0);
+    const int width = state.range(1);
+    std::vector<sp<RenderNode>> nodes;
+    for (int i = 0; i < width; i++) {
+        sp<RenderNode> node = TestUtils::createNode(i * 10, 0, i * 10 + 100, 100, nullptr);
+        node->mutateStagingProperties().setScaleX(1.5f);
+        TestUtils::syncHierarchyPropertiesAndDisplayList(node);
+        nodes.push_back(node);
+    }
+
+    DamageAccumulator accumulator;
+    SkRect dirty;
+    while (state.KeepRunning()) {
+        damageSubtree(accumulator, nodes, depth);
+        accumulator.finish(&dirty);
+        benchmark::DoNotOptimize(dirty);
+    }
+}
+BENCHMARK(BM_DamageAccumulator_tree)->Args({1, 1})->Args({3, 4})->Args({4, 8})->Args({12, 2});
+
+void BM_DamageAccumulator_computeCurrentTransform(benchmark::State& state) {
+    const int depth = state.range(0);
+    sp<RenderNode> node = TestUtils::createNode(10, 10, 110, 110, nullptr);
+    node->mutateStagingProperties().setRotation(10);
+    TestUtils::syncHierarchyPropertiesAndDisplayList(node);
+
+    DamageAccumulator accumulator;
+    for (int i = 0; i < depth; i++) {
+        accumulator.pushTransform(node.get());
+    }
+    Matrix4 transform;
+    while (state.KeepRunning()) {
+        accumulator.computeCurrentTransform(&transform);
+        benchmark::DoNotOptimize(transform);
+    }
+    for (int i = 0; i < depth; i++) {
+        accumulator.popTransform();
+    }
+}
+BENCHMARK(BM_DamageAccumulator_computeCurrentTransform)->Arg(1)->Arg(8)->Arg(32);
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include "AnimationContext.h"
+#include "FrameInfo.h"
+#include "IContextFactory.h"
+#include "RenderNode.h"
+#include "TreeInfo.h"
+#include "renderthread/CanvasContext.h"
+#include "tests/common/TestUtils.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+using namespace android::uirenderer::renderthread;
+
+class ContextFactory : public IContextFactory {
+public:
+    virtual AnimationContext* createAnimationContext(renderthread::TimeLord& clock) override {
+        return new AnimationContext(clock);
+    }
+};
+
+// CanvasContext::prepareTree is the bulk of DrawFrameTask::syncFrameState: it pushes the staging
+// properties and display lists of the UI thread's tree and accumulates damage. Runs it on the
+// RenderThread for a synthetic tree whose depth and width are the first two args. If the third
+// arg is set, every node's properties change every frame, like during a scroll of the whole tree.
+void BM_FrameSync_prepareTree(benchmark::State& state) {
+    const int depth = state.range(0);
+    const int width = state.range(1);
+    const bool changeProperties = state.range(2);
+    TestUtils::runOnRenderThread([&](RenderThread& renderThread) {
+        std::vector<sp<RenderNode>> nodes;
+        sp<RenderNode> rootNode = TestUtils::createTree(depth, width, &nodes);
+        ContextFactory contextFactory;
+        std::unique_ptr<CanvasContext> canvasContext(CanvasContext::create(
+                renderThread, false, rootNode.get(), &contextFactory, 0, 0));
+        int64_t uiFrameInfo[UI_THREAD_FRAME_INFO_SIZE] = {};
+
+        float translation = 0;
+        while (state.KeepRunning()) {
+            if (changeProperties) {
+                translation = translation > 10 ? 0 : translation + 1;
+                for (const sp<RenderNode>& node : nodes) {
+                    node->mutateStagingProperties().setTranslationY(translation);
+                    node->setPropertyFieldsDirty(RenderNode::TRANSLATION_Y);
+                }
+            }
+            TreeInfo info(TreeInfo::MODE_FULL, *canvasContext);
+            canvasContext->prepareTree(info, uiFrameInfo, systemTime(SYSTEM_TIME_MONOTONIC),
+                                       rootNode.get());
+            benchmark::DoNotOptimize(info.out.hasAnimations);
+        }
+        canvasContext->destroy();
+    });
+}
+BENCHMARK(BM_FrameSync_prepareTree)
+        ->Args({1, 1, 0})
+        ->Args({3, 4, 0})
+        ->Args({3, 4, 1})
+        ->Args({4, 8, 0})
+        ->Args({4, 8, 1})
+        ->Args({12, 2, 1})
+        ->UseRealTime();
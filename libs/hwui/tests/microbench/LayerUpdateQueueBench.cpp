@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include "LayerUpdateQueue.h"
+#include "RenderNode.h"
+#include "tests/common/TestUtils.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static std::vector<sp<RenderNode>> createLayerNodes(int count) {
+    std::vector<sp<RenderNode>> nodes;
+    for (int i = 0; i < count; i++) {
+        sp<RenderNode> node = TestUtils::createNode(0, 0, 100, 100, nullptr);
+        TestUtils::syncHierarchyPropertiesAndDisplayList(node);
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+// Every layer is damaged once per frame. Arg is the number of layers.
+void BM_LayerUpdateQueue_enqueue(benchmark::State& state) {
+    std::vector<sp<RenderNode>> nodes = createLayerNodes(state.range(0));
+    LayerUpdateQueue queue;
+    while (state.KeepRunning()) {
+        for (const sp<RenderNode>& node : nodes) {
+            queue.enqueueLayerWithDamage(node.get(), Rect(10, 10, 50, 50));
+        }
+        benchmark::DoNotOptimize(queue.entries().data());
+        queue.clear();
+    }
+}
+BENCHMARK(BM_LayerUpdateQueue_enqueue)->Arg(1)->Arg(8)->Arg(64);
+
+// Every layer is damaged by several of its descendants, so each entry is looked up again.
+void BM_LayerUpdateQueue_enqueueRepeated(benchmark::State& state) {
+    std::vector<sp<RenderNode>> nodes = createLayerNodes(state.range(0));
+    LayerUpdateQueue queue;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 4; i++) {
+            for (const sp<RenderNode>& node : nodes) {
+                queue.enqueueLayerWithDamage(node.get(), Rect(i * 10, 0, i * 10 + 20, 20));
+            }
+        }
+        benchmark::DoNotOptimize(queue.entries().data());
+        queue.clear();
+    }
+}
+BENCHMARK(BM_LayerUpdateQueue_enqueueRepeated)->Arg(1)->Arg(8)->Arg(64);
@@ -46,3 +46,30 @@ static void BM_LinearStdAllocator_vector(benchmark::State& state) {
     }
 }
 BENCHMARK(BM_LinearStdAllocator_vector);
+
+// Simulates display lists being recorded and thrown away every frame: each iteration fills a new
+// allocator with many small objects spanning several pages and then destroys it.
+static void BM_LinearAllocator_churn(benchmark::State& state) {
+    const int allocations = state.range(0);
+    while (state.KeepRunning()) {
+        LinearAllocator la;
+        for (int j = 0; j < allocations; j++) {
+            benchmark::DoNotOptimize(la.alloc<char>(64));
+        }
+    }
+}
+BENCHMARK(BM_LinearAllocator_churn)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_LinearAllocator_churnUncached(benchmark::State& state) {
+    const int allocations = state.range(0);
+    while (state.KeepRunning()) {
+        {
+            LinearAllocator la;
+            for (int j = 0; j < allocations; j++) {
+                benchmark::DoNotOptimize(la.alloc<char>(64));
+            }
+        }
+        LinearAllocator::trimPageCache();
+    }
+}
+BENCHMARK(BM_LinearAllocator_churnUncached)->Arg(16)->Arg(256)->Arg(4096);
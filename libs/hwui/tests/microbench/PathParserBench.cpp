@@ -51,3 +51,32 @@ void BM_PathParser_parseStringPathForPathData(benchmark::State& state) {
     }
 }
 BENCHMARK(BM_PathParser_parseStringPathForPathData);
+
+// Typical exported icon data: many short decimal numbers per command.
+static const char* sIconPathString =
+        "M12,21.35l-1.45,-1.32C5.4,15.36 2,12.28 2,8.5 2,5.42 4.42,3 7.5,3c1.74,0 3.41,0.81 "
+        "4.5,2.09C13.09,3.81 14.76,3 16.5,3 19.58,3 22,5.42 22,8.5c0,3.78 -3.4,6.86 -8.55,11.54L12,"
+        "21.35z";
+
+void BM_PathParser_parsePathData(benchmark::State& state) {
+    size_t length = strlen(sIconPathString);
+    for (auto _ : state) {
+        PathData outData;
+        PathParser::ParseResult result;
+        PathParser::parsePathData(&outData, &result, sIconPathString, length);
+        benchmark::DoNotOptimize(&outData);
+    }
+}
+BENCHMARK(BM_PathParser_parsePathData);
+
+void BM_PathParser_getPathDataCached(benchmark::State& state) {
+    size_t length = strlen(sIconPathString);
+    PathParser::clearPathDataCache();
+    for (auto _ : state) {
+        PathData outData;
+        PathParser::ParseResult result;
+        PathParser::getPathDataFromAsciiString(&outData, &result, sIconPathString, length);
+        benchmark::DoNotOptimize(&outData);
+    }
+}
+BENCHMARK(BM_PathParser_getPathDataCached);
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "MemoryPolicy.h"
+#include "hwui/Bitmap.h"
+
+#include <SkImageInfo.h>
+
+#include <cstring>
+
+using namespace android;
+using namespace android::uirenderer;
+
+TEST(Bitmap, heapPixelsAreReused) {
+    if (loadMemoryPolicy().bitmapPoolBytes < 1024 * 1024) {
+        GTEST_SKIP() << "The bitmap pool is too small for this test";
+    }
+    Bitmap::purgePixelPool();
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(250, 250);
+
+    sk_sp<Bitmap> bitmap = Bitmap::allocateHeapBitmap(info);
+    ASSERT_NE(nullptr, bitmap);
+    // Rounded up to the pool's size class
+    EXPECT_GE(bitmap->getAllocationByteCount(), info.computeMinByteSize());
+    void* pixels = bitmap->pixels();
+    memset(pixels, 0xff, info.computeMinByteSize());
+    bitmap.reset();
+
+    // A slightly different size falls in the same class
+    const SkImageInfo similarInfo = SkImageInfo::MakeN32Premul(248, 250);
+    bitmap = Bitmap::allocateHeapBitmap(similarInfo);
+    ASSERT_NE(nullptr, bitmap);
+    EXPECT_EQ(pixels, bitmap->pixels());
+    const uint8_t* bytes = static_cast<const uint8_t*>(bitmap->pixels());
+    for (size_t i = 0; i < bitmap->getAllocationByteCount(); i++) {
+        ASSERT_EQ(0, bytes[i]) << "at " << i;
+    }
+    bitmap.reset();
+    Bitmap::purgePixelPool();
+}
+
+TEST(Bitmap, smallHeapPixelsAreNotPooled) {
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(10, 10);
+    sk_sp<Bitmap> bitmap = Bitmap::allocateHeapBitmap(info);
+    ASSERT_NE(nullptr, bitmap);
+    EXPECT_EQ(info.computeMinByteSize(), bitmap->getAllocationByteCount());
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/Blur.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+namespace {
+
+std::vector<uint8_t> makeImage(int32_t width, int32_t height) {
+    std::vector<uint8_t> image(width * height);
+    srand(width * 31 + height);
+    for (uint8_t& pixel : image) {
+        pixel = rand() & 0xFF;
+    }
+    return image;
+}
+
+// The passes as one clamped loop, without the interior fast paths.
+uint8_t referencePixel(const float* weights, int32_t radius, const std::vector<uint8_t>& source,
+                       int32_t width, int32_t height, int32_t x, int32_t y, bool horizontal) {
+    float blurred = 0.0f;
+    for (int32_t r = -radius; r <= radius; r++) {
+        int32_t sx = horizontal ? std::clamp(x + r, 0, width - 1) : x;
+        int32_t sy = horizontal ? y : std::clamp(y + r, 0, height - 1);
+        blurred += source[sy * width + sx] * weights[r + radius];
+    }
+    return static_cast<uint8_t>(blurred);
+}
+
+void expectMatchesReference(bool horizontal, int32_t radius, int32_t width, int32_t height) {
+    float weights[2 * 25 + 1];
+    Blur::generateGaussianWeights(weights, radius);
+    std::vector<uint8_t> source = makeImage(width, height);
+    std::vector<uint8_t> dest(width * height);
+    if (horizontal) {
+        Blur::horizontal(weights, radius, source.data(), dest.data(), width, height);
+    } else {
+        Blur::vertical(weights, radius, source.data(), dest.data(), width, height);
+    }
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            // The SIMD kernels may round their sums differently in the last bit.
+            int expected =
+                    referencePixel(weights, radius, source, width, height, x, y, horizontal);
+            ASSERT_NEAR(expected, dest[y * width + x], 1) << "at " << x << ", " << y;
+        }
+    }
+}
+
+}  // namespace
+
+TEST(Blur, horizontal) {
+    expectMatchesReference(true, 1, 16, 4);
+    expectMatchesReference(true, 5, 37, 29);
+    expectMatchesReference(true, 25, 64, 3);
+    // Too narrow for any interior pixel
+    expectMatchesReference(true, 10, 15, 2);
+}
+
+TEST(Blur, vertical) {
+    expectMatchesReference(false, 1, 4, 16);
+    expectMatchesReference(false, 5, 37, 29);
+    expectMatchesReference(false, 25, 3, 64);
+    expectMatchesReference(false, 10, 2, 15);
+}
+
+TEST(Blur, parallelMatchesSerial) {
+    const int32_t width = 300;
+    const int32_t height = 301;
+    const int32_t radius = 8;
+    float weights[2 * radius + 1];
+    Blur::generateGaussianWeights(weights, radius);
+    std::vector<uint8_t> source = makeImage(width, height);
+    std::vector<uint8_t> serial(width * height);
+    std::vector<uint8_t> parallel(width * height);
+
+    Blur::horizontal(weights, radius, source.data(), serial.data(), width, height);
+    Blur::horizontal(weights, radius, source.data(), parallel.data(), width, height, true);
+    EXPECT_EQ(serial, parallel);
+
+    Blur::vertical(weights, radius, source.data(), serial.data(), width, height);
+    Blur::vertical(weights, radius, source.data(), parallel.data(), width, height, true);
+    EXPECT_EQ(serial, parallel);
+}
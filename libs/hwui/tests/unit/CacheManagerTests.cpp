@@ -16,6 +16,7 @@
 
 #include <gtest/gtest.h>
 
+#include "pipeline/skia/MemoryCategoryDump.h"
 #include "renderthread/CacheManager.h"
 #include "renderthread/EglManager.h"
 #include "tests/common/TestUtils.h"
@@ -86,3 +87,41 @@ RENDERTHREAD_SKIA_PIPELINE_TEST(CacheManager, DISABLED_trimMemory) {
     renderThread.cacheManager().trimMemory(TrimLevel::COMPLETE);
     ASSERT_TRUE(0 == grContext->getResourceCachePurgeableBytes());
 }
+
+RENDERTHREAD_SKIA_PIPELINE_TEST(CacheManager, tierBudgets) {
+    CacheManager& cacheManager = renderThread.cacheManager();
+    size_t cpuUsage, gpuUsage;
+    CacheTierUsage tierUsage;
+
+    cacheManager.notifyNextFrameSize(100, 100);
+    cacheManager.getMemoryUsage(&cpuUsage, &gpuUsage, &tierUsage);
+    EXPECT_LT(0u, tierUsage.hot.budgetBytes);
+    EXPECT_LE(tierUsage.hot.budgetBytes, tierUsage.warm.budgetBytes);
+    EXPECT_LT(tierUsage.warm.budgetBytes, cacheManager.getCacheSize());
+    EXPECT_EQ(cacheManager.getBackgroundCacheSize(), tierUsage.background.budgetBytes);
+
+    // The hot budget follows the size of the frames being drawn
+    const size_t smallFrameBudget = tierUsage.hot.budgetBytes;
+    cacheManager.notifyNextFrameSize(200, 200);
+    cacheManager.getMemoryUsage(&cpuUsage, &gpuUsage, &tierUsage);
+    EXPECT_LE(smallFrameBudget, tierUsage.hot.budgetBytes);
+    EXPECT_LE(tierUsage.hot.budgetBytes, tierUsage.warm.budgetBytes);
+}
+
+RENDERTHREAD_SKIA_PIPELINE_TEST(CacheManager, memoryCategories) {
+    GrDirectContext* grContext = renderThread.getGrContext();
+    ASSERT_TRUE(grContext != nullptr);
+    sk_sp<SkSurface> surface = SkSurface::MakeRenderTarget(grContext, skgpu::Budgeted::kYes,
+                                                           SkImageInfo::MakeN32Premul(100, 100));
+    surface->getCanvas()->drawColor(SK_ColorRED);
+    grContext->flushAndSubmit();
+
+    skiapipeline::MemoryCategoryDump dump;
+    skiapipeline::MemorySample sample;
+    dump.sample(grContext, &sample);
+    const uint64_t textureBytes =
+            sample.bytes[static_cast<size_t>(skiapipeline::MemoryCategory::Texture)];
+    const uint64_t renderTargetBytes =
+            sample.bytes[static_cast<size_t>(skiapipeline::MemoryCategory::RenderTarget)];
+    EXPECT_LE(100u * 100u * 4u, textureBytes + renderTargetBytes);
+}
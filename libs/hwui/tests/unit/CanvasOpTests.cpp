@@ -20,6 +20,7 @@
 #include <canvas/CanvasOpBuffer.h>
 #include <canvas/CanvasOps.h>
 #include <canvas/CanvasOpRasterizer.h>
+#include <canvas/CanvasOpRecorder.h>
 
 #include <tests/common/CallCountingCanvas.h>
 
@@ -38,6 +39,8 @@
 #include "pipeline/skia/AnimatedDrawables.h"
 #include <SkNoDrawCanvas.h>
 
+#include <sstream>
+
 using namespace android;
 using namespace android::uirenderer;
 using namespace android::uirenderer::skiapipeline;
@@ -647,3 +650,77 @@ TEST(CanvasOp, frontendSaveCount) {
     EXPECT_EQ(1, receiver[Op::Save]);
     EXPECT_EQ(1, receiver[Op::Restore]);
 }
+
+TEST(CanvasOp, recorderSimple) {
+    CanvasOpRecorder recorder(100, 100);
+    Paint paint;
+    recorder.save(SaveFlags::MatrixClip);
+    recorder.translate(10, 10);
+    EXPECT_TRUE(recorder.clipRect(0, 0, 50, 50, SkClipOp::kIntersect));
+    recorder.drawRect(0, 0, 20, 20, paint);
+    recorder.drawCircle(10, 10, 5, paint);
+    const float points[] = {1, 1, 2, 2, 3};
+    recorder.drawPoints(points, 5, paint);
+    recorder.restore();
+    EXPECT_EQ(1, recorder.getSaveCount());
+
+    auto buffer = recorder.finishRecording();
+    EXPECT_FALSE(buffer.isEmpty());
+    // save, clipRect, 3 draws, restore
+    EXPECT_EQ(6, countItems(buffer));
+
+    CallCountingCanvas canvas;
+    rasterizeCanvasBuffer(buffer, &canvas);
+    EXPECT_EQ(1, canvas.drawRectCount);
+    EXPECT_EQ(1, canvas.drawOvalCount);
+    EXPECT_EQ(1, canvas.drawPoints);
+    EXPECT_EQ(3, canvas.sumTotalDrawCalls());
+}
+
+TEST(CanvasOp, recorderSaveLayerOwnsPaint) {
+    CanvasOpRecorder recorder(100, 100);
+    {
+        SkPaint alphaPaint;
+        alphaPaint.setAlpha(128);
+        EXPECT_EQ(1, recorder.saveLayer(0, 0, 50, 50, &alphaPaint));
+    }
+    EXPECT_EQ(2, recorder.getSaveCount());
+    EXPECT_TRUE(recorder.quickRejectRect(60, 60, 70, 70));
+    recorder.restoreToCount(1);
+    EXPECT_EQ(1, recorder.getSaveCount());
+
+    auto buffer = recorder.finishRecording();
+    buffer.for_each([]<CanvasOpType T>(const CanvasOpContainer<T>* op) {
+        if constexpr (T == Op::SaveLayer) {
+            EXPECT_EQ(SkRect::MakeWH(50, 50), (*op)->bounds);
+            ASSERT_TRUE((*op)->paint.has_value());
+            EXPECT_EQ(128, (*op)->paint->getAlpha());
+        }
+    });
+}
+
+TEST(CanvasOp, recorderColorTransform) {
+    CanvasOpRecorder recorder(100, 100);
+    Paint paint;
+    paint.setColor(SK_ColorWHITE);
+    recorder.drawRect(0, 0, 20, 20, paint);
+
+    auto buffer = recorder.finishRecording();
+    buffer.applyColorTransform(ColorTransform::Dark);
+    buffer.for_each([]<CanvasOpType T>(const CanvasOpContainer<T>* op) {
+        if constexpr (T == Op::DrawRect) {
+            EXPECT_NE(SK_ColorWHITE, (*op)->paint.getColor());
+        }
+    });
+}
+
+TEST(CanvasOp, recorderOutput) {
+    CanvasOpRecorder recorder(100, 100);
+    recorder.drawColor(SK_ColorRED, SkBlendMode::kSrcOver);
+    recorder.drawRect(0, 0, 20, 20, Paint());
+
+    auto buffer = recorder.finishRecording();
+    std::ostringstream output;
+    buffer.output(output, 0);
+    EXPECT_EQ("  drawColor\n  drawRect\n", output.str());
+}
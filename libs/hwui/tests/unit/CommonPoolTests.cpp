@@ -22,6 +22,7 @@
 #include <condition_variable>
 #include <set>
 #include <thread>
+#include <vector>
 #include "unistd.h"
 
 using namespace android;
@@ -97,36 +98,22 @@ TEST(CommonPool, DISABLED_singleThread) {
     EXPECT_NE(gettid(), tid1);
 }
 
-// Test currently relies on timings
-// which makes it flaky, disable for now
-TEST(DISABLED_CommonPool, fullQueue) {
+TEST(CommonPool, queueIsUnbounded) {
     std::mutex lock;
     std::condition_variable fence;
     bool signaled = false;
-    static constexpr auto QUEUE_COUNT = CommonPool::THREAD_COUNT + CommonPool::QUEUE_SIZE + 10;
-    std::atomic_int queuedCount{0};
-    std::array<std::future<void>, QUEUE_COUNT> futures;
-
-    std::thread queueThread{[&] {
-        for (int i = 0; i < QUEUE_COUNT; i++) {
-            futures[i] = CommonPool::async([&] {
-                std::unique_lock _lock{lock};
-                while (!signaled) {
-                    fence.wait(_lock);
-                }
-            });
-            queuedCount++;
-        }
-    }};
-
-    int previous;
-    do {
-        previous = queuedCount.load();
-        usleep(10000);
-    } while (previous != queuedCount.load());
-
-    EXPECT_GT(queuedCount.load(), CommonPool::QUEUE_SIZE);
-    EXPECT_LT(queuedCount.load(), QUEUE_COUNT);
+    static constexpr auto QUEUE_COUNT = 1000;
+    std::vector<std::future<void>> futures;
+
+    // Every post returns right away, even with all workers blocked.
+    for (int i = 0; i < QUEUE_COUNT; i++) {
+        futures.push_back(CommonPool::async([&] {
+            std::unique_lock _lock{lock};
+            while (!signaled) {
+                fence.wait(_lock);
+            }
+        }));
+    }
 
     {
         std::unique_lock _lock{lock};
@@ -134,15 +121,76 @@ TEST(DISABLED_CommonPool, fullQueue) {
         fence.notify_all();
     }
 
-    queueThread.join();
-    EXPECT_EQ(queuedCount.load(), QUEUE_COUNT);
-
     // Ensure all our tasks are finished before return as they have references to the stack
     for (auto& f : futures) {
         f.get();
     }
 }
 
+TEST(CommonPool, frameCriticalRunsFirst) {
+    std::mutex lock;
+    std::condition_variable fence;
+    int started = 0;
+    std::array<bool, CommonPool::THREAD_COUNT> released{};
+    std::vector<std::future<void>> blockers;
+    for (int i = 0; i < CommonPool::THREAD_COUNT; i++) {
+        blockers.push_back(CommonPool::async([&, i] {
+            std::unique_lock _lock{lock};
+            started++;
+            fence.notify_all();
+            while (!released[i]) {
+                fence.wait(_lock);
+            }
+        }));
+    }
+    {
+        std::unique_lock _lock{lock};
+        while (started != CommonPool::THREAD_COUNT) {
+            fence.wait(_lock);
+        }
+    }
+
+    std::vector<int> order;
+    auto background = CommonPool::async([&] {
+        std::unique_lock _lock{lock};
+        order.push_back(1);
+    });
+    auto critical = CommonPool::async(
+            [&] {
+                std::unique_lock _lock{lock};
+                order.push_back(0);
+            },
+            CommonPool::Priority::FrameCritical);
+
+    // Free a single worker, which has to pick the frame critical task first.
+    {
+        std::unique_lock _lock{lock};
+        released[0] = true;
+        fence.notify_all();
+    }
+    background.get();
+    critical.get();
+    EXPECT_EQ((std::vector<int>{0, 1}), order);
+
+    {
+        std::unique_lock _lock{lock};
+        released.fill(true);
+        fence.notify_all();
+    }
+    for (auto& f : blockers) {
+        f.get();
+    }
+}
+
+TEST(CommonPool, nestedPostIsStolen) {
+    // A worker that blocks on work it posted itself relies on another worker stealing it.
+    auto outer = CommonPool::async([] {
+        auto inner = CommonPool::async([] { return gettid(); });
+        return inner.get() != gettid();
+    });
+    EXPECT_TRUE(outer.get());
+}
+
 class ObjectTracker {
     static std::atomic_int sGlobalCount;
 
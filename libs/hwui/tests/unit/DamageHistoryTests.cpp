@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <renderthread/DamageHistory.h>
+#include <renderthread/Frame.h>
+
+#include <SkRect.h>
+
+using namespace android;
+using namespace android::uirenderer;
+using namespace android::uirenderer::renderthread;
+
+TEST(DamageHistory, bufferAge) {
+    DamageHistory history;
+    history.onBufferPresented(Frame(100, 100, 0), SkRect::MakeLTRB(0, 0, 10, 10));
+    history.onBufferPresented(Frame(100, 100, 0), SkRect::MakeLTRB(20, 20, 30, 30));
+    history.onBufferPresented(Frame(100, 100, 0), SkRect::MakeLTRB(40, 40, 50, 50));
+
+    // A buffer of age 3 was presented before the last two frames
+    SkRect dirty = SkRect::MakeLTRB(90, 90, 95, 95);
+    ASSERT_TRUE(history.addBufferDamage(Frame(100, 100, 3), &dirty));
+    EXPECT_EQ(SkRect::MakeLTRB(20, 20, 95, 95), dirty);
+
+    // We don't know what happened before the first frame
+    dirty.setEmpty();
+    EXPECT_FALSE(history.addBufferDamage(Frame(100, 100, 4), &dirty));
+
+    history.clear();
+    EXPECT_FALSE(history.addBufferDamage(Frame(100, 100, 2), &dirty));
+}
+
+TEST(DamageHistory, bufferSlots) {
+    DamageHistory history;
+    history.onBufferPresented(Frame(100, 100, 0, 0), SkRect::MakeLTRB(0, 0, 10, 10));
+    history.onBufferPresented(Frame(100, 100, 0, 1), SkRect::MakeLTRB(20, 20, 30, 30));
+    history.onBufferPresented(Frame(100, 100, 0, 2), SkRect::MakeLTRB(40, 40, 50, 50));
+
+    SkRect dirty = SkRect::MakeEmpty();
+    ASSERT_TRUE(history.addBufferDamage(Frame(100, 100, 3, 0), &dirty));
+    EXPECT_EQ(SkRect::MakeLTRB(20, 20, 50, 50), dirty);
+
+    dirty.setEmpty();
+    ASSERT_TRUE(history.addBufferDamage(Frame(100, 100, 2, 1), &dirty));
+    EXPECT_EQ(SkRect::MakeLTRB(40, 40, 50, 50), dirty);
+
+    // Slot 3 was never presented, so its contents are unknown
+    EXPECT_FALSE(history.addBufferDamage(Frame(100, 100, 1, 3), &dirty));
+
+    // Damage keeps accumulating into a buffer that isn't dequeued, however old it gets
+    for (int i = 0; i < DamageHistory::kMaxBufferAge * 2; i++) {
+        history.onBufferPresented(Frame(100, 100, 0, 1 + i % 2), SkRect::MakeXYWH(i, i, 1, 1));
+    }
+    dirty.setEmpty();
+    ASSERT_TRUE(history.addBufferDamage(Frame(100, 100, 2 * DamageHistory::kMaxBufferAge + 3, 0),
+                                        &dirty));
+    EXPECT_EQ(SkRect::MakeLTRB(0, 0, 50, 50), dirty);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "hwui/GlyphRunCache.h"
+#include "hwui/MinikinUtils.h"
+#include "tests/common/TestUtils.h"
+
+using namespace android;
+using namespace android::uirenderer;
+
+static std::shared_ptr<const TextGlyphs> getGlyphs(const char* text, const Paint& paint) {
+    auto utf16 = TestUtils::asciiToUtf16(text);
+    size_t length = strlen(text);
+    return GlyphRunCache::get().getGlyphs(paint, nullptr, minikin::Bidi::LTR, utf16.get(), 0,
+                                          length, 0, length);
+}
+
+TEST(GlyphRunCache, reusesGlyphs) {
+    GlyphRunCache::get().clear();
+    Paint paint;
+    paint.getSkFont().setSize(20);
+
+    auto first = getGlyphs("Settings", paint);
+    auto second = getGlyphs("Settings", paint);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1u, GlyphRunCache::get().size());
+
+    // Anything that changes the layout needs an entry of its own.
+    Paint biggerPaint(paint);
+    biggerPaint.getSkFont().setSize(40);
+    EXPECT_NE(first, getGlyphs("Settings", biggerPaint));
+    EXPECT_NE(first, getGlyphs("Setting", paint));
+    EXPECT_EQ(3u, GlyphRunCache::get().size());
+    GlyphRunCache::get().clear();
+}
+
+TEST(GlyphRunCache, matchesLayout) {
+    GlyphRunCache::get().clear();
+    Paint paint;
+    paint.getSkFont().setSize(20);
+    const char* text = "Hello world";
+    auto utf16 = TestUtils::asciiToUtf16(text);
+    size_t length = strlen(text);
+
+    minikin::Layout layout = MinikinUtils::doLayout(&paint, minikin::Bidi::LTR, nullptr,
+                                                    utf16.get(), length, 0, length, 0, length,
+                                                    nullptr);
+    auto glyphs = getGlyphs(text, paint);
+    ASSERT_EQ(layout.nGlyphs(), glyphs->nGlyphs());
+    EXPECT_EQ(layout.getAdvance(), glyphs->getAdvance());
+    for (size_t i = 0; i < layout.nGlyphs(); i++) {
+        EXPECT_EQ(layout.getGlyphId(i), glyphs->getGlyphId(i));
+        EXPECT_EQ(layout.getX(i), glyphs->getX(i));
+        EXPECT_EQ(layout.getY(i), glyphs->getY(i));
+    }
+    ASSERT_FALSE(glyphs->runs.empty());
+    EXPECT_EQ(0u, glyphs->runs.front().start);
+    EXPECT_EQ(glyphs->nGlyphs(), glyphs->runs.back().end);
+    GlyphRunCache::get().clear();
+}
@@ -15,6 +15,7 @@
  */
 
 #include <android-base/macros.h>
+#include <fcntl.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stdio.h>
@@ -163,3 +164,76 @@ TEST(GraphicsStats, merge) {
         EXPECT_EQ(expectedBucket, loadedProto.histogram().Get(i).render_millis());
     }
 }
+
+TEST(GraphicsStats, appendManySaves) {
+    std::string path = findRootPath() + "/test_appendManySaves";
+    std::string packageName = "com.test.appendManySaves";
+    unlink(path.c_str());
+    MockProfileData mockData;
+    mockData.editJankFrameCount() = 1;
+    mockData.editTotalFrameCount() = 10;
+    mockData.editFrameCounts()[3] = 10;
+    constexpr int kSaves = 50;
+    for (int i = 0; i < kSaves; i++) {
+        GraphicsStatsService::saveBuffer(path, packageName, 5, 1000 + i, 2000 + i, &mockData);
+    }
+
+    // Each save only appends the buckets it has frames in.
+    struct stat sb;
+    ASSERT_EQ(0, stat(path.c_str(), &sb));
+    EXPECT_LT(sb.st_size, kSaves * 128);
+
+    protos::GraphicsStatsProto loadedProto;
+    EXPECT_TRUE(GraphicsStatsService::parseFromFile(path, &loadedProto));
+    unlink(path.c_str());
+
+    EXPECT_EQ(packageName, loadedProto.package_name());
+    EXPECT_EQ(1000, loadedProto.stats_start());
+    EXPECT_EQ(2000 + kSaves - 1, loadedProto.stats_end());
+    ASSERT_TRUE(loadedProto.has_summary());
+    EXPECT_EQ(kSaves, loadedProto.summary().janky_frames());
+    EXPECT_EQ(kSaves * 10, loadedProto.summary().total_frames());
+    ASSERT_EQ(mockData.editFrameCounts().size() + mockData.editSlowFrameCounts().size(),
+              (size_t)loadedProto.histogram_size());
+    for (size_t i = 0; i < (size_t)loadedProto.histogram_size(); i++) {
+        EXPECT_EQ(i == 3 ? kSaves * 10 : 0, loadedProto.histogram().Get(i).frame_count());
+    }
+}
+
+TEST(GraphicsStats, loadSingleProtoFile) {
+    std::string path = findRootPath() + "/test_loadSingleProtoFile";
+    std::string packageName = "com.test.loadSingleProtoFile";
+    MockProfileData mockData;
+    mockData.editTotalFrameCount() = 100;
+    for (size_t i = 0; i < mockData.editFrameCounts().size(); i++) {
+        mockData.editFrameCounts()[i] = (i % 5) + 1;
+    }
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 3000, 7000, &mockData);
+    protos::GraphicsStatsProto savedProto;
+    ASSERT_TRUE(GraphicsStatsService::parseFromFile(path, &savedProto));
+
+    // Rewrite the file the way versions that kept a single proto did.
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+        ASSERT_NE(-1, fd);
+        const int32_t version = 1;
+        std::string data(reinterpret_cast<const char*>(&version), sizeof(version));
+        ASSERT_TRUE(savedProto.AppendToString(&data));
+        ASSERT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+        close(fd);
+    }
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 7050, 10000, &mockData);
+
+    protos::GraphicsStatsProto loadedProto;
+    EXPECT_TRUE(GraphicsStatsService::parseFromFile(path, &loadedProto));
+    unlink(path.c_str());
+
+    EXPECT_EQ(3000, loadedProto.stats_start());
+    EXPECT_EQ(10000, loadedProto.stats_end());
+    EXPECT_EQ(200, loadedProto.summary().total_frames());
+    ASSERT_EQ(savedProto.histogram_size(), loadedProto.histogram_size());
+    for (int i = 0; i < loadedProto.histogram_size(); i++) {
+        EXPECT_EQ(savedProto.histogram().Get(i).frame_count() * 2,
+                  loadedProto.histogram().Get(i).frame_count());
+    }
+}
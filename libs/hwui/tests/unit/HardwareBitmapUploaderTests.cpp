@@ -0,0 +1,49 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <SkBitmap.h>
+
+#include <future>
+#include <vector>
+
+#include "HardwareBitmapUploader.h"
+#include "hwui/Bitmap.h"
+#include "tests/common/TestUtils.h"
+
+using namespace android;
+using namespace android::uirenderer;
+
+TEST(HardwareBitmapUploader, allocateHardwareBitmapAsync) {
+    // Queue several uploads back to back so that at least some of them end up in one batch
+    std::vector<SkBitmap> sources(8);
+    std::vector<std::future<sk_sp<Bitmap>>> results;
+    for (size_t i = 0; i < sources.size(); i++) {
+        sources[i].allocN32Pixels(16 + i, 16);
+        sources[i].eraseColor(SK_ColorRED);
+        results.push_back(HardwareBitmapUploader::allocateHardwareBitmapAsync(sources[i]));
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        sk_sp<Bitmap> bitmap = results[i].get();
+        ASSERT_NE(nullptr, bitmap);
+        EXPECT_TRUE(bitmap->isHardware());
+        EXPECT_EQ(sources[i].width(), bitmap->width());
+        EXPECT_EQ(sources[i].height(), bitmap->height());
+    }
+    HardwareBitmapUploader::terminate();
+}
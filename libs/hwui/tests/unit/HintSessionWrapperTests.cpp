@@ -113,6 +113,7 @@ void HintSessionWrapperTests::MockHintSessionBinding::init() {
 }
 
 void HintSessionWrapperTests::TearDown() {
+    Properties::usePredictiveHints = false;
     mWrapper = nullptr;
     sMockBinding = nullptr;
 }
@@ -148,4 +149,60 @@ TEST_F(HintSessionWrapperTests, loadResetHintsSendCorrectly) {
     mWrapper->sendLoadResetHint();
 }
 
+TEST_F(HintSessionWrapperTests, predictiveHintsSentBeforeSlowFrames) {
+    Properties::usePredictiveHints = true;
+    EXPECT_CALL(*sMockBinding,
+                fakeSendHint(sessionPtr, static_cast<int32_t>(SessionHint::CPU_LOAD_UP)))
+            .Times(1);
+    mWrapper->init();
+    waitForWrapperReady();
+
+    mWrapper->updateTargetWorkDuration(16_ms);
+    mWrapper->reportActualWorkDuration(4_ms);
+    mWrapper->onFrameStart(false);
+    mWrapper->reportActualWorkDuration(15_ms);
+    mWrapper->onFrameStart(false);
+
+    const auto& stats = mWrapper->predictionStats();
+    EXPECT_EQ(2u, stats.framesReported);
+    EXPECT_EQ(1u, stats.framesOverTarget);
+    EXPECT_EQ(1u, stats.missedPredictions);
+    EXPECT_EQ(1u, stats.predictedExpensive);
+    EXPECT_EQ(1u, stats.loadUpHints);
+}
+
+TEST_F(HintSessionWrapperTests, predictiveHintsSentWhenAnimationStarts) {
+    Properties::usePredictiveHints = true;
+    EXPECT_CALL(*sMockBinding,
+                fakeSendHint(sessionPtr, static_cast<int32_t>(SessionHint::CPU_LOAD_UP)))
+            .Times(1);
+    mWrapper->init();
+    waitForWrapperReady();
+
+    mWrapper->updateTargetWorkDuration(16_ms);
+    mWrapper->reportActualWorkDuration(2_ms);
+    mWrapper->onFrameStart(true);
+    mWrapper->reportActualWorkDuration(12_ms);
+    // Still expensive, but the boost from the first hint is still in effect.
+    mWrapper->onFrameStart(true);
+
+    EXPECT_EQ(1u, mWrapper->predictionStats().correctPredictions);
+}
+
+TEST_F(HintSessionWrapperTests, reactiveModeDoesNotPredict) {
+    EXPECT_CALL(*sMockBinding, fakeSendHint(_, _)).Times(0);
+    mWrapper->init();
+    waitForWrapperReady();
+
+    mWrapper->updateTargetWorkDuration(16_ms);
+    mWrapper->reportActualWorkDuration(15_ms);
+    mWrapper->onFrameStart(true);
+    mWrapper->reportActualWorkDuration(15_ms);
+
+    const auto& stats = mWrapper->predictionStats();
+    EXPECT_EQ(2u, stats.framesOverTarget);
+    EXPECT_EQ(2u, stats.missedPredictions);
+    EXPECT_EQ(0u, stats.loadUpHints);
+}
+
 }  // namespace android::uirenderer::renderthread
\ No newline at end of file
@@ -18,6 +18,7 @@
 #include <gmock/gmock.h>
 
 #include <JankTracker.h>
+#include <sys/mman.h>
 #include <utils/TimeUtils.h>
 
 using namespace android;
@@ -260,3 +261,115 @@ TEST(JankTracker, doubleStuffedTwoIntervalBehind) {
 
     ASSERT_EQ(2, container.get()->jankFrameCount());
 }
+
+TEST(JankTracker, stageHistogramBuckets) {
+    // Every value must land in a bucket whose start is within 1/16th of it.
+    const uint64_t values[] = {0, 1, 15, 16, 17, 100, 1234, 16667, 999999};
+    for (uint64_t micros : values) {
+        uint64_t start = StageHistogram::bucketStart(StageHistogram::bucketFor(micros));
+        EXPECT_LE(start, micros);
+        EXPECT_LE(micros - start, micros / StageHistogram::kSubBucketCount);
+    }
+    EXPECT_EQ(StageHistogram::kBucketCount - 1, StageHistogram::bucketFor(UINT64_MAX));
+
+    StageHistogram histogram;
+    for (int i = 1; i <= 100; i++) {
+        histogram.record(i * 100_us);
+    }
+    histogram.record(-1);
+    EXPECT_EQ(100u, histogram.count());
+    EXPECT_NEAR(5_ms, histogram.findPercentile(50), 5_ms / 16);
+    EXPECT_NEAR(9_ms, histogram.findPercentile(90), 9_ms / 16);
+    EXPECT_NEAR(10_ms, histogram.maxValue(), 10_ms / 16);
+    histogram.reset();
+    EXPECT_EQ(0, histogram.findPercentile(50));
+}
+
+TEST(JankTracker, stageStats) {
+    std::mutex mutex;
+    ProfileDataContainer container(mutex);
+    JankTracker jankTracker(&container);
+    std::unique_ptr<FrameMetricsReporter> reporter = std::make_unique<FrameMetricsReporter>();
+
+    FrameInfo* info = jankTracker.startFrame();
+    info->set(FrameInfoIndex::IntendedVsync) = 100_ms;
+    info->set(FrameInfoIndex::Vsync) = 101_ms;
+    info->set(FrameInfoIndex::SyncQueued) = 105_ms;
+    info->set(FrameInfoIndex::SyncStart) = 106_ms;
+    info->set(FrameInfoIndex::IssueDrawCommandsStart) = 108_ms;
+    info->set(FrameInfoIndex::SwapBuffers) = 112_ms;
+    info->set(FrameInfoIndex::SwapBuffersCompleted) = 113_ms;
+    info->set(FrameInfoIndex::GpuCompleted) = 115_ms;
+    info->set(FrameInfoIndex::FrameCompleted) = 115_ms;
+    info->set(FrameInfoIndex::DequeueBufferDuration) = 500_us;
+    info->set(FrameInfoIndex::FrameInterval) = 16_ms;
+    info->set(FrameInfoIndex::FrameDeadline) = 120_ms;
+    jankTracker.finishFrame(*info, reporter, 0, 0);
+
+    const FrameStageStats& stats = jankTracker.stageStats();
+    auto median = [&](FrameStage stage) { return stats.histogram(stage).findPercentile(50); };
+    EXPECT_NEAR(4_ms, median(FrameStage::UiThread), 4_ms / 16);
+    EXPECT_NEAR(1_ms, median(FrameStage::SyncQueueWait), 1_ms / 16);
+    EXPECT_NEAR(2_ms, median(FrameStage::Sync), 2_ms / 16);
+    EXPECT_NEAR(4_ms, median(FrameStage::IssueDraw), 4_ms / 16);
+    EXPECT_NEAR(500_us, median(FrameStage::DequeueBuffer), 500_us / 16);
+    EXPECT_NEAR(3_ms, median(FrameStage::Gpu), 3_ms / 16);
+    EXPECT_EQ(1u, stats.histogram(FrameStage::Swap).count());
+    EXPECT_EQ(0u, stats.histogram(FrameStage::FunctorSync).count());
+
+    info = jankTracker.startFrame();
+    int64_t uiFrameInfo[UI_THREAD_FRAME_INFO_SIZE] = {};
+    info->importUiThreadInfo(uiFrameInfo);
+    info->set(FrameInfoIndex::IntendedVsync) = 200_ms;
+    info->set(FrameInfoIndex::GpuCompleted) = 210_ms;
+    info->set(FrameInfoIndex::FrameCompleted) = 210_ms;
+    info->set(FrameInfoIndex::FrameInterval) = 16_ms;
+    info->set(FrameInfoIndex::FrameDeadline) = 220_ms;
+    info->setFunctorSync(3_ms, 2);
+    jankTracker.finishFrame(*info, reporter, 1, 0);
+    EXPECT_NEAR(3_ms, median(FrameStage::FunctorSync), 3_ms / 16);
+
+    std::lock_guard lock(mutex);
+    jankTracker.reset();
+    EXPECT_EQ(0u, stats.histogram(FrameStage::UiThread).count());
+}
+
+TEST(JankTracker, frameInfoRing) {
+    std::mutex mutex;
+    ProfileDataContainer container(mutex);
+    JankTracker jankTracker(&container);
+    std::unique_ptr<FrameMetricsReporter> reporter = std::make_unique<FrameMetricsReporter>();
+
+    int fd = jankTracker.getFrameInfoRingFd();
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(fd, jankTracker.getFrameInfoRingFd());
+    size_t size = FrameInfoRing::regionSize(120);
+    void* region = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ASSERT_NE(MAP_FAILED, region);
+    EXPECT_EQ(0u, FrameInfoRing::writeCount(region, size));
+
+    const uint64_t frameCount = 130;
+    for (uint64_t i = 0; i < frameCount; i++) {
+        FrameInfo* info = jankTracker.startFrame();
+        info->set(FrameInfoIndex::IntendedVsync) = 100_ms + i * 16_ms;
+        info->set(FrameInfoIndex::Vsync) = 100_ms + i * 16_ms;
+        info->set(FrameInfoIndex::GpuCompleted) = 110_ms + i * 16_ms;
+        info->set(FrameInfoIndex::FrameCompleted) = 110_ms + i * 16_ms;
+        info->set(FrameInfoIndex::FrameInterval) = 16_ms;
+        info->set(FrameInfoIndex::FrameDeadline) = 116_ms + i * 16_ms;
+        jankTracker.finishFrame(*info, reporter, i, 0);
+    }
+    ASSERT_EQ(frameCount, FrameInfoRing::writeCount(region, size));
+
+    int64_t data[FrameInfoRing::kFieldCount];
+    // The oldest frames were overwritten once the ring wrapped around.
+    EXPECT_FALSE(FrameInfoRing::read(region, size, 0, data));
+    EXPECT_FALSE(FrameInfoRing::read(region, size, frameCount, data));
+    for (uint64_t i = frameCount - 120; i < frameCount; i++) {
+        ASSERT_TRUE(FrameInfoRing::read(region, size, i, data));
+        EXPECT_EQ(static_cast<int64_t>(100_ms + i * 16_ms),
+                  data[static_cast<int>(FrameInfoIndex::IntendedVsync)]);
+    }
+    EXPECT_FALSE(FrameInfoRing::read(region, size / 2, frameCount - 1, data));
+    munmap(region, size);
+}
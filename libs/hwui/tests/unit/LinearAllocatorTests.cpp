@@ -86,6 +86,57 @@ TEST(LinearAllocator, rewind) {
     EXPECT_EQ(1, destroyed);
 }
 
+TEST(LinearAllocator, reset) {
+    int destroyed[10] = {0};
+    LinearAllocator la;
+    for (int i = 0; i < 10; i++) {
+        la.create<TestUtils::SignalingDtor>()->setSignal(destroyed + i);
+    }
+    // Grow past the first page and add a dedicated page for a large allocation
+    for (int i = 0; i < 64; i++) {
+        la.alloc<char>(256);
+    }
+    la.alloc<char>(64 * 1024);
+    size_t allocatedBefore = la.allocatedSize();
+
+    la.reset();
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(1, destroyed[i]);
+    }
+    EXPECT_GT(16u, la.usedSize());
+    EXPECT_LT(0u, la.allocatedSize());
+    EXPECT_GT(allocatedBefore, la.allocatedSize());
+
+    // The kept page satisfies a new allocation without allocating another one
+    size_t allocatedAfterReset = la.allocatedSize();
+    auto addr = la.alloc<char>(256);
+    EXPECT_NE(nullptr, addr);
+    EXPECT_EQ(allocatedAfterReset, la.allocatedSize());
+
+    la.reset();
+    la.reset();
+    EXPECT_EQ(allocatedAfterReset, la.allocatedSize());
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(1, destroyed[i]);
+    }
+}
+
+TEST(LinearAllocator, pageCache) {
+    LinearAllocator::trimPageCache();
+    void* firstPageAlloc;
+    {
+        LinearAllocator la;
+        firstPageAlloc = la.alloc<char>(100);
+    }
+    {
+        // The page released above is the most recently cached one of its size
+        LinearAllocator la;
+        EXPECT_EQ(firstPageAlloc, la.alloc<char>(100));
+        EXPECT_LE(100u, la.usedSize());
+    }
+    LinearAllocator::trimPageCache();
+}
+
 TEST(LinearStdAllocator, simpleAllocate) {
     LinearAllocator la;
     LinearStdAllocator<void*> stdAllocator(la);
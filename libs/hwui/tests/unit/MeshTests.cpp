@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SkBitmap.h>
+#include <SkCanvas.h>
+#include <SkMesh.h>
+#include <SkPaint.h>
+#include <gtest/gtest.h>
+
+#include "Mesh.h"
+
+namespace {
+
+using Attribute = SkMeshSpecification::Attribute;
+
+sk_sp<SkMeshSpecification> makeSolidRedSpec() {
+    const Attribute attributes[] = {{Attribute::Type::kFloat2, 0, SkString("pos")}};
+    auto result = SkMeshSpecification::Make(
+            attributes, 2 * sizeof(float), {},
+            SkString("Varyings main(const Attributes a) {"
+                     "    Varyings v;"
+                     "    v.position = a.pos;"
+                     "    return v;"
+                     "}"),
+            SkString("float2 main(const Varyings v, out half4 color) {"
+                     "    color = half4(1, 0, 0, 1);"
+                     "    return v.position;"
+                     "}"));
+    return result.specification;
+}
+
+SkColor drawAndReadPixel(const Mesh& mesh, int x, int y) {
+    SkBitmap bitmap;
+    bitmap.allocN32Pixels(10, 10);
+    bitmap.eraseColor(SK_ColorTRANSPARENT);
+    SkCanvas canvas(bitmap);
+    SkPaint paint;
+    paint.setColor(SK_ColorWHITE);
+    canvas.drawMesh(mesh.getSkMesh(), nullptr, paint);
+    return bitmap.getColor(x, y);
+}
+
+}  // namespace
+
+TEST(Mesh, updateVertexDataSubRange) {
+    sk_sp<SkMeshSpecification> spec = makeSolidRedSpec();
+    ASSERT_NE(nullptr, spec);
+    // The first triangle covers the left half of the middle row, the second one is empty.
+    const float vertices[] = {0, 0, 5, 0, 0, 20, 0, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> data(sizeof(vertices));
+    memcpy(data.data(), vertices, sizeof(vertices));
+    Mesh mesh(spec, static_cast<int>(SkMesh::Mode::kTriangles), std::move(data), 6, 0,
+              std::make_unique<MeshUniformBuilder>(spec), SkRect::MakeWH(10, 10));
+    ASSERT_TRUE(std::get<0>(mesh.validate()));
+
+    mesh.updateSkMesh(nullptr);
+    ASSERT_TRUE(mesh.getSkMesh().isValid());
+    const SkMesh::VertexBuffer* vertexBuffer = mesh.getSkMesh().vertexBuffer();
+    EXPECT_EQ(SK_ColorRED, drawAndReadPixel(mesh, 2, 5));
+    EXPECT_EQ(SK_ColorTRANSPARENT, drawAndReadPixel(mesh, 7, 5));
+
+    // Ranges outside of the vertex data are rejected.
+    const float outside[] = {5, 0, 10, 0, 10, 20};
+    EXPECT_FALSE(mesh.updateVertexData(8 * sizeof(float), outside, sizeof(outside)));
+    EXPECT_FALSE(mesh.updateVertexData(sizeof(vertices) + 1, outside, 0));
+
+    // Only the second triangle is updated, moving it into the right half.
+    ASSERT_TRUE(mesh.updateVertexData(6 * sizeof(float), outside, sizeof(outside)));
+    mesh.updateSkMesh(nullptr);
+    ASSERT_TRUE(mesh.getSkMesh().isValid());
+    // The vertex buffer is updated in place, not created again.
+    EXPECT_EQ(vertexBuffer, mesh.getSkMesh().vertexBuffer());
+    EXPECT_EQ(SK_ColorRED, drawAndReadPixel(mesh, 2, 5));
+    EXPECT_EQ(SK_ColorRED, drawAndReadPixel(mesh, 7, 5));
+}
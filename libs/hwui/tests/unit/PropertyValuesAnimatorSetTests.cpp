@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Interpolator.h"
+#include "PropertyValuesAnimatorSet.h"
+#include "PropertyValuesHolder.h"
+
+using namespace android;
+using namespace android::uirenderer;
+
+namespace {
+
+// Records the fraction it was last set to.
+class RecordingPropertyValuesHolder : public PropertyValuesHolder {
+public:
+    explicit RecordingPropertyValuesHolder(float* value) : mValue(value) {}
+    void setFraction(float fraction) override { *mValue = fraction; }
+
+private:
+    float* mValue;
+};
+
+class TestAnimatorSet : public PropertyValuesAnimatorSet {
+public:
+    using PropertyValuesAnimatorSet::onPlayTimeChanged;
+
+    void addAnimator(float* value, nsecs_t duration) {
+        addPropertyAnimator(new RecordingPropertyValuesHolder(value), new LinearInterpolator(), 0,
+                            duration, 0, RepeatMode::Restart);
+    }
+};
+
+}  // namespace
+
+TEST(PropertyValuesAnimatorSet, seekBackBeforeEndedAnimators) {
+    float shortValue = 0;
+    float mediumValue = 0;
+    float longValue = 0;
+    sp<TestAnimatorSet> set = new TestAnimatorSet();
+    // Added out of order, as start() sorts them by duration.
+    set->addAnimator(&longValue, 400);
+    set->addAnimator(&shortValue, 100);
+    set->addAnimator(&mediumValue, 200);
+    set->start(nullptr);
+
+    set->onPlayTimeChanged(50);
+    EXPECT_FLOAT_EQ(0.5f, shortValue);
+    EXPECT_FLOAT_EQ(0.25f, mediumValue);
+    EXPECT_FLOAT_EQ(0.125f, longValue);
+
+    // Past the end of the two shorter animators.
+    set->onPlayTimeChanged(250);
+    EXPECT_FLOAT_EQ(1.0f, shortValue);
+    EXPECT_FLOAT_EQ(1.0f, mediumValue);
+    EXPECT_FLOAT_EQ(0.625f, longValue);
+    set->onPlayTimeChanged(300);
+    EXPECT_FLOAT_EQ(1.0f, shortValue);
+    EXPECT_FLOAT_EQ(1.0f, mediumValue);
+    EXPECT_FLOAT_EQ(0.75f, longValue);
+
+    // Back before the end of the medium animator only.
+    set->onPlayTimeChanged(150);
+    EXPECT_FLOAT_EQ(1.0f, shortValue);
+    EXPECT_FLOAT_EQ(0.75f, mediumValue);
+    EXPECT_FLOAT_EQ(0.375f, longValue);
+
+    // Back before the end of both.
+    set->onPlayTimeChanged(50);
+    EXPECT_FLOAT_EQ(0.5f, shortValue);
+    EXPECT_FLOAT_EQ(0.25f, mediumValue);
+    EXPECT_FLOAT_EQ(0.125f, longValue);
+
+    // And past all of their ends.
+    set->onPlayTimeChanged(400);
+    EXPECT_FLOAT_EQ(1.0f, shortValue);
+    EXPECT_FLOAT_EQ(1.0f, mediumValue);
+    EXPECT_FLOAT_EQ(1.0f, longValue);
+}
@@ -21,6 +21,7 @@
 #include "DamageAccumulator.h"
 #include "IContextFactory.h"
 #include "RenderNode.h"
+#include "RetainedLayerCache.h"
 #include "TreeInfo.h"
 #include "renderthread/CanvasContext.h"
 #include "tests/common/TestUtils.h"
@@ -270,6 +271,24 @@ TEST(RenderNode, releasedCallback) {
     EXPECT_EQ(1, counts.destroyed);
 }
 
+TEST(RenderNode, getRevealClippedOutline) {
+    auto node = TestUtils::createNode(0, 0, 200, 400, nullptr);
+    SkPath outline = SkPath::Rect(SkRect::MakeWH(200, 400));
+    SkPath reveal = SkPath::Circle(100, 100, 50);
+
+    const SkPath* clipped = node->getRevealClippedOutline(outline, reveal);
+    EXPECT_EQ(SkRect::MakeLTRB(50, 50, 150, 150), clipped->getBounds());
+    // The same path is returned while neither input changes, so the shadow tessellation that Skia
+    // caches for it can be reused
+    const uint32_t clippedID = clipped->getGenerationID();
+    EXPECT_EQ(clippedID, node->getRevealClippedOutline(outline, reveal)->getGenerationID());
+
+    reveal = SkPath::Circle(100, 100, 25);
+    clipped = node->getRevealClippedOutline(outline, reveal);
+    EXPECT_NE(clippedID, clipped->getGenerationID());
+    EXPECT_EQ(SkRect::MakeLTRB(75, 75, 125, 125), clipped->getBounds());
+}
+
 RENDERTHREAD_TEST(RenderNode, prepareTree_nullableDisplayList) {
     auto rootNode = TestUtils::createNode(0, 0, 200, 400, nullptr);
     ContextFactory contextFactory;
@@ -299,6 +318,90 @@ RENDERTHREAD_TEST(RenderNode, prepareTree_nullableDisplayList) {
     canvasContext->destroy();
 }
 
+RENDERTHREAD_TEST(RenderNode, prepareTree_retainsUnchangedSubtreeAsLayer) {
+    const int threshold = RetainedLayerCache::get().frameThreshold();
+    if (threshold <= 0) {
+        GTEST_SKIP() << "Retained layers are disabled by the memory policy";
+    }
+    // Enough ops to be worth a layer
+    auto drawRows = [](Canvas& canvas, float offset) {
+        Paint paint;
+        for (int i = 0; i < 100; i++) {
+            canvas.drawRect(0, offset + i * 4, 200, offset + i * 4 + 2, paint);
+        }
+    };
+    auto rootNode = TestUtils::createNode(
+            0, 0, 200, 400,
+            [&](RenderProperties& props, Canvas& canvas) { drawRows(canvas, 0); });
+    ContextFactory contextFactory;
+    std::unique_ptr<CanvasContext> canvasContext(
+            CanvasContext::create(renderThread, false, rootNode.get(), &contextFactory, 0, 0));
+    TestUtils::syncHierarchyPropertiesAndDisplayList(rootNode);
+
+    int64_t frame = 0;
+    auto prepareFrame = [&](TreeInfo::TraversalMode mode) {
+        TreeInfo info(mode, *canvasContext.get());
+        DamageAccumulator damageAccumulator;
+        LayerUpdateQueue layerUpdateQueue;
+        info.damageAccumulator = &damageAccumulator;
+        info.layerUpdateQueue = &layerUpdateQueue;
+        info.damageGenerationId = ++frame;
+        rootNode->prepareTree(info);
+    };
+
+    for (int i = 0; i < threshold - 1; i++) {
+        prepareFrame(TreeInfo::MODE_RT_ONLY);
+        EXPECT_FALSE(rootNode->properties().isRetainedAsLayer());
+    }
+    prepareFrame(TreeInfo::MODE_RT_ONLY);
+    EXPECT_TRUE(rootNode->properties().isRetainedAsLayer());
+    EXPECT_EQ(LayerType::RenderLayer, rootNode->properties().effectiveLayerType());
+    EXPECT_TRUE(rootNode->hasLayer());
+
+    // Changing the content drops the layer again
+    TestUtils::recordNode(*rootNode, [&](Canvas& canvas) { drawRows(canvas, 1); });
+    prepareFrame(TreeInfo::MODE_FULL);
+    EXPECT_FALSE(rootNode->properties().isRetainedAsLayer());
+    EXPECT_FALSE(rootNode->hasLayer());
+
+    rootNode->destroyLayers();
+    canvasContext->destroy();
+}
+
+RENDERTHREAD_TEST(RenderNode, prepareTree_doesNotRetainUnclippedSubtree) {
+    const int threshold = RetainedLayerCache::get().frameThreshold();
+    if (threshold <= 0) {
+        GTEST_SKIP() << "Retained layers are disabled by the memory policy";
+    }
+    // Enough ops to be worth a layer, drawn partly outside of the bounds
+    auto rootNode = TestUtils::createNode(
+            0, 0, 200, 400, [](RenderProperties& props, Canvas& canvas) {
+                props.setClipToBounds(false);
+                Paint paint;
+                for (int i = 0; i < 100; i++) {
+                    canvas.drawRect(-50, i * 4, 250, i * 4 + 2, paint);
+                }
+            });
+    ContextFactory contextFactory;
+    std::unique_ptr<CanvasContext> canvasContext(
+            CanvasContext::create(renderThread, false, rootNode.get(), &contextFactory, 0, 0));
+    TestUtils::syncHierarchyPropertiesAndDisplayList(rootNode);
+
+    for (int i = 0; i < threshold + 1; i++) {
+        TreeInfo info(TreeInfo::MODE_RT_ONLY, *canvasContext.get());
+        DamageAccumulator damageAccumulator;
+        LayerUpdateQueue layerUpdateQueue;
+        info.damageAccumulator = &damageAccumulator;
+        info.layerUpdateQueue = &layerUpdateQueue;
+        info.damageGenerationId = i + 1;
+        rootNode->prepareTree(info);
+        EXPECT_FALSE(rootNode->properties().isRetainedAsLayer());
+    }
+    EXPECT_FALSE(rootNode->hasLayer());
+
+    canvasContext->destroy();
+}
+
 // TODO: Is this supposed to work in SkiaGL/SkiaVK?
 RENDERTHREAD_TEST(DISABLED_RenderNode, prepareTree_HwLayer_AVD_enqueueDamage) {
     VectorDrawable::Group* group = new VectorDrawable::Group();
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <utils/Log.h>
 
 #include <cstdint>
@@ -32,6 +33,7 @@
 #include "FileBlobCache.h"
 #include "pipeline/skia/ShaderCache.h"
 #include "tests/common/TestUtils.h"
+#include "thread/CommonPool.h"
 
 using namespace android::uirenderer::skiapipeline;
 
@@ -63,6 +65,16 @@ public:
         cache.mNewPipelineCacheSize = newCache.mNewPipelineCacheSize;
         cache.mOldPipelineCacheSize = newCache.mOldPipelineCacheSize;
         cache.mCacheDirty = newCache.mCacheDirty;
+        cache.mJournalPending.clear();
+        cache.mJournalId.clear();
+        cache.mJournalSize = newCache.mJournalSize;
+        cache.mJournalFailed = newCache.mJournalFailed.load();
+        cache.mUsedKeys.clear();
+        cache.mWarmUpFramesLeft = newCache.mWarmUpFramesLeft;
+        cache.mRecordingWarmUp = newCache.mRecordingWarmUp.load();
+        cache.mWarmUpKeys.clear();
+        cache.mWarmUpLoaded = newCache.mWarmUpLoaded;
+        cache.mWarmUpStats = newCache.mWarmUpStats;
         cache.mNumShadersCachedInRam = newCache.mNumShadersCachedInRam;
     }
 
@@ -369,6 +381,108 @@ TEST(ShaderCacheTest, testCacheValidation) {
     ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(cacheFile2));
 }
 
+TEST(ShaderCacheTest, testJournal) {
+    if (!folderExist(getExternalStorageFolder())) {
+        // don't run the test if external storage folder is not available
+        return;
+    }
+    std::string cacheFile = getExternalStorageFolder() + "/shaderCacheTest";
+    std::string journalFile = cacheFile + ".journal";
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(cacheFile));
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(journalFile));
+
+    ShaderCacheTestUtils::reinitializeAllFields(ShaderCache::get());
+    ShaderCacheTestUtils::setSaveDelayMs(ShaderCache::get(), 10);
+    ShaderCache::get().setFilename(cacheFile.c_str());
+    ShaderCache::get().initShaderDiskCache();
+
+    // A deferred save only appends the new entries to the journal
+    sk_sp<SkData> inVS;
+    setShader(inVS, "sassas");
+    ShaderCache::get().store(GrProgramDescTest(100), *inVS.get(), SkString());
+    ASSERT_NO_FATAL_FAILURE(ShaderCacheTestUtils::waitForPendingSave(ShaderCache::get()));
+    setShader(inVS, "someVS");
+    ShaderCache::get().store(GrProgramDescTest(432), *inVS.get(), SkString());
+    setShader(inVS, "ewData1");
+    ShaderCache::get().store(GrProgramDescTest(100), *inVS.get(), SkString());
+    ASSERT_NO_FATAL_FAILURE(ShaderCacheTestUtils::waitForPendingSave(ShaderCache::get()));
+
+    // Reloading replays the journal, the latest value of a key wins
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), false);
+    ShaderCache::get().initShaderDiskCache();
+    ASSERT_NE(-1, access(journalFile.c_str(), F_OK));
+    ASSERT_EQ(-1, access(cacheFile.c_str(), F_OK));
+    sk_sp<SkData> outVS;
+    ASSERT_NE((outVS = ShaderCache::get().load(GrProgramDescTest(100))), sk_sp<SkData>());
+    ASSERT_TRUE(checkShader(outVS, "ewData1"));
+    ASSERT_NE((outVS = ShaderCache::get().load(GrProgramDescTest(432))), sk_sp<SkData>());
+    ASSERT_TRUE(checkShader(outVS, "someVS"));
+
+    // Writing the whole cache discards the journal
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), true);
+    ASSERT_EQ(-1, access(journalFile.c_str(), F_OK));
+    ShaderCache::get().initShaderDiskCache();
+    ASSERT_NE((outVS = ShaderCache::get().load(GrProgramDescTest(100))), sk_sp<SkData>());
+    ASSERT_TRUE(checkShader(outVS, "ewData1"));
+
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), false);
+    ShaderCacheTestUtils::reinitializeAllFields(ShaderCache::get());
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(cacheFile));
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(journalFile));
+}
+
+TEST(ShaderCacheTest, testWarmUpShaders) {
+    if (!folderExist(getExternalStorageFolder())) {
+        // don't run the test if external storage folder is not available
+        return;
+    }
+    std::string cacheFile = getExternalStorageFolder() + "/shaderCacheTest";
+    std::string warmUpFile = cacheFile + ".warmup";
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(cacheFile));
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(cacheFile + ".journal"));
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(warmUpFile));
+
+    ShaderCacheTestUtils::reinitializeAllFields(ShaderCache::get());
+    ShaderCacheTestUtils::setSaveDelayMs(ShaderCache::get(), 10);
+    ShaderCache::get().setFilename(cacheFile.c_str());
+    ShaderCache::get().initShaderDiskCache();
+    ASSERT_TRUE(ShaderCache::get().loadWarmUpShaders().empty());
+
+    // Shaders stored during the first frames are recorded, later ones are not
+    sk_sp<SkData> inVS;
+    setShader(inVS, "sassas");
+    ShaderCache::get().store(GrProgramDescTest(100), *inVS.get(), SkString());
+    for (int i = 0; i < 60; i++) {
+        ShaderCache::get().onFrameCompleted();
+    }
+    setShader(inVS, "someVS");
+    ShaderCache::get().store(GrProgramDescTest(432), *inVS.get(), SkString());
+    ASSERT_NO_FATAL_FAILURE(ShaderCacheTestUtils::waitForPendingSave(ShaderCache::get()));
+    CommonPool::waitForIdle();
+
+    // The next launch gets the recorded shader back, once
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), true);
+    ShaderCacheTestUtils::reinitializeAllFields(ShaderCache::get());
+    ShaderCacheTestUtils::setSaveDelayMs(ShaderCache::get(), 10);
+    ShaderCache::get().setFilename(cacheFile.c_str());
+    ShaderCache::get().initShaderDiskCache();
+    ShaderCache::ShaderList shaders = ShaderCache::get().loadWarmUpShaders();
+    ASSERT_EQ(1u, shaders.size());
+    ASSERT_TRUE(checkShader(shaders[0].first, "100"));
+    ASSERT_TRUE(checkShader(shaders[0].second, "sassas"));
+    ASSERT_TRUE(ShaderCache::get().loadWarmUpShaders().empty());
+
+    ShaderCache::get().onWarmUpShaderCompiled(*shaders[0].first, true);
+    String8 log;
+    ShaderCache::get().dumpWarmUpStats(log);
+    ASSERT_NE(nullptr, strstr(log.c_str(), "1 recorded, 1 precompiled, 0 failed"));
+
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), false);
+    ShaderCacheTestUtils::reinitializeAllFields(ShaderCache::get());
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(cacheFile));
+    ASSERT_NO_FATAL_FAILURE(deleteFileAssertSuccess(warmUpFile));
+}
+
 using namespace android::uirenderer;
 RENDERTHREAD_SKIA_PIPELINE_TEST(ShaderCacheTest, testOnVkFrameFlushed) {
     if (Properties::getRenderPipelineType() != RenderPipelineType::SkiaVulkan) {
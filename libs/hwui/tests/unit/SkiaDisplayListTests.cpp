@@ -14,12 +14,17 @@
  * limitations under the License.
  */
 
+#include <SkNoDrawCanvas.h>
 #include <VectorDrawable.h>
 #include <gtest/gtest.h>
 
+#include <string>
+#include <vector>
+
 #include "AnimationContext.h"
 #include "DamageAccumulator.h"
 #include "IContextFactory.h"
+#include "RecordingCanvas.h"
 #include "pipeline/skia/GLFunctorDrawable.h"
 #include "pipeline/skia/SkiaDisplayList.h"
 #include "renderthread/CanvasContext.h"
@@ -367,3 +372,73 @@ TEST(SkiaDisplayList, updateChildren) {
     skiaDL.mChildNodes.emplace_back(renderNode.get(), &dummyCanvas);
     skiaDL.updateChildren([renderNode](RenderNode* n) { ASSERT_EQ(renderNode.get(), n); });
 }
+
+namespace {
+// Records the state changes and draws that replaying a DisplayListData makes.
+class OpLogCanvas : public SkNoDrawCanvas {
+public:
+    OpLogCanvas() : SkNoDrawCanvas(100, 100) {}
+    std::vector<std::string> log;
+
+protected:
+    void willSave() override { log.push_back("save"); }
+    void willRestore() override { log.push_back("restore"); }
+    void didTranslate(SkScalar dx, SkScalar dy) override {
+        log.push_back("translate " + std::to_string((int)dx) + " " + std::to_string((int)dy));
+    }
+    void didSetM44(const SkM44&) override { log.push_back("setMatrix"); }
+    void onClipRect(const SkRect& rect, SkClipOp op, ClipEdgeStyle style) override {
+        log.push_back("clipRect");
+        SkNoDrawCanvas::onClipRect(rect, op, style);
+    }
+    void onDrawRect(const SkRect&, const SkPaint&) override { log.push_back("drawRect"); }
+    void onDrawPoints(PointMode, size_t count, const SkPoint[], const SkPaint&) override {
+        log.push_back("drawPoints " + std::to_string(count));
+    }
+};
+}  // namespace
+
+TEST(SkiaDisplayList, compact) {
+    // Antialiased, so that replaying the points doesn't need a CanvasContext to snap them
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    const SkPoint points[] = {{1, 1}, {2, 2}, {3, 3}};
+    DisplayListData data;
+    RecordingCanvas recorder;
+    recorder.reset(&data, SkIRect::MakeWH(100, 100));
+    // A save whose state changes are never drawn with
+    recorder.save();
+    recorder.translate(10, 10);
+    recorder.clipRect(SkRect::MakeWH(10, 10));
+    recorder.restore();
+    // Consecutive translates become one
+    recorder.translate(1, 2);
+    recorder.translate(3, 4);
+    recorder.drawRect(SkRect::MakeWH(5, 5), paint);
+    // setMatrix replaces the translate before it
+    recorder.translate(7, 7);
+    recorder.setMatrix(SkM44());
+    recorder.drawPoints(SkCanvas::kPoints_PointMode, 3, points, paint);
+    recorder.drawPoints(SkCanvas::kPoints_PointMode, 2, points, paint);
+
+    const size_t usedBefore = data.usedSize();
+    const size_t saved = data.compact();
+    EXPECT_GT(saved, 0u);
+    EXPECT_EQ(usedBefore - saved, data.usedSize());
+    EXPECT_EQ(0u, data.compact());
+
+    OpLogCanvas canvas;
+    data.draw(&canvas);
+    const std::vector<std::string> expected = {"translate 4 6", "drawRect", "setMatrix",
+                                               "drawPoints 5"};
+    EXPECT_EQ(expected, canvas.log);
+}
+
+TEST(SkiaDisplayList, compact_keepsSaveLayer) {
+    DisplayListData data;
+    RecordingCanvas recorder;
+    recorder.reset(&data, SkIRect::MakeWH(100, 100));
+    recorder.saveLayerAlpha(nullptr, 128);
+    recorder.restore();
+    EXPECT_EQ(0u, data.compact());
+}
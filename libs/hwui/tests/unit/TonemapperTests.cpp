@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <SkColorSpace.h>
+#include <SkImageInfo.h>
+#include <SkPaint.h>
+
+#include "Tonemapper.h"
+
+using namespace android::uirenderer;
+
+static SkImageInfo makePQInfo() {
+    return SkImageInfo::Make(16, 16, kRGBA_F16_SkColorType, kPremul_SkAlphaType,
+                             SkColorSpace::MakeRGB(SkNamedTransferFn::kPQ, SkNamedGamut::kRec2020));
+}
+
+static SkImageInfo makeSRGBInfo() {
+    return SkImageInfo::MakeN32Premul(16, 16, SkColorSpace::MakeSRGB());
+}
+
+TEST(Tonemapper, sdrToSdrHasNoFilter) {
+    SkPaint paint;
+    tonemapPaint(makeSRGBInfo(), makeSRGBInfo(), -1, paint);
+    EXPECT_EQ(nullptr, paint.getColorFilter());
+}
+
+TEST(Tonemapper, reusesColorFilter) {
+    SkPaint first;
+    tonemapPaint(makePQInfo(), makeSRGBInfo(), 1000.f, first);
+    ASSERT_NE(nullptr, first.getColorFilter());
+
+    SkPaint second;
+    tonemapPaint(makePQInfo(), makeSRGBInfo(), 1000.f, second);
+    EXPECT_EQ(first.getColorFilter(), second.getColorFilter());
+
+    // The content's max luminance is a uniform, so it needs a filter of its own.
+    SkPaint brighter;
+    tonemapPaint(makePQInfo(), makeSRGBInfo(), 4000.f, brighter);
+    ASSERT_NE(nullptr, brighter.getColorFilter());
+    EXPECT_NE(first.getColorFilter(), brighter.getColorFilter());
+}
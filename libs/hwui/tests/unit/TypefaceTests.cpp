@@ -27,6 +27,7 @@
 #include "SkStream.h"
 #include "SkTypeface.h"
 
+#include "hwui/FontLoadStats.h"
 #include "hwui/MinikinSkia.h"
 #include "hwui/Typeface.h"
 
@@ -67,6 +68,19 @@ std::shared_ptr<minikin::FontFamily> buildFamily(const char* fileName) {
     return minikin::FontFamily::create(std::move(fonts));
 }
 
+std::shared_ptr<MinikinFontSkia> buildDeferredFont(const char* fileName) {
+    int fd = open(fileName, O_RDONLY);
+    LOG_ALWAYS_FATAL_IF(fd == -1, "Failed to open file %s", fileName);
+    struct stat st = {};
+    LOG_ALWAYS_FATAL_IF(fstat(fd, &st) == -1, "Failed to stat file %s", fileName);
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    sk_sp<SkData> skData =
+            SkData::MakeWithProc(data, st.st_size, unmap, reinterpret_cast<void*>(st.st_size));
+    return std::make_shared<MinikinFontSkia>(std::move(skData), 0, data, st.st_size, fileName, 0,
+                                             std::vector<minikin::FontVariation>());
+}
+
 std::vector<std::shared_ptr<minikin::FontFamily>> makeSingleFamlyVector(const char* fileName) {
     return std::vector<std::shared_ptr<minikin::FontFamily>>({buildFamily(fileName)});
 }
@@ -461,4 +475,34 @@ TEST(TypefaceTest, createFromFamilies_Family_withFallback) {
     EXPECT_EQ(minikin::FontStyle::Slant::UPRIGHT, regular->fStyle.slant());
 }
 
+TEST(TypefaceTest, deferredFont_parsedOnFirstGlyph) {
+    std::shared_ptr<MinikinFontSkia> minikinFont = buildDeferredFont(kRegularFont);
+    std::vector<std::shared_ptr<minikin::Font>> fonts;
+    fonts.push_back(minikin::Font::Builder(minikinFont).build());
+    std::shared_ptr<minikin::FontFamily> family = minikin::FontFamily::create(std::move(fonts));
+
+    // Coverage comes from the font data directly, building the family doesn't need a typeface.
+    EXPECT_NE(0u, family->getCoverage().length());
+    EXPECT_FALSE(minikinFont->isTypefaceLoaded());
+    EXPECT_FALSE(FontLoadStats::get().isLoaded(*family->getFont(0)));
+
+    minikin::MinikinPaint paint(nullptr);
+    paint.size = 10.0f;
+    minikinFont->GetHorizontalAdvance(1 /* any glyph */, paint, minikin::FontFakery());
+    EXPECT_TRUE(minikinFont->isTypefaceLoaded());
+    EXPECT_TRUE(FontLoadStats::get().isLoaded(*family->getFont(0)));
+}
+
+TEST(TypefaceTest, deferredFont_variationStaysDeferred) {
+    std::shared_ptr<MinikinFontSkia> minikinFont = buildDeferredFont(kRobotoVariable);
+    constexpr minikin::AxisTag kWeightTag = 0x77676874;  // 'wght'
+    std::shared_ptr<minikin::MinikinFont> variation =
+            minikinFont->createFontWithVariation({minikin::FontVariation(kWeightTag, 700)});
+    auto variationSkia = static_cast<const MinikinFontSkia*>(variation.get());
+    EXPECT_FALSE(minikinFont->isTypefaceLoaded());
+    EXPECT_FALSE(variationSkia->isTypefaceLoaded());
+    EXPECT_NE(nullptr, variationSkia->GetSkTypeface());
+    EXPECT_FALSE(minikinFont->isTypefaceLoaded());
+}
+
 }  // namespace
@@ -18,7 +18,9 @@
 
 #include "PathParser.h"
 #include "VectorDrawable.h"
+#include "VectorDrawableCache.h"
 #include "utils/MathUtils.h"
+#include "utils/TimeUtils.h"
 #include "utils/VectorDrawableUtils.h"
 
 #include <SkBitmap.h>
@@ -28,6 +30,7 @@
 #include <SkShader.h>
 
 #include <functional>
+#include <string>
 
 namespace android {
 namespace uirenderer {
@@ -279,6 +282,58 @@ TEST(PathParser, parseStringForData) {
     }
 }
 
+TEST(PathParser, numbersMatchStrtof) {
+    // Both numbers taking the fast path and ones that need strtof.
+    const char* numbers[] = {"0",        "-0",      "1.5",      ".5",       "-.25",
+                             "5.",       "7e3",     "2.5e+2",   "1.25E-4",  "12345.67",
+                             "1e10",     "1e-10",   "0.1",      "16777215", "16777217",
+                             "3.4e38",   "1e-45",   "1.000000001", "123456789.123"};
+    for (const char* number : numbers) {
+        std::string pathString = std::string("M") + number + " 0";
+        PathParser::ParseResult result;
+        PathData data;
+        PathParser::parsePathData(&data, &result, pathString.c_str(), pathString.size());
+        ASSERT_FALSE(result.failureOccurred) << number;
+        ASSERT_EQ(2u, data.points.size()) << number;
+        float expected = strtof(number, nullptr);
+        EXPECT_EQ(0, memcmp(&expected, &data.points[0], sizeof(float))) << number;
+    }
+}
+
+TEST(PathParser, cachesParsedPathData) {
+    PathParser::clearPathDataCache();
+    const char* pathString = "M 1 1 m 2 2, l 3 3 L 3 3 H 4 h4 V5 v5, Q6 6 6 6 q 6 6 6 6t 7 7 z";
+    size_t length = strlen(pathString);
+
+    PathParser::ParseResult result;
+    PathData expected;
+    PathParser::parsePathData(&expected, &result, pathString, length);
+    ASSERT_FALSE(result.failureOccurred);
+
+    for (int i = 0; i < 2; i++) {
+        PathData data;
+        PathParser::getPathDataFromAsciiString(&data, &result, pathString, length);
+        ASSERT_FALSE(result.failureOccurred);
+        EXPECT_EQ(expected, data);
+    }
+
+    // Cached results are appended to the existing data like parsed ones.
+    PathData data = expected;
+    PathParser::getPathDataFromAsciiString(&data, &result, pathString, length);
+    EXPECT_EQ(expected.verbs.size() * 2, data.verbs.size());
+    EXPECT_EQ(expected.points.size() * 2, data.points.size());
+
+    // Failures are reported every time.
+    const char* invalid = "M 1 1 m 2 2, l 3 3 L 3 3 H 4 h4 V5 v5, Q6 6 6 6 q 6 6 6 6t 7 7 7 z";
+    for (int i = 0; i < 2; i++) {
+        PathParser::ParseResult invalidResult;
+        PathData invalidData;
+        PathParser::getPathDataFromAsciiString(&invalidData, &invalidResult, invalid,
+                                               strlen(invalid));
+        EXPECT_TRUE(invalidResult.failureOccurred);
+    }
+}
+
 TEST(VectorDrawableUtils, createSkPathFromPathData) {
     for (const TestData& testData : sTestDataSet) {
         SkPath expectedPath;
@@ -415,5 +470,49 @@ TEST(VectorDrawable, drawPathWithoutIncrementingShaderRefCount) {
     EXPECT_TRUE(shader->unique());
 }
 
+static sp<VectorDrawableRoot> createTriangleTree(SkColor fillColor) {
+    const char* pathString = "M0 0 L10 0 L10 10 Z";
+    auto path = new VectorDrawable::FullPath(pathString, strlen(pathString));
+    path->mutateStagingProperties()->setFillColor(fillColor);
+    auto group = new VectorDrawable::Group();
+    group->addChild(path);
+    sp<VectorDrawableRoot> tree = new VectorDrawableRoot(group);
+    tree->mutateStagingProperties()->setViewportSize(10, 10);
+    tree->mutateStagingProperties()->setScaledSize(20, 20);
+    tree->syncProperties();
+    return tree;
+}
+
+TEST(VectorDrawable, sharedBitmapCache) {
+    VectorDrawable::VectorDrawableCache& cache = VectorDrawable::VectorDrawableCache::get();
+    cache.clear();
+
+    sp<VectorDrawableRoot> first = createTriangleTree(SK_ColorRED);
+    sp<VectorDrawableRoot> second = createTriangleTree(SK_ColorRED);
+    sp<VectorDrawableRoot> blue = createTriangleTree(SK_ColorBLUE);
+
+    Bitmap& firstBitmap = first->getBitmapUpdateIfDirty();
+    EXPECT_EQ(20, firstBitmap.width());
+    EXPECT_EQ(&firstBitmap, &second->getBitmapUpdateIfDirty());
+    EXPECT_NE(&firstBitmap, &blue->getBitmapUpdateIfDirty());
+    EXPECT_EQ(2u * 20 * 20 * 4, cache.sizeInBytes());
+
+    // A tree that keeps changing stops sharing, and never paints over the shared bitmap.
+    for (int i = 0; i < 5; i++) {
+        second->mutateProperties()->setViewportSize(11 + i, 10);
+        second->getBitmapUpdateIfDirty();
+    }
+    EXPECT_NE(&firstBitmap, &second->getBitmapUpdateIfDirty());
+    EXPECT_EQ(&firstBitmap, &first->getBitmapUpdateIfDirty());
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    cache.trimStale(now);
+    EXPECT_EQ(5u * 20 * 20 * 4, cache.sizeInBytes());
+    cache.trimStale(now + VectorDrawable::VectorDrawableCache::kStaleTimeout + 1_s);
+    EXPECT_EQ(0u, cache.sizeInBytes());
+    // Trees keep the bitmaps they already use.
+    EXPECT_EQ(20, first->getBitmapUpdateIfDirty().width());
+}
+
 }  // namespace uirenderer
 }  // namespace android
@@ -52,7 +52,7 @@ CommonPool::CommonPool() {
                     startHook(name.data());
                 }
             }
-            pool->workerLoop();
+            pool->workerLoop(i);
         });
         worker.detach();
     }
@@ -72,43 +72,92 @@ CommonPool& CommonPool::instance() {
     return pool;
 }
 
-void CommonPool::post(Task&& task) {
-    instance().enqueue(std::move(task));
+// The index of the pool worker running on this thread, or -1 for other threads.
+static thread_local int sWorkerIndex = -1;
+
+void CommonPool::post(Task&& task, Priority priority) {
+    instance().enqueue(std::move(task), priority);
 }
 
 std::vector<int> CommonPool::getThreadIds() {
     return instance().mWorkerThreadIds;
 }
 
-void CommonPool::enqueue(Task&& task) {
-    std::unique_lock lock(mLock);
-    while (!mWorkQueue.hasSpace()) {
-        lock.unlock();
-        usleep(100);
-        lock.lock();
+void CommonPool::enqueue(Task&& task, Priority priority) {
+    const int queue = static_cast<int>(priority);
+    // Count the task before it becomes visible so the count never drops below zero. A worker
+    // that sees the count first just looks for the task again.
+    mPendingTasks++;
+    if (sWorkerIndex >= 0) {
+        Worker& worker = mWorkers[sWorkerIndex];
+        std::lock_guard workerLock(worker.lock);
+        worker.queues[queue].push_back(std::move(task));
     }
-    mWorkQueue.push(std::move(task));
-    if (mWaitingThreads == THREAD_COUNT || (mWaitingThreads > 0 && mWorkQueue.size() > 1)) {
+
+    std::lock_guard lock(mLock);
+    if (sWorkerIndex < 0) {
+        mQueues[queue].push_back(std::move(task));
+    }
+    // Workers only park after checking mPendingTasks under mLock, so this cannot be missed.
+    if (mWaitingThreads > 0) {
         mCondition.notify_one();
     }
 }
 
-void CommonPool::workerLoop() {
-    std::unique_lock lock(mLock);
-    while (true) {
-        if (!mWorkQueue.hasWork()) {
-            mWaitingThreads++;
-            mCondition.wait(lock);
-            mWaitingThreads--;
+bool CommonPool::takeTask(int index, Task* outTask) {
+    for (int queue = 0; queue < PRIORITY_COUNT; queue++) {
+        // Newest work of our own first, since its data is most likely still in cache.
+        {
+            Worker& self = mWorkers[index];
+            std::lock_guard lock(self.lock);
+            if (!self.queues[queue].empty()) {
+                *outTask = std::move(self.queues[queue].back());
+                self.queues[queue].pop_back();
+                mPendingTasks--;
+                return true;
+            }
         }
-        // Need to double-check that work is still available now that we have the lock
-        // It may have already been grabbed by a different thread
-        while (mWorkQueue.hasWork()) {
-            auto work = mWorkQueue.pop();
-            lock.unlock();
+        {
+            std::lock_guard lock(mLock);
+            if (!mQueues[queue].empty()) {
+                *outTask = std::move(mQueues[queue].front());
+                mQueues[queue].pop_front();
+                mPendingTasks--;
+                return true;
+            }
+        }
+        // Steal the oldest work of the other workers.
+        for (int i = 1; i < THREAD_COUNT; i++) {
+            Worker& victim = mWorkers[(index + i) % THREAD_COUNT];
+            std::lock_guard lock(victim.lock);
+            if (!victim.queues[queue].empty()) {
+                *outTask = std::move(victim.queues[queue].front());
+                victim.queues[queue].pop_front();
+                mPendingTasks--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CommonPool::workerLoop(int index) {
+    sWorkerIndex = index;
+    while (true) {
+        Task work;
+        if (takeTask(index, &work)) {
             work();
-            lock.lock();
+            continue;
+        }
+
+        std::unique_lock lock(mLock);
+        // Need to double-check under the lock that no work was queued since we looked.
+        if (mPendingTasks.load() > 0) {
+            continue;
         }
+        mWaitingThreads++;
+        mCondition.wait(lock, [this] { return mPendingTasks.load() > 0; });
+        mWaitingThreads--;
     }
 }
 
@@ -118,7 +167,7 @@ void CommonPool::waitForIdle() {
 
 void CommonPool::doWaitForIdle() {
     std::unique_lock lock(mLock);
-    while (mWaitingThreads != THREAD_COUNT) {
+    while (mWaitingThreads != THREAD_COUNT || mPendingTasks.load() > 0) {
         lock.unlock();
         usleep(100);
         lock.lock();
@@ -21,7 +21,10 @@
 
 #include <log/log.h>
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
 #include <mutex>
@@ -30,71 +33,40 @@
 namespace android {
 namespace uirenderer {
 
-template <class T, int SIZE>
-class ArrayQueue {
-    PREVENT_COPY_AND_ASSIGN(ArrayQueue);
-    static_assert(SIZE > 0, "Size must be positive");
-
-public:
-    ArrayQueue() = default;
-    ~ArrayQueue() = default;
-
-    constexpr size_t capacity() const { return SIZE; }
-    constexpr bool hasWork() const { return mHead != mTail; }
-    constexpr bool hasSpace() const { return ((mHead + 1) % SIZE) != mTail; }
-    constexpr int size() const {
-        if (mHead > mTail) {
-            return mHead - mTail;
-        } else {
-            return mTail - mHead + SIZE;
-        }
-    }
-
-    constexpr void push(T&& t) {
-        int newHead = (mHead + 1) % SIZE;
-        LOG_ALWAYS_FATAL_IF(newHead == mTail, "no space");
-
-        mBuffer[mHead] = std::move(t);
-        mHead = newHead;
-    }
-
-    constexpr T pop() {
-        LOG_ALWAYS_FATAL_IF(mTail == mHead, "empty");
-        int index = mTail;
-        mTail = (mTail + 1) % SIZE;
-        T ret = std::move(mBuffer[index]);
-        mBuffer[index] = nullptr;
-        return ret;
-    }
-
-private:
-    T mBuffer[SIZE];
-    int mHead = 0;
-    int mTail = 0;
-};
-
 class CommonPool {
     PREVENT_COPY_AND_ASSIGN(CommonPool);
 
 public:
     using Task = std::function<void()>;
     static constexpr auto THREAD_COUNT = 2;
-    static constexpr auto QUEUE_SIZE = 128;
 
-    static void post(Task&& func);
+    // Tasks of a higher priority class are always started before tasks of a lower one.
+    enum class Priority {
+        // Work that a frame in flight is waiting on, such as fences and texture uploads.
+        FrameCritical = 0,
+        // Everything else: decodes, shader compiles, cache trimming, file writes.
+        Background = 1,
+    };
+    static constexpr int PRIORITY_COUNT = 2;
+
+    // Queues are unbounded, so posting never blocks. A task posted from a worker goes to that
+    // worker's own queue, which other workers steal from when they run out of work.
+    static void post(Task&& func, Priority priority = Priority::Background);
 
     template <class F>
-    static auto async(F&& func) -> std::future<decltype(func())> {
+    static auto async(F&& func, Priority priority = Priority::Background)
+            -> std::future<decltype(func())> {
         typedef std::packaged_task<decltype(func())()> task_t;
         auto task = std::make_shared<task_t>(std::forward<F>(func));
-        post([task]() { std::invoke(*task); });
+        post([task]() { std::invoke(*task); }, priority);
         return task->get_future();
     }
 
+    // The caller is blocked until `func` completes, so it always runs as frame critical.
     template <class F>
     static auto runSync(F&& func) -> decltype(func()) {
         std::packaged_task<decltype(func())()> task{std::forward<F>(func)};
-        post([&task]() { std::invoke(task); });
+        post([&task]() { std::invoke(task); }, Priority::FrameCritical);
         return task.get_future().get();
     };
 
@@ -109,17 +81,29 @@ private:
     CommonPool();
     ~CommonPool() {}
 
-    void enqueue(Task&&);
+    void enqueue(Task&&, Priority priority);
     void doWaitForIdle();
 
-    void workerLoop();
+    void workerLoop(int index);
+    bool takeTask(int index, Task* outTask);
+
+    struct Worker {
+        std::mutex lock;
+        // Owners push and pop at the back, thieves take from the front.
+        std::deque<Task> queues[PRIORITY_COUNT];
+    };
 
     std::vector<int> mWorkerThreadIds;
+    std::array<Worker, THREAD_COUNT> mWorkers;
 
+    // Guards the queues of tasks posted from outside the pool and the idle bookkeeping.
     std::mutex mLock;
     std::condition_variable mCondition;
     int mWaitingThreads = 0;
-    ArrayQueue<Task, QUEUE_SIZE> mWorkQueue;
+    std::deque<Task> mQueues[PRIORITY_COUNT];
+
+    // The number of tasks queued anywhere that have not been taken by a worker yet.
+    std::atomic<int> mPendingTasks{0};
 };
 
 }  // namespace uirenderer
@@ -15,10 +15,26 @@
  */
 
 #include <math.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "Blur.h"
 #include "MathUtils.h"
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef __ANDROID__
+#include <future>
+#include <vector>
+
+#include "thread/CommonPool.h"
+#endif
+
 namespace android {
 namespace uirenderer {
 
@@ -91,12 +107,88 @@ void Blur::generateGaussianWeights(float* weights, float radius) {
     }
 }
 
+#if defined(__ARM_NEON) || defined(__SSE2__)
+// Number of consecutive pixels of a row that blurPixels() blurs at once.
+static constexpr int32_t kSimdWidth = 4;
+
+// Blurs kSimdWidth consecutive pixels into output. taps points at the first tap of the first
+// pixel, and the taps of one pixel are tapStride bytes apart: 1 for the horizontal pass and the
+// row length for the vertical one. Either way the same tap of neighboring pixels is adjacent.
+static inline void blurPixels(const float* weights, int32_t radius, const uint8_t* taps,
+                              int32_t tapStride, uint8_t* output) {
+#if defined(__ARM_NEON)
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (int32_t r = 0; r <= 2 * radius; r++) {
+        uint32_t packed;
+        memcpy(&packed, taps + r * tapStride, sizeof(packed));
+        uint16x8_t wide = vmovl_u8(vcreate_u8(packed));
+        sum = vmlaq_n_f32(sum, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))), weights[r]);
+    }
+    uint16x4_t narrow = vqmovn_u32(vcvtq_u32_f32(sum));
+    uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+    uint32_t result = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+#else
+    const __m128i zero = _mm_setzero_si128();
+    __m128 sum = _mm_setzero_ps();
+    for (int32_t r = 0; r <= 2 * radius; r++) {
+        int32_t packed;
+        memcpy(&packed, taps + r * tapStride, sizeof(packed));
+        __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(wide), _mm_set1_ps(weights[r])));
+    }
+    __m128i ints = _mm_cvttps_epi32(sum);
+    int32_t result = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(ints, ints), zero));
+#endif
+    memcpy(output, &result, sizeof(result));
+}
+#endif
+
+// Runs blurRows(top, bottom) over all rows of the image, split into bands on the CommonPool if
+// parallel is set and the image is large enough to be worth it.
+template <typename F>
+static void forEachRowBand(int32_t width, int32_t height, bool parallel, F&& blurRows) {
+#ifdef __ANDROID__  // Layoutlib has no CommonPool
+    static constexpr int64_t kMinParallelPixels = 256 * 256;
+    static constexpr int32_t kMinBandHeight = 32;
+    int32_t bands = std::min<int32_t>(CommonPool::THREAD_COUNT + 1, height / kMinBandHeight);
+    if (parallel && bands > 1 && static_cast<int64_t>(width) * height >= kMinParallelPixels) {
+        const int32_t bandHeight = (height + bands - 1) / bands;
+        std::vector<std::future<void>> results;
+        for (int32_t top = bandHeight; top < height; top += bandHeight) {
+            const int32_t bottom = std::min(top + bandHeight, height);
+            results.push_back(CommonPool::async([&blurRows, top, bottom] { blurRows(top, bottom); },
+                                                CommonPool::Priority::FrameCritical));
+        }
+        blurRows(0, bandHeight);
+        for (auto& result : results) {
+            result.get();
+        }
+        return;
+    }
+#endif
+    blurRows(0, height);
+}
+
 void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                      int32_t width, int32_t height) {
+                      int32_t width, int32_t height, bool parallel) {
+    forEachRowBand(width, height, parallel, [&](int32_t top, int32_t bottom) {
+        horizontalRows(weights, radius, source, dest, width, top, bottom);
+    });
+}
+
+void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                    int32_t width, int32_t height, bool parallel) {
+    forEachRowBand(width, height, parallel, [&](int32_t top, int32_t bottom) {
+        verticalRows(weights, radius, source, dest, width, height, top, bottom);
+    });
+}
+
+void Blur::horizontalRows(const float* weights, int32_t radius, const uint8_t* source,
+                          uint8_t* dest, int32_t width, int32_t top, int32_t bottom) {
     float blurredPixel = 0.0f;
     float currentPixel = 0.0f;
 
-    for (int32_t y = 0; y < height; y++) {
+    for (int32_t y = top; y < bottom; y++) {
         const uint8_t* input = source + y * width;
         uint8_t* output = dest + y * width;
 
@@ -105,6 +197,14 @@ void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uin
             const float* gPtr = weights;
             // Optimization for non-border pixels
             if (x > radius && x < (width - radius)) {
+#if defined(__ARM_NEON) || defined(__SSE2__)
+                if (x + kSimdWidth <= width - radius) {
+                    blurPixels(weights, radius, input + (x - radius), 1, output);
+                    output += kSimdWidth;
+                    x += kSimdWidth - 1;
+                    continue;
+                }
+#endif
                 const uint8_t* i = input + (x - radius);
                 for (int r = -radius; r <= radius; r++) {
                     currentPixel = (float)(*i);
@@ -134,12 +234,13 @@ void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uin
     }
 }
 
-void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                    int32_t width, int32_t height) {
+void Blur::verticalRows(const float* weights, int32_t radius, const uint8_t* source,
+                        uint8_t* dest, int32_t width, int32_t height, int32_t top,
+                        int32_t bottom) {
     float blurredPixel = 0.0f;
     float currentPixel = 0.0f;
 
-    for (int32_t y = 0; y < height; y++) {
+    for (int32_t y = top; y < bottom; y++) {
         uint8_t* output = dest + y * width;
 
         for (int32_t x = 0; x < width; x++) {
@@ -149,6 +250,14 @@ void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8
             // Optimization for non-border pixels
             if (y > radius && y < (height - radius)) {
                 const uint8_t* i = input + ((y - radius) * width);
+#if defined(__ARM_NEON) || defined(__SSE2__)
+                if (x + kSimdWidth <= width) {
+                    blurPixels(weights, radius, i, width, output);
+                    output += kSimdWidth;
+                    x += kSimdWidth - 1;
+                    continue;
+                }
+#endif
                 for (int32_t r = -radius; r <= radius; r++) {
                     currentPixel = (float)(*i);
                     blurredPixel += currentPixel * gPtr[0];
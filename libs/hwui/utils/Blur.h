@@ -35,10 +35,19 @@ public:
     static uint32_t convertRadiusToInt(float radius);
 
     static void generateGaussianWeights(float* weights, float radius);
+    // The blur passes use NEON or SSE2 where available. If parallel is set, large images are
+    // split into bands of rows that are blurred on the CommonPool and the calling thread.
     static void horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                           int32_t width, int32_t height);
+                           int32_t width, int32_t height, bool parallel = false);
     static void vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                         int32_t width, int32_t height);
+                         int32_t width, int32_t height, bool parallel = false);
+
+private:
+    static void horizontalRows(const float* weights, int32_t radius, const uint8_t* source,
+                               uint8_t* dest, int32_t width, int32_t top, int32_t bottom);
+    static void verticalRows(const float* weights, int32_t radius, const uint8_t* source,
+                             uint8_t* dest, int32_t width, int32_t height, int32_t top,
+                             int32_t bottom);
 };
 
 }  // namespace uirenderer
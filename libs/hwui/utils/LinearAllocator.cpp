@@ -31,6 +31,9 @@
 #include <utils/Log.h>
 #include <utils/Macros.h>
 
+#include <mutex>
+#include <new>
+
 // The ideal size of a page allocation (these need to be multiples of 8)
 #define INITIAL_PAGE_SIZE ((size_t)512)  // 512b
 #define MAX_PAGE_SIZE ((size_t)131072)   // 128kb
@@ -72,9 +75,123 @@ static void _addAllocation(int count) {
 
 #define min(x, y) (((x) < (y)) ? (x) : (y))
 
+// Regular pages are sized INITIAL_PAGE_SIZE << n, which gives one size class per power of two up to
+// MAX_PAGE_SIZE. Only those are cached, dedicated pages are always returned to malloc.
+#define PAGE_SIZE_CLASS_COUNT 9
+
+// How much released page memory is held by each thread, and by the whole process on top of that
+#define MAX_THREAD_CACHED_BYTES ((size_t)262144)    // 256kb
+#define MAX_SHARED_CACHED_BYTES ((size_t)1048576)  // 1mb
+
 namespace android {
 namespace uirenderer {
 
+namespace {
+
+static_assert((INITIAL_PAGE_SIZE << (PAGE_SIZE_CLASS_COUNT - 1)) == MAX_PAGE_SIZE,
+              "Page size classes must cover every regular page size");
+
+int sizeClassFor(size_t pageSize) {
+    for (int i = 0; i < PAGE_SIZE_CLASS_COUNT; i++) {
+        if ((INITIAL_PAGE_SIZE << i) == pageSize) return i;
+    }
+    return -1;
+}
+
+class PageFreeList {
+public:
+    explicit PageFreeList(size_t maxBytes) : mMaxBytes(maxBytes) {}
+
+    ~PageFreeList() {
+        clear();
+        // Objects on the destroyed thread may still release pages while other thread_local
+        // destructors run, make sure they go straight back to malloc.
+        mMaxBytes = 0;
+    }
+
+    void* pop(int sizeClass) {
+        Block* block = mHeads[sizeClass];
+        if (!block) return nullptr;
+        mHeads[sizeClass] = block->next;
+        mCachedBytes -= INITIAL_PAGE_SIZE << sizeClass;
+        return block;
+    }
+
+    bool push(int sizeClass, void* buf) {
+        size_t bytes = INITIAL_PAGE_SIZE << sizeClass;
+        if (mCachedBytes + bytes > mMaxBytes) return false;
+        Block* block = new (buf) Block{mHeads[sizeClass]};
+        mHeads[sizeClass] = block;
+        mCachedBytes += bytes;
+        return true;
+    }
+
+    void clear() {
+        for (Block*& head : mHeads) {
+            while (head) {
+                Block* next = head->next;
+                free(head);
+                RM_ALLOCATION();
+                head = next;
+            }
+        }
+        mCachedBytes = 0;
+    }
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    Block* mHeads[PAGE_SIZE_CLASS_COUNT] = {};
+    size_t mCachedBytes = 0;
+    size_t mMaxBytes;
+};
+
+PageFreeList& threadPageCache() {
+    static thread_local PageFreeList sCache(MAX_THREAD_CACHED_BYTES);
+    return sCache;
+}
+
+// Lets pages released on one thread, typically the RenderThread, be picked up by allocators
+// created on another one, typically the UI thread.
+struct SharedPageCache {
+    std::mutex lock;
+    PageFreeList pages{MAX_SHARED_CACHED_BYTES};
+};
+
+SharedPageCache& sharedPageCache() {
+    // Intentionally leaked, pages may still be released while static destructors run
+    static SharedPageCache* sCache = new SharedPageCache();
+    return *sCache;
+}
+
+void* allocatePageMemory(size_t pageSize, size_t allocSize) {
+    int sizeClass = sizeClassFor(pageSize);
+    if (sizeClass >= 0) {
+        if (void* buf = threadPageCache().pop(sizeClass)) return buf;
+        SharedPageCache& shared = sharedPageCache();
+        std::lock_guard _lock{shared.lock};
+        if (void* buf = shared.pages.pop(sizeClass)) return buf;
+    }
+    ADD_ALLOCATION();
+    return malloc(allocSize);
+}
+
+void releasePageMemory(void* buf, size_t pageSize) {
+    int sizeClass = sizeClassFor(pageSize);
+    if (sizeClass >= 0) {
+        if (threadPageCache().push(sizeClass, buf)) return;
+        SharedPageCache& shared = sharedPageCache();
+        std::lock_guard _lock{shared.lock};
+        if (shared.pages.push(sizeClass, buf)) return;
+    }
+    free(buf);
+    RM_ALLOCATION();
+}
+
+}  // namespace
+
 class LinearAllocator::Page {
 public:
     Page* next() { return mNextPage; }
@@ -99,6 +216,7 @@ LinearAllocator::LinearAllocator()
         , mNext(0)
         , mCurrentPage(0)
         , mPages(0)
+        , mFirstPageSize(INITIAL_PAGE_SIZE)
         , mTotalAllocated(0)
         , mWastedSpace(0)
         , mPageCount(0)
@@ -111,13 +229,60 @@ LinearAllocator::~LinearAllocator(void) {
         node->dtor(node->addr);
     }
     Page* p = mPages;
+    size_t pageSize = mFirstPageSize;
+    while (p) {
+        Page* next = p->next();
+        freePage(p, pageSize);
+        pageSize = min(MAX_PAGE_SIZE, pageSize * 2);
+        p = next;
+    }
+    p = mDedicatedPages;
+    while (p) {
+        Page* next = p->next();
+        freePage(p, 0);
+        p = next;
+    }
+}
+
+void LinearAllocator::reset() {
+    while (mDtorList) {
+        auto node = mDtorList;
+        mDtorList = node->next;
+        node->dtor(node->addr);
+    }
+
+    // The current page is the last and largest regular page, it is mPageSize bytes large
+    Page* keep = mCurrentPage;
+    Page* p = mPages;
+    size_t pageSize = mFirstPageSize;
+    while (p != keep) {
+        Page* next = p->next();
+        freePage(p, pageSize);
+        pageSize = min(MAX_PAGE_SIZE, pageSize * 2);
+        p = next;
+    }
+    p = mDedicatedPages;
     while (p) {
         Page* next = p->next();
-        p->~Page();
-        free(p);
-        RM_ALLOCATION();
+        freePage(p, 0);
         p = next;
     }
+
+    mPages = keep;
+    mDedicatedPages = nullptr;
+    mDedicatedPageCount = 0;
+    if (keep) {
+        mFirstPageSize = mPageSize;
+        mNext = start(keep);
+        mTotalAllocated = ALIGN(mPageSize + sizeof(Page));
+        mWastedSpace = mPageSize;
+        mPageCount = 1;
+    } else {
+        mNext = 0;
+        mTotalAllocated = 0;
+        mWastedSpace = 0;
+        mPageCount = 0;
+    }
 }
 
 void* LinearAllocator::start(Page* p) {
@@ -159,9 +324,8 @@ void* LinearAllocator::allocImpl(size_t size) {
         // Allocation is too large, create a dedicated page for the allocation
         Page* page = newPage(size);
         mDedicatedPageCount++;
-        page->setNext(mPages);
-        mPages = page;
-        if (!mCurrentPage) mCurrentPage = mPages;
+        page->setNext(mDedicatedPages);
+        mDedicatedPages = page;
         return start(page);
     }
     ensureNext(size);
@@ -217,14 +381,25 @@ void LinearAllocator::rewindIfLastAlloc(void* ptr, size_t allocSize) {
 }
 
 LinearAllocator::Page* LinearAllocator::newPage(size_t pageSize) {
-    pageSize = ALIGN(pageSize + sizeof(LinearAllocator::Page));
-    ADD_ALLOCATION();
-    mTotalAllocated += pageSize;
+    size_t allocSize = ALIGN(pageSize + sizeof(LinearAllocator::Page));
+    mTotalAllocated += allocSize;
     mPageCount++;
-    void* buf = malloc(pageSize);
+    void* buf = allocatePageMemory(pageSize, allocSize);
     return new (buf) Page();
 }
 
+void LinearAllocator::freePage(Page* p, size_t pageSize) {
+    p->~Page();
+    releasePageMemory(p, pageSize);
+}
+
+void LinearAllocator::trimPageCache() {
+    threadPageCache().clear();
+    SharedPageCache& shared = sharedPageCache();
+    std::lock_guard _lock{shared.lock};
+    shared.pages.clear();
+}
+
 static const char* toSize(size_t value, float& result) {
     if (value < 2000) {
         result = value;
@@ -105,6 +105,14 @@ public:
         rewindIfLastAlloc((void*)ptr, sizeof(T));
     }
 
+    /**
+     * Runs the destructors of every object created by this allocator and makes its memory
+     * available for new allocations. The page most recently allocated for small objects, which is
+     * also the largest, is kept so that an allocator that is filled again with a similar amount of
+     * data does not have to go back to malloc. Every other page is freed.
+     */
+    void reset();
+
     /**
      * Dump memory usage statistics to the log (allocated and wasted space)
      */
@@ -117,6 +125,14 @@ public:
     size_t usedSize() const { return mTotalAllocated - mWastedSpace; }
     size_t allocatedSize() const { return mTotalAllocated; }
 
+    /**
+     * Pages released by any LinearAllocator are kept in a small per-thread cache, backed by a
+     * bounded process-wide cache, so that allocators created and destroyed at a high rate do not
+     * keep going back to malloc. This releases the process-wide cache and the cache of the calling
+     * thread.
+     */
+    static void trimPageCache();
+
 private:
     LinearAllocator(const LinearAllocator& other);
 
@@ -133,6 +149,7 @@ private:
     void addToDestructionList(Destructor, void* addr);
     void runDestructorFor(void* addr);
     Page* newPage(size_t pageSize);
+    void freePage(Page* p, size_t pageSize);
     bool fitsInCurrentPage(size_t size);
     void ensureNext(size_t size);
     void* start(Page* p);
@@ -142,7 +159,12 @@ private:
     size_t mMaxAllocSize;
     void* mNext;
     Page* mCurrentPage;
+    // Regular pages in allocation order. The first one is mFirstPageSize bytes large and every
+    // following one is twice the size of the previous one, up to the maximum page size.
     Page* mPages;
+    size_t mFirstPageSize;
+    // Pages holding a single allocation that was too large for a regular page
+    Page* mDedicatedPages = nullptr;
     DestructorNode* mDtorList = nullptr;
 
     // Memory usage tracking
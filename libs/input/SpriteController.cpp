@@ -23,6 +23,11 @@
 #include <utils/String8.h>
 #include <gui/Surface.h>
 
+namespace {
+// The number of events to be read at once for DisplayEventReceiver.
+const int EVENT_BUFFER_SIZE = 100;
+} // namespace
+
 namespace android {
 
 // --- SpriteController ---
@@ -35,10 +40,15 @@ SpriteController::SpriteController(const sp<Looper>& looper, int32_t overlayLaye
     mHandler = new WeakMessageHandler(this);
     mLocked.transactionNestingCount = 0;
     mLocked.deferredSpriteUpdate = false;
+    mLocked.displayEventReceiverInitialized = false;
+    mLocked.vsyncRequested = false;
 }
 
 SpriteController::~SpriteController() {
     mLooper->removeMessages(mHandler);
+    if (mLocked.displayEventReceiver != nullptr) {
+        mLooper->removeFd(mLocked.displayEventReceiver->getFd());
+    }
 
     if (mSurfaceComposerClient != NULL) {
         mSurfaceComposerClient->dispose();
@@ -65,7 +75,7 @@ void SpriteController::closeTransaction() {
     mLocked.transactionNestingCount -= 1;
     if (mLocked.transactionNestingCount == 0 && mLocked.deferredSpriteUpdate) {
         mLocked.deferredSpriteUpdate = false;
-        mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
+        requestUpdateLocked();
     }
 }
 
@@ -76,9 +86,78 @@ void SpriteController::invalidateSpriteLocked(const sp<SpriteImpl>& sprite) {
         if (mLocked.transactionNestingCount != 0) {
             mLocked.deferredSpriteUpdate = true;
         } else {
+            requestUpdateLocked();
+        }
+    }
+}
+
+void SpriteController::requestUpdateLocked() {
+    if (!mLocked.displayEventReceiverInitialized) {
+        mLocked.displayEventReceiverInitialized = true;
+        auto receiver = std::make_unique<DisplayEventReceiver>();
+        if (receiver->initCheck() == NO_ERROR) {
+            mLooper->addFd(receiver->getFd(), Looper::POLL_CALLBACK, Looper::EVENT_INPUT,
+                           sp<VsyncCallback>::make(this), nullptr);
+            mLocked.displayEventReceiver = std::move(receiver);
+        } else {
+            ALOGE("Failed to initialize DisplayEventReceiver, updating sprites without vsync.");
+        }
+    }
+
+    if (mLocked.displayEventReceiver == nullptr) {
+        mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
+    } else if (!mLocked.vsyncRequested) {
+        mLocked.vsyncRequested = true;
+        mLocked.displayEventReceiver->requestNextVsync();
+    }
+}
+
+int SpriteController::VsyncCallback::handleEvent(int /* fd */, int events, void* /* data */) {
+    sp<SpriteController> controller = mController.promote();
+    if (controller == nullptr) {
+        return 0; // Remove the callback, the SpriteController is gone anyways
+    }
+    return controller->handleDisplayEvents(events);
+}
+
+int SpriteController::handleDisplayEvents(int events) {
+    if (events & (Looper::EVENT_ERROR | Looper::EVENT_HANGUP)) {
+        ALOGE("Display event receiver pipe was closed or an error occurred.  events=0x%x", events);
+        AutoMutex _l(mLock);
+        mLocked.displayEventReceiver.reset();
+        if (!mLocked.invalidatedSprites.empty()) {
             mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
         }
+        return 0; // remove the callback
     }
+
+    if (!(events & Looper::EVENT_INPUT)) {
+        ALOGW("Received spurious callback for unhandled poll event.  events=0x%x", events);
+        return 1; // keep the callback
+    }
+
+    bool gotVsync = false;
+    { // acquire lock
+        AutoMutex _l(mLock);
+
+        DisplayEventReceiver::Event buf[EVENT_BUFFER_SIZE];
+        ssize_t n;
+        while ((n = mLocked.displayEventReceiver->getEvents(buf, EVENT_BUFFER_SIZE)) > 0) {
+            for (size_t i = 0; i < static_cast<size_t>(n); ++i) {
+                if (buf[i].header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+                    gotVsync = true;
+                }
+            }
+        }
+        if (gotVsync) {
+            mLocked.vsyncRequested = false;
+        }
+    } // release lock
+
+    if (gotVsync) {
+        doUpdateSprites();
+    }
+    return 1; // keep the callback
 }
 
 void SpriteController::disposeSurfaceLocked(const sp<SurfaceControl>& surfaceControl) {
@@ -140,48 +219,21 @@ void SpriteController::doUpdateSprites() {
         }
     }
 
-    // Resize and/or reparent sprites if needed.
+    // All the changes of this update, to every display, go in this one transaction. The buffer of
+    // a surface sets its size, so surfaces are never resized first.
     SurfaceComposerClient::Transaction t;
     bool needApplyTransaction = false;
+
+    // Reparent sprites and give them the buffer of their icon if needed, drawn only the first
+    // time it is shown.
     for (size_t i = 0; i < numSprites; i++) {
         SpriteUpdate& update = updates.editItemAt(i);
-        if (update.state.surfaceControl == nullptr) {
-            continue;
-        }
-
-        if (update.state.wantSurfaceVisible()) {
-            int32_t desiredWidth = update.state.icon.width();
-            int32_t desiredHeight = update.state.icon.height();
-            if (update.state.surfaceWidth < desiredWidth
-                    || update.state.surfaceHeight < desiredHeight) {
-                needApplyTransaction = true;
-
-                update.state.surfaceControl->updateDefaultBufferSize(desiredWidth, desiredHeight);
-                update.state.surfaceWidth = desiredWidth;
-                update.state.surfaceHeight = desiredHeight;
-                update.state.surfaceDrawn = false;
-                update.surfaceChanged = surfaceChanged = true;
-
-                if (update.state.surfaceVisible) {
-                    t.hide(update.state.surfaceControl);
-                    update.state.surfaceVisible = false;
-                }
-            }
-        }
 
         // If surface has changed to a new display, we have to reparent it.
-        if (update.state.dirty & DIRTY_DISPLAY_ID) {
+        if (update.state.surfaceControl != nullptr && (update.state.dirty & DIRTY_DISPLAY_ID)) {
             t.reparent(update.state.surfaceControl, mParentSurfaceProvider(update.state.displayId));
             needApplyTransaction = true;
         }
-    }
-    if (needApplyTransaction) {
-        t.apply();
-    }
-
-    // Redraw sprites if needed.
-    for (size_t i = 0; i < numSprites; i++) {
-        SpriteUpdate& update = updates.editItemAt(i);
 
         if ((update.state.dirty & DIRTY_BITMAP) && update.state.surfaceDrawn) {
             update.state.surfaceDrawn = false;
@@ -190,15 +242,19 @@ void SpriteController::doUpdateSprites() {
 
         if (update.state.surfaceControl != NULL && !update.state.surfaceDrawn
                 && update.state.wantSurfaceVisible()) {
-            sp<Surface> surface = update.state.surfaceControl->getSurface();
-            if (update.state.icon.draw(surface)) {
+            sp<GraphicBuffer> buffer = obtainIconBuffer(update.state.icon);
+            if (buffer != nullptr) {
+                t.setBuffer(update.state.surfaceControl, buffer);
+                t.setDataspace(update.state.surfaceControl, ui::Dataspace::V0_SRGB);
+                needApplyTransaction = true;
+                update.state.surfaceWidth = update.state.icon.width();
+                update.state.surfaceHeight = update.state.icon.height();
                 update.state.surfaceDrawn = true;
                 update.surfaceChanged = surfaceChanged = true;
             }
         }
     }
 
-    needApplyTransaction = false;
     for (size_t i = 0; i < numSprites; i++) {
         SpriteUpdate& update = updates.editItemAt(i);
 
@@ -331,6 +387,48 @@ void SpriteController::ensureSurfaceComposerClient() {
     }
 }
 
+graphics::Bitmap SpriteController::getIconBitmapLocked(const graphics::Bitmap& bitmap) {
+    auto it = mLocked.iconBitmaps.find(bitmap.get());
+    if (it != mLocked.iconBitmaps.end()) {
+        return it->second.copy;
+    }
+
+    if (mLocked.iconBitmaps.size() >= MAX_CACHED_ICONS) {
+        mLocked.iconBitmaps.clear();
+    }
+    graphics::Bitmap copy = bitmap.copy(ANDROID_BITMAP_FORMAT_RGBA_8888);
+    mLocked.iconBitmaps[bitmap.get()] = {bitmap, copy};
+    return copy;
+}
+
+sp<GraphicBuffer> SpriteController::obtainIconBuffer(const SpriteIcon& icon) {
+    { // acquire lock
+        AutoMutex _l(mLock);
+
+        auto it = mLocked.iconBuffers.find(icon.bitmap.get());
+        if (it != mLocked.iconBuffers.end()) {
+            return it->second.buffer;
+        }
+    } // release lock
+
+    sp<GraphicBuffer> buffer = icon.drawToBuffer();
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+
+    // Release the evicted buffers outside of the lock.
+    std::unordered_map<ABitmap*, IconBuffer> evictedBuffers;
+    { // acquire lock
+        AutoMutex _l(mLock);
+
+        if (mLocked.iconBuffers.size() >= MAX_CACHED_ICONS) {
+            std::swap(evictedBuffers, mLocked.iconBuffers);
+        }
+        mLocked.iconBuffers[icon.bitmap.get()] = {icon.bitmap, buffer};
+    } // release lock
+    return buffer;
+}
+
 sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height,
                                                    int32_t displayId) {
     ensureSurfaceComposerClient();
@@ -340,11 +438,12 @@ sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height
         ALOGE("Failed to get the parent surface for pointers on display %d", displayId);
     }
 
+    // The icon buffers are set on the surface directly, without a buffer queue.
+    const uint32_t flags = ISurfaceComposerClient::eHidden | ISurfaceComposerClient::eCursorWindow |
+            ISurfaceComposerClient::eFXSurfaceBufferState;
     const sp<SurfaceControl> surfaceControl =
             mSurfaceComposerClient->createSurface(String8("Sprite"), width, height,
-                                                  PIXEL_FORMAT_RGBA_8888,
-                                                  ISurfaceComposerClient::eHidden |
-                                                          ISurfaceComposerClient::eCursorWindow,
+                                                  PIXEL_FORMAT_RGBA_8888, flags,
                                                   parent ? parent->getHandle() : nullptr);
     if (surfaceControl == nullptr || !surfaceControl->isValid()) {
         ALOGE("Error creating sprite surface.");
@@ -375,21 +474,24 @@ void SpriteController::SpriteImpl::setIcon(const SpriteIcon& icon) {
 
     uint32_t dirty;
     if (icon.isValid()) {
-        mLocked.state.icon.bitmap = icon.bitmap.copy(ANDROID_BITMAP_FORMAT_RGBA_8888);
-        if (!mLocked.state.icon.isValid()
-                || mLocked.state.icon.hotSpotX != icon.hotSpotX
+        // Icons set again, such as the frames of an animation, share their copy and its buffer.
+        graphics::Bitmap bitmap = mController->getIconBitmapLocked(icon.bitmap);
+        dirty = bitmap.get() != mLocked.state.icon.bitmap.get() ? DIRTY_BITMAP : 0;
+        mLocked.state.icon.bitmap = std::move(bitmap);
+        if (mLocked.state.icon.hotSpotX != icon.hotSpotX
                 || mLocked.state.icon.hotSpotY != icon.hotSpotY) {
             mLocked.state.icon.hotSpotX = icon.hotSpotX;
             mLocked.state.icon.hotSpotY = icon.hotSpotY;
-            dirty = DIRTY_BITMAP | DIRTY_HOTSPOT;
-        } else {
-            dirty = DIRTY_BITMAP;
+            dirty |= DIRTY_HOTSPOT;
         }
 
         if (mLocked.state.icon.style != icon.style) {
             mLocked.state.icon.style = icon.style;
             dirty |= DIRTY_ICON_STYLE;
         }
+        if (dirty == 0) {
+            return; // same icon as before so nothing to do
+        }
     } else if (mLocked.state.icon.isValid()) {
         mLocked.state.icon.bitmap.reset();
         dirty = DIRTY_BITMAP | DIRTY_HOTSPOT | DIRTY_ICON_STYLE;
@@ -20,8 +20,12 @@
 #include <utils/RefBase.h>
 #include <utils/Looper.h>
 
+#include <gui/DisplayEventReceiver.h>
 #include <gui/SurfaceComposerClient.h>
 
+#include <memory>
+#include <unordered_map>
+
 #include "SpriteIcon.h"
 
 namespace android {
@@ -105,7 +109,8 @@ public:
  * spot representations of fingers.  It is not intended for general purpose use
  * by other components.
  *
- * All sprite position updates and rendering is performed asynchronously.
+ * All sprite position updates and rendering is performed asynchronously, at most once per
+ * vsync and in a single transaction, however many sprites changed in between.
  *
  * Clients are responsible for animating sprites by periodically updating their properties.
  */
@@ -229,6 +234,34 @@ private:
         void invalidateLocked(uint32_t dirty);
     };
 
+    /* The bitmap of an icon given to setIcon() and the copy of it that the sprites share. */
+    struct IconBitmap {
+        graphics::Bitmap source;
+        graphics::Bitmap copy;
+    };
+
+    /* A shared icon bitmap and the buffer it was drawn into, which the sprites showing it are
+     * given instead of being drawn again. */
+    struct IconBuffer {
+        graphics::Bitmap bitmap;
+        sp<GraphicBuffer> buffer;
+    };
+
+    /* Plenty for the pointer icons of a display, including the frames of animated ones. */
+    static constexpr size_t MAX_CACHED_ICONS = 64;
+
+    /* Updates the sprites on the vsyncs it requested. Holds the controller weakly, as the
+     * looper holds the callback. */
+    class VsyncCallback : public LooperCallback {
+    public:
+        explicit VsyncCallback(const wp<SpriteController>& controller)
+              : mController(controller) {}
+        int handleEvent(int fd, int events, void* data) override;
+
+    private:
+        wp<SpriteController> mController;
+    };
+
     /* Stores temporary information collected during the sprite update cycle. */
     struct SpriteUpdate {
         inline SpriteUpdate() : surfaceChanged(false) { }
@@ -255,12 +288,26 @@ private:
         std::vector<sp<SurfaceControl>> disposedSurfaces;
         uint32_t transactionNestingCount;
         bool deferredSpriteUpdate;
+        // Created on the first update, so that controllers never updated don't connect to
+        // SurfaceFlinger; null if that failed, and sprites are then updated right away.
+        std::unique_ptr<DisplayEventReceiver> displayEventReceiver;
+        bool displayEventReceiverInitialized;
+        bool vsyncRequested;
+        // Keyed by the source bitmap, which the entry keeps alive.
+        std::unordered_map<ABitmap*, IconBitmap> iconBitmaps;
+        // Keyed by the shared copy, which the entry keeps alive.
+        std::unordered_map<ABitmap*, IconBuffer> iconBuffers;
     } mLocked; // guarded by mLock
 
+    graphics::Bitmap getIconBitmapLocked(const graphics::Bitmap& bitmap);
+    sp<GraphicBuffer> obtainIconBuffer(const SpriteIcon& icon);
+
     void invalidateSpriteLocked(const sp<SpriteImpl>& sprite);
+    void requestUpdateLocked();
     void disposeSurfaceLocked(const sp<SurfaceControl>& surfaceControl);
 
     void handleMessage(const Message& message);
+    int handleDisplayEvents(int events);
     void doUpdateSprites();
     void doDisposeSurfaces();
 
@@ -24,22 +24,16 @@
 
 namespace android {
 
-bool SpriteIcon::draw(sp<Surface> surface) const {
-    ANativeWindow_Buffer outBuffer;
-    status_t status = surface->lock(&outBuffer, NULL);
-    if (status) {
-        ALOGE("Error %d locking sprite surface before drawing.", status);
-        return false;
-    }
-
+static void drawIcon(const SpriteIcon& icon, const ANativeWindow_Buffer& outBuffer,
+                     int32_t dataSpace) {
     graphics::Paint paint;
     paint.setBlendMode(ABLEND_MODE_SRC);
 
-    graphics::Canvas canvas(outBuffer, (int32_t)surface->getBuffersDataSpace());
-    canvas.drawBitmap(bitmap, 0, 0, &paint);
+    graphics::Canvas canvas(outBuffer, dataSpace);
+    canvas.drawBitmap(icon.bitmap, 0, 0, &paint);
 
-    const int iconWidth = width();
-    const int iconHeight = height();
+    const int iconWidth = icon.width();
+    const int iconHeight = icon.height();
 
     if (outBuffer.width > iconWidth) {
         paint.setBlendMode(ABLEND_MODE_CLEAR); // clear to transparent
@@ -49,12 +43,40 @@ bool SpriteIcon::draw(sp<Surface> surface) const {
         paint.setBlendMode(ABLEND_MODE_CLEAR); // clear to transparent
         canvas.drawRect({0, iconHeight, outBuffer.width, outBuffer.height}, paint);
     }
+}
+
+sp<GraphicBuffer> SpriteIcon::drawToBuffer() const {
+    sp<GraphicBuffer> buffer =
+            sp<GraphicBuffer>::make(static_cast<uint32_t>(width()),
+                                    static_cast<uint32_t>(height()), PIXEL_FORMAT_RGBA_8888, 1,
+                                    GraphicBuffer::USAGE_SW_WRITE_OFTEN |
+                                            GraphicBuffer::USAGE_HW_TEXTURE |
+                                            GraphicBuffer::USAGE_HW_COMPOSER,
+                                    "SpriteIcon");
+    if (buffer->initCheck() != OK) {
+        ALOGE("Error %d allocating sprite buffer.", buffer->initCheck());
+        return nullptr;
+    }
+
+    ANativeWindow_Buffer outBuffer;
+    status_t status = buffer->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, &outBuffer.bits);
+    if (status) {
+        ALOGE("Error %d locking sprite buffer before drawing.", status);
+        return nullptr;
+    }
+    outBuffer.width = buffer->getWidth();
+    outBuffer.height = buffer->getHeight();
+    outBuffer.stride = buffer->getStride();
+    outBuffer.format = buffer->getPixelFormat();
+
+    drawIcon(*this, outBuffer, ADATASPACE_SRGB);
 
-    status = surface->unlockAndPost();
+    status = buffer->unlock();
     if (status) {
-        ALOGE("Error %d unlocking and posting sprite surface after drawing.", status);
+        ALOGE("Error %d unlocking sprite buffer after drawing.", status);
+        return nullptr;
     }
-    return !status;
+    return buffer;
 }
 
 } // namespace android
@@ -18,8 +18,8 @@
 #define _UI_SPRITE_ICON_H
 
 #include <android/graphics/bitmap.h>
-#include <gui/Surface.h>
 #include <input/Input.h>
+#include <ui/GraphicBuffer.h>
 
 namespace android {
 
@@ -53,9 +53,9 @@ struct SpriteIcon {
     inline int32_t width() const { return bitmap.getInfo().width; }
     inline int32_t height() const { return bitmap.getInfo().height; }
 
-    // Draw the bitmap onto the given surface. Returns true if it's successful, or false otherwise.
-    // Note it doesn't set any metadata to the surface.
-    bool draw(const sp<Surface> surface) const;
+    // Draw the bitmap into a new sRGB buffer of its size, which a surface can then show any number
+    // of times without drawing again. Returns nullptr on failure.
+    sp<GraphicBuffer> drawToBuffer() const;
 };
 
 } // namespace android
@@ -23,6 +23,7 @@
 #include <utils/RefBase.h>
 
 #include <stdint.h>
+#include <functional>
 #include <vector>
 
 namespace android {
@@ -46,6 +47,30 @@ public:
     explicit EncodedBuffer(size_t chunkSize);
     virtual ~EncodedBuffer();
 
+    /**
+     * Creates a buffer that reads the given memory, e.g. a mapped file, instead of a copy of it.
+     * The buffer can't be written to. release(data, size) is called when it is destroyed.
+     */
+    static sp<EncodedBuffer> adopt(uint8_t* data, size_t size,
+                                   std::function<void(uint8_t*, size_t)> release);
+
+    /**
+     * The chunks of destroyed buffers are kept in a process-wide pool and reused by new
+     * buffers with the same chunk size, up to a limit of pooled bytes over all chunk sizes.
+     * The limit is 256 KB unless set otherwise; 0 turns pooling off.
+     */
+    static void setChunkPoolLimit(size_t bytes);
+
+    /**
+     * Returns how many bytes of chunks are in the pool.
+     */
+    static size_t chunkPoolSize();
+
+    /**
+     * Unmaps the chunks in the pool.
+     */
+    static void clearChunkPool();
+
     class Pointer {
     public:
         Pointer();
@@ -200,6 +225,8 @@ private:
         virtual uint8_t next();
         virtual uint64_t readRawVarint();
         virtual void move(size_t amt);
+        // The views stay valid until the EncodedBuffer is cleared or edited.
+        virtual bool readSpans(size_t size, std::vector<ProtoSpan>* spans);
 
     private:
         const sp<EncodedBuffer> mData;
@@ -210,6 +237,10 @@ private:
     size_t mChunkSize;
     std::vector<uint8_t*> mBuffers;
 
+    // Set for adopted memory, which is released with this instead of being pooled.
+    std::function<void(uint8_t*, size_t)> mRelease;
+    size_t mAdoptedSize;
+
     Pointer mWp;
     Pointer mEp;
 
@@ -18,10 +18,14 @@
 #define ANDROID_UTIL_PROTOOUTPUT_STREAM_H
 
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include <android/util/EncodedBuffer.h>
+#include <android/util/protobuf.h>
 
 namespace android {
 namespace util {
@@ -77,6 +81,43 @@ const uint64_t FIELD_COUNT_SINGLE = 1ULL << FIELD_COUNT_SHIFT;
 const uint64_t FIELD_COUNT_REPEATED = 2ULL << FIELD_COUNT_SHIFT;
 const uint64_t FIELD_COUNT_PACKED = 5ULL << FIELD_COUNT_SHIFT;
 
+//
+// The privacy dest of a field without an android.privacy option, see
+// frameworks/base/core/proto/android/privacy.proto.
+//
+const uint8_t PRIVACY_DEST_UNSET = 255;
+
+/**
+ * Describes a field of a message. protoc-gen-cppstream generates a _FIELD_DESCRIPTORS table of
+ * these next to the field ids, so code can look fields up without parsing the ids at run time.
+ */
+struct ProtoFieldDescriptor {
+    uint64_t fieldId;    // The generated field id, which has the type and count of the field.
+    uint8_t wireType;    // One of the WIRE_TYPE_* values the field is written with.
+    uint8_t privacyDest; // The dest of its android.privacy option, or PRIVACY_DEST_UNSET.
+
+    constexpr uint32_t number() const { return (uint32_t)fieldId; }
+    constexpr uint64_t type() const { return fieldId & FIELD_TYPE_MASK; }
+    constexpr bool repeated() const {
+        return (fieldId & FIELD_COUNT_MASK) == FIELD_COUNT_REPEATED
+                || (fieldId & FIELD_COUNT_MASK) == FIELD_COUNT_PACKED;
+    }
+};
+
+/**
+ * Returns the field with the given number in a generated descriptor table, or nullptr.
+ */
+template <size_t N>
+constexpr const ProtoFieldDescriptor* find_field(const ProtoFieldDescriptor (&fields)[N],
+                                                 uint32_t number) {
+    for (size_t i = 0; i < N; i++) {
+        if (fields[i].number() == number) {
+            return &fields[i];
+        }
+    }
+    return nullptr;
+}
+
 /**
  * Class to write to a protobuf stream.
  *
@@ -105,6 +146,14 @@ public:
     bool write(uint64_t fieldId, std::string val);
     bool write(uint64_t fieldId, const char* val, size_t size);
 
+    /**
+     * Writes a field whose id is known when compiling, e.g. a generated field constant. Whether
+     * the value fits the type of the field is checked by the compiler, and the value is encoded
+     * without looking the type up at run time. The bytes written are the same as write().
+     */
+    template <uint64_t fieldId, typename T>
+    bool write(const T& val);
+
     /**
      * Starts a sub-message write session.
      * Returns a token of this write session.
@@ -136,12 +185,16 @@ public:
 
     // Please don't use the following functions to dump protos unless you are familiar with protobuf encoding.
     void writeRawVarint(uint64_t varint);
+    // Length delimited fields whose size is known, like this one and strings, are written in their
+    // final encoding until the first start(), so a stream made only of them needs no compaction.
     void writeLengthDelimitedHeader(uint32_t id, size_t size);
     void writeRawByte(uint8_t byte);
+    void writeRaw(uint8_t const* buf, size_t size);
 
 private:
     sp<EncodedBuffer> mBuffer;
     size_t mCopyBegin;
+    size_t mCompactBegin; // Where the first message size placeholder is, or SIZE_MAX if none.
     bool mCompact;
     uint32_t mDepth;
     uint32_t mObjectId;
@@ -172,6 +225,67 @@ private:
     bool internalWrite(uint64_t fieldId, T val, const char* typeName);
 };
 
+template <uint64_t fieldId, typename T>
+bool
+ProtoOutputStream::write(const T& val)
+{
+    constexpr uint64_t type = fieldId & FIELD_TYPE_MASK;
+    constexpr uint32_t id = (uint32_t)fieldId;
+    if (mCompact) return false;
+
+    if constexpr (type == FIELD_TYPE_STRING || type == FIELD_TYPE_BYTES
+            || type == FIELD_TYPE_MESSAGE) {
+        static_assert(std::is_convertible_v<const T&, std::string_view>,
+                "strings, bytes and message bytes are written from text");
+        const std::string_view bytes = val;
+        writeLengthDelimitedHeader(id, bytes.size());
+        mBuffer->writeRaw(reinterpret_cast<uint8_t const*>(bytes.data()), bytes.size());
+    } else {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>,
+                "numeric fields are written from numbers or enums");
+        if constexpr (type == FIELD_TYPE_DOUBLE) {
+            const double d = (double)val;
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            mBuffer->writeHeader(id, WIRE_TYPE_FIXED64);
+            mBuffer->writeRawFixed64(bits);
+        } else if constexpr (type == FIELD_TYPE_FLOAT) {
+            const float f = (float)val;
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            mBuffer->writeHeader(id, WIRE_TYPE_FIXED32);
+            mBuffer->writeRawFixed32(bits);
+        } else if constexpr (type == FIELD_TYPE_INT64 || type == FIELD_TYPE_UINT64) {
+            mBuffer->writeHeader(id, WIRE_TYPE_VARINT);
+            mBuffer->writeRawVarint64((uint64_t)val);
+        } else if constexpr (type == FIELD_TYPE_INT32 || type == FIELD_TYPE_UINT32
+                || type == FIELD_TYPE_ENUM) {
+            mBuffer->writeHeader(id, WIRE_TYPE_VARINT);
+            mBuffer->writeRawVarint32((uint32_t)val);
+        } else if constexpr (type == FIELD_TYPE_BOOL) {
+            mBuffer->writeHeader(id, WIRE_TYPE_VARINT);
+            mBuffer->writeRawVarint32(val ? 1 : 0);
+        } else if constexpr (type == FIELD_TYPE_FIXED64 || type == FIELD_TYPE_SFIXED64) {
+            mBuffer->writeHeader(id, WIRE_TYPE_FIXED64);
+            mBuffer->writeRawFixed64((uint64_t)val);
+        } else if constexpr (type == FIELD_TYPE_FIXED32 || type == FIELD_TYPE_SFIXED32) {
+            mBuffer->writeHeader(id, WIRE_TYPE_FIXED32);
+            mBuffer->writeRawFixed32((uint32_t)val);
+        } else if constexpr (type == FIELD_TYPE_SINT64) {
+            const int64_t v = (int64_t)val;
+            mBuffer->writeHeader(id, WIRE_TYPE_VARINT);
+            mBuffer->writeRawVarint64(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+        } else if constexpr (type == FIELD_TYPE_SINT32) {
+            const int32_t v = (int32_t)val;
+            mBuffer->writeHeader(id, WIRE_TYPE_VARINT);
+            mBuffer->writeRawVarint32(((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+        } else {
+            static_assert(type != type, "the field type can't be written");
+        }
+    }
+    return true;
+}
+
 }
 }
 
@@ -25,6 +25,14 @@
 namespace android {
 namespace util {
 
+/**
+ * A contiguous run of bytes in the buffer of a ProtoReader.
+ */
+struct ProtoSpan {
+    uint8_t const* data;
+    size_t size;
+};
+
 class ProtoReader : public virtual RefBase {
 public:
     ProtoReader();
@@ -70,6 +78,15 @@ public:
      * Advance the read pointer.
      */
     virtual void move(size_t amt) = 0;
+
+    /**
+     * Appends views of the next size bytes to spans, one per contiguous run, and moves past them.
+     * Returns false without reading anything if the bytes can't be viewed at once, in which case
+     * they have to be read with next() or readBuffer() instead.
+     * The views are only valid until the reader reads further, unless the reader is documented
+     * otherwise. By default only a run in the current read buffer can be viewed.
+     */
+    virtual bool readSpans(size_t size, std::vector<ProtoSpan>* spans);
 };
 
 } // util
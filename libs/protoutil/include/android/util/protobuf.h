@@ -30,6 +30,9 @@ const uint8_t WIRE_TYPE_FIXED64 = 1;
 const uint8_t WIRE_TYPE_LENGTH_DELIMITED = 2;
 const uint8_t WIRE_TYPE_FIXED32 = 5;
 
+// The most bytes a varint of a 64 bit value takes.
+const size_t MAX_VARINT_SIZE = 10;
+
 /**
  * Read the wire type from varint, it is the smallest 3 bits.
  */
@@ -51,6 +54,12 @@ size_t get_varint_size(uint64_t varint);
  */
 uint8_t* write_raw_varint(uint8_t* buf, uint64_t val);
 
+/**
+ * Read a varint from the buffer. Return the next position to read at.
+ * There must be 10 bytes in the buffer, or the varint must be terminated before its end.
+ */
+uint8_t const* read_raw_varint(uint8_t const* buf, uint64_t* val);
+
 /**
  * Write a protobuf WIRE_TYPE_LENGTH_DELIMITED header. Return the next position
  * to write at. There must be 20 bytes in the buffer.
@@ -18,6 +18,9 @@
 #include <stdlib.h>
 #include <sys/mman.h>
 
+#include <map>
+#include <mutex>
+
 #include <android/util/EncodedBuffer.h>
 #include <android/util/protobuf.h>
 #include <cutils/log.h>
@@ -26,6 +29,98 @@ namespace android {
 namespace util {
 
 const size_t BUFFER_SIZE = 8 * 1024; // 8 KB
+const size_t DEFAULT_CHUNK_POOL_LIMIT = 256 * 1024; // 256 KB
+
+// ===========================================================
+/**
+ * Unused chunks, by chunk size. Buffers are created and destroyed a lot while dumping, e.g. one
+ * per section by incidentd, and mapping and unmapping their chunks each time was a large part
+ * of the cost of small writes.
+ */
+struct ChunkPool {
+    std::mutex lock;
+    std::map<size_t, std::vector<uint8_t*>> chunks;
+    size_t bytes = 0;
+    size_t limit = DEFAULT_CHUNK_POOL_LIMIT;
+};
+
+static ChunkPool& chunk_pool()
+{
+    static ChunkPool* pool = new ChunkPool();
+    return *pool;
+}
+
+static uint8_t* allocate_chunk(size_t chunkSize)
+{
+    ChunkPool& pool = chunk_pool();
+    {
+        std::scoped_lock<std::mutex> lock(pool.lock);
+        auto it = pool.chunks.find(chunkSize);
+        if (it != pool.chunks.end() && !it->second.empty()) {
+            uint8_t* chunk = it->second.back();
+            it->second.pop_back();
+            pool.bytes -= chunkSize;
+            return chunk;
+        }
+    }
+    // Use mmap instead of malloc to ensure memory alignment i.e. no fragmentation so that
+    // the mem region can be immediately reused by the allocator after calling munmap()
+    void* chunk = mmap(NULL, chunkSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+    return chunk == MAP_FAILED ? NULL : (uint8_t*)chunk;
+}
+
+static void release_chunk(uint8_t* chunk, size_t chunkSize)
+{
+    ChunkPool& pool = chunk_pool();
+    {
+        std::scoped_lock<std::mutex> lock(pool.lock);
+        if (pool.bytes + chunkSize <= pool.limit) {
+            pool.chunks[chunkSize].push_back(chunk);
+            pool.bytes += chunkSize;
+            return;
+        }
+    }
+    munmap(chunk, chunkSize);
+}
+
+void
+EncodedBuffer::setChunkPoolLimit(size_t bytes)
+{
+    ChunkPool& pool = chunk_pool();
+    std::scoped_lock<std::mutex> lock(pool.lock);
+    pool.limit = bytes;
+    // Drop chunks, largest first, until the pool fits.
+    for (auto it = pool.chunks.rbegin(); it != pool.chunks.rend() && pool.bytes > pool.limit;
+            it++) {
+        while (!it->second.empty() && pool.bytes > pool.limit) {
+            munmap(it->second.back(), it->first);
+            it->second.pop_back();
+            pool.bytes -= it->first;
+        }
+    }
+}
+
+size_t
+EncodedBuffer::chunkPoolSize()
+{
+    ChunkPool& pool = chunk_pool();
+    std::scoped_lock<std::mutex> lock(pool.lock);
+    return pool.bytes;
+}
+
+void
+EncodedBuffer::clearChunkPool()
+{
+    ChunkPool& pool = chunk_pool();
+    std::scoped_lock<std::mutex> lock(pool.lock);
+    for (auto& [chunkSize, chunks] : pool.chunks) {
+        for (uint8_t* chunk : chunks) {
+            munmap(chunk, chunkSize);
+        }
+    }
+    pool.chunks.clear();
+    pool.bytes = 0;
+}
 
 EncodedBuffer::Pointer::Pointer() : Pointer(BUFFER_SIZE)
 {
@@ -88,7 +183,9 @@ EncodedBuffer::EncodedBuffer() : EncodedBuffer(BUFFER_SIZE)
 }
 
 EncodedBuffer::EncodedBuffer(size_t chunkSize)
-        :mBuffers()
+        :mBuffers(),
+         mRelease(),
+         mAdoptedSize(0)
 {
     // Align chunkSize to memory page size
     chunkSize = chunkSize == 0 ? BUFFER_SIZE : chunkSize;
@@ -99,12 +196,30 @@ EncodedBuffer::EncodedBuffer(size_t chunkSize)
 
 EncodedBuffer::~EncodedBuffer()
 {
+    if (mRelease) {
+        mRelease(mBuffers[0], mAdoptedSize);
+        return;
+    }
     for (size_t i=0; i<mBuffers.size(); i++) {
-        uint8_t* buf = mBuffers[i];
-        munmap(buf, mChunkSize);
+        release_chunk(mBuffers[i], mChunkSize);
     }
 }
 
+sp<EncodedBuffer>
+EncodedBuffer::adopt(uint8_t* data, size_t size, std::function<void(uint8_t*, size_t)> release)
+{
+    // The memory is a single chunk, so readers see it as one contiguous block.
+    sp<EncodedBuffer> buffer = new EncodedBuffer();
+    buffer->mChunkSize = size == 0 ? 1 : size;
+    buffer->mWp = Pointer(buffer->mChunkSize);
+    buffer->mEp = Pointer(buffer->mChunkSize);
+    buffer->mBuffers.push_back(data);
+    buffer->mRelease = std::move(release);
+    buffer->mAdoptedSize = size;
+    buffer->mWp.move(size);
+    return buffer;
+}
+
 inline uint8_t*
 EncodedBuffer::at(const Pointer& p) const
 {
@@ -136,12 +251,11 @@ EncodedBuffer::writeBuffer()
 {
     // This prevents write pointer move too fast than allocating the buffer.
     if (mWp.index() > mBuffers.size()) return NULL;
+    // Adopted memory is read only.
+    if (mRelease) return NULL;
     uint8_t* buf = NULL;
     if (mWp.index() == mBuffers.size()) {
-        // Use mmap instead of malloc to ensure memory alignment i.e. no fragmentation so that
-        // the mem region can be immediately reused by the allocator after calling munmap()
-        buf = (uint8_t*)mmap(NULL, mChunkSize, PROT_READ | PROT_WRITE,
-                MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+        buf = allocate_chunk(mChunkSize);
 
         if (buf == NULL) return NULL; // This indicates NO_MEMORY
 
@@ -166,6 +280,13 @@ EncodedBuffer::writeRawByte(uint8_t val)
 size_t
 EncodedBuffer::writeRawVarint64(uint64_t val)
 {
+    // Encode straight into the chunk when the varint fits in it.
+    uint8_t* target = writeBuffer();
+    if (target != NULL && currentToWrite() >= MAX_VARINT_SIZE) {
+        size_t size = write_raw_varint(target, val) - target;
+        mWp.move(size);
+        return size;
+    }
     size_t size = 0;
     while (true) {
         size++;
@@ -290,7 +411,11 @@ uint64_t
 EncodedBuffer::readRawVarint()
 {
     uint64_t val = 0, shift = 0;
-    size_t start = mEp.pos();
+    if (mEp.index() < mBuffers.size() && mChunkSize - mEp.offset() >= MAX_VARINT_SIZE) {
+        uint8_t const* buf = at(mEp);
+        mEp.move(read_raw_varint(buf, &val) - buf);
+        return val;
+    }
     while (true) {
         uint8_t byte = readRawByte();
         val |= (UINT64_C(0x7F) & byte) << shift;
@@ -405,6 +530,11 @@ uint64_t
 EncodedBuffer::Reader::readRawVarint()
 {
     uint64_t val = 0, shift = 0;
+    if (currentToRead() >= MAX_VARINT_SIZE) {
+        uint8_t const* buf = mData->at(mRp);
+        mRp.move(read_raw_varint(buf, &val) - buf);
+        return val;
+    }
     while (true) {
         uint8_t byte = next();
         val |= (INT64_C(0x7F) & byte) << shift;
@@ -420,5 +550,21 @@ EncodedBuffer::Reader::move(size_t amt)
     mRp.move(amt);
 }
 
+bool
+EncodedBuffer::Reader::readSpans(size_t size, std::vector<ProtoSpan>* spans)
+{
+    if (size > mData->mWp.pos() - mRp.pos()) return false;
+    while (size > 0) {
+        size_t amt = currentToRead();
+        if (amt > size) {
+            amt = size;
+        }
+        spans->push_back({mData->at(mRp), amt});
+        mRp.move(amt);
+        size -= amt;
+    }
+    return true;
+}
+
 } // util
 } // android
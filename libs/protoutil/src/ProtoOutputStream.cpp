@@ -33,6 +33,7 @@ ProtoOutputStream::ProtoOutputStream(): ProtoOutputStream(new EncodedBuffer())
 ProtoOutputStream::ProtoOutputStream(sp<EncodedBuffer> buffer)
         :mBuffer(buffer),
          mCopyBegin(0),
+         mCompactBegin(SIZE_MAX),
          mCompact(false),
          mDepth(0),
          mObjectId(0),
@@ -50,6 +51,7 @@ ProtoOutputStream::clear()
 {
     mBuffer->clear();
     mCopyBegin = 0;
+    mCompactBegin = SIZE_MAX;
     mCompact = false;
     mDepth = 0;
     mObjectId = 0;
@@ -259,6 +261,9 @@ ProtoOutputStream::start(uint64_t fieldId)
 
     uint32_t id = (uint32_t)fieldId;
     size_t prevPos = mBuffer->wp()->pos();
+    if (mCompactBegin == SIZE_MAX) {
+        mCompactBegin = prevPos;
+    }
     mBuffer->writeHeader(id, WIRE_TYPE_LENGTH_DELIMITED);
     size_t sizePos = mBuffer->wp()->pos();
 
@@ -303,6 +308,9 @@ ProtoOutputStream::end(uint64_t token)
     } else {
         // reset wp which erase the header tag of the message when its size is 0.
         mBuffer->wp()->rewind()->move(sizePos - getTagSizeFromToken(token));
+        if (mBuffer->wp()->pos() <= mCompactBegin) {
+            mCompactBegin = SIZE_MAX;
+        }
     }
 }
 
@@ -323,17 +331,24 @@ ProtoOutputStream::compact() {
     size_t rawBufferSize = mBuffer->size();
     if (rawBufferSize == 0) return true; // nothing to do if the buffer is empty;
 
+    // the data before the first message placeholder is encoded already.
+    if (mCompactBegin >= rawBufferSize) {
+        mCompact = true;
+        return true;
+    }
+
     // reset edit pointer and recursively compute encoded size of messages.
-    mBuffer->ep()->rewind();
-    if (editEncodedSize(rawBufferSize) == 0) {
+    mBuffer->ep()->rewind()->move(mCompactBegin);
+    if (editEncodedSize(rawBufferSize - mCompactBegin) == 0) {
         ALOGE("Failed to editEncodedSize.");
         return false;
     }
 
     // reset both edit pointer and write pointer, and compact recursively.
-    mBuffer->ep()->rewind();
-    mBuffer->wp()->rewind();
-    if (!compactSize(rawBufferSize)) {
+    mBuffer->ep()->rewind()->move(mCompactBegin);
+    mBuffer->wp()->rewind()->move(mCompactBegin);
+    mCopyBegin = mCompactBegin;
+    if (!compactSize(rawBufferSize - mCompactBegin)) {
         ALOGE("Failed to compactSize.");
         return false;
     }
@@ -533,6 +548,10 @@ void
 ProtoOutputStream::writeLengthDelimitedHeader(uint32_t id, size_t size)
 {
     mBuffer->writeHeader(id, WIRE_TYPE_LENGTH_DELIMITED);
+    if (mCompactBegin == SIZE_MAX) {
+        mBuffer->writeRawVarint64(size);
+        return;
+    }
     // reserves 64 bits for length delimited fields, if first field is negative, compact it.
     mBuffer->writeRawFixed32(size);
     mBuffer->writeRawFixed32(size);
@@ -544,6 +563,12 @@ ProtoOutputStream::writeRawByte(uint8_t byte)
     mBuffer->writeRawByte(byte);
 }
 
+void
+ProtoOutputStream::writeRaw(uint8_t const* buf, size_t size)
+{
+    mBuffer->writeRaw(buf, size);
+}
+
 
 // =========================================================================
 // Private functions
@@ -661,9 +686,7 @@ ProtoOutputStream::writeUtf8StringImpl(uint32_t id, const char* val, size_t size
 {
     if (val == NULL) return;
     writeLengthDelimitedHeader(id, size);
-    for (size_t i=0; i<size; i++) {
-        mBuffer->writeRawByte((uint8_t)val[i]);
-    }
+    mBuffer->writeRaw(reinterpret_cast<uint8_t const*>(val), size);
 }
 
 inline void
@@ -671,9 +694,7 @@ ProtoOutputStream::writeMessageBytesImpl(uint32_t id, const char* val, size_t si
 {
     if (val == NULL) return;
     writeLengthDelimitedHeader(id, size);
-    for (size_t i=0; i<size; i++) {
-        mBuffer->writeRawByte(val[i]);
-    }
+    mBuffer->writeRaw(reinterpret_cast<uint8_t const*>(val), size);
 }
 
 } // util
@@ -26,5 +26,18 @@ ProtoReader::ProtoReader() {
 ProtoReader::~ProtoReader() {
 }
 
+bool
+ProtoReader::readSpans(size_t size, std::vector<ProtoSpan>* spans) {
+    if (size == 0) {
+        return true;
+    }
+    if (!hasNext() || currentToRead() < size) {
+        return false;
+    }
+    spans->push_back({readBuffer(), size});
+    move(size);
+    return true;
+}
+
 } // util
 } // android
@@ -34,27 +34,49 @@ read_field_id(uint32_t varint)
 size_t
 get_varint_size(uint64_t varint)
 {
-    size_t size = 1;
-    while ((varint & ~0x7F)) {
-        size++;
-        varint >>= 7;
-    }
-    return size;
+    // Every 7 significant bits take a byte: ceil(bits / 7), computed without a loop.
+    const size_t bits = 64 - __builtin_clzll(varint | 1);
+    return (bits * 9 + 64) / 64;
 }
 
 uint8_t*
 write_raw_varint(uint8_t* buf, uint64_t val)
 {
     uint8_t* p = buf;
-    while (true) {
-        if ((val & ~0x7F) == 0) {
-            *p++ = (uint8_t)val;
-            return p;
-        } else {
-            *p++ = (uint8_t)((val & 0x7F) | 0x80);
-            val >>= 7;
+    while (val >= 0x80) {
+        *p++ = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    *p++ = (uint8_t)val;
+    return p;
+}
+
+uint8_t const*
+read_raw_varint(uint8_t const* buf, uint64_t* val)
+{
+    // Most varints are tags and small values that fit in one or two bytes.
+    uint64_t result = buf[0];
+    if (result < 0x80) {
+        *val = result;
+        return buf + 1;
+    }
+    result = (result & 0x7F) | ((uint64_t)buf[1] << 7);
+    if (buf[1] < 0x80) {
+        *val = result;
+        return buf + 2;
+    }
+    result &= UINT64_C(0x3FFF);
+    for (size_t i = 2; i < MAX_VARINT_SIZE; i++) {
+        const uint64_t byte = buf[i];
+        result |= (byte & 0x7F) << (7 * i);
+        if (byte < 0x80) {
+            *val = result;
+            return buf + i + 1;
         }
     }
+    // Malformed, stop at the longest valid varint.
+    *val = result;
+    return buf + MAX_VARINT_SIZE;
 }
 
 uint8_t*
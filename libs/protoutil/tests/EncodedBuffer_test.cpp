@@ -150,3 +150,87 @@ TEST(EncodedBufferTest, ReadVarint) {
     EXPECT_EQ(reader->size(), len);
     EXPECT_EQ(reader->readRawVarint(), val);
 }
+
+TEST(EncodedBufferTest, ReusesPooledChunks) {
+    EncodedBuffer::clearChunkPool();
+    {
+        sp<EncodedBuffer> buffer = new EncodedBuffer(TEST_CHUNK_SIZE);
+        buffer->writeRawByte(1);
+        EXPECT_EQ(EncodedBuffer::chunkPoolSize(), 0UL);
+    }
+    const size_t pooled = EncodedBuffer::chunkPoolSize();
+    EXPECT_GT(pooled, 0UL);
+
+    // A buffer with the same chunk size takes the chunk back, and starts out empty.
+    sp<EncodedBuffer> buffer = new EncodedBuffer(TEST_CHUNK_SIZE);
+    buffer->writeRawByte(2);
+    EXPECT_EQ(EncodedBuffer::chunkPoolSize(), 0UL);
+    EXPECT_EQ(buffer->size(), 1UL);
+    EXPECT_EQ(buffer->read()->next(), 2);
+
+    EncodedBuffer::setChunkPoolLimit(0);
+    buffer.clear();
+    EXPECT_EQ(EncodedBuffer::chunkPoolSize(), 0UL);
+    EncodedBuffer::setChunkPoolLimit(256 * 1024);
+}
+
+TEST(EncodedBufferTest, ReadAdopted) {
+    uint8_t data[TEST_CHUNK_3X_SIZE];
+    for (size_t i = 0; i < TEST_CHUNK_3X_SIZE; i++) {
+        data[i] = i;
+    }
+    bool released = false;
+    {
+        sp<EncodedBuffer> buffer = EncodedBuffer::adopt(data, sizeof(data),
+                [&](uint8_t* adopted, size_t size) {
+                    EXPECT_EQ(adopted, data);
+                    EXPECT_EQ(size, sizeof(data));
+                    released = true;
+                });
+        EXPECT_EQ(buffer->size(), TEST_CHUNK_3X_SIZE);
+        EXPECT_EQ(buffer->writeBuffer(), nullptr);
+
+        sp<ProtoReader> reader = buffer->read();
+        EXPECT_EQ(reader->currentToRead(), TEST_CHUNK_3X_SIZE);
+        uint8_t val = 0;
+        while (reader->hasNext()) {
+            EXPECT_EQ(reader->next(), val);
+            val++;
+        }
+        EXPECT_EQ(reader->bytesRead(), TEST_CHUNK_3X_SIZE);
+        EXPECT_FALSE(released);
+    }
+    EXPECT_TRUE(released);
+}
+
+TEST(EncodedBufferTest, ReadSpans) {
+    sp<EncodedBuffer> buffer = new EncodedBuffer(TEST_CHUNK_SIZE);
+    const size_t chunkSize = buffer->currentToWrite();
+    const size_t total = 2 * chunkSize + TEST_CHUNK_HALF_SIZE;
+    for (size_t i = 0; i < total; i++) {
+        buffer->writeRawByte(i);
+    }
+
+    sp<ProtoReader> reader = buffer->read();
+    reader->move(TEST_CHUNK_HALF_SIZE);
+    std::vector<ProtoSpan> spans;
+    // Too many bytes, nothing is read.
+    EXPECT_FALSE(reader->readSpans(total, &spans));
+    EXPECT_TRUE(spans.empty());
+    EXPECT_EQ(reader->bytesRead(), TEST_CHUNK_HALF_SIZE);
+
+    const size_t size = chunkSize + TEST_CHUNK_HALF_SIZE;
+    ASSERT_TRUE(reader->readSpans(size, &spans));
+    EXPECT_EQ(reader->bytesRead(), TEST_CHUNK_HALF_SIZE + size);
+    ASSERT_EQ(spans.size(), 2UL);
+    EXPECT_EQ(spans[0].size, chunkSize - TEST_CHUNK_HALF_SIZE);
+    EXPECT_EQ(spans[1].size, 2 * TEST_CHUNK_HALF_SIZE);
+    uint8_t val = TEST_CHUNK_HALF_SIZE;
+    for (const ProtoSpan& span : spans) {
+        for (size_t i = 0; i < span.size; i++) {
+            EXPECT_EQ(span.data[i], val);
+            val++;
+        }
+    }
+    EXPECT_EQ(reader->next(), val);
+}
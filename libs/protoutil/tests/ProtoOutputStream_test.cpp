@@ -356,3 +356,71 @@ TEST(ProtoOutputStreamTest, NoStartCalled) {
     EXPECT_EQ(proto.size(), 0);
     EXPECT_FALSE(proto.flush(STDOUT_FILENO));
 }
+
+TEST(ProtoOutputStreamTest, KnownSizesNeedNoCompaction) {
+    std::string name = "known";
+    const char data[4] = { 'd', 'a', 't', 'a' };
+
+    ProtoOutputStream proto;
+    EXPECT_TRUE(proto.write(FIELD_TYPE_INT32 | ComplexProto::kIntsFieldNumber, 300));
+    proto.writeLengthDelimitedHeader(ComplexProto::kLogsFieldNumber, 2 + name.size());
+    proto.writeRawByte((ComplexProto::Log::kNameFieldNumber << FIELD_ID_SHIFT)
+            + WIRE_TYPE_LENGTH_DELIMITED);
+    proto.writeRawByte(name.size());
+    for (char c : name) {
+        proto.writeRawByte(c);
+    }
+    // Nothing was written with a size placeholder, so the raw bytes are the final ones.
+    EXPECT_EQ(proto.bytesWritten(), 3 + 2 + 2 + name.size());
+
+    // Fields after the first message are compacted, and the ones before it are left alone.
+    uint64_t token = proto.start(FIELD_TYPE_MESSAGE | ComplexProto::kLogsFieldNumber);
+    proto.write(FIELD_TYPE_BYTES | ComplexProto::Log::kDataFieldNumber, data, sizeof(data));
+    proto.end(token);
+    EXPECT_TRUE(proto.write(FIELD_TYPE_INT32 | ComplexProto::kIntsFieldNumber, 7));
+
+    ComplexProto complex;
+    ASSERT_TRUE(complex.ParseFromString(iterateToString(&proto)));
+    EXPECT_EQ(complex.ints_size(), 2);
+    EXPECT_EQ(complex.ints(0), 300);
+    EXPECT_EQ(complex.ints(1), 7);
+    EXPECT_EQ(complex.logs_size(), 2);
+    EXPECT_THAT(complex.logs(0).name(), StrEq("known"));
+    EXPECT_THAT(complex.logs(1).data(), StrEq("data"));
+}
+
+TEST(ProtoOutputStreamTest, CompileTimeFieldIds) {
+    constexpr uint64_t VAL_INT32 = FIELD_TYPE_INT32 | PrimitiveProto::kValInt32FieldNumber;
+    constexpr uint64_t VAL_DOUBLE = FIELD_TYPE_DOUBLE | PrimitiveProto::kValDoubleFieldNumber;
+    constexpr uint64_t VAL_STRING = FIELD_TYPE_STRING | PrimitiveProto::kValStringFieldNumber;
+    constexpr uint64_t VAL_SINT64 = FIELD_TYPE_SINT64 | PrimitiveProto::kValSint64FieldNumber;
+    constexpr uint64_t VAL_ENUM = FIELD_TYPE_ENUM | PrimitiveProto::kValEnumFieldNumber;
+    const std::string s = "hello";
+
+    ProtoOutputStream runtime;
+    runtime.write(VAL_INT32, -7);
+    runtime.write(VAL_DOUBLE, 324.5);
+    runtime.write(VAL_STRING, s);
+    runtime.write(VAL_SINT64, -61224762453LL);
+    runtime.write(VAL_ENUM, 2);
+
+    ProtoOutputStream compiled;
+    EXPECT_TRUE(compiled.write<VAL_INT32>(-7));
+    EXPECT_TRUE(compiled.write<VAL_DOUBLE>(324.5));
+    EXPECT_TRUE(compiled.write<VAL_STRING>(s));
+    EXPECT_TRUE(compiled.write<VAL_SINT64>(-61224762453LL));
+    EXPECT_TRUE(compiled.write<VAL_ENUM>(PrimitiveProto::TWO));
+
+    EXPECT_EQ(iterateToString(&compiled), iterateToString(&runtime));
+    EXPECT_FALSE(compiled.write<VAL_INT32>(1));
+
+    static constexpr ProtoFieldDescriptor FIELDS[] = {
+        { VAL_INT32, WIRE_TYPE_VARINT, PRIVACY_DEST_UNSET },
+        { VAL_STRING | FIELD_COUNT_REPEATED, WIRE_TYPE_LENGTH_DELIMITED, 200 },
+    };
+    static_assert(find_field(FIELDS, PrimitiveProto::kValStringFieldNumber)->repeated());
+    static_assert(find_field(FIELDS, PrimitiveProto::kValStringFieldNumber)->privacyDest == 200);
+    static_assert(find_field(FIELDS, PrimitiveProto::kValInt32FieldNumber)->type()
+            == FIELD_TYPE_INT32);
+    static_assert(find_field(FIELDS, PrimitiveProto::kValBytesFieldNumber) == nullptr);
+}
@@ -48,4 +48,16 @@ TEST(ProtobufTest, All) {
     EXPECT_EQ(header[1], 0x96);
     EXPECT_EQ(header[2], 0x01);
     EXPECT_EQ(header[3], UNSET_BYTE);
-}
\ No newline at end of file
+}
+TEST(ProtobufTest, ReadRawVarint) {
+    uint8_t buf[MAX_VARINT_SIZE];
+    for (int bits = 0; bits <= 64; bits++) {
+        const uint64_t val = bits == 64 ? UINT64_C(-1) : (UINT64_C(1) << bits) - 1;
+        const size_t size = write_raw_varint(buf, val) - buf;
+        EXPECT_EQ(get_varint_size(val), size);
+
+        uint64_t read = 0;
+        EXPECT_EQ(read_raw_varint(buf, &read) - buf, (long)size);
+        EXPECT_EQ(read, val);
+    }
+}
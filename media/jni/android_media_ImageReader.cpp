@@ -17,6 +17,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "ImageReader_JNI"
 #include "android_media_Utils.h"
+#include "core_jni_helpers.h"
 #include <cutils/atomic.h>
 #include <utils/Log.h>
 #include <utils/misc.h>
@@ -26,6 +27,7 @@
 #include <cstdio>
 
 #include <gui/BufferItemConsumer.h>
+#include <gui/BufferQueueDefs.h>
 #include <gui/Surface.h>
 
 #include <android_runtime/AndroidRuntime.h>
@@ -88,6 +90,13 @@ static struct {
     jmethodID ctor;
 } gImagePlaneClassInfo;
 
+static struct {
+    jmethodID clear;
+} gBufferClassInfo;
+
+// The most planes a locked image has, for the YUV formats.
+static constexpr int kMaxImagePlanes = 3;
+
 // Get an ID that's unique within this process.
 static int32_t createProcessUniqueId() {
     static volatile int32_t globalCounter = 0;
@@ -108,6 +117,18 @@ public:
     BufferItem* getBufferItem();
     void returnBufferItem(BufferItem* buffer);
 
+    // The planes of the buffer of a slot while nativeLockPlanes() has it locked, until the
+    // Image holding it is released or detached. The ByteBuffers over them belong to the Image.
+    struct SlotPlanes {
+        bool locked = false;
+        int count = 0;
+        uint8_t* base[kMaxImagePlanes] = {};
+        uint32_t size[kMaxImagePlanes] = {};
+        jint rowStride[kMaxImagePlanes] = {};
+        jint pixelStride[kMaxImagePlanes] = {};
+    };
+
+    SlotPlanes* getSlotPlanes(int slot);
 
     void setBufferConsumer(const sp<BufferItemConsumer>& consumer) { mConsumer = consumer; }
     BufferItemConsumer* getBufferConsumer() { return mConsumer.get(); }
@@ -132,6 +153,7 @@ private:
     static void detachJNI();
 
     List<BufferItem*> mBuffers;
+    SlotPlanes mSlotPlanes[BufferQueueDefs::NUM_BUFFER_SLOTS];
     sp<BufferItemConsumer> mConsumer;
     sp<IGraphicBufferProducer> mProducer;
     jobject mWeakThiz;
@@ -197,6 +219,13 @@ void JNIImageReaderContext::returnBufferItem(BufferItem* buffer) {
     mBuffers.push_back(buffer);
 }
 
+JNIImageReaderContext::SlotPlanes* JNIImageReaderContext::getSlotPlanes(int slot) {
+    if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        return NULL;
+    }
+    return &mSlotPlanes[slot];
+}
+
 JNIImageReaderContext::~JNIImageReaderContext() {
     bool needsDetach = false;
     JNIEnv* env = getJNIEnv(&needsDetach);
@@ -372,6 +401,11 @@ static void ImageReader_classInit(JNIEnv* env, jclass clazz)
             "(IILjava/nio/ByteBuffer;)V");
     LOG_ALWAYS_FATAL_IF(gImagePlaneClassInfo.ctor == NULL,
             "Can not find ImagePlane constructor");
+
+    jclass bufferClazz = env->FindClass("java/nio/Buffer");
+    LOG_ALWAYS_FATAL_IF(bufferClazz == NULL, "Can not find Buffer class");
+    gBufferClassInfo.clear = env->GetMethodID(bufferClazz, "clear", "()Ljava/nio/Buffer;");
+    LOG_ALWAYS_FATAL_IF(gBufferClassInfo.clear == NULL, "Can not find Buffer.clear");
 }
 
 static void ImageReader_init(JNIEnv* env, jobject thiz, jobject weakThiz, jint width, jint height,
@@ -499,6 +533,26 @@ static sp<Fence> Image_unlockIfLocked(JNIEnv* env, jobject image) {
     return Fence::NO_FENCE;
 }
 
+// Unlocks the buffer if nativeLockPlanes() locked it, handing back the fence of the unlock.
+// Returns false when the planes weren't locked that way.
+static bool ImageReader_unlockSlotPlanes(JNIEnv* env, JNIImageReaderContext* ctx,
+        BufferItem* buffer, sp<Fence>* releaseFence) {
+    JNIImageReaderContext::SlotPlanes* planes = ctx->getSlotPlanes(buffer->mSlot);
+    if (planes == NULL || !planes->locked) {
+        return false;
+    }
+    *planes = JNIImageReaderContext::SlotPlanes();
+    int fenceFd = -1;
+    status_t res = buffer->mGraphicBuffer->unlockAsync(&fenceFd);
+    if (res != OK) {
+        jniThrowRuntimeException(env, "unlock buffer failed");
+        *releaseFence = Fence::NO_FENCE;
+        return true;
+    }
+    *releaseFence = new Fence(fenceFd);
+    return true;
+}
+
 static void ImageReader_imageRelease(JNIEnv* env, jobject thiz, jobject image)
 {
     ALOGV("%s:", __FUNCTION__);
@@ -515,22 +569,17 @@ static void ImageReader_imageRelease(JNIEnv* env, jobject thiz, jobject image)
         return;
     }
 
-    sp<Fence> releaseFence = Image_unlockIfLocked(env, image);
+    sp<Fence> releaseFence;
+    if (!ImageReader_unlockSlotPlanes(env, ctx, buffer, &releaseFence)) {
+        releaseFence = Image_unlockIfLocked(env, image);
+    }
     bufferConsumer->releaseBuffer(*buffer, releaseFence);
     Image_setBufferItem(env, image, NULL);
     ctx->returnBufferItem(buffer);
     ALOGV("%s: Image (format: 0x%x) has been released", __FUNCTION__, ctx->getBufferFormat());
 }
 
-static jint ImageReader_imageSetup(JNIEnv* env, jobject thiz, jobject image) {
-    ALOGV("%s:", __FUNCTION__);
-    JNIImageReaderContext* ctx = ImageReader_getContext(env, thiz);
-    if (ctx == NULL) {
-        jniThrowException(env, "java/lang/IllegalStateException",
-                "ImageReader is not initialized or was already closed");
-        return -1;
-    }
-
+static jint ImageReader_acquireImage(JNIEnv* env, JNIImageReaderContext* ctx, jobject image) {
     BufferItemConsumer* bufferConsumer = ctx->getBufferConsumer();
     BufferItem* buffer = ctx->getBufferItem();
     if (buffer == NULL) {
@@ -642,6 +691,46 @@ static jint ImageReader_imageSetup(JNIEnv* env, jobject thiz, jobject image) {
     return ACQUIRE_SUCCESS;
 }
 
+static jint ImageReader_imageSetup(JNIEnv* env, jobject thiz, jobject image) {
+    ALOGV("%s:", __FUNCTION__);
+    JNIImageReaderContext* ctx = ImageReader_getContext(env, thiz);
+    if (ctx == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "ImageReader is not initialized or was already closed");
+        return -1;
+    }
+
+    return ImageReader_acquireImage(env, ctx, image);
+}
+
+// Acquires as many of the pending buffers as there are Images in |images|, into those Images in
+// order, and returns how many it acquired; it stops at the first that isn't acquired. Lets a
+// reader that recycles its Images drain the queue in one call. If an exception is thrown, the
+// Images before the one that failed were acquired and must still be released.
+static jint ImageReader_imageSetupBatch(JNIEnv* env, jobject thiz, jobjectArray images) {
+    ALOGV("%s:", __FUNCTION__);
+    JNIImageReaderContext* ctx = ImageReader_getContext(env, thiz);
+    if (ctx == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "ImageReader is not initialized or was already closed");
+        return -1;
+    }
+
+    jsize count = env->GetArrayLength(images);
+    jint acquired = 0;
+    while (acquired < count) {
+        jobject image = env->GetObjectArrayElement(images, acquired);
+        jint res = ImageReader_acquireImage(env, ctx, image);
+        env->DeleteLocalRef(image);
+        if (res != ACQUIRE_SUCCESS) {
+            break;
+        }
+        acquired++;
+    }
+    ALOGV("%s: acquired %d of %d images", __FUNCTION__, acquired, count);
+    return acquired;
+}
+
 static jint ImageReader_detachImage(JNIEnv* env, jobject thiz, jobject image,
                                     jboolean throwISEOnly) {
     ALOGV("%s:", __FUNCTION__);
@@ -662,7 +751,10 @@ static jint ImageReader_detachImage(JNIEnv* env, jobject thiz, jobject image,
     }
 
     status_t res = OK;
-    Image_unlockIfLocked(env, image);
+    sp<Fence> releaseFence;
+    if (!ImageReader_unlockSlotPlanes(env, ctx, buffer, &releaseFence)) {
+        Image_unlockIfLocked(env, image);
+    }
     res = bufferConsumer->detachBuffer(buffer->mSlot);
     if (res != OK) {
         ALOGE("Image detach failed: %s (%d)!!!", strerror(-res), res);
@@ -903,6 +995,110 @@ static jobjectArray Image_createSurfacePlanes(JNIEnv* env, jobject thiz,
     return surfacePlanes;
 }
 
+// Locks the Image for CPU access like nativeCreatePlanes() does, but instead of new SurfacePlanes
+// stores a direct ByteBuffer per plane into |byteBuffers| and the row and pixel stride of each
+// into |strides|, in pairs. |byteBuffers| belongs to the Image: a ByteBuffer it still holds from
+// the Image's previous frame is cleared and kept if the plane is mapped at the same address with
+// the same size, and replaced otherwise. The Image is unlocked when it is released. Returns the
+// number of planes.
+static jint ImageReader_lockPlanes(JNIEnv* env, jobject thiz, jobject image,
+        jint halReaderFormat, jlong ndkReaderUsage, jobjectArray byteBuffers, jintArray strides)
+{
+    ALOGV("%s:", __FUNCTION__);
+    JNIImageReaderContext* ctx = ImageReader_getContext(env, thiz);
+    if (ctx == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "ImageReader is not initialized or was already closed");
+        return -1;
+    }
+    BufferItem* buffer = Image_getBufferItem(env, image);
+    if (buffer == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "Image is not initialized");
+        return -1;
+    }
+    if (isFormatOpaque(halReaderFormat)) {
+        return 0;
+    }
+
+    jsize numPlanes = env->GetArrayLength(byteBuffers);
+    if (numPlanes > kMaxImagePlanes || env->GetArrayLength(strides) < numPlanes * 2) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                "Can't lock %d planes into %d strides", numPlanes,
+                env->GetArrayLength(strides));
+        return -1;
+    }
+    jobject surfacePlanes = env->GetObjectField(image, gSurfaceImageClassInfo.mPlanes);
+    if (surfacePlanes != NULL) {
+        env->DeleteLocalRef(surfacePlanes);
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "Image planes were already created");
+        return -1;
+    }
+    JNIImageReaderContext::SlotPlanes* planes = ctx->getSlotPlanes(buffer->mSlot);
+    if (planes == NULL) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalStateException",
+                "Invalid buffer slot %d", buffer->mSlot);
+        return -1;
+    }
+
+    if (planes->locked) {
+        // Already locked since this Image was acquired.
+        if (planes->count != numPlanes) {
+            jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                    "Image was locked with %d planes, not %d", planes->count, numPlanes);
+            return -1;
+        }
+    } else {
+        LockedImage lockedImg = LockedImage();
+        Image_getLockedImage(env, image, &lockedImg, ndkReaderUsage);
+        if (env->ExceptionCheck()) {
+            return -1;
+        }
+        planes->locked = true;
+        planes->count = numPlanes;
+        for (int i = 0; i < numPlanes; i++) {
+            uint8_t* pData = NULL;
+            uint32_t dataSize = 0;
+            int pixelStride = 0;
+            int rowStride = 0;
+            if (!Image_getLockedImageInfo(env, &lockedImg, i, halReaderFormat,
+                    &pData, &dataSize, &pixelStride, &rowStride)) {
+                return -1;
+            }
+            planes->base[i] = pData;
+            planes->size[i] = dataSize;
+            planes->rowStride[i] = rowStride;
+            planes->pixelStride[i] = pixelStride;
+        }
+    }
+
+    for (int i = 0; i < numPlanes; i++) {
+        jobject byteBuffer = env->GetObjectArrayElement(byteBuffers, i);
+        if (byteBuffer != NULL && env->GetDirectBufferAddress(byteBuffer) == planes->base[i] &&
+                env->GetDirectBufferCapacity(byteBuffer) == planes->size[i]) {
+            env->DeleteLocalRef(env->CallObjectMethod(byteBuffer, gBufferClassInfo.clear));
+        } else {
+            if (byteBuffer != NULL) {
+                env->DeleteLocalRef(byteBuffer);
+            }
+            byteBuffer = env->NewDirectByteBuffer(planes->base[i], planes->size[i]);
+            if (byteBuffer == NULL) {
+                if (env->ExceptionCheck() == false) {
+                    jniThrowException(env, "java/lang/IllegalStateException",
+                            "Failed to allocate ByteBuffer");
+                }
+                return -1;
+            }
+            env->SetObjectArrayElement(byteBuffers, i, byteBuffer);
+        }
+        env->DeleteLocalRef(byteBuffer);
+        jint planeStrides[2] = {planes->rowStride[i], planes->pixelStride[i]};
+        env->SetIntArrayRegion(strides, i * 2, 2, planeStrides);
+    }
+    return numPlanes;
+}
+
 static jint Image_getWidth(JNIEnv* env, jobject thiz)
 {
     BufferItem* buffer = Image_getBufferItem(env, thiz);
@@ -976,6 +1172,13 @@ static const JNINativeMethod gImageReaderMethods[] = {
     {"nativeDiscardFreeBuffers", "()V",                      (void*)ImageReader_discardFreeBuffers }
 };
 
+// Registered only if ImageReader declares them.
+static const JNINativeMethod gImageReaderOptionalMethods[] = {
+    {"nativeImageSetupBatch",  "([Landroid/media/Image;)I",  (void*)ImageReader_imageSetupBatch },
+    {"nativeLockPlanes",       "(Landroid/media/Image;IJ[Ljava/nio/ByteBuffer;[I)I",
+                                                             (void*)ImageReader_lockPlanes },
+};
+
 static const JNINativeMethod gImageMethods[] = {
     {"nativeCreatePlanes",      "(IIJ)[Landroid/media/ImageReader$SurfaceImage$SurfacePlane;",
                                                              (void*)Image_createSurfacePlanes },
@@ -991,6 +1194,10 @@ int register_android_media_ImageReader(JNIEnv *env) {
 
     int ret1 = AndroidRuntime::registerNativeMethods(env,
                    "android/media/ImageReader", gImageReaderMethods, NELEM(gImageReaderMethods));
+    if (ret1 == 0) {
+        RegisterOptionalMethods(env, "android/media/ImageReader", gImageReaderOptionalMethods,
+                NELEM(gImageReaderOptionalMethods));
+    }
 
     int ret2 = AndroidRuntime::registerNativeMethods(env,
                    "android/media/ImageReader$SurfaceImage", gImageMethods, NELEM(gImageMethods));
@@ -18,6 +18,12 @@
 #define LOG_TAG "MediaCodec-JNI"
 #include <utils/Log.h>
 
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <list>
 #include <type_traits>
 
 #include "android_media_MediaCodec.h"
@@ -30,6 +36,7 @@
 #include "android_runtime/AndroidRuntime.h"
 #include "android_runtime/android_view_Surface.h"
 #include "android_util_Binder.h"
+#include "core_jni_helpers.h"
 #include "jni.h"
 #include <nativehelper/JNIHelp.h>
 #include <nativehelper/ScopedLocalRef.h>
@@ -2455,6 +2462,121 @@ static status_t ConvertKeyValueListsToAMessage(
     return OK;
 }
 
+// Non-secure linear blocks that apps have recycled and codecs have released, kept mapped for
+// the next LinearBlock.obtain() of the same codecs: allocating and mapping a block for every
+// input buffer is a large part of the cost of feeding a 4K decoder.
+constexpr size_t kMaxPooledLinearBlocks = 16;
+constexpr size_t kMaxPooledLinearBlockBytes = 64 * 1048576;
+
+// A block lent out by the pool. It returns to the pool when the LinearBlock holding it is
+// recycled and every C2Buffer queued from it is destroyed, whichever comes last.
+struct PooledLinearBlock {
+    std::vector<std::string> codecNames;
+    std::shared_ptr<C2LinearBlock> block;
+    std::shared_ptr<C2WriteView> mapping;
+    std::atomic_int refs{1};  // the LinearBlock, plus one per outstanding C2Buffer.
+    // Weak references to the ByteBuffers LinearBlock.map() returned over the block. The app
+    // may still write through them after recycling the LinearBlock, so a pooled block is only
+    // lent out again once they have all been collected.
+    std::vector<jweak> mappedBuffers;
+};
+
+class LinearBlockPool {
+public:
+    // Called on a Java thread, as it checks whether the mapped ByteBuffers have been collected.
+    std::shared_ptr<PooledLinearBlock> take(
+            JNIEnv *env, size_t capacity, const std::vector<std::string> &names) {
+        std::lock_guard lock(mLock);
+        for (jweak ref : mStaleRefs) {
+            env->DeleteWeakGlobalRef(ref);
+        }
+        mStaleRefs.clear();
+        for (auto it = mBlocks.begin(); it != mBlocks.end(); ++it) {
+            const size_t blockCapacity = (*it)->block->capacity();
+            // Don't hand a large block out for a small buffer.
+            if ((*it)->codecNames == names && blockCapacity >= capacity
+                    && blockCapacity <= capacity * 2
+                    && releaseCollectedBuffers(env, it->get())) {
+                std::shared_ptr<PooledLinearBlock> pooled = std::move(*it);
+                mBlocks.erase(it);
+                mBytes -= blockCapacity;
+                pooled->refs = 1;
+                return pooled;
+            }
+        }
+        return nullptr;
+    }
+
+    void put(std::shared_ptr<PooledLinearBlock> pooled) {
+        const size_t capacity = pooled->block->capacity();
+        std::lock_guard lock(mLock);
+        if (capacity > kMaxPooledLinearBlockBytes) {
+            discardLocked(pooled.get());
+            return;
+        }
+        while (!mBlocks.empty() && (mBlocks.size() >= kMaxPooledLinearBlocks
+                || mBytes + capacity > kMaxPooledLinearBlockBytes)) {
+            mBytes -= mBlocks.front()->block->capacity();
+            discardLocked(mBlocks.front().get());
+            mBlocks.pop_front();  // the least recently returned.
+        }
+        mBytes += capacity;
+        mBlocks.push_back(std::move(pooled));
+    }
+
+    // Drops a reference to |pooled|, returning it to the pool if that was the last one.
+    void release(const std::shared_ptr<PooledLinearBlock> &pooled) {
+        if (pooled->refs.fetch_sub(1) == 1) {
+            put(pooled);
+        }
+    }
+
+    // Forgets |pooled|, which will never return to the pool.
+    void discard(PooledLinearBlock *pooled) {
+        std::lock_guard lock(mLock);
+        discardLocked(pooled);
+    }
+
+private:
+    // Drops the references to the ByteBuffers mapped over |pooled| that have been collected,
+    // and returns whether none is left.
+    static bool releaseCollectedBuffers(JNIEnv *env, PooledLinearBlock *pooled) {
+        std::vector<jweak> &refs = pooled->mappedBuffers;
+        refs.erase(std::remove_if(refs.begin(), refs.end(), [env](jweak ref) {
+            if (!env->IsSameObject(ref, nullptr)) {
+                return false;
+            }
+            env->DeleteWeakGlobalRef(ref);
+            return true;
+        }), refs.end());
+        return refs.empty();
+    }
+
+    // Blocks are discarded on any thread, including codec threads without a JNIEnv, so the
+    // references to their ByteBuffers are deleted by the next take() instead.
+    void discardLocked(PooledLinearBlock *pooled) {
+        mStaleRefs.insert(mStaleRefs.end(), pooled->mappedBuffers.begin(),
+                          pooled->mappedBuffers.end());
+        pooled->mappedBuffers.clear();
+    }
+
+    std::mutex mLock;
+    std::list<std::shared_ptr<PooledLinearBlock>> mBlocks;  // GUARDED_BY(mLock)
+    size_t mBytes = 0;  // GUARDED_BY(mLock)
+    std::vector<jweak> mStaleRefs;  // GUARDED_BY(mLock)
+};
+
+static LinearBlockPool &getLinearBlockPool() {
+    static LinearBlockPool *const sPool = new LinearBlockPool;
+    return *sPool;
+}
+
+static void onPooledC2BufferDestroyed(const C2Buffer *, void *arg) {
+    auto pooled = static_cast<std::shared_ptr<PooledLinearBlock> *>(arg);
+    getLinearBlockPool().release(*pooled);
+    delete pooled;
+}
+
 static bool obtain(
         JMediaCodecLinearBlock *context,
         int capacity,
@@ -2483,11 +2605,24 @@ static bool obtain(
         }
         context->mHidlMemory = hardware::fromHeap(context->mMemory->getMemory(
                     &context->mHidlMemoryOffset, &context->mHidlMemorySize));
+    } else if (std::shared_ptr<PooledLinearBlock> pooled =
+            getLinearBlockPool().take(AndroidRuntime::getJNIEnv(), capacity, names)) {
+        context->mBlock = pooled->block;
+        context->mReadWriteMapping = pooled->mapping;
+        context->mPooled = std::move(pooled);
     } else {
         context->mBlock = MediaCodec::FetchLinearBlock(capacity, names);
         if (!context->mBlock) {
             return false;
         }
+        auto mapping = std::make_shared<C2WriteView>(context->mBlock->map().get());
+        if (mapping->error() == C2_OK) {
+            context->mReadWriteMapping = mapping;
+            context->mPooled = std::make_shared<PooledLinearBlock>();
+            context->mPooled->codecNames = names;
+            context->mPooled->block = context->mBlock;
+            context->mPooled->mapping = std::move(mapping);
+        }
     }
     context->mCodecNames = names;
     return true;
@@ -2537,8 +2672,8 @@ static void extractBufferFromContext(
         }
         ALOGD("extractBufferFromContext: realloc & copying from IMemory to C2Block (cap=%zu)",
               context->capacity());
-        if (obtain(context, context->capacity(),
-                   context->mCodecNames, false /* secure */)) {
+        if (!obtain(context, context->capacity(),
+                    context->mCodecNames, false /* secure */)) {
             ALOGW("extractBufferFromContext: failed to obtain non-secure block");
             return;
         }
@@ -2555,6 +2690,17 @@ static void extractBufferFromContext(
         context->mHidlMemoryOffset = 0;
         *buffer = context->toC2Buffer(offset, size);
     }
+    if (*buffer != nullptr && context->mPooled && !context->mBuffer) {
+        // Keep the block out of the pool until the codec is done with the buffer.
+        context->mPooled->refs++;
+        auto arg = new std::shared_ptr<PooledLinearBlock>(context->mPooled);
+        if ((*buffer)->registerOnDestroyNotify(&onPooledC2BufferDestroyed, arg) != C2_OK) {
+            // Never reused then: the pool can't tell when the buffer is released.
+            delete arg;
+            getLinearBlockPool().discard(context->mPooled.get());
+            context->mPooled.reset();
+        }
+    }
 }
 
 static void android_media_MediaCodec_native_queueLinearBlock(
@@ -3543,7 +3689,7 @@ static jobject android_media_MediaCodec_LinearBlock_native_map(
             context->mReadWriteMapping =
                 std::make_shared<C2WriteView>(block->map().get());
         }
-        return CreateByteBuffer(
+        jobject byteBuffer = CreateByteBuffer(
                 env,
                 context->mReadWriteMapping->base(),
                 context->mReadWriteMapping->capacity(),
@@ -3551,6 +3697,10 @@ static jobject android_media_MediaCodec_LinearBlock_native_map(
                 context->mReadWriteMapping->size(),
                 false,  // readOnly
                 true /* clearBuffer */);
+        if (byteBuffer != nullptr && context->mPooled) {
+            context->mPooled->mappedBuffers.push_back(env->NewWeakGlobalRef(byteBuffer));
+        }
+        return byteBuffer;
     } else if (context->mLegacyBuffer) {
         return CreateByteBuffer(
                 env,
@@ -3576,11 +3726,69 @@ static jobject android_media_MediaCodec_LinearBlock_native_map(
     return nullptr;
 }
 
+// Reads up to |size| bytes from |fileDescriptor|, at |fileOffset| or its current offset if -1,
+// straight into the block at |offset|, e.g. from a socket or a file being demuxed natively.
+static jint android_media_MediaCodec_LinearBlock_native_readFrom(
+        JNIEnv *env, jobject thiz, jobject fileDescriptor, jlong fileOffset,
+        jint offset, jint size) {
+    JMediaCodecLinearBlock *context =
+        (JMediaCodecLinearBlock *)env->GetLongField(thiz, gLinearBlockInfo.contextId);
+    if (context == nullptr) {
+        jniThrowException(env, "java/lang/IllegalStateException", "LinearBlock is recycled");
+        return -1;
+    }
+    uint8_t *base = nullptr;
+    size_t capacity = 0;
+    if (context->mBlock) {
+        if (!context->mReadWriteMapping) {
+            context->mReadWriteMapping =
+                std::make_shared<C2WriteView>(context->mBlock->map().get());
+        }
+        if (context->mReadWriteMapping->error() == C2_OK) {
+            base = context->mReadWriteMapping->base();
+            capacity = context->mReadWriteMapping->capacity();
+        }
+    } else if (context->mMemory) {
+        base = static_cast<uint8_t *>(context->mMemory->unsecurePointer());
+        capacity = context->mMemory->size();
+    }
+    if (base == nullptr) {
+        throwExceptionAsNecessary(
+                env, INVALID_OPERATION, ACTION_CODE_FATAL,
+                "Underlying buffer is not writable");
+        return -1;
+    }
+    if (offset < 0 || size < 0 || (size_t)offset + size > capacity) {
+        jniThrowException(env, "java/lang/IndexOutOfBoundsException", nullptr);
+        return -1;
+    }
+    int fd = jniGetFDFromFileDescriptor(env, fileDescriptor);
+    size_t total = 0;
+    while (total < (size_t)size) {
+        uint8_t *dst = base + offset + total;
+        ssize_t n = fileOffset < 0
+                ? TEMP_FAILURE_RETRY(read(fd, dst, size - total))
+                : TEMP_FAILURE_RETRY(pread64(fd, dst, size - total, fileOffset + total));
+        if (n < 0) {
+            jniThrowIOException(env, errno);
+            return -1;
+        }
+        if (n == 0) {
+            break;  // end of file
+        }
+        total += n;
+    }
+    return total;
+}
+
 static void android_media_MediaCodec_LinearBlock_native_recycle(
         JNIEnv *env, jobject thiz) {
     JMediaCodecLinearBlock *context =
         (JMediaCodecLinearBlock *)env->GetLongField(thiz, gLinearBlockInfo.contextId);
     env->CallVoidMethod(thiz, gLinearBlockInfo.setInternalStateId, jlong(0), false);
+    if (context != nullptr && context->mPooled) {
+        getLinearBlockPool().release(context->mPooled);
+    }
     delete context;
 }
 
@@ -3805,6 +4013,12 @@ static const JNINativeMethod gLinearBlockMethods[] = {
       (void *)android_media_MediaCodec_LinearBlock_checkCompatible },
 };
 
+// Registered only if LinearBlock declares them.
+static const JNINativeMethod gLinearBlockOptionalMethods[] = {
+    { "native_readFrom", "(Ljava/io/FileDescriptor;JII)I",
+      (void *)android_media_MediaCodec_LinearBlock_native_readFrom },
+};
+
 int register_android_media_MediaCodec(JNIEnv *env) {
     int result = AndroidRuntime::registerNativeMethods(env,
                 "android/media/MediaCodec", gMethods, NELEM(gMethods));
@@ -3815,5 +4029,9 @@ int register_android_media_MediaCodec(JNIEnv *env) {
                 "android/media/MediaCodec$LinearBlock",
                 gLinearBlockMethods,
                 NELEM(gLinearBlockMethods));
+    if (result == JNI_OK) {
+        RegisterOptionalMethods(env, "android/media/MediaCodec$LinearBlock",
+                gLinearBlockOptionalMethods, NELEM(gLinearBlockOptionalMethods));
+    }
     return result;
 }
@@ -24,6 +24,8 @@
 
 namespace android {
 
+struct PooledLinearBlock;
+
 struct JMediaCodecLinearBlock {
     std::vector<std::string> mCodecNames;
 
@@ -40,6 +42,9 @@ struct JMediaCodecLinearBlock {
 
     sp<MediaCodecBuffer> mLegacyBuffer;
 
+    // Set when mBlock came from, and goes back to, the pool of android_media_MediaCodec.cpp.
+    std::shared_ptr<PooledLinearBlock> mPooled;
+
     std::once_flag mCopyWarningFlag;
 
     std::shared_ptr<C2Buffer> toC2Buffer(size_t offset, size_t size) const {
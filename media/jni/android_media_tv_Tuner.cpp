@@ -165,6 +165,7 @@
 #include "android_media_AudioPresentation.h"
 #include "android_media_MediaCodecLinearBlock.h"
 #include "android_runtime/AndroidRuntime.h"
+#include "core_jni_helpers.h"
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 
@@ -343,6 +344,8 @@ struct fields_t {
     jmethodID sharedFilterInitID;
     jmethodID onSharedFilterStatusID;
     jmethodID onSharedFilterEventID;
+    jmethodID onFilterEventsPackedID;
+    jmethodID onSharedFilterEventsPackedID;
 };
 
 static fields_t gFields;
@@ -858,9 +861,77 @@ void FilterClientCallbackImpl::getRestartEvent(const jobjectArray& arr, const in
     env->SetObjectArrayElement(arr, size, obj.get());
 }
 
+bool FilterClientCallbackImpl::packEvents(JNIEnv *env, const vector<DemuxFilterEvent> &events) {
+    for (const DemuxFilterEvent &event : events) {
+        if (event.getTag() != DemuxFilterEvent::Tag::section &&
+            event.getTag() != DemuxFilterEvent::Tag::pes) {
+            return false;
+        }
+    }
+
+    if (events.size() > mPackedEventsCapacity) {
+        size_t capacity = std::max(events.size(), mPackedEventsCapacity * 2);
+        std::unique_ptr<PackedFilterEvent[]> packedEvents(new PackedFilterEvent[capacity]);
+        ScopedLocalRef buffer(env,
+                              env->NewDirectByteBuffer(packedEvents.get(),
+                                                       capacity * sizeof(PackedFilterEvent)));
+        if (buffer.get() == nullptr) {
+            env->ExceptionClear();
+            return false;
+        }
+        if (mPackedEventsBuffer != nullptr) {
+            env->DeleteGlobalRef(mPackedEventsBuffer);
+        }
+        mPackedEventsBuffer = env->NewGlobalRef(buffer.get());
+        mPackedEvents = std::move(packedEvents);
+        mPackedEventsCapacity = capacity;
+    }
+
+    for (size_t i = 0; i < events.size(); i++) {
+        PackedFilterEvent &packed = mPackedEvents[i];
+        if (events[i].getTag() == DemuxFilterEvent::Tag::section) {
+            const DemuxFilterSectionEvent &sectionEvent =
+                    events[i].get<DemuxFilterEvent::Tag::section>();
+            packed.type = PackedFilterEvent::kSection;
+            packed.fields[0] = sectionEvent.tableId;
+            packed.fields[1] = sectionEvent.version;
+            packed.fields[2] = sectionEvent.sectionNum;
+            packed.dataLength = sectionEvent.dataLength;
+        } else {
+            const DemuxFilterPesEvent &pesEvent = events[i].get<DemuxFilterEvent::Tag::pes>();
+            packed.type = PackedFilterEvent::kPes;
+            packed.fields[0] = pesEvent.streamId;
+            packed.fields[1] = pesEvent.mpuSequenceNumber;
+            packed.fields[2] = 0;
+            packed.dataLength = pesEvent.dataLength;
+        }
+    }
+    return true;
+}
+
 void FilterClientCallbackImpl::onFilterEvent(const vector<DemuxFilterEvent> &events) {
     ALOGV("FilterClientCallbackImpl::onFilterEvent");
     JNIEnv *env = AndroidRuntime::getJNIEnv();
+
+    // Batches made only of sections and PES, what EPG scans produce, skip the event objects
+    // when the filter can read them packed.
+    jmethodID packedMethodID =
+            mSharedFilter ? gFields.onSharedFilterEventsPackedID : gFields.onFilterEventsPackedID;
+    if (packedMethodID != nullptr && !events.empty()) {
+        std::scoped_lock<std::mutex> lock(mMutex);
+        if (packEvents(env, events)) {
+            ScopedLocalRef filter(env, env->NewLocalRef(mFilterObj));
+            if (!env->IsSameObject(filter.get(), nullptr)) {
+                env->CallVoidMethod(filter.get(), packedMethodID, mPackedEventsBuffer,
+                                    static_cast<jint>(events.size()));
+            } else {
+                ALOGE("FilterClientCallbackImpl::onFilterEvent:"
+                      "Filter object has been freed. Ignoring callback.");
+            }
+            return;
+        }
+    }
+
     ScopedLocalRef<jobjectArray> array(env);
 
     if (!events.empty()) {
@@ -1066,6 +1137,9 @@ FilterClientCallbackImpl::~FilterClientCallbackImpl() {
     env->DeleteGlobalRef(mScramblingStatusEventClass);
     env->DeleteGlobalRef(mIpCidChangeEventClass);
     env->DeleteGlobalRef(mRestartEventClass);
+    if (mPackedEventsBuffer != nullptr) {
+        env->DeleteGlobalRef(mPackedEventsBuffer);
+    }
 }
 
 /////////////// FrontendClientCallbackImpl ///////////////////////
@@ -3699,6 +3773,20 @@ static void android_media_tv_Tuner_native_init(JNIEnv *env) {
     gFields.onSharedFilterEventID =
             env->GetMethodID(sharedFilterClazz, "onFilterEvent",
                              "([Landroid/media/tv/tuner/filter/FilterEvent;)V");
+    // Optional: filters that don't read packed events get event objects.
+    gFields.onFilterEventsPackedID =
+            env->GetMethodID(filterClazz, "onFilterEventsPacked", "(Ljava/nio/ByteBuffer;I)V");
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        gFields.onFilterEventsPackedID = nullptr;
+    }
+    gFields.onSharedFilterEventsPackedID =
+            env->GetMethodID(sharedFilterClazz, "onFilterEventsPacked",
+                             "(Ljava/nio/ByteBuffer;I)V");
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        gFields.onSharedFilterEventsPackedID = nullptr;
+    }
 
     jclass timeFilterClazz = env->FindClass("android/media/tv/tuner/filter/TimeFilter");
     gFields.timeFilterContext = env->GetFieldID(timeFilterClazz, "mNativeContext", "J");
@@ -4441,6 +4529,37 @@ static jint android_media_tv_Tuner_read_filter_fmq(
     return (jint)realReadSize;
 }
 
+// Reads from the filter FMQ straight into a direct ByteBuffer, without the copies in and out of
+// a Java array that GetByteArrayElements() makes.
+static jint android_media_tv_Tuner_read_filter_fmq_to_buffer(
+        JNIEnv *env, jobject filter, jobject buffer, jlong offset, jlong size) {
+    sp<FilterClient> filterClient = nullptr;
+    if (env->IsInstanceOf(filter, env->FindClass("android/media/tv/tuner/filter/SharedFilter"))) {
+        filterClient = getSharedFilterClient(env, filter);
+    } else {
+        filterClient = getFilterClient(env, filter);
+    }
+    if (filterClient == nullptr) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "Failed to read filter FMQ: filter client not found");
+        return -1;
+    }
+
+    int8_t *dst = static_cast<int8_t *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (dst == nullptr || capacity < 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "Failed to read filter FMQ: buffer is not a direct buffer");
+        return -1;
+    }
+    if (offset < 0 || size < 0 || offset > capacity - size) {
+        jniThrowException(env, "java/lang/IndexOutOfBoundsException",
+                "Failed to read filter FMQ: range is out of the buffer");
+        return -1;
+    }
+    return (jint)filterClient->read(dst + offset, size);
+}
+
 static jint android_media_tv_Tuner_close_filter(JNIEnv *env, jobject filter) {
     sp<FilterClient> filterClient = nullptr;
     bool shared = env->IsInstanceOf(
@@ -4958,6 +5077,28 @@ static jlong android_media_tv_Tuner_write_dvr_to_array(
     return (jlong)realSize;
 }
 
+// Fills stats with the bytes moved between the DVR and its file, the reads or writes that moved
+// data, those that the FMQ held back and the nanoseconds spent in file I/O.
+static void android_media_tv_Tuner_get_dvr_transfer_stats(
+        JNIEnv *env, jobject dvr, jlongArray stats) {
+    sp<DvrClient> dvrClient = getDvrClient(env, dvr);
+    if (dvrClient == nullptr) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+                "Failed to get dvr transfer stats: dvr client not found");
+        return;
+    }
+    if (stats == nullptr || env->GetArrayLength(stats) < 4) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "stats must hold 4 values");
+        return;
+    }
+
+    DvrTransferStats transferStats = dvrClient->getTransferStats();
+    jlong values[] = {transferStats.bytes, transferStats.transfers, transferStats.throttled,
+                      transferStats.ioTimeNs};
+    env->SetLongArrayRegion(stats, 0, NELEM(values), values);
+}
+
 static sp<MediaEvent> getMediaEventSp(JNIEnv *env, jobject mediaEventObj) {
     return (MediaEvent *)env->GetLongField(mediaEventObj, gFields.mediaEventContext);
 }
@@ -5108,6 +5249,12 @@ static const JNINativeMethod gFilterMethods[] = {
             (void *)android_media_tv_Tuner_set_filter_data_size_delay_hint},
 };
 
+// Registered only if Filter declares them.
+static const JNINativeMethod gFilterOptionalMethods[] = {
+    { "nativeRead", "(Ljava/nio/ByteBuffer;JJ)I",
+            (void *)android_media_tv_Tuner_read_filter_fmq_to_buffer},
+};
+
 static const JNINativeMethod gSharedFilterMethods[] = {
     { "nativeStartSharedFilter", "()I", (void *)android_media_tv_Tuner_start_filter},
     { "nativeStopSharedFilter", "()I", (void *)android_media_tv_Tuner_stop_filter},
@@ -5116,6 +5263,12 @@ static const JNINativeMethod gSharedFilterMethods[] = {
     { "nativeSharedClose", "()I", (void *)android_media_tv_Tuner_close_filter},
 };
 
+// Registered only if SharedFilter declares them.
+static const JNINativeMethod gSharedFilterOptionalMethods[] = {
+    { "nativeSharedRead", "(Ljava/nio/ByteBuffer;JJ)I",
+            (void *)android_media_tv_Tuner_read_filter_fmq_to_buffer},
+};
+
 static const JNINativeMethod gTimeFilterMethods[] = {
     { "nativeSetTimestamp", "(J)I", (void *)android_media_tv_Tuner_time_filter_set_timestamp },
     { "nativeClearTimestamp", "()I", (void *)android_media_tv_Tuner_time_filter_clear_timestamp },
@@ -5172,6 +5325,12 @@ static const JNINativeMethod gDvrPlaybackMethods[] = {
     { "nativeSeek", "(J)J", (void *)android_media_tv_Tuner_seek_dvr},
 };
 
+// Registered on DvrRecorder and DvrPlayback only if they declare them.
+static const JNINativeMethod gDvrTransferStatsMethods[] = {
+    { "nativeGetTransferStats", "([J)V",
+            (void *)android_media_tv_Tuner_get_dvr_transfer_stats},
+};
+
 static const JNINativeMethod gLnbMethods[] = {
     { "nativeSetVoltage", "(I)I", (void *)android_media_tv_Tuner_lnb_set_voltage },
     { "nativeSetTone", "(I)I", (void *)android_media_tv_Tuner_lnb_set_tone },
@@ -5202,6 +5361,8 @@ static bool register_android_media_tv_Tuner(JNIEnv *env) {
         ALOGE("Failed to register filter native methods");
         return false;
     }
+    RegisterOptionalMethods(env, "android/media/tv/tuner/filter/Filter",
+            gFilterOptionalMethods, NELEM(gFilterOptionalMethods));
     if (AndroidRuntime::registerNativeMethods(
             env, "android/media/tv/tuner/filter/SharedFilter",
             gSharedFilterMethods,
@@ -5209,6 +5370,8 @@ static bool register_android_media_tv_Tuner(JNIEnv *env) {
         ALOGE("Failed to register shared filter native methods");
         return false;
     }
+    RegisterOptionalMethods(env, "android/media/tv/tuner/filter/SharedFilter",
+            gSharedFilterOptionalMethods, NELEM(gSharedFilterOptionalMethods));
     if (AndroidRuntime::registerNativeMethods(
             env, "android/media/tv/tuner/filter/TimeFilter",
             gTimeFilterMethods,
@@ -5230,6 +5393,8 @@ static bool register_android_media_tv_Tuner(JNIEnv *env) {
         ALOGE("Failed to register dvr recorder native methods");
         return false;
     }
+    RegisterOptionalMethods(env, "android/media/tv/tuner/dvr/DvrRecorder",
+            gDvrTransferStatsMethods, NELEM(gDvrTransferStatsMethods));
     if (AndroidRuntime::registerNativeMethods(
             env, "android/media/tv/tuner/dvr/DvrPlayback",
             gDvrPlaybackMethods,
@@ -5237,6 +5402,8 @@ static bool register_android_media_tv_Tuner(JNIEnv *env) {
         ALOGE("Failed to register dvr playback native methods");
         return false;
     }
+    RegisterOptionalMethods(env, "android/media/tv/tuner/dvr/DvrPlayback",
+            gDvrTransferStatsMethods, NELEM(gDvrTransferStatsMethods));
     if (AndroidRuntime::registerNativeMethods(
             env, "android/media/tv/tuner/Lnb",
             gLnbMethods,
@@ -42,6 +42,7 @@
 #include <utils/RefBase.h>
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -124,6 +125,21 @@ struct MediaEvent : public RefBase {
     std::weak_ptr<C2Buffer> mC2Buffer;
 };
 
+/**
+ * A section or PES event as handed to Filter#onFilterEventsPacked(), in native byte order.
+ * Sections carry their table id, version and section number in fields, PES events their stream
+ * id and MPU sequence number.
+ */
+struct PackedFilterEvent {
+    static constexpr int32_t kSection = 0;
+    static constexpr int32_t kPes = 1;
+
+    int32_t type;
+    int32_t fields[3];
+    int64_t dataLength;
+};
+static_assert(sizeof(PackedFilterEvent) == 24, "Java reads PackedFilterEvents at 24 bytes");
+
 struct FilterClientCallbackImpl : public FilterClientCallback {
     FilterClientCallbackImpl();
     ~FilterClientCallbackImpl();
@@ -163,6 +179,13 @@ private:
     jmethodID mRestartEventInitID;
     jfieldID mMediaEventFieldContextID;
     bool mSharedFilter;
+    // Reused across callbacks; the direct ByteBuffer over it is only valid during one. Callbacks
+    // can come in on several binder threads, so they are packed and delivered under mMutex.
+    std::mutex mMutex;
+    std::unique_ptr<PackedFilterEvent[]> mPackedEvents;    // GUARDED_BY(mMutex)
+    size_t mPackedEventsCapacity = 0;                      // GUARDED_BY(mMutex)
+    jobject mPackedEventsBuffer = nullptr;                 // GUARDED_BY(mMutex)
+    bool packEvents(JNIEnv *env, const vector<DemuxFilterEvent>& events);
     void getSectionEvent(const jobjectArray& arr, const int size, const DemuxFilterEvent& event);
     void getMediaEvent(const jobjectArray& arr, const int size, const DemuxFilterEvent& event);
     void getPesEvent(const jobjectArray& arr, const int size, const DemuxFilterEvent& event);
@@ -45,6 +45,11 @@
 #include <stdio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 using namespace android;
 
 // ----------------------------------------------------------------------------
@@ -76,6 +81,10 @@ static jmethodID method_beginCopyObject;
 static jmethodID method_endCopyObject;
 static jmethodID method_getObjectReferences;
 static jmethodID method_setObjectReferences;
+// Optional; without it getObjectInfo() asks for each object on its own.
+static jmethodID method_getObjectInfos;
+
+static jclass class_String;
 
 // MtpDatabase fields.
 static jfieldID field_context;
@@ -126,6 +135,13 @@ static void initializeJavaIDs(JNIEnv* env) {
         GET_METHOD_ID(getObjectReferences, mdb_class, "(I)[I");
         GET_METHOD_ID(setObjectReferences, mdb_class, "(I[I)I");
         field_context = GetFieldIDOrDie(env, mdb_class, "mNativeContext", "J");
+        method_getObjectInfos = env->GetMethodID(mdb_class, "getObjectInfos",
+                "([I[I[J[Ljava/lang/String;[Ljava/lang/String;)Z");
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            method_getObjectInfos = NULL;
+        }
+        class_String = MakeGlobalRefOrDie(env, FindClassOrDie(env, "java/lang/String"));
 
         const jclass mpl_class = FindClassOrDie(env, "android/mtp/MtpPropertyList");
         GET_METHOD_ID(getCode, mpl_class, "()I");
@@ -151,11 +167,40 @@ IMtpDatabase* getMtpDatabase(JNIEnv *env, jobject database) {
 
 class MtpDatabase : public IMtpDatabase {
 private:
+    // What getObjectInfo() and getObjectFilePath() tell of an object, as fetched ahead of time
+    // by getObjectInfos().
+    struct CachedObjectInfo {
+        MtpStorageID    storageID;
+        MtpObjectFormat format;
+        MtpObjectHandle parent;
+        int64_t         dateCreated;
+        int64_t         dateModified;
+        int64_t         length;
+        // Negative when getObjectInfos() didn't read it.
+        int64_t         thumbSize;
+        int64_t         thumbWidth;
+        int64_t         thumbHeight;
+        std::string     name;
+        std::string     path;
+    };
+
     jobject         mDatabase;
     jintArray       mIntBuffer;
     jlongArray      mLongBuffer;
     jcharArray      mStringBuffer;
 
+    // Initiators list a folder with getObjectList() and then ask for the info of each object in
+    // turn. The handles of the last listing are kept so that the info of the next objects can be
+    // fetched in one upcall on the first miss, instead of three upcalls per object.
+    std::vector<MtpObjectHandle> mListedHandles;
+    std::unordered_map<MtpObjectHandle, size_t> mListedIndices;
+    std::unordered_map<MtpObjectHandle, CachedObjectInfo> mObjectInfoCache;
+
+    bool                            takeCachedObjectInfo(JNIEnv* env, MtpObjectHandle handle,
+                                            CachedObjectInfo& outInfo);
+    void                            fetchObjectInfos(JNIEnv* env, size_t start);
+    void                            invalidateObjectInfos();
+
 public:
                                     MtpDatabase(JNIEnv *env, jobject client);
     virtual                         ~MtpDatabase();
@@ -295,6 +340,104 @@ void MtpDatabase::cleanup(JNIEnv *env) {
 MtpDatabase::~MtpDatabase() {
 }
 
+// How many objects getObjectInfos() is asked about at a time.
+static constexpr size_t kObjectInfoBatchSize = 256;
+
+void MtpDatabase::invalidateObjectInfos() {
+    mListedHandles.clear();
+    mListedIndices.clear();
+    mObjectInfoCache.clear();
+}
+
+// Converts the UTF-16 of str like the strings read from mStringBuffer are. GetStringUTFChars()
+// gives modified UTF-8 instead, which encodes characters outside the BMP differently.
+static std::string toMtpString(JNIEnv* env, jstring str) {
+    const jsize length = env->GetStringLength(str);
+    std::vector<uint16_t> chars(length + 1);
+    env->GetStringRegion(str, 0, length, reinterpret_cast<jchar*>(chars.data()));
+    return std::string(static_cast<const char*>(MtpStringBuffer(chars.data())));
+}
+
+void MtpDatabase::fetchObjectInfos(JNIEnv* env, size_t start) {
+    mObjectInfoCache.clear();
+    size_t count = std::min(kObjectInfoBatchSize, mListedHandles.size() - start);
+
+    ScopedLocalRef<jintArray> handles(env, env->NewIntArray(count));
+    ScopedLocalRef<jintArray> intValues(env, env->NewIntArray(count * 3));
+    ScopedLocalRef<jlongArray> longValues(env, env->NewLongArray(count * 6));
+    ScopedLocalRef<jobjectArray> names(env, env->NewObjectArray(count, class_String, NULL));
+    ScopedLocalRef<jobjectArray> paths(env, env->NewObjectArray(count, class_String, NULL));
+    if (!handles.get() || !intValues.get() || !longValues.get() || !names.get() ||
+            !paths.get()) {
+        checkAndClearExceptionFromCallback(env, __FUNCTION__);
+        return;
+    }
+    static_assert(sizeof(jint) == sizeof(MtpObjectHandle),
+                  "MtpObjectHandles can't be copied into a jintArray");
+    env->SetIntArrayRegion(handles.get(), 0, count,
+            reinterpret_cast<const jint*>(&mListedHandles[start]));
+
+    bool found = env->CallBooleanMethod(mDatabase, method_getObjectInfos, handles.get(),
+            intValues.get(), longValues.get(), names.get(), paths.get());
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    if (!found) {
+        return;
+    }
+
+    std::vector<jint> ints(count * 3);
+    std::vector<jlong> longs(count * 6);
+    env->GetIntArrayRegion(intValues.get(), 0, ints.size(), ints.data());
+    env->GetLongArrayRegion(longValues.get(), 0, longs.size(), longs.data());
+    for (size_t i = 0; i < count; i++) {
+        // getObjectInfos() leaves the storage of objects it doesn't know at 0.
+        if (ints[i * 3] == 0) {
+            continue;
+        }
+        CachedObjectInfo info;
+        info.storageID = ints[i * 3];
+        info.format = ints[i * 3 + 1];
+        info.parent = ints[i * 3 + 2];
+        info.dateCreated = longs[i * 6];
+        info.dateModified = longs[i * 6 + 1];
+        info.length = longs[i * 6 + 2];
+        info.thumbSize = longs[i * 6 + 3];
+        info.thumbWidth = longs[i * 6 + 4];
+        info.thumbHeight = longs[i * 6 + 5];
+
+        ScopedLocalRef<jstring> name(env, (jstring)env->GetObjectArrayElement(names.get(), i));
+        ScopedLocalRef<jstring> path(env, (jstring)env->GetObjectArrayElement(paths.get(), i));
+        if (!name.get() || !path.get()) {
+            continue;
+        }
+        info.name = toMtpString(env, name.get());
+        info.path = toMtpString(env, path.get());
+        mObjectInfoCache.emplace(mListedHandles[start + i], std::move(info));
+    }
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+}
+
+bool MtpDatabase::takeCachedObjectInfo(JNIEnv* env, MtpObjectHandle handle,
+                                         CachedObjectInfo& outInfo) {
+    if (!method_getObjectInfos) {
+        return false;
+    }
+    auto cached = mObjectInfoCache.find(handle);
+    if (cached == mObjectInfoCache.end()) {
+        auto listed = mListedIndices.find(handle);
+        if (listed == mListedIndices.end()) {
+            return false;
+        }
+        fetchObjectInfos(env, listed->second);
+        cached = mObjectInfoCache.find(handle);
+        if (cached == mObjectInfoCache.end()) {
+            return false;
+        }
+    }
+    outInfo = std::move(cached->second);
+    mObjectInfoCache.erase(cached);
+    return true;
+}
+
 MtpObjectHandle MtpDatabase::beginSendObject(const char* path,
                                                MtpObjectFormat format,
                                                MtpObjectHandle parent,
@@ -313,6 +456,7 @@ MtpObjectHandle MtpDatabase::beginSendObject(const char* path,
 void MtpDatabase::endSendObject(MtpObjectHandle handle, bool succeeded) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->CallVoidMethod(mDatabase, method_endSendObject, (jint)handle, (jboolean)succeeded);
+    invalidateObjectInfos();
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -323,6 +467,7 @@ void MtpDatabase::rescanFile(const char* path, MtpObjectHandle handle,
     jstring pathStr = env->NewStringUTF(path);
     env->CallVoidMethod(mDatabase, method_rescanFile, pathStr,
                         (jint)handle, (jint)format);
+    invalidateObjectInfos();
 
     if (pathStr)
         env->DeleteLocalRef(pathStr);
@@ -345,6 +490,14 @@ MtpObjectHandleList* MtpDatabase::getObjectList(MtpStorageID storageID,
     env->ReleaseIntArrayElements(array, handles, 0);
     env->DeleteLocalRef(array);
 
+    if (method_getObjectInfos) {
+        invalidateObjectInfos();
+        mListedHandles.assign(list->begin(), list->end());
+        for (size_t i = 0; i < mListedHandles.size(); i++) {
+            mListedIndices.emplace(mListedHandles[i], i);
+        }
+    }
+
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
     return list;
 }
@@ -613,6 +766,7 @@ MtpResponseCode MtpDatabase::setObjectPropertyValue(MtpObjectHandle handle,
 
     result = env->CallIntMethod(mDatabase, method_setObjectProperty,
                 (jint)handle, (jint)property, longValue, stringValue);
+    invalidateObjectInfos();
     if (stringValue)
         env->DeleteLocalRef(stringValue);
 
@@ -838,41 +992,68 @@ MtpResponseCode MtpDatabase::getObjectInfo(MtpObjectHandle handle,
     MtpStringBuffer path;
     int64_t         length;
     MtpObjectFormat format;
-
-    MtpResponseCode result = getObjectFilePath(handle, path, length, format);
-    if (result != MTP_RESPONSE_OK) {
-        return result;
-    }
-    info.mCompressedSize = (length > 0xFFFFFFFFLL ? 0xFFFFFFFF : (uint32_t)length);
+    bool            thumbInfoKnown = false;
 
     JNIEnv* env = AndroidRuntime::getJNIEnv();
-    if (!env->CallBooleanMethod(mDatabase, method_getObjectInfo,
-                (jint)handle, mIntBuffer, mStringBuffer, mLongBuffer)) {
-        return MTP_RESPONSE_INVALID_OBJECT_HANDLE;
-    }
+    CachedObjectInfo cached;
+    if (takeCachedObjectInfo(env, handle, cached)) {
+        path.set(cached.path.c_str());
+        length = cached.length;
+        format = cached.format;
+        info.mCompressedSize = (length > 0xFFFFFFFFLL ? 0xFFFFFFFF : (uint32_t)length);
+        info.mStorageID = cached.storageID;
+        info.mFormat = cached.format;
+        info.mParent = cached.parent;
+        info.mDateCreated = cached.dateCreated;
+        info.mDateModified = cached.dateModified;
+        info.mAssociationType = MTP_ASSOCIATION_TYPE_UNDEFINED;
+        info.mName = strdup(cached.name.c_str());
+        if (cached.thumbSize >= 0) {
+            thumbInfoKnown = true;
+            if (cached.thumbSize > 0 && cached.thumbSize <= UINT32_MAX &&
+                    cached.thumbWidth > 0 && cached.thumbWidth <= UINT32_MAX &&
+                    cached.thumbHeight > 0 && cached.thumbHeight <= UINT32_MAX) {
+                info.mThumbCompressedSize = cached.thumbSize;
+                info.mThumbFormat = MTP_FORMAT_EXIF_JPEG;
+                info.mImagePixWidth = cached.thumbWidth;
+                info.mImagePixHeight = cached.thumbHeight;
+            }
+        }
+    } else {
+        MtpResponseCode result = getObjectFilePath(handle, path, length, format);
+        if (result != MTP_RESPONSE_OK) {
+            return result;
+        }
+        info.mCompressedSize = (length > 0xFFFFFFFFLL ? 0xFFFFFFFF : (uint32_t)length);
 
-    jint* intValues = env->GetIntArrayElements(mIntBuffer, 0);
-    info.mStorageID = intValues[0];
-    info.mFormat = intValues[1];
-    info.mParent = intValues[2];
-    env->ReleaseIntArrayElements(mIntBuffer, intValues, 0);
+        if (!env->CallBooleanMethod(mDatabase, method_getObjectInfo,
+                    (jint)handle, mIntBuffer, mStringBuffer, mLongBuffer)) {
+            return MTP_RESPONSE_INVALID_OBJECT_HANDLE;
+        }
 
-    jlong* longValues = env->GetLongArrayElements(mLongBuffer, 0);
-    info.mDateCreated = longValues[0];
-    info.mDateModified = longValues[1];
-    env->ReleaseLongArrayElements(mLongBuffer, longValues, 0);
+        jint* intValues = env->GetIntArrayElements(mIntBuffer, 0);
+        info.mStorageID = intValues[0];
+        info.mFormat = intValues[1];
+        info.mParent = intValues[2];
+        env->ReleaseIntArrayElements(mIntBuffer, intValues, 0);
+
+        jlong* longValues = env->GetLongArrayElements(mLongBuffer, 0);
+        info.mDateCreated = longValues[0];
+        info.mDateModified = longValues[1];
+        env->ReleaseLongArrayElements(mLongBuffer, longValues, 0);
+
+        if ((false)) {
+            info.mAssociationType = (format == MTP_FORMAT_ASSOCIATION ?
+                                    MTP_ASSOCIATION_TYPE_GENERIC_FOLDER :
+                                    MTP_ASSOCIATION_TYPE_UNDEFINED);
+        }
+        info.mAssociationType = MTP_ASSOCIATION_TYPE_UNDEFINED;
 
-    if ((false)) {
-        info.mAssociationType = (format == MTP_FORMAT_ASSOCIATION ?
-                                MTP_ASSOCIATION_TYPE_GENERIC_FOLDER :
-                                MTP_ASSOCIATION_TYPE_UNDEFINED);
+        jchar* str = env->GetCharArrayElements(mStringBuffer, 0);
+        MtpStringBuffer temp(str);
+        info.mName = strdup(temp);
+        env->ReleaseCharArrayElements(mStringBuffer, str, 0);
     }
-    info.mAssociationType = MTP_ASSOCIATION_TYPE_UNDEFINED;
-
-    jchar* str = env->GetCharArrayElements(mStringBuffer, 0);
-    MtpStringBuffer temp(str);
-    info.mName = strdup(temp);
-    env->ReleaseCharArrayElements(mStringBuffer, str, 0);
 
     // read EXIF data for thumbnail information
     switch (info.mFormat) {
@@ -883,7 +1064,7 @@ MtpResponseCode MtpDatabase::getObjectInfo(MtpObjectHandle handle,
         case MTP_FORMAT_BMP:
         case MTP_FORMAT_GIF: {
             env = AndroidRuntime::getJNIEnv();
-            if (env->CallBooleanMethod(
+            if (!thumbInfoKnown && env->CallBooleanMethod(
                     mDatabase, method_getThumbnailInfo, (jint)handle, mLongBuffer)) {
 
                 jlong* longValues = env->GetLongArrayElements(mLongBuffer, 0);
@@ -1049,6 +1230,7 @@ MtpResponseCode MtpDatabase::beginDeleteObject(MtpObjectHandle handle) {
 void MtpDatabase::endDeleteObject(MtpObjectHandle handle, bool succeeded) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->CallVoidMethod(mDatabase, method_endDeleteObject, (jint)handle, (jboolean) succeeded);
+    invalidateObjectInfos();
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -1070,6 +1252,7 @@ void MtpDatabase::endMoveObject(MtpObjectHandle oldParent, MtpObjectHandle newPa
     env->CallVoidMethod(mDatabase, method_endMoveObject,
                 (jint)oldParent, (jint) newParent, (jint) oldStorage, (jint) newStorage,
                 (jint) handle, (jboolean) succeeded);
+    invalidateObjectInfos();
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -1087,6 +1270,7 @@ MtpResponseCode MtpDatabase::beginCopyObject(MtpObjectHandle handle, MtpObjectHa
 void MtpDatabase::endCopyObject(MtpObjectHandle handle, bool succeeded) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->CallVoidMethod(mDatabase, method_endCopyObject, (jint)handle, (jboolean)succeeded);
+    invalidateObjectInfos();
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -20,10 +20,15 @@
 #define LOG_TAG "Visualizer"
 #include <utils/Log.h>
 
+#include <math.h>
 #include <stdint.h>
 #include <sys/types.h>
 #include <limits.h>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <audio_utils/fixedfft.h>
 #include <cutils/bitops.h>
 #include <utils/Thread.h>
@@ -326,9 +331,54 @@ status_t Visualizer::getFft(uint8_t *fft)
     return status;
 }
 
-status_t Visualizer::doFft(uint8_t *fft, uint8_t *waveform)
+status_t Visualizer::getFftMagnitudes(float *magnitudes)
+{
+    if (magnitudes == NULL) {
+        return BAD_VALUE;
+    }
+    if (mCaptureSize == 0) {
+        return NO_INIT;
+    }
+
+    const uint32_t bins = mCaptureSize >> 1;
+    if (!mEnabled) {
+        memset(magnitudes, 0, bins * sizeof(float));
+        return NO_ERROR;
+    }
+    uint8_t waveform[mCaptureSize];
+    status_t status = getWaveForm(waveform);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    int32_t workspace[bins];
+    computeFft(workspace, waveform);
+
+    // Each int32_t holds the real part of a bin in its top half and the imaginary part in its
+    // bottom half, except the first, which holds the DC and Nyquist terms.
+    constexpr float kScale = 1.0f / 32768.0f;
+    uint32_t i = 0;
+#if defined(__aarch64__)
+    // 32-bit NEON has no vector square root.
+    const float32x4_t scale = vdupq_n_f32(kScale);
+    for (; i + 4 <= bins; i += 4) {
+        const int32x4_t packed = vld1q_s32(workspace + i);
+        const float32x4_t re = vcvtq_f32_s32(vshrq_n_s32(packed, 16));
+        const float32x4_t im = vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(packed, 16), 16));
+        const float32x4_t power = vmlaq_f32(vmulq_f32(re, re), im, im);
+        vst1q_f32(magnitudes + i, vmulq_f32(vsqrtq_f32(power), scale));
+    }
+#endif
+    for (; i < bins; i++) {
+        const float re = static_cast<int16_t>(workspace[i] >> 16);
+        const float im = static_cast<int16_t>(workspace[i] & 0xffff);
+        magnitudes[i] = sqrtf(re * re + im * im) * kScale;
+    }
+    magnitudes[0] = fabsf(static_cast<float>(static_cast<int16_t>(workspace[0] >> 16))) * kScale;
+    return NO_ERROR;
+}
+
+void Visualizer::computeFft(int32_t *workspace, const uint8_t *waveform)
 {
-    int32_t workspace[mCaptureSize >> 1];
     int32_t nonzero = 0;
 
     for (uint32_t i = 0; i < mCaptureSize; i += 2) {
@@ -340,6 +390,12 @@ status_t Visualizer::doFft(uint8_t *fft, uint8_t *waveform)
     if (nonzero) {
         fixed_fft_real(mCaptureSize >> 1, workspace);
     }
+}
+
+status_t Visualizer::doFft(uint8_t *fft, uint8_t *waveform)
+{
+    int32_t workspace[mCaptureSize >> 1];
+    computeFft(workspace, waveform);
 
     for (uint32_t i = 0; i < mCaptureSize; i += 2) {
         short tmp = workspace[i >> 1] >> 21;
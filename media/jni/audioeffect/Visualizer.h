@@ -141,6 +141,11 @@ public:
     // getCaptureSize() but the length of the FFT is half of the size (both parts of the spectrum
     // are returned
     status_t getFft(uint8_t *fft);
+
+    // return the magnitude of each bin of the FFT of a capture, relative to full scale and
+    // without the 8 bit quantization of getFft(). The number of bins is half of getCaptureSize();
+    // the first holds the DC term.
+    status_t getFftMagnitudes(float *magnitudes);
     void release();
 
 protected:
@@ -168,6 +173,8 @@ private:
         uint32_t mSleepTimeUs;
     };
 
+    // fills workspace, getCaptureSize() / 2 values, with the packed FFT of waveform
+    void computeFft(int32_t *workspace, const uint8_t *waveform);
     status_t doFft(uint8_t *fft, uint8_t *waveform);
     void periodicCapture();
     uint32_t initCaptureSize();
@@ -199,9 +199,7 @@ static void captureCallback(void* user,
         jArray = callbackInfo->waveform_data;
 
         if (jArray != NULL) {
-            jbyte *nArray = env->GetByteArrayElements(jArray, NULL);
-            memcpy(nArray, waveform, waveformSize);
-            env->ReleaseByteArrayElements(jArray, nArray, 0);
+            env->SetByteArrayRegion(jArray, 0, waveformSize, reinterpret_cast<jbyte *>(waveform));
             env->CallStaticVoidMethod(
                 callbackInfo->visualizer_class,
                 fields.midPostNativeEvent,
@@ -219,9 +217,7 @@ static void captureCallback(void* user,
         jArray = callbackInfo->fft_data;
 
         if (jArray != NULL) {
-            jbyte *nArray = env->GetByteArrayElements(jArray, NULL);
-            memcpy(nArray, fft, fftSize);
-            env->ReleaseByteArrayElements(jArray, nArray, 0);
+            env->SetByteArrayRegion(jArray, 0, fftSize, reinterpret_cast<jbyte *>(fft));
             env->CallStaticVoidMethod(
                 callbackInfo->visualizer_class,
                 fields.midPostNativeEvent,
@@ -660,13 +656,20 @@ android_media_visualizer_native_getWaveForm(JNIEnv *env, jobject thiz, jbyteArra
         return VISUALIZER_ERROR_NO_INIT;
     }
 
-    jbyte* nWaveform = env->GetByteArrayElements(jWaveform, nullptr /* isCopy */);
-    if (nWaveform == NULL) {
-        return VISUALIZER_ERROR_NO_MEMORY;
+    // Capture on the stack and copy once, rather than have GetByteArrayElements() copy the array
+    // in and out.
+    const uint32_t size = lpVisualizer->getCaptureSize();
+    if (size == 0) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
+    if (env->GetArrayLength(jWaveform) < static_cast<jsize>(size)) {
+        return VISUALIZER_ERROR_BAD_VALUE;
+    }
+    uint8_t nWaveform[size];
+    jint status = translateError(lpVisualizer->getWaveForm(nWaveform));
+    if (status == VISUALIZER_SUCCESS) {
+        env->SetByteArrayRegion(jWaveform, 0, size, reinterpret_cast<jbyte *>(nWaveform));
     }
-    jint status = translateError(lpVisualizer->getWaveForm((uint8_t *)nWaveform));
-
-    env->ReleaseByteArrayElements(jWaveform, nWaveform, 0 /* mode */);
     return status;
 }
 
@@ -678,14 +681,41 @@ android_media_visualizer_native_getFft(JNIEnv *env, jobject thiz, jbyteArray jFf
         return VISUALIZER_ERROR_NO_INIT;
     }
 
-    jbyte* nFft = env->GetByteArrayElements(jFft, nullptr /* isCopy */);
-    if (nFft == NULL) {
-        return VISUALIZER_ERROR_NO_MEMORY;
+    const uint32_t size = lpVisualizer->getCaptureSize();
+    if (size == 0) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
+    if (env->GetArrayLength(jFft) < static_cast<jsize>(size)) {
+        return VISUALIZER_ERROR_BAD_VALUE;
     }
-    jint status = translateError(lpVisualizer->getFft((uint8_t *)nFft));
+    uint8_t nFft[size];
+    jint status = translateError(lpVisualizer->getFft(nFft));
+    if (status == VISUALIZER_SUCCESS) {
+        env->SetByteArrayRegion(jFft, 0, size, reinterpret_cast<jbyte *>(nFft));
+    }
+    return status;
+}
 
-    env->ReleaseByteArrayElements(jFft, nFft, 0 /* mode */);
+static jint
+android_media_visualizer_native_getFftMagnitudes(JNIEnv *env, jobject thiz, jfloatArray jMagnitudes)
+{
+    sp<Visualizer> lpVisualizer = getVisualizer(env, thiz);
+    if (lpVisualizer == 0) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
 
+    const uint32_t bins = lpVisualizer->getCaptureSize() / 2;
+    if (bins == 0) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
+    if (env->GetArrayLength(jMagnitudes) < static_cast<jsize>(bins)) {
+        return VISUALIZER_ERROR_BAD_VALUE;
+    }
+    float nMagnitudes[bins];
+    jint status = translateError(lpVisualizer->getFftMagnitudes(nMagnitudes));
+    if (status == VISUALIZER_SUCCESS) {
+        env->SetFloatArrayRegion(jMagnitudes, 0, bins, nMagnitudes);
+    }
     return status;
 }
 
@@ -760,6 +790,7 @@ static const JNINativeMethod gMethods[] = {
     {"native_getSamplingRate",   "()I",   (void *)android_media_visualizer_native_getSamplingRate},
     {"native_getWaveForm",       "([B)I", (void *)android_media_visualizer_native_getWaveForm},
     {"native_getFft",            "([B)I", (void *)android_media_visualizer_native_getFft},
+    {"native_getFftMagnitudes",  "([F)I", (void *)android_media_visualizer_native_getFftMagnitudes},
     {"native_getPeakRms",      "(Landroid/media/audiofx/Visualizer$MeasurementPeakRms;)I",
                                           (void *)android_media_visualizer_native_getPeakRms},
     {"native_setPeriodicCapture","(IZZ)I",(void *)android_media_setPeriodicCapture},
@@ -20,6 +20,13 @@
 
 #include "Sound.h"
 
+#include <sys/stat.h>
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include <android-base/thread_annotations.h>
 #include <media/NdkMediaCodec.h>
 #include <media/NdkMediaExtractor.h>
 #include <media/NdkMediaFormat.h>
@@ -29,11 +36,99 @@ namespace android::soundpool {
 constexpr uint32_t kMaxSampleRate = 192000;
 constexpr size_t   kDefaultHeapSize = 1024 * 1024; // 1MB (compatible with low mem devices)
 
+// The result of decoding a sound, immutable once in the DecodedPcmCache.
+struct DecodedPcm {
+    sp<MemoryHeapBase>   heap;
+    sp<IMemory>          data;
+    size_t               sizeInBytes = 0;
+    uint32_t             sampleRate = 0;
+    int32_t              channelCount = 0;
+    audio_format_t       format = AUDIO_FORMAT_INVALID;
+    audio_channel_mask_t channelMask = AUDIO_CHANNEL_NONE;
+};
+
+namespace {
+
+// Identifies the bytes a sound is decoded from: the file, as long as it isn't modified, and the
+// range of it that holds the sound.
+struct PcmKey {
+    dev_t   device;
+    ino_t   inode;
+    off_t   fileSize;
+    int64_t modifiedNs;
+    int64_t offset;
+    int64_t length;
+
+    bool operator==(const PcmKey& other) const {
+        return device == other.device && inode == other.inode && fileSize == other.fileSize
+                && modifiedNs == other.modifiedNs && offset == other.offset
+                && length == other.length;
+    }
+};
+
+struct PcmKeyHash {
+    size_t operator()(const PcmKey& key) const {
+        size_t hash = std::hash<uint64_t>{}(key.inode);
+        for (uint64_t value : {(uint64_t)key.device, (uint64_t)key.fileSize,
+                (uint64_t)key.modifiedNs, (uint64_t)key.offset, (uint64_t)key.length}) {
+            hash = hash * 31 + std::hash<uint64_t>{}(value);
+        }
+        return hash;
+    }
+};
+
+std::optional<PcmKey> getPcmKey(int fd, int64_t offset, int64_t length) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return std::nullopt; // pipes and sockets can't be read twice.
+    }
+    return PcmKey{st.st_dev, st.st_ino, st.st_size,
+            (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec, offset, length};
+}
+
+// Process-wide, so that the SoundPools of an app loading the same clicks and UI sounds keep
+// one copy of their PCM. It only holds weak references: the PCM goes away with its last Sound.
+class DecodedPcmCache {
+public:
+    std::shared_ptr<const DecodedPcm> find(const PcmKey& key) {
+        std::lock_guard lock(mLock);
+        auto it = mEntries.find(key);
+        return it != mEntries.end() ? it->second.lock() : nullptr;
+    }
+
+    // Returns the PCM to use for |key|: |pcm|, or the one another thread decoded meanwhile.
+    std::shared_ptr<const DecodedPcm> insert(const PcmKey& key,
+            std::shared_ptr<const DecodedPcm> pcm) {
+        std::lock_guard lock(mLock);
+        for (auto it = mEntries.begin(); it != mEntries.end();) {
+            it = it->second.expired() ? mEntries.erase(it) : std::next(it);
+        }
+        auto [it, inserted] = mEntries.emplace(key, pcm);
+        if (!inserted) {
+            return it->second.lock(); // not expired, as expired entries were just erased.
+        }
+        return pcm;
+    }
+
+private:
+    std::mutex mLock;
+    std::unordered_map<PcmKey, std::weak_ptr<const DecodedPcm>, PcmKeyHash> mEntries
+            GUARDED_BY(mLock);
+};
+
+DecodedPcmCache& getDecodedPcmCache() {
+    static DecodedPcmCache* const cache = new DecodedPcmCache(); // never destroyed.
+    return *cache;
+}
+
+} // namespace
+
 Sound::Sound(int32_t soundID, int fd, int64_t offset, int64_t length)
     : mSoundID(soundID)
     , mFd(fcntl(fd, F_DUPFD_CLOEXEC, (int)0 /* arg */)) // dup(fd) + close on exec to prevent leaks.
     , mOffset(offset)
     , mLength(length)
+    , mLoadTimeNs(systemTime())
 {
     ALOGV("%s(soundID=%d, fd=%d, offset=%lld, length=%lld)",
             __func__, soundID, fd, (long long)offset, (long long)length);
@@ -199,36 +294,57 @@ status_t Sound::doLoad()
 {
     ALOGV("%s()", __func__);
     status_t status = NO_INIT;
+    const nsecs_t startTimeNs = systemTime();
+    mQueuedTimeNs = startTimeNs - mLoadTimeNs;
     if (mFd.get() != -1) {
-        mHeap = new MemoryHeapBase(kDefaultHeapSize);
-
-        ALOGV("%s: start decode", __func__);
-        uint32_t sampleRate;
-        int32_t channelCount;
-        audio_format_t format;
-        audio_channel_mask_t channelMask;
-        status = decode(mFd.get(), mOffset, mLength, &sampleRate, &channelCount, &format,
-                        &channelMask, mHeap, &mSizeInBytes);
+        const std::optional<PcmKey> key = getPcmKey(mFd.get(), mOffset, mLength);
+        std::shared_ptr<const DecodedPcm> pcm;
+        if (key.has_value()) {
+            pcm = getDecodedPcmCache().find(*key);
+        }
+        if (pcm != nullptr) {
+            ALOGV("%s: reusing pcm decoded for another sound", __func__);
+            status = NO_ERROR;
+        } else {
+            auto decoded = std::make_shared<DecodedPcm>();
+            decoded->heap = new MemoryHeapBase(kDefaultHeapSize);
+
+            ALOGV("%s: start decode", __func__);
+            status = decode(mFd.get(), mOffset, mLength, &decoded->sampleRate,
+                            &decoded->channelCount, &decoded->format, &decoded->channelMask,
+                            decoded->heap, &decoded->sizeInBytes);
+
+            if (status != NO_ERROR) {
+                ALOGE("%s: unable to load sound", __func__);
+            } else if (decoded->sampleRate > kMaxSampleRate) {
+                ALOGE("%s: sample rate (%u) out of range", __func__, decoded->sampleRate);
+                status = BAD_VALUE;
+            } else if (decoded->channelCount < 1 || decoded->channelCount > FCC_LIMIT) {
+                ALOGE("%s: sample channel count (%d) out of range",
+                        __func__, decoded->channelCount);
+                status = BAD_VALUE;
+            } else {
+                // Correctly loaded, proper parameters
+                decoded->data = new MemoryBase(decoded->heap, 0, decoded->sizeInBytes);
+                pcm = key.has_value() ? getDecodedPcmCache().insert(*key, std::move(decoded))
+                                      : std::move(decoded);
+            }
+        }
         ALOGV("%s: close(%d)", __func__, mFd.get());
         mFd.reset();  // close
 
-        if (status != NO_ERROR) {
-            ALOGE("%s: unable to load sound", __func__);
-        } else if (sampleRate > kMaxSampleRate) {
-            ALOGE("%s: sample rate (%u) out of range", __func__, sampleRate);
-            status = BAD_VALUE;
-        } else if (channelCount < 1 || channelCount > FCC_LIMIT) {
-            ALOGE("%s: sample channel count (%d) out of range", __func__, channelCount);
-            status = BAD_VALUE;
-        } else {
-            // Correctly loaded, proper parameters
+        if (pcm != nullptr) {
             ALOGV("%s: pointer = %p, sizeInBytes = %zu, sampleRate = %u, channelCount = %d",
-                  __func__, mHeap->getBase(), mSizeInBytes, sampleRate, channelCount);
-            mData = new MemoryBase(mHeap, 0, mSizeInBytes);
-            mSampleRate = sampleRate;
-            mChannelCount = channelCount;
-            mFormat = format;
-            mChannelMask = channelMask;
+                  __func__, pcm->heap->getBase(), pcm->sizeInBytes, pcm->sampleRate,
+                  pcm->channelCount);
+            mData = pcm->data;
+            mSizeInBytes = pcm->sizeInBytes;
+            mSampleRate = pcm->sampleRate;
+            mChannelCount = pcm->channelCount;
+            mFormat = pcm->format;
+            mChannelMask = pcm->channelMask;
+            mPcm = std::move(pcm);
+            mDecodeTimeNs = systemTime() - startTimeNs;
             mState = READY;  // this should be last, as it is an atomic sync point
             return NO_ERROR;
         }
@@ -236,7 +352,7 @@ status_t Sound::doLoad()
         ALOGE("%s: uninitialized fd, dup failed", __func__);
     }
     // ERROR handling
-    mHeap.clear();
+    mDecodeTimeNs = systemTime() - startTimeNs;
     mState = DECODE_ERROR; // this should be last, as it is an atomic sync point
     return status;
 }
@@ -20,10 +20,14 @@
 #include <binder/MemoryBase.h>
 #include <binder/MemoryHeapBase.h>
 #include <system/audio.h>
+#include <utils/Timers.h>
+
+#include <memory>
 
 namespace android::soundpool {
 
 class SoundDecoder;
+struct DecodedPcm;
 
 /**
  * Sound is a resource used by SoundPool, referenced by soundID.
@@ -51,6 +55,10 @@ class SoundDecoder;
  *
  * See https://developer.android.com/training/articles/smp for discussions about
  * the variant load-acquire, store-release semantics.
+ *
+ * The decoded PCM is shared, through a process-wide cache, by all the Sounds of all the
+ * SoundPools loaded from the same unchanged file at the same offset and length; it is
+ * freed when the last of them is.
  */
 class Sound {
     friend SoundDecoder;  // calls doLoad().
@@ -72,6 +80,9 @@ public:
     sound_state getState() const { return mState; }
     uint8_t* getData() const { return static_cast<uint8_t*>(mData->unsecurePointer()); }
     sp<IMemory> getIMemory() const { return mData; }
+    // Once not LOADING: how long the sound waited for a decoder thread, and then took to decode.
+    int64_t getQueuedTimeNs() const { return mQueuedTimeNs; }
+    int64_t getDecodeTimeNs() const { return mDecodeTimeNs; }
 
 private:
     status_t doLoad();  // only SoundDecoder accesses this.
@@ -86,8 +97,11 @@ private:
     base::unique_fd      mFd;     // initialized in constructor, reset to -1 after loading
     const int64_t        mOffset; // int64_t to match java long, see off64_t
     const int64_t        mLength; // int64_t to match java long, see off64_t
+    const nsecs_t        mLoadTimeNs;  // when load() was called
+    int64_t              mQueuedTimeNs = 0;
+    int64_t              mDecodeTimeNs = 0;
     sp<IMemory>          mData;
-    sp<MemoryHeapBase>   mHeap;
+    std::shared_ptr<const DecodedPcm> mPcm; // owns mData, possibly shared with other Sounds
 };
 
 } // namespace android::soundpool
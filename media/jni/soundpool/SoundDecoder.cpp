@@ -71,8 +71,8 @@ void SoundDecoder::run(int32_t id)
             }
             continue;
         }
-        const int32_t soundID = mSoundIDs.front();
-        mSoundIDs.pop_front();
+        const int32_t soundID = mSoundIDs.top().soundID;
+        mSoundIDs.pop();
         mQueueSpaceAvailable.notify_one();
         ALOGV("%s(%d): processing soundID: %d  size: %zu", __func__, id, soundID, mSoundIDs.size());
         lock.unlock();
@@ -80,6 +80,9 @@ void SoundDecoder::run(int32_t id)
         status_t status = NO_INIT;
         if (sound.get() != nullptr) {
             status = sound->doLoad();
+            ALOGV("%s(%d): soundID:%d  queued for %lld ns, decoded in %lld ns",
+                    __func__, id, soundID, (long long)sound->getQueuedTimeNs(),
+                    (long long)sound->getDecodeTimeNs());
         }
         ALOGV("%s(%d): notifying loaded soundID:%d  status:%d", __func__, id, soundID, status);
         mSoundManager->notify(SoundPoolEvent(SoundPoolEvent::SOUND_LOADED, soundID, status));
@@ -88,9 +91,9 @@ void SoundDecoder::run(int32_t id)
     ALOGV("%s(%d): exiting", __func__, id);
 }
 
-void SoundDecoder::loadSound(int32_t soundID)
+void SoundDecoder::loadSound(int32_t soundID, int32_t priority)
 {
-    ALOGV("%s(%d)", __func__, soundID);
+    ALOGV("%s(%d, %d)", __func__, soundID, priority);
     size_t pendingSounds;
     {
         std::unique_lock lock(mLock);
@@ -100,7 +103,7 @@ void SoundDecoder::loadSound(int32_t soundID)
             mQueueSpaceAvailable.wait(lock);
         }
         if (mQuit) return;
-        mSoundIDs.push_back(soundID);
+        mSoundIDs.push({priority, mNextSequence++, soundID});
         mQueueDataAvailable.notify_one();
         ALOGV("%s: adding soundID: %d  size: %zu", __func__, soundID, mSoundIDs.size());
         pendingSounds = mSoundIDs.size();
@@ -18,8 +18,9 @@
 
 #include "SoundPool.h"
 
-#include <deque>
 #include <mutex>
+#include <queue>
+#include <vector>
 
 namespace android::soundpool {
 
@@ -30,10 +31,24 @@ class SoundDecoder {
 public:
     SoundDecoder(SoundManager* soundManager, size_t threads);
     ~SoundDecoder();
-    void loadSound(int32_t soundID) NO_THREAD_SAFETY_ANALYSIS; // uses unique_lock
+    // Sounds of higher priority are decoded first, sounds of equal priority in load order.
+    void loadSound(int32_t soundID, int32_t priority)
+            NO_THREAD_SAFETY_ANALYSIS; // uses unique_lock
     void quit();
 
 private:
+    struct PendingSound {
+        int32_t  priority;
+        uint64_t sequence;
+        int32_t  soundID;
+
+        // std::priority_queue puts the greatest first.
+        bool operator<(const PendingSound& other) const {
+            return priority != other.priority ? priority < other.priority
+                                              : sequence > other.sequence;
+        }
+    };
+
     // The decode thread function.
     void run(int32_t id) NO_THREAD_SAFETY_ANALYSIS; // uses unique_lock
 
@@ -44,7 +59,8 @@ private:
     std::condition_variable mQueueSpaceAvailable GUARDED_BY(mLock);
     std::condition_variable mQueueDataAvailable GUARDED_BY(mLock);
 
-    std::deque<int32_t>     mSoundIDs GUARDED_BY(mLock);
+    std::priority_queue<PendingSound, std::vector<PendingSound>> mSoundIDs GUARDED_BY(mLock);
+    uint64_t                mNextSequence GUARDED_BY(mLock) = 0;
     bool                    mQuit GUARDED_BY(mLock) = false;
 };
 
@@ -28,10 +28,11 @@ namespace android::soundpool {
 
 static const size_t kDecoderThreads = std::thread::hardware_concurrency() >= 4 ? 2 : 1;
 
-SoundManager::SoundManager()
-    : mDecoder{std::make_unique<SoundDecoder>(this, kDecoderThreads)}
+SoundManager::SoundManager(size_t decoderThreads)
+    : mDecoder{std::make_unique<SoundDecoder>(
+            this, decoderThreads != 0 ? decoderThreads : kDecoderThreads)}
 {
-    ALOGV("%s()", __func__);
+    ALOGV("%s(%zu)", __func__, decoderThreads);
 }
 
 SoundManager::~SoundManager()
@@ -63,7 +64,7 @@ int32_t SoundManager::load(int fd, int64_t offset, int64_t length, int32_t prior
     // the message queue emptying may block on SoundManager::findSound().
     //
     // It is theoretically possible that sound loads might decode out-of-order.
-    mDecoder->loadSound(soundID);
+    mDecoder->loadSound(soundID, priority);
     return soundID;
 }
 
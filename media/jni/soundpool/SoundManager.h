@@ -48,7 +48,8 @@ namespace android::soundpool {
 // This class manages Sounds for the SoundPool.
 class SoundManager {
 public:
-    SoundManager();
+    // decoderThreads of 0 picks a default for the device.
+    explicit SoundManager(size_t decoderThreads = 0);
     ~SoundManager();
 
     // Matches corresponding SoundPool API functions
@@ -86,11 +86,13 @@ bool checkLoop(int32_t *loop)
 
 SoundPool::SoundPool(
         int32_t maxStreams, const audio_attributes_t& attributes,
-        const std::string& opPackageName)
-    : mStreamManager(maxStreams, kStreamManagerThreads, attributes, opPackageName)
+        const std::string& opPackageName, int32_t decoderThreads)
+    : mSoundManager(std::max(decoderThreads, 0))
+    , mStreamManager(maxStreams, kStreamManagerThreads, attributes, opPackageName)
 {
-    ALOGV("%s(maxStreams=%d, attr={ content_type=%d, usage=%d, flags=0x%x, tags=%s })",
-            __func__, maxStreams,
+    ALOGV("%s(maxStreams=%d, decoderThreads=%d,"
+            " attr={ content_type=%d, usage=%d, flags=0x%x, tags=%s })",
+            __func__, maxStreams, decoderThreads,
             attributes.content_type, attributes.usage, attributes.flags, attributes.tags);
 }
 
@@ -245,4 +247,24 @@ void* SoundPool::getUserData() const
     return mSoundManager.getUserData();
 }
 
+void SoundPool::getTrackStats(
+        int64_t* creations, int64_t* reuses, int64_t* creationTimeNs) const
+{
+    ALOGV("%s()", __func__);
+    mStreamManager.getTrackStats(creations, reuses, creationTimeNs);
+}
+
+bool SoundPool::getLoadTimes(
+        int32_t soundID, int64_t* queuedTimeNs, int64_t* decodeTimeNs) const
+{
+    ALOGV("%s(%d)", __func__, soundID);
+    const std::shared_ptr<soundpool::Sound> sound = mSoundManager.findSound(soundID);
+    if (sound == nullptr || sound->getState() == soundpool::Sound::LOADING) {
+        return false;
+    }
+    *queuedTimeNs = sound->getQueuedTimeNs();
+    *decodeTimeNs = sound->getDecodeTimeNs();
+    return true;
+}
+
 } // end namespace android
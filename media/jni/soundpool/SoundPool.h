@@ -31,8 +31,9 @@ namespace android {
  */
 class SoundPool {
 public:
+    // decoderThreads caps how many sounds are decoded in parallel, 0 for the default.
     SoundPool(int32_t maxStreams, const audio_attributes_t& attributes,
-            const std::string& opPackageName = {});
+            const std::string& opPackageName = {}, int32_t decoderThreads = 0);
     ~SoundPool();
 
     // SoundPool Java API support
@@ -51,6 +52,10 @@ public:
     void setRate(int32_t streamID, float rate);
     void setCallback(SoundPoolCallback* callback, void* user);
     void* getUserData() const;
+    // How many plays created an AudioTrack, in how long overall, and how many reused one.
+    void getTrackStats(int64_t* creations, int64_t* reuses, int64_t* creationTimeNs) const;
+    // Returns false if the sound isn't loaded yet.
+    bool getLoadTimes(int32_t soundID, int64_t* queuedTimeNs, int64_t* decodeTimeNs) const;
 
     // not exposed in the public Java API, used for internal playerSetVolume() muting.
     void mute(bool muting);
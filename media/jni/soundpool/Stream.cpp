@@ -300,6 +300,7 @@ void Stream::play_l(const std::shared_ptr<Sound>& sound, int32_t nextStreamID,
             // the sample rate may fail to change if the audio track is a fast track.
             ALOGV("%s: reusing track %p for sound %d",
                     __func__, mAudioTrack.get(), sound->getSoundID());
+            mStreamManager->recordTrackReused();
         } else {
             // If reuse not possible, move mAudioTrack to garbage, set to nullptr.
             garbage.emplace_back(std::move(mAudioTrack));
@@ -312,6 +313,7 @@ void Stream::play_l(const std::shared_ptr<Sound>& sound, int32_t nextStreamID,
         // audio track while the new one is being started and avoids processing them with
         // wrong audio audio buffer size  (mAudioBufferSize)
         auto toggle = mToggle ^ 1;
+        const int64_t creationStartNs = systemTime();
         // NOLINTNEXTLINE(performance-no-int-to-ptr)
         audio_channel_mask_t soundChannelMask = sound->getChannelMask();
         // When sound contains a valid channel mask, use it as is.
@@ -355,6 +357,7 @@ void Stream::play_l(const std::shared_ptr<Sound>& sound, int32_t nextStreamID,
         }
         // From now on, AudioTrack callbacks received with previous toggle value will be ignored.
         mToggle = toggle;
+        mStreamManager->recordTrackCreated(systemTime() - creationStartNs);
         ALOGV("%s: using new track %p for sound %d",
                 __func__, mAudioTrack.get(), sound->getSoundID());
     }
@@ -181,6 +181,15 @@ int32_t StreamManager::queueForPlay(const std::shared_ptr<Sound> &sound,
                     break;
                 }
             }
+            if (newStream == nullptr) {
+                // Keep the warm tracks of other sounds if a stream has none to lose.
+                for (auto stream : mAvailableStreams) {
+                    if (stream->getSoundID() == 0) {
+                        newStream = stream;
+                        break;
+                    }
+                }
+            }
             if (newStream == nullptr) {
                 ALOGV("%s: found stream in available queue", __func__);
                 newStream = *mAvailableStreams.begin();
@@ -427,6 +436,10 @@ void StreamManager::run(int32_t id)
 
 void StreamManager::dump() const
 {
+    int64_t creations, reuses, creationTimeNs;
+    getTrackStats(&creations, &reuses, &creationTimeNs);
+    ALOGV("%s: AudioTracks created:%lld (%lld ns) reused:%lld", __func__,
+            (long long)creations, (long long)creationTimeNs, (long long)reuses);
     forEach([](const Stream *stream) { stream->dump(); });
 }
 
@@ -404,6 +404,21 @@ public:
 
     const std::string& getOpPackageName() const { return mOpPackageName; }
 
+    // Counts a play that had to create an AudioTrack, taking creationTimeNs, or that reused
+    // the track the stream already held for the sound.
+    void recordTrackCreated(int64_t creationTimeNs) {
+        ++mTrackCreations;
+        mTrackCreationTimeNs += creationTimeNs;
+    }
+    void recordTrackReused() { ++mTrackReuses; }
+
+    // Weakly consistent, for metrics.
+    void getTrackStats(int64_t* creations, int64_t* reuses, int64_t* creationTimeNs) const {
+        *creations = mTrackCreations;
+        *reuses = mTrackReuses;
+        *creationTimeNs = mTrackCreationTimeNs;
+    }
+
     // Moves the stream to the restart queue (called upon BUFFER_END of the static track)
     // this is locked internally.
     // If activeStreamIDToMatch is nonzero, it will only move to the restart queue
@@ -447,6 +462,10 @@ private:
 
     std::unique_ptr<ThreadPool> mThreadPool;                  // locked internally
 
+    std::atomic_int64_t         mTrackCreations = 0;
+    std::atomic_int64_t         mTrackReuses = 0;
+    std::atomic_int64_t         mTrackCreationTimeNs = 0;
+
     // mStreamManagerLock is used to lock access for transitions between the
     // 4 stream queues by the Manager Thread or by the user initiated play().
     // A stream pair has exactly one stream on exactly one of the queues.
@@ -476,7 +495,8 @@ private:
 
     // 3) mAvailableStreams: Streams that are inactive.
     // The paired stream will also be inactive.
-    // No particular order.
+    // No particular order. Those with a soundID keep a warm AudioTrack for that sound, so
+    // queueForPlay() takes streams without one before evicting the track of another sound.
     std::unordered_set<Stream*> mAvailableStreams GUARDED_BY(mStreamManagerLock);
 
     // 4) mProcessingStreams: Streams that are being processed by the ManagerThreads
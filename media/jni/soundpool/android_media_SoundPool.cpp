@@ -26,6 +26,7 @@
 #include <nativehelper/ScopedUtfChars.h>
 #include <android_runtime/AndroidRuntime.h>
 #include "SoundPool.h"
+#include "core_jni_helpers.h"
 
 using namespace android;
 
@@ -361,6 +362,46 @@ android_media_SoundPool_unload(JNIEnv *env, jobject thiz, jint sampleID) {
     return soundPool->unload(sampleID) ? JNI_TRUE : JNI_FALSE;
 }
 
+// Fills loadTimes with how long the sound waited to be decoded and took to decode, in ns.
+static jboolean
+android_media_SoundPool_getLoadTimes(JNIEnv *env, jobject thiz, jint sampleID,
+        jlongArray loadTimes)
+{
+    ALOGV("android_media_SoundPool_getLoadTimes");
+    auto soundPool = getSoundPool(env, thiz);
+    if (soundPool == nullptr) return JNI_FALSE;
+    if (loadTimes == nullptr || env->GetArrayLength(loadTimes) < 2) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "loadTimes too short");
+        return JNI_FALSE;
+    }
+    int64_t queuedTimeNs;
+    int64_t decodeTimeNs;
+    if (!soundPool->getLoadTimes(sampleID, &queuedTimeNs, &decodeTimeNs)) return JNI_FALSE;
+    const jlong times[] = { jlong(queuedTimeNs), jlong(decodeTimeNs) };
+    env->SetLongArrayRegion(loadTimes, 0, 2, times);
+    return JNI_TRUE;
+}
+
+// Fills trackStats with the AudioTracks created, the time spent creating them in ns, and the
+// plays that reused a track.
+static void
+android_media_SoundPool_getTrackStats(JNIEnv *env, jobject thiz, jlongArray trackStats)
+{
+    ALOGV("android_media_SoundPool_getTrackStats");
+    auto soundPool = getSoundPool(env, thiz);
+    if (soundPool == nullptr) return;
+    if (trackStats == nullptr || env->GetArrayLength(trackStats) < 3) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "trackStats too short");
+        return;
+    }
+    int64_t creations;
+    int64_t reuses;
+    int64_t creationTimeNs;
+    soundPool->getTrackStats(&creations, &reuses, &creationTimeNs);
+    const jlong stats[] = { jlong(creations), jlong(creationTimeNs), jlong(reuses) };
+    env->SetLongArrayRegion(trackStats, 0, 3, stats);
+}
+
 static jint
 android_media_SoundPool_play(JNIEnv *env, jobject thiz, jint sampleID,
         jfloat leftVolume, jfloat rightVolume, jint priority, jint loop,
@@ -500,10 +541,10 @@ static void android_media_callback(SoundPoolEvent event, SoundPool* soundPool, v
 }
 
 static jint
-android_media_SoundPool_native_setup(JNIEnv *env, jobject thiz,
-        jint maxChannels, jobject jaa, jstring opPackageName)
+android_media_SoundPool_native_setup_with_decoder_threads(JNIEnv *env, jobject thiz,
+        jint maxChannels, jobject jaa, jstring opPackageName, jint decoderThreads)
 {
-    ALOGV("android_media_SoundPool_native_setup");
+    ALOGV("android_media_SoundPool_native_setup(decoderThreads=%d)", (int)decoderThreads);
     if (jaa == nullptr) {
         ALOGE("Error creating SoundPool: invalid audio attributes");
         return -1;
@@ -527,7 +568,7 @@ android_media_SoundPool_native_setup(JNIEnv *env, jobject thiz,
             (audio_flags_mask_t) env->GetIntField(jaa, javaAudioAttrFields.fieldFlags);
     ScopedUtfChars opPackageNameStr(env, opPackageName);
     auto soundPool = std::make_shared<SoundPool>(
-            maxChannels, audioAttributes, opPackageNameStr.c_str());
+            maxChannels, audioAttributes, opPackageNameStr.c_str(), int32_t(decoderThreads));
     soundPool->setCallback(android_media_callback, nullptr /* user */);
 
     // register with SoundPoolManager.
@@ -541,6 +582,14 @@ android_media_SoundPool_native_setup(JNIEnv *env, jobject thiz,
     return 0;
 }
 
+static jint
+android_media_SoundPool_native_setup(JNIEnv *env, jobject thiz,
+        jint maxChannels, jobject jaa, jstring opPackageName)
+{
+    return android_media_SoundPool_native_setup_with_decoder_threads(
+            env, thiz, maxChannels, jaa, opPackageName, 0 /* decoderThreads */);
+}
+
 static void
 android_media_SoundPool_release(JNIEnv *env, jobject thiz)
 {
@@ -623,6 +672,22 @@ static JNINativeMethod gMethods[] = {
     }
 };
 
+// Registered only if SoundPool declares them.
+static JNINativeMethod gOptionalMethods[] = {
+    {   "native_setup",
+        "(ILjava/lang/Object;Ljava/lang/String;I)I",
+        (void*)android_media_SoundPool_native_setup_with_decoder_threads
+    },
+    {   "_getLoadTimes",
+        "(I[J)Z",
+        (void *)android_media_SoundPool_getLoadTimes
+    },
+    {   "_getTrackStats",
+        "([J)V",
+        (void *)android_media_SoundPool_getTrackStats
+    }
+};
+
 static const char* const kClassPathName = "android/media/SoundPool";
 
 jint JNI_OnLoad(JavaVM* vm, void* /* reserved */)
@@ -664,6 +729,7 @@ jint JNI_OnLoad(JavaVM* vm, void* /* reserved */)
                 env, kClassPathName, gMethods, NELEM(gMethods)) < 0) {
         return result;
     }
+    RegisterOptionalMethods(env, kClassPathName, gOptionalMethods, NELEM(gOptionalMethods));
 
     // Get the AudioAttributes class and fields
     jclass audioAttrClass = env->FindClass(kAudioAttributesClassPathName);
@@ -23,8 +23,10 @@
 #include <android-base/logging.h>
 #include <inttypes.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include "ClientHelper.h"
 
@@ -50,6 +52,64 @@ void DvrClient::setFd(int32_t fd) {
     mFd = fd;
 }
 
+int64_t DvrClient::transferFile(AidlMQ::MemTransaction* tx, int64_t size, bool toMQ) {
+    auto first = tx->getFirstRegion();
+    auto second = tx->getSecondRegion();
+    int64_t firstLength = min(static_cast<int64_t>(first.getLength()), size);
+    struct iovec iov[2] = {
+            {first.getAddress(), static_cast<size_t>(firstLength)},
+            {second.getAddress(), static_cast<size_t>(size - firstLength)},
+    };
+    struct iovec* next = iov;
+    int iovCount = size > firstLength ? 2 : 1;
+
+    // Both regions of the ring buffer go in one call, which a pipe or socket may complete only
+    // in part.
+    int64_t done = 0;
+    while (done < size) {
+        ssize_t ret = TEMP_FAILURE_RETRY(toMQ ? readv(mFd, next, iovCount)
+                                              : writev(mFd, next, iovCount));
+        if (ret < 0) {
+            ALOGE("Failed to %s FD: %s", toMQ ? "read from" : "write to", strerror(errno));
+            return done > 0 ? done : -1;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+        while (iovCount > 0 && static_cast<size_t>(ret) >= next->iov_len) {
+            ret -= next->iov_len;
+            next++;
+            iovCount--;
+        }
+        if (iovCount > 0) {
+            next->iov_base = static_cast<int8_t*>(next->iov_base) + ret;
+            next->iov_len -= ret;
+        }
+    }
+    return done;
+}
+
+void DvrClient::recordTransfer(int64_t bytes, bool throttled, int64_t ioTimeNs) {
+    if (bytes > 0) {
+        mTransferBytes += bytes;
+        mTransfers++;
+    }
+    if (throttled) {
+        mThrottledTransfers++;
+    }
+    mTransferTimeNs += ioTimeNs;
+}
+
+DvrTransferStats DvrClient::getTransferStats() {
+    DvrTransferStats stats;
+    stats.bytes = mTransferBytes;
+    stats.transfers = mTransfers;
+    stats.throttled = mThrottledTransfers;
+    stats.ioTimeNs = mTransferTimeNs;
+    return stats;
+}
+
 int64_t DvrClient::readFromFile(int64_t size) {
     if (mDvrMQ == nullptr || mDvrMQEventFlag == nullptr) {
         ALOGE("Failed to readFromFile. DVR mq is not configured");
@@ -66,28 +126,15 @@ int64_t DvrClient::readFromFile(int64_t size) {
     AidlMQ::MemTransaction tx;
     int64_t ret = 0;
     if (mDvrMQ->beginWrite(write, &tx)) {
-        auto first = tx.getFirstRegion();
-        auto data = first.getAddress();
-        int64_t length = first.getLength();
-        int64_t firstToWrite = min(length, write);
-        ret = read(mFd, data, firstToWrite);
-
+        nsecs_t start = systemTime();
+        ret = transferFile(&tx, write, true /* toMQ */);
+        nsecs_t ioTime = systemTime() - start;
         if (ret < 0) {
-            ALOGE("Failed to read from FD: %s", strerror(errno));
             return -1;
         }
-        if (ret < firstToWrite) {
-            ALOGW("file to MQ, first region: %" PRIu64 " bytes to write, but %" PRIu64
-                  " bytes written",
-                  firstToWrite, ret);
-        } else if (firstToWrite < write) {
-            ALOGV("write second region: %" PRIu64 " bytes written, %" PRIu64 " bytes in total", ret,
-                  write);
-            auto second = tx.getSecondRegion();
-            data = second.getAddress();
-            length = second.getLength();
-            int64_t secondToWrite = std::min(length, write - firstToWrite);
-            ret += read(mFd, data, secondToWrite);
+        if (ret < write) {
+            ALOGW("file to MQ: %" PRIu64 " bytes to write, but %" PRIu64 " bytes written", write,
+                  ret);
         }
         ALOGV("file to MQ: %" PRIu64 " bytes need to be written, %" PRIu64 " bytes written", write,
               ret);
@@ -95,6 +142,7 @@ int64_t DvrClient::readFromFile(int64_t size) {
             ALOGE("Error: failed to commit write!");
             return -1;
         }
+        recordTransfer(ret, write < size, ioTime);
     } else {
         ALOGE("dvrMq.beginWrite failed");
     }
@@ -143,33 +191,22 @@ int64_t DvrClient::writeToFile(int64_t size) {
     int64_t ret = 0;
     AidlMQ::MemTransaction tx;
     if (mDvrMQ->beginRead(toRead, &tx)) {
-        auto first = tx.getFirstRegion();
-        auto data = first.getAddress();
-        int64_t length = first.getLength();
-        int64_t firstToRead = std::min(length, toRead);
-        ret = write(mFd, data, firstToRead);
-
+        nsecs_t start = systemTime();
+        ret = transferFile(&tx, toRead, false /* toMQ */);
+        nsecs_t ioTime = systemTime() - start;
         if (ret < 0) {
-            ALOGE("Failed to write to FD: %s", strerror(errno));
             return -1;
         }
-        if (ret < firstToRead) {
-            ALOGW("MQ to file: %" PRIu64 " bytes read, but %" PRIu64 " bytes written", firstToRead,
+        if (ret < toRead) {
+            ALOGW("MQ to file: %" PRIu64 " bytes read, but %" PRIu64 " bytes written", toRead,
                   ret);
-        } else if (firstToRead < toRead) {
-            ALOGV("read second region: %" PRIu64 " bytes read, %" PRIu64 " bytes in total", ret,
-                  toRead);
-            auto second = tx.getSecondRegion();
-            data = second.getAddress();
-            length = second.getLength();
-            int32_t secondToRead = toRead - firstToRead;
-            ret += write(mFd, data, secondToRead);
         }
         ALOGV("MQ to file: %" PRIu64 " bytes to be read, %" PRIu64 " bytes written", toRead, ret);
         if (!mDvrMQ->commitRead(ret)) {
             ALOGE("Error: failed to commit read!");
             return 0;
         }
+        recordTransfer(ret, toRead < size, ioTime);
     } else {
         ALOGE("dvrMq.beginRead failed");
     }
@@ -23,6 +23,8 @@
 #include <aidl/android/media/tv/tuner/ITunerDvr.h>
 #include <fmq/AidlMessageQueue.h>
 
+#include <atomic>
+
 #include "DvrClientCallback.h"
 #include "FilterClient.h"
 
@@ -55,6 +57,21 @@ private:
     sp<DvrClientCallback> mDvrClientCallback;
 };
 
+/**
+ * Counters of the data moved between the DVR FMQ and its file.
+ */
+struct DvrTransferStats {
+    // Bytes moved.
+    int64_t bytes = 0;
+    // Calls of readFromFile()/writeToFile() that moved data.
+    int64_t transfers = 0;
+    // Calls that moved less than asked because the FMQ was full (playback) or had less data
+    // than asked (record), i.e. the other end of the FMQ held the transfer back.
+    int64_t throttled = 0;
+    // Time spent in file I/O.
+    int64_t ioTimeNs = 0;
+};
+
 struct DvrClient : public RefBase {
 
 public:
@@ -131,7 +148,20 @@ public:
      */
     Result setStatusCheckIntervalHint(int64_t durationInMs);
 
+    /**
+     * Get the counters of readFromFile() and writeToFile() since the DVR was opened.
+     */
+    DvrTransferStats getTransferStats();
+
 private:
+    /**
+     * Move up to size bytes between the file and the regions of an FMQ transaction, with as
+     * few system calls as the file allows. Return the bytes moved, or -1 if none could be.
+     */
+    int64_t transferFile(AidlMQ::MemTransaction* tx, int64_t size, bool toMQ);
+
+    void recordTransfer(int64_t bytes, bool throttled, int64_t ioTimeNs);
+
     /**
      * An AIDL Tuner Dvr Singleton assigned at the first time the Tuner Client
      * opens a dvr. Default null when dvr is not opened.
@@ -142,6 +172,11 @@ private:
     EventFlag* mDvrMQEventFlag;
     string mFilePath;
     int32_t mFd;
+
+    atomic<int64_t> mTransferBytes{0};
+    atomic<int64_t> mTransfers{0};
+    atomic<int64_t> mThrottledTransfers{0};
+    atomic<int64_t> mTransferTimeNs{0};
 };
 }  // namespace android
 
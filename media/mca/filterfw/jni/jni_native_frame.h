@@ -57,6 +57,12 @@ Java_android_filterfw_core_NativeFrame_setNativeData(JNIEnv* env,
 JNIEXPORT jbyteArray JNICALL
 Java_android_filterfw_core_NativeFrame_getNativeData(JNIEnv* env, jobject thiz, jint size);
 
+JNIEXPORT jboolean JNICALL
+Java_android_filterfw_core_NativeFrame_setNativeDirectBuffer(JNIEnv* env,
+                                                             jobject thiz,
+                                                             jobject buffer,
+                                                             jint length);
+
 JNIEXPORT jboolean JNICALL
 Java_android_filterfw_core_NativeFrame_getNativeBuffer(JNIEnv* env, jobject thiz, jobject buffer);
 
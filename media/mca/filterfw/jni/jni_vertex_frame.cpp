@@ -85,6 +85,20 @@ jboolean Java_android_filterfw_core_VertexFrame_setNativeData(JNIEnv* env,
   return JNI_FALSE;
 }
 
+jboolean Java_android_filterfw_core_VertexFrame_setNativeDirectBuffer(JNIEnv* env,
+                                                                      jobject thiz,
+                                                                      jobject buffer,
+                                                                      jint length) {
+  VertexFrame* frame = ConvertFromJava<VertexFrame>(env, thiz);
+  if (frame && buffer) {
+    // Uploads straight from the buffer's memory, which can be filled without any JNI copy.
+    const uint8_t* data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+    if (data && length >= 0 && length <= env->GetDirectBufferCapacity(buffer))
+      return ToJBool(frame->WriteData(data, length));
+  }
+  return JNI_FALSE;
+}
+
 jint Java_android_filterfw_core_VertexFrame_getNativeVboId(JNIEnv* env, jobject thiz) {
   VertexFrame* frame = ConvertFromJava<VertexFrame>(env, thiz);
   return frame ? frame->GetVboId() : -1;
@@ -44,6 +44,12 @@ Java_android_filterfw_core_VertexFrame_setNativeData(JNIEnv* env,
                                                      jint offset,
                                                      jint length);
 
+JNIEXPORT jboolean JNICALL
+Java_android_filterfw_core_VertexFrame_setNativeDirectBuffer(JNIEnv* env,
+                                                             jobject thiz,
+                                                             jobject buffer,
+                                                             jint length);
+
 JNIEXPORT jint JNICALL
 Java_android_filterfw_core_VertexFrame_getNativeVboId(JNIEnv* env, jobject thiz);
 
@@ -23,8 +23,12 @@
 #include "core/shader_program.h"
 #include "core/vertex_frame.h"
 
+#include <string.h>
+
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -39,6 +43,93 @@ static const char* s_default_vertex_shader_source_ =
   "  v_texcoord = a_texcoord;\n"
   "}\n";
 
+// Program Binary Cache ////////////////////////////////////////////////////////
+// The binaries of the programs linked so far in the process, by their sources and the driver
+// that linked them, so that ShaderPrograms created again in other GLEnvs, e.g. by a new effect
+// session, load them instead of compiling and linking their shaders again. Drivers without
+// GL_OES_get_program_binary always compile.
+struct ProgramBinary {
+  GLenum format;
+  std::vector<uint8_t> data;
+};
+
+static std::mutex s_program_binaries_mutex_;
+static std::unordered_map<std::string, ProgramBinary> s_program_binaries_;
+
+// Returns the key of the binary of the program linked from the given sources by the driver of
+// the current context, or an empty string if the driver doesn't provide program binaries.
+static std::string ProgramBinaryKey(const std::string& vertex_source,
+                                    const std::string& fragment_source) {
+  const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (!extensions || !strstr(extensions, "GL_OES_get_program_binary"))
+    return std::string();
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &format_count);
+  if (format_count <= 0)
+    return std::string();
+
+  const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  std::string key;
+  key.append(renderer ? renderer : "").push_back('\0');
+  key.append(version ? version : "").push_back('\0');
+  key.append(vertex_source).push_back('\0');
+  key.append(fragment_source);
+  return key;
+}
+
+// Returns a program loaded from the cached binary of the given key, or 0 if there is none or the
+// driver rejects it.
+static GLuint LoadProgramBinary(const std::string& key) {
+  static const PFNGLPROGRAMBINARYOESPROC program_binary =
+      reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"));
+  if (!program_binary)
+    return 0;
+
+  std::lock_guard<std::mutex> lock(s_program_binaries_mutex_);
+  auto iter = s_program_binaries_.find(key);
+  if (iter == s_program_binaries_.end())
+    return 0;
+
+  GLuint program = glCreateProgram();
+  if (program) {
+    const ProgramBinary& binary = iter->second;
+    program_binary(program, binary.format, binary.data.data(), binary.data.size());
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+      // Drivers may reject the binaries of other driver builds, compile again then.
+      LOG_FRAME("Discarding rejected program binary");
+      glDeleteProgram(program);
+      program = 0;
+      s_program_binaries_.erase(iter);
+    }
+  }
+  return program;
+}
+
+// Stores the binary of the linked program under the given key.
+static void SaveProgramBinary(const std::string& key, GLuint program) {
+  static const PFNGLGETPROGRAMBINARYOESPROC get_program_binary =
+      reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"));
+  if (!get_program_binary)
+    return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+  if (length <= 0)
+    return;
+  ProgramBinary binary;
+  binary.data.resize(length);
+  get_program_binary(program, length, &length, &binary.format, binary.data.data());
+  if (GLEnv::CheckGLError("Getting program binary"))
+    return;
+  binary.data.resize(length);
+
+  std::lock_guard<std::mutex> lock(s_program_binaries_mutex_);
+  s_program_binaries_[key] = std::move(binary);
+}
+
 // Helper Functions ////////////////////////////////////////////////////////////
 // Maps coordinates x,y in the unit rectangle over to the quadrangle specified
 // by the four points in b. The result coordinates are written to xt and yt.
@@ -259,23 +350,32 @@ bool ShaderProgram::CompileAndLink() {
     return false;
   }
 
-  // Compile vertex shader
-  vertex_shader_ = CompileShader(GL_VERTEX_SHADER,
-                                 vertex_shader_source_.c_str());
-  if (!vertex_shader_) {
-    ALOGE("Shader compilation failed!");
-    return false;
-  }
+  // Load the program if it was linked from the same sources before
+  const std::string binary_key = ProgramBinaryKey(vertex_shader_source_, fragment_shader_source_);
+  if (!binary_key.empty())
+    program_ = LoadProgramBinary(binary_key);
+
+  if (program_ == 0) {
+    // Compile vertex shader
+    vertex_shader_ = CompileShader(GL_VERTEX_SHADER,
+                                   vertex_shader_source_.c_str());
+    if (!vertex_shader_) {
+      ALOGE("Shader compilation failed!");
+      return false;
+    }
 
-  // Compile fragment shader
-  fragment_shader_ = CompileShader(GL_FRAGMENT_SHADER,
-                                   fragment_shader_source_.c_str());
-  if (!fragment_shader_)
-    return false;
+    // Compile fragment shader
+    fragment_shader_ = CompileShader(GL_FRAGMENT_SHADER,
+                                     fragment_shader_source_.c_str());
+    if (!fragment_shader_)
+      return false;
 
-  // Link
-  GLuint shaders[2] = { vertex_shader_, fragment_shader_ };
-  program_ = LinkProgram(shaders, 2);
+    // Link
+    GLuint shaders[2] = { vertex_shader_, fragment_shader_ };
+    program_ = LinkProgram(shaders, 2);
+    if (program_ != 0 && !binary_key.empty())
+      SaveProgramBinary(binary_key, program_);
+  }
 
   // Scan for all uniforms in the program
   ScanUniforms();
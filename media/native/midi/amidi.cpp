@@ -15,13 +15,20 @@
  */
 
 #define LOG_TAG "NativeMIDI"
+#define ATRACE_TAG ATRACE_TAG_AUDIO
 
 #include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <binder/Binder.h>
 #include <android_util_Binder.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
 
 #include <core_jni_helpers.h>
 
@@ -46,6 +53,7 @@ struct AMIDI_Port {
     const AMidiDevice  *device;    // Points to the AMidiDevice associated with the port.
     sp<IBinder>         binderToken;// The Binder token associated with the port.
     unique_fd           ufd;        // The unique file descriptor associated with the port.
+    bool                receiveError = false; // A read error left for the next receive to report.
 };
 
 /*
@@ -87,6 +95,10 @@ enum {
 #define AMIDI_PACKET_OVERHEAD   9
 #define AMIDI_BUFFER_SIZE       (AMIDI_PACKET_SIZE - AMIDI_PACKET_OVERHEAD)
 
+// The most packets AMidiInputPort_sendBatch() and AMidiOutputPort_receiveBatch() move per
+// sendmmsg() or recvmmsg() call.
+#define AMIDI_BATCH_PACKETS     16
+
 // JNI IDs (see android_media_midi.cpp)
 namespace android { namespace midi {
 //  MidiDevice Fields
@@ -319,12 +331,13 @@ public:
 
     ssize_t receive(int32_t *opcodePtr, uint8_t *buffer, size_t maxBytes,
             size_t *numBytesReceivedPtr, int64_t *timestampPtr) {
-        int portState = MIDI_PORT_STATE_OPEN_IDLE;
-        // check to see if the port is idle, then set to active
-        if (!mPort->state.compare_exchange_strong(portState, MIDI_PORT_STATE_OPEN_ACTIVE)) {
+        if (!activate()) {
             // The port not idle or has been closed.
             return AMEDIA_ERROR_UNKNOWN;
         }
+        if (takeReceiveError()) {
+            return AMEDIA_ERROR_UNKNOWN;
+        }
 
         struct pollfd checkFds[1] = { { mPort->ufd, POLLIN, 0 } };
         if (poll(checkFds, 1, 0) < 1) {
@@ -354,7 +367,112 @@ public:
         return 1;
     }
 
+    ssize_t receiveBatch(AMidiMessage *messages, size_t maxMessages, uint8_t *buffer,
+            size_t bufferSize) {
+        if (!activate() || takeReceiveError()) {
+            return AMEDIA_ERROR_UNKNOWN;
+        }
+
+        uint8_t readBuffers[AMIDI_BATCH_PACKETS][AMIDI_PACKET_SIZE];
+        struct iovec iovs[AMIDI_BATCH_PACKETS];
+        struct mmsghdr headers[AMIDI_BATCH_PACKETS];
+        size_t numReceived = 0;
+        size_t bufferUsed = 0;
+        bool readFailed = false;
+        while (numReceived < maxMessages) {
+            // Don't read more packets than buffer is sure to hold the data of, except that a
+            // first packet is always read, and truncated as receive() would.
+            size_t numPackets = std::min({(size_t) AMIDI_BATCH_PACKETS, maxMessages - numReceived,
+                    (bufferSize - bufferUsed) / AMIDI_BUFFER_SIZE});
+            if (numPackets == 0) {
+                if (numReceived > 0) {
+                    break;
+                }
+                numPackets = 1;
+            }
+
+            for (size_t index = 0; index < numPackets; index++) {
+                iovs[index] = { readBuffers[index], sizeof(readBuffers[index]) };
+                headers[index] = {};
+                headers[index].msg_hdr.msg_iov = &iovs[index];
+                headers[index].msg_hdr.msg_iovlen = 1;
+            }
+            int numRead = TEMP_FAILURE_RETRY(
+                    recvmmsg(mPort->ufd, headers, numPackets, MSG_DONTWAIT, nullptr));
+            if (numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;  // Nothing more there
+            }
+            if (numRead < 1) {
+                readFailed = true;
+                break;
+            }
+
+            for (int index = 0; index < numRead; index++) {
+                // see Packet Format definition at the top of this file.
+                const uint8_t *packet = readBuffers[index];
+                size_t readCount = headers[index].msg_len;
+                if (readCount < 1) {
+                    // Keep the packets read after it, and fail once they are returned.
+                    readFailed = true;
+                    continue;
+                }
+                AMidiMessage *message = &messages[numReceived++];
+                message->opcode = packet[0];
+                message->data = buffer + bufferUsed;
+                message->numBytes = 0;
+                message->timestamp = 0;
+                if (message->opcode == AMIDI_OPCODE_DATA && readCount >= AMIDI_PACKET_OVERHEAD) {
+                    message->numBytes = std::min(bufferSize - bufferUsed,
+                            readCount - AMIDI_PACKET_OVERHEAD);
+                    memcpy(buffer + bufferUsed, packet + 1, message->numBytes);
+                    memcpy(&message->timestamp, packet + readCount - sizeof(uint64_t),
+                            sizeof(message->timestamp));
+                    bufferUsed += message->numBytes;
+                }
+            }
+            if (readFailed) {
+                break;
+            }
+            if ((size_t) numRead < numPackets) {
+                break;  // Drained the socket
+            }
+        }
+        if (readFailed) {
+            if (numReceived == 0) {
+                return AMEDIA_ERROR_UNKNOWN;
+            }
+            // Return the messages received so far, and report the error on the next call.
+            mPort->receiveError = true;
+        }
+
+        // How long the newest message took from its sender's clock to here, for a systrace to
+        // line up with the audio pipeline.
+        if (numReceived > 0 && ATRACE_ENABLED()) {
+            ATRACE_INT("AMidi received", numReceived);
+            int64_t timestamp = messages[numReceived - 1].timestamp;
+            if (timestamp > 0) {
+                ATRACE_INT64("AMidi receive latency ns",
+                        systemTime(SYSTEM_TIME_MONOTONIC) - timestamp);
+            }
+        }
+        return numReceived;
+    }
+
 private:
+    // Clears the read error a previous receiveBatch() left to report, and returns whether there
+    // was one. Only called while the port is active, which keeps other receivers out.
+    bool takeReceiveError() {
+        bool receiveError = mPort->receiveError;
+        mPort->receiveError = false;
+        return receiveError;
+    }
+
+    // Flags the port active if it is idle, and returns whether it was.
+    bool activate() {
+        int portState = MIDI_PORT_STATE_OPEN_IDLE;
+        return mPort->state.compare_exchange_strong(portState, MIDI_PORT_STATE_OPEN_ACTIVE);
+    }
+
     AMIDI_Port *mPort;
 };
 
@@ -369,6 +487,20 @@ ssize_t AMIDI_API AMidiOutputPort_receive(const AMidiOutputPort *outputPort, int
            numBytesReceivedPtr, timestampPtr);
 }
 
+ssize_t AMIDI_API AMidiOutputPort_receiveBatch(const AMidiOutputPort *outputPort,
+        AMidiMessage *messages, size_t maxMessages, uint8_t *buffer, size_t bufferSize) {
+    if (outputPort == nullptr || messages == nullptr || buffer == nullptr) {
+        return -EINVAL;
+    }
+    if (maxMessages == 0) {
+        return 0;
+    }
+
+    ATRACE_CALL();
+    return MidiReceiver((AMIDI_Port*)outputPort).receiveBatch(messages, maxMessages, buffer,
+            bufferSize);
+}
+
 void AMIDI_API AMidiOutputPort_close(const AMidiOutputPort *outputPort) {
     AMIDI_closePort((AMIDI_Port*)outputPort);
 }
@@ -436,6 +568,89 @@ ssize_t AMIDI_API AMidiInputPort_sendWithTimestamp(const AMidiInputPort *inputPo
     return numSent;
 }
 
+ssize_t AMIDI_API AMidiInputPort_sendBatch(const AMidiInputPort *inputPort,
+        const AMidiMessage *messages, size_t numMessages) {
+    if (inputPort == nullptr || (messages == nullptr && numMessages > 0)) {
+        return AMEDIA_ERROR_INVALID_PARAMETER;
+    }
+    for (size_t index = 0; index < numMessages; index++) {
+        if ((messages[index].data == nullptr && messages[index].numBytes > 0)
+                || messages[index].timestamp < 0) {
+            return AMEDIA_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    ATRACE_CALL();
+    uint8_t writeBuffers[AMIDI_BATCH_PACKETS][AMIDI_PACKET_SIZE];
+    struct iovec iovs[AMIDI_BATCH_PACKETS];
+    struct mmsghdr headers[AMIDI_BATCH_PACKETS];
+    size_t messagesDone[AMIDI_BATCH_PACKETS]; // Messages wholly sent once the packet is.
+    size_t numSent = 0;
+    size_t next = 0;        // The next message to pack,
+    size_t nextOffset = 0;  // and where in its data.
+    while (next < numMessages) {
+        size_t numPackets = 0;
+        while (numPackets < AMIDI_BATCH_PACKETS && next < numMessages) {
+            // Messages with the same timestamp share packets: receivers parse MIDI data as a
+            // stream of bytes, as they do when a long message is split over packets.
+            uint8_t *packet = writeBuffers[numPackets];
+            int64_t timestamp = messages[next].timestamp;
+            size_t numBytes = 0;
+            while (next < numMessages && messages[next].timestamp == timestamp
+                    && numBytes < AMIDI_BUFFER_SIZE) {
+                const AMidiMessage &message = messages[next];
+                size_t blockSize = std::min((size_t) AMIDI_BUFFER_SIZE - numBytes,
+                        message.numBytes - nextOffset);
+                memcpy(packet + 1 + numBytes, message.data + nextOffset, blockSize);
+                numBytes += blockSize;
+                nextOffset += blockSize;
+                if (nextOffset < message.numBytes) {
+                    break;  // The rest goes in the next packet.
+                }
+                next++;
+                nextOffset = 0;
+            }
+            if (numBytes == 0) {
+                // Only empty messages, which there is nothing to send for.
+                if (numPackets == 0) {
+                    numSent = next;
+                } else {
+                    messagesDone[numPackets - 1] = next;
+                }
+                continue;
+            }
+
+            packet[0] = AMIDI_OPCODE_DATA;
+            memcpy(packet + 1 + numBytes, &timestamp, sizeof(timestamp));
+            iovs[numPackets] = { packet, numBytes + AMIDI_PACKET_OVERHEAD };
+            headers[numPackets] = {};
+            headers[numPackets].msg_hdr.msg_iov = &iovs[numPackets];
+            headers[numPackets].msg_hdr.msg_iovlen = 1;
+            messagesDone[numPackets] = next;
+            numPackets++;
+        }
+        if (numPackets == 0) {
+            break;
+        }
+
+        ATRACE_INT("AMidi send packets", numPackets);
+        int numWritten = TEMP_FAILURE_RETRY(
+                sendmmsg(((AMIDI_Port*)inputPort)->ufd, headers, numPackets, 0));
+        if (numWritten < 1) {
+            ALOGE("AMidiInputPort_sendBatch Couldn't write MIDI data buffers. errno:%d", errno);
+            break;  // error so bail out.
+        }
+        numSent = messagesDone[numWritten - 1];
+        if ((size_t) numWritten < numPackets) {
+            ALOGE("AMidiInputPort_sendBatch Couldn't write all MIDI data buffers."
+                  " requested:%zu, written:%d", numPackets, numWritten);
+            break;  // bail
+        }
+    }
+
+    return numSent;
+}
+
 media_status_t AMIDI_API AMidiInputPort_sendFlush(const AMidiInputPort *inputPort) {
     if (inputPort == nullptr) {
         return AMEDIA_ERROR_INVALID_PARAMETER;
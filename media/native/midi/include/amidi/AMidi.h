@@ -52,6 +52,19 @@ enum {
                                 /* Forces the send of any pending MIDI data. */
 };
 
+/**
+ * A timestamped MIDI message, as sent by AMidiInputPort_sendBatch() and received by
+ * AMidiOutputPort_receiveBatch().
+ *
+ * Introduced in API 35.
+ */
+typedef struct AMidiMessage {
+    int32_t opcode;         /* One of the AMIDI_OPCODE_* constants. Ignored when sending. */
+    const uint8_t *data;    /* The MIDI data bytes of the message. */
+    size_t numBytes;        /* The number of bytes pointed to by data. */
+    int64_t timestamp;      /* The CLOCK_MONOTONIC time in nanoseconds of the message. */
+} AMidiMessage;
+
 /*
  * Type IDs for various MIDI devices.
  */
@@ -277,6 +290,32 @@ void AMIDI_API AMidiOutputPort_close(const AMidiOutputPort *outputPort) __INTROD
 ssize_t AMIDI_API AMidiOutputPort_receive(const AMidiOutputPort *outputPort, int32_t *opcodePtr,
          uint8_t *buffer, size_t maxBytes, size_t* numBytesReceivedPtr, int64_t *outTimestampPtr) __INTRODUCED_IN(29);
 
+/**
+ * Receives up to maxMessages pending MIDI messages, reading many of them from the port per system
+ * call. Like AMidiOutputPort_receive(), this is a non-blocking call which returns 0 when no
+ * messages are available.
+ *
+ * The data bytes of the messages are stored one after the other in buffer, which each message's
+ * data points into. A message may carry up to 1015 bytes, and no more messages are read than
+ * buffer is sure to hold, so buffer should have room for 1015 bytes per message wanted. The first
+ * message is always read, and is truncated to bufferSize bytes if need be.
+ *
+ * If reading from the port fails after some messages were received, those messages are returned
+ * and the error is returned by the next receive call instead.
+ *
+ * @param outputPort   Identifies the port to receive messages from.
+ * @param messages     Receives the messages.
+ * @param maxMessages  Specifies the number of elements of messages.
+ * @param buffer       Points to the buffer to receive the message data bytes.
+ * @param bufferSize   Specifies the size of the buffer pointed to by the buffer parameter.
+ *
+ * @return the number of messages received, or a negative error code:
+ *  @see AMEDIA_ERROR_UNKNOWN - Unknown Error.
+ */
+ssize_t AMIDI_API AMidiOutputPort_receiveBatch(const AMidiOutputPort *outputPort,
+        AMidiMessage *messages, size_t maxMessages, uint8_t *buffer, size_t bufferSize)
+        __INTRODUCED_IN(35);
+
 /*
  * API for sending data to the Input port of a device.
  */
@@ -336,6 +375,23 @@ ssize_t AMIDI_API AMidiInputPort_sendWithTimestamp(const AMidiInputPort *inputPo
  */
 media_status_t AMIDI_API AMidiInputPort_sendFlush(const AMidiInputPort *inputPort) __INTRODUCED_IN(29);
 
+/**
+ * Sends a sequence of timestamped messages to the specified input port, writing many of them
+ * to the port per system call. Consecutive messages with the same timestamp may be delivered to
+ * the receiver as one message made of all their data bytes.
+ *
+ * @param inputPort    The identifier of the port to send data to.
+ * @param messages     Points to the array of messages to send. Their opcode is ignored.
+ * @param numMessages  Specifies the number of messages to send.
+ *
+ * @return The number of messages sent, which could be less than specified or a negative error
+ * code:
+ * @see AMEDIA_ERROR_INVALID_PARAMETER - The specified port was NULL, the specified messages, or
+ * the data of one of them, was NULL, or a timestamp was negative.
+ */
+ssize_t AMIDI_API AMidiInputPort_sendBatch(const AMidiInputPort *inputPort,
+        const AMidiMessage *messages, size_t numMessages) __INTRODUCED_IN(35);
+
 /**
  * Closes the input port.
  *
@@ -25,6 +25,9 @@
 #include <androidfw/AssetManager2.h>
 #include <utils/threads.h>
 
+#include <string>
+#include <vector>
+
 #include "jni.h"
 #include <nativehelper/JNIHelp.h>
 
@@ -97,6 +100,36 @@ AAssetDir* AAssetManager_openDir(AAssetManager* amgr, const char* dirName)
     return new AAssetDir(locked_mgr->OpenDir(dirName));
 }
 
+// Not declared by the public header yet, so it needs C linkage of its own.
+extern "C" int AAssetManager_getDirEntries(AAssetManager* amgr, const char* dirName,
+        void (*callback)(void* userData, const char* fileName, off64_t offset,
+                off64_t compressedLength, off64_t uncompressedLength, int method),
+        void* userData)
+{
+    struct Entry {
+        std::string name;
+        AssetEntryInfo info;
+    };
+    std::vector<Entry> entries;
+    {
+        ScopedLock<AssetManager2> locked_mgr(*AssetManagerForNdkAssetManager(amgr));
+        const bool result = locked_mgr->ForEachAssetEntry(dirName,
+                [&](StringPiece name, const AssetEntryInfo& info) {
+                    entries.push_back(Entry{std::string(name), info});
+                });
+        if (!result) {
+            return -1;
+        }
+    }
+
+    // The lock is released first so that the callback may use the asset manager.
+    for (const Entry& entry : entries) {
+        callback(userData, entry.name.c_str(), entry.info.offset, entry.info.compressed_length,
+                entry.info.uncompressed_length, entry.info.method);
+    }
+    return 0;
+}
+
 /**
  * AssetDir functionality
  */
@@ -212,3 +245,9 @@ int AAsset_isAllocated(AAsset* asset)
 {
     return asset->mAsset->isAllocated() ? 1 : 0;
 }
+
+// Not declared by the public header yet, so it needs C linkage of its own.
+extern "C" void AAsset_readAhead(AAsset* asset, off64_t length)
+{
+    asset->mAsset->readAhead(length);
+}
@@ -15,6 +15,9 @@
  */
 
 #include <private/android/choreographer.h>
+#include <utils/Timers.h>
+
+#include <algorithm>
 
 using namespace android;
 
@@ -79,3 +82,89 @@ int64_t AChoreographerFrameCallbackData_getFrameTimelineDeadlineNanos(
         const AChoreographerFrameCallbackData* data, size_t index) {
     return AChoreographerFrameCallbackData_routeGetFrameTimelineDeadlineNanos(data, index);
 }
+
+// A vsync callback that is delivered once every |vsyncCount| vsyncs. Pipelined renderers schedule
+// the work of several frames from the timelines of one delivery, and between deliveries the thread
+// is only woken once, by a delayed frame callback that asks for the vsync of the next delivery.
+//
+// A batch always has exactly one callback pending with the choreographer, which deletes it once it
+// has been cancelled.
+struct AChoreographerVsyncBatch {
+    AChoreographer* choreographer;
+    AChoreographer_vsyncCallback callback;
+    void* data;
+    uint32_t vsyncCount;
+    bool cancelled = false;
+};
+
+namespace {
+
+void onBatchVsync(const AChoreographerFrameCallbackData* callbackData, void* data);
+
+void onBatchFrame(int64_t /*frameTimeNanos*/, void* data) {
+    auto* batch = static_cast<AChoreographerVsyncBatch*>(data);
+    if (batch->cancelled) {
+        delete batch;
+        return;
+    }
+    AChoreographer_postVsyncCallback(batch->choreographer, onBatchVsync, batch);
+}
+
+void onBatchVsync(const AChoreographerFrameCallbackData* callbackData, void* data) {
+    auto* batch = static_cast<AChoreographerVsyncBatch*>(data);
+    if (batch->cancelled) {
+        delete batch;
+        return;
+    }
+    batch->callback(callbackData, batch->data);
+    if (batch->cancelled) {
+        delete batch;
+        return;
+    }
+
+    // The renderer can't schedule frames past the timelines it was given.
+    const size_t timelines = AChoreographerFrameCallbackData_getFrameTimelinesLength(callbackData);
+    const size_t vsyncCount = std::min<size_t>(batch->vsyncCount, timelines);
+    if (vsyncCount < 2) {
+        AChoreographer_postVsyncCallback(batch->choreographer, onBatchVsync, batch);
+        return;
+    }
+
+    // The frame callback runs on the first vsync after its delay, so aim the delay halfway
+    // between the two vsyncs before the next delivery.
+    const int64_t period =
+            AChoreographerFrameCallbackData_getFrameTimelineExpectedPresentationTimeNanos(
+                    callbackData, 1) -
+            AChoreographerFrameCallbackData_getFrameTimelineExpectedPresentationTimeNanos(
+                    callbackData, 0);
+    const int64_t target = AChoreographerFrameCallbackData_getFrameTimeNanos(callbackData) +
+            period * (static_cast<int64_t>(vsyncCount) - 1) - period / 2;
+    const int64_t delay = std::max<int64_t>(target - systemTime(SYSTEM_TIME_MONOTONIC), 0);
+    AChoreographer_postFrameCallbackDelayed64(batch->choreographer, onBatchFrame, batch,
+                                              static_cast<uint32_t>(ns2ms(delay)));
+}
+
+} // namespace
+
+// Posts |callback| to run on the next vsync and then on every |vsyncCount|th vsync, with the frame
+// timelines of the vsync it runs on, until the returned batch is cancelled. Each call is expected
+// to schedule the frames of the first |vsyncCount| timelines, or of all of them if there are fewer.
+// The batch must be cancelled on the thread of |choreographer|.
+//
+// These aren't declared by a public header yet, so they need C linkage of their own.
+extern "C" AChoreographerVsyncBatch* AChoreographer_postVsyncBatchCallback(
+        AChoreographer* choreographer, AChoreographer_vsyncCallback callback, void* data,
+        uint32_t vsyncCount) {
+    if (vsyncCount == 0) {
+        return nullptr;
+    }
+    auto* batch = new AChoreographerVsyncBatch{choreographer, callback, data, vsyncCount};
+    AChoreographer_postVsyncCallback(choreographer, onBatchVsync, batch);
+    return batch;
+}
+
+extern "C" void AChoreographerVsyncBatch_cancel(AChoreographerVsyncBatch* batch) {
+    if (batch != nullptr) {
+        batch->cancelled = true;
+    }
+}
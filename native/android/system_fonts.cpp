@@ -23,6 +23,7 @@
 #include <android/system_fonts.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -87,15 +88,9 @@ struct FontHasher {
 };
 
 struct ASystemFontIterator {
-    std::vector<AFont> fonts;
-    uint32_t index;
-
-    XmlDocUniquePtr mXmlDoc;
-
-    ParserState state;
-
-    // The OEM customization XML.
-    XmlDocUniquePtr mCustomizationXmlDoc;
+    // Shared with the font catalog, which replaces the list rather than modifying it.
+    std::shared_ptr<const std::vector<AFont>> fonts;
+    uint32_t index = 0;
 };
 
 struct AFontMatcher {
@@ -236,40 +231,112 @@ bool findFirstFontNode(const XmlDocUniquePtr& doc, ParserState* state) {
     return font != nullptr;
 }
 
-}  // namespace
+bool findNextFontNode(const XmlDocUniquePtr& xmlDoc, ParserState* state) {
+    if (state->mFontNode == nullptr) {
+        if (!xmlDoc) {
+            return false;  // Already at the end.
+        } else {
+            // First time to query font.
+            return findFirstFontNode(xmlDoc, state);
+        }
+    } else {
+        xmlNode* nextNode = nextSibling(state->mFontNode, FONT_TAG);
+        while (nextNode == nullptr) {
+            xmlNode* family = nextSibling(state->mFontNode->parent, FAMILY_TAG);
+            if (family == nullptr) {
+                break;
+            }
+            state->mLocale.reset(xmlGetProp(family, LOCALE_ATTR_NAME));
+            nextNode = firstElement(family, FONT_TAG);
+        }
+        state->mFontNode = nextNode;
+        return nextNode != nullptr;
+    }
+}
 
-ASystemFontIterator* ASystemFontIterator_open() {
-    std::unique_ptr<ASystemFontIterator> ite(new ASystemFontIterator());
+void appendFontsFromXml(const char* xmlPath, const std::string& pathPrefix,
+                        std::vector<AFont>* out) {
+    XmlDocUniquePtr xmlDoc(xmlReadFile(xmlPath, nullptr, 0));
+    ParserState state;
+    while (findNextFontNode(xmlDoc, &state)) {
+        AFont font;
+        copyFont(xmlDoc, state, &font, pathPrefix);
+        if (isFontFileAvailable(font.mFilePath)) {
+            out->push_back(std::move(font));
+        }
+    }
+}
 
-    std::unordered_set<AFont, FontHasher> fonts;
-    minikin::SystemFonts::getFontSet(
-            [&fonts](const std::vector<std::shared_ptr<minikin::Font>>& fontSet) {
-                for (const auto& font : fontSet) {
-                    std::optional<std::string> locale;
-                    uint32_t localeId = font->getLocaleListId();
-                    if (localeId != minikin::kEmptyLocaleListId) {
-                        locale.emplace(minikin::getLocaleString(localeId));
-                    }
-                    std::vector<std::pair<uint32_t, float>> axes;
-                    for (const auto& [tag, value] : font->typeface()->GetAxes()) {
-                        axes.push_back(std::make_pair(tag, value));
+// The system fonts, listed once per process rather than on every ASystemFontIterator_open. The
+// fonts hwui gave minikin are listed again only once minikin's font set changes, and the XML
+// configuration, only used if there are none, is parsed at most once.
+class SystemFontCatalog {
+public:
+    static SystemFontCatalog& get() {
+        static SystemFontCatalog catalog;
+        return catalog;
+    }
+
+    std::shared_ptr<const std::vector<AFont>> getFonts() {
+        std::lock_guard lock(mMutex);
+        bool isFontSetEmpty = false;
+        minikin::SystemFonts::getFontSet(
+                [&](const std::vector<std::shared_ptr<minikin::Font>>& fontSet) {
+                    isFontSetEmpty = fontSet.empty();
+                    if (!isFontSetEmpty && (!mFonts || fontSet != mFontSet)) {
+                        mFontSet = fontSet;
+                        mFonts = listFonts(fontSet);
                     }
+                });
+        if (!isFontSetEmpty) {
+            return mFonts;
+        }
+        if (!mXmlFonts) {
+            auto fonts = std::make_shared<std::vector<AFont>>();
+            appendFontsFromXml("/system/etc/fonts.xml", "/system/fonts/", fonts.get());
+            // TODO: Filter only customizationType="new-named-family"
+            appendFontsFromXml("/product/etc/fonts_customization.xml", "/product/fonts/",
+                               fonts.get());
+            mXmlFonts = std::move(fonts);
+        }
+        return mXmlFonts;
+    }
 
-                    fonts.insert({font->typeface()->GetFontPath(), std::move(locale),
-                                  font->style().weight(),
-                                  font->style().slant() == minikin::FontStyle::Slant::ITALIC,
-                                  static_cast<uint32_t>(font->typeface()->GetFontIndex()), axes});
-                }
-            });
-
-    if (fonts.empty()) {
-        ite->mXmlDoc.reset(xmlReadFile("/system/etc/fonts.xml", nullptr, 0));
-        ite->mCustomizationXmlDoc.reset(
-                xmlReadFile("/product/etc/fonts_customization.xml", nullptr, 0));
-    } else {
-        ite->index = 0;
-        ite->fonts.assign(fonts.begin(), fonts.end());
+private:
+    static std::shared_ptr<const std::vector<AFont>> listFonts(
+            const std::vector<std::shared_ptr<minikin::Font>>& fontSet) {
+        std::unordered_set<AFont, FontHasher> fonts;
+        for (const auto& font : fontSet) {
+            std::optional<std::string> locale;
+            uint32_t localeId = font->getLocaleListId();
+            if (localeId != minikin::kEmptyLocaleListId) {
+                locale.emplace(minikin::getLocaleString(localeId));
+            }
+            std::vector<std::pair<uint32_t, float>> axes;
+            for (const auto& [tag, value] : font->typeface()->GetAxes()) {
+                axes.push_back(std::make_pair(tag, value));
+            }
+
+            fonts.insert({font->typeface()->GetFontPath(), std::move(locale),
+                          font->style().weight(),
+                          font->style().slant() == minikin::FontStyle::Slant::ITALIC,
+                          static_cast<uint32_t>(font->typeface()->GetFontIndex()), axes});
+        }
+        return std::make_shared<const std::vector<AFont>>(fonts.begin(), fonts.end());
     }
+
+    std::mutex mMutex;
+    // The font set mFonts was listed from, which keeps its fonts from being reused.
+    std::vector<std::shared_ptr<minikin::Font>> mFontSet;
+    std::shared_ptr<const std::vector<AFont>> mFonts;
+    std::shared_ptr<const std::vector<AFont>> mXmlFonts;
+};
+
+}  // namespace
+
+ASystemFontIterator* ASystemFontIterator_open() {
+    std::unique_ptr<ASystemFontIterator> ite(new ASystemFontIterator());
+    ite->fonts = SystemFontCatalog::get().getFonts();
     return ite.release();
 }
 
@@ -339,67 +406,12 @@ AFont* _Nonnull AFontMatcher_match(
     return result.release();
 }
 
-bool findNextFontNode(const XmlDocUniquePtr& xmlDoc, ParserState* state) {
-    if (state->mFontNode == nullptr) {
-        if (!xmlDoc) {
-            return false;  // Already at the end.
-        } else {
-            // First time to query font.
-            return findFirstFontNode(xmlDoc, state);
-        }
-    } else {
-        xmlNode* nextNode = nextSibling(state->mFontNode, FONT_TAG);
-        while (nextNode == nullptr) {
-            xmlNode* family = nextSibling(state->mFontNode->parent, FAMILY_TAG);
-            if (family == nullptr) {
-                break;
-            }
-            state->mLocale.reset(xmlGetProp(family, LOCALE_ATTR_NAME));
-            nextNode = firstElement(family, FONT_TAG);
-        }
-        state->mFontNode = nextNode;
-        return nextNode != nullptr;
-    }
-}
-
 AFont* ASystemFontIterator_next(ASystemFontIterator* ite) {
     LOG_ALWAYS_FATAL_IF(ite == nullptr, "nullptr has passed as iterator argument");
-    if (!ite->fonts.empty()) {
-        if (ite->index >= ite->fonts.size()) {
-            return nullptr;
-        }
-        return new AFont(ite->fonts[ite->index++]);
+    if (ite->index >= ite->fonts->size()) {
+        return nullptr;
     }
-
-    if (ite->mXmlDoc) {
-        if (!findNextFontNode(ite->mXmlDoc, &ite->state)) {
-            // Reached end of the XML file. Continue OEM customization.
-            ite->mXmlDoc.reset();
-        } else {
-            std::unique_ptr<AFont> font = std::make_unique<AFont>();
-            copyFont(ite->mXmlDoc, ite->state, font.get(), "/system/fonts/");
-            if (!isFontFileAvailable(font->mFilePath)) {
-                return ASystemFontIterator_next(ite);
-            }
-            return font.release();
-        }
-    }
-    if (ite->mCustomizationXmlDoc) {
-        // TODO: Filter only customizationType="new-named-family"
-        if (!findNextFontNode(ite->mCustomizationXmlDoc, &ite->state)) {
-            // Reached end of the XML file. Finishing
-            ite->mCustomizationXmlDoc.reset();
-            return nullptr;
-        } else {
-            std::unique_ptr<AFont> font = std::make_unique<AFont>();
-            copyFont(ite->mCustomizationXmlDoc, ite->state, font.get(), "/product/fonts/");
-            if (!isFontFileAvailable(font->mFilePath)) {
-                return ASystemFontIterator_next(ite);
-            }
-            return font.release();
-        }
-    }
-    return nullptr;
+    return new AFont((*ite->fonts)[ite->index++]);
 }
 
 void AFont_close(AFont* font) {
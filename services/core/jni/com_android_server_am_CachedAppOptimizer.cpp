@@ -27,6 +27,7 @@
 #include <binder/IPCThreadState.h>
 #include <cutils/compiler.h>
 #include <dirent.h>
+#include <inttypes.h>
 #include <jni.h>
 #include <linux/errno.h>
 #include <linux/time.h>
@@ -37,6 +38,7 @@
 #include <processgroup/processgroup.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/pidfd.h>
 #include <sys/stat.h>
@@ -48,6 +50,15 @@
 #include <utils/Trace.h>
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core_jni_helpers.h"
 
 using android::base::StringPrintf;
 using android::base::WriteStringToFile;
@@ -351,98 +362,274 @@ static int getAnyPageAdvice(const Vma& vma) {
     return MADV_COLD;
 }
 
-// Perform a full process compaction using process_madvise syscall
-// using the madvise behavior defined by vmaToAdviseFunc per VMA.
-//
-// Currently supported behaviors are MADV_COLD and MADV_PAGEOUT.
-//
-// Returns the total number of bytes compacted on success. On error
-// returns process_madvise errno code or if compaction was cancelled
-// it returns ERROR_COMPACTION_CANCELLED.
+// A VMA given an advice, and the size it had resident right after the compaction, in kB.
+struct AdvisedVma {
+    uint64_t start;
+    uint64_t end;
+    uint64_t rss = 0;
+};
+
+// The VMAs of a process to compact, split by the advice to give them. The vectors are only
+// overwritten and grown, not cleared, to reuse their VMAs between processes.
+struct ProcessVmas {
+    int pid = 0;
+    int compactionFlags = 0;
+    std::vector<Vma> pageoutVmas = std::vector<Vma>(2000);
+    std::vector<Vma> coldVmas = std::vector<Vma>(2000);
+    int pageoutVmaCount = 0;
+    int coldVmaCount = 0;
+    // Every VMA given an advice, including those left out of the vectors because the last
+    // compaction of the process already advised them.
+    std::vector<AdvisedVma> advisedVmas;
+    std::string mapsBuffer;
+};
+
+// Two, so that compactProcesses() collects the VMAs of a process while madvising those of the
+// previous one.
+static ProcessVmas gProcessVmas[2];
+
+// What a process looked like right after its last successful compaction, so that compacting it
+// again only advises what changed since.
+struct CompactedProcess {
+    int compactionFlags;
+    bool systemCompaction;
+    // The start time of the process from /proc/pid/stat, which tells a reused pid apart.
+    uint64_t startTime;
+    // The VMAs that were advised, ascending like in /proc/pid/maps.
+    std::vector<AdvisedVma> advisedVmas;
+    uint64_t sequence;
+};
+
+// Enough for the cached apps and the processes of compactSystem(); past that the least recently
+// compacted process is forgotten.
+static constexpr size_t kMaxCompactedProcesses = 256;
+
+// Taken by the thread collecting the VMAs of the next process in compactProcesses() and by the
+// one compacting the current one.
+static std::mutex gCompactedProcessesLock;
+static std::unordered_map<int, CompactedProcess> gCompactedProcesses;
+static uint64_t gCompactionSequence = 0;
+
+static bool readStartTime(int pid, uint64_t* outStartTime) {
+    std::string stat;
+    if (!android::base::ReadFileToString(StringPrintf("/proc/%d/stat", pid), &stat)) {
+        return false;
+    }
+    // The command name may contain spaces and parentheses, so count the fields from the last
+    // parenthesis. The start time is the 22nd field, the 20th after the command name.
+    const size_t commEnd = stat.rfind(')');
+    if (commEnd == std::string::npos) {
+        return false;
+    }
+    const char* field = stat.c_str() + commEnd + 1;
+    for (int i = 0; i < 19; i++) {
+        field = strchr(field + 1, ' ');
+        if (field == nullptr) {
+            return false;
+        }
+    }
+    return sscanf(field, " %" SCNu64, outStartTime) == 1;
+}
+
+// Remembers the VMAs that compactVmas() just advised, or that an earlier compaction had, with
+// what each of them kept resident.
+static void recordCompaction(const ProcessVmas& vmas) {
+    CompactedProcess compacted{.compactionFlags = vmas.compactionFlags,
+                               .systemCompaction = inSystemCompaction,
+                               .advisedVmas = vmas.advisedVmas};
+    if (!readStartTime(vmas.pid, &compacted.startTime)) {
+        return;
+    }
+    // Both lists are ascending, so walk them together. A VMA that is gone keeps a resident size
+    // of 0, and can't match one of the next compaction anyway.
+    size_t index = 0;
+    auto& advised = compacted.advisedVmas;
+    ProcMemInfo meminfo(vmas.pid);
+    meminfo.ForEachVma([&](const Vma& vma) {
+        while (index < advised.size() && advised[index].start < vma.start) {
+            index++;
+        }
+        if (index < advised.size() && advised[index].start == vma.start &&
+            advised[index].end == vma.end) {
+            advised[index].rss = vma.usage.rss;
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(gCompactedProcessesLock);
+    compacted.sequence = ++gCompactionSequence;
+    if (gCompactedProcesses.size() >= kMaxCompactedProcesses &&
+        gCompactedProcesses.find(vmas.pid) == gCompactedProcesses.end()) {
+        auto oldest = std::min_element(gCompactedProcesses.begin(), gCompactedProcesses.end(),
+                                       [](const auto& a, const auto& b) {
+                                           return a.second.sequence < b.second.sequence;
+                                       });
+        gCompactedProcesses.erase(oldest);
+    }
+    gCompactedProcesses[vmas.pid] = std::move(compacted);
+}
+
+static void addVma(std::vector<Vma>& vmas, int& count, const Vma& vma) {
+    if (count < vmas.size()) {
+        vmas[count] = vma;
+    } else {
+        vmas.push_back(vma);
+    }
+    ++count;
+}
+
+// Reads the VMAs of pid from /proc/pid/maps into outVmas, keeping those that
+// vmaToAdviseFunc gives an advice.
 //
-// Not thread safe. We reuse vectors so we assume this is called only
-// on one thread at most.
-static int64_t compactProcess(int pid, VmaToAdviseFunc vmaToAdviseFunc) {
-    cancelRunningCompaction.store(false);
-    static std::string mapsBuffer;
+// If the same process was last compacted with the same flags, /proc/pid/smaps is read instead,
+// and a VMA advised by the last compaction is left out unless it has more resident since.
+static void collectVmas(int pid, int compactionFlags, const VmaToAdviseFunc& vmaToAdviseFunc,
+                        ProcessVmas* outVmas) {
     ATRACE_BEGIN("CollectVmas");
+    outVmas->pid = pid;
+    outVmas->compactionFlags = compactionFlags;
+    outVmas->pageoutVmaCount = 0;
+    outVmas->coldVmaCount = 0;
+    outVmas->advisedVmas.clear();
+
+    // Taken out, to be recorded again only if this compaction succeeds.
+    CompactedProcess previous;
+    bool incremental = false;
+    {
+        std::lock_guard<std::mutex> lock(gCompactedProcessesLock);
+        auto it = gCompactedProcesses.find(pid);
+        if (it != gCompactedProcesses.end()) {
+            previous = std::move(it->second);
+            gCompactedProcesses.erase(it);
+            incremental = previous.compactionFlags == compactionFlags &&
+                    previous.systemCompaction == inSystemCompaction;
+        }
+    }
+    uint64_t startTime;
+    incremental = incremental && readStartTime(pid, &startTime) && startTime == previous.startTime;
+
     ProcMemInfo meminfo(pid);
-    static std::vector<Vma> pageoutVmas(2000), coldVmas(2000);
-    int coldVmaIndex = 0;
-    int pageoutVmaIndex = 0;
-    auto vmaCollectorCb = [&vmaToAdviseFunc, &pageoutVmaIndex, &coldVmaIndex](const Vma& vma) {
+    size_t previousIndex = 0;
+    int skippedVmas = 0;
+    auto vmaCollectorCb = [&](const Vma& vma) {
         int advice = vmaToAdviseFunc(vma);
+        if (advice != MADV_COLD && advice != MADV_PAGEOUT) {
+            return;
+        }
+        outVmas->advisedVmas.push_back({.start = vma.start, .end = vma.end});
+        if (incremental) {
+            // Both lists are ascending, so walk them together.
+            const auto& advised = previous.advisedVmas;
+            while (previousIndex < advised.size() && advised[previousIndex].start < vma.start) {
+                previousIndex++;
+            }
+            if (previousIndex < advised.size() && advised[previousIndex].start == vma.start &&
+                advised[previousIndex].end == vma.end &&
+                vma.usage.rss <= advised[previousIndex].rss) {
+                skippedVmas++;
+                return;
+            }
+        }
         switch (advice) {
             case MADV_COLD:
-                if (coldVmaIndex < coldVmas.size()) {
-                    coldVmas[coldVmaIndex] = vma;
-                } else {
-                    coldVmas.push_back(vma);
-                }
-                ++coldVmaIndex;
+                addVma(outVmas->coldVmas, outVmas->coldVmaCount, vma);
                 break;
             case MADV_PAGEOUT:
-                if (pageoutVmaIndex < pageoutVmas.size()) {
-                    pageoutVmas[pageoutVmaIndex] = vma;
-                } else {
-                    pageoutVmas.push_back(vma);
-                }
-                ++pageoutVmaIndex;
+                addVma(outVmas->pageoutVmas, outVmas->pageoutVmaCount, vma);
                 break;
         }
     };
-    meminfo.ForEachVmaFromMaps(vmaCollectorCb, mapsBuffer);
+    if (incremental) {
+        meminfo.ForEachVma(vmaCollectorCb);
+    } else {
+        meminfo.ForEachVmaFromMaps(vmaCollectorCb, outVmas->mapsBuffer);
+    }
     ATRACE_END();
 #ifdef DEBUG_COMPACTION
-    ALOGE("Total VMAs sent for compaction anon=%d file=%d", pageoutVmaIndex,
-            coldVmaIndex);
+    ALOGE("Total VMAs sent for compaction anon=%d file=%d skipped=%d", outVmas->pageoutVmaCount,
+            outVmas->coldVmaCount, skippedVmas);
 #endif
+}
 
-    int64_t pageoutBytes = compactMemory(pageoutVmas, pid, MADV_PAGEOUT, pageoutVmaIndex);
+// Madvises the VMAs collected by collectVmas, the ones to page out first, and remembers them
+// for the next compaction of the process.
+//
+// Returns 0 and sets the bytes compacted with each advice on success. On
+// error returns process_madvise errno code or ERROR_COMPACTION_CANCELLED.
+static int compactVmas(const ProcessVmas& vmas, int64_t* outPageoutBytes, int64_t* outColdBytes) {
+    int64_t pageoutBytes =
+            compactMemory(vmas.pageoutVmas, vmas.pid, MADV_PAGEOUT, vmas.pageoutVmaCount);
     if (pageoutBytes < 0) {
         // Error, just forward it.
         cancelRunningCompaction.store(false);
         return pageoutBytes;
     }
 
-    int64_t coldBytes = compactMemory(coldVmas, pid, MADV_COLD, coldVmaIndex);
+    int64_t coldBytes = compactMemory(vmas.coldVmas, vmas.pid, MADV_COLD, vmas.coldVmaCount);
     if (coldBytes < 0) {
         // Error, just forward it.
         cancelRunningCompaction.store(false);
         return coldBytes;
     }
 
+    recordCompaction(vmas);
+    *outPageoutBytes = pageoutBytes;
+    *outColdBytes = coldBytes;
+    return 0;
+}
+
+// Perform a full process compaction using process_madvise syscall
+// using the madvise behavior defined by vmaToAdviseFunc per VMA.
+//
+// Currently supported behaviors are MADV_COLD and MADV_PAGEOUT.
+//
+// Returns the total number of bytes compacted on success. On error
+// returns process_madvise errno code or if compaction was cancelled
+// it returns ERROR_COMPACTION_CANCELLED.
+//
+// Not thread safe. We reuse vectors so we assume this is called only
+// on one thread at most.
+static int64_t compactProcess(int pid, int compactionFlags, VmaToAdviseFunc vmaToAdviseFunc) {
+    cancelRunningCompaction.store(false);
+    ProcessVmas& vmas = gProcessVmas[0];
+    collectVmas(pid, compactionFlags, vmaToAdviseFunc, &vmas);
+
+    int64_t pageoutBytes, coldBytes;
+    int error = compactVmas(vmas, &pageoutBytes, &coldBytes);
+    if (error < 0) {
+        return error;
+    }
     return pageoutBytes + coldBytes;
 }
 
-// Compact process using process_madvise syscall or fallback to procfs in
-// case syscall does not exist.
-static void compactProcessOrFallback(int pid, int compactionFlags) {
-    if ((compactionFlags & (COMPACT_ACTION_ANON_FLAG | COMPACT_ACTION_FILE_FLAG)) == 0) return;
+// Set when the system does not support process_madvise syscall to avoid
+// gathering VMAs in subsequent calls prior to falling back to procfs
+static bool shouldForceProcFs = false;
 
+static VmaToAdviseFunc getVmaToAdviseFunc(int compactionFlags, std::string* outCompactionType) {
     bool compactAnon = compactionFlags & COMPACT_ACTION_ANON_FLAG;
     bool compactFile = compactionFlags & COMPACT_ACTION_FILE_FLAG;
 
-    // Set when the system does not support process_madvise syscall to avoid
-    // gathering VMAs in subsequent calls prior to falling back to procfs
-    static bool shouldForceProcFs = false;
-    std::string compactionType;
-    VmaToAdviseFunc vmaToAdviseFunc;
-
     if (compactAnon) {
         if (compactFile) {
-            compactionType = "all";
-            vmaToAdviseFunc = getAnyPageAdvice;
-        } else {
-            compactionType = "anon";
-            vmaToAdviseFunc = getAnonPageAdvice;
+            *outCompactionType = "all";
+            return getAnyPageAdvice;
         }
-    } else {
-        compactionType = "file";
-        vmaToAdviseFunc = getFilePageAdvice;
+        *outCompactionType = "anon";
+        return getAnonPageAdvice;
     }
+    *outCompactionType = "file";
+    return getFilePageAdvice;
+}
+
+// Compact process using process_madvise syscall or fallback to procfs in
+// case syscall does not exist.
+static void compactProcessOrFallback(int pid, int compactionFlags) {
+    if ((compactionFlags & (COMPACT_ACTION_ANON_FLAG | COMPACT_ACTION_FILE_FLAG)) == 0) return;
+
+    std::string compactionType;
+    VmaToAdviseFunc vmaToAdviseFunc = getVmaToAdviseFunc(compactionFlags, &compactionType);
 
-    if (shouldForceProcFs || compactProcess(pid, vmaToAdviseFunc) == -ENOSYS) {
+    if (shouldForceProcFs || compactProcess(pid, compactionFlags, vmaToAdviseFunc) == -ENOSYS) {
         shouldForceProcFs = true;
         compactProcessProcfs(pid, compactionType);
     }
@@ -525,6 +712,107 @@ static void com_android_server_am_CachedAppOptimizer_compactProcess(JNIEnv*, job
     compactProcessOrFallback(pid, compactionFlags);
 }
 
+// These match the COMPACT_STATS_* constants of CachedAppOptimizer.
+enum {
+    COMPACT_STATS_PROCESSES = 0,   // processes compacted without error
+    COMPACT_STATS_PAGEOUT_BYTES,   // bytes advised MADV_PAGEOUT
+    COMPACT_STATS_COLD_BYTES,      // bytes advised MADV_COLD
+    COMPACT_STATS_COLLECT_NS,      // reading /proc/pid/maps, mostly hidden behind madvising
+    COMPACT_STATS_MADVISE_NS,      // process_madvise calls
+    COMPACT_STATS_STALL_NS,        // waiting for the maps of the next process once madvised
+    COMPACT_STATS_COUNT,
+};
+
+// Compacts many processes in one job, such as the apps cached together after a user switch.
+// While the VMAs of a process are madvised, those of the next one are read from
+// /proc/pid/maps on a second thread, so that neither phase waits on the other.
+//
+// Sets each result to the bytes compacted of its pid or to its error as compactProcess()
+// returns it; once the job is cancelled, the remaining pids get ERROR_COMPACTION_CANCELLED.
+// Fills stats with the COMPACT_STATS_* counters of the whole job.
+//
+// Not thread safe, like compactProcess().
+static void com_android_server_am_CachedAppOptimizer_compactProcesses(JNIEnv* env, jobject,
+        jintArray pidsArray, jint compactionFlags, jlongArray resultsArray, jlongArray statsArray) {
+    jsize count = env->GetArrayLength(pidsArray);
+    if (env->GetArrayLength(resultsArray) < count ||
+        env->GetArrayLength(statsArray) < COMPACT_STATS_COUNT) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                          "Results or stats array too small");
+        return;
+    }
+    std::vector<jint> pids(count);
+    env->GetIntArrayRegion(pidsArray, 0, count, pids.data());
+    std::vector<jlong> results(count, 0);
+    jlong stats[COMPACT_STATS_COUNT] = {};
+
+    std::string compactionType;
+    VmaToAdviseFunc vmaToAdviseFunc = getVmaToAdviseFunc(compactionFlags, &compactionType);
+    if ((compactionFlags & (COMPACT_ACTION_ANON_FLAG | COMPACT_ACTION_FILE_FLAG)) == 0) {
+        count = 0;
+    } else if (shouldForceProcFs) {
+        for (jint pid : pids) {
+            compactProcessProcfs(pid, compactionType);
+        }
+        count = 0;
+    }
+
+    ATRACE_BEGIN(StringPrintf("CompactProcesses %d", count).c_str());
+    cancelRunningCompaction.store(false);
+    std::atomic<nsecs_t> collectNs = 0;
+    auto collect = [&](jsize i) {
+        const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        collectVmas(pids[i], compactionFlags, vmaToAdviseFunc, &gProcessVmas[i % 2]);
+        collectNs += systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    };
+    if (count > 0) {
+        collect(0);
+    }
+    for (jsize i = 0; i < count; i++) {
+        std::thread nextCollector;
+        if (i + 1 < count) {
+            nextCollector = std::thread(collect, i + 1);
+        }
+
+        const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        int64_t pageoutBytes, coldBytes;
+        int error = compactVmas(gProcessVmas[i % 2], &pageoutBytes, &coldBytes);
+        const nsecs_t madvised = systemTime(SYSTEM_TIME_MONOTONIC);
+        stats[COMPACT_STATS_MADVISE_NS] += madvised - start;
+
+        if (nextCollector.joinable()) {
+            nextCollector.join();
+            stats[COMPACT_STATS_STALL_NS] += systemTime(SYSTEM_TIME_MONOTONIC) - madvised;
+        }
+
+        if (error == -ENOSYS) {
+            shouldForceProcFs = true;
+            for (jsize j = i; j < count; j++) {
+                compactProcessProcfs(pids[j], compactionType);
+                results[j] = -ENOSYS;
+            }
+            break;
+        }
+        if (error == ERROR_COMPACTION_CANCELLED) {
+            std::fill(results.begin() + i, results.end(), ERROR_COMPACTION_CANCELLED);
+            break;
+        }
+        if (error < 0) {
+            results[i] = error;
+            continue;
+        }
+        results[i] = pageoutBytes + coldBytes;
+        stats[COMPACT_STATS_PROCESSES]++;
+        stats[COMPACT_STATS_PAGEOUT_BYTES] += pageoutBytes;
+        stats[COMPACT_STATS_COLD_BYTES] += coldBytes;
+    }
+    stats[COMPACT_STATS_COLLECT_NS] = collectNs;
+    ATRACE_END();
+
+    env->SetLongArrayRegion(resultsArray, 0, results.size(), results.data());
+    env->SetLongArrayRegion(statsArray, 0, COMPACT_STATS_COUNT, stats);
+}
+
 static jint com_android_server_am_CachedAppOptimizer_freezeBinder(JNIEnv* env, jobject clazz,
                                                                   jint pid, jboolean freeze,
                                                                   jint timeout_ms) {
@@ -598,10 +886,19 @@ static const JNINativeMethod sMethods[] = {
         {"isFreezerProfileValid", "()Z",
          (void*)com_android_server_am_CachedAppOptimizer_isFreezerProfileValid}};
 
+// Registered only if CachedAppOptimizer declares them.
+static const JNINativeMethod sOptionalMethods[] = {
+        {"compactProcesses", "([II[J[J)V",
+         (void*)com_android_server_am_CachedAppOptimizer_compactProcesses},
+};
+
 int register_android_server_am_CachedAppOptimizer(JNIEnv* env)
 {
-    return jniRegisterNativeMethods(env, "com/android/server/am/CachedAppOptimizer",
-                                    sMethods, NELEM(sMethods));
+    int res = jniRegisterNativeMethods(env, "com/android/server/am/CachedAppOptimizer",
+                                       sMethods, NELEM(sMethods));
+    RegisterOptionalMethods(env, "com/android/server/am/CachedAppOptimizer", sOptionalMethods,
+                            NELEM(sOptionalMethods));
+    return res;
 }
 
 }
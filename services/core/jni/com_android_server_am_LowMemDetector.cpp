@@ -17,13 +17,23 @@
 #define LOG_TAG "LowMemDetector"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <psi/psi.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <unistd.h>
 
+#include <android-base/stringprintf.h>
 #include <jni.h>
 #include <nativehelper/JNIHelp.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include <vector>
+
+#include "core_jni_helpers.h"
 
 namespace android {
 
@@ -141,6 +151,224 @@ static jint android_server_am_LowMemDetector_waitForPressure(JNIEnv*, jobject) {
     return pressure_level;
 }
 
+// These match the PSI_RESOURCE_* constants of LowMemDetector.
+enum pressure_resources {
+    PSI_RESOURCE_MEMORY,
+    PSI_RESOURCE_IO,
+    PSI_RESOURCE_CPU,
+    PSI_RESOURCE_COUNT
+};
+
+static const char* const kPressureFiles[PSI_RESOURCE_COUNT] = {
+    "/proc/pressure/memory",
+    "/proc/pressure/io",
+    "/proc/pressure/cpu",
+};
+
+// These match the PRESSURE_EVENT_* constants of LowMemDetector. The stall totals are in us,
+// or -1 for a resource without triggers.
+enum pressure_event_fields {
+    PRESSURE_EVENT_TRIGGERS,    // bit i set if trigger i fired
+    PRESSURE_EVENT_TIME_NS,     // CLOCK_MONOTONIC when the event was read
+    PRESSURE_EVENT_MEMORY_SOME_US,
+    PRESSURE_EVENT_MEMORY_FULL_US,
+    PRESSURE_EVENT_IO_SOME_US,
+    PRESSURE_EVENT_IO_FULL_US,
+    PRESSURE_EVENT_CPU_SOME_US,
+    PRESSURE_EVENT_CPU_FULL_US,
+    PRESSURE_EVENT_FIELD_COUNT
+};
+
+// Each trigger is {resource, stall type, stall us, window us}.
+static constexpr int TRIGGER_FIELD_COUNT = 4;
+// As many as PRESSURE_EVENT_TRIGGERS has bits.
+static constexpr int MAX_TRIGGERS = 64;
+
+// The triggers of initTriggers(), all polled by one epoll, and the pressure files of their
+// resources to read the stall totals from.
+static int trigger_epollfd = -1;
+static std::vector<int> trigger_fds;
+static int pressure_stat_fds[PSI_RESOURCE_COUNT] = {-1, -1, -1};
+
+static void close_triggers() {
+    for (int fd : trigger_fds) {
+        close(fd);
+    }
+    trigger_fds.clear();
+    for (int& fd : pressure_stat_fds) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (trigger_epollfd >= 0) {
+        close(trigger_epollfd);
+        trigger_epollfd = -1;
+    }
+}
+
+// Like init_psi_monitor(), for any resource.
+static int open_psi_trigger(int resource, int stall_type, int threshold_us, int window_us) {
+    int fd = TEMP_FAILURE_RETRY(open(kPressureFiles[resource], O_WRONLY | O_CLOEXEC));
+    if (fd < 0) {
+        ALOGE("No kernel psi monitor support for %s: %s", kPressureFiles[resource],
+              strerror(errno));
+        return -1;
+    }
+
+    std::string trigger = android::base::StringPrintf("%s %d %d",
+                                                      stall_type == PSI_FULL ? "full" : "some",
+                                                      threshold_us, window_us);
+    if (TEMP_FAILURE_RETRY(write(fd, trigger.c_str(), trigger.size() + 1)) < 0) {
+        ALOGE("Failed to write \"%s\" to %s: %s", trigger.c_str(), kPressureFiles[resource],
+              strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads the some and full stall totals of a pressure file, leaving -1 for those it lacks.
+static void read_stall_totals(int fd, jlong* out_some_us, jlong* out_full_us) {
+    *out_some_us = -1;
+    *out_full_us = -1;
+    if (fd < 0) {
+        return;
+    }
+
+    char buf[256];
+    ssize_t size = TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf) - 1, 0));
+    if (size <= 0) {
+        return;
+    }
+    buf[size] = '\0';
+
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\nfull ...".
+    for (char* line = buf; line != nullptr && *line != '\0';) {
+        char* next = strchr(line, '\n');
+        if (next != nullptr) {
+            *next++ = '\0';
+        }
+        const char* total = strstr(line, "total=");
+        uint64_t value;
+        if (total != nullptr && sscanf(total, "total=%" SCNu64, &value) == 1) {
+            if (strncmp(line, "some", 4) == 0) {
+                *out_some_us = value;
+            } else if (strncmp(line, "full", 4) == 0) {
+                *out_full_us = value;
+            }
+        }
+        line = next;
+    }
+}
+
+// Replaces the triggers of waitForPressureEvent() with those of the array, made of
+// {resource, stall type, stall us, window us} for each of them. Returns 0 on success, -1 if the
+// kernel rejects a trigger, in which case there are none left.
+static jint android_server_am_LowMemDetector_initTriggers(JNIEnv* env, jobject,
+                                                          jintArray triggers_array) {
+    const jsize length = env->GetArrayLength(triggers_array);
+    const int count = length / TRIGGER_FIELD_COUNT;
+    if (length % TRIGGER_FIELD_COUNT != 0 || count == 0 || count > MAX_TRIGGERS) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                             "Expected 1 to %d triggers of %d ints, got %d ints", MAX_TRIGGERS,
+                             TRIGGER_FIELD_COUNT, length);
+        return -1;
+    }
+    std::vector<jint> triggers(length);
+    env->GetIntArrayRegion(triggers_array, 0, length, triggers.data());
+    for (int i = 0; i < count; i++) {
+        const jint* trigger = &triggers[i * TRIGGER_FIELD_COUNT];
+        if (trigger[0] < 0 || trigger[0] >= PSI_RESOURCE_COUNT ||
+            (trigger[1] != PSI_SOME && trigger[1] != PSI_FULL) || trigger[2] <= 0 ||
+            trigger[3] <= 0) {
+            jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                                 "Invalid trigger %d: {%d, %d, %d, %d}", i, trigger[0],
+                                 trigger[1], trigger[2], trigger[3]);
+            return -1;
+        }
+    }
+
+    close_triggers();
+    trigger_epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (trigger_epollfd == -1) {
+        ALOGE("epoll_create failed: %s", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        const jint* trigger = &triggers[i * TRIGGER_FIELD_COUNT];
+        const int resource = trigger[0];
+        int fd = open_psi_trigger(resource, trigger[1], trigger[2], trigger[3]);
+        if (fd < 0) {
+            close_triggers();
+            return -1;
+        }
+        trigger_fds.push_back(fd);
+
+        struct epoll_event event = {};
+        event.events = EPOLLPRI;
+        event.data.u32 = i;
+        if (epoll_ctl(trigger_epollfd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ALOGE("Failed to register psi trigger %d: %s", i, strerror(errno));
+            close_triggers();
+            return -1;
+        }
+
+        if (pressure_stat_fds[resource] < 0) {
+            pressure_stat_fds[resource] =
+                    TEMP_FAILURE_RETRY(open(kPressureFiles[resource], O_RDONLY | O_CLOEXEC));
+        }
+    }
+    return 0;
+}
+
+// Waits up to timeout_ms, or forever if negative, for any trigger of initTriggers() to fire,
+// then fills event with the PRESSURE_EVENT_* fields. Returns how many triggers fired, 0 on
+// timeout, or -1 on error.
+static jint android_server_am_LowMemDetector_waitForPressureEvent(JNIEnv* env, jobject,
+                                                                  jint timeout_ms,
+                                                                  jlongArray event_array) {
+    if (env->GetArrayLength(event_array) < PRESSURE_EVENT_FIELD_COUNT) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Event array too small");
+        return -1;
+    }
+    if (trigger_epollfd < 0) {
+        ALOGE("Pressure triggers are not initialized");
+        return -1;
+    }
+
+    struct epoll_event events[MAX_TRIGGERS];
+    int nevents;
+    do {
+        nevents = epoll_wait(trigger_epollfd, events, MAX_TRIGGERS, timeout_ms);
+        // keep waiting if interrupted
+    } while (nevents == -1 && errno == EINTR);
+    if (nevents == -1) {
+        ALOGE("epoll_wait failed while waiting for psi events: %s", strerror(errno));
+        return -1;
+    }
+
+    jlong event[PRESSURE_EVENT_FIELD_COUNT] = {};
+    uint64_t triggered = 0;
+    for (int i = 0; i < nevents; i++) {
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            // should never happen unless psi got disabled in kernel
+            ALOGE("Pressure events are not available anymore");
+            return -1;
+        }
+        triggered |= 1ULL << events[i].data.u32;
+    }
+    event[PRESSURE_EVENT_TRIGGERS] = static_cast<jlong>(triggered);
+    event[PRESSURE_EVENT_TIME_NS] = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int resource = 0; resource < PSI_RESOURCE_COUNT; resource++) {
+        read_stall_totals(pressure_stat_fds[resource],
+                          &event[PRESSURE_EVENT_MEMORY_SOME_US + 2 * resource],
+                          &event[PRESSURE_EVENT_MEMORY_FULL_US + 2 * resource]);
+    }
+    env->SetLongArrayRegion(event_array, 0, PRESSURE_EVENT_FIELD_COUNT, event);
+    return nevents;
+}
+
 static const JNINativeMethod sMethods[] = {
     /* name, signature, funcPtr */
     {"init", "()I", (void*)android_server_am_LowMemDetector_init},
@@ -148,9 +376,19 @@ static const JNINativeMethod sMethods[] = {
      (void*)android_server_am_LowMemDetector_waitForPressure},
 };
 
+// Registered only if LowMemDetector declares them.
+static const JNINativeMethod sTriggerMethods[] = {
+    {"initTriggers", "([I)I", (void*)android_server_am_LowMemDetector_initTriggers},
+    {"waitForPressureEvent", "(I[J)I",
+     (void*)android_server_am_LowMemDetector_waitForPressureEvent},
+};
+
 int register_android_server_am_LowMemDetector(JNIEnv* env) {
-    return jniRegisterNativeMethods(env, "com/android/server/am/LowMemDetector",
-                                    sMethods, NELEM(sMethods));
+    int res = jniRegisterNativeMethods(env, "com/android/server/am/LowMemDetector",
+                                       sMethods, NELEM(sMethods));
+    RegisterOptionalMethods(env, "com/android/server/am/LowMemDetector", sTriggerMethods,
+                            NELEM(sTriggerMethods));
+    return res;
 }
 
 } // namespace android
@@ -60,6 +60,9 @@
 
 #include <atomic>
 #include <cinttypes>
+#include <map>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "android_hardware_display_DisplayViewport.h"
@@ -166,6 +169,18 @@ static struct {
     jmethodID getAffineTransform;
 } gTouchCalibrationClassInfo;
 
+static struct {
+    jmethodID getResources;
+} gContextClassInfo;
+
+static struct {
+    jmethodID getDisplayMetrics;
+} gResourcesClassInfo;
+
+static struct {
+    jfieldID densityDpi;
+} gDisplayMetricsClassInfo;
+
 static struct {
     jclass clazz;
     jmethodID constructor;
@@ -243,16 +258,81 @@ static void loadSystemIconAsSpriteWithPointerIcon(JNIEnv* env, jobject contextOb
     }
 }
 
-static void loadSystemIconAsSprite(JNIEnv* env, jobject contextObj, PointerIconStyle style,
-                                   SpriteIcon* outSpriteIcon) {
-    PointerIcon pointerIcon;
-    loadSystemIconAsSpriteWithPointerIcon(env, contextObj, style, &pointerIcon, outSpriteIcon);
+// Returns the density of the display of the context, or 0 if it can't be read.
+static int32_t getDensityDpi(JNIEnv* env, jobject contextObj) {
+    if (contextObj == nullptr) {
+        return 0;
+    }
+    ScopedLocalRef<jobject> resources(env,
+            env->CallObjectMethod(contextObj, gContextClassInfo.getResources));
+    if (env->ExceptionCheck() || resources.get() == nullptr) {
+        env->ExceptionClear();
+        return 0;
+    }
+    ScopedLocalRef<jobject> displayMetrics(env,
+            env->CallObjectMethod(resources.get(), gResourcesClassInfo.getDisplayMetrics));
+    if (env->ExceptionCheck() || displayMetrics.get() == nullptr) {
+        env->ExceptionClear();
+        return 0;
+    }
+    return env->GetIntField(displayMetrics.get(), gDisplayMetricsClassInfo.densityDpi);
 }
 
+// A system pointer icon as loaded for a density, which displays of that density share.
+struct SystemPointerIcon {
+    SpriteIcon icon;
+    std::vector<graphics::Bitmap> bitmapFrames;
+    int32_t durationPerFrame{0};
+};
+
 enum {
     WM_ACTION_PASS_TO_USER = 1,
+    // Set by the policy on actions it would return again for the same event until it calls
+    // invalidateInterceptPolicyCache(); the same event is then intercepted without an upcall.
+    WM_ACTION_CACHEABLE = 1 << 30,
+};
+
+// What the policy actions of an event intercepted before queueing depend on, as far as the
+// policy tells by returning WM_ACTION_CACHEABLE. Motion events only use displayId and
+// policyFlags, as only they are passed to interceptMotionBeforeQueueingNonInteractive.
+struct InterceptPolicyKey {
+    bool isKey;
+    int32_t deviceId;
+    int32_t displayId;
+    uint32_t source;
+    int32_t keyCode;
+    int32_t scanCode;
+    int32_t action;
+    int32_t flags;
+    int32_t metaState;
+    bool repeat;
+    uint32_t policyFlags;
+
+    bool operator==(const InterceptPolicyKey& other) const {
+        return isKey == other.isKey && deviceId == other.deviceId &&
+                displayId == other.displayId && source == other.source &&
+                keyCode == other.keyCode && scanCode == other.scanCode && action == other.action &&
+                flags == other.flags && metaState == other.metaState && repeat == other.repeat &&
+                policyFlags == other.policyFlags;
+    }
+};
+
+struct InterceptPolicyKeyHash {
+    size_t operator()(const InterceptPolicyKey& key) const {
+        size_t hash = std::hash<int32_t>()(key.deviceId);
+        for (const int32_t value : {key.displayId, static_cast<int32_t>(key.source), key.keyCode,
+                                    key.scanCode, key.action, key.flags, key.metaState,
+                                    static_cast<int32_t>(key.policyFlags),
+                                    static_cast<int32_t>(key.isKey | key.repeat << 1)}) {
+            hash = hash * 31 + std::hash<int32_t>()(value);
+        }
+        return hash;
+    }
 };
 
+// Plenty for the keys and displays in use; the cache starts over once it fills up.
+static constexpr size_t MAX_INTERCEPT_POLICY_CACHE_ENTRIES = 256;
+
 static std::string getStringElementFromJavaArray(JNIEnv* env, jobjectArray array, jsize index) {
     jstring item = jstring(env->GetObjectArrayElement(array, index));
     ScopedUtfChars chars(env, item);
@@ -300,6 +380,7 @@ public:
     void setShowTouches(bool enabled);
     void setVolumeKeysRotation(int mode);
     void setInteractive(bool interactive);
+    void invalidateInterceptPolicyCache();
     void reloadCalibration();
     void setPointerIconType(PointerIconStyle iconId);
     void reloadPointerIcons();
@@ -439,6 +520,27 @@ private:
     } mLocked GUARDED_BY(mLock);
 
     std::atomic<bool> mInteractive;
+
+    // The policy actions of events intercepted before queueing, which the policy marked
+    // WM_ACTION_CACHEABLE. Separate from mLock, as it is taken for every event.
+    std::mutex mInterceptPolicyCacheLock;
+    std::unordered_map<InterceptPolicyKey, jint, InterceptPolicyKeyHash> mInterceptPolicyCache
+            GUARDED_BY(mInterceptPolicyCacheLock);
+    // Counts invalidations, so that the actions of an upcall that raced with one aren't cached.
+    uint32_t mInterceptPolicyCacheGeneration GUARDED_BY(mInterceptPolicyCacheLock){0};
+
+    // The system pointer icons by density and style, so that displays and reloads of the same
+    // density don't upcall for them and decode them again. Cleared by reloadPointerIcons().
+    std::mutex mSystemPointerIconsLock;
+    std::map<std::pair<int32_t, PointerIconStyle>, SystemPointerIcon> mSystemPointerIcons
+            GUARDED_BY(mSystemPointerIconsLock);
+
+    void loadSystemPointerIcon(JNIEnv* env, jobject contextObj, int32_t densityDpi,
+                               PointerIconStyle style, SystemPointerIcon* outIcon);
+    std::optional<jint> getCachedInterceptActions(const InterceptPolicyKey& key,
+                                                  uint32_t* outGeneration);
+    jint cacheInterceptActions(const InterceptPolicyKey& key, uint32_t generation,
+                               jint wmActions);
     void updateInactivityTimeoutLocked();
     void handleInterceptActions(jint wmActions, nsecs_t when, uint32_t& policyFlags);
     void ensureSpriteControllerLocked();
@@ -474,6 +576,12 @@ void NativeInputManager::dump(std::string& dump) {
     {
         dump += StringPrintf(INDENT "Interactive: %s\n", toString(mInteractive.load()));
     }
+    {
+        std::scoped_lock _l(mInterceptPolicyCacheLock);
+        dump += StringPrintf(INDENT "Intercept Policy Cache: %zu entries, generation=%" PRIu32
+                             "\n",
+                             mInterceptPolicyCache.size(), mInterceptPolicyCacheGeneration);
+    }
     {
         std::scoped_lock _l(mLock);
         dump += StringPrintf(INDENT "System UI Lights Out: %s\n",
@@ -1255,6 +1363,42 @@ void NativeInputManager::setInteractive(bool interactive) {
     mInteractive = interactive;
 }
 
+void NativeInputManager::invalidateInterceptPolicyCache() {
+    std::scoped_lock _l(mInterceptPolicyCacheLock);
+    mInterceptPolicyCache.clear();
+    mInterceptPolicyCacheGeneration++;
+}
+
+std::optional<jint> NativeInputManager::getCachedInterceptActions(const InterceptPolicyKey& key,
+                                                                  uint32_t* outGeneration) {
+    std::scoped_lock _l(mInterceptPolicyCacheLock);
+    *outGeneration = mInterceptPolicyCacheGeneration;
+    auto it = mInterceptPolicyCache.find(key);
+    if (it == mInterceptPolicyCache.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+// Returns the actions to apply, without WM_ACTION_CACHEABLE.
+jint NativeInputManager::cacheInterceptActions(const InterceptPolicyKey& key, uint32_t generation,
+                                               jint wmActions) {
+    if ((wmActions & WM_ACTION_CACHEABLE) == 0) {
+        return wmActions;
+    }
+    wmActions &= ~WM_ACTION_CACHEABLE;
+
+    std::scoped_lock _l(mInterceptPolicyCacheLock);
+    if (generation != mInterceptPolicyCacheGeneration) {
+        return wmActions;
+    }
+    if (mInterceptPolicyCache.size() >= MAX_INTERCEPT_POLICY_CACHE_ENTRIES) {
+        mInterceptPolicyCache.clear();
+    }
+    mInterceptPolicyCache[key] = wmActions;
+    return wmActions;
+}
+
 void NativeInputManager::reloadCalibration() {
     mInputManager->getReader().requestRefreshConfiguration(
             InputReaderConfiguration::Change::TOUCH_AFFINE_TRANSFORMATION);
@@ -1269,6 +1413,10 @@ void NativeInputManager::setPointerIconType(PointerIconStyle iconId) {
 }
 
 void NativeInputManager::reloadPointerIcons() {
+    {
+        std::scoped_lock _l(mSystemPointerIconsLock);
+        mSystemPointerIcons.clear();
+    }
     std::scoped_lock _l(mLock);
     std::shared_ptr<PointerController> controller = mLocked.pointerController.lock();
     if (controller != nullptr) {
@@ -1393,6 +1541,23 @@ void NativeInputManager::interceptKeyBeforeQueueing(const KeyEvent& keyEvent,
     }
 
     const nsecs_t when = keyEvent.getEventTime();
+    const InterceptPolicyKey cacheKey{.isKey = true,
+                                      .deviceId = keyEvent.getDeviceId(),
+                                      .displayId = keyEvent.getDisplayId(),
+                                      .source = keyEvent.getSource(),
+                                      .keyCode = keyEvent.getKeyCode(),
+                                      .scanCode = keyEvent.getScanCode(),
+                                      .action = keyEvent.getAction(),
+                                      .flags = keyEvent.getFlags(),
+                                      .metaState = keyEvent.getMetaState(),
+                                      .repeat = keyEvent.getRepeatCount() != 0,
+                                      .policyFlags = policyFlags};
+    uint32_t cacheGeneration;
+    if (std::optional<jint> cachedActions = getCachedInterceptActions(cacheKey, &cacheGeneration)) {
+        handleInterceptActions(*cachedActions, when, /*byref*/ policyFlags);
+        return;
+    }
+
     JNIEnv* env = jniEnv();
     ScopedLocalRef<jobject> keyEventObj(env, android_view_KeyEvent_fromNative(env, keyEvent));
     if (!keyEventObj.get()) {
@@ -1406,6 +1571,7 @@ void NativeInputManager::interceptKeyBeforeQueueing(const KeyEvent& keyEvent,
         wmActions = 0;
     }
     android_view_KeyEvent_recycle(env, keyEventObj.get());
+    wmActions = cacheInterceptActions(cacheKey, cacheGeneration, wmActions);
     handleInterceptActions(wmActions, when, /*byref*/ policyFlags);
 }
 
@@ -1434,6 +1600,15 @@ void NativeInputManager::interceptMotionBeforeQueueing(int32_t displayId, nsecs_
         return;
     }
 
+    const InterceptPolicyKey cacheKey{.isKey = false,
+                                      .displayId = displayId,
+                                      .policyFlags = policyFlags};
+    uint32_t cacheGeneration;
+    if (std::optional<jint> cachedActions = getCachedInterceptActions(cacheKey, &cacheGeneration)) {
+        handleInterceptActions(*cachedActions, when, /*byref*/ policyFlags);
+        return;
+    }
+
     JNIEnv* env = jniEnv();
     const jint wmActions =
             env->CallIntMethod(mServiceObj,
@@ -1442,7 +1617,8 @@ void NativeInputManager::interceptMotionBeforeQueueing(int32_t displayId, nsecs_
     if (checkAndClearExceptionFromCallback(env, "interceptMotionBeforeQueueingNonInteractive")) {
         return;
     }
-    handleInterceptActions(wmActions, when, /*byref*/ policyFlags);
+    handleInterceptActions(cacheInterceptActions(cacheKey, cacheGeneration, wmActions), when,
+                           /*byref*/ policyFlags);
 }
 
 void NativeInputManager::handleInterceptActions(jint wmActions, nsecs_t when,
@@ -1583,19 +1759,46 @@ void NativeInputManager::loadPointerIcon(SpriteIcon* icon, int32_t displayId) {
     }
 }
 
+void NativeInputManager::loadSystemPointerIcon(JNIEnv* env, jobject contextObj,
+                                               int32_t densityDpi, PointerIconStyle style,
+                                               SystemPointerIcon* outIcon) {
+    if (densityDpi > 0) {
+        std::scoped_lock _l(mSystemPointerIconsLock);
+        auto it = mSystemPointerIcons.find({densityDpi, style});
+        if (it != mSystemPointerIcons.end()) {
+            *outIcon = it->second;
+            return;
+        }
+    }
+
+    PointerIcon pointerIcon;
+    loadSystemIconAsSpriteWithPointerIcon(env, contextObj, style, &pointerIcon, &outIcon->icon);
+    outIcon->bitmapFrames = std::move(pointerIcon.bitmapFrames);
+    outIcon->durationPerFrame = pointerIcon.durationPerFrame;
+    if (densityDpi > 0 && outIcon->icon.isValid()) {
+        std::scoped_lock _l(mSystemPointerIconsLock);
+        mSystemPointerIcons[{densityDpi, style}] = *outIcon;
+    }
+}
+
 void NativeInputManager::loadPointerResources(PointerResources* outResources, int32_t displayId) {
     ATRACE_CALL();
     JNIEnv* env = jniEnv();
 
     ScopedLocalRef<jobject> displayContext(env, env->CallObjectMethod(
             mServiceObj, gServiceClassInfo.getContextForDisplay, displayId));
+    const int32_t densityDpi = getDensityDpi(env, displayContext.get());
 
-    loadSystemIconAsSprite(env, displayContext.get(), PointerIconStyle::TYPE_SPOT_HOVER,
-                           &outResources->spotHover);
-    loadSystemIconAsSprite(env, displayContext.get(), PointerIconStyle::TYPE_SPOT_TOUCH,
-                           &outResources->spotTouch);
-    loadSystemIconAsSprite(env, displayContext.get(), PointerIconStyle::TYPE_SPOT_ANCHOR,
-                           &outResources->spotAnchor);
+    SystemPointerIcon icon;
+    loadSystemPointerIcon(env, displayContext.get(), densityDpi, PointerIconStyle::TYPE_SPOT_HOVER,
+                          &icon);
+    outResources->spotHover = icon.icon;
+    loadSystemPointerIcon(env, displayContext.get(), densityDpi, PointerIconStyle::TYPE_SPOT_TOUCH,
+                          &icon);
+    outResources->spotTouch = icon.icon;
+    loadSystemPointerIcon(env, displayContext.get(), densityDpi,
+                          PointerIconStyle::TYPE_SPOT_ANCHOR, &icon);
+    outResources->spotAnchor = icon.icon;
 }
 
 void NativeInputManager::loadAdditionalMouseResources(
@@ -1606,31 +1809,31 @@ void NativeInputManager::loadAdditionalMouseResources(
 
     ScopedLocalRef<jobject> displayContext(env, env->CallObjectMethod(
             mServiceObj, gServiceClassInfo.getContextForDisplay, displayId));
+    const int32_t densityDpi = getDensityDpi(env, displayContext.get());
 
     for (int32_t iconId = static_cast<int32_t>(PointerIconStyle::TYPE_CONTEXT_MENU);
          iconId <= static_cast<int32_t>(PointerIconStyle::TYPE_HANDWRITING); ++iconId) {
         const PointerIconStyle pointerIconStyle = static_cast<PointerIconStyle>(iconId);
-        PointerIcon pointerIcon;
-        loadSystemIconAsSpriteWithPointerIcon(env, displayContext.get(), pointerIconStyle,
-                                              &pointerIcon, &((*outResources)[pointerIconStyle]));
-        if (!pointerIcon.bitmapFrames.empty()) {
+        SystemPointerIcon icon;
+        loadSystemPointerIcon(env, displayContext.get(), densityDpi, pointerIconStyle, &icon);
+        (*outResources)[pointerIconStyle] = icon.icon;
+        if (!icon.bitmapFrames.empty()) {
             PointerAnimation& animationData = (*outAnimationResources)[pointerIconStyle];
-            size_t numFrames = pointerIcon.bitmapFrames.size() + 1;
-            animationData.durationPerFrame =
-                    milliseconds_to_nanoseconds(pointerIcon.durationPerFrame);
+            size_t numFrames = icon.bitmapFrames.size() + 1;
+            animationData.durationPerFrame = milliseconds_to_nanoseconds(icon.durationPerFrame);
             animationData.animationFrames.reserve(numFrames);
-            animationData.animationFrames.push_back(SpriteIcon(
-                    pointerIcon.bitmap, pointerIcon.style,
-                    pointerIcon.hotSpotX, pointerIcon.hotSpotY));
+            animationData.animationFrames.push_back(icon.icon);
             for (size_t i = 0; i < numFrames - 1; ++i) {
               animationData.animationFrames.push_back(SpriteIcon(
-                      pointerIcon.bitmapFrames[i], pointerIcon.style,
-                      pointerIcon.hotSpotX, pointerIcon.hotSpotY));
+                      icon.bitmapFrames[i], icon.icon.style,
+                      icon.icon.hotSpotX, icon.icon.hotSpotY));
             }
         }
     }
-    loadSystemIconAsSprite(env, displayContext.get(), PointerIconStyle::TYPE_NULL,
-                           &((*outResources)[PointerIconStyle::TYPE_NULL]));
+    SystemPointerIcon nullIcon;
+    loadSystemPointerIcon(env, displayContext.get(), densityDpi, PointerIconStyle::TYPE_NULL,
+                          &nullIcon);
+    (*outResources)[PointerIconStyle::TYPE_NULL] = nullIcon.icon;
 }
 
 PointerIconStyle NativeInputManager::getDefaultPointerIconId() {
@@ -2115,6 +2318,12 @@ static void nativeSetInteractive(JNIEnv* env, jobject nativeImplObj, jboolean in
     im->setInteractive(interactive);
 }
 
+static void nativeInvalidateInterceptPolicyCache(JNIEnv* env, jobject nativeImplObj) {
+    NativeInputManager* im = getNativeInputManager(env, nativeImplObj);
+
+    im->invalidateInterceptPolicyCache();
+}
+
 static void nativeReloadCalibration(JNIEnv* env, jobject nativeImplObj) {
     NativeInputManager* im = getNativeInputManager(env, nativeImplObj);
 
@@ -2670,6 +2879,7 @@ static const JNINativeMethod gInputManagerMethods[] = {
         {"setShowTouches", "(Z)V", (void*)nativeSetShowTouches},
         {"setVolumeKeysRotation", "(I)V", (void*)nativeSetVolumeKeysRotation},
         {"setInteractive", "(Z)V", (void*)nativeSetInteractive},
+        {"invalidateInterceptPolicyCache", "()V", (void*)nativeInvalidateInterceptPolicyCache},
         {"reloadCalibration", "()V", (void*)nativeReloadCalibration},
         {"vibrate", "(I[J[III)V", (void*)nativeVibrate},
         {"vibrateCombined", "(I[JLandroid/util/SparseArray;II)V", (void*)nativeVibrateCombined},
@@ -2907,6 +3117,16 @@ int register_android_server_InputManager(JNIEnv* env) {
     GET_METHOD_ID(gTouchCalibrationClassInfo.getAffineTransform, gTouchCalibrationClassInfo.clazz,
             "getAffineTransform", "()[F");
 
+    // Context, Resources and DisplayMetrics, for the density of pointer icons
+    FIND_CLASS(clazz, "android/content/Context");
+    GET_METHOD_ID(gContextClassInfo.getResources, clazz, "getResources",
+                  "()Landroid/content/res/Resources;");
+    FIND_CLASS(clazz, "android/content/res/Resources");
+    GET_METHOD_ID(gResourcesClassInfo.getDisplayMetrics, clazz, "getDisplayMetrics",
+                  "()Landroid/util/DisplayMetrics;");
+    FIND_CLASS(clazz, "android/util/DisplayMetrics");
+    GET_FIELD_ID(gDisplayMetricsClassInfo.densityDpi, clazz, "densityDpi", "I");
+
     // Light
     FIND_CLASS(gLightClassInfo.clazz, "android/hardware/lights/Light");
     gLightClassInfo.clazz = jclass(env->NewGlobalRef(gLightClassInfo.clazz));
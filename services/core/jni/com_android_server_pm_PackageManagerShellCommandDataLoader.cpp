@@ -59,9 +59,13 @@ using CompressionType = int8_t;
 using RequestType = int16_t;
 using MagicType = uint32_t;
 
-static constexpr int BUFFER_SIZE = 256 * 1024;
+static constexpr int BUFFER_SIZE = 1024 * 1024;
 static constexpr int BLOCKS_COUNT = BUFFER_SIZE / INCFS_DATA_FILE_BLOCK_SIZE;
 
+// Streamed chunks that are already available are written to IncFS together, up to this much.
+static constexpr int MAX_BATCHED_CHUNKS = 16;
+static constexpr int MAX_BATCHED_SIZE = 2 * 1024 * 1024;
+
 static constexpr int COMMAND_SIZE = 4 + 2 + 2 + 4; // bytes
 static constexpr int HEADER_SIZE = 2 + 1 + 1 + 4 + 2; // bytes
 static constexpr std::string_view OKAY = "OKAY"sv;
@@ -146,6 +150,43 @@ static bool readChunk(int fd, std::vector<uint8_t>& data) {
 
 BlockHeader readHeader(std::span<uint8_t>& data);
 
+// Whether there is data to read on the fd right away.
+static bool hasDataReady(borrowed_fd fd) {
+    struct pollfd pfd = {fd.get(), POLLIN, 0};
+    return TEMP_FAILURE_RETRY(poll(&pfd, 1, 0)) > 0 && (pfd.revents & POLLIN);
+}
+
+// How much was written to IncFS, and how long it took.
+struct WriteStats {
+    using Clock = std::chrono::steady_clock;
+
+    int64_t bytes = 0;
+    int64_t blocks = 0;
+    int64_t writes = 0;
+    Clock::time_point startTs = Clock::now();
+
+    void add(std::span<const IncFsDataBlock> written) {
+        for (auto&& block : written) {
+            bytes += block.dataSize;
+        }
+        blocks += written.size();
+        ++writes;
+        if (CC_UNLIKELY(atrace_is_tag_enabled(ATRACE_TAG))) {
+            ATRACE_INT64("incfs_written_bytes", bytes);
+        }
+    }
+
+    void log(const char* what) const {
+        const auto elapsedMs =
+                std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTs)
+                        .count();
+        ALOGI("%s: wrote %lld blocks (%lld bytes) in %lld writes, %lldms, %lld KB/s", what,
+              static_cast<long long>(blocks), static_cast<long long>(bytes),
+              static_cast<long long>(writes), static_cast<long long>(elapsedMs),
+              static_cast<long long>(elapsedMs > 0 ? bytes / elapsedMs : 0));
+    }
+};
+
 static inline int32_t readLEInt32(borrowed_fd fd) {
     int32_t result;
     ReadFully(fd, &result, sizeof(result));
@@ -419,6 +460,7 @@ private:
         std::vector<IncFsDataBlock> blocks;
         blocks.reserve(BLOCKS_COUNT);
 
+        mPrepareStats = {};
         unique_fd streamingFd;
         MetadataMode streamingMode;
         for (auto&& file : addedFiles) {
@@ -455,6 +497,7 @@ private:
             }
         }
 
+        mPrepareStats.log("onPrepareImage");
         if (streamingFd.ok()) {
             ALOGE("onPrepareImage: done, proceeding to streaming.");
             return initStreaming(std::move(streamingFd), streamingMode);
@@ -541,6 +584,9 @@ private:
         }
 
         auto res = mIfs->writeBlocks({blocks->data(), blocks->size()});
+        if (res >= 0) {
+            mPrepareStats.add(*blocks);
+        }
 
         blocks->clear();
         buffer->erase(buffer->begin(), buffer->begin() + consumed);
@@ -790,9 +836,15 @@ private:
     }
 
     void receiver(unique_fd inout, MetadataMode mode) {
-        std::vector<uint8_t> data;
+        // The instructions point into the chunks, so the chunks of a batch are kept until it is
+        // written, and then reused for the next ones.
+        std::vector<std::vector<uint8_t>> chunks;
+        chunks.reserve(MAX_BATCHED_CHUNKS);
+        size_t batchedChunks = 0;
+        size_t batchedSize = 0;
         std::vector<IncFsDataBlock> instructions;
         std::unordered_map<FileIdx, unique_fd> writeFds;
+        WriteStats stats;
         while (!mStopReceiving) {
             const auto res = waitForData(inout);
             if (res == WaitResult::Timeout) {
@@ -807,11 +859,16 @@ private:
                 sendRequest(inout, EXIT);
                 break;
             }
+            if (batchedChunks == chunks.size()) {
+                chunks.emplace_back();
+            }
+            auto& data = chunks[batchedChunks++];
             if (!readChunk(inout, data)) {
                 ALOGE("Failed to read a message. Abort.");
                 mStatusListener->reportStatus(DATA_LOADER_UNRECOVERABLE);
                 break;
             }
+            batchedSize += data.size();
             auto remainingData = std::span(data);
             while (!remainingData.empty()) {
                 auto header = readHeader(remainingData);
@@ -859,9 +916,17 @@ private:
                 instructions.push_back(inst);
                 remainingData = remainingData.subspan(header.blockSize);
             }
-            writeInstructions(instructions);
+            if (!mStopReceiving && batchedChunks < MAX_BATCHED_CHUNKS &&
+                batchedSize < MAX_BATCHED_SIZE && hasDataReady(inout)) {
+                // More is already there, write it all at once.
+                continue;
+            }
+            writeInstructions(instructions, &stats);
+            batchedChunks = 0;
+            batchedSize = 0;
         }
-        writeInstructions(instructions);
+        writeInstructions(instructions, &stats);
+        stats.log("receiver");
 
         {
             std::lock_guard lock{mOutFdLock};
@@ -869,12 +934,18 @@ private:
         }
     }
 
-    void writeInstructions(std::vector<IncFsDataBlock>& instructions) {
+    void writeInstructions(std::vector<IncFsDataBlock>& instructions, WriteStats* stats) {
+        if (instructions.empty()) {
+            return;
+        }
         auto res = this->mIfs->writeBlocks(instructions);
         if (res != instructions.size()) {
             ALOGE("Dailed to write data to Incfs (res=%d when expecting %d)", res,
                   int(instructions.size()));
         }
+        if (res > 0) {
+            stats->add(std::span(instructions).first(res));
+        }
         instructions.clear();
     }
 
@@ -934,6 +1005,7 @@ private:
     std::atomic<bool> mStopReceiving = false;
     std::atomic<bool> mReadLogsEnabled = false;
     std::chrono::milliseconds mWaitOnEofInterval{WaitOnEofMinInterval};
+    WriteStats mPrepareStats;
     int64_t mLastSerialNo{-1};
     /** Tracks which files have been requested */
     std::unordered_set<FileIdx> mRequestedFiles;
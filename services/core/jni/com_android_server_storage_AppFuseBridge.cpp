@@ -24,11 +24,18 @@
 #include <libappfuse/FuseBridgeLoop.h>
 #include <libappfuse/FuseBuffer.h>
 #include <nativehelper/JNIHelp.h>
+#include <sys/socket.h>
 
 namespace android {
 namespace {
 
 constexpr const char* CLASS_NAME = "com/android/server/storage/AppFuseBridge";
+
+// How many messages of the largest size the sockets between the loop and the proxy queue in
+// each direction. With room for only one, the loop can't forward the next read or write of a
+// streamed file until the proxy has answered the previous one; with more, the kernel keeps
+// several in flight.
+constexpr int kProxySocketQueuedMessages = 4;
 static jclass gAppFuseClass;
 static jmethodID gAppFuseOnMount;
 static jmethodID gAppFuseOnClosed;
@@ -56,6 +63,16 @@ public:
     }
 };
 
+// Grows the buffers that SetupMessageSockets() sized for a single message. Failing to is not
+// fatal, the bridge then just handles one request at a time.
+void DeepenProxySocket(int fd) {
+    const int size = kProxySocketQueuedMessages * sizeof(fuse::FuseBuffer);
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) != 0) {
+        PLOG(WARNING) << "Failed to grow the buffers of the AppFuse proxy socket";
+    }
+}
+
 class MonitorScope final {
 public:
     MonitorScope(JNIEnv* env, jobject obj) : mEnv(env), mObj(obj), mLocked(false) {
@@ -115,6 +132,8 @@ jint com_android_server_storage_AppFuseBridge_add_bridge(
     if (!fuse::SetupMessageSockets(&proxyFd)) {
         return -1;
     }
+    DeepenProxySocket(proxyFd[0].get());
+    DeepenProxySocket(proxyFd[1].get());
 
     if (!loop->AddBridge(mountId, std::move(devFd), std::move(proxyFd[0]))) {
         return -1;
@@ -280,54 +280,76 @@ static jlong vibratorPerformEffect(JNIEnv* env, jclass /* clazz */, jlong ptr, j
     return result.isOk() ? result.value().count() : (result.isUnsupported() ? 0 : -1);
 }
 
-static jlong vibratorPerformComposedEffect(JNIEnv* env, jclass /* clazz */, jlong ptr,
-                                           jobjectArray composition, jlong vibrationId) {
-    VibratorControllerWrapper* wrapper = reinterpret_cast<VibratorControllerWrapper*>(ptr);
-    if (wrapper == nullptr) {
-        ALOGE("vibratorPerformComposedEffect failed because native wrapper was not initialized");
-        return -1;
-    }
+static std::vector<aidl::CompositeEffect> compositionFromJava(JNIEnv* env,
+                                                              jobjectArray composition) {
     size_t size = env->GetArrayLength(composition);
     std::vector<aidl::CompositeEffect> effects;
+    effects.reserve(size);
     for (size_t i = 0; i < size; i++) {
         jobject element = env->GetObjectArrayElement(composition, i);
         effects.push_back(effectFromJavaPrimitive(env, element));
+        env->DeleteLocalRef(element);
     }
-    auto callback = wrapper->createCallback(vibrationId);
-    auto performComposedEffectFn = [&effects, &callback](vibrator::HalWrapper* hal) {
-        return hal->performComposedEffect(effects, callback);
-    };
-    auto result = wrapper->halCall<std::chrono::milliseconds>(performComposedEffectFn,
-                                                              "performComposedEffect");
-    return result.isOk() ? result.value().count() : (result.isUnsupported() ? 0 : -1);
+    return effects;
 }
 
-static jlong vibratorPerformPwleEffect(JNIEnv* env, jclass /* clazz */, jlong ptr,
-                                       jobjectArray waveform, jint brakingId, jlong vibrationId) {
-    VibratorControllerWrapper* wrapper = reinterpret_cast<VibratorControllerWrapper*>(ptr);
-    if (wrapper == nullptr) {
-        ALOGE("vibratorPerformPwleEffect failed because native wrapper was not initialized");
-        return -1;
-    }
-    aidl::Braking braking = static_cast<aidl::Braking>(brakingId);
+static std::vector<aidl::PrimitivePwle> pwlesFromJava(JNIEnv* env, jobjectArray waveform,
+                                                       aidl::Braking braking,
+                                                       std::chrono::milliseconds* totalDuration) {
     size_t size = env->GetArrayLength(waveform);
     std::vector<aidl::PrimitivePwle> primitives;
-    std::chrono::milliseconds totalDuration(0);
+    primitives.reserve(size + 1);
+    *totalDuration = std::chrono::milliseconds(0);
     for (size_t i = 0; i < size; i++) {
         jobject element = env->GetObjectArrayElement(waveform, i);
         aidl::ActivePwle activePwle = activePwleFromJavaPrimitive(env, element);
+        env->DeleteLocalRef(element);
         if ((i > 0) && shouldBeReplacedWithBraking(activePwle, braking)) {
             primitives.push_back(brakingPwle(braking, activePwle.duration));
         } else {
             primitives.push_back(activePwle);
         }
-        totalDuration += std::chrono::milliseconds(activePwle.duration);
+        *totalDuration += std::chrono::milliseconds(activePwle.duration);
 
         if ((i == (size - 1)) && shouldAddLastBraking(activePwle, braking)) {
             primitives.push_back(brakingPwle(braking, 0 /* duration */));
         }
     }
+    return primitives;
+}
+
+/*
+ * A composition or PWLE waveform already converted to HAL types, which Java keeps behind a handle
+ * and replays without converting its segments again. Only the fields of its kind are set.
+ */
+struct PreparedEffect {
+    enum class Kind { COMPOSITION, PWLE };
+
+    Kind kind;
+    std::vector<aidl::CompositeEffect> composition;
+    std::vector<aidl::PrimitivePwle> pwles;
+    std::chrono::milliseconds pwleDuration;
+};
+
+static void destroyPreparedEffect(void* ptr) {
+    delete reinterpret_cast<PreparedEffect*>(ptr);
+}
 
+static jlong performComposedEffect(VibratorControllerWrapper* wrapper,
+                                   const std::vector<aidl::CompositeEffect>& effects,
+                                   jlong vibrationId) {
+    auto callback = wrapper->createCallback(vibrationId);
+    auto performComposedEffectFn = [&effects, &callback](vibrator::HalWrapper* hal) {
+        return hal->performComposedEffect(effects, callback);
+    };
+    auto result = wrapper->halCall<std::chrono::milliseconds>(performComposedEffectFn,
+                                                              "performComposedEffect");
+    return result.isOk() ? result.value().count() : (result.isUnsupported() ? 0 : -1);
+}
+
+static jlong performPwleEffect(VibratorControllerWrapper* wrapper,
+                               const std::vector<aidl::PrimitivePwle>& primitives,
+                               std::chrono::milliseconds totalDuration, jlong vibrationId) {
     auto callback = wrapper->createCallback(vibrationId);
     auto performPwleEffectFn = [&primitives, &callback](vibrator::HalWrapper* hal) {
         return hal->performPwleEffect(primitives, callback);
@@ -336,6 +358,72 @@ static jlong vibratorPerformPwleEffect(JNIEnv* env, jclass /* clazz */, jlong pt
     return result.isOk() ? totalDuration.count() : (result.isUnsupported() ? 0 : -1);
 }
 
+static jlong vibratorPerformComposedEffect(JNIEnv* env, jclass /* clazz */, jlong ptr,
+                                           jobjectArray composition, jlong vibrationId) {
+    VibratorControllerWrapper* wrapper = reinterpret_cast<VibratorControllerWrapper*>(ptr);
+    if (wrapper == nullptr) {
+        ALOGE("vibratorPerformComposedEffect failed because native wrapper was not initialized");
+        return -1;
+    }
+    return performComposedEffect(wrapper, compositionFromJava(env, composition), vibrationId);
+}
+
+static jlong vibratorPerformPwleEffect(JNIEnv* env, jclass /* clazz */, jlong ptr,
+                                       jobjectArray waveform, jint brakingId, jlong vibrationId) {
+    VibratorControllerWrapper* wrapper = reinterpret_cast<VibratorControllerWrapper*>(ptr);
+    if (wrapper == nullptr) {
+        ALOGE("vibratorPerformPwleEffect failed because native wrapper was not initialized");
+        return -1;
+    }
+    std::chrono::milliseconds totalDuration;
+    std::vector<aidl::PrimitivePwle> primitives =
+            pwlesFromJava(env, waveform, static_cast<aidl::Braking>(brakingId), &totalDuration);
+    return performPwleEffect(wrapper, primitives, totalDuration, vibrationId);
+}
+
+static jlong vibratorPrepareComposedEffect(JNIEnv* env, jclass /* clazz */,
+                                           jobjectArray composition) {
+    auto prepared = std::make_unique<PreparedEffect>();
+    prepared->kind = PreparedEffect::Kind::COMPOSITION;
+    prepared->composition = compositionFromJava(env, composition);
+    return reinterpret_cast<jlong>(prepared.release());
+}
+
+static jlong vibratorPreparePwleEffect(JNIEnv* env, jclass /* clazz */, jobjectArray waveform,
+                                       jint brakingId) {
+    auto prepared = std::make_unique<PreparedEffect>();
+    prepared->kind = PreparedEffect::Kind::PWLE;
+    prepared->pwles = pwlesFromJava(env, waveform, static_cast<aidl::Braking>(brakingId),
+                                    &prepared->pwleDuration);
+    return reinterpret_cast<jlong>(prepared.release());
+}
+
+static jlong vibratorGetPreparedEffectFinalizer(JNIEnv* /* env */, jclass /* clazz */) {
+    return static_cast<jlong>(reinterpret_cast<uintptr_t>(&destroyPreparedEffect));
+}
+
+static jlong vibratorPerformPreparedEffect(JNIEnv* env, jclass /* clazz */, jlong ptr,
+                                           jlong effectPtr, jlong vibrationId) {
+    VibratorControllerWrapper* wrapper = reinterpret_cast<VibratorControllerWrapper*>(ptr);
+    if (wrapper == nullptr) {
+        ALOGE("vibratorPerformPreparedEffect failed because native wrapper was not initialized");
+        return -1;
+    }
+    PreparedEffect* prepared = reinterpret_cast<PreparedEffect*>(effectPtr);
+    if (prepared == nullptr) {
+        ALOGE("vibratorPerformPreparedEffect failed because the effect was not prepared");
+        return -1;
+    }
+    switch (prepared->kind) {
+        case PreparedEffect::Kind::COMPOSITION:
+            return performComposedEffect(wrapper, prepared->composition, vibrationId);
+        case PreparedEffect::Kind::PWLE:
+            return performPwleEffect(wrapper, prepared->pwles, prepared->pwleDuration,
+                                     vibrationId);
+    }
+    return -1;
+}
+
 static void vibratorAlwaysOnEnable(JNIEnv* env, jclass /* clazz */, jlong ptr, jlong id,
                                    jlong effect, jlong strength) {
     VibratorControllerWrapper* wrapper = reinterpret_cast<VibratorControllerWrapper*>(ptr);
@@ -466,6 +554,16 @@ static const JNINativeMethod method_table[] = {
         {"getInfo", "(JLandroid/os/VibratorInfo$Builder;)Z", (void*)vibratorGetInfo},
 };
 
+// Registered only if NativeWrapper declares them.
+static const JNINativeMethod prepared_method_table[] = {
+        {"prepareComposedEffect", "([Landroid/os/vibrator/PrimitiveSegment;)J",
+         (void*)vibratorPrepareComposedEffect},
+        {"preparePwleEffect", "([Landroid/os/vibrator/RampSegment;I)J",
+         (void*)vibratorPreparePwleEffect},
+        {"getPreparedEffectFinalizer", "()J", (void*)vibratorGetPreparedEffectFinalizer},
+        {"performPreparedEffect", "(JJJ)J", (void*)vibratorPerformPreparedEffect},
+};
+
 int register_android_server_vibrator_VibratorController(JavaVM* jvm, JNIEnv* env) {
     sJvm = jvm;
     auto listenerClassName =
@@ -522,9 +620,13 @@ int register_android_server_vibrator_VibratorController(JavaVM* jvm, JNIEnv* env
                              "(Landroid/os/VibratorInfo$FrequencyProfile;)"
                              "Landroid/os/VibratorInfo$Builder;");
 
-    return jniRegisterNativeMethods(env,
-                                    "com/android/server/vibrator/VibratorController$NativeWrapper",
-                                    method_table, NELEM(method_table));
+    int res = jniRegisterNativeMethods(env,
+                                       "com/android/server/vibrator/VibratorController"
+                                       "$NativeWrapper",
+                                       method_table, NELEM(method_table));
+    RegisterOptionalMethods(env, "com/android/server/vibrator/VibratorController$NativeWrapper",
+                            prepared_method_table, NELEM(prepared_method_table));
+    return res;
 }
 
 }; // namespace android
@@ -18,6 +18,8 @@
 
 #include "GnssMeasurementCallback.h"
 
+#include <string.h>
+
 namespace android::gnss {
 
 using binder::Status;
@@ -67,6 +69,7 @@ jmethodID method_gnssMeasurementsSetSatellitePvt;
 jmethodID method_gnssClockCtor;
 jmethodID method_gnssMeasurementCtor;
 jmethodID method_reportMeasurementData;
+jmethodID method_reportMeasurementDataPacked;
 jmethodID method_satellitePvtBuilderBuild;
 jmethodID method_satellitePvtBuilderCtor;
 jmethodID method_satellitePvtBuilderSetPositionEcef;
@@ -83,11 +86,185 @@ jmethodID method_positionEcef;
 jmethodID method_velocityEcef;
 jmethodID method_clockInfo;
 
+// The packed form of a GnssData, reported through reportMeasurementDataPacked() in a single
+// upcall instead of a few hundred JNI calls per report. Values are in native byte order, strings
+// are an int32 length followed by their bytes, and lists an int32 count followed by their
+// elements:
+//
+//   int32 version, int32 interfaceVersion, int32 isFullTracking
+//   elapsedRealtime: int32 flags, int64 timestampNs, double timeUncertaintyNs
+//   clock: int32 gnssClockFlags, int32 leapSecond, int64 timeNs, double timeUncertaintyNs,
+//          int64 fullBiasNs, double biasNs, double biasUncertaintyNs, double driftNsps,
+//          double driftUncertaintyNsps, int32 hwClockDiscontinuityCount,
+//          signal type referenceSignalTypeForIsb
+//   list of measurements:
+//          int32 flags, int32 svid, signal type signalType, double timeOffsetNs, int32 state,
+//          int64 receivedSvTimeInNs, int64 receivedSvTimeUncertaintyInNs,
+//          double antennaCN0DbHz, double basebandCN0DbHz, double pseudorangeRateMps,
+//          double pseudorangeRateUncertaintyMps, int32 accumulatedDeltaRangeState,
+//          double accumulatedDeltaRangeM, double accumulatedDeltaRangeUncertaintyM,
+//          int32 multipathIndicator, double snrDb, double agcLevelDb,
+//          double fullInterSignalBiasNs, double fullInterSignalBiasUncertaintyNs,
+//          double satelliteInterSignalBiasNs, double satelliteInterSignalBiasUncertaintyNs,
+//          satellite PVT and list of correlation vectors when flags has them
+//   list of AGCs: double agcLevelDb, int32 constellation, int64 carrierFrequencyHz
+//
+// where a signal type is int32 constellation, double carrierFrequencyHz, string codeType; a
+// satellite PVT is int32 flags, double[4] position, double[4] velocity, double[3] clock info,
+// double ionoDelayMeters, double tropoDelayMeters, int64 timeOfClockSeconds,
+// int32 issueOfDataClock, int64 timeOfEphemerisSeconds, int32 issueOfDataEphemeris,
+// int32 ephemerisSource; and a correlation vector is double frequencyOffsetMps,
+// double samplingStartM, double samplingWidthM, int32[] magnitude. As with the objects, only
+// the fields that their flags and interfaceVersion mark as valid are meaningful, and
+// accumulatedDeltaRangeState already has ADR_STATE_HALF_CYCLE_REPORTED set.
+constexpr int32_t kPackedGnssDataVersion = 1;
+
+// Rough size of a measurement without its correlation vectors, to size the buffer up front.
+constexpr size_t kPackedMeasurementSize = 400;
+
+class PackedWriter {
+public:
+    explicit PackedWriter(size_t capacity) { mBuffer.reserve(capacity); }
+
+    template <class T>
+    void put(T value) {
+        const size_t offset = mBuffer.size();
+        mBuffer.resize(offset + sizeof(T));
+        memcpy(mBuffer.data() + offset, &value, sizeof(T));
+    }
+
+    void putInt(int32_t value) { put<int32_t>(value); }
+    void putLong(int64_t value) { put<int64_t>(value); }
+    void putDouble(double value) { put<double>(value); }
+
+    void putString(const std::string& value) {
+        putInt(value.size());
+        mBuffer.insert(mBuffer.end(), value.begin(), value.end());
+    }
+
+    void putSignalType(const hardware::gnss::GnssSignalType& signalType) {
+        putInt(static_cast<int32_t>(signalType.constellation));
+        putDouble(signalType.carrierFrequencyHz);
+        putString(signalType.codeType);
+    }
+
+    const std::vector<jbyte>& buffer() const { return mBuffer; }
+
+private:
+    std::vector<jbyte> mBuffer;
+};
+
+void packSatellitePvt(const SatellitePvt& satellitePvt, PackedWriter& writer) {
+    writer.putInt(satellitePvt.flags);
+    writer.putDouble(satellitePvt.satPosEcef.posXMeters);
+    writer.putDouble(satellitePvt.satPosEcef.posYMeters);
+    writer.putDouble(satellitePvt.satPosEcef.posZMeters);
+    writer.putDouble(satellitePvt.satPosEcef.ureMeters);
+    writer.putDouble(satellitePvt.satVelEcef.velXMps);
+    writer.putDouble(satellitePvt.satVelEcef.velYMps);
+    writer.putDouble(satellitePvt.satVelEcef.velZMps);
+    writer.putDouble(satellitePvt.satVelEcef.ureRateMps);
+    writer.putDouble(satellitePvt.satClockInfo.satHardwareCodeBiasMeters);
+    writer.putDouble(satellitePvt.satClockInfo.satTimeCorrectionMeters);
+    writer.putDouble(satellitePvt.satClockInfo.satClkDriftMps);
+    writer.putDouble(satellitePvt.ionoDelayMeters);
+    writer.putDouble(satellitePvt.tropoDelayMeters);
+    writer.putLong(satellitePvt.timeOfClockSeconds);
+    writer.putInt(satellitePvt.issueOfDataClock);
+    writer.putLong(satellitePvt.timeOfEphemerisSeconds);
+    writer.putInt(satellitePvt.issueOfDataEphemeris);
+    writer.putInt(static_cast<int32_t>(satellitePvt.ephemerisSource));
+}
+
+void packMeasurement(const GnssMeasurement& measurement, PackedWriter& writer) {
+    writer.putInt(measurement.flags);
+    writer.putInt(measurement.svid);
+    writer.putSignalType(measurement.signalType);
+    writer.putDouble(measurement.timeOffsetNs);
+    writer.putInt(measurement.state);
+    writer.putLong(measurement.receivedSvTimeInNs);
+    writer.putLong(measurement.receivedSvTimeUncertaintyInNs);
+    writer.putDouble(measurement.antennaCN0DbHz);
+    writer.putDouble(measurement.basebandCN0DbHz);
+    writer.putDouble(measurement.pseudorangeRateMps);
+    writer.putDouble(measurement.pseudorangeRateUncertaintyMps);
+    // Half cycle state is reported in the AIDL version of GnssMeasurement
+    writer.putInt(measurement.accumulatedDeltaRangeState | ADR_STATE_HALF_CYCLE_REPORTED);
+    writer.putDouble(measurement.accumulatedDeltaRangeM);
+    writer.putDouble(measurement.accumulatedDeltaRangeUncertaintyM);
+    writer.putInt(static_cast<int32_t>(measurement.multipathIndicator));
+    writer.putDouble(measurement.snrDb);
+    writer.putDouble(measurement.agcLevelDb);
+    writer.putDouble(measurement.fullInterSignalBiasNs);
+    writer.putDouble(measurement.fullInterSignalBiasUncertaintyNs);
+    writer.putDouble(measurement.satelliteInterSignalBiasNs);
+    writer.putDouble(measurement.satelliteInterSignalBiasUncertaintyNs);
+
+    if (measurement.flags & static_cast<uint32_t>(GnssMeasurement::HAS_SATELLITE_PVT)) {
+        packSatellitePvt(measurement.satellitePvt, writer);
+    }
+
+    if (measurement.flags & static_cast<uint32_t>(GnssMeasurement::HAS_CORRELATION_VECTOR)) {
+        writer.putInt(measurement.correlationVectors.size());
+        for (const CorrelationVector& correlationVector : measurement.correlationVectors) {
+            writer.putDouble(correlationVector.frequencyOffsetMps);
+            writer.putDouble(correlationVector.samplingStartM);
+            writer.putDouble(correlationVector.samplingWidthM);
+            writer.putInt(correlationVector.magnitude.size());
+            for (int32_t magnitude : correlationVector.magnitude) {
+                writer.putInt(magnitude);
+            }
+        }
+    }
+}
+
+void packGnssData(const GnssData& data, int32_t interfaceVersion, PackedWriter& writer) {
+    writer.putInt(kPackedGnssDataVersion);
+    writer.putInt(interfaceVersion);
+    writer.putInt(interfaceVersion >= 3 && data.isFullTracking);
+
+    writer.putInt(data.elapsedRealtime.flags);
+    writer.putLong(data.elapsedRealtime.timestampNs);
+    writer.putDouble(data.elapsedRealtime.timeUncertaintyNs);
+
+    const GnssClock& clock = data.clock;
+    writer.putInt(clock.gnssClockFlags);
+    writer.putInt(clock.leapSecond);
+    writer.putLong(clock.timeNs);
+    writer.putDouble(clock.timeUncertaintyNs);
+    writer.putLong(clock.fullBiasNs);
+    writer.putDouble(clock.biasNs);
+    writer.putDouble(clock.biasUncertaintyNs);
+    writer.putDouble(clock.driftNsps);
+    writer.putDouble(clock.driftUncertaintyNsps);
+    writer.putInt(clock.hwClockDiscontinuityCount);
+    writer.putSignalType(clock.referenceSignalTypeForIsb);
+
+    writer.putInt(data.measurements.size());
+    for (const GnssMeasurement& measurement : data.measurements) {
+        packMeasurement(measurement, writer);
+    }
+
+    writer.putInt(data.gnssAgcs.size());
+    for (const GnssAgc& gnssAgc : data.gnssAgcs) {
+        writer.putDouble(gnssAgc.agcLevelDb);
+        writer.putInt(static_cast<int32_t>(gnssAgc.constellation));
+        writer.putLong(gnssAgc.carrierFrequencyHz);
+    }
+}
+
 } // anonymous namespace
 
 void GnssMeasurement_class_init_once(JNIEnv* env, jclass& clazz) {
     method_reportMeasurementData = env->GetMethodID(clazz, "reportMeasurementData",
                                                     "(Landroid/location/GnssMeasurementsEvent;)V");
+    // Optional: without it every report is translated into Java objects field by field.
+    method_reportMeasurementDataPacked =
+            env->GetMethodID(clazz, "reportMeasurementDataPacked", "([B)V");
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        method_reportMeasurementDataPacked = nullptr;
+    }
 
     // Initialize GnssMeasurement related classes and methods
     jclass gnssMeasurementsEventClass = env->FindClass("android/location/GnssMeasurementsEvent");
@@ -385,6 +562,11 @@ Status GnssMeasurementCallbackAidl::gnssMeasurementCb(const GnssData& data) {
 void GnssMeasurementCallbackAidl::translateAndSetGnssData(const GnssData& data) {
     JNIEnv* env = getJniEnv();
 
+    if (method_reportMeasurementDataPacked != nullptr) {
+        reportPackedGnssData(env, data);
+        return;
+    }
+
     JavaObject gnssClockJavaObject(env, class_gnssClock, method_gnssClockCtor);
     translateGnssClock(env, data, gnssClockJavaObject);
     jobject clock = gnssClockJavaObject.get();
@@ -406,6 +588,22 @@ void GnssMeasurementCallbackAidl::translateAndSetGnssData(const GnssData& data)
     env->DeleteLocalRef(gnssAgcArray);
 }
 
+void GnssMeasurementCallbackAidl::reportPackedGnssData(JNIEnv* env, const GnssData& data) {
+    PackedWriter writer(kPackedMeasurementSize * (data.measurements.size() + 1));
+    packGnssData(data, this->getInterfaceVersion(), writer);
+
+    const std::vector<jbyte>& buffer = writer.buffer();
+    jbyteArray packed = env->NewByteArray(buffer.size());
+    if (packed == nullptr) {
+        checkAndClearExceptionFromCallback(env, __FUNCTION__);
+        return;
+    }
+    env->SetByteArrayRegion(packed, 0, buffer.size(), buffer.data());
+    env->CallVoidMethod(mCallbacksObj, method_reportMeasurementDataPacked, packed);
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    env->DeleteLocalRef(packed);
+}
+
 void GnssMeasurementCallbackAidl::translateSingleGnssMeasurement(JNIEnv* env,
                                                                  const GnssMeasurement& measurement,
                                                                  JavaObject& object) {
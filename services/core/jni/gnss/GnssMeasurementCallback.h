@@ -43,6 +43,7 @@ extern jmethodID method_gnssMeasurementsEventCtor;
 extern jmethodID method_gnssClockCtor;
 extern jmethodID method_gnssMeasurementCtor;
 extern jmethodID method_reportMeasurementData;
+extern jmethodID method_reportMeasurementDataPacked;
 } // anonymous namespace
 
 void GnssMeasurement_class_init_once(JNIEnv* env, jclass& clazz);
@@ -68,6 +69,9 @@ private:
 
     void translateAndSetGnssData(const hardware::gnss::GnssData& data);
 
+    // Reports |data| as one byte array, see packGnssData().
+    void reportPackedGnssData(JNIEnv* env, const hardware::gnss::GnssData& data);
+
     void translateGnssClock(JNIEnv* env, const hardware::gnss::GnssData& data, JavaObject& object);
 
     jobject& mCallbacksObj;
@@ -18,11 +18,13 @@
 
 #include "SurfaceFlingerPuller.h"
 
+#include <google/protobuf/arena.h>
 #include <gui/SurfaceComposerClient.h>
 #include <log/log.h>
 #include <statslog.h>
 #include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
 
+#include <array>
 #include <vector>
 
 namespace android {
@@ -33,12 +35,33 @@ using android::util::BytesField;
 using std::optional;
 
 namespace {
-optional<BytesField> getBytes(const google::protobuf::MessageLite& proto, std::string& data) {
-    if (!proto.SerializeToString(&data)) {
-        ALOGW("Unable to serialize surface flinger bytes field");
-        return std::nullopt;
+// Serializes the protos back to back into data and points a BytesField at each of them. data is
+// only ever grown, so that all the atoms of a pull reuse it; the BytesFields are valid until the
+// next call. Returns false if any serialization failed.
+template <size_t N>
+bool getBytes(const std::array<const google::protobuf::MessageLite*, N>& protos,
+              std::string& data, std::array<optional<BytesField>, N>& outFields) {
+    std::array<size_t, N> sizes;
+    size_t totalSize = 0;
+    for (size_t i = 0; i < N; i++) {
+        sizes[i] = protos[i]->ByteSizeLong();
+        totalSize += sizes[i];
     }
-    return {BytesField(data.data(), data.size())};
+    if (data.size() < totalSize) {
+        data.resize(totalSize);
+    }
+
+    uint8_t* out = reinterpret_cast<uint8_t*>(data.data());
+    for (size_t i = 0; i < N; i++) {
+        uint8_t* end = protos[i]->SerializeWithCachedSizesToArray(out);
+        if (static_cast<size_t>(end - out) != sizes[i]) {
+            ALOGW("Unable to serialize surface flinger bytes field");
+            return false;
+        }
+        outFields[i].emplace(reinterpret_cast<const char*>(out), sizes[i]);
+        out = end;
+    }
+    return true;
 }
 } // namespace
 
@@ -70,27 +93,26 @@ AStatsManager_PullAtomCallbackReturn SurfaceFlingerPuller::pull(int32_t atomTag,
 
 AStatsManager_PullAtomCallbackReturn SurfaceFlingerPuller::parseGlobalInfoPull(
         const std::string& protoData, AStatsEventList* data) {
-    android::surfaceflinger::SurfaceflingerStatsGlobalInfoWrapper atomList;
-    if (!atomList.ParseFromString(protoData)) {
+    // The messages are freed all at once with the arena, instead of one by one.
+    google::protobuf::Arena arena;
+    auto* atomList = google::protobuf::Arena::CreateMessage<
+            android::surfaceflinger::SurfaceflingerStatsGlobalInfoWrapper>(&arena);
+    if (!atomList->ParseFromString(protoData)) {
         ALOGW("Error parsing surface flinger global stats to proto");
         return AStatsManager_PULL_SKIP;
     }
 
-    for (const auto& atom : atomList.atom()) {
-        // The strings must outlive the BytesFields, which only have a pointer to the data.
-        std::string frameDurationStr, renderEngineTimeStr, deadlineMissesStr, predictionErrorsStr;
-        optional<BytesField> frameDuration = getBytes(atom.frame_duration(), frameDurationStr);
-        optional<BytesField> renderEngineTime =
-                getBytes(atom.render_engine_timing(), renderEngineTimeStr);
-        optional<BytesField> deadlineMisses =
-                getBytes(atom.sf_deadline_misses(), deadlineMissesStr);
-        optional<BytesField> predictionErrors =
-                getBytes(atom.sf_prediction_errors(), predictionErrorsStr);
-
+    // Must outlive the BytesFields, which only have a pointer to the data.
+    std::string bytes;
+    for (const auto& atom : atomList->atom()) {
+        std::array<optional<BytesField>, 4> fields;
         // Fail if any serialization to bytes failed.
-        if (!frameDuration || !renderEngineTime || !deadlineMisses || !predictionErrors) {
+        if (!getBytes<4>({&atom.frame_duration(), &atom.render_engine_timing(),
+                          &atom.sf_deadline_misses(), &atom.sf_prediction_errors()},
+                         bytes, fields)) {
             return AStatsManager_PULL_SKIP;
         }
+        const auto& [frameDuration, renderEngineTime, deadlineMisses, predictionErrors] = fields;
 
         android::util::addAStatsEvent(data, android::util::SURFACEFLINGER_STATS_GLOBAL_INFO,
                                       atom.total_frames(), atom.missed_frames(),
@@ -113,38 +135,32 @@ AStatsManager_PullAtomCallbackReturn SurfaceFlingerPuller::parseGlobalInfoPull(
 
 AStatsManager_PullAtomCallbackReturn SurfaceFlingerPuller::parseLayerInfoPull(
         const std::string& protoData, AStatsEventList* data) {
-    android::surfaceflinger::SurfaceflingerStatsLayerInfoWrapper atomList;
-    if (!atomList.ParseFromString(protoData)) {
+    // The messages, including the name of every layer, are freed all at once with the arena,
+    // instead of one by one.
+    google::protobuf::Arena arena;
+    auto* atomList = google::protobuf::Arena::CreateMessage<
+            android::surfaceflinger::SurfaceflingerStatsLayerInfoWrapper>(&arena);
+    if (!atomList->ParseFromString(protoData)) {
         ALOGW("Error parsing surface flinger layer stats to proto");
         return AStatsManager_PULL_SKIP;
     }
 
-    for (const auto& atom : atomList.atom()) {
-        // The strings must outlive the BytesFields, which only have a pointer to the data.
-        std::string present2PresentStr, post2presentStr, acquire2PresentStr, latch2PresentStr,
-                desired2PresentStr, post2AcquireStr, frameRateVoteStr, appDeadlineMissesStr,
-                present2PresentDeltaStr;
-        optional<BytesField> present2Present =
-                getBytes(atom.present_to_present(), present2PresentStr);
-        optional<BytesField> present2PresentDelta =
-                getBytes(atom.present_to_present_delta(), present2PresentDeltaStr);
-        optional<BytesField> post2present = getBytes(atom.post_to_present(), post2presentStr);
-        optional<BytesField> acquire2Present =
-                getBytes(atom.acquire_to_present(), acquire2PresentStr);
-        optional<BytesField> latch2Present = getBytes(atom.latch_to_present(), latch2PresentStr);
-        optional<BytesField> desired2Present =
-                getBytes(atom.desired_to_present(), desired2PresentStr);
-        optional<BytesField> post2Acquire = getBytes(atom.post_to_acquire(), post2AcquireStr);
-        optional<BytesField> frameRateVote = getBytes(atom.set_frame_rate_vote(), frameRateVoteStr);
-        optional<BytesField> appDeadlineMisses =
-                getBytes(atom.app_deadline_misses(), appDeadlineMissesStr);
-
+    // Must outlive the BytesFields, which only have a pointer to the data.
+    std::string bytes;
+    for (const auto& atom : atomList->atom()) {
+        std::array<optional<BytesField>, 9> fields;
         // Fail if any serialization to bytes failed.
-        if (!present2Present || !post2present || !acquire2Present || !latch2Present ||
-            !desired2Present || !post2Acquire || !frameRateVote || !appDeadlineMisses ||
-            !present2PresentDelta) {
+        if (!getBytes<9>({&atom.present_to_present(), &atom.present_to_present_delta(),
+                          &atom.post_to_present(), &atom.acquire_to_present(),
+                          &atom.latch_to_present(), &atom.desired_to_present(),
+                          &atom.post_to_acquire(), &atom.set_frame_rate_vote(),
+                          &atom.app_deadline_misses()},
+                         bytes, fields)) {
             return AStatsManager_PULL_SKIP;
         }
+        const auto& [present2Present, present2PresentDelta, post2present, acquire2Present,
+                     latch2Present, desired2Present, post2Acquire, frameRateVote,
+                     appDeadlineMisses] = fields;
 
         android::util::addAStatsEvent(data, android::util::SURFACEFLINGER_STATS_LAYER_INFO,
                                       atom.layer_name().c_str(), atom.total_frames(),
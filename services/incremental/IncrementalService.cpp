@@ -18,6 +18,7 @@
 
 #include "IncrementalService.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/no_destructor.h>
 #include <android-base/properties.h>
@@ -25,8 +26,10 @@
 #include <binder/AppOpsManager.h>
 #include <binder/Status.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <uuid/uuid.h>
 
+#include <algorithm>
 #include <charconv>
 #include <ctime>
 #include <iterator>
@@ -61,17 +64,30 @@ struct Constants {
     static constexpr auto mountpointMdPrefix = ".mountpoint."sv;
     static constexpr auto infoMdName = ".info"sv;
     static constexpr auto readLogsDisabledMarkerName = ".readlogs_disabled"sv;
+    static constexpr auto prefetchPlanName = ".prefetch_plan"sv;
     static constexpr auto libDir = "lib"sv;
     static constexpr auto libSuffix = ".so"sv;
     static constexpr auto blockSize = 4096;
+    // Native libraries are extracted on up to this many threads at once.
+    static constexpr unsigned maxJobThreads = 4;
     static constexpr auto systemPackage = "android"sv;
 
     static constexpr auto userStatusDelay = 100ms;
 
+    // How often to take the page reads of a storage recording a prefetch plan, and how much to
+    // read at once when prefetching.
+    static constexpr auto prefetchRecordInterval = 100ms;
+    static constexpr auto prefetchReadSize = 256 * 1024;
+    // How long destruction waits for a prefetch that is blocked on the DataLoader.
+    static constexpr auto prefetchStopTimeout = 1s;
+
     static constexpr auto progressUpdateInterval = 1000ms;
     static constexpr auto perUidTimeoutOffset = progressUpdateInterval * 2;
     static constexpr auto minPerUidTimeout = progressUpdateInterval * 3;
 
+    // Health checks are delayed by up to this much, so that they run together.
+    static constexpr auto healthCheckGrain = 500ms;
+
     // If DL was up and not crashing for 10mins, we consider it healthy and reset all delays.
     static constexpr auto healthyDataLoaderUptime = 10min;
 
@@ -369,9 +385,17 @@ IncrementalService::IncrementalService(ServiceManagerWrapper&& sm, std::string_v
     CHECK(mClock) << "Clock is unavailable";
 
     mJobQueue.reserve(16);
-    mJobProcessor = std::thread([this]() {
+    const auto jobThreads =
+            std::clamp<unsigned>(std::thread::hardware_concurrency(), 1, constants().maxJobThreads);
+    for (unsigned i = 0; i < jobThreads; ++i) {
+        mJobProcessors.emplace_back([this]() {
+            mJni->initializeForCurrentThread();
+            runJobProcessing();
+        });
+    }
+    mPrefetchProcessor = std::thread([this, queue = mPrefetchQueue]() {
         mJni->initializeForCurrentThread();
-        runJobProcessing();
+        runPrefetchProcessing(queue);
     });
     mCmdLooperThread = std::thread([this]() {
         mJni->initializeForCurrentThread();
@@ -388,7 +412,27 @@ IncrementalService::~IncrementalService() {
         mRunning = false;
     }
     mJobCondition.notify_all();
-    mJobProcessor.join();
+    {
+        std::lock_guard lock(mPrefetchQueue->lock);
+        mPrefetchQueue->running = false;
+    }
+    mPrefetchQueue->condition.notify_all();
+    for (auto& jobProcessor : mJobProcessors) {
+        jobProcessor.join();
+    }
+    {
+        std::unique_lock lock(mPrefetchQueue->lock);
+        if (!mPrefetchQueue->condition.wait_for(lock, constants().prefetchStopTimeout,
+                                                [this]() { return mPrefetchQueue->exited; })) {
+            // The read can only end once the DataLoader serves it or the read times out. The
+            // thread checks that the queue stopped before it uses the service again.
+            LOG(WARNING) << "Prefetch is blocked on a read, not waiting for it";
+            mPrefetchProcessor.detach();
+        }
+    }
+    if (mPrefetchProcessor.joinable()) {
+        mPrefetchProcessor.join();
+    }
     mLooper->wake();
     mCmdLooperThread.join();
     mTimedQueue->stop();
@@ -871,10 +915,30 @@ void IncrementalService::onInstallationComplete(StorageId storage) {
         return;
     }
 
-    // Always enable long read timeouts after installation is complete.
-    std::unique_lock l(ifs->lock);
-    ifs->setReadTimeoutsRequested(getEnableReadTimeoutsAfterInstall());
-    applyStorageParamsLocked(*ifs);
+    std::string planPath;
+    {
+        // Always enable long read timeouts after installation is complete.
+        std::unique_lock l(ifs->lock);
+        ifs->setReadTimeoutsRequested(getEnableReadTimeoutsAfterInstall());
+        applyStorageParamsLocked(*ifs);
+
+        const auto storageIt = ifs->storages.find(storage);
+        if (storageIt == ifs->storages.end()) {
+            return;
+        }
+        planPath = path::join(ifs->root, constants().mount, storageIt->second.name,
+                              constants().prefetchPlanName);
+    }
+
+    // Fetch the blocks of the prefetch plan the installer shipped, if any, in its order.
+    {
+        std::lock_guard lock(mPrefetchQueue->lock);
+        if (!mPrefetchQueue->running) {
+            return;
+        }
+        mPrefetchQueue->plans.emplace_back(ifs, std::move(planPath));
+    }
+    mPrefetchQueue->condition.notify_all();
 }
 
 IncrementalService::BindPathMap::const_iterator IncrementalService::findStorageLocked(
@@ -990,6 +1054,92 @@ int IncrementalService::setStorageParams(StorageId storageId, bool enableReadLog
     return 0;
 }
 
+bool IncrementalService::startPrefetchRecording(StorageId storageId) {
+    const auto ifs = getIfs(storageId);
+    if (!ifs) {
+        LOG(ERROR) << "startPrefetchRecording failed, invalid storageId: " << storageId;
+        return false;
+    }
+
+    {
+        std::unique_lock l(ifs->lock);
+        if (!ifs->readLogsEnabled()) {
+            LOG(ERROR) << "startPrefetchRecording failed, readlogs disabled for storageId: "
+                       << storageId;
+            return false;
+        }
+        if (ifs->prefetchRecording) {
+            return true;
+        }
+        // The DataLoader reads the logs of the mount control, so the recording opens its own.
+        ifs->prefetchControl = mIncFs->openMount(path::join(ifs->root, constants().mount));
+        if (ifs->prefetchControl.logs() < 0) {
+            LOG(ERROR) << "startPrefetchRecording failed, can't open the read logs for storageId: "
+                       << storageId;
+            ifs->prefetchControl = {};
+            return false;
+        }
+        ifs->prefetchRecording = std::make_unique<PrefetchPlan>();
+    }
+
+    return addTimedJob(*mTimedQueue, ifs->mountId, constants().prefetchRecordInterval,
+                       [this, ifs = std::weak_ptr<IncFsMount>(ifs)]() {
+                           recordPageReads(ifs.lock());
+                       });
+}
+
+std::string IncrementalService::stopPrefetchRecording(StorageId storageId) {
+    const auto ifs = getIfs(storageId);
+    if (!ifs) {
+        LOG(ERROR) << "stopPrefetchRecording failed, invalid storageId: " << storageId;
+        return {};
+    }
+
+    std::unique_lock l(ifs->lock);
+    if (!ifs->prefetchRecording) {
+        return {};
+    }
+    // Take the reads since the last time the recording job ran, which then stops on its own.
+    std::vector<incfs::ReadInfoWithUid> reads;
+    if (ifs->readLogsEnabled() &&
+        mIncFs->waitForPageReads(ifs->prefetchControl, 0ms, &reads) ==
+                incfs::WaitResult::HaveData) {
+        ifs->prefetchRecording->add(reads);
+    }
+    const auto plan = std::move(ifs->prefetchRecording);
+    ifs->prefetchControl = {};
+    LOG(INFO) << "Recorded a prefetch plan of " << plan->ranges().size()
+              << " ranges for storageId: " << storageId;
+    return plan->serialize();
+}
+
+void IncrementalService::recordPageReads(const IfsMountPtr& ifs) {
+    if (!ifs) {
+        return;
+    }
+
+    std::unique_lock l(ifs->lock);
+    if (!ifs->prefetchRecording) {
+        return;
+    }
+    if (!ifs->readLogsEnabled()) {
+        LOG(WARNING) << "Stopped recording the prefetch plan, readlogs disabled for mountId: "
+                     << ifs->mountId;
+        ifs->prefetchRecording.reset();
+        ifs->prefetchControl = {};
+        return;
+    }
+    std::vector<incfs::ReadInfoWithUid> reads;
+    if (mIncFs->waitForPageReads(ifs->prefetchControl, 0ms, &reads) ==
+        incfs::WaitResult::HaveData) {
+        ifs->prefetchRecording->add(reads);
+    }
+    l.unlock();
+
+    addTimedJob(*mTimedQueue, ifs->mountId, constants().prefetchRecordInterval,
+                [this, ifs = std::weak_ptr<IncFsMount>(ifs)]() { recordPageReads(ifs.lock()); });
+}
+
 int IncrementalService::disableReadLogsLocked(IncFsMount& ifs) {
     ifs.setReadLogsRequested(false);
     return applyStorageParamsLocked(ifs);
@@ -1909,7 +2059,8 @@ bool IncrementalService::configureNativeBinaries(StorageId storage, std::string_
         return false;
     }
 
-    // Need a shared pointer: will be passing it into all unpacking jobs.
+    // Need a shared pointer: will be passing it into all unpacking jobs. These run in parallel,
+    // which is fine as extracting an entry only reads the archive at its own offsets.
     std::shared_ptr<ZipArchive> zipFile(zipFileHandle, [](ZipArchiveHandle h) { CloseArchive(h); });
     void* cookie = nullptr;
     const auto libFilePrefix = path::join(constants().libDir, abi) += "/";
@@ -1933,7 +2084,7 @@ bool IncrementalService::configureNativeBinaries(StorageId storage, std::string_
         }
     }
 
-    std::vector<Job> jobQueue;
+    std::deque<Job> jobQueue;
     ZipEntry entry;
     std::string_view fileName;
     while (!Next(cookie, &entry, &fileName)) {
@@ -2128,7 +2279,8 @@ bool IncrementalService::waitForNativeBinariesExtraction(StorageId storage) {
     std::unique_lock lock(mJobMutex);
     mJobCondition.wait(lock, [this, mount] {
         return !mRunning ||
-                (mPendingJobsMount != mount && mJobQueue.find(mount) == mJobQueue.end());
+                (mRunningJobs.find(mount) == mRunningJobs.end() &&
+                 mJobQueue.find(mount) == mJobQueue.end());
     });
     return mRunning;
 }
@@ -2293,23 +2445,130 @@ void IncrementalService::runJobProcessing() {
             return;
         }
 
+        // Take one library at a time, so that all the threads work on the same mount until its
+        // extraction is done.
         auto it = mJobQueue.begin();
-        mPendingJobsMount = it->first;
-        auto queue = std::move(it->second);
-        mJobQueue.erase(it);
+        const auto mount = it->first;
+        auto job = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty()) {
+            mJobQueue.erase(it);
+        }
+        ++mRunningJobs[mount];
         lock.unlock();
 
-        for (auto&& job : queue) {
-            job();
-        }
+        job();
 
         lock.lock();
-        mPendingJobsMount = kInvalidStorageId;
+        if (auto runningIt = mRunningJobs.find(mount); --runningIt->second == 0) {
+            mRunningJobs.erase(runningIt);
+        }
         lock.unlock();
         mJobCondition.notify_all();
     }
 }
 
+void IncrementalService::runPrefetchProcessing(const std::shared_ptr<PrefetchQueue>& queue) {
+    std::unique_lock lock(queue->lock);
+    for (;;) {
+        queue->condition.wait(lock,
+                              [&queue]() { return !queue->running || !queue->plans.empty(); });
+        if (!queue->running) {
+            break;
+        }
+
+        auto [ifs, planPath] = std::move(queue->plans.front());
+        queue->plans.pop_front();
+        prefetch(*queue, lock, ifs, planPath);
+    }
+    queue->exited = true;
+    queue->condition.notify_all();
+}
+
+// Runs with `lock` held, and releases it only around reads that may wait on the DataLoader. Once
+// the queue stops, the service may be gone, so nothing but the queue is touched after a read.
+void IncrementalService::prefetch(PrefetchQueue& queue, std::unique_lock<std::mutex>& lock,
+                                  const std::weak_ptr<IncFsMount>& weakIfs,
+                                  const std::string& planPath) {
+    const auto startTs = Clock::now();
+
+    incfs::UniqueFd planFd;
+    if (auto ifs = weakIfs.lock()) {
+        const auto fileId = mIncFs->getFileId(ifs->control, planPath);
+        if (!incfs::isValidFileId(fileId)) {
+            return;
+        }
+        planFd = mIncFs->openForSpecialOps(ifs->control, fileId);
+    }
+    if (!planFd.ok()) {
+        return;
+    }
+    std::string data;
+    lock.unlock();
+    const bool read = android::base::ReadFdToString(planFd.get(), &data);
+    lock.lock();
+    if (!queue.running) {
+        return;
+    }
+    if (!read) {
+        LOG(ERROR) << "Failed to read the prefetch plan " << planPath;
+        return;
+    }
+    const auto plan = PrefetchPlan::parse(data);
+    if (!plan) {
+        LOG(ERROR) << "Invalid prefetch plan " << planPath;
+        return;
+    }
+
+    // Reading a missing block makes it a pending read, which the DataLoader serves in turn. The
+    // files are opened once, and skipped if they are fully loaded already.
+    std::unordered_map<incfs::FileId, incfs::UniqueFd, FileIdHash, FileIdEqual> files;
+    auto buffer = std::unique_ptr<char[]>(new char[constants().prefetchReadSize]);
+    int64_t readBytes = 0;
+    for (auto&& range : plan->ranges()) {
+        auto [fileIt, inserted] = files.try_emplace(range.id);
+        {
+            // The last reference to the mount can't be dropped while the lock is released.
+            const auto ifs = weakIfs.lock();
+            if (!ifs) {
+                LOG(INFO) << "Stopped prefetching for an expired mount";
+                return;
+            }
+            if (inserted &&
+                mIncFs->isFileFullyLoaded(ifs->control, range.id) != incfs::LoadingState::Full) {
+                fileIt->second = mIncFs->openForSpecialOps(ifs->control, range.id);
+            }
+        }
+        if (!fileIt->second.ok()) {
+            continue;
+        }
+
+        auto offset = off64_t(range.first) * constants().blockSize;
+        auto remaining = int64_t(range.count) * constants().blockSize;
+        while (remaining > 0) {
+            const auto size = std::min<int64_t>(remaining, constants().prefetchReadSize);
+            lock.unlock();
+            const auto res = TEMP_FAILURE_RETRY(pread64(fileIt->second.get(), buffer.get(), size,
+                                                        offset));
+            lock.lock();
+            if (!queue.running) {
+                return;
+            }
+            if (res <= 0) {
+                break;
+            }
+            offset += res;
+            remaining -= res;
+            readBytes += res;
+        }
+    }
+
+    if (perfLoggingEnabled()) {
+        LOG(INFO) << "incfs: Prefetched " << plan->ranges().size() << " ranges (" << readBytes
+                  << " bytes) in " << elapsedMcs(startTs, Clock::now()) << "mcs";
+    }
+}
+
 void IncrementalService::registerAppOpsCallback(const std::string& packageName) {
     sp<IAppOpsCallback> listener;
     {
@@ -2924,6 +3183,15 @@ void IncrementalService::DataLoaderStub::onHealthStatus(const StorageHealthListe
     mHealthStatus = healthStatus;
 }
 
+// The health checks of all storages are aligned to the same grid instead of their exact times,
+// so that the ones due at about the same time run on one timer wakeup.
+static Milliseconds coalesceHealthCheckDelay(TimePoint now, Milliseconds delay) {
+    const auto grain = std::chrono::duration_cast<Clock::duration>(constants().healthCheckGrain);
+    const auto deadline = now.time_since_epoch() + delay;
+    const auto aligned = (deadline + grain - Clock::duration(1)) / grain * grain;
+    return std::chrono::ceil<Milliseconds>(aligned - now.time_since_epoch());
+}
+
 void IncrementalService::DataLoaderStub::updateHealthStatus(bool baseline) {
     LOG(DEBUG) << id() << ": updateHealthStatus" << (baseline ? " (baseline)" : "");
 
@@ -2932,14 +3200,12 @@ void IncrementalService::DataLoaderStub::updateHealthStatus(bool baseline) {
 
     {
         std::unique_lock lock(mMutex);
-        unregisterFromPendingReads();
-
         healthListener = mHealthListener;
 
         // Healthcheck depends on timestamp of the oldest pending read.
         // To get it, we need to re-open a pendingReads FD to get a full list of reads.
         // Additionally we need to re-register for epoll with fresh FDs in case there are no
-        // reads.
+        // reads. A storage without reads stays registered with the FD it has.
         const auto now = Clock::now();
         const auto kernelTsUs = getOldestPendingReadTs();
         if (baseline) {
@@ -2958,6 +3224,7 @@ void IncrementalService::DataLoaderStub::updateHealthStatus(bool baseline) {
             return;
         }
 
+        unregisterFromPendingReads();
         resetHealthControl();
 
         // Always make sure the data loader is started.
@@ -3001,6 +3268,7 @@ void IncrementalService::DataLoaderStub::updateHealthStatus(bool baseline) {
             checkBackAfter = unhealthyMonitoring;
             healthStatusToReport = IStorageHealthListener::HEALTH_STATUS_UNHEALTHY;
         }
+        checkBackAfter = coalesceHealthCheckDelay(now, checkBackAfter);
         LOG(DEBUG) << id() << ": updateHealthStatus in " << double(checkBackAfter.count()) / 1000.0
                    << "secs";
         mService.addTimedJob(*mService.mTimedQueue, id(), checkBackAfter,
@@ -3068,12 +3336,14 @@ BootClockTsUs IncrementalService::DataLoaderStub::getOldestPendingReadTs() {
 
 void IncrementalService::DataLoaderStub::registerForPendingReads() {
     const auto pendingReadsFd = mHealthControl.pendingReads();
-    if (pendingReadsFd < 0) {
+    if (pendingReadsFd < 0 || pendingReadsFd == mRegisteredPendingReadsFd) {
         return;
     }
+    unregisterFromPendingReads();
 
     LOG(DEBUG) << id() << ": addFd(pendingReadsFd): " << pendingReadsFd;
 
+    // Epoll picks up the FDs added or removed on any thread, there is no need to wake the looper.
     mService.mLooper->addFd(
             pendingReadsFd, android::Looper::POLL_CALLBACK, android::Looper::EVENT_INPUT,
             [](int, int, void* data) -> int {
@@ -3082,7 +3352,7 @@ void IncrementalService::DataLoaderStub::registerForPendingReads() {
                 return 0;
             },
             this);
-    mService.mLooper->wake();
+    mRegisteredPendingReadsFd = pendingReadsFd;
 }
 
 BootClockTsUs IncrementalService::DataLoaderStub::getOldestTsFromLastPendingReads() {
@@ -3125,7 +3395,7 @@ long IncrementalService::DataLoaderStub::elapsedMsSinceOldestPendingRead() {
 }
 
 void IncrementalService::DataLoaderStub::unregisterFromPendingReads() {
-    const auto pendingReadsFd = mHealthControl.pendingReads();
+    const auto pendingReadsFd = std::exchange(mRegisteredPendingReadsFd, -1);
     if (pendingReadsFd < 0) {
         return;
     }
@@ -3133,7 +3403,6 @@ void IncrementalService::DataLoaderStub::unregisterFromPendingReads() {
     LOG(DEBUG) << id() << ": removeFd(pendingReadsFd): " << pendingReadsFd;
 
     mService.mLooper->removeFd(pendingReadsFd);
-    mService.mLooper->wake();
 }
 
 void IncrementalService::DataLoaderStub::setHealthListener(
@@ -35,6 +35,7 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <map>
@@ -49,6 +50,7 @@
 #include <utility>
 #include <vector>
 
+#include "PrefetchPlan.h"
 #include "ServiceWrappers.h"
 #include "incfs.h"
 #include "path.h"
@@ -172,6 +174,11 @@ public:
     void disallowReadLogs(StorageId storage);
     int setStorageParams(StorageId storage, bool enableReadLogs);
 
+    // Records the blocks the storage reads into a prefetch plan, while its read logs are enabled.
+    bool startPrefetchRecording(StorageId storage);
+    // Returns the serialized plan of the recording, or an empty string if there was none.
+    std::string stopPrefetchRecording(StorageId storage);
+
     int makeFile(StorageId storage, std::string_view path, int mode, FileId id,
                  incfs::NewFileParams params, std::span<const uint8_t> data);
     int makeDir(StorageId storage, std::string_view path, int mode = 0755);
@@ -313,6 +320,7 @@ private:
 
         std::string mHealthPath;
         incfs::UniqueControl mHealthControl;
+        int mRegisteredPendingReadsFd = -1;
         struct {
             TimePoint userTs;
             BootClockTsUs kernelTsUs;
@@ -349,6 +357,9 @@ private:
         BindMap bindPoints;
         DataLoaderStubPtr dataLoaderStub;
         TimePoint startLoadingTs = {};
+        std::unique_ptr<PrefetchPlan> prefetchRecording;
+        // A control of its own, so the recording reads the page reads log with its own offset.
+        Control prefetchControl;
         std::atomic<int> nextStorageDirNo{0};
         const IncrementalService& incrementalService;
 
@@ -457,6 +468,11 @@ private:
     void onAppOpChanged(const std::string& packageName);
 
     void runJobProcessing();
+    struct PrefetchQueue;
+    void runPrefetchProcessing(const std::shared_ptr<PrefetchQueue>& queue);
+    void recordPageReads(const IfsMountPtr& ifs);
+    void prefetch(PrefetchQueue& queue, std::unique_lock<std::mutex>& lock,
+                  const std::weak_ptr<IncFsMount>& weakIfs, const std::string& planPath);
     void extractZipFile(const IfsMountPtr& ifs, ZipArchiveHandle zipFile, ZipEntry& entry,
                         const incfs::FileId& libFileId, std::string_view debugLibPath,
                         Clock::time_point scheduledTs);
@@ -507,11 +523,26 @@ private:
 
     std::atomic_bool mRunning{true};
 
-    std::unordered_map<MountId, std::vector<Job>> mJobQueue;
-    MountId mPendingJobsMount = kInvalidStorageId;
+    // Native library extraction jobs of each mount, run by a small pool of threads. A mount is
+    // in mRunningJobs while any of its jobs is still extracting.
+    std::unordered_map<MountId, std::deque<Job>> mJobQueue;
+    std::unordered_map<MountId, int> mRunningJobs;
     std::condition_variable mJobCondition;
     std::mutex mJobMutex;
-    std::thread mJobProcessor;
+    std::vector<std::thread> mJobProcessors;
+
+    // Prefetches run on their own thread, as they may wait on the DataLoader for a long time.
+    // The thread only uses the service while it holds the queue lock, and it shares the queue,
+    // so a thread still blocked in a read can be left behind when the service goes away.
+    struct PrefetchQueue {
+        std::mutex lock;
+        std::condition_variable condition;
+        std::deque<std::pair<std::weak_ptr<IncFsMount>, std::string>> plans;
+        bool running = true;
+        bool exited = false;
+    };
+    const std::shared_ptr<PrefetchQueue> mPrefetchQueue = std::make_shared<PrefetchQueue>();
+    std::thread mPrefetchProcessor;
 
     std::thread mCmdLooperThread;
 };
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PrefetchPlan.h"
+
+#include <string.h>
+
+#include <limits>
+#include <type_traits>
+
+namespace android::incremental {
+
+namespace {
+
+// "IPFP", followed by the version and the number of ranges.
+constexpr uint32_t kMagic = 0x50465049;
+constexpr uint32_t kVersion = 1;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+};
+
+struct Entry {
+    char id[sizeof(incfs::FileId::data)];
+    int32_t first;
+    int32_t count;
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) == 12);
+static_assert(std::is_trivially_copyable_v<Entry> && sizeof(Entry) == 24);
+
+} // namespace
+
+bool PrefetchPlan::Block::operator==(const Block& other) const {
+    return index == other.index && FileIdEqual()(id, other.id);
+}
+
+size_t PrefetchPlan::BlockHash::operator()(const Block& block) const {
+    return FileIdHash()(block.id) * 31 + std::hash<IncFsBlockIndex>()(block.index);
+}
+
+void PrefetchPlan::add(std::span<const incfs::ReadInfoWithUid> reads) {
+    for (auto&& read : reads) {
+        if (read.block < 0 || !mSeen.insert({read.id, read.block}).second) {
+            continue;
+        }
+        if (!mRanges.empty()) {
+            auto& last = mRanges.back();
+            if (last.first + last.count == read.block && FileIdEqual()(last.id, read.id)) {
+                ++last.count;
+                continue;
+            }
+        }
+        mRanges.push_back({read.id, read.block, 1});
+    }
+}
+
+std::string PrefetchPlan::serialize() const {
+    const Header header = {kMagic, kVersion, uint32_t(mRanges.size())};
+    std::string data(sizeof(header) + mRanges.size() * sizeof(Entry), '\0');
+    memcpy(data.data(), &header, sizeof(header));
+    auto out = data.data() + sizeof(header);
+    for (auto&& range : mRanges) {
+        Entry entry;
+        memcpy(entry.id, range.id.data, sizeof(entry.id));
+        entry.first = range.first;
+        entry.count = range.count;
+        memcpy(out, &entry, sizeof(entry));
+        out += sizeof(entry);
+    }
+    return data;
+}
+
+std::optional<PrefetchPlan> PrefetchPlan::parse(std::string_view data) {
+    Header header;
+    if (data.size() < sizeof(header)) {
+        return {};
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    data.remove_prefix(sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion ||
+        data.size() != size_t(header.count) * sizeof(Entry)) {
+        return {};
+    }
+
+    PrefetchPlan plan;
+    plan.mRanges.reserve(header.count);
+    for (uint32_t i = 0; i < header.count; ++i) {
+        Entry entry;
+        memcpy(&entry, data.data() + i * sizeof(entry), sizeof(entry));
+        if (entry.first < 0 || entry.count <= 0 ||
+            entry.count > std::numeric_limits<IncFsBlockIndex>::max() - entry.first) {
+            return {};
+        }
+        Range range;
+        memcpy(range.id.data, entry.id, sizeof(range.id.data));
+        range.first = entry.first;
+        range.count = entry.count;
+        plan.mRanges.push_back(range);
+    }
+    return plan;
+}
+
+} // namespace android::incremental
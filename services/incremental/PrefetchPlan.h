@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <incfs.h>
+
+#include <string.h>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace android::incremental {
+
+struct FileIdHash {
+    size_t operator()(const incfs::FileId& id) const {
+        return std::hash<std::string_view>()(std::string_view(id.data, sizeof(id.data)));
+    }
+};
+
+struct FileIdEqual {
+    bool operator()(const incfs::FileId& l, const incfs::FileId& r) const {
+        return memcmp(l.data, r.data, sizeof(l.data)) == 0;
+    }
+};
+
+//
+// The blocks a reference launch of an app read, in the order it first read each of them.
+//
+// The plan is recorded from the read logs of a storage, and shipped as the ".prefetch_plan" file
+// of the storage of the next installs. Once such an installation is complete, the service reads
+// the blocks in the plan order, so that the DataLoader streams them before the app needs them.
+//
+class PrefetchPlan {
+public:
+    struct Range {
+        incfs::FileId id;
+        IncFsBlockIndex first;
+        IncFsBlockIndex count;
+    };
+
+    // Appends the blocks of the reads that weren't read before. A block that follows the last
+    // one of the same file extends its range.
+    void add(std::span<const incfs::ReadInfoWithUid> reads);
+
+    const std::vector<Range>& ranges() const { return mRanges; }
+    bool empty() const { return mRanges.empty(); }
+
+    std::string serialize() const;
+    static std::optional<PrefetchPlan> parse(std::string_view data);
+
+private:
+    struct Block {
+        incfs::FileId id;
+        IncFsBlockIndex index;
+
+        bool operator==(const Block& other) const;
+    };
+    struct BlockHash {
+        size_t operator()(const Block& block) const;
+    };
+
+    std::vector<Range> mRanges;
+    std::unordered_set<Block, BlockHash> mSeen;
+};
+
+} // namespace android::incremental
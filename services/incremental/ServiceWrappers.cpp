@@ -241,6 +241,10 @@ public:
             std::vector<incfs::ReadInfoWithUid>* pendingReadsBuffer) const final {
         return incfs::waitForPendingReads(control, timeout, pendingReadsBuffer);
     }
+    WaitResult waitForPageReads(const Control& control, std::chrono::milliseconds timeout,
+                                std::vector<incfs::ReadInfoWithUid>* pageReadsBuffer) const final {
+        return incfs::waitForPageReads(control, timeout, pageReadsBuffer);
+    }
     ErrorCode setUidReadTimeouts(const Control& control,
                                  const std::vector<android::os::incremental::PerUidReadTimeouts>&
                                          perUidReadTimeouts) const final {
@@ -324,7 +328,9 @@ private:
                 return;
             }
 
-            const auto now = Clock::now();
+            // Run the jobs due in the next few ms as well, instead of waking up again for each.
+            static constexpr auto kCoalesceSlack = 5ms;
+            const auto now = Clock::now() + kCoalesceSlack;
             // Always re-acquire begin(). We can't use it after unlock as mTimedJobs can change.
             for (auto it = mJobs.begin(); it != mJobs.end() && it->when <= now;
                  it = mJobs.begin()) {
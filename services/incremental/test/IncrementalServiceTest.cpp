@@ -411,6 +411,9 @@ public:
     MOCK_CONST_METHOD3(waitForPendingReads,
                        WaitResult(const Control& control, std::chrono::milliseconds timeout,
                                   std::vector<incfs::ReadInfoWithUid>* pendingReadsBuffer));
+    MOCK_CONST_METHOD3(waitForPageReads,
+                       WaitResult(const Control& control, std::chrono::milliseconds timeout,
+                                  std::vector<incfs::ReadInfoWithUid>* pageReadsBuffer));
     MOCK_CONST_METHOD2(setUidReadTimeouts,
                        ErrorCode(const Control& control,
                                  const std::vector<PerUidReadTimeouts>& perUidReadTimeouts));
@@ -1446,6 +1449,38 @@ TEST_F(IncrementalServiceTest, testStartDataLoaderUnhealthyStorage) {
     checkHealthMetrics(storageId, 0, listener->mStatus);
 }
 
+TEST_F(IncrementalServiceTest, testHealthyStorageStaysRegisteredForPendingReads) {
+    mIncFs->openMountSuccess();
+    mIncFs->waitForPendingReadsTimeout();
+
+    // Registered once, and unregistered when the storage goes away.
+    EXPECT_CALL(*mLooper, addFd(MockIncFs::kPendingReadsFd, _, _, _, _)).Times(1);
+    EXPECT_CALL(*mLooper, removeFd(MockIncFs::kPendingReadsFd)).Times(1);
+
+    sp<NiceMock<MockStorageHealthListener>> listener{new NiceMock<MockStorageHealthListener>};
+    StorageHealthCheckParams params;
+    params.blockedTimeoutMs = 10000;
+    params.unhealthyTimeoutMs = 20000;
+    params.unhealthyMonitoringMs = 30000;
+
+    TemporaryDir tempDir;
+    int storageId =
+            mIncrementalService->createStorage(tempDir.path, mDataLoaderParcel,
+                                               IncrementalService::CreateOptions::CreateNew);
+    ASSERT_GE(storageId, 0);
+    mIncrementalService->startLoading(storageId, std::move(mDataLoaderParcel), {},
+                                      std::move(params), listener, {});
+    ASSERT_NE(nullptr, mLooper->mCallback);
+
+    // Looper/epoll callbacks without any pending reads left.
+    mLooper->mCallback(-1, -1, mLooper->mCallbackData);
+    mLooper->mCallback(-1, -1, mLooper->mCallbackData);
+    ASSERT_NE(nullptr, mLooper->mCallback);
+    ASSERT_EQ(IStorageHealthListener::HEALTH_STATUS_OK, listener->mStatus);
+
+    mIncrementalService->deleteStorage(storageId);
+}
+
 TEST_F(IncrementalServiceTest, testSetIncFsMountOptionsSuccess) {
     mVold->setIncFsMountOptionsSuccess();
     mAppOpsManager->checkPermissionSuccess();
@@ -2308,4 +2343,112 @@ TEST_F(IncrementalServiceTest, testMetricsWithLastReadError) {
     ASSERT_EQ(expectedLastReadUid, lastReadErrorUid);
 }
 
+TEST_F(IncrementalServiceTest, testPrefetchRecording) {
+    mVold->setIncFsMountOptionsSuccess();
+    mAppOpsManager->checkPermissionSuccess();
+    TemporaryDir tempDir;
+    int storageId =
+            mIncrementalService->createStorage(tempDir.path, mDataLoaderParcel,
+                                               IncrementalService::CreateOptions::CreateNew);
+    ASSERT_GE(storageId, 0);
+    ASSERT_TRUE(mIncrementalService->startLoading(storageId, std::move(mDataLoaderParcel), {}, {},
+                                                  {}, {}));
+    mTimedQueue->clearJob(storageId);
+
+    // Readlogs are disabled.
+    ASSERT_FALSE(mIncrementalService->startPrefetchRecording(storageId));
+    ASSERT_GE(mDataLoader->setStorageParams(true), 0);
+    // The recording can't open read logs of its own.
+    ASSERT_FALSE(mIncrementalService->startPrefetchRecording(storageId));
+
+    TemporaryFile logsFile;
+    const auto logsFd = dup(logsFile.fd);
+    EXPECT_CALL(*mIncFs, openMount(_)).WillOnce(Invoke([&](std::string_view) {
+        return UniqueControl(IncFs_CreateControl(-1, -1, logsFd, -1));
+    }));
+    ASSERT_TRUE(mIncrementalService->startPrefetchRecording(storageId));
+    ASSERT_EQ(storageId, mTimedQueue->mId);
+    ASSERT_EQ(100ms, mTimedQueue->mAfter);
+
+    const FileId first = {{1}}, second = {{2}};
+    ON_CALL(*mIncFs, waitForPageReads(_, _, _))
+            .WillByDefault(Invoke([&](const Control& control, std::chrono::milliseconds,
+                                      std::vector<ReadInfoWithUid>* reads) {
+                EXPECT_EQ(logsFd, control.logs());
+                reads->push_back({.id = first, .block = 0});
+                reads->push_back({.id = first, .block = 1});
+                reads->push_back({.id = second, .block = 5});
+                reads->push_back({.id = first, .block = 0});
+                reads->push_back({.id = first, .block = 2});
+                return WaitResult::HaveData;
+            }));
+    auto job = mTimedQueue->mWhat;
+    mTimedQueue->clearJob(storageId);
+    job();
+    // The job runs again until the recording stops.
+    ASSERT_EQ(storageId, mTimedQueue->mId);
+    ASSERT_TRUE(mTimedQueue->mWhat);
+
+    const auto plan = PrefetchPlan::parse(mIncrementalService->stopPrefetchRecording(storageId));
+    ASSERT_TRUE(plan);
+    ASSERT_EQ(3U, plan->ranges().size());
+    EXPECT_TRUE(FileIdEqual()(first, plan->ranges()[0].id));
+    EXPECT_EQ(0, plan->ranges()[0].first);
+    EXPECT_EQ(2, plan->ranges()[0].count);
+    EXPECT_TRUE(FileIdEqual()(second, plan->ranges()[1].id));
+    EXPECT_EQ(5, plan->ranges()[1].first);
+    EXPECT_TRUE(FileIdEqual()(first, plan->ranges()[2].id));
+    EXPECT_EQ(2, plan->ranges()[2].first);
+    EXPECT_EQ(1, plan->ranges()[2].count);
+    ASSERT_EQ("", mIncrementalService->stopPrefetchRecording(storageId));
+}
+
+TEST_F(IncrementalServiceTest, testPrefetchAfterInstallationComplete) {
+    mVold->setIncFsMountOptionsSuccess();
+    TemporaryDir tempDir;
+    int storageId =
+            mIncrementalService->createStorage(tempDir.path, mDataLoaderParcel,
+                                               IncrementalService::CreateOptions::CreateNew);
+    ASSERT_GE(storageId, 0);
+
+    const FileId planId = {{1}}, loadedId = {{2}}, partialId = {{3}};
+    PrefetchPlan plan;
+    const ReadInfoWithUid reads[] = {{.id = loadedId, .block = 0}, {.id = partialId, .block = 1}};
+    plan.add(reads);
+    TemporaryFile planFile;
+    ASSERT_TRUE(android::base::WriteStringToFd(plan.serialize(), planFile.fd));
+    TemporaryFile dataFile;
+    ASSERT_TRUE(android::base::WriteStringToFd(std::string(2 * 4096, 'x'), dataFile.fd));
+
+    ON_CALL(*mIncFs, getFileId(_, Truly([](std::string_view path) {
+                                   return path.ends_with("/.prefetch_plan");
+                               })))
+            .WillByDefault(Return(planId));
+    ON_CALL(*mIncFs, isFileFullyLoaded(_, An<FileId>()))
+            .WillByDefault(Invoke([&](const Control&, FileId id) {
+                return FileIdEqual()(id, loadedId) ? incfs::LoadingState::Full
+                                                   : incfs::LoadingState::MissingBlocks;
+            }));
+    auto isId = [](const FileId& expected) {
+        return Truly([expected](const FileId& id) { return FileIdEqual()(id, expected); });
+    };
+    EXPECT_CALL(*mIncFs, openForSpecialOps(_, isId(planId)))
+            .WillOnce(Invoke([&](const Control&, FileId) {
+                lseek(planFile.fd, 0, SEEK_SET);
+                return UniqueFd(dup(planFile.fd));
+            }));
+    // Fully loaded files are skipped.
+    EXPECT_CALL(*mIncFs, openForSpecialOps(_, isId(loadedId))).Times(0);
+    std::promise<void> prefetched;
+    EXPECT_CALL(*mIncFs, openForSpecialOps(_, isId(partialId)))
+            .WillOnce(Invoke([&](const Control&, FileId) {
+                UniqueFd fd(dup(dataFile.fd));
+                prefetched.set_value();
+                return fd;
+            }));
+
+    mIncrementalService->onInstallationComplete(storageId);
+    ASSERT_EQ(std::future_status::ready, prefetched.get_future().wait_for(5s));
+}
+
 } // namespace android::os::incremental
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../PrefetchPlan.h"
+
+#include <gtest/gtest.h>
+
+using namespace std::literals;
+
+namespace android::incremental {
+
+static const incfs::FileId kFirst = {{1}};
+static const incfs::FileId kSecond = {{2}};
+
+TEST(PrefetchPlan, MergesConsecutiveBlocks) {
+    PrefetchPlan plan;
+    const incfs::ReadInfoWithUid reads[] = {
+            {.id = kFirst, .block = 3}, {.id = kFirst, .block = 4}, {.id = kFirst, .block = 3},
+            {.id = kSecond, .block = 5}, {.id = kFirst, .block = 5}, {.id = kFirst, .block = 0},
+    };
+    plan.add(reads);
+
+    ASSERT_EQ(4U, plan.ranges().size());
+    EXPECT_TRUE(FileIdEqual()(kFirst, plan.ranges()[0].id));
+    EXPECT_EQ(3, plan.ranges()[0].first);
+    EXPECT_EQ(2, plan.ranges()[0].count);
+    EXPECT_TRUE(FileIdEqual()(kSecond, plan.ranges()[1].id));
+    EXPECT_EQ(5, plan.ranges()[1].first);
+    EXPECT_EQ(1, plan.ranges()[1].count);
+    // Block 5 of the first file doesn't follow the range of the second one.
+    EXPECT_TRUE(FileIdEqual()(kFirst, plan.ranges()[2].id));
+    EXPECT_EQ(5, plan.ranges()[2].first);
+    EXPECT_EQ(1, plan.ranges()[2].count);
+    EXPECT_EQ(0, plan.ranges()[3].first);
+}
+
+TEST(PrefetchPlan, SerializeAndParse) {
+    PrefetchPlan plan;
+    const incfs::ReadInfoWithUid reads[] = {{.id = kSecond, .block = 7},
+                                            {.id = kFirst, .block = 0}};
+    plan.add(reads);
+
+    const auto parsed = PrefetchPlan::parse(plan.serialize());
+    ASSERT_TRUE(parsed);
+    ASSERT_EQ(2U, parsed->ranges().size());
+    EXPECT_TRUE(FileIdEqual()(kSecond, parsed->ranges()[0].id));
+    EXPECT_EQ(7, parsed->ranges()[0].first);
+    EXPECT_TRUE(FileIdEqual()(kFirst, parsed->ranges()[1].id));
+    EXPECT_EQ(0, parsed->ranges()[1].first);
+
+    EXPECT_TRUE(PrefetchPlan::parse(PrefetchPlan().serialize())->empty());
+}
+
+TEST(PrefetchPlan, ParseInvalid) {
+    PrefetchPlan plan;
+    const incfs::ReadInfoWithUid reads[] = {{.id = kFirst, .block = 1}};
+    plan.add(reads);
+    const auto data = plan.serialize();
+
+    EXPECT_FALSE(PrefetchPlan::parse(""sv));
+    EXPECT_FALSE(PrefetchPlan::parse(std::string_view(data).substr(0, data.size() - 1)));
+    EXPECT_FALSE(PrefetchPlan::parse(data + "x"));
+    auto badMagic = data;
+    badMagic[0] = 'x';
+    EXPECT_FALSE(PrefetchPlan::parse(badMagic));
+}
+
+} // namespace android::incremental
@@ -17,7 +17,7 @@
 #include "apk_layout_compiler.h"
 #include "dex_layout_compiler.h"
 #include "java_lang_builder.h"
-#include "layout_validation.h"
+#include "resxml_layout_parser.h"
 #include "util.h"
 
 #include "androidfw/ApkAssets.h"
@@ -31,57 +31,18 @@
 
 namespace startop {
 
-using android::ResXMLParser;
 using android::base::StringPrintf;
 
-class ResXmlVisitorAdapter {
- public:
-  ResXmlVisitorAdapter(ResXMLParser* parser) : parser_{parser} {}
-
-  template <typename Visitor>
-  void Accept(Visitor* visitor) {
-    size_t depth{0};
-    do {
-      switch (parser_->next()) {
-        case ResXMLParser::START_DOCUMENT:
-          depth++;
-          visitor->VisitStartDocument();
-          break;
-        case ResXMLParser::END_DOCUMENT:
-          depth--;
-          visitor->VisitEndDocument();
-          break;
-        case ResXMLParser::START_TAG: {
-          depth++;
-          size_t name_length = 0;
-          const char16_t* name = parser_->getElementName(&name_length);
-          visitor->VisitStartTag(std::u16string{name, name_length});
-          break;
-        }
-        case ResXMLParser::END_TAG:
-          depth--;
-          visitor->VisitEndTag();
-          break;
-        default:;
-      }
-    } while (depth > 0 || parser_->getEventType() == ResXMLParser::FIRST_CHUNK_CODE);
-  }
-
- private:
-  ResXMLParser* parser_;
-};
-
-bool CanCompileLayout(ResXMLParser* parser) {
-  ResXmlVisitorAdapter adapter{parser};
-  LayoutValidationVisitor visitor;
-  adapter.Accept(&visitor);
-
-  return visitor.can_compile();
-}
-
 namespace {
 void CompileApkAssetsLayouts(const android::ApkAssetsPtr& assets, CompilationTarget target,
-                             std::ostream& target_out) {
+                             const ApkLayoutCompilerOptions& options, std::ostream& target_out,
+                             ApkLayoutCompilerStats* stats) {
+  CHECK(assets) << "Unable to load the APK";
+  ApkLayoutCompilerStats unused_stats;
+  if (stats == nullptr) {
+    stats = &unused_stats;
+  }
+
   android::AssetManager2 resources;
   resources.SetApkAssets({assets});
 
@@ -107,6 +68,12 @@ void CompileApkAssetsLayouts(const android::ApkAssetsPtr& assets, CompilationTar
                   ->ForEachFile(path, [&](android::StringPiece layout_file, android::FileType) {
                       auto layout_path = StringPrintf("%s%.*s", path.c_str(),
                                                       (int)layout_file.size(), layout_file.data());
+                      const std::string layout_name =
+                              startop::util::FindLayoutNameFromFilename(layout_path);
+                      if (!options.layouts.empty() && options.layouts.count(layout_name) == 0) {
+                          stats->skipped++;
+                          return;
+                      }
                       android::ApkAssetsCookie cookie = android::kInvalidCookie;
                       auto asset = resources.OpenNonAsset(layout_path,
                                                           android::Asset::ACCESS_RANDOM, &cookie);
@@ -119,10 +86,13 @@ void CompileApkAssetsLayouts(const android::ApkAssetsPtr& assets, CompilationTar
                                      /*copy_data=*/true);
                       android::ResXMLParser parser{xml_tree};
                       parser.restart();
-                      if (CanCompileLayout(&parser)) {
+                      std::string message;
+                      if (!CanCompileLayout(&parser, &message)) {
+                          LOG(INFO) << "Not compiling " << layout_path << ": " << message;
+                          stats->unsupported++;
+                      } else {
                           parser.restart();
-                          const std::string layout_name =
-                                  startop::util::FindLayoutNameFromFilename(layout_path);
+                          stats->compiled++;
                           ResXmlVisitorAdapter adapter{&parser};
                           switch (target) {
                               case CompilationTarget::kDex: {
@@ -165,15 +135,27 @@ void CompileApkAssetsLayouts(const android::ApkAssetsPtr& assets, CompilationTar
 
 void CompileApkLayouts(const std::string& filename, CompilationTarget target,
                        std::ostream& target_out) {
-  auto assets = android::ApkAssets::Load(filename);
-  CompileApkAssetsLayouts(assets, target, target_out);
+  CompileApkLayouts(filename, target, {}, target_out, /*stats=*/nullptr);
 }
 
 void CompileApkLayoutsFd(android::base::unique_fd fd, CompilationTarget target,
                          std::ostream& target_out) {
+  CompileApkLayoutsFd(std::move(fd), target, {}, target_out, /*stats=*/nullptr);
+}
+
+void CompileApkLayouts(const std::string& filename, CompilationTarget target,
+                       const ApkLayoutCompilerOptions& options, std::ostream& target_out,
+                       ApkLayoutCompilerStats* stats) {
+  auto assets = android::ApkAssets::Load(filename);
+  CompileApkAssetsLayouts(assets, target, options, target_out, stats);
+}
+
+void CompileApkLayoutsFd(android::base::unique_fd fd, CompilationTarget target,
+                         const ApkLayoutCompilerOptions& options, std::ostream& target_out,
+                         ApkLayoutCompilerStats* stats) {
   constexpr const char* friendly_name{"viewcompiler assets"};
   auto assets = android::ApkAssets::LoadFromFd(std::move(fd), friendly_name);
-  CompileApkAssetsLayouts(assets, target, target_out);
+  CompileApkAssetsLayouts(assets, target, options, target_out, stats);
 }
 
 }  // namespace startop
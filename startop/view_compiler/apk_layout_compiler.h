@@ -18,6 +18,7 @@
 #define APK_LAYOUT_COMPILER_H_
 
 #include <string>
+#include <unordered_set>
 
 #include "android-base/unique_fd.h"
 
@@ -25,11 +26,34 @@ namespace startop {
 
 enum class CompilationTarget { kJavaLanguage, kDex };
 
+struct ApkLayoutCompilerOptions {
+  // The names of the layouts to compile, such as those an app profile found hot at startup.
+  // All of the layouts of the APK are compiled if empty.
+  std::unordered_set<std::string> layouts;
+};
+
+// What a compilation did with the layouts of an APK, to be logged or reported as metrics.
+struct ApkLayoutCompilerStats {
+  // Layouts compiled into the output.
+  size_t compiled{0};
+  // Layouts left out by ApkLayoutCompilerOptions::layouts.
+  size_t skipped{0};
+  // Layouts that layout validation rejected, e.g. for having a merge or include tag.
+  size_t unsupported{0};
+};
+
 void CompileApkLayouts(const std::string& filename, CompilationTarget target,
                        std::ostream& target_out);
 void CompileApkLayoutsFd(android::base::unique_fd fd, CompilationTarget target,
                          std::ostream& target_out);
 
+void CompileApkLayouts(const std::string& filename, CompilationTarget target,
+                       const ApkLayoutCompilerOptions& options, std::ostream& target_out,
+                       ApkLayoutCompilerStats* stats);
+void CompileApkLayoutsFd(android::base::unique_fd fd, CompilationTarget target,
+                         const ApkLayoutCompilerOptions& options, std::ostream& target_out,
+                         ApkLayoutCompilerStats* stats);
+
 }  // namespace startop
 
 #endif  // APK_LAYOUT_COMPILER_H_
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares, for each layout of an APK, the binary XML walk that XmlBlock-based inflation repeats
+// on every inflation against the one-time cost of compiling the layout into dex at dexopt time.
+//
+//   layout_inflation_benchmark <apk> [benchmark flags]
+
+#include "apk_layout_compiler.h"
+#include "dex_builder.h"
+#include "dex_layout_compiler.h"
+#include "resxml_layout_parser.h"
+#include "util.h"
+
+#include "androidfw/ApkAssets.h"
+#include "androidfw/AssetManager2.h"
+#include "androidfw/ResourceTypes.h"
+#include "android-base/logging.h"
+#include "android-base/stringprintf.h"
+#include "benchmark/benchmark.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using android::base::StringPrintf;
+
+struct Layout {
+  std::string name;
+  std::string data;
+  std::shared_ptr<const android::DynamicRefTable> dynamic_ref_table;
+};
+
+std::vector<Layout> LoadLayouts(const android::ApkAssetsPtr& assets) {
+  android::AssetManager2 resources;
+  resources.SetApkAssets({assets});
+
+  std::vector<Layout> layouts;
+  assets->GetAssetsProvider()->ForEachFile("res/layout/", [&](android::StringPiece file,
+                                                              android::FileType) {
+    auto path = StringPrintf("res/layout/%.*s", (int)file.size(), file.data());
+    android::ApkAssetsCookie cookie = android::kInvalidCookie;
+    auto asset = resources.OpenNonAsset(path, android::Asset::ACCESS_BUFFER, &cookie);
+    CHECK(asset);
+    const char* buffer = static_cast<const char*>(asset->getBuffer(/*wordAligned=*/true));
+    layouts.push_back({startop::util::FindLayoutNameFromFilename(path),
+                       std::string{buffer, static_cast<size_t>(asset->getLength())},
+                       resources.GetDynamicRefTableForCookie(cookie)});
+  });
+  return layouts;
+}
+
+// What the framework does natively for each inflation of a layout through XmlBlock: walk all its
+// tags and read all their attributes.
+void BM_ParseLayout(benchmark::State& state, const Layout* layout) {
+  for (auto _ : state) {
+    android::ResXMLTree xml_tree{layout->dynamic_ref_table};
+    xml_tree.setTo(layout->data.data(), layout->data.size(), /*copy_data=*/false);
+    android::ResXMLParser parser{xml_tree};
+    parser.restart();
+    android::ResXMLParser::event_code_t code;
+    while ((code = parser.next()) != android::ResXMLParser::END_DOCUMENT &&
+           code != android::ResXMLParser::BAD_DOCUMENT) {
+      if (code != android::ResXMLParser::START_TAG) {
+        continue;
+      }
+      benchmark::DoNotOptimize(parser.getElementNameID());
+      for (size_t i = 0; i < parser.getAttributeCount(); i++) {
+        android::Res_value value;
+        benchmark::DoNotOptimize(parser.getAttributeNameResID(i));
+        benchmark::DoNotOptimize(parser.getAttributeValue(i, &value));
+      }
+    }
+  }
+}
+
+// What dexopt pays once to compile the layout, so that inflating it doesn't parse XML.
+void BM_CompileLayout(benchmark::State& state, const Layout* layout) {
+  for (auto _ : state) {
+    android::ResXMLTree xml_tree{layout->dynamic_ref_table};
+    xml_tree.setTo(layout->data.data(), layout->data.size(), /*copy_data=*/false);
+    android::ResXMLParser parser{xml_tree};
+    parser.restart();
+
+    startop::dex::DexBuilder dex_file;
+    startop::dex::ClassBuilder compiled_view{dex_file.MakeClass("CompiledView")};
+    startop::dex::MethodBuilder method{compiled_view.CreateMethod(
+        layout->name,
+        startop::dex::Prototype{startop::dex::TypeDescriptor::FromClassname("android.view.View"),
+                                startop::dex::TypeDescriptor::FromClassname(
+                                    "android.content.Context"),
+                                startop::dex::TypeDescriptor::Int()})};
+    startop::DexViewBuilder builder{&method};
+    builder.Start();
+    startop::LayoutCompilerVisitor visitor{&builder};
+    startop::ResXmlVisitorAdapter adapter{&parser};
+    adapter.Accept(&visitor);
+    builder.Finish();
+    method.Encode();
+    slicer::MemView image{dex_file.CreateImage()};
+    benchmark::DoNotOptimize(image.ptr<const char>());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (argc < 2) {
+    LOG(ERROR) << "Usage: " << argv[0] << " <apk> [benchmark flags]";
+    return 1;
+  }
+  auto assets = android::ApkAssets::Load(argv[1]);
+  if (!assets) {
+    LOG(ERROR) << "Unable to load " << argv[1];
+    return 1;
+  }
+
+  const std::vector<Layout> layouts = LoadLayouts(assets);
+  for (const Layout& layout : layouts) {
+    android::ResXMLTree xml_tree{layout.dynamic_ref_table};
+    xml_tree.setTo(layout.data.data(), layout.data.size(), /*copy_data=*/false);
+    android::ResXMLParser parser{xml_tree};
+    parser.restart();
+    if (!startop::CanCompileLayout(&parser)) {
+      continue;
+    }
+    benchmark::RegisterBenchmark(("BM_ParseLayout/" + layout.name).c_str(), BM_ParseLayout,
+                                 &layout);
+    benchmark::RegisterBenchmark(("BM_CompileLayout/" + layout.name).c_str(), BM_CompileLayout,
+                                 &layout);
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -16,6 +16,7 @@
 
 #include "gflags/gflags.h"
 
+#include "android-base/file.h"
 #include "android-base/stringprintf.h"
 #include "apk_layout_compiler.h"
 #include "dex_builder.h"
@@ -50,6 +51,9 @@ constexpr char kStdoutFilename[]{"stdout"};
 DEFINE_bool(apk, false, "Compile layouts in an APK");
 DEFINE_bool(dex, false, "Generate a DEX file instead of Java");
 DEFINE_int32(infd, -1, "Read input from the given file descriptor");
+DEFINE_string(layouts, "",
+              "With --apk, a file listing the names of the layouts to compile, one per line. "
+              "All layouts are compiled if unset");
 DEFINE_string(out, kStdoutFilename, "Where to write the generated class");
 DEFINE_string(package, "", "The package name for the generated class (required)");
 
@@ -120,17 +124,30 @@ int main(int argc, char** argv) {
   if (FLAGS_apk) {
     const startop::CompilationTarget target =
         FLAGS_dex ? startop::CompilationTarget::kDex : startop::CompilationTarget::kJavaLanguage;
+    startop::ApkLayoutCompilerOptions options;
+    if (!FLAGS_layouts.empty()) {
+      string layouts;
+      if (!android::base::ReadFileToString(FLAGS_layouts, &layouts)) {
+        PLOG(ERROR) << "Unable to read " << FLAGS_layouts;
+        return 1;
+      }
+      options.layouts = startop::util::ParseLayoutNames(layouts);
+    }
+    startop::ApkLayoutCompilerStats stats;
     if (FLAGS_infd >= 0) {
-      startop::CompileApkLayoutsFd(
-          android::base::unique_fd{FLAGS_infd}, target, is_stdout ? std::cout : outfile);
+      startop::CompileApkLayoutsFd(android::base::unique_fd{FLAGS_infd}, target, options,
+                                   is_stdout ? std::cout : outfile, &stats);
     } else {
       if (argc < 2) {
         gflags::ShowUsageWithFlags(argv[kProgramName]);
         return 1;
       }
       const char* const filename = argv[kFileNameParam];
-      startop::CompileApkLayouts(filename, target, is_stdout ? std::cout : outfile);
+      startop::CompileApkLayouts(filename, target, options, is_stdout ? std::cout : outfile,
+                                 &stats);
     }
+    LOG(INFO) << "Compiled " << stats.compiled << " layouts, skipped " << stats.skipped
+              << " and found " << stats.unsupported << " unsupported";
     return 0;
   }
 
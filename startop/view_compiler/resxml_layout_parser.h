@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef RESXML_LAYOUT_PARSER_H_
+#define RESXML_LAYOUT_PARSER_H_
+
+#include "androidfw/ResourceTypes.h"
+
+#include <string>
+
+namespace startop {
+
+// Drives a visitor through the events of the binary XML of a compiled layout, as found in an APK.
+class ResXmlVisitorAdapter {
+ public:
+  ResXmlVisitorAdapter(android::ResXMLParser* parser) : parser_{parser} {}
+
+  template <typename Visitor>
+  void Accept(Visitor* visitor) {
+    size_t depth{0};
+    do {
+      switch (parser_->next()) {
+        case android::ResXMLParser::START_DOCUMENT:
+          depth++;
+          visitor->VisitStartDocument();
+          break;
+        case android::ResXMLParser::END_DOCUMENT:
+          depth--;
+          visitor->VisitEndDocument();
+          break;
+        case android::ResXMLParser::START_TAG: {
+          depth++;
+          size_t name_length = 0;
+          const char16_t* name = parser_->getElementName(&name_length);
+          visitor->VisitStartTag(std::u16string{name, name_length});
+          break;
+        }
+        case android::ResXMLParser::END_TAG:
+          depth--;
+          visitor->VisitEndTag();
+          break;
+        default:;
+      }
+    } while (depth > 0 || parser_->getEventType() == android::ResXMLParser::FIRST_CHUNK_CODE);
+  }
+
+ private:
+  android::ResXMLParser* parser_;
+};
+
+// Returns whether a layout resource represented by a binary XML parser is supported by the layout
+// compiler.
+bool CanCompileLayout(android::ResXMLParser* parser, std::string* message = nullptr);
+
+}  // namespace startop
+
+#endif  // RESXML_LAYOUT_PARSER_H_
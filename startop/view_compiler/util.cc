@@ -16,6 +16,8 @@
 
 #include "util.h"
 
+#include "android-base/strings.h"
+
 using std::string;
 
 namespace startop {
@@ -34,5 +36,16 @@ string FindLayoutNameFromFilename(const string& filename) {
   return filename.substr(start, end - start);
 }
 
+std::unordered_set<string> ParseLayoutNames(const string& text) {
+  std::unordered_set<string> names;
+  for (const string& line : android::base::Split(text, "\n")) {
+    string name = android::base::Trim(line);
+    if (!name.empty() && name[0] != '#') {
+      names.insert(std::move(name));
+    }
+  }
+  return names;
+}
+
 }  // namespace util
 }  // namespace startop
@@ -17,12 +17,17 @@
 #define VIEW_COMPILER_UTIL_H_
 
 #include <string>
+#include <unordered_set>
 
 namespace startop {
 namespace util {
 
 std::string FindLayoutNameFromFilename(const std::string& filename);
 
+// Parses a list of layout names, one per line, such as the hot layouts of an app. Surrounding
+// whitespace, blank lines and lines starting with '#' are ignored.
+std::unordered_set<std::string> ParseLayoutNames(const std::string& text);
+
 }  // namespace util
 }  // namespace startop
 
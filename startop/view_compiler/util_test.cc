@@ -30,5 +30,11 @@ TEST(UtilTest, FindLayoutNameFromFilename) {
   EXPECT_EQ("bar", startop::util::FindLayoutNameFromFilename("/foo/bar.xml"));
 }
 
+TEST(UtilTest, ParseLayoutNames) {
+  EXPECT_TRUE(startop::util::ParseLayoutNames("").empty());
+  EXPECT_EQ((std::unordered_set<string>{"activity_main", "list_item"}),
+            startop::util::ParseLayoutNames("# hot layouts\nactivity_main\n\n  list_item \n"));
+}
+
 }  // namespace util
 }  // namespace startop
@@ -16,6 +16,12 @@
 
 #include "LoadedApk.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "ResourceValues.h"
 #include "ValueVisitor.h"
 #include "format/Archive.h"
@@ -25,6 +31,7 @@
 #include "format/proto/ProtoSerialize.h"
 #include "io/BigBufferStream.h"
 #include "io/Util.h"
+#include "trace/TraceBuffer.h"
 #include "xml/XmlDom.h"
 
 using ::aapt::io::IFile;
@@ -72,8 +79,38 @@ static ApkFormat DetermineApkFormat(io::IFileCollection* apk) {
   }
 }
 
+// Deserializes the proto resource table in `table_file`. Returns nullptr on error.
+static std::unique_ptr<ResourceTable> LoadProtoTable(const android::Source& source,
+                                                     io::IFile* table_file,
+                                                     io::IFileCollection* collection,
+                                                     android::IDiagnostics* diag) {
+  TRACE_CALL();
+  pb::ResourceTable pb_table;
+  std::unique_ptr<io::InputStream> in = table_file->OpenInputStream();
+  if (in == nullptr) {
+    diag->Error(android::DiagMessage(source) << "failed to open " << kProtoResourceTablePath);
+    return {};
+  }
+
+  io::ProtoInputStreamReader proto_reader(in.get());
+  if (!proto_reader.ReadMessage(&pb_table)) {
+    diag->Error(android::DiagMessage(source) << "failed to read " << kProtoResourceTablePath);
+    return {};
+  }
+
+  std::string error;
+  auto table = util::make_unique<ResourceTable>(ResourceTable::Validation::kDisabled);
+  if (!DeserializeTableFromPb(pb_table, collection, table.get(), &error)) {
+    diag->Error(android::DiagMessage(source)
+                << "failed to deserialize " << kProtoResourceTablePath << ": " << error);
+    return {};
+  }
+  return table;
+}
+
 std::unique_ptr<LoadedApk> LoadedApk::LoadApkFromPath(StringPiece path,
-                                                      android::IDiagnostics* diag) {
+                                                      android::IDiagnostics* diag,
+                                                      bool lazy_table) {
   android::Source source(path);
   std::string error;
   std::unique_ptr<io::ZipFileCollection> apk = io::ZipFileCollection::Create(path, &error);
@@ -87,7 +124,7 @@ std::unique_ptr<LoadedApk> LoadedApk::LoadApkFromPath(StringPiece path,
     case ApkFormat::kBinary:
       return LoadBinaryApkFromFileCollection(source, std::move(apk), diag);
     case ApkFormat::kProto:
-      return LoadProtoApkFromFileCollection(source, std::move(apk), diag);
+      return LoadProtoApkFromFileCollection(source, std::move(apk), diag, lazy_table);
     default:
       diag->Error(android::DiagMessage(path) << "could not identify format of APK");
       return {};
@@ -96,29 +133,13 @@ std::unique_ptr<LoadedApk> LoadedApk::LoadApkFromPath(StringPiece path,
 
 std::unique_ptr<LoadedApk> LoadedApk::LoadProtoApkFromFileCollection(
     const android::Source& source, unique_ptr<io::IFileCollection> collection,
-    android::IDiagnostics* diag) {
+    android::IDiagnostics* diag, bool lazy_table) {
   std::unique_ptr<ResourceTable> table;
 
   io::IFile* table_file = collection->FindFile(kProtoResourceTablePath);
-  if (table_file != nullptr) {
-    pb::ResourceTable pb_table;
-    std::unique_ptr<io::InputStream> in = table_file->OpenInputStream();
-    if (in == nullptr) {
-      diag->Error(android::DiagMessage(source) << "failed to open " << kProtoResourceTablePath);
-      return {};
-    }
-
-    io::ProtoInputStreamReader proto_reader(in.get());
-    if (!proto_reader.ReadMessage(&pb_table)) {
-      diag->Error(android::DiagMessage(source) << "failed to read " << kProtoResourceTablePath);
-      return {};
-    }
-
-    std::string error;
-    table = util::make_unique<ResourceTable>(ResourceTable::Validation::kDisabled);
-    if (!DeserializeTableFromPb(pb_table, collection.get(), table.get(), &error)) {
-      diag->Error(android::DiagMessage(source)
-                  << "failed to deserialize " << kProtoResourceTablePath << ": " << error);
+  if (table_file != nullptr && !lazy_table) {
+    table = LoadProtoTable(source, table_file, collection.get(), diag);
+    if (table == nullptr) {
       return {};
     }
   }
@@ -149,8 +170,19 @@ std::unique_ptr<LoadedApk> LoadedApk::LoadProtoApkFromFileCollection(
                 << "failed to deserialize proto " << kAndroidManifestPath << ": " << error);
     return {};
   }
-  return util::make_unique<LoadedApk>(source, std::move(collection), std::move(table),
-                                      std::move(manifest), ApkFormat::kProto);
+  auto apk = util::make_unique<LoadedApk>(source, std::move(collection), std::move(table),
+                                          std::move(manifest), ApkFormat::kProto);
+  if (lazy_table) {
+    apk->pending_table_file_ = table_file;
+    apk->pending_table_diag_ = diag;
+  }
+  return apk;
+}
+
+void LoadedApk::LoadPendingTableSlow() const {
+  io::IFile* table_file = pending_table_file_;
+  pending_table_file_ = nullptr;
+  table_ = LoadProtoTable(source_, table_file, apk_.get(), pending_table_diag_);
 }
 
 std::unique_ptr<LoadedApk> LoadedApk::LoadBinaryApkFromFileCollection(
@@ -200,12 +232,13 @@ std::unique_ptr<LoadedApk> LoadedApk::LoadBinaryApkFromFileCollection(
 bool LoadedApk::WriteToArchive(IAaptContext* context, const TableFlattenerOptions& options,
                                IArchiveWriter* writer) {
   FilterChain empty;
-  return WriteToArchive(context, table_.get(), options, &empty, writer);
+  return WriteToArchive(context, GetResourceTable(), options, &empty, writer);
 }
 
 bool LoadedApk::WriteToArchive(IAaptContext* context, ResourceTable* split_table,
                                const TableFlattenerOptions& options, FilterChain* filters,
                                IArchiveWriter* writer, XmlResource* manifest) {
+  TRACE_CALL();
   std::set<std::string> referenced_resources;
   // List the files being referenced in the resource table.
   for (auto& pkg : split_table->packages) {
@@ -221,6 +254,8 @@ bool LoadedApk::WriteToArchive(IAaptContext* context, ResourceTable* split_table
     }
   }
 
+  // The files to write, in the order of the input APK, with the path each is written at.
+  std::vector<std::pair<io::IFile*, std::string>> files;
   std::unique_ptr<io::IFileCollectionIterator> iterator = apk_->Iterator();
   while (iterator->HasNext()) {
     io::IFile* file = iterator->Next();
@@ -251,6 +286,51 @@ bool LoadedApk::WriteToArchive(IAaptContext* context, ResourceTable* split_table
       }
       continue;
     }
+    files.emplace_back(file, std::move(output_path));
+  }
+
+  // Whether the file is copied as is, rather than regenerated from the table or manifest.
+  auto is_copied = [&](io::IFile* file) {
+    const std::string& path = file->GetSource().path;
+    return !(format_ == ApkFormat::kBinary && path == kApkResourceTablePath) &&
+           !(format_ == ApkFormat::kProto && path == kProtoResourceTablePath) &&
+           !(manifest != nullptr && path == "AndroidManifest.xml");
+  };
+
+  // The archive is written on this thread, but with several jobs the files copied to it are read
+  // and inflated on them first, a window of files at a time to bound the memory they take.
+  constexpr size_t kReadWindow = 64;
+  std::vector<std::unique_ptr<io::IData>> window_data;
+
+  for (size_t i = 0; i < files.size(); i++) {
+    io::IFile* file = files[i].first;
+    const std::string& path = file->GetSource().path;
+    const std::string& output_path = files[i].second;
+
+    const size_t window_index = i % kReadWindow;
+    if (options.jobs > 1 && window_index == 0) {
+      const size_t window_size = std::min(kReadWindow, files.size() - i);
+      window_data.clear();
+      window_data.resize(window_size);
+
+      std::atomic<size_t> next_file = 0;
+      auto worker = [&]() {
+        for (size_t j = next_file++; j < window_size; j = next_file++) {
+          if (is_copied(files[i + j].first)) {
+            window_data[j] = files[i + j].first->OpenAsData();
+          }
+        }
+      };
+
+      std::vector<std::thread> threads;
+      const size_t thread_count = std::min(options.jobs, window_size);
+      for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back(worker);
+      }
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    }
 
     // The resource table needs to be re-serialized since it might have changed.
     if (format_ == ApkFormat::kBinary && path == kApkResourceTablePath) {
@@ -301,6 +381,12 @@ bool LoadedApk::WriteToArchive(IAaptContext* context, ResourceTable* split_table
                                         writer)) {
         return false;
       }
+    } else if (options.jobs > 1) {
+      std::unique_ptr<io::IData> data = std::move(window_data[window_index]);
+      if (!io::CopyFileToArchivePreserveCompression(context, file, data.get(), output_path,
+                                                    writer)) {
+        return false;
+      }
     } else {
       if (!io::CopyFileToArchivePreserveCompression(
               context, file, output_path, writer)) {
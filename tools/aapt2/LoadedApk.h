@@ -45,13 +45,19 @@ class LoadedApk {
   virtual ~LoadedApk() = default;
 
   // Loads both binary and proto APKs from disk.
+  //
+  // When `lazy_table` is set, the resource table of a proto APK is only deserialized the first time
+  // it is retrieved, and errors in it are reported to `diag` at that point. Commands that only
+  // need the manifest then never read the table. Retrieving a table that has not been loaded yet
+  // is not thread-safe.
   static std::unique_ptr<LoadedApk> LoadApkFromPath(android::StringPiece path,
-                                                    android::IDiagnostics* diag);
+                                                    android::IDiagnostics* diag,
+                                                    bool lazy_table = false);
 
   // Loads a proto APK from the given file collection.
   static std::unique_ptr<LoadedApk> LoadProtoApkFromFileCollection(
       const android::Source& source, std::unique_ptr<io::IFileCollection> collection,
-      android::IDiagnostics* diag);
+      android::IDiagnostics* diag, bool lazy_table = false);
 
   // Loads a binary APK from the given file collection.
   static std::unique_ptr<LoadedApk> LoadBinaryApkFromFileCollection(
@@ -76,11 +82,14 @@ class LoadedApk {
     return format_;
   }
 
+  // Returns nullptr if the APK has no resource table, or if a lazily loaded one is invalid.
   const ResourceTable* GetResourceTable() const {
+    LoadPendingTable();
     return table_.get();
   }
 
   ResourceTable* GetResourceTable() {
+    LoadPendingTable();
     return table_.get();
   }
 
@@ -119,9 +128,21 @@ class LoadedApk {
  private:
   DISALLOW_COPY_AND_ASSIGN(LoadedApk);
 
+  // Deserializes the table that was left for later by a lazy load, if there is one.
+  void LoadPendingTable() const {
+    if (pending_table_file_ != nullptr) {
+      LoadPendingTableSlow();
+    }
+  }
+
+  void LoadPendingTableSlow() const;
+
   android::Source source_;
   std::unique_ptr<io::IFileCollection> apk_;
-  std::unique_ptr<ResourceTable> table_;
+  mutable std::unique_ptr<ResourceTable> table_;
+  // The resource table file that has not been deserialized yet, and where to report its errors.
+  mutable io::IFile* pending_table_file_ = nullptr;
+  android::IDiagnostics* pending_table_diag_ = nullptr;
   std::unique_ptr<xml::XmlResource> manifest_;
   ApkFormat format_;
 };
@@ -38,6 +38,7 @@
 #include "cmd/Link.h"
 #include "cmd/Optimize.h"
 #include "io/FileStream.h"
+#include "process/SymbolTable.h"
 #include "trace/TraceBuffer.h"
 #include "util/Files.h"
 #include "util/Util.h"
@@ -110,6 +111,9 @@ class DaemonCommand : public Command {
   int Action(const std::vector<std::string>& arguments) override {
     TRACE_FLUSH_ARGS(trace_folder_ ? trace_folder_.value() : "", "daemon", arguments);
     text::Printer printer(out_);
+
+    // Invocations usually include the same framework APKs, keep them loaded in between.
+    AssetManagerSymbolSource::SetApkAssetsCacheEnabled(true);
     std::cout << "Ready" << std::endl;
 
     while (true) {
@@ -139,10 +139,22 @@ ResourceTableType* ResourceTablePackage::FindOrCreateType(const ResourceNamedTyp
   });
 }
 
+std::vector<std::unique_ptr<ResourceEntry>>::iterator ResourceTableType::LowerBoundEntry(
+    android::StringPiece name) {
+  const size_t hint = entry_hint_;
+  if (hint <= entries.size() &&
+      (hint == 0 || less_than_struct_with_name<ResourceEntry>(entries[hint - 1], name)) &&
+      (hint == entries.size() || !less_than_struct_with_name<ResourceEntry>(entries[hint], name))) {
+    return entries.begin() + hint;
+  }
+  return std::lower_bound(entries.begin(), entries.end(), name,
+                          less_than_struct_with_name<ResourceEntry>);
+}
+
 ResourceEntry* ResourceTableType::CreateEntry(android::StringPiece name) {
-  return FindElementsRunAction<ResourceEntry>(name, entries, [&](bool found, auto& iter) {
-    return entries.emplace(iter, new ResourceEntry(name))->get();
-  });
+  auto iter = entries.emplace(LowerBoundEntry(name), new ResourceEntry(name));
+  entry_hint_ = std::distance(entries.begin(), iter) + 1;
+  return iter->get();
 }
 
 ResourceEntry* ResourceTableType::FindEntry(android::StringPiece name) const {
@@ -151,9 +163,12 @@ ResourceEntry* ResourceTableType::FindEntry(android::StringPiece name) const {
 }
 
 ResourceEntry* ResourceTableType::FindOrCreateEntry(android::StringPiece name) {
-  return FindElementsRunAction<ResourceEntry>(name, entries, [&](bool found, auto& iter) {
-    return found ? iter->get() : entries.emplace(iter, new ResourceEntry(name))->get();
-  });
+  auto iter = LowerBoundEntry(name);
+  if (iter == entries.end() || name != (*iter)->name) {
+    iter = entries.emplace(iter, new ResourceEntry(name));
+  }
+  entry_hint_ = std::distance(entries.begin(), iter) + 1;
+  return iter->get();
 }
 
 ResourceConfigValue* ResourceEntry::FindValue(const ConfigDescription& config,
@@ -187,6 +187,15 @@ class ResourceTableType {
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ResourceTableType);
+
+  // Returns the first entry with the given name, or where an entry with that name would be
+  // inserted.
+  std::vector<std::unique_ptr<ResourceEntry>>::iterator LowerBoundEntry(android::StringPiece name);
+
+  // The position right after the entry that was last found or created by this type. Merging a
+  // table visits the entries of each type in order, so the next entry usually belongs there.
+  // Only a hint: `entries` may have changed since, and it is checked before it is used.
+  size_t entry_hint_ = 0;
 };
 
 class ResourceTablePackage {
@@ -385,4 +385,31 @@ TEST(ResourceTableTest, ConflictingIdsCreateEntry) {
       test::GetDiagnostics()));
 }
 
+TEST(ResourceTableTest, FindOrCreateEntryKeepsEntriesSorted) {
+  ResourceTableType type(ResourceNamedTypeWithDefaultName(ResourceType::kString));
+  ResourceEntry* b = type.FindOrCreateEntry("b");
+  ResourceEntry* d = type.FindOrCreateEntry("d");
+  EXPECT_EQ(b, type.FindOrCreateEntry("b"));
+  EXPECT_EQ(d, type.FindOrCreateEntry("d"));
+
+  // Entries before, between and after the ones created last.
+  ResourceEntry* a = type.FindOrCreateEntry("a");
+  ResourceEntry* c = type.FindOrCreateEntry("c");
+  ResourceEntry* e = type.FindOrCreateEntry("e");
+  EXPECT_EQ(c, type.FindOrCreateEntry("c"));
+  EXPECT_EQ(a, type.FindOrCreateEntry("a"));
+
+  // An entry removed behind the type's back.
+  type.entries.erase(type.entries.begin() + 1);
+  EXPECT_EQ(c, type.FindOrCreateEntry("c"));
+  EXPECT_EQ(e, type.FindEntry("e"));
+  EXPECT_EQ(nullptr, type.FindEntry("b"));
+
+  ASSERT_EQ(4u, type.entries.size());
+  EXPECT_EQ("a", type.entries[0]->name);
+  EXPECT_EQ("c", type.entries[1]->name);
+  EXPECT_EQ("d", type.entries[2]->name);
+  EXPECT_EQ("e", type.entries[3]->name);
+}
+
 }  // namespace aapt
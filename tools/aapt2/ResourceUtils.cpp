@@ -711,6 +711,56 @@ std::unique_ptr<Item> TryParseItemForAttribute(
   return {};
 }
 
+std::unique_ptr<Item> ItemForAttributeCache::TryParseItemForAttribute(StringPiece value,
+                                                                      const Attribute* attr) {
+  using android::ResTable_map;
+
+  const uint32_t type_mask = attr->type_mask;
+  auto item = TryParseItemForAttribute(value, type_mask);
+  if (item) {
+    return item;
+  }
+
+  if (type_mask & ResTable_map::TYPE_ENUM) {
+    auto enum_value = TryParseEnumSymbol(attr, value);
+    if (enum_value) {
+      return std::move(enum_value);
+    }
+  }
+
+  if (type_mask & ResTable_map::TYPE_FLAGS) {
+    auto flag_value = TryParseFlagSymbol(attr, value);
+    if (flag_value) {
+      return std::move(flag_value);
+    }
+  }
+  return {};
+}
+
+std::unique_ptr<Item> ItemForAttributeCache::TryParseItemForAttribute(StringPiece value,
+                                                                      uint32_t type_mask) {
+  std::string key(reinterpret_cast<const char*>(&type_mask), sizeof(type_mask));
+  key.append(value);
+  Shard& shard = shards_[std::hash<std::string>{}(key) % kShardCount];
+
+  // The items parsed from a type mask never refer to a string pool.
+  CloningValueTransformer cloner(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.items.find(key);
+    if (it != shard.items.end()) {
+      return it->second ? it->second->Transform(cloner) : nullptr;
+    }
+  }
+
+  std::unique_ptr<Item> item = ResourceUtils::TryParseItemForAttribute(value, type_mask);
+  std::lock_guard<std::mutex> lock(shard.lock);
+  if (shard.items.size() < kMaxShardSize) {
+    shard.items.emplace(std::move(key), item ? item->Transform(cloner) : nullptr);
+  }
+  return item;
+}
+
 std::string BuildResourceFileName(const ResourceFile& res_file, const NameMangler* mangler) {
   std::stringstream out;
   out << "res/" << res_file.name.type;
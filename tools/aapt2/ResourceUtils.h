@@ -17,12 +17,17 @@
 #ifndef AAPT_RESOURCEUTILS_H
 #define AAPT_RESOURCEUTILS_H
 
+#include <array>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "NameMangler.h"
 #include "Resource.h"
 #include "ResourceValues.h"
+#include "android-base/macros.h"
 #include "androidfw/AssetManager2.h"
 #include "androidfw/ConfigDescription.h"
 #include "androidfw/ResourceTypes.h"
@@ -209,6 +214,34 @@ std::unique_ptr<Item> TryParseItemForAttribute(
 
 uint32_t AndroidTypeToAttributeTypeMask(uint16_t type);
 
+// Remembers what TryParseItemForAttribute() parsed strings as. The XML files of an app assign the
+// same few values to attributes over and over, and with this cache each is only parsed once for
+// every type mask it is assigned with. Safe to use from several threads.
+class ItemForAttributeCache {
+ public:
+  ItemForAttributeCache() = default;
+
+  // Same as TryParseItemForAttribute() without an on_create_reference callback. Enum and flag
+  // symbols depend on the attribute rather than on its type mask, so they are not cached.
+  std::unique_ptr<Item> TryParseItemForAttribute(android::StringPiece value, const Attribute* attr);
+  std::unique_ptr<Item> TryParseItemForAttribute(android::StringPiece value, uint32_t type_mask);
+
+  static constexpr size_t kShardCount = 16;
+  // Once a shard is this big it stops caching new strings, which are likely not repeated anyway.
+  static constexpr size_t kMaxShardSize = 1024;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ItemForAttributeCache);
+
+  struct Shard {
+    std::mutex lock;
+    // Keyed by the type mask followed by the string. A null item is a string that doesn't parse.
+    std::unordered_map<std::string, std::unique_ptr<Item>> items;
+  };
+
+  std::array<Shard, kShardCount> shards_;
+};
+
 /**
  * Returns a string path suitable for use within an APK. The path will look
  * like:
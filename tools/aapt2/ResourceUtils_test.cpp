@@ -228,6 +228,32 @@ TEST(ResourceUtilsTest, ItemsWithWhitespaceAreParsedCorrectly) {
               Pointee(ValueEq(BinaryPrimitive(Res_value::TYPE_FLOAT, expected_float_flattened))));
 }
 
+TEST(ResourceUtilsTest, ItemForAttributeCacheParsesLikeUncached) {
+  ResourceUtils::ItemForAttributeCache cache;
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(cache.TryParseItemForAttribute("12", ResTable_map::TYPE_INTEGER),
+                Pointee(ValueEq(BinaryPrimitive(Res_value::TYPE_INT_DEC, 12u))));
+    // The same string, cached for another type mask.
+    EXPECT_THAT(cache.TryParseItemForAttribute("12", ResTable_map::TYPE_STRING), Eq(nullptr));
+
+    std::unique_ptr<Item> item =
+        cache.TryParseItemForAttribute("@string/foo", ResTable_map::TYPE_REFERENCE);
+    Reference* ref = ValueCast<Reference>(item.get());
+    ASSERT_THAT(ref, NotNull());
+    EXPECT_THAT(ref->name, Eq(test::ParseNameOrDie("string/foo")));
+    EXPECT_THAT(ref->type_flags, Eq(std::optional<uint32_t>(ResTable_map::TYPE_REFERENCE)));
+  }
+
+  std::unique_ptr<Attribute> attr = test::AttributeBuilder()
+                                        .SetTypeMask(ResTable_map::TYPE_ENUM)
+                                        .AddItem("foo", 1u)
+                                        .Build();
+  std::unique_ptr<Item> item = cache.TryParseItemForAttribute("foo", attr.get());
+  BinaryPrimitive* symbol = ValueCast<BinaryPrimitive>(item.get());
+  ASSERT_THAT(symbol, NotNull());
+  EXPECT_THAT(symbol->value.data, Eq(1u));
+}
+
 TEST(ResourceUtilsTest, ParseSdkVersionWithCodename) {
   EXPECT_THAT(ResourceUtils::ParseSdkVersion("Q"), Eq(std::optional<int>(10000)));
   EXPECT_THAT(ResourceUtils::ParseSdkVersion("Q.fingerprint"), Eq(std::optional<int>(10000)));
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput and peak memory of aapt2 compile, link and optimize on generated apps.
+//
+// Every benchmark takes the shape of the app and the number of jobs as arguments:
+//   values, layouts, drawables, locales, overlays, jobs
+// Each command runs in a child process, and the peak_rss_kb counter is the largest resident set
+// size any run of it reached.
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "android-base/file.h"
+#include "android-base/stringprintf.h"
+#include "benchmark/benchmark.h"
+
+#include "Diagnostics.h"
+#include "benchmarks/SyntheticApp.h"
+#include "cmd/Command.h"
+#include "cmd/Compile.h"
+#include "cmd/Link.h"
+#include "cmd/Optimize.h"
+#include "util/Files.h"
+
+using android::base::StringPrintf;
+
+namespace aapt {
+namespace bench {
+
+// Runs the command in a child process, so that the memory it uses is measured on its own and not
+// mixed with that of earlier runs. Returns false if the command failed.
+static bool RunCommand(Command* command, const std::vector<std::string>& args,
+                       long* out_peak_rss_kb) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    std::vector<android::StringPiece> command_args(args.begin(), args.end());
+    _exit(command->Execute(command_args, &std::cerr));
+  }
+  if (pid < 0) {
+    return false;
+  }
+  int status = 0;
+  struct rusage usage = {};
+  if (wait4(pid, &status, 0, &usage) != pid) {
+    return false;
+  }
+  *out_peak_rss_kb = std::max(*out_peak_rss_kb, static_cast<long>(usage.ru_maxrss));
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// A generated app in a temporary directory, which is removed with it.
+class AppFixture {
+ public:
+  explicit AppFixture(const benchmark::State& state) {
+    options_.values = state.range(0);
+    options_.layouts = state.range(1);
+    options_.drawables = state.range(2);
+    options_.locales = state.range(3);
+    options_.overlays = state.range(4);
+    jobs_ = std::to_string(state.range(5));
+    valid_ = GenerateSyntheticApp(dir_.path, options_, &app_);
+  }
+
+  ~AppFixture() {
+    std::error_code error;
+    std::filesystem::remove_all(dir_.path, error);
+  }
+
+  bool valid() const {
+    return valid_;
+  }
+
+  // The number of resource files of the app, base and overlays together.
+  int64_t FileCount() const {
+    const size_t values_files = (options_.values + 99) / 100;
+    return 1 + values_files * (options_.locales + 2) + options_.layouts +
+           options_.drawables + options_.overlays * (1 + options_.layouts / 10);
+  }
+
+  std::string GetPath(const std::string& name) const {
+    return file::BuildPath({dir_.path, name});
+  }
+
+  std::string OverlayFlata(size_t overlay) const {
+    return GetPath(StringPrintf("overlay_%zu.flata", overlay));
+  }
+
+  bool Compile(long* peak_rss_kb) const {
+    StdErrDiagnostics diag;
+    CompileCommand base(&diag);
+    if (!RunCommand(&base, {"--dir", app_.res_dir, "-o", GetPath("res.flata"), "-j", jobs_},
+                    peak_rss_kb)) {
+      return false;
+    }
+    for (size_t i = 0; i < app_.overlay_dirs.size(); i++) {
+      CompileCommand overlay(&diag);
+      if (!RunCommand(&overlay,
+                      {"--dir", app_.overlay_dirs[i], "-o", OverlayFlata(i), "-j", jobs_},
+                      peak_rss_kb)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Link(long* peak_rss_kb) const {
+    std::vector<std::string> args = {"--manifest", app_.manifest, "-o", GetPath("app.apk"),
+                                     "-j", jobs_, GetPath("res.flata")};
+    for (size_t i = 0; i < app_.overlay_dirs.size(); i++) {
+      args.insert(args.end(), {"-R", OverlayFlata(i)});
+    }
+    StdErrDiagnostics diag;
+    LinkCommand command(&diag);
+    return RunCommand(&command, args, peak_rss_kb);
+  }
+
+  bool Optimize(long* peak_rss_kb) const {
+    OptimizeCommand command;
+    return RunCommand(&command, {"-o", GetPath("optimized.apk"), "-j", jobs_, GetPath("app.apk")},
+                      peak_rss_kb);
+  }
+
+ private:
+  TemporaryDir dir_;
+  SyntheticAppOptions options_;
+  SyntheticApp app_;
+  std::string jobs_;
+  bool valid_ = false;
+};
+
+static void ReportCounters(benchmark::State& state, const AppFixture& app, long peak_rss_kb) {
+  state.counters["files"] = benchmark::Counter(app.FileCount() * state.iterations(),
+                                               benchmark::Counter::kIsRate);
+  state.counters["peak_rss_kb"] = peak_rss_kb;
+}
+
+void BM_Compile(benchmark::State& state) {
+  AppFixture app(state);
+  if (!app.valid()) {
+    state.SkipWithError("Failed to generate the app");
+    return;
+  }
+  long peak_rss_kb = 0;
+  for (auto _ : state) {
+    if (!app.Compile(&peak_rss_kb)) {
+      state.SkipWithError("Failed to compile the app");
+      return;
+    }
+  }
+  ReportCounters(state, app, peak_rss_kb);
+}
+
+void BM_Link(benchmark::State& state) {
+  AppFixture app(state);
+  long unused = 0;
+  if (!app.valid() || !app.Compile(&unused)) {
+    state.SkipWithError("Failed to compile the app");
+    return;
+  }
+  long peak_rss_kb = 0;
+  for (auto _ : state) {
+    if (!app.Link(&peak_rss_kb)) {
+      state.SkipWithError("Failed to link the app");
+      return;
+    }
+  }
+  ReportCounters(state, app, peak_rss_kb);
+}
+
+void BM_Optimize(benchmark::State& state) {
+  AppFixture app(state);
+  long unused = 0;
+  if (!app.valid() || !app.Compile(&unused) || !app.Link(&unused)) {
+    state.SkipWithError("Failed to build the app");
+    return;
+  }
+  long peak_rss_kb = 0;
+  for (auto _ : state) {
+    if (!app.Optimize(&peak_rss_kb)) {
+      state.SkipWithError("Failed to optimize the app");
+      return;
+    }
+  }
+  ReportCounters(state, app, peak_rss_kb);
+}
+
+// A small app, a large one, the large one with many locales and overlays, and the latter again
+// on several jobs.
+static void AppShapes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"values", "layouts", "drawables", "locales", "overlays", "jobs"});
+  benchmark->Args({500, 50, 50, 0, 0, 1});
+  benchmark->Args({5000, 1000, 1000, 0, 0, 1});
+  benchmark->Args({5000, 1000, 1000, 40, 2, 1});
+  benchmark->Args({5000, 1000, 1000, 40, 2, 8});
+  benchmark->Unit(benchmark::kMillisecond);
+  benchmark->UseRealTime();
+}
+
+BENCHMARK(BM_Compile)->Apply(AppShapes);
+BENCHMARK(BM_Link)->Apply(AppShapes);
+BENCHMARK(BM_Optimize)->Apply(AppShapes);
+
+}  // namespace bench
+}  // namespace aapt
+
+BENCHMARK_MAIN();
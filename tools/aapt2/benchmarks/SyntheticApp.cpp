@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmarks/SyntheticApp.h"
+
+#include <algorithm>
+
+#include "android-base/file.h"
+#include "android-base/stringprintf.h"
+#include "util/Files.h"
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+
+namespace aapt {
+namespace bench {
+
+// Values of each type per values file.
+constexpr size_t kValuesPerFile = 100;
+
+static bool WriteResFile(const std::string& res_dir, const std::string& type_dir,
+                         const std::string& name, const std::string& contents) {
+  const std::string dir = file::BuildPath({res_dir, type_dir});
+  return file::mkdirs(dir) &&
+         android::base::WriteStringToFile(contents, file::BuildPath({dir, name}));
+}
+
+// Two letter language codes, which are all valid locale qualifiers.
+static std::string LocaleQualifier(size_t i) {
+  return {static_cast<char>('a' + (i / 26) % 26), static_cast<char>('a' + i % 26)};
+}
+
+static std::string StringsFile(size_t first, size_t last, const std::string& text) {
+  std::string contents = "<resources>\n";
+  for (size_t i = first; i < last; i++) {
+    StringAppendF(&contents, "  <string name=\"string_%zu\">%s %zu</string>\n", i, text.c_str(),
+                  i);
+  }
+  contents += "</resources>\n";
+  return contents;
+}
+
+static std::string ValuesFile(size_t first, size_t last) {
+  std::string contents = "<resources>\n";
+  for (size_t i = first; i < last; i++) {
+    StringAppendF(&contents, "  <dimen name=\"dimen_%zu\">%zudp</dimen>\n", i, i % 64);
+    StringAppendF(&contents, "  <color name=\"color_%zu\">#ff%06zx</color>\n", i,
+                  (i * 2654435761u) & 0xffffff);
+    StringAppendF(&contents, "  <integer name=\"integer_%zu\">%zu</integer>\n", i, i);
+  }
+  contents += "</resources>\n";
+  return contents;
+}
+
+// The attributes used by layouts and drawables, so that the app links without a framework jar.
+static const char* kAttrsFile = R"(<resources>
+  <attr name="label" format="string|reference" />
+  <attr name="size" format="dimension|reference" />
+  <attr name="tint" format="color|reference" />
+  <attr name="icon" format="reference" />
+  <attr name="count" format="integer|reference" />
+  <attr name="gravity">
+    <flag name="top" value="0x30" />
+    <flag name="bottom" value="0x50" />
+    <flag name="center" value="0x11" />
+  </attr>
+</resources>
+)";
+
+static std::string LayoutFile(size_t index, const SyntheticAppOptions& options) {
+  const size_t values = std::max<size_t>(options.values, 1);
+  std::string contents = "<Frame xmlns:app=\"http://schemas.android.com/apk/res-auto\">\n";
+  for (size_t i = 0; i < 10; i++) {
+    const size_t value = (index * 10 + i) % values;
+    StringAppendF(&contents,
+                  "  <Label app:label=\"@string/string_%zu\" app:size=\"@dimen/dimen_%zu\"\n"
+                  "      app:tint=\"@color/color_%zu\" app:count=\"%zu\" "
+                  "app:gravity=\"top|center\"",
+                  value, value, value, i);
+    if (options.drawables > 0) {
+      StringAppendF(&contents, " app:icon=\"@drawable/drawable_%zu\"",
+                    (index * 10 + i) % options.drawables);
+    }
+    contents += " />\n";
+  }
+  contents += "</Frame>\n";
+  return contents;
+}
+
+static std::string DrawableFile(size_t index, size_t values) {
+  return StringPrintf(
+      "<vector xmlns:app=\"http://schemas.android.com/apk/res-auto\" app:size=\"24dp\">\n"
+      "  <path app:tint=\"@color/color_%zu\" app:label=\"M%zu,0 L24,%zu L0,24 Z\" />\n"
+      "</vector>\n",
+      index % std::max<size_t>(values, 1), index % 24, index % 24);
+}
+
+bool GenerateSyntheticApp(const std::string& dir, const SyntheticAppOptions& options,
+                          SyntheticApp* out_app) {
+  out_app->manifest = file::BuildPath({dir, "AndroidManifest.xml"});
+  if (!android::base::WriteStringToFile(
+          "<manifest xmlns:android=\"http://schemas.android.com/apk/res/android\"\n"
+          "    package=\"com.aapt.benchmark\" />\n",
+          out_app->manifest)) {
+    return false;
+  }
+
+  out_app->res_dir = file::BuildPath({dir, "res"});
+  const std::string& res_dir = out_app->res_dir;
+  if (!WriteResFile(res_dir, "values", "attrs.xml", kAttrsFile)) {
+    return false;
+  }
+  for (size_t first = 0; first < options.values; first += kValuesPerFile) {
+    const size_t last = std::min(first + kValuesPerFile, options.values);
+    const std::string name = StringPrintf("values_%zu.xml", first / kValuesPerFile);
+    if (!WriteResFile(res_dir, "values", "strings_" + name, StringsFile(first, last, "String")) ||
+        !WriteResFile(res_dir, "values", name, ValuesFile(first, last))) {
+      return false;
+    }
+    for (size_t locale = 0; locale < options.locales; locale++) {
+      const std::string qualifier = LocaleQualifier(locale);
+      if (!WriteResFile(res_dir, "values-" + qualifier, "strings_" + name,
+                        StringsFile(first, last, "String " + qualifier))) {
+        return false;
+      }
+    }
+  }
+  for (size_t i = 0; i < options.layouts; i++) {
+    if (!WriteResFile(res_dir, "layout", StringPrintf("layout_%zu.xml", i),
+                      LayoutFile(i, options))) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < options.drawables; i++) {
+    if (!WriteResFile(res_dir, "drawable", StringPrintf("drawable_%zu.xml", i),
+                      DrawableFile(i, options.values))) {
+      return false;
+    }
+  }
+
+  out_app->overlay_dirs.clear();
+  for (size_t overlay = 0; overlay < options.overlays; overlay++) {
+    const std::string overlay_dir = file::BuildPath({dir, StringPrintf("overlay_%zu", overlay)});
+    std::string strings = "<resources>\n";
+    for (size_t i = overlay % 10; i < options.values; i += 10) {
+      StringAppendF(&strings, "  <string name=\"string_%zu\">Overlay %zu string %zu</string>\n", i,
+                    overlay, i);
+    }
+    strings += "</resources>\n";
+    if (!WriteResFile(overlay_dir, "values", "strings.xml", strings)) {
+      return false;
+    }
+    for (size_t i = overlay % 10; i < options.layouts; i += 10) {
+      if (!WriteResFile(overlay_dir, "layout", StringPrintf("layout_%zu.xml", i),
+                        LayoutFile(i + overlay + 1, options))) {
+        return false;
+      }
+    }
+    out_app->overlay_dirs.push_back(overlay_dir);
+  }
+  return true;
+}
+
+}  // namespace bench
+}  // namespace aapt
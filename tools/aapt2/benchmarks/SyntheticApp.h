@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_BENCHMARKS_SYNTHETICAPP_H
+#define AAPT_BENCHMARKS_SYNTHETICAPP_H
+
+#include <string>
+#include <vector>
+
+namespace aapt {
+namespace bench {
+
+// The shape of a generated app. The defaults give a small app; the benchmarks scale the counts up.
+struct SyntheticAppOptions {
+  // Number of strings, dimens, colors and integers each, spread over values files of 100 entries.
+  size_t values = 100;
+
+  // Number of layouts. Each one references strings, dimens, colors and drawables of the app.
+  size_t layouts = 10;
+
+  // Number of vector drawables.
+  size_t drawables = 10;
+
+  // Number of locales, besides the default one, that translate every string.
+  size_t locales = 0;
+
+  // Number of overlay resource directories. Each overlay redefines a tenth of the values and
+  // layouts of the base directory.
+  size_t overlays = 0;
+};
+
+// The paths of a generated app.
+struct SyntheticApp {
+  std::string manifest;
+  std::string res_dir;
+  std::vector<std::string> overlay_dirs;
+};
+
+// Writes the manifest and resource directories of an app with the given shape under `dir`, which
+// must exist. Returns false if a file could not be written.
+bool GenerateSyntheticApp(const std::string& dir, const SyntheticAppOptions& options,
+                          SyntheticApp* out_app);
+
+}  // namespace bench
+}  // namespace aapt
+
+#endif  // AAPT_BENCHMARKS_SYNTHETICAPP_H
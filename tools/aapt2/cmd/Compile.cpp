@@ -17,13 +17,27 @@
 #include "Compile.h"
 
 #include <dirent.h>
-
+#include <inttypes.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "ResourceParser.h"
 #include "ResourceTable.h"
+#include "ResourceUtils.h"
 #include "android-base/errors.h"
 #include "android-base/file.h"
+#include "android-base/stringprintf.h"
+#include "android-base/threads.h"
 #include "android-base/utf8.h"
 #include "androidfw/ConfigDescription.h"
 #include "androidfw/IDiagnostics.h"
@@ -513,15 +527,28 @@ static bool CompilePng(IAaptContext* context, const CompileOptions& options,
       }
     }
 
-    // Write the crunched PNG.
-    if (!WritePng(context, image.get(), nine_patch.get(), &crunched_png_buffer_out, {})) {
+    // Write the crunched PNG. Unless this is a 9-patch, the original is used when the crunched
+    // PNG turns out larger, so stop compressing once it is.
+    const size_t original_size = png_chunk_filter.ByteCount();
+    PngOptions png_options;
+    if (nine_patch == nullptr) {
+      png_options.max_size = original_size;
+    }
+    const bool crunched = WritePng(context, image.get(), nine_patch.get(),
+                                   &crunched_png_buffer_out, png_options);
+    if (!crunched && (png_options.max_size == 0 ||
+                      crunched_png_buffer_out.ByteCount() <= png_options.max_size)) {
       return false;
     }
 
-    if (nine_patch != nullptr ||
-        crunched_png_buffer_out.ByteCount() <= png_chunk_filter.ByteCount()) {
+    if (crunched) {
       // No matter what, we must use the re-encoded PNG, even if it is larger.
       // 9-patch images must be re-encoded since their borders are stripped.
+      if (context->IsVerbose()) {
+        context->GetDiagnostics()->Note(android::DiagMessage(path_data.source)
+                                        << "crunched PNG from " << original_size << " to "
+                                        << crunched_png_buffer_out.ByteCount() << " bytes");
+      }
       buffer.AppendBuffer(std::move(crunched_png_buffer));
     } else {
       // The re-encoded PNG is larger than the original, and there is
@@ -529,7 +556,9 @@ static bool CompilePng(IAaptContext* context, const CompileOptions& options,
       if (context->IsVerbose()) {
         context->GetDiagnostics()->Note(android::DiagMessage(path_data.source)
                                         << "original PNG is smaller than crunched PNG"
-                                        << ", using original");
+                                        << ", using original (stopped crunching at "
+                                        << crunched_png_buffer_out.ByteCount() << " of "
+                                        << original_size << " bytes)");
       }
 
       png_chunk_filter.Rewind();
@@ -643,11 +672,277 @@ class CompileContext : public IAaptContext {
   bool verbose_ = false;
 };
 
+// Keeps the entries written to it in memory, so that a file compiled on a worker thread can be
+// written to the real archive once the files before it are done.
+class BufferedArchiveWriter : public IArchiveWriter {
+ public:
+  BufferedArchiveWriter() = default;
+
+  bool WriteFile(StringPiece path, uint32_t flags, io::InputStream* in) override {
+    if (!StartEntry(path, flags)) {
+      return false;
+    }
+
+    const void* data = nullptr;
+    size_t len = 0;
+    while (in->Next(&data, &len)) {
+      if (!Write(data, static_cast<int>(len))) {
+        return false;
+      }
+    }
+
+    if (in->HadError()) {
+      error_ = in->GetError();
+      return false;
+    }
+
+    return FinishEntry();
+  }
+
+  bool StartEntry(StringPiece path, uint32_t flags) override {
+    if (in_entry_) {
+      error_ = "already writing an entry";
+      return false;
+    }
+    entries_.push_back(Entry{std::string(path), flags, {}});
+    in_entry_ = true;
+    return true;
+  }
+
+  bool Write(const void* data, int len) override {
+    if (!in_entry_) {
+      error_ = "not writing an entry";
+      return false;
+    }
+    entries_.back().data.append(static_cast<const char*>(data), len);
+    return true;
+  }
+
+  bool FinishEntry() override {
+    if (!in_entry_) {
+      error_ = "not writing an entry";
+      return false;
+    }
+    in_entry_ = false;
+    return true;
+  }
+
+  bool HadError() const override {
+    return !error_.empty();
+  }
+
+  std::string GetError() const override {
+    return error_;
+  }
+
+  // Returns the data of the entry at `path`, or nullptr if there is none.
+  const std::string* FindEntry(StringPiece path) const {
+    for (const Entry& entry : entries_) {
+      if (entry.path == path) {
+        return &entry.data;
+      }
+    }
+    return nullptr;
+  }
+
+  // Writes the entries to `writer` in the order they were started, and drops them.
+  bool WriteTo(IArchiveWriter* writer) {
+    bool result = true;
+    for (const Entry& entry : entries_) {
+      io::StringInputStream in(entry.data);
+      if (!writer->WriteFile(entry.path, entry.flags, &in)) {
+        result = false;
+        break;
+      }
+    }
+    entries_.clear();
+    return result;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BufferedArchiveWriter);
+
+  struct Entry {
+    std::string path;
+    uint32_t flags;
+    std::string data;
+  };
+
+  std::vector<Entry> entries_;
+  bool in_entry_ = false;
+  std::string error_;
+};
+
+using CompileFunc = decltype(&CompileFile);
+
+struct CompileJob {
+  io::IFile* file;
+  ResourcePathData path_data;
+  CompileFunc compile_func;
+  std::string out_path;
+
+  // Filled in by the worker thread that compiles the file, and emptied once they are written out so
+  // that the compiled files aren't all held in memory until the end.
+  BufferedArchiveWriter writer;
+  BufferedDiagnostics diagnostics;
+  std::promise<bool> result;
+  std::future<bool> result_future;
+};
+
+// Returns where the compiled file is kept in --cache-dir. The name is a hash of the file's contents
+// and of everything else that ends up in the compiled file: the tool version, the options, and the
+// path of the file.
+static std::optional<std::string> GetCachePath(const CompileOptions& options, io::IFile* file,
+                                               const ResourcePathData& path_data,
+                                               const std::string& out_path) {
+  std::unique_ptr<io::IData> data = file->OpenAsData();
+  if (!data) {
+    return {};
+  }
+
+  std::stringstream key;
+  key << util::GetToolFingerprint() << '\0' << path_data.source.path << '\0' << out_path << '\0'
+      << options.source_path.value_or("") << '\0' << options.pseudolocalize
+      << options.no_png_crunch << options.legacy_mode << options.preserve_visibility_of_styleables
+      << (options.visibility ? static_cast<int>(options.visibility.value()) : -1) << '\0';
+  const std::string key_str = key.str();
+
+  // Two independent hashes, so that files only collide when both do.
+  uint64_t fnv = 0xcbf29ce484222325ull;
+  auto fnv_update = [&fnv](const void* bytes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      fnv = (fnv ^ static_cast<const uint8_t*>(bytes)[i]) * 0x100000001b3ull;
+    }
+  };
+  fnv_update(key_str.data(), key_str.size());
+  fnv_update(data->data(), data->size());
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32_z(crc, reinterpret_cast<const Bytef*>(key_str.data()), key_str.size());
+  crc = crc32_z(crc, static_cast<const Bytef*>(data->data()), data->size());
+
+  std::string path = options.cache_dir.value();
+  file::AppendPath(&path, android::base::StringPrintf("%016" PRIx64 "%08lx-%zu.flat", fnv,
+                                                      static_cast<unsigned long>(crc),
+                                                      data->size()));
+  return path;
+}
+
+// Puts the compiled file in the cache. The file is written under a temporary name first, so that
+// a concurrent compile never reads a partial one.
+static void WriteToCache(IAaptContext* context, const std::string& cache_path,
+                         const std::string& data) {
+  const std::string tmp_path =
+      android::base::StringPrintf("%s.%d.%" PRIu64 ".tmp", cache_path.c_str(), getpid(),
+                                  android::base::GetThreadId());
+  if (!android::base::WriteStringToFile(data, tmp_path) ||
+      rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    ::android::base::utf8::unlink(tmp_path.c_str());
+    context->GetDiagnostics()->Warn(android::DiagMessage(cache_path)
+                                    << "failed to write to the cache");
+  }
+}
+
+static bool RunCompileJob(IAaptContext* context, const CompileOptions& options,
+                          io::IFile* file, const ResourcePathData& path_data,
+                          CompileFunc compile_func, IArchiveWriter* writer,
+                          const std::string& out_path) {
+  // The text symbols file is a second output that the cache doesn't keep.
+  std::optional<std::string> cache_path;
+  if (options.cache_dir && !options.generate_text_symbols_path) {
+    cache_path = GetCachePath(options, file, path_data, out_path);
+  }
+
+  if (cache_path) {
+    std::string cached;
+    if (android::base::ReadFileToString(cache_path.value(), &cached)) {
+      if (context->IsVerbose()) {
+        context->GetDiagnostics()->Note(android::DiagMessage(path_data.source)
+                                        << "using cached " << cache_path.value());
+      }
+      io::StringInputStream in(cached);
+      if (!writer->WriteFile(out_path, 0, &in)) {
+        context->GetDiagnostics()->Error(android::DiagMessage(out_path)
+                                         << "failed to write: " << writer->GetError());
+        return false;
+      }
+      return true;
+    }
+  }
+
+  BufferedArchiveWriter buffered_writer;
+  if (!compile_func(context, options, path_data, file,
+                    cache_path ? &buffered_writer : writer, out_path)) {
+    context->GetDiagnostics()->Error(android::DiagMessage(file->GetSource())
+                                     << "file failed to compile");
+    return false;
+  }
+
+  if (cache_path) {
+    if (const std::string* data = buffered_writer.FindEntry(out_path)) {
+      WriteToCache(context, cache_path.value(), *data);
+    }
+    if (!buffered_writer.WriteTo(writer)) {
+      context->GetDiagnostics()->Error(android::DiagMessage(out_path)
+                                       << "failed to write: " << writer->GetError());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compiles the jobs on `options.jobs` threads, and writes out their entries and diagnostics in
+// order as soon as all the jobs before them are done.
+static bool RunCompileJobs(IAaptContext* context, const CompileOptions& options,
+                           std::vector<std::unique_ptr<CompileJob>>& jobs,
+                           IArchiveWriter* output_writer) {
+  for (std::unique_ptr<CompileJob>& job : jobs) {
+    job->result_future = job->result.get_future();
+  }
+
+  std::atomic<size_t> next_job = 0;
+  auto worker = [&]() {
+    for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+      CompileJob& job = *jobs[i];
+      JobContext job_context(context, &job.diagnostics);
+      job.result.set_value(RunCompileJob(&job_context, options, job.file, job.path_data,
+                                         job.compile_func, &job.writer, job.out_path));
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t thread_count = std::min(options.jobs, jobs.size());
+  for (size_t i = 0; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+
+  bool error = false;
+  for (std::unique_ptr<CompileJob>& job : jobs) {
+    const bool compiled = job->result_future.get();
+    job->diagnostics.WriteTo(context->GetDiagnostics());
+    if (compiled && !job->writer.WriteTo(output_writer)) {
+      context->GetDiagnostics()->Error(android::DiagMessage(job->out_path)
+                                       << "failed to write: " << output_writer->GetError());
+      error = true;
+    }
+    error |= !compiled;
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return !error;
+}
+
 int Compile(IAaptContext* context, io::IFileCollection* inputs, IArchiveWriter* output_writer,
              CompileOptions& options) {
   TRACE_CALL();
   bool error = false;
 
+  // Every input writes the same text symbols file, which only works one at a time.
+  const bool parallel = options.jobs > 1 && !options.generate_text_symbols_path;
+  std::vector<std::unique_ptr<CompileJob>> jobs;
+
   // Iterate over the input files in a stable, platform-independent manner
   auto file_iterator  = inputs->Iterator();
   while (file_iterator->HasNext()) {
@@ -711,19 +1006,26 @@ int Compile(IAaptContext* context, io::IFileCollection* inputs, IArchiveWriter*
       continue;
     }
 
-    const std::string out_path = BuildIntermediateContainerFilename(path_data);
-    if (!compile_func(context, options, path_data, file, output_writer, out_path)) {
-      context->GetDiagnostics()->Error(android::DiagMessage(file->GetSource())
-                                       << "file failed to compile");
+    std::string out_path = BuildIntermediateContainerFilename(path_data);
+    if (parallel) {
+      jobs.push_back(std::unique_ptr<CompileJob>(
+          new CompileJob{file, std::move(path_data), compile_func, std::move(out_path)}));
+    } else if (!RunCompileJob(context, options, file, path_data, compile_func, output_writer,
+                              out_path)) {
       error = true;
     }
   }
 
+  if (!jobs.empty() && !RunCompileJobs(context, options, jobs, output_writer)) {
+    error = true;
+  }
+
   return error ? 1 : 0;
 }
 
 int CompileCommand::Action(const std::vector<std::string>& args) {
-  TRACE_FLUSH(trace_folder_? trace_folder_.value() : "", "CompileCommand::Action");
+  TRACE_FLUSH_PROFILE(trace_folder_? trace_folder_.value() : "",
+                      profile_path_ ? profile_path_.value() : "", "CompileCommand::Action");
   CompileContext context(diagnostic_);
   context.SetVerbose(options_.verbose);
 
@@ -743,6 +1045,23 @@ int CompileCommand::Action(const std::vector<std::string>& args) {
     }
   }
 
+  if (jobs_) {
+    const std::optional<uint32_t> maybe_jobs = ResourceUtils::ParseInt(jobs_.value());
+    if (!maybe_jobs || maybe_jobs.value() == 0) {
+      context.GetDiagnostics()->Error(android::DiagMessage()
+                                      << "-j '" << jobs_.value()
+                                      << "' is not a valid number of jobs");
+      return 1;
+    }
+    options_.jobs = maybe_jobs.value();
+  }
+
+  if (options_.cache_dir && !file::mkdirs(options_.cache_dir.value())) {
+    context.GetDiagnostics()->Error(android::DiagMessage(options_.cache_dir.value())
+                                    << "failed to create the cache directory");
+    return 1;
+  }
+
   std::unique_ptr<io::IFileCollection> file_collection;
 
   // Collect the resources files to compile
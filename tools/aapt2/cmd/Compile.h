@@ -42,6 +42,11 @@ struct CompileOptions {
   // See comments on aapt::ResourceParserOptions.
   bool preserve_visibility_of_styleables = false;
   bool verbose = false;
+  // Number of files compiled at the same time. The archive entries and diagnostics are written in
+  // input order regardless.
+  size_t jobs = 1;
+  // Directory of previously compiled files to reuse when the input and options haven't changed.
+  std::optional<std::string> cache_dir;
 };
 
 /** Parses flags and compiles resources to be used in linking.  */
@@ -71,8 +76,20 @@ class CompileCommand : public Command {
         "Sets the visibility of the compiled resources to the specified\n"
             "level. Accepted levels: public, private, default", &visibility_);
     AddOptionalSwitch("-v", "Enables verbose logging", &options_.verbose);
+    AddOptionalFlag("-j",
+        "Number of files to compile in parallel. The output is the same\n"
+            "as when compiling them one at a time.", &jobs_);
+    AddOptionalFlag("--cache-dir",
+        "Directory in which to keep compiled files, and from which to reuse\n"
+            "them when the file, its path and the options are unchanged.\n"
+            "Warnings of reused files are not printed again.",
+        &options_.cache_dir, Command::kPath);
     AddOptionalFlag("--trace-folder", "Generate systrace json trace fragment to specified folder.",
                     &trace_folder_);
+    AddOptionalFlag("--profile",
+                    "Writes how much time and memory each phase took to the given file as JSON,\n"
+                    "or prints it when the file is '-'.",
+                    &profile_path_);
     AddOptionalFlag("--source-path",
                       "Sets the compiled resource file source file path to the given string.",
                       &options_.source_path);
@@ -84,7 +101,9 @@ class CompileCommand : public Command {
   android::IDiagnostics* diagnostic_;
   CompileOptions options_;
   std::optional<std::string> visibility_;
+  std::optional<std::string> jobs_;
   std::optional<std::string> trace_folder_;
+  std::optional<std::string> profile_path_;
 };
 
 int Compile(IAaptContext* context, io::IFileCollection* inputs, IArchiveWriter* output_writer,
@@ -139,6 +139,90 @@ TEST_F(CompilerTest, DirInput) {
   ASSERT_EQ(::android::base::utf8::unlink(kOutputFlata.c_str()), 0);
 }
 
+TEST_F(CompilerTest, DirInputParallel) {
+  StdErrDiagnostics diag;
+  const std::string kResDir = BuildPath({android::base::Dirname(android::base::GetExecutablePath()),
+                                         "integration-tests", "CompileTest", "DirInput", "res"});
+  const std::string kSerialFlata = BuildPath({testing::TempDir(), "serial.flata"});
+  const std::string kParallelFlata = BuildPath({testing::TempDir(), "parallel.flata"});
+  ::android::base::utf8::unlink(kSerialFlata.c_str());
+  ::android::base::utf8::unlink(kParallelFlata.c_str());
+
+  ASSERT_EQ(CompileCommand(&diag).Execute({"--dir", kResDir, "-o", kSerialFlata}, &std::cerr), 0);
+  ASSERT_EQ(CompileCommand(&diag).Execute({"--dir", kResDir, "-o", kParallelFlata, "-j", "4"},
+                                          &std::cerr),
+            0);
+
+  // The entries are written in input order, so the archives are the same byte for byte.
+  std::string serial;
+  std::string parallel;
+  ASSERT_TRUE(android::base::ReadFileToString(kSerialFlata, &serial));
+  ASSERT_TRUE(android::base::ReadFileToString(kParallelFlata, &parallel));
+  EXPECT_EQ(serial, parallel);
+
+  ASSERT_EQ(::android::base::utf8::unlink(kSerialFlata.c_str()), 0);
+  ASSERT_EQ(::android::base::utf8::unlink(kParallelFlata.c_str()), 0);
+}
+
+TEST_F(CompilerTest, InvalidJobs) {
+  StdErrDiagnostics diag;
+  const std::string kResDir = BuildPath({android::base::Dirname(android::base::GetExecutablePath()),
+                                         "integration-tests", "CompileTest", "DirInput", "res"});
+  const std::string kOutputFlata = BuildPath({testing::TempDir(), "compiled.flata"});
+  ASSERT_NE(CompileCommand(&diag).Execute({"--dir", kResDir, "-o", kOutputFlata, "-j", "0"},
+                                          &std::cerr),
+            0);
+}
+
+TEST_F(CompilerTest, CacheDir) {
+  StdErrDiagnostics diag;
+  const std::string kResDir = BuildPath({android::base::Dirname(android::base::GetExecutablePath()),
+                                         "integration-tests", "CompileTest", "DirInput", "res"});
+  const std::string kCacheDir = BuildPath({testing::TempDir(), "compile_cache"});
+  const std::string kFirstFlata = BuildPath({testing::TempDir(), "first.flata"});
+  const std::string kSecondFlata = BuildPath({testing::TempDir(), "second.flata"});
+  ::android::base::utf8::unlink(kFirstFlata.c_str());
+  ::android::base::utf8::unlink(kSecondFlata.c_str());
+
+  ASSERT_EQ(CompileCommand(&diag).Execute(
+                {"--dir", kResDir, "-o", kFirstFlata, "--cache-dir", kCacheDir}, &std::cerr),
+            0);
+  auto cached = file::FindFiles(kCacheDir, &diag);
+  ASSERT_TRUE(cached);
+  const size_t cached_count = cached->size();
+  EXPECT_EQ(cached_count, 3u);
+
+  // Nothing changed, so every file comes from the cache and the output is the same.
+  ASSERT_EQ(CompileCommand(&diag).Execute(
+                {"--dir", kResDir, "-o", kSecondFlata, "--cache-dir", kCacheDir}, &std::cerr),
+            0);
+  cached = file::FindFiles(kCacheDir, &diag);
+  ASSERT_TRUE(cached);
+  EXPECT_EQ(cached->size(), cached_count);
+
+  std::string first;
+  std::string second;
+  ASSERT_TRUE(android::base::ReadFileToString(kFirstFlata, &first));
+  ASSERT_TRUE(android::base::ReadFileToString(kSecondFlata, &second));
+  EXPECT_EQ(first, second);
+
+  // Different options don't reuse the files compiled without them.
+  ::android::base::utf8::unlink(kSecondFlata.c_str());
+  ASSERT_EQ(CompileCommand(&diag).Execute(
+                {"--dir", kResDir, "-o", kSecondFlata, "--cache-dir", kCacheDir, "--legacy"},
+                &std::cerr),
+            0);
+  cached = file::FindFiles(kCacheDir, &diag);
+  ASSERT_TRUE(cached);
+  EXPECT_EQ(cached->size(), 2 * cached_count);
+
+  for (const std::string& name : cached.value()) {
+    ::android::base::utf8::unlink(BuildPath({kCacheDir, name}).c_str());
+  }
+  ASSERT_EQ(::android::base::utf8::unlink(kFirstFlata.c_str()), 0);
+  ASSERT_EQ(::android::base::utf8::unlink(kSecondFlata.c_str()), 0);
+}
+
 TEST_F(CompilerTest, ZipInput) {
   StdErrDiagnostics diag;
   std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
@@ -73,7 +73,9 @@ class DumpApkCommand : public Command {
 
     bool error = false;
     for (auto apk : args) {
-      auto loaded_apk = LoadedApk::LoadApkFromPath(apk, diag_);
+      // Most dumps only look at the manifest, which is small compared to the resource table of a
+      // large bundle. The dumps that do need the table retrieve it on demand.
+      auto loaded_apk = LoadedApk::LoadApkFromPath(apk, diag_, true /* lazy_table */);
       if (!loaded_apk) {
         error = true;
         continue;
@@ -125,4 +125,26 @@ TEST_F(DumpTest, DumpBadgingApkBuiltWithAaptAndTagsInWrongPlace) {
   ASSERT_EQ(output, expected);
 }
 
+TEST_F(DumpTest, LazyProtoTableIsLoadedOnDemand) {
+  StdErrDiagnostics diag;
+  const std::string compiled_files_dir = GetTestPath("compiled");
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/values.xml"),
+                          R"(<resources><string name="hello">Hello</string></resources>)",
+                          compiled_files_dir, &diag));
+
+  const std::string out_apk = GetTestPath("out.apk");
+  std::vector<std::string> link_args = {"--manifest", GetDefaultManifest(), "-o", out_apk,
+                                        "--proto-format"};
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+
+  auto loaded_apk = LoadedApk::LoadApkFromPath(out_apk, &diag, true /* lazy_table */);
+  ASSERT_THAT(loaded_apk, Ne(nullptr));
+  ASSERT_THAT(loaded_apk->GetManifest(), Ne(nullptr));
+
+  ResourceTable* table = loaded_apk->GetResourceTable();
+  ASSERT_THAT(table, Ne(nullptr));
+  EXPECT_THAT(test::GetValue<String>(table, "com.aapt.command.test:string/hello"), Ne(nullptr));
+  EXPECT_THAT(loaded_apk->GetResourceTable(), Eq(table));
+}
+
 }  // namespace aapt
@@ -19,8 +19,14 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <mutex>
 #include <queue>
+#include <set>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -35,6 +41,7 @@
 #include "android-base/expected.h"
 #include "android-base/file.h"
 #include "android-base/stringprintf.h"
+#include "android-base/utf8.h"
 #include "androidfw/IDiagnostics.h"
 #include "androidfw/Locale.h"
 #include "androidfw/StringPiece.h"
@@ -51,6 +58,7 @@
 #include "io/BigBufferStream.h"
 #include "io/FileStream.h"
 #include "io/FileSystem.h"
+#include "io/StringStream.h"
 #include "io/Util.h"
 #include "io/ZipArchive.h"
 #include "java/JavaClassGenerator.h"
@@ -302,6 +310,7 @@ struct ResourceFileFlattenerOptions {
   OutputFormat output_format = OutputFormat::kApk;
   std::unordered_set<std::string> extensions_to_not_compress;
   std::optional<std::regex> regex_to_not_compress;
+  size_t jobs = 1;
 };
 
 // A sampling of public framework resource IDs.
@@ -368,14 +377,26 @@ class ResourceFileFlattener {
 
     // The destination to write this file to.
     std::string dst_path;
+
+    // The XML after linking and versioning, if it was linked ahead of time on a worker thread,
+    // along with the messages logged while linking it.
+    std::optional<std::vector<std::unique_ptr<xml::XmlResource>>> versioned_docs;
+    std::unique_ptr<BufferedDiagnostics> link_diagnostics;
   };
 
-  std::vector<std::unique_ptr<xml::XmlResource>> LinkAndVersionXmlFile(ResourceTable* table,
+  std::vector<std::unique_ptr<xml::XmlResource>> LinkAndVersionXmlFile(IAaptContext* context,
+                                                                       ResourceTable* table,
                                                                        FileOperation* file_op);
 
+  // Links and versions the XML of the file operations on options_.jobs threads.
+  void LinkXmlFilesInParallel(ResourceTable* table, const std::vector<FileOperation*>& file_ops);
+
   ResourceFileFlattenerOptions options_;
   IAaptContext* context_;
   proguard::KeepSet* keep_set_;
+  std::mutex keep_set_lock_;
+  // Shared by the XML files, which may be linked on several threads.
+  ResourceUtils::ItemForAttributeCache item_cache_;
   XmlCompatVersioner::Rules rules_;
 };
 
@@ -428,6 +449,10 @@ ResourceFileFlattener::ResourceFileFlattener(const ResourceFileFlattenerOptions&
   }
 }
 
+static auto kDrawableVersions = std::map<std::string, ApiVersion>{
+    { "adaptive-icon" , SDK_O },
+};
+
 static bool IsTransitionElement(const std::string& name) {
   return name == "fade" || name == "changeBounds" || name == "slide" || name == "explode" ||
          name == "changeImageTransform" || name == "changeTransform" ||
@@ -450,32 +475,48 @@ std::vector<T> make_singleton_vec(T&& val) {
 }
 
 std::vector<std::unique_ptr<xml::XmlResource>> ResourceFileFlattener::LinkAndVersionXmlFile(
-    ResourceTable* table, FileOperation* file_op) {
+    IAaptContext* context, ResourceTable* table, FileOperation* file_op) {
   TRACE_CALL();
   xml::XmlResource* doc = file_op->xml_to_flatten.get();
   const android::Source& src = doc->file.source;
 
-  if (context_->IsVerbose()) {
-    context_->GetDiagnostics()->Note(android::DiagMessage()
-                                     << "linking " << src.path << " (" << doc->file.name << ")");
+  // Check minimum sdk versions supported for drawables
+  auto drawable_entry = kDrawableVersions.find(doc->root->name);
+  if (drawable_entry != kDrawableVersions.end()) {
+    if (drawable_entry->second > context->GetMinSdkVersion()
+        && drawable_entry->second > file_op->config.sdkVersion) {
+      context->GetDiagnostics()->Error(android::DiagMessage(src)
+                                       << "<" << drawable_entry->first << "> elements "
+                                       << "require a sdk version of at least "
+                                       << (int16_t)drawable_entry->second);
+      return {};
+    }
+  }
+
+  if (context->IsVerbose()) {
+    context->GetDiagnostics()->Note(android::DiagMessage()
+                                    << "linking " << src.path << " (" << doc->file.name << ")");
   }
 
   // First, strip out any tools namespace attributes. AAPT stripped them out early, which means
   // that existing projects have out-of-date references which pass compilation.
   xml::StripAndroidStudioAttributes(doc->root.get());
 
-  XmlReferenceLinker xml_linker(table);
-  if (!options_.do_not_fail_on_missing_resources && !xml_linker.Consume(context_, doc)) {
+  XmlReferenceLinker xml_linker(table, &item_cache_);
+  if (!options_.do_not_fail_on_missing_resources && !xml_linker.Consume(context, doc)) {
     return {};
   }
 
-  if (options_.update_proguard_spec && !proguard::CollectProguardRules(context_, doc, keep_set_)) {
-    return {};
+  if (options_.update_proguard_spec) {
+    std::lock_guard<std::mutex> lock(keep_set_lock_);
+    if (!proguard::CollectProguardRules(context, doc, keep_set_)) {
+      return {};
+    }
   }
 
   if (options_.no_xml_namespaces) {
     XmlNamespaceRemover namespace_remover;
-    if (!namespace_remover.Consume(context_, doc)) {
+    if (!namespace_remover.Consume(context, doc)) {
       return {};
     }
   }
@@ -501,7 +542,43 @@ std::vector<std::unique_ptr<xml::XmlResource>> ResourceFileFlattener::LinkAndVer
   XmlCompatVersioner xml_compat_versioner(&rules_);
   const util::Range<ApiVersion> api_range{config.sdkVersion,
                                           FindNextApiVersionForConfig(entry, config)};
-  return xml_compat_versioner.Process(context_, doc, api_range);
+  return xml_compat_versioner.Process(context, doc, api_range);
+}
+
+void ResourceFileFlattener::LinkXmlFilesInParallel(ResourceTable* table,
+                                                   const std::vector<FileOperation*>& file_ops) {
+  TRACE_CALL();
+  std::atomic<size_t> next_op = 0;
+  auto worker = [&]() {
+    for (size_t i = next_op++; i < file_ops.size(); i = next_op++) {
+      FileOperation* file_op = file_ops[i];
+      file_op->link_diagnostics = util::make_unique<BufferedDiagnostics>();
+      JobContext job_context(context_, file_op->link_diagnostics.get());
+      file_op->versioned_docs = LinkAndVersionXmlFile(&job_context, table, file_op);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t thread_count = std::min(options_.jobs, file_ops.size());
+  for (size_t i = 0; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+// Whether the table defines macros. Substituting one adds to the table, so XML that may use them
+// can't be linked concurrently.
+static bool HasMacros(const ResourceTable& table) {
+  for (const auto& package : table.packages) {
+    for (const auto& type : package->types) {
+      if (type->named_type.type == ResourceType::kMacro && !type->entries.empty()) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 ResourceFile::Type XmlFileTypeForOutputFormat(OutputFormat format) {
@@ -515,16 +592,13 @@ ResourceFile::Type XmlFileTypeForOutputFormat(OutputFormat format) {
   return ResourceFile::Type::kUnknown;
 }
 
-static auto kDrawableVersions = std::map<std::string, ApiVersion>{
-    { "adaptive-icon" , SDK_O },
-};
-
 bool ResourceFileFlattener::Flatten(ResourceTable* table, IArchiveWriter* archive_writer) {
   TRACE_CALL();
   bool error = false;
   std::map<std::pair<ConfigDescription, StringPiece>, FileOperation> config_sorted_files;
 
   proguard::CollectResourceReferences(context_, table, keep_set_);
+  const bool link_in_parallel = options_.jobs > 1 && !HasMacros(*table);
 
   for (auto& pkg : table->packages) {
     CHECK(!pkg->name.empty()) << "Packages must have names when being linked";
@@ -612,28 +686,31 @@ bool ResourceFileFlattener::Flatten(ResourceTable* table, IArchiveWriter* archiv
         }
       }
 
+      // Linking reads the table but doesn't change it, so the XML files of this type can be
+      // linked concurrently. Anything that adds to the table happens below, in order.
+      if (link_in_parallel) {
+        std::vector<FileOperation*> xml_file_ops;
+        for (auto& map_entry : config_sorted_files) {
+          if (map_entry.second.xml_to_flatten) {
+            xml_file_ops.push_back(&map_entry.second);
+          }
+        }
+        LinkXmlFilesInParallel(table, xml_file_ops);
+      }
+
       // Now flatten the sorted values.
       for (auto& map_entry : config_sorted_files) {
         const ConfigDescription& config = map_entry.first.first;
         FileOperation& file_op = map_entry.second;
 
-        if (file_op.xml_to_flatten) {
-          // Check minimum sdk versions supported for drawables
-          auto drawable_entry = kDrawableVersions.find(file_op.xml_to_flatten->root->name);
-          if (drawable_entry != kDrawableVersions.end()) {
-            if (drawable_entry->second > context_->GetMinSdkVersion()
-                && drawable_entry->second > config.sdkVersion) {
-              context_->GetDiagnostics()->Error(
-                  android::DiagMessage(file_op.xml_to_flatten->file.source)
-                  << "<" << drawable_entry->first << "> elements "
-                  << "require a sdk version of at least " << (int16_t)drawable_entry->second);
-              error = true;
-              continue;
-            }
-          }
+        if (file_op.link_diagnostics) {
+          file_op.link_diagnostics->WriteTo(context_->GetDiagnostics());
+        }
 
+        if (file_op.versioned_docs || file_op.xml_to_flatten) {
           std::vector<std::unique_ptr<xml::XmlResource>> versioned_docs =
-              LinkAndVersionXmlFile(table, &file_op);
+              file_op.versioned_docs ? std::move(file_op.versioned_docs.value())
+                                     : LinkAndVersionXmlFile(context_, table, &file_op);
           if (versioned_docs.empty()) {
             error = true;
             continue;
@@ -756,6 +833,161 @@ static bool LoadStableIdMap(android::IDiagnostics* diag, const std::string& path
   return true;
 }
 
+static uint64_t HashContents(StringPiece data) {
+  // 64-bit FNV-1a.
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : data) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Reads the compiled file `data` that was read from `path`. If it is a compiled values file, its
+// resource table is returned in `out_table`, which is left empty for any other kind of file.
+static bool LoadValuesTable(IAaptContext* context, const std::string& path,
+                            const std::string& data, std::unique_ptr<ResourceTable>* out_table) {
+  io::StringInputStream input_stream(data);
+  ContainerReader reader(&input_stream);
+  if (reader.HadError()) {
+    context->GetDiagnostics()->Error(android::DiagMessage(path)
+                                     << "failed to read file: " << reader.GetError());
+    return false;
+  }
+
+  std::unique_ptr<ResourceTable> table;
+  ContainerReaderEntry* entry;
+  while ((entry = reader.Next()) != nullptr) {
+    if (entry->Type() != ContainerEntryType::kResTable || table != nullptr) {
+      // Compiled files are merged along with the io::IFile they live in.
+      return true;
+    }
+
+    pb::ResourceTable pb_table;
+    if (!entry->GetResTable(&pb_table)) {
+      context->GetDiagnostics()->Error(android::DiagMessage(path)
+                                       << "failed to read resource table: " << entry->GetError());
+      return false;
+    }
+
+    table = util::make_unique<ResourceTable>();
+    std::string error;
+    if (!DeserializeTableFromPb(pb_table, nullptr /*files*/, table.get(), &error)) {
+      context->GetDiagnostics()->Error(android::DiagMessage(path)
+                                       << "failed to deserialize resource table: " << error);
+      return false;
+    }
+  }
+
+  if (reader.HadError()) {
+    context->GetDiagnostics()->Error(android::DiagMessage(path)
+                                     << "failed to read file: " << reader.GetError());
+    return false;
+  }
+  *out_table = std::move(table);
+  return true;
+}
+
+// The snapshot tracks what each values file defines by key. A value is keyed by the resource it
+// belongs to and its configuration and product, as type/name then config and product on their own
+// lines. The state of an entry that doesn't belong to any value, like the visibility and IDs from
+// <public> and <java-symbol>, is keyed by the bare type/name.
+static std::string ResourceValueKey(const std::string& entry_key,
+                                    const ResourceConfigValue& value) {
+  return entry_key + "\n" + value.config.to_string() + "\n" + value.product;
+}
+
+static std::string EntryKeyOf(const std::string& key) {
+  return key.substr(0, key.find('\n'));
+}
+
+static bool HasEntryState(const ResourceEntry& entry) {
+  return entry.id || entry.visibility.level != Visibility::Level::kUndefined ||
+         entry.allow_new || entry.overlayable_item || entry.staged_id;
+}
+
+// Returns the keys of the resource values and entry state that TableMerger takes from `table`.
+static std::vector<std::string> CollectMergedResourceNames(IAaptContext* context,
+                                                           const ResourceTable& table) {
+  std::vector<std::string> names;
+  for (const auto& package : table.packages) {
+    if (!package->name.empty() && package->name != context->GetCompilationPackage()) {
+      continue;
+    }
+    for (const auto& type : package->types) {
+      for (const auto& entry : type->entries) {
+        const std::string entry_key = type->named_type.to_string() + "/" + entry->name;
+        if (HasEntryState(*entry)) {
+          names.push_back(entry_key);
+        }
+        for (const auto& value : entry->values) {
+          names.push_back(ResourceValueKey(entry_key, *value));
+        }
+      }
+    }
+  }
+  return names;
+}
+
+// Removes the values with the given keys from the entry. Returns whether the entry itself is left
+// to remove, because it has a key of its own among them or nothing is left of it.
+static bool RemoveResourceValues(const std::set<std::string>& names, const std::string& entry_key,
+                                 ResourceEntry* entry) {
+  if (names.count(entry_key) != 0) {
+    return true;
+  }
+  auto& values = entry->values;
+  values.erase(std::remove_if(values.begin(), values.end(),
+                              [&](const std::unique_ptr<ResourceConfigValue>& value) {
+                                return names.count(ResourceValueKey(entry_key, *value)) != 0;
+                              }),
+               values.end());
+  return values.empty() && !HasEntryState(*entry);
+}
+
+// Removes the resource values and entries with the given keys from the table, along with the
+// entries and types they leave empty.
+static void RemoveResources(const std::set<std::string>& names, ResourceTable* table) {
+  for (auto& package : table->packages) {
+    auto& types = package->types;
+    for (auto type_iter = types.begin(); type_iter != types.end();) {
+      const std::string prefix = (*type_iter)->named_type.to_string() + "/";
+      auto& entries = (*type_iter)->entries;
+      auto new_end = std::remove_if(entries.begin(), entries.end(),
+                                    [&](const std::unique_ptr<ResourceEntry>& entry) {
+                                      return RemoveResourceValues(names, prefix + entry->name,
+                                                                  entry.get());
+                                    });
+      if (new_end == entries.begin() && !entries.empty()) {
+        type_iter = types.erase(type_iter);
+        continue;
+      }
+      entries.erase(new_end, entries.end());
+      ++type_iter;
+    }
+  }
+}
+
+// Returns what a snapshot must have been made for to be used by this link.
+static std::string GetSnapshotKey(IAaptContext* context, const TableMergerOptions& options) {
+  return StringPrintf("%s\n%s\nauto_add_overlay=%d strict_visibility=%d override_styles=%d",
+                      util::GetToolFingerprint().c_str(),
+                      context->GetCompilationPackage().c_str(), options.auto_add_overlay,
+                      options.strict_visibility, options.override_styles_instead_of_overlaying);
+}
+
+// Writes the snapshot under a temporary name first, so that an interrupted link never leaves a
+// partial one behind. Failing to write it only costs the next link its head start.
+static void WriteSnapshot(IAaptContext* context, const std::string& path,
+                          const pb::internal::LinkSnapshot& snapshot) {
+  const std::string tmp_path = path + ".tmp";
+  std::string data;
+  if (!snapshot.SerializeToString(&data) || !android::base::WriteStringToFile(data, tmp_path) ||
+      rename(tmp_path.c_str(), path.c_str()) != 0) {
+    ::android::base::utf8::unlink(tmp_path.c_str());
+    context->GetDiagnostics()->Warn(android::DiagMessage(path) << "failed to write snapshot");
+  }
+}
+
 class Linker {
  public:
   Linker(LinkContext* context, const LinkOptions& options)
@@ -1644,7 +1876,7 @@ class Linker {
           return false;
         }
       } else if (entry->Type() == ContainerEntryType::kResFile) {
-        TRACE_NAME(std::string("Process ResFile") + file->GetSource().path);
+        TRACE_NAME(std::string("Process ResFile:") + file->GetSource().path);
         pb::internal::CompiledFile pb_compiled_file;
         off64_t offset;
         size_t len;
@@ -1670,6 +1902,180 @@ class Linker {
     return true;
   }
 
+  // Reads the snapshot written by a previous link, if there is one this link can use.
+  bool LoadSnapshot(const std::string& path, const TableMergerOptions& merger_options,
+                    pb::internal::LinkSnapshot* out_snapshot) {
+    std::string data;
+    if (!android::base::ReadFileToString(path, &data)) {
+      return false;
+    }
+    if (!out_snapshot->ParseFromString(data) ||
+        out_snapshot->key() != GetSnapshotKey(context_, merger_options)) {
+      if (context_->IsVerbose()) {
+        context_->GetDiagnostics()->Note(android::DiagMessage(path) << "ignoring stale snapshot");
+      }
+      return false;
+    }
+    return true;
+  }
+
+  // Merges the input files like MergePath does, except that the compiled values files are merged
+  // into the snapshot of the values merged by the previous link, so that only the values files
+  // that changed since have to be read and merged again. The updated snapshot is saved for the
+  // next link.
+  bool MergeInputsWithSnapshot(const std::vector<std::string>& input_files,
+                               const TableMergerOptions& merger_options) {
+    TRACE_CALL();
+    const std::string& snapshot_path = options_.incremental_snapshot_path.value();
+    pb::internal::LinkSnapshot old_snapshot;
+    bool reuse = LoadSnapshot(snapshot_path, merger_options, &old_snapshot);
+    std::map<std::string, const pb::internal::LinkSnapshot::Input*> old_inputs;
+    if (reuse) {
+      for (const auto& input : old_snapshot.input()) {
+        old_inputs[input.path()] = &input;
+      }
+    }
+
+    pb::internal::LinkSnapshot new_snapshot;
+    new_snapshot.set_key(GetSnapshotKey(context_, merger_options));
+    // The values files that need merging, by their index in new_snapshot.
+    std::map<int, std::unique_ptr<ResourceTable>> tables_to_merge;
+    std::set<std::string> unchanged_paths;
+    std::vector<std::string> other_inputs;
+    for (const std::string& path : input_files) {
+      if (!util::EndsWith(path, ".flat")) {
+        other_inputs.push_back(path);
+        continue;
+      }
+
+      std::string data;
+      if (!android::base::ReadFileToString(path, &data)) {
+        context_->GetDiagnostics()->Error(android::DiagMessage(path) << "failed to open file");
+        return false;
+      }
+
+      pb::internal::LinkSnapshot::Input input;
+      input.set_path(path);
+      input.set_size(data.size());
+      input.set_hash(HashContents(data));
+      auto old_input = old_inputs.find(path);
+      if (old_input != old_inputs.end() && old_input->second->size() == input.size() &&
+          old_input->second->hash() == input.hash()) {
+        *input.mutable_resource_name() = old_input->second->resource_name();
+        unchanged_paths.insert(path);
+      } else {
+        std::unique_ptr<ResourceTable> table;
+        if (!LoadValuesTable(context_, path, data, &table)) {
+          return false;
+        }
+        if (table == nullptr) {
+          other_inputs.push_back(path);
+          continue;
+        }
+        for (std::string& name : CollectMergedResourceNames(context_, *table)) {
+          input.add_resource_name(std::move(name));
+        }
+        tables_to_merge[new_snapshot.input_size()] = std::move(table);
+      }
+      *new_snapshot.add_input() = std::move(input);
+    }
+
+    // The values and entry state of the files that changed or are gone are dropped from the
+    // snapshot. That only works for what no other file contributed to, a <declare-styleable> split
+    // across files for instance, so otherwise everything is merged again. Dropping entry state
+    // drops the whole entry, so none of the unchanged files may define any part of it.
+    std::set<std::string> stale_names;
+    if (reuse) {
+      std::map<std::string, int> definition_count;
+      std::set<std::string> kept_entries;
+      for (const auto& input : old_snapshot.input()) {
+        const bool unchanged = unchanged_paths.count(input.path()) != 0;
+        for (const std::string& name : input.resource_name()) {
+          definition_count[name]++;
+          if (unchanged) {
+            kept_entries.insert(EntryKeyOf(name));
+          }
+        }
+      }
+      for (const auto& input : old_snapshot.input()) {
+        if (unchanged_paths.count(input.path()) != 0) {
+          continue;
+        }
+        for (const std::string& name : input.resource_name()) {
+          reuse &= definition_count[name] == 1;
+          if (EntryKeyOf(name) == name) {
+            reuse &= kept_entries.count(name) == 0;
+          }
+          stale_names.insert(name);
+        }
+      }
+    }
+
+    auto snapshot_table = util::make_unique<ResourceTable>();
+    if (reuse) {
+      std::string error;
+      if (DeserializeTableFromPb(old_snapshot.table(), nullptr /*files*/, snapshot_table.get(),
+                                 &error)) {
+        RemoveResources(stale_names, snapshot_table.get());
+      } else {
+        context_->GetDiagnostics()->Warn(android::DiagMessage(snapshot_path)
+                                         << "failed to deserialize snapshot: " << error);
+        snapshot_table = util::make_unique<ResourceTable>();
+        reuse = false;
+      }
+    }
+
+    if (!reuse) {
+      for (int i = 0; i < new_snapshot.input_size(); i++) {
+        if (tables_to_merge.count(i) != 0) {
+          continue;
+        }
+        const std::string& path = new_snapshot.input(i).path();
+        std::string data;
+        std::unique_ptr<ResourceTable> table;
+        if (!android::base::ReadFileToString(path, &data)) {
+          context_->GetDiagnostics()->Error(android::DiagMessage(path) << "failed to open file");
+          return false;
+        }
+        if (!LoadValuesTable(context_, path, data, &table)) {
+          return false;
+        }
+        tables_to_merge[i] = std::move(table);
+      }
+    }
+
+    if (context_->IsVerbose()) {
+      context_->GetDiagnostics()->Note(android::DiagMessage(snapshot_path)
+                                       << "merging " << tables_to_merge.size() << " of "
+                                       << new_snapshot.input_size() << " values files");
+    }
+
+    TableMerger snapshot_merger(context_, snapshot_table.get(), merger_options);
+    for (auto& entry : tables_to_merge) {
+      const android::Source src(new_snapshot.input(entry.first).path());
+      if (entry.second == nullptr ||
+          !snapshot_merger.Merge(src, entry.second.get(), false /*overlay*/)) {
+        context_->GetDiagnostics()->Error(android::DiagMessage(src)
+                                          << "failed to merge resource table");
+        return false;
+      }
+    }
+
+    SerializeTableToPb(*snapshot_table, new_snapshot.mutable_table(), context_->GetDiagnostics());
+    WriteSnapshot(context_, snapshot_path, new_snapshot);
+
+    if (!table_merger_->Merge(android::Source(snapshot_path), snapshot_table.get(),
+                              false /*overlay*/)) {
+      return false;
+    }
+    for (const std::string& input : other_inputs) {
+      if (!MergePath(input, false)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   bool CopyAssetsDirsToApk(IArchiveWriter* writer) {
     std::map<std::string, std::unique_ptr<io::RegularFile>> merged_assets;
     for (const std::string& assets_dir : options_.assets_dirs) {
@@ -1876,6 +2282,7 @@ class Linker {
         static_cast<bool>(options_.generate_proguard_rules_path);
     file_flattener_options.output_format = options_.output_format;
     file_flattener_options.do_not_fail_on_missing_resources = options_.merge_only;
+    file_flattener_options.jobs = options_.jobs;
 
     ResourceFileFlattener file_flattener(file_flattener_options, context_, keep_set);
     if (!file_flattener.Flatten(table, writer)) {
@@ -2024,11 +2431,18 @@ class Linker {
       }
     }
 
-    for (const std::string& input : input_files) {
-      if (!MergePath(input, false)) {
+    if (options_.incremental_snapshot_path) {
+      if (!MergeInputsWithSnapshot(input_files, table_merger_options)) {
         context_->GetDiagnostics()->Error(android::DiagMessage() << "failed parsing input");
         return 1;
       }
+    } else {
+      for (const std::string& input : input_files) {
+        if (!MergePath(input, false)) {
+          context_->GetDiagnostics()->Error(android::DiagMessage() << "failed parsing input");
+          return 1;
+        }
+      }
     }
 
     for (const std::string& input : options_.overlay_files) {
@@ -2363,7 +2777,8 @@ class Linker {
 };
 
 int LinkCommand::Action(const std::vector<std::string>& args) {
-  TRACE_FLUSH(trace_folder_ ? trace_folder_.value() : "", "LinkCommand::Action");
+  TRACE_FLUSH_PROFILE(trace_folder_ ? trace_folder_.value() : "",
+                      profile_path_ ? profile_path_.value() : "", "LinkCommand::Action");
   LinkContext context(diag_);
 
   // Expand all argument-files passed into the command line. These start with '@'.
@@ -2468,6 +2883,18 @@ int LinkCommand::Action(const std::vector<std::string>& args) {
     context.SetPackageId(static_cast<uint8_t>(package_id_int));
   }
 
+  if (jobs_) {
+    const std::optional<uint32_t> maybe_jobs = ResourceUtils::ParseInt(jobs_.value());
+    if (!maybe_jobs || maybe_jobs.value() == 0) {
+      context.GetDiagnostics()->Error(android::DiagMessage()
+                                      << "-j '" << jobs_.value()
+                                      << "' is not a valid number of jobs");
+      return 1;
+    }
+    options_.jobs = maybe_jobs.value();
+    options_.table_flattener_options.jobs = options_.jobs;
+  }
+
   // Populate the set of extra packages for which to generate R.java.
   for (std::string& extra_package : extra_java_packages_) {
     // A given package can actually be a colon separated list of packages.
@@ -108,6 +108,13 @@ struct LinkOptions {
 
   // Whether we should fail on definitions of a resource with conflicting visibility.
   bool strict_visibility = false;
+
+  // The number of threads XML files are linked on.
+  size_t jobs = 1;
+
+  // Where the merged values files are kept between links, so that only the ones that changed
+  // are merged again.
+  std::optional<std::string> incremental_snapshot_path;
 };
 
 class LinkCommand : public Command {
@@ -318,10 +325,22 @@ class LinkCommand : public Command {
     AddOptionalFlag("--trace-folder",
         "Generate systrace json trace fragment to specified folder.",
         &trace_folder_);
+    AddOptionalFlag("--profile",
+        "Writes how much time and memory each phase took to the given file as JSON,\n"
+            "or prints it when the file is '-'.",
+        &profile_path_);
+    AddOptionalFlag("--incremental-snapshot",
+        "Keeps the merged compiled values files in the given file. Subsequent links\n"
+            "given the same file only merge the values files that changed since.",
+        &options_.incremental_snapshot_path);
     AddOptionalSwitch("--merge-only",
         "Only merge the resources, without verifying resource references. This flag\n"
             "should only be used together with the --static-lib flag.",
         &options_.merge_only);
+    AddOptionalFlag("-j",
+        "Links the XML files and flattens the resource table on the given number of\n"
+            "threads. The output is the same as when doing so one at a time.",
+        &jobs_);
     AddOptionalSwitch("-v", "Enables verbose logging.", &verbose_);
   }
 
@@ -334,6 +353,7 @@ class LinkCommand : public Command {
   std::vector<std::string> overlay_arg_list_;
   std::vector<std::string> extra_java_packages_;
   std::optional<std::string> package_id_;
+  std::optional<std::string> jobs_;
   std::vector<std::string> configs_;
   std::optional<std::string> preferred_density_;
   std::optional<std::string> product_list_;
@@ -347,6 +367,7 @@ class LinkCommand : public Command {
   std::optional<std::string> stable_id_file_path_;
   std::vector<std::string> split_args_;
   std::optional<std::string> trace_folder_;
+  std::optional<std::string> profile_path_;
 };
 
 }// namespace aapt
@@ -269,6 +269,137 @@ TEST_F(LinkTest, OverrideStylesInsteadOfOverlaying) {
   EXPECT_EQ(actual_style->entries[0].key.id, 0x010100d4);  // android:background
 }
 
+TEST_F(LinkTest, IncrementalSnapshot) {
+  StdErrDiagnostics diag;
+  const std::string compiled_files_dir = GetTestPath("compiled");
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/a.xml"),
+                          R"(<resources><string name="foo">one</string></resources>)",
+                          compiled_files_dir, &diag));
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/b.xml"),
+                          R"(<resources><string name="bar">two</string></resources>)",
+                          compiled_files_dir, &diag));
+
+  const std::string out_apk = GetTestPath("out.apk");
+  const std::string snapshot = GetTestPath("snapshot.pb");
+  std::vector<std::string> link_args = {
+      "--manifest", GetDefaultManifest(kDefaultPackageName),
+      "-o", out_apk,
+      "--incremental-snapshot", snapshot,
+  };
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+  std::string snapshot_data;
+  ASSERT_TRUE(android::base::ReadFileToString(snapshot, &snapshot_data));
+
+  // Only a.xml changes, b.xml is taken from the snapshot.
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/a.xml"),
+                          R"(<resources>
+                               <string name="foo">three</string>
+                               <string name="baz">four</string>
+                             </resources>)",
+                          compiled_files_dir, &diag));
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+
+  std::unique_ptr<LoadedApk> apk = LoadedApk::LoadApkFromPath(out_apk, &diag);
+  ASSERT_THAT(apk, Ne(nullptr));
+  const std::string package = kDefaultPackageName;
+
+  auto foo = test::GetValue<String>(apk->GetResourceTable(), package + ":string/foo");
+  ASSERT_THAT(foo, NotNull());
+  EXPECT_EQ(*foo->value, "three");
+  auto bar = test::GetValue<String>(apk->GetResourceTable(), package + ":string/bar");
+  ASSERT_THAT(bar, NotNull());
+  EXPECT_EQ(*bar->value, "two");
+  auto baz = test::GetValue<String>(apk->GetResourceTable(), package + ":string/baz");
+  ASSERT_THAT(baz, NotNull());
+  EXPECT_EQ(*baz->value, "four");
+}
+
+TEST_F(LinkTest, IncrementalSnapshotKeepsOtherConfigs) {
+  StdErrDiagnostics diag;
+  const std::string compiled_files_dir = GetTestPath("compiled");
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/strings.xml"),
+                          R"(<resources><string name="foo">one</string></resources>)",
+                          compiled_files_dir, &diag));
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values-fr/strings.xml"),
+                          R"(<resources><string name="foo">un</string></resources>)",
+                          compiled_files_dir, &diag));
+
+  const std::string out_apk = GetTestPath("out.apk");
+  std::vector<std::string> link_args = {
+      "--manifest", GetDefaultManifest(kDefaultPackageName),
+      "-o", out_apk,
+      "--incremental-snapshot", GetTestPath("snapshot.pb"),
+  };
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+
+  // Only the French value is dropped from the snapshot and merged again.
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values-fr/strings.xml"),
+                          R"(<resources><string name="foo">deux</string></resources>)",
+                          compiled_files_dir, &diag));
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+
+  std::unique_ptr<LoadedApk> apk = LoadedApk::LoadApkFromPath(out_apk, &diag);
+  ASSERT_THAT(apk, Ne(nullptr));
+  const std::string name = std::string(kDefaultPackageName) + ":string/foo";
+  auto foo = test::GetValue<String>(apk->GetResourceTable(), name);
+  ASSERT_THAT(foo, NotNull());
+  EXPECT_EQ(*foo->value, "one");
+  auto foo_fr = test::GetValueForConfig<String>(apk->GetResourceTable(), name,
+                                                test::ParseConfigOrDie("fr"));
+  ASSERT_THAT(foo_fr, NotNull());
+  EXPECT_EQ(*foo_fr->value, "deux");
+}
+
+TEST_F(LinkTest, ParallelXmlLinking) {
+  StdErrDiagnostics diag;
+  const std::string compiled_files_dir = GetTestPath("compiled");
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/values.xml"),
+                          R"(<resources><string name="label">Hello</string></resources>)",
+                          compiled_files_dir, &diag));
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(CompileFile(GetTestPath("res/layout/layout" + std::to_string(i) + ".xml"),
+                            R"(<TextView xmlns:android="http://schemas.android.com/apk/res/android"
+                                   android:paddingHorizontal="4dp"
+                                   android:text="@string/label"/>)",
+                            compiled_files_dir, &diag));
+  }
+
+  const std::string serial_apk = GetTestPath("serial.apk");
+  const std::string parallel_apk = GetTestPath("parallel.apk");
+  ASSERT_TRUE(Link({"--manifest", GetDefaultManifest(), "-o", serial_apk}, compiled_files_dir,
+                   &diag));
+  ASSERT_TRUE(Link({"--manifest", GetDefaultManifest(), "-o", parallel_apk, "-j", "4"},
+                   compiled_files_dir, &diag));
+
+  std::string serial;
+  std::string parallel;
+  ASSERT_TRUE(android::base::ReadFileToString(serial_apk, &serial));
+  ASSERT_TRUE(android::base::ReadFileToString(parallel_apk, &parallel));
+  EXPECT_EQ(serial, parallel);
+
+  ASSERT_FALSE(Link({"--manifest", GetDefaultManifest(), "-o", parallel_apk, "-j", "0"},
+                    compiled_files_dir, &diag));
+}
+
+TEST_F(LinkTest, Profile) {
+  StdErrDiagnostics diag;
+  const std::string compiled_files_dir = GetTestPath("compiled");
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/values.xml"),
+                          R"(<resources><string name="label">Hello</string></resources>)",
+                          compiled_files_dir, &diag));
+
+  const std::string profile_path = GetTestPath("profile.json");
+  ASSERT_TRUE(Link({"--manifest", GetDefaultManifest(), "-o", GetTestPath("out.apk"), "--profile",
+                    profile_path},
+                   compiled_files_dir, &diag));
+
+  std::string profile;
+  ASSERT_TRUE(android::base::ReadFileToString(profile_path, &profile));
+  EXPECT_THAT(profile, HasSubstr(R"({"phases": [)"));
+  EXPECT_THAT(profile, HasSubstr(R"("name": "LinkCommand::Action", "count": 1,)"));
+  EXPECT_THAT(profile, HasSubstr(R"("name": "Process ResTable", "count": 1,)"));
+}
+
 TEST_F(LinkTest, AppInfoWithUsesSplit) {
   StdErrDiagnostics diag;
   const std::string base_files_dir = GetTestPath("base");
@@ -47,6 +47,7 @@
 #include "optimize/ResourceFilter.h"
 #include "optimize/VersionCollapser.h"
 #include "split/TableSplitter.h"
+#include "trace/TraceBuffer.h"
 #include "util/Files.h"
 #include "util/Util.h"
 
@@ -132,6 +133,7 @@ class Optimizer {
   }
 
   int Run(std::unique_ptr<LoadedApk> apk) {
+    TRACE_CALL();
     if (context_->IsVerbose()) {
       context_->GetDiagnostics()->Note(android::DiagMessage() << "Optimizing APK...");
     }
@@ -223,7 +225,7 @@ class Optimizer {
       MultiApkGenerator generator{apk.get(), context_};
       MultiApkGeneratorOptions generator_options = {
           options_.output_dir.value(), options_.apk_artifacts.value(),
-          options_.table_flattener_options, options_.kept_artifacts};
+          options_.table_flattener_options, options_.kept_artifacts, options_.jobs};
       if (!generator.FromBaseApk(generator_options)) {
         return 1;
       }
@@ -346,6 +348,7 @@ bool ExtractAppDataFromManifest(OptimizeContext* context, const LoadedApk* apk,
 }
 
 int OptimizeCommand::Action(const std::vector<std::string>& args) {
+  TRACE_FLUSH_PROFILE("", profile_path_ ? profile_path_.value() : "", "OptimizeCommand::Action");
   if (args.size() != 1u) {
     std::cerr << "must have one APK as argument.\n\n";
     Usage(&std::cerr);
@@ -400,6 +403,17 @@ int OptimizeCommand::Action(const std::vector<std::string>& args) {
     return 1;
   }
 
+  if (jobs_) {
+    const std::optional<uint32_t> maybe_jobs = ResourceUtils::ParseInt(jobs_.value());
+    if (!maybe_jobs || maybe_jobs.value() == 0) {
+      diag->Error(android::DiagMessage() << "-j '" << jobs_.value()
+                                         << "' is not a valid number of jobs");
+      return 1;
+    }
+    options_.jobs = maybe_jobs.value();
+    options_.table_flattener_options.jobs = options_.jobs;
+  }
+
   std::unique_ptr<LoadedApk> apk = LoadedApk::LoadApkFromPath(apk_path, context.GetDiagnostics());
   if (!apk) {
     return 1;
@@ -69,6 +69,9 @@ struct OptimizeOptions {
 
   // Path to the output map of original resource paths/names to obfuscated paths/names.
   std::optional<std::string> obfuscation_map_path;
+
+  // Number of multi-APK artifacts to generate at the same time.
+  size_t jobs = 1;
 };
 
 class OptimizeCommand : public Command {
@@ -140,6 +143,14 @@ class OptimizeCommand : public Command {
         "store the same resource value only once in resource table which decreases APK size.\n"
         "Has no effect on APKs where resource names are kept.",
         &options_.table_flattener_options.deduplicate_entry_values);
+    AddOptionalFlag("--profile",
+                    "Writes how much time and memory each phase took to the given file as JSON,\n"
+                    "or prints it when the file is '-'.",
+                    &profile_path_);
+    AddOptionalFlag("-j",
+        "Generates the artifacts of the XML configuration file, and reads the files\n"
+            "written to the output APKs, on the given number of threads.",
+        &jobs_);
     AddOptionalSwitch("-v", "Enables verbose logging", &verbose_);
   }
 
@@ -154,6 +165,8 @@ class OptimizeCommand : public Command {
   std::optional<std::string> config_path_;
   std::optional<std::string> resources_config_path_;
   std::optional<std::string> target_densities_;
+  std::optional<std::string> profile_path_;
+  std::optional<std::string> jobs_;
   std::vector<std::string> configs_;
   std::vector<std::string> split_args_;
   std::unordered_set<std::string> kept_artifacts_;
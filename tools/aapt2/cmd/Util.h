@@ -20,9 +20,12 @@
 #include <regex>
 #include <set>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "AppInfo.h"
 #include "SdkConstants.h"
+#include "android-base/macros.h"
 #include "androidfw/IDiagnostics.h"
 #include "androidfw/StringPiece.h"
 #include "filter/ConfigFilter.h"
@@ -32,6 +35,80 @@
 
 namespace aapt {
 
+// Holds on to the messages of work done on a worker thread until they can be logged in the order
+// the work was handed out.
+class BufferedDiagnostics : public android::IDiagnostics {
+ public:
+  BufferedDiagnostics() = default;
+
+  void Log(Level level, android::DiagMessageActual& actual_msg) override {
+    messages_.emplace_back(level, actual_msg);
+  }
+
+  void WriteTo(android::IDiagnostics* diag) {
+    for (auto& [level, msg] : messages_) {
+      diag->Log(level, msg);
+    }
+    messages_.clear();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BufferedDiagnostics);
+
+  std::vector<std::pair<Level, android::DiagMessageActual>> messages_;
+};
+
+// Context of work done on a worker thread, which only differs from the command's context by where
+// the diagnostics go.
+class JobContext : public IAaptContext {
+ public:
+  JobContext(IAaptContext* context, android::IDiagnostics* diagnostics)
+      : context_(context), diagnostics_(diagnostics) {
+  }
+
+  PackageType GetPackageType() override {
+    return context_->GetPackageType();
+  }
+
+  bool IsVerbose() override {
+    return context_->IsVerbose();
+  }
+
+  android::IDiagnostics* GetDiagnostics() override {
+    return diagnostics_;
+  }
+
+  NameMangler* GetNameMangler() override {
+    return context_->GetNameMangler();
+  }
+
+  const std::string& GetCompilationPackage() override {
+    return context_->GetCompilationPackage();
+  }
+
+  uint8_t GetPackageId() override {
+    return context_->GetPackageId();
+  }
+
+  SymbolTable* GetExternalSymbols() override {
+    return context_->GetExternalSymbols();
+  }
+
+  int GetMinSdkVersion() override {
+    return context_->GetMinSdkVersion();
+  }
+
+  const std::set<std::string>& GetSplitNameDependencies() override {
+    return context_->GetSplitNameDependencies();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(JobContext);
+
+  IAaptContext* context_;
+  android::IDiagnostics* diagnostics_;
+};
+
 // Parses a configuration density (ex. hdpi, xxhdpi, 234dpi, anydpi, etc).
 // Returns Nothing and logs a human friendly error message if the string was not legal.
 std::optional<uint16_t> ParseTargetDensityParameter(android::StringPiece arg,
@@ -35,6 +35,10 @@ constexpr size_t kPngSignatureSize = 8u;
 
 struct PngOptions {
   int grayscale_tolerance = 0;
+
+  // When not zero, WritePng stops compressing as soon as the PNG is larger than this many bytes,
+  // for callers that would throw such a PNG away.
+  size_t max_size = 0;
 };
 
 /**
@@ -96,6 +100,9 @@ std::unique_ptr<Image> ReadPng(IAaptContext* context, const android::Source& sou
 /**
  * Writes the RGBA Image, with optional 9-patch meta-data, into the OutputStream
  * as a PNG.
+ *
+ * If the PNG grows past options.max_size, false is returned without logging an
+ * error, and more than max_size bytes will have been written to `out`.
  */
 bool WritePng(IAaptContext* context, const Image* image,
               const NinePatch* nine_patch, io::OutputStream* out,
@@ -107,8 +107,14 @@ static void ReadDataFromStream(png_structp png_ptr, png_bytep buffer, png_size_t
   }
 }
 
+struct PngWriteTarget {
+  io::OutputStream* out;
+  size_t max_size;
+};
+
 static void WriteDataToStream(png_structp png_ptr, png_bytep buffer, png_size_t len) {
-  io::OutputStream* out = (io::OutputStream*)png_get_io_ptr(png_ptr);
+  PngWriteTarget* target = (PngWriteTarget*)png_get_io_ptr(png_ptr);
+  io::OutputStream* out = target->out;
 
   void* out_buffer;
   size_t out_len;
@@ -141,6 +147,12 @@ static void WriteDataToStream(png_structp png_ptr, png_bytep buffer, png_size_t
   if (out_len > 0) {
     out->BackUp(out_len);
   }
+
+  // The caller has no use for a PNG this large, don't bother compressing the rest of it.
+  // This is not an error, so jump straight back to WritePng instead of going through LogError.
+  if (target->max_size != 0 && out->ByteCount() > target->max_size) {
+    png_longjmp(png_ptr, 1);
+  }
 }
 
 std::unique_ptr<Image> ReadPng(IAaptContext* context, const android::Source& source,
@@ -519,7 +531,8 @@ bool WritePng(IAaptContext* context, const Image* image,
   png_set_error_fn(write_ptr, (png_voidp)context->GetDiagnostics(), LogError, LogWarning);
 
   // Set up the write functions which write to our custom data sources.
-  png_set_write_fn(write_ptr, (png_voidp)out, WriteDataToStream, nullptr);
+  PngWriteTarget target = {out, options.max_size};
+  png_set_write_fn(write_ptr, (png_voidp)&target, WriteDataToStream, nullptr);
 
   // We want small files and can take the performance hit to achieve this goal.
   png_set_compression_level(write_ptr, Z_BEST_COMPRESSION);
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/Png.h"
+
+#include "io/BigBufferStream.h"
+#include "test/Test.h"
+
+namespace aapt {
+
+// An RGBA image with a different color in every pixel, so that it neither fits a palette nor
+// compresses well.
+static std::unique_ptr<Image> MakeNoisyImage(int32_t width, int32_t height) {
+  auto image = util::make_unique<Image>();
+  image->width = width;
+  image->height = height;
+  image->data = std::unique_ptr<uint8_t[]>(new uint8_t[width * height * 4]);
+  image->rows = std::unique_ptr<uint8_t*[]>(new uint8_t*[height]);
+  uint32_t seed = 1;
+  for (int32_t y = 0; y < height; y++) {
+    image->rows[y] = image->data.get() + y * width * 4;
+    for (int32_t x = 0; x < width * 4; x++) {
+      seed = seed * 1103515245 + 12345;
+      image->rows[y][x] = static_cast<uint8_t>(seed >> 16);
+    }
+  }
+  return image;
+}
+
+TEST(PngCrunchTest, WritePng) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  std::unique_ptr<Image> image = MakeNoisyImage(64, 64);
+
+  android::BigBuffer buffer(4096);
+  io::BigBufferOutputStream out(&buffer);
+  ASSERT_TRUE(WritePng(context.get(), image.get(), nullptr, &out, {}));
+  EXPECT_GT(out.ByteCount(), kPngSignatureSize);
+}
+
+TEST(PngCrunchTest, WritePngStopsAtMaxSize) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  std::unique_ptr<Image> image = MakeNoisyImage(64, 64);
+
+  PngOptions options;
+  options.max_size = 1024;
+  android::BigBuffer buffer(4096);
+  io::BigBufferOutputStream out(&buffer);
+  ASSERT_FALSE(WritePng(context.get(), image.get(), nullptr, &out, options));
+  EXPECT_GT(out.ByteCount(), options.max_size);
+
+  // Noise doesn't compress, so the whole image would have been far larger.
+  EXPECT_LT(out.ByteCount(), 64u * 64u * 4u);
+}
+
+}  // namespace aapt
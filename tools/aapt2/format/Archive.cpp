@@ -210,8 +210,7 @@ class ZipFileWriter : public IArchiveWriter {
         ZipWriter::FileEntry last_entry;
         int32_t result = writer_->GetLastEntry(&last_entry);
         CHECK(result == 0);
-        if (last_entry.compressed_size + (last_entry.compressed_size / 10) >
-            last_entry.uncompressed_size) {
+        if (!IsCompressedEnough(last_entry.compressed_size, last_entry.uncompressed_size)) {
           // The file was not compressed enough, rewind and store it uncompressed.
           if (!in->Rewind()) {
             // Well we tried, may as well keep what we had.
@@ -256,6 +255,10 @@ class ZipFileWriter : public IArchiveWriter {
 
 }  // namespace
 
+bool IsCompressedEnough(size_t compressed_size, size_t uncompressed_size) {
+  return compressed_size + (compressed_size / 10) <= uncompressed_size;
+}
+
 std::unique_ptr<IArchiveWriter> CreateDirectoryArchiveWriter(android::IDiagnostics* diag,
                                                              StringPiece path) {
   std::unique_ptr<DirectoryWriter> writer = util::make_unique<DirectoryWriter>();
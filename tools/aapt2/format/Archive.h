@@ -69,6 +69,10 @@ class IArchiveWriter : public ::google::protobuf::io::CopyingOutputStream {
   virtual std::string GetError() const = 0;
 };
 
+// Whether compressing an entry down to compressed_size saves enough to be worth inflating it at
+// runtime. Entries that don't are stored uncompressed instead. This preserves the behavior of AAPT.
+bool IsCompressedEnough(size_t compressed_size, size_t uncompressed_size);
+
 std::unique_ptr<IArchiveWriter> CreateDirectoryArchiveWriter(android::IDiagnostics* diag,
                                                              android::StringPiece path);
 
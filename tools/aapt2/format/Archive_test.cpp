@@ -14,7 +14,11 @@
  * limitations under the License.
  */
 
+#include "LoadedApk.h"
+#include "io/Util.h"
+#include "io/ZipArchive.h"
 #include "test/Test.h"
+#include "ziparchive/zip_writer.h"
 
 namespace aapt {
 
@@ -206,4 +210,84 @@ TEST_F(ArchiveTest, ZipFileWriteFileError) {
   ASSERT_EQ("ZipFileWriteFileError", writer->GetError());
 }
 
+TEST_F(ArchiveTest, CopyPoorlyCompressedFileStoresIt) {
+  // Random data does not compress, but a writer without AAPT's check deflates it anyway.
+  std::string input_path = GetTestPath("input.apk");
+  std::unique_ptr<uint8_t[]> data = MakeTestArray();
+  {
+    std::unique_ptr<FILE, decltype(fclose)*> file = {fopen(input_path.c_str(), "w+b"), fclose};
+    ASSERT_NE(nullptr, file);
+    ZipWriter zip_writer(file.get());
+    ASSERT_EQ(0, zip_writer.StartEntry("test", ZipWriter::kCompress));
+    ASSERT_EQ(0, zip_writer.WriteBytes(data.get(), kTestDataLength));
+    ASSERT_EQ(0, zip_writer.FinishEntry());
+    ASSERT_EQ(0, zip_writer.Finish());
+  }
+
+  std::unique_ptr<io::ZipFileCollection> input = io::ZipFileCollection::Create(input_path, nullptr);
+  ASSERT_NE(nullptr, input);
+  io::IFile* input_file = input->FindFile("test");
+  ASSERT_NE(nullptr, input_file);
+  ASSERT_TRUE(input_file->WasCompressed());
+  ASSERT_TRUE(input_file->GetCompressedSize());
+  ASSERT_FALSE(IsCompressedEnough(input_file->GetCompressedSize().value(), kTestDataLength));
+
+  std::string output_path = GetTestPath("output.apk");
+  std::unique_ptr<IArchiveWriter> writer = MakeZipFileWriter(output_path);
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  ASSERT_TRUE(io::CopyFileToArchivePreserveCompression(context.get(), input_file, "test",
+                                                       writer.get()));
+  writer.reset();
+
+  std::unique_ptr<io::ZipFileCollection> output =
+      io::ZipFileCollection::Create(output_path, nullptr);
+  ASSERT_NE(nullptr, output);
+  EXPECT_FALSE(output->FindFile("test")->WasCompressed());
+  VerifyZipFile(output_path, "test", data.get());
+}
+
+TEST_F(ArchiveTest, WriteApkReadingFilesOnSeveralJobs) {
+  // More files than are read at a time, so that several windows are needed.
+  constexpr size_t kFileCount = 100;
+  std::string input_path = GetTestPath("input.apk");
+  std::unique_ptr<uint8_t[]> data = MakeTestArray();
+  {
+    std::unique_ptr<FILE, decltype(fclose)*> file = {fopen(input_path.c_str(), "w+b"), fclose};
+    ASSERT_NE(nullptr, file);
+    ZipWriter zip_writer(file.get());
+    ASSERT_EQ(0, zip_writer.StartEntry("res/raw/long_name", ZipWriter::kCompress));
+    ASSERT_EQ(0, zip_writer.WriteBytes(data.get(), kTestDataLength));
+    ASSERT_EQ(0, zip_writer.FinishEntry());
+    for (size_t i = 0; i < kFileCount; i++) {
+      std::string path = "assets/file" + std::to_string(i);
+      ASSERT_EQ(0, zip_writer.StartEntry(path.c_str(), i % 2 ? ZipWriter::kCompress : 0));
+      ASSERT_EQ(0, zip_writer.WriteBytes(data.get(), kTestDataLength));
+      ASSERT_EQ(0, zip_writer.FinishEntry());
+    }
+    ASSERT_EQ(0, zip_writer.Finish());
+  }
+
+  std::unique_ptr<io::ZipFileCollection> input = io::ZipFileCollection::Create(input_path, nullptr);
+  ASSERT_NE(nullptr, input);
+  LoadedApk apk({input_path}, std::move(input), {}, {}, kBinary);
+
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder().AddFileReference("com.app:raw/long_name", "res/a").Build();
+  TableFlattenerOptions options;
+  options.shortened_path_map["res/raw/long_name"] = "res/a";
+  options.jobs = 4;
+
+  std::string output_path = GetTestPath("output.apk");
+  std::unique_ptr<IArchiveWriter> writer = MakeZipFileWriter(output_path);
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  FilterChain filters;
+  ASSERT_TRUE(apk.WriteToArchive(context.get(), table.get(), options, &filters, writer.get()));
+  writer.reset();
+
+  VerifyZipFile(output_path, "res/a", data.get());
+  for (size_t i = 0; i < kFileCount; i++) {
+    VerifyZipFile(output_path, "assets/file" + std::to_string(i), data.get());
+  }
+}
+
 }  // namespace aapt
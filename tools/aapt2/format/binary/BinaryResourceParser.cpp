@@ -110,6 +110,11 @@ bool BinaryResourceParser::Parse() {
     return false;
   }
 
+  // Now go through the table and change local resource ID references to symbolic references. This
+  // is done once all packages are parsed, rather than revisiting the whole table after each one.
+  ReferenceIdToNameVisitor visitor(&id_index_);
+  VisitAllValuesInTable(table_, &visitor);
+
   if (parser.Next() != ResChunkPullParser::Event::kEndDocument) {
     if (parser.event() == ResChunkPullParser::Event::kBadDocument) {
       diag_->Warn(android::DiagMessage(source_)
@@ -211,6 +216,7 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
   // clear the type and key pool in case they were set from a previous package.
   type_pool_.uninit();
   key_pool_.uninit();
+  key_names_.clear();
 
   ResChunkPullParser parser(GetChunkData(&package_header->header),
                             GetChunkDataLen(&package_header->header));
@@ -235,6 +241,7 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
                          << "ResTable_package: " << key_pool_.getError());
             return false;
           }
+          key_names_.resize(key_pool_.size());
         } else {
           diag_->Warn(android::DiagMessage(source_) << "unexpected string pool");
         }
@@ -282,11 +289,6 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
     diag_->Error(android::DiagMessage(source_) << "corrupt ResTable_package: " << parser.error());
     return false;
   }
-
-  // Now go through the table and change local resource ID references to
-  // symbolic references.
-  ReferenceIdToNameVisitor visitor(&id_index_);
-  VisitAllValuesInTable(table_, &visitor);
   return true;
 }
 
@@ -384,8 +386,7 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
       continue;
     }
 
-    const ResourceName name(package->name, *parsed_type,
-        android::util::GetString(key_pool_, entry->key()));
+    const ResourceName name(package->name, *parsed_type, GetKeyName(entry->key()));
     const ResourceId res_id(package_id, type->id, static_cast<uint16_t>(it.index()));
 
     std::unique_ptr<Value> resource_value;
@@ -443,6 +444,18 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
   return true;
 }
 
+const std::string& BinaryResourceParser::GetKeyName(uint32_t key) {
+  if (key >= key_names_.size()) {
+    static const std::string kEmptyName;
+    return kEmptyName;
+  }
+  std::optional<std::string>& name = key_names_[key];
+  if (!name) {
+    name = android::util::GetString(key_pool_, key);
+  }
+  return *name;
+}
+
 bool BinaryResourceParser::ParseLibrary(const ResChunk_header* chunk) {
   DynamicRefTable dynamic_ref_table;
   if (dynamic_ref_table.load(reinterpret_cast<const ResTable_lib_header*>(chunk)) != NO_ERROR) {
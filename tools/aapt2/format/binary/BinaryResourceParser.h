@@ -17,7 +17,9 @@
 #ifndef AAPT_FORMAT_BINARY_RESOURCEPARSER_H
 #define AAPT_FORMAT_BINARY_RESOURCEPARSER_H
 
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "ResourceTable.h"
 #include "ResourceValues.h"
@@ -57,6 +59,10 @@ class BinaryResourceParser {
   bool ParseType(const ResourceTablePackage* package, const android::ResChunk_header* chunk,
                  uint8_t package_id);
   bool ParseLibrary(const android::ResChunk_header* chunk);
+
+  // Returns the entry name at index `key` of the key pool, which is decoded only the first time
+  // it is needed. Every configuration of an entry refers to the same key.
+  const std::string& GetKeyName(uint32_t key);
   bool ParseOverlayable(const android::ResChunk_header* chunk);
   bool ParseStagedAliases(const android::ResChunk_header* chunk);
 
@@ -114,6 +120,9 @@ class BinaryResourceParser {
   // in this table.
   android::ResStringPool key_pool_;
 
+  // The decoded strings of key_pool_, by index.
+  std::vector<std::optional<std::string>> key_names_;
+
   // A mapping of resource ID to resource name. When we finish parsing
   // we use this to convert all resource IDs to symbolic references.
   std::map<ResourceId, ResourceName> id_index_;
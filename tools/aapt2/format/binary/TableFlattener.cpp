@@ -16,10 +16,14 @@
 
 #include "format/binary/TableFlattener.h"
 
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <sstream>
+#include <thread>
 #include <type_traits>
 #include <variant>
+#include <vector>
 
 #include "ResourceTable.h"
 #include "ResourceValues.h"
@@ -73,7 +77,8 @@ class PackageFlattener {
                    bool compact_entries,
                    bool collapse_key_stringpool,
                    const std::set<ResourceName>& name_collapse_exemptions,
-                   bool deduplicate_entry_values)
+                   bool deduplicate_entry_values,
+                   size_t jobs)
       : context_(context),
         diag_(context->GetDiagnostics()),
         package_(package),
@@ -82,7 +87,8 @@ class PackageFlattener {
         compact_entries_(compact_entries),
         collapse_key_stringpool_(collapse_key_stringpool),
         name_collapse_exemptions_(name_collapse_exemptions),
-        deduplicate_entry_values_(deduplicate_entry_values) {
+        deduplicate_entry_values_(deduplicate_entry_values),
+        jobs_(jobs) {
   }
 
   bool FlattenPackage(BigBuffer* buffer) {
@@ -432,7 +438,38 @@ class PackageFlattener {
     return true;
   }
 
+  // The chunks of one type: its spec followed by one type chunk per configuration.
+  struct TypeChunks {
+    const ResourceTableTypeView* type;
+    size_t num_entries;
+    // The binary resource table lists resource entries for each configuration.
+    // We store them inverted, where a resource entry lists the values for each
+    // configuration available. Here we reverse this to match the binary table.
+    std::map<ConfigDescription, std::vector<FlatEntry>> config_to_entry_list_map;
+    BigBuffer buffer{1024};
+    bool flattened = false;
+  };
+
+  bool FlattenTypeChunks(TypeChunks* chunks) {
+    if (!FlattenTypeSpec(*chunks->type, chunks->type->entries, &chunks->buffer)) {
+      return false;
+    }
+
+    // Flatten a configuration value.
+    for (auto& entry : chunks->config_to_entry_list_map) {
+      if (!FlattenConfig(*chunks->type, entry.first, chunks->num_entries, &entry.second,
+                         &chunks->buffer)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   bool FlattenTypes(BigBuffer* buffer) {
+    // The type and key string pools are filled in first, in the order the types are written, so
+    // every index is fixed before any chunk refers to it. The chunks of each type then only read
+    // shared state and can be flattened concurrently into buffers of their own.
+    std::vector<TypeChunks> types;
     size_t expected_type_id = 1;
     for (const ResourceTableTypeView& type : package_.types) {
       if (type.named_type.type == ResourceType::kStyleable ||
@@ -452,20 +489,11 @@ class PackageFlattener {
       expected_type_id++;
       type_pool_.MakeRef(type.named_type.to_string());
 
-      if (!FlattenTypeSpec(type, type.entries, buffer)) {
-        return false;
-      }
+      TypeChunks& chunks = types.emplace_back();
+      chunks.type = &type;
 
       // Since the entries are sorted by ID, the last ID will be the largest.
-      const size_t num_entries = type.entries.back().id.value() + 1;
-
-      // The binary resource table lists resource entries for each
-      // configuration.
-      // We store them inverted, where a resource entry lists the values for
-      // each
-      // configuration available. Here we reverse this to match the binary
-      // table.
-      std::map<ConfigDescription, std::vector<FlatEntry>> config_to_entry_list_map;
+      chunks.num_entries = type.entries.back().id.value() + 1;
 
       for (const ResourceTableEntryView& entry : type.entries) {
         if (entry.staged_id) {
@@ -502,18 +530,44 @@ class PackageFlattener {
 
         // Group values by configuration.
         for (auto& config_value : entry.values) {
-          config_to_entry_list_map[config_value->config].push_back(
+          chunks.config_to_entry_list_map[config_value->config].push_back(
               FlatEntry{&entry, config_value->value.get(), local_key_index});
         }
       }
+    }
+
+    if (jobs_ > 1 && types.size() > 1) {
+      std::atomic<size_t> next_type = 0;
+      auto worker = [&]() {
+        for (size_t i = next_type++; i < types.size(); i = next_type++) {
+          types[i].flattened = FlattenTypeChunks(&types[i]);
+        }
+      };
 
-      // Flatten a configuration value.
-      for (auto& entry : config_to_entry_list_map) {
-        if (!FlattenConfig(type, entry.first, num_entries, &entry.second, buffer)) {
+      std::vector<std::thread> threads;
+      const size_t thread_count = std::min(jobs_, types.size());
+      for (size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back(worker);
+      }
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    } else {
+      for (TypeChunks& chunks : types) {
+        chunks.flattened = FlattenTypeChunks(&chunks);
+        if (!chunks.flattened) {
           return false;
         }
       }
     }
+
+    // Splice the types in order, so the output doesn't depend on the number of jobs.
+    for (TypeChunks& chunks : types) {
+      if (!chunks.flattened) {
+        return false;
+      }
+      buffer->AppendBuffer(std::move(chunks.buffer));
+    }
     return true;
   }
 
@@ -557,6 +611,7 @@ class PackageFlattener {
   const std::set<ResourceName>& name_collapse_exemptions_;
   std::map<uint32_t, uint32_t> aliases_;
   bool deduplicate_entry_values_;
+  size_t jobs_;
 };
 
 }  // namespace
@@ -611,7 +666,8 @@ bool TableFlattener::Consume(IAaptContext* context, ResourceTable* table) {
                                options_.use_compact_entries,
                                options_.collapse_key_stringpool,
                                options_.name_collapse_exemptions,
-                               options_.deduplicate_entry_values);
+                               options_.deduplicate_entry_values,
+                               options_.jobs);
     if (!flattener.FlattenPackage(&package_buffer)) {
       return false;
     }
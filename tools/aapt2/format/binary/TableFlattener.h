@@ -82,6 +82,10 @@ struct TableFlattenerOptions {
 
   // Map from original resource ids to obfuscated names.
   std::unordered_map<uint32_t, std::string> id_resource_map;
+
+  // The number of threads the types of a package are flattened on. LoadedApk::WriteToArchive also
+  // reads the files it copies on this many threads. The output is the same for any number of jobs.
+  size_t jobs = 1;
 };
 
 class TableFlattener : public IResourceTableConsumer {
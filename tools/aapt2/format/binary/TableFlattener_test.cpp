@@ -200,6 +200,68 @@ TEST_F(TableFlattenerTest, FlattenFullyLinkedTable) {
                      Res_value::TYPE_STRING, (uint32_t)*idx, 0u));
 }
 
+TEST_F(TableFlattenerTest, FlattenTypesInParallel) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddSimple("com.app.test:id/one", ResourceId(0x7f020000))
+          .AddSimple("com.app.test:id/two", ResourceId(0x7f020001))
+          .AddValue("com.app.test:integer/one", ResourceId(0x7f030000),
+                    util::make_unique<BinaryPrimitive>(uint8_t(Res_value::TYPE_INT_DEC), 1u))
+          .AddValue("com.app.test:integer/one", test::ParseConfigOrDie("v1"),
+                    ResourceId(0x7f030000),
+                    util::make_unique<BinaryPrimitive>(uint8_t(Res_value::TYPE_INT_DEC), 2u))
+          .AddString("com.app.test:string/test", ResourceId(0x7f050000), "foo")
+          .AddString("com.app.test:string/test", test::ParseConfigOrDie("fr"),
+                     ResourceId(0x7f050000), "bar")
+          .AddString("com.app.test:layout/bar", ResourceId(0x7f060000), "res/layout/bar.xml")
+          .Build();
+
+  std::string serial_output;
+  ASSERT_TRUE(Flatten(context_.get(), {}, table.get(), &serial_output));
+
+  TableFlattenerOptions options;
+  options.jobs = 4;
+  std::string parallel_output;
+  ASSERT_TRUE(Flatten(context_.get(), options, table.get(), &parallel_output));
+  EXPECT_EQ(serial_output, parallel_output);
+
+  ResTable res_table;
+  ASSERT_TRUE(Flatten(context_.get(), options, table.get(), &res_table));
+  EXPECT_TRUE(Exists(&res_table, "com.app.test:integer/one", ResourceId(0x7f030000),
+                     test::ParseConfigOrDie("v1"), Res_value::TYPE_INT_DEC, 2u,
+                     ResTable_config::CONFIG_VERSION));
+}
+
+TEST_F(TableFlattenerTest, ParseEntryNamesAndReferencesAcrossConfigs) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddString("com.app.test:string/a", ResourceId(0x7f050000), "a")
+          .AddString("com.app.test:string/a", test::ParseConfigOrDie("fr"),
+                     ResourceId(0x7f050000), "fr")
+          .AddString("com.app.test:string/b", test::ParseConfigOrDie("fr"),
+                     ResourceId(0x7f050001), "b")
+          .AddReference("com.app.test:string/c", ResourceId(0x7f050002), "com.app.test:string/a")
+          .Build();
+  // Flattening only keeps the IDs of references, the parser has to find the name again.
+  Reference* linked_ref = test::GetValue<Reference>(table.get(), "com.app.test:string/c");
+  linked_ref->id = ResourceId(0x7f050000);
+  linked_ref->name = {};
+
+  ResourceTable result;
+  ASSERT_TRUE(Flatten(context_.get(), {}, table.get(), &result));
+
+  EXPECT_THAT(test::GetValueForConfig<String>(&result, "com.app.test:string/a",
+                                              test::ParseConfigOrDie("fr")),
+              NotNull());
+  EXPECT_THAT(test::GetValueForConfig<String>(&result, "com.app.test:string/b",
+                                              test::ParseConfigOrDie("fr")),
+              NotNull());
+  Reference* ref = test::GetValue<Reference>(&result, "com.app.test:string/c");
+  ASSERT_THAT(ref, NotNull());
+  ASSERT_TRUE(ref->name);
+  EXPECT_EQ(ref->name.value(), test::ParseNameOrDie("com.app.test:string/a"));
+}
+
 TEST_F(TableFlattenerTest, FlattenEntriesWithGapsInIds) {
   std::unique_ptr<ResourceTable> table =
       test::ResourceTableBuilder()
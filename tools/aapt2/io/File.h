@@ -19,6 +19,7 @@
 
 #include <list>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "android-base/macros.h"
@@ -57,6 +58,12 @@ class IFile {
     return false;
   }
 
+  // Returns the size the file had while it was compressed, if WasCompressed() is true and the
+  // size is known.
+  virtual std::optional<size_t> GetCompressedSize() {
+    return {};
+  }
+
  private:
   // Any segments created from this IFile need to be owned by this IFile, so
   // keep them
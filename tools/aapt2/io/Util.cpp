@@ -57,8 +57,30 @@ bool CopyFileToArchive(IAaptContext* context, io::IFile* file, std::string_view
 
 bool CopyFileToArchivePreserveCompression(IAaptContext* context, io::IFile* file,
                                           std::string_view out_path, IArchiveWriter* writer) {
-  uint32_t compression_flags = file->WasCompressed() ? ArchiveEntry::kCompress : 0u;
-  return CopyFileToArchive(context, file, out_path, compression_flags, writer);
+  std::unique_ptr<io::IData> data = file->OpenAsData();
+  return CopyFileToArchivePreserveCompression(context, file, data.get(), out_path, writer);
+}
+
+bool CopyFileToArchivePreserveCompression(IAaptContext* context, io::IFile* file,
+                                          io::IData* data, std::string_view out_path,
+                                          IArchiveWriter* writer) {
+  TRACE_CALL();
+  if (!data) {
+    context->GetDiagnostics()->Error(android::DiagMessage(file->GetSource())
+                                     << "failed to open file");
+    return false;
+  }
+
+  uint32_t compression_flags = 0u;
+  if (file->WasCompressed()) {
+    // The writer would deflate the file again only to find out that it is stored better, and
+    // write it a second time. Its previous compressed size already tells.
+    std::optional<size_t> compressed_size = file->GetCompressedSize();
+    if (!compressed_size || IsCompressedEnough(compressed_size.value(), data->size())) {
+      compression_flags = ArchiveEntry::kCompress;
+    }
+  }
+  return CopyInputStreamToArchive(context, data, out_path, compression_flags, writer);
 }
 
 bool CopyProtoToArchive(IAaptContext* context, ::google::protobuf::Message* proto_msg,
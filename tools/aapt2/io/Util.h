@@ -38,6 +38,11 @@ bool CopyFileToArchive(IAaptContext* context, IFile* file, std::string_view out_
 bool CopyFileToArchivePreserveCompression(IAaptContext* context, IFile* file,
                                           std::string_view out_path, IArchiveWriter* writer);
 
+// Same as above, for when the contents of `file` were already opened as `data`. A null `data`
+// means opening the file failed.
+bool CopyFileToArchivePreserveCompression(IAaptContext* context, IFile* file, IData* data,
+                                          std::string_view out_path, IArchiveWriter* writer);
+
 bool CopyProtoToArchive(IAaptContext* context, ::google::protobuf::Message* proto_msg,
                         std::string_view out_path, uint32_t compression_flags,
                         IArchiveWriter* writer);
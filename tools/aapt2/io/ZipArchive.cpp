@@ -75,6 +75,13 @@ bool ZipFile::WasCompressed() {
   return zip_entry_.method != kCompressStored;
 }
 
+std::optional<size_t> ZipFile::GetCompressedSize() {
+  if (!WasCompressed()) {
+    return {};
+  }
+  return zip_entry_.compressed_length;
+}
+
 ZipFileCollectionIterator::ZipFileCollectionIterator(
     ZipFileCollection* collection)
     : current_(collection->files_.begin()), end_(collection->files_.end()) {}
@@ -34,6 +34,10 @@ namespace aapt {
 class ResourceTable;
 class ResourceEntry;
 
+namespace ResourceUtils {
+class ItemForAttributeCache;
+}  // namespace ResourceUtils
+
 // Defines the context in which a resource value is defined. Most resources are defined with the
 // implicit package name of their compilation context. Understanding the package name of a resource
 // allows to determine visibility of other symbols which may or may not have their packages defined.
@@ -132,9 +136,14 @@ class XmlNamespaceRemover : public IXmlResourceConsumer {
 
 // Resolves attributes in the XmlResource and compiles string values to resource values.
 // Once an XmlResource is processed by this linker, it is ready to be flattened.
+//
+// The optional `item_cache` is used to compile the string values, and can be shared by the linkers
+// of all the XML files of a link.
 class XmlReferenceLinker : public IXmlResourceConsumer {
  public:
-  explicit XmlReferenceLinker(ResourceTable* table) : table_(table) {
+  explicit XmlReferenceLinker(ResourceTable* table,
+                              ResourceUtils::ItemForAttributeCache* item_cache = nullptr)
+      : table_(table), item_cache_(item_cache) {
   }
 
   bool Consume(IAaptContext* context, xml::XmlResource* resource) override;
@@ -142,6 +151,7 @@ class XmlReferenceLinker : public IXmlResourceConsumer {
  private:
   DISALLOW_COPY_AND_ASSIGN(XmlReferenceLinker);
   ResourceTable* table_;
+  ResourceUtils::ItemForAttributeCache* item_cache_;
 };
 
 }  // namespace aapt
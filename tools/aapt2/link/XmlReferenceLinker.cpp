@@ -37,11 +37,13 @@ class XmlVisitor : public xml::PackageAwareVisitor {
   using xml::PackageAwareVisitor::Visit;
 
   XmlVisitor(const android::Source& source, android::StringPool* pool, const CallSite& callsite,
-             IAaptContext* context, ResourceTable* table, SymbolTable* symbols)
+             IAaptContext* context, ResourceTable* table, SymbolTable* symbols,
+             ResourceUtils::ItemForAttributeCache* item_cache)
       : source_(source),
         callsite_(callsite),
         context_(context),
         symbols_(symbols),
+        item_cache_(item_cache),
         reference_transformer_(callsite, context, symbols, pool, table, this) {
   }
 
@@ -90,7 +92,9 @@ class XmlVisitor : public xml::PackageAwareVisitor {
         attribute = &attr.compiled_attribute.value().attribute;
       }
 
-      attr.compiled_value = ResourceUtils::TryParseItemForAttribute(attr.value, attribute);
+      attr.compiled_value =
+          item_cache_ ? item_cache_->TryParseItemForAttribute(attr.value, attribute)
+                      : ResourceUtils::TryParseItemForAttribute(attr.value, attribute);
       if (attr.compiled_value) {
         // With a compiledValue, we must resolve the reference and assign it an ID.
         attr.compiled_value->SetSource(source);
@@ -120,6 +124,7 @@ class XmlVisitor : public xml::PackageAwareVisitor {
   const CallSite& callsite_;
   IAaptContext* context_;
   SymbolTable* symbols_;
+  ResourceUtils::ItemForAttributeCache* item_cache_;
 
   ReferenceLinkerTransformer reference_transformer_;
   bool error_ = false;
@@ -141,7 +146,7 @@ bool XmlReferenceLinker::Consume(IAaptContext* context, xml::XmlResource* resour
   }
 
   XmlVisitor visitor(resource->file.source, &resource->string_pool, callsite, context, table_,
-                     context->GetExternalSymbols());
+                     context->GetExternalSymbols(), item_cache_);
   if (resource->root) {
     resource->root->Accept(&visitor);
     return !visitor.HasError();
@@ -17,8 +17,11 @@
 #include "MultiApkGenerator.h"
 
 #include <algorithm>
+#include <atomic>
 #include <regex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "androidfw/ConfigDescription.h"
 #include "androidfw/StringPiece.h"
@@ -130,14 +133,9 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
   std::unordered_set<std::string> artifacts_to_keep = options.kept_artifacts;
   std::unordered_set<std::string> filtered_artifacts;
   std::unordered_set<std::string> kept_artifacts;
+  std::vector<const OutputArtifact*> artifacts;
 
-  // For now, just write out the stripped APK since ABI splitting doesn't modify anything else.
   for (const OutputArtifact& artifact : options.apk_artifacts) {
-    FilterChain filters;
-
-    ContextWrapper wrapped_context{context_};
-    wrapped_context.SetSource(artifact.name);
-
     if (!options.kept_artifacts.empty()) {
       const auto& it = artifacts_to_keep.find(artifact.name);
       if (it == artifacts_to_keep.end()) {
@@ -152,43 +150,7 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
         kept_artifacts.insert(artifact.name);
       }
     }
-
-    std::unique_ptr<ResourceTable> table =
-        FilterTable(context_, artifact, *apk_->GetResourceTable(), &filters);
-    if (!table) {
-      return false;
-    }
-
-    android::IDiagnostics* diag = wrapped_context.GetDiagnostics();
-
-    std::unique_ptr<XmlResource> manifest;
-    if (!UpdateManifest(artifact, &manifest, diag)) {
-      diag->Error(android::DiagMessage()
-                  << "could not update AndroidManifest.xml for output artifact");
-      return false;
-    }
-
-    std::string out = options.out_dir;
-    if (!file::mkdirs(out)) {
-      diag->Warn(android::DiagMessage() << "could not create out dir: " << out);
-    }
-    file::AppendPath(&out, artifact.name);
-
-    if (context_->IsVerbose()) {
-      diag->Note(android::DiagMessage() << "Generating split: " << out);
-    }
-
-    std::unique_ptr<IArchiveWriter> writer = CreateZipFileArchiveWriter(diag, out);
-
-    if (context_->IsVerbose()) {
-      diag->Note(android::DiagMessage() << "Writing output: " << out);
-    }
-
-    filters.AddFilter(util::make_unique<SignatureFilter>());
-    if (!apk_->WriteToArchive(&wrapped_context, table.get(), options.table_flattener_options,
-                              &filters, writer.get(), manifest.get())) {
-      return false;
-    }
+    artifacts.push_back(&artifact);
   }
 
   // Make sure all of the requested artifacts were valid. If there are any kept artifacts left,
@@ -218,7 +180,95 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
     return false;
   }
 
-  return true;
+  if (!file::mkdirs(options.out_dir)) {
+    context_->GetDiagnostics()->Warn(android::DiagMessage()
+                                     << "could not create out dir: " << options.out_dir);
+  }
+
+  if (options.jobs <= 1 || artifacts.size() <= 1) {
+    for (const OutputArtifact* artifact : artifacts) {
+      if (!GenerateArtifact(context_, *artifact, options)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Every artifact works on its own clone of the table and manifest, so the only state the jobs
+  // share is the base APK, which they only read. The jobs are already busy with artifacts, so each
+  // writes its own on a single thread.
+  MultiApkGeneratorOptions job_options = options;
+  job_options.table_flattener_options.jobs = 1;
+  std::vector<std::unique_ptr<BufferedDiagnostics>> diagnostics(artifacts.size());
+  std::atomic<size_t> next_artifact = 0;
+  std::atomic<bool> error = false;
+  auto worker = [&]() {
+    for (size_t i = next_artifact++; i < artifacts.size() && !error; i = next_artifact++) {
+      diagnostics[i] = util::make_unique<BufferedDiagnostics>();
+      JobContext job_context(context_, diagnostics[i].get());
+      if (!GenerateArtifact(&job_context, *artifacts[i], job_options)) {
+        error = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t thread_count = std::min(options.jobs, artifacts.size());
+  for (size_t i = 0; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // Report in the order of the configuration, regardless of which job finished first.
+  for (const std::unique_ptr<BufferedDiagnostics>& diag : diagnostics) {
+    if (diag) {
+      diag->WriteTo(context_->GetDiagnostics());
+    }
+  }
+  return !error;
+}
+
+bool MultiApkGenerator::GenerateArtifact(IAaptContext* context, const OutputArtifact& artifact,
+                                         const MultiApkGeneratorOptions& options) {
+  FilterChain filters;
+
+  ContextWrapper wrapped_context{context};
+  wrapped_context.SetSource(artifact.name);
+
+  // For now, just write out the stripped APK since ABI splitting doesn't modify anything else.
+  std::unique_ptr<ResourceTable> table =
+      FilterTable(context, artifact, *apk_->GetResourceTable(), &filters);
+  if (!table) {
+    return false;
+  }
+
+  android::IDiagnostics* diag = wrapped_context.GetDiagnostics();
+
+  std::unique_ptr<XmlResource> manifest;
+  if (!UpdateManifest(artifact, &manifest, diag)) {
+    diag->Error(android::DiagMessage()
+                << "could not update AndroidManifest.xml for output artifact");
+    return false;
+  }
+
+  std::string out = options.out_dir;
+  file::AppendPath(&out, artifact.name);
+
+  if (context->IsVerbose()) {
+    diag->Note(android::DiagMessage() << "Generating split: " << out);
+  }
+
+  std::unique_ptr<IArchiveWriter> writer = CreateZipFileArchiveWriter(diag, out);
+
+  if (context->IsVerbose()) {
+    diag->Note(android::DiagMessage() << "Writing output: " << out);
+  }
+
+  filters.AddFilter(util::make_unique<SignatureFilter>());
+  return apk_->WriteToArchive(&wrapped_context, table.get(), options.table_flattener_options,
+                              &filters, writer.get(), manifest.get());
 }
 
 std::unique_ptr<ResourceTable> MultiApkGenerator::FilterTable(IAaptContext* context,
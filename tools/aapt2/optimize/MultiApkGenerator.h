@@ -34,6 +34,8 @@ struct MultiApkGeneratorOptions {
   std::vector<configuration::OutputArtifact> apk_artifacts;
   TableFlattenerOptions table_flattener_options;
   std::unordered_set<std::string> kept_artifacts;
+  // Number of artifacts to generate at the same time.
+  size_t jobs = 1;
 };
 
 /**
@@ -61,6 +63,13 @@ class MultiApkGenerator {
     return context_->GetDiagnostics();
   }
 
+  /**
+   * Filters the base APK for a single artifact and writes it to the output directory. Only reads
+   * the base APK, so several artifacts can be generated at once on different contexts.
+   */
+  bool GenerateArtifact(IAaptContext* context, const configuration::OutputArtifact& artifact,
+                        const MultiApkGeneratorOptions& options);
+
   bool UpdateManifest(const configuration::OutputArtifact& artifact,
                       std::unique_ptr<xml::XmlResource>* updated_manifest,
                       android::IDiagnostics* diag);
@@ -23,13 +23,16 @@
 
 #include "LoadedApk.h"
 #include "ResourceTable.h"
+#include "ResourceUtils.h"
 #include "configuration/ConfigurationParser.h"
 #include "filter/Filter.h"
 #include "format/Archive.h"
 #include "format/binary/TableFlattener.h"
+#include "io/FileSystem.h"
 #include "process/IResourceTableConsumer.h"
 #include "test/Context.h"
 #include "test/Test.h"
+#include "util/Files.h"
 
 using ::android::ConfigDescription;
 
@@ -180,5 +183,37 @@ TEST_F(MultiApkGeneratorTest, VersionFilterNoVersion) {
   EXPECT_THAT(GetValue<Id>(new_table, "android:string/one"), NotNull());
 }
 
+TEST_F(MultiApkGeneratorTest, GeneratesArtifactsInParallel) {
+  std::unique_ptr<xml::XmlResource> manifest = test::BuildXmlDom(R"(
+      <manifest xmlns:android="http://schemas.android.com/apk/res/android"
+          package="com.app" android:versionCode="1">
+        <uses-sdk android:minSdkVersion="19" />
+      </manifest>)");
+  manifest->root->FindAttribute(xml::kSchemaAndroid, "versionCode")->compiled_value =
+      ResourceUtils::TryParseInt("1");
+
+  LoadedApk apk = {{"test.apk"}, util::make_unique<io::FileCollection>(), BuildTable(),
+                   std::move(manifest), kBinary};
+  std::unique_ptr<IAaptContext> ctx = test::ContextBuilder().SetMinSdkVersion(19).Build();
+
+  MultiApkGeneratorOptions options;
+  options.out_dir = file::BuildPath({testing::TempDir(), "multi_apk_parallel"});
+  options.apk_artifacts.push_back(
+      test::ArtifactBuilder().SetName("mdpi.apk").AddDensity(mdpi_).Build());
+  options.apk_artifacts.push_back(
+      test::ArtifactBuilder().SetName("xhdpi.apk").AddDensity(xhdpi_).Build());
+  options.apk_artifacts.push_back(
+      test::ArtifactBuilder().SetName("v21.apk").SetAndroidSdk(21).Build());
+  options.jobs = 3;
+
+  MultiApkGenerator generator{&apk, ctx.get()};
+  ASSERT_TRUE(generator.FromBaseApk(options));
+
+  for (const OutputArtifact& artifact : options.apk_artifacts) {
+    EXPECT_THAT(file::GetFileType(file::BuildPath({options.out_dir, artifact.name})),
+                Eq(file::FileType::kRegular));
+  }
+}
+
 }  // namespace
 }  // namespace aapt
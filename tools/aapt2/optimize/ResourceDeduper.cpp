@@ -17,10 +17,15 @@
 #include "optimize/ResourceDeduper.h"
 
 #include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
 
 #include "DominatorTree.h"
 #include "ResourceTable.h"
+#include "ResourceValues.h"
 #include "trace/TraceBuffer.h"
+#include "utils/JenkinsHash.h"
 
 using android::ConfigDescription;
 
@@ -28,6 +33,70 @@ namespace aapt {
 
 namespace {
 
+uint32_t HashString(const std::string& str) {
+  return static_cast<uint32_t>(std::hash<std::string>()(str));
+}
+
+uint32_t HashReference(const Reference& ref) {
+  uint32_t hash = android::JenkinsHashMix(0, static_cast<uint32_t>(ref.reference_type));
+  hash = android::JenkinsHashMix(hash, ref.id.value_or(ResourceId(0)).id);
+  return android::JenkinsHashMix(hash, ref.name ? HashString(ref.name.value().entry) : 0);
+}
+
+uint32_t HashItem(const Item* item);
+
+// Hashes a part of what Value::Equals() compares, so values with different hashes are never
+// equal and most values that are not equal have different hashes.
+uint32_t HashValue(const Value* value) {
+  if (auto item = ValueCast<Item>(value)) {
+    return HashItem(item);
+  } else if (auto style = ValueCast<Style>(value)) {
+    // Style entries are compared regardless of their order.
+    uint32_t entries_hash = 0;
+    for (const Style::Entry& entry : style->entries) {
+      entries_hash +=
+          android::JenkinsHashMix(HashReference(entry.key), HashItem(entry.value.get()));
+    }
+    uint32_t hash = android::JenkinsHashMix(1, static_cast<uint32_t>(style->entries.size()));
+    hash = android::JenkinsHashMix(hash, style->parent ? HashReference(style->parent.value()) : 0);
+    return android::JenkinsHashMix(hash, entries_hash);
+  } else if (auto array = ValueCast<Array>(value)) {
+    uint32_t hash = android::JenkinsHashMix(2, static_cast<uint32_t>(array->elements.size()));
+    for (const std::unique_ptr<Item>& element : array->elements) {
+      hash = android::JenkinsHashMix(hash, HashItem(element.get()));
+    }
+    return hash;
+  } else if (auto plural = ValueCast<Plural>(value)) {
+    uint32_t hash = 3;
+    for (const std::unique_ptr<Item>& plural_value : plural->values) {
+      hash = android::JenkinsHashMix(hash, plural_value ? HashItem(plural_value.get()) : 0);
+    }
+    return hash;
+  }
+  // Attributes, styleables and macros are rare enough to always be compared.
+  return 4;
+}
+
+uint32_t HashItem(const Item* item) {
+  if (auto str = ValueCast<String>(item)) {
+    return android::JenkinsHashMix(5, HashString(*str->value));
+  } else if (auto styled_str = ValueCast<StyledString>(item)) {
+    return android::JenkinsHashMix(6, HashString(styled_str->value->value));
+  } else if (auto raw_str = ValueCast<RawString>(item)) {
+    return android::JenkinsHashMix(7, HashString(*raw_str->value));
+  } else if (auto file = ValueCast<FileReference>(item)) {
+    return android::JenkinsHashMix(8, HashString(*file->path));
+  } else if (auto prim = ValueCast<BinaryPrimitive>(item)) {
+    uint32_t hash = android::JenkinsHashMix(9, prim->value.dataType);
+    return android::JenkinsHashMix(hash, prim->value.data);
+  } else if (auto ref = ValueCast<Reference>(item)) {
+    return android::JenkinsHashMix(10, HashReference(*ref));
+  } else if (ValueCast<Id>(item)) {
+    return 11;
+  }
+  return 12;
+}
+
 /**
  * Remove duplicated key-value entries from dominated resources.
  *
@@ -44,7 +113,15 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
   using Node = DominatorTree::Node;
 
   explicit DominatedKeyValueRemover(IAaptContext* context, ResourceEntry* entry)
-      : context_(context), entry_(entry) {}
+      : context_(context), entry_(entry) {
+    // Entries with hundreds of configurations compare every value with every sibling, a hash
+    // comparison first tells most of the values that differ apart without calling Equals().
+    value_hashes_.reserve(entry->values.size());
+    for (const auto& config_value : entry->values) {
+      value_hashes_.emplace(config_value.get(),
+                            config_value->value ? HashValue(config_value->value.get()) : 0);
+    }
+  }
 
   void VisitConfig(Node* node) {
     Node* parent = node->parent();
@@ -56,7 +133,7 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
     if (!node_value || !parent_value) {
       return;
     }
-    if (!node_value->value->Equals(parent_value->value.get())) {
+    if (!ValuesEqual(node_value, parent_value)) {
       return;
     }
 
@@ -70,7 +147,7 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
         continue;
       }
       if (node_configuration.IsCompatibleWith(sibling_value->config) &&
-          !node_value->value->Equals(sibling_value->value.get())) {
+          !ValuesEqual(node_value, sibling_value)) {
         // The configurations are compatible, but the value is
         // different, so we can't remove this value.
         return;
@@ -89,8 +166,13 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
  private:
   DISALLOW_COPY_AND_ASSIGN(DominatedKeyValueRemover);
 
+  bool ValuesEqual(const ResourceConfigValue* a, const ResourceConfigValue* b) const {
+    return value_hashes_.at(a) == value_hashes_.at(b) && a->value->Equals(b->value.get());
+  }
+
   IAaptContext* context_;
   ResourceEntry* entry_;
+  std::unordered_map<const ResourceConfigValue*, uint32_t> value_hashes_;
 };
 
 static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
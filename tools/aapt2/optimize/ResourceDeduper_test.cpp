@@ -17,6 +17,7 @@
 #include "optimize/ResourceDeduper.h"
 
 #include "ResourceTable.h"
+#include "ResourceUtils.h"
 #include "test/Test.h"
 
 using ::aapt::test::HasValue;
@@ -173,4 +174,35 @@ TEST(ResourceDeduperTest, MccMncValuesAreKept) {
 }
 
 
+TEST(ResourceDeduperTest, StylesWithReorderedItemsAreDeduped) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  const ConfigDescription default_config = {};
+  const ConfigDescription land_config = test::ParseConfigOrDie("land");
+  const ConfigDescription port_config = test::ParseConfigOrDie("port");
+
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddValue("android:style/Theme", default_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/bar", ResourceUtils::TryParseInt("2"))
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                        .Build())
+          .AddValue("android:style/Theme", land_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                        .AddItem("android:attr/bar", ResourceUtils::TryParseInt("2"))
+                        .Build())
+          .AddValue("android:style/Theme", port_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                        .AddItem("android:attr/bar", ResourceUtils::TryParseInt("3"))
+                        .Build())
+          .Build();
+
+  ASSERT_TRUE(ResourceDeduper().Consume(context.get(), table.get()));
+  EXPECT_THAT(table, HasValue("android:style/Theme", default_config));
+  EXPECT_THAT(table, Not(HasValue("android:style/Theme", land_config)));
+  EXPECT_THAT(table, HasValue("android:style/Theme", port_config));
+}
+
 }  // namespace aapt
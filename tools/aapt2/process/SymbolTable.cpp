@@ -16,7 +16,11 @@
 
 #include "process/SymbolTable.h"
 
+#include <sys/stat.h>
+
 #include <iostream>
+#include <map>
+#include <string>
 
 #include "android-base/logging.h"
 #include "android-base/stringprintf.h"
@@ -41,10 +45,7 @@ using ::android::StringPiece16;
 namespace aapt {
 
 SymbolTable::SymbolTable(NameMangler* mangler)
-    : mangler_(mangler),
-      delegate_(util::make_unique<DefaultSymbolTableDelegate>()),
-      cache_(200),
-      id_cache_(200) {
+    : mangler_(mangler), delegate_(util::make_unique<DefaultSymbolTableDelegate>()) {
 }
 
 void SymbolTable::SetDelegate(std::unique_ptr<ISymbolTableDelegate> delegate) {
@@ -52,10 +53,11 @@ void SymbolTable::SetDelegate(std::unique_ptr<ISymbolTableDelegate> delegate) {
   delegate_ = std::move(delegate);
 
   // Clear the cache in case this delegate changes the order of lookup.
-  cache_.clear();
+  ClearNameCache();
 }
 
 void SymbolTable::AppendSource(std::unique_ptr<ISymbolSource> source) {
+  std::lock_guard<std::mutex> lock(sources_lock_);
   sources_.push_back(std::move(source));
 
   // We do not clear the cache, because sources earlier in the list take
@@ -63,13 +65,35 @@ void SymbolTable::AppendSource(std::unique_ptr<ISymbolSource> source) {
 }
 
 void SymbolTable::PrependSource(std::unique_ptr<ISymbolSource> source) {
-  sources_.insert(sources_.begin(), std::move(source));
+  {
+    std::lock_guard<std::mutex> lock(sources_lock_);
+    sources_.insert(sources_.begin(), std::move(source));
+  }
 
   // We must clear the cache in case we did a lookup before adding this
   // resource.
-  cache_.clear();
+  ClearNameCache();
+}
+
+SymbolTable::CacheShard& SymbolTable::GetShard(const ResourceName& name) {
+  return cache_shards_[hash_type(name) % kCacheShardCount];
+}
+
+SymbolTable::CacheShard& SymbolTable::GetShard(const ResourceId& id) {
+  return cache_shards_[hash_type(id) % kCacheShardCount];
+}
+
+void SymbolTable::ClearNameCache() {
+  for (CacheShard& shard : cache_shards_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.cache.clear();
+  }
 }
 
+// Keeps the last symbol returned to each thread alive, in case another thread evicts it from the
+// cache while it is in use.
+static thread_local std::shared_ptr<SymbolTable::Symbol> sLastSymbol;
+
 const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
   const ResourceName* name_with_package = &name;
 
@@ -83,8 +107,13 @@ const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
   }
 
   // We store the name unmangled in the cache, so look it up as-is.
-  if (const std::shared_ptr<Symbol>& s = cache_.get(*name_with_package)) {
-    return s.get();
+  CacheShard& shard = GetShard(*name_with_package);
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (const std::shared_ptr<Symbol>& s = shard.cache.get(*name_with_package)) {
+      sLastSymbol = s;
+      return s.get();
+    }
   }
 
   // The name was not found in the cache. Mangle it (if necessary) and find it in our sources.
@@ -96,7 +125,11 @@ const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
     mangled_name = &mangled_name_impl.value();
   }
 
-  std::unique_ptr<Symbol> symbol = delegate_->FindByName(*mangled_name, sources_);
+  std::unique_ptr<Symbol> symbol;
+  {
+    std::lock_guard<std::mutex> lock(sources_lock_);
+    symbol = delegate_->FindByName(*mangled_name, sources_);
+  }
   if (symbol == nullptr) {
     return nullptr;
   }
@@ -107,25 +140,40 @@ const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
 
   // Since we look in the cache with the unmangled, but package prefixed
   // name, we must put the same name into the cache.
-  cache_.put(*name_with_package, shared_symbol);
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.cache.put(*name_with_package, shared_symbol);
+  }
 
   if (shared_symbol->id) {
     // The symbol has an ID, so we can also cache this!
-    id_cache_.put(shared_symbol->id.value(), shared_symbol);
+    CacheShard& id_shard = GetShard(shared_symbol->id.value());
+    std::lock_guard<std::mutex> lock(id_shard.lock);
+    id_shard.id_cache.put(shared_symbol->id.value(), shared_symbol);
   }
 
   // Returns the raw pointer. Callers are not expected to hold on to this
   // between calls to Find*.
+  sLastSymbol = shared_symbol;
   return shared_symbol.get();
 }
 
 const SymbolTable::Symbol* SymbolTable::FindById(const ResourceId& id) {
-  if (const std::shared_ptr<Symbol>& s = id_cache_.get(id)) {
-    return s.get();
+  CacheShard& shard = GetShard(id);
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (const std::shared_ptr<Symbol>& s = shard.id_cache.get(id)) {
+      sLastSymbol = s;
+      return s.get();
+    }
   }
 
   // We did not find it in the cache, so look through the sources.
-  std::unique_ptr<Symbol> symbol = delegate_->FindById(id, sources_);
+  std::unique_ptr<Symbol> symbol;
+  {
+    std::lock_guard<std::mutex> lock(sources_lock_);
+    symbol = delegate_->FindById(id, sources_);
+  }
   if (symbol == nullptr) {
     return nullptr;
   }
@@ -133,10 +181,14 @@ const SymbolTable::Symbol* SymbolTable::FindById(const ResourceId& id) {
   // Take ownership of the symbol into a shared_ptr. We do this because LruCache
   // doesn't support unique_ptr.
   std::shared_ptr<Symbol> shared_symbol(std::move(symbol));
-  id_cache_.put(id, shared_symbol);
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.id_cache.put(id, shared_symbol);
+  }
 
   // Returns the raw pointer. Callers are not expected to hold on to this
   // between calls to Find*.
+  sLastSymbol = shared_symbol;
   return shared_symbol.get();
 }
 
@@ -218,9 +270,82 @@ std::unique_ptr<SymbolTable::Symbol> ResourceTableSymbolSource::FindByName(
   return symbol;
 }
 
+namespace {
+
+struct CachedApkAssets {
+  android::AssetManager2::ApkAssetsPtr apk_assets;
+
+  // What the file looked like when it was loaded. ApkAssets::IsUpToDate() only checks the open
+  // file, which misses the file being replaced by a new one.
+  off_t size;
+  time_t mtime;
+  long mtime_nsec;
+  ino_t inode;
+};
+
+// Files rewritten within the same second keep their st_mtime, so compare the nanoseconds too where
+// the platform records them.
+long GetMtimeNsec(const struct stat& sb) {
+#if defined(__APPLE__)
+  return sb.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  return 0;
+#else
+  return sb.st_mtim.tv_nsec;
+#endif
+}
+
+struct ApkAssetsCache {
+  std::mutex lock;
+  bool enabled = false;
+  std::map<std::string, CachedApkAssets> entries;
+};
+
+ApkAssetsCache& GetApkAssetsCache() {
+  static ApkAssetsCache* cache = new ApkAssetsCache();
+  return *cache;
+}
+
+android::AssetManager2::ApkAssetsPtr LoadApkAssets(const std::string& path) {
+  ApkAssetsCache& cache = GetApkAssetsCache();
+  std::lock_guard<std::mutex> lock(cache.lock);
+  struct stat sb;
+  if (!cache.enabled || stat(path.c_str(), &sb) != 0) {
+    return ApkAssets::Load(path);
+  }
+
+  auto iter = cache.entries.find(path);
+  if (iter != cache.entries.end()) {
+    const CachedApkAssets& cached = iter->second;
+    if (cached.size == sb.st_size && cached.mtime == sb.st_mtime &&
+        cached.mtime_nsec == GetMtimeNsec(sb) && cached.inode == sb.st_ino) {
+      return cached.apk_assets;
+    }
+    cache.entries.erase(iter);
+  }
+
+  android::AssetManager2::ApkAssetsPtr apk = ApkAssets::Load(path);
+  if (apk) {
+    cache.entries.emplace(
+        path, CachedApkAssets{apk, sb.st_size, sb.st_mtime, GetMtimeNsec(sb), sb.st_ino});
+  }
+  return apk;
+}
+
+}  // namespace
+
+void AssetManagerSymbolSource::SetApkAssetsCacheEnabled(bool enabled) {
+  ApkAssetsCache& cache = GetApkAssetsCache();
+  std::lock_guard<std::mutex> lock(cache.lock);
+  cache.enabled = enabled;
+  if (!enabled) {
+    cache.entries.clear();
+  }
+}
+
 bool AssetManagerSymbolSource::AddAssetPath(StringPiece path) {
   TRACE_CALL();
-  if (auto apk = ApkAssets::Load(path.data())) {
+  if (auto apk = LoadApkAssets(std::string(path))) {
     apk_assets_.push_back(std::move(apk));
     asset_manager_.SetApkAssets(apk_assets_);
     return true;
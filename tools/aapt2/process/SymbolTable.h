@@ -18,7 +18,9 @@
 #define AAPT_PROCESS_SYMBOLTABLE_H
 
 #include <algorithm>
+#include <array>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "android-base/macros.h"
@@ -86,6 +88,10 @@ class SymbolTable {
   // cause the existing cache to be cleared.
   void PrependSource(std::unique_ptr<ISymbolSource> source);
 
+  // The FindByXXX methods may be called from several threads at once. A result stays valid until
+  // the next FindByXXX call made by the same thread. Cached symbols are found without waiting for
+  // lookups of other symbols.
+
   // NOTE: Never hold on to the result between calls to FindByXXX. The
   // results are stored in a cache which may evict entries on subsequent calls.
   const Symbol* FindByName(const ResourceName& name);
@@ -101,14 +107,32 @@ class SymbolTable {
   const Symbol* FindByReference(const Reference& ref);
 
  private:
+  static constexpr size_t kCacheShardCount = 16;
+  static constexpr uint32_t kCacheShardCapacity = 64;
+
+  // A part of the cache, with its own lock. Which shard a symbol is cached in depends on the hash
+  // of its name, or of its ID in the ID cache.
+  struct CacheShard {
+    std::mutex lock;
+
+    // We use shared_ptr because unique_ptr is not supported and
+    // we need automatic deletion.
+    android::LruCache<ResourceName, std::shared_ptr<Symbol>> cache{kCacheShardCapacity};
+    android::LruCache<ResourceId, std::shared_ptr<Symbol>> id_cache{kCacheShardCapacity};
+  };
+
+  CacheShard& GetShard(const ResourceName& name);
+  CacheShard& GetShard(const ResourceId& id);
+  void ClearNameCache();
+
   NameMangler* mangler_;
   std::unique_ptr<ISymbolTableDelegate> delegate_;
+
+  // Guards the sources, which are not safe to query concurrently.
+  std::mutex sources_lock_;
   std::vector<std::unique_ptr<ISymbolSource>> sources_;
 
-  // We use shared_ptr because unique_ptr is not supported and
-  // we need automatic deletion.
-  android::LruCache<ResourceName, std::shared_ptr<Symbol>> cache_;
-  android::LruCache<ResourceId, std::shared_ptr<Symbol>> id_cache_;
+  std::array<CacheShard, kCacheShardCount> cache_shards_;
 
   DISALLOW_COPY_AND_ASSIGN(SymbolTable);
 };
@@ -192,6 +216,11 @@ class AssetManagerSymbolSource : public ISymbolSource {
  public:
   AssetManagerSymbolSource() = default;
 
+  // When enabled, the APKs loaded by AddAssetPath stay loaded after their sources are destroyed
+  // and are reused by later sources that add the same path, as long as the file has not changed
+  // on disk. The daemon command enables this so that only its first link loads android.jar.
+  static void SetApkAssetsCacheEnabled(bool enabled);
+
   bool AddAssetPath(android::StringPiece path);
   std::map<size_t, std::string> GetAssignedPackageIds() const;
   bool IsPackageDynamic(uint32_t packageId, const std::string& package_name) const;
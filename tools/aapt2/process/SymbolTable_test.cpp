@@ -16,6 +16,10 @@
 
 #include "process/SymbolTable.h"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "SdkConstants.h"
 #include "androidfw/BigBuffer.h"
 #include "format/binary/TableFlattener.h"
@@ -76,6 +80,40 @@ TEST(SymbolTableTest, FindByName) {
   EXPECT_THAT(symbol_table.FindByName(test::ParseNameOrDie("com.android.lib:id/foo")), NotNull());
 }
 
+TEST(SymbolTableTest, ConcurrentLookups) {
+  // More symbols than the cache holds, so that the threads evict each other's results.
+  constexpr int kSymbolCount = 2000;
+  test::ResourceTableBuilder builder;
+  for (int i = 0; i < kSymbolCount; i++) {
+    builder.AddSimple("com.android.app:id/foo" + std::to_string(i), ResourceId(0x7f010000 + i));
+  }
+  std::unique_ptr<ResourceTable> table = builder.Build();
+
+  NameMangler mangler(NameManglerPolicy{"com.android.app"});
+  SymbolTable symbol_table(&mangler);
+  symbol_table.AppendSource(util::make_unique<ResourceTableSymbolSource>(table.get()));
+
+  std::atomic<int> mismatches = 0;
+  auto look_up_all = [&]() {
+    for (int i = 0; i < kSymbolCount; i++) {
+      const SymbolTable::Symbol* s =
+          symbol_table.FindByName(test::ParseNameOrDie("id/foo" + std::to_string(i)));
+      if (s == nullptr || s->id != ResourceId(0x7f010000 + i)) {
+        mismatches++;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(look_up_all);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(mismatches.load(), Eq(0));
+}
+
 using SymbolTableTestFixture = CommandTestFixture;
 TEST_F(SymbolTableTestFixture, FindByNameWhenSymbolIsMangledInResTable) {
   using namespace android;
@@ -134,4 +172,47 @@ TEST_F(SymbolTableTestFixture, FindByNameWhenSymbolIsMangledInResTable) {
   EXPECT_THAT(symbol_table.FindByName(test::ParseNameOrDie("com.android.other:id/foo")), IsNull());
 }
 
+TEST_F(SymbolTableTestFixture, ApkAssetsCacheReloadsChangedApk) {
+  StdErrDiagnostics diag;
+  const std::string compiled_files_dir = GetTestPath("compiled");
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/values.xml"),
+      R"(<?xml version="1.0" encoding="utf-8"?>
+         <resources>
+             <item type="id" name="foo"/>
+        </resources>)",
+        compiled_files_dir, &diag));
+
+  const std::string out_apk = GetTestPath("out.apk");
+  std::vector<std::string> link_args = {
+      "--manifest", GetDefaultManifest("com.android.app"),
+      "-o", out_apk,
+  };
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+
+  AssetManagerSymbolSource::SetApkAssetsCacheEnabled(true);
+  AssetManagerSymbolSource first_source;
+  ASSERT_TRUE(first_source.AddAssetPath(out_apk));
+  AssetManagerSymbolSource second_source;
+  ASSERT_TRUE(second_source.AddAssetPath(out_apk));
+  EXPECT_THAT(second_source.GetAssetManager()->GetApkAssets(0).get(),
+              Eq(first_source.GetAssetManager()->GetApkAssets(0).get()));
+
+  ASSERT_TRUE(CompileFile(GetTestPath("res/values/values.xml"),
+      R"(<?xml version="1.0" encoding="utf-8"?>
+         <resources>
+             <item type="id" name="foo"/>
+             <item type="id" name="bar"/>
+        </resources>)",
+        compiled_files_dir, &diag));
+  ASSERT_TRUE(Link(link_args, compiled_files_dir, &diag));
+
+  AssetManagerSymbolSource changed_source;
+  ASSERT_TRUE(changed_source.AddAssetPath(out_apk));
+  EXPECT_THAT(changed_source.GetAssetManager()->GetApkAssets(0).get(),
+              Ne(first_source.GetAssetManager()->GetApkAssets(0).get()));
+  EXPECT_THAT(changed_source.FindByName(test::ParseNameOrDie("com.android.app:id/bar")),
+              NotNull());
+  AssetManagerSymbolSource::SetApkAssetsCacheEnabled(false);
+}
+
 }  // namespace aapt
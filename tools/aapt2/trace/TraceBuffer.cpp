@@ -16,13 +16,22 @@
 
 #include "TraceBuffer.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <unistd.h>
 #include <vector>
 
 #include <inttypes.h>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "android-base/threads.h"
 #include "android-base/utf8.h"
 
 #include "util/Files.h"
@@ -36,12 +45,20 @@ constexpr char kBegin = 'B';
 constexpr char kEnd = 'E';
 
 struct TracePoint {
-  pid_t tid;
+  pid_t pid;
+  uint64_t tid;
   int64_t time;
   std::string tag;
   char type;
+  // How much of the tag names the phase, the rest are its arguments.
+  size_t phase_length;
+  // Process CPU time and peak resident set size when the point was recorded, for profiles.
+  int64_t cpu_time;
+  int64_t peak_rss_kb;
 };
 
+// Guards traces, compile -j records events from several threads.
+std::mutex traces_lock;
 std::vector<TracePoint> traces;
 
 int64_t GetTime() noexcept {
@@ -49,38 +66,194 @@ int64_t GetTime() noexcept {
   return std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
 }
 
-} // namespace anonymous
+// Windows has neither, its profiles report both as 0.
+void GetResourceUsage(int64_t* cpu_time, int64_t* peak_rss_kb) noexcept {
+  *cpu_time = 0;
+  *peak_rss_kb = 0;
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    *cpu_time = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ll +
+                usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#ifdef __APPLE__
+    // macOS reports bytes rather than kilobytes.
+    *peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    *peak_rss_kb = usage.ru_maxrss;
+#endif
+  }
+#endif
+}
 
-void AddWithTime(const std::string& tag, char type, int64_t time) noexcept {
-  TracePoint t = {getpid(), time, tag, type};
-  traces.emplace_back(t);
+// The time spent in one phase, summed over all the times it ran under the same parent phase.
+struct ProfileNode {
+  std::string name;
+  uint64_t count = 0;
+  int64_t wall_time = 0;
+  int64_t cpu_time = 0;
+  int64_t peak_rss_kb = 0;
+  std::vector<std::unique_ptr<ProfileNode>> children;
+
+  ProfileNode* GetChild(const std::string& child_name) {
+    for (auto& child : children) {
+      if (child->name == child_name) {
+        return child.get();
+      }
+    }
+    children.push_back(std::make_unique<ProfileNode>());
+    children.back()->name = child_name;
+    return children.back().get();
+  }
+};
+
+// Tags like "Process ResTable:<path>" name their phase before the ':'.
+std::string GetPhaseName(const TracePoint& point) {
+  return point.tag.substr(0, std::min(point.phase_length, point.tag.find(':')));
 }
 
-void Add(const std::string& tag, char type) noexcept {
-  AddWithTime(tag, type, GetTime());
+// Builds the phase tree from nested begin and end events. Each thread has its own nesting, the
+// outermost phases of worker threads are top level phases.
+ProfileNode BuildProfile(const std::vector<TracePoint>& points, size_t first_point) {
+  struct OpenPhase {
+    ProfileNode* node;
+    const TracePoint* begin;
+  };
+
+  ProfileNode root;
+  std::vector<std::pair<uint64_t, std::vector<OpenPhase>>> thread_stacks;
+  for (size_t i = std::min(first_point, points.size()); i < points.size(); i++) {
+    const TracePoint& point = points[i];
+    std::vector<OpenPhase>* stack = nullptr;
+    for (auto& thread_stack : thread_stacks) {
+      if (thread_stack.first == point.tid) {
+        stack = &thread_stack.second;
+        break;
+      }
+    }
+    if (stack == nullptr) {
+      stack = &thread_stacks.emplace_back(point.tid, std::vector<OpenPhase>()).second;
+    }
+
+    if (point.type == kBegin) {
+      ProfileNode* parent = stack->empty() ? &root : stack->back().node;
+      stack->push_back(OpenPhase{parent->GetChild(GetPhaseName(point)), &point});
+    } else if (!stack->empty()) {
+      const OpenPhase& phase = stack->back();
+      phase.node->count++;
+      phase.node->wall_time += point.time - phase.begin->time;
+      phase.node->cpu_time += point.cpu_time - phase.begin->cpu_time;
+      phase.node->peak_rss_kb = std::max(phase.node->peak_rss_kb, point.peak_rss_kb);
+      stack->pop_back();
+    }
+  }
+  return root;
 }
 
+std::string EscapeJson(const std::string& str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
 
+void WriteProfileJson(FILE* f, const ProfileNode& node, int depth) {
+  const std::string indent(depth * 2, ' ');
+  fprintf(f, "%s{\"name\": \"%s\", \"count\": %" PRIu64 ", \"wall_ms\": %.3f, "
+          "\"cpu_ms\": %.3f, \"peak_rss_kb\": %" PRId64 ", \"children\": [",
+          indent.c_str(), EscapeJson(node.name).c_str(), node.count, node.wall_time / 1000.0,
+          node.cpu_time / 1000.0, node.peak_rss_kb);
+  for (size_t i = 0; i < node.children.size(); i++) {
+    fprintf(f, i == 0 ? "\n" : ",\n");
+    WriteProfileJson(f, *node.children[i], depth + 1);
+  }
+  fprintf(f, node.children.empty() ? "]}" : "\n%s]}", indent.c_str());
+}
 
+void PrintProfileTable(const ProfileNode& node, int depth) {
+  const std::string name = std::string(depth * 2, ' ') + node.name;
+  printf("%-56s %8" PRIu64 " %12.3f %12.3f %14" PRId64 "\n", name.c_str(), node.count,
+         node.wall_time / 1000.0, node.cpu_time / 1000.0, node.peak_rss_kb);
+  for (auto& child : node.children) {
+    PrintProfileTable(*child, depth + 1);
+  }
+}
 
-void Flush(const std::string& basePath) {
-  TRACE_CALL();
-  if (basePath.empty()) {
+void WriteProfile(const std::string& profile_path, const std::vector<TracePoint>& points,
+                  size_t first_point) {
+  const ProfileNode root = BuildProfile(points, first_point);
+  if (profile_path == "-") {
+    printf("%-56s %8s %12s %12s %14s\n", "Phase", "Count", "Wall ms", "CPU ms", "Peak RSS KB");
+    for (auto& phase : root.children) {
+      PrintProfileTable(*phase, 0);
+    }
+    fflush(stdout);
     return;
   }
 
-  std::stringstream s;
-  s << basePath << aapt::file::sDirSep << "report_aapt2_" << getpid() << ".json";
-  FILE* f = android::base::utf8::fopen(s.str().c_str(), "a");
+  FILE* f = android::base::utf8::fopen(profile_path.c_str(), "w");
   if (f == nullptr) {
     return;
   }
-
-  for(const TracePoint& trace : traces) {
-    fprintf(f, "{\"ts\" : \"%" PRIu64 "\", \"ph\" : \"%c\", \"tid\" : \"%d\" , \"pid\" : \"%d\", "
-            "\"name\" : \"%s\" },\n", trace.time, trace.type, 0, trace.tid, trace.tag.c_str());
+  fprintf(f, "{\"phases\": [");
+  for (size_t i = 0; i < root.children.size(); i++) {
+    fprintf(f, i == 0 ? "\n" : ",\n");
+    WriteProfileJson(f, *root.children[i], 1);
   }
+  fprintf(f, "\n]}\n");
   fclose(f);
+}
+
+} // namespace anonymous
+
+void AddWithTime(const std::string& tag, char type, int64_t time,
+                 size_t phase_length = std::string::npos) noexcept {
+  TracePoint t = {getpid(), android::base::GetThreadId(), time, tag, type, phase_length, 0, 0};
+  GetResourceUsage(&t.cpu_time, &t.peak_rss_kb);
+  std::lock_guard<std::mutex> lock(traces_lock);
+  traces.emplace_back(t);
+}
+
+void Add(const std::string& tag, char type,
+         size_t phase_length = std::string::npos) noexcept {
+  AddWithTime(tag, type, GetTime(), phase_length);
+}
+
+// Returns the index the next event will be recorded at.
+size_t NextIndex() {
+  std::lock_guard<std::mutex> lock(traces_lock);
+  return traces.size();
+}
+
+// Events before profileStart were recorded by earlier invocations of a daemon and are left out of
+// the profile.
+void Flush(const std::string& basePath, const std::string& profilePath, size_t profileStart) {
+  TRACE_CALL();
+  if (basePath.empty() && profilePath.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(traces_lock);
+  if (!profilePath.empty()) {
+    WriteProfile(profilePath, traces, profileStart);
+  }
+
+  if (!basePath.empty()) {
+    std::stringstream s;
+    s << basePath << aapt::file::sDirSep << "report_aapt2_" << getpid() << ".json";
+    FILE* f = android::base::utf8::fopen(s.str().c_str(), "a");
+    if (f != nullptr) {
+      for(const TracePoint& trace : traces) {
+        fprintf(f, "{\"ts\" : \"%" PRIu64 "\", \"ph\" : \"%c\", \"tid\" : \"%" PRIu64 "\" , "
+                "\"pid\" : \"%d\", \"name\" : \"%s\" },\n", trace.time, trace.type, trace.tid,
+                trace.pid, trace.tag.c_str());
+      }
+      fclose(f);
+    }
+  }
   traces.clear();
 }
 
@@ -106,7 +279,7 @@ Trace::Trace(const std::string& tag, const std::vector<android::StringPiece>& ar
     s << arg;
     s << " ";
   }
-  tracebuffer::Add(s.str(), tracebuffer::kBegin);
+  tracebuffer::Add(s.str(), tracebuffer::kBegin, tag.size());
 }
 
 Trace::~Trace() {
@@ -127,7 +300,7 @@ FlushTrace::FlushTrace(const std::string& basepath, const std::string& tag,
     s << arg;
     s << " ";
   }
-  tracebuffer::Add(s.str(), tracebuffer::kBegin);
+  tracebuffer::Add(s.str(), tracebuffer::kBegin, tag.size());
 }
 
 FlushTrace::FlushTrace(const std::string& basepath, const std::string& tag,
@@ -139,12 +312,18 @@ FlushTrace::FlushTrace(const std::string& basepath, const std::string& tag,
     s << arg;
     s << " ";
   }
-  tracebuffer::Add(s.str(), tracebuffer::kBegin);
+  tracebuffer::Add(s.str(), tracebuffer::kBegin, tag.size());
+}
+
+FlushTrace::FlushTrace(const std::string& basepath, const std::string& profile_path,
+    const std::string& tag)
+    : basepath_(basepath), profile_path_(profile_path), profile_start_(tracebuffer::NextIndex()) {
+  tracebuffer::Add(tag, tracebuffer::kBegin);
 }
 
 FlushTrace::~FlushTrace() {
   tracebuffer::Add("", tracebuffer::kEnd);
-  tracebuffer::Flush(basepath_);
+  tracebuffer::Flush(basepath_, profile_path_, profile_start_);
 }
 
 } // namespace aapt
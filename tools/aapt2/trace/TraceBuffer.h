@@ -26,7 +26,8 @@ namespace aapt {
 
 // Record timestamps for beginning and end of a task and generate systrace json fragments.
 // This is an in-process ftrace which has the advantage of being platform independent.
-// These methods are NOT thread-safe since aapt2 is not multi-threaded.
+// Events are recorded with the id of the thread that records them, and may be recorded from
+// several threads at once.
 
 // Convenience RIAA object to automatically finish an event when object goes out of scope.
 class Trace {
@@ -42,6 +43,12 @@ void EndTrace();
 
 // A main trace is required to flush events to disk. Events are formatted in systrace
 // json format.
+//
+// When a profile path is given, a summary of the recorded events is written there as well: for
+// each phase, nested the way the phases ran, how often it ran, its wall time, the process CPU time
+// spent while it ran and the peak resident set size by the time it ended. Events whose tags only
+// differ in their arguments or after the first ':', like the ones naming a file, count as the same
+// phase. The summary is JSON, or a table printed to stdout when the path is "-".
 class FlushTrace {
 public:
   explicit FlushTrace(const std::string& basepath, const std::string& tag);
@@ -49,9 +56,13 @@ public:
       const std::vector<android::StringPiece>& args);
   explicit FlushTrace(const std::string& basepath, const std::string& tag,
       const std::vector<std::string>& args);
+  explicit FlushTrace(const std::string& basepath, const std::string& profile_path,
+      const std::string& tag);
   ~FlushTrace();
 private:
   std::string basepath_;
+  std::string profile_path_;
+  size_t profile_start_ = 0;
 };
 
 #define TRACE_CALL() Trace __t(__func__)
@@ -60,5 +71,6 @@ private:
 
 #define TRACE_FLUSH(basename, tag) FlushTrace __t(basename, tag)
 #define TRACE_FLUSH_ARGS(basename, tag, args) FlushTrace __t(basename, tag, args)
+#define TRACE_FLUSH_PROFILE(basename, profile_path, tag) FlushTrace __t(basename, profile_path, tag)
 } // namespace aapt
 #endif //AAPT_TRACEBUFFER_H
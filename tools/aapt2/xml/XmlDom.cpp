@@ -18,6 +18,7 @@
 
 #include <expat.h>
 
+#include <algorithm>
 #include <memory>
 #include <stack>
 #include <string>
@@ -121,15 +122,23 @@ static void XMLCALL StartElementHandler(void* user_data, const char* name, const
 
   SplitName(name, &el->namespace_uri, &el->name);
 
+  // Build the attributes in place, in a vector that is only allocated once. Generated layouts
+  // have many elements with many attributes each.
+  size_t attr_count = 0;
+  while (attrs[attr_count * 2]) {
+    attr_count++;
+  }
+  el->attributes.reserve(el->attributes.size() + attr_count);
   while (*attrs) {
-    Attribute attribute;
+    Attribute& attribute = el->attributes.emplace_back();
     SplitName(*attrs++, &attribute.namespace_uri, &attribute.name);
     attribute.value = *attrs++;
-    el->attributes.push_back(std::move(attribute));
   }
 
   // Sort the attributes.
-  std::sort(el->attributes.begin(), el->attributes.end(), less_attribute);
+  if (!std::is_sorted(el->attributes.begin(), el->attributes.end(), less_attribute)) {
+    std::sort(el->attributes.begin(), el->attributes.end(), less_attribute);
+  }
 
   // Add to the stack.
   Element* this_el = el.get();
@@ -95,7 +95,39 @@ sp<Rule> RuleGenerator::generateAbi(const Vector<abi::Variant>& splitAbis, size_
     return abiRule;
 }
 
-sp<Rule> RuleGenerator::generate(const SortedVector<SplitDescription>& group, size_t index) {
+// The densities and ABIs of a whole group, in the order of the group, or empty if all its splits
+// have the same one.
+struct GroupAxes {
+    Vector<int> allDensities;
+    Vector<abi::Variant> allVariants;
+};
+
+static GroupAxes collectGroupAxes(const SortedVector<SplitDescription>& group) {
+    GroupAxes axes;
+    const size_t groupSize = group.size();
+    for (size_t i = 1; i < groupSize; i++) {
+        if (group[i].config.density != group[0].config.density) {
+            // This group differs by density.
+            for (size_t j = 0; j < groupSize; j++) {
+                axes.allDensities.add(group[j].config.density);
+            }
+            break;
+        }
+    }
+    for (size_t i = 1; i < groupSize; i++) {
+        if (group[i].abi != group[0].abi) {
+            // This group differs by ABI.
+            for (size_t j = 0; j < groupSize; j++) {
+                axes.allVariants.add(group[j].abi);
+            }
+            break;
+        }
+    }
+    return axes;
+}
+
+static sp<Rule> generateWithAxes(const SortedVector<SplitDescription>& group, size_t index,
+        const GroupAxes& axes) {
     sp<Rule> rootRule = new Rule();
     rootRule->op = Rule::AND_SUBRULES;
 
@@ -118,46 +150,41 @@ sp<Rule> RuleGenerator::generate(const SortedVector<SplitDescription>& group, si
     }
 
     if (group[index].config.density != 0) {
-        size_t densityIndex = 0;
-        Vector<int> allDensities;
-        allDensities.add(group[index].config.density);
-
-        const size_t groupSize = group.size();
-        for (size_t i = 0; i < groupSize; i++) {
-            if (group[i].config.density != group[index].config.density) {
-                // This group differs by density.
-                allDensities.clear();
-                for (size_t j = 0; j < groupSize; j++) {
-                    allDensities.add(group[j].config.density);
-                }
-                densityIndex = index;
-                break;
-            }
+        if (axes.allDensities.isEmpty()) {
+            Vector<int> allDensities;
+            allDensities.add(group[index].config.density);
+            rootRule->subrules.add(RuleGenerator::generateDensity(allDensities, 0));
+        } else {
+            rootRule->subrules.add(RuleGenerator::generateDensity(axes.allDensities, index));
         }
-        rootRule->subrules.add(generateDensity(allDensities, densityIndex));
     }
 
     if (group[index].abi != abi::Variant_none) {
-        size_t abiIndex = 0;
-        Vector<abi::Variant> allVariants;
-        allVariants.add(group[index].abi);
-
-        const size_t groupSize = group.size();
-        for (size_t i = 0; i < groupSize; i++) {
-            if (group[i].abi != group[index].abi) {
-                // This group differs by ABI.
-                allVariants.clear();
-                for (size_t j = 0; j < groupSize; j++) {
-                    allVariants.add(group[j].abi);
-                }
-                abiIndex = index;
-                break;
-            }
+        if (axes.allVariants.isEmpty()) {
+            Vector<abi::Variant> allVariants;
+            allVariants.add(group[index].abi);
+            rootRule->subrules.add(RuleGenerator::generateAbi(allVariants, 0));
+        } else {
+            rootRule->subrules.add(RuleGenerator::generateAbi(axes.allVariants, index));
         }
-        rootRule->subrules.add(generateAbi(allVariants, abiIndex));
     }
 
     return rootRule;
 }
 
+sp<Rule> RuleGenerator::generate(const SortedVector<SplitDescription>& group, size_t index) {
+    return generateWithAxes(group, index, collectGroupAxes(group));
+}
+
+Vector<sp<Rule> > RuleGenerator::generateAll(const SortedVector<SplitDescription>& group) {
+    const GroupAxes axes = collectGroupAxes(group);
+    Vector<sp<Rule> > rules;
+    const size_t groupSize = group.size();
+    rules.setCapacity(groupSize);
+    for (size_t i = 0; i < groupSize; i++) {
+        rules.add(generateWithAxes(group, i, axes));
+    }
+    return rules;
+}
+
 } // namespace split
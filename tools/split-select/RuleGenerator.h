@@ -30,6 +30,12 @@ struct RuleGenerator {
     // Generate rules for a Split given the group of mutually exclusive splits it belongs to
     static android::sp<Rule> generate(const android::SortedVector<SplitDescription>& group, size_t index);
 
+    // Generate rules for all the splits of a group of mutually exclusive splits, in the order of
+    // the group. Cheaper than calling generate() for each split, as the densities and ABIs of the
+    // group are only collected once.
+    static android::Vector<android::sp<Rule> > generateAll(
+            const android::SortedVector<SplitDescription>& group);
+
     static android::sp<Rule> generateAbi(const android::Vector<abi::Variant>& allVariants, size_t index);
     static android::sp<Rule> generateDensity(const android::Vector<int>& allDensities, size_t index);
 };
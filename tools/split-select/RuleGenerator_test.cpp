@@ -20,6 +20,7 @@
 #include "TestRules.h"
 
 #include <gtest/gtest.h>
+#include <utils/SortedVector.h>
 #include <utils/Vector.h>
 
 using namespace android;
@@ -107,4 +108,28 @@ TEST(RuleGeneratorTest, testDensityRulesWithAnyDpi) {
     EXPECT_RULES_EQ(RuleGenerator::generateDensity(densities, anyIndex), AlwaysTrue());
 }
 
+TEST(RuleGeneratorTest, generateAllMatchesGenerate) {
+    SortedVector<SplitDescription> densityGroup;
+    SortedVector<SplitDescription> abiGroup;
+    const char* densitySplits[] = {"mdpi", "hdpi", "xhdpi", "xxhdpi", "anydpi"};
+    const char* abiSplits[] = {":armeabi", ":armeabi-v7a", ":x86"};
+    SplitDescription split;
+    for (const char* str : densitySplits) {
+        ASSERT_TRUE(SplitDescription::parse(String8(str), &split));
+        densityGroup.add(split);
+    }
+    for (const char* str : abiSplits) {
+        ASSERT_TRUE(SplitDescription::parse(String8(str), &split));
+        abiGroup.add(split);
+    }
+
+    for (const SortedVector<SplitDescription>* group : {&densityGroup, &abiGroup}) {
+        const Vector<sp<Rule> > rules = RuleGenerator::generateAll(*group);
+        ASSERT_EQ(group->size(), rules.size());
+        for (size_t i = 0; i < group->size(); i++) {
+            EXPECT_RULES_EQ(rules[i], *RuleGenerator::generate(*group, i));
+        }
+    }
+}
+
 } // namespace split
@@ -36,8 +36,7 @@ SplitSelector::SplitSelector(const Vector<SplitDescription>& splits)
 
 static void selectBestFromGroup(const SortedVector<SplitDescription>& splits,
         const SplitDescription& target, Vector<SplitDescription>& splitsOut) {
-    SplitDescription bestSplit;
-    bool isSet = false;
+    const SplitDescription* bestSplit = NULL;
     const size_t splitCount = splits.size();
     for (size_t j = 0; j < splitCount; j++) {
         const SplitDescription& thisSplit = splits[j];
@@ -45,14 +44,13 @@ static void selectBestFromGroup(const SortedVector<SplitDescription>& splits,
             continue;
         }
 
-        if (!isSet || thisSplit.isBetterThan(bestSplit, target)) {
-            isSet = true;
-            bestSplit = thisSplit;
+        if (bestSplit == NULL || thisSplit.isBetterThan(*bestSplit, target)) {
+            bestSplit = &thisSplit;
         }
     }
 
-    if (isSet) {
-        splitsOut.add(bestSplit);
+    if (bestSplit != NULL) {
+        splitsOut.add(*bestSplit);
     }
 }
 
@@ -71,9 +69,10 @@ KeyedVector<SplitDescription, sp<Rule> > SplitSelector::getRules() const {
     const size_t groupCount = mGroups.size();
     for (size_t i = 0; i < groupCount; i++) {
         const SortedVector<SplitDescription>& splits = mGroups[i];
+        const Vector<sp<Rule> > groupRules = RuleGenerator::generateAll(splits);
         const size_t splitCount = splits.size();
         for (size_t j = 0; j < splitCount; j++) {
-            sp<Rule> rule = Rule::simplify(RuleGenerator::generate(splits, j));
+            sp<Rule> rule = Rule::simplify(groupRules[j]);
             if (rule != NULL) {
                 rules.add(splits[j], rule);
             }
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures grouping, selection and rule generation on synthetic bundles of density, locale and
+// ABI splits. Every benchmark takes the shape of the bundle as arguments:
+//   locales, densities
+// which makes locales * densities density splits, one group per locale, plus an ABI group.
+
+#include <benchmark/benchmark.h>
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include "Grouper.h"
+#include "SplitDescription.h"
+#include "SplitSelector.h"
+
+using namespace android;
+
+namespace split {
+
+static const char* const kAbis[] = {
+    "armeabi", "armeabi-v7a", "arm64-v8a", "x86", "x86_64",
+};
+
+static Vector<SplitDescription> makeSplits(size_t localeCount, size_t densityCount) {
+    Vector<SplitDescription> splits;
+    SplitDescription split;
+    for (size_t i = 0; i < localeCount; i++) {
+        const char language[] = {char('a' + (i / 26) % 26), char('a' + i % 26), '\0'};
+        for (size_t j = 0; j < densityCount; j++) {
+            String8 str = String8::format("%s-%zudpi", language, 120 + 4 * j);
+            if (SplitDescription::parse(str, &split)) {
+                splits.add(split);
+            }
+        }
+    }
+    for (const char* abi : kAbis) {
+        if (SplitDescription::parse(String8::format(":%s", abi), &split)) {
+            splits.add(split);
+        }
+    }
+    return splits;
+}
+
+static void BM_GroupSplits(benchmark::State& state) {
+    const Vector<SplitDescription> splits = makeSplits(state.range(0), state.range(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(groupByMutualExclusivity(splits).size());
+    }
+    state.SetItemsProcessed(state.iterations() * splits.size());
+}
+
+static void BM_GetBestSplits(benchmark::State& state) {
+    const Vector<SplitDescription> splits = makeSplits(state.range(0), state.range(1));
+    const SplitSelector selector(splits);
+    SplitDescription target;
+    SplitDescription::parse(String8("ab-xhdpi-v21:arm64-v8a"), &target);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(selector.getBestSplits(target).size());
+    }
+    state.SetItemsProcessed(state.iterations() * splits.size());
+}
+
+static void BM_GetRules(benchmark::State& state) {
+    const Vector<SplitDescription> splits = makeSplits(state.range(0), state.range(1));
+    const SplitSelector selector(splits);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(selector.getRules().size());
+    }
+    state.SetItemsProcessed(state.iterations() * splits.size());
+}
+
+// From a few splits to a bundle with hundreds in one density group.
+BENCHMARK(BM_GroupSplits)->Args({1, 6})->Args({50, 6})->Args({4, 100})->Args({1, 400});
+BENCHMARK(BM_GetBestSplits)->Args({1, 6})->Args({50, 6})->Args({4, 100})->Args({1, 400});
+BENCHMARK(BM_GetRules)->Args({1, 6})->Args({50, 6})->Args({4, 100})->Args({1, 400});
+
+} // namespace split
+
+BENCHMARK_MAIN();
@@ -11,6 +11,7 @@ using namespace google::protobuf::io;
 using namespace std;
 
 const bool GENERATE_MAPPING = true;
+const bool GENERATE_DESCRIPTORS = true;
 
 static string
 make_filename(const FileDescriptorProto& file_descriptor)
@@ -115,6 +116,19 @@ write_message(stringstream& text, const DescriptorProto& message, const string&
         text << indented << "};" << endl << endl;
     }
 
+    N = message.field_size();
+    if (GENERATE_DESCRIPTORS && N > 0) {
+        text << indented << "static constexpr ::android::util::ProtoFieldDescriptor"
+                << " _FIELD_DESCRIPTORS[" << N << "] = {" << endl;
+        for (int i=0; i<N; i++) {
+            const FieldDescriptorProto& field = message.field(i);
+            text << indented << INDENT << "{ " << make_constant_name(field.name())
+                    << ", ::android::util::" << get_wire_type_name(field) << ", "
+                    << (int)get_privacy_dest(field) << " }," << endl;
+        }
+        text << indented << "};" << endl << endl;
+    }
+
     text << indent << "} //" << message.name() << endl;
     text << endl;
 }
@@ -135,6 +149,11 @@ write_header_file(CodeGeneratorResponse* response, const FileDescriptorProto& fi
     text << "#define " << header << endl;
     text << endl;
 
+    if (GENERATE_DESCRIPTORS) {
+        text << "#include <android/util/ProtoOutputStream.h>" << endl;
+        text << endl;
+    }
+
     vector<string> namespaces = split(file_descriptor.package(), '.');
     for (vector<string>::iterator it = namespaces.begin(); it != namespaces.end(); it++) {
         text << "namespace " << *it << " {" << endl;
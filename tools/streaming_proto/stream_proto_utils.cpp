@@ -1,5 +1,7 @@
 #include "stream_proto_utils.h"
 
+#include "google/protobuf/unknown_field_set.h"
+
 namespace android {
 namespace stream_proto {
 
@@ -17,6 +19,14 @@ const uint64_t FIELD_COUNT_SINGLE = 1ULL << FIELD_COUNT_SHIFT;
 const uint64_t FIELD_COUNT_REPEATED = 2ULL << FIELD_COUNT_SHIFT;
 const uint64_t FIELD_COUNT_PACKED = 5ULL << FIELD_COUNT_SHIFT;
 
+/**
+ * Extension number of the android.privacy field option, and the field number of dest in
+ * PrivacyFlags. See frameworks/base/core/proto/android/privacy.proto.
+ */
+const int PRIVACY_EXTENSION_NUMBER = 102672883;
+const int PRIVACY_DEST_NUMBER = 1;
+const uint8_t PRIVACY_DEST_UNSET = 255;
+
 uint64_t
 get_field_id(const FieldDescriptorProto& field)
 {
@@ -84,6 +94,54 @@ get_proto_type(const FieldDescriptorProto& field)
     }
 }
 
+string
+get_wire_type_name(const FieldDescriptorProto& field)
+{
+    if (field.options().packed()) {
+        return "WIRE_TYPE_LENGTH_DELIMITED";
+    }
+    switch (field.type()) {
+        case FieldDescriptorProto::TYPE_DOUBLE:
+        case FieldDescriptorProto::TYPE_FIXED64:
+        case FieldDescriptorProto::TYPE_SFIXED64:
+            return "WIRE_TYPE_FIXED64";
+        case FieldDescriptorProto::TYPE_FLOAT:
+        case FieldDescriptorProto::TYPE_FIXED32:
+        case FieldDescriptorProto::TYPE_SFIXED32:
+            return "WIRE_TYPE_FIXED32";
+        case FieldDescriptorProto::TYPE_STRING:
+        case FieldDescriptorProto::TYPE_MESSAGE:
+        case FieldDescriptorProto::TYPE_BYTES:
+            return "WIRE_TYPE_LENGTH_DELIMITED";
+        default:
+            return "WIRE_TYPE_VARINT";
+    }
+}
+
+uint8_t
+get_privacy_dest(const FieldDescriptorProto& field)
+{
+    const UnknownFieldSet& options = field.options().unknown_fields();
+    for (int i=0; i<options.field_count(); i++) {
+        const UnknownField& option = options.field(i);
+        if (option.number() != PRIVACY_EXTENSION_NUMBER
+                || option.type() != UnknownField::TYPE_LENGTH_DELIMITED) {
+            continue;
+        }
+        UnknownFieldSet flags;
+        if (!flags.ParseFromString(option.length_delimited())) {
+            continue;
+        }
+        for (int j=0; j<flags.field_count(); j++) {
+            const UnknownField& flag = flags.field(j);
+            if (flag.number() == PRIVACY_DEST_NUMBER && flag.type() == UnknownField::TYPE_VARINT) {
+                return (uint8_t)flag.varint();
+            }
+        }
+    }
+    return PRIVACY_DEST_UNSET;
+}
+
 bool
 should_generate_for_file(const CodeGeneratorRequest& request, const string& file)
 {
@@ -20,6 +20,17 @@ uint64_t get_field_id(const FieldDescriptorProto& field);
  */
 string get_proto_type(const FieldDescriptorProto& field);
 
+/**
+ * Get the name of the WIRE_TYPE_* constant in android/util/protobuf.h a field is written with.
+ */
+string get_wire_type_name(const FieldDescriptorProto& field);
+
+/**
+ * Get the dest of the android.privacy option of a field, or 255 (DEST_UNSET) if it has none.
+ * The option is read from the unknown fields since privacy.proto isn't linked in.
+ */
+uint8_t get_privacy_dest(const FieldDescriptorProto& field);
+
 /**
  * See if this is the file for this request, and not one of the imported ones.
  */